@@ -10,6 +10,7 @@ Device		gs_Device;
 
 #ifdef MUSIC
 V2MPlayer	gs_Music;
+SynthStream	gs_MusicStream;
 void*		gs_pMusicPlayerWorkMem;
 #endif
 
@@ -202,6 +203,14 @@ int	WindowInit()
 	SetFocus( gs_WindowInfos.hWnd );
 
 
+	//////////////////////////////////////////////////////////////////////////
+	// Start the worker threads first since the device and everything after it share them
+#ifdef TRACING
+	gs_Trace.Init();	// Allocate the trace buffers before the workers can record anything
+#endif
+	gs_Jobs.Init();
+
+
 	//////////////////////////////////////////////////////////////////////////
 	// Initialize DirectX Device
 // 
@@ -227,7 +236,12 @@ int	WindowInit()
 	if ( !gs_Music.Open( pTheTune ) )
 		return ERR_MUSIC_INIT;
 
-	dsInit( gs_Music.RenderProxy, &gs_Music, gs_WindowInfos.hWnd );
+#ifdef MUSIC_PRERENDER
+	gs_MusicStream.InitPreRendered( gs_Music );	// Renders on its own thread during IntroInit()
+#else
+	gs_MusicStream.Init( gs_Music, MUSIC_LOOKAHEAD_MS );
+#endif
+	dsInit( SynthStream::RenderProxy, &gs_MusicStream, gs_WindowInfos.hWnd );
 
 // Readback positions
 // sS32*	pPositions = NULL;
@@ -247,6 +261,7 @@ void	WindowExit()
 	// Kill the music
 #ifdef MUSIC
 	dsClose();
+	gs_MusicStream.Exit();
 
 	delete[] gs_pMusicPlayerWorkMem;
 	gs_Music.Close();
@@ -257,6 +272,12 @@ void	WindowExit()
 	ASSERT( RemainingComponents == 0, "Some DirectX components remain on exit !	Did you forget some deletes ???" );	// This means you forgot to clean up some components ! It's okay since the device is going to clean them up for you, but it's better yet if you know what your doing and take care of your own garbage...
 	gs_Device.Exit();
 
+	// Stop the worker threads once nobody can push jobs anymore
+	gs_Jobs.Exit();
+#ifdef TRACING
+	gs_Trace.Exit();
+#endif
+
 	// Destroy the Windows contexts
 	if ( gs_WindowInfos.hDC != NULL )	ReleaseDC( gs_WindowInfos.hWnd, gs_WindowInfos.hDC );
 	if ( gs_WindowInfos.hWnd != NULL )	DestroyWindow( gs_WindowInfos.hWnd );
@@ -276,7 +297,7 @@ void	DrawTime( float t )
 	static int		frame=0;
 	static float	OldTime=0.0;
 	static int		fps=0;
-	char			str[128];
+	char			str[512];
 	int				s, m, c;
 
 	if ( t < 0.0f )
@@ -300,7 +321,16 @@ void	DrawTime( float t )
 		c = floorf( t * 100.0f ) % 100;
 		float	ms = 1000.0f / fps;
 
-		sprintf_s( str, 128, "%s %02d:%02d:%02d  [%d fps] [%4.4f ms] (!DEBUG WIP VERSION!)", pWindowClass, m, s, c, fps, ms );
+		int	Length = sprintf_s( str, 512, "%s %02d:%02d:%02d  [%d fps] [%4.4f ms] (!DEBUG WIP VERSION!) ", pWindowClass, m, s, c, fps, ms );
+
+#ifdef TRACK_ALLOCATIONS
+		// The heap allocations of the last frame, that we want to drive to 0
+		const AllocationStats&	Allocations = GetLastFrameAllocationStats();
+		Length += sprintf_s( str + Length, 512 - Length, "[%d allocs %d KB, %d KB live %d KB peak] ", Allocations.AllocationsCount, Allocations.AllocatedBytes >> 10, int(GetLiveAllocatedBytes() >> 10), int(GetPeakAllocatedBytes() >> 10) );
+#endif
+
+		// Overlay the device's statistics of the last frame
+		FrameStatsCapture::Format( gs_Device.GetLastFrameStats(), str + Length, 512 - Length );
 		SetWindowText( gs_WindowInfos.hWnd, str );
 	}
 }
@@ -420,6 +450,16 @@ void WINAPI	EntryPoint()
 		ExitProcess( ErrorCode );
 	}
 
+	AllocateMemoryPool();
+
+#ifdef MICRO_BENCHMARKS
+	// Measure the CPU kernels instead of running the intro
+	RunMicroBenchmarks( "./MicroBenchmarks.csv" );
+	WindowExit();
+	FreeMemoryPool();
+	ExitProcess( 0 );
+#endif
+
 	IntroProgressDelegate	Progress = { &gs_WindowInfos, ShowProgress };
 	if ( (ErrorCode = IntroInit( Progress )) )
 	{
@@ -428,22 +468,38 @@ void WINAPI	EntryPoint()
 		ExitProcess( -ErrorCode );
 	}
 
-	// Start the music
-#ifdef MUSIC
-	gs_Music.Play();
+	// Start the music (an offline capture doesn't play it, its time is derived from the frame index instead)
+#if defined(MUSIC) && !defined(IMAGE_SEQUENCE_CAPTURE)
+	gs_MusicStream.Play();
 #endif
 
 	//////////////////////////////////////////////////////////////////////////
 	// Run the message loop !
-	bool	bFinished = false;
-    float	StartTime = 0.001f * timeGetTime(); 
-	float	LastTime = 0.0f;
+	bool		bFinished = false;
+	FramePacer	Pacer( 60.0f );
+#ifndef NDEBUG
+	FrameStatsCapture	FrameStats( gs_Device );
+#endif
+#ifdef BENCHMARK
+	Benchmark	Bench( gs_Device, BENCHMARK, 120, 1200 );
+#endif
+#ifdef IMAGE_SEQUENCE_CAPTURE
+	ImageSequenceCapture	Capture( gs_Device, IMAGE_SEQUENCE_CAPTURE, 60, 3600, ImageSequenceCapture::PNG, 1 );
+	gs_pImageSequenceCapture = &Capture;
+#endif
 
 	while ( !bFinished )
 	{
-		float	Time = 0.001f * timeGetTime() - StartTime;
-	    float	DeltaTime = Time - LastTime;
-		LastTime = Time;
+		TRACE_SCOPE( "Frame" );
+
+#if defined(MUSIC) && defined(MUSIC_PRERENDER)
+		Pacer.BeginFrame( gs_MusicStream.GetPlayTime() );	// Exact sync on the music
+#else
+		Pacer.BeginFrame();
+#endif
+
+		// Recycle last frame's scratch memory
+		FrameMemoryReset();
 
 		// Process Windows messages
 		MSG		msg;
@@ -459,8 +515,33 @@ void WINAPI	EntryPoint()
 
 #ifndef NDEBUG
 		// Show FPS
-		DrawTime( Time );
+		DrawTime( Pacer.GetTime() );
 		HandleEvents();
+
+		// F11 captures the statistics of the next 10 seconds (at 60 fps)
+		static bool	bCaptureKeyWasDown = false;
+		if ( gs_WindowInfos.pKeys[VK_F11] && !bCaptureKeyWasDown )
+			FrameStats.Start( "./FrameStats.csv", 600 );
+		bCaptureKeyWasDown = gs_WindowInfos.pKeys[VK_F11] != 0;
+
+		// F10 toggles the DO_NOT_WAIT map attempts
+		gs_Device.SetMapDoNotWait( gs_WindowInfos.pKeysToggle[VK_F10] != 0 );
+#endif
+
+#ifdef TRACING
+		// F9 starts recording a trace, pressing it again writes the trace
+		static bool	bTraceKeyWasDown = false;
+		if ( gs_WindowInfos.pKeys[VK_F9] && !bTraceKeyWasDown )
+		{
+			if ( !gs_Trace.IsRecording() )
+				gs_Trace.StartRecording();
+			else
+			{
+				gs_Trace.StopRecording();
+				gs_Trace.Export( "./Trace.json" );
+			}
+		}
+		bTraceKeyWasDown = gs_WindowInfos.pKeys[VK_F9] != 0;
 #endif
 
 #ifdef SURE_DEBUG
@@ -471,13 +552,32 @@ void WINAPI	EntryPoint()
 		ReloadChangedTweakableValues();
 
 		// Reload modified shaders
-		WatchIncludesModifications();
-		Shader::WatchShadersModifications();
-		ComputeShader::WatchShadersModifications();
+		WatchShaderFilesModifications();
+#endif
+
+#ifdef BENCHMARK
+		// Render the frames at fixed times so every run renders the same frames whatever the frame rate
+		float	Time = Bench.GetFramesCount() * Pacer.GetStep();
+		bFinished |= !IntroUpdate( Time, Pacer.GetStep() );
+		bFinished |= !IntroDo( Time, Pacer.GetStep() );
+		bFinished |= !Bench.Update();
+#elif defined(IMAGE_SEQUENCE_CAPTURE)
+		// Render the frames at fixed virtual times whatever the rendering takes (the frame is grabbed by IntroDo() before presenting)
+		float	Time = Capture.GetTime();
+		bFinished |= !IntroUpdate( Time, Capture.GetDeltaTime() );
+		bFinished |= !IntroDo( Time, Capture.GetDeltaTime() );
+		bFinished |= !Capture.Update();
+#else
+		// Run the intro: simulate at a fixed rate then render once
+		while ( Pacer.Step() )
+			bFinished |= !IntroUpdate( Pacer.GetSimulationTime(), Pacer.GetStep() );
+
+		bFinished |= !IntroDo( Pacer.GetRenderTime(), Pacer.GetDeltaTime() );
 #endif
 
-		// Run the intro
-		bFinished |= !IntroDo( Time, DeltaTime );
+#ifndef NDEBUG
+		FrameStats.Update();
+#endif
 
 // This was in iQ's framework, I don't know what it's for. I believe it's useful when using OpenGL but with DirectX it makes everything slow as hell (attempts to load/unload DLLs every frame) !
 // I left it here so everyone knows it must NOT be called...
@@ -487,15 +587,36 @@ void WINAPI	EntryPoint()
 	//////////////////////////////////////////////////////////////////////////
 
 	// Stop the music
-#ifdef MUSIC
-	gs_Music.Stop();
+#if defined(MUSIC) && !defined(IMAGE_SEQUENCE_CAPTURE)
+	gs_MusicStream.Stop();
+#endif
+
+#ifdef IMAGE_SEQUENCE_CAPTURE
+	// Write the last images before the device goes away
+	Capture.Finish();
+	gs_pImageSequenceCapture = NULL;
+#endif
+
+	// Write the results and fail if we're slower than the baseline (copy a previous Benchmark.json over the baseline to accept new timings)
+	int	ExitCode = 0;
+#ifdef BENCHMARK
+	Bench.Write( "./Benchmark.json" );
+	if ( !Bench.Compare( "./Benchmark.baseline.json", 0.05f ) )
+		ExitCode = 1;
 #endif
 
  	IntroExit();
 
 	WindowExit();
 
+#ifdef TRACK_ALLOCATIONS
+	// Whatever is still alive now was leaked (or belongs to a static instance)
+	WriteAllocationReport( "./AllocationLeaks.csv" );
+#endif
+
+	FreeMemoryPool();
+
 	// Clean exit...
-	ExitProcess( 0 );
+	ExitProcess( ExitCode );
 }
 
@@ -15,6 +15,12 @@
 #define ALLOW_WINDOWED
 
 //#define MUSIC			// Enable music
+#define MUSIC_LOOKAHEAD_MS	200	// How far ahead of the output the music is synthesized (cf. Sound/SynthStream.h)
+//#define MUSIC_PRERENDER		// Pre-render the whole music while the intro initializes and drive the intro's time by the audio clock
+
+//#define MICRO_BENCHMARKS	// Define this to measure the CPU kernels into ./MicroBenchmarks.csv instead of running the intro (cf. Utility/MicroBenchmarks.h)
+//#define BENCHMARK	"GlobalIllum2"	// Define this to benchmark the effect the intro renders (along a fixed camera path), the value names it in ./Benchmark.json
+//#define IMAGE_SEQUENCE_CAPTURE	"./Capture/Frame"	// Define this to render the intro offline at fixed time steps into an image sequence with this prefix (cf. RendererD3D11/ImageSequenceCapture.h)
 
 #ifdef A64BITS
 #pragma pack(8)			// VERY important, so WNDCLASS gets the correct padding and we don't crash the system
@@ -38,50 +44,96 @@
 #endif
 #include "Utility/Memory.h"
 #include "Utility/Random.h"
+#include "Utility/RandomStream.h"
 #include "Utility/Resources.h"
+#include "Utility/ShaderPermutations.h"
 #include "Utility/Camera.h"
 #include "Utility/SH.h"
 #include "Utility/tweakval.h"
 #include "Utility/MemoryMappedFile.h"
+#include "Utility/FileWatcher.h"
+#include "Utility/FramePacer.h"
+#include "Utility/MicroBenchmarks.h"
 #include "Utility/Profiling.h"
+#include "Utility/Trace.h"
 #include "Utility/FPSCamera.h"
 #include "Utility/Video.h"
+#include "Utility/VideoSource.h"
 #include "Utility/TextureFilePOM.h"
 #include "Utility/Octree.h"
+#include "Utility/PointGrid.h"
+#include "Utility/Tetrahedralization.h"
+#include "Utility/BoundsCuller.h"
+#include "Utility/OcclusionCuller.h"
+#include "Utility/MeshSimplifier.h"
 
 // DirectX Renderer
 #include "RendererD3D11/Device.h"
+#include "RendererD3D11/GPUProfiler.h"
+#include "RendererD3D11/JobQueue.h"
+#include "RendererD3D11/RenderTargetPool.h"
+#include "RendererD3D11/RenderTargetFormats.h"
+#include "RendererD3D11/RenderGraph.h"
+#include "RendererD3D11/CommandList.h"
+#include "RendererD3D11/TextureStreamer.h"
+#include "RendererD3D11/FrameStatsCapture.h"
+#include "RendererD3D11/Benchmark.h"
+#include "RendererD3D11/ImageSequenceCapture.h"
 #include "RendererD3D11/Components/Texture2D.h"
 #include "RendererD3D11/Components/Texture3D.h"
 #include "RendererD3D11/Components/StructuredBuffer.h"
 #include "RendererD3D11/Components/Shader.h"
 #include "RendererD3D11/Components/ComputeShader.h"
 #include "RendererD3D11/Components/ConstantBuffer.h"
+#include "RendererD3D11/Components/GeometryPool.h"
+#include "RendererD3D11/Components/DynamicGeometry.h"
 #include "RendererD3D11/Components/Primitive.h"
 #include "RendererD3D11/Components/States.h"
+#include "RendererD3D11/Components/PipelineState.h"
+#include "Utility/MultiView.h"
 
 // V2 Sound Player
 #include "Sound/v2mplayer.h"
 #include "Sound/libv2.h"
+#include "Sound/SynthStream.h"
 
 // 2D Procedural
 #include "Procedural/TextureBuilder.h"
+#include "Procedural/TextureBuilderGPU.h"
+#include "Procedural/JumpFlood.h"
+#include "Procedural/BlockCompressor.h"
+#include "Procedural/VolumeBuilder.h"
 #include "Procedural/Generators/Noise.h"
 #include "Procedural/Generators/Generators.h"
 #include "Procedural/Filters/Filters.h"
 #include "Procedural/DrawUtils/Draw.h"
+#include "Procedural/TextureGraph.h"
+#include "Procedural/VirtualTexture.h"
+#include "Procedural/BrickVolume.h"
+
+// Scene loading
+#include "Scene/Scene.h"
+#include "Scene/SceneStreamer.h"
 
 // 3D Procedural
 #include "Procedural/GeometryBuilder.h"
 #include "Procedural/RayTracer.h"
 
-// Scene loading
-#include "Scene/Scene.h"
-
 // Indirect Lighting
 #include "Utility/SHProbeEncoder/SHProbeNetwork.h"
 #include "Utility/SHProbeEncoder/SHProbeEncoder.h"
 
+// Post-processes
+#include "Utility/DepthUpsampler.h"
+#include "Utility/DepthPyramid.h"
+#include "Utility/MipGenerator.h"
+#include "Utility/EnvMapFilter.h"
+#include "Utility/ToneMapper.h"
+#include "Utility/TemporalAA.h"
+#include "Utility/VoxelGI.h"
+#include "Utility/GPUAlgorithms.h"
+#include "Utility/TextureArrayPacker.h"
+
 
 extern const float4	LUMINANCE;	// D65 Illuminant with observer at 2
 
@@ -114,6 +166,7 @@ extern Device		gs_Device;
 //////////////////////////////////////////////////////////////////////////
 // The sound player
 extern V2MPlayer	gs_Music;
+extern SynthStream	gs_MusicStream;
 extern void*		gs_pMusicPlayerWorkMem;
 
 //////////////////////////////////////////////////////////////////////////
@@ -132,5 +185,6 @@ void	print( const char* _pText, ... );	// Works only in DEBUG mode !
 
 //////////////////////////////////////////////////////////////////////////
 // Main intro functions
+#include "Utility/InitGraph.h"
 #include "Intro/Intro.h"
 
@@ -7,106 +7,92 @@ Texture3D*	gs_pTexNoise3D = NULL;
 //////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////
 
-int	Build3DTextures( IntroProgressDelegate& _Delegate )
+namespace
 {
-	half4*	ppNoise[NOISE3D_SHIFT+1];
+	struct	NoiseFillData
+	{
+		const Noise*	pNoise;
+		float3			pOffsets[4];
+	};
 
-	// Build wrapping 3D noise for mip level 0
-	Noise	N( 1 );
-	_randpushseed();
-	_srand( RAND_DEFAULT_SEED_U, RAND_DEFAULT_SEED_V );
+	// Fills each component as a regular lattice (voxels are stored X first, which is what the lattice fill gives us)
+	void	FillNoise( VolumeBuilder& _Builder, int _Z0, int _Z1, void* _pData )
+	{
+		const NoiseFillData&	Data = *((const NoiseFillData*) _pData);
+		float*	pVoxels = _Builder.GetMip( 0 );
+		for ( int ComponentIndex=0; ComponentIndex < 4; ComponentIndex++ )
+			Data.pNoise->WrapPerlinLattice( Data.pOffsets[ComponentIndex], NOISE3D_SIZE, NOISE3D_SIZE, NOISE3D_SIZE, pVoxels + ComponentIndex, sizeof(float4), _Z0, _Z1 );
+	}
 
-	ppNoise[0] = new half4[NOISE3D_SIZE*NOISE3D_SIZE*NOISE3D_SIZE];
+	NoiseFillData	gs_Noise3DData;
+	VolumeBuilder*	gs_pNoise3DBuilder = NULL;	// Only built when the cached noise can't be used
 
-	float3	Position;
-	float3	Offset0( _frand(), _frand(), _frand() );
-	float3	Offset1( _frand(), _frand(), _frand() );
-	float3	Offset2( _frand(), _frand(), _frand() );
-	for ( int Z=0; Z < NOISE3D_SIZE; Z++ )
+	// Draws the offsets of the noise components (the random generator isn't thread-safe so this must happen before preparing)
+	void	InitNoise3DOffsets()
 	{
-		Position.z = float(Z) / NOISE3D_SIZE;
-		for ( int Y=0; Y < NOISE3D_SIZE; Y++ )
-		{
-			Position.y = float(Y) / NOISE3D_SIZE;
-			for ( int X=0; X < NOISE3D_SIZE; X++ )
-			{
-				Position.x = float(X) / NOISE3D_SIZE;
-
-				int	Index = X+((Y+(Z<<NOISE3D_SHIFT)) << NOISE3D_SHIFT);
-
-				ppNoise[0][Index].x = N.WrapPerlin( Position );
-				ppNoise[0][Index].y = N.WrapPerlin( Position + Offset0 );
-				ppNoise[0][Index].z = N.WrapPerlin( Position + Offset1 );
-				ppNoise[0][Index].w = N.WrapPerlin( Position + Offset2 );
-			}
-		}
+		_randpushseed();
+		_srand( RAND_DEFAULT_SEED_U, RAND_DEFAULT_SEED_V );
+
+		gs_Noise3DData.pOffsets[0] = float3::Zero;
+		for ( int ComponentIndex=1; ComponentIndex < 4; ComponentIndex++ )
+			gs_Noise3DData.pOffsets[ComponentIndex].Set( _frand(), _frand(), _frand() );
+
+		_randpopseed();
+	}
+
+	// Builds wrapping 3D noise for mip level 0 and its mips
+	void	BuildNoise3D()
+	{
+		Noise	N( 1 );
+		gs_Noise3DData.pNoise = &N;
+
+		gs_pNoise3DBuilder = new VolumeBuilder( NOISE3D_SIZE, NOISE3D_SIZE, NOISE3D_SIZE, 4 );
+		gs_pNoise3DBuilder->Fill( FillNoise, &gs_Noise3DData );
+		gs_pNoise3DBuilder->GenerateMips();
+
+		gs_Noise3DData.pNoise = NULL;
 	}
-	_randpopseed();
 
-	// Build mipmaps
-	int	Size = NOISE3D_SIZE;
-	for ( int MipLevel=1; MipLevel <= NOISE3D_SHIFT; MipLevel++ )
+	// Worker thread: only builds the noise if there's no cache to reuse
+	int		PrepareNoise3D( void* _pData )
 	{
-		int	PreviousSize = Size;
-		Size >>= 1;
+		if ( GetFileAttributesA( "./Noise32x32x32.pom" ) == INVALID_FILE_ATTRIBUTES )
+			BuildNoise3D();
+		return 0;
+	}
 
-		ppNoise[MipLevel] = new half4[Size*Size*Size];
-		for ( int Z=0; Z < Size; Z++ )
+	// Device thread: reuses the noise built at last launch if it's still there, otherwise generates the texture and saves it for next time
+	int		CreateNoise3D( void* _pData )
+	{
+		if ( gs_pNoise3DBuilder == NULL )
+			gs_pTexNoise3D = VolumeBuilder::LoadCachedTexture( "./Noise32x32x32.pom", NOISE3D_SIZE, NOISE3D_SIZE, NOISE3D_SIZE, PixelFormatRGBA16F::DESCRIPTOR );
+		if ( gs_pTexNoise3D == NULL )
 		{
-			half4*	pSlice0 = ppNoise[MipLevel-1] + PreviousSize*PreviousSize*(2*Z);
-			half4*	pSlice1 = ppNoise[MipLevel-1] + PreviousSize*PreviousSize*(2*Z+1);
-
-			half4*	pTargetSlice = ppNoise[MipLevel] + Size*Size*Z;
-
-			for ( int Y=0; Y < Size; Y++ )
-			{
-				half4*	pScanline00 = pSlice0 + PreviousSize*(2*Y);
-				half4*	pScanline01 = pSlice0 + PreviousSize*(2*Y+1);
-				half4*	pScanline10 = pSlice1 + PreviousSize*(2*Y);
-				half4*	pScanline11 = pSlice1 + PreviousSize*(2*Y+1);
-
-				half4*	pTargetScanline = pTargetSlice + Size*Y;
-
-				for ( int X=0; X < Size; X++ )
-				{
-					int			Px = 2*X;
-					int			Nx = 2*X+1;
-
-					float4	V000 = pScanline00[Px];
-					float4	V001 = pScanline00[Nx];
-					float4	V010 = pScanline01[Px];
-					float4	V011 = pScanline01[Nx];
-					float4	V100 = pScanline10[Px];
-					float4	V101 = pScanline10[Nx];
-					float4	V110 = pScanline11[Px];
-					float4	V111 = pScanline11[Nx];
-
-					float4	V = 0.125f * (V000 + V001 + V010 + V011
-											+ V100 + V101 + V110 + V111);
-
-					*pTargetSlice++ = V;
-				}
-			}
+			if ( gs_pNoise3DBuilder == NULL )
+				BuildNoise3D();	// The cache was stale
+			gs_pTexNoise3D = gs_pNoise3DBuilder->CreateTexture( PixelFormatRGBA16F::DESCRIPTOR, "./Noise32x32x32.pom" );
 		}
-	}
 
-	// Generate texture
-	gs_pTexNoise3D = new Texture3D( gs_Device, NOISE3D_SIZE, NOISE3D_SIZE, NOISE3D_SIZE, PixelFormatRGBA16F::DESCRIPTOR, 0, (void**) ppNoise );
+		delete gs_pNoise3DBuilder;
+		gs_pNoise3DBuilder = NULL;
 
-	gs_pTexNoise3D->Set( 0, true );	// This is a global texture !
+		gs_pTexNoise3D->Set( 0, true );	// This is a global texture !
 
-	for ( int MipLevel=0; MipLevel <= NOISE3D_SHIFT; MipLevel++ )
-		delete[] ppNoise[MipLevel];
+		return 0;
+	}
+}
 
-#if 1
-	// Save as POM format
-	Texture3D*	pStagingNoise = new Texture3D( gs_Device, NOISE3D_SIZE, NOISE3D_SIZE, NOISE3D_SIZE, PixelFormatRGBA16F::DESCRIPTOR, 0, NULL, true );
-	pStagingNoise->CopyFrom( *gs_pTexNoise3D );
-	pStagingNoise->Save( "./Noise32x32x32.pom" );
-	delete pStagingNoise;
-#endif
+int	Build3DTextures( IntroProgressDelegate& _Delegate )
+{
+	InitNoise3DOffsets();
+	PrepareNoise3D( NULL );
+	return CreateNoise3D( NULL );
+}
 
-	return 0;
+int	Declare3DTextures( InitGraph& _Graph )
+{
+	InitNoise3DOffsets();
+	return _Graph.AddTask( "Noise3D", PrepareNoise3D, CreateNoise3D, NULL, 4 );
 }
 
 void	Delete3DTextures()
@@ -3,7 +3,12 @@
 
 #define CHECK_MATERIAL( pMaterial, ErrorCode )		if ( (pMaterial)->HasErrors() ) m_ErrorCode = ErrorCode;
 
-EffectDOF::EffectDOF( Device& _Device, Texture2D& _RTHDR, Primitive& _ScreenQuad, Camera& _Camera ) : m_ErrorCode( 0 ), m_Device( _Device ), m_RTTarget( _RTHDR ), m_ScreenQuad( _ScreenQuad )
+#ifdef COMPUTE_DOF
+const float	EffectDOF::DOF_FOCUS_RANGE = 2.0f;
+const float	EffectDOF::DOF_IN_FOCUS_THRESHOLD = 0.5f;
+#endif
+
+EffectDOF::EffectDOF( Device& _Device, Texture2D& _RTHDR, Primitive& _ScreenQuad, Camera& _Camera ) : m_ErrorCode( 0 ), m_Device( _Device ), m_RTTarget( _RTHDR ), m_ScreenQuad( _ScreenQuad ), m_Camera( _Camera )
 {
 #ifdef SHADERTOY
  	CHECK_MATERIAL( m_pMatShadertoy = CreateMaterial( IDR_SHADER_SHADERTOY, "./Resources/Shaders/Shadertoy.hlsl", VertexFormatPt4::DESCRIPTOR, "VS", NULL, "PS" ), 1 );
@@ -42,8 +47,12 @@ EffectDOF::EffectDOF( Device& _Device, Texture2D& _RTHDR, Primitive& _ScreenQuad
   	CHECK_MATERIAL( m_pMatDOFFar = CreateMaterial( IDR_SHADER_DOF_COMPUTE, "./Resources/Shaders/DOFCompute.hlsl", VertexFormatPt4::DESCRIPTOR, "VS", NULL, "PS_Far" ), 16 );
   	CHECK_MATERIAL( m_pMatDOFCombine = CreateMaterial( IDR_SHADER_DOF_COMPUTE, "./Resources/Shaders/DOFCompute.hlsl", VertexFormatPt4::DESCRIPTOR, "VS", NULL, "PS_Combine" ), 17 );
 
-// 	// Compute Shaders
-// 	CHECK_MATERIAL( m_pCSUpdateProbe = CreateComputeShader( IDR_SHADER_GI_UPDATE_PROBE, "./Resources/Shaders/GIUpdateProbe.hlsl", "CS" ), 20 );
+#ifdef COMPUTE_DOF
+	// Compute Shaders
+	CHECK_MATERIAL( m_pCSDOFTiles = CreateComputeShader( IDR_SHADER_DOF_COMPUTE_TILED, "./Resources/Shaders/DOFComputeTiled.hlsl", "CS_Tiles" ), 18 );
+	CHECK_MATERIAL( m_pCSDOFGather = CreateComputeShader( IDR_SHADER_DOF_COMPUTE_TILED, "./Resources/Shaders/DOFComputeTiled.hlsl", "CS_Gather" ), 19 );
+	CHECK_MATERIAL( m_pCSDOFCombine = CreateComputeShader( IDR_SHADER_DOF_COMPUTE_TILED, "./Resources/Shaders/DOFComputeTiled.hlsl", "CS_Combine" ), 20 );
+#endif
 
 
 	//////////////////////////////////////////////////////////////////////////
@@ -77,6 +86,12 @@ EffectDOF::EffectDOF( Device& _Device, Texture2D& _RTHDR, Primitive& _ScreenQuad
 
 	m_pRTTemp = new Texture2D( m_Device, QuarterWidth, QuarterHeight, 2, PixelFormatR16F::DESCRIPTOR, 1, NULL );
 
+#ifdef COMPUTE_DOF
+	U32	TilesCountX = (W + DOF_TILE_SIZE-1) / DOF_TILE_SIZE;
+	U32	TilesCountY = (H + DOF_TILE_SIZE-1) / DOF_TILE_SIZE;
+	m_pRTDOFResult = new Texture2D( m_Device, W, H, 1, PixelFormatRGBA16F::DESCRIPTOR, 1, NULL, false, true );
+#endif
+
 // 		opts.Format(ARK_FORMAT_RG16_FLOAT).Width(HalfWidth).Height(HalfHeight).NumLevels(1).BindType(TB_RENDER_TARGET);
 // 		idImage * dofMaskDiv2Buffer = globalImages->ScratchImage( va( "_DOF_MASK_DIV2_%p", _hDC ), opts );
 // 		pCtxt->m_dofMaskDiv2RenderDest->CreateFromImages( dofMaskDiv2Buffer, NULL, NULL ADDITIONAL_CREATE_FROM_IMAGES_PARAMS );
@@ -101,6 +116,15 @@ EffectDOF::EffectDOF( Device& _Device, Texture2D& _RTHDR, Primitive& _ScreenQuad
  	m_pCB_Object = new CB<CBObject>( _Device, 11 );
  	m_pCB_Material = new CB<CBMaterial>( _Device, 12 );
 	m_pCB_Splat = new CB<CBSplat>( _Device, 10 );
+#ifdef COMPUTE_DOF
+	m_pCB_ComputeDOF = new CB<CBComputeDOF>( _Device, 13 );
+	m_pCB_ComputeDOF->m.TargetSizeX = W;
+	m_pCB_ComputeDOF->m.TargetSizeY = H;
+	m_pCB_ComputeDOF->m.TilesCountX = TilesCountX;
+	m_pCB_ComputeDOF->m.TilesCountY = TilesCountY;
+	m_pCB_ComputeDOF->m.FocusRange = DOF_FOCUS_RANGE;
+	m_pCB_ComputeDOF->m.InFocusThreshold = DOF_IN_FOCUS_THRESHOLD;
+#endif
 
 	m_pCB_Scene->m.DynamicLightsCount = 0;
 	m_pCB_Scene->m.StaticLightsCount = 0;
@@ -145,12 +169,18 @@ EffectDOF::~EffectDOF()
 	m_bDeleteSceneTags = true;
 	m_Scene.ClearTags( *this );
 
+#ifdef COMPUTE_DOF
+	delete m_pCB_ComputeDOF;
+#endif
 	delete m_pCB_Splat;
 	delete m_pCB_Material;
 	delete m_pCB_Object;
 	delete m_pCB_Scene;
 	delete m_pCB_General;
 
+#ifdef COMPUTE_DOF
+	delete m_pRTDOFResult;
+#endif
 	delete m_pRTTemp;
 
 	delete m_pRTDownsampledHDRTarget;
@@ -161,7 +191,11 @@ EffectDOF::~EffectDOF()
 	delete m_pRTShadowMap;
 	delete m_pTexWalls;
 
-// 	delete m_pCSUpdateProbe;
+#ifdef COMPUTE_DOF
+	delete m_pCSDOFCombine;
+	delete m_pCSDOFGather;
+	delete m_pCSDOFTiles;
+#endif
  
  	delete m_pMatCombine;
 	delete m_pMatDownsampleAvg;
@@ -254,6 +288,11 @@ void	EffectDOF::Render( float _Time, float _DeltaTime )
 	U32	QuarterWidth = (HalfWidth+1) >> 1;
 	U32	QuarterHeight = (HalfHeight+1) >> 1;
 
+#ifdef COMPUTE_DOF
+	// Auto-focus on the cube
+	float3	Camera2Cube = m_pCB_Object->m.Local2World.GetRow( 3 ) - m_Camera.GetCB().Camera2World.GetRow( 3 );
+	RenderComputeDOF( Camera2Cube.Length() );
+#else
 	// 3.1) Start by downsampling buffers
 	Downsample( HalfWidth, HalfHeight, m_RTTarget.GetSRV(), m_pRTDownsampledHDRTarget->GetRTV( 0, 0, 1 ), AVG );
 	Downsample( QuarterWidth, QuarterHeight, m_pRTDownsampledHDRTarget->GetSRV( 0, 1, 0, 1 ), m_pRTDownsampledHDRTarget->GetRTV( 1, 0, 1 ), AVG );
@@ -265,6 +304,7 @@ void	EffectDOF::Render( float _Time, float _DeltaTime )
 
 	// 3.3) Render actual DOF
 	RenderDOF();
+#endif
 
 
 // 	//////////////////////////////////////////////////////////////////////////
@@ -283,9 +323,13 @@ void	EffectDOF::Render( float _Time, float _DeltaTime )
 	m_Device.SetStates( m_Device.m_pRS_CullNone, m_Device.m_pDS_Disabled, m_Device.m_pBS_Disabled );
 	m_Device.SetRenderTarget( m_Device.DefaultRenderTarget() );
 
+#ifdef COMPUTE_DOF
+	m_pRTDOFResult->SetPS( 10 );
+#else
 	m_RTTarget.SetPS( 10 );
 
 m_pRTDownsampledHDRTarget->SetPS( 64 );
+#endif
 
 	m_pCB_Splat->m.dUV = m_Device.DefaultRenderTarget().GetdUV();
 	m_pCB_Splat->UpdateData();
@@ -316,7 +360,7 @@ void	EffectDOF::Downsample( int _TargetWidth, int _TargetHeight, const ID3D11Sha
 	m_Device.SetRenderTarget( _TargetWidth, _TargetHeight, _Target );
 
 	ID3D11ShaderResourceView*	pTarget = &_Source;
-	m_Device.DXContext().PSSetShaderResources( 10, 1, &pTarget );
+	m_Device.SetShaderResource( Device::SSF_PIXEL_SHADER, 10, pTarget );
 
 //	m_pCB_Splat->m.dUV = _Source.GetdUV();
 	m_pCB_Splat->UpdateData();
@@ -608,6 +652,77 @@ void	EffectDOF::ScaleKernel( float* _pOffsets, int _Width, int _Height ) const
 	}
 }
 
+#ifdef COMPUTE_DOF
+//////////////////////////////////////////////////////////////////////////
+// Computes the DOF with 3 compute kernels working on DOF_TILE_SIZE tiles (cf. DOFComputeTiled.hlsl)
+// The GPU can't skip dispatching the in-focus tiles without indirect dispatch so their groups exit as soon as they read the
+//	tile classification instead, which still saves the gather bandwidth that dominated the former downsample/fuzziness/blur passes.
+//
+void	EffectDOF::RenderComputeDOF( float _FocusDistance )
+{
+	m_Device.RemoveRenderTargets();	// So we can read the depth stencil
+
+	m_pCB_ComputeDOF->m.FocusDistance = _FocusDistance;
+	m_pCB_ComputeDOF->UpdateData();
+
+	U32	TilesCountX = m_pCB_ComputeDOF->m.TilesCountX;
+	U32	TilesCountY = m_pCB_ComputeDOF->m.TilesCountY;
+	U32	HalfWidth = (m_RTTarget.GetWidth()+1) >> 1;
+	U32	HalfHeight = (m_RTTarget.GetHeight()+1) >> 1;
+
+	// The intermediate targets only live during this pass
+	Texture2D&	RTTiles = m_Device.RenderTargets().Acquire( TilesCountX, TilesCountY, 1, PixelFormatRG16F::DESCRIPTOR, 1, true );	// One texel per tile, X=Min |CoC| Y=Max |CoC|
+	Texture2D&	RTHalf = m_Device.RenderTargets().Acquire( HalfWidth, HalfHeight, 1, PixelFormatRGBA16F::DESCRIPTOR, 1, true );		// Half resolution color & signed CoC
+
+	// 1] Classify the tiles & downsample
+	USING_COMPUTESHADER_START( *m_pCSDOFTiles )
+
+	m_RTTarget.SetCS( 10 );
+	m_Device.DefaultDepthStencil().SetCS( 11 );
+	RTTiles.SetCSUAV( 0 );
+	RTHalf.SetCSUAV( 1 );
+
+	M.Dispatch( TilesCountX, TilesCountY, 1 );
+
+	USING_COMPUTE_SHADER_END
+
+	RTTiles.RemoveFromLastAssignedSlotUAV();
+	RTHalf.RemoveFromLastAssignedSlotUAV();
+
+	// 2] Gather the out-of-focus tiles
+	Texture2D&	RTGather = m_Device.RenderTargets().Acquire( HalfWidth, HalfHeight, 1, PixelFormatRGBA16F::DESCRIPTOR, 1, true );	// Half resolution blurred color
+
+	USING_COMPUTESHADER_START( *m_pCSDOFGather )
+
+	RTTiles.SetCS( 12 );
+	RTHalf.SetCS( 13 );
+	RTGather.SetCSUAV( 1 );
+
+	M.Dispatch( TilesCountX, TilesCountY, 1 );
+
+	USING_COMPUTE_SHADER_END
+
+	RTGather.RemoveFromLastAssignedSlotUAV();
+
+	// 3] Combine with the sharp color
+	USING_COMPUTESHADER_START( *m_pCSDOFCombine )
+
+	RTGather.SetCS( 14 );
+	m_pRTDOFResult->SetCSUAV( 1 );
+
+	M.Dispatch( TilesCountX, TilesCountY, 1 );
+
+	USING_COMPUTE_SHADER_END
+
+	m_pRTDOFResult->RemoveFromLastAssignedSlotUAV();
+	m_Device.RemoveShaderResources( 10, 5, Device::SSF_COMPUTE_SHADER );
+
+	m_Device.RenderTargets().Release( RTGather );
+	m_Device.RenderTargets().Release( RTHalf );
+	m_Device.RenderTargets().Release( RTTiles );
+}
+#endif
+
 
 //////////////////////////////////////////////////////////////////////////
 // Computes the shadow map infos and render the shadow map itself
@@ -803,7 +918,7 @@ void*	EffectDOF::TagPrimitive( const Scene& _Owner, const Scene::Mesh& _Mesh, co
 	}
 	ASSERT( pVertexFormat != NULL, "Unsupported vertex format!" );
 
-	Primitive*	pPrim = new Primitive( m_Device, _Primitive.m_VerticesCount, _Primitive.m_pVertices, 3*_Primitive.m_FacesCount, _Primitive.m_pFaces, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST, *pVertexFormat );
+	Primitive*	pPrim = new Primitive( m_Device, _Primitive.m_VerticesCount, _Primitive.m_pVertices, 3*_Primitive.m_FacesCount, _Primitive.m_pFaces, _Primitive.m_IndexFormat, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST, *pVertexFormat );
 
 // 	// Tag the primitive with the face offset
 // 	pPrim->m_pTag = (void*) m_TotalFacesCount;
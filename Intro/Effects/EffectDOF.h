@@ -1,6 +1,7 @@
 #pragma once
 
 #define SHADERTOY
+#define COMPUTE_DOF		// Define this to compute the DOF with compute kernels working on 32x32 pixels tiles, in-focus tiles skip the gather (cf. DOFComputeTiled.hlsl)
 
 #define DOF_NB_SAMPLE		8
 #define DOF_OFFSET_COUNT	(DOF_NB_SAMPLE * 2)
@@ -14,6 +15,11 @@ private:	// CONSTANTS
 
 	static const int		SHADOW_MAP_SIZE = 1024;
 
+	static const U32		DOF_TILE_SIZE = 32;				// In full resolution pixels, a compute group handles a tile
+	static const U32		DOF_MAX_COC_RADIUS = 8;			// In half resolution pixels
+	static const float		DOF_FOCUS_RANGE;				// Distance from the focus plane where the CoC reaches its max
+	static const float		DOF_IN_FOCUS_THRESHOLD;			// CoC below which a tile is considered sharp
+
 protected:	// NESTED TYPES
 
 #pragma pack( push, 4 )
@@ -58,6 +64,16 @@ protected:	// NESTED TYPES
 		float4	Weights[8];
 	};
 
+	struct CBComputeDOF
+	{
+		U32			TargetSizeX, TargetSizeY;
+		U32			TilesCountX, TilesCountY;
+		float		FocusDistance;
+		float		FocusRange;
+		float		InFocusThreshold;
+		float		__PAD;
+	};
+
 #pragma  pack( pop )
 
 	enum DOWNSAMPLE_TYPE
@@ -73,6 +89,7 @@ private:	// FIELDS
 	Device&				m_Device;
 	Texture2D&			m_RTTarget;
 	Primitive&			m_ScreenQuad;
+	Camera&				m_Camera;
 
 	Shader*			m_pMatRender;				// Renders the scene
 	Shader*			m_pMatRenderCube;			// Renders the gloubi cube
@@ -89,6 +106,12 @@ private:	// FIELDS
 
 	Shader*			m_pMatShadertoy;
 
+#ifdef COMPUTE_DOF
+	ComputeShader*		m_pCSDOFTiles;				// Computes the CoC, downsamples color & CoC and classifies the tiles
+	ComputeShader*		m_pCSDOFGather;				// Gathers the bokeh of the out-of-focus tiles at half resolution
+	ComputeShader*		m_pCSDOFCombine;			// Blends the sharp & blurred colors
+#endif
+
 	// Primitives
 	Scene				m_Scene;
 	bool				m_bDeleteSceneTags;
@@ -105,6 +128,10 @@ private:	// FIELDS
 
 	Texture2D*			m_pRTTemp;
 
+#ifdef COMPUTE_DOF
+	Texture2D*			m_pRTDOFResult;			// Full resolution result (the intermediate targets come from the device's render target pool)
+#endif
+
 	// Constant buffers
  	CB<CBGeneral>*		m_pCB_General;
  	CB<CBScene>*		m_pCB_Scene;
@@ -112,6 +139,9 @@ private:	// FIELDS
  	CB<CBMaterial>*		m_pCB_Material;
 
 	CB<CBSplat>*		m_pCB_Splat;
+#ifdef COMPUTE_DOF
+	CB<CBComputeDOF>*	m_pCB_ComputeDOF;
+#endif
 
 
 public:		// PROPERTIES
@@ -144,4 +174,8 @@ protected:
 
 	void			ComputeKernel( float* _Offsets, float* _Weights, const float _weights[4], bool vertical ) const;
 	void			ScaleKernel( float* _Offsets, int _Width, int _Height ) const;
+
+#ifdef COMPUTE_DOF
+	void			RenderComputeDOF( float _FocusDistance );
+#endif
 };
\ No newline at end of file
@@ -3,14 +3,23 @@
 
 #define CHECK_MATERIAL( pMaterial, ErrorCode )		if ( (pMaterial)->HasErrors() ) m_ErrorCode = ErrorCode;
 
-EffectDeferred::EffectDeferred() : m_ErrorCode( 0 )
+EffectDeferred::EffectDeferred() : m_ErrorCode( 0 ), m_DebugView( DEBUG_VIEW_NONE )
 {
 	//////////////////////////////////////////////////////////////////////////
 	// Create the materials
+#ifdef COMPACT_GBUFFER
+	D3D_SHADER_MACRO	pGBufferMacros[] = { { "COMPACT_GBUFFER", "1" }, { NULL, NULL } };
+#else
+	D3D_SHADER_MACRO*	pGBufferMacros = NULL;
+#endif
+
 	CHECK_MATERIAL( m_pMatDepthPass = CreateMaterial( IDR_SHADER_DEFERRED_DEPTH_PASS, "./Resources/Shaders/DeferredDepthPass.hlsl", VertexFormatP3N3G3T2::DESCRIPTOR, "VS", NULL, NULL ), 1 );
-	CHECK_MATERIAL( m_pMatFillGBuffer = CreateMaterial( IDR_SHADER_DEFERRED_FILL_GBUFFER, "./Resources/Shaders/DeferredFillGBuffer.hlsl", VertexFormatP3N3G3T2::DESCRIPTOR, "VS", NULL, "PS" ), 1 );
+	CHECK_MATERIAL( m_pMatFillGBuffer = CreateMaterial( IDR_SHADER_DEFERRED_FILL_GBUFFER, "./Resources/Shaders/DeferredFillGBuffer.hlsl", VertexFormatP3N3G3T2::DESCRIPTOR, "VS", NULL, "PS", pGBufferMacros ), 1 );
 	CHECK_MATERIAL( m_pMatShading_StencilPass = CreateMaterial( IDR_SHADER_DEFERRED_SHADING_STENCIL, "./Resources/Shaders/DeferredShadingStencil.hlsl", VertexFormatP3::DESCRIPTOR, "VS", NULL, NULL ), 1 );
 	CHECK_MATERIAL( m_pMatShading = CreateMaterial( IDR_SHADER_DEFERRED_SHADING, "./Resources/Shaders/DeferredShading.hlsl", VertexFormatPt4::DESCRIPTOR, "VS", NULL, "PS" ), 1 );
+#ifdef TILED_DEFERRED_SHADING
+	CHECK_MATERIAL( m_pCSShadingTiled = CreateComputeShader( IDR_SHADER_DEFERRED_SHADING_TILED, "./Resources/Shaders/DeferredShadingTiled.hlsl", "CS", pGBufferMacros ), 2 );
+#endif
 
 
 	//////////////////////////////////////////////////////////////////////////
@@ -21,22 +30,55 @@ EffectDeferred::EffectDeferred() : m_ErrorCode( 0 )
 	}
 
 	// Create the render targets
+#ifdef COMPACT_GBUFFER
+	m_pRTGBufferNormal = new Texture2D( gs_Device, gs_Device.DefaultRenderTarget().GetWidth(), gs_Device.DefaultRenderTarget().GetHeight(), 1, RenderTargetFormats::Select( RenderTargetFormats::GBUFFER_NORMAL ), 1, NULL );
+	m_pRTGBufferMaterial = new Texture2D( gs_Device, gs_Device.DefaultRenderTarget().GetWidth(), gs_Device.DefaultRenderTarget().GetHeight(), 1, RenderTargetFormats::Select( RenderTargetFormats::GBUFFER_MATERIAL ), 1, NULL );
+#else
 	m_pRTGBuffer = new Texture2D( gs_Device, gs_Device.DefaultRenderTarget().GetWidth(), gs_Device.DefaultRenderTarget().GetHeight(), 2, PixelFormatRGBA16F::DESCRIPTOR, 1, NULL );
+#endif
+#ifdef TILED_DEFERRED_SHADING
+	m_pRTLightAccumulation = new Texture2D( gs_Device, gs_Device.DefaultRenderTarget().GetWidth(), gs_Device.DefaultRenderTarget().GetHeight(), 1, PixelFormatRGBA16F::DESCRIPTOR, 1, NULL, false, true );
+
+	// All the lights are accumulated at once
+	m_LightsCount = 0;
+	m_ppLights = new Light*[MAX_LIGHTS];
+	m_pSB_Lights = new SB<Light::CBLight>( gs_Device, MAX_LIGHTS, true );
+#endif
 
 
 	//////////////////////////////////////////////////////////////////////////
 	// Create the constant buffers
 	m_pCB_Render = new CB<CBRender>( gs_Device, 10 );
 //	m_pCB_Render->m.DeltaTime.Set( 0, 1 );
+#ifdef TILED_DEFERRED_SHADING
+	m_pCB_TiledShading = new CB<CBTiledShading>( gs_Device, 11, false, Device::SSF_COMPUTE_SHADER );
+	m_pCB_TiledShading->m.ScreenSizeX = gs_Device.DefaultRenderTarget().GetWidth();
+	m_pCB_TiledShading->m.ScreenSizeY = gs_Device.DefaultRenderTarget().GetHeight();
+#endif
 }
 
 EffectDeferred::~EffectDeferred()
 {
 //	delete m_pTexVoronoi;
 
+#ifdef TILED_DEFERRED_SHADING
+	delete m_pCB_TiledShading;
+
+	for ( int LightIndex=0; LightIndex < m_LightsCount; LightIndex++ )
+		delete m_ppLights[LightIndex];
+	delete[] m_ppLights;
+	delete m_pSB_Lights;
+
+	delete m_pRTLightAccumulation;
+#endif
 	delete m_pCB_Render;
 
+#ifdef COMPACT_GBUFFER
+	delete m_pRTGBufferMaterial;
+	delete m_pRTGBufferNormal;
+#else
 	delete m_pRTGBuffer;
+#endif
 
 	delete m_pPrimSphere;
 
@@ -94,7 +136,86 @@ void	EffectDeferred::Render( float _Time, float _DeltaTime )
 
 		USING_MATERIAL_END
 	}*/
+
+#ifdef TILED_DEFERRED_SHADING
+	//////////////////////////////////////////////////////////////////////////
+	// 3] Accumulate the lights
+	ShadeTiled();
+#endif
+}
+
+#ifdef TILED_DEFERRED_SHADING
+//////////////////////////////////////////////////////////////////////////
+// Accumulates all the lights into m_pRTLightAccumulation with a single dispatch (cf. DeferredShadingTiled.hlsl)
+// Each 16x16 tile culls the whole light list against its depth bounds in groupshared memory, so a light only costs its upload and
+//	a sphere test per tile instead of the 2 stencil passes and the CB update of the light volumes.
+//
+void	EffectDeferred::ShadeTiled()
+{
+	for ( int LightIndex=0; LightIndex < m_LightsCount; LightIndex++ )
+		m_ppLights[LightIndex]->Upload( m_pSB_Lights->m[LightIndex] );
+	if ( m_LightsCount > 0 )
+		m_pSB_Lights->Write( m_LightsCount );
+
+	m_pCB_TiledShading->m.LightsCount = m_LightsCount;
+	m_pCB_TiledShading->m.DebugView = m_DebugView;
+	m_pCB_TiledShading->m.Ambient = m_pCB_Render->m.Ambient;
+	m_pCB_TiledShading->UpdateData();
+
+	gs_Device.RemoveRenderTargets();	// So we can read the depth stencil
+
+	USING_COMPUTESHADER_START( *m_pCSShadingTiled )
+
+#ifdef COMPACT_GBUFFER
+	m_pRTGBufferNormal->SetCS( 10 );
+	m_pRTGBufferMaterial->SetCS( 13 );
+#else
+	m_pRTGBuffer->SetCS( 10 );
+#endif
+	gs_Device.DefaultDepthStencil().SetCS( 11 );
+	m_pSB_Lights->SetInput( 12 );
+	m_pRTLightAccumulation->SetCSUAV( 0 );
+
+	U32	TilesCountX = (m_pCB_TiledShading->m.ScreenSizeX + TILE_SIZE-1) / TILE_SIZE;
+	U32	TilesCountY = (m_pCB_TiledShading->m.ScreenSizeY + TILE_SIZE-1) / TILE_SIZE;
+	M.Dispatch( TilesCountX, TilesCountY, 1 );
+
+	USING_COMPUTE_SHADER_END
+
+	m_pRTLightAccumulation->RemoveFromLastAssignedSlotUAV();
+	gs_Device.RemoveShaderResources( 10, 4, Device::SSF_COMPUTE_SHADER );
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Light
+EffectDeferred::Light::Light()
+	: m_Type( OMNI )
+	, m_Position( float3::Zero )
+	, m_Direction( 0, -1, 0 )
+	, m_Color( float3::One )
+{
+	m_Data.Omni.RadiusHotspot = 1.0f;
+	m_Data.Omni.RadiusFalloff = 2.0f;
+}
+
+EffectDeferred::Light::~Light()
+{
+}
+
+void	EffectDeferred::Light::Upload( CBLight& _Target ) const
+{
+	_Target.Position = m_Position;
+	_Target.Type = m_Type;
+	_Target.Direction = m_Direction;
+	_Target.Color = m_Color;
+	switch ( m_Type )
+	{
+	case OMNI:			_Target.Data.Set( m_Data.Omni.RadiusHotspot, m_Data.Omni.RadiusFalloff, 0.0f, 0.0f ); break;
+	case SPOT:			_Target.Data.Set( cosf( m_Data.Spot.AngleHotspot ), cosf( m_Data.Spot.AngleFalloff ), m_Data.Spot.Length, 0.0f ); break;
+	case DIRECTIONAL:	_Target.Data.Set( m_Data.Directional.RadiusHotspot, m_Data.Directional.RadiusFalloff, m_Data.Directional.Length, 0.0f ); break;
+	}
 }
+#endif
 
 //////////////////////////////////////////////////////////////////////////
 // 
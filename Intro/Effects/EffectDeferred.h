@@ -1,13 +1,31 @@
 #pragma once
 
+#define TILED_DEFERRED_SHADING	// Define this to accumulate all the lights in a single compute dispatch that culls them per 16x16 screen tile (cf. DeferredShadingTiled.hlsl)
+#define COMPACT_GBUFFER			// Define this to store the G-Buffer as an octahedral RG16 normal and an RGBA8 albedo/roughness/metal instead of 2 RGBA16F slices (cf. Inc/GBuffer.hlsl)
+
 template<typename> class CB;
 
 class EffectDeferred
 {
 private:	// CONSTANTS
 
+#ifdef TILED_DEFERRED_SHADING
+	static const U32		TILE_SIZE = 16;			// A compute group shades a tile
+	static const int		MAX_LIGHTS = 4096;
+#endif
+
 public:		// NESTED TYPES
 
+	enum DEBUG_VIEW	// !!IMPORTANT ==> Must correspond to DEBUG_VIEW_XXX in DeferredShadingTiled.hlsl!!
+	{
+		DEBUG_VIEW_NONE,
+		DEBUG_VIEW_NORMAL,
+		DEBUG_VIEW_ALBEDO,
+		DEBUG_VIEW_ROUGHNESS,
+		DEBUG_VIEW_METAL,
+		DEBUG_VIEW_DEPTH,
+	};
+
 	struct CBRender
 	{
 		float3	dUV;
@@ -15,6 +33,16 @@ public:		// NESTED TYPES
 		float3	Ambient;
 	};
 
+#ifdef TILED_DEFERRED_SHADING
+	struct CBTiledShading
+	{
+		U32			ScreenSizeX, ScreenSizeY;
+		U32			LightsCount;
+		U32			DebugView;
+		float3	Ambient;
+	};
+#endif
+
 	class	Object
 	{
 	public:		// NESTED TYPES
@@ -54,7 +82,11 @@ public:		// NESTED TYPES
 
 	class	Light
 	{
+#ifdef TILED_DEFERRED_SHADING
+	public:		// The lights are all uploaded into a single structured buffer
+#else
 	protected:
+#endif
 
 		struct	CBLight
 		{
@@ -79,32 +111,38 @@ public:		// NESTED TYPES
 		float3	m_Color;
 		union
 		{
-			struct {	// OMNI
+			struct {
 				float	RadiusHotspot;
 				float	RadiusFalloff;
-			};
-			struct {	// DIRECTION
+			}	Omni;
+			struct {
 				float	RadiusHotspot;
 				float	RadiusFalloff;
 				float	Length;
-			};
-			struct {	// SPOT
+			}	Directional;
+			struct {
 				float	AngleHotspot;
 				float	AngleFalloff;
 				float	Length;
-			};
+			}	Spot;
 		} m_Data;
 
+#ifndef TILED_DEFERRED_SHADING
 	protected:
 
 		CB<CBLight>*	m_pCBLight;
+#endif
 
 	public:
 
 		Light();
 		~Light();
 
+#ifdef TILED_DEFERRED_SHADING
+		void		Upload( CBLight& _Target ) const;
+#else
 		void		Upload();
+#endif
 	};
 
 
@@ -116,14 +154,26 @@ private:	// FIELDS
 	Shader*			m_pMatFillGBuffer;
 	Shader*			m_pMatShading_StencilPass;
 	Shader*			m_pMatShading;
+#ifdef TILED_DEFERRED_SHADING
+	ComputeShader*		m_pCSShadingTiled;
+#endif
 
 	int					m_ObjectsCount;
 	Object**			m_ppObjects;
 
 	int					m_LightsCount;
 	Light**				m_ppLights;
-
+#ifdef TILED_DEFERRED_SHADING
+	SB<Light::CBLight>*	m_pSB_Lights;
+	CB<CBTiledShading>*	m_pCB_TiledShading;
+#endif
+
+#ifdef COMPACT_GBUFFER
+	Texture2D*			m_pRTGBufferNormal;		// RenderTargetFormats::GBUFFER_NORMAL
+	Texture2D*			m_pRTGBufferMaterial;	// RenderTargetFormats::GBUFFER_MATERIAL
+#else
 	Texture2D*			m_pRTGBuffer;
+#endif
 	Texture2D*			m_pRTLightAccumulation;
 
 	Primitive*			m_pPrimCylinder;
@@ -137,6 +187,7 @@ public:
 	// Params
 public:
 
+	DEBUG_VIEW			m_DebugView;	// Replaces the lighting by one of the G-Buffer's attributes
 
 public:		// PROPERTIES
 
@@ -152,4 +203,8 @@ public:		// METHODS
 protected:
 	
 //	void	BuildVoronoiTexture( TextureBuilder& _TB, NjFloat2* _pCellCenters, VertexFormatPt4* _pVertices );
+
+#ifdef TILED_DEFERRED_SHADING
+	void	ShadeTiled();
+#endif
 };
\ No newline at end of file
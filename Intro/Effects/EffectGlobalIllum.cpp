@@ -250,22 +250,12 @@ void	EffectGlobalIllum::PreComputeProbes()
 
 	//////////////////////////////////////////////////////////////////////////
 	// Allocate probes
-	m_ProbesCount = 0;
-	Scene::Node*	pSceneProbe = NULL;
-	while ( pSceneProbe = m_Scene.ForEach( Scene::Node::PROBE, pSceneProbe ) )
-	{
-		m_ProbesCount++;
-	}
+	m_ProbesCount = m_Scene.m_ProbesCount;
 	m_pProbes = new ProbeStruct[m_ProbesCount];
-
-	pSceneProbe = NULL;
-	m_ProbesCount = 0;
-	while ( pSceneProbe = m_Scene.ForEach( Scene::Node::PROBE, pSceneProbe ) )
+	for ( int ProbeIndex=0; ProbeIndex < m_ProbesCount; ProbeIndex++ )
 	{
-		m_pProbes[m_ProbesCount].pSceneProbe = (Scene::Probe*) pSceneProbe;
-		m_pProbes[m_ProbesCount].NeighborsCount = 0;	// No neighbor at the moment
-
-		m_ProbesCount++;
+		m_pProbes[ProbeIndex].pSceneProbe = m_Scene.m_ppProbes[ProbeIndex];
+		m_pProbes[ProbeIndex].NeighborsCount = 0;	// No neighbor at the moment
 	}
 
 	// Also allocate runtime probes structured buffer
@@ -386,11 +376,8 @@ void	EffectGlobalIllum::PreComputeProbes()
 			m_Device.ClearDepthStencil( *pRTCubeMapDepth, 1.0f, 0, true, false );
 
 			// Render scene
-			Scene::Node*	pMesh = NULL;
-			while ( pMesh = m_Scene.ForEach( Scene::Node::MESH, pMesh ) )
-			{
-				RenderMesh( (Scene::Mesh&) *pMesh, m_pMatRenderCubeMap );
-			}
+			for ( int MeshIndex=0; MeshIndex < m_Scene.m_MeshesCount; MeshIndex++ )
+				RenderMesh( *m_Scene.m_ppMeshes[MeshIndex], m_pMatRenderCubeMap );
 
 			// Render neighborhood for each probe
 			// The idea here is simply to build a 3D voronoi cell by splatting the planes passing through all other probes
@@ -820,7 +807,7 @@ void*	EffectGlobalIllum::TagPrimitive( const Scene::Mesh& _Mesh, const Scene::Me
 	}
 	ASSERT( pVertexFormat != NULL, "Unsupported vertex format!" );
 
-	Primitive*	pPrim = new Primitive( m_Device, _Primitive.m_VerticesCount, _Primitive.m_pVertices, 3*_Primitive.m_FacesCount, _Primitive.m_pFaces, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST, *pVertexFormat );
+	Primitive*	pPrim = new Primitive( m_Device, _Primitive.m_VerticesCount, _Primitive.m_pVertices, 3*_Primitive.m_FacesCount, _Primitive.m_pFaces, _Primitive.m_IndexFormat, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST, *pVertexFormat );
 
 	return pPrim;
 }
@@ -34,6 +34,15 @@
 //	_ Run
 //		=> If successful, this should take some time to load the scene, render the probes' cube maps
 //		=> It should exit the pre-computation and render your scene with indirect lighting
+//	_ With INCREMENTAL_PROBE_BAKE defined, running again after editing the scene only rebakes the probes affected by the meshes you changed
+//	_ With SCENE_HOT_RELOAD defined, converting the scene again while it runs takes the meshes you changed without restarting
+//		=> The hierarchy, the textures and the primitives, vertices & faces counts of the meshes must stay the same, otherwise restart
+//	_ To split the bake across the nodes of a render farm, share the probes directory between the nodes and run
+//		=> "-bakeunit=<UnitIndex>/<UnitsCount>" on each node: it bakes its part of the probes and exits
+//		=> Then "-bakemerge=<UnitsCount>" once all the units are done: it verifies & merges them and renders your scene
+//	_ To reduce the amount of probes, place a dense set of probes in your scene and run "-optimizeprobes=<ErrorBudget>" (e.g. 0.05 for 5%)
+//		=> It bakes all the probes, removes the ones their neighbors predict within the budget, saves the kept ones to ProbePlacement.keep and exits
+//		=> The next runs only use the kept probes (the probes changed so the next bake is complete), delete the file to use all of them again
 //
 // 4) Normal run
 //	_ Make sure LOAD_PROBES is NOT commented
@@ -61,29 +70,43 @@
 #define SCENE 3	// Test
 
 //#define	LOAD_PROBES				// Define this to simply load probes without computing them
+#define	INCREMENTAL_PROBE_BAKE	// Define this to only rebake the probes affected by the meshes that changed since the last bake (cf. SHProbeNetwork::RebakeProbes())
 #define USE_WHITE_TEXTURES		// Define this to use a single white texture for the entire scene (low patate machines)
 #define	USE_NORMAL_MAPS			// Define this to use normal maps
 
+#if defined(TEXTURE_ARRAYS) && (defined(STREAMED_TEXTURES) || defined(USE_WHITE_TEXTURES))
+	#error "TEXTURE_ARRAYS needs the scene textures to be loaded from files at once: undefine STREAMED_TEXTURES and USE_WHITE_TEXTURES!"
+#endif
+#define	PROBE_SH_STORAGE_FORMAT	SHProbeNetwork::SH_STORAGE_FLOAT	// Storage of the runtime probe SH (use SH_STORAGE_HALF or SH_STORAGE_L1 to save memory & bandwidth on large maps)
+
 // Scene selection (also think about changing the scene in the .RC!)
 #if SCENE==0
 	#define SCENE_PATH				".\\Resources\\Scenes\\GITest1\\"
+	#define SCENE_FILE_PATH			".\\Resources\\Scenes\\"
+	#define SCENE_FILE_NAME			"GITest1.gcx"
 
 	#define PROBES_PATH				SCENE_PATH "ProbeSets\\GITest1_10Probes\\"
 
 #elif SCENE==2
 	#define SCENE_PATH				".\\Resources\\Scenes\\Sponza\\"
+	#define SCENE_FILE_PATH			SCENE_PATH
+	#define SCENE_FILE_NAME			"Sponza.gcx"
 
 	#define TEXTURES_PATH			SCENE_PATH "TexturesPOM\\"
 	#define PROBES_PATH				SCENE_PATH "Probes\\"
 
 #elif SCENE==1
 	#define SCENE_PATH				"..\\Arkane\\GIScenes\\City\\"
+	#define SCENE_FILE_PATH			SCENE_PATH
+	#define SCENE_FILE_NAME			"scene.gcx"
 
 	#define TEXTURES_PATH			SCENE_PATH "TexturesPOM\\"
 	#define PROBES_PATH				SCENE_PATH "Probes\\"
 
 #elif SCENE==3
 	#define SCENE_PATH				"..\\Arkane\\GIScenes\\SimpleMapWithManyProbes\\"
+	#define SCENE_FILE_PATH			SCENE_PATH
+	#define SCENE_FILE_NAME			"scene.gcx"	// The file of IDR_SCENE_GI in the .RC, watched for changes with SCENE_HOT_RELOAD
 
 	#define TEXTURES_PATH			SCENE_PATH "Textures\\"
 	#define PROBES_PATH				SCENE_PATH "Probes\\"
@@ -93,47 +116,202 @@
 
 #define CHECK_MATERIAL( pMaterial, ErrorCode )		if ( (pMaterial)->HasErrors() ) m_ErrorCode = ErrorCode;
 
+// Vertex format of the depth-only scene materials, also the format of the position-only streams with DEPTH_VERTEX_STREAMS
+static const IVertexFormatDescriptor&	GetSceneDepthVertexFormat() {
+#ifdef PACKED_SCENE_VERTICES
+	return VertexFormatPackedP4::DESCRIPTOR;
+#else
+	return VertexFormatP3::DESCRIPTOR;
+#endif
+}
+
+const float	EffectGlobalIllum2::SUN_SHADOW_CASCADES_MAX_DISTANCE = 40.0f;
+const float	EffectGlobalIllum2::SUN_SHADOW_CASCADES_SPLIT_LAMBDA = 0.75f;
+const float	EffectGlobalIllum2::SUN_SHADOW_CASCADES_BIAS_TEXELS = 1.5f;
+const float	EffectGlobalIllum2::OCCLUDER_MIN_SIZE = 0.1f;
+
 EffectGlobalIllum2::EffectGlobalIllum2( Device& _Device, Texture2D& _RTHDR, Primitive& _ScreenQuad, FPSCamera& _Camera )
 	: m_ErrorCode( 0 )
 	, m_Device( _Device )
 	, m_RTTarget( _RTHDR )
 	, m_ScreenQuad( _ScreenQuad )
+	, m_Camera( _Camera.m_Camera )
+	, m_LastPointLight( float4::Zero )
+	, m_DeltaTime( 0.0f )
+	, m_SkySHColor( float3::Zero )
+	, m_bSkySHValid( false )
 	, m_DebugVoronoiCellIndex( ~0U )
 	, m_pPrimVoronoiCellPlanes( NULL )
-	, m_pPrimVoronoiCellEdges( NULL ) {
+	, m_pPrimVoronoiCellEdges( NULL )
+	, m_pSB_InstanceTransforms( NULL )
+	, m_pScenePool( NULL )
+	, m_pSceneDepthPool( NULL )
+#ifdef SCENE_HOT_RELOAD
+	, m_pSceneWatcher( NULL )
+#endif
+	, m_DynamicObjectsCount( 0 )
+#ifdef DEPTH_PREPASS
+	, m_OverdrawQueryIndex( -1 )
+	, m_Overdraw( 0.0f )
+	, m_bDepthPrepass( false )
+	, m_bDepthPrepassFrame( false )
+#endif
+#ifdef PARALLEL_RECORDING
+	, m_RecorderShadowMap( *this, &EffectGlobalIllum2::RenderShadowMap )
+	, m_RecorderShadowMapPoint( *this, &EffectGlobalIllum2::RenderShadowMapPoint )
+	, m_RecorderScene( *this, &EffectGlobalIllum2::RenderScene )
+#endif
+	{
 
 	//////////////////////////////////////////////////////////////////////////
 	// Create the materials
-	m_SceneVertexFormatDesc.AggregateVertexFormat( VertexFormatP3N3G3B3T2::DESCRIPTOR );
+#ifdef PACKED_SCENE_VERTICES
+	const IVertexFormatDescriptor&	SceneVertexFormat = VertexFormatPackedP3N3G3B3T2::DESCRIPTOR;
+	const char*						pPackedVertices = "1";
+#else
+	const IVertexFormatDescriptor&	SceneVertexFormat = VertexFormatP3N3G3B3T2::DESCRIPTOR;
+	const char*						pPackedVertices = "0";
+#endif
+	const IVertexFormatDescriptor&	SceneDepthVertexFormat = GetSceneDepthVertexFormat();
+#ifdef CLUSTERED_LIGHTS
+	const char*						pClusteredLights = "1";
+#else
+	const char*						pClusteredLights = "0";
+#endif
+#ifdef SHADOW_ATLAS
+	const char*						pShadowAtlas = "1";
+#else
+	const char*						pShadowAtlas = "0";
+#endif
+#ifdef SUN_SHADOW_CASCADES
+	const char*						pSunShadowCascades = "1";
+#else
+	const char*						pSunShadowCascades = "0";
+#endif
+#ifdef TEXTURE_ARRAYS
+	const char*						pTextureArrays = "1";
+#else
+	const char*						pTextureArrays = "0";
+#endif
+#ifdef VOXEL_CONE_TRACED_GI
+	const char*						pVoxelGI = "1";
+#else
+	const char*						pVoxelGI = "0";
+#endif
+
+	m_SceneVertexFormatDesc.AggregateVertexFormat( SceneVertexFormat );
 
+	BeginShaderCompilation();	// All the materials below compile in parallel
+
+	const char*	pSHStorageFormat = SHProbeNetwork::GetSHStorageFormatMacro( PROBE_SH_STORAGE_FORMAT );
 	{
 // Main scene rendering is quite heavy so we prefer to reload it from binary instead
 //ScopedForceMaterialsLoadFromBinary		bisou;
 
-		D3D_SHADER_MACRO	pMacros[] = { { "USE_SHADOW_MAP", "1" }, { "PER_VERTEX_PROBE_ID", "1" }, { NULL, NULL } };
+		D3D_SHADER_MACRO	pMacros[] = { { "USE_SHADOW_MAP", "1" }, { "PER_VERTEX_PROBE_ID", "1" }, { "SH_STORAGE_FORMAT", pSHStorageFormat }, { "PACKED_VERTICES", pPackedVertices }, { "CLUSTERED_LIGHTS", pClusteredLights }, { "SHADOW_ATLAS", pShadowAtlas }, { "SUN_SHADOW_CASCADES", pSunShadowCascades }, { "TEXTURE_ARRAYS", pTextureArrays }, { "VOXEL_GI", pVoxelGI }, { NULL, NULL } };
 		m_SceneVertexFormatDesc.AggregateVertexFormat( VertexFormatU32::DESCRIPTOR );
- 		CHECK_MATERIAL( m_pMatRender = CreateMaterial( IDR_SHADER_GI_RENDER_SCENE, "./Resources/Shaders/GIRenderScene2.hlsl", m_SceneVertexFormatDesc, "VS", NULL, "PS", pMacros ), 1 );
+ 		m_pMatRender = CreateMaterial( IDR_SHADER_GI_RENDER_SCENE, "./Resources/Shaders/GIRenderScene2.hlsl", m_SceneVertexFormatDesc, "VS", NULL, "PS", pMacros );
 
-		D3D_SHADER_MACRO	pMacros2[] = { { "EMISSIVE", "1" }, { NULL, NULL } };
-		CHECK_MATERIAL( m_pMatRenderEmissive = CreateMaterial( IDR_SHADER_GI_RENDER_SCENE, "./Resources/Shaders/GIRenderScene2.hlsl", VertexFormatP3N3G3B3T2::DESCRIPTOR, "VS", NULL, "PS", pMacros2 ), 2 );
+		D3D_SHADER_MACRO	pMacros2[] = { { "EMISSIVE", "1" }, { "SH_STORAGE_FORMAT", pSHStorageFormat }, { "PACKED_VERTICES", pPackedVertices }, { "TEXTURE_ARRAYS", pTextureArrays }, { NULL, NULL } };
+		m_pMatRenderEmissive = CreateMaterial( IDR_SHADER_GI_RENDER_SCENE, "./Resources/Shaders/GIRenderScene2.hlsl", SceneVertexFormat, "VS", NULL, "PS", pMacros2 );
 	}
 
 	{
 ScopedForceMaterialsLoadFromBinary		bisou;
 
- 		CHECK_MATERIAL( m_pMatRenderShadowMap = CreateMaterial( IDR_SHADER_GI_RENDER_SHADOW_MAP, "./Resources/Shaders/GIRenderShadowMap.hlsl", VertexFormatP3::DESCRIPTOR, "VS", NULL, NULL ), 4 );
- 		CHECK_MATERIAL( m_pMatRenderShadowMapPoint = CreateMaterial( IDR_SHADER_GI_RENDER_SHADOW_MAP, "./Resources/Shaders/GIRenderShadowMap.hlsl", VertexFormatP3::DESCRIPTOR, "VS2", "GS", NULL ), 5 );
+		D3D_SHADER_MACRO	pSHStorageMacros[] = { { "SH_STORAGE_FORMAT", pSHStorageFormat }, { NULL, NULL } };
+#ifdef INSTANCED_SHADOW_MAPS
+		const char*			pInstanced = "1";
+#else
+		const char*			pInstanced = "0";
+#endif
+		D3D_SHADER_MACRO	pDepthMacros[] = { { "PACKED_VERTICES", pPackedVertices }, { "INSTANCED", pInstanced }, { NULL, NULL } };
+
+ 		m_pMatRenderShadowMap = CreateMaterial( IDR_SHADER_GI_RENDER_SHADOW_MAP, "./Resources/Shaders/GIRenderShadowMap.hlsl", SceneDepthVertexFormat, "VS", NULL, NULL, pDepthMacros );
+#ifdef DEPTH_PREPASS
+		D3D_SHADER_MACRO	pPrepassMacros[] = { { "PACKED_VERTICES", pPackedVertices }, { NULL, NULL } };
+		m_pMatRenderDepthPrepass = CreateMaterial( IDR_SHADER_GI_RENDER_DEPTH_PREPASS, "./Resources/Shaders/GIRenderDepthPrepass.hlsl", SceneDepthVertexFormat, "VS", NULL, NULL, pPrepassMacros );
+#endif
+#ifdef CULLED_POINT_SHADOW_FACES
+		// No GS: each instance is projected into the face of its view index, the VS also selects the slice when the device allows it (cf. RenderShadowMapPointStatic())
+		D3D_SHADER_MACRO	pPointDepthMacros[] = { { "PACKED_VERTICES", pPackedVertices }, { "MULTIVIEW", "1" }, { "VS_RT_ARRAY_INDEX", m_Device.SupportsVSRenderTargetArrayIndex() ? "1" : "0" }, { NULL, NULL } };
+ 		m_pMatRenderShadowMapPoint = CreateMaterial( IDR_SHADER_GI_RENDER_SHADOW_MAP, "./Resources/Shaders/GIRenderShadowMap.hlsl", SceneDepthVertexFormat, "VS_MultiView", NULL, NULL, pPointDepthMacros );
+#else
+ 		m_pMatRenderShadowMapPoint = CreateMaterial( IDR_SHADER_GI_RENDER_SHADOW_MAP, "./Resources/Shaders/GIRenderShadowMap.hlsl", SceneDepthVertexFormat, "VS2", "GS", NULL, pDepthMacros );
+#endif
+#ifdef CACHED_SHADOW_MAPS
+		// The dynamic objects are drawn with the regular sphere primitive, unpacked but instanced
+		D3D_SHADER_MACRO	pDynamicDepthMacros[] = { { "PACKED_VERTICES", "0" }, { "INSTANCED", "1" }, { NULL, NULL } };
+		m_pMatRenderShadowMapDynamic = CreateMaterial( IDR_SHADER_GI_RENDER_SHADOW_MAP, "./Resources/Shaders/GIRenderShadowMap.hlsl", VertexFormatP3N3G3T2::DESCRIPTOR, "VS", NULL, NULL, pDynamicDepthMacros );
+		m_pMatRenderShadowMapPointDynamic = CreateMaterial( IDR_SHADER_GI_RENDER_SHADOW_MAP, "./Resources/Shaders/GIRenderShadowMap.hlsl", VertexFormatP3N3G3T2::DESCRIPTOR, "VS2", "GS", NULL, pDynamicDepthMacros );
+#endif
+#ifdef SHADOW_ATLAS
+		// Same as the point light shadow map except the GS selects a viewport per face instead of a slice
+		D3D_SHADER_MACRO	pAtlasDepthMacros[] = { { "PACKED_VERTICES", pPackedVertices }, { "INSTANCED", pInstanced }, { "SHADOW_ATLAS", "1" }, { NULL, NULL } };
+		m_pMatRenderShadowAtlas = CreateMaterial( IDR_SHADER_GI_RENDER_SHADOW_MAP, "./Resources/Shaders/GIRenderShadowMap.hlsl", SceneDepthVertexFormat, "VS2", "GS", NULL, pAtlasDepthMacros );
+		m_pMatClearShadowAtlas = CreateMaterial( IDR_SHADER_GI_CLEAR_SHADOW_ATLAS, "./Resources/Shaders/GIClearShadowAtlas.hlsl", VertexFormatPt4::DESCRIPTOR, "VS", NULL, NULL );
+#endif
 
- 		CHECK_MATERIAL( m_pMatPostProcess = CreateMaterial( IDR_SHADER_GI_POST_PROCESS, "./Resources/Shaders/GIPostProcess.hlsl", VertexFormatPt4::DESCRIPTOR, "VS", NULL, "PS" ), 6 );
- 		CHECK_MATERIAL( m_pMatRenderLights = CreateMaterial( IDR_SHADER_GI_RENDER_LIGHTS, "./Resources/Shaders/GIRenderLights.hlsl", VertexFormatP3N3::DESCRIPTOR, "VS", NULL, "PS" ), 7 );
- 		CHECK_MATERIAL( m_pMatRenderDynamic = CreateMaterial( IDR_SHADER_GI_RENDER_DYNAMIC, "./Resources/Shaders/GIRenderDynamic.hlsl", VertexFormatP3N3G3T2::DESCRIPTOR, "VS", NULL, "PS" ), 8 );
- 		CHECK_MATERIAL( m_pMatRenderDebugProbes = CreateMaterial( IDR_SHADER_GI_RENDER_DEBUG_PROBES, "./Resources/Shaders/GIRenderDebugProbes.hlsl", VertexFormatP3N3::DESCRIPTOR, "VS", NULL, "PS" ), 9 );
- 		CHECK_MATERIAL( m_pMatRenderDebugProbesNetwork = CreateMaterial( IDR_SHADER_GI_RENDER_DEBUG_PROBES, "./Resources/Shaders/GIRenderDebugProbes.hlsl", VertexFormatP3::DESCRIPTOR, "VS_Network", "GS_Network", "PS_Network" ), 10 );
- 		CHECK_MATERIAL( m_pMatRenderDebugProbeVoronoi = CreateMaterial( IDR_SHADER_GI_RENDER_DEBUG_VORONOI, "./Resources/Shaders/GIRenderDebugVoronoi.hlsl", VertexFormatP3::DESCRIPTOR, "VS", NULL, "PS" ), 11 );
+ 		m_pMatPostProcess = CreateMaterial( IDR_SHADER_GI_POST_PROCESS, "./Resources/Shaders/GIPostProcess.hlsl", VertexFormatPt4::DESCRIPTOR, "VS", NULL, "PS" );
+ 		m_pMatRenderLights = CreateMaterial( IDR_SHADER_GI_RENDER_LIGHTS, "./Resources/Shaders/GIRenderLights.hlsl", VertexFormatP3N3::DESCRIPTOR, "VS", NULL, "PS" );
+ 		m_pMatRenderDynamic = CreateMaterial( IDR_SHADER_GI_RENDER_DYNAMIC, "./Resources/Shaders/GIRenderDynamic.hlsl", VertexFormatP3N3G3T2::DESCRIPTOR, "VS", NULL, "PS", pSHStorageMacros );
+ 		m_pMatRenderDebugProbes = CreateMaterial( IDR_SHADER_GI_RENDER_DEBUG_PROBES, "./Resources/Shaders/GIRenderDebugProbes.hlsl", VertexFormatP3N3::DESCRIPTOR, "VS", NULL, "PS", pSHStorageMacros );
+ 		m_pMatRenderDebugProbesNetwork = CreateMaterial( IDR_SHADER_GI_RENDER_DEBUG_PROBES, "./Resources/Shaders/GIRenderDebugProbes.hlsl", VertexFormatP3::DESCRIPTOR, "VS_Network", "GS_Network", "PS_Network" );
+ 		m_pMatRenderDebugProbeVoronoi = CreateMaterial( IDR_SHADER_GI_RENDER_DEBUG_VORONOI, "./Resources/Shaders/GIRenderDebugVoronoi.hlsl", VertexFormatP3::DESCRIPTOR, "VS", NULL, "PS" );
 	}
 
+	EndShaderCompilation();
+
+	CHECK_MATERIAL( m_pMatRender, 1 );
+	CHECK_MATERIAL( m_pMatRenderEmissive, 2 );
+	CHECK_MATERIAL( m_pMatRenderShadowMap, 4 );
+	CHECK_MATERIAL( m_pMatRenderShadowMapPoint, 5 );
+	CHECK_MATERIAL( m_pMatPostProcess, 6 );
+	CHECK_MATERIAL( m_pMatRenderLights, 7 );
+	CHECK_MATERIAL( m_pMatRenderDynamic, 8 );
+	CHECK_MATERIAL( m_pMatRenderDebugProbes, 9 );
+	CHECK_MATERIAL( m_pMatRenderDebugProbesNetwork, 10 );
+	CHECK_MATERIAL( m_pMatRenderDebugProbeVoronoi, 11 );
+#ifdef CACHED_SHADOW_MAPS
+	CHECK_MATERIAL( m_pMatRenderShadowMapDynamic, 13 );
+	CHECK_MATERIAL( m_pMatRenderShadowMapPointDynamic, 14 );
+#endif
+#ifdef SHADOW_ATLAS
+	CHECK_MATERIAL( m_pMatRenderShadowAtlas, 15 );
+	CHECK_MATERIAL( m_pMatClearShadowAtlas, 16 );
+#endif
+#ifdef DEPTH_PREPASS
+	CHECK_MATERIAL( m_pMatRenderDepthPrepass, 19 );
+#endif
+
+	// The scene pass only switches between these so its draws skip the material & states when they didn't change
+	m_pPSO_Scene = new PipelineState( *m_pMatRender, m_Device.m_pRS_CullBack, m_Device.m_pDS_ReadWriteLess, m_Device.m_pBS_Disabled );
+	m_pPSO_SceneEmissive = new PipelineState( *m_pMatRenderEmissive, m_Device.m_pRS_CullBack, m_Device.m_pDS_ReadWriteLess, m_Device.m_pBS_Disabled );
+#ifdef DEPTH_PREPASS
+	// "less equal" rather than "equal" tolerates the last bit of difference between the 2 vertex shaders
+	m_pPSO_SceneAfterPrepass = new PipelineState( *m_pMatRender, m_Device.m_pRS_CullBack, m_Device.m_pDS_ReadLessEqual, m_Device.m_pBS_Disabled );
+	m_pPSO_SceneEmissiveAfterPrepass = new PipelineState( *m_pMatRenderEmissive, m_Device.m_pRS_CullBack, m_Device.m_pDS_ReadLessEqual, m_Device.m_pBS_Disabled );
+	m_pPSO_DepthPrepass = new PipelineState( *m_pMatRenderDepthPrepass, m_Device.m_pRS_CullBack, m_Device.m_pDS_ReadWriteLess, m_Device.m_pBS_ZPrePass );
+#endif
+
 m_pCSComputeShadowMapBounds = NULL;	// TODO!
 
+#ifdef CLUSTERED_LIGHTS
+	CHECK_MATERIAL( m_pCSCullLightClusters = CreateComputeShader( IDR_SHADER_GI_CULL_LIGHT_CLUSTERS, "./Resources/Shaders/GICullLightClusters.hlsl", "CS" ), 12 );
+#endif
+	CHECK_MATERIAL( m_pCSSkySH = CreateComputeShader( IDR_SHADER_GI_SKY_SH, "./Resources/Shaders/GISkySH.hlsl", "CS" ), 20 );
+#ifdef AUTO_EXPOSURE
+	CHECK_MATERIAL( m_pToneMapper = new ToneMapper( m_Device, m_RTTarget.GetWidth(), m_RTTarget.GetHeight() ), 17 );
+#endif
+#ifdef TEMPORAL_AA
+	CHECK_MATERIAL( m_pTemporalAA = new TemporalAA( m_Device, m_Camera, m_RTTarget.GetWidth(), m_RTTarget.GetHeight(), VertexFormatP3N3G3T2::DESCRIPTOR ), 18 );
+#endif
+#ifdef VOXEL_CONE_TRACED_GI
+	D3D_SHADER_MACRO	pVoxelizeMacros[] = { { "PACKED_VERTICES", pPackedVertices }, { NULL, NULL } };
+	CHECK_MATERIAL( m_pVoxelGI = new VoxelGI( m_Device, SceneVertexFormat, pVoxelizeMacros ), 21 );
+#endif
+	m_pRenderGraph = new RenderGraph( m_Device );
+
 
 	//////////////////////////////////////////////////////////////////////////
 	// Create the textures
@@ -303,18 +481,43 @@ m_pCSComputeShadowMapBounds = NULL;	// TODO!
 		m_TexturesCount = sizeof(ppTextureFileNames) / sizeof(const char*);
 		m_ppTextures = new Texture2D*[m_TexturesCount];
 
+#ifdef STREAMED_TEXTURES
+		m_pTextureStreamer = new TextureStreamer( _Device );
+#endif
+#ifdef TEXTURE_ARRAYS
+		m_pTexturePacker = new TextureArrayPacker( _Device );
+#endif
+
 		static char	pTemp[1024];
 		for ( int TextureIndex=0; TextureIndex < m_TexturesCount; TextureIndex++ )
 		{
 			const char*	pTextureFileName = ppTextureFileNames[TextureIndex];
 			sprintf_s( pTemp, "%s%s", TEXTURES_PATH, pTextureFileName );
 
+#ifdef STREAMED_TEXTURES
+			m_ppTextures[TextureIndex] = m_pTextureStreamer->Load( pTemp );
+#elif defined(TEXTURE_ARRAYS)
+			m_pTexturePacker->Add( pTemp );	// Packed texture indices match the texture IDs
+#else
 			TextureFilePOM	POM( pTemp );
 			m_ppTextures[TextureIndex] = new Texture2D( _Device, POM );
+#endif
 		}
 
+#ifdef TEXTURE_ARRAYS
+		// Pack the textures and make each one point to its array (so textures sharing an array are sorted together in the draw queue)
+		m_pTexturePacker->Build();
+		ASSERT( m_pTexturePacker->GetArraysCount() <= int(MAX_MATERIAL_TEXTURE_ARRAYS), "Too many texture arrays! Increase MAX_MATERIAL_TEXTURE_ARRAYS or use fewer formats & sizes..." );
+		for ( int TextureIndex=0; TextureIndex < m_TexturesCount; TextureIndex++ )
+			m_ppTextures[TextureIndex] = &m_pTexturePacker->GetArray( TextureArrayPacker::GetSlotArray( m_pTexturePacker->GetSlot( TextureIndex ) ) );
+#endif
+
 #else	//#ifndef	USE_WHITE_TEXTURES
 
+#ifdef STREAMED_TEXTURES
+		m_pTextureStreamer = NULL;
+#endif
+
 		m_TexturesCount = 2;
 		m_ppTextures = new Texture2D*[m_TexturesCount];
 
@@ -339,6 +542,35 @@ m_pCSComputeShadowMapBounds = NULL;	// TODO!
 	// Create the shadow map
 	m_pRTShadowMap = new Texture2D( _Device, SHADOW_MAP_SIZE, SHADOW_MAP_SIZE, DepthStencilFormatD32F::DESCRIPTOR );
 	m_pRTShadowMapPoint = new Texture2D( _Device, SHADOW_MAP_POINT_SIZE, SHADOW_MAP_POINT_SIZE, DepthStencilFormatD32F::DESCRIPTOR, 6 );
+#ifdef CACHED_SHADOW_MAPS
+	m_pRTShadowMapStatic = new Texture2D( _Device, SHADOW_MAP_SIZE, SHADOW_MAP_SIZE, DepthStencilFormatD32F::DESCRIPTOR );
+	m_pRTShadowMapPointStatic = new Texture2D( _Device, SHADOW_MAP_POINT_SIZE, SHADOW_MAP_POINT_SIZE, DepthStencilFormatD32F::DESCRIPTOR, 6 );
+	memset( &m_ShadowMapStaticWorld2Light, 0, sizeof(float4x4) );	// Can't match any actual light so the caches get rendered on the first frame
+	m_ShadowMapPointStaticLight = float4::Zero;
+	m_bShadowMapStaticDirty = true;
+	m_bShadowMapPointStaticDirty = true;
+#endif
+#ifdef SHADOW_ATLAS
+	m_pRTShadowAtlas = new Texture2D( _Device, SHADOW_ATLAS_SIZE, SHADOW_ATLAS_SIZE, DepthStencilFormatD32F::DESCRIPTOR );
+	for ( U32 SlotIndex=0; SlotIndex < SHADOW_ATLAS_SLOTS_COUNT; SlotIndex++ )
+	{
+		ShadowAtlasSlot&	Slot = m_pShadowAtlasSlots[SlotIndex];
+		Slot.LightIndex = SHADOW_ATLAS_NO_SLOT;
+		Slot.LastUsedFrame = 0;
+		Slot.Level = 0;
+		Slot.Light = float4::Zero;
+		Slot.bRendered = false;
+	}
+	m_ShadowAtlasFrameIndex = 0;
+	m_ShadowAtlasRenderSlotsCount = 0;
+#endif
+#ifdef SUN_SHADOW_CASCADES
+	m_pRTSunShadowCascades = new Texture2D( _Device, SUN_SHADOW_CASCADE_SIZE, SUN_SHADOW_CASCADE_SIZE, DepthStencilFormatD32F::DESCRIPTOR, SUN_SHADOW_CASCADES_COUNT );
+	m_SunShadowCascadesSunDirection = float3::Zero;	// Can't match any actual sun so all the cascades get rendered on the first frame
+	m_SunShadowCascadesFrameIndex = 0;
+	m_SunShadowCascadesRenderMask = 0;
+	m_bSunShadowMapUpdate = true;
+#endif
 
 
 	//////////////////////////////////////////////////////////////////////////
@@ -346,12 +578,52 @@ m_pCSComputeShadowMapBounds = NULL;	// TODO!
 	m_pCB_General = new CB<CBGeneral>( _Device, 8, true );
 	m_pCB_Scene = new CB<CBScene>( _Device, 9, true );
  	m_pCB_Object = new CB<CBObject>( _Device, 10 );
+	m_pCB_Object->SetTransient( true );	// Updated for every mesh
 	m_pCB_ObjectVoronoi = new CB<CBObjectVoronoi>( _Device, 10 );
 	m_pCB_Splat = new CB<CBSplat>( _Device, 10 );
-	m_pCB_DynamicObject = new CB<CBDynamicObject>( _Device, 10 );
  	m_pCB_Material = new CB<CBMaterial>( _Device, 11 );
 	m_pCB_ShadowMap = new CB<CBShadowMap>( _Device, 2, true );
 	m_pCB_ShadowMapPoint = new CB<CBShadowMapPoint>( _Device, 3, true );
+#ifdef CULLED_POINT_SHADOW_FACES
+	m_pShadowMapPointViews = new MultiView( _Device );
+#endif
+#ifdef CLUSTERED_LIGHTS
+	m_pCB_LightClusters = new CB<CBLightClusters>( _Device, 12, true );
+	m_pCB_LightClusters->m.ClustersX = LIGHT_CLUSTERS_X;
+	m_pCB_LightClusters->m.ClustersY = LIGHT_CLUSTERS_Y;
+	m_pCB_LightClusters->m.ClustersZ = LIGHT_CLUSTERS_Z;
+	m_pCB_LightClusters->m.MaxIndices = MAX_CLUSTER_LIGHT_INDICES;
+	m_pCB_LightClusters->m.ScreenSize.Set( float(m_RTTarget.GetWidth()), float(m_RTTarget.GetHeight()) );
+#endif
+#ifdef SHADOW_ATLAS
+	m_pCB_ShadowAtlas = new CB<CBShadowAtlas>( _Device, 13 );
+#endif
+	m_pCB_SkySH = new CB<CBSkySH>( _Device, 10 );
+#ifdef SUN_SHADOW_CASCADES
+	m_pCB_SunShadowCascades = new CB<CBSunShadowCascades>( _Device, 4 );
+	memset( &m_pCB_SunShadowCascades->m, 0, sizeof(CBSunShadowCascades) );
+	m_pCB_SunShadowCascadeRender = new CB<CBShadowMap>( _Device, 2, true );
+#endif
+
+#ifdef PARALLEL_RECORDING
+	m_pCB_ObjectShadowMap = new CB<CBObject>( _Device, 10 );
+	m_pCB_ObjectShadowMapPoint = new CB<CBObject>( _Device, 10 );
+
+	m_pCLShadowMap = new CommandList( _Device );
+	m_pCLShadowMapPoint = new CommandList( _Device );
+	m_pCLScene = new CommandList( _Device );
+#endif
+
+#ifdef DEPTH_PREPASS
+	D3D11_QUERY_DESC	StatisticsDesc;
+	StatisticsDesc.Query = D3D11_QUERY_PIPELINE_STATISTICS;
+	StatisticsDesc.MiscFlags = 0;
+	for ( U32 QueryIndex=0; QueryIndex < OVERDRAW_QUERIES_COUNT; QueryIndex++ )
+	{
+		Device::Check( m_Device.DXDevice().CreateQuery( &StatisticsDesc, &m_ppQueriesOverdraw[QueryIndex] ) );
+		m_pQueriesOverdrawPending[QueryIndex] = false;
+	}
+#endif
 
 	m_pCB_Scene->m.DynamicLightsCount = 0;
 	m_pCB_Scene->m.StaticLightsCount = 0;
@@ -359,78 +631,165 @@ m_pCSComputeShadowMapBounds = NULL;	// TODO!
 
 
 	//////////////////////////////////////////////////////////////////////////
-	// Create the lights structured buffers
-	m_pSB_LightsStatic = new SB<LightStruct>( m_Device, MAX_LIGHTS, true );
-	m_pSB_LightsDynamic = new SB<LightStruct>( m_Device, MAX_LIGHTS, true );
+	// Create the lights structured buffers (the static lights buffer is sized once the scene is loaded, the dynamic ones are rewritten each frame)
+	m_pSB_LightsDynamic = new FrameSB<LightStruct>( m_Device, MAX_DYNAMIC_LIGHTS );
+
+	// Create the dynamic objects' instances
+	m_pSB_DynamicObjects = new FrameSB<DynamicObjectInstance>( m_Device, MAX_DYNAMIC_OBJECTS );
+
+	// Create the ambient sky SH, written by GISkySH.hlsl
+	m_pSB_SkySH = new SB<float4>( m_Device, 18, true );
+#ifdef CACHED_SHADOW_MAPS
+	m_pSB_DynamicObjectTransforms = new FrameSB<float4x4>( m_Device, MAX_DYNAMIC_OBJECTS );
+#endif
+#ifdef CLUSTERED_LIGHTS
+	m_pSB_ClusterRanges = new SB<ClusterRange>( m_Device, LIGHT_CLUSTERS_X * LIGHT_CLUSTERS_Y * LIGHT_CLUSTERS_Z, true );
+	m_pSB_ClusterLightIndices = new SB<U32>( m_Device, MAX_CLUSTER_LIGHT_INDICES, true );
+	m_pSB_ClusterIndicesCounter = new SB<U32>( m_Device, 1, true );
+#endif
+#ifdef SHADOW_ATLAS
+	m_pSB_ShadowAtlasLights = new SB<ShadowAtlasLight>( m_Device, SHADOW_ATLAS_SLOTS_COUNT, true );
+#endif
 
 
 	//////////////////////////////////////////////////////////////////////////
 	// Initialize the probes network
-	m_ProbesNetwork.Init( m_Device, m_ScreenQuad );
+#ifdef PACKED_SCENE_VERTICES
+	const bool	bPackedSceneVertices = true;
+#else
+	const bool	bPackedSceneVertices = false;
+#endif
+#ifdef TEXTURE_ARRAYS
+	const bool	bTextureArrays = true;
+#else
+	const bool	bTextureArrays = false;
+#endif
+	m_ProbesNetwork.Init( m_Device, m_ScreenQuad, PROBE_SH_STORAGE_FORMAT, bPackedSceneVertices, bTextureArrays );
 
 
 	//////////////////////////////////////////////////////////////////////////
 	// Load and init the scene
-	m_Scene.Load( IDR_SCENE_GI );
+	m_Scene.Load( IDR_SCENE_GI, SCENE_LODS_COUNT );
 
-	// Cache meshes & probes since my ForEach function is slow as hell!! ^^
-	{
-		m_ppCachedMeshes = new Scene::Mesh*[m_Scene.m_MeshesCount];
+	const char*	pOptimizeProbes = strstr( GetCommandLineA(), "-optimizeprobes=" );	// Offline probe placement optimization (cf. SHProbeNetwork::OptimizeProbePlacement())
 
-		m_ProbesNetwork.PreAllocateProbes( m_Scene.m_ProbesCount );
+#ifdef TEXTURE_ARRAYS
+	// Store the texture slots of each material
+	m_pSB_MaterialTextures = new SB<MaterialTextures>( m_Device, MAX( 1, m_Scene.m_MaterialsCount ), true );
+	for ( int MaterialIndex=0; MaterialIndex < m_Scene.m_MaterialsCount; MaterialIndex++ )
+	{
+		const Scene::Material&	SceneMaterial = *m_Scene.m_ppMaterials[MaterialIndex];
+		const Scene::Material::Texture*	ppSceneTextures[3] = { &SceneMaterial.m_TexDiffuseAlbedo, &SceneMaterial.m_TexNormal, &SceneMaterial.m_TexSpecularAlbedo };
 
-		class	VisitorStoreNodes : public Scene::IVisitor
+		MaterialTextures&	Target = m_pSB_MaterialTextures->m[SceneMaterial.m_ID];
+		Target.__PAD = 0;
+		for ( int TextureIndex=0; TextureIndex < 3; TextureIndex++ )
 		{
-			EffectGlobalIllum2&	m_Owner;
-			FPSCamera&			m_Camera;
-		public:
-			int		m_MeshIndex;
-			int		m_PrimitivesCount;
-			int		m_VerticesCount;
-			int		m_FacesCount;
-			VisitorStoreNodes( EffectGlobalIllum2& _Owner, FPSCamera& _Camera ) : m_Owner( _Owner ), m_Camera( _Camera ), m_MeshIndex( 0 ), m_PrimitivesCount( 0 ), m_FacesCount( 0 ), m_VerticesCount( 0 ) {}
-			void	HandleNode( Scene::Node& _Node ) override
-			{
-				if ( _Node.m_Type == Scene::Node::MESH ) {
-					// Register a new mesh
-					Scene::Mesh*	pMesh = (Scene::Mesh*) &_Node;
-					m_Owner.m_ppCachedMeshes[m_MeshIndex++] = pMesh;
-					m_PrimitivesCount += pMesh->m_PrimitivesCount;
-					for ( int i=0; i < pMesh->m_PrimitivesCount; i++ ) {
-						m_VerticesCount += pMesh->m_pPrimitives[i].m_VerticesCount;
-						m_FacesCount += pMesh->m_pPrimitives[i].m_FacesCount;
-					}
-
-				} else if ( _Node.m_Type == Scene::Node::LIGHT ) {
-					// Add another static light
-					Scene::Light&	SourceLight = (Scene::Light&) _Node;
-					LightStruct&	TargetLight = m_Owner.m_pSB_LightsStatic->m[m_Owner.m_pCB_Scene->m.StaticLightsCount++];
-
-					TargetLight.Type = SourceLight.m_LightType;
-					TargetLight.Position = SourceLight.m_Local2World.GetRow( 3 );
-					TargetLight.Direction = -SourceLight.m_Local2World.GetRow( 2 ).Normalize();
-					TargetLight.Color = SourceLight.m_Intensity * SourceLight.m_Color;
-					TargetLight.Parms.Set( 10.0f, 11.0f, cosf( SourceLight.m_HotSpot ), cosf( SourceLight.m_Falloff ) );
-
-				} else if ( _Node.m_Type == Scene::Node::PROBE )
-					m_Owner.m_ProbesNetwork.AddProbe( (Scene::Probe&) _Node );
-				else if ( _Node.m_Type == Scene::Node::CAMERA ) {
-					float3	CameraPosition = _Node.m_Local2World.GetRow( 3 );
-					float3	CameraAt = -_Node.m_Local2World.GetRow( 1 );
-					m_Camera.Init( CameraPosition, CameraPosition + 4.0f * CameraAt );
-				}
+			U32	TextureID = ppSceneTextures[TextureIndex]->m_ID;
+			Target.pSlots[TextureIndex] = TextureID != ~0U ? m_pTexturePacker->GetSlot( TextureID ) : TextureArrayPacker::INVALID_SLOT;
+		}
+#ifndef USE_NORMAL_MAPS
+		Target.pSlots[1] = TextureArrayPacker::INVALID_SLOT;
+#endif
+	}
+	m_pSB_MaterialTextures->Write( MAX( 1, m_Scene.m_MaterialsCount ) );
+#endif
+
+	m_pSB_LightsStatic = new SB<LightStruct>( m_Device, MAX( 1, m_Scene.m_LightsCount ), true );
+#ifdef SHADOW_ATLAS
+	m_pSB_ShadowAtlasLightSlots = new SB<U32>( m_Device, m_Scene.m_LightsCount + MAX_DYNAMIC_LIGHTS, true );
+#endif
+
+	// Gather the nodes from the scene's typed arrays, the index of a light in the scene is also its index in the static lights buffer
+	{
+		m_ppCachedMeshes = m_Scene.m_ppMeshes;
+
+		for ( int LightIndex=0; LightIndex < m_Scene.m_LightsCount; LightIndex++ ) {
+			const Scene::Light&	SourceLight = *m_Scene.m_ppLights[LightIndex];
+			LightStruct&		TargetLight = m_pSB_LightsStatic->m[SourceLight.m_TypeIndex];
+
+			TargetLight.Type = SourceLight.m_LightType;
+			TargetLight.Position = SourceLight.m_Local2World.GetRow( 3 );
+			TargetLight.Direction = -SourceLight.m_Local2World.GetRow( 2 ).Normalize();
+			TargetLight.Color = SourceLight.m_Intensity * SourceLight.m_Color;
+			TargetLight.Parms.Set( 10.0f, 11.0f, cosf( SourceLight.m_HotSpot ), cosf( SourceLight.m_Falloff ) );
+		}
+		m_pCB_Scene->m.StaticLightsCount = m_Scene.m_LightsCount;
+
+		// Optimizing the placement starts again from all the probes of the scene, otherwise only the probes it kept are used
+		m_ProbesNetwork.AddSceneProbes( m_Scene, PROBES_PATH, pOptimizeProbes != NULL );
+
+		if ( m_Scene.m_CamerasCount > 0 ) {
+			const Scene::Camera&	SceneCamera = *m_Scene.m_ppCameras[m_Scene.m_CamerasCount-1];	// The last camera wins, like it always did
+			float3	CameraPosition = SceneCamera.m_Local2World.GetRow( 3 );
+			float3	CameraAt = -SceneCamera.m_Local2World.GetRow( 1 );
+			_Camera.Init( CameraPosition, CameraPosition + 4.0f * CameraAt );
+		}
+	}
+
+	// Build the culler from the meshes' world bounds
+	{
+		float3*	pBoundsMin = new float3[m_Scene.m_MeshesCount];
+		float3*	pBoundsMax = new float3[m_Scene.m_MeshesCount];
+		for ( int MeshIndex=0; MeshIndex < m_Scene.m_MeshesCount; MeshIndex++ ) {
+			pBoundsMin[MeshIndex] = m_ppCachedMeshes[MeshIndex]->m_GlobalBBoxMin;
+			pBoundsMax[MeshIndex] = m_ppCachedMeshes[MeshIndex]->m_GlobalBBoxMax;
+		}
+		m_MeshesCuller.Init( m_Scene.m_MeshesCount, pBoundsMin, pBoundsMax );
+		delete[] pBoundsMax;
+		delete[] pBoundsMin;
+
+		m_pVisibleMeshesScene = new U8[m_Scene.m_MeshesCount];
+		m_pVisibleMeshesShadowMap = new U8[m_Scene.m_MeshesCount];
+		m_pVisibleMeshesShadowMapPoint = new U8[m_Scene.m_MeshesCount];
+		m_pVisibleMeshesShadowAtlas = new U8[m_Scene.m_MeshesCount];
+#ifdef VOXEL_CONE_TRACED_GI
+		m_pVisibleMeshesVoxels = new U8[m_Scene.m_MeshesCount];
+#endif
+	}
+
+#ifdef OCCLUSION_CULLING
+	BuildOccluders();
+#endif
+
+#ifdef INSTANCED_SHADOW_MAPS
+	// Upload the transforms of the instance groups once and for all (the scene is static)
+	m_pSB_InstanceTransforms = new SB<float4x4>( m_Device, MAX( 1, m_Scene.m_InstancesCount ), true );
+	for ( int InstanceIndex=0; InstanceIndex < m_Scene.m_InstancesCount; InstanceIndex++ )
+		m_pSB_InstanceTransforms->m[InstanceIndex] = m_Scene.m_ppInstances[InstanceIndex]->m_pOwner->m_Local2World;
+	m_pSB_InstanceTransforms->Write( m_Scene.m_InstancesCount );
+#endif
+
+#ifdef POOLED_SCENE_GEOMETRY
+	// Size the pool of the scene primitives (cf. TagPrimitive())
+	{
+		int		VerticesCount = 0;
+		int		IndicesCount = 0;
+		bool	b32BitsIndices = false;
+		for ( int MeshIndex=0; MeshIndex < m_Scene.m_MeshesCount; MeshIndex++ ) {
+			const Scene::Mesh&	Mesh = *m_ppCachedMeshes[MeshIndex];
+			for ( int PrimitiveIndex=0; PrimitiveIndex < Mesh.m_PrimitivesCount; PrimitiveIndex++ ) {
+				const Scene::Mesh::Primitive&	P = Mesh.m_pPrimitives[PrimitiveIndex];
+				VerticesCount += P.m_VerticesCount;
+				IndicesCount += 3 * (P.m_pLODFacesStart[P.m_LODsCount-1] + P.m_pLODFacesCount[P.m_LODsCount-1]);
+				b32BitsIndices |= P.m_IndexFormat == DXGI_FORMAT_R32_UINT;
 			}
-		}	Visitor1( *this, _Camera );
-		m_Scene.ForEach( Visitor1 );
+		}
+
+#ifdef PACKED_SCENE_VERTICES
+		m_pScenePool = new GeometryPool( m_Device, MAX( 1, VerticesCount ), IndicesCount, b32BitsIndices ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT, VertexFormatPackedP3N3G3B3T2::DESCRIPTOR );
+#else
+		m_pScenePool = new GeometryPool( m_Device, MAX( 1, VerticesCount ), IndicesCount, b32BitsIndices ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT, VertexFormatP3N3G3B3T2::DESCRIPTOR );
+#endif
+#ifdef DEPTH_VERTEX_STREAMS
+		m_pSceneDepthPool = new GeometryPool( m_Device, MAX( 1, VerticesCount ), 0, DXGI_FORMAT_R16_UINT, GetSceneDepthVertexFormat() );	// Positions only, drawn with the indices of the scene pool
+#endif
 	}
+#endif
 
 	// Compute scene's BBox
-	m_SceneBBoxMin = float3::MaxFlt;
-	m_SceneBBoxMax = -float3::MaxFlt;
-	for ( int MeshIndex=0; MeshIndex < m_Scene.m_MeshesCount; MeshIndex++ ) {
-		m_SceneBBoxMin = m_SceneBBoxMin.Min( m_ppCachedMeshes[MeshIndex]->m_GlobalBBoxMin );
-		m_SceneBBoxMax = m_SceneBBoxMax.Max( m_ppCachedMeshes[MeshIndex]->m_GlobalBBoxMax );
-	}
+	m_SceneBBoxMin = m_Scene.m_GlobalBBoxMin;
+	m_SceneBBoxMax = m_Scene.m_GlobalBBoxMax;
 
 	// Upload static lights once and for all
 	m_pSB_LightsStatic->Write( m_pCB_Scene->m.StaticLightsCount );
@@ -454,13 +813,41 @@ m_pCSComputeShadowMapBounds = NULL;	// TODO!
 		m_EmissiveMaterialsCount = 0;
 		m_Scene.PlaceTags( *this );
 
-		// Precompute probes and store result to disk
-		RenderScene		functor( *this );
-		m_ProbesNetwork.PreComputeProbes( PROBES_PATH, functor, m_Scene, m_TotalFacesCount );
+		// Precompute probes and store result to disk (or only our part of them, or merge the parts of a distributed bake)
+		const char*	pCommandLine = GetCommandLineA();
+		const char*	pBakeUnit = strstr( pCommandLine, "-bakeunit=" );
+		const char*	pBakeMerge = strstr( pCommandLine, "-bakemerge=" );
+		U32			BakeUnitIndex = 0;
+		U32			BakeUnitsCount = 1;
+		if ( pBakeUnit != NULL && sscanf_s( pBakeUnit, "-bakeunit=%u/%u", &BakeUnitIndex, &BakeUnitsCount ) != 2 )
+			BakeUnitsCount = 0;
+		if ( pBakeMerge != NULL && sscanf_s( pBakeMerge, "-bakemerge=%u", &BakeUnitsCount ) != 1 )
+			BakeUnitsCount = 0;
+		ASSERT( BakeUnitsCount > 0 && BakeUnitIndex < BakeUnitsCount, "Invalid bake unit on the command line!" );
+
+		if ( pBakeMerge != NULL ) {
+			if ( !m_ProbesNetwork.MergeBakeWorkUnits( PROBES_PATH, m_Scene, m_TotalFacesCount, BakeUnitsCount ) )
+				m_ErrorCode = 19;	// Some units are missing or don't match, check the debug output...
+		} else {
+			RenderScene		functor( *this );
+#ifdef INCREMENTAL_PROBE_BAKE
+			if ( pBakeUnit == NULL )
+				m_ProbesNetwork.RebakeProbes( PROBES_PATH, functor, m_Scene, m_TotalFacesCount );
+			else
+#endif
+				m_ProbesNetwork.PreComputeProbes( PROBES_PATH, functor, m_Scene, m_TotalFacesCount, BakeUnitIndex, BakeUnitsCount );
+			if ( pBakeUnit != NULL )
+				ExitProcess( 0 );	// The render farm nodes are done once their unit is saved
+		}
 
 		// Delete rendering primitives
 		m_bDeleteSceneTags = true;
 		m_Scene.PlaceTags( *this );
+#ifdef POOLED_SCENE_GEOMETRY
+		m_pScenePool->Reset();
+		if ( m_pSceneDepthPool != NULL )
+			m_pSceneDepthPool->Reset();
+#endif
 #endif
 	}
 
@@ -468,6 +855,14 @@ m_pCSComputeShadowMapBounds = NULL;	// TODO!
 	// Load probes
 	m_ProbesNetwork.LoadProbes( PROBES_PATH, m_SceneBBoxMin, m_SceneBBoxMax );
 
+	if ( pOptimizeProbes != NULL ) {
+		float	ErrorBudget = 0.0f;
+		if ( sscanf_s( pOptimizeProbes, "-optimizeprobes=%f", &ErrorBudget ) != 1 || ErrorBudget <= 0.0f )
+			ErrorBudget = 0.05f;
+		m_ProbesNetwork.OptimizeProbePlacement( PROBES_PATH, m_Scene, ErrorBudget );
+		ExitProcess( 0 );	// The next run bakes & uses the probes that were kept
+	}
+
 
 	//////////////////////////////////////////////////////////////////////////
 	// Initialize our own objects and assign them as tags to the scene's objects
@@ -481,6 +876,11 @@ m_pCSComputeShadowMapBounds = NULL;	// TODO!
 
 	ASSERT( m_ProbesNetwork.GetProbeIDVertexStream() != NULL && m_ProbesNetwork.GetProbeIDVertexStream()->GetVerticesCount() == m_TotalVerticesCount, "There's a discrepancy between the scene's total vertices count and last computed probe vertex stream! Did the scene change? In which case, you should probably recompute the probes network by commenting out the \"LOAD_PROBES\" define and start again..." );
 
+#ifdef SCENE_HOT_RELOAD
+	// Watch the scene file for a new conversion (cf. HotReloadScene())
+	m_pSceneWatcher = new FileWatcher( SCENE_FILE_PATH );
+#endif
+
 
 	//////////////////////////////////////////////////////////////////////////
 	// Create our sphere primitive for displaying lights & probes
@@ -492,51 +892,6 @@ m_pCSComputeShadowMapBounds = NULL;	// TODO!
 	m_pPrimPoint = new Primitive( _Device, 1, &Point, 0, NULL, D3D11_PRIMITIVE_TOPOLOGY_POINTLIST, VertexFormatP3::DESCRIPTOR );
 
 
-	//////////////////////////////////////////////////////////////////////////
-	// Build the ambient sky SH using the CIE overcast sky model
-	//
-	const int	MAX_THETA = 40;
-	double		dPhidTheta = (PI / MAX_THETA) * (2*PI / (2*MAX_THETA));
-
-	double		SumSHCoeffs[3*9];
-	memset( SumSHCoeffs, 0, 3*9*sizeof(double) );
-
-	double		SHCoeffs[9];
-	double		SumSolidAngle = 0.0;
-	for ( int ThetaIndex=0; ThetaIndex < MAX_THETA; ThetaIndex++ )
-	{
-		float	Theta = PI * (0.5f+ThetaIndex) / MAX_THETA;
-		for ( int PhiIndex=0; PhiIndex < 2*MAX_THETA; PhiIndex++ )
-		{
-			float		Phi = PI * PhiIndex / MAX_THETA;
-			float3	Direction( sinf(Phi) * sinf(Theta), cosf(Theta), cosf(Phi)*sinf(Theta) );
-			SH::BuildSHCoeffs_YUp( Direction, SHCoeffs );
-
-			float3	SkyColor = (1.0f + 2.0f * MAX( -0.5f, cosf(Theta) )) / 3.0f * float3::One;
-//			float3	SkyColor = 1.0f;	// Simple ambient sky...
-
-			double		SolidAngle = sinf(Theta) * dPhidTheta;
-			SumSolidAngle += SolidAngle;
-
-			for ( int l=0; l < 3; l++ )
-			{
-				float3	FilteredIntensity = SkyColor * expf( -(PI * l / 3.0f) * (PI * l / 3.0f) / 2.0f );
-				for ( int m=-l; m <= l; m++ )
-				{
-					int		CoeffIndex = l*(l+1)+m;
-					double	SHCoeff = SHCoeffs[CoeffIndex] * SolidAngle;
-					SumSHCoeffs[3*CoeffIndex+0] += FilteredIntensity.x * SHCoeff;
-					SumSHCoeffs[3*CoeffIndex+1] += FilteredIntensity.y * SHCoeff;
-					SumSHCoeffs[3*CoeffIndex+2] += FilteredIntensity.z * SHCoeff;
-				}
-			}
-		}
-	}
-
-	for ( int i=0; i < 9; i++ )
-		m_pSHAmbientSky[i] = float( SKY_INTENSITY * INV4PI * SumSHCoeffs[3*i+0] ) * float3( 0.64f, 0.79f, 1.0f );
-
-
 	//////////////////////////////////////////////////////////////////////////
 	// Build initial positions for dynamic dummy objects
 	float3	BBoxCenter = 0.5f * (m_SceneBBoxMin + m_SceneBBoxMax);
@@ -632,11 +987,25 @@ EffectGlobalIllum2::~EffectGlobalIllum2()
 	delete m_pPrimPoint;
 	delete m_pPrimSphere;
 
-	delete[] m_ppCachedMeshes;
+#ifdef VOXEL_CONE_TRACED_GI
+	delete[] m_pVisibleMeshesVoxels;
+#endif
+	delete[] m_pVisibleMeshesShadowAtlas;
+	delete[] m_pVisibleMeshesShadowMapPoint;
+	delete[] m_pVisibleMeshesShadowMap;
+	delete[] m_pVisibleMeshesScene;
+	m_MeshesCuller.Exit();
 
 	m_bDeleteSceneTags = true;
 	m_Scene.PlaceTags( *this );
 	m_Scene.Exit();
+	delete m_pSceneDepthPool;
+	delete m_pScenePool;
+#ifdef SCENE_HOT_RELOAD
+	delete m_pSceneWatcher;
+	for ( int SceneIndex=0; SceneIndex < m_ReloadedScenes.GetCount(); SceneIndex++ )
+		delete[] m_ReloadedScenes[SceneIndex];
+#endif
 
 	m_ProbesNetwork.Exit();
 
@@ -645,31 +1014,121 @@ EffectGlobalIllum2::~EffectGlobalIllum2()
 	if ( m_pPrimVoronoiCellEdges != NULL )
 		delete m_pPrimVoronoiCellEdges;
 
+#ifdef SHADOW_ATLAS
+	delete m_pSB_ShadowAtlasLights;
+	delete m_pSB_ShadowAtlasLightSlots;
+#endif
+#ifdef CLUSTERED_LIGHTS
+	delete m_pSB_ClusterIndicesCounter;
+	delete m_pSB_ClusterLightIndices;
+	delete m_pSB_ClusterRanges;
+#endif
+#ifdef CACHED_SHADOW_MAPS
+	delete m_pSB_DynamicObjectTransforms;
+#endif
+	delete m_pSB_SkySH;
+	delete m_pSB_DynamicObjects;
 	delete m_pSB_LightsDynamic;
+	delete m_pSB_InstanceTransforms;
 	delete m_pSB_LightsStatic;
 
+#ifdef DEPTH_PREPASS
+	for ( U32 QueryIndex=0; QueryIndex < OVERDRAW_QUERIES_COUNT; QueryIndex++ )
+		m_ppQueriesOverdraw[QueryIndex]->Release();
+#endif
+
+#ifdef PARALLEL_RECORDING
+	delete m_pCLScene;
+	delete m_pCLShadowMapPoint;
+	delete m_pCLShadowMap;
+
+	delete m_pCB_ObjectShadowMapPoint;
+	delete m_pCB_ObjectShadowMap;
+#endif
+
+	delete m_pCB_SkySH;
+#ifdef SUN_SHADOW_CASCADES
+	delete m_pCB_SunShadowCascadeRender;
+	delete m_pCB_SunShadowCascades;
+#endif
+#ifdef SHADOW_ATLAS
+	delete m_pCB_ShadowAtlas;
+#endif
+#ifdef CLUSTERED_LIGHTS
+	delete m_pCB_LightClusters;
+#endif
+#ifdef CULLED_POINT_SHADOW_FACES
+	delete m_pShadowMapPointViews;
+#endif
 	delete m_pCB_ShadowMapPoint;
 	delete m_pCB_ShadowMap;
 	delete m_pCB_Material;
-	delete m_pCB_DynamicObject;
 	delete m_pCB_Splat;
 	delete m_pCB_ObjectVoronoi;
 	delete m_pCB_Object;
 	delete m_pCB_Scene;
 	delete m_pCB_General;
 
+#ifdef SUN_SHADOW_CASCADES
+	delete m_pRTSunShadowCascades;
+#endif
+#ifdef SHADOW_ATLAS
+	delete m_pRTShadowAtlas;
+#endif
+#ifdef CACHED_SHADOW_MAPS
+	delete m_pRTShadowMapPointStatic;
+	delete m_pRTShadowMapStatic;
+#endif
 	delete m_pRTShadowMapPoint;
 	delete m_pRTShadowMap;
 
 	delete m_pTexDynamicNormalMap;
+#ifdef STREAMED_TEXTURES
+	delete m_pTextureStreamer;	// Stops streaming before we destroy the textures
+#endif
+#ifdef TEXTURE_ARRAYS
+	delete m_pSB_MaterialTextures;
+	delete m_pTexturePacker;	// The textures are only pointing to its arrays
+#else
 	for ( int TextureIndex=0; TextureIndex < m_TexturesCount; TextureIndex++ )
 		delete m_ppTextures[TextureIndex];
+#endif
 	delete[] m_ppTextures;
 
+	delete m_pRenderGraph;
+#ifdef VOXEL_CONE_TRACED_GI
+	delete m_pVoxelGI;
+#endif
+#ifdef TEMPORAL_AA
+	delete m_pTemporalAA;
+#endif
+#ifdef AUTO_EXPOSURE
+	delete m_pToneMapper;
+#endif
 	delete m_pMatPostProcess;
+	delete m_pCSSkySH;
 	delete m_pCSComputeShadowMapBounds;
+#ifdef CLUSTERED_LIGHTS
+	delete m_pCSCullLightClusters;
+#endif
+#ifdef SHADOW_ATLAS
+	delete m_pMatClearShadowAtlas;
+	delete m_pMatRenderShadowAtlas;
+#endif
+#ifdef CACHED_SHADOW_MAPS
+	delete m_pMatRenderShadowMapPointDynamic;
+	delete m_pMatRenderShadowMapDynamic;
+#endif
 	delete m_pMatRenderShadowMapPoint;
 	delete m_pMatRenderShadowMap;
+#ifdef DEPTH_PREPASS
+	delete m_pPSO_DepthPrepass;
+	delete m_pPSO_SceneEmissiveAfterPrepass;
+	delete m_pPSO_SceneAfterPrepass;
+	delete m_pMatRenderDepthPrepass;
+#endif
+	delete m_pPSO_SceneEmissive;
+	delete m_pPSO_Scene;
 	delete m_pMatRenderDebugProbeVoronoi;
 	delete m_pMatRenderDebugProbesNetwork;
 	delete m_pMatRenderDebugProbes;
@@ -680,12 +1139,61 @@ EffectGlobalIllum2::~EffectGlobalIllum2()
 }
 
 float		AnimateLightTime0 = 0.0f;
+
+static const float	PROBES_UPDATE_GPU_BUDGET = 500.0f;			// GPU time we allow for probe updates each frame (in microseconds)
+static const float	POINT_LIGHT_INFLUENCE_THRESHOLD = 0.01f;	// Irradiance below which a probe is not considered lit by the point light anymore
+static const float	DYNAMIC_OBJECT_RADIUS = 0.1f;				// Scale of the unit sphere drawn for each dynamic object (cf. GIRenderDynamic.hlsl)
+static const float	DEPTH_PREPASS_ENABLE_OVERDRAW = 1.5f;		// Shaded pixels per screen pixel above which the depth prepass pays for itself
+static const float	DEPTH_PREPASS_DISABLE_OVERDRAW = 1.2f;		// Below which it's disabled again (lower so the prepass doesn't toggle every measure)
 float		AnimateDynamicObjects = 0.0f;
 
 #define RENDER_SUN	1
 
 void	EffectGlobalIllum2::Render( float _Time, float _DeltaTime )
 {
+	GPU_PROFILE_SCOPE( m_Device, "GI" );
+
+	m_DeltaTime = _DeltaTime;
+
+#ifdef STREAMED_TEXTURES
+	if ( m_pTextureStreamer != NULL )
+		m_pTextureStreamer->Update( TEXTURE_STREAMING_BUDGET );	// Upload the mips that finished loading
+#endif
+
+#ifdef SCENE_HOT_RELOAD
+	// Take the meshes that changed in the scene file before anything gets rendered with them
+	if ( m_pSceneWatcher != NULL && m_pSceneWatcher->IsWatching() ) {
+		bool	bSceneChanged = m_pSceneWatcher->HasOverflowed();	// Some changes were lost, check the scene anyway
+		char	pFileName[MAX_PATH];
+		while ( m_pSceneWatcher->Pop( pFileName ) ) {
+			const char*	pName = strrchr( pFileName, '/' );
+			bSceneChanged |= !_stricmp( pName != NULL ? pName+1 : pFileName, SCENE_FILE_NAME );
+		}
+		if ( bSceneChanged )
+			HotReloadScene();
+	}
+#endif
+
+#ifdef TEMPORAL_AA
+	// Jitter the camera before anything is rendered with it
+	m_pTemporalAA->JitterCamera();
+	m_Camera.Upload( 0 );
+#endif
+
+#ifdef DEPTH_PREPASS
+	// Decide before the scene pass gets recorded
+	UpdateDepthPrepass();
+#endif
+
+#ifdef OCCLUSION_CULLING
+	// Rasterize the occluders on the workers while the shadow maps get rendered, the scene pass waits for them
+	for ( int OccluderIndex=0; OccluderIndex < m_OccluderMeshes.GetCount(); OccluderIndex++ ) {
+		const Scene::Mesh&	Mesh = *m_ppCachedMeshes[m_OccluderMeshes[OccluderIndex]];
+		m_OcclusionCuller.SetOccluderEnabled( OccluderIndex, Mesh.m_ChunkIndex < 0 || m_Scene.m_pChunks[Mesh.m_ChunkIndex].m_State == Scene::Chunk::RESIDENT );
+	}
+	m_OcclusionCuller.Begin( m_Camera.GetCB().World2Proj );
+#endif
+
 	// Setup general data
 	m_pCB_General->m.ShowIndirect = gs_WindowInfos.pKeys[VK_RETURN] == 0;
 	m_pCB_General->m.ShowOnlyIndirect = gs_WindowInfos.pKeys[VK_BACK] == 0;
@@ -711,6 +1219,53 @@ void	EffectGlobalIllum2::Render( float _Time, float _DeltaTime )
 #endif
 
 
+	//////////////////////////////////////////////////////////////////////////
+	// Animate dynamic objects first since they're drawn in the shadow maps
+#ifdef TEMPORAL_AA
+	U32	PreviousDynamicObjectsCount = m_DynamicObjectsCount;
+	memcpy( m_pDynamicObjectPreviousPositions, m_pDynamicObjectPositions, sizeof(m_pDynamicObjectPositions) );
+#endif
+	m_DynamicObjectsCount = MIN( m_CachedCopy.DynamicObjectsCount, U32(MAX_DYNAMIC_OBJECTS) );
+	if ( m_DynamicObjectsCount > 0 )
+	{
+		AnimateDynamicObjects += 0.05f * _DeltaTime;
+		float	t = abs( fmodf( AnimateDynamicObjects, 2.0f ) - 1.0f );
+
+		for ( U32 DynamicObjectIndex=0; DynamicObjectIndex < m_DynamicObjectsCount; DynamicObjectIndex++ )
+		{
+			DynamicObject&	DynObj = m_pDynamicObjects[DynamicObjectIndex];
+			m_pDynamicObjectPositions[DynamicObjectIndex] = DynObj.PositionStart + (DynObj.PositionEnd - DynObj.PositionStart) * t;
+		}
+	}
+#ifdef TEMPORAL_AA
+	for ( U32 DynamicObjectIndex=PreviousDynamicObjectsCount; DynamicObjectIndex < m_DynamicObjectsCount; DynamicObjectIndex++ )
+		m_pDynamicObjectPreviousPositions[DynamicObjectIndex] = m_pDynamicObjectPositions[DynamicObjectIndex];	// No motion on their first frame
+#endif
+
+	// Upload the instances once for all the passes
+	if ( m_DynamicObjectsCount > 0 )
+	{
+		for ( U32 DynamicObjectIndex=0; DynamicObjectIndex < m_DynamicObjectsCount; DynamicObjectIndex++ )
+		{
+			DynamicObjectInstance&	Instance = m_pSB_DynamicObjects->m[DynamicObjectIndex];
+			Instance.Position = m_pDynamicObjectPositions[DynamicObjectIndex];
+			Instance.Radius = DYNAMIC_OBJECT_RADIUS;
+#ifdef TEMPORAL_AA
+			Instance.PreviousPosition = m_pDynamicObjectPreviousPositions[DynamicObjectIndex];
+#else
+			Instance.PreviousPosition = Instance.Position;
+#endif
+#ifdef CACHED_SHADOW_MAPS
+			m_pSB_DynamicObjectTransforms->m[DynamicObjectIndex].PRS( Instance.Position, float4::QuatFromAngleAxis( 0.0f, float3::UnitY ), DYNAMIC_OBJECT_RADIUS * float3::One );
+#endif
+		}
+		m_pSB_DynamicObjects->Write( m_DynamicObjectsCount );
+#ifdef CACHED_SHADOW_MAPS
+		m_pSB_DynamicObjectTransforms->Write( m_DynamicObjectsCount );
+#endif
+	}
+
+
 	//////////////////////////////////////////////////////////////////////////
 	// Animate lights
 
@@ -793,12 +1348,20 @@ void	EffectGlobalIllum2::Render( float _Time, float _DeltaTime )
 #endif
 
 	if ( ShowLight0 )
-		RenderShadowMapPoint( m_pSB_LightsDynamic->m[0].Position, 30.0f );
-	else
 	{
-		m_pCB_ShadowMapPoint->UpdateData();
-		m_pRTShadowMapPoint->Set( 3, true );
+		PrepareShadowMapPoint( m_pSB_LightsDynamic->m[0].Position, 30.0f );
+#ifdef PARALLEL_RECORDING
+		m_pCLShadowMapPoint->RecordAsync( m_RecorderShadowMapPoint );
+#else
+		RenderShadowMapPoint();
+#endif
 	}
+	else
+		m_pCB_ShadowMapPoint->UpdateData();
+
+	// Assign the shadow map to shaders
+	// NOTE: When recording in parallel, it's only used by the command list once it's executed so it's safe to bind it already
+	m_pRTShadowMapPoint->Set( 3, true );
 
 
 	// ============= Sun light =============
@@ -820,19 +1383,42 @@ void	EffectGlobalIllum2::Render( float _Time, float _DeltaTime )
 		m_pSB_LightsDynamic->m[1].Parms = float4::Zero;
 
 		// Render directional shadow map for Sun simulation
-		RenderShadowMap( SunDirection );
+		PrepareShadowMap( SunDirection );
+#ifdef PARALLEL_RECORDING
+		m_pCLShadowMap->RecordAsync( m_RecorderShadowMap );
+#else
+		RenderShadowMap();
+#endif
+		m_pRTShadowMap->Set( 2, true );
+#ifdef SUN_SHADOW_CASCADES
+		m_pRTSunShadowCascades->Set( 32, true );
+#endif
 	}
 #else
 
 	// Set shadow map to something, otherwise DX pisses me off with warnings...
 	m_pCB_ShadowMap->UpdateData();
 	m_pRTShadowMap->Set( 2, true );
+#ifdef SUN_SHADOW_CASCADES
+	m_pCB_SunShadowCascades->UpdateData();
+	m_pRTSunShadowCascades->Set( 32, true );
+#endif
 
 #endif
 
 	m_pSB_LightsDynamic->Write( 2 );
 	m_pSB_LightsDynamic->SetInput( 6, true );
 
+#ifdef CLUSTERED_LIGHTS
+	// Bin the lights before the scene pass gets recorded so it inherits the cluster buffers
+	CullLightClusters();
+#endif
+
+#ifdef SHADOW_ATLAS
+	// Allocate the atlas slots & bind their lookup tables before the scene pass gets recorded
+	PrepareShadowAtlas();
+#endif
+
 
 	// Update emissive materials
 	if ( m_EmissiveMaterialsCount > 0 ) {
@@ -851,13 +1437,69 @@ void	EffectGlobalIllum2::Render( float _Time, float _DeltaTime )
 			m_ppEmissiveMaterials[EmissiveMaterialIndex]->m_EmissiveColor = EmissiveColor;
 	}
 
+#ifdef VOXEL_CONE_TRACED_GI
+	{	// Voxelize & light the clipmap before the scene pass gets recorded so it inherits the bindings
+		// NOTE: With PARALLEL_RECORDING, the sun's shadow map isn't executed yet and the voxels are lit by last frame's
+		GPU_PROFILE_SCOPE( m_Device, "VoxelGI" );
+		VoxelizeScene	Voxelize( *this );
+		m_pVoxelGI->Update( m_Camera.GetCB().Camera2World.GetRow( 3 ), Voxelize, m_pSB_LightsDynamic->m[1].Direction, m_pSB_LightsDynamic->m[1].Color, *m_pRTShadowMap, m_pCB_ShadowMap->m.World2Light );
+		m_pVoxelGI->Bind();
+	}
+#endif
+
+#ifdef PARALLEL_RECORDING
+	// The scene pass can be recorded right away: it inherits the shadow maps & lights we just bound and the probes' inputs
+	//	don't change (only their content is updated by the dynamic probes update below)
+	m_ProbesNetwork.BindSceneInputs();
+	m_pCLScene->RecordAsync( m_RecorderScene );
+
+	m_Device.Jobs().Wait();
+
+	// Shadow maps must be executed first since the dynamic probes need them
+	if ( m_pCLShadowMapPoint->IsRecorded() )
+	{
+		GPU_PROFILE_SCOPE( m_Device, "ShadowMapPoint" );
+		m_pCLShadowMapPoint->Execute();
+	}
+	if ( m_pCLShadowMap->IsRecorded() )
+	{
+		GPU_PROFILE_SCOPE( m_Device, "ShadowMap" );
+		m_pCLShadowMap->Execute();
+	}
+#endif
+
+#ifdef SHADOW_ATLAS
+	RenderShadowAtlas();
+#endif
+
 
 	//////////////////////////////////////////////////////////////////////////
 	// Update dynamic probes
 	float3	SkyColor = m_CachedCopy.EnableSky ? m_CachedCopy.SkyIntensity * float3( m_CachedCopy.SkyColorR, m_CachedCopy.SkyColorG, m_CachedCopy.SkyColorB ) : float3::Zero;
+	UpdateSkySH( SkyColor );
 
 	SHProbeNetwork::DynamicUpdateParms	Parms;
 	Parms.MaxProbeUpdatesPerFrame = m_CachedCopy.MaxProbeUpdatesPerFrame;
+	Parms.Time = _Time;
+	Parms.wsCameraPosition = m_Camera.GetCB().Camera2World.GetRow( 3 );
+	Parms.World2Proj = m_Camera.GetCB().World2Proj;
+	Parms.GPUBudget = PROBES_UPDATE_GPU_BUDGET;
+#ifdef GPU_PROFILING
+	int	ProbeUpdateScopeIndex = m_Device.Profiler().FindScope( "GI/ProbeUpdate" );
+	Parms.MeasuredGPUTime = ProbeUpdateScopeIndex >= 0 ? 1000.0f * m_Device.Profiler().GetScope( ProbeUpdateScopeIndex ).AverageDuration : 0.0f;
+#else
+	Parms.MeasuredGPUTime = 0.0f;	// Always update the maximum amount of probes
+#endif
+
+	// Probes lit by the point light both before and after it changed need an update
+	const LightStruct&	PointLight = m_pSB_LightsDynamic->m[0];
+	float				PointLightIntensity = MAX( MAX( PointLight.Color.x, PointLight.Color.y ), PointLight.Color.z );
+	float4				pChangedLights[2];
+	pChangedLights[0] = m_LastPointLight;
+	pChangedLights[1] = float4( PointLight.Position, sqrtf( PointLightIntensity / POINT_LIGHT_INFLUENCE_THRESHOLD ) );	// Distance where the light's irradiance is negligible
+	Parms.ChangedLightsCount = (pChangedLights[1] - m_LastPointLight).LengthSq() > 0.0f ? 2 : 0;
+	Parms.pChangedLights = pChangedLights;
+	m_LastPointLight = pChangedLights[1];
 	Parms.pQueryMaterial = this;
 	Parms.BounceFactorSun = 0.01f * m_CachedCopy.BounceFactorSun * float3::One;
 	Parms.BounceFactorSky = 0.01f * m_CachedCopy.BounceFactorSky * SkyColor;
@@ -866,109 +1508,255 @@ void	EffectGlobalIllum2::Render( float _Time, float _DeltaTime )
 	Parms.BounceFactorEmissive = 0.01f * m_CachedCopy.BounceFactorEmissive;
 	Parms.BounceFactorNeighbors = 0.01f * (m_CachedCopy.EnableNeighborsRedistribution ? m_CachedCopy.NeighborProbesContributionBoost : 0.0f);
 
-// 	memset( Parms.AmbientSkySH, 0, 9*sizeof(float3) );
-// 	if ( m_CachedCopy.EnableSky ) {
-// 		// Use CIE sky
-// //		memcpy_s( Parms.AmbientSkySH, sizeof(Parms.AmbientSkySH), m_pSHAmbientSky, sizeof(m_pSHAmbientSky) );
-// 
-// 		// Simple ambient sky term
-// 		float	SH0 = 0.28209479177387814347403972578039f;	// DC coeff for SH is 1/(2*sqrt(PI))
-// 		Parms.AmbientSkySH[0] = SH0 * float3::One;
-// 	}
-
-	m_ProbesNetwork.UpdateDynamicProbes( Parms );
+	{
+		GPU_PROFILE_SCOPE( m_Device, "ProbeUpdate" );
+		m_ProbesNetwork.UpdateDynamicProbes( Parms );
+	}
 
 
 	//////////////////////////////////////////////////////////////////////////
-	// 1] Render the scene
- 	m_Device.ClearRenderTarget( m_RTTarget, m_CachedCopy.EnableSky ? 1.0f * float4( 0.64f, 0.79f, 1.0f, 0.0f ) : float4::Zero );
-
- 	m_Device.SetRenderTarget( m_RTTarget, &m_Device.DefaultDepthStencil() );
-	m_Device.SetStates( m_Device.m_pRS_CullBack, m_Device.m_pDS_ReadWriteLess, m_Device.m_pBS_Disabled );
-
-	m_Scene.Render( *this );
+	// Declare the passes of the frame
+	// The graph only removes the bindings that conflict between 2 passes (e.g. the depth stencil rendered to by the scene
+	//	then read by the temporal AA) and culls the passes whose results end up unused
+	// The compute passes are tagged as async so the graph moves them after the bandwidth-bound post-process when nothing they
+	//	write is read in between (each pass gets its own GPU profiler scope to compare with m_pRenderGraph->SetInterleaving( false ))
+	RenderGraph&			Graph = *m_pRenderGraph;
+	RenderGraph::Resource	Target = Graph.Import( "Target", m_RTTarget );
+	RenderGraph::Resource	DepthStencil = Graph.Import( "DepthStencil", m_Device.DefaultDepthStencil() );
+	RenderGraph::Resource	BackBuffer = Graph.Import( "BackBuffer", m_Device.DefaultRenderTarget(), true );
 
+	// 1] Render the scene
+	int	Pass = Graph.AddPass( "Scene", *this, PASS_SCENE );
+	Graph.Write( Pass, Target );
+	Graph.Write( Pass, DepthStencil );
+	Graph.SetHint( Pass, RenderGraph::HINT_ALU );
 
-	//////////////////////////////////////////////////////////////////////////
 	// 2] Render the lights
-	USING_MATERIAL_START( *m_pMatRenderLights )
-
-	m_pPrimSphere->RenderInstanced( M, 1 );	// Only show point light, no sun light
-
-	USING_MATERIAL_END
-
+	Pass = Graph.AddPass( "Lights", *this, PASS_LIGHTS );
+	Graph.Write( Pass, Target );
+	Graph.Write( Pass, DepthStencil );
 
-	//////////////////////////////////////////////////////////////////////////
 	// 3] Render the dynamic objects
-	if ( m_CachedCopy.DynamicObjectsCount > 0 )
+	if ( m_DynamicObjectsCount > 0 )
 	{
-		AnimateDynamicObjects += 0.05f * _DeltaTime;
-		float	t = abs( fmodf( AnimateDynamicObjects, 2.0f ) - 1.0f );
+		Pass = Graph.AddPass( "DynamicObjects", *this, PASS_DYNAMIC_OBJECTS );
+		Graph.Write( Pass, Target );
+		Graph.Write( Pass, DepthStencil );
+	}
 
-		USING_MATERIAL_START( *m_pMatRenderDynamic )
+	// 3.5] Reduce the opaque depth into the shared depth pyramid (kept since it's an output, other effects may read it this frame)
+	RenderGraph::Resource	Pyramid = Graph.Import( "DepthPyramid", gs_pDepthPyramid->GetTexture(), true );
+	Pass = Graph.AddPass( "DepthPyramid", *this, PASS_DEPTH_PYRAMID );
+	Graph.Read( Pass, DepthStencil );
+	Graph.ReadWrite( Pass, Pyramid );
+	Graph.SetHint( Pass, RenderGraph::HINT_ASYNC_COMPUTE );
 
-		m_pTexDynamicNormalMap->SetPS( 11 );
+	// 4] Render the debug probes
+	if ( m_CachedCopy.ShowDebugProbes != 0 )
+	{
+		Pass = Graph.AddPass( "DebugProbes", *this, PASS_DEBUG_PROBES );
+		Graph.Write( Pass, Target );
+		Graph.Write( Pass, DepthStencil );
+	}
 
-		for ( U32 DynamicObjectIndex=0; DynamicObjectIndex < m_CachedCopy.DynamicObjectsCount; DynamicObjectIndex++ )
-		{
-			DynamicObject&	DynObj = m_pDynamicObjects[DynamicObjectIndex];
+	// 5] Post-process the result
+#ifdef TEMPORAL_AA
+	RenderGraph::Resource	Velocity = Graph.Import( "Velocity", m_pTemporalAA->GetVelocity() );
+
+	Pass = Graph.AddPass( "CameraVelocity", *this, PASS_CAMERA_VELOCITY );
+	Graph.Read( Pass, DepthStencil );		// The compute shaders reconstruct the camera motion from the depth
+	Graph.ReadWrite( Pass, Velocity );
+	Graph.SetHint( Pass, RenderGraph::HINT_ASYNC_COMPUTE );
+	if ( m_DynamicObjectsCount > 0 )
+	{
+		Pass = Graph.AddPass( "ObjectsVelocity", *this, PASS_OBJECTS_VELOCITY );
+		Graph.Write( Pass, Velocity );
+		Graph.Write( Pass, DepthStencil );	// Depth-tested against the scene
+	}
+#endif
 
-			// Update object's position & probe ID to use for dynamic indirect lighting
-			m_pCB_DynamicObject->m.Position = DynObj.PositionStart + (DynObj.PositionEnd - DynObj.PositionStart) * t;
-			m_pCB_DynamicObject->m.ProbeID = m_ProbesNetwork.GetNearestProbe( m_pCB_DynamicObject->m.Position );
-			m_pCB_DynamicObject->UpdateData();
+	Pass = Graph.AddPass( "PostProcess", *this, PASS_POST_PROCESS );
+	Graph.Read( Pass, Target );
+#ifdef TEMPORAL_AA
+	Graph.Read( Pass, DepthStencil );
+	Graph.Read( Pass, Velocity );
+#endif
+	Graph.Write( Pass, BackBuffer );
+	Graph.SetHint( Pass, RenderGraph::HINT_BANDWIDTH );	// Full screen resolve & tone mapping
 
-			m_pPrimSphere->Render( M );
+	// 6] Render debug probe voronoï cell
+#if _DEBUG
+	if ( m_CachedCopy.ShowDebugProbeVoronoiCell )
+	{
+		Pass = Graph.AddPass( "DebugProbeVoronoi", *this, PASS_DEBUG_PROBE_VORONOI );
+		Graph.Write( Pass, BackBuffer );
+		Graph.Write( Pass, DepthStencil );
+	}
+#endif
+
+	Graph.Execute();
+}
+
+void	EffectGlobalIllum2::ExecutePass( RenderGraph& _Graph, U32 _PassID )
+{
+	switch ( _PassID )
+	{
+	//////////////////////////////////////////////////////////////////////////
+	// 1] Render the scene
+	case PASS_SCENE:
+#ifdef DEPTH_PREPASS
+		if ( m_OverdrawQueryIndex >= 0 )
+			m_Device.DXContext().Begin( m_ppQueriesOverdraw[m_OverdrawQueryIndex] );
+#endif
+#ifdef PARALLEL_RECORDING
+		m_pCLScene->Execute();	// Measured by the graph's "Scene" scope
+
+		// The immediate context got its own state back after execution so we need to set the scene's targets again for the next passes
+	 	m_Device.SetRenderTarget( m_RTTarget, &m_Device.DefaultDepthStencil() );
+		m_Device.SetStates( m_Device.m_pRS_CullBack, m_Device.m_pDS_ReadWriteLess, m_Device.m_pBS_Disabled );
+#else
+		RenderScene();
+#endif
+#ifdef DEPTH_PREPASS
+		if ( m_OverdrawQueryIndex >= 0 )
+		{
+			m_Device.DXContext().End( m_ppQueriesOverdraw[m_OverdrawQueryIndex] );
+			m_pQueriesOverdrawPending[m_OverdrawQueryIndex] = true;
+			m_pQueriesOverdrawFrameIndex[m_OverdrawQueryIndex] = m_Device.GetFrameIndex();
 		}
+#endif
+		break;
+
+
+	//////////////////////////////////////////////////////////////////////////
+	// 2] Render the lights
+	case PASS_LIGHTS:
+		USING_MATERIAL_START( *m_pMatRenderLights )
+
+		m_pPrimSphere->RenderInstanced( M, 1 );	// Only show point light, no sun light
 
 		USING_MATERIAL_END
-	}
+		break;
+
+
+	//////////////////////////////////////////////////////////////////////////
+	// 3] Render the dynamic objects
+	case PASS_DYNAMIC_OBJECTS:
+		USING_MATERIAL_START( *m_pMatRenderDynamic )
+
+		m_pTexDynamicNormalMap->SetPS( 11 );
+
+		// The vertex shader fetches its instance and blends the 4 probes of the tetrahedron containing it (cf. Inc/DynamicObjects.hlsl)
+		m_pSB_DynamicObjects->SetInput( 44 );
+		m_pPrimSphere->RenderInstanced( M, m_DynamicObjectsCount );
+
+		USING_MATERIAL_END
+		break;
+
+
+	//////////////////////////////////////////////////////////////////////////
+	// 3.5] Build the depth pyramid
+	case PASS_DEPTH_PYRAMID:
+		gs_pDepthPyramid->Build( m_Device.DefaultDepthStencil() );
+		gs_pDepthPyramid->Set();
+		break;
 
 
 	//////////////////////////////////////////////////////////////////////////
 	// 4] Render the debug probes
-	if ( m_CachedCopy.ShowDebugProbes != 0 )
-	{
+	case PASS_DEBUG_PROBES:
 		USING_MATERIAL_START( *m_pMatRenderDebugProbes )
 
 		m_pPrimSphere->RenderInstanced( M, m_ProbesNetwork.GetProbesCount() );
 
 		USING_MATERIAL_END
-	}
 
-// 	if ( m_CachedCopy.ShowDebugProbesNetwork != 0 )
-// 	{
-// 		USING_MATERIAL_START( *m_pMatRenderDebugProbesNetwork )
+// 		if ( m_CachedCopy.ShowDebugProbesNetwork != 0 )
+// 		{
+// 			USING_MATERIAL_START( *m_pMatRenderDebugProbesNetwork )
 // 
-// 		m_pPrimPoint->RenderInstanced( M, m_pSB_RuntimeProbeNetworkInfos->GetElementsCount() );
+// 			m_pPrimPoint->RenderInstanced( M, m_pSB_RuntimeProbeNetworkInfos->GetElementsCount() );
 // 
-// 		USING_MATERIAL_END
-// 	}
+// 			USING_MATERIAL_END
+// 		}
+		break;
 
 
 	//////////////////////////////////////////////////////////////////////////
 	// 5] Post-process the result
-	USING_MATERIAL_START( *m_pMatPostProcess )
+#ifdef TEMPORAL_AA
+	case PASS_CAMERA_VELOCITY: {
+		GPU_PROFILE_SCOPE( m_Device, "TemporalAA" );
+		m_pTemporalAA->ComputeCameraVelocity( m_Device.DefaultDepthStencil() );
+		break;
+	}
 
-	m_Device.SetStates( m_Device.m_pRS_CullNone, m_Device.m_pDS_Disabled, m_Device.m_pBS_Disabled );
-	m_Device.SetRenderTarget( m_Device.DefaultRenderTarget() );
+	case PASS_OBJECTS_VELOCITY: {
+		GPU_PROFILE_SCOPE( m_Device, "TemporalAA" );
 
-	m_RTTarget.SetPS( 10 );
+		// The dynamic objects' own motion over the camera motion
+		USING_MATERIAL_START( m_pTemporalAA->GetObjectVelocityMaterial() )
 
-	m_pCB_Splat->m.dUV = m_Device.DefaultRenderTarget().GetdUV();
-	m_pCB_Splat->UpdateData();
+		m_Device.SetStates( m_Device.m_pRS_CullBack, m_Device.m_pDS_ReadLessEqual, m_Device.m_pBS_Disabled );
+		m_Device.SetRenderTarget( m_pTemporalAA->GetVelocity(), &m_Device.DefaultDepthStencil() );
 
-	m_ScreenQuad.Render( M );
+		float4x4	Local2World, PreviousLocal2World;
+		for ( U32 DynamicObjectIndex=0; DynamicObjectIndex < m_DynamicObjectsCount; DynamicObjectIndex++ )
+		{
+			Local2World.PRS( m_pDynamicObjectPositions[DynamicObjectIndex], float4::QuatFromAngleAxis( 0.0f, float3::UnitY ), DYNAMIC_OBJECT_RADIUS * float3::One );
+			PreviousLocal2World.PRS( m_pDynamicObjectPreviousPositions[DynamicObjectIndex], float4::QuatFromAngleAxis( 0.0f, float3::UnitY ), DYNAMIC_OBJECT_RADIUS * float3::One );
+			m_pTemporalAA->SetObjectMotion( Local2World, PreviousLocal2World );
 
-	USING_MATERIAL_END
+			m_pPrimSphere->Render( M );
+		}
+
+		USING_MATERIAL_END
+		break;
+	}
+#endif
+
+	case PASS_POST_PROCESS: {
+#ifdef TEMPORAL_AA
+		{
+			GPU_PROFILE_SCOPE( m_Device, "TemporalAA" );
+			m_pTemporalAA->Resolve( m_RTTarget, m_Device.DefaultDepthStencil() );
+		}
+		Texture2D&	RTResolved = m_pTemporalAA->GetHistory();
+#else
+		Texture2D&	RTResolved = m_RTTarget;
+#endif
+
+#ifdef AUTO_EXPOSURE
+		GPU_PROFILE_SCOPE( m_Device, "ToneMapping" );
+		m_pToneMapper->Render( m_DeltaTime, RTResolved, m_Device.DefaultRenderTarget(), m_ScreenQuad );
+#else
+		USING_MATERIAL_START( *m_pMatPostProcess )
 
-	m_RTTarget.RemoveFromLastAssignedSlots();
+		GPU_PROFILE_SCOPE( m_Device, "PostProcess" );
 
+		m_Device.SetStates( m_Device.m_pRS_CullNone, m_Device.m_pDS_Disabled, m_Device.m_pBS_Disabled );
+		m_Device.SetRenderTarget( m_Device.DefaultRenderTarget() );
+
+		RTResolved.SetPS( 10 );
+
+		m_pCB_Splat->m.dUV = m_Device.DefaultRenderTarget().GetdUV();
+		m_pCB_Splat->UpdateData();
+
+		m_ScreenQuad.Render( M );
+
+		USING_MATERIAL_END
+
+	#ifdef TEMPORAL_AA
+		RTResolved.RemoveFromLastAssignedSlots();	// The history is owned by the temporal AA that writes it again next frame, the graph doesn't know about it
+	#endif
+#endif
+		break;
+	}
 
 	//////////////////////////////////////////////////////////////////////////
 	// 6] Render debug probe voronoï cell
 #if _DEBUG
-	if ( m_CachedCopy.ShowDebugProbeVoronoiCell ) {
+	case PASS_DEBUG_PROBE_VORONOI: {
 		USING_MATERIAL_START( *m_pMatRenderDebugProbeVoronoi )
 
 		m_Device.SetStates( m_Device.m_pRS_CullNone, m_Device.m_pDS_ReadLessEqual, m_Device.m_pBS_Additive );
@@ -989,15 +1777,293 @@ void	EffectGlobalIllum2::Render( float _Time, float _DeltaTime )
 		}
 
 		USING_MATERIAL_END
+		break;
+	}
+#endif
+
+	default:
+		ASSERT( false, "Unsupported pass!" );
+		break;
 	}
+}
+
+
+#ifdef CLUSTERED_LIGHTS
+//////////////////////////////////////////////////////////////////////////
+// Assigns the static & dynamic lights to the camera clusters (cf. GICullLightClusters.hlsl)
+// Each cluster gets a range of a compact list of light indices that the scene shader loops over
+//
+void	EffectGlobalIllum2::CullLightClusters()
+{
+	GPU_PROFILE_SCOPE( m_Device, "LightClusters" );
+
+	m_pCB_LightClusters->m.ZNearFar.Set( m_Camera.GetCB().Params.z, m_Camera.GetCB().Params.w );
+	m_pCB_LightClusters->m.InfluenceThreshold = POINT_LIGHT_INFLUENCE_THRESHOLD;
+	m_pCB_LightClusters->UpdateData();
+
+	U32	pZero[4] = { 0, 0, 0, 0 };
+	m_pSB_ClusterIndicesCounter->Clear( pZero );
+
+	USING_COMPUTESHADER_START( *m_pCSCullLightClusters )
+
+	m_pSB_ClusterRanges->SetOutput( 0 );
+	m_pSB_ClusterLightIndices->SetOutput( 1 );
+	m_pSB_ClusterIndicesCounter->SetOutput( 2 );
+
+	M.Dispatch( (LIGHT_CLUSTERS_X+3) >> 2, (LIGHT_CLUSTERS_Y+3) >> 2, (LIGHT_CLUSTERS_Z+3) >> 2 );
+
+	USING_COMPUTE_SHADER_END
+
+	// Feed the scene pass (inputs are automatically unassigned from the outputs)
+	m_pSB_ClusterRanges->SetInput( 27 );
+	m_pSB_ClusterLightIndices->SetInput( 28 );
+}
 #endif
+
+
+//////////////////////////////////////////////////////////////////////////
+// Projects the CIE overcast sky onto SH9 and convolves it with the cosine lobe (cf. GISkySH.hlsl)
+// The coefficients never leave the GPU: the buffer stays bound at t57 for the probe update & scene shaders (cf. Inc/SkySH.hlsl)
+//	and the kernel only runs again when the sky color or intensity changes
+//
+void	EffectGlobalIllum2::UpdateSkySH( const float3& _SkyColor )
+{
+	bool	bChanged = !m_bSkySHValid || (_SkyColor - m_SkySHColor).LengthSq() > 0.0f;
+	if ( bChanged && m_pCSSkySH->Use() )
+	{	// (otherwise the kernel is still compiling, try again next frame)
+		m_pCB_SkySH->m.SkyColor = _SkyColor;
+		m_pCB_SkySH->UpdateData();
+
+		m_pSB_SkySH->SetOutput( 0 );
+
+		m_pCSSkySH->Dispatch( 1, 1, 1 );
+
+		m_SkySHColor = _SkyColor;
+		m_bSkySHValid = true;
+	}
+
+	m_pSB_SkySH->SetInput( 57 );	// Inputs are automatically unassigned from the outputs
 }
 
 
+#ifdef SHADOW_ATLAS
+//////////////////////////////////////////////////////////////////////////
+// Allocates the slots of the shadow atlas to the most important lights (cf. Inc/ShadowAtlas.hlsl)
+// Lights are rated by the apparent radius of their influence sphere: the best ones keep their slot or evict the least recently
+//	used one, and the resolution of their faces follows their apparent size. A slot is only rendered again when its light moves
+//	or changes level so static lights are almost free once rendered.
+//
+void	EffectGlobalIllum2::PrepareShadowAtlas()
+{
+	m_ShadowAtlasFrameIndex++;
+
+	float3	CameraPosition = m_Camera.GetCB().Camera2World.GetRow( 3 );
+	float3	CameraAt = m_Camera.GetCB().Camera2World.GetRow( 2 );
+	float	PixelsPerUnit = 0.5f * m_RTTarget.GetHeight() / m_Camera.GetCB().Params.y;	// Screen pixels covered by a unit size at unit distance
+
+	// Select the most important lights, by decreasing importance
+	U32		StaticLightsCount = m_pCB_Scene->m.StaticLightsCount;
+	U32		LightsCount = StaticLightsCount + m_pCB_Scene->m.DynamicLightsCount;
+	U32		SelectedCount = 0;
+	U32		pSelectedLights[SHADOW_ATLAS_SLOTS_COUNT];
+	float	pSelectedImportances[SHADOW_ATLAS_SLOTS_COUNT];
+	float4	pSelectedSpheres[SHADOW_ATLAS_SLOTS_COUNT];
+	for ( U32 LightIndex=0; LightIndex < LightsCount; LightIndex++ )
+	{
+		m_pSB_ShadowAtlasLightSlots->m[LightIndex] = SHADOW_ATLAS_NO_SLOT;
+		if ( LightIndex == StaticLightsCount )
+			continue;	// The animated point light has its own cube map
+
+		const LightStruct&	Light = LightIndex < StaticLightsCount ? m_pSB_LightsStatic->m[LightIndex] : m_pSB_LightsDynamic->m[LightIndex-StaticLightsCount];
+		if ( Light.Type == Scene::Light::DIRECTIONAL )
+			continue;
+
+		// Same influence sphere as the light clusters
+		float	Intensity = MAX( MAX( Light.Color.x, Light.Color.y ), Light.Color.z );
+		float	Radius = sqrtf( Intensity / POINT_LIGHT_INFLUENCE_THRESHOLD );
+		float3	ToLight = Light.Position - CameraPosition;
+		if ( Radius <= 0.0f || (ToLight | CameraAt) < -Radius )
+			continue;	// Switched off or behind the camera
+
+		float	Importance = PixelsPerUnit * Radius / MAX( Radius, ToLight.Length() );
+
+		U32	InsertIndex = SelectedCount;
+		while ( InsertIndex > 0 && pSelectedImportances[InsertIndex-1] < Importance )
+			InsertIndex--;
+		if ( InsertIndex >= SHADOW_ATLAS_SLOTS_COUNT )
+			continue;	// Not important enough
+
+		U32	MovedCount = MIN( SelectedCount, U32(SHADOW_ATLAS_SLOTS_COUNT-1) ) - InsertIndex;
+		memmove( pSelectedLights + InsertIndex+1, pSelectedLights + InsertIndex, MovedCount * sizeof(U32) );
+		memmove( pSelectedImportances + InsertIndex+1, pSelectedImportances + InsertIndex, MovedCount * sizeof(float) );
+		memmove( pSelectedSpheres + InsertIndex+1, pSelectedSpheres + InsertIndex, MovedCount * sizeof(float4) );
+		pSelectedLights[InsertIndex] = LightIndex;
+		pSelectedImportances[InsertIndex] = Importance;
+		pSelectedSpheres[InsertIndex] = float4( Light.Position, Radius );
+		SelectedCount = MIN( SelectedCount+1, U32(SHADOW_ATLAS_SLOTS_COUNT) );
+	}
+
+	// Selected lights that already own a slot keep it
+	U32	pSelectedSlots[SHADOW_ATLAS_SLOTS_COUNT];
+	for ( U32 SelectedIndex=0; SelectedIndex < SelectedCount; SelectedIndex++ )
+	{
+		pSelectedSlots[SelectedIndex] = SHADOW_ATLAS_NO_SLOT;
+		for ( U32 SlotIndex=0; SlotIndex < SHADOW_ATLAS_SLOTS_COUNT; SlotIndex++ )
+			if ( m_pShadowAtlasSlots[SlotIndex].LightIndex == pSelectedLights[SelectedIndex] )
+			{
+				m_pShadowAtlasSlots[SlotIndex].LastUsedFrame = m_ShadowAtlasFrameIndex;
+				pSelectedSlots[SelectedIndex] = SlotIndex;
+				break;
+			}
+	}
+
+	// The others take the least recently used slots (there's always one that wasn't used this frame since we selected at most as many lights as there are slots)
+	for ( U32 SelectedIndex=0; SelectedIndex < SelectedCount; SelectedIndex++ )
+	{
+		if ( pSelectedSlots[SelectedIndex] != SHADOW_ATLAS_NO_SLOT )
+			continue;
+
+		U32	OldestSlotIndex = 0;
+		for ( U32 SlotIndex=1; SlotIndex < SHADOW_ATLAS_SLOTS_COUNT; SlotIndex++ )
+			if ( m_pShadowAtlasSlots[SlotIndex].LastUsedFrame < m_pShadowAtlasSlots[OldestSlotIndex].LastUsedFrame )
+				OldestSlotIndex = SlotIndex;
+
+		ShadowAtlasSlot&	Slot = m_pShadowAtlasSlots[OldestSlotIndex];
+		Slot.LightIndex = pSelectedLights[SelectedIndex];
+		Slot.LastUsedFrame = m_ShadowAtlasFrameIndex;
+		Slot.bRendered = false;
+		pSelectedSlots[SelectedIndex] = OldestSlotIndex;
+	}
+
+	// Schedule the most important out of date slots for rendering and build the lookup tables
+	float	PageUV = float(SHADOW_ATLAS_PAGE_SIZE) / SHADOW_ATLAS_SIZE;
+	m_ShadowAtlasRenderSlotsCount = 0;
+	for ( U32 SelectedIndex=0; SelectedIndex < SelectedCount; SelectedIndex++ )
+	{
+		U32					SlotIndex = pSelectedSlots[SelectedIndex];
+		ShadowAtlasSlot&	Slot = m_pShadowAtlasSlots[SlotIndex];
+
+		U32	Level = 0;
+		while ( Level < SHADOW_ATLAS_LEVELS_COUNT-1 && pSelectedImportances[SelectedIndex] < float(SHADOW_ATLAS_PAGE_SIZE >> (Level+1)) )
+			Level++;
+
+		bool	bOutOfDate = !Slot.bRendered || Slot.Level != Level || memcmp( &Slot.Light, &pSelectedSpheres[SelectedIndex], sizeof(float4) ) != 0;
+		if ( bOutOfDate && m_ShadowAtlasRenderSlotsCount < SHADOW_ATLAS_MAX_RENDERS_PER_FRAME )
+		{
+			Slot.Level = Level;
+			Slot.Light = pSelectedSpheres[SelectedIndex];
+			Slot.bRendered = true;	// Rendered before the scene pass is executed
+			m_pShadowAtlasRenderSlots[m_ShadowAtlasRenderSlotsCount++] = SlotIndex;
+		}
+		if ( !Slot.bRendered )
+			continue;	// Unshadowed until its turn comes (lights that moved keep using their previous render meanwhile)
+
+		m_pSB_ShadowAtlasLightSlots->m[Slot.LightIndex] = SlotIndex;
+
+		ShadowAtlasLight&	GPULight = m_pSB_ShadowAtlasLights->m[SlotIndex];
+		GPULight.Position.Set( Slot.Light.x, Slot.Light.y, Slot.Light.z );
+		GPULight.FarClipDistance = Slot.Light.w;
+		GPULight.UVOrigin.Set( 3 * (SlotIndex % SHADOW_ATLAS_SLOTS_X) * PageUV, 2 * (SlotIndex / SHADOW_ATLAS_SLOTS_X) * PageUV );
+		GPULight.UVFaceSize = float(SHADOW_ATLAS_PAGE_SIZE >> Slot.Level) / SHADOW_ATLAS_SIZE;
+		GPULight.__PAD = 0.0f;
+	}
+
+	m_pSB_ShadowAtlasLightSlots->Write( LightsCount );
+	m_pSB_ShadowAtlasLightSlots->SetInput( 30, true );
+	m_pSB_ShadowAtlasLights->Write();
+	m_pSB_ShadowAtlasLights->SetInput( 31, true );
+
+	// NOTE: When recording in parallel, the atlas is only read once the scene pass is executed, after RenderShadowAtlas()
+	m_pRTShadowAtlas->Set( 29, true );
+}
+
+// Renders the slots scheduled by PrepareShadowAtlas(), the 6 faces of a light are rendered at once through 6 viewports
+void	EffectGlobalIllum2::RenderShadowAtlas()
+{
+	if ( m_ShadowAtlasRenderSlotsCount == 0 )
+		return;
+
+	GPU_PROFILE_SCOPE( m_Device, "ShadowAtlas" );
+
+#ifdef PARALLEL_RECORDING
+	CB<CBObject>&	CBObject = *m_pCB_ObjectShadowMapPoint;	// Safe to reuse now that the point light's pass was executed
+#else
+	CB<CBObject>&	CBObject = *m_pCB_Object;
+#endif
+
+	m_pRTShadowAtlas->RemoveFromLastAssignedSlots();
+
+	for ( U32 RenderIndex=0; RenderIndex < m_ShadowAtlasRenderSlotsCount; RenderIndex++ )
+	{
+		U32						SlotIndex = m_pShadowAtlasRenderSlots[RenderIndex];
+		const ShadowAtlasSlot&	Slot = m_pShadowAtlasSlots[SlotIndex];
+		float					X = float(3 * SHADOW_ATLAS_PAGE_SIZE * (SlotIndex % SHADOW_ATLAS_SLOTS_X));
+		float					Y = float(2 * SHADOW_ATLAS_PAGE_SIZE * (SlotIndex / SHADOW_ATLAS_SLOTS_X));
+
+		// Reset the slot to the far plane (we can't clear only a part of the depth view)
+		{
+			D3D11_VIEWPORT	SlotViewport = { X, Y, float(3 * SHADOW_ATLAS_PAGE_SIZE), float(2 * SHADOW_ATLAS_PAGE_SIZE), 0.0f, 1.0f };
+
+			USING_MATERIAL_START( *m_pMatClearShadowAtlas )
+
+			m_Device.SetStates( m_Device.m_pRS_CullNone, m_Device.m_pDS_ReadWriteGreater, m_Device.m_pBS_Disabled );
+			m_Device.SetRenderTargets( SHADOW_ATLAS_SIZE, SHADOW_ATLAS_SIZE, 0, NULL, m_pRTShadowAtlas->GetDSV(), &SlotViewport );
+			m_ScreenQuad.Render( M );
+
+			USING_MATERIAL_END
+		}
+
+		// Render the faces, each one in the top-left corner of its page
+		float			FaceSize = float(SHADOW_ATLAS_PAGE_SIZE >> Slot.Level);
+		D3D11_VIEWPORT	pFaceViewports[6];
+		for ( U32 FaceIndex=0; FaceIndex < 6; FaceIndex++ )
+		{
+			D3D11_VIEWPORT&	Viewport = pFaceViewports[FaceIndex];
+			Viewport.TopLeftX = X + float(SHADOW_ATLAS_PAGE_SIZE * (FaceIndex % 3));
+			Viewport.TopLeftY = Y + float(SHADOW_ATLAS_PAGE_SIZE * (FaceIndex / 3));
+			Viewport.Width = FaceSize;
+			Viewport.Height = FaceSize;
+			Viewport.MinDepth = 0.0f;
+			Viewport.MaxDepth = 1.0f;
+		}
+
+		m_pCB_ShadowAtlas->m.Position.Set( Slot.Light.x, Slot.Light.y, Slot.Light.z );
+		m_pCB_ShadowAtlas->m.FarClipDistance = Slot.Light.w;
+		m_pCB_ShadowAtlas->UpdateData();
+
+		USING_MATERIAL_START( *m_pMatRenderShadowAtlas )
+
+		m_Device.SetStates( m_Device.m_pRS_CullNone, m_Device.m_pDS_ReadWriteLess, m_Device.m_pBS_Disabled );
+		m_Device.SetRenderTargets( SHADOW_ATLAS_SIZE, SHADOW_ATLAS_SIZE, 0, NULL, m_pRTShadowAtlas->GetDSV(), pFaceViewports, 6 );
+
+		m_MeshesCuller.Cull( m_pCB_ShadowAtlas->m.Position, m_pCB_ShadowAtlas->m.FarClipDistance, m_pVisibleMeshesShadowAtlas );
+
+		LODView	View;
+		View.Position = m_pCB_ShadowAtlas->m.Position;
+		View.PixelsPerUnit = 0.5f * FaceSize;
+		View.bOrthographic = false;
+
+#ifdef INSTANCED_SHADOW_MAPS
+		RenderInstanceGroups( m_pVisibleMeshesShadowAtlas, M, CBObject, View );
+#else
+		for ( int MeshIndex=0; MeshIndex < m_Scene.m_MeshesCount; MeshIndex++ )
+			if ( m_pVisibleMeshesShadowAtlas[MeshIndex] )
+				RenderMesh( *m_ppCachedMeshes[MeshIndex], &M, false, CBObject, &View );
+#endif
+
+		USING_MATERIAL_END
+	}
+
+	m_Device.RemoveRenderTargets();
+	m_pRTShadowAtlas->Set( 29, true );
+}
+#endif
+
+
 //////////////////////////////////////////////////////////////////////////
 // Computes the shadow map infos and render the shadow map itself
 //
-void	EffectGlobalIllum2::RenderShadowMap( const float3& _SunDirection )
+void	EffectGlobalIllum2::PrepareShadowMap( const float3& _SunDirection )
 {
 	//////////////////////////////////////////////////////////////////////////
 	// Build a nice transform
@@ -1010,6 +2076,9 @@ void	EffectGlobalIllum2::RenderShadowMap( const float3& _SunDirection )
 	m_pCB_ShadowMap->m.Light2World.SetRow( 3, float3::Zero, 1 );	// Temporary
 
 	m_pCB_ShadowMap->m.World2Light = m_pCB_ShadowMap->m.Light2World.Inverse();
+#ifdef SUN_SHADOW_CASCADES
+	float4x4	Light2WorldRotation = m_pCB_ShadowMap->m.Light2World;
+#endif
 
 	// Find appropriate bounds
 	float3		BBoxMin = float3::MaxFlt;
@@ -1053,6 +2122,16 @@ void	EffectGlobalIllum2::RenderShadowMap( const float3& _SunDirection )
 
 	m_pCB_ShadowMap->UpdateData();
 
+#ifdef CACHED_SHADOW_MAPS
+	// The static scene only needs to be rendered again if the light moved
+	m_bShadowMapStaticDirty = memcmp( &m_ShadowMapStaticWorld2Light, &m_pCB_ShadowMap->m.World2Light, sizeof(float4x4) ) != 0;
+	m_ShadowMapStaticWorld2Light = m_pCB_ShadowMap->m.World2Light;
+#endif
+
+#ifdef SUN_SHADOW_CASCADES
+	PrepareSunShadowCascades( _SunDirection, Light2WorldRotation, BBoxMin, BBoxMax );
+#endif
+
 
 
 //CHECK => All corners should be in [(-1,-1,0),(+1,+1,1)]
@@ -1082,53 +2161,328 @@ void	EffectGlobalIllum2::RenderShadowMap( const float3& _SunDirection )
 // }
 //CHECK
 
+	// Unbind the shadow map so we can render into it
+	m_pRTShadowMap->RemoveFromLastAssignedSlots();
+#ifdef SUN_SHADOW_CASCADES
+	m_pRTSunShadowCascades->RemoveFromLastAssignedSlots();
+#endif
+}
 
-	//////////////////////////////////////////////////////////////////////////
-	// Perform actual rendering
+void	EffectGlobalIllum2::RenderShadowMap()
+{
+	GPU_PROFILE_SCOPE( m_Device, "ShadowMap" );
+
+#ifdef PARALLEL_RECORDING
+	CB<CBObject>&	CBObject = *m_pCB_ObjectShadowMap;
+#else
+	CB<CBObject>&	CBObject = *m_pCB_Object;
+#endif
+
+#ifdef SUN_SHADOW_CASCADES
+	RenderSunShadowCascades( CBObject );
+	if ( !m_bSunShadowMapUpdate )
+		return;	// The whole scene shadow map keeps last frames' render
+#endif
+
+#ifdef CACHED_SHADOW_MAPS
+	if ( m_bShadowMapStaticDirty )
+		RenderShadowMapStatic( *m_pRTShadowMapStatic, CBObject );
+
+	m_pRTShadowMap->CopyFrom( *m_pRTShadowMapStatic );
+	RenderShadowMapDynamicObjects( *m_pMatRenderShadowMapDynamic, *m_pRTShadowMap, CBObject );
+#else
+	RenderShadowMapStatic( *m_pRTShadowMap, CBObject );
+#endif
+}
+
+// Renders the scene meshes into the directional shadow map
+void	EffectGlobalIllum2::RenderShadowMapStatic( Texture2D& _Target, CB<CBObject>& _CBObject )
+{
 	USING_MATERIAL_START( *m_pMatRenderShadowMap )
 
 	m_Device.SetStates( m_Device.m_pRS_CullNone, m_Device.m_pDS_ReadWriteLess, m_Device.m_pBS_Disabled );
 
-	m_pRTShadowMap->RemoveFromLastAssignedSlots();
-	m_Device.ClearDepthStencil( *m_pRTShadowMap, 1.0f, 0, true, false );
-	m_Device.SetRenderTargets( m_pRTShadowMap->GetWidth(), m_pRTShadowMap->GetHeight(), 0, NULL, m_pRTShadowMap->GetDSV() );
+	m_Device.ClearDepthStencil( _Target, 1.0f, 0, true, false );
+	m_Device.SetRenderTargets( _Target.GetWidth(), _Target.GetHeight(), 0, NULL, _Target.GetDSV() );
+
+	// World2Light maps the shadow's bounds to [(-1,-1,0),(+1,+1,1)] like a projection
+	m_MeshesCuller.Cull( m_pCB_ShadowMap->m.World2Light, m_pVisibleMeshesShadowMap );
 
+	// The shadow map covers twice the length of Light2World's X axis
+	float3	LightX = m_pCB_ShadowMap->m.Light2World.GetRow( 0 );
+	LODView	View;
+	View.Position = float3::Zero;
+	View.PixelsPerUnit = SHADOW_MAP_SIZE / MAX( 1e-6f, 2.0f * LightX.Length() );
+	View.bOrthographic = true;
+
+#ifdef INSTANCED_SHADOW_MAPS
+	RenderInstanceGroups( m_pVisibleMeshesShadowMap, M, _CBObject, View );
+#else
 	for ( int MeshIndex=0; MeshIndex < m_Scene.m_MeshesCount; MeshIndex++ )
-		RenderMesh( *m_ppCachedMeshes[MeshIndex], &M, false );
+		if ( m_pVisibleMeshesShadowMap[MeshIndex] )
+			RenderMesh( *m_ppCachedMeshes[MeshIndex], &M, false, _CBObject, &View );
+#endif
 
 	USING_MATERIAL_END
 
-	// Assign the shadow map to shaders
 	m_Device.RemoveRenderTargets();
-	m_pRTShadowMap->Set( 2, true );
 }
 
-void	EffectGlobalIllum2::RenderShadowMapPoint( const float3& _Position, float _FarClipDistance )
+void	EffectGlobalIllum2::PrepareShadowMapPoint( const float3& _Position, float _FarClipDistance )
 {
 	m_pCB_ShadowMapPoint->m.Position = _Position;
 	m_pCB_ShadowMapPoint->m.FarClipDistance = _FarClipDistance;
 	m_pCB_ShadowMapPoint->UpdateData();
 
-	//////////////////////////////////////////////////////////////////////////
-	// Perform actual rendering
+#ifdef CULLED_POINT_SHADOW_FACES
+	// The views are only used to cull the meshes against each face, the shader still projects with cbShadowMapPoint
+	//	(we never upload cbMultiView, whose slot is used by cbGeneral)
+	m_pShadowMapPointViews->SetCubeMap( _Position, 1e-3f * _FarClipDistance, _FarClipDistance );
+#endif
+
+#ifdef CACHED_SHADOW_MAPS
+	float4	Light( _Position, _FarClipDistance );
+	m_bShadowMapPointStaticDirty = memcmp( &m_ShadowMapPointStaticLight, &Light, sizeof(float4) ) != 0;
+	m_ShadowMapPointStaticLight = Light;
+#endif
+
+	// Unbind the shadow map so we can render into it
+	m_pRTShadowMapPoint->RemoveFromLastAssignedSlots();
+}
+
+void	EffectGlobalIllum2::RenderShadowMapPoint()
+{
+	GPU_PROFILE_SCOPE( m_Device, "ShadowMapPoint" );
+
+#ifdef PARALLEL_RECORDING
+	CB<CBObject>&	CBObject = *m_pCB_ObjectShadowMapPoint;
+#else
+	CB<CBObject>&	CBObject = *m_pCB_Object;
+#endif
+
+#ifdef CACHED_SHADOW_MAPS
+	if ( m_bShadowMapPointStaticDirty )
+		RenderShadowMapPointStatic( *m_pRTShadowMapPointStatic, CBObject );
+
+	m_pRTShadowMapPoint->CopyFrom( *m_pRTShadowMapPointStatic );
+	RenderShadowMapDynamicObjects( *m_pMatRenderShadowMapPointDynamic, *m_pRTShadowMapPoint, CBObject );
+#else
+	RenderShadowMapPointStatic( *m_pRTShadowMapPoint, CBObject );
+#endif
+}
+
+// Renders the scene meshes into the point light's cube shadow map
+// With CULLED_POINT_SHADOW_FACES, the meshes are only drawn into the faces they overlap (the instance groups are then ignored
+//	since the instance ID already selects the face)
+void	EffectGlobalIllum2::RenderShadowMapPointStatic( Texture2D& _Target, CB<CBObject>& _CBObject )
+{
 	USING_MATERIAL_START( *m_pMatRenderShadowMapPoint )
 
 	m_Device.SetStates( m_Device.m_pRS_CullNone, m_Device.m_pDS_ReadWriteLess, m_Device.m_pBS_Disabled );
 
-	m_pRTShadowMapPoint->RemoveFromLastAssignedSlots();
-	m_Device.ClearDepthStencil( *m_pRTShadowMapPoint, 1.0f, 0, true, false );
-	m_Device.SetRenderTargets( m_pRTShadowMapPoint->GetWidth(), m_pRTShadowMapPoint->GetHeight(), 0, NULL, m_pRTShadowMapPoint->GetDSV() );
+	m_Device.ClearDepthStencil( _Target, 1.0f, 0, true, false );
+
+	// Each cube face has a 90 field of view
+	LODView	View;
+	View.Position = m_pCB_ShadowMapPoint->m.Position;
+	View.PixelsPerUnit = 0.5f * SHADOW_MAP_POINT_SIZE;
+	View.bOrthographic = false;
+
+#ifdef CULLED_POINT_SHADOW_FACES
+	// Find the faces overlapped by each mesh, most meshes only touch 1 or 2 of them
+	m_pShadowMapPointViews->Cull( m_MeshesCuller, m_pVisibleMeshesShadowMapPoint );
+
+	if ( m_Device.SupportsVSRenderTargetArrayIndex() )
+	{	// Draw each mesh once, instanced for each of its faces: the VS routes each instance to its slice
+		m_Device.SetRenderTargets( _Target.GetWidth(), _Target.GetHeight(), 0, NULL, _Target.GetDSV() );
+		for ( int MeshIndex=0; MeshIndex < m_Scene.m_MeshesCount; MeshIndex++ )
+		{
+			U8	FacesMask = m_pVisibleMeshesShadowMapPoint[MeshIndex];
+			if ( FacesMask == 0 )
+				continue;
+
+			m_pShadowMapPointViews->SetObjectMask( FacesMask );
+			RenderMesh( *m_ppCachedMeshes[MeshIndex], &M, false, _CBObject, &View, MultiView::GetInstancesCount( FacesMask ) );
+		}
+	}
+	else
+	{	// Draw the meshes overlapping each face into its slice, a single instance always gets the face of the object mask
+		for ( int FaceIndex=0; FaceIndex < 6; FaceIndex++ )
+		{
+			U8	FaceBit = U8( 1 << FaceIndex );
+			m_Device.SetRenderTargets( _Target.GetWidth(), _Target.GetHeight(), 0, NULL, _Target.GetDSV( FaceIndex, 1 ) );
+			m_pShadowMapPointViews->SetObjectMask( FaceBit );
+			for ( int MeshIndex=0; MeshIndex < m_Scene.m_MeshesCount; MeshIndex++ )
+				if ( m_pVisibleMeshesShadowMapPoint[MeshIndex] & FaceBit )
+					RenderMesh( *m_ppCachedMeshes[MeshIndex], &M, false, _CBObject, &View );
+		}
+	}
+#else
+	m_Device.SetRenderTargets( _Target.GetWidth(), _Target.GetHeight(), 0, NULL, _Target.GetDSV() );
+
+	// Only meshes within the light's range can cast shadows in the cube map
+	m_MeshesCuller.Cull( m_pCB_ShadowMapPoint->m.Position, m_pCB_ShadowMapPoint->m.FarClipDistance, m_pVisibleMeshesShadowMapPoint );
 
+#ifdef INSTANCED_SHADOW_MAPS
+	RenderInstanceGroups( m_pVisibleMeshesShadowMapPoint, M, _CBObject, View );
+#else
 	for ( int MeshIndex=0; MeshIndex < m_Scene.m_MeshesCount; MeshIndex++ )
-		RenderMesh( *m_ppCachedMeshes[MeshIndex], &M, false );
+		if ( m_pVisibleMeshesShadowMapPoint[MeshIndex] )
+			RenderMesh( *m_ppCachedMeshes[MeshIndex], &M, false, _CBObject, &View );
+#endif
+#endif
 
 	USING_MATERIAL_END
 
-	// Assign the shadow map to shaders
 	m_Device.RemoveRenderTargets();
-	m_pRTShadowMapPoint->Set( 3, true );
 }
 
+#ifdef CACHED_SHADOW_MAPS
+// Draws the dynamic objects over a shadow map that already contains the static scene
+// They're all drawn with a single instanced call, the ones out of the point light's range are clipped by its GS
+void	EffectGlobalIllum2::RenderShadowMapDynamicObjects( Shader& _Material, Texture2D& _Target, CB<CBObject>& _CBObject, int _SliceIndex )
+{
+	if ( m_DynamicObjectsCount == 0 )
+		return;
+
+	USING_MATERIAL_START( _Material )
+
+	m_Device.SetStates( m_Device.m_pRS_CullNone, m_Device.m_pDS_ReadWriteLess, m_Device.m_pBS_Disabled );
+	m_Device.SetRenderTargets( _Target.GetWidth(), _Target.GetHeight(), 0, NULL, _SliceIndex < 0 ? _Target.GetDSV() : _Target.GetDSV( _SliceIndex, 1 ) );
+
+	m_pSB_DynamicObjectTransforms->SetInput( 26 );
+	_CBObject.m.InstancesStart = 0;
+	_CBObject.UpdateData();
+
+	m_pPrimSphere->RenderInstanced( M, m_DynamicObjectsCount );
+
+	USING_MATERIAL_END
+
+	m_Device.RemoveRenderTargets();
+}
+#endif
+
+#ifdef SUN_SHADOW_CASCADES
+//////////////////////////////////////////////////////////////////////////
+// Fits the cascades to the camera frustum and decides which ones get rendered this frame (cf. Inc/SunShadowCascades.hlsl)
+// Each cascade covers the bounding sphere of its slice of the frustum so its size doesn't change when the camera rotates, and its
+//	center is snapped to whole texels in light space so the shadow edges don't shimmer when the camera moves.
+// Cascades 0 & 1 are updated every frame, cascade 2 every 2nd frame and cascade 3 every 4th frame, together with the whole scene
+//	shadow map on another frame so at most 3 maps are rendered each frame. Everything is updated when the sun moves.
+//
+void	EffectGlobalIllum2::PrepareSunShadowCascades( const float3& _SunDirection, const float4x4& _Light2World, const float3& _BBoxMin, const float3& _BBoxMax )
+{
+	bool	bSunMoved = (_SunDirection - m_SunShadowCascadesSunDirection).LengthSq() > 0.0f;
+	m_SunShadowCascadesSunDirection = _SunDirection;
+
+	U32	FrameIndex = m_SunShadowCascadesFrameIndex++;
+	m_bSunShadowMapUpdate = bSunMoved || (FrameIndex & 3) == 3;
+
+	// Split the frustum with the "practical" scheme (blend of logarithmic & uniform splits)
+	const float4&	CameraParams = m_Camera.GetCB().Params;
+	float			Near = CameraParams.z;
+	float			Far = MIN( CameraParams.w, SUN_SHADOW_CASCADES_MAX_DISTANCE );
+	float			SqTanDiagonal = CameraParams.x*CameraParams.x + CameraParams.y*CameraParams.y;
+
+	float3			CameraPosition = m_Camera.GetCB().Camera2World.GetRow( 3 );
+	float3			CameraAt = m_Camera.GetCB().Camera2World.GetRow( 2 );
+	float4x4		World2LightRotation = _Light2World.Inverse();
+	float			DepthRange = _BBoxMax.z - _BBoxMin.z;
+
+	m_SunShadowCascadesRenderMask = 0;
+	float	SliceNear = Near;
+	for ( U32 CascadeIndex=0; CascadeIndex < SUN_SHADOW_CASCADES_COUNT; CascadeIndex++ )
+	{
+		float	t = float(CascadeIndex+1) / SUN_SHADOW_CASCADES_COUNT;
+		float	SliceFar = SUN_SHADOW_CASCADES_SPLIT_LAMBDA * Near * powf( Far / Near, t ) + (1.0f - SUN_SHADOW_CASCADES_SPLIT_LAMBDA) * (Near + (Far - Near) * t);
+
+		U32		Period = 1U << MAX( 0, int(CascadeIndex)-1 );
+		if ( bSunMoved || ((FrameIndex + CascadeIndex) % Period) == 0 )
+		{
+			m_SunShadowCascadesRenderMask |= 1U << CascadeIndex;
+
+			// Bounding sphere of the slice, centered on the view axis
+			float	SphereDistance = MIN( 0.5f * (SliceNear + SliceFar) * (1.0f + SqTanDiagonal), SliceFar );
+			float	Radius = sqrtf( (SliceFar - SphereDistance) * (SliceFar - SphereDistance) + SliceFar * SliceFar * SqTanDiagonal );
+					Radius = ceilf( 16.0f * Radius ) / 16.0f;	// Avoid numerical noise on the size
+
+			// Snap the center to whole texels in light space
+			float	TexelSize = 2.0f * Radius / SUN_SHADOW_CASCADE_SIZE;
+			float3	Center = float4( CameraPosition + SphereDistance * CameraAt, 1.0f ) * World2LightRotation;
+			Center.x = TexelSize * floorf( Center.x / TexelSize );
+			Center.y = TexelSize * floorf( Center.y / TexelSize );
+			Center.z = _BBoxMin.z;	// The cascade covers the whole depth of the scene so all the casters between the sun & the slice are included
+			float3	CenterWorld = float4( Center, 1.0f ) * _Light2World;
+
+			float4x4&	Light2World = m_pSunShadowCascadesLight2World[CascadeIndex];
+			Light2World = _Light2World;
+			Light2World.SetRow( 3, CenterWorld, 1 );
+			Light2World.Scale( float3( Radius, Radius, DepthRange ) );
+
+			m_pCB_SunShadowCascades->m.World2Cascade[CascadeIndex] = Light2World.Inverse();
+			m_pCB_SunShadowCascades->m.Bias[CascadeIndex] = SUN_SHADOW_CASCADES_BIAS_TEXELS * TexelSize / MAX( 1e-6f, DepthRange );
+		}
+
+		SliceNear = SliceFar;
+	}
+
+	m_pCB_SunShadowCascades->UpdateData();
+}
+
+// Renders the scene meshes and the dynamic objects into the cascades scheduled for this frame
+void	EffectGlobalIllum2::RenderSunShadowCascades( CB<CBObject>& _CBObject )
+{
+	for ( U32 CascadeIndex=0; CascadeIndex < SUN_SHADOW_CASCADES_COUNT; CascadeIndex++ )
+	{
+		if ( (m_SunShadowCascadesRenderMask & (1U << CascadeIndex)) == 0 )
+			continue;	// The cascade keeps the render it was last given
+
+		// The shadow shader reads World2Light from the shadow map constants
+		m_pCB_SunShadowCascadeRender->m.Light2World = m_pSunShadowCascadesLight2World[CascadeIndex];
+		m_pCB_SunShadowCascadeRender->m.World2Light = m_pCB_SunShadowCascades->m.World2Cascade[CascadeIndex];
+		m_pCB_SunShadowCascadeRender->m.BoundsMin = m_pCB_ShadowMap->m.BoundsMin;
+		m_pCB_SunShadowCascadeRender->m.BoundsMax = m_pCB_ShadowMap->m.BoundsMax;
+		m_pCB_SunShadowCascadeRender->UpdateData();
+
+		ID3D11DepthStencilView*	pDSV = m_pRTSunShadowCascades->GetDSV( CascadeIndex, 1 );
+
+		{	USING_MATERIAL_START( *m_pMatRenderShadowMap )
+
+			m_Device.SetStates( m_Device.m_pRS_CullNone, m_Device.m_pDS_ReadWriteLess, m_Device.m_pBS_Disabled );
+
+			m_Device.ClearDepthStencil( *pDSV, 1.0f, 0, true, false );
+			m_Device.SetRenderTargets( SUN_SHADOW_CASCADE_SIZE, SUN_SHADOW_CASCADE_SIZE, 0, NULL, pDSV );
+
+			// Only the meshes within the cascade's volume
+			m_MeshesCuller.Cull( m_pCB_SunShadowCascadeRender->m.World2Light, m_pVisibleMeshesShadowMap );
+
+			float3	LightX = m_pCB_SunShadowCascadeRender->m.Light2World.GetRow( 0 );
+			LODView	View;
+			View.Position = float3::Zero;
+			View.PixelsPerUnit = SUN_SHADOW_CASCADE_SIZE / MAX( 1e-6f, 2.0f * LightX.Length() );
+			View.bOrthographic = true;
+
+#ifdef INSTANCED_SHADOW_MAPS
+			RenderInstanceGroups( m_pVisibleMeshesShadowMap, M, _CBObject, View );
+#else
+			for ( int MeshIndex=0; MeshIndex < m_Scene.m_MeshesCount; MeshIndex++ )
+				if ( m_pVisibleMeshesShadowMap[MeshIndex] )
+					RenderMesh( *m_ppCachedMeshes[MeshIndex], &M, false, _CBObject, &View );
+#endif
+
+			USING_MATERIAL_END
+		}
+
+#ifdef CACHED_SHADOW_MAPS
+		RenderShadowMapDynamicObjects( *m_pMatRenderShadowMapDynamic, *m_pRTSunShadowCascades, _CBObject, CascadeIndex );
+#endif
+	}
+
+	m_Device.RemoveRenderTargets();
+	m_pCB_ShadowMap->Set( 2 );	// Back to the whole scene shadow map
+}
+#endif
+
 #pragma region Scene Tagging
 
 //////////////////////////////////////////////////////////////////////////
@@ -1192,6 +2546,14 @@ void*	EffectGlobalIllum2::TagNode( const Scene& _Owner, Scene::Node& _Node ) {
 	return NULL;
 }
 
+#ifdef PACKED_SCENE_VERTICES
+// Bounds the positions of a primitive are quantized in when packing its vertices
+static void	GetQuantizationBounds( const Scene::Mesh::Primitive& _Primitive, float3& _Min, float3& _Size ) {
+	_Min = _Primitive.m_LocalBBoxMin;
+	_Size = (_Primitive.m_LocalBBoxMax - _Primitive.m_LocalBBoxMin).Max( 1e-6f * float3::One );
+}
+#endif
+
 // Each scene mesh's primitive will require a tag at creation & destruction time: we create an actual runtime rendering primitive
 void*	EffectGlobalIllum2::TagPrimitive( const Scene& _Owner, Scene::Mesh& _Mesh, Scene::Mesh::Primitive& _Primitive )
 {
@@ -1210,12 +2572,92 @@ void*	EffectGlobalIllum2::TagPrimitive( const Scene& _Owner, Scene::Mesh& _Mesh,
 	}
 	ASSERT( pVertexFormat != NULL, "Unsupported vertex format!" );
 
-	Primitive*	pPrim = new Primitive( m_Device, _Primitive.m_VerticesCount, _Primitive.m_pVertices, 3*_Primitive.m_FacesCount, _Primitive.m_pFaces, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST, *pVertexFormat );
+	// The index buffer holds all the LODs one after another (cf. RenderPrimitive())
+	const void*	pIndices = _Primitive.m_pLODFaces != NULL ? _Primitive.m_pLODFaces : _Primitive.m_pFaces;
+	int			IndicesCount = 3 * (_Primitive.m_pLODFacesStart[_Primitive.m_LODsCount-1] + _Primitive.m_pLODFacesCount[_Primitive.m_LODsCount-1]);
+
+#ifdef POOLED_SCENE_GEOMETRY
+	Primitive*	pReloadedPrim = NULL;
+#ifdef SCENE_HOT_RELOAD
+	// A reloaded primitive is rewritten in place (cf. HotReloadScene()), drop the coarsest LODs that don't fit in its indices anymore
+	pReloadedPrim = (Primitive*) _Primitive.m_pTag;
+	while ( pReloadedPrim != NULL && IndicesCount > pReloadedPrim->GetIndicesCount() && _Primitive.m_LODsCount > 1 ) {
+		_Primitive.m_LODsCount--;
+		IndicesCount = 3 * (_Primitive.m_pLODFacesStart[_Primitive.m_LODsCount-1] + _Primitive.m_pLODFacesCount[_Primitive.m_LODsCount-1]);
+	}
+#endif
+#endif
+
+#ifdef PACKED_SCENE_VERTICES
+	// Quantize the vertices within the primitive's bounding box (cf. RenderMesh() that provides the bounds to the shaders)
+	ASSERT( _Primitive.m_VertexFormat == Scene::Mesh::Primitive::P3N3G3B3T2, "Only the P3N3G3B3T2 format can be packed!" );
+	pVertexFormat = &VertexFormatPackedP3N3G3B3T2::DESCRIPTOR;
+
+	float3	QuantizationMin, QuantizationSize;
+	GetQuantizationBounds( _Primitive, QuantizationMin, QuantizationSize );
+	float3	InvQuantizationSize( 1.0f / QuantizationSize.x, 1.0f / QuantizationSize.y, 1.0f / QuantizationSize.z );
+
+	U8*		pPackedVertices = new U8[_Primitive.m_VerticesCount * pVertexFormat->Size()];
+	const Scene::Mesh::Primitive::VF_P3N3G3B3T2*	pSourceVertex = (const Scene::Mesh::Primitive::VF_P3N3G3B3T2*) _Primitive.m_pVertices;
+	for ( U32 VertexIndex=0; VertexIndex < _Primitive.m_VerticesCount; VertexIndex++, pSourceVertex++ ) {
+		float3	NormalizedPosition = (pSourceVertex->P - QuantizationMin) * InvQuantizationSize;
+		pVertexFormat->Write( pPackedVertices + VertexIndex * pVertexFormat->Size(), NormalizedPosition, pSourceVertex->N, pSourceVertex->G, pSourceVertex->B, pSourceVertex->T );
+	}
+	const void*	pVertices = pPackedVertices;
+#else
+	const void*	pVertices = _Primitive.m_pVertices;
+#endif
+
+#ifdef POOLED_SCENE_GEOMETRY
+	// Primitives are allocated in tag order so each one's base vertex is also its offset in the probe ID vertex stream
+	ASSERT( &m_pScenePool->GetFormat() == pVertexFormat, "Scene pool has the wrong vertex format!" );
+	Primitive*	pPrim = pReloadedPrim;
+	if ( pPrim != NULL )
+		pPrim->Rewrite( *m_pScenePool, pVertices, IndicesCount, pIndices, _Primitive.m_IndexFormat );
+	else
+		pPrim = new Primitive( *m_pScenePool, _Primitive.m_VerticesCount, pVertices, IndicesCount, pIndices, _Primitive.m_IndexFormat, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST );
+	ASSERT( U32(pPrim->GetBaseVertex()) == m_TotalVerticesCount, "Scene primitives were not allocated in tag order!" );
+#else
+#ifdef SCENE_HOT_RELOAD
+	delete (Primitive*) _Primitive.m_pTag;	// A reloaded primitive is simply created again
+#endif
+	Primitive*	pPrim = new Primitive( m_Device, _Primitive.m_VerticesCount, pVertices, IndicesCount, pIndices, _Primitive.m_IndexFormat, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST, *pVertexFormat );
+#endif
+
+#ifdef DEPTH_VERTEX_STREAMS
+	// Copy the positions into their own stream for the depth-only materials
+	const IVertexFormatDescriptor&	DepthFormat = GetSceneDepthVertexFormat();
+	U8*		pDepthVertices = new U8[_Primitive.m_VerticesCount * DepthFormat.Size()];
+	const Scene::Mesh::Primitive::VF_P3N3G3B3T2*	pDepthSourceVertex = (const Scene::Mesh::Primitive::VF_P3N3G3B3T2*) _Primitive.m_pVertices;
+	for ( U32 VertexIndex=0; VertexIndex < _Primitive.m_VerticesCount; VertexIndex++, pDepthSourceVertex++ ) {
+#ifdef PACKED_SCENE_VERTICES
+		float3	Position = (pDepthSourceVertex->P - QuantizationMin) * InvQuantizationSize;
+#else
+		float3	Position = pDepthSourceVertex->P;
+#endif
+		DepthFormat.Write( pDepthVertices + VertexIndex * DepthFormat.Size(), Position, float3::Zero, float3::Zero, float3::Zero, float2::Zero );
+	}
+
+#ifdef POOLED_SCENE_GEOMETRY
+	// Allocated in the same order as the scene pool so both primitives have the same base vertex
+	if ( pReloadedPrim != NULL )
+		pPrim->GetDepthStream()->Rewrite( *m_pSceneDepthPool, pDepthVertices, 0, NULL, _Primitive.m_IndexFormat );
+	else
+		pPrim->SetDepthStream( new Primitive( *m_pSceneDepthPool, _Primitive.m_VerticesCount, pDepthVertices, 0, NULL, _Primitive.m_IndexFormat, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST ) );
+#else
+	pPrim->SetDepthStream( new Primitive( m_Device, _Primitive.m_VerticesCount, pDepthVertices, 0, NULL, _Primitive.m_IndexFormat, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST, DepthFormat ) );
+#endif
+	delete[] pDepthVertices;
+#endif
+
+#ifdef PACKED_SCENE_VERTICES
+	delete[] pPackedVertices;
+#endif
 
 	// Bind additional buffer infos if they're available
 	Primitive*	pAdditionalVertexStream = m_ProbesNetwork.GetProbeIDVertexStream();
 	if ( pAdditionalVertexStream != NULL ) {
-		pPrim->BindVertexStream( 1, *pAdditionalVertexStream, m_TotalVerticesCount );	// We access a small portion of the buffer that only concerns this primitive's vertices
+		pPrim->BindVertexStream( 1, *pAdditionalVertexStream, m_TotalVerticesCount );	// We access a small portion of the buffer that only concerns this primitive's vertices (offset 0 with a pool since the base vertex already gets us there)
 	}
 
 	// Tag the primitive with the face offset
@@ -1223,7 +2665,7 @@ void*	EffectGlobalIllum2::TagPrimitive( const Scene& _Owner, Scene::Mesh& _Mesh,
 	m_pPrimitiveFaceOffset[m_TotalPrimitivesCount] = m_TotalFacesCount;		// Store face offset for each primitive
 	m_pPrimitiveVertexOffset[m_TotalPrimitivesCount] = m_TotalVerticesCount;// Store vertex offset also
 	m_TotalVerticesCount += pPrim->GetVerticesCount();						// Increase total amount of vertices
-	m_TotalFacesCount += pPrim->GetFacesCount();							// Increase total amount of faces
+	m_TotalFacesCount += _Primitive.m_FacesCount;							// Increase total amount of faces (LOD 0 only, the other LODs don't have probe infos)
 	m_TotalPrimitivesCount++;
 
 #ifdef _DEBUG
@@ -1233,6 +2675,170 @@ void*	EffectGlobalIllum2::TagPrimitive( const Scene& _Owner, Scene::Mesh& _Mesh,
 	return pPrim;
 }
 
+#ifdef SCENE_HOT_RELOAD
+// Loads the new version of the scene file and takes the meshes that changed from it (cf. Scene::DiffMeshes())
+// Their primitives are rewritten in place so the pools & the probe ID stream keep their layout: meshes may move, deform or
+//	change material but must keep their primitives, vertices & faces counts, anything else requires a restart
+void	EffectGlobalIllum2::HotReloadScene() {
+	FILE*	pFile = NULL;
+	fopen_s( &pFile, SCENE_FILE_PATH SCENE_FILE_NAME, "rb" );
+	if ( pFile == NULL )
+		return;	// Still locked by the converter, we'll be notified again when it's done
+
+	fseek( pFile, 0, SEEK_END );
+	U32		SceneSize = U32( ftell( pFile ) );
+	fseek( pFile, 0, SEEK_SET );
+	U8*		pSceneData = new U8[MAX( 1U, SceneSize )];
+	SceneSize = U32( fread_s( pSceneData, SceneSize, 1, SceneSize, pFile ) );
+	fclose( pFile );
+
+	if ( !Scene::IsSceneData( pSceneData, SceneSize ) ) {
+		delete[] pSceneData;
+		return;
+	}
+
+	// Single LOD, only the changed meshes get their LODs built when we take them
+	Scene	NewScene;
+	NewScene.Load( pSceneData, SceneSize );
+
+	bool*	pChangedMeshes = new bool[MAX( 1, m_Scene.m_MeshesCount )];
+	int		ChangedMeshesCount = m_Scene.DiffMeshes( NewScene, pChangedMeshes );
+	for ( int MeshIndex=0; ChangedMeshesCount > 0 && MeshIndex < m_Scene.m_MeshesCount; MeshIndex++ ) {
+		if ( !pChangedMeshes[MeshIndex] )
+			continue;
+
+		const Scene::Mesh&	OldMesh = *m_Scene.m_ppMeshes[MeshIndex];
+		const Scene::Mesh&	NewMesh = *NewScene.m_ppMeshes[MeshIndex];
+		bool	bSameLayout = OldMesh.m_PrimitivesCount == NewMesh.m_PrimitivesCount;
+		for ( int PrimitiveIndex=0; bSameLayout && PrimitiveIndex < OldMesh.m_PrimitivesCount; PrimitiveIndex++ ) {
+			const Scene::Mesh::Primitive&	OldPrimitive = OldMesh.m_pPrimitives[PrimitiveIndex];
+			const Scene::Mesh::Primitive&	NewPrimitive = NewMesh.m_pPrimitives[PrimitiveIndex];
+			bSameLayout = OldPrimitive.m_VerticesCount == NewPrimitive.m_VerticesCount
+						&& OldPrimitive.m_FacesCount == NewPrimitive.m_FacesCount
+						&& OldPrimitive.m_IndexFormat == NewPrimitive.m_IndexFormat
+						&& OldPrimitive.m_VertexFormat == NewPrimitive.m_VertexFormat;
+		}
+		if ( !bSameLayout )
+			ChangedMeshesCount = -1;
+	}
+	if ( ChangedMeshesCount < 0 )
+		OutputDebugString( "Scene hot reload: the hierarchy, the textures or the size of some meshes changed, restart required!\n" );
+	if ( ChangedMeshesCount <= 0 ) {
+		delete[] pChangedMeshes;
+		delete[] pSceneData;
+		return;
+	}
+
+	m_Scene.ReplaceMeshes( NewScene, pChangedMeshes, SCENE_LODS_COUNT );
+	m_ReloadedScenes.Append( pSceneData );	// Our new primitives point into it
+
+	// Primitives are tagged in depth-first order so find the tag index of each mesh's first primitive (cf. TagPrimitive())
+	class	PrimitiveIndexVisitor : public Scene::IVisitor {
+	public:
+		int*	m_pFirstPrimitiveIndex;
+		int		m_PrimitivesCount;
+
+		virtual void	HandleNode( Scene::Node& _Node ) override {
+			if ( _Node.m_Type != Scene::Node::MESH )
+				return;
+			Scene::Mesh&	Mesh = (Scene::Mesh&) _Node;
+			m_pFirstPrimitiveIndex[Mesh.m_MeshIndex] = m_PrimitivesCount;
+			m_PrimitivesCount += Mesh.m_PrimitivesCount;
+		}
+	}	visitor;
+	visitor.m_pFirstPrimitiveIndex = new int[MAX( 1, m_Scene.m_MeshesCount )];
+	visitor.m_PrimitivesCount = 0;
+	m_Scene.ForEach( visitor );
+
+	// Tag the materials again for their new emissive colors, then rewrite the changed primitives at their previous offsets
+	m_bDeleteSceneTags = false;
+	m_EmissiveMaterialsCount = 0;
+	m_Scene.PlaceMaterialTags( *this );
+
+	U32		TotalFacesCount = m_TotalFacesCount;
+	U32		TotalVerticesCount = m_TotalVerticesCount;
+	U32		TotalPrimitivesCount = m_TotalPrimitivesCount;
+	for ( int MeshIndex=0; MeshIndex < m_Scene.m_MeshesCount; MeshIndex++ ) {
+		if ( !pChangedMeshes[MeshIndex] )
+			continue;
+
+		int		FirstPrimitiveIndex = visitor.m_pFirstPrimitiveIndex[MeshIndex];
+		m_TotalFacesCount = m_pPrimitiveFaceOffset[FirstPrimitiveIndex];
+		m_TotalVerticesCount = m_pPrimitiveVertexOffset[FirstPrimitiveIndex];
+		m_TotalPrimitivesCount = FirstPrimitiveIndex;
+		m_Scene.PlaceTags( *this, *m_Scene.m_ppMeshes[MeshIndex] );
+	}
+	m_TotalFacesCount = TotalFacesCount;
+	m_TotalVerticesCount = TotalVerticesCount;
+	m_TotalPrimitivesCount = TotalPrimitivesCount;
+
+	// Update everything that was computed from the meshes' bounds & transforms
+	float3*	pBoundsMin = new float3[m_Scene.m_MeshesCount];
+	float3*	pBoundsMax = new float3[m_Scene.m_MeshesCount];
+	for ( int MeshIndex=0; MeshIndex < m_Scene.m_MeshesCount; MeshIndex++ ) {
+		pBoundsMin[MeshIndex] = m_ppCachedMeshes[MeshIndex]->m_GlobalBBoxMin;
+		pBoundsMax[MeshIndex] = m_ppCachedMeshes[MeshIndex]->m_GlobalBBoxMax;
+	}
+	m_MeshesCuller.Init( m_Scene.m_MeshesCount, pBoundsMin, pBoundsMax );
+	delete[] pBoundsMax;
+	delete[] pBoundsMin;
+
+	m_SceneBBoxMin = m_Scene.m_GlobalBBoxMin;
+	m_SceneBBoxMax = m_Scene.m_GlobalBBoxMax;
+
+#ifdef OCCLUSION_CULLING
+	BuildOccluders();
+#endif
+
+#ifdef INSTANCED_SHADOW_MAPS
+	delete m_pSB_InstanceTransforms;	// The instance groups were rebuilt
+	m_pSB_InstanceTransforms = new SB<float4x4>( m_Device, MAX( 1, m_Scene.m_InstancesCount ), true );
+	for ( int InstanceIndex=0; InstanceIndex < m_Scene.m_InstancesCount; InstanceIndex++ )
+		m_pSB_InstanceTransforms->m[InstanceIndex] = m_Scene.m_ppInstances[InstanceIndex]->m_pOwner->m_Local2World;
+	m_pSB_InstanceTransforms->Write( m_Scene.m_InstancesCount );
+#endif
+
+#ifdef CACHED_SHADOW_MAPS
+	memset( &m_ShadowMapStaticWorld2Light, 0, sizeof(float4x4) );	// Render the static casters again
+	m_ShadowMapPointStaticLight = float4::Zero;
+#endif
+
+#ifdef VOXEL_CONE_TRACED_GI
+	m_pVoxelGI->Invalidate();
+#endif
+
+#ifndef LOAD_PROBES
+	// Rebake the probes influenced by the changed meshes (cf. SHProbeNetwork::RebakeProbes()) and rebind their new ID stream
+	RenderScene		functor( *this );
+	m_ProbesNetwork.RebakeProbes( PROBES_PATH, functor, m_Scene, m_TotalFacesCount );
+	m_ProbesNetwork.LoadProbes( PROBES_PATH, m_SceneBBoxMin, m_SceneBBoxMax );
+
+	Primitive*	pProbeIDVertexStream = m_ProbesNetwork.GetProbeIDVertexStream();
+	ASSERT( pProbeIDVertexStream != NULL && pProbeIDVertexStream->GetVerticesCount() == m_TotalVerticesCount, "The rebaked probe vertex stream doesn't match the scene anymore!" );
+	for ( int MeshIndex=0; MeshIndex < m_Scene.m_MeshesCount; MeshIndex++ ) {
+		Scene::Mesh&	Mesh = *m_ppCachedMeshes[MeshIndex];
+		for ( int PrimitiveIndex=0; PrimitiveIndex < Mesh.m_PrimitivesCount; PrimitiveIndex++ ) {
+			Primitive*	pPrim = (Primitive*) Mesh.m_pPrimitives[PrimitiveIndex].m_pTag;
+			pPrim->BindVertexStream( 1, *pProbeIDVertexStream, m_pPrimitiveVertexOffset[visitor.m_pFirstPrimitiveIndex[MeshIndex] + PrimitiveIndex] );
+		}
+	}
+
+	m_pCB_Scene->m.ProbesCount = m_ProbesNetwork.GetProbesCount();
+#else
+	OutputDebugString( "Scene hot reload: the probes were not rebaked since LOAD_PROBES is defined!\n" );
+#endif
+
+	delete[] visitor.m_pFirstPrimitiveIndex;
+	delete[] pChangedMeshes;
+
+#ifdef _DEBUG
+	char	pTemp[256];
+	sprintf_s( pTemp, "Scene hot reload: %d meshes changed\n", ChangedMeshesCount );
+	OutputDebugString( pTemp );
+#endif
+}
+#endif
+
 #pragma endregion
 
 
@@ -1241,12 +2847,294 @@ void*	EffectGlobalIllum2::TagPrimitive( const Scene& _Owner, Scene::Mesh& _Mesh,
 //
 #pragma region Scene Rendering
 
+#ifdef OCCLUSION_CULLING
+// Makes occluders of the meshes that are large but made of few faces (i.e. walls, floors & ceilings rather than props)
+void	EffectGlobalIllum2::BuildOccluders()
+{
+	m_OcclusionCuller.Wait();
+	m_OcclusionCuller.Clear();
+	m_OccluderMeshes.Clear();
+
+	float	MinSize = OCCLUDER_MIN_SIZE * (m_Scene.m_GlobalBBoxMax - m_Scene.m_GlobalBBoxMin).Length();
+	for ( int MeshIndex=0; MeshIndex < m_Scene.m_MeshesCount; MeshIndex++ ) {
+		const Scene::Mesh&	Mesh = *m_ppCachedMeshes[MeshIndex];
+		if ( (Mesh.m_GlobalBBoxMax - Mesh.m_GlobalBBoxMin).Length() < MinSize )
+			continue;
+
+		U32	FacesCount = 0;
+		for ( int PrimitiveIndex=0; PrimitiveIndex < Mesh.m_PrimitivesCount; PrimitiveIndex++ )
+			FacesCount += Mesh.m_pPrimitives[PrimitiveIndex].m_FacesCount;
+		if ( FacesCount > OCCLUDER_MAX_FACES )
+			continue;
+
+		for ( int PrimitiveIndex=0; PrimitiveIndex < Mesh.m_PrimitivesCount; PrimitiveIndex++ ) {
+			const Scene::Mesh::Primitive&	ScenePrimitive = Mesh.m_pPrimitives[PrimitiveIndex];
+			m_OcclusionCuller.AddOccluder( Mesh.m_Local2World, ScenePrimitive.m_VerticesCount, ScenePrimitive.m_pVertices, sizeof(Scene::Mesh::Primitive::VF_P3N3G3B3T2), ScenePrimitive.m_FacesCount, ScenePrimitive.m_pFaces, ScenePrimitive.m_IndexFormat == DXGI_FORMAT_R16_UINT );
+			m_OccluderMeshes.Append( MeshIndex );
+		}
+	}
+}
+#endif
+
+// Main scene pass
+void	EffectGlobalIllum2::RenderScene()
+{
+	GPU_PROFILE_SCOPE( m_Device, "Scene" );
+
+ 	m_Device.ClearRenderTarget( m_RTTarget, m_CachedCopy.EnableSky ? 1.0f * float4( 0.64f, 0.79f, 1.0f, 0.0f ) : float4::Zero );
+
+ 	m_Device.SetRenderTarget( m_RTTarget, &m_Device.DefaultDepthStencil() );
+
+	// Queue the primitives of the visible meshes
+	float3	CameraPosition = m_Camera.GetCB().Camera2World.GetRow( 3 );
+	float	InvMaxDistance = 1.0f / MAX( 1e-3f, (m_SceneBBoxMax - m_SceneBBoxMin).Length() );
+
+	m_MeshesCuller.Cull( m_Camera.GetCB().World2Proj, m_pVisibleMeshesScene );
+#ifdef OCCLUSION_CULLING
+	m_OcclusionCuller.Wait();
+#endif
+	m_DrawItemsCount = 0;
+	for ( int MeshIndex=0; MeshIndex < m_Scene.m_MeshesCount; MeshIndex++ ) {
+		const Scene::Mesh&	Mesh = *m_ppCachedMeshes[MeshIndex];
+		if ( !m_pVisibleMeshesScene[MeshIndex] )
+			continue;	// Out of the frustum
+		if ( Mesh.m_ChunkIndex >= 0 && m_Scene.m_pChunks[Mesh.m_ChunkIndex].m_State != Scene::Chunk::RESIDENT )
+			continue;	// Streamed out...
+#ifdef OCCLUSION_CULLING
+		if ( !m_OcclusionCuller.IsVisible( Mesh.m_GlobalBBoxMin, Mesh.m_GlobalBBoxMax ) )
+			continue;	// Hidden behind the occluders
+#endif
+
+		for ( int PrimitiveIndex=0; PrimitiveIndex < Mesh.m_PrimitivesCount; PrimitiveIndex++ ) {
+			const Scene::Mesh::Primitive&	ScenePrimitive = Mesh.m_pPrimitives[PrimitiveIndex];
+			const Shader*	pMat = (const Shader*) ScenePrimitive.m_pMaterial->m_pTag;
+			if ( pMat == NULL || ScenePrimitive.m_pTag == NULL )
+				continue;	// Unsupported material or primitive!
+
+			ASSERT( m_DrawItemsCount < MAX_SCENE_PRIMITIVES, "Too many draw items!" );
+			DrawItem&	Item = m_pDrawItems[m_DrawItemsCount++];
+			Item.Key = BuildDrawItemKey( Mesh, ScenePrimitive, GetScenePipelineState( *pMat, false ), CameraPosition, InvMaxDistance );
+			Item.pMesh = &Mesh;
+			Item.PrimitiveIndex = PrimitiveIndex;
+		}
+	}
+
+	SortDrawItems( m_DrawItemsCount, m_pDrawItems, m_pDrawItemsTemp );
+
+#ifdef DEPTH_PREPASS
+	if ( m_bDepthPrepassFrame ) {
+		// Lay the depth down with color writes disabled then shade only the visible pixels, without writing the depth again
+		RenderDrawItemsDepth();
+		RenderDrawItems( true );
+
+		m_Device.SetStates( m_Device.m_pRS_CullBack, m_Device.m_pDS_ReadWriteLess, m_Device.m_pBS_Disabled );	// The next passes expect the scene's states
+		return;
+	}
+#endif
+
+	RenderDrawItems( false );
+}
+
+const PipelineState&	EffectGlobalIllum2::GetScenePipelineState( const Shader& _Material, bool _bAfterPrepass ) const {
+	bool	bEmissive = &_Material == m_pMatRenderEmissive;
+	ASSERT( bEmissive || &_Material == m_pMatRender, "Unsupported scene material!" );
+#ifdef DEPTH_PREPASS
+	if ( _bAfterPrepass )
+		return bEmissive ? *m_pPSO_SceneEmissiveAfterPrepass : *m_pPSO_SceneAfterPrepass;
+#endif
+	return bEmissive ? *m_pPSO_SceneEmissive : *m_pPSO_Scene;
+}
+
+// Sort keys are made of, from the most significant bits:
+//	_ 4 bits for the pipeline state (the upper bits of its sort key, i.e. of its material's hash since changing the shader is the most expensive)
+//	_ 12+10+10 bits for the diffuse, normal & specular texture IDs
+//	_ 12 bits for the material ID
+//	_ 16 bits for the distance of the mesh to the camera so primitives sharing the same states are drawn front to back
+// Fields are truncated so IDs that don't fit may reach the wrong place in the queue, that only costs extra state changes.
+U64	EffectGlobalIllum2::BuildDrawItemKey( const Scene::Mesh& _Mesh, const Scene::Mesh::Primitive& _Primitive, const PipelineState& _PipelineState, const float3& _CameraPosition, float _InvMaxDistance ) const {
+	const Scene::Material&	SceneMaterial = *_Primitive.m_pMaterial;
+
+	U64	PipelineKey = _PipelineState.GetSortKey() >> 28;
+#ifdef TEXTURE_ARRAYS
+	U64	DiffuseID = 0;	// Textures are all bound at once so only the shader & the distance matter
+	U64	NormalID = 0;
+	U64	SpecularID = 0;
+#else
+	U64	DiffuseID = SceneMaterial.m_TexDiffuseAlbedo.m_ID & 0xFFF;
+	U64	NormalID = SceneMaterial.m_TexNormal.m_ID & 0x3FF;
+	U64	SpecularID = SceneMaterial.m_TexSpecularAlbedo.m_ID & 0x3FF;
+#endif
+	U64	MaterialID = SceneMaterial.m_ID & 0xFFF;
+
+	float	Distance = (0.5f * (_Mesh.m_GlobalBBoxMin + _Mesh.m_GlobalBBoxMax) - _CameraPosition).Length();
+	U64		Depth = U64( 65535.0f * CLAMP( Distance * _InvMaxDistance, 0.0f, 1.0f ) );
+
+	return (PipelineKey << 60) | (DiffuseID << 48) | (NormalID << 38) | (SpecularID << 28) | (MaterialID << 16) | Depth;
+}
+
+// LSD radix sort on bytes, passes where all the items share the same byte are skipped (e.g. unused shader or texture bits)
+void	EffectGlobalIllum2::SortDrawItems( U32 _Count, DrawItem* _pItems, DrawItem* _pTemp ) {
+	DrawItem*	pSource = _pItems;
+	DrawItem*	pTarget = _pTemp;
+	for ( U32 Shift=0; Shift < 64; Shift+=8 ) {
+		U32	pStart[256];
+		memset( pStart, 0, 256*sizeof(U32) );
+		for ( U32 i=0; i < _Count; i++ )
+			pStart[(pSource[i].Key >> Shift) & 0xFF]++;
+		if ( _Count == 0 || pStart[(pSource[0].Key >> Shift) & 0xFF] == _Count )
+			continue;	// Nothing to sort on this byte
+
+		U32	Sum = 0;
+		for ( U32 Digit=0; Digit < 256; Digit++ ) {
+			U32	Count = pStart[Digit];
+			pStart[Digit] = Sum;
+			Sum += Count;
+		}
+		for ( U32 i=0; i < _Count; i++ )
+			pTarget[pStart[(pSource[i].Key >> Shift) & 0xFF]++] = pSource[i];
+
+		DrawItem*	pTemp = pSource;
+		pSource = pTarget;
+		pTarget = pTemp;
+	}
+
+	if ( pSource != _pItems )
+		memcpy( _pItems, pSource, _Count*sizeof(DrawItem) );
+}
+
+// Submits the sorted queue, states are only changed when they differ from the previous item's
+void	EffectGlobalIllum2::RenderDrawItems( bool _bAfterPrepass ) {
+	const Scene::Mesh*	pCurrentMesh = NULL;
+	const Texture2D*	ppCurrentTextures[3] = { NULL, NULL, NULL };
+
+#ifdef TEXTURE_ARRAYS
+	BindMaterialTextureArrays();
+#endif
+
+	for ( U32 ItemIndex=0; ItemIndex < m_DrawItemsCount; ItemIndex++ ) {
+		const DrawItem&					Item = m_pDrawItems[ItemIndex];
+		const Scene::Mesh::Primitive&	ScenePrimitive = Item.pMesh->m_pPrimitives[Item.PrimitiveIndex];
+		const Scene::Material&			SceneMaterial = *ScenePrimitive.m_pMaterial;
+		Shader*		pMat = (Shader*) SceneMaterial.m_pTag;
+		Primitive*	pPrim = (Primitive*) ScenePrimitive.m_pTag;
+
+		// Upload the object's CB
+		if ( Item.pMesh != pCurrentMesh ) {
+			pCurrentMesh = Item.pMesh;
+			memcpy( &m_pCB_Object->m.Local2World, &pCurrentMesh->m_Local2World, sizeof(float4x4) );
+			m_pCB_Object->m.QuantizationMin = float3::Zero;
+			m_pCB_Object->m.QuantizationSize = float3::One;
+#ifndef PACKED_SCENE_VERTICES
+			m_pCB_Object->UpdateData();
+#endif
+		}
+#ifdef PACKED_SCENE_VERTICES
+		GetQuantizationBounds( ScenePrimitive, m_pCB_Object->m.QuantizationMin, m_pCB_Object->m.QuantizationSize );
+		m_pCB_Object->UpdateData();
+#endif
+
+		// Bind textures
+		Texture2D*	ppTextures[3];
+		GetMaterialTextures( SceneMaterial, ppTextures );
+#ifndef TEXTURE_ARRAYS
+		for ( int TextureIndex=0; TextureIndex < 3; TextureIndex++ ) {
+			Texture2D*	pTexture = ppTextures[TextureIndex] != NULL ? ppTextures[TextureIndex] : m_ppTextures[0];
+			if ( pTexture == ppCurrentTextures[TextureIndex] )
+				continue;
+
+			pTexture->SetPS( 10+TextureIndex );
+			ppCurrentTextures[TextureIndex] = pTexture;
+		}
+#endif
+
+		// The material CB also holds the primitive's face offset so it's updated for every item
+		UpdateMaterialCB( SceneMaterial, *pPrim, ppTextures );
+
+		if ( !m_Device.SetPipelineState( GetScenePipelineState( *pMat, _bAfterPrepass ) ) )
+			continue;	// Still compiling...
+
+		RenderPrimitive( *pPrim, ScenePrimitive, *pMat, 0 );
+	}
+}
+
+#ifdef DEPTH_PREPASS
+// Submits the queue with the depth-only material, the primitives bind their position-only stream since it has the material's format
+void	EffectGlobalIllum2::RenderDrawItemsDepth() {
+	const Scene::Mesh*	pCurrentMesh = NULL;
+	if ( !m_Device.SetPipelineState( *m_pPSO_DepthPrepass ) )
+		return;
+
+	for ( U32 ItemIndex=0; ItemIndex < m_DrawItemsCount; ItemIndex++ ) {
+		const DrawItem&					Item = m_pDrawItems[ItemIndex];
+		const Scene::Mesh::Primitive&	ScenePrimitive = Item.pMesh->m_pPrimitives[Item.PrimitiveIndex];
+		Primitive*	pPrim = (Primitive*) ScenePrimitive.m_pTag;
+
+		if ( Item.pMesh != pCurrentMesh ) {
+			pCurrentMesh = Item.pMesh;
+			memcpy( &m_pCB_Object->m.Local2World, &pCurrentMesh->m_Local2World, sizeof(float4x4) );
+			m_pCB_Object->m.QuantizationMin = float3::Zero;
+			m_pCB_Object->m.QuantizationSize = float3::One;
+#ifndef PACKED_SCENE_VERTICES
+			m_pCB_Object->UpdateData();
+#endif
+		}
+#ifdef PACKED_SCENE_VERTICES
+		GetQuantizationBounds( ScenePrimitive, m_pCB_Object->m.QuantizationMin, m_pCB_Object->m.QuantizationSize );
+		m_pCB_Object->UpdateData();
+#endif
+
+		RenderPrimitive( *pPrim, ScenePrimitive, *m_pMatRenderDepthPrepass, 0 );
+	}
+}
+
+// Reads back the overdraw measured by the last frames shaded without the prepass and decides whether this frame uses it
+// While enabled, the prepass still leaves out a frame every DEPTH_PREPASS_PROBE_PERIOD so we notice when the overdraw drops
+void	EffectGlobalIllum2::UpdateDepthPrepass() {
+	ID3D11DeviceContext&	Context = m_Device.DXContext();
+	float	PixelsCount = float( m_RTTarget.GetWidth() * m_RTTarget.GetHeight() );
+
+	int		NewestQueryIndex = -1;
+	for ( U32 QueryIndex=0; QueryIndex < OVERDRAW_QUERIES_COUNT; QueryIndex++ ) {
+		if ( !m_pQueriesOverdrawPending[QueryIndex] )
+			continue;
+
+		D3D11_QUERY_DATA_PIPELINE_STATISTICS	Statistics;
+		if ( Context.GetData( m_ppQueriesOverdraw[QueryIndex], &Statistics, sizeof(Statistics), D3D11_ASYNC_GETDATA_DONOTFLUSH ) != S_OK )
+			continue;	// Not ready yet
+
+		m_pQueriesOverdrawPending[QueryIndex] = false;
+		if ( NewestQueryIndex >= 0 && m_pQueriesOverdrawFrameIndex[QueryIndex] < m_pQueriesOverdrawFrameIndex[NewestQueryIndex] )
+			continue;	// An older measure
+
+		NewestQueryIndex = QueryIndex;
+		m_Overdraw = float( Statistics.PSInvocations ) / PixelsCount;
+	}
+
+	if ( NewestQueryIndex >= 0 )
+		m_bDepthPrepass = m_Overdraw > (m_bDepthPrepass ? DEPTH_PREPASS_DISABLE_OVERDRAW : DEPTH_PREPASS_ENABLE_OVERDRAW);
+
+	// Measure the frames shaded without the prepass, as long as their query isn't still in flight
+	U32		FrameIndex = m_Device.GetFrameIndex();
+	bool	bMeasure = !m_bDepthPrepass || (FrameIndex % DEPTH_PREPASS_PROBE_PERIOD) == 0;
+	U32		QueryIndex = FrameIndex % OVERDRAW_QUERIES_COUNT;
+	m_bDepthPrepassFrame = !bMeasure;
+	m_OverdrawQueryIndex = bMeasure && !m_pQueriesOverdrawPending[QueryIndex] ? int(QueryIndex) : -1;
+}
+#endif
+
 // Mesh rendering: we render each of the mesh's primitive in turn
 void	EffectGlobalIllum2::RenderMesh( const Scene::Mesh& _Mesh, Shader* _pMaterialOverride, bool _SetMaterial )
+{
+	RenderMesh( _Mesh, _pMaterialOverride, _SetMaterial, *m_pCB_Object );
+}
+
+void	EffectGlobalIllum2::RenderMesh( const Scene::Mesh& _Mesh, Shader* _pMaterialOverride, bool _SetMaterial, CB<CBObject>& _CBObject, const LODView* _pLODView, int _InstancesCount )
 {
 	// Upload the object's CB
-	memcpy( &m_pCB_Object->m.Local2World, &_Mesh.m_Local2World, sizeof(float4x4) );
-	m_pCB_Object->UpdateData();
+	memcpy( &_CBObject.m.Local2World, &_Mesh.m_Local2World, sizeof(float4x4) );
+	_CBObject.m.QuantizationMin = float3::Zero;
+	_CBObject.m.QuantizationSize = float3::One;
+	_CBObject.UpdateData();
 
 	for ( int PrimitiveIndex=0; PrimitiveIndex < _Mesh.m_PrimitivesCount; PrimitiveIndex++ )
 	{
@@ -1260,54 +3148,126 @@ void	EffectGlobalIllum2::RenderMesh( const Scene::Mesh& _Mesh, Shader* _pMateria
 		if ( pPrim == NULL )
 			continue;	// Unsupported primitive!
 
+#ifdef PACKED_SCENE_VERTICES
+		// Upload the bounds the primitive's positions were quantized in
+		GetQuantizationBounds( ScenePrimitive, _CBObject.m.QuantizationMin, _CBObject.m.QuantizationSize );
+		_CBObject.UpdateData();
+#endif
+
 		// Upload textures
 		if ( _SetMaterial )
 		{
-			Texture2D*	pTexDiffuseAlbedo = (Texture2D*) SceneMaterial.m_TexDiffuseAlbedo.m_pTag;
-			if ( pTexDiffuseAlbedo != NULL )
-				pTexDiffuseAlbedo->SetPS( 10 );
-			else
-				m_ppTextures[0]->SetPS( 10 );
-
-			Texture2D*	pTexNormal = NULL;
-#ifdef USE_NORMAL_MAPS
-	#ifdef USE_WHITE_TEXTURES
-			pTexNormal = m_ppTextures[1];
-	#else
-			pTexNormal = (Texture2D*) SceneMaterial.m_TexNormal.m_pTag;
-	#endif
+			Texture2D*	ppTextures[3];
+			GetMaterialTextures( SceneMaterial, ppTextures );
+#ifdef TEXTURE_ARRAYS
+			BindMaterialTextureArrays();	// The material CB's ID gives its slots
+#else
+			for ( int TextureIndex=0; TextureIndex < 3; TextureIndex++ )
+				(ppTextures[TextureIndex] != NULL ? ppTextures[TextureIndex] : m_ppTextures[0])->SetPS( 10+TextureIndex );
 #endif
-			if ( pTexNormal != NULL )
-				pTexNormal->SetPS( 11 );
-			else
-				m_ppTextures[0]->SetPS( 11 );
-
-			Texture2D*	pTexSpecularAlbedo = (Texture2D*) SceneMaterial.m_TexSpecularAlbedo.m_pTag;
-			if ( pTexSpecularAlbedo != NULL )
-				pTexSpecularAlbedo->SetPS( 12 );
-			else
-				m_ppTextures[0]->SetPS( 12 );
 
 			// Upload the primitive's material CB
-			m_pCB_Material->m.ID = SceneMaterial.m_ID;
-			m_pCB_Material->m.DiffuseAlbedo = SceneMaterial.m_DiffuseAlbedo;
-			m_pCB_Material->m.HasDiffuseTexture = pTexDiffuseAlbedo != NULL;
-			m_pCB_Material->m.SpecularAlbedo = SceneMaterial.m_SpecularAlbedo;
-			m_pCB_Material->m.HasSpecularTexture = pTexSpecularAlbedo != NULL;
-			m_pCB_Material->m.EmissiveColor = SceneMaterial.m_EmissiveColor;
-			m_pCB_Material->m.SpecularExponent = SceneMaterial.m_SpecularExponent.x;
-			m_pCB_Material->m.FaceOffset = U32(pPrim->m_pTag);
-			m_pCB_Material->m.HasNormalTexture = pTexNormal != NULL;
-			m_pCB_Material->UpdateData();
+			UpdateMaterialCB( SceneMaterial, *pPrim, ppTextures );
 
 			pMat->Use();
 		}
 
 		// Render
-		pPrim->Render( *pMat );
+		int	LODIndex = _pLODView != NULL ? ScenePrimitive.SelectLOD( _pLODView->GetProjectedSize( ScenePrimitive ) ) : 0;
+		RenderPrimitive( *pPrim, ScenePrimitive, *pMat, LODIndex, _InstancesCount );
 	}
 }
 
+void	EffectGlobalIllum2::RenderPrimitive( Primitive& _Primitive, const Scene::Mesh::Primitive& _ScenePrimitive, Shader& _Material, int _LODIndex, int _InstancesCount ) {
+	int	StartIndex = 3 * _ScenePrimitive.m_pLODFacesStart[_LODIndex];
+	int	IndicesCount = 3 * _ScenePrimitive.m_pLODFacesCount[_LODIndex];
+	if ( _InstancesCount > 1 )
+		_Primitive.RenderInstanced( _Material, _InstancesCount, 0, _Primitive.GetVerticesCount(), StartIndex, IndicesCount, 0 );
+	else
+		_Primitive.Render( _Material, 0, _Primitive.GetVerticesCount(), StartIndex, IndicesCount, 0 );
+}
+
+// Projected diameter of the primitive's bounding sphere
+float	EffectGlobalIllum2::LODView::GetProjectedSize( const Scene::Mesh::Primitive& _Primitive ) const {
+	float	Diameter = (_Primitive.m_GlobalBBoxMax - _Primitive.m_GlobalBBoxMin).Length();
+	if ( bOrthographic )
+		return Diameter * PixelsPerUnit;
+
+	float	Distance = (0.5f * (_Primitive.m_GlobalBBoxMin + _Primitive.m_GlobalBBoxMax) - Position).Length();
+	return Diameter * PixelsPerUnit / MAX( 0.5f * Diameter, Distance );	// Primitives containing the viewer are considered fully visible
+}
+
+// Draws each instance group having at least one visible instance with a single instanced call
+// The runtime primitive of any tagged instance can stand for the whole group since they all share the same geometry
+//	(its additional probe ID stream is simply ignored by the depth-only shaders)
+void	EffectGlobalIllum2::RenderInstanceGroups( const U8* _pVisibleMeshes, Shader& _Material, CB<CBObject>& _CBObject, const LODView& _View ) {
+	m_pSB_InstanceTransforms->SetInput( 26 );
+
+	for ( int GroupIndex=0; GroupIndex < m_Scene.m_InstanceGroupsCount; GroupIndex++ ) {
+		const Scene::InstanceGroup&	Group = m_Scene.m_pInstanceGroups[GroupIndex];
+
+		// Find a tagged instance and the finest LOD required by the visible instances
+		const Scene::Mesh::Primitive*	pScenePrimitive = NULL;
+		int		LODIndex = Scene::Mesh::Primitive::MAX_LODS;
+		for ( int InstanceIndex=Group.m_InstancesStart; InstanceIndex < Group.m_InstancesStart+Group.m_InstancesCount; InstanceIndex++ ) {
+			const Scene::Mesh::Primitive&	Instance = *m_Scene.m_ppInstances[InstanceIndex];
+			if ( _pVisibleMeshes[Instance.m_pOwner->m_MeshIndex] )
+				LODIndex = MIN( LODIndex, Instance.SelectLOD( _View.GetProjectedSize( Instance ) ) );
+			if ( pScenePrimitive == NULL && Instance.m_pTag != NULL )
+				pScenePrimitive = &Instance;
+		}
+		if ( LODIndex == Scene::Mesh::Primitive::MAX_LODS || pScenePrimitive == NULL )
+			continue;	// Culled or streamed out
+
+		_CBObject.m.InstancesStart = Group.m_InstancesStart;
+#ifdef PACKED_SCENE_VERTICES
+		GetQuantizationBounds( *pScenePrimitive, _CBObject.m.QuantizationMin, _CBObject.m.QuantizationSize );
+#endif
+		_CBObject.UpdateData();
+
+		RenderPrimitive( *((Primitive*) pScenePrimitive->m_pTag), *pScenePrimitive, _Material, LODIndex, Group.m_InstancesCount );
+	}
+}
+
+#ifdef TEXTURE_ARRAYS
+// Binds all the scene texture arrays & the materials' slots (cf. Inc/MaterialTextureArrays.hlsl)
+void	EffectGlobalIllum2::BindMaterialTextureArrays() const {
+	for ( int ArrayIndex=0; ArrayIndex < m_pTexturePacker->GetArraysCount(); ArrayIndex++ ) {
+		const Texture2D&	Array = m_pTexturePacker->GetArray( ArrayIndex );
+		Array.SetPS( 45+ArrayIndex, false, Array.GetSRV( 0, 0, 0, 0, true ) );	// Viewed as an array even with a single slice
+	}
+	m_pSB_MaterialTextures->SetInput( 53 );
+}
+#endif
+
+void	EffectGlobalIllum2::GetMaterialTextures( const Scene::Material& _Material, Texture2D** _ppTextures ) const {
+	_ppTextures[0] = (Texture2D*) _Material.m_TexDiffuseAlbedo.m_pTag;
+
+	_ppTextures[1] = NULL;
+#ifdef USE_NORMAL_MAPS
+	#ifdef USE_WHITE_TEXTURES
+	_ppTextures[1] = m_ppTextures[1];
+	#else
+	_ppTextures[1] = (Texture2D*) _Material.m_TexNormal.m_pTag;
+	#endif
+#endif
+
+	_ppTextures[2] = (Texture2D*) _Material.m_TexSpecularAlbedo.m_pTag;
+}
+
+void	EffectGlobalIllum2::UpdateMaterialCB( const Scene::Material& _Material, const Primitive& _Primitive, Texture2D** _ppTextures ) {
+	m_pCB_Material->m.ID = _Material.m_ID;
+	m_pCB_Material->m.DiffuseAlbedo = _Material.m_DiffuseAlbedo;
+	m_pCB_Material->m.HasDiffuseTexture = _ppTextures[0] != NULL;
+	m_pCB_Material->m.SpecularAlbedo = _Material.m_SpecularAlbedo;
+	m_pCB_Material->m.HasSpecularTexture = _ppTextures[2] != NULL;
+	m_pCB_Material->m.EmissiveColor = _Material.m_EmissiveColor;
+	m_pCB_Material->m.SpecularExponent = _Material.m_SpecularExponent.x;
+	m_pCB_Material->m.FaceOffset = U32(_Primitive.m_pTag);
+	m_pCB_Material->m.HasNormalTexture = _ppTextures[1] != NULL;
+	m_pCB_Material->UpdateData();
+}
+
 #pragma endregion
 
 
@@ -1327,76 +3287,6 @@ void	EffectGlobalIllum2::BuildVoronoiPrimitives() {
 		return;	// Empty neighborhood... Nothing to display!
 
 
-	// Dirty inline class that will help us build our cell's polygons
-	class	CellPolygon {
-	private:
-		float3			m_P;
-		float3			m_T;
-		float3			m_B;
-		float3			m_N;
-		int				m_CurrentListIndex;
-		List<float3>	m_pVertices[2];
-
-	public:
-
-		const List<float3>&	GetVertices() const	{ return m_pVertices[m_CurrentListIndex]; }
-
-	public:
-		CellPolygon( const float3& _P, const float3& _N ) {
-
-			m_P = _P;
-			m_N = _N;
-			if ( fabsf( m_N.y ) < 1.0f-1e-3f ) {
-				m_T = float3::UnitY.Cross( m_N ).Normalize();
-				m_B = m_N.Cross( m_T );
-			} else {
-				m_T = float3::UnitZ;
-				m_B = float3::UnitX;
-			}
-
-			// Start with 4 vertices
-			const float	R = 10.0f;	// Default plane size is 10 meters
-			m_CurrentListIndex = 0;
-			m_pVertices[0].Init( 4 );
-			m_pVertices[0].Append( m_P + R * (-m_T + m_B) );
-			m_pVertices[0].Append( m_P + R * (-m_T - m_B) );
-			m_pVertices[0].Append( m_P + R * ( m_T - m_B) );
-			m_pVertices[0].Append( m_P + R * ( m_T + m_B) );
-		}
-
-		// Cut polygon with a new plane, yielding a new polygon
-		void	Cut( const float3& _P, const float3& _N ) {
-			List<float3>&	SourceVertices = m_pVertices[m_CurrentListIndex];
-			m_CurrentListIndex ^= 1;
-			List<float3>&	TargetVertices = m_pVertices[m_CurrentListIndex];
-			TargetVertices.Init( SourceVertices.GetCount() + 1 );	// Any intersection add at most one more vertex every time...
-
-			for ( int EdgeIndex=0; EdgeIndex < SourceVertices.GetCount(); EdgeIndex++ ) {
-				float3	P0 = SourceVertices[EdgeIndex+0];
-				float3	P1 = SourceVertices[(EdgeIndex+1) % SourceVertices.GetCount()];
-				float	Dot0 = (P0 - _P).Dot( _N );
-				float	Dot1 = (P1 - _P).Dot( _N );
-				bool	InFront0 = Dot0 >= 0.0f;
-				bool	InFront1 = Dot1 >= 0.0f;
-				if ( !InFront0 && !InFront1 )
-					continue;	// This edge is completely behind the cutting plane, skip it entirely
-
-				if ( InFront0 && InFront1 ) {
-					// This edge is completely in front of the cutting plane, add P1
-					TargetVertices.Append( P1 );
-				} else {
-					// The edge intersects the plane
-					float3	D = P1 - P0;
-					float	t = -Dot0 / D.Dot( _N );
-					float3	I = P0 + t * D;
-					TargetVertices.Append( I );		// Add intersection no matter what
-					if ( InFront1 )
-						TargetVertices.Append( P1 );	// Since the edge is entering the plane, also add end point
-				}
-			}
-		}
-	};
-
 	// Builds vertices & indices for primitives
 	List<VertexFormatP3>	Vertices;
 	List<U32>				Indices_Faces;
@@ -1406,7 +3296,7 @@ void	EffectGlobalIllum2::BuildVoronoiPrimitives() {
 		const SHProbe::VoronoiProbeInfo&	VoronoiInfo = Probe.m_VoronoiProbes[PlaneIndex];
 
 		// Build the polygon by cutting it with all other neighbors
-		CellPolygon	Polygon( VoronoiInfo.PlanePosition, VoronoiInfo.PlaneNormal );
+		SHProbe::CellPolygon	Polygon( VoronoiInfo.PlanePosition, VoronoiInfo.PlaneNormal );
 		for ( int NeighborPlaneIndex=0; NeighborPlaneIndex < Probe.m_VoronoiProbes.GetCount(); NeighborPlaneIndex++ )
 			if ( NeighborPlaneIndex != PlaneIndex ) {
 				const SHProbe::VoronoiProbeInfo&	NeighborVoronoiInfo = Probe.m_VoronoiProbes[NeighborPlaneIndex];
@@ -1418,7 +3308,7 @@ void	EffectGlobalIllum2::BuildVoronoiPrimitives() {
 		U32					VerticesCount = PolygonVertices.GetCount();
 		U32					VertexOffset = Vertices.GetCount();
 		if ( VerticesCount < 3 )
-			continue;	// Completely culled! This shouldn't be happening... This means the cube map resolution rendering let a wrong plane appear!
+			continue;	// Completely culled! This shouldn't be happening since SHProbeEncoder::BuildProbeVoronoiCell() only keeps the planes bounding the cell...
 
 //		float				PolygonArea = 0.0f;
 		for ( U32 FaceTriangleIndex=0; FaceTriangleIndex < VerticesCount-2; FaceTriangleIndex++ ) {
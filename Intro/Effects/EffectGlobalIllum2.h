@@ -3,23 +3,89 @@
 #define SUN_INTENSITY	200.0f
 #define SKY_INTENSITY	(0.025f*SUN_INTENSITY)
 
+#define PARALLEL_RECORDING	// Define this to record the shadow maps and scene passes in parallel into deferred command lists (comment to render everything on the immediate context)
+//#define PACKED_SCENE_VERTICES	// Define this to upload the scene primitives as 20 bytes VertexFormatPackedP3N3G3B3T2 vertices instead of 56 bytes VertexFormatP3N3G3B3T2 (scene shaders are compiled with PACKED_VERTICES=1)
+#define POOLED_SCENE_GEOMETRY	// Define this to suballocate all the scene primitives from a single vertex & index buffer so the scene draws don't rebind the input assembler (comment to give each primitive its own buffers)
+#define DEPTH_VERTEX_STREAMS	// Define this to give each scene primitive a tightly packed copy of its positions that the shadow passes read instead of the fat vertices (cf. Primitive::SetDepthStream())
+#define DEPTH_PREPASS			// Define this to lay the scene's depth with the position-only streams before shading it without depth writes, enabled only while the measured overdraw is worth it (cf. UpdateDepthPrepass())
+//#define INSTANCED_SHADOW_MAPS	// Define this to draw each group of identical scene primitives with a single instanced call in the shadow passes (shadow shaders are compiled with INSTANCED=1, cf. Inc/SceneInstancing.hlsl)
+#define CULLED_POINT_SHADOW_FACES	// Define this to draw each scene mesh only into the cube faces of the point light's shadow map its bounds overlap, instanced once per face instead of a GS replicating every triangle to the 6 faces (shadow shader is compiled with MULTIVIEW=1, cf. Inc/MultiView.hlsl)
+#define CACHED_SHADOW_MAPS		// Define this to render the static scene into cached shadow maps only when their light changes, the shadow maps are then a copy of the cache with the dynamic objects drawn over it
+#define SHADOW_ATLAS			// Define this to render the cube shadow maps of the other point & spot lights into the slots of a single depth atlas, allocated each frame by screen importance (shadow shader is compiled with SHADOW_ATLAS=1, cf. Inc/ShadowAtlas.hlsl)
+#define SUN_SHADOW_CASCADES		// Define this to render the sun's shadow into stable cascades fit to the camera, the far cascades being updated every 2nd or 4th frame only (scene shader is compiled with SUN_SHADOW_CASCADES=1, cf. Inc/SunShadowCascades.hlsl)
+#define STREAMED_TEXTURES		// Define this to load the scene textures with only their low mips resident and stream the higher mips in the background within a per-frame budget (cf. TextureStreamer)
+//#define TEXTURE_ARRAYS		// Define this to pack the scene textures into texture arrays by format & size so the materials index their slices instead of binding their own textures (scene shaders are compiled with TEXTURE_ARRAYS=1, cf. Inc/MaterialTextureArrays.hlsl)
+#define AUTO_EXPOSURE			// Define this to bring the HDR result to the screen with the histogram auto-exposure and the baked tone curve LUT (cf. ToneMapper) instead of the fixed exposure of GIPostProcess.hlsl
+#define TEMPORAL_AA				// Define this to jitter the camera, build a velocity buffer from the camera & dynamic objects motion and accumulate the frames into a reprojected history before tone mapping (cf. TemporalAA)
+#define CLUSTERED_LIGHTS		// Define this to bin the lights into camera clusters with a compute shader so the scene shader only evaluates the lights of its cluster (scene shader is compiled with CLUSTERED_LIGHTS=1, cf. Inc/LightClusters.hlsl)
+//#define VOXEL_CONE_TRACED_GI	// Define this to light the scene with cones traced through a camera-centered voxel clipmap, voxelized & lit by the sun on the fly, instead of sampling the probes (scene shader is compiled with VOXEL_GI=1, cf. VoxelGI & Inc/VoxelConeTracing.hlsl)
+#define SCENE_HOT_RELOAD		// Define this to watch the scene file and take the meshes that changed from its new version without restarting, only their primitives are rebuilt and only the probes they influenced are rebaked (cf. HotReloadScene())
+#define OCCLUSION_CULLING		// Define this to rasterize the large & simple scene meshes into a low resolution CPU depth buffer on the workers at the start of the frame, the scene pass skipping the meshes they hide (cf. OcclusionCuller)
+
 template<typename> class CB;
 
-class EffectGlobalIllum2 : public Scene::ISceneTagger, public Scene::ISceneRenderer, public SHProbeNetwork::DynamicUpdateParms::IQueryMaterial
+class EffectGlobalIllum2 : public Scene::ISceneTagger, public Scene::ISceneRenderer, public SHProbeNetwork::DynamicUpdateParms::IQueryMaterial, public IRenderPass
 {
 private:	// CONSTANTS
 
 	static const U32		MAX_SCENE_PRIMITIVES = 1024;		// We handle a maximum of 1024 scene primitives. That's not because the tech is limited but simply because I don't have a dynamic list class! ^^
 
-	static const U32		MAX_LIGHTS = 64;
+	static const U32		MAX_DYNAMIC_LIGHTS = 1024;			// Static lights are sized from the scene
+
+	static const U32		LIGHT_CLUSTERS_X = 16;				// Screen tiles
+	static const U32		LIGHT_CLUSTERS_Y = 9;
+	static const U32		LIGHT_CLUSTERS_Z = 24;				// Exponential depth slices
+	static const U32		MAX_CLUSTER_LIGHT_INDICES = 128*1024;	// Size of the list shared by all the clusters (an average of 37 lights per cluster)
 
-	static const U32		MAX_DYNAMIC_OBJECTS = 128;
+	static const U32		MAX_MATERIAL_TEXTURE_ARRAYS = 8;	// !!IMPORTANT ==> Must correspond to MAX_MATERIAL_TEXTURE_ARRAYS in Inc/MaterialTextureArrays.hlsl!!
+
+	static const U32		MAX_DYNAMIC_OBJECTS = 4096;			// They're all drawn with a single instanced call per pass
 
 	static const U32		SHADOW_MAP_SIZE = 1024;
 	static const U32		SHADOW_MAP_POINT_SIZE = 256;		// Point light shadow map
 
+	static const U32		SHADOW_ATLAS_SIZE = 4096;			// Depth atlas shared by the shadowed lights (cf. SHADOW_ATLAS)
+	static const U32		SHADOW_ATLAS_PAGE_SIZE = 256;		// A page holds a cube face at full resolution, a light's slot is made of 3x2 pages
+	static const U32		SHADOW_ATLAS_SLOTS_X = SHADOW_ATLAS_SIZE / (3*SHADOW_ATLAS_PAGE_SIZE);
+	static const U32		SHADOW_ATLAS_SLOTS_Y = SHADOW_ATLAS_SIZE / (2*SHADOW_ATLAS_PAGE_SIZE);
+	static const U32		SHADOW_ATLAS_SLOTS_COUNT = SHADOW_ATLAS_SLOTS_X * SHADOW_ATLAS_SLOTS_Y;	// 40 shadowed lights
+	static const U32		SHADOW_ATLAS_LEVELS_COUNT = 3;		// Faces are rendered at 256, 128 or 64 pixels depending on the light's importance
+	static const U32		SHADOW_ATLAS_MAX_RENDERS_PER_FRAME = 4;	// Slots re-rendered each frame at most, the others wait for the next frames
+	static const U32		SHADOW_ATLAS_NO_SLOT = ~0U;
+
+	static const U32		SUN_SHADOW_CASCADES_COUNT = 4;		// Camera cascades of the sun's shadow (cf. SUN_SHADOW_CASCADES), cascade i is updated every 2^(i-1) frames
+	static const U32		SUN_SHADOW_CASCADE_SIZE = 1024;
+	static const float		SUN_SHADOW_CASCADES_MAX_DISTANCE;	// Distance from the camera covered by the last cascade, the whole scene shadow map is used beyond
+	static const float		SUN_SHADOW_CASCADES_SPLIT_LAMBDA;	// Blend between logarithmic (1) and uniform (0) splits
+	static const float		SUN_SHADOW_CASCADES_BIAS_TEXELS;	// Depth bias in cascade texels
+
+	static const U32		OCCLUDER_MAX_FACES = 512;			// Meshes with more faces are never occluders (cf. OCCLUSION_CULLING)
+	static const float		OCCLUDER_MIN_SIZE;					// Minimum diagonal of an occluder's bounds, relative to the scene's diagonal
+
+	static const int		SCENE_LODS_COUNT = 4;				// Levels of detail built for the scene primitives at load time (used by the shadow passes)
+
+	static const U32		TEXTURE_STREAMING_BUDGET = 2 << 20;	// Bytes of streamed mips uploaded each frame at most (cf. STREAMED_TEXTURES)
+
+	static const U32		OVERDRAW_QUERIES_COUNT = 4;			// Frames in flight we keep the scene pass statistics queries for (cf. DEPTH_PREPASS)
+	static const U32		DEPTH_PREPASS_PROBE_PERIOD = 64;	// While the prepass is enabled, a frame is shaded without it every 64 frames to measure the overdraw again
+
 
 protected:	// NESTED TYPES
+
+#ifdef PARALLEL_RECORDING
+	// Records one of our passes into a command list
+	class	PassRecorder : public CommandList::IRecorder
+	{
+	public:
+		typedef void	(EffectGlobalIllum2::*PassMethod)();
+
+		EffectGlobalIllum2&	m_Owner;
+		PassMethod			m_pPass;
+
+		PassRecorder( EffectGlobalIllum2& _Owner, PassMethod _pPass ) : m_Owner( _Owner ), m_pPass( _pPass )	{}
+		virtual void	Record( CommandList& _CommandList )	{ (m_Owner.*m_pPass)(); }
+	};
+#endif
 	
 #pragma pack( push, 4 )
 
@@ -39,6 +105,10 @@ protected:	// NESTED TYPES
 
 	struct CBObject {
 		float4x4	Local2World;	// Local=>World transform to rotate the object
+		float3		QuantizationMin;	// Bounds of the primitive's packed positions (cf. PACKED_SCENE_VERTICES)
+		float		__PAD0;
+		float3		QuantizationSize;
+		U32			InstancesStart;		// Index of the first transform of the instance group being drawn (cf. INSTANCED_SHADOW_MAPS)
  	};
 
 	struct CBObjectVoronoi {
@@ -49,9 +119,12 @@ protected:	// NESTED TYPES
 		float3	dUV;
 	};
 
-	struct CBDynamicObject {
+	// WARNING: must match the DynamicObjectInstance structure in Inc/DynamicObjects.hlsl!
+	struct DynamicObjectInstance {
 		float3		Position;
-		U32			ProbeID;
+		float		Radius;
+		float3		PreviousPosition;			// Position at the previous frame
+		U32			__PAD;
  	};
 
 	struct CBMaterial {
@@ -69,6 +142,12 @@ protected:	// NESTED TYPES
 		U32			HasNormalTexture;
 	};
 
+	// WARNING: must match the MaterialTextures structure in Inc/MaterialTextureArrays.hlsl!
+	struct MaterialTextures {
+		U32			pSlots[3];		// Slots of the diffuse, normal & specular textures (cf. TextureArrayPacker::GetSlot()), ~0U if the material doesn't have the texture
+		U32			__PAD;
+	};
+
 	struct CBShadowMap {
 		float4x4	Light2World;
 		float4x4	World2Light;
@@ -82,6 +161,29 @@ protected:	// NESTED TYPES
 		float		FarClipDistance;
 	};
 
+	struct CBSunShadowCascades {
+		float4x4	World2Cascade[SUN_SHADOW_CASCADES_COUNT];	// Maps each cascade to [(-1,-1,0),(+1,+1,1)] like World2Light
+		float4		Bias;										// Depth bias of each cascade
+	};
+
+	struct CBShadowAtlas {
+		float3		Position;					// Position of the light being rendered into the atlas
+		float		FarClipDistance;
+	};
+
+	struct CBLightClusters {
+		U32			ClustersX, ClustersY, ClustersZ;
+		U32			MaxIndices;					// Size of the index list
+		float2		ZNearFar;					// Depth range covered by the slices
+		float2		ScreenSize;
+		float		InfluenceThreshold;			// Irradiance below which a light doesn't affect a cluster anymore
+	};
+
+	struct	CBSkySH {
+		float3		SkyColor;					// Intensity * color, zero when the sky is disabled
+		float		__PAD;
+	};
+
 	// Structured Buffers
 	// Light buffer
 	struct	LightStruct
@@ -93,6 +195,23 @@ protected:	// NESTED TYPES
 		float4		Parms;						// X=Falloff radius, Y=Cutoff radius, Z=Cos(Falloff angle), W=Cos(Cutoff angle)
 	};
 
+	// A shadowed light in the atlas
+	struct	ShadowAtlasLight
+	{
+		float3		Position;
+		float		FarClipDistance;
+		float2		UVOrigin;					// UV of the slot's top-left corner
+		float		UVFaceSize;					// UV size of a face's viewport (faces are always a page apart)
+		float		__PAD;
+	};
+
+	// Range of a cluster's lights in the cluster light indices
+	struct	ClusterRange
+	{
+		U32			Start;
+		U32			Count;
+	};
+
 #pragma pack( pop )
 
 	// Functors for using probe network
@@ -103,11 +222,76 @@ protected:	// NESTED TYPES
 			for ( int MeshIndex=0; MeshIndex < m_this.m_Scene.m_MeshesCount; MeshIndex++ )
 				m_this.RenderMesh( *m_this.m_ppCachedMeshes[MeshIndex], &_Material, true );
 		}
+		void	operator()( Shader& _Material, MultiView& _Views ) {
+			// The meshes are culled once for all the views and drawn once, instanced for each view seeing them
+			_Views.Cull( m_this.m_MeshesCuller, m_this.m_pVisibleMeshesScene );
+			for ( int MeshIndex=0; MeshIndex < m_this.m_Scene.m_MeshesCount; MeshIndex++ ) {
+				U8	ViewMask = m_this.m_pVisibleMeshesScene[MeshIndex];
+				if ( ViewMask == 0 )
+					continue;
+
+				_Views.SetObjectMask( ViewMask );
+				m_this.RenderMesh( *m_this.m_ppCachedMeshes[MeshIndex], &_Material, true, *m_this.m_pCB_Object, NULL, MultiView::GetInstancesCount( ViewMask ) );
+			}
+		}
+	};
+
+#ifdef VOXEL_CONE_TRACED_GI
+	// Functor for voxelizing the meshes overlapping a level of the voxel clipmap, with their material so the albedo gets voxelized too
+	class	VoxelizeScene : public VoxelGI::IVoxelizeScene {
+	public:	EffectGlobalIllum2&	m_this;
+		VoxelizeScene( EffectGlobalIllum2& _this ) : m_this( _this ) {}
+		void	operator()( Shader& _Material, const float4x4& _World2Level ) {
+			m_this.m_MeshesCuller.Cull( _World2Level, m_this.m_pVisibleMeshesVoxels );
+			for ( int MeshIndex=0; MeshIndex < m_this.m_Scene.m_MeshesCount; MeshIndex++ )
+				if ( m_this.m_pVisibleMeshesVoxels[MeshIndex] )
+					m_this.RenderMesh( *m_this.m_ppCachedMeshes[MeshIndex], &_Material, true );
+		}
+	};
+#endif
+
+	// Tells how many pixels a world size covers in a view so primitives can pick their LOD (cf. Scene::Mesh::Primitive::SelectLOD())
+	struct	LODView {
+		float3		Position;			// Position of the viewer (perspective views only)
+		float		PixelsPerUnit;		// Pixels covered by a unit size (at a unit distance for perspective views)
+		bool		bOrthographic;
+
+		float		GetProjectedSize( const Scene::Mesh::Primitive& _Primitive ) const;
+	};
+
+	// The passes rendered through the frame's render graph (cf. ExecutePass())
+	enum	RENDER_PASS {
+		PASS_SCENE,
+		PASS_LIGHTS,
+		PASS_DYNAMIC_OBJECTS,
+		PASS_DEPTH_PYRAMID,				// Shared min/max depth pyramid (cf. Utility/DepthPyramid.h)
+		PASS_DEBUG_PROBES,
+		PASS_CAMERA_VELOCITY,			// Camera motion from the depth (cf. TEMPORAL_AA)
+		PASS_OBJECTS_VELOCITY,			// Dynamic objects motion drawn over the camera motion (cf. TEMPORAL_AA)
+		PASS_POST_PROCESS,				// Anti-aliasing, tone mapping & output to the back buffer
+		PASS_DEBUG_PROBE_VORONOI,
+	};
+
+	// A primitive to draw in the scene pass along with its sort key (cf. BuildDrawItemKey())
+	struct	DrawItem {
+		U64					Key;
+		const Scene::Mesh*	pMesh;
+		int					PrimitiveIndex;
 	};
 
 
 protected:
 
+	// A slot of the shadow atlas, owned by a light until it gets evicted by a more important one
+	struct	ShadowAtlasSlot
+	{
+		U32			LightIndex;					// Static lights are numbered first, followed by the dynamic lights (SHADOW_ATLAS_NO_SLOT if free)
+		U32			LastUsedFrame;				// Last frame the light was selected, the least recently used slot gets evicted first
+		U32			Level;						// Faces are rendered at SHADOW_ATLAS_PAGE_SIZE >> Level
+		float4		Light;						// XYZ=Position W=Far clip distance the faces were rendered with
+		bool		bRendered;
+	};
+
 	struct	DynamicObject
 	{
 		float3		PositionStart;
@@ -122,15 +306,50 @@ private:	// FIELDS
 	Device&				m_Device;
 	Texture2D&			m_RTTarget;
 	Primitive&			m_ScreenQuad;
+	Camera&				m_Camera;
 
 	Shader*			m_pMatRender;					// Displays the scene
 	Shader*			m_pMatRenderEmissive;			// Displays the scene's emissive objects (area lights)
+#ifdef DEPTH_PREPASS
+	Shader*			m_pMatRenderDepthPrepass;		// Renders the scene's depth only, from the position-only streams
+#endif
+
+	// Pipeline states of the scene pass (cf. GetScenePipelineState())
+	PipelineState*	m_pPSO_Scene;
+	PipelineState*	m_pPSO_SceneEmissive;
+#ifdef DEPTH_PREPASS
+	PipelineState*	m_pPSO_SceneAfterPrepass;		// Same without depth writes, only shading the pixels laid by the prepass
+	PipelineState*	m_pPSO_SceneEmissiveAfterPrepass;
+	PipelineState*	m_pPSO_DepthPrepass;
+#endif
 	Shader*			m_pMatRenderLights;				// Displays the lights as small emissive balls
 	Shader*			m_pMatRenderDynamic;			// Displays the dynamic objects as balls with a normal map
 	Shader*			m_pCSComputeShadowMapBounds;	// Computes the shadow map bounds
+#ifdef CLUSTERED_LIGHTS
+	ComputeShader*		m_pCSCullLightClusters;			// Assigns the lights to the camera clusters
+#endif
+	ComputeShader*		m_pCSSkySH;						// Projects the ambient sky onto SH9 (cf. UpdateSkySH())
 	Shader*			m_pMatRenderShadowMap;			// Renders the directional shadowmap
 	Shader*			m_pMatRenderShadowMapPoint;		// Renders the point light shadowmap
+#ifdef SHADOW_ATLAS
+	Shader*			m_pMatRenderShadowAtlas;			// Renders the 6 faces of a light into its atlas slot at once
+	Shader*			m_pMatClearShadowAtlas;				// Resets a slot to the far plane
+#endif
+#ifdef CACHED_SHADOW_MAPS
+	Shader*			m_pMatRenderShadowMapDynamic;		// Renders the dynamic objects over the cached directional shadowmap
+	Shader*			m_pMatRenderShadowMapPointDynamic;	// Renders the dynamic objects over the cached point light shadowmap
+#endif
 	Shader*			m_pMatPostProcess;				// Post-processes the result
+#ifdef AUTO_EXPOSURE
+	ToneMapper*		m_pToneMapper;					// Replaces the post-process
+#endif
+	RenderGraph*	m_pRenderGraph;					// Resolves the bindings between the passes of the frame
+#ifdef TEMPORAL_AA
+	TemporalAA*		m_pTemporalAA;
+#endif
+#ifdef VOXEL_CONE_TRACED_GI
+	VoxelGI*		m_pVoxelGI;						// Replaces the probes' indirect lighting in the scene shader
+#endif
 	Shader*			m_pMatRenderDebugProbes;		// Displays the probes as small spheres
 	Shader*			m_pMatRenderDebugProbesNetwork;	// Displays the probes network
 	Shader*			m_pMatRenderDebugProbeVoronoi;	// Displays the probe Vorono cells
@@ -141,6 +360,12 @@ private:	// FIELDS
 	float3				m_SceneBBoxMax;
 	CompositeVertexFormatDescriptor	m_SceneVertexFormatDesc;
 	bool				m_bDeleteSceneTags;
+	GeometryPool*		m_pScenePool;		// Shared buffers of the scene primitives (only with POOLED_SCENE_GEOMETRY)
+	GeometryPool*		m_pSceneDepthPool;	// Shared buffer of their position-only streams (only with POOLED_SCENE_GEOMETRY & DEPTH_VERTEX_STREAMS)
+#ifdef SCENE_HOT_RELOAD
+	FileWatcher*		m_pSceneWatcher;	// Watches the directory of the scene file
+	List<U8*>			m_ReloadedScenes;	// Data of the reloaded scene files, the meshes taken from them point into it
+#endif
 	Primitive*			m_pPrimSphere;
 	Primitive*			m_pPrimPoint;
 
@@ -149,7 +374,38 @@ private:	// FIELDS
 	Primitive*			m_pPrimVoronoiCellEdges;
 
 		// Cached list of meshes
-	Scene::Mesh**		m_ppCachedMeshes;
+	Scene::Mesh**		m_ppCachedMeshes;	// The scene's own array of meshes (not owned)
+
+		// Frustum culling of the cached meshes, each pass has its own visibility array since passes can be recorded in parallel
+	BoundsCuller		m_MeshesCuller;
+	U8*					m_pVisibleMeshesScene;
+	U8*					m_pVisibleMeshesShadowMap;
+	U8*					m_pVisibleMeshesShadowMapPoint;
+	U8*					m_pVisibleMeshesShadowAtlas;
+#ifdef VOXEL_CONE_TRACED_GI
+	U8*					m_pVisibleMeshesVoxels;
+#endif
+#ifdef OCCLUSION_CULLING
+		// Software occlusion of the scene pass, rasterized from the camera while the shadow maps are rendered
+	OcclusionCuller		m_OcclusionCuller;
+	List<int>			m_OccluderMeshes;	// Index of the mesh of each occluder
+#endif
+
+		// Render queue of the scene pass, rebuilt & sorted by state then depth each frame
+	U32					m_DrawItemsCount;
+	DrawItem			m_pDrawItems[MAX_SCENE_PRIMITIVES];
+	DrawItem			m_pDrawItemsTemp[MAX_SCENE_PRIMITIVES];
+
+#ifdef DEPTH_PREPASS
+		// Overdraw heuristic: the pixel shader invocations of the scene pass are read back a few frames late
+	ID3D11Query*		m_ppQueriesOverdraw[OVERDRAW_QUERIES_COUNT];
+	bool				m_pQueriesOverdrawPending[OVERDRAW_QUERIES_COUNT];
+	U32					m_pQueriesOverdrawFrameIndex[OVERDRAW_QUERIES_COUNT];
+	int					m_OverdrawQueryIndex;	// Query issued by this frame's scene pass, -1 if not measured
+	float				m_Overdraw;				// Last measured shaded pixels per screen pixel without the prepass
+	bool				m_bDepthPrepass;		// Enabled by the heuristic
+	bool				m_bDepthPrepassFrame;	// The scene pass of this frame starts with the prepass
+#endif
 
 		// Cached list of materials
 	int					m_EmissiveMaterialsCount;
@@ -164,14 +420,52 @@ private:	// FIELDS
 
 		// Dynamic objects
 	DynamicObject		m_pDynamicObjects[MAX_DYNAMIC_OBJECTS];
+	U32					m_DynamicObjectsCount;
+	float3				m_pDynamicObjectPositions[MAX_DYNAMIC_OBJECTS];	// Animated at the start of the frame so the shadow maps can use them
+#ifdef TEMPORAL_AA
+	float3				m_pDynamicObjectPreviousPositions[MAX_DYNAMIC_OBJECTS];	// Positions of the previous frame for the velocity buffer
+#endif
 
 
 	// Textures
 	int					m_TexturesCount;
 	Texture2D**			m_ppTextures;
+#ifdef STREAMED_TEXTURES
+	TextureStreamer*	m_pTextureStreamer;				// Streams the mips of the scene textures (NULL if they're not loaded from files)
+#endif
+#ifdef TEXTURE_ARRAYS
+	TextureArrayPacker*	m_pTexturePacker;				// Owns the arrays, m_ppTextures then points to the array of each texture
+	SB<MaterialTextures>*	m_pSB_MaterialTextures;		// (SRV) Texture slots of each scene material, indexed by material ID
+#endif
 	Texture2D*			m_pTexDynamicNormalMap;
 	Texture2D*			m_pRTShadowMap;
 	Texture2D*			m_pRTShadowMapPoint;
+#ifdef CULLED_POINT_SHADOW_FACES
+	MultiView*			m_pShadowMapPointViews;			// The 6 faces of the point light's cube, m_pVisibleMeshesShadowMapPoint then receives the faces overlapped by each mesh
+#endif
+#ifdef CACHED_SHADOW_MAPS
+	Texture2D*			m_pRTShadowMapStatic;			// Static scene depth, only re-rendered when the sun moves
+	Texture2D*			m_pRTShadowMapPointStatic;		// Static scene depth, only re-rendered when the point light moves
+	float4x4			m_ShadowMapStaticWorld2Light;	// Light transform the cache was rendered with
+	float4				m_ShadowMapPointStaticLight;	// XYZ=Position W=Far clip distance the cache was rendered with
+	bool				m_bShadowMapStaticDirty;
+	bool				m_bShadowMapPointStaticDirty;
+#endif
+#ifdef SHADOW_ATLAS
+	Texture2D*			m_pRTShadowAtlas;
+	ShadowAtlasSlot		m_pShadowAtlasSlots[SHADOW_ATLAS_SLOTS_COUNT];
+	U32					m_ShadowAtlasFrameIndex;
+	U32					m_ShadowAtlasRenderSlotsCount;
+	U32					m_pShadowAtlasRenderSlots[SHADOW_ATLAS_MAX_RENDERS_PER_FRAME];	// Slots to render this frame
+#endif
+#ifdef SUN_SHADOW_CASCADES
+	Texture2D*			m_pRTSunShadowCascades;
+	float4x4			m_pSunShadowCascadesLight2World[SUN_SHADOW_CASCADES_COUNT];	// Transform each cascade was last rendered with
+	float3				m_SunShadowCascadesSunDirection;	// Sun direction the cascades were rendered with, all of them are updated when it changes
+	U32					m_SunShadowCascadesFrameIndex;
+	U32					m_SunShadowCascadesRenderMask;		// Cascades to render this frame
+	bool				m_bSunShadowMapUpdate;				// The whole scene shadow map is updated every 4th frame as well
+#endif
 
 	// Constant buffers
  	CB<CBGeneral>*			m_pCB_General;
@@ -179,18 +473,60 @@ private:	// FIELDS
  	CB<CBObject>*			m_pCB_Object;
 	CB<CBObjectVoronoi>*	m_pCB_ObjectVoronoi;
 	CB<CBSplat>*			m_pCB_Splat;
-	CB<CBDynamicObject>*	m_pCB_DynamicObject;
  	CB<CBMaterial>*			m_pCB_Material;
  	CB<CBShadowMap>*		m_pCB_ShadowMap;
  	CB<CBShadowMapPoint>*	m_pCB_ShadowMapPoint;
+#ifdef CLUSTERED_LIGHTS
+	CB<CBLightClusters>*	m_pCB_LightClusters;
+#endif
+#ifdef SHADOW_ATLAS
+	CB<CBShadowAtlas>*		m_pCB_ShadowAtlas;
+#endif
+	CB<CBSkySH>*			m_pCB_SkySH;
+#ifdef SUN_SHADOW_CASCADES
+	CB<CBSunShadowCascades>*	m_pCB_SunShadowCascades;
+	CB<CBShadowMap>*		m_pCB_SunShadowCascadeRender;	// Replaces the whole scene's shadow map constants while rendering a cascade
+#endif
+
+#ifdef PARALLEL_RECORDING
+	// Passes recorded in parallel, each one needs its own object CB since components are not thread-safe
+	CB<CBObject>*			m_pCB_ObjectShadowMap;
+	CB<CBObject>*			m_pCB_ObjectShadowMapPoint;
+
+	CommandList*			m_pCLShadowMap;
+	CommandList*			m_pCLShadowMapPoint;
+	CommandList*			m_pCLScene;
+
+	PassRecorder			m_RecorderShadowMap;
+	PassRecorder			m_RecorderShadowMapPoint;
+	PassRecorder			m_RecorderScene;
+#endif
 
 	// Runtime scene lights
 	SB<LightStruct>*	m_pSB_LightsStatic;
-	SB<LightStruct>*	m_pSB_LightsDynamic;
+	SB<float4x4>*		m_pSB_InstanceTransforms;	// Local=>World transforms of all the scene instances, group after group (only with INSTANCED_SHADOW_MAPS)
+	FrameSB<LightStruct>*	m_pSB_LightsDynamic;		// Updated each frame so they're ring buffered (cf. FrameSB)
+	FrameSB<DynamicObjectInstance>*	m_pSB_DynamicObjects;	// Instances of the dynamic objects, updated each frame (cf. Inc/DynamicObjects.hlsl)
+#ifdef CACHED_SHADOW_MAPS
+	FrameSB<float4x4>*	m_pSB_DynamicObjectTransforms;	// Local=>World transforms of the dynamic objects for the instanced shadow passes (cf. Inc/SceneInstancing.hlsl)
+#endif
+	float4				m_LastPointLight;		// Influence sphere of the point light at last frame, to detect changes for the probes' update
+	float				m_DeltaTime;			// Duration of the frame being rendered, for the passes executed by the render graph
+#ifdef CLUSTERED_LIGHTS
+	SB<ClusterRange>*	m_pSB_ClusterRanges;
+	SB<U32>*			m_pSB_ClusterLightIndices;	// Static lights are numbered first, followed by the dynamic lights
+	SB<U32>*			m_pSB_ClusterIndicesCounter;
+#endif
+#ifdef SHADOW_ATLAS
+	SB<U32>*			m_pSB_ShadowAtlasLightSlots;	// Slot of each static & dynamic light
+	SB<ShadowAtlasLight>*	m_pSB_ShadowAtlasLights;	// Lights of each slot
+#endif
 
 
-	// Ambient SH computed from CIE overcast sky model
-	float3				m_pSHAmbientSky[9];
+	// Ambient sky SH computed on the GPU from the CIE overcast sky model (cf. Inc/SkySH.hlsl)
+	SB<float4>*			m_pSB_SkySH;			// 9 radiance coefficients followed by the 9 irradiance coefficients
+	float3				m_SkySHColor;			// Sky color the SH were last projected with
+	bool				m_bSkySHValid;
 
 	// Probes network
 	SHProbeNetwork		m_ProbesNetwork;
@@ -286,10 +622,67 @@ public:		// METHODS
 	// ISceneRenderer Implementation
 	virtual void	RenderMesh( const Scene::Mesh& _Mesh, Shader* _pMaterialOverride, bool _SetMaterial ) override;
 
+	// IRenderPass Implementation
+	virtual void	ExecutePass( RenderGraph& _Graph, U32 _PassID ) override;
+
 private:
 
-	void			RenderShadowMap( const float3& _SunDirection );
-	void			RenderShadowMapPoint( const float3& _Position, float _FarClipDistance );
+	// Shadow maps are rendered in 2 steps: the preparation updates the constant buffers on the immediate context
+	//	while the rendering only issues draw calls and can be recorded on another thread
+	void			PrepareShadowMap( const float3& _SunDirection );
+	void			RenderShadowMap();
+	void			RenderShadowMapStatic( Texture2D& _Target, CB<CBObject>& _CBObject );
+	void			PrepareShadowMapPoint( const float3& _Position, float _FarClipDistance );
+	void			RenderShadowMapPoint();
+	void			RenderShadowMapPointStatic( Texture2D& _Target, CB<CBObject>& _CBObject );
+#ifdef CACHED_SHADOW_MAPS
+	void			RenderShadowMapDynamicObjects( Shader& _Material, Texture2D& _Target, CB<CBObject>& _CBObject, int _SliceIndex=-1 );	// Renders into all the slices by default
+#endif
+#ifdef SUN_SHADOW_CASCADES
+	void			PrepareSunShadowCascades( const float3& _SunDirection, const float4x4& _Light2World, const float3& _BBoxMin, const float3& _BBoxMax );
+	void			RenderSunShadowCascades( CB<CBObject>& _CBObject );
+#endif
+	void			RenderInstanceGroups( const U8* _pVisibleMeshes, Shader& _Material, CB<CBObject>& _CBObject, const LODView& _View );
+
+#ifdef SHADOW_ATLAS
+	// The atlas is prepared before the scene pass gets recorded but rendered on the immediate context once the deferred passes are done
+	void			PrepareShadowAtlas();
+	void			RenderShadowAtlas();
+#endif
+
+#ifdef CLUSTERED_LIGHTS
+	void			CullLightClusters();
+#endif
+
+	void			UpdateSkySH( const float3& _SkyColor );
+
+#ifdef SCENE_HOT_RELOAD
+	void			HotReloadScene();
+#endif
+
+#ifdef OCCLUSION_CULLING
+	void			BuildOccluders();
+#endif
+
+	void			RenderScene();
+	void			RenderMesh( const Scene::Mesh& _Mesh, Shader* _pMaterialOverride, bool _SetMaterial, CB<CBObject>& _CBObject, const LODView* _pLODView=NULL, int _InstancesCount=1 );	// Without a view, LOD 0 is used
+	void			RenderPrimitive( Primitive& _Primitive, const Scene::Mesh::Primitive& _ScenePrimitive, Shader& _Material, int _LODIndex, int _InstancesCount=1 );
+
+#ifdef TEXTURE_ARRAYS
+	void			BindMaterialTextureArrays() const;
+#endif
+	void			GetMaterialTextures( const Scene::Material& _Material, Texture2D** _ppTextures ) const;	// Diffuse, normal & specular textures, NULL if not available
+	void			UpdateMaterialCB( const Scene::Material& _Material, const Primitive& _Primitive, Texture2D** _ppTextures );
+
+	// Scene pass render queue
+	const PipelineState&	GetScenePipelineState( const Shader& _Material, bool _bAfterPrepass ) const;
+	U64				BuildDrawItemKey( const Scene::Mesh& _Mesh, const Scene::Mesh::Primitive& _Primitive, const PipelineState& _PipelineState, const float3& _CameraPosition, float _InvMaxDistance ) const;
+	static void		SortDrawItems( U32 _Count, DrawItem* _pItems, DrawItem* _pTemp );
+	void			RenderDrawItems( bool _bAfterPrepass );
+#ifdef DEPTH_PREPASS
+	void			RenderDrawItemsDepth();
+	void			UpdateDepthPrepass();
+#endif
 
 	void			BuildVoronoiPrimitives();
 
@@ -3,12 +3,24 @@
 
 #define CHECK_MATERIAL( pMaterial, ErrorCode )		if ( (pMaterial)->HasErrors() ) m_ErrorCode = ErrorCode;
 
+#ifdef PARTICLES_COMPUTE
+const float	EffectParticles::PARTICLES_LIFE_TIME = 4.0f;
+#endif
+
 EffectParticles::EffectParticles() : m_ErrorCode( 0 )
 {
 	//////////////////////////////////////////////////////////////////////////
 	// Create the materials
+#ifdef PARTICLES_COMPUTE
+	CHECK_MATERIAL( m_pCSEmit = CreateComputeShader( IDR_SHADER_PARTICLES_SIMULATE_CS, "./Resources/Shaders/ParticlesSimulateCS.hlsl", "CS_Emit" ), 4 );
+	CHECK_MATERIAL( m_pCSSimulate = CreateComputeShader( IDR_SHADER_PARTICLES_SIMULATE_CS, "./Resources/Shaders/ParticlesSimulateCS.hlsl", "CS_Simulate" ), 5 );
+	CHECK_MATERIAL( m_pCSSortLocal = CreateComputeShader( IDR_SHADER_PARTICLES_SIMULATE_CS, "./Resources/Shaders/ParticlesSimulateCS.hlsl", "CS_SortLocal" ), 6 );
+	CHECK_MATERIAL( m_pCSSortStep = CreateComputeShader( IDR_SHADER_PARTICLES_SIMULATE_CS, "./Resources/Shaders/ParticlesSimulateCS.hlsl", "CS_SortStep" ), 7 );
+	CHECK_MATERIAL( m_pMatDisplayQuads = CreateMaterial( IDR_SHADER_PARTICLES_DISPLAY_QUADS, "./Resources/Shaders/ParticlesDisplayQuads.hlsl", VertexFormatPt4::DESCRIPTOR, "VS", NULL, "PS" ), 8 );
+#else
 	CHECK_MATERIAL( m_pMatCompute = CreateMaterial( IDR_SHADER_PARTICLES_COMPUTE, "./Resources/Shaders/ParticlesCompute.hlsl", VertexFormatPt4::DESCRIPTOR, "VS", NULL, "PS" ), 1 );
 	CHECK_MATERIAL( m_pMatDisplay = CreateMaterial( IDR_SHADER_PARTICLES_DISPLAY, "./Resources/Shaders/ParticlesDisplay.hlsl", VertexFormatPt4::DESCRIPTOR, "VS", "GS", "PS" ), 2 );
+#endif
 	CHECK_MATERIAL( m_pMatDebugVoronoi = CreateMaterial( IDR_SHADER_PARTICLES_DISPLAY, "./Resources/Shaders/ParticlesDisplay.hlsl", VertexFormatPt4::DESCRIPTOR, "VS_DEBUG", NULL, "PS_DEBUG" ), 3 );
 
 
@@ -66,6 +78,30 @@ EffectParticles::EffectParticles() : m_ErrorCode( 0 )
 		delete[] pVertices;
 	}
 
+#ifdef PARTICLES_COMPUTE
+	delete[]	pCellCenters;
+
+	//////////////////////////////////////////////////////////////////////////
+	// Create the particles pool, all the particles start dead with their slot in the dead list
+	m_pSB_Particles = new SB<Particle>( gs_Device, MAX_PARTICLES_COUNT, true );
+	memset( m_pSB_Particles->m, 0, MAX_PARTICLES_COUNT*sizeof(Particle) );
+	m_pSB_Particles->Write();
+
+	m_pSB_DeadList = new SB<U32>( gs_Device, MAX_PARTICLES_COUNT, true );
+	for ( U32 ParticleIndex=0; ParticleIndex < MAX_PARTICLES_COUNT; ParticleIndex++ )
+		m_pSB_DeadList->m[ParticleIndex] = ParticleIndex;
+	m_pSB_DeadList->Write();
+
+	m_pSB_SortList = new SB<SortEntry>( gs_Device, MAX_PARTICLES_COUNT, true );
+
+	m_pSB_Counters = new SB<U32>( gs_Device, 2, true );
+	m_pSB_Counters->m[0] = MAX_PARTICLES_COUNT;
+	m_pSB_Counters->m[1] = 0;
+	m_pSB_Counters->Write();
+
+	m_EmitFraction = 0.0f;
+
+#else
 	//////////////////////////////////////////////////////////////////////////
 	// Build the initial positions & orientations of the particles from the surface of a torus
 	PixelFormatRGBA32F*	pInitialPositions = new PixelFormatRGBA32F[EFFECT_PARTICLES_COUNT*EFFECT_PARTICLES_COUNT];
@@ -168,12 +204,25 @@ EffectParticles::EffectParticles() : m_ErrorCode( 0 )
 	m_ppRTParticleTangents[0]->CopyFrom( *pTempTangents );
 	m_ppRTParticleTangents[1]->CopyFrom( *pTempTangents );
 	delete pTempTangents;
+#endif
 
 
 	//////////////////////////////////////////////////////////////////////////
 	// Create the constant buffers
 	m_pCB_Render = new CB<CBRender>( gs_Device, 10 );
 	m_pCB_Render->m.DeltaTime.Set( 0, 1 );
+
+#ifdef PARTICLES_COMPUTE
+	m_pCB_Simulate = new CB<CBSimulate>( gs_Device, 11 );
+	m_pCB_Simulate->m.MaxParticlesCount = MAX_PARTICLES_COUNT;
+	m_pCB_Simulate->m.EmitterCenter.Set( 0, 0.8f, 0 );
+	m_pCB_Simulate->m.EmitterGreatRadius = 0.5f;
+	m_pCB_Simulate->m.EmitterSmallRadius = 0.2f;
+	m_pCB_Simulate->m.LifeTime = PARTICLES_LIFE_TIME;
+	m_pCB_Simulate->m.ParticleSize = 0.01f;
+
+	m_pCB_Sort = new CB<CBSort>( gs_Device, 12, false, Device::SSF_COMPUTE_SHADER );
+#endif
 }
 
 EffectParticles::~EffectParticles()
@@ -182,6 +231,15 @@ EffectParticles::~EffectParticles()
 
 	delete m_pCB_Render;
 
+#ifdef PARTICLES_COMPUTE
+	delete m_pCB_Sort;
+	delete m_pCB_Simulate;
+
+	delete m_pSB_Counters;
+	delete m_pSB_SortList;
+	delete m_pSB_DeadList;
+	delete m_pSB_Particles;
+#else
 	delete m_ppRTParticleTangents[0];
 	delete m_ppRTParticleTangents[1];
 	delete m_ppRTParticleNormals[0];
@@ -189,16 +247,84 @@ EffectParticles::~EffectParticles()
 	delete m_ppRTParticlePositions[2];
 	delete m_ppRTParticlePositions[1];
 	delete m_ppRTParticlePositions[0];
+#endif
 
 	delete m_pPrimParticle;
 
+#ifdef PARTICLES_COMPUTE
+	delete m_pMatDisplayQuads;
+	delete m_pCSSortStep;
+	delete m_pCSSortLocal;
+	delete m_pCSSimulate;
+	delete m_pCSEmit;
+#else
 	delete m_pMatCompute;
  	delete m_pMatDisplay;
+#endif
 	delete m_pMatDebugVoronoi;
 }
 
 void	EffectParticles::Render( float _Time, float _DeltaTime )
 {
+#ifdef PARTICLES_COMPUTE
+	//////////////////////////////////////////////////////////////////////////
+	// 1] Emit & simulate the particles
+	// Emit at the rate that keeps the pool full
+	float	EmitCount = m_EmitFraction + MAX_PARTICLES_COUNT * _DeltaTime / PARTICLES_LIFE_TIME;
+	U32		EmitIntCount = MIN( U32( floorf( EmitCount ) ), U32(MAX_PARTICLES_COUNT) );
+	m_EmitFraction = EmitCount - floorf( EmitCount );
+
+	m_pCB_Simulate->m.EmitCount = EmitIntCount;
+	m_pCB_Simulate->m.DeltaTime = _DeltaTime;
+	m_pCB_Simulate->m.Time = _Time;
+	m_pCB_Simulate->m.EmissivePower = m_EmissivePower;
+	m_pCB_Simulate->UpdateData();
+
+	// Unused entries of the sort list must end up last
+	U32	pClearKeys[4] = { ~0U, ~0U, ~0U, ~0U };
+	m_pSB_SortList->Clear( pClearKeys );
+
+	{	USING_COMPUTESHADER_START( *m_pCSEmit )
+
+		m_pSB_Particles->SetOutput( 0 );
+		m_pSB_DeadList->SetOutput( 1 );
+		m_pSB_SortList->SetOutput( 2 );
+		m_pSB_Counters->SetOutput( 3 );
+
+		U32	GroupsCount = MAX( 1U, (EmitIntCount + SIMULATE_THREADS_COUNT-1) / SIMULATE_THREADS_COUNT );	// Always run the thread resetting the sort counter
+		M.Dispatch( GroupsCount, 1, 1 );
+
+		USING_COMPUTE_SHADER_END
+	}
+
+	{	USING_COMPUTESHADER_START( *m_pCSSimulate )
+
+		M.Dispatch( MAX_PARTICLES_COUNT / SIMULATE_THREADS_COUNT, 1, 1 );
+
+		USING_COMPUTE_SHADER_END
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+	// 2] Sort them back to front
+	SortParticles();
+
+	//////////////////////////////////////////////////////////////////////////
+	// 3] Render the particles
+	{	USING_MATERIAL_START( *m_pMatDisplayQuads )
+
+		gs_Device.SetRenderTarget( gs_Device.DefaultRenderTarget(), &gs_Device.DefaultDepthStencil() );
+		gs_Device.SetStates( gs_Device.m_pRS_CullNone, gs_Device.m_pDS_ReadLessEqual, gs_Device.m_pBS_AlphaBlend );
+
+		m_pSB_Particles->SetInput( 10 );
+		m_pSB_SortList->SetInput( 11 );
+		m_pSB_Counters->SetInput( 12 );
+
+		gs_pPrimQuad->RenderInstanced( M, MAX_PARTICLES_COUNT );
+
+		USING_MATERIAL_END
+	}
+
+#else
 	//////////////////////////////////////////////////////////////////////////
 	// 1] Update particles' positions
 	{	USING_MATERIAL_START( *m_pMatCompute )
@@ -259,6 +385,7 @@ void	EffectParticles::Render( float _Time, float _DeltaTime )
 
 		USING_MATERIAL_END
 	}
+#endif
 
 // DEBUG
 {	USING_MATERIAL_START( *m_pMatDebugVoronoi )
@@ -284,6 +411,54 @@ void	EffectParticles::Render( float _Time, float _DeltaTime )
 // DEBUG
 }
 
+#ifdef PARTICLES_COMPUTE
+//////////////////////////////////////////////////////////////////////////
+// Bitonic sort of the whole sort list (cf. ParticlesSimulateCS.hlsl)
+// Blocks of SORT_GROUP_SIZE entries are first sorted in groupshared memory, then each merge of larger sequences runs the strides
+//	that span several groups one dispatch at a time and finishes with the strides that fit in a group.
+//
+void	EffectParticles::SortParticles()
+{
+	U32	GroupsCount = MAX_PARTICLES_COUNT / SORT_GROUP_SIZE;
+
+	m_pCB_Sort->m.BlockSize = 0;
+	m_pCB_Sort->m.Stride = 0;
+	m_pCB_Sort->UpdateData();
+
+	{	USING_COMPUTESHADER_START( *m_pCSSortLocal )
+
+		m_pSB_SortList->SetOutput( 2 );
+		M.Dispatch( GroupsCount, 1, 1 );
+
+		USING_COMPUTE_SHADER_END
+	}
+
+	for ( U32 BlockSize=2*SORT_GROUP_SIZE; BlockSize <= MAX_PARTICLES_COUNT; BlockSize <<= 1 )
+	{
+		m_pCB_Sort->m.BlockSize = BlockSize;
+
+		{	USING_COMPUTESHADER_START( *m_pCSSortStep )
+
+			for ( U32 Stride=BlockSize >> 1; Stride >= SORT_GROUP_SIZE; Stride >>= 1 )
+			{
+				m_pCB_Sort->m.Stride = Stride;
+				m_pCB_Sort->UpdateData();
+				M.Dispatch( GroupsCount, 1, 1 );
+			}
+
+			USING_COMPUTE_SHADER_END
+		}
+
+		{	USING_COMPUTESHADER_START( *m_pCSSortLocal )
+
+			M.Dispatch( GroupsCount, 1, 1 );
+
+			USING_COMPUTE_SHADER_END
+		}
+	}
+}
+#endif
+
 namespace	// Drawers & Fillers
 {
 	struct	__VoronoiInfos
@@ -370,8 +545,20 @@ void	EffectParticles::BuildVoronoiTexture( TextureBuilder& _TB, float2* _pCellCe
 	Noise	N( 1 );
 			N.SetCellularWrappingParameters( EFFECT_PARTICLES_COUNT, EFFECT_PARTICLES_COUNT, EFFECT_PARTICLES_COUNT );
 
+	// Generate the positions of the center of each cell (in UV space)
+	for ( int Y=0; Y < EFFECT_PARTICLES_COUNT; Y++ )
+		for ( int X=0; X < EFFECT_PARTICLES_COUNT; X++ )
+			N.CellularGetCenter( X, Y, _pCellCenters[EFFECT_PARTICLES_COUNT*Y+X], true );
+
+	// Flood the cells on the GPU rather than testing each pixel against its neighbor cells (cf. FillVoronoi())
 	TextureBuilder	TempVoronoi( _TB.GetWidth(), _TB.GetHeight() );
-					TempVoronoi.Fill( ::FillVoronoi, &N );
+	{
+		JumpFlood	Flood( TempVoronoi.GetWidth(), TempVoronoi.GetHeight(), true );
+		if ( Flood.BuildVoronoi( _pCellCenters, EFFECT_PARTICLES_COUNT*EFFECT_PARTICLES_COUNT ) )
+			Flood.CopyTo( TempVoronoi, float(EFFECT_PARTICLES_COUNT) );	// Distances in cell units like FillVoronoi()
+		else
+			TempVoronoi.Fill( ::FillVoronoi, &N, true );
+	}
 
 	// Clear the vertices to wrong intervals
 	for ( int ParticleIndex=0; ParticleIndex < EFFECT_PARTICLES_COUNT*EFFECT_PARTICLES_COUNT; ParticleIndex++ )
@@ -379,7 +566,7 @@ void	EffectParticles::BuildVoronoiTexture( TextureBuilder& _TB, float2* _pCellCe
 
 	// Perturb the original vorono with a small noise to break the regular cell patterns
 	__PerturbVoronoi	S = { &N, &TempVoronoi, TempVoronoi.GetWidth(), TempVoronoi.GetHeight(), _pVertices };
-	_TB.Fill( ::PerturbVoronoi, &S );
+	_TB.Fill( ::PerturbVoronoi, &S );	// Not thread-safe: accumulates the particles' UV bounds
 
 	// Reparse vertices to make sure border particles wrap correctly
 // 	for ( int VertexIndex=0; VertexIndex < EFFECT_PARTICLES_COUNT*EFFECT_PARTICLES_COUNT; VertexIndex++ )
@@ -392,9 +579,4 @@ void	EffectParticles::BuildVoronoiTexture( TextureBuilder& _TB, float2* _pCellCe
 // 		ASSERT( DeltaU < 0.2f, "WTF?!" );
 // 		ASSERT( DeltaV < 0.2f, "WTF?!" );
 //  	}
-
-	// Generate the positions of the center of each cell (in UV space)
-	for ( int Y=0; Y < EFFECT_PARTICLES_COUNT; Y++ )
-		for ( int X=0; X < EFFECT_PARTICLES_COUNT; X++ )
-			N.CellularGetCenter( X, Y, _pCellCenters[EFFECT_PARTICLES_COUNT*Y+X], true );
 }
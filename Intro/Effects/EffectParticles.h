@@ -1,6 +1,7 @@
 #pragma once
 
 #define EFFECT_PARTICLES_COUNT	64
+#define PARTICLES_COMPUTE		// Define this to simulate a million particles in structured buffers with compute shaders (cf. ParticlesSimulateCS.hlsl)
 
 template<typename> class CB;
 
@@ -8,6 +9,13 @@ class EffectParticles
 {
 private:	// CONSTANTS
 
+#ifdef PARTICLES_COMPUTE
+	static const U32		MAX_PARTICLES_COUNT = 1 << 20;	// Must be a power of 2 for the bitonic sort
+	static const U32		SORT_GROUP_SIZE = 1024;			// Entries sorted in groupshared memory by a single group
+	static const U32		SIMULATE_THREADS_COUNT = 256;
+	static const float		PARTICLES_LIFE_TIME;			// Life time of a particle in seconds
+#endif
+
 public:		// NESTED TYPES
 
 	struct CBRender
@@ -17,6 +25,43 @@ public:		// NESTED TYPES
 		float2	DeltaTime;
 	};
 
+#ifdef PARTICLES_COMPUTE
+	struct CBSimulate
+	{
+		U32		MaxParticlesCount;
+		U32		EmitCount;
+		float	DeltaTime;
+		float	Time;
+
+		float3	EmitterCenter;
+		float	EmitterGreatRadius;
+		float	EmitterSmallRadius;
+		float	LifeTime;
+		float	ParticleSize;
+		float	EmissivePower;
+	};
+
+	struct CBSort
+	{
+		U32		BlockSize;
+		U32		Stride;
+	};
+
+	struct Particle
+	{
+		float3	Position;
+		float	Life;
+		float3	Velocity;
+		float	Seed;
+	};
+
+	struct SortEntry
+	{
+		U32		Key;
+		U32		ParticleIndex;
+	};
+#endif
+
 private:	// FIELDS
 
 	int					m_ErrorCode;
@@ -25,6 +70,24 @@ private:	// FIELDS
 	Shader*			m_pMatDisplay;
 	Shader*			m_pMatDebugVoronoi;
 
+#ifdef PARTICLES_COMPUTE
+	ComputeShader*		m_pCSEmit;
+	ComputeShader*		m_pCSSimulate;
+	ComputeShader*		m_pCSSortLocal;
+	ComputeShader*		m_pCSSortStep;
+	Shader*			m_pMatDisplayQuads;
+
+	SB<Particle>*		m_pSB_Particles;
+	SB<U32>*			m_pSB_DeadList;
+	SB<SortEntry>*		m_pSB_SortList;
+	SB<U32>*			m_pSB_Counters;		// [0]=Dead list size [1]=Live particles count
+
+	CB<CBSimulate>*		m_pCB_Simulate;
+	CB<CBSort>*			m_pCB_Sort;
+
+	float				m_EmitFraction;		// Fractional particles left to emit
+#endif
+
 	Primitive*			m_pPrimParticle;
 
 	Texture2D*			m_ppRTParticlePositions[3];
@@ -54,4 +117,8 @@ public:		// METHODS
 protected:
 	
 	void	BuildVoronoiTexture( TextureBuilder& _TB, float2* _pCellCenters, VertexFormatPt4* _pVertices );
+
+#ifdef PARTICLES_COMPUTE
+	void	SortParticles();
+#endif
 };
\ No newline at end of file
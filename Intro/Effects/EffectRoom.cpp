@@ -9,19 +9,33 @@ EffectRoom::EffectRoom( Texture2D& _RTTarget ) : m_ErrorCode( 0 ), m_RTTarget( _
 	// Create the materials
  	CHECK_MATERIAL( m_pMatDisplay = CreateMaterial( IDR_SHADER_ROOM_DISPLAY, "./Resources/Shaders/RoomDisplay.hlsl", VertexFormatP3N3G3T3T3::DESCRIPTOR, "VS", NULL, "PS" ), 1 );
  	CHECK_MATERIAL( m_pMatDisplayEmissive = CreateMaterial( IDR_SHADER_ROOM_DISPLAY, "./Resources/Shaders/RoomDisplay.hlsl", VertexFormatP3N3G3T3T3::DESCRIPTOR, "VS", NULL, "PS_Emissive" ), 2 );
+#ifdef PROGRESSIVE_LIGHTMAPS
+	CHECK_MATERIAL( m_pCSBakeLightMap = CreateComputeShader( IDR_SHADER_ROOM_BAKE_LIGHTMAP, "./Resources/Shaders/RoomBakeLightMap.hlsl", "CS" ), 7 );
+#endif
 
 	//////////////////////////////////////////////////////////////////////////
 	// Build the room geometry & compute lightmaps
 	{
-		TextureBuilder	TB( 2048, 1024 );
-		BuildRoomTextures( TB );
+		TextureGraph	Graph;
+#ifdef _DEBUG
+		Graph.SetCacheDirectory( "./TextureCache" );
+#endif
+		int	Walls = BuildRoomTextures( Graph );
+		Graph.Run();
+
+		const TextureBuilder&	TB = Graph.GetResult( Walls );
+		m_pTexWalls = TB.CreateTexture( PixelFormatRGBA16F::DESCRIPTOR, TextureBuilder::CONV_RGBA_NxNyHR_M );
 		BuildRoom( TB );
 	}
 
 	//////////////////////////////////////////////////////////////////////////
 	// Create the constant buffers
  	m_pCB_Object = new CB<CBObject>( gs_Device, 10 );
+	m_pCB_Object->SetTransient( true );	// Updated for every draw
  	m_pCB_Tesselate = new CB<CBTesselate>( gs_Device, 10 );
+#ifdef PROGRESSIVE_LIGHTMAPS
+	m_pCB_Bake = new CB<CBBake>( gs_Device, 11, false, Device::SSF_COMPUTE_SHADER );
+#endif
 
 
 	// Build animation parameters
@@ -71,6 +85,16 @@ EffectRoom::EffectRoom( Texture2D& _RTTarget ) : m_ErrorCode( 0 ), m_RTTarget( _
 
 EffectRoom::~EffectRoom()
 {
+#ifdef PROGRESSIVE_LIGHTMAPS
+	for ( int FaceIndex=0; FaceIndex < 6; FaceIndex++ )
+	{
+		delete m_ppLMInfos[FaceIndex];
+		delete m_ppLMAccum[FaceIndex];
+	}
+	delete m_pCB_Bake;
+	delete m_pCSBakeLightMap;
+#endif
+
  	delete m_pCB_Object;
  	delete m_pCB_Tesselate;
 
@@ -117,6 +141,10 @@ float	EffectRoom::AnimateFailure( float& _TimerTillFailure, float& _TimeSinceFai
 
 void	EffectRoom::Render( float _Time, float _DeltaTime )
 {
+#ifdef PROGRESSIVE_LIGHTMAPS
+	BakeLightMaps();
+#endif
+
 	//////////////////////////////////////////////////////////////////////////
 	// Animate lights
 	float		LightMaxIntensity = 10.0f;
@@ -175,8 +203,9 @@ m_pTexVoronoi->SetPS( 12 );
 // 		gs_Device.ClearRenderTarget( gs_Device.DefaultRenderTarget(), NjFloat4::Zero );
 // 
 // 		m_pCB_Tesselate->m.dUV = gs_Device.DefaultRenderTarget().GetdUV();
-// 		m_pCB_Tesselate->m.TesselationFactors.x = _TV( 64.0f );	// Edge tesselation
-// 		m_pCB_Tesselate->m.TesselationFactors.y = _TV( 64.0f );	// Inside tesselation
+// 		m_pCB_Tesselate->m.TargetEdgePixels = _TV( 8.0f );		// The factors now follow the screen length of the edges
+// 		m_pCB_Tesselate->m.MaxTesselationFactor = _TV( 64.0f );
+// 		m_pCB_Tesselate->m.TesselationBudget = _TV( 1.0f );		// Lower to trade displacement detail for GPU time
 //  		m_pCB_Tesselate->UpdateData();
 // 
 // 		m_pPrimTesselatedQuad->Render( M );
@@ -366,18 +395,9 @@ void	EffectRoom::BuildRoom( const TextureBuilder& _TB )
 
 	//////////////////////////////////////////////////////////////////////////
 	// Allocate the input & output buffers
-	struct LightMapInfos
-	{
-		float3	Position;
-		U32			Seed0;
-		float3	Normal;
-		U32			Seed1;
-		float3	Tangent;
-		U32			Seed2;
-		float3	BiTangent;
-		U32			Seed3;
-	};
-
+#ifdef PROGRESSIVE_LIGHTMAPS
+	SB<LightMapInfos>**	ppLMInfos = m_ppLMInfos;	// Kept for the progressive bake
+#else
 	struct	LightMapResult
 	{
 		float4	Irradiance;
@@ -387,6 +407,7 @@ void	EffectRoom::BuildRoom( const TextureBuilder& _TB )
 	SB<LightMapResult>*	ppResults0[6];
 	SB<LightMapResult>*	ppResults1[6];
  	SB<LightMapResult>*	ppAccumResults[6];
+#endif
 	for ( int FaceIndex=0; FaceIndex < 6; FaceIndex++ )
 	{
 		int		W = pIntSizes[2*FaceIndex+0];
@@ -394,14 +415,19 @@ void	EffectRoom::BuildRoom( const TextureBuilder& _TB )
 		int		Size = W*H;
 
 		ppLMInfos[FaceIndex] = new SB<LightMapInfos>( gs_Device, Size, true );
+#ifdef PROGRESSIVE_LIGHTMAPS
+		m_ppLMAccum[FaceIndex] = new SB<float4>( gs_Device, Size, false );
+		m_ppLMAccum[FaceIndex]->Clear( float4::Zero );
+#else
 		ppResults0[FaceIndex] = new SB<LightMapResult>( gs_Device, Size, false );
 		ppResults1[FaceIndex] = new SB<LightMapResult>( gs_Device, Size, false );
 		ppAccumResults[FaceIndex] = new SB<LightMapResult>( gs_Device, Size, false );
+#endif
 	}
 
 	//////////////////////////////////////////////////////////////////////////
 	// Build the normal map & height map from the wall texture
-	TextureBuilder	TBNormalHeight( LIGHTMAP_SIZE, LIGHTMAP_SIZE/2 );
+	TextureBuilder	TBNormalHeight( LIGHTMAP_SIZE, LIGHTMAP_SIZE/2, TextureBuilder::CHANNEL_HEIGHT );
 					TBNormalHeight.CopyFrom( _TB );	// Scale down...
 	int				Dummy;
 	float4**		ppWallTextureNormals = (float4**) TBNormalHeight.Convert( PixelFormatRGBA32F::DESCRIPTOR, TextureBuilder::CONV_NxNyNzH, Dummy );
@@ -468,6 +494,12 @@ void	EffectRoom::BuildRoom( const TextureBuilder& _TB )
 		ppLMInfos[FaceIndex]->Write();
 	}
 
+#ifdef PROGRESSIVE_LIGHTMAPS
+	//////////////////////////////////////////////////////////////////////////
+	// The light maps start black and converge while the room runs (cf. BakeLightMaps())
+	m_pTexLightMaps = new Texture2D( gs_Device, LIGHTMAP_SIZE, LIGHTMAP_SIZE, 4, PixelFormatRGBA16F::DESCRIPTOR, 1, NULL, false, true );
+	m_BakeSamplesCount = 0;
+#else
 //*
 	//////////////////////////////////////////////////////////////////////////
 	// Compute direct lighting
@@ -617,7 +649,50 @@ void	EffectRoom::BuildRoom( const TextureBuilder& _TB )
 		delete ppResults1[FaceIndex];
 		delete ppAccumResults[FaceIndex];
 	}
+#endif
+}
+
+#ifdef PROGRESSIVE_LIGHTMAPS
+//////////////////////////////////////////////////////////////////////////
+// Traces BAKE_SAMPLES_PER_FRAME more paths from each light map texel (cf. RoomBakeLightMap.hlsl)
+// Each neon is accumulated in its own channel so the light failures simply rescale the channels at display time, the bake never
+//	restarts and the light maps keep converging until BAKE_MAX_SAMPLES.
+//
+void	EffectRoom::BakeLightMaps()
+{
+	if ( m_BakeSamplesCount >= BAKE_MAX_SAMPLES )
+		return;	// Converged
+
+	m_pCB_Bake->m.FirstSampleIndex = m_BakeSamplesCount;
+	m_pCB_Bake->m.SamplesCount = BAKE_SAMPLES_PER_FRAME;
+	m_BakeSamplesCount += BAKE_SAMPLES_PER_FRAME;
+	m_pCB_Bake->m.InvTotalSamplesCount = 1.0f / m_BakeSamplesCount;
+
+	USING_COMPUTESHADER_START( *m_pCSBakeLightMap )
+
+	m_pTexLightMaps->SetCSUAV( 1 );
+
+	for ( int FaceIndex=0; FaceIndex < 6; FaceIndex++ )
+	{
+		// Ceiling & floor have their own slice, walls are packed 2 by 2 (cf. BuildRoom())
+		bool	bWall = FaceIndex >= 2;
+		m_pCB_Bake->m.LightMapSizeX = LIGHTMAP_SIZE;
+		m_pCB_Bake->m.LightMapSizeY = bWall ? LIGHTMAP_SIZE/2 : LIGHTMAP_SIZE;
+		m_pCB_Bake->m.TargetSlice = bWall ? 2 + ((FaceIndex-2) >> 1) : FaceIndex;
+		m_pCB_Bake->m.TargetOffsetY = bWall ? ((FaceIndex-2) & 1) * LIGHTMAP_SIZE/2 : 0;
+		m_pCB_Bake->UpdateData();
+
+		m_ppLMInfos[FaceIndex]->SetInput( 10 );
+		m_ppLMAccum[FaceIndex]->SetOutput( 0 );
+
+		M.Dispatch( (m_pCB_Bake->m.LightMapSizeX+7) >> 3, (m_pCB_Bake->m.LightMapSizeY+7) >> 3, 1 );
+	}
+
+	USING_COMPUTE_SHADER_END
+
+	m_pTexLightMaps->RemoveFromLastAssignedSlotUAV();
 }
+#endif
 
 //////////////////////////////////////////////////////////////////////////
 // Build the texture used for the walls
@@ -644,19 +719,26 @@ namespace RoomFillers
 		_Pixel.Roughness = 1.0f;
 		_Pixel.MatID = 0;
 	}
-}
 
-void	EffectRoom::BuildRoomTextures( TextureBuilder& _TB )
-{
+	// _pParams[0] is the width of the panels' rounded border
+	void	EvaluateWallPanels( const TextureBuilder** _ppInputs, const float* _pParams, TextureBuilder& _Target, void* _pData )
 	{
-		_TB.Clear( Pixel( float4::Zero ) );
+		// The panels are flat beyond the rounded border so we can skip the filler there
+		Pixel		PanelInterior( float4( 1.0f, 1.0f, 1.0f, 1.0f ), 0.25f, 1.0f, 0.0f, 0 );
 
 		DrawUtils	DU;
-		DU.SetupSurface( _TB );
+		DU.SetupSurface( _Target );
+		DU.BeginBatch();
 		for ( int Y=0; Y < 4; Y++ )
 			for ( int X=0; X < 4; X++ )
-				DU.DrawRectangle( 512.0f*X, 256.0f*Y, 512, 256, 20, 1.0f, RoomFillers::FillRoundedRect, NULL );
-
-		m_pTexWalls = _TB.CreateTexture( PixelFormatRGBA16F::DESCRIPTOR, TextureBuilder::CONV_RGBA_NxNyHR_M );
+				DU.DrawRectangle( 512.0f*X, 256.0f*Y, 512, 256, _pParams[0], 1.0f, FillRoundedRect, NULL, &PanelInterior, 0.0f );
+		DU.EndBatch();
 	}
 }
+
+int		EffectRoom::BuildRoomTextures( TextureGraph& _Graph )
+{
+	int	Walls = _Graph.AddNode( "RoomWalls", 2048, 1024, RoomFillers::EvaluateWallPanels, NULL );
+	_Graph.SetParam( Walls, 0, 20.0f );
+	return Walls;
+}
@@ -6,6 +6,8 @@
 #define ROOM_BOUNCES_COUNT		4
 #define ROOM_RAY_GROUPS_COUNT	1
 
+#define PROGRESSIVE_LIGHTMAPS	// Define this to bake the light maps progressively on the GPU while the room runs instead of blocking on the full bake at init (cf. RoomBakeLightMap.hlsl)
+
 template<typename> class CB;
 
 class EffectRoom
@@ -13,6 +15,10 @@ class EffectRoom
 private:	// CONSTANTS
 
 	static const int	LIGHTMAP_SIZE = 256;		// Size of the lightmap
+#ifdef PROGRESSIVE_LIGHTMAPS
+	static const U32	BAKE_SAMPLES_PER_FRAME = 4;	// Paths traced per texel each frame
+	static const U32	BAKE_MAX_SAMPLES = 4096;	// The bake stops once the light maps have accumulated that many paths
+#endif
 
 
 protected:	// NESTED TYPES
@@ -30,10 +36,36 @@ protected:	// NESTED TYPES
 	struct CBTesselate
 	{
 		float3	dUV;
-		float		__PAD0;
-		float2	TesselationFactors;
+		float	TargetEdgePixels;		// Screen length of the generated edges (cf. Inc/AdaptiveTessellation.hlsl)
+		float	MaxTesselationFactor;
+		float	TesselationBudget;		// Global scale of the factors in ]0,1]
+		float2	__PAD0;
+	};
+
+	struct LightMapInfos
+	{
+		float3	Position;
+		U32			Seed0;
+		float3	Normal;
+		U32			Seed1;
+		float3	Tangent;
+		U32			Seed2;
+		float3	BiTangent;
+		U32			Seed3;
 	};
 
+#ifdef PROGRESSIVE_LIGHTMAPS
+	struct CBBake
+	{
+		U32			LightMapSizeX, LightMapSizeY;
+		U32			TargetSlice;
+		U32			TargetOffsetY;
+		U32			FirstSampleIndex;
+		U32			SamplesCount;
+		float		InvTotalSamplesCount;
+	};
+#endif
+
 	struct MaterialDescriptor 
 	{
 		int			LightSourceIndex;	// -1 For standard reflective materials
@@ -47,6 +79,9 @@ private:	// FIELDS
 
 	Shader*			m_pMatDisplay;			// Displays the room
 	Shader*			m_pMatDisplayEmissive;	// Displays the lights
+#ifdef PROGRESSIVE_LIGHTMAPS
+	ComputeShader*		m_pCSBakeLightMap;		// Accumulates a few more paths into the light maps each frame
+#endif
 //	Material*			m_pMatTestTesselation;	// My first Domain Shader!
 
 	// Primitives
@@ -63,6 +98,14 @@ public:	Texture2D*			m_pTexVoronoi;		// Test vorono
  	CB<CBObject>*		m_pCB_Object;
  	CB<CBTesselate>*	m_pCB_Tesselate;
 
+#ifdef PROGRESSIVE_LIGHTMAPS
+	// Progressive bake
+	SB<LightMapInfos>*	m_ppLMInfos[6];			// Position & tangent space of each texel of each face
+	SB<float4>*			m_ppLMAccum[6];			// Sum of the samples of each texel of each face
+	CB<CBBake>*			m_pCB_Bake;
+	U32					m_BakeSamplesCount;
+#endif
+
 	// Animation parameters
 	float4			m_LightUpTime;
 	float4			m_LightFailTimer;		// Time before the light fails
@@ -89,8 +132,11 @@ public:		// METHODS
 protected:
 
 	void		BuildRoom( const TextureBuilder& _TB );
-	void		BuildRoomTextures( TextureBuilder& _TB );
+	int			BuildRoomTextures( TextureGraph& _Graph );	// Returns the node of the walls' texture
 	void		BuildVoronoiTexture( TextureBuilder& _TB );
+#ifdef PROGRESSIVE_LIGHTMAPS
+	void		BakeLightMaps();
+#endif
 
 	float		AnimateFailure( float& _TimerTillFailure, float& _TimeSinceFailure, float& _FailureDuration, float _FailMinTime, float _FailDeltaTime, float _DeltaTime );
 
@@ -28,6 +28,9 @@ EffectTranslucency::EffectTranslucency( Texture2D& _RTTarget ) : m_ErrorCode( 0
 
 	D3D_SHADER_MACRO	pMacros[2] = { { "TARGET_SIZE", "128" }, { NULL, NULL } };
 	CHECK_MATERIAL( m_pMatDiffusion = CreateMaterial( IDR_SHADER_TRANSLUCENCY_DIFFUSION, "./Resources/Shaders/TranslucencyDiffusion.hlsl", VertexFormatPt4::DESCRIPTOR, "VS", NULL, "PS", pMacros ), 3 );
+#ifdef COMPUTE_DIFFUSION
+	CHECK_MATERIAL( m_pCSDiffusion = CreateComputeShader( IDR_SHADER_TRANSLUCENCY_DIFFUSION_CS, "./Resources/Shaders/TranslucencyDiffusionCS.hlsl", "CS" ), 4 );
+#endif
 
 	//////////////////////////////////////////////////////////////////////////
 	// Build some sphere primitives
@@ -47,23 +50,43 @@ EffectTranslucency::EffectTranslucency( Texture2D& _RTTarget ) : m_ErrorCode( 0
 	m_pRTZBuffer = new Texture2D( gs_Device, DIFFUSION_SIZE, DIFFUSION_SIZE, 1, PixelFormatRGBA16F::DESCRIPTOR, 1, NULL );
 	m_pDepthStencil = new Texture2D( gs_Device, DIFFUSION_SIZE, DIFFUSION_SIZE, DepthStencilFormatD32F::DESCRIPTOR );
 
+#ifdef COMPUTE_DIFFUSION
+	m_ppRTDiffusion[0] = new Texture2D( gs_Device, DIFFUSION_SIZE, DIFFUSION_SIZE, 1, PixelFormatRGBA16F::DESCRIPTOR, 1, NULL, false, true );
+	m_ppRTDiffusion[1] = new Texture2D( gs_Device, DIFFUSION_SIZE, DIFFUSION_SIZE, 1, PixelFormatRGBA16F::DESCRIPTOR, 1, NULL, false, true );
+#else
 	m_ppRTDiffusion[0] = new Texture2D( gs_Device, DIFFUSION_SIZE, DIFFUSION_SIZE, 1, PixelFormatRGBA16F::DESCRIPTOR, 1, NULL );
 	m_ppRTDiffusion[1] = new Texture2D( gs_Device, DIFFUSION_SIZE, DIFFUSION_SIZE, 1, PixelFormatRGBA16F::DESCRIPTOR, 1, NULL );
+#endif
+#ifdef DIFFUSION_MULTIGRID
+	m_ppRTDiffusionCoarse[0] = new Texture2D( gs_Device, DIFFUSION_SIZE/2, DIFFUSION_SIZE/2, 1, PixelFormatRGBA16F::DESCRIPTOR, 1, NULL, false, true );
+	m_ppRTDiffusionCoarse[1] = new Texture2D( gs_Device, DIFFUSION_SIZE/2, DIFFUSION_SIZE/2, 1, PixelFormatRGBA16F::DESCRIPTOR, 1, NULL, false, true );
+#endif
 
 
 	//////////////////////////////////////////////////////////////////////////
 	// Create the constant buffers
 	m_pCB_Object = new CB<CBObject>( gs_Device, 10 );
+	m_pCB_Object->SetTransient( true );	// Updated for every draw
 	m_pCB_Diffusion = new CB<CBDiffusion>( gs_Device, 10 );
 	m_pCB_Pass = new CB<CBPass>( gs_Device, 11 );
+#ifdef COMPUTE_DIFFUSION
+	m_pCB_Solver = new CB<CBSolver>( gs_Device, 11, false, Device::SSF_COMPUTE_SHADER );
+#endif
 }
 
 EffectTranslucency::~EffectTranslucency()
 {
+#ifdef COMPUTE_DIFFUSION
+	delete m_pCB_Solver;
+#endif
 	delete m_pCB_Pass;
 	delete m_pCB_Diffusion;
 	delete m_pCB_Object;
 
+#ifdef DIFFUSION_MULTIGRID
+	delete m_ppRTDiffusionCoarse[1];
+	delete m_ppRTDiffusionCoarse[0];
+#endif
 	delete m_ppRTDiffusion[1];
 	delete m_ppRTDiffusion[0];
 	delete m_pDepthStencil;
@@ -72,6 +95,9 @@ EffectTranslucency::~EffectTranslucency()
 	delete m_pPrimTorusInternal;
 	delete m_pPrimSphereExternal;
 
+#ifdef COMPUTE_DIFFUSION
+	delete m_pCSDiffusion;
+#endif
 	delete m_pMatDiffusion;
  	delete m_pMatBuildZBuffer;
  	delete m_pMatDisplay;
@@ -138,33 +164,37 @@ void	EffectTranslucency::Render( float _Time, float _DeltaTime )
 
 	//////////////////////////////////////////////////////////////////////////
 	// 3] Perform diffusion
-	gs_Device.SetStates( gs_Device.m_pRS_CullNone, gs_Device.m_pDS_Disabled, gs_Device.m_pBS_Disabled );
 
-	{	USING_MATERIAL_START( *m_pMatDiffusion )
+	// Setup our global diffusion parameters
+	float	BBoxSize = _TV(0.002f);	// Size of the BBox containing our objects, in meter
 
-		// Clear original irradiance map
-		gs_Device.ClearRenderTarget( *m_ppRTDiffusion[0], float4( 0.0f, 0.0f, 0.0f, 0.0f ) );
+	m_pCB_Diffusion->m.BBoxSize = BBoxSize;
+	m_pCB_Diffusion->m.SliceThickness = BBoxSize / DIFFUSION_PASSES_COUNT;	// Size of a single slice
+	m_pCB_Diffusion->m.TexelSize = BBoxSize / DIFFUSION_SIZE;				// Size of a single texel
+	m_pCB_Diffusion->m.ExtinctionCoeff = _TV(1000.0f) * float3( 0.8f, 0.85f, 1.0f );
+	m_pCB_Diffusion->m.Albedo = _TV(0.8f) * float3::One;
 
-		// Setup our global diffusion parameters
-		float	BBoxSize = _TV(0.002f);	// Size of the BBox containing our objects, in meter
+	float3	ScatteringAnisotropy = _TV(0.0f) * float3::One;
+	float		PhaseFactor = _TV(4.6f);
+	m_pCB_Diffusion->m.Phase0 = PhaseFactor * ComputePhase( ScatteringAnisotropy, 0, 1, m_pCB_Diffusion->m.TexelSize, m_pCB_Diffusion->m.SliceThickness );
+	m_pCB_Diffusion->m.Phase1 = PhaseFactor * ComputePhase( ScatteringAnisotropy, 1, 8, m_pCB_Diffusion->m.TexelSize, m_pCB_Diffusion->m.SliceThickness );
+	m_pCB_Diffusion->m.Phase2 = PhaseFactor * ComputePhase( ScatteringAnisotropy, 2, 12, m_pCB_Diffusion->m.TexelSize, m_pCB_Diffusion->m.SliceThickness );
 
-		m_pCB_Diffusion->m.BBoxSize = BBoxSize;
-		m_pCB_Diffusion->m.SliceThickness = BBoxSize / DIFFUSION_PASSES_COUNT;	// Size of a single slice
-		m_pCB_Diffusion->m.TexelSize = BBoxSize / DIFFUSION_SIZE;				// Size of a single texel
-		m_pCB_Diffusion->m.ExtinctionCoeff = _TV(1000.0f) * float3( 0.8f, 0.85f, 1.0f );
-		m_pCB_Diffusion->m.Albedo = _TV(0.8f) * float3::One;
+//	m_pCB_Diffusion->m.ExternalLight = _TV(2.0f) * NjFloat3( 1.0f, 1.0f, 1.0f );
+	m_pCB_Diffusion->m.ExternalLight = _TV(1.4f) * (1.4f - m_EmissivePower) * float3( 1.0f, 1.0f, 1.0f );
+	m_pCB_Diffusion->m.InternalEmissive = _TV(10.0f) * m_EmissivePower * float3( 1.0f, 0.8f, 0.2f );
 
-		float3	ScatteringAnisotropy = _TV(0.0f) * float3::One;
-		float		PhaseFactor = _TV(4.6f);
-		m_pCB_Diffusion->m.Phase0 = PhaseFactor * ComputePhase( ScatteringAnisotropy, 0, 1, m_pCB_Diffusion->m.TexelSize, m_pCB_Diffusion->m.SliceThickness );
-		m_pCB_Diffusion->m.Phase1 = PhaseFactor * ComputePhase( ScatteringAnisotropy, 1, 8, m_pCB_Diffusion->m.TexelSize, m_pCB_Diffusion->m.SliceThickness );
-		m_pCB_Diffusion->m.Phase2 = PhaseFactor * ComputePhase( ScatteringAnisotropy, 2, 12, m_pCB_Diffusion->m.TexelSize, m_pCB_Diffusion->m.SliceThickness );
+	m_pCB_Diffusion->UpdateData();
 
-//		m_pCB_Diffusion->m.ExternalLight = _TV(2.0f) * NjFloat3( 1.0f, 1.0f, 1.0f );
-		m_pCB_Diffusion->m.ExternalLight = _TV(1.4f) * (1.4f - m_EmissivePower) * float3( 1.0f, 1.0f, 1.0f );
-		m_pCB_Diffusion->m.InternalEmissive = _TV(10.0f) * m_EmissivePower * float3( 1.0f, 0.8f, 0.2f );
+#ifdef COMPUTE_DIFFUSION
+	Diffuse();
+#else
+	gs_Device.SetStates( gs_Device.m_pRS_CullNone, gs_Device.m_pDS_Disabled, gs_Device.m_pBS_Disabled );
 
-		m_pCB_Diffusion->UpdateData();
+	{	USING_MATERIAL_START( *m_pMatDiffusion )
+
+		// Clear original irradiance map
+		gs_Device.ClearRenderTarget( *m_ppRTDiffusion[0], float4( 0.0f, 0.0f, 0.0f, 0.0f ) );
 
 gs_Device.SetRenderTarget( gs_Device.DefaultRenderTarget(), NULL );
 
@@ -191,6 +221,7 @@ gs_Device.SetRenderTarget( gs_Device.DefaultRenderTarget(), NULL );
 
 		USING_MATERIAL_END
 	}
+#endif
 
 	//////////////////////////////////////////////////////////////////////////
 	// 4] Finally, render the object with a planar mapping of the irradiance map
@@ -221,6 +252,73 @@ gs_Device.SetRenderTarget( gs_Device.DefaultRenderTarget(), NULL );
 	}
 }
 
+#ifdef COMPUTE_DIFFUSION
+//////////////////////////////////////////////////////////////////////////
+// Marches the irradiance through the same slices as the pixel shader passes, DIFFUSION_SLICES_PER_DISPATCH at a time (cf. TranslucencyDiffusionCS.hlsl)
+// In multigrid mode, most of the volume is marched on a half resolution grid with slices twice as thick: the phase weights only depend on
+//	the ratio of the texel size to the slice thickness so they still apply. The last slices are then refined at full resolution from the
+//	upsampled coarse irradiance.
+//
+void	EffectTranslucency::Diffuse()
+{
+	gs_Device.RemoveRenderTargets();	// So we can read the ZBuffer
+
+	int	SlicesCount = DIFFUSION_PASSES_COUNT+1;
+
+#ifdef DIFFUSION_MULTIGRID
+	int	CoarseSlicesCount = (SlicesCount - DIFFUSION_FINE_SLICES_COUNT) / (2*DIFFUSION_SLICES_PER_DISPATCH) * DIFFUSION_SLICES_PER_DISPATCH;
+
+	gs_Device.ClearRenderTarget( *m_ppRTDiffusionCoarse[0], float4::Zero );
+	MarchSlices( m_ppRTDiffusionCoarse[0], m_ppRTDiffusionCoarse, DIFFUSION_SIZE/2, 0, CoarseSlicesCount, 2 );
+	MarchSlices( m_ppRTDiffusionCoarse[0], m_ppRTDiffusion, DIFFUSION_SIZE, 2*CoarseSlicesCount, SlicesCount - 2*CoarseSlicesCount, 1 );
+#else
+	gs_Device.ClearRenderTarget( *m_ppRTDiffusion[0], float4::Zero );
+	MarchSlices( m_ppRTDiffusion[0], m_ppRTDiffusion, DIFFUSION_SIZE, 0, SlicesCount, 1 );
+#endif
+
+	gs_Device.RemoveShaderResources( 10, 2, Device::SSF_COMPUTE_SHADER );
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Marches _SlicesCount slices of _SliceScale pixel shader passes each on a grid of _GridSize texels, starting from the _pSource irradiance
+// The slices are ping-ponged between the 2 maps of _ppIrradiance and the result ends up in _ppIrradiance[0]
+//
+void	EffectTranslucency::MarchSlices( Texture2D* _pSource, Texture2D** _ppIrradiance, int _GridSize, int _FirstSliceIndex, int _SlicesCount, int _SliceScale )
+{
+	m_pCB_Solver->m.GridSize = _GridSize;
+	m_pCB_Solver->m.ZBufferScale = DIFFUSION_SIZE / _GridSize;
+	m_pCB_Solver->m.SliceDeltaZ = 2.0f * _SliceScale / DIFFUSION_PASSES_COUNT;
+	m_pCB_Solver->m.GridSliceThickness = _SliceScale * m_pCB_Diffusion->m.SliceThickness;
+
+	U32	GroupsCount = (_GridSize + DIFFUSION_TILE_SIZE-1) / DIFFUSION_TILE_SIZE;
+
+	USING_COMPUTESHADER_START( *m_pCSDiffusion )
+
+	m_pRTZBuffer->SetCS( 10 );
+
+	for ( int SliceIndex=0; SliceIndex < _SlicesCount; SliceIndex+=DIFFUSION_SLICES_PER_DISPATCH )
+	{
+		m_pCB_Solver->m.FirstZ = 2.0f * (_FirstSliceIndex + _SliceScale * SliceIndex) / DIFFUSION_PASSES_COUNT;
+		m_pCB_Solver->UpdateData();
+
+		_pSource->SetCS( 11 );
+		_ppIrradiance[1]->SetCSUAV( 0 );
+
+		M.Dispatch( GroupsCount, GroupsCount, 1 );
+
+		_ppIrradiance[1]->RemoveFromLastAssignedSlotUAV();
+
+		// Swap irradiance maps
+		Texture2D*	pTemp = _ppIrradiance[0];
+		_ppIrradiance[0] = _ppIrradiance[1];
+		_ppIrradiance[1] = pTemp;
+		_pSource = _ppIrradiance[0];
+	}
+
+	USING_COMPUTE_SHADER_END
+}
+#endif
+
 float3	EffectTranslucency::ComputePhase( const float3& _Anisotropy, int _PixelDistance, int _SamplesCount, float _TexelSize, float _SliceThickness )
 {
 	// Imagine receiving light from a point above you offset by a distance d
@@ -1,5 +1,8 @@
 #pragma once
 
+#define COMPUTE_DIFFUSION	// Define this to perform the diffusion with a few compute dispatches instead of one pixel shader pass per slice (cf. TranslucencyDiffusionCS.hlsl)
+#define DIFFUSION_MULTIGRID	// Define this to march most of the volume on a half resolution grid and only refine the last slices at full resolution (requires COMPUTE_DIFFUSION)
+
 template<typename> class CB;
 
 class EffectTranslucency
@@ -9,6 +12,12 @@ private:	// CONSTANTS
 	static const int	DIFFUSION_SIZE = 128;	// If you change this, also make sure you change the "TARGET_SIZE" macro in the m_pMatDiffusion material compilation !
 	static const int	DIFFUSION_PASSES_COUNT = 64;
 
+#ifdef COMPUTE_DIFFUSION
+	static const int	DIFFUSION_TILE_SIZE = 16;			// !!IMPORTANT ==> Must correspond to TILE_SIZE in TranslucencyDiffusionCS.hlsl!!
+	static const int	DIFFUSION_SLICES_PER_DISPATCH = 4;	// !!IMPORTANT ==> Must correspond to SLICES_PER_DISPATCH in TranslucencyDiffusionCS.hlsl!!
+	static const int	DIFFUSION_FINE_SLICES_COUNT = 8;	// Amount of last slices marched at full resolution in multigrid mode
+#endif
+
 
 public:		// NESTED TYPES
 
@@ -51,6 +60,17 @@ public:		// NESTED TYPES
 		float		NextZ;
 	};
 
+#ifdef COMPUTE_DIFFUSION
+	struct CBSolver
+	{
+		U32			GridSize;				// Size of the irradiance grid
+		U32			ZBufferScale;			// Amount of ZBuffer texels covered by a grid texel
+		float		FirstZ;					// Z of the first slice advanced by the dispatch
+		float		SliceDeltaZ;			// Z extent of a slice
+		float		GridSliceThickness;		// Thickness of a slice on the grid (in meters)
+	};
+#endif
+
 private:	// FIELDS
 
 	int					m_ErrorCode;
@@ -59,6 +79,9 @@ private:	// FIELDS
 	Shader*			m_pMatBuildZBuffer;	// Renders the internal & exteral objects into a single RGBA16F linear ZBuffer
 	Shader*			m_pMatDiffusion;	// Performs light diffusion through the volume
 	Shader*			m_pMatDisplay;		// Some material for primitive display
+#ifdef COMPUTE_DIFFUSION
+	ComputeShader*		m_pCSDiffusion;		// Marches DIFFUSION_SLICES_PER_DISPATCH slices per dispatch
+#endif
 
 	Primitive*			m_pPrimTorusInternal;
 	Primitive*			m_pPrimSphereExternal;
@@ -66,10 +89,16 @@ private:	// FIELDS
 	Texture2D*			m_pRTZBuffer;
 	Texture2D*			m_pDepthStencil;	// The depth stencil adapted to the ZBuffers rendering
 	Texture2D*			m_ppRTDiffusion[2];
+#ifdef DIFFUSION_MULTIGRID
+	Texture2D*			m_ppRTDiffusionCoarse[2];	// Half resolution irradiance grid
+#endif
 
 	CB<CBObject>*		m_pCB_Object;
 	CB<CBDiffusion>*	m_pCB_Diffusion;
 	CB<CBPass>*			m_pCB_Pass;
+#ifdef COMPUTE_DIFFUSION
+	CB<CBSolver>*		m_pCB_Solver;
+#endif
 
 
 	// Params
@@ -93,6 +122,10 @@ public:		// METHODS
 
 protected:
 
+#ifdef COMPUTE_DIFFUSION
+	void	Diffuse();
+	void	MarchSlices( Texture2D* _pSource, Texture2D** _ppIrradiance, int _GridSize, int _FirstSliceIndex, int _SlicesCount, int _SliceScale );
+#endif
 	float3	ComputePhase( const float3& _Anisotropy, int _PixelDistance, int _SamplesCount, float _TexelSize, float _SliceThickness );
 
 };
\ No newline at end of file
@@ -6,6 +6,13 @@
 static const int	TERRAIN_SUBDIVISIONS_COUNT = 200;	// Don't push it over 254 or it will crash due to more than 65536 vertices!
 static const float	TERRAIN_SIZE = 100.0f;
 
+#ifdef TESSELLATED_TERRAIN
+static const float	TERRAIN_TARGET_EDGE_PIXELS = 8.0f;			// Screen size we aim for the edges of the tessellated triangles
+static const int	TERRAIN_TESSELLATION_FACTOR = 32;
+static const float	TERRAIN_SHADOW_TARGET_EDGE_PIXELS = 32.0f;	// The shadow map uses the same patches with 4 times coarser triangles
+static const int	TERRAIN_SHADOW_TESSELLATION_FACTOR = 8;
+#endif
+
 static const float	CLOUD_SIZE = 100.0f;
 
 static const float	SCREEN_TARGET_RATIO = 0.25f;
@@ -14,6 +21,42 @@ static const float	GROUND_RADIUS_KM = 6360.0f;
 static const float	ATMOSPHERE_THICKNESS_KM = 60.0f;
 
 static const float	TRANSMITTANCE_TAN_MAX = 1.5f;	// Close to PI/2 to maximize precision at grazing angles
+
+#ifdef TEMPORAL_CLOUDS
+static const float	TEMPORAL_DEPTH_REJECTION = 0.1f;	// History is rejected if its cloud box depth differs by more than 10%
+
+// Order in which the pixels of a block are marched, from one frame to the next
+static const U8		BAYER_2x2[4] = { 0, 2, 3, 1 };
+static const U8		BAYER_4x4[16] = { 0, 8, 2, 10, 12, 4, 14, 6, 3, 11, 1, 9, 15, 7, 13, 5 };
+
+// Finds the pixel of the block whose Bayer rank is the frame index
+static void	GetTemporalOffset( U32 _FrameIndex, int& _X, int& _Y )
+{
+	const U8*	pBayer = EffectVolumetric::TEMPORAL_PATTERN_SIZE == 2 ? BAYER_2x2 : BAYER_4x4;
+	int			PixelsCount = EffectVolumetric::TEMPORAL_PATTERN_SIZE * EffectVolumetric::TEMPORAL_PATTERN_SIZE;
+	U32			Rank = _FrameIndex % PixelsCount;
+	for ( int PixelIndex=0; PixelIndex < PixelsCount; PixelIndex++ )
+		if ( pBayer[PixelIndex] == Rank )
+		{
+			_X = PixelIndex % EffectVolumetric::TEMPORAL_PATTERN_SIZE;
+			_Y = PixelIndex / EffectVolumetric::TEMPORAL_PATTERN_SIZE;
+			return;
+		}
+}
+#endif
+
+#ifdef FROXEL_FOG
+static const float	FROXEL_NEAR_KM = 0.05f;			// Depth of the first slice
+static const float	FROXEL_FAR_KM = 64.0f;			// Depth of the last slice, farther surfaces use the last slice's integrated fog
+static const float	FROXEL_TEMPORAL_WEIGHT = 0.9f;	// Weight of the reprojected history when accumulating the jittered samples
+
+// Van der Corput sequence of the position of the samples within their slice, from one frame to the next
+static const float	FROXEL_JITTERS_Z[8] = { 0.5f, 0.25f, 0.75f, 0.125f, 0.625f, 0.375f, 0.875f, 0.0625f };
+#endif
+
+#ifdef SKY_LUTS
+static const float	AERIAL_PERSPECTIVE_FAR_KM = 32.0f;	// Depth of the last slice, farther surfaces use the last slice's fog
+#endif
 //#define USE_PRECISE_COS_THETA_MIN
 
 
@@ -28,21 +71,42 @@ EffectVolumetric::EffectVolumetric( Device& _Device, Texture2D& _RTHDR, Primitiv
 
  	CHECK_MATERIAL( m_pMatDepthPrePass = CreateMaterial( IDR_SHADER_VOLUMETRIC_DEPTH_PREPASS, "./Resources/Shaders/VolumetricDepthPrePass.hlsl", VertexFormatPt4::DESCRIPTOR, "VS", NULL, "PS" ), 5 );
 
-	D3D_SHADER_MACRO	pMacrosAboveClouds[] = {
-		{ "CAMERA_ABOVE_CLOUDS", "1" },
-		{ NULL,	NULL }
-	};
-	CHECK_MATERIAL( m_ppMatDisplay[0] = CreateMaterial( IDR_SHADER_VOLUMETRIC_DISPLAY, "./Resources/Shaders/VolumetricDisplay.hlsl", VertexFormatPt4::DESCRIPTOR, "VS", NULL, "PS" ), 6 );
-	CHECK_MATERIAL( m_ppMatDisplay[1] = CreateMaterial( IDR_SHADER_VOLUMETRIC_DISPLAY, "./Resources/Shaders/VolumetricDisplay.hlsl", VertexFormatPt4::DESCRIPTOR, "VS", NULL, "PS", pMacrosAboveClouds ), 7 );
-// 	CHECK_MATERIAL( m_ppMatDisplay[0] = CreateMaterial( IDR_SHADER_VOLUMETRIC_DISPLAY, "./Resources/Shaders/VolumetricDisplay_AtmosphereOnly.hlsl", VertexFormatPt4::DESCRIPTOR, "VS", NULL, "PS" ), 6 );//### DEBUG ATMOSPHERE TABLES!
-// 	CHECK_MATERIAL( m_ppMatDisplay[1] = CreateMaterial( IDR_SHADER_VOLUMETRIC_DISPLAY, "./Resources/Shaders/VolumetricDisplay_AtmosphereOnly.hlsl", VertexFormatPt4::DESCRIPTOR, "VS", NULL, "PS", pMacrosAboveClouds ), 7 );
+	// The variant for a camera above the clouds is only compiled if it's ever requested
+	static const char*	ppDisplayKeywords[] = { "CAMERA_ABOVE_CLOUDS", NULL };
+	m_pMatDisplay = new ShaderPermutations( IDR_SHADER_VOLUMETRIC_DISPLAY, "./Resources/Shaders/VolumetricDisplay.hlsl", VertexFormatPt4::DESCRIPTOR, "VS", NULL, "PS", ppDisplayKeywords );
+	CHECK_MATERIAL( &m_pMatDisplay->Get( 0 ), 6 );
+// 	m_pMatDisplay = new ShaderPermutations( IDR_SHADER_VOLUMETRIC_DISPLAY, "./Resources/Shaders/VolumetricDisplay_AtmosphereOnly.hlsl", VertexFormatPt4::DESCRIPTOR, "VS", NULL, "PS", ppDisplayKeywords );//### DEBUG ATMOSPHERE TABLES!
 
  	CHECK_MATERIAL( m_pMatCombine = CreateMaterial( IDR_SHADER_VOLUMETRIC_COMBINE, "./Resources/Shaders/VolumetricCombine.hlsl", VertexFormatPt4::DESCRIPTOR, "VS", NULL, "PS" ), 8 );
 
+#ifdef TEMPORAL_CLOUDS
+	CHECK_MATERIAL( m_pMatTemporalMask = CreateMaterial( IDR_SHADER_VOLUMETRIC_TEMPORAL, "./Resources/Shaders/VolumetricTemporal.hlsl", VertexFormatPt4::DESCRIPTOR, "VS", NULL, "PS_Mask" ), 11 );
+	CHECK_MATERIAL( m_pMatTemporalResolve = CreateMaterial( IDR_SHADER_VOLUMETRIC_TEMPORAL, "./Resources/Shaders/VolumetricTemporal.hlsl", VertexFormatPt4::DESCRIPTOR, "VS", NULL, "PS_Resolve" ), 12 );
+#endif
+
 #ifdef SHOW_TERRAIN
+#ifdef TESSELLATED_TERRAIN
+	D3D_SHADER_MACRO	pMacrosTessellated[] = {
+		{ "TESSELLATED_TERRAIN", "1" },
+		{ NULL,	NULL }
+	};
+	CHECK_MATERIAL( m_pMatTerrainShadow = CreateMaterial( IDR_SHADER_VOLUMETRIC_TERRAIN, "./Resources/Shaders/VolumetricTerrain.hlsl", VertexFormatP3::DESCRIPTOR, "VS_Patch", "HS_Patch", "DS_Patch", NULL, NULL, pMacrosTessellated ), 9 );
+	CHECK_MATERIAL( m_pMatTerrain = CreateMaterial( IDR_SHADER_VOLUMETRIC_TERRAIN, "./Resources/Shaders/VolumetricTerrain.hlsl", VertexFormatP3::DESCRIPTOR, "VS_Patch", "HS_Patch", "DS_Patch", NULL, "PS", pMacrosTessellated ), 10 );
+#else
 	CHECK_MATERIAL( m_pMatTerrainShadow = CreateMaterial( IDR_SHADER_VOLUMETRIC_TERRAIN, "./Resources/Shaders/VolumetricTerrain.hlsl", VertexFormatP3::DESCRIPTOR, "VS", NULL, NULL ), 9 );
 	CHECK_MATERIAL( m_pMatTerrain = CreateMaterial( IDR_SHADER_VOLUMETRIC_TERRAIN, "./Resources/Shaders/VolumetricTerrain.hlsl", VertexFormatP3::DESCRIPTOR, "VS", NULL, "PS" ), 10 );
 #endif
+#endif
+
+#ifdef FROXEL_FOG
+	CHECK_MATERIAL( m_pCSFroxelInject = CreateComputeShader( IDR_SHADER_VOLUMETRIC_FROXELS, "./Resources/Shaders/VolumetricFroxels.hlsl", "CS_Inject" ), 13 );
+	CHECK_MATERIAL( m_pCSFroxelIntegrate = CreateComputeShader( IDR_SHADER_VOLUMETRIC_FROXELS, "./Resources/Shaders/VolumetricFroxels.hlsl", "CS_Integrate" ), 14 );
+#endif
+
+#ifdef SKY_LUTS
+	CHECK_MATERIAL( m_pCSSkyView = CreateComputeShader( IDR_SHADER_VOLUMETRIC_SKY_LUTS, "./Resources/Shaders/VolumetricSkyLUTs.hlsl", "CS_SkyView" ), 15 );
+	CHECK_MATERIAL( m_pCSAerialPerspective = CreateComputeShader( IDR_SHADER_VOLUMETRIC_SKY_LUTS, "./Resources/Shaders/VolumetricSkyLUTs.hlsl", "CS_AerialPerspective" ), 16 );
+#endif
 
 //	const char*	pCSO = LoadCSO( "./Resources/Shaders/CSO/VolumetricCombine.cso" );
 //	CHECK_MATERIAL( m_pMatCombine = CreateMaterial( IDR_SHADER_VOLUMETRIC_COMBINE, VertexFormatPt4::DESCRIPTOR, "VS", NULL, pCSO ), 4 );
@@ -70,6 +134,8 @@ EffectVolumetric::EffectVolumetric( Device& _Device, Texture2D& _RTHDR, Primitiv
 	m_ppRTScattering[0] = new Texture3D( m_Device, RES_3D_U, RES_3D_COS_THETA_VIEW, RES_3D_ALTITUDE, PixelFormatRGBA32F::DESCRIPTOR, 1, NULL, false, UAV );	// inscatter (final)
 	m_ppRTScattering[1] = new Texture3D( m_Device, RES_3D_U, RES_3D_COS_THETA_VIEW, RES_3D_ALTITUDE, PixelFormatRGBA32F::DESCRIPTOR, 1, NULL, false, UAV );
 	m_ppRTScattering[2] = new Texture3D( m_Device, RES_3D_U, RES_3D_COS_THETA_VIEW, RES_3D_ALTITUDE, PixelFormatRGBA32F::DESCRIPTOR, 1, NULL, false, UAV );
+	for ( int TableIndex=0; TableIndex < 3; TableIndex++ )
+		m_ppRTScattering[TableIndex]->m_pMemoryTag = "Sky Scattering";	// The largest tables by far (cf. Device::DumpVideoMemoryUsage())
 
 	// Setup to their target slots, even though they're not computed yet... That's just to avoid annoying warnings in the console.
 	m_ppRTTransmittance[0]->Set( 6, true );
@@ -128,12 +194,32 @@ EffectVolumetric::EffectVolumetric( Device& _Device, Texture2D& _RTHDR, Primitiv
 		m_pPrimTerrain = new Primitive( m_Device, VertexFormatP3::DESCRIPTOR );
 		GeometryBuilder::BuildPlane( 200, 200, float3::UnitX, -float3::UnitZ, *m_pPrimTerrain );
 	}
+#ifdef TESSELLATED_TERRAIN
+	{
+		float3	pVertices[4] = {
+			float3( 0.0f, 0.0f, 0.0f ),
+			float3( 1.0f, 0.0f, 0.0f ),
+			float3( 1.0f, 0.0f, 1.0f ),
+			float3( 0.0f, 0.0f, 1.0f ),
+		};
+		m_pPrimTerrainPatch = new Primitive( m_Device, 4, pVertices, 0, NULL, D3D11_PRIMITIVE_TOPOLOGY_4_CONTROL_POINT_PATCHLIST, VertexFormatP3::DESCRIPTOR );
+		m_pSB_TerrainPatches = new SB<TerrainPatch>( m_Device, TERRAIN_MAX_PATCHES, true );
+	}
+#endif
 #endif
 
 	//////////////////////////////////////////////////////////////////////////
 	// Build textures & render targets
 	m_pRTCameraFrustumSplat = new Texture2D( m_Device, SHADOW_MAP_SIZE, SHADOW_MAP_SIZE, 1, PixelFormatR8::DESCRIPTOR, 1, NULL );
+#ifdef CLOUD_SHADOW_CASCADES
+	m_ppRTShadowCascades[0] = new Texture2D( m_Device, SHADOW_MAP_SIZE, SHADOW_MAP_SIZE, 2*SHADOW_CASCADES_COUNT, PixelFormatRGBA16F::DESCRIPTOR, 1, NULL );
+	m_ppRTShadowCascades[1] = new Texture2D( m_Device, SHADOW_MAP_SIZE, SHADOW_MAP_SIZE, 2*SHADOW_CASCADES_COUNT, PixelFormatRGBA16F::DESCRIPTOR, 1, NULL );
+	m_pRTTransmittanceMap = m_ppRTShadowCascades[0];
+	m_ShadowCascadeRefreshIndex = 0;
+	m_bShadowCascadesValid = false;
+#else
 	m_pRTTransmittanceMap = new Texture2D( m_Device, SHADOW_MAP_SIZE, SHADOW_MAP_SIZE, 2, PixelFormatRGBA16F::DESCRIPTOR, 1, NULL );
+#endif
 
 	int	W = m_Device.DefaultRenderTarget().GetWidth();
 	int	H = m_Device.DefaultRenderTarget().GetHeight();
@@ -145,12 +231,61 @@ EffectVolumetric::EffectVolumetric( Device& _Device, Texture2D& _RTHDR, Primitiv
 	m_pRTRenderZ = new Texture2D( m_Device, m_RenderWidth, m_RenderHeight, 1, PixelFormatRG16F::DESCRIPTOR, 1, NULL );
 	m_pRTRender = new Texture2D( m_Device, m_RenderWidth, m_RenderHeight, 2, PixelFormatRGBA16F::DESCRIPTOR, 1, NULL );
 
+#ifdef DEPTH_AWARE_UPSAMPLE
+	m_pUpsampler = new DepthUpsampler( m_Device, W, H, 2 );
+	if ( m_pUpsampler->HasErrors() )
+		m_ErrorCode = 15;
+	ASSERT( m_pUpsampler->GetLowResWidth() == m_RenderWidth && m_pUpsampler->GetLowResHeight() == m_RenderHeight, "Upsampler & cloud resolutions mismatch! Did you change SCREEN_TARGET_RATIO?" );
+	m_pRTRenderUpsampled = new Texture2D( m_Device, W, H, 2, PixelFormatRGBA16F::DESCRIPTOR, 1, NULL, false, true );
+#endif
+
+#ifdef TEMPORAL_CLOUDS
+	m_pRTRenderStencil = new Texture2D( m_Device, m_RenderWidth, m_RenderHeight, DepthStencilFormatD24S8::DESCRIPTOR );
+	m_pRTRenderZHistory = new Texture2D( m_Device, m_RenderWidth, m_RenderHeight, 1, PixelFormatRG16F::DESCRIPTOR, 1, NULL );
+	m_ppRTHistory[0] = new Texture2D( m_Device, m_RenderWidth, m_RenderHeight, 2, PixelFormatRGBA16F::DESCRIPTOR, 1, NULL );
+	m_ppRTHistory[1] = new Texture2D( m_Device, m_RenderWidth, m_RenderHeight, 2, PixelFormatRGBA16F::DESCRIPTOR, 1, NULL );
+	m_TemporalFrameIndex = 0;
+	m_bHistoryValid = false;
+
+	{	// Stencil is set to 1 for the pixels to march, no depth test
+		D3D11_DEPTH_STENCIL_DESC	Desc;
+		memset( &Desc, 0, sizeof(Desc) );
+		Desc.DepthEnable = false;
+		Desc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
+		Desc.DepthFunc = D3D11_COMPARISON_ALWAYS;
+		Desc.StencilEnable = true;
+		Desc.StencilReadMask = 0xFF;
+		Desc.StencilWriteMask = 0xFF;
+		Desc.FrontFace.StencilFunc = D3D11_COMPARISON_ALWAYS;
+		Desc.FrontFace.StencilPassOp = D3D11_STENCIL_OP_INCR_SAT;	// Stencil is cleared to 0
+		Desc.FrontFace.StencilFailOp = D3D11_STENCIL_OP_KEEP;
+		Desc.FrontFace.StencilDepthFailOp = D3D11_STENCIL_OP_KEEP;
+		Desc.BackFace = Desc.FrontFace;
+
+		m_pDS_WriteStencil = new DepthStencilState( m_Device, Desc );
+	}
+#endif
+
 	int	DepthPassWidth = m_RenderWidth / 2;
 	int	DepthPassHeight	= m_RenderHeight / 2;
 	m_pRTVolumeDepth = new Texture2D( m_Device, DepthPassWidth, DepthPassHeight, 1, PixelFormatRG16F::DESCRIPTOR, 1, NULL );
 
-//	m_pTexFractal0 = BuildFractalTexture( true );
-	m_pTexFractal1 = BuildFractalTexture( false );
+#ifdef FROXEL_FOG
+	m_ppTexFroxelScattering[0] = new Texture3D( m_Device, FROXELS_W, FROXELS_H, FROXELS_D, PixelFormatRGBA16F::DESCRIPTOR, 1, NULL, false, true );
+	m_ppTexFroxelScattering[1] = new Texture3D( m_Device, FROXELS_W, FROXELS_H, FROXELS_D, PixelFormatRGBA16F::DESCRIPTOR, 1, NULL, false, true );
+	m_pTexFroxelFog = new Texture3D( m_Device, FROXELS_W, FROXELS_H, FROXELS_D, PixelFormatRGBA16F::DESCRIPTOR, 1, NULL, false, true );
+	m_FroxelFrameIndex = 0;
+	m_bFroxelHistoryValid = false;
+#endif
+
+#ifdef SKY_LUTS
+	m_pTexSkyView = new Texture2D( m_Device, SKY_VIEW_W, SKY_VIEW_H, 1, PixelFormatRGBA16F::DESCRIPTOR, 1, NULL, false, true );
+	m_pTexAerialPerspective = new Texture3D( m_Device, AERIAL_PERSPECTIVE_SIZE, AERIAL_PERSPECTIVE_SIZE, AERIAL_PERSPECTIVE_SIZE, PixelFormatRGBA16F::DESCRIPTOR, 1, NULL, false, true );
+#endif
+
+//	m_pTexFractal0 = BuildFractalTexture( true, NULL );
+	m_pTexFractalMinMax = NULL;
+	m_pTexFractal1 = BuildFractalTexture( false, &m_pTexFractalMinMax );
 
 #ifdef SHOW_TERRAIN
 	m_pRTTerrainShadow = new Texture2D( m_Device, TERRAIN_SHADOW_MAP_SIZE, TERRAIN_SHADOW_MAP_SIZE, DepthStencilFormatD32F::DESCRIPTOR );
@@ -163,6 +298,22 @@ EffectVolumetric::EffectVolumetric( Device& _Device, Texture2D& _RTHDR, Primitiv
 	m_pCB_Atmosphere = new CB<CBAtmosphere>( m_Device, 7, true );
 	m_pCB_Shadow = new CB<CBShadow>( m_Device, 8, true );
 	m_pCB_Volume = new CB<CBVolume>( m_Device, 9, true );
+#ifdef TEMPORAL_CLOUDS
+	m_pCB_Temporal = new CB<CBTemporal>( m_Device, 10 );
+#endif
+#ifdef CLOUD_SHADOW_CASCADES
+	m_pCB_ShadowCascades = new CB<CBShadowCascades>( m_Device, 11 );
+#endif
+#ifdef FROXEL_FOG
+	m_pCB_Froxels = new CB<CBFroxels>( m_Device, 12 );
+	m_pCB_Froxels->m.PointLightsCount = 0;
+#endif
+#ifdef SKY_LUTS
+	m_pCB_SkyLUTs = new CB<CBSkyLUTs>( m_Device, 5 );
+#endif
+#ifdef TESSELLATED_TERRAIN
+	m_pCB_TerrainTessellation = new CB<CBTerrainTessellation>( m_Device, 13 );
+#endif
 
 	//////////////////////////////////////////////////////////////////////////
 	// Setup our volume & light
@@ -260,22 +411,68 @@ EffectVolumetric::~EffectVolumetric()
 	delete m_pMMF;
 #endif
 
+#ifdef TEMPORAL_CLOUDS
+	delete m_pCB_Temporal;
+	delete m_pDS_WriteStencil;
+	delete m_ppRTHistory[1];
+	delete m_ppRTHistory[0];
+	delete m_pRTRenderZHistory;
+	delete m_pRTRenderStencil;
+	delete m_pMatTemporalResolve;
+	delete m_pMatTemporalMask;
+#endif
+
+#ifdef FROXEL_FOG
+	delete m_pCB_Froxels;
+	delete m_pTexFroxelFog;
+	delete m_ppTexFroxelScattering[1];
+	delete m_ppTexFroxelScattering[0];
+	delete m_pCSFroxelIntegrate;
+	delete m_pCSFroxelInject;
+#endif
+
+#ifdef SKY_LUTS
+	delete m_pCB_SkyLUTs;
+	delete m_pTexAerialPerspective;
+	delete m_pTexSkyView;
+	delete m_pCSAerialPerspective;
+	delete m_pCSSkyView;
+#endif
+
+#ifdef CLOUD_SHADOW_CASCADES
+	delete m_pCB_ShadowCascades;
+#endif
 	delete m_pCB_Volume;
 	delete m_pCB_Shadow;
 	delete m_pCB_Atmosphere;
 	delete m_pCB_Splat;
 	delete m_pCB_Object;
 
+	delete m_pTexFractalMinMax;
 	delete m_pTexFractal1;
 	delete m_pTexFractal0;
 	delete m_pRTVolumeDepth;
+#ifdef DEPTH_AWARE_UPSAMPLE
+	delete m_pRTRenderUpsampled;
+	delete m_pUpsampler;
+#endif
 	delete m_pRTRender;
 	delete m_pRTRenderZ;
 	delete m_pRTDownsampledDepth;
+#ifdef CLOUD_SHADOW_CASCADES
+	delete m_ppRTShadowCascades[1];
+	delete m_ppRTShadowCascades[0];
+#else
 	delete m_pRTTransmittanceMap;
+#endif
 	delete m_pRTCameraFrustumSplat;
 
 #ifdef SHOW_TERRAIN
+#ifdef TESSELLATED_TERRAIN
+	delete m_pCB_TerrainTessellation;
+	delete m_pSB_TerrainPatches;
+	delete m_pPrimTerrainPatch;
+#endif
 	delete m_pRTTerrainShadow;
 	delete m_pMatTerrainShadow;
 	delete m_pMatTerrain;
@@ -289,8 +486,7 @@ EffectVolumetric::~EffectVolumetric()
 	FreeSkyTables();
 
  	delete m_pMatCombine;
-	delete m_ppMatDisplay[1];
-	delete m_ppMatDisplay[0];
+	delete m_pMatDisplay;
 	delete m_pMatDepthPrePass;
  	delete m_pMatComputeTransmittance;
  	delete m_pMatSplatCameraFrustum;
@@ -310,6 +506,8 @@ EffectVolumetric::~EffectVolumetric()
 
 void	EffectVolumetric::Render( float _Time, float _DeltaTime )
 {
+	GPU_PROFILE_SCOPE( m_Device, "Volumetric" );
+
 // DEBUG
 float	t = 2*0.25f * _Time;
 //m_LightDirection.Set( 0, 1, -1 );
@@ -326,79 +524,87 @@ float	t = 2*0.25f * _Time;
 #ifdef _DEBUG
 	if ( m_pMMF->CheckForChange() )
 	{
-		ParametersBlock&	Params = m_pMMF->GetMappedMemory();
+		const ParametersBlock&	Params = m_pMMF->GetSnapshot();
 
 		//////////////////////////////////////////////////////////////////////////
-		// Check if any change in params requires a sky table rebuild
-		bool	bRequireSkyUpdate = false;
+		// Atmosphere Params
+		if ( m_pMMF->HasChanged( &ParametersBlock::SunTheta, &ParametersBlock::AltitudeOffset ) )
+		{
+			// Check if any change in params requires a sky table rebuild
+			bool	bRequireSkyUpdate = false;
 
-		bRequireSkyUpdate |= !ALMOST( m_pCB_Atmosphere->m.AirParams.x, Params.AirAmount );
-		bRequireSkyUpdate |= !ALMOST( m_pCB_Atmosphere->m.AirParams.y, Params.AirReferenceAltitudeKm );
-		bRequireSkyUpdate |= !ALMOST( m_pCB_Atmosphere->m.FogParams.x, Params.FogScattering );
-		bRequireSkyUpdate |= !ALMOST( m_pCB_Atmosphere->m.FogParams.y, Params.FogExtinction );
-		bRequireSkyUpdate |= !ALMOST( m_pCB_Atmosphere->m.FogParams.z, Params.FogReferenceAltitudeKm );
-		bRequireSkyUpdate |= !ALMOST( m_pCB_Atmosphere->m.FogParams.w, Params.FogAnisotropy );
-		bRequireSkyUpdate |= !ALMOST( m_pCB_PreComputeSky->m._AverageGroundReflectance, Params.AverageGroundReflectance );
+			bRequireSkyUpdate |= !ALMOST( m_pCB_Atmosphere->m.AirParams.x, Params.AirAmount );
+			bRequireSkyUpdate |= !ALMOST( m_pCB_Atmosphere->m.AirParams.y, Params.AirReferenceAltitudeKm );
+			bRequireSkyUpdate |= !ALMOST( m_pCB_Atmosphere->m.FogParams.x, Params.FogScattering );
+			bRequireSkyUpdate |= !ALMOST( m_pCB_Atmosphere->m.FogParams.y, Params.FogExtinction );
+			bRequireSkyUpdate |= !ALMOST( m_pCB_Atmosphere->m.FogParams.z, Params.FogReferenceAltitudeKm );
+			bRequireSkyUpdate |= !ALMOST( m_pCB_Atmosphere->m.FogParams.w, Params.FogAnisotropy );
+			bRequireSkyUpdate |= !ALMOST( m_pCB_PreComputeSky->m._AverageGroundReflectance, Params.AverageGroundReflectance );
 
 
-		//////////////////////////////////////////////////////////////////////////
-		// Atmosphere Params
-		m_pCB_Atmosphere->m.LightDirection.Set( sinf(Params.SunPhi)*sinf(Params.SunTheta), cosf(Params.SunTheta), -cosf(Params.SunPhi)*sinf(Params.SunTheta) );
-		m_pCB_Atmosphere->m.SunIntensity = Params.SunIntensity;
+			m_pCB_Atmosphere->m.LightDirection.Set( sinf(Params.SunPhi)*sinf(Params.SunTheta), cosf(Params.SunTheta), -cosf(Params.SunPhi)*sinf(Params.SunTheta) );
+			m_pCB_Atmosphere->m.SunIntensity = Params.SunIntensity;
 
-		m_pCB_Atmosphere->m.AirParams.Set( Params.AirAmount, Params.AirReferenceAltitudeKm );
-		m_pCB_Atmosphere->m.GodraysStrengthRayleigh = Params.GodraysStrengthRayleigh;
-		m_pCB_Atmosphere->m.GodraysStrengthMie = Params.GodraysStrengthMie;
-		m_pCB_Atmosphere->m.AltitudeOffset = Params.AltitudeOffset;
+			m_pCB_Atmosphere->m.AirParams.Set( Params.AirAmount, Params.AirReferenceAltitudeKm );
+			m_pCB_Atmosphere->m.GodraysStrengthRayleigh = Params.GodraysStrengthRayleigh;
+			m_pCB_Atmosphere->m.GodraysStrengthMie = Params.GodraysStrengthMie;
+			m_pCB_Atmosphere->m.AltitudeOffset = Params.AltitudeOffset;
 
-		m_pCB_Atmosphere->m.FogParams.Set( Params.FogScattering, Params.FogExtinction, Params.FogReferenceAltitudeKm, Params.FogAnisotropy );
+			m_pCB_Atmosphere->m.FogParams.Set( Params.FogScattering, Params.FogExtinction, Params.FogReferenceAltitudeKm, Params.FogAnisotropy );
 
-		m_pCB_Atmosphere->UpdateData();
+			m_pCB_Atmosphere->UpdateData();
 
-		m_pCB_PreComputeSky->m._AverageGroundReflectance = Params.AverageGroundReflectance;
+			m_pCB_PreComputeSky->m._AverageGroundReflectance = Params.AverageGroundReflectance;
 
-		if ( bRequireSkyUpdate )
-			TriggerSkyTablesUpdate();	// Rebuild tables if change in atmosphere params!
+			if ( bRequireSkyUpdate )
+				TriggerSkyTablesUpdate();	// Rebuild tables if change in atmosphere params!
+		}
 
 
 		//////////////////////////////////////////////////////////////////////////
 		// Volumetric Params
-		m_CloudAltitude = Params.CloudBaseAltitude;
-		m_CloudThickness = Params.CloudThickness;
+		if ( m_pMMF->HasChanged( &ParametersBlock::CloudBaseAltitude, &ParametersBlock::NoiseShapingPower ) )
+		{
+			m_CloudAltitude = Params.CloudBaseAltitude;
+			m_CloudThickness = Params.CloudThickness;
 // 		m_Position.Set( 0, Params.CloudBaseAltitude + 0.5f * Params.CloudThickness, -100 );
- 		m_Scale.Set( 0.5f * CLOUD_SIZE, 0.5f * Params.CloudThickness, 0.5f * CLOUD_SIZE );
+			m_Scale.Set( 0.5f * CLOUD_SIZE, 0.5f * Params.CloudThickness, 0.5f * CLOUD_SIZE );
 
-		m_pCB_Volume->m._CloudAltitudeThickness.Set( Params.CloudBaseAltitude, Params.CloudThickness );
-		m_pCB_Volume->m._CloudExtinctionScattering.Set( Params.CloudExtinction, Params.CloudScattering );
-		m_pCB_Volume->m._CloudPhases.Set( Params.CloudAnisotropyIso, Params.CloudAnisotropyForward );
-		m_pCB_Volume->m._CloudShadowStrength = Params.CloudShadowStrength;
+			m_pCB_Volume->m._CloudAltitudeThickness.Set( Params.CloudBaseAltitude, Params.CloudThickness );
+			m_pCB_Volume->m._CloudExtinctionScattering.Set( Params.CloudExtinction, Params.CloudScattering );
+			m_pCB_Volume->m._CloudPhases.Set( Params.CloudAnisotropyIso, Params.CloudAnisotropyForward );
+			m_pCB_Volume->m._CloudShadowStrength = Params.CloudShadowStrength;
 
-		// Isotropic lighting
-		m_pCB_Volume->m._CloudIsotropicScattering = Params.CloudIsotropicScattering;
-		m_pCB_Volume->m._CloudIsotropicFactors.Set( Params.CloudIsoSkyRadianceFactor, Params.CloudIsoSunRadianceFactor, Params.CloudIsoTerrainReflectanceFactor );
+			// Isotropic lighting
+			m_pCB_Volume->m._CloudIsotropicScattering = Params.CloudIsotropicScattering;
+			m_pCB_Volume->m._CloudIsotropicFactors.Set( Params.CloudIsoSkyRadianceFactor, Params.CloudIsoSunRadianceFactor, Params.CloudIsoTerrainReflectanceFactor );
 
-		// Noise
-		m_pCB_Volume->m._CloudLoFreqParams.Set( Params.NoiseLoFrequency, Params.NoiseLoVerticalLooping );
-		m_pCB_Volume->m._CloudHiFreqParams.Set( Params.NoiseHiFrequency, Params.NoiseHiOffset, Params.NoiseHiStrength );
+			// Noise
+			m_pCB_Volume->m._CloudLoFreqParams.Set( Params.NoiseLoFrequency, Params.NoiseLoVerticalLooping );
+			m_pCB_Volume->m._CloudHiFreqParams.Set( Params.NoiseHiFrequency, Params.NoiseHiOffset, Params.NoiseHiStrength );
 
-		m_CloudAnimSpeedLoFreq = Params.NoiseLoAnimSpeed;
-		m_CloudAnimSpeedHiFreq = Params.NoiseHiAnimSpeed;
+			m_CloudAnimSpeedLoFreq = Params.NoiseLoAnimSpeed;
+			m_CloudAnimSpeedHiFreq = Params.NoiseHiAnimSpeed;
 
-		float	HalfMiddleOffset = Params.NoiseOffsetMiddle;
-		m_pCB_Volume->m._CloudOffsets.Set( Params.NoiseOffsetBottom - HalfMiddleOffset, HalfMiddleOffset, Params.NoiseOffsetTop - HalfMiddleOffset );
+			float	HalfMiddleOffset = Params.NoiseOffsetMiddle;
+			m_pCB_Volume->m._CloudOffsets.Set( Params.NoiseOffsetBottom - HalfMiddleOffset, HalfMiddleOffset, Params.NoiseOffsetTop - HalfMiddleOffset );
 
-		m_pCB_Volume->m._CloudContrastGamma.Set( Params.NoiseContrast, Params.NoiseGamma );
-		m_pCB_Volume->m._CloudShapingPower = Params.NoiseShapingPower;
+			m_pCB_Volume->m._CloudContrastGamma.Set( Params.NoiseContrast, Params.NoiseGamma );
+			m_pCB_Volume->m._CloudShapingPower = Params.NoiseShapingPower;
 
-		m_pCB_Volume->UpdateData();
+			// m_pCB_Volume is uploaded every frame anyway because of the cloud animation
+		}
 
 
 		//////////////////////////////////////////////////////////////////////////
 		// Terrain Params
-		m_bShowTerrain = Params.TerrainEnabled == 1;
-		m_pCB_Object->m.TerrainHeight = Params.TerrainHeight;
-		m_pCB_Object->m.AlbedoMultiplier = Params.TerrainAlbedoMultiplier;
-		m_pCB_Object->m.CloudShadowStrength = Params.TerrainCloudShadowStrength;
+		if ( m_pMMF->HasChanged( &ParametersBlock::TerrainEnabled, &ParametersBlock::TerrainCloudShadowStrength ) )
+		{
+			m_bShowTerrain = Params.TerrainEnabled == 1;
+			m_pCB_Object->m.TerrainHeight = Params.TerrainHeight;
+			m_pCB_Object->m.AlbedoMultiplier = Params.TerrainAlbedoMultiplier;
+			m_pCB_Object->m.CloudShadowStrength = Params.TerrainCloudShadowStrength;
+		}
 	}
 #endif
 
@@ -432,6 +638,8 @@ float	t = 2*0.25f * _Time;
 		m_pTexFractal0->SetPS( 16 );
 	if ( m_pTexFractal1 != NULL )
 		m_pTexFractal1->SetPS( 17 );
+	if ( m_pTexFractalMinMax != NULL )
+		m_pTexFractalMinMax->SetPS( 18 );
 
 
 	//////////////////////////////////////////////////////////////////////////
@@ -507,6 +715,9 @@ float	t = 2*0.25f * _Time;
 	// 1.2] Compute transmittance map
 	PERF_BEGIN_EVENT( D3DCOLOR( 0xFF400000 ), L"Render TFM" );
 
+#ifdef CLOUD_SHADOW_CASCADES
+	RenderShadowCascades();
+#else
 	m_Device.ClearRenderTarget( *m_pRTTransmittanceMap, float4( 0.0f, 0.0f, 0.0f, 0.0f ) );
 
 	D3D11_VIEWPORT	Viewport = {
@@ -540,6 +751,7 @@ float	t = 2*0.25f * _Time;
 	// Remove contention on that Transmittance Z we don't need for the next pass...
 	m_Device.RemoveShaderResources( 10 );
 	m_Device.RemoveRenderTargets();
+#endif
 
 	PERF_END_EVENT();
 
@@ -565,7 +777,11 @@ float	t = 2*0.25f * _Time;
 			m_pCB_Object->m.dUV = m_pRTTerrainShadow->GetdUV();
 			m_pCB_Object->UpdateData();
 
+#ifdef TESSELLATED_TERRAIN
+			RenderTerrainPatches( M, m_pCB_Shadow->m.World2TerrainShadow, TERRAIN_SHADOW_TARGET_EDGE_PIXELS, TERRAIN_SHADOW_TESSELLATION_FACTOR );
+#else
 			m_pPrimTerrain->Render( M );
+#endif
 
 		USING_MATERIAL_END
 
@@ -594,7 +810,11 @@ float	t = 2*0.25f * _Time;
 			m_pCB_Object->m.dUV = m_RTHDR.GetdUV();
 			m_pCB_Object->UpdateData();
 
+#ifdef TESSELLATED_TERRAIN
+			RenderTerrainPatches( M, m_Camera.GetCB().World2Proj, TERRAIN_TARGET_EDGE_PIXELS, TERRAIN_TESSELLATION_FACTOR );
+#else
 			m_pPrimTerrain->Render( M );
+#endif
 
 		USING_MATERIAL_END
 
@@ -607,6 +827,26 @@ float	t = 2*0.25f * _Time;
 
 	m_pRTTransmittanceMap->SetPS( 4, true );	// Now we need the TFM!
 
+#ifdef FROXEL_FOG
+	//////////////////////////////////////////////////////////////////////////
+	// 3.5] Inject & integrate the fog in the froxels (opaque & transparent shaders sample the result at t19)
+	PERF_BEGIN_EVENT( D3DCOLOR( 0xFF008080 ), L"Froxel Fog" );
+
+	RenderFroxels();
+
+	PERF_END_EVENT();
+#endif
+
+#ifdef SKY_LUTS
+	//////////////////////////////////////////////////////////////////////////
+	// 3.75] Compute the sky-view & aerial-perspective tables (the sky & opaque shaders sample them at t54 & t55)
+	PERF_BEGIN_EVENT( D3DCOLOR( 0xFF0080FF ), L"Sky LUTs" );
+
+	RenderSkyLUTs();
+
+	PERF_END_EVENT();
+#endif
+
 
 	//////////////////////////////////////////////////////////////////////////
 	// 4] Downsample Depth Buffer
@@ -628,6 +868,11 @@ float	t = 2*0.25f * _Time;
 
 	m_Device.RemoveShaderResources( 0, 3, Device::SSF_COMPUTE_SHADER_UAV );	// Remove contention on downsampled depth
 
+#ifdef DEPTH_AWARE_UPSAMPLE
+	gs_pDepthPyramid->Build( m_Device.DefaultDepthStencil() );	// Free if another effect already built it this frame
+	m_pUpsampler->DownsampleDepth( *gs_pDepthPyramid );
+#endif
+
 	PERF_END_EVENT();
 
 
@@ -635,6 +880,14 @@ float	t = 2*0.25f * _Time;
 	// 5] Render the cloud box's front & back
 	PERF_BEGIN_EVENT( D3DCOLOR( 0xFF800000 ), L"Render Volume Front&Back" );
 
+#ifdef TEMPORAL_CLOUDS
+	{	// Keep last frame's depths for the history rejection
+		Texture2D*	pTemp = m_pRTRenderZ;
+		m_pRTRenderZ = m_pRTRenderZHistory;
+		m_pRTRenderZHistory = pTemp;
+	}
+#endif
+
 	m_Device.ClearRenderTarget( *m_pRTRenderZ, float4( 0.0f, -1e4f, 0.0f, 0.0f ) );
 
 	USING_MATERIAL_START( *m_pMatDepthWrite )
@@ -689,17 +942,51 @@ float	t = 2*0.25f * _Time;
 	// 7] Render the actual volume
 	PERF_BEGIN_EVENT( D3DCOLOR( 0xFFFF0000 ), L"Render Volume" );
 
-//	Material*	pMat = m_Camera.GetCB().Camera2World.GetRow(2).y > m_CloudAltitude+m_CloudThickness ? m_ppMatDisplay[1] : m_ppMatDisplay[0];
-	Shader*	pMat = m_ppMatDisplay[0];
-	USING_MATERIAL_START( *pMat )
+#ifdef TEMPORAL_CLOUDS
+	// Tag the pixels to march this frame
+	int	MarchedOffsetX, MarchedOffsetY;
+	GetTemporalOffset( m_TemporalFrameIndex, MarchedOffsetX, MarchedOffsetY );
 
-		m_Device.ClearRenderTarget( *m_pRTRender, float4( 0.0f, 0.0f, 0.0f, 1.0f ) );
+	m_pCB_Temporal->m.dUV = m_pRTRender->GetdUV();
+	m_pCB_Temporal->m.PatternSize = TEMPORAL_PATTERN_SIZE;
+	m_pCB_Temporal->m.MarchedOffsetX = MarchedOffsetX;
+	m_pCB_Temporal->m.MarchedOffsetY = MarchedOffsetY;
+	m_pCB_Temporal->m.TargetSizeX = m_RenderWidth;
+	m_pCB_Temporal->m.TargetSizeY = m_RenderHeight;
+	m_pCB_Temporal->m.PreviousWorld2Proj = m_Camera.GetCB().PreviousWorld2Proj;	// The history is rebuilt every frame so it's the camera's previous frame
+	m_pCB_Temporal->m.DepthRejection = TEMPORAL_DEPTH_REJECTION;
+	m_pCB_Temporal->m.bHistoryValid = m_bHistoryValid ? 1 : 0;
+
+	m_Device.ClearDepthStencil( *m_pRTRenderStencil, 1.0f, 0, false, true );
+
+	USING_MATERIAL_START( *m_pMatTemporalMask )
+
+		m_Device.SetRenderTargets( m_RenderWidth, m_RenderHeight, 0, NULL, m_pRTRenderStencil->GetDSV() );
+		m_Device.SetStates( NULL, m_pDS_WriteStencil, NULL );
+
+		m_pCB_Temporal->UpdateData();
+
+		m_ScreenQuad.Render( M );
+
+	USING_MATERIAL_END
+#endif
+
+//	Shader*	pMat = &m_pMatDisplay->Get( m_Camera.GetCB().Camera2World.GetRow(2).y > m_CloudAltitude+m_CloudThickness ? m_pMatDisplay->GetKeyword( "CAMERA_ABOVE_CLOUDS" ) : 0 );
+	Shader*	pMat = &m_pMatDisplay->Get( 0 );
+	USING_MATERIAL_START( *pMat )
 
 		ID3D11RenderTargetView*	ppViews[] = {
 			m_pRTRender->GetRTV( 0, 0, 1 ),
 			m_pRTRender->GetRTV( 0, 1, 1 )
 		};
+#ifdef TEMPORAL_CLOUDS
+		// Only march the tagged pixels (the others are reprojected below so there's no need to clear)
+		m_Device.SetRenderTargets( m_pRTRender->GetWidth(), m_pRTRender->GetHeight(), 2, ppViews, m_pRTRenderStencil->GetDSV() );
+		m_Device.SetStates( NULL, m_Device.m_pDS_ReadLessEqual_StencilFailIfZero, NULL );
+#else
+		m_Device.ClearRenderTarget( *m_pRTRender, float4( 0.0f, 0.0f, 0.0f, 1.0f ) );
 		m_Device.SetRenderTargets( m_pRTRender->GetWidth(), m_pRTRender->GetHeight(), 2, ppViews );
+#endif
 
 //		m_pRTRenderZ->SetPS( 10 );
 		m_Device.DefaultDepthStencil().SetPS( 11 );
@@ -724,11 +1011,53 @@ float	t = 2*0.25f * _Time;
 
 	PERF_END_EVENT();
 
+#ifdef TEMPORAL_CLOUDS
+	//////////////////////////////////////////////////////////////////////////
+	// 7.5] Reproject the pixels that were not marched this frame
+	PERF_BEGIN_EVENT( D3DCOLOR( 0xFFFF8000 ), L"Resolve Volume" );
+
+	Texture2D&	History = *m_ppRTHistory[m_TemporalFrameIndex & 1];
+	USING_MATERIAL_START( *m_pMatTemporalResolve )
+
+		ID3D11RenderTargetView*	ppViews[] = {
+			History.GetRTV( 0, 0, 1 ),
+			History.GetRTV( 0, 1, 1 )
+		};
+		m_Device.SetRenderTargets( History.GetWidth(), History.GetHeight(), 2, ppViews );
+		m_Device.SetStates( NULL, m_Device.m_pDS_Disabled, NULL );
+
+		m_pRTRender->SetPS( 10 );
+		m_pRTRenderZ->SetPS( 11 );
+		m_pRTRenderZHistory->SetPS( 12 );
+		m_ppRTHistory[(m_TemporalFrameIndex+1) & 1]->SetPS( 13 );
+		m_pCB_Temporal->UpdateData();
+
+		m_ScreenQuad.Render( M );
+
+	USING_MATERIAL_END
+
+	PERF_END_EVENT();
+
+	m_bHistoryValid = true;
+	m_TemporalFrameIndex++;
+#endif
 
 #endif//### DRIVER PROBLEM
 
 	//////////////////////////////////////////////////////////////////////////
 	// 8] Combine with screen
+#ifdef DEPTH_AWARE_UPSAMPLE
+	PERF_BEGIN_EVENT( D3DCOLOR( 0xFF000080 ), L"Upsample Volume" );
+
+#ifdef TEMPORAL_CLOUDS
+	m_pUpsampler->Upsample( m_Device.DefaultDepthStencil(), History, *m_pRTRenderUpsampled );
+#else
+	m_pUpsampler->Upsample( m_Device.DefaultDepthStencil(), *m_pRTRender, *m_pRTRenderUpsampled );
+#endif
+
+	PERF_END_EVENT();
+#endif
+
 	PERF_BEGIN_EVENT( D3DCOLOR( 0xFF0000FF ), L"Combine" );
 
 	m_Device.SetRenderTarget( m_Device.DefaultRenderTarget(), NULL );
@@ -739,7 +1068,13 @@ float	t = 2*0.25f * _Time;
 		m_pCB_Splat->m.dUV = m_Device.DefaultRenderTarget().GetdUV();
 		m_pCB_Splat->UpdateData();
 
+#if defined(DEPTH_AWARE_UPSAMPLE)
+		m_pRTRenderUpsampled->SetPS( 10 );	// Full resolution cloud rendering, with scattering and extinction
+#elif defined(TEMPORAL_CLOUDS)
+		History.SetPS( 10 );		// Resolved cloud rendering, with scattering and extinction
+#else
 		m_pRTRender->SetPS( 10 );	// Cloud rendering, with scattering and extinction
+#endif
 		m_RTHDR.SetPS( 13 );		// Background scene
 
 // DEBUG
@@ -759,6 +1094,265 @@ float	t = 2*0.25f * _Time;
 	m_Device.RemoveShaderResources( 13 );
 }
 
+#ifdef CLOUD_SHADOW_CASCADES
+//////////////////////////////////////////////////////////////////////////
+// Renders the transmittance map as cascades fixed in the world (i.e. in the light plane) and centered on the camera
+// Cascade 0 is the coarsest and covers SHADOW_CASCADE0_SIZE_KM, each next cascade covers half the size of the previous one.
+//
+// Since the cascades are snapped to their texels, moving the camera only scrolls them by whole texels:
+//	_ The texels still covered are copied from the previous cascades
+//	_ Only the column & row strips that scrolled in are rendered
+// A single cascade is fully re-rendered each frame (round robin) so the animated clouds are eventually refreshed everywhere.
+// Everything is re-rendered if the light frame changes (i.e. new light direction or cloud altitude).
+//
+// The legacy shadow constants (CBShadow) are left with the coarsest cascade so consumers that don't know about cascades
+//	still sample slices 0 & 1 of the transmittance map as before.
+//
+static const float	SHADOW_CASCADE0_SIZE_KM = 128.0f;
+
+void	EffectVolumetric::RenderShadowCascades()
+{
+	// Build the world-fixed light frame: same axes & Z as m_World2Light but not centered on the cloud box that follows the camera
+	float4x4	World2Light = m_World2Light;
+	World2Light.SetRow( 3, float4( 0, 0, World2Light.GetRow( 3 ).z, 1 ) );
+	float4x4	Light2World = World2Light.Inverse();
+
+	float	ZSize = m_pCB_Shadow->m.ZMinMax.y;
+	bool	bInvalidate = !m_bShadowCascadesValid || ZSize != m_ShadowCascadesZSize || memcmp( &World2Light, &m_ShadowCascadesWorld2Light, sizeof(float4x4) ) != 0;
+	m_ShadowCascadesWorld2Light = World2Light;
+	m_ShadowCascadesZSize = ZSize;
+
+	float3	CameraPositionKm = m_Camera.GetCB().Camera2World.GetRow( 3 );
+	float3	CameraPositionLight = float4( CameraPositionKm, 1 ) * World2Light;
+
+	Texture2D&	Source = *m_ppRTShadowCascades[0];
+	Texture2D&	Target = *m_ppRTShadowCascades[1];
+	Target.RemoveFromLastAssignedSlots();
+
+	USING_MATERIAL_START( *m_pMatComputeTransmittance )
+
+		m_pCB_Splat->m.dUV = Target.GetdUV();
+		m_pCB_Splat->UpdateData();
+
+		for ( int CascadeIndex=0; CascadeIndex < SHADOW_CASCADES_COUNT; CascadeIndex++ )
+		{
+			float	TexelSizeKm = SHADOW_CASCADE0_SIZE_KM / ((1 << CascadeIndex) * SHADOW_MAP_SIZE);
+
+			int		OriginX = int( floorf( CameraPositionLight.x / TexelSizeKm ) ) - SHADOW_MAP_SIZE / 2;
+			int		OriginY = int( floorf( CameraPositionLight.y / TexelSizeKm ) ) - SHADOW_MAP_SIZE / 2;
+			int		DeltaX = OriginX - m_pShadowCascadeOrigins[2*CascadeIndex+0];	// The new texel X was the old texel X+DeltaX
+			int		DeltaY = OriginY - m_pShadowCascadeOrigins[2*CascadeIndex+1];
+			m_pShadowCascadeOrigins[2*CascadeIndex+0] = OriginX;
+			m_pShadowCascadeOrigins[2*CascadeIndex+1] = OriginY;
+
+			// Build the UV => Light transform of the cascade
+			float		CascadeSizeKm = SHADOW_MAP_SIZE * TexelSizeKm;
+			float4x4	UV2Light;
+			UV2Light.SetRow( 0, float4( CascadeSizeKm, 0, 0, 0 ) );
+			UV2Light.SetRow( 1, float4( 0, CascadeSizeKm, 0, 0 ) );
+			UV2Light.SetRow( 2, float4( 0, 0, 1, 0 ) );
+			UV2Light.SetRow( 3, float4( OriginX * TexelSizeKm, OriginY * TexelSizeKm, 0, 1 ) );
+			float4x4	Light2UV = UV2Light.Inverse();
+
+			m_pCB_Shadow->m.World2Shadow = World2Light * Light2UV;
+			m_pCB_Shadow->m.Shadow2World = UV2Light * Light2World;
+			m_pCB_Shadow->UpdateData();
+			m_pCB_ShadowCascades->m.World2Cascade[CascadeIndex] = m_pCB_Shadow->m.World2Shadow;
+
+			ID3D11RenderTargetView*	ppViews[2] = {
+				Target.GetRTV( 0, 2*CascadeIndex+0, 1 ),
+				Target.GetRTV( 0, 2*CascadeIndex+1, 1 ),
+			};
+
+			if ( bInvalidate || CascadeIndex == m_ShadowCascadeRefreshIndex || abs(DeltaX) >= SHADOW_MAP_SIZE || abs(DeltaY) >= SHADOW_MAP_SIZE )
+			{	// Full refresh
+				RenderShadowCascadeRect( M, ppViews, 0, 0, SHADOW_MAP_SIZE, SHADOW_MAP_SIZE );
+				continue;
+			}
+
+			// Copy the texels that are still covered
+			int	KeptWidth = SHADOW_MAP_SIZE - abs(DeltaX);
+			int	KeptHeight = SHADOW_MAP_SIZE - abs(DeltaY);
+			int	KeptX = MAX( 0, -DeltaX );
+			int	KeptY = MAX( 0, -DeltaY );
+			Target.CopyRegionFrom( Source, 2*CascadeIndex+0, MAX( 0, DeltaX ), MAX( 0, DeltaY ), KeptWidth, KeptHeight, KeptX, KeptY );
+			Target.CopyRegionFrom( Source, 2*CascadeIndex+1, MAX( 0, DeltaX ), MAX( 0, DeltaY ), KeptWidth, KeptHeight, KeptX, KeptY );
+
+			// Render the column that scrolled in, then the row without the column's corner
+			if ( DeltaX != 0 )
+				RenderShadowCascadeRect( M, ppViews, DeltaX > 0 ? KeptWidth : 0, 0, abs(DeltaX), SHADOW_MAP_SIZE );
+			if ( DeltaY != 0 )
+				RenderShadowCascadeRect( M, ppViews, KeptX, DeltaY > 0 ? KeptHeight : 0, KeptWidth, abs(DeltaY) );
+		}
+
+	USING_MATERIAL_END
+
+	m_pCB_ShadowCascades->UpdateData();
+
+	// Restore the coarsest cascade for the legacy consumers
+	m_pCB_Shadow->m.World2Shadow = m_pCB_ShadowCascades->m.World2Cascade[0];
+	m_pCB_Shadow->m.Shadow2World = m_pCB_Shadow->m.World2Shadow.Inverse();
+	m_pCB_Shadow->UpdateData();
+
+	m_ppRTShadowCascades[0] = &Target;
+	m_ppRTShadowCascades[1] = &Source;
+	m_pRTTransmittanceMap = &Target;
+
+	m_ShadowCascadeRefreshIndex = (m_ShadowCascadeRefreshIndex + 1) % SHADOW_CASCADES_COUNT;
+	m_bShadowCascadesValid = true;
+
+	// Remove contention on that Transmittance Z we don't need for the next pass...
+	m_Device.RemoveShaderResources( 10 );
+	m_Device.RemoveRenderTargets();
+}
+
+void	EffectVolumetric::RenderShadowCascadeRect( Shader& M, ID3D11RenderTargetView* const* _ppViews, int _X, int _Y, int _Width, int _Height )
+{
+	D3D11_VIEWPORT	Viewport = {
+		float(_X),
+		float(_Y),
+		float(_Width),
+		float(_Height),
+		0.0f,	// MinDepth
+		1.0f,	// MaxDepth
+	};
+
+	m_Device.SetRenderTargets( SHADOW_MAP_SIZE, SHADOW_MAP_SIZE, 2, _ppViews, NULL, &Viewport );
+	m_ScreenQuad.Render( M );
+}
+#endif
+
+#ifdef FROXEL_FOG
+//////////////////////////////////////////////////////////////////////////
+// Froxel fog (cf. VolumetricFroxels.hlsl)
+// The camera frustum is cut into FROXELS_W x FROXELS_H x FROXELS_D cells with exponentially distributed slices:
+//	_ CS_Inject computes the in-scattering (sun, sky & point lights) and extinction of the height fog in each froxel.
+//		The sample is jittered within its slice every frame and blended with the previous frame's reprojected froxels.
+//	_ CS_Integrate then walks each column from the camera to accumulate the scattering & transmittance
+// Any shader can then fog a surface with a single lookup in the integrated volume (cf. Inc/Froxels.hlsl)
+//
+void	EffectVolumetric::SetFroxelPointLights( int _Count, const float4* _pLights )
+{
+	ASSERT( _Count <= MAX_FROXEL_POINT_LIGHTS, "Too many froxel point lights!" );
+	_Count = MIN( _Count, int(MAX_FROXEL_POINT_LIGHTS) );
+
+	m_pCB_Froxels->m.PointLightsCount = _Count;
+	memcpy( m_pCB_Froxels->m.pPointLights, _pLights, 2*_Count*sizeof(float4) );
+}
+
+void	EffectVolumetric::RenderFroxels()
+{
+	Texture3D&	Current = *m_ppTexFroxelScattering[m_FroxelFrameIndex & 1];
+	Texture3D&	History = *m_ppTexFroxelScattering[(m_FroxelFrameIndex+1) & 1];
+
+	m_pCB_Froxels->m.SizeX = FROXELS_W;
+	m_pCB_Froxels->m.SizeY = FROXELS_H;
+	m_pCB_Froxels->m.SizeZ = FROXELS_D;
+	m_pCB_Froxels->m.NearKm = FROXEL_NEAR_KM;
+	m_pCB_Froxels->m.FarKm = FROXEL_FAR_KM;
+	m_pCB_Froxels->m.TemporalWeight = FROXEL_TEMPORAL_WEIGHT;
+	m_pCB_Froxels->m.bHistoryValid = m_bFroxelHistoryValid ? 1 : 0;
+	m_pCB_Froxels->m.PreviousWorld2Proj = m_FroxelPreviousWorld2Proj;
+	m_pCB_Froxels->m.JitterZ = FROXEL_JITTERS_Z[m_FroxelFrameIndex & 7];
+	m_pCB_Froxels->m.bTerrainShadow = m_bShowTerrain ? 1 : 0;
+	m_pCB_Froxels->UpdateData();
+
+	// Unbind the integrated fog from last frame's passes before writing it
+	m_pTexFroxelFog->RemoveFromLastAssignedSlots();
+
+	// 1] Inject the lighting in each froxel
+	USING_COMPUTESHADER_START( *m_pCSFroxelInject )
+
+		History.SetCS( 10 );
+#ifdef SHOW_TERRAIN
+		if ( m_bShowTerrain )
+			m_pRTTerrainShadow->SetCS( 11 );
+#endif
+		Current.SetCSUAV( 0, Current.GetUAV( 0, 0, FROXELS_D ) );
+
+		M.Dispatch( (FROXELS_W+3) >> 2, (FROXELS_H+3) >> 2, FROXELS_D >> 2 );
+
+	USING_COMPUTE_SHADER_END
+
+	m_Device.RemoveShaderResources( 0, 1, Device::SSF_COMPUTE_SHADER_UAV );
+	m_Device.RemoveShaderResources( 10, 2, Device::SSF_COMPUTE_SHADER );
+
+	// 2] Integrate front to back
+	USING_COMPUTESHADER_START( *m_pCSFroxelIntegrate )
+
+		Current.SetCS( 10 );
+		m_pTexFroxelFog->SetCSUAV( 0, m_pTexFroxelFog->GetUAV( 0, 0, FROXELS_D ) );
+
+		M.Dispatch( (FROXELS_W+7) >> 3, (FROXELS_H+7) >> 3, 1 );
+
+	USING_COMPUTE_SHADER_END
+
+	m_Device.RemoveShaderResources( 0, 1, Device::SSF_COMPUTE_SHADER_UAV );
+	m_Device.RemoveShaderResources( 10, 1, Device::SSF_COMPUTE_SHADER );
+
+	m_pTexFroxelFog->Set( 19, true );
+
+	m_FroxelPreviousWorld2Proj = m_Camera.GetCB().World2Proj;
+	m_bFroxelHistoryValid = true;
+	m_FroxelFrameIndex++;
+}
+#endif
+
+#ifdef SKY_LUTS
+//////////////////////////////////////////////////////////////////////////
+// Sky-view & aerial-perspective tables (cf. VolumetricSkyLUTs.hlsl)
+// Sampling the 4D scattering table costs several fetches and a lot of parametrization math per pixel, so we only do it for:
+//	_ A SKY_VIEW_W x SKY_VIEW_H latitude/longitude map of the sky around the camera, oriented toward the sun
+//	_ An AERIAL_PERSPECTIVE_SIZE^3 volume of the camera frustum storing the in-scattering & transmittance up to each slice
+// The sky then becomes a single bilinear fetch and the aerial perspective on opaque surfaces a single trilinear fetch (cf. Inc/SkyLUTs.hlsl)
+//
+void	EffectVolumetric::RenderSkyLUTs()
+{
+	float3	SunDirection = m_pCB_Atmosphere->m.LightDirection;
+	SunDirection.y = 0.0f;
+	float	HorizontalLength = SunDirection.Length();
+	SunDirection = HorizontalLength > 1e-4f ? SunDirection / HorizontalLength : float3( 1, 0, 0 );	// Any longitude origin will do for a sun at the zenith
+
+	m_pCB_SkyLUTs->m.SkyViewSizeX = SKY_VIEW_W;
+	m_pCB_SkyLUTs->m.SkyViewSizeY = SKY_VIEW_H;
+	m_pCB_SkyLUTs->m.AerialPerspectiveFarKm = AERIAL_PERSPECTIVE_FAR_KM;
+	m_pCB_SkyLUTs->m.AerialPerspectiveSizeX = AERIAL_PERSPECTIVE_SIZE;
+	m_pCB_SkyLUTs->m.AerialPerspectiveSizeY = AERIAL_PERSPECTIVE_SIZE;
+	m_pCB_SkyLUTs->m.AerialPerspectiveSizeZ = AERIAL_PERSPECTIVE_SIZE;
+	m_pCB_SkyLUTs->m.SunDirection = SunDirection;
+	m_pCB_SkyLUTs->UpdateData();
+
+	// Unbind the tables from last frame's passes before writing them
+	m_pTexSkyView->RemoveFromLastAssignedSlots();
+	m_pTexAerialPerspective->RemoveFromLastAssignedSlots();
+
+	// 1] Sky-view
+	USING_COMPUTESHADER_START( *m_pCSSkyView )
+
+		m_pTexSkyView->SetCSUAV( 0 );
+
+		M.Dispatch( (SKY_VIEW_W+7) >> 3, (SKY_VIEW_H+7) >> 3, 1 );
+
+	USING_COMPUTE_SHADER_END
+
+	m_Device.RemoveShaderResources( 0, 1, Device::SSF_COMPUTE_SHADER_UAV );
+
+	// 2] Aerial perspective
+	USING_COMPUTESHADER_START( *m_pCSAerialPerspective )
+
+		m_pTexAerialPerspective->SetCSUAV( 0, m_pTexAerialPerspective->GetUAV( 0, 0, AERIAL_PERSPECTIVE_SIZE ) );
+
+		M.Dispatch( AERIAL_PERSPECTIVE_SIZE >> 2, AERIAL_PERSPECTIVE_SIZE >> 2, AERIAL_PERSPECTIVE_SIZE >> 2 );
+
+	USING_COMPUTE_SHADER_END
+
+	m_Device.RemoveShaderResources( 0, 1, Device::SSF_COMPUTE_SHADER_UAV );
+
+	m_pTexSkyView->Set( 54, true );
+	m_pTexAerialPerspective->Set( 55, true );
+}
+#endif
+
 //#define	SPLAT_TO_BOX
 #define USE_NUAJ_SHADOW
 #ifdef	SPLAT_TO_BOX
@@ -1450,6 +2044,153 @@ for ( int i=0; i < 5; i++ )
 	return World2Proj;
 }
 
+#ifdef TESSELLATED_TERRAIN
+
+//////////////////////////////////////////////////////////////////////////
+// Tessellated terrain quadtree (cf. Inc/TerrainTessellation.hlsl)
+// Nodes live in the terrain's local [-1,1] XZ plane and are split when their world size, seen from the camera, would yield tessellated
+//	triangle edges larger than the target amount of pixels. Nodes outside of the frustum are discarded.
+// The selection only depends on the camera position so the main & shadow passes select the same patches, the shadow pass only culls
+//	against the terrain shadow map's frustum and uses a lower tessellation factor.
+//
+namespace
+{
+	// Returns false if all the corners of the box are outside of the same clipping plane
+	bool	IsBoxVisible( const float4x4& _World2Proj, const float3& _Min, const float3& _Max )
+	{
+		U32	OutsideMask = 0x3F;
+		for ( int i=0; i < 8; i++ )
+		{
+			float4	Proj = float4( (i&1) ? _Max.x : _Min.x, (i&2) ? _Max.y : _Min.y, (i&4) ? _Max.z : _Min.z, 1 ) * _World2Proj;
+			U32		Outside = 0;
+			if ( Proj.x < -Proj.w )	Outside |= 1;
+			if ( Proj.x > Proj.w )	Outside |= 2;
+			if ( Proj.y < -Proj.w )	Outside |= 4;
+			if ( Proj.y > Proj.w )	Outside |= 8;
+			if ( Proj.z < 0.0f )	Outside |= 16;
+			if ( Proj.z > Proj.w )	Outside |= 32;
+			OutsideMask &= Outside;
+		}
+		return OutsideMask == 0;
+	}
+}
+
+void	EffectVolumetric::RenderTerrainPatches( Shader& M, const float4x4& _World2Proj, float _TargetEdgePixels, int _TessellationFactor )
+{
+	// A node is split when its world size exceeds SplitRatio times its distance to the camera
+	float	TanFovV = m_Camera.GetCB().Params.y;
+	float	SplitRatio = _TargetEdgePixels * _TessellationFactor * 2.0f * TanFovV / m_RTHDR.GetHeight();
+
+	// Neighbors more than log2(TessellationFactor) levels coarser can't be matched anymore
+	int		MaxEdgeShift = 0;
+	while ( (2 << MaxEdgeShift) <= _TessellationFactor )
+		MaxEdgeShift++;
+
+	int		PatchesCount = 0;
+	SelectTerrainPatches( _World2Proj, float2( -1.0f, -1.0f ), 2.0f, 0, SplitRatio, MaxEdgeShift, PatchesCount );
+	if ( PatchesCount == 0 )
+		return;
+
+	m_pSB_TerrainPatches->Write( PatchesCount );
+	m_pSB_TerrainPatches->SetInput( 15 );
+
+	m_pCB_TerrainTessellation->m.TessellationFactor = float(_TessellationFactor);
+	m_pCB_TerrainTessellation->UpdateData();
+
+	m_pPrimTerrainPatch->RenderInstanced( M, PatchesCount );
+}
+
+void	EffectVolumetric::SelectTerrainPatches( const float4x4& _World2Proj, const float2& _Position, float _Size, int _Level, float _SplitRatio, int _MaxEdgeShift, int& _PatchesCount )
+{
+	if ( _PatchesCount >= TERRAIN_MAX_PATCHES )
+		return;	// Out of patches, the farthest nodes will be missing...
+
+	float3	Min, Max;
+	GetTerrainNodeBox( _Position, _Size, Min, Max );
+	if ( !IsBoxVisible( _World2Proj, Min, Max ) )
+		return;
+
+	if ( SplitTerrainNode( _Position, _Size, _Level, _SplitRatio ) )
+	{
+		float	HalfSize = 0.5f * _Size;
+		for ( int i=0; i < 4; i++ )
+			SelectTerrainPatches( _World2Proj, _Position + float2( (i&1) * HalfSize, (i>>1) * HalfSize ), HalfSize, _Level+1, _SplitRatio, _MaxEdgeShift, _PatchesCount );
+		return;
+	}
+
+	// Find the level of the leaves just across the middle of each edge
+	float	Epsilon = 0.25f * 2.0f / (1 << TERRAIN_MAX_LEVEL);
+	float2	pNeighbors[4] = {
+		float2( -Epsilon, 0.5f * _Size ),
+		float2( 0.5f * _Size, -Epsilon ),
+		float2( _Size + Epsilon, 0.5f * _Size ),
+		float2( 0.5f * _Size, _Size + Epsilon ),
+	};
+
+	U32	EdgeShifts = 0;
+	for ( int Edge=0; Edge < 4; Edge++ )
+	{
+		float2	Neighbor = _Position + pNeighbors[Edge];
+		if ( Neighbor.x < -1.0f || Neighbor.x > 1.0f || Neighbor.y < -1.0f || Neighbor.y > 1.0f )
+			continue;	// Terrain border
+
+		int	Shift = _Level - GetTerrainLeafLevel( Neighbor, _SplitRatio );	// Finer neighbors take care of matching our edge
+		EdgeShifts |= U32( MIN( _MaxEdgeShift, MAX( 0, Shift ) ) ) << (8*Edge);
+	}
+
+	TerrainPatch&	Patch = m_pSB_TerrainPatches->m[_PatchesCount++];
+	Patch.Position = _Position;
+	Patch.Size = _Size;
+	Patch.EdgeShifts = EdgeShifts;
+}
+
+bool	EffectVolumetric::SplitTerrainNode( const float2& _Position, float _Size, int _Level, float _SplitRatio ) const
+{
+	if ( _Level >= TERRAIN_MAX_LEVEL )
+		return false;
+
+	float3	Min, Max;
+	GetTerrainNodeBox( _Position, _Size, Min, Max );
+
+	float3	CameraPosition = m_Camera.GetCB().Camera2World.GetRow( 3 );
+	float3	Closest = CameraPosition.Max( Min ).Min( Max );
+	float	Distance = (CameraPosition - Closest).Length();
+
+	return Max.x - Min.x > _SplitRatio * Distance;
+}
+
+// Descends the quadtree to the leaf containing the point
+int		EffectVolumetric::GetTerrainLeafLevel( const float2& _Point, float _SplitRatio ) const
+{
+	float2	Position( -1.0f, -1.0f );
+	float	Size = 2.0f;
+	int		Level = 0;
+	while ( SplitTerrainNode( Position, Size, Level, _SplitRatio ) )
+	{
+		Size *= 0.5f;
+		if ( _Point.x >= Position.x + Size )
+			Position.x += Size;
+		if ( _Point.y >= Position.y + Size )
+			Position.y += Size;
+		Level++;
+	}
+
+	return Level;
+}
+
+void	EffectVolumetric::GetTerrainNodeBox( const float2& _Position, float _Size, float3& _Min, float3& _Max ) const
+{
+	float3	Corner0 = float4( _Position.x, 0, _Position.y, 1 ) * m_Terrain2World;
+	float3	Corner1 = float4( _Position.x + _Size, 0, _Position.y + _Size, 1 ) * m_Terrain2World;
+
+	_Min = Corner0.Min( Corner1 );
+	_Max = Corner0.Max( Corner1 );
+	_Min.y = 0.0f;
+	_Max.y = m_pCB_Object->m.TerrainHeight;
+}
+
+#endif
+
 
 //////////////////////////////////////////////////////////////////////////
 // Builds a fractal texture compositing several octaves of tiling Perlin noise
@@ -1457,6 +2198,148 @@ for ( int i=0; i < 5; i++ )
 #define USE_WIDE_NOISE
 #ifdef USE_WIDE_NOISE
 
+namespace
+{
+	struct	FractalFillData
+	{
+		Noise**		ppNoises;
+		int			OctavesCount;
+		float		AmplitudeFactor;
+		float		Normalizer;
+	};
+
+	void	FillFractal( VolumeBuilder& _Builder, int _Z0, int _Z1, void* _pData )
+	{
+		const FractalFillData&	Data = *((const FractalFillData*) _pData);
+		int		SizeXY = _Builder.GetWidth();
+
+		float3	UVW;
+		for ( int Z=_Z0; Z < _Z1; Z++ )
+		{
+			UVW.z = float( Z ) / SizeXY;	// Here we keep a cubic aspect ratio for voxels so we also divide by the same size as other dimensions: we don't want the noise to quickly loop vertically!
+			float*	pSlice = _Builder.GetSlice( Z );
+			for ( int Y=0; Y < SizeXY; Y++ )
+			{
+				UVW.y = float( Y ) / SizeXY;
+				float*	pScanline = pSlice + SizeXY * Y;
+				for ( int X=0; X < SizeXY; X++ )
+				{
+					UVW.x = float( X ) / SizeXY;
+
+					float	V = 0.0f;
+					float	Amplitude = 1.0f;
+					for ( int OctaveIndex=0; OctaveIndex < Data.OctavesCount; OctaveIndex++ )
+					{
+						V += Amplitude * Data.ppNoises[OctaveIndex]->WrapPerlin( UVW );
+						Amplitude *= Data.AmplitudeFactor;
+					}
+					V *= Data.Normalizer;
+					*pScanline++ = V;
+				}
+			}
+		}
+	}
+
+	// Builds the min/max of the noise in each cell of the volume, stored in the R & G components of RGBA8 texels
+	// Cells are dilated by 1 voxel to account for trilinear filtering at their borders (wrapping in XY since the noise tiles, clamping in Z)
+	U32*	BuildMinMaxCells( const U8* _pVoxels, int _SizeXY, int _SizeZ, int _CellSizeXY, int _CellSizeZ )
+	{
+		int		CellsCountXY = _SizeXY / _CellSizeXY;
+		int		CellsCountZ = _SizeZ / _CellSizeZ;
+		U32*	pCells = new U32[CellsCountXY*CellsCountXY*CellsCountZ];
+
+		U32*	pCell = pCells;
+		for ( int CellZ=0; CellZ < CellsCountZ; CellZ++ )
+			for ( int CellY=0; CellY < CellsCountXY; CellY++ )
+				for ( int CellX=0; CellX < CellsCountXY; CellX++ )
+				{
+					U8	Min = 255, Max = 0;
+					for ( int Z=CellZ*_CellSizeZ-1; Z <= (CellZ+1)*_CellSizeZ; Z++ )
+					{
+						const U8*	pSlice = _pVoxels + _SizeXY*_SizeXY * CLAMP( Z, 0, _SizeZ-1 );
+						for ( int Y=CellY*_CellSizeXY-1; Y <= (CellY+1)*_CellSizeXY; Y++ )
+						{
+							const U8*	pScanline = pSlice + _SizeXY * ((Y + _SizeXY) % _SizeXY);
+							for ( int X=CellX*_CellSizeXY-1; X <= (CellX+1)*_CellSizeXY; X++ )
+							{
+								U8	V = pScanline[(X + _SizeXY) % _SizeXY];
+								Min = MIN( Min, V );
+								Max = MAX( Max, V );
+							}
+						}
+					}
+					*pCell++ = U32(Min) | (U32(Max) << 8);
+				}
+
+		return pCells;
+	}
+
+	// Creates the wrapping noises of the fractal octaves and returns the normalizer of their sum
+	float	CreateFractalOctaves( bool _bBuildFirst, int _OctavesCount, float _AmplitudeFactor, Noise** _ppNoises )
+	{
+		float	NoiseFrequency = 0.0001f;
+		float	FrequencyFactor = 2.0f;
+		for ( int OctaveIndex=0; OctaveIndex < _OctavesCount; OctaveIndex++ )
+		{
+			_ppNoises[OctaveIndex] = new Noise( _bBuildFirst ? 1+OctaveIndex : 37951+OctaveIndex );
+			_ppNoises[OctaveIndex]->SetWrappingParameters( NoiseFrequency, 198746+OctaveIndex );
+			NoiseFrequency *= FrequencyFactor;
+		}
+
+		float	Normalizer = 0.0f;
+		float	Amplitude = 1.0f;
+		for ( int OctaveIndex=1; OctaveIndex < _OctavesCount; OctaveIndex++ )
+		{
+			Normalizer += Amplitude;
+			Amplitude *= _AmplitudeFactor;
+		}
+		return 1.0f / Normalizer;
+	}
+
+#ifdef BUILD_FRACTAL_USING_CS
+	struct	CBFractal
+	{
+		U32		SizeX, SizeY, SizeZ;
+		U32		OctavesCount;
+		U32		SourceSizeX, SourceSizeY, SourceSizeZ;
+		float	Normalizer;
+		float	ScaleMin, ScaleMax;
+		U32		CellSizeXY, CellSizeZ;
+	};
+
+	struct	FractalGradient
+	{
+		float	pComponents[8];	// Same layout as the 6D gradients of the Noise class
+	};
+
+	struct	FractalOctave
+	{
+		float2	WrapCenter0;
+		float2	WrapCenter1;
+		float2	WrapCenter2;
+		float	WrapRadius;
+		float	Amplitude;
+	};
+
+	void	DispatchFractalKernel( ComputeShader& _Kernel, CB<CBFractal>& _CB, int _SizeX, int _SizeY, int _SizeZ )
+	{
+		_CB.m.SizeX = _SizeX;
+		_CB.m.SizeY = _SizeY;
+		_CB.m.SizeZ = _SizeZ;
+		_CB.UpdateData();
+
+		_Kernel.Use();
+		_Kernel.Dispatch( (_SizeX+7) >> 3, (_SizeY+7) >> 3, (_SizeZ+3) >> 2 );
+	}
+#endif
+}
+
+//static const int TEXTURE_SIZE_XY = 360;	// 280 FPS full res
+static const int TEXTURE_SIZE_XY = 180;		// 400 FPS full res
+static const int TEXTURE_SIZE_Z = 16;
+static const int TEXTURE_MIPS = 5;		// Max mips is the lowest dimension's mip
+static const float	FRACTAL_PACK_SCALE_MIN = -0.15062222f, FRACTAL_PACK_SCALE_MAX = 0.16956991f;	// Range of the fractal values mapped to [0,1] by the R8 packing
+
 // ========================================================================
 // Since we're using a very thin slab of volume, vertical precision is not necessary
 // The scale of the world=>noise transform is World * 0.05, meaning the noise will tile every 20 world units.
@@ -1468,198 +2351,230 @@ for ( int i=0; i < 5; i++ )
 //
 // This yields a final teture size of 360x360x16
 //
-Texture3D*	EffectVolumetric::BuildFractalTexture( bool _bBuildFirst )
+// If _ppMinMax is not NULL, it receives a coarse volume with the min/max noise of each cell so the march can leap over cells that can't contain any cloud
+//
+#ifdef BUILD_FRACTAL_USING_CS
+// The GPU version evaluates the same octaves in a R32F scratch volume, builds its mips then packs them into the R8 volume.
+// It only takes a few milliseconds so we don't bother with the disk cache.
+//
+Texture3D*	EffectVolumetric::BuildFractalTexture( bool _bBuildFirst, Texture3D** _ppMinMax )
 {
-	Noise*	pNoises[FRACTAL_OCTAVES];
-	float	NoiseFrequency = 0.0001f;
-	float	FrequencyFactor = 2.0f;
-	float	AmplitudeFactor = _bBuildFirst ? 0.707f : 0.707f;
-
-	for ( int OctaveIndex=0; OctaveIndex < FRACTAL_OCTAVES; OctaveIndex++ )
+	const char*	ppKernelEntryPoints[] = { "CS_Noise", "CS_Downsample", "CS_Pack", "CS_MinMax" };
+	ComputeShader*	ppKernels[4];
+	for ( int KernelIndex=0; KernelIndex < 4; KernelIndex++ )
 	{
-		pNoises[OctaveIndex] = new Noise( _bBuildFirst ? 1+OctaveIndex : 37951+OctaveIndex );
-		pNoises[OctaveIndex]->SetWrappingParameters( NoiseFrequency, 198746+OctaveIndex );
-		NoiseFrequency *= FrequencyFactor;
+		ppKernels[KernelIndex] = CreateComputeShader( IDR_SHADER_VOLUMETRIC_BUILD_FRACTAL, "./Resources/Shaders/VolumetricBuildFractal.hlsl", ppKernelEntryPoints[KernelIndex] );
+		ASSERT( !ppKernels[KernelIndex]->HasErrors(), "Failed to compile fractal kernel!" );
 	}
 
-//static const int TEXTURE_SIZE_XY = 360;	// 280 FPS full res
-static const int TEXTURE_SIZE_XY = 180;		// 400 FPS full res
-static const int TEXTURE_SIZE_Z = 16;
-static const int TEXTURE_MIPS = 5;		// Max mips is the lowest dimension's mip
+	// Upload the tables of the octaves
+	Noise*	pNoises[FRACTAL_OCTAVES];
+	float	AmplitudeFactor = 0.707f;
+	float	Normalizer = CreateFractalOctaves( _bBuildFirst, FRACTAL_OCTAVES, AmplitudeFactor, pNoises );
 
-	int		SizeXY = TEXTURE_SIZE_XY;
-	int		SizeZ = TEXTURE_SIZE_Z;
+	SB<U32>				Permutations( m_Device, FRACTAL_OCTAVES * 2*NOISE_SIZE, true );
+	SB<FractalGradient>	Gradients( m_Device, FRACTAL_OCTAVES * NOISE_SIZE, true );
+	SB<FractalOctave>	Octaves( m_Device, FRACTAL_OCTAVES, true );
 
-	float	Normalizer = 0.0f;
 	float	Amplitude = 1.0f;
-	for ( int OctaveIndex=1; OctaveIndex < FRACTAL_OCTAVES; OctaveIndex++ )
+	for ( int OctaveIndex=0; OctaveIndex < FRACTAL_OCTAVES; OctaveIndex++ )
 	{
-		Normalizer += Amplitude;
+		const Noise&	N = *pNoises[OctaveIndex];
+		memcpy( Permutations.m + 2*NOISE_SIZE*OctaveIndex, N.GetPermutationTable(), 2*NOISE_SIZE*sizeof(U32) );
+		memcpy( Gradients.m + NOISE_SIZE*OctaveIndex, N.GetGradients6D(), NOISE_SIZE*sizeof(FractalGradient) );
+
+		FractalOctave&	O = Octaves.m[OctaveIndex];
+		O.WrapCenter0 = N.GetWrapCenter( 0 );
+		O.WrapCenter1 = N.GetWrapCenter( 1 );
+		O.WrapCenter2 = N.GetWrapCenter( 2 );
+		O.WrapRadius = N.GetWrapRadius();
+		O.Amplitude = Amplitude;
 		Amplitude *= AmplitudeFactor;
+
+		delete pNoises[OctaveIndex];
 	}
-	Normalizer = 1.0f / Normalizer;
+	Permutations.Write();
+	Gradients.Write();
+	Octaves.Write();
+
+	Permutations.SetInput( 10 );
+	Gradients.SetInput( 11 );
+	Octaves.SetInput( 12 );
 
-	float**	ppMips = new float*[TEXTURE_MIPS];
+	CB<CBFractal>	CB_Fractal( m_Device, 10 );
+	CB_Fractal.m.OctavesCount = FRACTAL_OCTAVES;
+	CB_Fractal.m.Normalizer = Normalizer;
+	CB_Fractal.m.ScaleMin = FRACTAL_PACK_SCALE_MIN;
+	CB_Fractal.m.ScaleMax = FRACTAL_PACK_SCALE_MAX;
+	CB_Fractal.m.CellSizeXY = FRACTAL_EMPTY_SPACE_CELL_XY;
+	CB_Fractal.m.CellSizeZ = FRACTAL_EMPTY_SPACE_CELL_Z;
+
+	Texture3D	Scratch( m_Device, TEXTURE_SIZE_XY, TEXTURE_SIZE_XY, TEXTURE_SIZE_Z, PixelFormatR32F::DESCRIPTOR, TEXTURE_MIPS, NULL, false, true );
+	Texture3D*	pResult = new Texture3D( m_Device, TEXTURE_SIZE_XY, TEXTURE_SIZE_XY, TEXTURE_SIZE_Z, PixelFormatR8::DESCRIPTOR, TEXTURE_MIPS, NULL, false, true );
 
 	// Build first mip
-	ppMips[0] = new float[SizeXY*SizeXY*SizeZ];
+	Scratch.SetCSUAV( 0, Scratch.GetUAV( 0, 0, TEXTURE_SIZE_Z ) );
+	DispatchFractalKernel( *ppKernels[0], CB_Fractal, TEXTURE_SIZE_XY, TEXTURE_SIZE_XY, TEXTURE_SIZE_Z );
+	Scratch.RemoveFromLastAssignedSlotUAV();
 
-#if 0
-	// Build & Save
-	NjFloat3	UVW;
-	for ( int Z=0; Z < SizeZ; Z++ )
+	// Build other mips & pack
+	int	SizeXY = TEXTURE_SIZE_XY, SizeZ = TEXTURE_SIZE_Z;
+	for ( int MipIndex=0; MipIndex < TEXTURE_MIPS; MipIndex++ )
 	{
-		UVW.z = float( Z ) / SizeXY;	// Here we keep a cubic aspect ratio for voxels so we also divide by the same size as other dimensions: we don't want the noise to quickly loop vertically!
-		float*	pSlice = ppMips[0] + SizeXY*SizeXY*Z;
-		for ( int Y=0; Y < SizeXY; Y++ )
+		if ( MipIndex > 0 )
 		{
-			UVW.y = float( Y ) / SizeXY;
-			float*	pScanline = pSlice + SizeXY * Y;
-			for ( int X=0; X < SizeXY; X++ )
-			{
-				UVW.x = float( X ) / SizeXY;
+			CB_Fractal.m.SourceSizeX = CB_Fractal.m.SourceSizeY = SizeXY;
+			CB_Fractal.m.SourceSizeZ = SizeZ;
+			SizeXY = MAX( 1, SizeXY >> 1 );
+			SizeZ = MAX( 1, SizeZ >> 1 );
+
+			Scratch.SetCS( 13, false, Scratch.GetSRV( MipIndex-1, 1 ) );
+			Scratch.SetCSUAV( 0, Scratch.GetUAV( MipIndex, 0, SizeZ ) );
+			DispatchFractalKernel( *ppKernels[1], CB_Fractal, SizeXY, SizeXY, SizeZ );
+			Scratch.RemoveFromLastAssignedSlotUAV();
+		}
 
-				float	V = 0.0f;
-				float	Amplitude = 1.0f;
-				for ( int OctaveIndex=0; OctaveIndex < FRACTAL_OCTAVES; OctaveIndex++ )
-				{
-					V += Amplitude * pNoises[OctaveIndex]->WrapPerlin( UVW );
-					Amplitude *= AmplitudeFactor;
-				}
-				V *= Normalizer;
-				*pScanline++ = V;
-			}
+		Scratch.SetCS( 13, false, Scratch.GetSRV( MipIndex, 1 ) );
+		pResult->SetCSUAV( 0, pResult->GetUAV( MipIndex, 0, SizeZ ) );
+		DispatchFractalKernel( *ppKernels[2], CB_Fractal, SizeXY, SizeXY, SizeZ );
+		pResult->RemoveFromLastAssignedSlotUAV();
+		m_Device.RemoveShaderResources( 13, 1, Device::SSF_COMPUTE_SHADER );
+	}
+
+	// Build the empty space skipping volume from the quantized values the shader will actually sample
+	if ( _ppMinMax != NULL )
+	{
+		int	CellsCountXY = TEXTURE_SIZE_XY / FRACTAL_EMPTY_SPACE_CELL_XY;
+		int	CellsCountZ = TEXTURE_SIZE_Z / FRACTAL_EMPTY_SPACE_CELL_Z;
+		*_ppMinMax = new Texture3D( m_Device, CellsCountXY, CellsCountXY, CellsCountZ, PixelFormatRGBA8::DESCRIPTOR, 1, NULL, false, true );
+
+		CB_Fractal.m.SourceSizeX = CB_Fractal.m.SourceSizeY = TEXTURE_SIZE_XY;
+		CB_Fractal.m.SourceSizeZ = TEXTURE_SIZE_Z;
+
+		pResult->SetCS( 13, false, pResult->GetSRV( 0, 1 ) );
+		(*_ppMinMax)->SetCSUAV( 1, (*_ppMinMax)->GetUAV( 0, 0, CellsCountZ ) );
+		DispatchFractalKernel( *ppKernels[3], CB_Fractal, CellsCountXY, CellsCountXY, CellsCountZ );
+		(*_ppMinMax)->RemoveFromLastAssignedSlotUAV();
+	}
+
+	m_Device.RemoveShaderResources( 10, 4, Device::SSF_COMPUTE_SHADER );
+
+	for ( int KernelIndex=0; KernelIndex < 4; KernelIndex++ )
+		delete ppKernels[KernelIndex];
+
+	return pResult;
+}
+
+#else
+Texture3D*	EffectVolumetric::BuildFractalTexture( bool _bBuildFirst, Texture3D** _ppMinMax )
+{
+	// Reuse the texture built at last launch if it's still there
+	const char*	pCacheFileName = _bBuildFirst ? "./Noise180x180x16_0.pom" : "./Noise180x180x16.pom";
+	const char*	pMinMaxCacheFileName = _bBuildFirst ? "./Noise180x180x16_MinMax_0.pom" : "./Noise180x180x16_MinMax.pom";
+	const int	CellsCountXY = TEXTURE_SIZE_XY / FRACTAL_EMPTY_SPACE_CELL_XY;
+	const int	CellsCountZ = TEXTURE_SIZE_Z / FRACTAL_EMPTY_SPACE_CELL_Z;
+
+	Texture3D*	pResult = VolumeBuilder::LoadCachedTexture( pCacheFileName, TEXTURE_SIZE_XY, TEXTURE_SIZE_XY, TEXTURE_SIZE_Z, PixelFormatR8::DESCRIPTOR, TEXTURE_MIPS );
+	if ( pResult != NULL && _ppMinMax != NULL )
+	{	// Both must be there or we build them again
+		*_ppMinMax = VolumeBuilder::LoadCachedTexture( pMinMaxCacheFileName, CellsCountXY, CellsCountXY, CellsCountZ, PixelFormatRGBA8::DESCRIPTOR, 1 );
+		if ( *_ppMinMax == NULL )
+		{
+			delete pResult;
+			pResult = NULL;
 		}
 	}
+	if ( pResult != NULL )
+		return pResult;
+
+	Noise*	pNoises[FRACTAL_OCTAVES];
+	float	AmplitudeFactor = 0.707f;
+	float	Normalizer = CreateFractalOctaves( _bBuildFirst, FRACTAL_OCTAVES, AmplitudeFactor, pNoises );
+
+	int		SizeXY = TEXTURE_SIZE_XY;
+	int		SizeZ = TEXTURE_SIZE_Z;
+
+	VolumeBuilder	Builder( TEXTURE_SIZE_XY, TEXTURE_SIZE_XY, TEXTURE_SIZE_Z, 1, TEXTURE_MIPS );
+
+	// Build first mip
+#if 0
+	// Build & Save
+	FractalFillData	Data;
+	Data.ppNoises = pNoises;
+	Data.OctavesCount = FRACTAL_OCTAVES;
+	Data.AmplitudeFactor = AmplitudeFactor;
+	Data.Normalizer = Normalizer;
+	Builder.Fill( FillFractal, &Data );
+
 	FILE*	pFile = NULL;
 	fopen_s( &pFile, _bBuildFirst ? "FractalNoise0.float" : "FractalNoise1.float", "wb" );
 	ASSERT( pFile != NULL, "Couldn't write fractal file!" );
-	fwrite( ppMips[0], sizeof(float), SizeXY*SizeXY*SizeZ, pFile );
+	fwrite( Builder.GetMip( 0 ), sizeof(float), SizeXY*SizeXY*SizeZ, pFile );
 	fclose( pFile );
 #else
 	// Only load
 	FILE*	pFile = NULL;
 	fopen_s( &pFile, _bBuildFirst ? "FractalNoise0.float" : "FractalNoise1.float", "rb" );
 	ASSERT( pFile != NULL, "Couldn't load fractal file!" );
-	fread_s( ppMips[0], SizeXY*SizeXY*SizeZ*sizeof(float), sizeof(float), SizeXY*SizeXY*SizeZ, pFile );
+	fread_s( Builder.GetMip( 0 ), SizeXY*SizeXY*SizeZ*sizeof(float), sizeof(float), SizeXY*SizeXY*SizeZ, pFile );
 	fclose( pFile );
 #endif
 
 	// Build other mips
-	for ( int MipIndex=1; MipIndex < TEXTURE_MIPS; MipIndex++ )
-	{
-		int		SourceSizeXY = SizeXY;
-		int		SourceSizeZ = SizeZ;
-		SizeXY = MAX( 1, SizeXY >> 1 );
-		SizeZ = MAX( 1, SizeZ >> 1 );
-
-		float*	pSource = ppMips[MipIndex-1];
-		float*	pTarget = new float[SizeXY*SizeXY*SizeZ];
-		ppMips[MipIndex] = pTarget;
-
-		for ( int Z=0; Z < SizeZ; Z++ )
-		{
-			float*	pSlice0 = pSource + SourceSizeXY*SourceSizeXY*(2*Z);
-			float*	pSlice1 = pSource + SourceSizeXY*SourceSizeXY*(2*Z+1);
-			float*	pSliceT = pTarget + SizeXY*SizeXY*Z;
-			for ( int Y=0; Y < SizeXY; Y++ )
-			{
-				float*	pScanline00 = pSlice0 + SourceSizeXY * (2*Y);
-				float*	pScanline01 = pSlice0 + SourceSizeXY * (2*Y+1);
-				float*	pScanline10 = pSlice1 + SourceSizeXY * (2*Y);
-				float*	pScanline11 = pSlice1 + SourceSizeXY * (2*Y+1);
-				float*	pScanlineT = pSliceT + SizeXY*Y;
-				for ( int X=0; X < SizeXY; X++ )
-				{
-					float	V  = pScanline00[0] + pScanline00[1];	// From slice 0, current line
-							V += pScanline01[0] + pScanline01[1];	// From slice 0, next line
-							V += pScanline10[0] + pScanline10[1];	// From slice 1, current line
-							V += pScanline11[0] + pScanline11[1];	// From slice 1, next line
-					V *= 0.125f;
-
-					*pScanlineT++ = V;
-
-					pScanline00 += 2;
-					pScanline01 += 2;
-					pScanline10 += 2;
-					pScanline11 += 2;
-				}
-			}
-		}
-	}
+	Builder.GenerateMips();
 
 #define PACK_R8	// Use R8 instead of R32F
 #ifdef PACK_R8
 
-	const float	ScaleMin = -0.15062222f, ScaleMax = 0.16956991f;
-
 	// Convert mips to U8
 	U8**	ppMipsU8 = new U8*[TEXTURE_MIPS];
 
-	SizeXY = TEXTURE_SIZE_XY;
-	SizeZ = TEXTURE_SIZE_Z;
 	for ( int MipIndex=0; MipIndex < TEXTURE_MIPS; MipIndex++ )
 	{
-		float*	pSource = ppMips[MipIndex];
+		float*	pSource = Builder.GetMip( MipIndex );
 		U8*		pTarget = new U8[SizeXY*SizeXY*SizeZ];
 		ppMipsU8[MipIndex] = pTarget;
 
-		float	Min = +1.0, Max = -1.0f;
-		for ( int Z=0; Z < SizeZ; Z++ )
+		for ( int VoxelIndex=0; VoxelIndex < SizeXY*SizeXY*SizeZ; VoxelIndex++ )
 		{
-			float*	pSlice = pSource + SizeXY*SizeXY*Z;
-			U8*		pSliceT = pTarget + SizeXY*SizeXY*Z;
-			for ( int Y=0; Y < SizeXY; Y++ )
-			{
-				float*	pScanline = pSlice + SizeXY * Y;
-				U8*		pScanlineT = pSliceT + SizeXY*Y;
-				for ( int X=0; X < SizeXY; X++ )
-				{
-					float	V = *pScanline++;
-							V = (V-ScaleMin)/(ScaleMax-ScaleMin);
-					*pScanlineT++ = U8( MIN( 255, int(256 * V) ) );
-
-					Min = MIN( Min, V );
-					Max = MAX( Max, V );
-				}
-			}
+			float	V = *pSource++;
+					V = (V-FRACTAL_PACK_SCALE_MIN)/(FRACTAL_PACK_SCALE_MAX-FRACTAL_PACK_SCALE_MIN);
+			*pTarget++ = U8( MIN( 255, int(256 * V) ) );
 		}
 
 		SizeXY = MAX( 1, SizeXY >> 1 );
 		SizeZ = MAX( 1, SizeZ >> 1 );
 	}
 
-	// Build actual R8 texture
-	Texture3D*	pResult = new Texture3D( m_Device, TEXTURE_SIZE_XY, TEXTURE_SIZE_XY, TEXTURE_SIZE_Z, PixelFormatR8::DESCRIPTOR, TEXTURE_MIPS, (void**) ppMipsU8 );
+	// Build actual R8 texture and save it for next time
+	pResult = new Texture3D( m_Device, TEXTURE_SIZE_XY, TEXTURE_SIZE_XY, TEXTURE_SIZE_Z, PixelFormatR8::DESCRIPTOR, TEXTURE_MIPS, (void**) ppMipsU8 );
+	VolumeBuilder::SaveCachedTexture( pCacheFileName, TEXTURE_SIZE_XY, TEXTURE_SIZE_XY, TEXTURE_SIZE_Z, PixelFormatR8::DESCRIPTOR, TEXTURE_MIPS, (void**) ppMipsU8 );
+
+	if ( _ppMinMax != NULL )
+	{	// Build the empty space skipping volume from the quantized values the shader will actually sample
+		U32*	pCells = BuildMinMaxCells( ppMipsU8[0], TEXTURE_SIZE_XY, TEXTURE_SIZE_Z, FRACTAL_EMPTY_SPACE_CELL_XY, FRACTAL_EMPTY_SPACE_CELL_Z );
+		*_ppMinMax = new Texture3D( m_Device, CellsCountXY, CellsCountXY, CellsCountZ, PixelFormatRGBA8::DESCRIPTOR, 1, (void**) &pCells );
+		VolumeBuilder::SaveCachedTexture( pMinMaxCacheFileName, CellsCountXY, CellsCountXY, CellsCountZ, PixelFormatRGBA8::DESCRIPTOR, 1, (void**) &pCells );
+		delete[] pCells;
+	}
 
 	for ( int MipIndex=0; MipIndex < TEXTURE_MIPS; MipIndex++ )
 		delete[] ppMipsU8[MipIndex];
 	delete[] ppMipsU8;
 
-
-#if 1
-	// Save as POM format
-	Texture3D*	pStagingNoise = new Texture3D( m_Device, TEXTURE_SIZE_XY, TEXTURE_SIZE_XY, TEXTURE_SIZE_Z, PixelFormatR8::DESCRIPTOR, TEXTURE_MIPS, NULL, true );
-	pStagingNoise->CopyFrom( *pResult );
-	pStagingNoise->Save( "./Noise180x180x16.pom" );
-	delete pStagingNoise;
-#endif
-
-
 #else
 	// Build actual R32F texture
-	Texture3D*	pResult = new Texture3D( m_Device, TEXTURE_SIZE_XY, TEXTURE_SIZE_XY, TEXTURE_SIZE_Z, PixelFormatR32F::DESCRIPTOR, TEXTURE_MIPS, (void**) ppMips );
+	pResult = Builder.CreateTexture( PixelFormatR32F::DESCRIPTOR );
+	if ( _ppMinMax != NULL )
+		*_ppMinMax = NULL;	// Empty space skipping is only supported with the R8 packing
 #endif
 
-	for ( int MipIndex=0; MipIndex < TEXTURE_MIPS; MipIndex++ )
-		delete[] ppMips[MipIndex];
-	delete[] ppMips;
-
 	for ( int OctaveIndex=0; OctaveIndex < FRACTAL_OCTAVES; OctaveIndex++ )
 		delete pNoises[OctaveIndex];
 
 	return pResult;
 }
+#endif
 
 #else
 //////////////////////////////////////////////////////////////////////////
@@ -1675,8 +2590,11 @@ namespace
 }
 
 
-Texture3D*	EffectVolumetric::BuildFractalTexture( bool _bBuildFirst )
+Texture3D*	EffectVolumetric::BuildFractalTexture( bool _bBuildFirst, Texture3D** _ppMinMax )
 {
+	if ( _ppMinMax != NULL )
+		*_ppMinMax = NULL;	// Empty space skipping is only supported with the wide noise
+
 	Noise*	pNoises[FRACTAL_OCTAVES];
 	float	NoiseFrequency = 0.0001f;
 	float	FrequencyFactor = 2.0f;
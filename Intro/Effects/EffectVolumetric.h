@@ -1,8 +1,15 @@
 #pragma once
 
 #define SHOW_TERRAIN
+#define TESSELLATED_TERRAIN		// Define this to render the terrain as a quadtree of patches tessellated on the GPU according to their screen size (cf. Inc/TerrainTessellation.hlsl)
+#define TEMPORAL_CLOUDS	// Define this to ray-march only a subset of the cloud pixels each frame and reproject the others from the previous frame (cf. VolumetricTemporal.hlsl)
+#define CLOUD_SHADOW_CASCADES	// Define this to render the cloud transmittance map as world-fixed cascades that only re-render the texels scrolled in (cf. Inc/CloudShadowCascades.hlsl)
+#define FROXEL_FOG				// Define this to inject & integrate the fog lighting in a camera-aligned volume that shaders sample with a single lookup (cf. Inc/Froxels.hlsl)
+#define DEPTH_AWARE_UPSAMPLE	// Define this to upsample the clouds to full resolution with nearest-depth selection on edges before combining them (cf. Utility/DepthUpsampler.h)
+#define SKY_LUTS				// Define this to compute a sky-view map & an aerial-perspective volume each frame so the sky & the fog on surfaces are single lookups (cf. Inc/SkyLUTs.hlsl)
 
 //#define BUILD_SKY_TABLES_USING_CS			// Use the Compute Shader version
+#define BUILD_FRACTAL_USING_CS				// Generate the cloud fractal with compute shaders instead of building/loading it on the CPU (cf. VolumetricBuildFractal.hlsl)
 
 #define	TRANSMITTANCE_W			256			// cos(theta)
 #define	TRANSMITTANCE_H			64			// Altitude
@@ -23,6 +30,7 @@
 
 
 template<typename> class CB;
+template<typename> class SB;
 
 class EffectVolumetric
 {
@@ -30,9 +38,26 @@ private:	// CONSTANTS
 
 	static const int		SHADOW_MAP_SIZE = 512;//256;
 	static const int		TERRAIN_SHADOW_MAP_SIZE = 512;
+	static const int		SHADOW_CASCADES_COUNT = 4;	// Each cascade covers half the size of the previous one, using 2 slices of the cascades array (cf. CBShadowCascades)
 
 	static const int		FRACTAL_TEXTURE_POT = 7;
 	static const int		FRACTAL_OCTAVES = 14;
+	static const int		FRACTAL_EMPTY_SPACE_CELL_XY = 6;	// Size of the cells of the min/max noise volume used to skip empty space (the 180x180x16 fractal yields 30x30x4 cells)
+	static const int		FRACTAL_EMPTY_SPACE_CELL_Z = 4;
+
+	static const int		TEMPORAL_PATTERN_SIZE = 2;	// Only 1 pixel of each 2x2 block is marched each frame (use 4 to march 1/16 of the pixels)
+
+	static const int		FROXELS_W = 160;			// Froxel volume resolution (exponential slices in Z)
+	static const int		FROXELS_H = 90;
+	static const int		FROXELS_D = 64;
+	static const int		MAX_FROXEL_POINT_LIGHTS = 8;
+
+	static const int		SKY_VIEW_W = 192;			// Latitude/longitude sky-view map resolution
+	static const int		SKY_VIEW_H = 108;
+	static const int		AERIAL_PERSPECTIVE_SIZE = 32;	// Aerial-perspective volume resolution (linear slices in Z)
+
+	static const int		TERRAIN_MAX_PATCHES = 1024;
+	static const int		TERRAIN_MAX_LEVEL = 7;		// The finest patches cover 1/128 of the terrain's size
 
 
 public:		// NESTED TYPES
@@ -107,6 +132,61 @@ public:		// NESTED TYPES
 		float		__PAD3;
 	};
 
+	struct	CBTemporal
+	{
+		float3		dUV;
+		U32			PatternSize;
+		int			MarchedOffsetX, MarchedOffsetY;
+		int			TargetSizeX, TargetSizeY;
+		float4x4	PreviousWorld2Proj;
+		float		DepthRejection;
+		U32			bHistoryValid;
+		float2		__PAD;
+	};
+
+	struct	CBShadowCascades
+	{
+		float4x4	World2Cascade[SHADOW_CASCADES_COUNT];	// From coarsest to finest, yields the cascade's UV in XY and the same Z as World2Shadow
+	};
+
+	struct	CBFroxels
+	{
+		U32			SizeX, SizeY, SizeZ;
+		U32			PointLightsCount;
+		float		NearKm, FarKm;			// Depth range covered by the slices
+		float		TemporalWeight;			// Weight of the reprojected history
+		U32			bHistoryValid;
+		float4x4	PreviousWorld2Proj;
+		float		JitterZ;				// Position of this frame's samples within their slice, in [0,1[
+		U32			bTerrainShadow;
+		float2		__PAD;
+		float4		pPointLights[2*MAX_FROXEL_POINT_LIGHTS];	// 2 per light: XYZ=Position (km) W=Radius (km), then RGB=Intensity
+	};
+
+	struct	CBSkyLUTs
+	{
+		U32			SkyViewSizeX, SkyViewSizeY;
+		float		AerialPerspectiveFarKm;	// Depth of the last slice
+		float		__PAD0;
+		U32			AerialPerspectiveSizeX, AerialPerspectiveSizeY, AerialPerspectiveSizeZ;
+		float		__PAD1;
+		float3		SunDirection;			// Horizontal direction of the sun, the origin of the sky-view longitudes
+		float		__PAD2;
+	};
+
+	struct	CBTerrainTessellation
+	{
+		float		TessellationFactor;
+		float3		__PAD;
+	};
+
+	struct	TerrainPatch
+	{
+		float2		Position;				// Local XZ position of the patch's min corner
+		float		Size;					// Local size of the patch
+		U32			EdgeShifts;				// 8 bits per edge (-X, -Z, +X, +Z), each edge's tessellation factor is divided by 2^Shift to match a coarser neighbor
+	};
+
 	struct	CBPreComputeCS
 	{
 		U32		_TargetSizeX;	// Final render target size (2D or 3D)
@@ -164,7 +244,7 @@ private:	// FIELDS
 	Shader*			m_pMatSplatCameraFrustum;
 	Shader*			m_pMatComputeTransmittance;
 	Shader*			m_pMatDepthPrePass;
-	Shader*			m_ppMatDisplay[2];
+	ShaderPermutations*	m_pMatDisplay;
 	Shader*			m_pMatCombine;
 
 	Primitive*			m_pPrimBox;
@@ -174,16 +254,59 @@ private:	// FIELDS
 	Texture2D*			m_pRTTerrainShadow;
 	Shader*			m_pMatTerrainShadow;
 	Shader*			m_pMatTerrain;
+#ifdef TESSELLATED_TERRAIN
+	Primitive*			m_pPrimTerrainPatch;	// A unit square of 4 control points, instanced for each patch
+	SB<TerrainPatch>*	m_pSB_TerrainPatches;
+	CB<CBTerrainTessellation>*	m_pCB_TerrainTessellation;
+#endif
 #endif
 
 	Texture2D*			m_pRTDownsampledDepth;
 	Texture3D*			m_pTexFractal0;
 	Texture3D*			m_pTexFractal1;
+	Texture3D*			m_pTexFractalMinMax;	// Min/Max of m_pTexFractal1 in coarse cells (cf. Inc/CloudEmptySpace.hlsl)
 	Texture2D*			m_pRTCameraFrustumSplat;
 	Texture2D*			m_pRTTransmittanceMap;
 	Texture2D*			m_pRTVolumeDepth;
 	Texture2D*			m_pRTRenderZ;
 	Texture2D*			m_pRTRender;
+#ifdef DEPTH_AWARE_UPSAMPLE
+	DepthUpsampler*		m_pUpsampler;
+	Texture2D*			m_pRTRenderUpsampled;	// Full resolution clouds (same layout as m_pRTRender)
+#endif
+#ifdef TEMPORAL_CLOUDS
+	Shader*				m_pMatTemporalMask;
+	Shader*				m_pMatTemporalResolve;
+	DepthStencilState*	m_pDS_WriteStencil;
+	Texture2D*			m_pRTRenderStencil;		// Tags the pixels to march this frame
+	Texture2D*			m_pRTRenderZHistory;	// Previous frame's m_pRTRenderZ (they're swapped each frame)
+	Texture2D*			m_ppRTHistory[2];		// Resolved clouds of the current & previous frames (same layout as m_pRTRender)
+	U32					m_TemporalFrameIndex;
+	bool				m_bHistoryValid;
+#endif
+#ifdef CLOUD_SHADOW_CASCADES
+	Texture2D*			m_ppRTShadowCascades[2];	// Current & previous cascades, m_pRTTransmittanceMap points to the current ones
+	float4x4			m_ShadowCascadesWorld2Light;// The world-fixed light frame the cascades were rendered in
+	float				m_ShadowCascadesZSize;
+	int					m_pShadowCascadeOrigins[2*SHADOW_CASCADES_COUNT];	// Position of each cascade's first texel in the light plane, in texels
+	int					m_ShadowCascadeRefreshIndex;// The cascade fully re-rendered this frame so animated clouds don't stay frozen in the scrolled texels
+	bool				m_bShadowCascadesValid;
+#endif
+#ifdef FROXEL_FOG
+	ComputeShader*		m_pCSFroxelInject;
+	ComputeShader*		m_pCSFroxelIntegrate;
+	Texture3D*			m_ppTexFroxelScattering[2];	// In-scattering & extinction of each froxel for the current & previous frames
+	Texture3D*			m_pTexFroxelFog;			// Integrated from the camera: RGB=Accumulated scattering, A=Transmittance
+	U32					m_FroxelFrameIndex;
+	float4x4			m_FroxelPreviousWorld2Proj;
+	bool				m_bFroxelHistoryValid;
+#endif
+#ifdef SKY_LUTS
+	ComputeShader*		m_pCSSkyView;
+	ComputeShader*		m_pCSAerialPerspective;
+	Texture2D*			m_pTexSkyView;				// Sky radiance around the camera
+	Texture3D*			m_pTexAerialPerspective;	// Integrated from the camera: RGB=Accumulated scattering, A=Transmittance
+#endif
 
 	// Sky rendering
 	Texture2D*			m_ppRTTransmittance[2];
@@ -199,6 +322,18 @@ private:	// FIELDS
 	CB<CBShadow>*		m_pCB_Shadow;
 	CB<CBVolume>*		m_pCB_Volume;
 	CB<CBPreComputeCS>*	m_pCB_PreComputeSky;
+#ifdef TEMPORAL_CLOUDS
+	CB<CBTemporal>*		m_pCB_Temporal;
+#endif
+#ifdef CLOUD_SHADOW_CASCADES
+	CB<CBShadowCascades>*	m_pCB_ShadowCascades;
+#endif
+#ifdef FROXEL_FOG
+	CB<CBFroxels>*		m_pCB_Froxels;
+#endif
+#ifdef SKY_LUTS
+	CB<CBSkyLUTs>*		m_pCB_SkyLUTs;
+#endif
 
 	float4x4			m_World2Light;
 	float4x4			m_Light2ShadowNormalized;	// Yields a normalized Z instead of world units like World2Shadow
@@ -294,16 +429,27 @@ public:		// METHODS
 
 	void		Render( float _Time, float _DeltaTime );
 
+#ifdef FROXEL_FOG
+	// Sets the point lights injected in the fog (2 float4 per light, cf. CBFroxels::pPointLights)
+	void		SetFroxelPointLights( int _Count, const float4* _pLights );
+#endif
+
 protected:
 
 	// Sky tables computation
 	void		InitSkyTables();
 	void		FreeSkyTables();
 
+		// Disk cache
+	U32			ComputeSkyTablesHash() const;
+	bool		LoadCachedSkyTables( U32 _Hash );
+	void		SaveCachedSkyTables( U32 _Hash );
+
 		// Time-sliced update
 	void		ExitUpdateSkyTables();
 	void		TriggerSkyTablesUpdate();
 	void		UpdateSkyTables();
+	void		UpdateSkyTablesPass();		// Issues a single pass of the current stage
 
 	void		InitMultiPassStage( int _StageIndex, int _TargetSizeX, int _TargetSizeY, int _TargetSizeZ, int _StepsCount );
 	void		InitSinglePassStage( int _TargetSizeX, int _TargetSizeY, int _TargetSizeZ, int _StepsCount );
@@ -338,6 +484,23 @@ protected:
 	void		ComputeFrustumIntersection( float3 _pCameraFrustumKm[5], float _PlaneHeight, float2& _QuadMin, float2& _QuadMax );
 
 	float4x4	ComputeTerrainShadowTransform();
+#ifdef TESSELLATED_TERRAIN
+	void		RenderTerrainPatches( Shader& M, const float4x4& _World2Proj, float _TargetEdgePixels, int _TessellationFactor );
+	void		SelectTerrainPatches( const float4x4& _World2Proj, const float2& _Position, float _Size, int _Level, float _SplitRatio, int _MaxEdgeShift, int& _PatchesCount );
+	bool		SplitTerrainNode( const float2& _Position, float _Size, int _Level, float _SplitRatio ) const;
+	int			GetTerrainLeafLevel( const float2& _Point, float _SplitRatio ) const;
+	void		GetTerrainNodeBox( const float2& _Position, float _Size, float3& _Min, float3& _Max ) const;
+#endif
+#ifdef CLOUD_SHADOW_CASCADES
+	void		RenderShadowCascades();
+	void		RenderShadowCascadeRect( Shader& M, ID3D11RenderTargetView* const* _ppViews, int _X, int _Y, int _Width, int _Height );
+#endif
+#ifdef FROXEL_FOG
+	void		RenderFroxels();
+#endif
+#ifdef SKY_LUTS
+	void		RenderSkyLUTs();
+#endif
 
-	Texture3D*	BuildFractalTexture( bool _bLoadFirst );
+	Texture3D*	BuildFractalTexture( bool _bLoadFirst, Texture3D** _ppMinMax );
 };
\ No newline at end of file
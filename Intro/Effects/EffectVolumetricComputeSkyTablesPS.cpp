@@ -2,9 +2,14 @@
 // Builds the sky tables using time-sliced Pixel Shader tasks
 //
 
-#define FILENAME_IRRADIANCE		"./TexIrradiance_64x16.pom"
-#define FILENAME_TRANSMITTANCE	"./TexTransmittance_256x64.pom"
-#define FILENAME_SCATTERING		"./TexScattering_256x128x32.pom"
+#if defined(_DEBUG) || !defined(GODCOMPLEX)
+#define SKY_TABLES_DISK_CACHE	// Define this to reload the tables from disk when they were already computed for the same parameters (POM I/O is not available in the intro build)
+#endif
+
+// The %08X is replaced by the hash of the parameters the tables were computed with (cf. ComputeSkyTablesHash())
+#define FILENAME_IRRADIANCE		"./TexIrradiance_64x16_%08X.pom"
+#define FILENAME_TRANSMITTANCE	"./TexTransmittance_256x64_%08X.pom"
+#define FILENAME_SCATTERING		"./TexScattering_256x128x32_%08X.pom"
 
 //////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////
@@ -95,6 +100,58 @@ namespace
 
 	U32					m_pStagePassesCount[3*STAGES_COUNT];	// Filled automatically in InitUpdateSkyTables(), derived from the 2 tables above
 
+	// Per-frame budget
+	static const float	UPDATE_BUDGET_MS = 1.0f;						// GPU time we allow the update to take each frame
+	static const int	MAX_PASSES_PER_FRAME = 16;
+	static const float	DEFAULT_PASS_COST_MS = UPDATE_BUDGET_MS;		// Cost assumed for a stage we never measured (i.e. a single pass per frame)
+
+	// Names of the GPU profiler scopes used to measure the cost of a single pass of each stage
+	const char*			m_ppStageScopeNames[STAGES_COUNT] = {
+		"Sky Transmittance",
+		"Sky Transmittance Limited",
+		"Sky Irradiance Single",
+		"Sky Scattering Single",
+		"Sky Scattering Delta",
+		"Sky Irradiance Delta",
+		"Sky Scattering Multiple",
+	};
+
+	bool				m_bTransmittancePending = false;				// True when the new transmittance table is computed but not yet used for rendering
+	U32					m_UpdateHash = 0;								// Hash of the parameters the tables being updated are computed with
+
+	U32		HashBytes( U32 _Hash, const void* _pData, int _Size )
+	{
+		const U8*	pData = (const U8*) _pData;
+		for ( int i=0; i < _Size; i++ )
+			_Hash = ((_Hash << 5) + _Hash) + pData[i];
+		return _Hash;
+	}
+
+	bool	FileExists( const char* _pFileName )
+	{
+		FILE*	pFile;
+		fopen_s( &pFile, _pFileName, "rb" );
+		if ( pFile == NULL )
+			return false;
+		fclose( pFile );
+		return true;
+	}
+
+	// Returns the last measured GPU cost of a single pass of the given stage
+	float	GetStagePassCost( Device& _Device, int _StageIndex )
+	{
+#ifdef GPU_PROFILING
+		const GPUProfiler&	Profiler = _Device.Profiler();
+		for ( int ScopeIndex=0; ScopeIndex < Profiler.GetScopesCount(); ScopeIndex++ )
+		{
+			const GPUProfiler::ScopeStats&	Scope = Profiler.GetScope( ScopeIndex );
+			if ( Scope.pShortName == m_ppStageScopeNames[_StageIndex] && Scope.LastDuration > 0.0f )
+				return Scope.LastDuration;
+		}
+#endif
+		return DEFAULT_PASS_COST_MS;
+	}
+
 #ifdef _DEBUG
 //#define ENABLE_PROFILING
 #endif
@@ -255,6 +312,88 @@ void	EffectVolumetric::TriggerSkyTablesUpdate()
 	m_bSkyTableDirty = true;	// Should start the update process as soon as updating is done...
 }
 
+// Hashes every parameter the tables depend on, as well as their resolutions
+U32		EffectVolumetric::ComputeSkyTablesHash() const
+{
+	const CBAtmosphere&	Atmosphere = m_pCB_Atmosphere->m;
+
+	U32	Hash = 5381;
+	Hash = HashBytes( Hash, &Atmosphere.AirParams, sizeof(float2) );
+	Hash = HashBytes( Hash, &Atmosphere.FogParams, sizeof(float4) );
+	Hash = HashBytes( Hash, &m_pCB_PreComputeSky->m._AverageGroundReflectance, sizeof(float) );
+
+	int	pResolutions[] = {
+		TRANSMITTANCE_W, TRANSMITTANCE_H,
+		IRRADIANCE_W, IRRADIANCE_H,
+		RES_3D_U, RES_3D_COS_THETA_VIEW, RES_3D_ALTITUDE,
+		MAX_SCATTERING_ORDER,
+	};
+	Hash = HashBytes( Hash, pResolutions, sizeof(pResolutions) );
+
+	return Hash;
+}
+
+#ifdef SKY_TABLES_DISK_CACHE
+// Reloads the final tables from disk, returns false if any of them is missing
+bool	EffectVolumetric::LoadCachedSkyTables( U32 _Hash )
+{
+	char	pFileNameTransmittance[256];
+	char	pFileNameIrradiance[256];
+	char	pFileNameScattering[256];
+	sprintf_s( pFileNameTransmittance, FILENAME_TRANSMITTANCE, _Hash );
+	sprintf_s( pFileNameIrradiance, FILENAME_IRRADIANCE, _Hash );
+	sprintf_s( pFileNameScattering, FILENAME_SCATTERING, _Hash );
+	if ( !FileExists( pFileNameTransmittance ) || !FileExists( pFileNameIrradiance ) || !FileExists( pFileNameScattering ) )
+		return false;
+
+	{
+		TextureFilePOM	POM( pFileNameTransmittance );
+		Texture2D		Table( m_Device, POM );
+		m_ppRTTransmittance[0]->CopyFrom( Table );
+	}
+	{
+		TextureFilePOM	POM( pFileNameIrradiance );
+		Texture2D		Table( m_Device, POM );
+		m_ppRTIrradiance[0]->CopyFrom( Table );
+	}
+	{
+		TextureFilePOM	POM( pFileNameScattering );
+		Texture3D		Table( m_Device, POM );
+		m_ppRTScattering[0]->CopyFrom( Table );
+	}
+
+	m_ppRTTransmittance[0]->Set( 6, true );
+	m_ppRTScattering[0]->Set( 8, true );
+	m_ppRTIrradiance[0]->Set( 9, true );
+
+	return true;
+}
+
+// Saves the final tables to disk so the next run with the same parameters can reload them
+void	EffectVolumetric::SaveCachedSkyTables( U32 _Hash )
+{
+	char	pFileName[256];
+
+	Texture3D*	pStagingScattering = new Texture3D( m_Device, m_ppRTScattering[0]->GetWidth(), m_ppRTScattering[0]->GetHeight(), m_ppRTScattering[0]->GetDepth(), PixelFormatRGBA32F::DESCRIPTOR, 1, NULL, true, true );
+	pStagingScattering->CopyFrom( *m_ppRTScattering[0] );
+	sprintf_s( pFileName, FILENAME_SCATTERING, _Hash );
+	pStagingScattering->Save( pFileName );
+	delete pStagingScattering;
+
+	Texture2D*	pStagingIrradiance = new Texture2D( m_Device, m_ppRTIrradiance[0]->GetWidth(), m_ppRTIrradiance[0]->GetHeight(), 1, PixelFormatRGBA32F::DESCRIPTOR, 1, NULL, true, true );
+	pStagingIrradiance->CopyFrom( *m_ppRTIrradiance[0] );
+	sprintf_s( pFileName, FILENAME_IRRADIANCE, _Hash );
+	pStagingIrradiance->Save( pFileName );
+	delete pStagingIrradiance;
+
+	Texture2D*	pStagingTransmittance = new Texture2D( m_Device, m_ppRTTransmittance[0]->GetWidth(), m_ppRTTransmittance[0]->GetHeight(), 1, PixelFormatRGBA32F::DESCRIPTOR, 1, NULL, true, true );
+	pStagingTransmittance->CopyFrom( *m_ppRTTransmittance[0] );
+	sprintf_s( pFileName, FILENAME_TRANSMITTANCE, _Hash );
+	pStagingTransmittance->Save( pFileName );
+	delete pStagingTransmittance;
+}
+#endif
+
 void	EffectVolumetric::InitMultiPassStage( int _StageIndex, int _TargetSizeX, int _TargetSizeY, int _TargetSizeZ, int _StepsCount )
 {
 	ASSERT( m_pCB_PreComputeSky->m._PassIndexX == 0 && m_pCB_PreComputeSky->m._PassIndexY == 0 && m_pCB_PreComputeSky->m._PassIndexZ == 0, "Pass index should always equal 0 at the beginning of a new stage!" );
@@ -365,21 +504,28 @@ void	EffectVolumetric::DispatchStage( Shader& M )
 //
 // So this functions is merely a state machine keeping track of what has been computed and what remains to be computed until the tables have all been updated.
 //
+// Each frame, we issue as many passes as fit in UPDATE_BUDGET_MS given the last measured cost of a pass of the current stage
+//	(the first pass of the frame is the one we measure, the others are not profiled so the measure stays the cost of a single pass).
+// The new tables are only bound for rendering once the update is complete so the sky never shows a half-updated state.
 //
 void	EffectVolumetric::UpdateSkyTables()
 {
 	if ( !m_bSkyTableDirty && m_CurrentStage == COMPUTING_STOPPED )
 		return;
 
-	// Set the rasterizer state that enables scissoring
-	m_Device.SetStates( m_pRS_CullNoneWithScissoring, m_Device.m_pDS_Disabled, m_Device.m_pBS_Disabled );
-
 	//////////////////////////////////////////////////////////////////////////
 	//////////////////////////////////////////////////////////////////////////
 	// STARTING POINT
 	if ( m_CurrentStage == COMPUTING_STOPPED )
 	{	// Initiate update process
 		m_bSkyTableDirty = false;	// Clear immediately so we can still trigger a new update while updating... This new update will only start once this update is complete.
+
+		m_UpdateHash = ComputeSkyTablesHash();
+#ifdef SKY_TABLES_DISK_CACHE
+		if ( LoadCachedSkyTables( m_UpdateHash ) )
+			return;	// Already computed these tables in a previous run
+#endif
+
 		m_CurrentStage = COMPUTING_TRANSMITTANCE;
 		m_ScatteringOrder = 2;		// We start the loop at order 2 so we loop up to MAX_SCATTERING_ORDER
 		m_pCB_PreComputeSky->m._bFirstPass = true;
@@ -396,6 +542,35 @@ void	EffectVolumetric::UpdateSkyTables()
 	//////////////////////////////////////////////////////////////////////////
 	//////////////////////////////////////////////////////////////////////////
 
+	if ( m_bTransmittancePending )
+		m_ppRTTransmittance[1]->Set( 6, true );	// Remaining stages use the new transmittance table
+
+	float	RemainingBudget = UPDATE_BUDGET_MS;
+	for ( int PassIndex=0; PassIndex < MAX_PASSES_PER_FRAME && m_CurrentStage != COMPUTING_STOPPED; PassIndex++ )
+	{
+		float	PassCost = GetStagePassCost( m_Device, m_CurrentStage );
+		if ( PassIndex > 0 && PassCost > RemainingBudget )
+			break;	// Always issue at least one pass so the update progresses
+		RemainingBudget -= PassCost;
+
+		if ( PassIndex == 0 )
+		{
+			GPU_PROFILE_SCOPE( m_Device, m_ppStageScopeNames[m_CurrentStage] );
+			UpdateSkyTablesPass();
+		}
+		else
+			UpdateSkyTablesPass();
+	}
+
+	if ( m_bTransmittancePending )
+		m_ppRTTransmittance[0]->Set( 6, true );	// Keep rendering with the current table until the update completes
+}
+
+void	EffectVolumetric::UpdateSkyTablesPass()
+{
+	// Set the rasterizer state that enables scissoring
+	m_Device.SetStates( m_pRS_CullNoneWithScissoring, m_Device.m_pDS_Disabled, m_Device.m_pBS_Disabled );
+
 	int	CurrentStageIndex = int(m_CurrentStage);
 
 	switch ( m_CurrentStage )
@@ -432,14 +607,10 @@ void	EffectVolumetric::UpdateSkyTables()
 				m_CurrentStage = COMPUTING_IRRADIANCE_SINGLE;
 				m_bStageStarting = true;
 
-				// Assign to slot 6
+				// Assign to slot 6 for the next stages (it only becomes our new default texture once the update completes)
 				m_Device.RemoveRenderTargets();
 				m_ppRTTransmittance[1]->Set( 6, true );
-
-				// This is our new default texture
-				Texture2D*	pTemp = m_ppRTTransmittance[0];
-				m_ppRTTransmittance[0] = m_ppRTTransmittance[1];
-				m_ppRTTransmittance[1] = pTemp;
+				m_bTransmittancePending = true;
 			}
 		}
 		break;
@@ -642,7 +813,15 @@ void	EffectVolumetric::UpdateSkyTables()
 // 						}
 					}
 
-					// Assign final textures to slots 8 & 9
+					// Assign final textures to slots 6, 8 & 9
+					if ( m_bTransmittancePending )
+					{
+						Texture2D*	pTemp = m_ppRTTransmittance[0];
+						m_ppRTTransmittance[0] = m_ppRTTransmittance[1];
+						m_ppRTTransmittance[1] = pTemp;
+						m_ppRTTransmittance[0]->Set( 6, true );
+						m_bTransmittancePending = false;
+					}
 					m_ppRTScattering[0]->RemoveFromLastAssignedSlots();
 					m_ppRTIrradiance[0]->RemoveFromLastAssignedSlots();
 					m_ppRTScattering[1]->Set( 8, true );
@@ -656,6 +835,10 @@ void	EffectVolumetric::UpdateSkyTables()
 					Texture2D*	pTemp1 = m_ppRTIrradiance[0];
 					m_ppRTIrradiance[0] = m_ppRTIrradiance[1];
 					m_ppRTIrradiance[1] = pTemp1;
+
+#ifdef SKY_TABLES_DISK_CACHE
+					SaveCachedSkyTables( m_UpdateHash );
+#endif
 				}
 			}
 		}
@@ -894,33 +1077,20 @@ void	EffectVolumetric::UpdateSkyTables()
 					// Only changes from now on will trigger an update again...
 //					m_bSkyTableDirty = false;
 
-					// Assign final textures to slots 8 & 9
+					// Assign final textures to slots 6, 8 & 9
+					if ( m_bTransmittancePending )
+					{
+						Texture2D*	pTemp = m_ppRTTransmittance[0];
+						m_ppRTTransmittance[0] = m_ppRTTransmittance[1];
+						m_ppRTTransmittance[1] = pTemp;
+						m_ppRTTransmittance[0]->Set( 6, true );
+						m_bTransmittancePending = false;
+					}
 					m_ppRTScattering[0]->RemoveFromLastAssignedSlots();
 					m_ppRTIrradiance[0]->RemoveFromLastAssignedSlots();
 					m_ppRTScattering[1]->Set( 8, true );
 					m_ppRTIrradiance[1]->Set( 9, true );
 
-
-#if 1
-{
-	Texture3D*	pStagingScattering = new Texture3D( m_Device, m_ppRTScattering[1]->GetWidth(), m_ppRTScattering[1]->GetHeight(), m_ppRTScattering[1]->GetDepth(), PixelFormatRGBA32F::DESCRIPTOR, 1, NULL, true, true );
-	pStagingScattering->CopyFrom( *m_ppRTScattering[1] );
-	pStagingScattering->Save( FILENAME_SCATTERING );
-	delete pStagingScattering;
-
-	Texture2D*	pStagingIrradiance = new Texture2D( m_Device, m_ppRTIrradiance[1]->GetWidth(), m_ppRTIrradiance[1]->GetHeight(), 1, PixelFormatRGBA32F::DESCRIPTOR, 1, NULL, true, true );
-	pStagingIrradiance->CopyFrom( *m_ppRTIrradiance[1] );
-	pStagingIrradiance->Save( FILENAME_IRRADIANCE );
-	delete pStagingIrradiance;
-
-	Texture2D*	pStagingTransmittance = new Texture2D( m_Device, m_ppRTTransmittance[0]->GetWidth(), m_ppRTTransmittance[0]->GetHeight(), 1, PixelFormatRGBA32F::DESCRIPTOR, 1, NULL, true, true );
-	pStagingTransmittance->CopyFrom( *m_ppRTTransmittance[0] );
-	pStagingTransmittance->Save( FILENAME_TRANSMITTANCE );
-	delete pStagingTransmittance;
-}
-#endif
-
-
 					// Swap double-buffered slots
 					Texture3D*	pTemp0 = m_ppRTScattering[0];
 					m_ppRTScattering[0] = m_ppRTScattering[1];
@@ -929,6 +1099,10 @@ void	EffectVolumetric::UpdateSkyTables()
 					Texture2D*	pTemp1 = m_ppRTIrradiance[0];
 					m_ppRTIrradiance[0] = m_ppRTIrradiance[1];
 					m_ppRTIrradiance[1] = pTemp1;
+
+#ifdef SKY_TABLES_DISK_CACHE
+					SaveCachedSkyTables( m_UpdateHash );
+#endif
 				}
 				// COMPLETION POINT
 				//////////////////////////////////////////////////////////////////////////
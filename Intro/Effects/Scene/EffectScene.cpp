@@ -403,6 +403,13 @@ void	EffectScene::Render( float _Time, float _DeltaTime, Texture2D& _RTHDR )
 	const Texture2D*	pTexEnvMap = m_Scene.GetEnvMap();
 	if ( pTexEnvMap != NULL )
 		pTexEnvMap->SetPS( 15 );
+	const EnvMapFilter*	pEnvMapFilter = m_Scene.GetEnvMapFilter();
+	if ( pEnvMapFilter != NULL )
+	{	// Split-sum specular & SH ambient
+		pEnvMapFilter->GetPrefiltered().SetPS( 18 );
+		pEnvMapFilter->GetBRDF().SetPS( 19 );
+		pEnvMapFilter->GetSH().SetInput( 20 );
+	}
 
 // DEBUG
 const Texture2D*	pTexLayeredMat = m_Scene.GetObjectAt(0).GetPrimitiveAt(0).GetLayeredTexture();
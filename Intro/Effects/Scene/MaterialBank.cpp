@@ -3,9 +3,9 @@
 
 //////////////////////////////////////////////////////////////////////////
 // MaterialBank
-MaterialBank::MaterialBank( Device& _Device ) : m_Device( _Device ), m_pMaterials( NULL )
+MaterialBank::MaterialBank( Device& _Device ) : m_Device( _Device ), m_MaterialsCount( 0 ), m_pMaterials( NULL ), m_DirtyStart( MAX_MATERIALS ), m_DirtyEnd( 0 )
 {
-	m_pTB_Materials = new TB<Material::StaticParameters,64>( _Device, 8, true );
+	m_pTB_Materials = new TB<Material::StaticParameters,MAX_MATERIALS>( _Device, 8, true, true );
 }
 
 MaterialBank::~MaterialBank()
@@ -18,6 +18,7 @@ void	MaterialBank::AllocateMaterials( int _MaterialsCount )
 {
 	DestroyMaterials();
 
+	ASSERT( _MaterialsCount <= MAX_MATERIALS, "Too many materials!" );
 	m_MaterialsCount = _MaterialsCount;
 	m_pMaterials = new Material[_MaterialsCount];
 }
@@ -30,6 +31,15 @@ void	MaterialBank::DestroyMaterials()
 	delete[] m_pMaterials;
 	m_pMaterials = NULL;
 	m_MaterialsCount = 0;
+	m_DirtyStart = MAX_MATERIALS;
+	m_DirtyEnd = 0;
+}
+
+void	MaterialBank::MarkDirty( int _MaterialIndex )
+{
+	ASSERT( _MaterialIndex >= 0 && _MaterialIndex < m_MaterialsCount, "Material index out of range!" );
+	m_DirtyStart = MIN( m_DirtyStart, _MaterialIndex );
+	m_DirtyEnd = MAX( m_DirtyEnd, _MaterialIndex+1 );
 }
 
 MaterialBank::Material&	MaterialBank::GetMaterialAt( int _Index )
@@ -40,12 +50,12 @@ MaterialBank::Material&	MaterialBank::GetMaterialAt( int _Index )
 
 void	MaterialBank::UpdateMaterialsBuffer()
 {
-	if ( !m_TB_MaterialsDirty )
+	if ( m_DirtyStart >= m_DirtyEnd )
 		return;	// Up to date...
 
 	const float	FALLOFF_GOAL = 0.01f;
 
-	for ( int MaterialIndex=0; MaterialIndex < m_MaterialsCount; MaterialIndex++ )
+	for ( int MaterialIndex=m_DirtyStart; MaterialIndex < m_DirtyEnd; MaterialIndex++ )
 	{
 		Material::StaticParameters&	Params = m_pTB_Materials->m[MaterialIndex];
 
@@ -85,8 +95,9 @@ void	MaterialBank::UpdateMaterialsBuffer()
 // Params.Offset = Offset + A*8.0f;
 	}
 
-	m_pTB_Materials->UpdateData();
-	m_TB_MaterialsDirty = false;
+	m_pTB_Materials->UpdateRange( m_DirtyStart, m_DirtyEnd - m_DirtyStart );
+	m_DirtyStart = MAX_MATERIALS;
+	m_DirtyEnd = 0;
 }
 
 
@@ -99,7 +110,7 @@ void	MaterialBank::Material::SetStaticParameters( MaterialBank& _Owner, const ch
 	m_pName = _pName;
 	memcpy( &m_Static, &_Parameters, sizeof(StaticParameters) );
 
-	m_pOwner->m_TB_MaterialsDirty = true;
+	m_pOwner->MarkDirty( int(this - m_pOwner->m_pMaterials) );
 }
 
 void	MaterialBank::Material::SetDynamicParameters( const DynamicParameters& _Parameters )
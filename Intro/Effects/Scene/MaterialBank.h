@@ -11,6 +11,8 @@ class MaterialBank
 {
 private:	// CONSTANTS
 
+	static const int	MAX_MATERIALS = 64;		// Size of the material texture buffer
+
 public:		// NESTED TYPES
 
 	class	Material
@@ -74,8 +76,10 @@ private:	// FIELDS
 
 	// The texture buffer (texture slot #8) that will contain our static parameters
 	// Valid for the entire scene
-	bool		m_TB_MaterialsDirty;
-	TB<Material::StaticParameters,64>*	m_pTB_Materials;
+	// Only the range of materials modified since the last update gets processed and uploaded
+	int			m_DirtyStart;
+	int			m_DirtyEnd;
+	TB<Material::StaticParameters,MAX_MATERIALS>*	m_pTB_Materials;
 
 
 public:		// PROPERTIES
@@ -91,6 +95,9 @@ public:		// METHODS
 	void	AllocateMaterials( int _MaterialsCount );
 	void	DestroyMaterials();
 
+	// Flags a material for the next buffer update
+	void	MarkDirty( int _MaterialIndex );
+
 	// Updates and uploads any change to the material buffer
 	void	UpdateMaterialsBuffer();
 };
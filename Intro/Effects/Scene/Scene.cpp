@@ -14,6 +14,8 @@ EffectScene::EffectScene( Device& _Device )
 	, m_pLightsPoint			( NULL )
 	, m_LightsCountSpot			( 0 )
 	, m_pLightsSpot			( NULL )
+	, m_pTexEnvMap				( NULL )
+	, m_pEnvMapFilter			( NULL )
 {
 	m_pMaterials = new MaterialBank( _Device );
 }
@@ -25,11 +27,37 @@ EffectScene::~EffectScene()
 	delete m_pMaterials;
 }
 
+namespace
+{
+	// Objects only rebuild their own transform so they can be updated in parallel
+	class	UpdateObjectsKernel : public IParallelForKernel
+	{
+	public:
+		EffectScene::Object**	ppObjects;
+		float					Time;
+		float					DeltaTime;
+
+		virtual void	Run( int _Start, int _End )
+		{
+			for ( int ObjectIndex=_Start; ObjectIndex < _End; ObjectIndex++ )
+				if ( ppObjects[ObjectIndex] != NULL )
+					ppObjects[ObjectIndex]->Update( Time, DeltaTime );
+		}
+	};
+}
+
 void	EffectScene::Update( float _Time, float _DeltaTime )
 {
-	for ( int ObjectIndex=0; ObjectIndex < m_ObjectsCount; ObjectIndex++ )
-		if ( m_ppObjects[ObjectIndex] != NULL )
-			m_ppObjects[ObjectIndex]->Update( _Time, _DeltaTime );
+	static const int	GRAIN_SIZE = 64;	// Objects per chunk, smaller scenes are updated by the calling thread
+
+	UpdateObjectsKernel	Kernel;
+	Kernel.ppObjects = m_ppObjects;
+	Kernel.Time = _Time;
+	Kernel.DeltaTime = _DeltaTime;
+	if ( m_ObjectsCount > GRAIN_SIZE )
+		gs_Jobs.ParallelFor( m_ObjectsCount, GRAIN_SIZE, Kernel );
+	else
+		Kernel.Run( 0, m_ObjectsCount );
 }
 
 void	EffectScene::Render( Shader& _Material, bool _bDepthPass ) const
@@ -163,9 +191,10 @@ void	EffectScene::SetSpotLightEnabled( int _LightIndex, bool _bEnabled )
 	L.m_bEnabled = _bEnabled;
 }
 
-void	EffectScene::SetEnvMap( Texture2D& _EnvMap )
+void	EffectScene::SetEnvMap( Texture2D& _EnvMap, const EnvMapFilter* _pFilter )
 {
 	m_pTexEnvMap = &_EnvMap;
+	m_pEnvMapFilter = _pFilter;
 }
 
 
@@ -6,6 +6,7 @@
 
 template<typename> class CB;
 class	MaterialBank;
+class	EnvMapFilter;
 
 class EffectScene
 {
@@ -168,6 +169,7 @@ private:	// FIELDS
 	Light*			m_pLightsSpot;
 
 	Texture2D*		m_pTexEnvMap;
+	const EnvMapFilter*	m_pEnvMapFilter;	// Optional prefiltered version of the env map (cf. SetEnvMap())
 
 	MaterialBank*	m_pMaterials;
 
@@ -187,6 +189,7 @@ public:		// PROPERTIES
 	const Light*		GetSpotLights() const						{ return m_pLightsSpot; }
 
 	const Texture2D*	GetEnvMap() const							{ return m_pTexEnvMap; }
+	const EnvMapFilter*	GetEnvMapFilter() const						{ return m_pEnvMapFilter; }
 
 public:		// METHODS
 
@@ -212,7 +215,8 @@ public:		// METHODS
 	void		SetPointLightEnabled( int _LightIndex, bool _bEnabled );
 	void		SetSpotLightEnabled( int _LightIndex, bool _bEnabled );
 
-	void		SetEnvMap( Texture2D& _EnvMap );
+	// _pFilter, the optional GPU prefiltering of the env map (GGX mips, BRDF table & SH) the owner keeps updated
+	void		SetEnvMap( Texture2D& _EnvMap, const EnvMapFilter* _pFilter=NULL );
 };
 
 
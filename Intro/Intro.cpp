@@ -28,6 +28,11 @@ static Scene*				gs_pScene = NULL;
 
 // Textures & Render targets
 static Texture2D*			gs_pRTHDR = NULL;
+DepthPyramid*				gs_pDepthPyramid = NULL;	// Shared min/max depth pyramid (cf. Utility/DepthPyramid.h)
+
+#ifdef IMAGE_SEQUENCE_CAPTURE
+ImageSequenceCapture*		gs_pImageSequenceCapture = NULL;
+#endif
 
 // Primitives
 Primitive*					gs_pPrimQuad = NULL;		// Screen quad for post-processes
@@ -65,76 +70,39 @@ static EffectGlobalIllum2*	gs_pEffectGI = NULL;
 void	PrepareScene();
 void	ReleaseScene();
 
-int	IntroInit( IntroProgressDelegate& _Delegate )
+namespace
 {
-
-/*	NjHalf		Test( 1.0f / 65535 );
-	Test.raw = 0x0001;	// This gives wrong values when exponent is 0!
-	Test.raw = 0x0400;	// Smallest exponent, no mantissa
-	Test.raw = 0x0401;	// Smallest exponent, smallest non null mantissa		(6.1094761e-005)
-	Test.raw = 0x0402;	// Smallest exponent, larger mantissa without LSbit		(6.1154366e-005)
-	Test.raw = 0x0404;	// Smallest exponent, larger mantissa without 2 LSbits	(6.1273575e-005)
-	float		Smallest = Test;
-
-	int	i;
-	for ( i=0; i < 100; i++ )
+	// The init tasks, all run on the device thread (cf. IntroInit())
+	int		CreateCamera( void* _pData )
 	{
-	//	1/65535.0 = 1.5259021896696422e-005;
-
-		float	f = _frand();
-//		f = MAX( f, 1.5259021896696422e-005f );
-//		f = MAX( f, 2*3.0518043793392843518730449378195e-5f );
-//		U32		Bisou = U32( f * 65535.0f );
-//		if ( Bisou & 1 )
-//			break;
-
-		U32	Bisou = U32( f * 65535 );
-			Bisou &= ~0xF;
-		float	f2 = Bisou / 65535.0f;
-		U32	Bisou2 = U32( f2 * 65535 );
-		if ( Bisou2 & 1 )
-			break;
-	}
-*/
-
-	//////////////////////////////////////////////////////////////////////////
-	// Attempt to create the video capture object
-// 	gs_pVideo = new Video( gs_Device, gs_WindowInfos.hWnd );
-// 	gs_pVideo->EnumerateDevices( DevicesEnumerator, NULL );
-// 	gs_pVideo->Init( 0 );	// Use first device
-// 	gs_pVideo->Play();		// GO!
+		gs_pCamera = new Camera( gs_Device );	// NOTE: Camera reserves the CB slot #0 for itself !
+		gs_pCamera->SetPerspective( DEG2RAD( 50.0f ), float(RESX) / RESY, 0.01f, 1000.0f );
+		gs_pCamera->Upload( 0 );
 
+//		gs_pCameraManipulator = new FPSCamera( *gs_pCamera, NjFloat3::Zero, NjFloat3::UnitZ );
 
-	//////////////////////////////////////////////////////////////////////////
-	// Create our camera
-	gs_pCamera = new Camera( gs_Device );	// NOTE: Camera reserves the CB slot #0 for itself !
-	gs_pCamera->SetPerspective( DEG2RAD( 50.0f ), float(RESX) / RESY, 0.01f, 1000.0f );
-	gs_pCamera->Upload( 0 );
-
-//	gs_pCameraManipulator = new FPSCamera( *gs_pCamera, NjFloat3::Zero, NjFloat3::UnitZ );
-
-	// Global illum test
-//	gs_pCameraManipulator = new FPSCamera( *gs_pCamera, NjFloat3( 0, 1, 6 ), -NjFloat3::UnitZ );	// Corridor
-	gs_pCameraManipulator = new FPSCamera( *gs_pCamera, float3( -12.890693f, 6.1750569f, -7.4139323f ), float3( -6.5200315f, 3.7125835f, -5.5834103f ) );	// City scene
+		// Global illum test
+//		gs_pCameraManipulator = new FPSCamera( *gs_pCamera, NjFloat3( 0, 1, 6 ), -NjFloat3::UnitZ );	// Corridor
+		gs_pCameraManipulator = new FPSCamera( *gs_pCamera, float3( -12.890693f, 6.1750569f, -7.4139323f ), float3( -6.5200315f, 3.7125835f, -5.5834103f ) );	// City scene
 
+		return 0;
+	}
 
-	//////////////////////////////////////////////////////////////////////////
 	// Create our scene
-//	gs_pScene = new Scene( gs_Device );
-
+// 	int		CreateScene( void* _pData )
+// 	{
+// 		gs_pScene = new Scene( gs_Device );
+// 		return 0;
+// 	}
 
-	//////////////////////////////////////////////////////////////////////////
-	// Create render targets & textures
+	int		CreateTargetsAndPrimitives( void* _pData )
 	{
-		gs_pRTHDR = new Texture2D( gs_Device, RESX, RESY, 1, PixelFormatRGBA16F::DESCRIPTOR, 3, NULL );
-
-		Build2DTextures( _Delegate );
-		Build3DTextures( _Delegate );
-	}
+		//////////////////////////////////////////////////////////////////////////
+		// Create render targets
+		gs_pRTHDR = new Texture2D( gs_Device, RESX, RESY, 1, RenderTargetFormats::Select( RenderTargetFormats::HDR_COLOR ), 3, NULL );	// Alpha is never read
 
-	//////////////////////////////////////////////////////////////////////////
-	// Create primitives
-	{
+		//////////////////////////////////////////////////////////////////////////
+		// Create primitives
 		float4	pVertices[4] =
 		{
 			float4( -1.0f, +1.0f, 0.0f, 1.0f ),
@@ -143,23 +111,36 @@ int	IntroInit( IntroProgressDelegate& _Delegate )
 			float4( +1.0f, -1.0f, 0.0f, 1.0f ),
 		};
 		gs_pPrimQuad = new Primitive( gs_Device, 4, pVertices, 0, NULL, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP, VertexFormatPt4::DESCRIPTOR );
+
+		//////////////////////////////////////////////////////////////////////////
+		// Create constant buffers
+		gs_pCB_Global = new CB<CBGlobal>( gs_Device, 1, true );	// Global params go to slot #1
+		gs_pCB_Test = new CB<CBTest>( gs_Device, 10 );
+
+		return 0;
 	}
 
-	//////////////////////////////////////////////////////////////////////////
-	// Create materials
+	int		Create2DTextures( void* _pData )
 	{
-		CHECK_MATERIAL( gs_pMatPostFinal = CreateMaterial( IDR_SHADER_POST_FINAL, "./Resources/Shaders/PostFinal.hlsl", VertexFormatPt4::DESCRIPTOR, "VS", NULL, "PS" ), ERR_EFFECT_INTRO+1 );
+		return Build2DTextures( *((IntroProgressDelegate*) _pData) );
 	}
 
-	//////////////////////////////////////////////////////////////////////////
-	// Create constant buffers
+	int		CreateMaterials( void* _pData )
 	{
-		gs_pCB_Global = new CB<CBGlobal>( gs_Device, 1, true );	// Global params go to slot #1
-		gs_pCB_Test = new CB<CBTest>( gs_Device, 10 );
+		BeginShaderCompilation();
+
+		gs_pMatPostFinal = CreateMaterial( IDR_SHADER_POST_FINAL, "./Resources/Shaders/PostFinal.hlsl", VertexFormatPt4::DESCRIPTOR, "VS", NULL, "PS" );
+		gs_pDepthPyramid = new DepthPyramid( gs_Device, gs_Device.DefaultDepthStencil().GetWidth(), gs_Device.DefaultDepthStencil().GetHeight() );
+
+		EndShaderCompilation();	// The graph reports the progress
+
+		CHECK_MATERIAL( gs_pMatPostFinal, ERR_EFFECT_INTRO+1 );
+		CHECK_MATERIAL( gs_pDepthPyramid, ERR_EFFECT_INTRO+2 );
+
+		return 0;
 	}
 
-	//////////////////////////////////////////////////////////////////////////
-	// Create effects
+	int		CreateEffects( void* _pData )
 	{
 // 		CHECK_EFFECT( gs_pEffectRoom = new EffectRoom( *gs_pRTHDR ), ERR_EFFECT_ROOM );
 // 		gs_pEffectRoom->m_pTexVoronoi = gs_pEffectParticles->m_pTexVoronoi;
@@ -173,9 +154,71 @@ int	IntroInit( IntroProgressDelegate& _Delegate )
 		CHECK_EFFECT( gs_pEffectGI = new EffectGlobalIllum2( gs_Device, *gs_pRTHDR, *gs_pPrimQuad, *gs_pCameraManipulator ), ERR_EFFECT_GLOBALILLUM );
 
 //		CHECK_EFFECT( gs_pEffectDOF = new EffectDOF( gs_Device, *gs_pRTHDR, *gs_pPrimQuad, *gs_pCamera ), ERR_EFFECT_DOF );
+
+		return 0;
 	}
+}
+
+int	IntroInit( IntroProgressDelegate& _Delegate )
+{
+
+/*	NjHalf		Test( 1.0f / 65535 );
+	Test.raw = 0x0001;	// This gives wrong values when exponent is 0!
+	Test.raw = 0x0400;	// Smallest exponent, no mantissa
+	Test.raw = 0x0401;	// Smallest exponent, smallest non null mantissa		(6.1094761e-005)
+	Test.raw = 0x0402;	// Smallest exponent, larger mantissa without LSbit		(6.1154366e-005)
+	Test.raw = 0x0404;	// Smallest exponent, larger mantissa without 2 LSbits	(6.1273575e-005)
+	float		Smallest = Test;
+
+	int	i;
+	for ( i=0; i < 100; i++ )
+	{
+	//	1/65535.0 = 1.5259021896696422e-005;
+
+		float	f = _frand();
+//		f = MAX( f, 1.5259021896696422e-005f );
+//		f = MAX( f, 2*3.0518043793392843518730449378195e-5f );
+//		U32		Bisou = U32( f * 65535.0f );
+//		if ( Bisou & 1 )
+//			break;
+
+		U32	Bisou = U32( f * 65535 );
+			Bisou &= ~0xF;
+		float	f2 = Bisou / 65535.0f;
+		U32	Bisou2 = U32( f2 * 65535 );
+		if ( Bisou2 & 1 )
+			break;
+	}
+*/
+
+	//////////////////////////////////////////////////////////////////////////
+	// Attempt to create the video capture object
+// 	gs_pVideo = new Video( gs_Device, gs_WindowInfos.hWnd );
+// 	gs_pVideo->EnumerateDevices( DevicesEnumerator, NULL );
+// 	gs_pVideo->Init( 0 );	// Use first device
+// 	gs_pVideo->Play();		// GO!
 
 
+	//////////////////////////////////////////////////////////////////////////
+	// Declare the init tasks: the CPU parts run concurrently, the GPU parts run here as soon as their dependencies are ready
+	InitGraph	Graph;
+
+	int	TaskCamera = Graph.AddTask( "Camera", NULL, CreateCamera, NULL );
+//	int	TaskScene = Graph.AddTask( "Scene", NULL, CreateScene, NULL );
+	int	TaskTargets = Graph.AddTask( "Targets & Primitives", NULL, CreateTargetsAndPrimitives, NULL );
+	int	Task2DTextures = Graph.AddTask( "2D Textures", NULL, Create2DTextures, &_Delegate );
+	int	Task3DTextures = Declare3DTextures( Graph );
+	Graph.AddTask( "Materials", NULL, CreateMaterials, NULL, 2 );
+	int	TaskEffects = Graph.AddTask( "Effects", NULL, CreateEffects, NULL, 8 );
+	Graph.AddDependency( TaskEffects, TaskCamera );
+	Graph.AddDependency( TaskEffects, TaskTargets );
+	Graph.AddDependency( TaskEffects, Task2DTextures );
+	Graph.AddDependency( TaskEffects, Task3DTextures );	// The noise is a global texture the effects' shaders sample
+
+	int	ErrorCode = Graph.Run( &_Delegate );
+	if ( ErrorCode != 0 )
+		return ErrorCode;
+
 	//////////////////////////////////////////////////////////////////////////
 	// Initialize the scene last so it gives us the opportunity to fix shader errors first instead of waiting for the scene to be ready!
 #ifdef TEST_SCENE
@@ -210,6 +253,10 @@ void	IntroExit()
 	Delete3DTextures();
 	Delete2DTextures();
 	delete gs_pRTHDR;
+	delete gs_pDepthPyramid;
+	TextureBuilderGPU::ReleaseKernels();
+	JumpFlood::ReleaseKernels();
+	MipGenerator::ReleaseKernels();
 
 	// Release the scene
 #ifdef TEST_SCENE
@@ -240,10 +287,22 @@ namespace
 	Texture2D*	gs_pSceneTexture2;
 	Texture2D*	gs_pSceneTexture3;
 	Texture2D*	gs_pTexEnvMap;
+	EnvMapFilter*	gs_pEnvMapFilter;
+	bool		gs_bEnvMapFiltered = false;
+}
+
+bool	IntroUpdate( float _Time, float _DeltaTime )
+{
+	// Nothing is simulated at a fixed rate yet: the effects still animate from the render time
+	return true;
 }
 
 bool	IntroDo( float _Time, float _DeltaTime )
 {
+#ifdef GPU_PROFILING
+	gs_Device.Profiler().BeginFrame();
+#endif
+
 	// Upload global parameters
 	gs_pCB_Global->m.Time.Set( _Time, _DeltaTime, 1.0f / _Time, 1.0f / _DeltaTime );
 	gs_pCB_Global->UpdateData();
@@ -338,6 +397,10 @@ bool	IntroDo( float _Time, float _DeltaTime )
 //	gs_pScene->GetObjectAt( 0 ).SetPRS( NjFloat3::UnitY, NjFloat4::QuatFromAngleAxis( 0.5f * _Time, NjFloat3( 1, 1, 1 ) ) );
 
 
+	// A changing sky would rather call Update( ..., true ) each frame
+	if ( !gs_bEnvMapFiltered )
+		gs_bEnvMapFiltered = gs_pEnvMapFilter->Update( *gs_pTexEnvMap );
+
 	//////////////////////////////////////////////////////////////////////////
 	// Render the scene
 	gs_pEffectScene->Render( _Time, _DeltaTime, *gs_pRTHDR );
@@ -401,7 +464,14 @@ bool	IntroDo( float _Time, float _DeltaTime )
 
 #elif 1	// TEST GLOBAL ILLUM
 
+#if defined(BENCHMARK) || defined(IMAGE_SEQUENCE_CAPTURE)
+	// Orbit around the city so every run renders the same frames
+	float	Angle = 0.2f * _Time;
+	float3	Target( -6.5200315f, 3.7125835f, -5.5834103f );
+	gs_pCameraManipulator->Init( Target + float3( 6.6f * sinf( Angle ), 2.5f, 6.6f * cosf( Angle ) ), Target, float3::UnitY );
+#else
 	gs_pCameraManipulator->Update( _DeltaTime, 3.0f, 1.0f );
+#endif
 	gs_pCamera->Upload( 0 );
 
  	gs_Device.ClearRenderTarget( *gs_pRTHDR, float4( 0.0f, 0.0f, 0.0f, 0.0f ) );
@@ -422,8 +492,19 @@ bool	IntroDo( float _Time, float _DeltaTime )
 
 #endif
 
+#ifdef GPU_PROFILING
+	gs_Device.Profiler().EndFrame();
+#endif
+	gs_Device.RenderTargets().EndFrame();
+
+#ifdef IMAGE_SEQUENCE_CAPTURE
+	// Grab the frame before the back buffer gets discarded (EXR stores the linear HDR target instead)
+	if ( gs_pImageSequenceCapture != NULL )
+		gs_pImageSequenceCapture->Grab( gs_pImageSequenceCapture->GetFormat() == ImageSequenceCapture::EXR ? *gs_pRTHDR : gs_Device.DefaultRenderTarget() );
+#endif
+
 	// Present !
-	gs_Device.DXSwapChain().Present( 0, 0 );
+	gs_Device.Present();
 
 	return true;	// True means continue !
 }
@@ -535,12 +616,12 @@ void	PrepareScene()
 			&gs_pSceneTexture3,
 		};
 
-		TextureBuilder	TBLayer0( 512, 512 );
-		TextureBuilder	TBLayer1( 512, 512 );
-		TextureBuilder	TBLayer2( 512, 512 );
-		TextureBuilder	TBLayer3( 512, 512 );
-		TextureBuilder	TBLayerSpecular( 512, 512 );
-		TextureBuilder	TBLayerHeight( 512, 512 );
+		TextureBuilder	TBLayer0( 512, 512, TextureBuilder::CHANNEL_RGBA );
+		TextureBuilder	TBLayer1( 512, 512, TextureBuilder::CHANNEL_RGBA );
+		TextureBuilder	TBLayer2( 512, 512, TextureBuilder::CHANNEL_RGBA );
+		TextureBuilder	TBLayer3( 512, 512, TextureBuilder::CHANNEL_RGBA );
+		TextureBuilder	TBLayerSpecular( 512, 512, TextureBuilder::CHANNEL_RGBA );
+		TextureBuilder	TBLayerHeight( 512, 512, TextureBuilder::CHANNEL_HEIGHT );
 
 		int		pArraySizes[6];
 		void**	pppContents[6];
@@ -571,7 +652,7 @@ void	PrepareScene()
 	}
 #else
 	{
-		TextureBuilder	TBLayer( 512, 512 );
+		TextureBuilder	TBLayer( 512, 512, TextureBuilder::CHANNEL_RGBA );
 		TBLayer.LoadFromRAWFile( "./Resources/Images/LayeredMaterial0-Layer0.raw" );
 
 		int		pArraySizes[6];
@@ -594,10 +675,14 @@ void	PrepareScene()
 	//////////////////////////////////////////////////////////////////////////
 	// Create the env map
 	{
-		TextureBuilder	TBEnvMap( 1024, 512 );		TBEnvMap.LoadFromFloatFile( "./Resources/Images/uffizi-large_1024x512.float" );
+		TextureBuilder	TBEnvMap( 1024, 512, TextureBuilder::CHANNEL_RGBA );		TBEnvMap.LoadFromFloatFile( "./Resources/Images/uffizi-large_1024x512.float" );
 		gs_pTexEnvMap = TBEnvMap.CreateTexture( PixelFormatRGBA16F::DESCRIPTOR, TextureBuilder::CONV_RGBA );
 
-		gs_pScene->SetEnvMap( *gs_pTexEnvMap );
+		// The env map is static so it's prefiltered all at once, as soon as the kernels are ready (cf. IntroDo())
+		gs_pEnvMapFilter = new EnvMapFilter( gs_Device );
+		gs_bEnvMapFiltered = gs_pEnvMapFilter->Update( *gs_pTexEnvMap );
+
+		gs_pScene->SetEnvMap( *gs_pTexEnvMap, gs_pEnvMapFilter );
 	}
 
 	//////////////////////////////////////////////////////////////////////////
@@ -698,6 +783,7 @@ void	ReleaseScene()
 // 	delete gs_pSceneTexture2;
 // 	delete gs_pSceneTexture1;
 	delete gs_pSceneTexture0;
+	delete gs_pEnvMapFilter;
 	delete gs_pTexEnvMap;
 }
 #endif
@@ -5,6 +5,11 @@
 
 extern Primitive*	gs_pPrimQuad;		// Screen quad for post-processes
 extern Texture3D*	gs_pTexNoise3D;		// General purpose 3D noise texture (32x32x32)
+extern DepthPyramid*	gs_pDepthPyramid;	// Min/max depth pyramid of the default depth stencil, built once per frame by the first effect needing it
+
+#ifdef IMAGE_SEQUENCE_CAPTURE
+extern ImageSequenceCapture*	gs_pImageSequenceCapture;	// Set by the main loop, grabs the rendered frames before they're presented
+#endif
 
 #ifdef _DEBUG
 extern Video*		gs_pVideo;			// Global video capture from the webcam
@@ -15,5 +20,10 @@ extern Video*		gs_pVideo;			// Global video capture from the webcam
 int		IntroInit( IntroProgressDelegate& _Delegate );
 void	IntroExit();
 
+// Called at a fixed rate (0 or more times per frame) to advance the simulation, _DeltaTime is the constant step
+// Return false to end the intro
+bool	IntroUpdate( float _Time, float _DeltaTime );
+
+// Called once per frame to render, _Time lags the simulation by less than a step
 // Return false to end the intro
 bool	IntroDo( float _Time, float _DeltaTime );
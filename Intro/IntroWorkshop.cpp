@@ -16,6 +16,9 @@ static Camera*			gs_pCamera = NULL;
 // Primitives
 Primitive*				gs_pPrimQuad = NULL;		// Screen quad for post-processes
 
+// Textures & Render targets
+DepthPyramid*			gs_pDepthPyramid = NULL;	// Not used by the workshop effects
+
 // Materials
 static Shader*		gs_pMatPostFinal = NULL;	// Final post-process rendering to the screen
 
@@ -110,11 +113,20 @@ void	IntroExit()
 	// Release render targets & textures
 	Delete3DTextures();
 	Delete2DTextures();
+	TextureBuilderGPU::ReleaseKernels();
+	JumpFlood::ReleaseKernels();
+	MipGenerator::ReleaseKernels();
 
 	// Release the camera
 	delete gs_pCamera;
 }
 
+bool	IntroUpdate( float _Time, float _DeltaTime )
+{
+	// Nothing is simulated at a fixed rate yet: the effects still animate from the render time
+	return true;
+}
+
 bool	IntroDo( float _Time, float _DeltaTime )
 {
 	// Upload global parameters
@@ -139,9 +151,10 @@ bool	IntroDo( float _Time, float _DeltaTime )
 
  	gs_pEffectDeferred->Render( _Time, _DeltaTime );
 
+	gs_Device.RenderTargets().EndFrame();
 
 	// Present !
-	gs_Device.DXSwapChain().Present( 0, 0 );
+	gs_Device.Present();
 
 	return true;	// True means continue !
 }
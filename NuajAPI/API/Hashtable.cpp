@@ -113,4 +113,49 @@ void	DictionaryU32::ForEach( VisitorDelegate _pDelegate, void* _pUserData )
 			pNode = pNode->pNext;
 		}
 	}
-}
\ No newline at end of file
+}
+
+//////////////////////////////////////////////////////////////////////////
+// StringID debug registry
+// Keeps a copy of the string of each ID built to detect collisions
+// NOTE: Not thread-safe, IDs built from concurrent threads (e.g. threaded shader compilation) may race on the registry
+//
+#ifdef _DEBUG
+
+struct	StringIDRegistry
+{
+	FlatDictionary<U32, char*>	Hash2String;
+
+	static void	DeleteString( int _EntryIndex, char*& _pValue, void* _pUserData )	{ delete[] _pValue; }
+
+	~StringIDRegistry()	{ Hash2String.ForEach( DeleteString, NULL ); }
+};
+
+static StringIDRegistry&	GetStringIDRegistry()
+{
+	static StringIDRegistry	Registry;	// Constructed on first use since IDs can be built by static initializers
+	return Registry;
+}
+
+void	StringID::Register( U32 _Hash, const char* _pString )
+{
+	char**	ppExisting = GetStringIDRegistry().Hash2String.Get( _Hash );
+	if ( ppExisting != NULL )
+	{
+		ASSERT( !strcmp( *ppExisting, _pString ), "StringID collision! 2 different strings have the same hash..." );
+		return;
+	}
+
+	int		Length = int( strlen( _pString ) ) + 1;
+	char*	pCopy = new char[Length];
+	memcpy( pCopy, _pString, Length );
+	GetStringIDRegistry().Hash2String.Add( _Hash, pCopy );
+}
+
+const char*	StringID::GetString( U32 _Hash )
+{
+	char**	ppString = GetStringIDRegistry().Hash2String.Get( _Hash );
+	return ppString != NULL ? *ppString : NULL;
+}
+
+#endif
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Types.h"
+#include "StringID.h"
 #include "ASMHelpers.h"
 #include "../Math/Math.h"
 
@@ -110,6 +111,12 @@ public:		// METHODS
 	void	Remove( U32 _Key );					// remove entry
 	void	Clear();
 	void	ForEach( VisitorDelegate _pDelegate, void* _pUserData );
+
+	// Interned strings are keyed by their hash
+	T*		Get( StringID _Key ) const				{ return Get( _Key.Hash ); }
+	T&		Add( StringID _Key )					{ return Add( _Key.Hash ); }
+	T&		Add( StringID _Key, const T& _Value )	{ return Add( _Key.Hash, _Value ); }
+	void	Remove( StringID _Key )					{ Remove( _Key.Hash ); }
 };
 
 // General dictionary storing blind values
@@ -198,5 +205,104 @@ public:		// METHODS
 };
 
 
+//////////////////////////////////////////////////////////////////////////
+// Flat dictionary using open addressing with Robin Hood probing
+//
+// Entries are stored in a single array instead of individually allocated nodes, and a separate byte per slot stores
+//	the probe distance of its entry (0 means empty) so a lookup mostly scans a few contiguous bytes and stops as soon
+//	as it meets an entry closer to its home slot than the key we're looking for would be.
+// Removal shifts the following entries back instead of leaving tombstones, and the table doubles once it's 80% full.
+//
+// The key traits class H is pluggable and must provide:
+//	static U32	GetHash( const K& _Key );
+//	static int	Compare( const K& _Key0, const K& _Key1 );	// 0 if equal
+//	static K	Copy( const K& _Key );						// Called when a key enters the dictionary
+//	static void	Release( K& _Key );							// Called when a key leaves the dictionary
+// Default traits are provided for integer keys, for strings (which are then copied and owned by the dictionary) and for
+//	interned strings (StringID, whose hash is used directly).
+//
+// NOTE: Pointers returned by Get()/Add() are only valid until the next Add() or Remove()
+//
+template<typename K> struct	FlatKey
+{
+	static U32		GetHash( const K& _Key )					{ U32 Hash = U32(_Key) * 0x9E3779B1U; return Hash ^ (Hash >> 16); }
+	static int		Compare( const K& _Key0, const K& _Key1 )	{ return _Key0 == _Key1 ? 0 : 1; }
+	static K		Copy( const K& _Key )						{ return _Key; }
+	static void		Release( K& _Key )							{}
+};
+template<> struct	FlatKey<const char*>
+{
+	static U32		GetHash( const char* const& _pKey )
+	{	// djb2
+		U32			Hash = 5381;
+		const char*	pKey = _pKey;
+		int			c;
+		while ( (c = *pKey++) )
+			Hash = ((Hash << 5) + Hash) + c;
+		return Hash;
+	}
+	static int		Compare( const char* const& _pKey0, const char* const& _pKey1 )	{ return strcmp( _pKey0, _pKey1 ); }
+	static const char*	Copy( const char* const& _pKey )
+	{
+		int		Length = int( strlen( _pKey ) ) + 1;
+		char*	pCopy = new char[Length];
+		memcpy( pCopy, _pKey, Length );
+		return pCopy;
+	}
+	static void		Release( const char*& _pKey )				{ delete[] _pKey; _pKey = NULL; }
+};
+template<> struct	FlatKey<StringID>
+{	// The FNV hash is already well distributed and no string needs to be copied
+	static U32		GetHash( const StringID& _Key )							{ return _Key.Hash; }
+	static int		Compare( const StringID& _Key0, const StringID& _Key1 )	{ return _Key0 == _Key1 ? 0 : 1; }
+	static StringID	Copy( const StringID& _Key )							{ return _Key; }
+	static void		Release( StringID& _Key )								{}
+};
+
+template<typename K, typename T, typename H=FlatKey<K> > class	FlatDictionary
+{
+public:
+
+	typedef void	(*VisitorDelegate)( int _EntryIndex, T& _Value, void* _pUserData );
+
+protected:	// NESTED TYPES
+
+	struct	Slot
+	{
+		K		Key;
+		T		Value;
+	};
+
+protected:	// FIELDS
+
+	Slot*	m_pSlots;
+	U8*		m_pDistances;		// Probe distance + 1 for each slot, 0 if the slot is empty
+	int		m_Capacity;			// Always a power of 2
+	int		m_EntriesCount;
+
+public:		// METHODS
+
+	FlatDictionary( int _Capacity=16 );
+	~FlatDictionary();
+
+	int		GetEntriesCount() const		{ return m_EntriesCount; }	// Amount of entries in the dictionary
+
+	T*		Get( const K& _Key ) const;				// retrieve entry
+	T&		Add( const K& _Key );					// store entry
+	T&		Add( const K& _Key, const T& _Value );	// store entry
+	T&		AddUnique( const K& _Key );				// store entry if it doesn't exist yet
+	void	AddUnique( const K& _Key, const T& _Value );
+	void	Remove( const K& _Key );				// remove entry
+	void	Clear();
+	void	ForEach( VisitorDelegate _pDelegate, void* _pUserData );
+
+protected:
+
+	int		Find( const K& _Key ) const;
+	int		Insert( const K& _Key, const T& _Value );
+	void	Grow();
+};
+
+
 //////////////////////////////////////////////////////////////////////////
 #include "Hashtable.inl"
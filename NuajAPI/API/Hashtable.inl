@@ -50,6 +50,7 @@ template<typename T> T&	DictionaryString<T>::Add( const char* _pKey )
 {
 	U32		idx = Hash( _pKey ) % m_Size;
  
+	ALLOCATION_TAG( "DictionaryString" );
 	Node*	pNode = new Node();
 
 	int		KeyLength = strnlen( _pKey, HT_MAX_KEYLEN ) + 1;
@@ -221,6 +222,7 @@ template<typename T> T&	Dictionary<T>::Add( U32 _Key )
 {
 	U32		idx = _Key % m_Size;
  
+	ALLOCATION_TAG( "Dictionary" );
 	Node*	pNode = new Node();
 	pNode->Key = _Key;
 	pNode->pNext = m_ppTable[idx];	// Here, we could add a check for m_ppTable[idx] == NULL to ensure no collision...
@@ -442,3 +444,198 @@ void	DictionaryGeneric<K,T>::ForEach( VisitorDelegate _pDelegate, void* _pUserDa
 		}
 	}
 }
+
+//////////////////////////////////////////////////////////////////////////
+// Flat version
+//
+template<typename K, typename T, typename H>
+FlatDictionary<K,T,H>::FlatDictionary( int _Capacity ) : m_EntriesCount( 0 )
+{
+	m_Capacity = 4;
+	while ( m_Capacity < _Capacity )
+		m_Capacity <<= 1;
+
+	m_pSlots = new Slot[m_Capacity];
+	m_pDistances = new U8[m_Capacity];
+	memset( m_pDistances, 0, m_Capacity );
+}
+
+template<typename K, typename T, typename H>
+FlatDictionary<K,T,H>::~FlatDictionary()
+{
+	Clear();
+	delete[] m_pDistances;
+	delete[] m_pSlots;
+}
+
+template<typename K, typename T, typename H>
+T*	FlatDictionary<K,T,H>::Get( const K& _Key ) const
+{
+	int	SlotIndex = Find( _Key );
+	return SlotIndex >= 0 ? &m_pSlots[SlotIndex].Value : NULL;
+}
+
+template<typename K, typename T, typename H>
+T&	FlatDictionary<K,T,H>::Add( const K& _Key )
+{
+	ASSERT( Find( _Key ) < 0, "Key already exists! Use AddUnique() instead..." );
+
+	if ( 5*(m_EntriesCount+1) > 4*m_Capacity )
+		Grow();		// Keep the load factor below 80%
+
+	int	SlotIndex = Insert( H::Copy( _Key ), T() );
+	m_EntriesCount++;
+
+	return m_pSlots[SlotIndex].Value;
+}
+
+template<typename K, typename T, typename H>
+T&	FlatDictionary<K,T,H>::Add( const K& _Key, const T& _Value )
+{
+	T&	Value = Add( _Key );
+		Value = _Value;
+
+	return Value;
+}
+
+template<typename K, typename T, typename H>
+T&	FlatDictionary<K,T,H>::AddUnique( const K& _Key )
+{
+	T*	pExisting = Get( _Key );
+	if ( pExisting != NULL )
+		return *pExisting;
+
+	return Add( _Key );
+}
+
+template<typename K, typename T, typename H>
+void	FlatDictionary<K,T,H>::AddUnique( const K& _Key, const T& _Value )
+{
+	T&	Value = AddUnique( _Key );
+		Value = _Value;
+}
+
+template<typename K, typename T, typename H>
+void	FlatDictionary<K,T,H>::Remove( const K& _Key )
+{
+	int	SlotIndex = Find( _Key );
+	if ( SlotIndex < 0 )
+		return;
+
+	H::Release( m_pSlots[SlotIndex].Key );
+
+	// Shift the following entries back until we reach an empty slot or an entry that is already in its home slot
+	int	Mask = m_Capacity - 1;
+	int	NextSlotIndex = (SlotIndex + 1) & Mask;
+	while ( m_pDistances[NextSlotIndex] > 1 )
+	{
+		m_pSlots[SlotIndex] = m_pSlots[NextSlotIndex];
+		m_pDistances[SlotIndex] = m_pDistances[NextSlotIndex] - 1;
+
+		SlotIndex = NextSlotIndex;
+		NextSlotIndex = (NextSlotIndex + 1) & Mask;
+	}
+
+	m_pDistances[SlotIndex] = 0;
+	m_pSlots[SlotIndex].Value = T();
+	m_EntriesCount--;
+}
+
+template<typename K, typename T, typename H>
+void	FlatDictionary<K,T,H>::Clear()
+{
+	for ( int SlotIndex=0; SlotIndex < m_Capacity; SlotIndex++ )
+		if ( m_pDistances[SlotIndex] != 0 )
+		{
+			H::Release( m_pSlots[SlotIndex].Key );
+			m_pSlots[SlotIndex].Value = T();
+		}
+
+	memset( m_pDistances, 0, m_Capacity );
+	m_EntriesCount = 0;
+}
+
+template<typename K, typename T, typename H>
+void	FlatDictionary<K,T,H>::ForEach( VisitorDelegate _pDelegate, void* _pUserData )
+{
+	int	EntryIndex = 0;
+	for ( int SlotIndex=0; SlotIndex < m_Capacity; SlotIndex++ )
+		if ( m_pDistances[SlotIndex] != 0 )
+			(*_pDelegate)( EntryIndex++, m_pSlots[SlotIndex].Value, _pUserData );
+}
+
+template<typename K, typename T, typename H>
+int		FlatDictionary<K,T,H>::Find( const K& _Key ) const
+{
+	int	Mask = m_Capacity - 1;
+	int	SlotIndex = H::GetHash( _Key ) & Mask;
+	for ( int Distance=1; Distance <= m_pDistances[SlotIndex]; Distance++ )
+	{
+		if ( m_pDistances[SlotIndex] == Distance && H::Compare( _Key, m_pSlots[SlotIndex].Key ) == 0 )
+			return SlotIndex;
+
+		SlotIndex = (SlotIndex + 1) & Mask;
+	}
+
+	return -1;	// We met an empty slot or an entry closer to its home than we would be: the key can't be further
+}
+
+// Inserts a key we already own and returns the slot where it landed
+// Poorer entries (i.e. further from their home slot) steal the slots of richer ones as we go
+template<typename K, typename T, typename H>
+int		FlatDictionary<K,T,H>::Insert( const K& _Key, const T& _Value )
+{
+	int		Mask = m_Capacity - 1;
+	int		SlotIndex = H::GetHash( _Key ) & Mask;
+	int		Result = -1;
+
+	Slot	Carried;
+	Carried.Key = _Key;
+	Carried.Value = _Value;
+	int		Distance = 1;
+	while ( m_pDistances[SlotIndex] != 0 )
+	{
+		if ( m_pDistances[SlotIndex] < Distance )
+		{	// Swap with the richer entry and carry it further
+			Slot	Temp = m_pSlots[SlotIndex];
+			m_pSlots[SlotIndex] = Carried;
+			Carried = Temp;
+
+			int		TempDistance = m_pDistances[SlotIndex];
+			m_pDistances[SlotIndex] = U8(Distance);
+			Distance = TempDistance;
+
+			if ( Result < 0 )
+				Result = SlotIndex;
+		}
+
+		SlotIndex = (SlotIndex + 1) & Mask;
+		Distance++;
+		ASSERT( Distance < 256, "Probe sequence too long! Check your hash function..." );
+	}
+
+	m_pSlots[SlotIndex] = Carried;
+	m_pDistances[SlotIndex] = U8(Distance);
+
+	return Result >= 0 ? Result : SlotIndex;
+}
+
+template<typename K, typename T, typename H>
+void	FlatDictionary<K,T,H>::Grow()
+{
+	Slot*	pOldSlots = m_pSlots;
+	U8*		pOldDistances = m_pDistances;
+	int		OldCapacity = m_Capacity;
+
+	m_Capacity <<= 1;
+	m_pSlots = new Slot[m_Capacity];
+	m_pDistances = new U8[m_Capacity];
+	memset( m_pDistances, 0, m_Capacity );
+
+	for ( int SlotIndex=0; SlotIndex < OldCapacity; SlotIndex++ )
+		if ( pOldDistances[SlotIndex] != 0 )
+			Insert( pOldSlots[SlotIndex].Key, pOldSlots[SlotIndex].Value );	// Keys are moved, not copied
+
+	delete[] pOldDistances;
+	delete[] pOldSlots;
+}
@@ -3,15 +3,29 @@
 #include "Types.h"
 #include "ASMHelpers.h"
 
+// Placement new (we don't include <new> but stay compatible with it if somebody else does)
+#ifndef __PLACEMENT_NEW_INLINE
+#define __PLACEMENT_NEW_INLINE
+inline void* __cdecl	operator new( size_t, void* _pWhere )	{ return _pWhere; }
+inline void  __cdecl	operator delete( void*, void* )			{}
+#endif
+
 // Comparer should return:
 //	+1 if a < b 
 //	-1 if a > b
 //	 0 if a == b
+// NOTE: Sort() accepts any object with such a Compare() method, deriving from IComparer is not mandatory
+//	and deriving a class marked as final (or not using IComparer at all) lets the compiler inline the comparisons
 template<typename T> class	IComparer {
 public:	virtual int		Compare( const T& a, const T& b ) const = 0;
 };
 
 // Simple list class
+//	_ All the allocated elements are constructed, elements beyond the count are kept around for later use
+//	_ Elements are relocated bitwise when the list grows or elements are moved around: they are never copied
+//		nor destroyed in the process so elements owning memory (e.g. other lists) can be safely stored by value
+//	_ The allocated size grows geometrically so appending is amortized O(1)
+//	WARNING: Growing the list invalidates pointers to its elements! Use Reserve() or Init() if you intend to keep them
 template<typename T> class	List
 {
 protected:	// NESTED TYPES
@@ -37,23 +51,32 @@ public:		// METHODS
 	List( U32 _InitialSize );
 	~List();
 
-	void		Init( U32 _Size );
+	void		Init( U32 _Size );				// Ensures at least _Size elements are allocated and clears the list
+	void		Reserve( U32 _Size );			// Ensures at least _Size elements are allocated, keeping the existing elements
 
 	T&			operator[]( U32 _Index );
 	const T&	operator[]( U32 _Index ) const;
 	T&			Insert( U32 _Index );
 	void		Append( const T& _Value );
 	void		AppendUnique( const T& _Value );
-	T&			Append();
+	T&			Append();						// Returns a new default-constructed element
+	void		AppendRange( const T* _pValues, U32 _Count );
+	void		AppendRange( const List<T>& _Values )	{ AppendRange( _Values.m_pList, _Values.m_Count ); }
 	U32			IndexOf( const T& _Value ) const;
-	void		RemoveAt( U32 _Index );
+	void		RemoveAt( U32 _Index );			// Keeps the order of elements, O(N)
+	void		RemoveSwap( U32 _Index );		// Replaces the element by the last one, O(1)
 	bool		Remove( const T& _Value );
 	void		Clear()	{ m_Count = 0; }
 
-	void		Sort( const IComparer<T>& _Comparer );
+	template<typename C> void	Sort( const C& _Comparer );
 
 private:
-	void		Allocate( U32 _NewCount );
+	void		Grow( U32 _MinSize );
+	void		Reallocate( U32 _NewSize );
+	void		Release();
+	void		Reset( T& _Element );
+	void		Swap( U32 _Index0, U32 _Index1 );
+	template<typename C> void	SortRange( U32 _Left, U32 _Right, const C& _Comparer );
 };
 
-#include "List.inl"
\ No newline at end of file
+#include "List.inl"
@@ -1,4 +1,3 @@
-
 template<typename T> List<T>::List()
 	: m_pList( NULL )
 	, m_Size( 0 )
@@ -18,17 +17,22 @@ template<typename T> List<T>::List( U32 _InitialSize )
 template<typename T> void	List<T>::Init( U32 _Size )
 {
 	if ( _Size > m_Size ) {
-		delete[] m_pList;
-		m_pList = new T[_Size];
+		Release();	// No need to relocate the existing elements
+		Reallocate( _Size );
 	}
 
-	m_Size = _Size;
 	m_Count = 0;
 }
 
+template<typename T> void	List<T>::Reserve( U32 _Size )
+{
+	if ( _Size > m_Size )
+		Reallocate( _Size );
+}
+
 template<typename T> List<T>::~List()
 {
-	delete[] m_pList;
+	Release();
 }
 
 template<typename T> T&			List<T>::operator[]( U32 _Index )
@@ -44,8 +48,17 @@ template<typename T> const T&	List<T>::operator[]( U32 _Index ) const
 }
 
 template<typename T> void		List<T>::Append( const T& _Value ) {
-	Allocate( m_Count+1 );
-	memcpy( &m_pList[m_Count-1], &_Value, sizeof(T) );
+	if ( m_Count == m_Size ) {
+		if ( &_Value >= m_pList && &_Value < m_pList+m_Size ) {
+			// The value lives in our own buffer that is about to move...
+			U32	SourceIndex = U32(&_Value - m_pList);
+			Grow( m_Count+1 );
+			m_pList[m_Count++] = m_pList[SourceIndex];
+			return;
+		}
+		Grow( m_Count+1 );
+	}
+	m_pList[m_Count++] = _Value;
 }
 
 template<typename T> void		List<T>::AppendUnique( const T& _Value ) {
@@ -58,18 +71,38 @@ template<typename T> void		List<T>::AppendUnique( const T& _Value ) {
 }
 
 template<typename T> T&			List<T>::Append() {
-	Allocate( m_Count+1 );
-	return m_pList[m_Count-1];
+	if ( m_Count == m_Size )
+		Grow( m_Count+1 );
+
+	T&	Result = m_pList[m_Count++];
+	Reset( Result );
+	return Result;
 }
 
-template<typename T> T&			List<T>::Insert( U32 _Index ) {
-	if ( _Index == m_Count )
-		return Append( _Index );
+template<typename T> void		List<T>::AppendRange( const T* _pValues, U32 _Count ) {
+	ASSERT( _pValues+_Count <= m_pList || _pValues >= m_pList+m_Size, "Can't append a range from the list itself!" );
+	if ( m_Count+_Count > m_Size )
+		Grow( m_Count+_Count );
 
-	ASSERT( _Index < m_Count, "Index out of range!" );
-	Allocate( m_Count+1 );
+	T*	pTarget = m_pList + m_Count;
+	for ( U32 i=0; i < _Count; i++ )
+		*pTarget++ = *_pValues++;
+	m_Count += _Count;
+}
 
-	memcpy( &m_pList[_Index+1], &m_pList[_Index], (m_Count-1-_Index)*sizeof(T) );
+template<typename T> T&			List<T>::Insert( U32 _Index ) {
+	ASSERT( _Index <= m_Count, "Index out of range!" );
+	if ( m_Count == m_Size )
+		Grow( m_Count+1 );
+
+	// Rotate the spare element at the end into the insertion slot
+	U8	pTemp[sizeof(T)];
+	memcpy( pTemp, &m_pList[m_Count], sizeof(T) );
+	memmove( &m_pList[_Index+1], &m_pList[_Index], (m_Count-_Index)*sizeof(T) );
+	memcpy( &m_pList[_Index], pTemp, sizeof(T) );
+	m_Count++;
+
+	Reset( m_pList[_Index] );
 	return m_pList[_Index];
 }
 
@@ -84,7 +117,20 @@ template<typename T> U32		List<T>::IndexOf( const T& _Value ) const {
 
 template<typename T> void		List<T>::RemoveAt( U32 _Index ) {
 	ASSERT( _Index < m_Count, "Index out of range!" );
-	memcpy( &m_pList[_Index], &m_pList[_Index+1], (m_Count-_Index-1)*sizeof(T) );
+
+	// Rotate the removed element at the end of the list where it becomes a spare element
+	U8	pTemp[sizeof(T)];
+	memcpy( pTemp, &m_pList[_Index], sizeof(T) );
+	memmove( &m_pList[_Index], &m_pList[_Index+1], (m_Count-_Index-1)*sizeof(T) );
+	memcpy( &m_pList[m_Count-1], pTemp, sizeof(T) );
+	m_Count--;
+}
+
+template<typename T> void		List<T>::RemoveSwap( U32 _Index ) {
+	ASSERT( _Index < m_Count, "Index out of range!" );
+	m_Count--;
+	if ( _Index != m_Count )
+		Swap( _Index, m_Count );
 }
 
 template<typename T> bool		List<T>::Remove( const T& _Value ) {
@@ -96,46 +142,96 @@ template<typename T> bool		List<T>::Remove( const T& _Value ) {
 	return true;
 }
 
-template<typename T> void		List<T>::Allocate( U32 _NewCount ) {
-	if ( _NewCount <= m_Size )
-	{	// No need to re-allocate...
-		m_Count = _NewCount;
-		return;
-	}
+template<typename T> void		List<T>::Grow( U32 _MinSize ) {
+	U32	NewSize = m_Size != 0 ? 2*m_Size : 8;	// Arbitrary...
+	if ( NewSize < _MinSize )
+		NewSize = _MinSize;
+
+	Reallocate( NewSize );
+}
+
+template<typename T> void		List<T>::Reallocate( U32 _NewSize ) {
+	ASSERT( _NewSize > m_Size, "Lists never shrink!" );
+
+	ALLOCATION_TAG( "List<T>" );
+	T*	pNewList = (T*) new U8[_NewSize*sizeof(T)];
+	if ( m_pList != NULL )
+		memcpy( pNewList, m_pList, m_Size*sizeof(T) );	// Relocate existing elements
+	for ( U32 i=m_Size; i < _NewSize; i++ )
+		new( pNewList+i ) T();
+
+	delete[] (U8*) m_pList;
+	m_pList = pNewList;
+	m_Size = _NewSize;
+}
+
+template<typename T> void		List<T>::Release() {
+	for ( U32 i=0; i < m_Size; i++ )
+		m_pList[i].~T();
+	delete[] (U8*) m_pList;
+
+	m_pList = NULL;
+	m_Size = 0;
+	m_Count = 0;
+}
 
-	T*	pOldList = m_pList;
-	int	OldSize = m_Size;
-
-	if ( m_Size != 0 )
-		m_Size *= 2;
-	else
-		m_Size = 8;	// Arbitrary...
-
-	m_pList = new T[m_Size];
-	memset( m_pList, 0, m_Size*sizeof(T) );
-	if ( pOldList != NULL )
-		memcpy( m_pList, pOldList, OldSize*sizeof(T) );
-	m_Count = _NewCount;
-
-	delete[] pOldList;
-}
-
-// Poor man's version: bubble sort!
-template<typename T> void	List<T>::Sort( const IComparer<T>& _Comparer ) {
-	if ( m_Size == 0 )
-		return;
-
-	T	temp;
-	for ( U32 i=0; i < m_Size-1; i++ ) {
-		T&	a = m_pList[i];
-		for ( U32 j=i; j < m_Size; j++ ) {
-			T&	b = m_pList[j];
-			if ( _Comparer.Compare( a, b ) < 0 ) {
-				// Swap since a > b and should be placed afterward...
-				memcpy_s( &temp, sizeof(T), &a, sizeof(T) );
-				memcpy_s( &a, sizeof(T), &b, sizeof(T) );
-				memcpy_s( &b, sizeof(T), &temp, sizeof(T) );
-			}
+template<typename T> void		List<T>::Reset( T& _Element ) {
+	_Element.~T();
+	new( &_Element ) T();
+}
+
+template<typename T> void		List<T>::Swap( U32 _Index0, U32 _Index1 ) {
+	U8	pTemp[sizeof(T)];
+	memcpy( pTemp, &m_pList[_Index0], sizeof(T) );
+	memcpy( &m_pList[_Index0], &m_pList[_Index1], sizeof(T) );
+	memcpy( &m_pList[_Index1], pTemp, sizeof(T) );
+}
+
+// Quick sort with median of 3 pivot and insertion sort for small ranges
+template<typename T> template<typename C> void	List<T>::Sort( const C& _Comparer ) {
+	if ( m_Count > 1 )
+		SortRange( 0, m_Count-1, _Comparer );
+}
+
+template<typename T> template<typename C> void	List<T>::SortRange( U32 _Left, U32 _Right, const C& _Comparer ) {
+	while ( _Right - _Left > 16 ) {
+		// Order left, middle and right elements and use the median as pivot
+		U32	Middle = _Left + ((_Right - _Left) >> 1);
+		if ( _Comparer.Compare( m_pList[Middle], m_pList[_Left] ) > 0 )
+			Swap( _Left, Middle );
+		if ( _Comparer.Compare( m_pList[_Right], m_pList[_Left] ) > 0 )
+			Swap( _Left, _Right );
+		if ( _Comparer.Compare( m_pList[_Right], m_pList[Middle] ) > 0 )
+			Swap( Middle, _Right );
+
+		// Partition (left and right elements act as sentinels)
+		U32	PivotIndex = _Right-1;
+		Swap( Middle, PivotIndex );
+		const T&	Pivot = m_pList[PivotIndex];
+
+		U32	i = _Left;
+		U32	j = PivotIndex;
+		for ( ;; ) {
+			while ( _Comparer.Compare( m_pList[++i], Pivot ) > 0 );
+			while ( _Comparer.Compare( Pivot, m_pList[--j] ) > 0 );
+			if ( i >= j )
+				break;
+			Swap( i, j );
+		}
+		Swap( i, PivotIndex );
+
+		// Recurse into the smallest partition and loop on the largest one to bound the stack depth
+		if ( i - _Left < _Right - i ) {
+			SortRange( _Left, i-1, _Comparer );
+			_Left = i+1;
+		} else {
+			SortRange( i+1, _Right, _Comparer );
+			_Right = i-1;
 		}
 	}
+
+	// Finish with an insertion sort
+	for ( U32 i=_Left+1; i <= _Right; i++ )
+		for ( U32 j=i; j > _Left && _Comparer.Compare( m_pList[j], m_pList[j-1] ) > 0; j-- )
+			Swap( j-1, j );
 }
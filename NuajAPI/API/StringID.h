@@ -0,0 +1,75 @@
+//////////////////////////////////////////////////////////////////////////
+// Interned string IDs
+// A StringID is the 32-bits FNV-1a hash of a string, used in place of the string to look up shader bindings & dictionaries.
+// Built from a string literal, the hash is computed by a chain of force-inlined templates (one per character) that the
+//	optimizer folds into a constant so, in release, a GCX_ID( "_TexShadowMap" ) costs nothing more than an integer.
+// Runtime strings must go through StringID::FromString() that hashes the same way with a loop.
+//
+// Usage:
+//	pShader->SetTexture( GCX_ID( "_TexShadowMap" ), pShadowMap->GetSRV() );
+//	Dictionary<int>	Values;	Values.Add( GCX_ID( "Count" ) ) = 12;
+//
+// NOTE: The hash is never checked against the string in release so 2 strings sharing the same ID can't be told apart!
+//	In DEBUG, every ID built is registered along with its string and the registry asserts when 2 different strings collide.
+//
+#pragma once
+
+#include "Types.h"
+
+#define GCX_ID( _String )	StringID( _String )
+
+struct	StringID
+{
+	static const U32	FNV_OFFSET_BASIS = 2166136261U;
+	static const U32	FNV_PRIME = 16777619U;
+
+	U32		Hash;
+
+	StringID() : Hash( 0 )	{}
+
+	// Hashes a string literal (the terminating 0 is not part of the hash)
+	template<int N> __forceinline StringID( const char (&_pString)[N] )
+		: Hash( Hasher<N, N-1>::Compute( _pString ) )
+	{
+#ifdef _DEBUG
+		Register( Hash, _pString );
+#endif
+	}
+
+	// Hashes a runtime string
+	static StringID	FromString( const char* _pString )
+	{
+		StringID	Result;
+		Result.Hash = FNV_OFFSET_BASIS;
+		for ( const char* pChar=_pString; *pChar != '\0'; pChar++ )
+			Result.Hash = (Result.Hash ^ U8(*pChar)) * FNV_PRIME;
+#ifdef _DEBUG
+		Register( Result.Hash, _pString );
+#endif
+		return Result;
+	}
+
+	bool	operator==( const StringID& _Other ) const	{ return Hash == _Other.Hash; }
+	bool	operator!=( const StringID& _Other ) const	{ return Hash != _Other.Hash; }
+
+#ifdef _DEBUG
+	// Returns the string the ID was built from, or NULL if it was never built (cf. Hashtable.cpp)
+	static const char*	GetString( U32 _Hash );
+#endif
+
+private:
+
+	// Hash of the _Length first characters of the string, unrolled at compile time
+	template<int N, int _Length> struct	Hasher
+	{
+		static __forceinline U32	Compute( const char (&_pString)[N] )	{ return (Hasher<N, _Length-1>::Compute( _pString ) ^ U8(_pString[_Length-1])) * FNV_PRIME; }
+	};
+	template<int N> struct	Hasher<N, 0>
+	{
+		static __forceinline U32	Compute( const char (&_pString)[N] )	{ return FNV_OFFSET_BASIS; }
+	};
+
+#ifdef _DEBUG
+	static void			Register( U32 _Hash, const char* _pString );
+#endif
+};
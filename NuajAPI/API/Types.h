@@ -18,8 +18,8 @@ typedef signed short	S16;
 typedef unsigned short	U16;
 typedef unsigned int	U32;
 typedef signed int		S32;
-typedef unsigned long	U64;
-typedef signed long		S64;
+typedef unsigned __int64	U64;	// long is only 32 bits with MSVC
+typedef signed __int64		S64;
 
 typedef int NjErrorID;
 typedef int NjResourceID;
@@ -29,6 +29,7 @@ typedef int NjResourceID;
 //
 #define SAFE_DELETE( a )		if ( (a) != NULL ) { delete (a); (a) = NULL; }
 #define SAFE_DELETE_ARRAY( a )	if ( (a) != NULL ) { delete[] (a); (a) = NULL; }
+#define ALLOCATION_TAG( _pTag )	// Tags the heap allocations of the scope, only tracked with TRACK_ALLOCATIONS (cf. Utility/Memory.h)
 
 #ifndef GODCOMPLEX
 template<typename T> void		SafeDelete__( T*& _pBuffer )
@@ -22,6 +22,43 @@ const float4	float4::UnitW( 0, 0, 0, 1 );
 const float4x4	float4x4::Zero = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
 const float4x4	float4x4::Identity = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
 
+#ifdef NUAJ_MATH_SSE
+// Matrix rows loaded into SSE registers
+struct	SSEMatrix
+{
+	__m128	r0, r1, r2, r3;
+
+	SSEMatrix( const float4x4& _M )
+		: r0( _mm_loadu_ps( &_M.m[4*0] ) )
+		, r1( _mm_loadu_ps( &_M.m[4*1] ) )
+		, r2( _mm_loadu_ps( &_M.m[4*2] ) )
+		, r3( _mm_loadu_ps( &_M.m[4*3] ) )	{}
+
+	__m128	Transform( __m128 _V ) const
+	{
+		__m128	x = _mm_shuffle_ps( _V, _V, _MM_SHUFFLE( 0, 0, 0, 0 ) );
+		__m128	y = _mm_shuffle_ps( _V, _V, _MM_SHUFFLE( 1, 1, 1, 1 ) );
+		__m128	z = _mm_shuffle_ps( _V, _V, _MM_SHUFFLE( 2, 2, 2, 2 ) );
+		__m128	w = _mm_shuffle_ps( _V, _V, _MM_SHUFFLE( 3, 3, 3, 3 ) );
+		return _mm_add_ps( _mm_add_ps( _mm_mul_ps( x, r0 ), _mm_mul_ps( y, r1 ) ), _mm_add_ps( _mm_mul_ps( z, r2 ), _mm_mul_ps( w, r3 ) ) );
+	}
+	__m128	TransformPoint( const float3& _P ) const
+	{
+		return _mm_add_ps( _mm_add_ps( _mm_mul_ps( _mm_set1_ps( _P.x ), r0 ), _mm_mul_ps( _mm_set1_ps( _P.y ), r1 ) ), _mm_add_ps( _mm_mul_ps( _mm_set1_ps( _P.z ), r2 ), r3 ) );
+	}
+	__m128	TransformVector( const float3& _V ) const
+	{
+		return _mm_add_ps( _mm_add_ps( _mm_mul_ps( _mm_set1_ps( _V.x ), r0 ), _mm_mul_ps( _mm_set1_ps( _V.y ), r1 ) ), _mm_mul_ps( _mm_set1_ps( _V.z ), r2 ) );
+	}
+};
+
+static inline void	StoreFloat3( float3& _Target, __m128 _V )
+{
+	_mm_storel_pi( (__m64*) &_Target.x, _V );
+	_mm_store_ss( &_Target.z, _mm_movehl_ps( _V, _V ) );
+}
+#endif
+
 float4	float4::QuatFromAngleAxis( float _Angle, const float3& _Axis )
 {
 	float3	NormalizedAxis = _Axis;
@@ -37,6 +74,90 @@ float4	float4::QuatFromAngleAxis( float _Angle, const float3& _Axis )
 
 float4x4  float4x4::Inverse() const
 {
+#ifdef NUAJ_MATH_SSE
+	// Cramer's rule on the transposed matrix (cf. Intel's "Streaming SIMD Extensions - Inverse of 4x4 Matrix")
+	const float*	pSource = m;
+	__m128	Minor0, Minor1, Minor2, Minor3;
+	__m128	Row0, Row1 = _mm_setzero_ps(), Row2, Row3 = _mm_setzero_ps();
+	__m128	Det, Temp = _mm_setzero_ps();
+
+	Temp = _mm_loadh_pi( _mm_loadl_pi( Temp, (const __m64*) (pSource+ 0) ), (const __m64*) (pSource+ 4) );
+	Row1 = _mm_loadh_pi( _mm_loadl_pi( Row1, (const __m64*) (pSource+ 8) ), (const __m64*) (pSource+12) );
+	Row0 = _mm_shuffle_ps( Temp, Row1, 0x88 );
+	Row1 = _mm_shuffle_ps( Row1, Temp, 0xDD );
+	Temp = _mm_loadh_pi( _mm_loadl_pi( Temp, (const __m64*) (pSource+ 2) ), (const __m64*) (pSource+ 6) );
+	Row3 = _mm_loadh_pi( _mm_loadl_pi( Row3, (const __m64*) (pSource+10) ), (const __m64*) (pSource+14) );
+	Row2 = _mm_shuffle_ps( Temp, Row3, 0x88 );
+	Row3 = _mm_shuffle_ps( Row3, Temp, 0xDD );
+
+	Temp = _mm_mul_ps( Row2, Row3 );
+	Temp = _mm_shuffle_ps( Temp, Temp, 0xB1 );
+	Minor0 = _mm_mul_ps( Row1, Temp );
+	Minor1 = _mm_mul_ps( Row0, Temp );
+	Temp = _mm_shuffle_ps( Temp, Temp, 0x4E );
+	Minor0 = _mm_sub_ps( _mm_mul_ps( Row1, Temp ), Minor0 );
+	Minor1 = _mm_sub_ps( _mm_mul_ps( Row0, Temp ), Minor1 );
+	Minor1 = _mm_shuffle_ps( Minor1, Minor1, 0x4E );
+
+	Temp = _mm_mul_ps( Row1, Row2 );
+	Temp = _mm_shuffle_ps( Temp, Temp, 0xB1 );
+	Minor0 = _mm_add_ps( _mm_mul_ps( Row3, Temp ), Minor0 );
+	Minor3 = _mm_mul_ps( Row0, Temp );
+	Temp = _mm_shuffle_ps( Temp, Temp, 0x4E );
+	Minor0 = _mm_sub_ps( Minor0, _mm_mul_ps( Row3, Temp ) );
+	Minor3 = _mm_sub_ps( _mm_mul_ps( Row0, Temp ), Minor3 );
+	Minor3 = _mm_shuffle_ps( Minor3, Minor3, 0x4E );
+
+	Temp = _mm_mul_ps( _mm_shuffle_ps( Row1, Row1, 0x4E ), Row3 );
+	Temp = _mm_shuffle_ps( Temp, Temp, 0xB1 );
+	Row2 = _mm_shuffle_ps( Row2, Row2, 0x4E );
+	Minor0 = _mm_add_ps( _mm_mul_ps( Row2, Temp ), Minor0 );
+	Minor2 = _mm_mul_ps( Row0, Temp );
+	Temp = _mm_shuffle_ps( Temp, Temp, 0x4E );
+	Minor0 = _mm_sub_ps( Minor0, _mm_mul_ps( Row2, Temp ) );
+	Minor2 = _mm_sub_ps( _mm_mul_ps( Row0, Temp ), Minor2 );
+	Minor2 = _mm_shuffle_ps( Minor2, Minor2, 0x4E );
+
+	Temp = _mm_mul_ps( Row0, Row1 );
+	Temp = _mm_shuffle_ps( Temp, Temp, 0xB1 );
+	Minor2 = _mm_add_ps( _mm_mul_ps( Row3, Temp ), Minor2 );
+	Minor3 = _mm_sub_ps( _mm_mul_ps( Row2, Temp ), Minor3 );
+	Temp = _mm_shuffle_ps( Temp, Temp, 0x4E );
+	Minor2 = _mm_sub_ps( _mm_mul_ps( Row3, Temp ), Minor2 );
+	Minor3 = _mm_sub_ps( Minor3, _mm_mul_ps( Row2, Temp ) );
+
+	Temp = _mm_mul_ps( Row0, Row3 );
+	Temp = _mm_shuffle_ps( Temp, Temp, 0xB1 );
+	Minor1 = _mm_sub_ps( Minor1, _mm_mul_ps( Row2, Temp ) );
+	Minor2 = _mm_add_ps( _mm_mul_ps( Row1, Temp ), Minor2 );
+	Temp = _mm_shuffle_ps( Temp, Temp, 0x4E );
+	Minor1 = _mm_add_ps( _mm_mul_ps( Row2, Temp ), Minor1 );
+	Minor2 = _mm_sub_ps( Minor2, _mm_mul_ps( Row1, Temp ) );
+
+	Temp = _mm_mul_ps( Row0, Row2 );
+	Temp = _mm_shuffle_ps( Temp, Temp, 0xB1 );
+	Minor1 = _mm_add_ps( _mm_mul_ps( Row3, Temp ), Minor1 );
+	Minor3 = _mm_sub_ps( Minor3, _mm_mul_ps( Row1, Temp ) );
+	Temp = _mm_shuffle_ps( Temp, Temp, 0x4E );
+	Minor1 = _mm_sub_ps( Minor1, _mm_mul_ps( Row3, Temp ) );
+	Minor3 = _mm_add_ps( _mm_mul_ps( Row1, Temp ), Minor3 );
+
+	Det = _mm_mul_ps( Row0, Minor0 );
+	Det = _mm_add_ps( _mm_shuffle_ps( Det, Det, 0x4E ), Det );
+	Det = _mm_add_ss( _mm_shuffle_ps( Det, Det, 0xB1 ), Det );
+	ASSERT( abs(_mm_cvtss_f32( Det )) > 1e-6f, "Matrix is not inversible!" );
+
+	Det = _mm_div_ss( _mm_set_ss( 1.0f ), Det );	// Full precision division rather than _mm_rcp_ss()
+	Det = _mm_shuffle_ps( Det, Det, 0x00 );
+
+	float4x4	Result;
+	_mm_storeu_ps( &Result.m[4*0], _mm_mul_ps( Det, Minor0 ) );
+	_mm_storeu_ps( &Result.m[4*1], _mm_mul_ps( Det, Minor1 ) );
+	_mm_storeu_ps( &Result.m[4*2], _mm_mul_ps( Det, Minor2 ) );
+	_mm_storeu_ps( &Result.m[4*3], _mm_mul_ps( Det, Minor3 ) );
+
+	return Result;
+#else
 	float	Det = Determinant();
 	ASSERT( abs(Det) > 1e-6f, "Matrix is not inversible!" );
 
@@ -61,6 +182,7 @@ float4x4  float4x4::Inverse() const
 	Temp.m[4*3+3] = CoFactor( 3, 3 ) * Det;
 
 	return	Temp;
+#endif
 }
 
 float	   float4x4::Determinant() const
@@ -106,14 +228,84 @@ float4x4&	float4x4::Scale( const float3& _Scale )
 float4   operator*( const float4& a, const float4x4& b )
 {
 	float4	R;
+#ifdef NUAJ_MATH_SSE
+	SSEMatrix	M( b );
+	_mm_storeu_ps( &R.x, M.Transform( _mm_loadu_ps( &a.x ) ) );
+#else
 	R.x = a.x * b.m[4*0+0] + a.y * b.m[4*1+0] + a.z * b.m[4*2+0] + a.w * b.m[4*3+0];
 	R.y = a.x * b.m[4*0+1] + a.y * b.m[4*1+1] + a.z * b.m[4*2+1] + a.w * b.m[4*3+1];
 	R.z = a.x * b.m[4*0+2] + a.y * b.m[4*1+2] + a.z * b.m[4*2+2] + a.w * b.m[4*3+2];
 	R.w = a.x * b.m[4*0+3] + a.y * b.m[4*1+3] + a.z * b.m[4*2+3] + a.w * b.m[4*3+3];
+#endif
 
 	return R;
 }
 
+void	float4x4::Transform( const float4* _pSource, float4* _pTarget, U32 _Count ) const
+{
+#ifdef NUAJ_MATH_SSE
+	SSEMatrix	M( *this );
+	for ( U32 i=0; i < _Count; i++ )
+		_mm_storeu_ps( &_pTarget[i].x, M.Transform( _mm_loadu_ps( &_pSource[i].x ) ) );
+#else
+	for ( U32 i=0; i < _Count; i++ )
+		_pTarget[i] = _pSource[i] * *this;
+#endif
+}
+
+void	float4x4::TransformPoints( const float3* _pSource, float3* _pTarget, U32 _Count, U32 _SourceStride, U32 _TargetStride ) const
+{
+	const U8*	pSource = (const U8*) _pSource;
+	U8*			pTarget = (U8*) _pTarget;
+#ifdef NUAJ_MATH_SSE
+	SSEMatrix	M( *this );
+	for ( U32 i=0; i < _Count; i++, pSource+=_SourceStride, pTarget+=_TargetStride )
+		StoreFloat3( *((float3*) pTarget), M.TransformPoint( *((const float3*) pSource) ) );
+#else
+	for ( U32 i=0; i < _Count; i++, pSource+=_SourceStride, pTarget+=_TargetStride )
+		*((float3*) pTarget) = float4( *((const float3*) pSource), 1 ) * *this;
+#endif
+}
+
+void	float4x4::TransformVectors( const float3* _pSource, float3* _pTarget, U32 _Count, U32 _SourceStride, U32 _TargetStride ) const
+{
+	const U8*	pSource = (const U8*) _pSource;
+	U8*			pTarget = (U8*) _pTarget;
+#ifdef NUAJ_MATH_SSE
+	SSEMatrix	M( *this );
+	for ( U32 i=0; i < _Count; i++, pSource+=_SourceStride, pTarget+=_TargetStride )
+		StoreFloat3( *((float3*) pTarget), M.TransformVector( *((const float3*) pSource) ) );
+#else
+	for ( U32 i=0; i < _Count; i++, pSource+=_SourceStride, pTarget+=_TargetStride )
+		*((float3*) pTarget) = float4( *((const float3*) pSource), 0 ) * *this;
+#endif
+}
+
+void	float4x4::TransformBBox( const float3* _pSource, U32 _Count, float3& _BBoxMin, float3& _BBoxMax, U32 _SourceStride ) const
+{
+	const U8*	pSource = (const U8*) _pSource;
+#ifdef NUAJ_MATH_SSE
+	SSEMatrix	M( *this );
+	__m128		BBoxMin = _mm_setr_ps( _BBoxMin.x, _BBoxMin.y, _BBoxMin.z, 0.0f );
+	__m128		BBoxMax = _mm_setr_ps( _BBoxMax.x, _BBoxMax.y, _BBoxMax.z, 0.0f );
+	for ( U32 i=0; i < _Count; i++, pSource+=_SourceStride )
+	{
+		__m128	P = M.TransformPoint( *((const float3*) pSource) );
+		BBoxMin = _mm_min_ps( BBoxMin, P );
+		BBoxMax = _mm_max_ps( BBoxMax, P );
+	}
+	StoreFloat3( _BBoxMin, BBoxMin );
+	StoreFloat3( _BBoxMax, BBoxMax );
+#else
+	for ( U32 i=0; i < _Count; i++, pSource+=_SourceStride )
+	{
+		float3	P = float4( *((const float3*) pSource), 1 ) * *this;
+		_BBoxMin = _BBoxMin.Min( P );
+		_BBoxMax = _BBoxMax.Max( P );
+	}
+#endif
+}
+
 float4x4	float4x4::BuildFromQuat( const float4& _Quat )
 {
 	float4x4	Result;
@@ -341,10 +533,44 @@ half::operator float() const
 	return f32.f;
 }
 
+#ifdef NUAJ_MATH_F16C
+#include <immintrin.h>
+#endif
+
+void	half::Encode( const float* _pSource, half* _pTarget, int _Count )
+{
+	int	Index = 0;
+#ifdef NUAJ_MATH_F16C
+	for ( ; Index+4 <= _Count; Index+=4 )
+		_mm_storel_epi64( (__m128i*) &_pTarget[Index], _mm_cvtps_ph( _mm_loadu_ps( &_pSource[Index] ), _MM_FROUND_TO_NEAREST_INT ) );
+#endif
+	for ( ; Index < _Count; Index++ )
+		_pTarget[Index] = half( _pSource[Index] );
+}
+
+void	half::Decode( const half* _pSource, float* _pTarget, int _Count )
+{
+	int	Index = 0;
+#ifdef NUAJ_MATH_F16C
+	for ( ; Index+4 <= _Count; Index+=4 )
+		_mm_storeu_ps( &_pTarget[Index], _mm_cvtph_ps( _mm_loadl_epi64( (const __m128i*) &_pSource[Index] ) ) );
+#endif
+	for ( ; Index < _Count; Index++ )
+		_pTarget[Index] = _pSource[Index];
+}
+
 float4x4  float4x4::operator*( const float4x4& b ) const
 {
 	float4x4  R;
 
+#ifdef NUAJ_MATH_SSE
+	// Each row of the result is the transform of our row by b
+	SSEMatrix	B( b );
+	_mm_storeu_ps( &R.m[4*0], B.Transform( _mm_loadu_ps( &m[4*0] ) ) );
+	_mm_storeu_ps( &R.m[4*1], B.Transform( _mm_loadu_ps( &m[4*1] ) ) );
+	_mm_storeu_ps( &R.m[4*2], B.Transform( _mm_loadu_ps( &m[4*2] ) ) );
+	_mm_storeu_ps( &R.m[4*3], B.Transform( _mm_loadu_ps( &m[4*3] ) ) );
+#else
 	R.m[4*0+0] = m[4*0+0] * b.m[4*0+0] + m[4*0+1] * b.m[4*1+0] + m[4*0+2] * b.m[4*2+0] + m[4*0+3] * b.m[4*3+0];
 	R.m[4*0+1] = m[4*0+0] * b.m[4*0+1] + m[4*0+1] * b.m[4*1+1] + m[4*0+2] * b.m[4*2+1] + m[4*0+3] * b.m[4*3+1];
 	R.m[4*0+2] = m[4*0+0] * b.m[4*0+2] + m[4*0+1] * b.m[4*1+2] + m[4*0+2] * b.m[4*2+2] + m[4*0+3] * b.m[4*3+2];
@@ -364,6 +590,7 @@ float4x4  float4x4::operator*( const float4x4& b ) const
 	R.m[4*3+1] = m[4*3+0] * b.m[4*0+1] + m[4*3+1] * b.m[4*1+1] + m[4*3+2] * b.m[4*2+1] + m[4*3+3] * b.m[4*3+1];
 	R.m[4*3+2] = m[4*3+0] * b.m[4*0+2] + m[4*3+1] * b.m[4*1+2] + m[4*3+2] * b.m[4*2+2] + m[4*3+3] * b.m[4*3+2];
 	R.m[4*3+3] = m[4*3+0] * b.m[4*0+3] + m[4*3+1] * b.m[4*1+3] + m[4*3+2] * b.m[4*2+3] + m[4*3+3] * b.m[4*3+3];
+#endif
 
 	return R;
 }
@@ -7,6 +7,14 @@
 
 #include <math.h>
 
+#define NUAJ_MATH_SSE	// Define this to use the SSE implementation of matrix operations (comment to fall back to plain scalar code)
+
+#ifdef NUAJ_MATH_SSE
+#include <xmmintrin.h>
+#endif
+
+//#define NUAJ_MATH_F16C	// Define this to use the F16C instructions for batches of half floats (requires an Ivy Bridge CPU or later, cf. half::Encode())
+
 // Override some functions with our own implementations
 //#ifdef GODCOMPLEX
 #if 1
@@ -197,6 +205,7 @@ static float4   operator*( float a, const float4& b ) { return float4( a*b.x, a*
 
 
 // Float4x4 used for matrix operations
+// NOTE: The SSE implementation uses unaligned loads & stores so matrices can live anywhere (e.g. constant buffers, file data, etc.)
 class   float4x4
 {
 public:
@@ -214,6 +223,13 @@ public:
 
 	float4x4&			Scale( const float3& _Scale );
 
+	// Batch transforms
+	// The strides are the amount of bytes between 2 consecutive elements so positions can be read from (or written to) vertex buffers directly
+	void				Transform( const float4* _pSource, float4* _pTarget, U32 _Count ) const;
+	void				TransformPoints( const float3* _pSource, float3* _pTarget, U32 _Count, U32 _SourceStride=sizeof(float3), U32 _TargetStride=sizeof(float3) ) const;	// Transforms (x,y,z,1)
+	void				TransformVectors( const float3* _pSource, float3* _pTarget, U32 _Count, U32 _SourceStride=sizeof(float3), U32 _TargetStride=sizeof(float3) ) const;	// Transforms (x,y,z,0)
+	void				TransformBBox( const float3* _pSource, U32 _Count, float3& _BBoxMin, float3& _BBoxMax, U32 _SourceStride=sizeof(float3) ) const;	// Grows the bounding box with the transformed points
+
 //	NjFloat4			operator*( const NjFloat4& b ) const;
 	float4x4			operator*( const float4x4& b ) const;
 	float&				operator()( int _Row, int _Column );
@@ -250,6 +266,10 @@ public:
 	half()	{ raw=0; }
 	half( float value );
 	operator float() const;
+
+	// Converts arrays of floats, 4 at a time with NUAJ_MATH_F16C (F16C rounds to nearest & keeps denormals where the scalar version truncates)
+	static void	Encode( const float* _pSource, half* _pTarget, int _Count );
+	static void	Decode( const half* _pSource, float* _pTarget, int _Count );
 };
 
 class   half4
@@ -11,6 +11,9 @@ using namespace	FBXImporter;
 AnimationTrack::AnimationTrack( ObjectProperty^ _Owner, FbxAnimCurve* _pAnimCurve )
 	: m_Owner( _Owner )
 	, m_pAnimCurve( _pAnimCurve )
+	, m_Keys( nullptr )
+	, m_PendingFactor( 1.0f )
+	, m_PendingOffset( 0.0f )
 {
 	// Get the track's name
  	m_Name = Helpers::GetString( _pAnimCurve->GetName() );
@@ -19,17 +22,17 @@ AnimationTrack::AnimationTrack( ObjectProperty^ _Owner, FbxAnimCurve* _pAnimCurv
 	FbxTimeSpan	StartStop;
 	_pAnimCurve->GetTimeInterval( StartStop );
 	m_TimeSpan = Helpers::GetTimeSpan( StartStop );
+}
 
-
-	//////////////////////////////////////////////////////////////////////////
-	// Build the set of animation keys
+void	AnimationTrack::BuildKeys()
+{
 	List<AnimationKey^>^	Keys = gcnew List<AnimationKey^>();
 
 	AnimationKey^	Previous = nullptr;
-	int	KeysCount = _pAnimCurve->KeyGetCount();
+	int	KeysCount = m_pAnimCurve->KeyGetCount();
 	for ( int KeyIndex=0; KeyIndex < KeysCount; KeyIndex++ )
 	{
-		FbxAnimCurveKey&	SourceKey = _pAnimCurve->KeyGet( KeyIndex );
+		FbxAnimCurveKey&	SourceKey = m_pAnimCurve->KeyGet( KeyIndex );
 
 		AnimationKey^	K = gcnew AnimationKey();
 						K->Previous = Previous;
@@ -42,7 +45,7 @@ AnimationTrack::AnimationTrack( ObjectProperty^ _Owner, FbxAnimCurve* _pAnimCurv
 
 		// Build the key
 		K->Time = (float) SourceKey.GetTime().GetSecondDouble();
-		K->Value = float( SourceKey.GetValue() );
+		K->Value = m_PendingFactor * float( SourceKey.GetValue() ) + m_PendingOffset;
 
 		// Retrieve interpolation type
 		switch ( SourceKey.GetInterpolation() )
@@ -71,8 +74,8 @@ AnimationTrack::AnimationTrack( ObjectProperty^ _Owner, FbxAnimCurve* _pAnimCurv
 		FbxAnimCurveDef::EWeightedMode	TangentWeightMode = SourceKey.GetTangentWeightMode();
 		FbxAnimCurveDef::EVelocityMode	TangentVelocityMode = SourceKey.GetTangentVelocityMode();
 
-// 			KFCurveTangentInfo			LeftInfo = _pAnimCurve->KeyGetLeftDerivativeInfo( KeyIndex );
-// 			KFCurveTangentInfo			RightInfo = _pAnimCurve->KeyGetRightDerivativeInfo( KeyIndex );
+// 			KFCurveTangentInfo			LeftInfo = m_pAnimCurve->KeyGetLeftDerivativeInfo( KeyIndex );
+// 			KFCurveTangentInfo			RightInfo = m_pAnimCurve->KeyGetRightDerivativeInfo( KeyIndex );
  
 		switch ( TangentMode )
 		{
@@ -90,8 +93,8 @@ AnimationTrack::AnimationTrack( ObjectProperty^ _Owner, FbxAnimCurve* _pAnimCurv
 		case FbxAnimCurveDef::eTangentUser:			// Left slope = Right slope
 		case FbxAnimCurveDef::eTangentGenericBreak:	// Independent left & right slopes
 			K->CubicType = AnimationKey::CUBIC_INTERPOLATION_TYPE::CUSTOM;
-			K->RightSlope = SourceKey.GetDataFloat( FbxAnimCurveDef::eRightSlope );
-			K->NextLeftSlope = SourceKey.GetDataFloat( FbxAnimCurveDef::eNextLeftSlope );
+			K->RightSlope = m_PendingFactor * SourceKey.GetDataFloat( FbxAnimCurveDef::eRightSlope );
+			K->NextLeftSlope = m_PendingFactor * SourceKey.GetDataFloat( FbxAnimCurveDef::eNextLeftSlope );
 			K->RightWeight = SourceKey.GetDataFloat( FbxAnimCurveDef::eRightWeight );
 			K->NextLeftWeight = SourceKey.GetDataFloat( FbxAnimCurveDef::eNextLeftWeight );
 			K->RightWeight = SourceKey.GetDataFloat( FbxAnimCurveDef::eRightVelocity );
@@ -115,6 +118,12 @@ AnimationTrack::AnimationTrack( AnimationTrack^ _Source )
 	m_TimeSpan = _Source->m_TimeSpan;
 	m_pAnimCurve = _Source->m_pAnimCurve;
 
+	m_PendingFactor = _Source->m_PendingFactor;
+	m_PendingOffset = _Source->m_PendingOffset;
+	m_Keys = nullptr;
+	if ( _Source->m_Keys == nullptr )
+		return;	// Our keys will be read from the curve as well
+
 	m_Keys = gcnew cli::array<AnimationKey^>( _Source->m_Keys->Length );
 	for ( int KeyIndex=0; KeyIndex < m_Keys->Length; KeyIndex++ )
 	{
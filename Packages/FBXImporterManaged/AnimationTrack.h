@@ -17,8 +17,10 @@ namespace FBXImporter
 
 	//////////////////////////////////////////////////////////////////////////
 	// Represents a property attached to an object
+	// The keys are only read from the FBX curve on first access to Keys, so they are not built for tracks that are never used
+	// NOTE: The owner scene must not have been released before the keys are accessed!
 	//
-	[System::Diagnostics::DebuggerDisplayAttribute( "Name={Name} KeysCount={Keys.Length} ChildTracksCount={ChildTracks.Length} DefaultValue={m_Defaultvalue}" )]
+	[System::Diagnostics::DebuggerDisplayAttribute( "Name={Name} KeysCount={KeysCount} ChildTracksCount={ChildTracks.Length} DefaultValue={m_Defaultvalue}" )]
 	public ref class	AnimationTrack
 	{
 	public:		// NESTED TYPES
@@ -76,7 +78,11 @@ namespace FBXImporter
 		String^							m_Name;
 		FTimeSpan^					m_TimeSpan;
 
-		cli::array<AnimationKey^>^		m_Keys;
+		cli::array<AnimationKey^>^		m_Keys;			// Built on first access
+
+		// Factor & offset applied by ApplyFactor() and AddValue() before the keys were built
+		float							m_PendingFactor;
+		float							m_PendingOffset;
 
 
 	public:		// PROPERTIES
@@ -93,7 +99,17 @@ namespace FBXImporter
 
 		property cli::array<AnimationKey^>^	Keys
 		{
-			cli::array<AnimationKey^>^	get()	{ return m_Keys; }
+			cli::array<AnimationKey^>^	get()
+			{
+				if ( m_Keys == nullptr )
+					BuildKeys();
+				return m_Keys;
+			}
+		}
+
+		property int			KeysCount
+		{
+			int			get()	{ return m_Keys != nullptr ? m_Keys->Length : m_pAnimCurve->KeyGetCount(); }
 		}
 
 
@@ -108,6 +124,12 @@ namespace FBXImporter
 		//
 		void	AddValue( float _Value )
 		{
+			if ( m_Keys == nullptr )
+			{	// Apply it when the keys get built
+				m_PendingOffset += _Value;
+				return;
+			}
+
 			for ( int KeyIndex=0; KeyIndex < m_Keys->Length; KeyIndex++ )
 			{
 				AnimationKey^	Key = m_Keys[KeyIndex];
@@ -120,6 +142,13 @@ namespace FBXImporter
 		//
 		void	ApplyFactor( float _Factor )
 		{
+			if ( m_Keys == nullptr )
+			{	// Apply it when the keys get built
+				m_PendingFactor *= _Factor;
+				m_PendingOffset *= _Factor;
+				return;
+			}
+
 			for ( int KeyIndex=0; KeyIndex < m_Keys->Length; KeyIndex++ )
 			{
 				AnimationKey^	Key = m_Keys[KeyIndex];
@@ -129,5 +158,10 @@ namespace FBXImporter
 				Key->NextLeftSlope *= _Factor;
 			}
 		}
+
+	protected:
+
+		// Reads the keys from the FBX curve
+		void	BuildKeys();
 	};
 }
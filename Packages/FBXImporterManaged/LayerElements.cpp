@@ -13,6 +13,9 @@ void	LayerElement::BuildArray( FbxLayerElement* _pLayerElement )
 {
 	m_CachedArray = nullptr;
 
+	if ( m_Owner->Owner->ParentScene->m_pScene == NULL )
+		throw gcnew Exception( "Can't build layer element \"" + Name + "\" since its scene was released!" );
+
 	//////////////////////////////////////////////////////////////////////////
 	// Build the array first
 	int		ElementsCount = 0;
@@ -98,19 +101,20 @@ Object^		LayerElement::GetElementByTriangleVertex( int _TriangleIndex, int _Tria
 // 		throw gcnew Exception( "Mapping type \"BY_EDGE\" is not supported!" );
 // 	}
 
+	cli::array<Object^>^	Array = ToArray();
 	switch ( m_MappingMode )
 	{
 	case MAPPING_TYPE::BY_CONTROL_POINT:
-		return	m_CachedArray[m_Owner->Owner->GetControlPointIndex( _TriangleIndex, _TriangleVertexIndex )];
+		return	Array[m_Owner->Owner->GetControlPointIndex( _TriangleIndex, _TriangleVertexIndex )];
 
 	case MAPPING_TYPE::BY_TRIANGLE:
-		return	m_CachedArray[_TriangleIndex];
+		return	Array[_TriangleIndex];
 
 	case MAPPING_TYPE::BY_TRIANGLE_VERTEX:
-		return	m_CachedArray[3 * _TriangleIndex + _TriangleVertexIndex];
+		return	Array[3 * _TriangleIndex + _TriangleVertexIndex];
 
 	case MAPPING_TYPE::ALL_SAME:
-		return	m_CachedArray[0];
+		return	Array[0];
 
 	case MAPPING_TYPE::BY_EDGE:
 		throw gcnew Exception( "Mapping type \"BY_EDGE\" is not supported!" );
@@ -214,6 +218,92 @@ Object^	LayerElement::GetElementAt( FbxLayerElement* _pLayerElement, int _Index
 	return	Result;
 }
 
+// Copies a FBX layer element array into a managed array of _Target elements with a single memcpy
+//
+template<typename _Source, typename _Target> static cli::array<_Target>^	CopyLayerElementArray( FbxLayerElementArrayTemplate<_Source>& _Array )
+{
+	int	ElementsCount = _Array.GetCount();
+	cli::array<_Target>^	Result = gcnew cli::array<_Target>( ElementsCount * sizeof(_Source) / sizeof(_Target) );
+	if ( ElementsCount == 0 )
+		return	Result;
+
+	_Source*	pSource = _Array.GetLocked( FbxLayerElementArray::eReadLock );
+	if ( pSource == NULL )
+		throw gcnew Exception( "Failed to lock layer element array!" );
+
+	pin_ptr<_Target>	pTarget = &Result[0];
+	memcpy( pTarget, pSource, ElementsCount * sizeof(_Source) );
+
+	_Array.Release( &pSource );
+
+	return	Result;
+}
+
+int		LayerElement::ComponentsCount::get()
+{
+	switch ( m_ElementType )
+	{
+	case	ELEMENT_TYPE::NORMAL:
+	case	ELEMENT_TYPE::TANGENT:
+	case	ELEMENT_TYPE::BINORMAL:
+		return	sizeof(FbxVector4) / sizeof(double);
+	case	ELEMENT_TYPE::UV:
+		return	sizeof(FbxVector2) / sizeof(double);
+	case	ELEMENT_TYPE::VERTEX_COLOR:
+		return	sizeof(FbxColor) / sizeof(double);
+	}
+
+	return	0;
+}
+
+cli::array<double>^	LayerElement::CopyDirectArray()
+{
+	if ( m_pLayerElement == NULL )
+		return	nullptr;
+	if ( m_Owner->Owner->ParentScene->m_pScene == NULL )
+		throw gcnew Exception( "Can't copy layer element \"" + Name + "\" since its scene was released!" );
+
+	switch ( m_ElementType )
+	{
+	case	ELEMENT_TYPE::NORMAL:
+	case	ELEMENT_TYPE::TANGENT:
+	case	ELEMENT_TYPE::BINORMAL:
+		return	CopyLayerElementArray<FbxVector4,double>( static_cast<FbxLayerElementTemplate<FbxVector4>*>( m_pLayerElement )->GetDirectArray() );
+	case	ELEMENT_TYPE::UV:
+		return	CopyLayerElementArray<FbxVector2,double>( static_cast<FbxLayerElementTemplate<FbxVector2>*>( m_pLayerElement )->GetDirectArray() );
+	case	ELEMENT_TYPE::VERTEX_COLOR:
+		return	CopyLayerElementArray<FbxColor,double>( static_cast<FbxLayerElementTemplate<FbxColor>*>( m_pLayerElement )->GetDirectArray() );
+	}
+
+	return	nullptr;
+}
+
+cli::array<int>^	LayerElement::CopyIndexArray()
+{
+	if ( m_pLayerElement == NULL || ReferenceType == REFERENCE_TYPE::DIRECT )
+		return	nullptr;
+	if ( m_Owner->Owner->ParentScene->m_pScene == NULL )
+		throw gcnew Exception( "Can't copy layer element \"" + Name + "\" since its scene was released!" );
+
+	switch ( m_ElementType )
+	{
+	case	ELEMENT_TYPE::NORMAL:
+	case	ELEMENT_TYPE::TANGENT:
+	case	ELEMENT_TYPE::BINORMAL:
+		return	CopyLayerElementArray<int,int>( static_cast<FbxLayerElementTemplate<FbxVector4>*>( m_pLayerElement )->GetIndexArray() );
+	case	ELEMENT_TYPE::UV:
+		return	CopyLayerElementArray<int,int>( static_cast<FbxLayerElementTemplate<FbxVector2>*>( m_pLayerElement )->GetIndexArray() );
+	case	ELEMENT_TYPE::SMOOTHING:
+		return	CopyLayerElementArray<int,int>( static_cast<FbxLayerElementTemplate<int>*>( m_pLayerElement )->GetIndexArray() );
+	case	ELEMENT_TYPE::VERTEX_COLOR:
+		return	CopyLayerElementArray<int,int>( static_cast<FbxLayerElementTemplate<FbxColor>*>( m_pLayerElement )->GetIndexArray() );
+	case	ELEMENT_TYPE::MATERIAL:
+		return	CopyLayerElementArray<int,int>( static_cast<FbxLayerElementMaterial*>( m_pLayerElement )->GetIndexArray() );
+	}
+
+	return	nullptr;
+}
+
 bool	LayerElement::Compare( LayerElement^ _Other )
 {
 	if ( _Other == nullptr )
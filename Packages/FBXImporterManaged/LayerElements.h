@@ -20,6 +20,10 @@ namespace FBXImporter
 	//	that is mapped in a specific way to the owner mesh's polygons
 	// This is used to generically encode Positions, Normals, UV Sets, Vertex Colors and so on.
 	//
+	// The array of objects returned by ToArray() is only built on first call. Tools that don't need one object per element
+	//	can instead copy the raw FBX arrays in a single block with CopyDirectArray() and CopyIndexArray().
+	// NOTE: The owner scene must not have been released before the data are accessed!
+	//
 	[System::Diagnostics::DebuggerDisplayAttribute( "Name={Name} Type={ElementType} Mapping={MappingType} Index={Index}" )]
 	public ref class	LayerElement
 	{
@@ -106,6 +110,7 @@ namespace FBXImporter
 	protected:	// FIELDS
 
 		Layer^					m_Owner;
+		FbxLayerElement*		m_pLayerElement;	// NULL for custom layer elements
 
 		String^					m_Name;
 
@@ -115,7 +120,7 @@ namespace FBXImporter
 
 		int						m_Index;		// The semantic index of this layer element (e.g. UV Set #0 => Index=0, UV Set #1 => Index=1, etc.)
 
-		// Cached array conversion
+		// Cached array conversion (built on first access)
 		cli::array<Object^>^	m_CachedArray;
 
 
@@ -148,11 +153,17 @@ namespace FBXImporter
 		{
 			int				get()		{ return m_Index; }
 		}
+
+		// Gets the amount of doubles per element returned by CopyDirectArray() (0 if the element type doesn't support it)
+		property int			ComponentsCount
+		{
+			int				get();
+		}
 		
 
 	public:		// METHODS
 
-		LayerElement( Layer^ _Owner, FbxLayerElement* _pLayerElement, FbxLayerElement::EType _ElementType ) : m_Owner( _Owner ), m_CachedArray( nullptr )
+		LayerElement( Layer^ _Owner, FbxLayerElement* _pLayerElement, FbxLayerElement::EType _ElementType ) : m_Owner( _Owner ), m_pLayerElement( _pLayerElement ), m_CachedArray( nullptr )
 		{
 			m_Name = Helpers::GetString( _pLayerElement->GetName() );
 			m_ElementType = static_cast<ELEMENT_TYPE>( _ElementType );
@@ -166,13 +177,10 @@ namespace FBXImporter
 			if ( Match != nullptr && Match->Groups->Count == 2 )
 				if ( Int32::TryParse( Match->Groups[1]->Value, m_Index ) )
 					m_Index--;	// Index naming convention starts at one!
-
-			// Cache the layer element array
-			BuildArray( _pLayerElement );
 		}
 
 		// This constructor is used for custom creation of a layer element (i.e. procedural meshes)
-		LayerElement( String^ _Name, ELEMENT_TYPE _ElementType, MAPPING_TYPE _MappingMode, int _SemanticIndex ) : m_Owner( nullptr ), m_CachedArray( nullptr )
+		LayerElement( String^ _Name, ELEMENT_TYPE _ElementType, MAPPING_TYPE _MappingMode, int _SemanticIndex ) : m_Owner( nullptr ), m_pLayerElement( NULL ), m_CachedArray( nullptr )
 		{
 			m_Name = _Name;
 			m_ElementType = _ElementType;
@@ -207,7 +215,26 @@ namespace FBXImporter
 		//
 		// Note: any other type is not supported
 		//
-		cli::array<Object^>^		ToArray()	{ return m_CachedArray; }
+		cli::array<Object^>^		ToArray()
+		{
+			if ( m_CachedArray == nullptr && m_pLayerElement != NULL )
+				BuildArray( m_pLayerElement );
+			return m_CachedArray;
+		}
+
+		// Copies the FBX direct array in a single block, as ComponentsCount doubles per element:
+		//	_ 4 (X,Y,Z,W) for NORMAL, BINORMAL and TANGENT
+		//	_ 2 (U,V) for UV
+		//	_ 4 (R,G,B,A) for VERTEX_COLOR
+		// Returns nullptr for custom layer elements and any other element type
+		//
+		// NOTE: Unlike ToArray(), the data are not remapped to the triangles: the elements are addressed as given by the
+		//	MappingType, through the array returned by CopyIndexArray() if ReferenceType is not DIRECT.
+		//
+		cli::array<double>^			CopyDirectArray();
+
+		// Copies the FBX index array in a single block (returns nullptr if ReferenceType is DIRECT or for custom layer elements)
+		cli::array<int>^			CopyIndexArray();
 
 		// Compares 2 layers elements and returns true if they are equal
 		bool	Compare( LayerElement^ _Other );
@@ -8,8 +8,11 @@
 using namespace	FBXImporter;
 
 NodeMesh::NodeMesh( Scene^ _ParentScene, Node^ _Parent, FbxNode* _pNode ) : NodeWithAttribute( _ParentScene, _Parent, _pNode )
+	, m_pMesh( _pNode->GetMesh() )
+	, m_Layers( nullptr )
+	, m_Vertices( nullptr )
 {
-	FbxMesh*	pMesh = _pNode->GetMesh();
+	FbxMesh*	pMesh = m_pMesh;
 
 	pMesh->ComputeBBox();				// Compute the bounding box
 
@@ -20,7 +23,7 @@ NodeMesh::NodeMesh( Scene^ _ParentScene, Node^ _Parent, FbxNode* _pNode ) : Node
 // Doesn't work at all! Makes all faces with a SMG=0...
 //
 // 	// Convert Maya soft/hard edge info into smoothing group info
-// 	FbxGeometryConverter	GeoConv( _ParentScene->m_pTempSDKManager );
+// 	FbxGeometryConverter	GeoConv( _ParentScene->m_pSDKManager );
 // //	GeoConv.ComputeEdgeSmoothingFromNormals( pMesh );
 // 	GeoConv.ComputePolygonSmoothingFromEdgeSmoothing( pMesh );
 
@@ -36,12 +39,10 @@ NodeMesh::NodeMesh( Scene^ _ParentScene, Node^ _Parent, FbxNode* _pNode ) : Node
 // 
 //	pMesh->ComputeVertexNormals();	// Compute the vertex normals
 
-	FbxVector4*	pControlPoints = pMesh->GetControlPoints();
-	if ( pControlPoints == NULL )
+	if ( pMesh->GetControlPoints() == NULL )
 		throw gcnew Exception( "List of control points for mesh \"" + Name + "\" is not initialized!" );
 
-	int	VerticesCount = pMesh->GetControlPointsCount();
-	m_Vertices = gcnew cli::array<WMath::Point^>( VerticesCount );
+	m_VerticesCount = pMesh->GetControlPointsCount();	// The actual vertices are built by BuildVertices() on first access
 
 // 	switch ( m_ParentScene->UpAxis )
 // 	{
@@ -59,8 +60,6 @@ NodeMesh::NodeMesh( Scene^ _ParentScene, Node^ _Parent, FbxNode* _pNode ) : Node
 // 			m_Vertices[VertexIndex] = gcnew WMath::Point( (float) pControlPoints[VertexIndex][0], (float) pControlPoints[VertexIndex][2], -(float) pControlPoints[VertexIndex][1] );
 // 		break;
 // 	}
-	for ( int VertexIndex=0; VertexIndex < VerticesCount; VertexIndex++ )
-		m_Vertices[VertexIndex] = gcnew WMath::Point( (float) pControlPoints[VertexIndex][0], (float) pControlPoints[VertexIndex][1], (float) pControlPoints[VertexIndex][2] );
 
 
 	//////////////////////////////////////////////////////////////////////////
@@ -105,16 +104,6 @@ NodeMesh::NodeMesh( Scene^ _ParentScene, Node^ _Parent, FbxNode* _pNode ) : Node
 	m_PolygonVerticesCount = PolygonVertexOffset;
 
 
-	//////////////////////////////////////////////////////////////////////////
-	// Build layers referencing the vertices
-	m_Layers = gcnew List<Layer^>();
-	for ( int LayerIndex=0; LayerIndex < pMesh->GetLayerCount(); LayerIndex++ )
-	{
-		Layer^	L = gcnew Layer( this, pMesh->GetLayer( LayerIndex ) );
-		m_Layers->Add( L );
-	}
-
-
 	//////////////////////////////////////////////////////////////////////////
 	// Cache pivot
 	//
@@ -191,6 +180,47 @@ int	NodeMesh::GetControlPointIndex( int _TriangleIndex, int _TriangleVertexIndex
 	throw gcnew Exception( "Triangle vertex index out of range!" );
 }
 
+cli::array<double>^	NodeMesh::CopyControlPoints()
+{
+	if ( m_ParentScene->m_pScene == NULL )
+		throw gcnew Exception( "Can't read the control points of mesh \"" + Name + "\" since its scene was released!" );
+
+	cli::array<double>^	Result = gcnew cli::array<double>( 4 * m_VerticesCount );
+	if ( m_VerticesCount == 0 )
+		return	Result;
+
+	pin_ptr<double>	pTarget = &Result[0];
+	memcpy( pTarget, m_pMesh->GetControlPoints(), m_VerticesCount * sizeof(FbxVector4) );
+
+	return	Result;
+}
+
+void	NodeMesh::BuildVertices()
+{
+	if ( m_ParentScene->m_pScene == NULL )
+		throw gcnew Exception( "Can't build the vertices of mesh \"" + Name + "\" since its scene was released!" );
+
+	FbxVector4*	pControlPoints = m_pMesh->GetControlPoints();
+
+	m_Vertices = gcnew cli::array<WMath::Point^>( m_VerticesCount );
+	for ( int VertexIndex=0; VertexIndex < m_VerticesCount; VertexIndex++ )
+		m_Vertices[VertexIndex] = gcnew WMath::Point( (float) pControlPoints[VertexIndex][0], (float) pControlPoints[VertexIndex][1], (float) pControlPoints[VertexIndex][2] );
+}
+
+void	NodeMesh::BuildLayers()
+{
+	if ( m_ParentScene->m_pScene == NULL )
+		throw gcnew Exception( "Can't build the layers of mesh \"" + Name + "\" since its scene was released!" );
+
+	// Build layers referencing the vertices (their elements only convert their data when accessed)
+	m_Layers = gcnew List<Layer^>();
+	for ( int LayerIndex=0; LayerIndex < m_pMesh->GetLayerCount(); LayerIndex++ )
+	{
+		Layer^	L = gcnew Layer( this, m_pMesh->GetLayer( LayerIndex ) );
+		m_Layers->Add( L );
+	}
+}
+
 // int	NodeMesh::GetAbsolutePolygonVertexIndex( int _PolygonIndex, int _PolygonVertexIndex )
 // {
 // 	return	m_PolygonVertexOffsets[_PolygonIndex] + _PolygonVertexIndex;
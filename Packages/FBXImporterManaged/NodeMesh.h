@@ -15,6 +15,8 @@ namespace FBXImporter
 {
 	//////////////////////////////////////////////////////////////////////////
 	// A Mesh node
+	// The triangles are built on creation but the vertices and layers are only converted on first access
+	// NOTE: The parent scene must not have been released before they are accessed!
 	//
 	public ref class		NodeMesh : public NodeWithAttribute
 	{
@@ -65,14 +67,17 @@ namespace FBXImporter
 
 	protected:	// FIELDS
 
+		FbxMesh*					m_pMesh;
+
 		WMath::BoundingBox^			m_BBox;
 		int							m_PolygonsCount;
 		WMath::Matrix4x4^			m_Pivot;
 
-		List<Layer^>^				m_Layers;	// The list of layers
+		List<Layer^>^				m_Layers;	// The list of layers (built on first access)
 
 		cli::array<Triangle^>^		m_Triangles;
-		cli::array<WMath::Point^>^	m_Vertices;
+		int							m_VerticesCount;
+		cli::array<WMath::Point^>^	m_Vertices;	// Built on first access
 		cli::array<int>^			m_PolygonVertexOffsets;
 
 		int							m_PolygonVerticesCount;	// The total amount of polygon vertices
@@ -113,17 +118,27 @@ namespace FBXImporter
 
 		property cli::array<WMath::Point^>^	Vertices
 		{
-			cli::array<WMath::Point^>^	get()	{ return m_Vertices; }
+			cli::array<WMath::Point^>^	get()
+			{
+				if ( m_Vertices == nullptr )
+					BuildVertices();
+				return m_Vertices;
+			}
 		}
 
 		property int						VerticesCount
 		{
-			int							get()	{ return m_Vertices->Length; }
+			int							get()	{ return m_VerticesCount; }
 		}
 
 		property cli::array<Layer^>^		Layers
 		{
-			cli::array<Layer^>^			get()	{ return m_Layers->ToArray(); }
+			cli::array<Layer^>^			get()
+			{
+				if ( m_Layers == nullptr )
+					BuildLayers();
+				return m_Layers->ToArray();
+			}
 		}
 
 		property int						PolygonsCount
@@ -144,7 +159,15 @@ namespace FBXImporter
 		// Gets the index to a control point given the triangle and its internal index
 		int		GetControlPointIndex( int _TriangleIndex, int _TriangleVertexIndex );
 
+		// Copies the control points as 4 doubles (X,Y,Z,W) per vertex in a single block, without creating a Point per vertex
+		cli::array<double>^	CopyControlPoints();
+
 		// Gets the absolute index to a polygon vertex index given the polygon and its internal index
 //		int		GetAbsolutePolygonVertexIndex( int _PolygonIndex, int _PolygonVertexIndex );
+
+	protected:
+
+		void	BuildVertices();
+		void	BuildLayers();
 	};
 }
@@ -108,8 +108,9 @@ namespace FBXImporter
 
 
 	internal:
-		// Temporary, valid during "Load()"
-		FbxManager*			m_pTempSDKManager;
+		// Kept alive until the scene is disposed or reloaded so nodes, layer elements and animation tracks can read their data on access
+		FbxManager*			m_pSDKManager;
+		FbxScene*			m_pScene;
 
 
 	public:		// PROPERTIES
@@ -148,7 +149,8 @@ namespace FBXImporter
 	public:		// METHODS
 
 		Scene()
-			: m_pTempSDKManager( NULL )
+			: m_pSDKManager( NULL )
+			, m_pScene( NULL )
 		{
 			// Initialize lists
 			m_Takes = gcnew List<Take^>();
@@ -159,6 +161,12 @@ namespace FBXImporter
 
 		~Scene()
 		{
+			this->!Scene();
+		}
+
+		!Scene()
+		{
+			Release();
 		}
 
 		//////////////////////////////////////////////////////////////////////////
@@ -166,19 +174,22 @@ namespace FBXImporter
 		//
 		void		Load( System::String^ _FileName )
 		{
+			// Destroy any previously loaded scene
+			Release();
+
 			// The first thing to do is to create the FBX SDK manager which is the object allocator for almost all the classes in the SDK.
-			m_pTempSDKManager = FbxManager::Create();
-			if ( !m_pTempSDKManager )
+			m_pSDKManager = FbxManager::Create();
+			if ( !m_pSDKManager )
 				throw gcnew Exception( "Unable to create the FBX SDK manager!" );
 
 			// Create an IOSettings object
-			FbxIOSettings*	pIOSettings = FbxIOSettings::Create( m_pTempSDKManager, IOSROOT );
-			m_pTempSDKManager->SetIOSettings( pIOSettings );
+			FbxIOSettings*	pIOSettings = FbxIOSettings::Create( m_pSDKManager, IOSROOT );
+			m_pSDKManager->SetIOSettings( pIOSettings );
 
 			// Load plugins from the executable directory
 			FbxString lPath = FbxGetApplicationDirectory();
 			FbxString lExtension = "dll";
-			m_pTempSDKManager->LoadPluginsDirectory( lPath.Buffer(), lExtension.Buffer() );
+			m_pSDKManager->LoadPluginsDirectory( lPath.Buffer(), lExtension.Buffer() );
 
 
 			// Clear lists & pointers
@@ -196,10 +207,10 @@ namespace FBXImporter
 			FbxManager::GetFileFormatVersion( lSDKMajor, lSDKMinor, lSDKRevision );
 
 			// Create the entity that will hold the scene.
-			FbxScene*	pScene = FbxScene::Create( m_pTempSDKManager, "" );
+			FbxScene*	pScene = FbxScene::Create( m_pSDKManager, "" );
 
 			// Create an importer
-			FbxImporter*	pImporter = FbxImporter::Create( m_pTempSDKManager,"" );
+			FbxImporter*	pImporter = FbxImporter::Create( m_pSDKManager,"" );
 			try
 			{
 				// Initialize the importer by providing a filename.
@@ -255,7 +266,7 @@ namespace FBXImporter
 			}
 			catch ( Exception^ )
 			{
-				pScene->Destroy( true );
+				Release();
 				throw;
 			}
 			finally
@@ -266,23 +277,31 @@ namespace FBXImporter
 
 			try
 			{
+				m_pScene = pScene;
 				ProcessSceneData( pScene );
 			}
 			catch ( Exception^ _e )
 			{
+				Release();
 				throw gcnew Exception( "An error occurred while importing scene data!", _e );
 			}
-			finally
-			{
-				pScene->Destroy( true );
-			}
 
+			// NOTE: The FBX scene is NOT destroyed here: heavy data (vertices, layer element arrays, animation keys)
+			//	are only converted when first accessed and read directly from the FBX objects
+		}
+
+		// Destroys the FBX scene and SDK manager
+		// NOTE: The data of the nodes, layer elements and animation tracks that were not accessed yet is lost!
+		//
+		void			Release()
+		{
 			// Delete the FBX SDK manager. All the objects that have been allocated 
 			// using the FBX SDK manager and that haven't been explicitly destroyed 
 			// are automatically destroyed at the same time.
-			if ( m_pTempSDKManager )
-				m_pTempSDKManager->Destroy();
-			m_pTempSDKManager = NULL;
+			if ( m_pSDKManager )
+				m_pSDKManager->Destroy();
+			m_pSDKManager = NULL;
+			m_pScene = NULL;
 		}
 
 		// Finds a node by name
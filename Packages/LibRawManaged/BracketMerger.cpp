@@ -0,0 +1,99 @@
+// This is the main DLL file.
+
+#include "stdafx.h"
+
+#include "BracketMerger.h"
+
+namespace LibRawManaged {
+
+	BracketMerger::BracketMerger( RendererManaged::Device^ _Device, FileInfo^ _ShaderFileName )
+		: m_Device( _Device )
+		, m_SaturationThreshold( 0.95f )
+	{
+		RendererManaged::ShaderFile^	File = gcnew RendererManaged::ShaderFile( _ShaderFileName );
+		m_CS = gcnew RendererManaged::ComputeShader( _Device, File, "CS_Merge", nullptr );
+		delete File;
+
+		m_CB = gcnew RendererManaged::ConstantBuffer<CBMerge>( _Device, 0 );
+	}
+
+	BracketMerger::~BracketMerger()
+	{
+		delete m_CB;
+		delete m_CS;
+	}
+
+	RendererManaged::Texture2D^	BracketMerger::Merge( cli::array<String^>^ _FileNames )
+	{
+		cli::array<RawFile^>^	Brackets = RawFile::UnpackFiles( _FileNames, true, 0 );
+		try
+		{
+			return Merge( Brackets );
+		}
+		finally
+		{
+			for each ( RawFile^ Bracket in Brackets )
+				delete Bracket;
+		}
+	}
+
+	RendererManaged::Texture2D^	BracketMerger::Merge( cli::array<RawFile^>^ _Brackets )
+	{
+		if ( _Brackets == nullptr || _Brackets->Length == 0 || _Brackets->Length > MAX_BRACKETS )
+			throw gcnew Exception( "Expecting between 1 and " + MAX_BRACKETS + " brackets!" );
+
+		RawFile^	Reference = _Brackets[0];
+		int			W = Reference->Width;
+		int			H = Reference->Height;
+		cli::array<float>^	InvExposures = gcnew cli::array<float>( 4*4 );
+		float		MinExposure = Single::MaxValue;
+		for each ( RawFile^ Bracket in _Brackets )
+		{
+			if ( Bracket->Mosaic == nullptr )
+				throw gcnew Exception( "Brackets must be unpacked with UnpackMosaic()!" );
+			if ( Bracket->Width != W || Bracket->Height != H || Bracket->CFAPattern != Reference->CFAPattern )
+				throw gcnew Exception( "Brackets must have the same size and Bayer pattern!" );
+			MinExposure = Math::Min( MinExposure, Bracket->Exposure );
+		}
+		for ( int BracketIndex=0; BracketIndex < _Brackets->Length; BracketIndex++ )
+			InvExposures[BracketIndex] = MinExposure / _Brackets[BracketIndex]->Exposure;
+
+		// Upload the mosaics
+		RendererManaged::Texture2D^	Mosaics = gcnew RendererManaged::Texture2D( m_Device, W, H, _Brackets->Length, 1, RendererManaged::PIXEL_FORMAT::R16_UNORM, false, false, nullptr );
+		for ( int BracketIndex=0; BracketIndex < _Brackets->Length; BracketIndex++ )
+			Mosaics->Write( 0, BracketIndex, _Brackets[BracketIndex]->Mosaic );
+
+		RendererManaged::Texture2D^	Result = gcnew RendererManaged::Texture2D( m_Device, W, H, 1, 1, RendererManaged::PIXEL_FORMAT::RGBA32_FLOAT, false, true, nullptr );
+
+		// Merge
+		cli::array<float>^	M = Reference->CameraToRGB;
+		cli::array<float>^	WB = Reference->WhiteBalance;
+		m_CB->m.SizeX = W;
+		m_CB->m.SizeY = H;
+		m_CB->m.BracketsCount = _Brackets->Length;
+		m_CB->m.CFAPattern = Reference->CFAPattern;
+		m_CB->m.BlackLevel = Reference->BlackLevel / 65535.0f;
+		m_CB->m.WhiteLevel = Reference->Maximum / 65535.0f;
+		m_CB->m.SaturationThreshold = m_SaturationThreshold;
+		m_CB->m.WhiteBalance.Set( WB[0], WB[1], WB[2], 0.0f );
+		m_CB->m.CameraToRGB0.Set( M[0], M[1], M[2], 0.0f );
+		m_CB->m.CameraToRGB1.Set( M[3], M[4], M[5], 0.0f );
+		m_CB->m.CameraToRGB2.Set( M[6], M[7], M[8], 0.0f );
+		m_CB->m.InvExposures0.Set( InvExposures[0], InvExposures[1], InvExposures[2], InvExposures[3] );
+		m_CB->m.InvExposures1.Set( InvExposures[4], InvExposures[5], InvExposures[6], InvExposures[7] );
+		m_CB->m.InvExposures2.Set( InvExposures[8], InvExposures[9], InvExposures[10], InvExposures[11] );
+		m_CB->m.InvExposures3.Set( InvExposures[12], InvExposures[13], InvExposures[14], InvExposures[15] );
+		m_CB->UpdateData();
+
+		m_CS->Use();
+		Mosaics->SetCS( 0, gcnew RendererManaged::View2D( Mosaics, 0, 1, 0, _Brackets->Length, true ) );	// Always an array, even for a single bracket
+		Result->SetCSUAV( 0 );
+		m_CS->Dispatch( (W+15) >> 4, (H+15) >> 4, 1 );
+
+		Result->RemoveFromLastAssignedSlotUAV();
+		Mosaics->RemoveFromLastAssignedSlots();
+		delete Mosaics;
+
+		return Result;
+	}
+}
@@ -0,0 +1,70 @@
+// BracketMerger.h
+// Merges exposure brackets of RAW files into an RGBA32F HDR texture on the GPU.
+//
+// The files are only unpacked (cf. RawFile::UnpackMosaic()), the Bayer mosaics are uploaded as a texture array then
+//	a single compute pass demosaics them, merges the brackets weighted by how well each photosite is exposed and applies
+//	the camera's white balance and color matrix (cf. Shaders/MergeBrackets.hlsl).
+//
+// Usage:
+//	BracketMerger^	Merger = gcnew BracketMerger( Device, gcnew FileInfo( "Shaders/MergeBrackets.hlsl" ) );
+//	Texture2D^		HDR = Merger->Merge( BracketFileNames );	// A UAV texture, copy it to a staging texture to read it back
+//
+// NOTE: The color info (black & white levels, white balance and color matrix) of the first bracket are used for all the
+//	brackets, which must have been shot with the same camera. Radiances are relative to the shortest exposure.
+//
+#pragma once
+
+#include "LibRawManaged.h"
+
+using namespace System;
+using namespace System::IO;
+
+namespace LibRawManaged {
+
+	public ref class BracketMerger
+	{
+	public:		// CONSTANTS
+
+		static const int	MAX_BRACKETS = 16;
+
+	private:	// NESTED TYPES
+
+		[System::Runtime::InteropServices::StructLayout( System::Runtime::InteropServices::LayoutKind::Sequential )]
+		value struct	CBMerge
+		{
+			UInt32	SizeX, SizeY;
+			UInt32	BracketsCount;
+			UInt32	CFAPattern;
+			float	BlackLevel;
+			float	WhiteLevel;
+			float	SaturationThreshold;
+			float	Padding;
+			RendererManaged::float4	WhiteBalance;
+			RendererManaged::float4	CameraToRGB0, CameraToRGB1, CameraToRGB2;
+			RendererManaged::float4	InvExposures0, InvExposures1, InvExposures2, InvExposures3;
+		};
+
+	private:	// FIELDS
+
+		RendererManaged::Device^					m_Device;
+		RendererManaged::ComputeShader^				m_CS;
+		RendererManaged::ConstantBuffer<CBMerge>^	m_CB;
+		float										m_SaturationThreshold;
+
+	public:		// PROPERTIES
+
+		// The normalized value above which a photosite is considered clipped (defaults to 0.95)
+		property float	SaturationThreshold	{ float get() { return m_SaturationThreshold; } void set( float _Value ) { m_SaturationThreshold = _Value; } }
+
+	public:		// METHODS
+
+		BracketMerger( RendererManaged::Device^ _Device, FileInfo^ _ShaderFileName );
+		~BracketMerger();
+
+		// Unpacks the mosaics of the files concurrently then merges them
+		RendererManaged::Texture2D^	Merge( cli::array<String^>^ _FileNames );
+
+		// Merges brackets unpacked with RawFile::UnpackMosaic()
+		RendererManaged::Texture2D^	Merge( cli::array<RawFile^>^ _Brackets );
+	};
+}
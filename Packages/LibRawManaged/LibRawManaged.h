@@ -7,6 +7,8 @@
 #include "libraw.h"
 #pragma managed
 
+#include <vcclr.h>
+
 using namespace System;
 
 namespace LibRawManaged {
@@ -21,14 +23,40 @@ namespace LibRawManaged {
 			ADOBE_RGB
 		};
 
+	private:
+
+		// Decodes one file of a list
+		ref class	FilesDecoder
+		{
+		public:
+			cli::array<String^>^	m_FileNames;
+			bool					m_bMosaicOnly;
+			cli::array<RawFile^>^	m_Results;
+
+			void	Decode( int _FileIndex )
+			{
+				RawFile^	Result = gcnew RawFile();
+				Result->Unpack( m_FileNames[_FileIndex], m_bMosaicOnly );
+				m_Results[_FileIndex] = Result;
+			}
+		};
+
 	private:
 		::LibRaw*		m_pLibRaw;
 
 		// Decoded image data
 		int				m_Width;
 		int				m_Height;
+		cli::array<System::UInt16>^	m_Pixels;	// RGBA, Stride values per row
 		cli::array<cli::array<System::UInt16>^,2>^ 	m_Image;
 
+		// Undemosaiced sensor data
+		cli::array<System::UInt16>^	m_Mosaic;		// Width*Height raw values, 1 per photosite
+		int				m_CFAPattern;	// Color of each photosite of the 2x2 Bayer tile, 2 bits each (0=R, 1=G, 2=B)
+		float			m_BlackLevel;
+		cli::array<float>^	m_WhiteBalance;	// RGB multipliers of the camera, normalized so G=1
+		cli::array<float>^	m_CameraToRGB;	// 3x3 row-major matrix from camera to linear sRGB
+
 		// Shot info
 		float			m_ISOSpeed;
 		float			m_Aperture;
@@ -43,7 +71,24 @@ namespace LibRawManaged {
 
 		property int				Width	{ int get() { return m_Width; } }
 		property int				Height	{ int get() { return m_Height; } }
-		property cli::array<cli::array<System::UInt16>^,2>^ Image	{ cli::array<cli::array<System::UInt16>^,2>^ get() { return m_Image; } }
+
+		// The decoded RGBA pixels, stored contiguously with Stride values per row (i.e. pixel (X,Y) starts at Stride*Y+4*X)
+		property cli::array<System::UInt16>^	Pixels	{ cli::array<System::UInt16>^ get() { return m_Pixels; } }
+		property int				Stride	{ int get() { return 4 * m_Width; } }
+
+		// The pixels as a 2D array of RGBA arrays, built from Pixels the first time it's requested
+		// NOTE: This allocates a managed array per pixel, prefer Pixels or CopyTo()
+		property cli::array<cli::array<System::UInt16>^,2>^ Image	{ cli::array<cli::array<System::UInt16>^,2>^ get() { return GetImage(); } }
+
+		// The Bayer mosaic unpacked by UnpackMosaic(), the color of photosite (X,Y) is (CFAPattern >> (2*(2*(Y&1)+(X&1)))) & 3
+		property cli::array<System::UInt16>^	Mosaic	{ cli::array<System::UInt16>^ get() { return m_Mosaic; } }
+		property int				CFAPattern		{ int get() { return m_CFAPattern; } }
+		property float				BlackLevel		{ float get() { return m_BlackLevel; } }
+		property cli::array<float>^	WhiteBalance	{ cli::array<float>^ get() { return m_WhiteBalance; } }
+		property cli::array<float>^	CameraToRGB		{ cli::array<float>^ get() { return m_CameraToRGB; } }
+
+		// The amount of light the shot received compared to a 1s shot at f/1 and ISO 100
+		property float				Exposure		{ float get() { return m_ShutterSpeed * (m_ISOSpeed / 100.0f) / Math::Max( 1e-3f, m_Aperture * m_Aperture ); } }
 
 		property float				ISOSpeed		{ float get() { return m_ISOSpeed; } }
 		property float				Aperture		{ float get() { return m_Aperture; } }
@@ -57,6 +102,7 @@ namespace LibRawManaged {
 		RawFile()
 		{
 			m_pLibRaw = new ::LibRaw();
+			m_Pixels = nullptr;
 			m_Image = nullptr;
 			m_ColorProfile = COLOR_PROFILE::sRGB;
 		}
@@ -66,24 +112,131 @@ namespace LibRawManaged {
 			delete m_pLibRaw;
 		}
 
+		// Decodes a RAW file from a stream, read in chunks into a native buffer
 		void	UnpackRAW( System::IO::Stream^ _Stream )
 		{
 			if ( _Stream == nullptr )
 				throw gcnew System::Exception( "Invalid image stream!" );
 
-			// Read the file's content into a managed stream
-			int	FileLength = (int) _Stream->Length;
-			cli::array<System::Byte>^	ManagedFileContent = gcnew cli::array<System::Byte>( FileLength );
-			_Stream->Read( ManagedFileContent, 0, FileLength );
-
-			// Allocate memory to store the stream's content in an unmanaged buffer
+			int		FileLength = (int) _Stream->Length;
 			byte*	pBuffer = new byte[FileLength];
-			System::Runtime::InteropServices::Marshal::Copy( ManagedFileContent, 0, System::IntPtr( pBuffer ), FileLength );
+			try
+			{
+				cli::array<System::Byte>^	Chunk = gcnew cli::array<System::Byte>( Math::Min( FileLength, 1 << 16 ) );
+				int	Offset = 0;
+				while ( Offset < FileLength )
+				{
+					int	ReadLength = _Stream->Read( Chunk, 0, Math::Min( Chunk->Length, FileLength - Offset ) );
+					if ( ReadLength <= 0 )
+						throw gcnew Exception( "Unexpected end of RAW stream" );
+					System::Runtime::InteropServices::Marshal::Copy( Chunk, 0, System::IntPtr( pBuffer + Offset ), ReadLength );
+					Offset += ReadLength;
+				}
+
+				// Open from memory
+				if ( m_pLibRaw->open_buffer( pBuffer, FileLength ) != LIBRAW_SUCCESS )
+					throw gcnew Exception( "Failed loading RAW file from memory" );
+
+				Decode();
+			}
+			finally
+			{
+				m_pLibRaw->recycle();	// Get ready for the next image
+				delete[] pBuffer;
+			}
+		}
+
+		// Decodes a RAW file mapped in memory
+		void	UnpackRAW( String^ _FileName )	{ Unpack( _FileName, false ); }
+
+		// Only unpacks the sensor's Bayer mosaic of a file mapped in memory, without demosaicing nor color conversion
+		// Fills Mosaic and the color info needed to process it (e.g. on the GPU with a BracketMerger)
+		void	UnpackMosaic( String^ _FileName )	{ Unpack( _FileName, true ); }
+
+		// Copies the decoded pixels into native memory (e.g. a mapped staging texture), _RowPitch is in bytes
+		void	CopyTo( System::IntPtr _pTarget, int _RowPitch )
+		{
+			if ( m_Pixels == nullptr )
+				throw gcnew Exception( "No image was decoded!" );
+
+			int		RowSize = Stride * sizeof(System::UInt16);
+			if ( _RowPitch < RowSize )
+				throw gcnew Exception( "Target row pitch is too small!" );
+
+			pin_ptr<System::UInt16>	pSource = &m_Pixels[0];
+			byte*	pTarget = (byte*) _pTarget.ToPointer();
+			for ( int Y=0; Y < m_Height; Y++ )
+				memcpy( pTarget + _RowPitch * Y, (byte*) pSource + RowSize * Y, RowSize );
+		}
+
+		// Decodes (or only unpacks the mosaics of) RAW files concurrently, the results are in the order of the files
+		// _MaxConcurrency <= 0 uses all the processors
+		static cli::array<RawFile^>^	UnpackFiles( cli::array<String^>^ _FileNames, bool _bMosaicOnly, int _MaxConcurrency )
+		{
+			FilesDecoder^	Decoder = gcnew FilesDecoder();
+			Decoder->m_FileNames = _FileNames;
+			Decoder->m_bMosaicOnly = _bMosaicOnly;
+			Decoder->m_Results = gcnew cli::array<RawFile^>( _FileNames->Length );
+
+			System::Threading::Tasks::ParallelOptions^	Options = gcnew System::Threading::Tasks::ParallelOptions();
+			Options->MaxDegreeOfParallelism = _MaxConcurrency > 0 ? _MaxConcurrency : Environment::ProcessorCount;
+			System::Threading::Tasks::Parallel::For( 0, _FileNames->Length, Options, gcnew Action<int>( Decoder, &FilesDecoder::Decode ) );
+
+			return Decoder->m_Results;
+		}
+
+		// Decodes all the RAW files of a directory concurrently, the results are in the order of the directory's files
+		static cli::array<RawFile^>^	UnpackDirectory( System::IO::DirectoryInfo^ _Directory, String^ _SearchPattern, int _MaxConcurrency )
+		{
+			cli::array<System::IO::FileInfo^>^	Files = _Directory->GetFiles( _SearchPattern );
+			cli::array<String^>^	FileNames = gcnew cli::array<String^>( Files->Length );
+			for ( int FileIndex=0; FileIndex < Files->Length; FileIndex++ )
+				FileNames[FileIndex] = Files[FileIndex]->FullName;
+
+			return UnpackFiles( FileNames, false, _MaxConcurrency );
+		}
+
+	private:
+
+		// Opens a file mapped in memory then decodes it
+		void	Unpack( String^ _FileName, bool _bMosaicOnly )
+		{
+			pin_ptr<const wchar_t>	wpFileName = PtrToStringChars( _FileName );
+			HANDLE	hFile = ::CreateFileW( wpFileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+			if ( hFile == INVALID_HANDLE_VALUE )
+				throw gcnew System::IO::FileNotFoundException( "Failed opening RAW file", _FileName );
+
+			::LibRaw_windows_datastream*	pStream = NULL;
+			try
+			{
+				try
+				{
+					pStream = new ::LibRaw_windows_datastream( hFile );
+				}
+				catch ( std::exception& )
+				{
+					throw gcnew Exception( "Failed mapping RAW file \"" + _FileName + "\"" );
+				}
+
+				if ( m_pLibRaw->open_datastream( pStream ) != LIBRAW_SUCCESS )
+					throw gcnew Exception( "Failed loading RAW file \"" + _FileName + "\"" );
 
-			// Open from memory
-			if ( m_pLibRaw->open_buffer( pBuffer, FileLength ) != LIBRAW_SUCCESS )
-				throw gcnew Exception( "Failed loading RAW file from memory" );
+				if ( _bMosaicOnly )
+					DecodeMosaic();
+				else
+					Decode();
+			}
+			finally
+			{
+				m_pLibRaw->recycle();	// Get ready for the next image
+				delete pStream;
+				::CloseHandle( hFile );	// The mapping keeps the file open until the stream is deleted anyway
+			}
+		}
 
+		// Processes the opened file and copies the result into our pixels
+		void	Decode()
+		{
 			// Let us unpack the image
 			if ( m_pLibRaw->unpack() != LIBRAW_SUCCESS )
 				throw gcnew Exception( "Failed unpacking RAW file" );
@@ -101,7 +254,73 @@ namespace LibRawManaged {
 				throw gcnew Exception( "Failed processing image" );
 			
 
-			// Retrieve shot info
+			ReadShotInfo();
+
+
+			// Copy the RGBA image as is (reusing our pixels if the size didn't change)
+			m_Width = m_pLibRaw->imgdata.sizes.iwidth;
+			m_Height = m_pLibRaw->imgdata.sizes.iheight;
+			m_Image = nullptr;
+
+			int	ValuesCount = 4 * m_Width * m_Height;
+			if ( m_Pixels == nullptr || m_Pixels->Length != ValuesCount )
+				m_Pixels = gcnew cli::array<System::UInt16>( ValuesCount );
+
+			pin_ptr<System::UInt16>	pTarget = &m_Pixels[0];
+			memcpy( pTarget, m_pLibRaw->imgdata.image, ValuesCount * sizeof(System::UInt16) );
+		}
+
+		// Copies the visible part of the unpacked mosaic and its color info
+		void	DecodeMosaic()
+		{
+			if ( m_pLibRaw->unpack() != LIBRAW_SUCCESS )
+				throw gcnew Exception( "Failed unpacking RAW file" );
+
+			const libraw_rawdata_t&	RawData = m_pLibRaw->imgdata.rawdata;
+			if ( RawData.raw_image == NULL || RawData.iparams.filters == 0 || RawData.iparams.filters == 9 )
+				throw gcnew Exception( "Only Bayer sensors are supported!" );	// Neither Foveon nor X-Trans
+
+			ReadShotInfo();
+
+			m_Width = RawData.sizes.width;
+			m_Height = RawData.sizes.height;
+			m_Image = nullptr;
+
+			int	ValuesCount = m_Width * m_Height;
+			if ( m_Mosaic == nullptr || m_Mosaic->Length != ValuesCount )
+				m_Mosaic = gcnew cli::array<System::UInt16>( ValuesCount );
+
+			pin_ptr<System::UInt16>	pTarget = &m_Mosaic[0];
+			const byte*	pSource = (const byte*) (RawData.raw_image + RawData.sizes.left_margin) + RawData.sizes.top_margin * RawData.sizes.raw_pitch;
+			for ( int Y=0; Y < m_Height; Y++ )
+				memcpy( pTarget + m_Width * Y, pSource + RawData.sizes.raw_pitch * Y, m_Width * sizeof(System::UInt16) );
+
+			// The pattern of the visible area (the second green is reported as color 3)
+			m_CFAPattern = 0;
+			for ( int Y=0; Y < 2; Y++ )
+				for ( int X=0; X < 2; X++ )
+				{
+					int	Color = m_pLibRaw->COLOR( Y, X );
+					m_CFAPattern |= (Color == 3 ? 1 : Color) << (2*(2*Y+X));
+				}
+
+			const libraw_colordata_t&	Color = RawData.color;
+			m_BlackLevel = Color.black + 0.25f * (Color.cblack[0] + Color.cblack[1] + Color.cblack[2] + Color.cblack[3]);
+			m_MaximumWhite = Color.maximum;
+
+			float	Green = Color.cam_mul[1] > 0.0f ? Color.cam_mul[1] : 1.0f;
+			m_WhiteBalance = gcnew cli::array<float>( 3 );
+			for ( int i=0; i < 3; i++ )
+				m_WhiteBalance[i] = Color.cam_mul[i] > 0.0f ? Color.cam_mul[i] / Green : 1.0f;	// Some cameras don't report a white balance
+
+			m_CameraToRGB = gcnew cli::array<float>( 9 );
+			for ( int Row=0; Row < 3; Row++ )
+				for ( int Column=0; Column < 3; Column++ )
+					m_CameraToRGB[3*Row+Column] = Color.rgb_cam[Row][Column];
+		}
+
+		void	ReadShotInfo()
+		{
 			m_ISOSpeed = m_pLibRaw->imgdata.other.iso_speed;
 			m_Aperture = m_pLibRaw->imgdata.other.aperture;
 			m_ShutterSpeed = m_pLibRaw->imgdata.other.shutter;
@@ -110,14 +329,14 @@ namespace LibRawManaged {
 			// Retrieve color info
 			// TODO: retrieve profile
 			m_MaximumWhite = m_pLibRaw->imgdata.color.maximum;
+		}
 
-
-			// Write this as a readable RGB array
-			m_Width = m_pLibRaw->imgdata.sizes.iwidth;
-			m_Height = m_pLibRaw->imgdata.sizes.iheight;
+		cli::array<cli::array<System::UInt16>^,2>^	GetImage()
+		{
+			if ( m_Image != nullptr || m_Pixels == nullptr )
+				return m_Image;
 
 			m_Image = gcnew cli::array<cli::array<System::UInt16>^,2>( m_Width, m_Height );
-
 			for ( int Y=0; Y < m_Height; Y++ )
 			{
 				for ( int X=0; X < m_Width; X++ )
@@ -125,15 +344,14 @@ namespace LibRawManaged {
 					cli::array<System::UInt16>^	Pixel = gcnew cli::array<System::UInt16>( 4 );
 					m_Image[X,Y] = Pixel;
 
-					Pixel[0] = m_pLibRaw->imgdata.image[m_Width*Y+X][0];
-					Pixel[1] = m_pLibRaw->imgdata.image[m_Width*Y+X][1];
-					Pixel[2] = m_pLibRaw->imgdata.image[m_Width*Y+X][2];
-					Pixel[3] = m_pLibRaw->imgdata.image[m_Width*Y+X][3];
+					int	Offset = Stride*Y+4*X;
+					Pixel[0] = m_Pixels[Offset+0];
+					Pixel[1] = m_Pixels[Offset+1];
+					Pixel[2] = m_Pixels[Offset+2];
+					Pixel[3] = m_Pixels[Offset+3];
 				}
 			}
-
-			// Get ready for the next image
-			m_pLibRaw->recycle();
+			return m_Image;
 		}
 	};
 }
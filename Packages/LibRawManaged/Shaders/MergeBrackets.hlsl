@@ -0,0 +1,95 @@
+//////////////////////////////////////////////////////////////////////////
+// Merges exposure brackets of RAW Bayer mosaics into an HDR image (cf. BracketMerger.h)
+//
+//	_ CS_Merge, demosaics each bracket (bilinear, over the 3x3 neighborhood of the photosite), weighs the brackets so
+//		well exposed photosites are favored and saturated ones rejected, then white balances and converts the merged
+//		camera radiance to linear sRGB.
+//		Radiances are relative to the shortest exposure (i.e. a photosite at the white level in that bracket is 1).
+//
+#define MAX_BRACKETS	16
+
+cbuffer	cbMerge : register( b0 )
+{
+	uint2	_Size;
+	uint	_BracketsCount;
+	uint	_CFAPattern;			// Color of each photosite of the 2x2 Bayer tile, 2 bits each (0=R, 1=G, 2=B)
+	float	_BlackLevel;			// Normalized
+	float	_WhiteLevel;			// Normalized
+	float	_SaturationThreshold;	// Photosites above this value are considered clipped
+	float	_Padding;
+	float4	_WhiteBalance;
+	float4	_CameraToRGB[3];
+	float4	_InvExposures[MAX_BRACKETS/4];	// Shortest exposure / exposure of each bracket
+};
+
+Texture2DArray<float>	_TexMosaics : register( t0 );	// 1 slice per bracket
+RWTexture2D<float4>		_Out : register( u0 );
+
+uint	CFAColor( int2 _Position )
+{
+	return (_CFAPattern >> (2 * (2 * (_Position.y & 1) + (_Position.x & 1)))) & 3;
+}
+
+// Returns the normalized camera RGB in XYZ and the largest photosite value of the neighborhood in W
+float4	Demosaic( int2 _Position, uint _BracketIndex )
+{
+	float3	Sum = 0.0;
+	float3	Count = 0.0;
+	float	MaxValue = 0.0;
+	for ( int Y=-1; Y <= 1; Y++ )
+		for ( int X=-1; X <= 1; X++ )
+		{
+			// Mirror by 2 photosites on the borders to keep the Bayer pattern
+			int2	P = _Position + int2( X, Y );
+			P = P < 0 ? P + 2 : P;
+			P = P >= int2( _Size ) ? P - 2 : P;
+
+			float	Value = saturate( (_TexMosaics[uint3( P, _BracketIndex )] - _BlackLevel) / (_WhiteLevel - _BlackLevel) );
+			uint	Color = CFAColor( P );
+			float3	Mask = float3( Color == 0, Color == 1, Color == 2 );
+			Sum += Mask * Value;
+			Count += Mask;
+			MaxValue = max( MaxValue, Value );
+		}
+
+	return float4( Sum / max( 1.0, Count ), MaxValue );
+}
+
+// Favors mid-tones and rejects saturated photosites
+float	Weight( float _Value )
+{
+	return _Value >= _SaturationThreshold ? 0.0 : 1e-3 + 1.0 - pow( abs( 2.0 * _Value - 1.0 ), 12.0 );
+}
+
+[numthreads( 16, 16, 1 )]
+void	CS_Merge( uint3 _ThreadID : SV_DispatchThreadID )
+{
+	if ( any( _ThreadID.xy >= _Size ) )
+		return;
+
+	float3	SumRadiance = 0.0;
+	float	SumWeights = 0.0;
+	float3	Fallback = 0.0;			// The shortest exposure, used when every bracket is saturated
+	float	MaxInvExposure = 0.0;
+	for ( uint BracketIndex=0; BracketIndex < _BracketsCount; BracketIndex++ )
+	{
+		float4	Camera = Demosaic( _ThreadID.xy, BracketIndex );
+		float	InvExposure = _InvExposures[BracketIndex >> 2][BracketIndex & 3];
+		float3	Radiance = InvExposure * Camera.xyz;
+
+		float	W = Weight( Camera.w );
+		SumRadiance += W * Radiance;
+		SumWeights += W;
+
+		if ( InvExposure > MaxInvExposure )
+		{
+			MaxInvExposure = InvExposure;
+			Fallback = Radiance;
+		}
+	}
+
+	float3	CameraRGB = _WhiteBalance.xyz * (SumWeights > 0.0 ? SumRadiance / SumWeights : Fallback);
+	float3	RGB = float3( dot( _CameraToRGB[0].xyz, CameraRGB ), dot( _CameraToRGB[1].xyz, CameraRGB ), dot( _CameraToRGB[2].xyz, CameraRGB ) );
+
+	_Out[_ThreadID.xy] = float4( max( 0.0, RGB ), 1.0 );
+}
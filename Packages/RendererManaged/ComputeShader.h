@@ -11,41 +11,23 @@ namespace RendererManaged {
 
 	public ref class ComputeShader
 	{
-	private:
+	internal:
 
-		::ComputeShader*	m_pShader;
+		::ComputeShader*		m_pShader;
+		NativeShaderArguments*	m_pArguments;	// Must outlive the native shader
 
 	public:
 
 		ComputeShader( Device^ _Device, ShaderFile^ _ShaderFile, String^ _EntryPoint, cli::array<ShaderMacro^>^ _Macros )
 		{
-			const char*	ShaderFileName = (const char*) System::Runtime::InteropServices::Marshal::StringToHGlobalAnsi( _ShaderFile->m_ShaderFileName->FullName ).ToPointer();
-			const char*	ShaderCode = (const char*) System::Runtime::InteropServices::Marshal::StringToHGlobalAnsi( _ShaderFile->m_ShaderSourceCode ).ToPointer();
-			const char*	EntryPoint = (const char*) System::Runtime::InteropServices::Marshal::StringToHGlobalAnsi( _EntryPoint ).ToPointer();
-
-			D3D_SHADER_MACRO*	pMacros = NULL;
-			if ( _Macros != nullptr )
-			{
-				int i=0;
-				pMacros = new D3D_SHADER_MACRO[_Macros->Length + 1];
-				for ( ; i < _Macros->Length; i++ )
-				{
-					pMacros[i].Name = (const char*) System::Runtime::InteropServices::Marshal::StringToHGlobalAnsi( _Macros[i]->Name ).ToPointer();
-					pMacros[i].Definition = (const char*) System::Runtime::InteropServices::Marshal::StringToHGlobalAnsi( _Macros[i]->Value ).ToPointer();
-
-				}
-				pMacros[i].Name = NULL;
-				pMacros[i].Definition = NULL;
-			}
-
-			m_pShader = new ::ComputeShader( *_Device->m_pDevice, ShaderFileName, ShaderCode, pMacros, EntryPoint, NULL );
-
-			delete[] pMacros;
+			m_pArguments = CreateArguments( _ShaderFile->m_ShaderFileName, _EntryPoint, _Macros );
+			m_pShader = CreateNative( _Device, _ShaderFile, m_pArguments, false );
 		}
 
 		~ComputeShader()
 		{
 			delete m_pShader;
+			delete m_pArguments;
 		}
 
 		bool	Use()
@@ -60,18 +42,31 @@ namespace RendererManaged {
 
 		static ComputeShader^	CreateFromBinaryBlob( Device^ _Device, FileInfo^ _ShaderFileName, String^ _EntryPoint )
 		{
-			const char*	ShaderFileName = (const char*) System::Runtime::InteropServices::Marshal::StringToHGlobalAnsi( _ShaderFileName->FullName ).ToPointer();
-			const char*	EntryPoint = (const char*) System::Runtime::InteropServices::Marshal::StringToHGlobalAnsi( _EntryPoint ).ToPointer();
+			NativeShaderArguments*	pArguments = CreateArguments( _ShaderFileName, _EntryPoint, nullptr );
+			::ComputeShader*	pShader = ::ComputeShader::CreateFromBinaryBlob( *_Device->m_pDevice, pArguments->FileName.Get(), NULL, pArguments->EntryPoint( NativeShaderArguments::CS ) );
 
-			::ComputeShader*	pShader = ::ComputeShader::CreateFromBinaryBlob( *_Device->m_pDevice, ShaderFileName, NULL, EntryPoint );
+			return gcnew ComputeShader( pShader, pArguments );
+		}
+
+	internal:
+
+		ComputeShader( ::ComputeShader* _pShader, NativeShaderArguments* _pArguments )
+		{
+			m_pShader = _pShader;
+			m_pArguments = _pArguments;
+		}
 
-			return gcnew ComputeShader( _Device, pShader );
+		static NativeShaderArguments*	CreateArguments( FileInfo^ _ShaderFileName, String^ _EntryPoint, cli::array<ShaderMacro^>^ _Macros )
+		{
+			NativeShaderArguments*	pArguments = new NativeShaderArguments( _ShaderFileName, _Macros );
+			pArguments->pEntryPoints[NativeShaderArguments::CS].Set( _EntryPoint );
+			return pArguments;
 		}
 
-	private:
-		ComputeShader( Device^ _Device, ::ComputeShader* _ComputeShader )
+		// Creates the native shader from the file's cached source code (compiling later with Compile() if deferred)
+		static ::ComputeShader*	CreateNative( Device^ _Device, ShaderFile^ _ShaderFile, NativeShaderArguments* _pArguments, bool _bDeferCompilation )
 		{
-			m_pShader = _ComputeShader;
+			return new ::ComputeShader( *_Device->m_pDevice, _pArguments->FileName.Get(), _ShaderFile->NativeSourceCode(), _pArguments->pMacros, _pArguments->EntryPoint( NativeShaderArguments::CS ), NULL, _bDeferCompilation );
 		}
 	};
 }
@@ -64,6 +64,8 @@ namespace RendererManaged {
 			Texture2D^	get() { return m_DefaultDepthStencil; }
 		}
 
+		void*	GetWrappedDevice()	{ return m_pDevice; }
+
 		Device()
 		{
 			m_pDevice = new ::Device();
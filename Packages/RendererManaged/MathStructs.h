@@ -518,4 +518,15 @@ namespace RendererManaged
 			return f32.f;
 		}
 	};
+
+	[System::Diagnostics::DebuggerDisplayAttribute( "{x.value}, {y.value}, {z.value}, {w.value}" )]
+	public value struct	half4
+	{
+	public:
+		half	x, y, z, w;
+		half4( float _x, float _y, float _z, float _w ) : x( _x ), y( _y ), z( _z ), w( _w ) {}
+		half4( float4 _value ) : x( _value.x ), y( _value.y ), z( _value.z ), w( _value.w ) {}
+
+		property float4	value	{ float4 get() { return float4( x, y, z, w ); } }
+	};
 }
@@ -13,6 +13,18 @@ using namespace System::IO;
 
 namespace RendererManaged {
 
+	// The pixels of a mapped sub-resource, accessed in place (valid until the texture is unmapped)
+	public value struct	MappedPixels
+	{
+	public:
+		System::IntPtr	Data;
+		int				RowPitch;
+		int				DepthPitch;
+
+	internal:
+		MappedPixels( D3D11_MAPPED_SUBRESOURCE& _SubResource ) : Data( _SubResource.pData ), RowPitch( _SubResource.RowPitch ), DepthPitch( _SubResource.DepthPitch ) {}
+	};
+
 	public ref class PixelsBuffer : public ByteBuffer
 	{
 	internal:
@@ -14,45 +14,21 @@ namespace RendererManaged {
 	{
 	internal:
 
-		::Shader*	m_pShader;
+		::Shader*				m_pShader;
+		NativeShaderArguments*	m_pArguments;	// Must outlive the native shader
 
 	public:
 
 		Shader( Device^ _Device, ShaderFile^ _ShaderFile, VERTEX_FORMAT _Format, String^ _EntryPointVS, String^ _EntryPointGS, String^ _EntryPointPS, cli::array<ShaderMacro^>^ _Macros )
 		{
-			const char*	ShaderFileName = (const char*) System::Runtime::InteropServices::Marshal::StringToHGlobalAnsi( _ShaderFile->m_ShaderFileName->FullName ).ToPointer();
-			const char*	ShaderCode = (const char*) System::Runtime::InteropServices::Marshal::StringToHGlobalAnsi( _ShaderFile->m_ShaderSourceCode ).ToPointer();
-			const char*	EntryPointVS = (const char*) System::Runtime::InteropServices::Marshal::StringToHGlobalAnsi( _EntryPointVS ).ToPointer();
-			const char*	EntryPointHS = NULL;	//TODO?
-			const char*	EntryPointDS = NULL;	//TODO?
-			const char*	EntryPointGS = (const char*) System::Runtime::InteropServices::Marshal::StringToHGlobalAnsi( _EntryPointGS ).ToPointer();
-			const char*	EntryPointPS = (const char*) System::Runtime::InteropServices::Marshal::StringToHGlobalAnsi( _EntryPointPS ).ToPointer();
-
-			D3D_SHADER_MACRO*	pMacros = NULL;
-			if ( _Macros != nullptr )
-			{
-				int i=0;
-				pMacros = new D3D_SHADER_MACRO[_Macros->Length + 1];
-				for ( ; i < _Macros->Length; i++ )
-				{
-					pMacros[i].Name = (const char*) System::Runtime::InteropServices::Marshal::StringToHGlobalAnsi( _Macros[i]->Name ).ToPointer();
-					pMacros[i].Definition = (const char*) System::Runtime::InteropServices::Marshal::StringToHGlobalAnsi( _Macros[i]->Value ).ToPointer();
-
-				}
-				pMacros[i].Name = NULL;
-				pMacros[i].Definition = NULL;
-			}
-
-			IVertexFormatDescriptor*	pDescriptor = GetDescriptor( _Format );
-
-			m_pShader = new ::Shader( *_Device->m_pDevice, ShaderFileName, *pDescriptor, ShaderCode, pMacros, EntryPointVS, EntryPointHS, EntryPointDS, EntryPointGS, EntryPointPS, NULL );
-
-			delete[] pMacros;
+			m_pArguments = CreateArguments( _ShaderFile->m_ShaderFileName, _EntryPointVS, _EntryPointGS, _EntryPointPS, _Macros );
+			m_pShader = CreateNative( _Device, _ShaderFile, _Format, m_pArguments, false );
 		}
 
 		~Shader()
 		{
 			delete m_pShader;
+			delete m_pArguments;
 		}
 
 		bool	Use()
@@ -62,13 +38,6 @@ namespace RendererManaged {
 
 		static Shader^	CreateFromBinaryBlob( Device^ _Device, FileInfo^ _ShaderFileName, VERTEX_FORMAT _Format, String^ _EntryPointVS, String^ _EntryPointGS, String^ _EntryPointPS )
 		{
-			const char*	ShaderFileName = (const char*) System::Runtime::InteropServices::Marshal::StringToHGlobalAnsi( _ShaderFileName->FullName ).ToPointer();
-			const char*	EntryPointVS = (const char*) System::Runtime::InteropServices::Marshal::StringToHGlobalAnsi( _EntryPointVS ).ToPointer();
-			const char*	EntryPointHS = NULL;	//TODO?
-			const char*	EntryPointDS = NULL;	//TODO?
-			const char*	EntryPointGS = (const char*) System::Runtime::InteropServices::Marshal::StringToHGlobalAnsi( _EntryPointGS ).ToPointer();
-			const char*	EntryPointPS = (const char*) System::Runtime::InteropServices::Marshal::StringToHGlobalAnsi( _EntryPointPS ).ToPointer();
-
 			IVertexFormatDescriptor*	pDescriptor = NULL;
 			switch ( _Format )
 			{
@@ -77,15 +46,46 @@ namespace RendererManaged {
 			if ( pDescriptor == NULL )
 				throw gcnew Exception( "Unsupported vertex format!" );
 
-			::Shader*	pShader = ::Shader::CreateFromBinaryBlob( *_Device->m_pDevice, ShaderFileName, *pDescriptor, NULL, EntryPointVS, EntryPointHS, EntryPointDS, EntryPointGS, EntryPointPS );
+			NativeShaderArguments*	pArguments = CreateArguments( _ShaderFileName, _EntryPointVS, _EntryPointGS, _EntryPointPS, nullptr );
+			::Shader*	pShader = ::Shader::CreateFromBinaryBlob( *_Device->m_pDevice, pArguments->FileName.Get(), *pDescriptor, NULL,
+				pArguments->EntryPoint( NativeShaderArguments::VS ),
+				pArguments->EntryPoint( NativeShaderArguments::HS ),
+				pArguments->EntryPoint( NativeShaderArguments::DS ),
+				pArguments->EntryPoint( NativeShaderArguments::GS ),
+				pArguments->EntryPoint( NativeShaderArguments::PS ) );
 
-			return gcnew Shader( _Device, pShader );
+			return gcnew Shader( pShader, pArguments );
 		}
 
-	private:
-		Shader( Device^ _Device, ::Shader* _pShader )
+	internal:
+
+		Shader( ::Shader* _pShader, NativeShaderArguments* _pArguments )
 		{
 			m_pShader = _pShader;
+			m_pArguments = _pArguments;
+		}
+
+		static NativeShaderArguments*	CreateArguments( FileInfo^ _ShaderFileName, String^ _EntryPointVS, String^ _EntryPointGS, String^ _EntryPointPS, cli::array<ShaderMacro^>^ _Macros )
+		{
+			NativeShaderArguments*	pArguments = new NativeShaderArguments( _ShaderFileName, _Macros );
+			pArguments->pEntryPoints[NativeShaderArguments::VS].Set( _EntryPointVS );
+			pArguments->pEntryPoints[NativeShaderArguments::GS].Set( _EntryPointGS );
+			pArguments->pEntryPoints[NativeShaderArguments::PS].Set( _EntryPointPS );
+			return pArguments;	// No hull & domain shaders yet
+		}
+
+		// Creates the native shader from the file's cached source code (compiling later with Compile() if deferred)
+		static ::Shader*	CreateNative( Device^ _Device, ShaderFile^ _ShaderFile, VERTEX_FORMAT _Format, NativeShaderArguments* _pArguments, bool _bDeferCompilation )
+		{
+			IVertexFormatDescriptor*	pDescriptor = GetDescriptor( _Format );
+
+			return new ::Shader( *_Device->m_pDevice, _pArguments->FileName.Get(), *pDescriptor, _ShaderFile->NativeSourceCode(), _pArguments->pMacros,
+				_pArguments->EntryPoint( NativeShaderArguments::VS ),
+				_pArguments->EntryPoint( NativeShaderArguments::HS ),
+				_pArguments->EntryPoint( NativeShaderArguments::DS ),
+				_pArguments->EntryPoint( NativeShaderArguments::GS ),
+				_pArguments->EntryPoint( NativeShaderArguments::PS ),
+				NULL, _bDeferCompilation );
 		}
 	};
 }
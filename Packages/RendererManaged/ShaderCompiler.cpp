@@ -0,0 +1,79 @@
+// This is the main DLL file.
+
+#include "stdafx.h"
+
+#include "ShaderCompiler.h"
+
+using namespace RendererManaged;
+
+ShaderCompiler::ShaderCompiler( Device^ _Device )
+	: m_Device( _Device )
+{
+	m_ShaderFiles = gcnew Dictionary<String^, ShaderFile^>();
+}
+
+ShaderCompiler::~ShaderCompiler()
+{
+	for each ( ShaderFile^ File in m_ShaderFiles->Values )
+		delete File;
+	m_ShaderFiles->Clear();
+}
+
+ShaderFile^	ShaderCompiler::GetShaderFile( FileInfo^ _ShaderFileName )
+{
+	ShaderFile^	Result = nullptr;
+	if ( !m_ShaderFiles->TryGetValue( _ShaderFileName->FullName, Result ) )
+	{
+		Result = gcnew ShaderFile( _ShaderFileName );
+		m_ShaderFiles->Add( _ShaderFileName->FullName, Result );
+	}
+	return Result;
+}
+
+void	ShaderCompiler::Invalidate( FileInfo^ _ShaderFileName )
+{
+	m_ShaderFiles->Remove( _ShaderFileName->FullName );	// Pending compilations still hold the file, it's disposed by the GC
+}
+
+Shader^	ShaderCompiler::Compile( FileInfo^ _ShaderFileName, VERTEX_FORMAT _Format, String^ _EntryPointVS, String^ _EntryPointGS, String^ _EntryPointPS, cli::array<ShaderMacro^>^ _Macros )
+{
+	return gcnew Shader( m_Device, GetShaderFile( _ShaderFileName ), _Format, _EntryPointVS, _EntryPointGS, _EntryPointPS, _Macros );
+}
+
+ComputeShader^	ShaderCompiler::CompileCompute( FileInfo^ _ShaderFileName, String^ _EntryPoint, cli::array<ShaderMacro^>^ _Macros )
+{
+	return gcnew ComputeShader( m_Device, GetShaderFile( _ShaderFileName ), _EntryPoint, _Macros );
+}
+
+Task<Shader^>^	ShaderCompiler::CompileAsync( FileInfo^ _ShaderFileName, VERTEX_FORMAT _Format, String^ _EntryPointVS, String^ _EntryPointGS, String^ _EntryPointPS, cli::array<ShaderMacro^>^ _Macros )
+{
+	CompilationJob^	Job = gcnew CompilationJob( GetShaderFile( _ShaderFileName ) );
+
+	// Create the deferred native shader on this thread
+	NativeShaderArguments*	pArguments = Shader::CreateArguments( _ShaderFileName, _EntryPointVS, _EntryPointGS, _EntryPointPS, _Macros );
+	Job->m_Shader = gcnew Shader( Shader::CreateNative( m_Device, Job->m_ShaderFile, _Format, pArguments, true ), pArguments );
+
+	return Task<Shader^>::Factory->StartNew( gcnew Func<Shader^>( Job, &CompilationJob::CompileShader ) );
+}
+
+Task<ComputeShader^>^	ShaderCompiler::CompileComputeAsync( FileInfo^ _ShaderFileName, String^ _EntryPoint, cli::array<ShaderMacro^>^ _Macros )
+{
+	CompilationJob^	Job = gcnew CompilationJob( GetShaderFile( _ShaderFileName ) );
+
+	NativeShaderArguments*	pArguments = ComputeShader::CreateArguments( _ShaderFileName, _EntryPoint, _Macros );
+	Job->m_ComputeShader = gcnew ComputeShader( ComputeShader::CreateNative( m_Device, Job->m_ShaderFile, pArguments, true ), pArguments );
+
+	return Task<ComputeShader^>::Factory->StartNew( gcnew Func<ComputeShader^>( Job, &CompilationJob::CompileComputeShader ) );
+}
+
+Shader^	ShaderCompiler::CompilationJob::CompileShader()
+{
+	m_Shader->m_pShader->Compile( m_ShaderFile->NativeSourceCode() );
+	return m_Shader;
+}
+
+ComputeShader^	ShaderCompiler::CompilationJob::CompileComputeShader()
+{
+	m_ComputeShader->m_pShader->Compile( m_ShaderFile->NativeSourceCode() );
+	return m_ComputeShader;
+}
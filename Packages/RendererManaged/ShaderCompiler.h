@@ -0,0 +1,70 @@
+// RendererManaged.h
+// Compiles shaders from files whose source code is loaded and marshaled once, either immediately or on the thread pool.
+// The compiled stages are stored in the native persistent shader cache (cf. Shader::ms_Cache) so a shader compiled once
+//	by the tools or the intro is never recompiled until its source code or macros change.
+//
+// Usage:
+//	ShaderCompiler^	Compiler = gcnew ShaderCompiler( Device );
+//	Task<Shader^>^	Pending = Compiler->CompileAsync( gcnew FileInfo( "Shaders/Test.hlsl" ), VERTEX_FORMAT::Pt4, "VS", nullptr, "PS", nullptr );
+//	... (do something else)
+//	Shader^	S = Pending->Result;
+//
+// NOTE: The native shader is registered with the device on the calling thread (the device's components list is not
+//	thread-safe) and only the compilation runs on the thread pool, so the device must not be destroyed while tasks are pending.
+//
+#pragma once
+#include "Device.h"
+#include "ShaderMacros.h"
+#include "ShaderFile.h"
+#include "Shader.h"
+#include "ComputeShader.h"
+
+using namespace System;
+using namespace System::IO;
+using namespace System::Collections::Generic;
+using namespace System::Threading::Tasks;
+
+namespace RendererManaged {
+
+	public ref class ShaderCompiler
+	{
+	private:
+
+		Device^								m_Device;
+		Dictionary<String^, ShaderFile^>^	m_ShaderFiles;	// The files already loaded & marshaled, indexed by full path
+
+	public:
+
+		ShaderCompiler( Device^ _Device );
+		~ShaderCompiler();
+
+		// Returns the cached file, loading it the first time it's requested
+		ShaderFile^		GetShaderFile( FileInfo^ _ShaderFileName );
+
+		// Forgets a file so it's reloaded from disk the next time a shader is compiled from it
+		void			Invalidate( FileInfo^ _ShaderFileName );
+
+		Shader^			Compile( FileInfo^ _ShaderFileName, VERTEX_FORMAT _Format, String^ _EntryPointVS, String^ _EntryPointGS, String^ _EntryPointPS, cli::array<ShaderMacro^>^ _Macros );
+		ComputeShader^	CompileCompute( FileInfo^ _ShaderFileName, String^ _EntryPoint, cli::array<ShaderMacro^>^ _Macros );
+
+		// Same as above but the compilation runs on a thread pool task
+		Task<Shader^>^			CompileAsync( FileInfo^ _ShaderFileName, VERTEX_FORMAT _Format, String^ _EntryPointVS, String^ _EntryPointGS, String^ _EntryPointPS, cli::array<ShaderMacro^>^ _Macros );
+		Task<ComputeShader^>^	CompileComputeAsync( FileInfo^ _ShaderFileName, String^ _EntryPoint, cli::array<ShaderMacro^>^ _Macros );
+
+	private:
+
+		// The work item of an asynchronous compilation, holds the file so its native source code lives until the shader is compiled
+		ref class	CompilationJob
+		{
+		public:
+			ShaderFile^				m_ShaderFile;
+			Shader^					m_Shader;
+			ComputeShader^			m_ComputeShader;
+
+			CompilationJob( ShaderFile^ _ShaderFile ) : m_ShaderFile( _ShaderFile ) {}
+
+			Shader^			CompileShader();
+			ComputeShader^	CompileComputeShader();
+		};
+	};
+}
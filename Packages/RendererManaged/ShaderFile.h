@@ -2,12 +2,81 @@
 
 #pragma once
 #include "Device.h"
+#include "ShaderMacros.h"
 
 using namespace System;
 using namespace System::IO;
 
 namespace RendererManaged {
 
+	// A native ANSI copy of a managed string, freed with the object
+	class	AnsiString
+	{
+		char*	m_pString;
+
+	public:
+		AnsiString() : m_pString( NULL ) {}
+		AnsiString( String^ _Value ) : m_pString( NULL )	{ Set( _Value ); }
+		~AnsiString()										{ Set( nullptr ); }
+
+		void	Set( String^ _Value )
+		{
+			if ( m_pString != NULL )
+				System::Runtime::InteropServices::Marshal::FreeHGlobal( IntPtr( m_pString ) );
+			m_pString = _Value != nullptr ? (char*) System::Runtime::InteropServices::Marshal::StringToHGlobalAnsi( _Value ).ToPointer() : NULL;
+		}
+
+		const char*	Get() const	{ return m_pString; }
+
+	private:
+		AnsiString( const AnsiString& );
+		AnsiString&	operator=( const AnsiString& );
+	};
+
+	// The arguments a native shader is created with
+	// The native shader keeps pointers to its entry points and macros to recompile itself, so they must live as long as the shader
+	class	NativeShaderArguments
+	{
+	public:
+		enum	ENTRY_POINT
+		{
+			VS, HS, DS, GS, PS,
+			ENTRY_POINTS_COUNT,
+			CS = 0,
+		};
+
+		AnsiString			FileName;
+		AnsiString			pEntryPoints[ENTRY_POINTS_COUNT];
+		AnsiString*			pMacroStrings;		// Name & value of each macro
+		D3D_SHADER_MACRO*	pMacros;			// NULL-terminated, NULL if there are no macros
+
+	public:
+		NativeShaderArguments( FileInfo^ _FileName, cli::array<ShaderMacro^>^ _Macros ) : FileName( _FileName->FullName ), pMacroStrings( NULL ), pMacros( NULL )
+		{
+			if ( _Macros == nullptr )
+				return;
+
+			pMacroStrings = new AnsiString[2*_Macros->Length];
+			pMacros = new D3D_SHADER_MACRO[_Macros->Length + 1];
+			for ( int i=0; i < _Macros->Length; i++ )
+			{
+				pMacroStrings[2*i+0].Set( _Macros[i]->Name );
+				pMacroStrings[2*i+1].Set( _Macros[i]->Value );
+				pMacros[i].Name = pMacroStrings[2*i+0].Get();
+				pMacros[i].Definition = pMacroStrings[2*i+1].Get();
+			}
+			pMacros[_Macros->Length].Name = NULL;
+			pMacros[_Macros->Length].Definition = NULL;
+		}
+		~NativeShaderArguments()
+		{
+			delete[] pMacros;
+			delete[] pMacroStrings;
+		}
+
+		const char*	EntryPoint( ENTRY_POINT _EntryPoint ) const	{ return pEntryPoints[_EntryPoint].Get(); }
+	};
+
 	public ref class ShaderFile
 	{
 	public:
@@ -15,6 +84,10 @@ namespace RendererManaged {
 		FileInfo^	m_ShaderFileName;
 		String^		m_ShaderSourceCode;
 
+	internal:
+
+		AnsiString*	m_pNativeSourceCode;	// Marshaled once for all the shaders compiled from this file
+
 	public:
 
 		ShaderFile( FileInfo^ _ShaderFileName )
@@ -27,6 +100,26 @@ namespace RendererManaged {
 			StreamReader^	R = _ShaderFileName->OpenText();
 			m_ShaderSourceCode = R->ReadToEnd();
 			delete R;
+
+			m_pNativeSourceCode = new AnsiString( m_ShaderSourceCode );
+		}
+		~ShaderFile()
+		{
+			this->!ShaderFile();
+		}
+		!ShaderFile()
+		{
+			delete m_pNativeSourceCode;
+			m_pNativeSourceCode = NULL;
+		}
+
+	internal:
+
+		const char*	NativeSourceCode()
+		{
+			if ( m_pNativeSourceCode == NULL )
+				throw gcnew ObjectDisposedException( "ShaderFile" );
+			return m_pNativeSourceCode->Get();
 		}
 	};
 
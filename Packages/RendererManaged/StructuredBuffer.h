@@ -1,9 +1,25 @@
 // RendererManaged.h
-
+// Read()/Write() without arrays transfer the "m" array, the overloads taking an array transfer a range of elements with any
+//	array of T, pinned during the copy, so thousands of records cost a single managed/native transition.
+// T must be a blittable value type whose layout matches the HLSL structure (cf. [StructLayout( LayoutKind::Sequential )]), this
+//	is checked when the buffer is created.
+//
+// Usage:
+//	StructuredBuffer<Probe>^	Probes = gcnew StructuredBuffer<Probe>( Device, 4096, true );
+//	Probes->Write( MyProbes, 0, 0, MyProbes->Length );		// Uploads the whole array at once
+//	Task<cli::array<Probe>^>^	Pending = Probes->ReadAsync( 4096 );
+//	... (render a few frames, calling Probes->ResolvePendingReads() every frame)
+//	cli::array<Probe>^	Result = Pending->Result;
+//
+// NOTE: ReadAsync() doesn't stall the GPU, its task completes once ResolvePendingReads() finds the copy was executed.
+//	Both must be called from the thread that owns the device (the device is not thread-safe).
+//
 #pragma once
 #include "Device.h"
 
 using namespace System;
+using namespace System::Collections::Generic;
+using namespace System::Threading::Tasks;
 
 namespace RendererManaged {
 
@@ -11,7 +27,19 @@ namespace RendererManaged {
 	{
 	private:
 
+		// An asynchronous read queued on the native readback ring
+		ref class	PendingRead
+		{
+		public:
+			int									m_Ticket;
+			int									m_ElementsCount;
+			TaskCompletionSource<cli::array<T>^>^	m_Completion;
+
+			PendingRead( int _Ticket, int _ElementsCount ) : m_Ticket( _Ticket ), m_ElementsCount( _ElementsCount ), m_Completion( gcnew TaskCompletionSource<cli::array<T>^>() ) {}
+		};
+
 		::StructuredBuffer*	m_pStructuredBuffer;
+		List<PendingRead^>^	m_PendingReads;
 
 	public:
 		cli::array<T>^		m;
@@ -25,13 +53,17 @@ namespace RendererManaged {
 
 		~StructuredBuffer()
 		{
+			for each ( PendingRead^ Pending in m_PendingReads )
+				Pending->m_Completion->TrySetCanceled();
 			delete m_pStructuredBuffer;
 		}
 
 		void	Init(  Device^ _Device, int _ElementsCount, bool _Writeable )
 		{
+			int	ElementSize = ValidateElementType();
 			m = gcnew array<T>( _ElementsCount );
-			m_pStructuredBuffer = new ::StructuredBuffer( *_Device->m_pDevice, System::Runtime::InteropServices::Marshal::SizeOf( T::typeid ), _ElementsCount, _Writeable );
+			m_PendingReads = gcnew List<PendingRead^>();
+			m_pStructuredBuffer = new ::StructuredBuffer( *_Device->m_pDevice, ElementSize, _ElementsCount, _Writeable );
 		}
 
 		void	Read() { Read( -1 ); }
@@ -46,6 +78,71 @@ namespace RendererManaged {
 			cli::pin_ptr<T>	Bisou = &m[0];
 			m_pStructuredBuffer->Write( Bisou, _ElementsCount );
 		}
+
+		// Copies _ElementsCount elements of the buffer starting at _FirstElement into the array starting at _ArrayOffset
+		void	Read( cli::array<T>^ _Elements )	{ Read( _Elements, 0, 0, _Elements->Length ); }
+		void	Read( cli::array<T>^ _Elements, int _ArrayOffset, int _FirstElement, int _ElementsCount )
+		{
+			CheckRange( _Elements, _ArrayOffset, _FirstElement, _ElementsCount );
+			if ( _ElementsCount == 0 )
+				return;
+
+			cli::pin_ptr<T>	pElements = &_Elements[_ArrayOffset];
+			m_pStructuredBuffer->ReadRange( pElements, _FirstElement, _ElementsCount );
+		}
+
+		// Uploads _ElementsCount elements of the array starting at _ArrayOffset into the buffer starting at _FirstElement
+		void	Write( cli::array<T>^ _Elements )	{ Write( _Elements, 0, 0, _Elements->Length ); }
+		void	Write( cli::array<T>^ _Elements, int _ArrayOffset, int _FirstElement, int _ElementsCount )
+		{
+			CheckRange( _Elements, _ArrayOffset, _FirstElement, _ElementsCount );
+			if ( _ElementsCount == 0 )
+				return;
+
+			cli::pin_ptr<T>	pElements = &_Elements[_ArrayOffset];
+			m_pStructuredBuffer->WriteRange( pElements, _FirstElement, _ElementsCount );
+		}
+
+		// Queues a copy of the first _ElementsCount elements, the task completes with a new array once the GPU executed it (cf. ResolvePendingReads())
+		Task<cli::array<T>^>^	ReadAsync( int _ElementsCount )
+		{
+			if ( _ElementsCount <= 0 || _ElementsCount > m->Length )
+				throw gcnew ArgumentOutOfRangeException( "_ElementsCount" );
+
+			int	Ticket = m_pStructuredBuffer->ReadAsync( _ElementsCount );
+			if ( Ticket < 0 )
+				throw gcnew Exception( "Too many asynchronous reads in flight! Call ResolvePendingReads() until some complete." );
+
+			PendingRead^	Pending = gcnew PendingRead( Ticket, _ElementsCount );
+			m_PendingReads->Add( Pending );
+			return Pending->m_Completion->Task;
+		}
+
+		// Completes the tasks of the asynchronous reads whose copy was executed, returns the amount of reads still pending
+		int		ResolvePendingReads()
+		{
+			for ( int ReadIndex=0; ReadIndex < m_PendingReads->Count; )
+			{
+				PendingRead^	Pending = m_PendingReads[ReadIndex];
+				cli::array<T>^	Result = gcnew array<T>( Pending->m_ElementsCount );
+				bool			bResolved;
+				{
+					cli::pin_ptr<T>	pResult = &Result[0];
+					bResolved = m_pStructuredBuffer->TryResolve( Pending->m_Ticket, pResult );
+				}
+				if ( !bResolved )
+				{
+					ReadIndex++;
+					continue;
+				}
+
+				m_PendingReads->RemoveAt( ReadIndex );
+				Pending->m_Completion->SetResult( Result );
+			}
+
+			return m_PendingReads->Count;
+		}
+
 		void	Clear( float4 _Value )
 		{
 			::float4	value( _Value.x, _Value.y, _Value.z, _Value.w );
@@ -57,5 +154,40 @@ namespace RendererManaged {
 		}
 		void	SetOutput( int _SlotIndex )		{ m_pStructuredBuffer->SetOutput( _SlotIndex ); }
  		void	RemoveFromLastAssignedSlots()	{ m_pStructuredBuffer->RemoveFromLastAssignedSlots(); }
+
+	private:
+
+		// Makes sure the elements can be copied as is to the GPU and returns their size
+		static int	ValidateElementType()
+		{
+			if ( !T::typeid->IsValueType )
+				throw gcnew Exception( "The elements of a structured buffer must be value types!" );
+
+			try
+			{	// Only arrays of blittable types can be pinned
+				System::Runtime::InteropServices::GCHandle	Handle = System::Runtime::InteropServices::GCHandle::Alloc( gcnew array<T>( 1 ), System::Runtime::InteropServices::GCHandleType::Pinned );
+				Handle.Free();
+			}
+			catch ( ArgumentException^ )
+			{
+				throw gcnew Exception( "The elements of a structured buffer must be blittable (no references, bool or char fields)!" );
+			}
+
+			int	ElementSize = System::Runtime::InteropServices::Marshal::SizeOf( T::typeid );
+			if ( (ElementSize & 3) != 0 )
+				throw gcnew Exception( "The size of the elements of a structured buffer must be a multiple of 4!" );
+
+			return ElementSize;
+		}
+
+		void	CheckRange( cli::array<T>^ _Elements, int _ArrayOffset, int _FirstElement, int _ElementsCount )
+		{
+			if ( _Elements == nullptr )
+				throw gcnew ArgumentNullException( "_Elements" );
+			if ( _ArrayOffset < 0 || _ElementsCount < 0 || _ArrayOffset + _ElementsCount > _Elements->Length )
+				throw gcnew Exception( "The range exceeds the array!" );
+			if ( _FirstElement < 0 || _FirstElement + _ElementsCount > m->Length )
+				throw gcnew Exception( "The range exceeds the buffer!" );
+		}
 	};
 }
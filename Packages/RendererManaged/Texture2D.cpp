@@ -34,6 +34,39 @@ namespace RendererManaged {
 		m_pTexture = new ::Texture2D( *_Device->m_pDevice, _Width, _Height, *pDescriptor, _ArraySize );
 	}
 
+	void	Texture2D::Read( int _MipLevelIndex, int _ArrayIndex, void* _pPixels, int _PixelsCount, int _PixelSize ) {
+		int	RowSize = CheckMipLevel( _MipLevelIndex, _PixelsCount, _PixelSize );
+		int	RowsCount = _PixelsCount * _PixelSize / RowSize;
+
+		D3D11_MAPPED_SUBRESOURCE&	Mapped = m_pTexture->Map( _MipLevelIndex, _ArrayIndex );
+		const U8*	pSource = (const U8*) Mapped.pData;
+		U8*			pTarget = (U8*) _pPixels;
+		for ( int Y=0; Y < RowsCount; Y++, pSource+=Mapped.RowPitch, pTarget+=RowSize )
+			memcpy( pTarget, pSource, RowSize );
+		m_pTexture->UnMap( _MipLevelIndex, _ArrayIndex );
+	}
+
+	void	Texture2D::Write( int _MipLevelIndex, int _ArrayIndex, const void* _pPixels, int _PixelsCount, int _PixelSize ) {
+		int	RowSize = CheckMipLevel( _MipLevelIndex, _PixelsCount, _PixelSize );
+		m_pTexture->UpdateSubResource( _MipLevelIndex, _ArrayIndex, _pPixels, RowSize, _PixelsCount * _PixelSize );
+	}
+
+	// Ensures the array matches the mip level and returns the size of a row of pixels
+	int		Texture2D::CheckMipLevel( int _MipLevelIndex, int _PixelsCount, int _PixelSize ) {
+		if ( _MipLevelIndex < 0 || _MipLevelIndex >= MipLevelsCount )
+			throw gcnew Exception( "Invalid mip level index!" );
+		if ( m_pTexture->GetFormatDescriptor().Size() != _PixelSize )
+			throw gcnew Exception( "The size of the array's elements doesn't match the texture's pixel format!" );
+
+		int	W = Width, H = Height;
+		for ( int MipLevelIndex=0; MipLevelIndex < _MipLevelIndex; MipLevelIndex++ )
+			::Texture2D::NextMipSize( W, H );
+		if ( _PixelsCount != W * H )
+			throw gcnew Exception( "The array must contain exactly the pixels of the mip level!" );
+
+		return W * _PixelSize;
+	}
+
 	void	Texture2D::Set( int _SlotIndex, View2D^ _view )			{ m_pTexture->Set( _SlotIndex, true, _view != nullptr ? _view->SRV : NULL ); }
 	void	Texture2D::SetVS( int _SlotIndex, View2D^ _view )		{ m_pTexture->SetVS( _SlotIndex, true, _view != nullptr ? _view->SRV : NULL ); }
 	void	Texture2D::SetHS( int _SlotIndex, View2D^ _view )		{ m_pTexture->SetHS( _SlotIndex, true, _view != nullptr ? _view->SRV : NULL ); }
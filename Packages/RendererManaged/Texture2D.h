@@ -76,6 +76,23 @@ namespace RendererManaged {
 			m_pTexture->UnMap( _MipLevelIndex, _ArrayIndex );
 		}
 
+		// Maps without copying the pixels into a PixelsBuffer (call UnMap() once you're done with them)
+		MappedPixels	MapDirect( int _MipLevelIndex, int _ArrayIndex ) {
+			return MappedPixels( m_pTexture->Map( _MipLevelIndex, _ArrayIndex ) );
+		}
+
+		// Bulk copies of a whole mip level between the texture and an array of Width*Height pixels stored row after row
+		// The size of the array's elements must be the size of the texture's pixels (e.g. float4 for RGBA32F, half4 for RGBA16F, UInt16 for R16)
+		// Read() maps the texture (i.e. it must be a staging texture) while Write() directly uploads from the pinned array (default usage only)
+		void		Read( int _MipLevelIndex, int _ArrayIndex, cli::array<float4>^ _Pixels )	{ cli::pin_ptr<float4> pPixels = &_Pixels[0]; Read( _MipLevelIndex, _ArrayIndex, pPixels, _Pixels->Length, sizeof(float4) ); }
+		void		Read( int _MipLevelIndex, int _ArrayIndex, cli::array<half4>^ _Pixels )		{ cli::pin_ptr<half4> pPixels = &_Pixels[0]; Read( _MipLevelIndex, _ArrayIndex, pPixels, _Pixels->Length, sizeof(half4) ); }
+		void		Read( int _MipLevelIndex, int _ArrayIndex, cli::array<float>^ _Pixels )		{ cli::pin_ptr<float> pPixels = &_Pixels[0]; Read( _MipLevelIndex, _ArrayIndex, pPixels, _Pixels->Length, sizeof(float) ); }
+		void		Read( int _MipLevelIndex, int _ArrayIndex, cli::array<UInt16>^ _Pixels )	{ cli::pin_ptr<UInt16> pPixels = &_Pixels[0]; Read( _MipLevelIndex, _ArrayIndex, pPixels, _Pixels->Length, sizeof(UInt16) ); }
+		void		Write( int _MipLevelIndex, int _ArrayIndex, cli::array<float4>^ _Pixels )	{ cli::pin_ptr<float4> pPixels = &_Pixels[0]; Write( _MipLevelIndex, _ArrayIndex, pPixels, _Pixels->Length, sizeof(float4) ); }
+		void		Write( int _MipLevelIndex, int _ArrayIndex, cli::array<half4>^ _Pixels )	{ cli::pin_ptr<half4> pPixels = &_Pixels[0]; Write( _MipLevelIndex, _ArrayIndex, pPixels, _Pixels->Length, sizeof(half4) ); }
+		void		Write( int _MipLevelIndex, int _ArrayIndex, cli::array<float>^ _Pixels )	{ cli::pin_ptr<float> pPixels = &_Pixels[0]; Write( _MipLevelIndex, _ArrayIndex, pPixels, _Pixels->Length, sizeof(float) ); }
+		void		Write( int _MipLevelIndex, int _ArrayIndex, cli::array<UInt16>^ _Pixels )	{ cli::pin_ptr<UInt16> pPixels = &_Pixels[0]; Write( _MipLevelIndex, _ArrayIndex, pPixels, _Pixels->Length, sizeof(UInt16) ); }
+
 		// Views
 		View2D^		GetView()				{ return GetView( 0, 0, 0, 0 ); }
 		View2D^		GetView( int _MipLevelStart, int _MipLevelsCount, int _ArrayStart, int _ArraySize ) { return gcnew View2D( this, _MipLevelStart, _MipLevelsCount, _ArrayStart, _ArraySize ); }
@@ -109,5 +126,9 @@ namespace RendererManaged {
 		Texture2D( const ::Texture2D& _ExistingTexture ) {
 			m_pTexture = const_cast< ::Texture2D* >( &_ExistingTexture );
 		}
+
+		void		Read( int _MipLevelIndex, int _ArrayIndex, void* _pPixels, int _PixelsCount, int _PixelSize );
+		void		Write( int _MipLevelIndex, int _ArrayIndex, const void* _pPixels, int _PixelsCount, int _PixelSize );
+		int			CheckMipLevel( int _MipLevelIndex, int _PixelsCount, int _PixelSize );
 	};
 }
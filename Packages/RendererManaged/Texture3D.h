@@ -70,6 +70,11 @@ namespace RendererManaged {
 			return gcnew PixelsBuffer( MappedResource );
 		}
 
+		// Maps without copying the voxels into a PixelsBuffer (call UnMap() once you're done with them)
+		MappedPixels	MapDirect( int _MipLevelIndex ) {
+			return MappedPixels( m_pTexture->Map( _MipLevelIndex ) );
+		}
+
 		void			UnMap( int _MipLevelIndex )
 		{
 			m_pTexture->UnMap( _MipLevelIndex );
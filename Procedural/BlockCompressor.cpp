@@ -0,0 +1,280 @@
+#include "../GodComplex.h"
+
+namespace
+{
+	U16		Quantize565( const float3& _Color )
+	{
+		int	R = CLAMP( int( 31.0f * _Color.x + 0.5f ), 0, 31 );
+		int	G = CLAMP( int( 63.0f * _Color.y + 0.5f ), 0, 63 );
+		int	B = CLAMP( int( 31.0f * _Color.z + 0.5f ), 0, 31 );
+		return U16( (R << 11) | (G << 5) | B );
+	}
+
+	float3	Expand565( U16 _Color )
+	{
+		return float3( ((_Color >> 11) & 31) / 31.0f, ((_Color >> 5) & 63) / 63.0f, (_Color & 31) / 31.0f );
+	}
+
+	// Quantizes the 2 endpoints, orders them for the 4 colors mode and finds the best index of each pixel
+	// Returns the squared error of the block
+	float	FitBC1( const float3 _pColors[16], const float3& _E0, const float3& _E1, U16& _C0, U16& _C1, int _pIndices[16] )
+	{
+		_C0 = Quantize565( _E0 );
+		_C1 = Quantize565( _E1 );
+		if ( _C0 < _C1 )
+		{
+			U16	Temp = _C0;
+			_C0 = _C1;
+			_C1 = Temp;
+		}
+
+		float3	pPalette[4];
+		pPalette[0] = Expand565( _C0 );
+		pPalette[1] = Expand565( _C1 );
+		pPalette[2] = (2.0f * pPalette[0] + pPalette[1]) / 3.0f;
+		pPalette[3] = (pPalette[0] + 2.0f * pPalette[1]) / 3.0f;
+		int	PaletteSize = _C0 == _C1 ? 1 : 4;	// Equal endpoints would select the 3 colors mode so we only use index 0
+
+		float	Error = 0.0f;
+		for ( int PixelIndex=0; PixelIndex < 16; PixelIndex++ )
+		{
+			float	BestError = FLOAT32_MAX;
+			for ( int Index=0; Index < PaletteSize; Index++ )
+			{
+				float3	Delta = _pColors[PixelIndex] - pPalette[Index];
+				float	IndexError = Delta | Delta;
+				if ( IndexError < BestError )
+				{
+					BestError = IndexError;
+					_pIndices[PixelIndex] = Index;
+				}
+			}
+			Error += BestError;
+		}
+
+		return Error;
+	}
+
+	// Palette weights of the first endpoint for each BC1 index
+	const float	BC1_WEIGHTS[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+
+	U8		Quantize8( float _Value )
+	{
+		return U8( CLAMP( int( 255.0f * _Value + 0.5f ), 0, 255 ) );
+	}
+}
+
+bool	BlockCompressor::IsSupported( const IPixelFormatDescriptor& _Format )
+{
+	switch ( _Format.DirectXFormat() )
+	{
+	case DXGI_FORMAT_BC1_UNORM:
+	case DXGI_FORMAT_BC1_UNORM_SRGB:
+	case DXGI_FORMAT_BC3_UNORM:
+	case DXGI_FORMAT_BC3_UNORM_SRGB:
+	case DXGI_FORMAT_BC4_UNORM:
+	case DXGI_FORMAT_BC5_UNORM:
+		return true;
+	}
+	return false;
+}
+
+int		BlockCompressor::GetCompressedSize( const IPixelFormatDescriptor& _Format, int _Width, int _Height )
+{
+	return ((_Width+3) >> 2) * ((_Height+3) >> 2) * _Format.Size();
+}
+
+void	BlockCompressor::Compress( const IPixelFormatDescriptor& _Format, const float4* _pSource, int _Width, int _Height, U8* _pTarget, int _BlockY0, int _BlockY1 )
+{
+	ASSERT( IsSupported( _Format ), "Unsupported block-compressed format!" );
+
+	int	BlocksCountX = (_Width+3) >> 2;
+	int	BlocksCountY = (_Height+3) >> 2;
+	if ( _BlockY1 < 0 )
+		_BlockY1 = BlocksCountY;
+
+	DXGI_FORMAT	Format = _Format.DirectXFormat();
+	int			BlockBytes = _Format.Size();
+
+	float4	pBlock[16];
+	for ( int BlockY=_BlockY0; BlockY < _BlockY1; BlockY++ )
+	{
+		U8*	pTarget = _pTarget + BlockBytes * BlocksCountX * BlockY;
+		for ( int BlockX=0; BlockX < BlocksCountX; BlockX++, pTarget+=BlockBytes )
+		{
+			// Gather the block, replicating the border pixels
+			for ( int Y=0; Y < 4; Y++ )
+			{
+				const float4*	pScanline = _pSource + _Width * MIN( 4*BlockY+Y, _Height-1 );
+				for ( int X=0; X < 4; X++ )
+					pBlock[4*Y+X] = pScanline[MIN( 4*BlockX+X, _Width-1 )];
+			}
+
+			switch ( Format )
+			{
+			case DXGI_FORMAT_BC1_UNORM:
+			case DXGI_FORMAT_BC1_UNORM_SRGB:
+				EncodeBC1( pBlock, pTarget );
+				break;
+			case DXGI_FORMAT_BC3_UNORM:
+			case DXGI_FORMAT_BC3_UNORM_SRGB:
+				EncodeBC4( pBlock, 3, pTarget );
+				EncodeBC1( pBlock, pTarget + 8 );
+				break;
+			case DXGI_FORMAT_BC4_UNORM:
+				EncodeBC4( pBlock, 0, pTarget );
+				break;
+			case DXGI_FORMAT_BC5_UNORM:
+				EncodeBC4( pBlock, 0, pTarget );
+				EncodeBC4( pBlock, 1, pTarget + 8 );
+				break;
+			}
+		}
+	}
+}
+
+void	BlockCompressor::EncodeBC1( const float4 _pBlock[16], U8 _pTarget[8] )
+{
+	float3	pColors[16];
+	float3	Mean( 0, 0, 0 );
+	for ( int PixelIndex=0; PixelIndex < 16; PixelIndex++ )
+	{
+		pColors[PixelIndex].Set( CLAMP( _pBlock[PixelIndex].x, 0.0f, 1.0f ), CLAMP( _pBlock[PixelIndex].y, 0.0f, 1.0f ), CLAMP( _pBlock[PixelIndex].z, 0.0f, 1.0f ) );
+		Mean = Mean + pColors[PixelIndex];
+	}
+	Mean = Mean / 16.0f;
+
+	// Build the covariance matrix
+	float	XX = 0.0f, XY = 0.0f, XZ = 0.0f, YY = 0.0f, YZ = 0.0f, ZZ = 0.0f;
+	for ( int PixelIndex=0; PixelIndex < 16; PixelIndex++ )
+	{
+		float3	D = pColors[PixelIndex] - Mean;
+		XX += D.x * D.x;	XY += D.x * D.y;	XZ += D.x * D.z;
+		YY += D.y * D.y;	YZ += D.y * D.z;	ZZ += D.z * D.z;
+	}
+
+	// Find the principal axis by power iteration
+	float3	Axis( 1, 1, 1 );
+	for ( int Iteration=0; Iteration < 8; Iteration++ )
+	{
+		float3	NewAxis( XX * Axis.x + XY * Axis.y + XZ * Axis.z, XY * Axis.x + YY * Axis.y + YZ * Axis.z, XZ * Axis.x + YZ * Axis.y + ZZ * Axis.z );
+		float	Length = NewAxis.Length();
+		if ( Length < 1e-12f )
+			break;	// Uniform block (or we converged onto a null vector), the endpoints end up on the mean
+		Axis = NewAxis / Length;
+	}
+
+	// The endpoints are the farthest projections along the axis
+	float	MinT = 0.0f, MaxT = 0.0f;
+	for ( int PixelIndex=0; PixelIndex < 16; PixelIndex++ )
+	{
+		float	t = (pColors[PixelIndex] - Mean) | Axis;
+		MinT = MIN( MinT, t );
+		MaxT = MAX( MaxT, t );
+	}
+
+	U16		C0, C1;
+	int		pIndices[16];
+	float	Error = FitBC1( pColors, Mean + MaxT * Axis, Mean + MinT * Axis, C0, C1, pIndices );
+
+	// Refine the endpoints once by least squares, solving for the 2 endpoints given the indices
+	if ( Error > 0.0f && C0 != C1 )
+	{
+		float	AA = 0.0f, AB = 0.0f, BB = 0.0f;
+		float3	AX( 0, 0, 0 ), BX( 0, 0, 0 );
+		for ( int PixelIndex=0; PixelIndex < 16; PixelIndex++ )
+		{
+			float	a = BC1_WEIGHTS[pIndices[PixelIndex]];
+			float	b = 1.0f - a;
+			AA += a * a;
+			AB += a * b;
+			BB += b * b;
+			AX = AX + a * pColors[PixelIndex];
+			BX = BX + b * pColors[PixelIndex];
+		}
+
+		float	Det = AA * BB - AB * AB;
+		if ( fabs( Det ) > 1e-6f )
+		{
+			float	InvDet = 1.0f / Det;
+			float3	E0 = InvDet * (BB * AX - AB * BX);
+			float3	E1 = InvDet * (AA * BX - AB * AX);
+
+			U16		RefinedC0, RefinedC1;
+			int		pRefinedIndices[16];
+			float	RefinedError = FitBC1( pColors, E0, E1, RefinedC0, RefinedC1, pRefinedIndices );
+			if ( RefinedError < Error )
+			{
+				C0 = RefinedC0;
+				C1 = RefinedC1;
+				memcpy( pIndices, pRefinedIndices, 16*sizeof(int) );
+			}
+		}
+	}
+
+	U32	Indices = 0;
+	for ( int PixelIndex=0; PixelIndex < 16; PixelIndex++ )
+		Indices |= U32(pIndices[PixelIndex]) << (2*PixelIndex);
+
+	_pTarget[0] = U8(C0 & 0xFF);
+	_pTarget[1] = U8(C0 >> 8);
+	_pTarget[2] = U8(C1 & 0xFF);
+	_pTarget[3] = U8(C1 >> 8);
+	_pTarget[4] = U8(Indices & 0xFF);
+	_pTarget[5] = U8((Indices >> 8) & 0xFF);
+	_pTarget[6] = U8((Indices >> 16) & 0xFF);
+	_pTarget[7] = U8(Indices >> 24);
+}
+
+void	BlockCompressor::EncodeBC4( const float4 _pBlock[16], int _Component, U8 _pTarget[8] )
+{
+	float	pValues[16];
+	float	Min = 1.0f, Max = 0.0f;
+	for ( int PixelIndex=0; PixelIndex < 16; PixelIndex++ )
+	{
+		pValues[PixelIndex] = CLAMP( (&_pBlock[PixelIndex].x)[_Component], 0.0f, 1.0f );
+		Min = MIN( Min, pValues[PixelIndex] );
+		Max = MAX( Max, pValues[PixelIndex] );
+	}
+
+	// Always use the 8 values mode (A0 > A1), equal endpoints only use index 0
+	U8	A0 = Quantize8( Max );
+	U8	A1 = Quantize8( Min );
+
+	float	pPalette[8];
+	pPalette[0] = A0 / 255.0f;
+	pPalette[1] = A1 / 255.0f;
+	for ( int Index=1; Index < 7; Index++ )
+		pPalette[1+Index] = ((7-Index) * pPalette[0] + Index * pPalette[1]) / 7.0f;
+	int	PaletteSize = A0 == A1 ? 1 : 8;
+
+	U32	IndicesLow = 0, IndicesHigh = 0;	// 48 bits of indices, 24 bits each
+	for ( int PixelIndex=0; PixelIndex < 16; PixelIndex++ )
+	{
+		int		BestIndex = 0;
+		float	BestError = FLOAT32_MAX;
+		for ( int Index=0; Index < PaletteSize; Index++ )
+		{
+			float	Error = fabs( pValues[PixelIndex] - pPalette[Index] );
+			if ( Error < BestError )
+			{
+				BestError = Error;
+				BestIndex = Index;
+			}
+		}
+
+		if ( PixelIndex < 8 )
+			IndicesLow |= U32(BestIndex) << (3*PixelIndex);
+		else
+			IndicesHigh |= U32(BestIndex) << (3*(PixelIndex-8));
+	}
+
+	_pTarget[0] = A0;
+	_pTarget[1] = A1;
+	_pTarget[2] = U8(IndicesLow & 0xFF);
+	_pTarget[3] = U8((IndicesLow >> 8) & 0xFF);
+	_pTarget[4] = U8(IndicesLow >> 16);
+	_pTarget[5] = U8(IndicesHigh & 0xFF);
+	_pTarget[6] = U8((IndicesHigh >> 8) & 0xFF);
+	_pTarget[7] = U8(IndicesHigh >> 16);
+}
@@ -0,0 +1,32 @@
+//////////////////////////////////////////////////////////////////////////
+// Encodes RGBA32F images into block-compressed formats (cf. the COMPRESSED FORMATS in PixelFormats.h)
+//	_ BC1 stores RGB with 2 endpoints in 565 and 2-bits indices (alpha is dropped)
+//	_ BC3 stores RGB like BC1 and alpha like BC4
+//	_ BC4 stores the red channel with 2 endpoints in 8 bits and 3-bits indices
+//	_ BC5 stores red & green as 2 BC4 blocks (e.g. normal XY)
+//
+// Endpoints are found along the principal axis of the block's colors then refined once by least squares, which is quite
+//	faster than an exhaustive search and good enough for procedural textures.
+//
+// Values are expected in [0,1], sRGB formats simply store the values they're given (like PixelFormatRGBA8_sRGB does).
+//
+#pragma once
+
+class	BlockCompressor
+{
+public:		// METHODS
+
+	static bool		IsSupported( const IPixelFormatDescriptor& _Format );
+
+	// Returns the size in bytes of an image of the given size once compressed
+	static int		GetCompressedSize( const IPixelFormatDescriptor& _Format, int _Width, int _Height );
+
+	// Compresses the rows of blocks [_BlockY0,_BlockY1[ of a _Width x _Height image (-1 for all the remaining rows)
+	// Blocks along the right & bottom borders of images whose size isn't a multiple of 4 replicate the border pixels
+	// THREAD SAFETY: Different rows of blocks can be compressed concurrently
+	static void		Compress( const IPixelFormatDescriptor& _Format, const float4* _pSource, int _Width, int _Height, U8* _pTarget, int _BlockY0=0, int _BlockY1=-1 );
+
+	// Single block encoders (_pBlock contains 4x4 pixels in scanline order)
+	static void		EncodeBC1( const float4 _pBlock[16], U8 _pTarget[8] );
+	static void		EncodeBC4( const float4 _pBlock[16], int _Component, U8 _pTarget[8] );
+};
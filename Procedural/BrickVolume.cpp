@@ -0,0 +1,169 @@
+#include "../GodComplex.h"
+
+BrickVolume::BrickVolume( Device& _Device, const VolumeBuilder& _Volume, int _BrickSize, const IPixelFormatDescriptor& _Format, const float4& _EmptyValue, float _EmptyThreshold )
+	: m_Device( _Device )
+	, m_Width( _Volume.GetWidth() )
+	, m_Height( _Volume.GetHeight() )
+	, m_Depth( _Volume.GetDepth() )
+	, m_PixelSize( _Format.Size() )
+	, m_BrickSize( _BrickSize )
+	, m_SlotSize( _BrickSize + 2*BRICK_BORDER )
+	, m_ResidentBricksCount( 0 )
+{
+	ASSERT( _BrickSize >= 2 && 2*m_SlotSize <= MAX_ATLAS_SIZE, "Invalid brick size!" );
+	ASSERT( (m_Width % m_BrickSize) == 0 && (m_Height % m_BrickSize) == 0 && (m_Depth % m_BrickSize) == 0, "The volume must be made of whole bricks!" );
+
+	m_BricksCountX = m_Width / m_BrickSize;
+	m_BricksCountY = m_Height / m_BrickSize;
+	m_BricksCountZ = m_Depth / m_BrickSize;
+	int	BricksCount = GetBricksCount();
+
+	// Find the non-empty bricks
+	bool*	pEmpty = new bool[BricksCount];
+	for ( int BrickZ=0, BrickIndex=0; BrickZ < m_BricksCountZ; BrickZ++ )
+		for ( int BrickY=0; BrickY < m_BricksCountY; BrickY++ )
+			for ( int BrickX=0; BrickX < m_BricksCountX; BrickX++, BrickIndex++ )
+			{
+				pEmpty[BrickIndex] = IsBrickEmpty( _Volume, BrickX, BrickY, BrickZ, _EmptyValue, _EmptyThreshold );
+				if ( !pEmpty[BrickIndex] )
+					m_ResidentBricksCount++;
+			}
+
+	// Lay the slots out as a cube, slot 0 being the empty brick
+	int	SlotsCount = 1 + m_ResidentBricksCount;
+	int	MaxSlotsPerSide = MAX_ATLAS_SIZE / m_SlotSize;
+	int	SlotsPerSide = 1;
+	while ( SlotsPerSide*SlotsPerSide*SlotsPerSide < SlotsCount )
+		SlotsPerSide++;
+
+	int	SlotsX = MIN( SlotsPerSide, MaxSlotsPerSide );
+	int	SlotsY = MIN( SlotsX, (SlotsCount + SlotsX-1) / SlotsX );
+	int	SlotsZ = (SlotsCount + SlotsX*SlotsY-1) / (SlotsX*SlotsY);
+	ASSERT( SlotsZ <= MaxSlotsPerSide, "Too many non-empty bricks to fit in the atlas!" );
+
+	int	AtlasWidth = SlotsX * m_SlotSize;
+	int	AtlasHeight = SlotsY * m_SlotSize;
+	int	AtlasDepth = SlotsZ * m_SlotSize;
+	int	RowPitch = AtlasWidth * m_PixelSize;
+	int	DepthPitch = AtlasHeight * RowPitch;
+
+	U8*	pAtlas = new U8[AtlasDepth * DepthPitch];
+	memset( pAtlas, 0, AtlasDepth * DepthPitch );	// Unused slots
+
+	// Fill the empty slot
+	for ( int Z=0; Z < m_SlotSize; Z++ )
+		for ( int Y=0; Y < m_SlotSize; Y++ )
+		{
+			U8*	pScanline = pAtlas + Z*DepthPitch + Y*RowPitch;
+			for ( int X=0; X < m_SlotSize; X++, pScanline+=m_PixelSize )
+				_Format.Write( pScanline, _EmptyValue );
+		}
+
+	// Copy the non-empty bricks to their slot & build the indirection
+	PixelFormatRGBA16_UINT*	pIndirection = new PixelFormatRGBA16_UINT[BricksCount];
+	int	SlotIndex = 1;
+	for ( int BrickZ=0, BrickIndex=0; BrickZ < m_BricksCountZ; BrickZ++ )
+		for ( int BrickY=0; BrickY < m_BricksCountY; BrickY++ )
+			for ( int BrickX=0; BrickX < m_BricksCountX; BrickX++, BrickIndex++ )
+			{
+				PixelFormatRGBA16_UINT&	Entry = pIndirection[BrickIndex];
+				if ( pEmpty[BrickIndex] )
+				{
+					Entry.R = Entry.G = Entry.B = Entry.A = 0;
+					continue;
+				}
+
+				int	SlotX = SlotIndex % SlotsX;
+				int	SlotY = (SlotIndex / SlotsX) % SlotsY;
+				int	SlotZ = SlotIndex / (SlotsX*SlotsY);
+				SlotIndex++;
+
+				Entry.R = U16( SlotX );
+				Entry.G = U16( SlotY );
+				Entry.B = U16( SlotZ );
+				Entry.A = 1;
+
+				U8*	pSlot = pAtlas + SlotZ*m_SlotSize*DepthPitch + SlotY*m_SlotSize*RowPitch + SlotX*m_SlotSize*m_PixelSize;
+				CopyBrick( _Volume, BrickX, BrickY, BrickZ, _Format, pSlot, RowPitch, DepthPitch );
+			}
+
+	const void*	ppIndirection[1] = { pIndirection };
+	m_pTexIndirection = new Texture3D( m_Device, m_BricksCountX, m_BricksCountY, m_BricksCountZ, PixelFormatRGBA16_UINT::DESCRIPTOR, 1, ppIndirection );
+
+	const void*	ppAtlas[1] = { pAtlas };
+	m_pTexAtlas = new Texture3D( m_Device, AtlasWidth, AtlasHeight, AtlasDepth, _Format, 1, ppAtlas );
+
+	delete[] pIndirection;
+	delete[] pAtlas;
+	delete[] pEmpty;
+}
+
+BrickVolume::~BrickVolume()
+{
+	delete m_pTexAtlas;
+	delete m_pTexIndirection;
+}
+
+float	BrickVolume::GetCompressionRatio() const
+{
+	float	DenseSize = float(m_Width) * m_Height * m_Depth * m_PixelSize;
+	float	SparseSize = float(m_pTexAtlas->GetWidth()) * m_pTexAtlas->GetHeight() * m_pTexAtlas->GetDepth() * m_PixelSize
+					   + float(GetBricksCount()) * sizeof(PixelFormatRGBA16_UINT);
+	return SparseSize / DenseSize;
+}
+
+void	BrickVolume::Set() const
+{
+	m_pTexIndirection->Set( INDIRECTION_SLOT, true );
+	m_pTexAtlas->Set( ATLAS_SLOT, true );
+}
+
+const float*	BrickVolume::GetVoxel( const VolumeBuilder& _Volume, int _X, int _Y, int _Z ) const
+{
+	_X = CLAMP( _X, 0, m_Width-1 );
+	_Y = CLAMP( _Y, 0, m_Height-1 );
+	_Z = CLAMP( _Z, 0, m_Depth-1 );
+	return _Volume.GetMip( 0 ) + _Volume.GetChannelsCount() * (m_Width * (m_Height * _Z + _Y) + _X);
+}
+
+// The borders are tested too since they're sampled by the trilinear filtering at the brick's boundaries
+bool	BrickVolume::IsBrickEmpty( const VolumeBuilder& _Volume, int _BrickX, int _BrickY, int _BrickZ, const float4& _EmptyValue, float _EmptyThreshold ) const
+{
+	int	ChannelsCount = MIN( 4, _Volume.GetChannelsCount() );
+	int	X0 = _BrickX * m_BrickSize - BRICK_BORDER;
+	int	Y0 = _BrickY * m_BrickSize - BRICK_BORDER;
+	int	Z0 = _BrickZ * m_BrickSize - BRICK_BORDER;
+	for ( int Z=Z0; Z < Z0+m_SlotSize; Z++ )
+		for ( int Y=Y0; Y < Y0+m_SlotSize; Y++ )
+			for ( int X=X0; X < X0+m_SlotSize; X++ )
+			{
+				const float*	pVoxel = GetVoxel( _Volume, X, Y, Z );
+				for ( int ChannelIndex=0; ChannelIndex < ChannelsCount; ChannelIndex++ )
+					if ( fabs( pVoxel[ChannelIndex] - (&_EmptyValue.x)[ChannelIndex] ) > _EmptyThreshold )
+						return false;
+			}
+
+	return true;
+}
+
+void	BrickVolume::CopyBrick( const VolumeBuilder& _Volume, int _BrickX, int _BrickY, int _BrickZ, const IPixelFormatDescriptor& _Format, U8* _pTarget, int _TargetRowPitch, int _TargetDepthPitch ) const
+{
+	int	ChannelsCount = MIN( 4, _Volume.GetChannelsCount() );
+	int	X0 = _BrickX * m_BrickSize - BRICK_BORDER;
+	int	Y0 = _BrickY * m_BrickSize - BRICK_BORDER;
+	int	Z0 = _BrickZ * m_BrickSize - BRICK_BORDER;
+	for ( int Z=0; Z < m_SlotSize; Z++ )
+		for ( int Y=0; Y < m_SlotSize; Y++ )
+		{
+			U8*	pScanline = _pTarget + Z*_TargetDepthPitch + Y*_TargetRowPitch;
+			for ( int X=0; X < m_SlotSize; X++, pScanline+=m_PixelSize )
+			{
+				const float*	pVoxel = GetVoxel( _Volume, X0+X, Y0+Y, Z0+Z );
+
+				float4	Value( 0, 0, 0, 0 );
+				for ( int ChannelIndex=0; ChannelIndex < ChannelsCount; ChannelIndex++ )
+					(&Value.x)[ChannelIndex] = pVoxel[ChannelIndex];
+				_Format.Write( pScanline, Value );
+			}
+		}
+}
@@ -0,0 +1,78 @@
+//////////////////////////////////////////////////////////////////////////
+// Brick Volume
+// Sparse storage of a mostly empty volume (e.g. cloud density, translucency) as an atlas of bricks of BrickSize^3 voxels
+//	where only the non-empty bricks are stored, and an indirection volume of one entry per brick telling in which slot
+//	of the atlas the brick is.
+//
+// _ Each brick is stored with a border of BRICK_BORDER voxels copied from its neighbors so trilinear filtering is seamless
+//	across bricks (i.e. a slot is BrickSize+2 voxels on a side)
+// _ A brick is empty when all its voxels, borders included, are within the threshold of the empty value: its entry then
+//	points to the atlas slot 0 that's filled with the empty value, so sampling never needs to branch
+//
+// Usage:
+//	VolumeBuilder	Density( 512, 512, 128, 1, 1 );
+//	Density.Fill( FillDensity, &Data );
+//	BrickVolume		Volume( gs_Device, Density, 8, PixelFormatR16F::DESCRIPTOR );
+//	(...)
+//	Volume.Set();	// Indirection in t35 & atlas in t36 for BrickVolumeSample() (cf. Inc/BrickVolume.hlsl)
+//
+// NOTE: Only the mip 0 of the builder is stored, there are no mips in the atlas.
+// The volume's dimensions must be multiples of the brick size, voxels outside the volume are clamped to its borders.
+//
+#pragma once
+
+class BrickVolume
+{
+public:		// CONSTANTS
+
+	static const int	BRICK_BORDER = 1;
+	static const int	MAX_ATLAS_SIZE = D3D11_REQ_TEXTURE3D_U_V_OR_W_DIMENSION;	// 2048 voxels on a side
+	static const int	INDIRECTION_SLOT = 35;		// !!IMPORTANT ==> Must correspond to _TexBrickIndirection in Inc/BrickVolume.hlsl!!
+	static const int	ATLAS_SLOT = 36;			// !!IMPORTANT ==> Must correspond to _TexBrickAtlas in Inc/BrickVolume.hlsl!!
+
+private:	// FIELDS
+
+	Device&				m_Device;
+
+	int					m_Width;
+	int					m_Height;
+	int					m_Depth;
+	int					m_PixelSize;			// Size of a voxel in the atlas format
+	int					m_BrickSize;
+	int					m_SlotSize;				// BrickSize + 2 borders
+
+	int					m_BricksCountX;
+	int					m_BricksCountY;
+	int					m_BricksCountZ;
+	int					m_ResidentBricksCount;	// Non-empty bricks (the empty slot 0 excluded)
+
+	Texture3D*			m_pTexIndirection;		// XYZ=Slot of the brick in the atlas, W=1 if the brick isn't empty
+	Texture3D*			m_pTexAtlas;
+
+public:		// PROPERTIES
+
+	int			GetBricksCount() const			{ return m_BricksCountX * m_BricksCountY * m_BricksCountZ; }
+	int			GetResidentBricksCount() const	{ return m_ResidentBricksCount; }
+	int			GetBrickSize() const			{ return m_BrickSize; }
+	Texture3D&	GetIndirection()				{ return *m_pTexIndirection; }
+	Texture3D&	GetAtlas()						{ return *m_pTexAtlas; }
+
+	// Size of the atlas & indirection volumes compared to the size of the dense volume of the same format
+	float		GetCompressionRatio() const;
+
+public:		// METHODS
+
+	// _BrickSize, voxels on a side of a brick (8 or 16 are good choices: small bricks are tighter but have more border overhead)
+	// _EmptyValue, _EmptyThreshold, voxels whose channels all are within _EmptyThreshold of _EmptyValue are considered empty
+	BrickVolume( Device& _Device, const VolumeBuilder& _Volume, int _BrickSize, const IPixelFormatDescriptor& _Format, const float4& _EmptyValue=float4::Zero, float _EmptyThreshold=0.0f );
+	~BrickVolume();
+
+	// Sets the indirection in t35 & the atlas in t36 for all the stages (cf. Inc/BrickVolume.hlsl)
+	void		Set() const;
+
+private:
+
+	bool		IsBrickEmpty( const VolumeBuilder& _Volume, int _BrickX, int _BrickY, int _BrickZ, const float4& _EmptyValue, float _EmptyThreshold ) const;
+	void		CopyBrick( const VolumeBuilder& _Volume, int _BrickX, int _BrickY, int _BrickZ, const IPixelFormatDescriptor& _Format, U8* _pTarget, int _TargetRowPitch, int _TargetDepthPitch ) const;
+	const float*	GetVoxel( const VolumeBuilder& _Volume, int _X, int _Y, int _Z ) const;
+};
@@ -3,14 +3,18 @@
 DrawUtils::DrawUtils()
 	: m_pSurface( NULL )
 {
-	m_ContextRECT.pOwner = this;
-	m_ContextLINE.pOwner = this;
-	m_ContextELLIPSE.pOwner = this;
-	m_ContextSCRATCH.pOwner = this;
-
 	m_X = float2::UnitX;
 	m_Y = float2::UnitY;
 	m_C = float2::Zero;
+
+	m_bBatching = false;
+}
+
+DrawUtils::~DrawUtils()
+{
+	ASSERT( !m_bBatching, "Did you forget to call EndBatch()?" );
+	for ( int QuadIndex=0; QuadIndex < m_BatchedQuads.GetCount(); QuadIndex++ )
+		delete m_BatchedQuads[QuadIndex].pContext;
 }
 
 void	DrawUtils::SetupSurface( int _Width, int _Height, Pixel* _pSurface )
@@ -36,12 +40,18 @@ void	DrawUtils::SetupTransform( float _PivotX, float _PivotY, float _Angle )
 }
 
 //////////////////////////////////////////////////////////////////////////
-void	DrawUtils::DrawRectangle( float x, float y, float w, float h, float border, float bias, FillDelegate _Filler, void* _pData ) const
+void	DrawUtils::DrawRectangle( float x, float y, float w, float h, float border, float bias, FillDelegate _Filler, void* _pData, const Pixel* _pInterior, float _InteriorDistance ) const
 {
 	m_Infos.pData = _pData;
 
 	// Setup rectangle-specific parameters
 	m_ContextRECT.pFiller = _Filler;
+	m_ContextRECT.bInterior = _pInterior != NULL;
+	if ( _pInterior != NULL )
+	{
+		m_ContextRECT.Interior = *_pInterior;
+		m_ContextRECT.InteriorDistance = _InteriorDistance;
+	}
 	m_ContextRECT.x0 = bias*border;
 	m_ContextRECT.y0 = bias*border;
 	m_ContextRECT.x1 = w - bias*border;
@@ -59,18 +69,13 @@ void	DrawUtils::DrawRectangle( float x, float y, float w, float h, float border,
 
 	DrawQuad( pVertices, m_ContextRECT );
 }
-void	DrawUtils::DrawContextRECT::DrawPixel()
+void	DrawUtils::DrawContextRECT::DrawPixel( DrawInfos& _Infos, const float4& _P, Pixel& _Pixel ) const
 {
-	int	WrappedX = X % pOwner->m_Width;
-		WrappedX = WrappedX < 0 ? WrappedX + pOwner->m_Width : WrappedX;
-
-	pOwner->m_Infos.x = X;
-	pOwner->m_Infos.UV.Set( P.z, P.w );
-	pOwner->m_Infos.Coverage = Coverage;
+	_Infos.UV.Set( _P.z, _P.w );
 
 	// Compute signed distance to border
-	float	fX = P.z * w;	// U * w = Pixel X in LOCAL rectangle space
-	float	fY = P.w * h;	// V * h = Pixel Y in LOCAL rectangle space
+	float	fX = _P.z * w;	// U * w = Pixel X in LOCAL rectangle space
+	float	fY = _P.w * h;	// V * h = Pixel Y in LOCAL rectangle space
 
 	float	Dx0 = fX - x0;
 	float	Dy0 = fY - y0;
@@ -96,10 +101,49 @@ void	DrawUtils::DrawContextRECT::DrawPixel()
 
 	// Normalize and re-sign
 	D *= (bOutside ? -1.0f : +1.0f) * InvBorderSize;
-	pOwner->m_Infos.Distance = D;
+	_Infos.Distance = D;
 
 	// Invoke pixel drawing
-	pFiller( pOwner->m_Infos, pScanline[WrappedX] );
+	pFiller( _Infos, _Pixel );
+}
+
+namespace
+{
+	// Restricts [_t0,_t1] to the values of t where _a + _b * t >= _Min
+	void	ClipLinear( float _a, float _b, float _Min, float& _t0, float& _t1 )
+	{
+		if ( _b == 0.0f )
+		{
+			if ( _a < _Min )
+				_t1 = _t0 - 1.0f;	// Empty range
+			return;
+		}
+
+		float	t = (_Min - _a) / _b;
+		if ( _b > 0.0f )
+			_t0 = MAX( _t0, t );
+		else
+			_t1 = MIN( _t1, t );
+	}
+}
+
+bool	DrawUtils::DrawContextRECT::GetInteriorRange( const float4& _P, const float4& _Slope, float& _t0, float& _t1 ) const
+{
+	// Inside the rectangle, the distance is the smallest of the 4 distances to the borders that are linear along the span
+	float	MinDistance = 0.0f;	// Outside the rectangle distances are computed differently so we stick to the inside
+	if ( InvBorderSize > 0.0f )
+		MinDistance = MAX( 0.0f, InteriorDistance / InvBorderSize );
+	else if ( InteriorDistance > 0.0f )
+		return false;	// The distance is always 0
+
+	_t0 = -FLOAT32_MAX;
+	_t1 = FLOAT32_MAX;
+	ClipLinear( w * _P.z - x0, w * _Slope.z, MinDistance, _t0, _t1 );
+	ClipLinear( x1 - w * _P.z, -w * _Slope.z, MinDistance, _t0, _t1 );
+	ClipLinear( h * _P.w - y0, h * _Slope.w, MinDistance, _t0, _t1 );
+	ClipLinear( y1 - h * _P.w, -h * _Slope.w, MinDistance, _t0, _t1 );
+
+	return _t0 <= _t1;
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -131,32 +175,33 @@ void	DrawUtils::DrawLine( float x0, float y0, float x1, float y1, float thicknes
 
 	DrawQuad( pVertices, m_ContextLINE );
 }
-void	DrawUtils::DrawContextLINE::DrawPixel()
+void	DrawUtils::DrawContextLINE::DrawPixel( DrawInfos& _Infos, const float4& _P, Pixel& _Pixel ) const
 {
-	int	WrappedX = X % pOwner->m_Width;
-		WrappedX = WrappedX < 0 ? WrappedX + pOwner->m_Width : WrappedX;
-
-	pOwner->m_Infos.x = X;
-	pOwner->m_Infos.UV.Set( P.z, P.w );
-	pOwner->m_Infos.Coverage = Coverage;
+	_Infos.UV.Set( _P.z, _P.w );
 
 	// Compute distance to the line
-	float	U = CLAMP( pOwner->m_Infos.UV.x, dU, 1.0f - dU );	// Nearest U coordinate on the segment
-	float	Du = (pOwner->m_Infos.UV.x - U) / dU;		// Normalize U distance
-	float	Dv = 2.0f * (pOwner->m_Infos.UV.y - 0.5f);	// For V, the line is simply in the middle at V=0.5
-	pOwner->m_Infos.Distance = sqrtf( Du*Du + Dv*Dv );
+	float	U = CLAMP( _Infos.UV.x, dU, 1.0f - dU );	// Nearest U coordinate on the segment
+	float	Du = (_Infos.UV.x - U) / dU;		// Normalize U distance
+	float	Dv = 2.0f * (_Infos.UV.y - 0.5f);	// For V, the line is simply in the middle at V=0.5
+	_Infos.Distance = sqrtf( Du*Du + Dv*Dv );
 
 	// Invoke pixel drawing
-	pFiller( pOwner->m_Infos, pScanline[WrappedX] );
+	pFiller( _Infos, _Pixel );
 }
 
 //////////////////////////////////////////////////////////////////////////
-void	DrawUtils::DrawEllipse( float x, float y, float w, float h, float border, float bias, FillDelegate _Filler, void* _pData ) const
+void	DrawUtils::DrawEllipse( float x, float y, float w, float h, float border, float bias, FillDelegate _Filler, void* _pData, const Pixel* _pInterior, float _InteriorDistance ) const
 {
 	m_Infos.pData = _pData;
 
 	// Setup rectangle-specific parameters
 	m_ContextELLIPSE.pFiller = _Filler;
+	m_ContextELLIPSE.bInterior = _pInterior != NULL;
+	if ( _pInterior != NULL )
+	{
+		m_ContextELLIPSE.Interior = *_pInterior;
+		m_ContextELLIPSE.InteriorDistance = _InteriorDistance;
+	}
 	m_ContextELLIPSE.w = w;
 	m_ContextELLIPSE.h = h;
 	m_ContextELLIPSE.InvDu = (border != 0.0f ? w / border : 0.0f);
@@ -171,27 +216,56 @@ void	DrawUtils::DrawEllipse( float x, float y, float w, float h, float border, f
 
 	DrawQuad( pVertices, m_ContextELLIPSE );
 }
-void	DrawUtils::DrawContextELLIPSE::DrawPixel()
+void	DrawUtils::DrawContextELLIPSE::DrawPixel( DrawInfos& _Infos, const float4& _P, Pixel& _Pixel ) const
 {
-	int	WrappedX = X % pOwner->m_Width;
-		WrappedX = WrappedX < 0 ? WrappedX + pOwner->m_Width : WrappedX;
-
-	pOwner->m_Infos.x = X;
-	pOwner->m_Infos.UV.Set( P.z, P.w );
-	pOwner->m_Infos.Coverage = Coverage;
+	_Infos.UV.Set( _P.z, _P.w );
 
-	float	Du = 2.0f * (P.z - 0.5f);
-	float	Dv = 2.0f * (P.w - 0.5f);
+	float	Du = 2.0f * (_P.z - 0.5f);
+	float	Dv = 2.0f * (_P.w - 0.5f);
 	float	D = 1.0f - sqrtf( Du*Du + Dv*Dv );
 	if ( D < 0.0f )
 		return;	// Skip negative distances (i.e. out of the ellipse)
 
 	D += DistanceBias;	// Apply bias
 
-	pOwner->m_Infos.Distance = D * InvDu;
+	_Infos.Distance = D * InvDu;
 
 	// Invoke pixel drawing
-	pFiller( pOwner->m_Infos, pScanline[WrappedX] );
+	pFiller( _Infos, _Pixel );
+}
+
+bool	DrawUtils::DrawContextELLIPSE::GetInteriorRange( const float4& _P, const float4& _Slope, float& _t0, float& _t1 ) const
+{
+	// Find the maximum radius of the interior pixels
+	float	MaxRadius = 1.0f;
+	if ( InvDu > 0.0f )
+		MaxRadius = MIN( MaxRadius, 1.0f + DistanceBias - InteriorDistance / InvDu );
+	else if ( InteriorDistance > 0.0f )
+		return false;	// The distance is always 0
+	if ( MaxRadius <= 0.0f )
+		return false;
+
+	// The radius along the span is given by r(t)^2 = (Du0 + t.dDu)^2 + (Dv0 + t.dDv)^2 = A.t^2 + B.t + C
+	float	Du0 = 2.0f * _P.z - 1.0f, dDu = 2.0f * _Slope.z;
+	float	Dv0 = 2.0f * _P.w - 1.0f, dDv = 2.0f * _Slope.w;
+	float	A = dDu*dDu + dDv*dDv;
+	float	B = 2.0f * (Du0*dDu + Dv0*dDv);
+	float	C = Du0*Du0 + Dv0*Dv0 - MaxRadius*MaxRadius;
+	if ( A < 1e-12f )
+	{	// Constant radius along the span
+		_t0 = -FLOAT32_MAX;
+		_t1 = FLOAT32_MAX;
+		return C <= 0.0f;
+	}
+
+	float	Delta = B*B - 4.0f*A*C;
+	if ( Delta < 0.0f )
+		return false;
+
+	Delta = sqrtf( Delta );
+	_t0 = (-B - Delta) / (2.0f * A);
+	_t1 = (-B + Delta) / (2.0f * A);
+	return true;
 }
 
 
@@ -251,20 +325,15 @@ void	DrawUtils::DrawScratch( const float2& _Position, const float2& _Direction,
 	}
 }
 
-void	DrawUtils::DrawContextSCRATCH::DrawPixel()
+void	DrawUtils::DrawContextSCRATCH::DrawPixel( DrawInfos& _Infos, const float4& _P, Pixel& _Pixel ) const
 {
-	int	WrappedX = X % pOwner->m_Width;
-		WrappedX = WrappedX < 0 ? WrappedX + pOwner->m_Width : WrappedX;
-
-	pOwner->m_Infos.x = X;
-	pOwner->m_Infos.UV.Set( P.z, P.w );
-	pOwner->m_Infos.Coverage = Coverage;
+	_Infos.UV.Set( _P.z, _P.w );
 
 	// Compute distance to the center of the scratch
-	pOwner->m_Infos.Distance = 2.0f * (pOwner->m_Infos.UV.y - 0.5f);
+	_Infos.Distance = 2.0f * (_Infos.UV.y - 0.5f);
 
 	// Invoke pixel drawing
-	pFiller( pOwner->m_Infos, pScanline[WrappedX], Distance + P.z * StepDistance, U + P.z * StepU );
+	pFiller( _Infos, _Pixel, Distance + _P.z * StepDistance, U + _P.z * StepU );
 }
 
 
@@ -277,17 +346,40 @@ void	DrawUtils::Transform( const float4& _SourcePosition, float4& _TransformedPo
 	_TransformedPosition.w = _SourcePosition.w;
 }
 
-// Here, we're assuming (x,y) couples are CCW and form a convex quadrilateral
 void	DrawUtils::DrawQuad( float4 _pVertices[], DrawContext& _Context ) const
+{
+	float4	pVertices[4];
+	for ( int i=0; i < 4; i++ )
+		Transform( _pVertices[i], pVertices[i] );
+
+	if ( !m_bBatching )
+	{
+		RasterizeQuad( pVertices, _Context, m_Infos, 0, m_Height );
+		return;
+	}
+
+	// Record the quad with a copy of the context for later
+	BatchedQuad&	Quad = m_BatchedQuads.Append();
+	float			MinY = FLOAT32_MAX, MaxY = -FLOAT32_MAX;
+	for ( int i=0; i < 4; i++ )
+	{
+		Quad.pVertices[i] = pVertices[i];
+		MinY = MIN( MinY, pVertices[i].y );
+		MaxY = MAX( MaxY, pVertices[i].y );
+	}
+	Quad.pContext = _Context.Clone();
+	Quad.pData = m_Infos.pData;
+	Quad.Y0 = int( floorf( MinY ) );
+	Quad.Y1 = int( floorf( MaxY+0.5f ) ) + 1;	// Edges end on the scanline nearest to their last vertex
+}
+
+// Here, we're assuming (x,y) couples are CCW and form a convex quadrilateral
+void	DrawUtils::RasterizeQuad( const float4 _pVertices[], const DrawContext& _Context, DrawInfos& _Infos, int _ClipY0, int _ClipY1 ) const
 {
 	// Build doubled list of vertices with UVs
 	float4	pVertices[8];
-	Transform( _pVertices[0], pVertices[0] );
-	Transform( _pVertices[1], pVertices[1] );
-	Transform( _pVertices[2], pVertices[2] );
-	Transform( _pVertices[3], pVertices[3] );
 	for ( int i=0; i < 4; i++ )
-		pVertices[4+i] = pVertices[i];
+		pVertices[4+i] = pVertices[i] = _pVertices[i];
 
 	// Find top vertex
 	float	Min = FLOAT32_MAX;
@@ -299,13 +391,14 @@ void	DrawUtils::DrawQuad( float4 _pVertices[], DrawContext& _Context ) const
 			Top = i;
 		}
 
-	// Start drawing
-	_Context.Y = floorf( pVertices[Top].y );
+	// Start drawing at the first scanline whose center is below the top vertex (edges end the same way, so horizontal edges are skipped)
+	int			Y = int( floorf( pVertices[Top].y+0.5f ) );
+	int			WrappedY = Y % m_Height;
+				WrappedY = WrappedY < 0 ? WrappedY + m_Height : WrappedY;	// Ensure always positive !
 	int			LDy = 0, RDy = 0;			// Amount of pixels to trace for the left & right segments until the next segment (or end of the quad)
 	int			L = Top, R = 4+Top;			// Left & Right indices: Left will increase, Right will decrease
 	float4	LPos, RPos;					// Left & Right position & UV
 	float4	LSlope, RSlope;				// Left & Right slope
-//	while ( _Context.Y < m_Height )
 	while ( true )
 	{
 		while ( LDy <= 0.0f && L <= R )
@@ -313,81 +406,208 @@ void	DrawUtils::DrawQuad( float4 _pVertices[], DrawContext& _Context ) const
 			float4&	Current = pVertices[L];
 			float4&	Next = pVertices[++L];
 			LSlope = Next - Current;
-			int		EndY = floorf( Next.y+0.5f );
-			LDy = EndY - _Context.Y;
-// 			if ( LDy <= 0 )
-// 				continue;	// Too low a slope !
+			int		EndY = int( floorf( Next.y+0.5f ) );
+			LDy = EndY - Y;
 
 			LSlope = LSlope / LSlope.y;
-			LPos = Current + (_Context.Y+0.5f - Current.y) * LSlope;
+			LPos = Current + (Y+0.5f - Current.y) * LSlope;
 		}
 		while ( RDy <= 0.0f && L <= R )
 		{	// Rebuild right slope
 			float4&	Current = pVertices[R];
 			float4&	Next = pVertices[--R];
 			RSlope = Next - Current;
-			int		EndY = floorf( Next.y+0.5f );
-			RDy = EndY - _Context.Y;
-// 			if ( RDy <= 0 )
-// 				continue;	// Too low a slope !
+			int		EndY = int( floorf( Next.y+0.5f ) );
+			RDy = EndY - Y;
 
 			RSlope = RSlope / RSlope.y;
-			RPos = Current + (_Context.Y+0.5f - Current.y) * RSlope;
+			RPos = Current + (Y+0.5f - Current.y) * RSlope;
 		}
 		if ( L > R )
 			break;	// The quad is over !
 
-		// Draw the scanline
-		// The comments left here are the original lines you need to draw in CLAMP mode
-//		if ( _Context.Y > 0 )
+		// Draw the scanline (there is no clipping along X since we wrap)
+		if ( WrappedY >= _ClipY0 && WrappedY < _ClipY1 )
 		{
-			_Context.X = floorf( LPos.x );
-//			bool		bClipLeft = _Context.X < 0;
-			bool		bClipLeft = false;	// Don't ever clip since we wrap !
-//			_Context.X = MAX( 0, _Context.X );
-
-			int			RX = floorf( RPos.x );
-//			bool		bClipRight = RX >= m_Width;
-			bool		bClipRight = false;	// Don't ever clip since we wrap !
-//						RX = MIN( m_Width-1, RX );
-
-			// Compute slope & start position
-			float4	Slope = RPos - LPos;
+			const float4&	SpanStart = LPos.x <= RPos.x ? LPos : RPos;
+			const float4&	SpanEnd = LPos.x <= RPos.x ? RPos : LPos;
+
+			int		X0 = int( floorf( SpanStart.x ) );
+			int		X1 = int( floorf( SpanEnd.x ) );
+
+			// Compute slope & position at the center of the first pixel
+			float4	Slope = SpanEnd - SpanStart;
 			if ( Slope.x != 0.0f )
 				Slope = Slope / Slope.x;
+			float4	P0 = SpanStart + (X0+0.5f - SpanStart.x) * Slope;
 
-			_Context.P = LPos + (_Context.X+0.5f - LPos.x) * Slope;
-			_Context.NewScanline();
-
-			// Draw left pixel
-			if ( !bClipLeft )
+			// Find the range of interior pixels, that must have full coverage
+			int		InteriorX0 = X1, InteriorX1 = X1-1;
+			float	t0, t1;
+			if ( _Context.bInterior && X1 > X0+1 && _Context.GetInteriorRange( P0, Slope, t0, t1 ) )
 			{
-				_Context.Coverage = ceilf( _Context.P.x ) - LPos.x;
-				_Context.DrawPixel();
-				_Context.X++;
-				_Context.P = _Context.P + Slope;
+				static const float	EPSILON = 1e-3f;	// Leave the pixels right on the interior's boundary to the filler
+				InteriorX0 = X0 + int( ceilf( MAX( t0 + EPSILON, 1.0f ) ) );
+				InteriorX1 = X0 + int( floorf( MIN( t1 - EPSILON, float(X1-X0-1) ) ) );
 			}
 
-			// Draw full coverage pixels
-			_Context.Coverage = 1.0f;
-			for ( ; _Context.X < RX; _Context.X++ )
-			{
-				_Context.DrawPixel();
-				_Context.P = _Context.P + Slope;
-			}
+			Pixel*	pScanline = m_pSurface + m_Width * WrappedY;
+			int		WrappedX = X0 % m_Width;
+					WrappedX = WrappedX < 0 ? WrappedX + m_Width : WrappedX;
 
-			// Draw right pixel
-			if ( !bClipRight )
+			_Infos.y = Y;
+			float4	P = P0;
+			for ( int X=X0; X <= X1; )
 			{
-				_Context.Coverage = RPos.x - floorf( _Context.P.x );
-				_Context.DrawPixel();
+				if ( X == InteriorX0 && InteriorX0 <= InteriorX1 )
+				{	// Fast fill of the interior run
+					for ( ; X <= InteriorX1; X++ )
+					{
+						pScanline[WrappedX] = _Context.Interior;
+						if ( ++WrappedX == m_Width )
+							WrappedX = 0;
+					}
+					P = P0 + float(X-X0) * Slope;
+					continue;
+				}
+
+				// Analytic coverage of the edge pixels
+				if ( X0 == X1 )
+					_Infos.Coverage = SpanEnd.x - SpanStart.x;
+				else if ( X == X0 )
+					_Infos.Coverage = (X0+1) - SpanStart.x;
+				else if ( X == X1 )
+					_Infos.Coverage = SpanEnd.x - X1;
+				else
+					_Infos.Coverage = 1.0f;
+
+				_Infos.x = X;
+				_Context.DrawPixel( _Infos, P, pScanline[WrappedX] );
+
+				X++;
+				if ( ++WrappedX == m_Width )
+					WrappedX = 0;
+				P = P + Slope;
 			}
 		}
 
 		// Increment
-		_Context.Y++;
+		Y++;
+		if ( ++WrappedY == m_Height )
+			WrappedY = 0;
 		LDy--; RDy--;
 		LPos = LPos + LSlope;
 		RPos = RPos + RSlope;
 	}
 }
+
+
+//////////////////////////////////////////////////////////////////////////
+// Batching
+// The surface is split into bands of scanlines, each band rasterizes all the quads overlapping it in submission order
+static const int	BATCH_BAND_HEIGHT = 16;
+
+class	DrawUtils::BatchTask : public IJob
+{
+	const DrawUtils&	m_Owner;
+	List<int>*			m_pBandQuads;		// Indices of the quads overlapping each band
+	int					m_BandsCount;
+	volatile LONG		m_NextBandIndex;
+
+public:
+
+	BatchTask( const DrawUtils& _Owner )
+		: m_Owner( _Owner )
+		, m_NextBandIndex( 0 )
+	{
+		m_BandsCount = (m_Owner.m_Height + BATCH_BAND_HEIGHT-1) / BATCH_BAND_HEIGHT;
+		m_pBandQuads = new List<int>[m_BandsCount];
+
+		// Bin the quads
+		for ( int QuadIndex=0; QuadIndex < m_Owner.m_BatchedQuads.GetCount(); QuadIndex++ )
+		{
+			const BatchedQuad&	Quad = m_Owner.m_BatchedQuads[QuadIndex];
+			int	RowsCount = Quad.Y1 - Quad.Y0;
+			if ( RowsCount >= m_Owner.m_Height )
+			{	// Covers the entire surface
+				for ( int BandIndex=0; BandIndex < m_BandsCount; BandIndex++ )
+					m_pBandQuads[BandIndex].Append( QuadIndex );
+				continue;
+			}
+
+			int	WrappedY0 = Quad.Y0 % m_Owner.m_Height;
+				WrappedY0 = WrappedY0 < 0 ? WrappedY0 + m_Owner.m_Height : WrappedY0;
+			BinRows( QuadIndex, WrappedY0, MIN( WrappedY0 + RowsCount, m_Owner.m_Height ) );
+			if ( WrappedY0 + RowsCount > m_Owner.m_Height )
+				BinRows( QuadIndex, 0, WrappedY0 + RowsCount - m_Owner.m_Height );	// Rows wrapping at the top of the surface
+		}
+	}
+	~BatchTask()
+	{
+		delete[] m_pBandQuads;
+	}
+
+	void			BinRows( int _QuadIndex, int _Y0, int _Y1 )
+	{
+		for ( int BandIndex=_Y0 / BATCH_BAND_HEIGHT; BandIndex <= (_Y1-1) / BATCH_BAND_HEIGHT; BandIndex++ )
+		{
+			List<int>&	Quads = m_pBandQuads[BandIndex];
+			if ( Quads.GetCount() == 0 || Quads[Quads.GetCount()-1] != _QuadIndex )
+				Quads.Append( _QuadIndex );	// Don't add the quad twice if both its ends overlap the band
+		}
+	}
+
+	void			Execute()
+	{
+		JobQueue&	Jobs = gs_Device.Jobs();
+		int			HelpersCount = MIN( Jobs.GetHelpersCount(), m_BandsCount-1 );
+		for ( int HelperIndex=0; HelperIndex < HelpersCount; HelperIndex++ )
+			Jobs.Push( *this );
+		Run();
+		if ( HelpersCount > 0 )
+			Jobs.Wait();
+	}
+
+	virtual void	Run()
+	{
+		DrawInfos	Infos = m_Owner.m_Infos;	// Each thread needs its own infos
+		for ( ;; )
+		{
+			int	BandIndex = InterlockedIncrement( &m_NextBandIndex ) - 1;
+			if ( BandIndex >= m_BandsCount )
+				return;
+
+			int			Y0 = BATCH_BAND_HEIGHT * BandIndex;
+			int			Y1 = MIN( Y0 + BATCH_BAND_HEIGHT, m_Owner.m_Height );
+			List<int>&	Quads = m_pBandQuads[BandIndex];
+			for ( int i=0; i < Quads.GetCount(); i++ )
+			{
+				const BatchedQuad&	Quad = m_Owner.m_BatchedQuads[Quads[i]];
+				Infos.pData = Quad.pData;
+				m_Owner.RasterizeQuad( Quad.pVertices, *Quad.pContext, Infos, Y0, Y1 );
+			}
+		}
+	}
+};
+
+void	DrawUtils::BeginBatch()
+{
+	ASSERT( !m_bBatching, "Already batching!" );
+	m_bBatching = true;
+}
+
+void	DrawUtils::EndBatch()
+{
+	ASSERT( m_bBatching, "Did you forget to call BeginBatch()?" );
+	m_bBatching = false;
+
+	if ( m_BatchedQuads.GetCount() > 0 )
+	{
+		BatchTask	Task( *this );
+		Task.Execute();
+	}
+
+	for ( int QuadIndex=0; QuadIndex < m_BatchedQuads.GetCount(); QuadIndex++ )
+		delete m_BatchedQuads[QuadIndex].pContext;
+	m_BatchedQuads.Clear();
+}
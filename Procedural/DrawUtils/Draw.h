@@ -1,5 +1,14 @@
 // Drawing helpers
 //
+// Primitives are rasterized as spans of scanlines: the coverage of the edge pixels is computed once per span, and rectangles
+//	and ellipses can be given an interior pixel that is directly written in the pixels farther than a given distance from the
+//	border, the fill delegate is then only invoked for the pixels in between.
+//
+// Primitives drawn between BeginBatch() and EndBatch() are only recorded, then binned into bands of scanlines that are
+//	rasterized in parallel by the worker threads when the batch ends. Primitives are drawn in the order they were
+//	submitted within each band so the result is the same as with immediate drawing.
+//	WARNING: The fill delegates of batched primitives must be thread-safe (i.e. only write _Pixel and only read constant data)!
+//
 #pragma once
 
 #include "../FatPixel.h"
@@ -23,27 +32,30 @@ public:		// NESTED TYPES
 
 protected:
 
+	// The parameters of a primitive, they are never modified by the rasterization so they can be shared by several threads
 	struct	DrawContext
 	{
-		DrawUtils*	pOwner;
-		int			X, Y;			// Currently drawn pixel in SURFACE space
-		float4	P;				// Current position + UV
-		float		Coverage;		// Pixel coverage
-		Pixel*		pScanline;		// Current scanline
-		virtual void	NewScanline()
-		{
-			int	WrappedY = Y % pOwner->m_Height;
-				WrappedY = WrappedY < 0 ? WrappedY + pOwner->m_Height : WrappedY;	// Ensure always positive !
-
-			pScanline = pOwner->m_pSurface + pOwner->m_Width * WrappedY;
-			pOwner->m_Infos.y = Y;
-		}
-		virtual void	DrawPixel() = 0;
+		bool			bInterior;			// True if pixels with full coverage whose distance is at least InteriorDistance are set to Interior
+		float			InteriorDistance;
+		Pixel			Interior;
+
+		DrawContext() : bInterior( false )	{}
+		virtual ~DrawContext()	{}
+
+		virtual DrawContext*	Clone() const = 0;
+
+		// Computes the distance & UVs of the pixel at position _P (position + UV) and invokes the filler
+		virtual void	DrawPixel( DrawInfos& _Infos, const float4& _P, Pixel& _Pixel ) const = 0;
+
+		// Returns the range [_t0,_t1] of the span _P + t * _Slope whose pixels are interior (only called if bInterior is true)
+		virtual bool	GetInteriorRange( const float4& _P, const float4& _Slope, float& _t0, float& _t1 ) const	{ return false; }
 	};
 
 	struct	DrawContextRECT : public DrawContext
 	{
-		virtual void	DrawPixel();
+		virtual DrawContext*	Clone() const	{ return new DrawContextRECT( *this ); }
+		virtual void	DrawPixel( DrawInfos& _Infos, const float4& _P, Pixel& _Pixel ) const;
+		virtual bool	GetInteriorRange( const float4& _P, const float4& _Slope, float& _t0, float& _t1 ) const;
 
 		float			w, h;			// Rectangle width/height
 		float			x0, y0, x1, y1;	// Borders
@@ -53,7 +65,8 @@ protected:
 
 	struct	DrawContextLINE : public DrawContext
 	{
-		virtual void	DrawPixel();
+		virtual DrawContext*	Clone() const	{ return new DrawContextLINE( *this ); }
+		virtual void	DrawPixel( DrawInfos& _Infos, const float4& _P, Pixel& _Pixel ) const;
 
 		float			dU;				// Small portion of UV space along U that offsets to the line's start
 		FillDelegate	pFiller;		// Filler delegate
@@ -61,7 +74,9 @@ protected:
 
 	struct	DrawContextELLIPSE : public DrawContext
 	{
-		virtual void	DrawPixel();
+		virtual DrawContext*	Clone() const	{ return new DrawContextELLIPSE( *this ); }
+		virtual void	DrawPixel( DrawInfos& _Infos, const float4& _P, Pixel& _Pixel ) const;
+		virtual bool	GetInteriorRange( const float4& _P, const float4& _Slope, float& _t0, float& _t1 ) const;
 
 		float			w, h;			// Rectangle width/height
 		float			x0, y0, x1, y1;	// Borders
@@ -72,7 +87,8 @@ protected:
 
 	struct	DrawContextSCRATCH : public DrawContext
 	{
-		virtual void	DrawPixel();
+		virtual DrawContext*	Clone() const	{ return new DrawContextSCRATCH( *this ); }
+		virtual void	DrawPixel( DrawInfos& _Infos, const float4& _P, Pixel& _Pixel ) const;
 
 		float		Distance;
 		float		StepDistance;
@@ -82,6 +98,17 @@ protected:
 		ScratchFillDelegate	pFiller;	// Filler delegate
 	};
 
+	// A recorded quad (cf. BeginBatch())
+	struct	BatchedQuad
+	{
+		float4			pVertices[4];	// Transformed vertices
+		DrawContext*	pContext;		// Copy of the context at the time the quad was drawn
+		void*			pData;
+		int				Y0, Y1;			// Range of scanlines covered by the quad (not wrapped)
+	};
+
+	class	BatchTask;
+
 protected:	// FIELDS
 
 	int			m_Width;
@@ -100,9 +127,13 @@ protected:	// FIELDS
 
 	mutable DrawContextSCRATCH	m_ContextSCRATCH;
 
+	bool						m_bBatching;
+	mutable List<BatchedQuad>	m_BatchedQuads;
+
 public:		// METHODS
 
 	DrawUtils();
+	~DrawUtils();
 
 	void	SetupSurface( int _Width, int _Height, Pixel* _pSurface );
 	void	SetupSurface( TextureBuilder& _TB );
@@ -111,12 +142,15 @@ public:		// METHODS
 	// Draws a rectangle
 	//	border = thickness of the border
 	//	bias = bias in the border computation [0,1]. 1 shifts the border toward the outside of the rectangle.
-	void	DrawRectangle( float x, float y, float w, float h, float border, float bias, FillDelegate _Filler, void* _pData ) const;
+	//	_pInterior, if not NULL, is directly written in the pixels with full coverage whose distance is at least _InteriorDistance
+	//		instead of invoking the filler (i.e. the filler must return that pixel for these distances)
+	void	DrawRectangle( float x, float y, float w, float h, float border, float bias, FillDelegate _Filler, void* _pData, const Pixel* _pInterior=NULL, float _InteriorDistance=1.0f ) const;
 
 	// Draws an ellipse
 	//	border = thickness of the border
 	//	bias = bias in the border computation [0,1]. 1 shifts the border toward the outside of the rectangle.
-	void	DrawEllipse( float x, float y, float w, float h, float border, float bias, FillDelegate _Filler, void* _pData ) const;
+	//	_pInterior, cf. DrawRectangle()
+	void	DrawEllipse( float x, float y, float w, float h, float border, float bias, FillDelegate _Filler, void* _pData, const Pixel* _pInterior=NULL, float _InteriorDistance=1.0f ) const;
 
 	// Draws a line
 	void	DrawLine( float x0, float y0, float x1, float y1, float thickness, FillDelegate _Filler, void* _pData ) const;
@@ -132,7 +166,15 @@ public:		// METHODS
 
 	void	DrawSplotch( const float2& _Position, const float2& _Size, float _Angle, const Noise& _Noise, float _Perturbation ) const;
 
+
+	// =================== Batching ===================
+	void	BeginBatch();	// Primitives are recorded until EndBatch() is called
+	void	EndBatch();		// Draws the recorded primitives in parallel
+
 protected:
 	void	DrawQuad( float4 _pVertices[], DrawContext& _Context ) const;
 	void	Transform( const float4& _SourcePosition, float4& _TransformedPosition ) const;
+
+	// Rasterizes the scanlines of a transformed quad whose wrapped Y lies within [_ClipY0,_ClipY1[
+	void	RasterizeQuad( const float4 _pVertices[], const DrawContext& _Context, DrawInfos& _Infos, int _ClipY0, int _ClipY1 ) const;
 };
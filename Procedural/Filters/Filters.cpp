@@ -1,200 +1,285 @@
 #include "../../GodComplex.h"
 
 //////////////////////////////////////////////////////////////////////////
-// Gaussian Blur
-struct __BlurStruct
-{
-	TextureBuilder*	pSource;
-	int		W, H;
-	int		Size;
-	float*	pWeights;
-	float	InvSumWeights;
-};
-
-// Wrap versions
-void	FillBlurGaussianHW( int _X, int _Y, const float2& _UV, Pixel& _Pixel, void* _pData )
+// Separable line filters
+// A separable filter is applied in 2 passes on the filtered channels of the builder (RGBA, Height & Roughness, when stored):
+//	_ The first pass filters the rows of the builder and writes them transposed into a temporary planar buffer
+//	_ The second pass filters the rows of that buffer (i.e. the columns of the builder) and writes them back transposed
+// Both passes thus read contiguous lines, and lines are processed in batches so the transposed writes are grouped.
+// Metallic & MatID are never filtered.
+//
+namespace
 {
-	__BlurStruct&	Data = *((__BlurStruct*) _pData);
-
-	float	Xl = _X-1.0f, Xr = _X+1.0f;
-	float	Y = float(_Y);
+	static const int	MAX_FILTERED_CHANNELS = 6;	// RGBA, Height & Roughness
+	static const int	LINES_PER_BATCH = 8;		// Lines processed together to group transposed writes
 
-	Data.pSource->SampleWrap( float(_X), Y, 0, _Pixel );
-
-	Pixel	Temp;
-	for ( int i=0; i < Data.Size; i++ )
+	// Fills the _Padding values on each side of a line of _Length values, wrapping or clamping
+	void	PadLine( float* _pLine, int _Length, int _Padding, bool _bWrap )
 	{
-		float	Weight = Data.pWeights[i];
-
-		// Accumulate from the left
-		Data.pSource->SampleWrap( Xl, Y, 0, Temp );	Xl--;
-		_Pixel.RGBA = _Pixel.RGBA + Weight * Temp.RGBA;
-		_Pixel.Height += Weight * Temp.Height;
-		_Pixel.Roughness += Weight * Temp.Roughness;
-
-		// Accumulate from the right
-		Data.pSource->SampleWrap( Xr, Y, 0, Temp );	Xr++;
-		_Pixel.RGBA = _Pixel.RGBA + Weight * Temp.RGBA;
-		_Pixel.Height += Weight * Temp.Height;
-		_Pixel.Roughness += Weight * Temp.Roughness;
+		for ( int i=1; i <= _Padding; i++ )
+		{
+			_pLine[-i] = _pLine[_bWrap ? (_Length - i % _Length) % _Length : 0];
+			_pLine[_Length-1+i] = _pLine[_bWrap ? (i-1) % _Length : _Length-1];
+		}
 	}
 
-	// Normalize result
-	_Pixel.RGBA = Data.InvSumWeights * _Pixel.RGBA;
-	_Pixel.Roughness *= Data.InvSumWeights;
-	_Pixel.Height *= Data.InvSumWeights;
-}
-void	FillBlurGaussianVW( int _X, int _Y, const float2& _UV, Pixel& _Pixel, void* _pData )
-{
-	__BlurStruct&	Data = *((__BlurStruct*) _pData);
+	// A filter applied to a single line
+	class	LineFilter
+	{
+	public:
+		virtual ~LineFilter()	{}
 
-	float	X = float(_X);
-	float	Yl = _Y-1.0f, Yr = _Y+1.0f;
+		// Returns the amount of padding values the filter reads on each side of the line
+		virtual int		GetPadding() const = 0;
 
-	Data.pSource->SampleWrap( X, float(_Y), 0, _Pixel );
+		// Filters a padded line of _Length values into _pResult.
+		//	_pLine and the 2 scratch lines are [-Padding,_Length+Padding[ large, the filter may overwrite them
+		virtual void	Filter( float* _pLine, int _Length, bool _bWrap, float* _pScratch0, float* _pScratch1, float* _pResult ) const = 0;
+	};
 
-	Pixel	Temp;
-	for ( int i=0; i < Data.Size; i++ )
+	class	SeparableTask : public IJob
 	{
-		float	Weight = Data.pWeights[i];
-
-		// Accumulate from the top
-		Data.pSource->SampleWrap( X, Yl, 0, Temp );	Yl--;
-		_Pixel.RGBA = _Pixel.RGBA + Weight * Temp.RGBA;
-		_Pixel.Height += Weight * Temp.Height;
-		_Pixel.Roughness += Weight * Temp.Roughness;
-
-		// Accumulate from the bottom
-		Data.pSource->SampleWrap( X, Yr, 0, Temp );	Yr++;
-		_Pixel.RGBA = _Pixel.RGBA + Weight * Temp.RGBA;
-		_Pixel.Height += Weight * Temp.Height;
-		_Pixel.Roughness += Weight * Temp.Roughness;
-	}
-
-	// Normalize result
-	_Pixel.RGBA = Data.InvSumWeights * _Pixel.RGBA;
-	_Pixel.Roughness *= Data.InvSumWeights;
-	_Pixel.Height *= Data.InvSumWeights;
-}
-// Clamp versions
-void	FillBlurGaussianHC( int _X, int _Y, const float2& _UV, Pixel& _Pixel, void* _pData )
-{
-	__BlurStruct&	Data = *((__BlurStruct*) _pData);
+		const LineFilter*	m_pFilter;
+		bool				m_bWrap;
+		int					m_ChannelsCount;
+		float*				m_ppChannels[MAX_FILTERED_CHANNELS];	// First value of each channel in the builder
+		int					m_pStrides[MAX_FILTERED_CHANNELS];		// Stride between 2 values of each channel
+		float*				m_pTransposed;		// m_ChannelsCount planes of W*H values
+		int					m_Width;
+		int					m_Height;
+		int					m_Pass;				// 0 = rows towards the transposed planes, 1 = transposed planes back to the pixels
+		int					m_BatchesCount;
+		volatile LONG		m_NextBatchIndex;
+
+	public:
+
+		SeparableTask( TextureBuilder& _Builder, bool _bWrap )
+			: m_pFilter( NULL ), m_bWrap( _bWrap ), m_ChannelsCount( 0 ), m_Width( _Builder.GetWidth() ), m_Height( _Builder.GetHeight() )
+		{
+			// Collect the stored channels
+			int		Stride;
+			float*	pRGBA = _Builder.GetChannel( 0, TextureBuilder::CHANNEL_RGBA, Stride );
+			for ( int ComponentIndex=0; pRGBA != NULL && ComponentIndex < 4; ComponentIndex++ )
+			{
+				m_ppChannels[m_ChannelsCount] = pRGBA + ComponentIndex;
+				m_pStrides[m_ChannelsCount++] = Stride;
+			}
+			TextureBuilder::CHANNEL	pChannels[2] = { TextureBuilder::CHANNEL_HEIGHT, TextureBuilder::CHANNEL_ROUGHNESS };
+			for ( int ChannelIndex=0; ChannelIndex < 2; ChannelIndex++ )
+				if ( (m_ppChannels[m_ChannelsCount] = _Builder.GetChannel( 0, pChannels[ChannelIndex], Stride )) != NULL )
+					m_pStrides[m_ChannelsCount++] = Stride;
+
+			m_pTransposed = new float[m_ChannelsCount*m_Width*m_Height];
+		}
+		~SeparableTask()
+		{
+			delete[] m_pTransposed;
+		}
 
-	float	Xl = _X-1.0f, Xr = _X+1.0f;
-	float	Y = float(_Y);
+		void	Execute( int _Pass, const LineFilter& _Filter )
+		{
+			m_pFilter = &_Filter;
+			m_Pass = _Pass;
+			m_BatchesCount = ((_Pass == 0 ? m_Height : m_Width) + LINES_PER_BATCH-1) / LINES_PER_BATCH;
+			m_NextBatchIndex = 0;
+
+			JobQueue&	Jobs = gs_Device.Jobs();
+			int			HelpersCount = MIN( Jobs.GetHelpersCount(), m_BatchesCount-1 );
+			for ( int HelperIndex=0; HelperIndex < HelpersCount; HelperIndex++ )
+				Jobs.Push( *this );
+			Run();
+			if ( HelpersCount > 0 )
+				Jobs.Wait();
+		}
 
-	Data.pSource->SampleClamp( float(_X), Y, 0, _Pixel );
+		virtual void	Run()
+		{
+			int		LinesCount = m_Pass == 0 ? m_Height : m_Width;
+			int		Length = m_Pass == 0 ? m_Width : m_Height;
+			int		Padding = m_pFilter->GetPadding();
+			int		PaddedLength = Length + 2*Padding;
+			int		PixelsCount = m_Width * m_Height;
+
+			float*	pBuffers = new float[4*PaddedLength];
+			float*	pLine = pBuffers + Padding;
+			float*	pScratch0 = pLine + PaddedLength;
+			float*	pScratch1 = pScratch0 + PaddedLength;
+			float*	pResult = pScratch1 + PaddedLength;
+
+			for ( ;; )
+			{
+				int	BatchIndex = InterlockedIncrement( &m_NextBatchIndex ) - 1;
+				if ( BatchIndex >= m_BatchesCount )
+					break;
+
+				int	LineStart = LINES_PER_BATCH * BatchIndex;
+				int	LineEnd = MIN( LineStart + LINES_PER_BATCH, LinesCount );
+				for ( int ChannelIndex=0; ChannelIndex < m_ChannelsCount; ChannelIndex++ )
+				{
+					float*	pPlane = m_pTransposed + PixelsCount * ChannelIndex;
+					int		Stride = m_pStrides[ChannelIndex];
+					for ( int LineIndex=LineStart; LineIndex < LineEnd; LineIndex++ )
+					{
+						if ( m_Pass == 0 )
+						{
+							const float*	pScanline = m_ppChannels[ChannelIndex] + Stride * m_Width * LineIndex;
+							for ( int i=0; i < Length; i++, pScanline+=Stride )
+								pLine[i] = *pScanline;
+
+							m_pFilter->Filter( pLine, Length, m_bWrap, pScratch0, pScratch1, pResult );
+
+							float*	pColumn = pPlane + LineIndex;
+							for ( int i=0; i < Length; i++, pColumn+=m_Height )
+								*pColumn = pResult[i];
+						}
+						else
+						{
+							memcpy( pLine, pPlane + m_Height * LineIndex, Length*sizeof(float) );
+
+							m_pFilter->Filter( pLine, Length, m_bWrap, pScratch0, pScratch1, pResult );
+
+							float*	pColumn = m_ppChannels[ChannelIndex] + Stride * LineIndex;
+							for ( int i=0; i < Length; i++, pColumn+=Stride*m_Width )
+								*pColumn = pResult[i];
+						}
+					}
+				}
+			}
+
+			delete[] pBuffers;
+		}
+	};
 
-	Pixel	Temp;
-	for ( int i=0; i < Data.Size; i++ )
+	// Applies a filter on the rows then on the columns of the builder
+	void	ApplySeparable( TextureBuilder& _Builder, const LineFilter& _FilterRows, const LineFilter& _FilterColumns, bool _bWrap )
 	{
-		float	Weight = Data.pWeights[i];
-
-		// Accumulate from the left
-		Data.pSource->SampleClamp( Xl, Y, 0, Temp );	Xl--;
-		_Pixel.RGBA = _Pixel.RGBA + Weight * Temp.RGBA;
-		_Pixel.Height += Weight * Temp.Height;
-		_Pixel.Roughness += Weight * Temp.Roughness;
-
-		// Accumulate from the right
-		Data.pSource->SampleClamp( Xr, Y, 0, Temp );	Xr++;
-		_Pixel.RGBA = _Pixel.RGBA + Weight * Temp.RGBA;
-		_Pixel.Height += Weight * Temp.Height;
-		_Pixel.Roughness += Weight * Temp.Roughness;
-	}
+		SeparableTask	Task( _Builder, _bWrap );
+		Task.Execute( 0, _FilterRows );
+		Task.Execute( 1, _FilterColumns );
 
-	// Normalize result
-	_Pixel.RGBA = Data.InvSumWeights * _Pixel.RGBA;
-	_Pixel.Roughness *= Data.InvSumWeights;
-	_Pixel.Height *= Data.InvSumWeights;
+		_Builder.InvalidateMips();
+	}
 }
-void	FillBlurGaussianVC( int _X, int _Y, const float2& _UV, Pixel& _Pixel, void* _pData )
-{
-	__BlurStruct&	Data = *((__BlurStruct*) _pData);
 
-	float	X = float(_X);
-	float	Yl = _Y-1.0f, Yr = _Y+1.0f;
 
-	Data.pSource->SampleClamp( X, float(_Y), 0, _Pixel );
+//////////////////////////////////////////////////////////////////////////
+// Gaussian Blur
+// Small kernels are convolved directly, larger ones are approximated by a cascade of 3 box filters computed with
+//	running sums so their cost doesn't depend on the kernel size anymore
+//
+namespace
+{
+	static const float	BOX_CASCADE_MIN_SIZE = 8.0f;	// Kernel half size above which we switch to the box cascade
+	static const int	BOXES_COUNT = 3;
 
-	Pixel	Temp;
-	for ( int i=0; i < Data.Size; i++ )
+	class	GaussianFilter : public LineFilter
 	{
-		float	Weight = Data.pWeights[i];
-
-		// Accumulate from the top
-		Data.pSource->SampleClamp( X, Yl, 0, Temp );	Yl--;
-		_Pixel.RGBA = _Pixel.RGBA + Weight * Temp.RGBA;
-		_Pixel.Height += Weight * Temp.Height;
-		_Pixel.Roughness += Weight * Temp.Roughness;
-
-		// Accumulate from the bottom
-		Data.pSource->SampleClamp( X, Yr, 0, Temp );	Yr++;
-		_Pixel.RGBA = _Pixel.RGBA + Weight * Temp.RGBA;
-		_Pixel.Height += Weight * Temp.Height;
-		_Pixel.Roughness += Weight * Temp.Roughness;
-	}
+		int		m_Size;
+		float*	m_pWeights;
+		float	m_InvSumWeights;
 
-	// Normalize result
-	_Pixel.RGBA = Data.InvSumWeights * _Pixel.RGBA;
-	_Pixel.Roughness *= Data.InvSumWeights;
-	_Pixel.Height *= Data.InvSumWeights;
-}
+	public:
 
-void	Filters::BlurGaussian( TextureBuilder& _Builder, float _SizeX, float _SizeY, bool _bWrap, float _MinWeight )
-{
-	int	W = _Builder.GetWidth(), H = _Builder.GetHeight();
+		GaussianFilter( float _Size, float _MinWeight )
+		{
+			m_Size = int( ceilf( _Size ) );
+			float	k = logf( _MinWeight ) / (_Size*_Size);
+
+			m_pWeights = new float[m_Size];
+			m_InvSumWeights = 1.0f;
+			for ( int i=0; i < m_Size; i++ )
+			{
+				m_pWeights[i] = expf( k * (1+i)*(1+i) );
+				m_InvSumWeights += 2.0f * m_pWeights[i];
+			}
+			m_InvSumWeights = 1.0f / m_InvSumWeights;
+		}
+		~GaussianFilter()	{ delete[] m_pWeights; }
 
-	TextureBuilder	Temp( W, H );
+		virtual int		GetPadding() const	{ return m_Size; }
 
-	// Apply horizontal pass
+		virtual void	Filter( float* _pLine, int _Length, bool _bWrap, float* _pScratch0, float* _pScratch1, float* _pResult ) const
+		{
+			PadLine( _pLine, _Length, m_Size, _bWrap );
+			for ( int X=0; X < _Length; X++ )
+			{
+				float	Sum = _pLine[X];
+				for ( int i=0; i < m_Size; i++ )
+					Sum += m_pWeights[i] * (_pLine[X-1-i] + _pLine[X+1+i]);
+				_pResult[X] = m_InvSumWeights * Sum;
+			}
+		}
+	};
+
+	class	BoxCascadeFilter : public LineFilter
 	{
-		__BlurStruct	BS;
-		BS.pSource = &_Builder;
-		BS.W = W;
-		BS.H = H;
+		int		m_pRadii[BOXES_COUNT];
 
-		BS.Size = ceilf( _SizeX );
-		float	k = logf( _MinWeight ) / (_SizeX*_SizeX);
+	public:
 
-		BS.pWeights = new float[BS.Size];
-		BS.InvSumWeights = 1.0f;
-		for ( int i=0; i < BS.Size; i++ )
+		// Computes the widths of the boxes that best approximate a gaussian of deviation _Sigma (cf. "Fast Almost-Gaussian Filtering", P. Kovesi)
+		BoxCascadeFilter( float _Sigma )
 		{
-			BS.pWeights[i] = expf( k * (1+i)*(1+i) );
-			BS.InvSumWeights += 2.0f * BS.pWeights[i];
+			float	Variance = 12.0f * _Sigma*_Sigma;
+			int		LowWidth = int( floorf( sqrtf( Variance / BOXES_COUNT + 1.0f ) ) );
+			if ( (LowWidth & 1) == 0 )
+				LowWidth--;
+
+			int		LowBoxesCount = int( floorf( 0.5f + (Variance - BOXES_COUNT*LowWidth*LowWidth - 4*BOXES_COUNT*LowWidth - 3*BOXES_COUNT) / (-4*LowWidth - 4) ) );
+			for ( int BoxIndex=0; BoxIndex < BOXES_COUNT; BoxIndex++ )
+				m_pRadii[BoxIndex] = ((BoxIndex < LowBoxesCount ? LowWidth : LowWidth+2) - 1) / 2;
 		}
-		BS.InvSumWeights = 1.0f / BS.InvSumWeights;
 
-		Temp.Fill( _bWrap ? FillBlurGaussianHW : FillBlurGaussianHC, &BS );
+		virtual int		GetPadding() const	{ return MAX( m_pRadii[0], m_pRadii[BOXES_COUNT-1] ); }
 
-		delete[] BS.pWeights;
-	}
+		virtual void	Filter( float* _pLine, int _Length, bool _bWrap, float* _pScratch0, float* _pScratch1, float* _pResult ) const
+		{
+			float*	pSource = _pLine;
+			for ( int BoxIndex=0; BoxIndex < BOXES_COUNT; BoxIndex++ )
+			{
+				float*	pTarget = BoxIndex == BOXES_COUNT-1 ? _pResult : (BoxIndex & 1 ? _pScratch1 : _pScratch0);
+				int		Radius = m_pRadii[BoxIndex];
+				double	InvWidth = 1.0 / (2*Radius+1);
+
+				PadLine( pSource, _Length, Radius, _bWrap );
+
+				double	Sum = 0.0;	// We accumulate in double to avoid drifting on long lines
+				for ( int i=-Radius; i <= Radius; i++ )
+					Sum += pSource[i];
+				pTarget[0] = float( InvWidth * Sum );
+
+				for ( int X=1; X < _Length; X++ )
+				{
+					Sum += pSource[X+Radius] - pSource[X-1-Radius];
+					pTarget[X] = float( InvWidth * Sum );
+				}
+
+				pSource = pTarget;
+			}
+		}
+	};
 
-	// Apply vertical pass
+	// Applies a single 1D gaussian pass
+	LineFilter*	CreateGaussianFilter( float _Size, float _MinWeight )
 	{
-		__BlurStruct	BS;
-		BS.pSource = &Temp;
-		BS.W = W;
-		BS.H = H;
+		if ( _Size <= BOX_CASCADE_MIN_SIZE )
+			return new GaussianFilter( _Size, _MinWeight );
 
-		BS.Size = ceilf( _SizeY );
-		float	k = logf( _MinWeight ) / (_SizeY*_SizeY);
+		// The weight exp( k.x² ) reaches _MinWeight at _Size so k = log(_MinWeight) / _Size² = -1 / (2.Sigma²)
+		float	Sigma = _Size / sqrtf( -2.0f * logf( _MinWeight ) );
+		return new BoxCascadeFilter( Sigma );
+	}
+}
 
-		BS.pWeights = new float[BS.Size];
-		BS.InvSumWeights = 1.0f;
-		for ( int i=0; i < BS.Size; i++ )
-		{
-			BS.pWeights[i] = expf( k * (1+i)*(1+i) );
-			BS.InvSumWeights += 2.0f * BS.pWeights[i];
-		}
-		BS.InvSumWeights = 1.0f / BS.InvSumWeights;
+void	Filters::BlurGaussian( TextureBuilder& _Builder, float _SizeX, float _SizeY, bool _bWrap, float _MinWeight )
+{
+	LineFilter*	pFilterH = CreateGaussianFilter( _SizeX, _MinWeight );
+	LineFilter*	pFilterV = CreateGaussianFilter( _SizeY, _MinWeight );
 
-		_Builder.Fill( _bWrap ? FillBlurGaussianVW : FillBlurGaussianVC, &BS );
+	ApplySeparable( _Builder, *pFilterH, *pFilterV, _bWrap );
 
-		delete[] BS.pWeights;
-	}
+	delete pFilterV;
+	delete pFilterH;
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -219,12 +304,12 @@ void	FillUnsharpMaskSubtract( int _X, int _Y, const float2& _UV, Pixel& _Pixel,
 void	Filters::UnsharpMask( TextureBuilder& _Builder, float _Size )
 {
 	// Blur the source
-	TextureBuilder	Temp( _Builder.GetWidth(), _Builder.GetHeight() );
+	TextureBuilder	Temp( _Builder.GetWidth(), _Builder.GetHeight(), _Builder.GetPlanarChannels() );
 	Temp.CopyFrom( _Builder );
 	BlurGaussian( Temp, _Size, _Size );
 
 	// Subtract
-	_Builder.Fill( FillUnsharpMaskSubtract, &Temp );
+	_Builder.Fill( FillUnsharpMaskSubtract, &Temp, true );
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -254,7 +339,7 @@ void	Filters::BrightnessContrastGamma( TextureBuilder& _Builder, float _Brightne
 	BCG.C = tanf( HALFPI * 0.5f * (1.0f + _Contrast) );
 	BCG.G = _Gamma;
 
-	_Builder.Fill( FillBCG, &BCG );
+	_Builder.Fill( FillBCG, &BCG, true );
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -289,93 +374,115 @@ void	Filters::Emboss( TextureBuilder& _Builder, const float2& _Direction, float
 	Params.Direction.Normalize();
 	Params.Amplitude = _Amplitude;
 
-	_Builder.Fill( FillEmboss, &Params );
+	_Builder.Fill( FillEmboss, &Params, true );
 }
 
 
 //////////////////////////////////////////////////////////////////////////
-// Erosion
-struct __ErosionStruct
+// Erosion & Dilation
+// The min/max over the (2S+1)x(2S+1) square kernel is separable, each line is filtered using the van Herk/Gil-Werman
+//	algorithm: the padded line is split into blocks the size of the kernel where we compute the running min/max from
+//	the start and from the end of the block. Any kernel window then spans at most 2 blocks and its min/max is simply
+//	given by the suffix of the first block and the prefix of the second, whatever the kernel size.
+// Both filters always wrap, like they always did.
+//
+namespace
 {
-	Pixel*	pSource;
-	int		W, H;
-	int		Size;
-};
-void	FillErode( int _X, int _Y, const float2& _UV, Pixel& _Pixel, void* _pData )
-{
-	__ErosionStruct&	Params = *((__ErosionStruct*) _pData);
-
-	_Pixel.RGBA = FLOAT32_MAX * float4::One;
-	_Pixel.Height = FLOAT32_MAX;
-	_Pixel.Roughness = FLOAT32_MAX;
-	for ( int Y=_Y-Params.Size; Y <= _Y+Params.Size; Y++ )
+	template<bool MAXIMUM> class	MorphologyFilter : public LineFilter
 	{
-		int		SampleY = ((Params.H+Y) % Params.H);
-		Pixel*	pScanline = &Params.pSource[Params.W * SampleY];
-		for ( int X=_X-Params.Size; X <= _X+Params.Size; X++ )
+		int		m_Size;
+
+		static float	Select( float a, float b )	{ return MAXIMUM ? MAX( a, b ) : MIN( a, b ); }
+
+	public:
+
+		MorphologyFilter( int _Size ) : m_Size( _Size )	{}
+
+		virtual int		GetPadding() const	{ return m_Size; }
+
+		virtual void	Filter( float* _pLine, int _Length, bool _bWrap, float* _pScratch0, float* _pScratch1, float* _pResult ) const
 		{
-			int	SampleX = (Params.W+X) % Params.W;
-			_Pixel.RGBA = _Pixel.RGBA.Min( pScanline[SampleX].RGBA );
-			_Pixel.Height = MIN( _Pixel.Height, pScanline[SampleX].Height );
-			_Pixel.Roughness = MIN( _Pixel.Roughness, pScanline[SampleX].Roughness );
+			PadLine( _pLine, _Length, m_Size, _bWrap );
+
+			int		KernelWidth = 2*m_Size+1;
+			int		PaddedLength = _Length + 2*m_Size;
+			float*	pSource = _pLine - m_Size;
+			float*	pPrefix = _pScratch0 - m_Size;
+			float*	pSuffix = _pScratch1 - m_Size;
+			for ( int BlockStart=0; BlockStart < PaddedLength; BlockStart+=KernelWidth )
+			{
+				int	BlockEnd = MIN( BlockStart + KernelWidth, PaddedLength );
+
+				pPrefix[BlockStart] = pSource[BlockStart];
+				for ( int i=BlockStart+1; i < BlockEnd; i++ )
+					pPrefix[i] = Select( pPrefix[i-1], pSource[i] );
+
+				pSuffix[BlockEnd-1] = pSource[BlockEnd-1];
+				for ( int i=BlockEnd-2; i >= BlockStart; i-- )
+					pSuffix[i] = Select( pSuffix[i+1], pSource[i] );
+			}
+
+			// The window of pixel X spans [X,X+KernelWidth[ in padded coordinates
+			for ( int X=0; X < _Length; X++ )
+				_pResult[X] = Select( pSuffix[X], pPrefix[X+KernelWidth-1] );
 		}
-	}
+	};
 }
 
 void	Filters::Erode( TextureBuilder& _Builder, int _KernelSize )
 {
-	TextureBuilder	Temp( _Builder.GetWidth(), _Builder.GetHeight() );
-	Temp.CopyFrom( _Builder );
-
-	__ErosionStruct	Params;
-	Params.pSource = Temp.GetMips()[0];
-	Params.W = Temp.GetWidth();
-	Params.H = Temp.GetHeight();
-	Params.Size = _KernelSize;
+	MorphologyFilter<false>	Filter( _KernelSize );
+	ApplySeparable( _Builder, Filter, Filter, true );
+}
 
-	_Builder.Fill( FillErode, &Params );
+void	Filters::Dilate( TextureBuilder& _Builder, int _KernelSize )
+{
+	MorphologyFilter<true>	Filter( _KernelSize );
+	ApplySeparable( _Builder, Filter, Filter, true );
 }
 
 
 //////////////////////////////////////////////////////////////////////////
-// Dilation
-struct __DilationStruct
+// GPU versions
+// The weights are computed by the kernels, we only provide the exponent factor and the normalizer
+//
+static void	SetupGaussianKernel( TextureBuilderGPU::KernelParams& _Params, float _Size, float _MinWeight )
 {
-	Pixel*	pSource;
-	int		W, H;
-	int		Size;
-};
-void	FillDilate( int _X, int _Y, const float2& _UV, Pixel& _Pixel, void* _pData )
+	_Params.KernelSize = U32( ceilf( _Size ) );
+	_Params.WeightFactor = logf( _MinWeight ) / (_Size*_Size);
+
+	float	SumWeights = 1.0f;
+	for ( U32 i=0; i < _Params.KernelSize; i++ )
+		SumWeights += 2.0f * expf( _Params.WeightFactor * (1+i)*(1+i) );
+	_Params.InvSumWeights = 1.0f / SumWeights;
+}
+
+void	Filters::BlurGaussian( TextureBuilderGPU& _Builder, float _SizeX, float _SizeY, bool _bWrap, float _MinWeight )
 {
-	__DilationStruct&	Params = *((__DilationStruct*) _pData);
+	TextureBuilderGPU::KernelParams	Params;
+	Params.Flags = _bWrap ? TextureBuilderGPU::FLAG_WRAP : 0;
 
-	_Pixel.RGBA = -FLOAT32_MAX * float4::One;
-	_Pixel.Height = -FLOAT32_MAX;
-	_Pixel.Roughness = -FLOAT32_MAX;
-	for ( int Y=_Y-Params.Size; Y <= _Y+Params.Size; Y++ )
-	{
-		int		SampleY = ((Params.H+Y) % Params.H);
-		Pixel*	pScanline = &Params.pSource[Params.W * SampleY];
-		for ( int X=_X-Params.Size; X <= _X+Params.Size; X++ )
-		{
-			int	SampleX = (Params.W+X) % Params.W;
-			_Pixel.RGBA = _Pixel.RGBA.Max( pScanline[SampleX].RGBA );
-			_Pixel.Height = MAX( _Pixel.Height, pScanline[SampleX].Height );
-			_Pixel.Roughness = MAX( _Pixel.Roughness, pScanline[SampleX].Roughness );
-		}
-	}
+	// Apply horizontal pass
+	SetupGaussianKernel( Params, _SizeX, _MinWeight );
+	_Builder.Run( TextureBuilderGPU::KERNEL_BLUR_H, _Builder, Params );
+
+	// Apply vertical pass
+	SetupGaussianKernel( Params, _SizeY, _MinWeight );
+	_Builder.Run( TextureBuilderGPU::KERNEL_BLUR_V, _Builder, Params );
 }
 
-void	Filters::Dilate( TextureBuilder& _Builder, int _KernelSize )
+void	Filters::Erode( TextureBuilderGPU& _Builder, int _KernelSize )
 {
-	TextureBuilder	Temp( _Builder.GetWidth(), _Builder.GetHeight() );
-	Temp.CopyFrom( _Builder );
+	TextureBuilderGPU::KernelParams	Params;
+	Params.KernelSize = _KernelSize;
 
-	__DilationStruct	Params;
-	Params.pSource = Temp.GetMips()[0];
-	Params.W = Temp.GetWidth();
-	Params.H = Temp.GetHeight();
-	Params.Size = _KernelSize;
+	_Builder.Run( TextureBuilderGPU::KERNEL_ERODE, _Builder, Params );
+}
+
+void	Filters::Dilate( TextureBuilderGPU& _Builder, int _KernelSize )
+{
+	TextureBuilderGPU::KernelParams	Params;
+	Params.KernelSize = _KernelSize;
 
-	_Builder.Fill( FillDilate, &Params );
+	_Builder.Run( TextureBuilderGPU::KERNEL_DILATE, _Builder, Params );
 }
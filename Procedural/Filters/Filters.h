@@ -19,4 +19,9 @@ public:		// METHODS
 	static void	Erode( TextureBuilder& _Builder, int _KernelSize=4 );
 
 	static void	Dilate( TextureBuilder& _Builder, int _KernelSize=4 );
+
+	// GPU versions of the above (cf. TextureBuilderGPU)
+	static void	BlurGaussian( TextureBuilderGPU& _Builder, float _SizeX, float _SizeY, bool _bWrap=true, float _MinWeight=0.05f );
+	static void	Erode( TextureBuilderGPU& _Builder, int _KernelSize=4 );
+	static void	Dilate( TextureBuilderGPU& _Builder, int _KernelSize=4 );
 };
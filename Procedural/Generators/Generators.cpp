@@ -40,119 +40,279 @@ void Generators::ComputeNormal( const TextureBuilder& _Source, TextureBuilder& _
 	Params.HeightFactor = _HeightFactor;
 	Params.bNormalize = _bNormalize;
 
-	_Target.Fill( FillNormal, &Params );
+	_Target.Fill( FillNormal, &Params, &_Source != &_Target );
 }
 
 
 //////////////////////////////////////////////////////////////////////////
 // AO
-// The algorithm here is to find the "horizon" of the height field for each of the samplings directions
-// We slice the circle of directions about the considered point then for each direction we march forward and analyze the height of the height field at that position.
-// The height and the distance we marched give us the slope of the horizon, which we keep if it exceeds the maximum for that direction.
-// In the end, we obtain a portion of horizon that is not occluded by the surrounding heights. Summing these portions we get the AO...
+// The algorithm here is to find the "horizon" of the height field for each of the sampling directions then to sum the
+//	portions of the hemisphere that are not occluded by the surrounding heights.
+// Instead of marching from every texel, each direction is swept along parallel lines that cover every texel exactly once:
+//	a line is walked backward (from the farthest point ahead) while keeping the upper convex hull of the heights already
+//	visited in a stack. The horizon of a point is the tangent from that point to the hull, which is found by popping the hull
+//	points that lie below it, and these are never needed again since the point itself hides them from the points behind.
+//	Each point is pushed & popped at most once so a direction costs O(pixels) instead of O(pixels x samples).
+// The lines of a direction are independent and spread across the worker threads.
 //
-struct __AOStruct
-{
-	const TextureBuilder*	pSource;
-	float			HeightFactor;
-	int				DirectionsCount;
-	int				SamplesCount;
-	bool			bWriteOnlyAlpha;
-};
-void	FillAO( int _X, int _Y, const float2& _UV, Pixel& _Pixel, void* _pData )
+// NOTE: The horizon is only searched within the radius (in texels), the hull points beyond the radius are dropped from
+//	the bottom of the stack so the points they were hiding are lost: the horizon is then slightly underestimated.
+//
+namespace
 {
-	__AOStruct&	Params = *((__AOStruct*) _pData);
-
-	float	SumAO = 0.0f;
-	for ( int DirectionIndex=0; DirectionIndex < Params.DirectionsCount; DirectionIndex++ )
+	class	HorizonSweepTask : public IJob
 	{
-		float		Angle = TWOPI * DirectionIndex / Params.DirectionsCount;
-		float2	Direction( cosf( Angle ), sinf( Angle ) );
+		const float*	m_pHeights;			// Copy of the source heights
+		float*			m_pVisibility;		// Accumulated visibility of every texel
+		int				m_Width;
+		int				m_Height;
+		float			m_HeightFactor;
+		float			m_Radius;
+
+		// Current direction
+		bool			m_bMajorX;			// True if lines step one texel along X
+		int				m_MajorSign;
+		int				m_MajorSize;		// Amount of texels along the major axis
+		int				m_LinesCount;		// Amount of texels along the minor axis
+		int				m_StepsCount;		// Steps of a line, including the ones ahead of the last texel
+		float			m_StepLength;		// Distance between 2 steps, in texels
+		int*			m_pMinorOffsets;	// Integer part of the minor offset at each step
+		float*			m_pMinorFractions;	// Fractional part of the minor offset at each step
+		volatile LONG	m_NextLineIndex;
+
+	public:
+
+		HorizonSweepTask( const float* _pHeights, float* _pVisibility, int _Width, int _Height, float _HeightFactor, float _Radius )
+			: m_pHeights( _pHeights ), m_pVisibility( _pVisibility ), m_Width( _Width ), m_Height( _Height ), m_HeightFactor( _HeightFactor ), m_Radius( _Radius )
+		{
+			int	MaxSteps = MAX( _Width, _Height ) + int(ceilf( _Radius )) + 1;
+			m_pMinorOffsets = new int[MaxSteps];
+			m_pMinorFractions = new float[MaxSteps];
+		}
+		~HorizonSweepTask()
+		{
+			delete[] m_pMinorFractions;
+			delete[] m_pMinorOffsets;
+		}
 
-//		NjFloat2	Position( float(_X), float(_Y) );	// For some reason, this doesn't compile !!
-		float2	Position;
-		Position.x = float(_X);
-		Position.y = float(_Y);
+		void			Execute( float _Angle )
+		{
+			float	DirX = cosf( _Angle );
+			float	DirY = sinf( _Angle );
+			m_bMajorX = fabs( DirX ) >= fabs( DirY );
+			float	Major = m_bMajorX ? DirX : DirY;
+			float	Minor = m_bMajorX ? DirY : DirX;
+			m_MajorSign = Major >= 0.0f ? 1 : -1;
+			m_MajorSize = m_bMajorX ? m_Width : m_Height;
+			m_LinesCount = m_bMajorX ? m_Height : m_Width;
+			m_StepLength = 1.0f / fabs( Major );
+			m_StepsCount = m_MajorSize + int(ceilf( m_Radius / m_StepLength ));
+
+			// All the lines of a direction share the same sub-texel offsets
+			float	MinorStep = Minor / fabs( Major );
+			for ( int Step=0; Step < m_StepsCount; Step++ )
+			{
+				float	Offset = Step * MinorStep;
+				m_pMinorOffsets[Step] = int(floorf( Offset ));
+				m_pMinorFractions[Step] = Offset - m_pMinorOffsets[Step];
+			}
+
+			m_NextLineIndex = 0;
+			JobQueue&	Jobs = gs_Device.Jobs();
+			int			HelpersCount = MIN( Jobs.GetHelpersCount(), m_LinesCount / 16 );
+			for ( int HelperIndex=0; HelperIndex < HelpersCount; HelperIndex++ )
+				Jobs.Push( *this );
+			Run();
+			if ( HelpersCount > 0 )
+				Jobs.Wait();
+		}
 
-		float	MaxSlope = 0.0f;
-		for ( int SampleIndex=0; SampleIndex < Params.SamplesCount; SampleIndex++ )
+		virtual void	Run()
 		{
-			Position = Position + Direction;	// March one step
+			float*	pStackDistances = new float[m_StepsCount];
+			float*	pStackHeights = new float[m_StepsCount];
+			for ( ;; )
+			{
+				int	LineIndex = InterlockedIncrement( &m_NextLineIndex ) - 1;
+				if ( LineIndex >= m_LinesCount )
+					break;
+
+				SweepLine( LineIndex, pStackDistances, pStackHeights );
+			}
+			delete[] pStackHeights;
+			delete[] pStackDistances;
+		}
+
+	protected:
 
-			Pixel	P;
-			Params.pSource->SampleWrap( Position.x, Position.y, 0, P );
+		void			SweepLine( int _LineIndex, float* _pStackDistances, float* _pStackHeights )
+		{
+			int	Bottom = 0;
+			int	Top = 0;
+			for ( int Step=m_StepsCount-1; Step >= 0; Step-- )
+			{
+				// Wrapped position of the step (the steps past the last texel wrap around to the first ones)
+				int	MajorPos = m_MajorSign > 0 ? Step : m_MajorSize-1 - Step;
+				MajorPos = ((MajorPos % m_MajorSize) + m_MajorSize) % m_MajorSize;
+				int	MinorPos0 = (((_LineIndex + m_pMinorOffsets[Step]) % m_LinesCount) + m_LinesCount) % m_LinesCount;
+				int	MinorPos1 = MinorPos0+1 < m_LinesCount ? MinorPos0+1 : 0;
+				float	t = m_pMinorFractions[Step];
+
+				int		Index0 = m_bMajorX ? m_Width * MinorPos0 + MajorPos : m_Width * MajorPos + MinorPos0;
+				int		Index1 = m_bMajorX ? m_Width * MinorPos1 + MajorPos : m_Width * MajorPos + MinorPos1;
+				float	H = m_HeightFactor * (m_pHeights[Index0] + t * (m_pHeights[Index1] - m_pHeights[Index0]));
+				float	Distance = Step * m_StepLength;
+
+				// Drop the hull points beyond the radius
+				while ( Bottom < Top && _pStackDistances[Bottom] - Distance > m_Radius )
+					Bottom++;
+
+				// Pop the hull points below the tangent
+				while ( Top - Bottom >= 2 && Slope( H, Distance, _pStackHeights[Top-1], _pStackDistances[Top-1] ) <= Slope( H, Distance, _pStackHeights[Top-2], _pStackDistances[Top-2] ) )
+					Top--;
+
+				if ( Step < m_MajorSize )
+				{	// Accumulate the visibility of the texel the line goes through
+					float	MaxSlope = Top > Bottom ? MAX( 0.0f, Slope( H, Distance, _pStackHeights[Top-1], _pStackDistances[Top-1] ) ) : 0.0f;
+					int		Index = t < 0.5f ? Index0 : Index1;
+					m_pVisibility[Index] += HALFPI - atanf( MaxSlope );
+				}
+
+				_pStackDistances[Top] = Distance;
+				_pStackHeights[Top] = H;
+				Top++;
+			}
+		}
 
-			float	Slope = Params.HeightFactor * P.Height / (1.0f + SampleIndex);	// The slope of the horizon
-			MaxSlope = MAX( MaxSlope, Slope );
+		static float	Slope( float _Height, float _Distance, float _HullHeight, float _HullDistance )
+		{
+			return (_HullHeight - _Height) / (_HullDistance - _Distance);
 		}
+	};
+}
 
-		// Accumulate visibility
-		SumAO += HALFPI - atanf( MaxSlope );
+void Generators::ComputeAO( const TextureBuilder& _Source, TextureBuilder& _Target, float _HeightFactor, int _DirectionsCount, int _SamplesCount, bool _bWriteOnlyAlpha )
+{
+	ASSERT( _Source.GetWidth() == _Target.GetWidth() && _Source.GetHeight() == _Target.GetHeight(), "Source & target must have the same size!" );
+	int	W = _Target.GetWidth();
+	int	H = _Target.GetHeight();
+
+	// Copy the heights (the target can be the source) and clear the visibility
+	float*	pHeights = new float[W*H];
+	int		SourceStride;
+	const float*	pSourceHeights = _Source.GetChannel( 0, TextureBuilder::CHANNEL_HEIGHT, SourceStride );
+	for ( int i=0; i < W*H; i++ )
+		pHeights[i] = pSourceHeights != NULL ? pSourceHeights[i*SourceStride] : 0.0f;
+
+	float*	pVisibility = new float[W*H];
+	memset( pVisibility, 0, W*H*sizeof(float) );
+
+	HorizonSweepTask	Task( pHeights, pVisibility, W, H, _HeightFactor, float(_SamplesCount) );
+	for ( int DirectionIndex=0; DirectionIndex < _DirectionsCount; DirectionIndex++ )
+		Task.Execute( TWOPI * DirectionIndex / _DirectionsCount );
+
+	// Normalize & write the AO
+	int		TargetStride;
+	float*	pTarget = _Target.GetChannel( 0, TextureBuilder::CHANNEL_RGBA, TargetStride );
+	ASSERT( pTarget != NULL, "Target doesn't store colors!" );
+	if ( pTarget != NULL )
+	{
+		float	Normalizer = 1.0f / (HALFPI * _DirectionsCount);
+		for ( int i=0; i < W*H; i++ )
+		{
+			float	AO = Normalizer * pVisibility[i];
+			float*	pRGBA = pTarget + i*TargetStride;
+			pRGBA[3] = AO;
+			if ( !_bWriteOnlyAlpha )
+				pRGBA[0] = pRGBA[1] = pRGBA[2] = AO;
+		}
 	}
-	SumAO /= HALFPI * Params.DirectionsCount;	// Normalize
+	_Target.InvalidateMips();
+
+	delete[] pVisibility;
+	delete[] pHeights;
+}
+
 
-	_Pixel.RGBA.w = SumAO;
-	if ( Params.bWriteOnlyAlpha )
-		return;
+//////////////////////////////////////////////////////////////////////////
+// GPU versions
+//
+void Generators::ComputeNormal( const TextureBuilderGPU& _Source, TextureBuilderGPU& _Target, float _HeightFactor, bool _bNormalize )
+{
+	TextureBuilderGPU::KernelParams	Params;
+	Params.HeightFactor = _HeightFactor;
+	Params.Flags = _bNormalize ? TextureBuilderGPU::FLAG_NORMALIZE : 0;
 
-	_Pixel.RGBA.Set( SumAO, SumAO, SumAO, SumAO );
+	_Target.Run( TextureBuilderGPU::KERNEL_NORMAL, _Source, Params );
 }
 
-void Generators::ComputeAO( const TextureBuilder& _Source, TextureBuilder& _Target, float _HeightFactor, int _DirectionsCount, int _SamplesCount, bool _bWriteOnlyAlpha )
+void Generators::ComputeAO( const TextureBuilderGPU& _Source, TextureBuilderGPU& _Target, float _HeightFactor, int _DirectionsCount, int _SamplesCount, bool _bWriteOnlyAlpha )
 {
-	__AOStruct	Params;
-	Params.pSource = &_Source;
+	TextureBuilderGPU::KernelParams	Params;
 	Params.HeightFactor = _HeightFactor;
-	Params.DirectionsCount = _DirectionsCount;
+	Params.KernelSize = _DirectionsCount;
 	Params.SamplesCount = _SamplesCount;
-	Params.bWriteOnlyAlpha = _bWriteOnlyAlpha;
+	Params.Flags = _bWriteOnlyAlpha ? TextureBuilderGPU::FLAG_WRITE_ONLY_ALPHA : 0;
 
-	_Target.Fill( FillAO, &Params );
+	_Target.Run( TextureBuilderGPU::KERNEL_AO, _Source, Params );
 }
 
 
 //////////////////////////////////////////////////////////////////////////
 // Dirtyness
-struct __DirtynessStruct
-{
-	TextureBuilder*	pBuilder;
-	const Noise*	pNoise;
-	float			DirtNoiseFrequency;
-	float			DirtAmplitude;
-	float			PullBackForce;
-	float			AverageIntensity;
-};
-void	FillDirtyness( int _X, int _Y, const float2& _UV, Pixel& _Pixel, void* _pData )
+// Each pixel only depends on the pixel right above it so the dirt leaks down each column independently: columns are
+//	processed in parallel, each one from top to bottom starting from the seed in the last line (wrapping), which gives
+//	exactly the same result as a single in-place pass over the scanlines
+namespace
 {
-	__DirtynessStruct&	Params = *((__DirtynessStruct*) _pData);
-
-	Pixel	P[3];
-	Params.pBuilder->SampleWrap( _X-1.0f, _Y-1.0f, 0, P[0] );
-	Params.pBuilder->SampleWrap( _X+0.0f, _Y-1.0f, 0, P[1] );
-	Params.pBuilder->SampleWrap( _X+1.0f, _Y-1.0f, 0, P[2] );
-
-//	NjFloat4	F = C[0] + C[2] - C[1];	// Some sort of average
-//	NjFloat4	F = 0.333f * (C[0] + C[2] + C[1]);
-	float4	F = P[1].RGBA;
-	float		fOffset = Params.DirtAmplitude * Params.pNoise->Perlin( Params.DirtNoiseFrequency * _UV ) + F.w;
-
-	F.x += fOffset;
-	F.y += fOffset;
-	F.z += fOffset;
-	F.w = Params.PullBackForce * (Params.AverageIntensity - (F | LUMINANCE));	// Will yield -1 when F reaches the average intensity so the color is always somewhat brought back to average
-
-	_Pixel.RGBA = F;
+	class	DirtynessKernel : public IParallelForKernel
+	{
+	public:
+		TextureBuilder*	pBuilder;
+		const Noise*	pNoise;
+		float			DirtNoiseFrequency;
+		float			DirtAmplitude;
+		float			PullBackForce;
+		float			AverageIntensity;
+
+		virtual void	Run( int _StartColumn, int _EndColumn )
+		{
+			int		W = pBuilder->GetWidth();
+			int		H = pBuilder->GetHeight();
+			Pixel*	pPixels = pBuilder->GetMips()[0];
+			for ( int X=_StartColumn; X < _EndColumn; X++ )
+			{
+				float2	UV( float(X) / W, 0.0f );
+				for ( int Y=0; Y < H; Y++ )
+				{
+					UV.y = float(Y) / H;
+
+//					NjFloat4	F = C[0] + C[2] - C[1];	// Some sort of average
+//					NjFloat4	F = 0.333f * (C[0] + C[2] + C[1]);
+					float4	F = pPixels[W*((Y+H-1) % H)+X].RGBA;
+					float	fOffset = DirtAmplitude * pNoise->Perlin( DirtNoiseFrequency * UV ) + F.w;
+
+					F.x += fOffset;
+					F.y += fOffset;
+					F.z += fOffset;
+					F.w = PullBackForce * (AverageIntensity - (F | LUMINANCE));	// Will yield -1 when F reaches the average intensity so the color is always somewhat brought back to average
+
+					pPixels[W*Y+X].RGBA = F;
+				}
+			}
+		}
+	};
 }
 
 void	Generators::Dirtyness( TextureBuilder& _Builder, const Noise& _Noise, float _InitialIntensity, float _AverageIntensity, float _DirtNoiseFrequency, float _DirtAmplitude, float _PullBackForce )
 {
-	__DirtynessStruct	Params;
-	Params.pBuilder = &_Builder;
-	Params.pNoise = &_Noise;
-	Params.DirtNoiseFrequency = _DirtNoiseFrequency;
-	Params.DirtAmplitude = _DirtAmplitude;
-	Params.PullBackForce = _PullBackForce;
-	Params.AverageIntensity = _AverageIntensity;
+	DirtynessKernel	Kernel;
+	Kernel.pBuilder = &_Builder;
+	Kernel.pNoise = &_Noise;
+	Kernel.DirtNoiseFrequency = _DirtNoiseFrequency;
+	Kernel.DirtAmplitude = _DirtAmplitude;
+	Kernel.PullBackForce = _PullBackForce;
+	Kernel.AverageIntensity = _AverageIntensity;
 
 	// Setup last line used as initial seed
 	for ( int X=0; X < _Builder.GetWidth(); X++ )
@@ -163,7 +323,8 @@ void	Generators::Dirtyness( TextureBuilder& _Builder, const Noise& _Noise, float
 		P.RGBA.Set( InitialValue, InitialValue, InitialValue, 0.0f );
 	}
 
-	_Builder.Fill( FillDirtyness, &Params );
+	gs_Jobs.ParallelFor( _Builder.GetWidth(), 16, Kernel );
+	_Builder.InvalidateMips();
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -233,7 +394,7 @@ void	Generators::Marble( TextureBuilder& _Builder, float _HeightFactor, int _Boo
 	Params.HeightFactor = _HeightFactor;
 	Params.Factor = 1.0f / (Max - Min);
 	Params.pBuffer = pBuffer + W * _BootSize;
-	_Builder.Fill( FillMarble, &Params );
+	_Builder.Fill( FillMarble, &Params, true );
 
 	delete[] pBuffer;
 }
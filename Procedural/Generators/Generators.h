@@ -10,9 +10,14 @@ public:		// METHODS
 	// Computes the normal from a source texture's height field
 	static void ComputeNormal( const TextureBuilder& _Source, TextureBuilder& _Target, float _HeightFactor=1.0f, bool _bNormalize=true );
 
-	// Computes the ambient occlusion from a source texture's height field
+	// Computes the ambient occlusion from a source texture's height field (of the same size as the target)
+	// _SamplesCount is the radius of the horizon search in texels
 	static void ComputeAO( const TextureBuilder& _Source, TextureBuilder& _Target, float _HeightFactor=1.0f, int _DirectionsCount=8, int _SamplesCount=8, bool _bWriteOnlyAlpha=false );
 
+	// GPU versions of the above (cf. TextureBuilderGPU)
+	static void ComputeNormal( const TextureBuilderGPU& _Source, TextureBuilderGPU& _Target, float _HeightFactor=1.0f, bool _bNormalize=true );
+	static void ComputeAO( const TextureBuilderGPU& _Source, TextureBuilderGPU& _Target, float _HeightFactor=1.0f, int _DirectionsCount=8, int _SamplesCount=8, bool _bWriteOnlyAlpha=false );
+
 	// Fills a texture with dirtyness/moss/mouldiness leaking from the top of the texture
 	//	_InitialIntensity, intensity for initialization
 	//	_AverageIntensity, the average intensity of dirtyness
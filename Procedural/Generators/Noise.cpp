@@ -19,9 +19,22 @@ const float	Noise::BIAS_R = 0.7685431298f;
 const float	Noise::BIAS_S = 0.4646579661f;
 const float	Noise::BIAS_T = 0.9887465321f;
 
-Noise::Noise( int _Seed )
-	: m_pWavelet2D( NULL )
+Noise::Noise( int _Seed, bool _bHashed )
+	: m_HashSeed( U32( (OFFSET_BASIS ^ U32(_Seed)) * FNV_PRIME ) )
+	, m_pWavelet2D( NULL )
+	, m_pWavelet3D( NULL )
 {
+	// Arbitrary default wrapping init
+	SetWrappingParameters( 0.001f, 1 );
+	SetCellularWrappingParameters( 16, 16, 16 );
+
+	if ( _bHashed )
+	{	// No tables, the permutations & gradients are computed on the fly (cf. HashGradient())
+		m_pNoise1 = m_pNoise2 = m_pNoise3 = m_pNoise4 = m_pNoise5 = m_pNoise6 = NULL;
+		m_pPermutation = NULL;
+		return;
+	}
+
 	_randpushseed();
 	_srand( _Seed, RAND_DEFAULT_SEED_V );
 
@@ -60,10 +73,6 @@ Noise::Noise( int _Seed )
 		m_pPermutation[NOISE_SIZE+i] = m_pPermutation[i];
 
 	_randpopseed();
-
-	// Arbitrary default wrapping init
-	SetWrappingParameters( 0.001f, 1 );
-	SetCellularWrappingParameters( 16, 16, 16 );
 }
 
 Noise::~Noise()
@@ -78,6 +87,39 @@ Noise::~Noise()
 
 	if ( m_pWavelet2D != NULL )
 		delete[] m_pWavelet2D;
+	if ( m_pWavelet3D != NULL )
+		delete[] m_pWavelet3D;
+}
+
+// Generates the same kind of gradients as the tables from the permuted index: a random vector in [-1,1]^N that we normalize
+//	(or a random value in [0,1[ for the 1D noise), so there are still NOISE_SIZE different gradients per dimension
+const float*	Noise::HashGradient( U32 _Permutation, int _Dimensions, float _pGradient[8] ) const
+{
+	U32	Hash = _Permutation ^ m_HashSeed;
+	float	SumSq = 0.0f;
+	for ( int j=0; j < 8; j++ )
+	{
+		Hash = (Hash ^ (Hash >> 15)) * 0x2C1B3C6Du;
+		Hash = (Hash ^ (Hash >> 12)) * 0x297A2D39u;
+		Hash ^= Hash >> 15;
+
+		float	v = 0.0f;
+		if ( j < _Dimensions )
+		{
+			v = Hash * 2.3283064370807973754314699618685e-10f;
+			if ( _Dimensions > 1 )
+				v = 2.0f * v - 1.0f;
+		}
+		_pGradient[j] = v;
+		SumSq += v*v;
+	}
+	if ( _Dimensions > 1 )
+	{
+		SumSq = 1.0f / sqrtf( MAX( 1e-12f, SumSq ) );
+		for ( int j=0; j < _Dimensions; j++ )
+			_pGradient[j] *= SumSq;
+	}
+	return _pGradient;
 }
 
 // This should generate a code like this:
@@ -99,8 +141,8 @@ float	Noise::Perlin( float u ) const
 {
 	NOISE_INDICES( BIAS_U, u, 0 )
 
-	float	N0 = Dot( m_pPermutation[X0_], t0 );
-	float	N1 = Dot( m_pPermutation[X0], r0 );
+	float	N0 = Dot( Permute( X0_ ), t0 );
+	float	N1 = Dot( Permute( X0 ), r0 );
 
 	t0 = SCurve( t0 );
 
@@ -112,10 +154,10 @@ float	Noise::Perlin( const float2& uv ) const
 	NOISE_INDICES( BIAS_U, uv.x, 0 )
 	NOISE_INDICES( BIAS_V, uv.y, 1 )
 
-	float	N00 = Dot( m_pPermutation[m_pPermutation[X0_]+X1_], t0, t1 );
-	float	N01 = Dot( m_pPermutation[m_pPermutation[X0 ]+X1_], r0, t1 );
-	float	N10 = Dot( m_pPermutation[m_pPermutation[X0_]+X1 ], t0, r1 );
-	float	N11 = Dot( m_pPermutation[m_pPermutation[X0 ]+X1 ], r0, r1 );
+	float	N00 = Dot( Permute( Permute( X0_ )+X1_ ), t0, t1 );
+	float	N01 = Dot( Permute( Permute( X0  )+X1_ ), r0, t1 );
+	float	N10 = Dot( Permute( Permute( X0_ )+X1  ), t0, r1 );
+	float	N11 = Dot( Permute( Permute( X0  )+X1  ), r0, r1 );
 
 	t0 = SCurve( t0 );
 	t1 = SCurve( t1 );
@@ -129,14 +171,14 @@ float	Noise::Perlin( const float3& uvw ) const
 	NOISE_INDICES( BIAS_V, uvw.y, 1 )
 	NOISE_INDICES( BIAS_W, uvw.z, 2 )
 
-	float	N000 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1_]+X2_], t0, t1, t2 );
-	float	N001 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1_]+X2_], r0, t1, t2 );
-	float	N010 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1 ]+X2_], t0, r1, t2 );
-	float	N011 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1 ]+X2_], r0, r1, t2 );
-	float	N100 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1_]+X2 ], t0, t1, r2 );
-	float	N101 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1_]+X2 ], r0, t1, r2 );
-	float	N110 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1 ]+X2 ], t0, r1, r2 );
-	float	N111 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1 ]+X2 ], r0, r1, r2 );
+	float	N000 = Dot( Permute( Permute( Permute( X0_ )+X1_ )+X2_ ), t0, t1, t2 );
+	float	N001 = Dot( Permute( Permute( Permute( X0  )+X1_ )+X2_ ), r0, t1, t2 );
+	float	N010 = Dot( Permute( Permute( Permute( X0_ )+X1  )+X2_ ), t0, r1, t2 );
+	float	N011 = Dot( Permute( Permute( Permute( X0  )+X1  )+X2_ ), r0, r1, t2 );
+	float	N100 = Dot( Permute( Permute( Permute( X0_ )+X1_ )+X2  ), t0, t1, r2 );
+	float	N101 = Dot( Permute( Permute( Permute( X0  )+X1_ )+X2  ), r0, t1, r2 );
+	float	N110 = Dot( Permute( Permute( Permute( X0_ )+X1  )+X2  ), t0, r1, r2 );
+	float	N111 = Dot( Permute( Permute( Permute( X0  )+X1  )+X2  ), r0, r1, r2 );
 
 	t0 = SCurve( t0 );
 	t1 = SCurve( t1 );
@@ -152,22 +194,22 @@ float	Noise::Perlin( const float4& uvwr ) const
 	NOISE_INDICES( BIAS_W, uvwr.z, 2 )
 	NOISE_INDICES( BIAS_R, uvwr.w, 3 )
 
-	float	N0000 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1_]+X2_]+X3_], t0, t1, t2, t3 );
-	float	N0001 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1_]+X2_]+X3_], r0, t1, t2, t3 );
-	float	N0010 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1 ]+X2_]+X3_], t0, r1, t2, t3 );
-	float	N0011 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1 ]+X2_]+X3_], r0, r1, t2, t3 );
-	float	N0100 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1_]+X2 ]+X3_], t0, t1, r2, t3 );
-	float	N0101 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1_]+X2 ]+X3_], r0, t1, r2, t3 );
-	float	N0110 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1 ]+X2 ]+X3_], t0, r1, r2, t3 );
-	float	N0111 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1 ]+X2 ]+X3_], r0, r1, r2, t3 );
-	float	N1000 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1_]+X2_]+X3 ], t0, t1, t2, r3 );
-	float	N1001 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1_]+X2_]+X3 ], r0, t1, t2, r3 );
-	float	N1010 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1 ]+X2_]+X3 ], t0, r1, t2, r3 );
-	float	N1011 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1 ]+X2_]+X3 ], r0, r1, t2, r3 );
-	float	N1100 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1_]+X2 ]+X3 ], t0, t1, r2, r3 );
-	float	N1101 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1_]+X2 ]+X3 ], r0, t1, r2, r3 );
-	float	N1110 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1 ]+X2 ]+X3 ], t0, r1, r2, r3 );
-	float	N1111 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1 ]+X2 ]+X3 ], r0, r1, r2, r3 );
+	float	N0000 = Dot( Permute( Permute( Permute( Permute( X0_ )+X1_ )+X2_ )+X3_ ), t0, t1, t2, t3 );
+	float	N0001 = Dot( Permute( Permute( Permute( Permute( X0  )+X1_ )+X2_ )+X3_ ), r0, t1, t2, t3 );
+	float	N0010 = Dot( Permute( Permute( Permute( Permute( X0_ )+X1  )+X2_ )+X3_ ), t0, r1, t2, t3 );
+	float	N0011 = Dot( Permute( Permute( Permute( Permute( X0  )+X1  )+X2_ )+X3_ ), r0, r1, t2, t3 );
+	float	N0100 = Dot( Permute( Permute( Permute( Permute( X0_ )+X1_ )+X2  )+X3_ ), t0, t1, r2, t3 );
+	float	N0101 = Dot( Permute( Permute( Permute( Permute( X0  )+X1_ )+X2  )+X3_ ), r0, t1, r2, t3 );
+	float	N0110 = Dot( Permute( Permute( Permute( Permute( X0_ )+X1  )+X2  )+X3_ ), t0, r1, r2, t3 );
+	float	N0111 = Dot( Permute( Permute( Permute( Permute( X0  )+X1  )+X2  )+X3_ ), r0, r1, r2, t3 );
+	float	N1000 = Dot( Permute( Permute( Permute( Permute( X0_ )+X1_ )+X2_ )+X3  ), t0, t1, t2, r3 );
+	float	N1001 = Dot( Permute( Permute( Permute( Permute( X0  )+X1_ )+X2_ )+X3  ), r0, t1, t2, r3 );
+	float	N1010 = Dot( Permute( Permute( Permute( Permute( X0_ )+X1  )+X2_ )+X3  ), t0, r1, t2, r3 );
+	float	N1011 = Dot( Permute( Permute( Permute( Permute( X0  )+X1  )+X2_ )+X3  ), r0, r1, t2, r3 );
+	float	N1100 = Dot( Permute( Permute( Permute( Permute( X0_ )+X1_ )+X2  )+X3  ), t0, t1, r2, r3 );
+	float	N1101 = Dot( Permute( Permute( Permute( Permute( X0  )+X1_ )+X2  )+X3  ), r0, t1, r2, r3 );
+	float	N1110 = Dot( Permute( Permute( Permute( Permute( X0_ )+X1  )+X2  )+X3  ), t0, r1, r2, r3 );
+	float	N1111 = Dot( Permute( Permute( Permute( Permute( X0  )+X1  )+X2  )+X3  ), r0, r1, r2, r3 );
 
 	t0 = SCurve( t0 );
 	t1 = SCurve( t1 );
@@ -188,39 +230,39 @@ float	Noise::Perlin( const float4& uvwr, float s ) const
 	NOISE_INDICES( BIAS_R, uvwr.w, 3 )
 	NOISE_INDICES( BIAS_S, s, 4 )
 
-	float	N00000 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1_]+X2_]+X3_]+X4_], t0, t1, t2, t3, t4 );
-	float	N00001 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1_]+X2_]+X3_]+X4_], r0, t1, t2, t3, t4 );
-	float	N00010 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1 ]+X2_]+X3_]+X4_], t0, r1, t2, t3, t4 );
-	float	N00011 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1 ]+X2_]+X3_]+X4_], r0, r1, t2, t3, t4 );
-	float	N00100 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1_]+X2 ]+X3_]+X4_], t0, t1, r2, t3, t4 );
-	float	N00101 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1_]+X2 ]+X3_]+X4_], r0, t1, r2, t3, t4 );
-	float	N00110 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1 ]+X2 ]+X3_]+X4_], t0, r1, r2, t3, t4 );
-	float	N00111 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1 ]+X2 ]+X3_]+X4_], r0, r1, r2, t3, t4 );
-	float	N01000 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1_]+X2_]+X3 ]+X4_], t0, t1, t2, r3, t4 );
-	float	N01001 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1_]+X2_]+X3 ]+X4_], r0, t1, t2, r3, t4 );
-	float	N01010 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1 ]+X2_]+X3 ]+X4_], t0, r1, t2, r3, t4 );
-	float	N01011 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1 ]+X2_]+X3 ]+X4_], r0, r1, t2, r3, t4 );
-	float	N01100 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1_]+X2 ]+X3 ]+X4_], t0, t1, r2, r3, t4 );
-	float	N01101 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1_]+X2 ]+X3 ]+X4_], r0, t1, r2, r3, t4 );
-	float	N01110 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1 ]+X2 ]+X3 ]+X4_], t0, r1, r2, r3, t4 );
-	float	N01111 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1 ]+X2 ]+X3 ]+X4_], r0, r1, r2, r3, t4 );
-
-	float	N10000 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1_]+X2_]+X3_]+X4 ], t0, t1, t2, t3, r4 );
-	float	N10001 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1_]+X2_]+X3_]+X4 ], r0, t1, t2, t3, r4 );
-	float	N10010 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1 ]+X2_]+X3_]+X4 ], t0, r1, t2, t3, r4 );
-	float	N10011 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1 ]+X2_]+X3_]+X4 ], r0, r1, t2, t3, r4 );
-	float	N10100 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1_]+X2 ]+X3_]+X4 ], t0, t1, r2, t3, r4 );
-	float	N10101 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1_]+X2 ]+X3_]+X4 ], r0, t1, r2, t3, r4 );
-	float	N10110 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1 ]+X2 ]+X3_]+X4 ], t0, r1, r2, t3, r4 );
-	float	N10111 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1 ]+X2 ]+X3_]+X4 ], r0, r1, r2, t3, r4 );
-	float	N11000 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1_]+X2_]+X3 ]+X4 ], t0, t1, t2, r3, r4 );
-	float	N11001 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1_]+X2_]+X3 ]+X4 ], r0, t1, t2, r3, r4 );
-	float	N11010 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1 ]+X2_]+X3 ]+X4 ], t0, r1, t2, r3, r4 );
-	float	N11011 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1 ]+X2_]+X3 ]+X4 ], r0, r1, t2, r3, r4 );
-	float	N11100 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1_]+X2 ]+X3 ]+X4 ], t0, t1, r2, r3, r4 );
-	float	N11101 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1_]+X2 ]+X3 ]+X4 ], r0, t1, r2, r3, r4 );
-	float	N11110 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1 ]+X2 ]+X3 ]+X4 ], t0, r1, r2, r3, r4 );
-	float	N11111 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1 ]+X2 ]+X3 ]+X4 ], r0, r1, r2, r3, r4 );
+	float	N00000 = Dot( Permute( Permute( Permute( Permute( Permute( X0_ )+X1_ )+X2_ )+X3_ )+X4_ ), t0, t1, t2, t3, t4 );
+	float	N00001 = Dot( Permute( Permute( Permute( Permute( Permute( X0  )+X1_ )+X2_ )+X3_ )+X4_ ), r0, t1, t2, t3, t4 );
+	float	N00010 = Dot( Permute( Permute( Permute( Permute( Permute( X0_ )+X1  )+X2_ )+X3_ )+X4_ ), t0, r1, t2, t3, t4 );
+	float	N00011 = Dot( Permute( Permute( Permute( Permute( Permute( X0  )+X1  )+X2_ )+X3_ )+X4_ ), r0, r1, t2, t3, t4 );
+	float	N00100 = Dot( Permute( Permute( Permute( Permute( Permute( X0_ )+X1_ )+X2  )+X3_ )+X4_ ), t0, t1, r2, t3, t4 );
+	float	N00101 = Dot( Permute( Permute( Permute( Permute( Permute( X0  )+X1_ )+X2  )+X3_ )+X4_ ), r0, t1, r2, t3, t4 );
+	float	N00110 = Dot( Permute( Permute( Permute( Permute( Permute( X0_ )+X1  )+X2  )+X3_ )+X4_ ), t0, r1, r2, t3, t4 );
+	float	N00111 = Dot( Permute( Permute( Permute( Permute( Permute( X0  )+X1  )+X2  )+X3_ )+X4_ ), r0, r1, r2, t3, t4 );
+	float	N01000 = Dot( Permute( Permute( Permute( Permute( Permute( X0_ )+X1_ )+X2_ )+X3  )+X4_ ), t0, t1, t2, r3, t4 );
+	float	N01001 = Dot( Permute( Permute( Permute( Permute( Permute( X0  )+X1_ )+X2_ )+X3  )+X4_ ), r0, t1, t2, r3, t4 );
+	float	N01010 = Dot( Permute( Permute( Permute( Permute( Permute( X0_ )+X1  )+X2_ )+X3  )+X4_ ), t0, r1, t2, r3, t4 );
+	float	N01011 = Dot( Permute( Permute( Permute( Permute( Permute( X0  )+X1  )+X2_ )+X3  )+X4_ ), r0, r1, t2, r3, t4 );
+	float	N01100 = Dot( Permute( Permute( Permute( Permute( Permute( X0_ )+X1_ )+X2  )+X3  )+X4_ ), t0, t1, r2, r3, t4 );
+	float	N01101 = Dot( Permute( Permute( Permute( Permute( Permute( X0  )+X1_ )+X2  )+X3  )+X4_ ), r0, t1, r2, r3, t4 );
+	float	N01110 = Dot( Permute( Permute( Permute( Permute( Permute( X0_ )+X1  )+X2  )+X3  )+X4_ ), t0, r1, r2, r3, t4 );
+	float	N01111 = Dot( Permute( Permute( Permute( Permute( Permute( X0  )+X1  )+X2  )+X3  )+X4_ ), r0, r1, r2, r3, t4 );
+
+	float	N10000 = Dot( Permute( Permute( Permute( Permute( Permute( X0_ )+X1_ )+X2_ )+X3_ )+X4  ), t0, t1, t2, t3, r4 );
+	float	N10001 = Dot( Permute( Permute( Permute( Permute( Permute( X0  )+X1_ )+X2_ )+X3_ )+X4  ), r0, t1, t2, t3, r4 );
+	float	N10010 = Dot( Permute( Permute( Permute( Permute( Permute( X0_ )+X1  )+X2_ )+X3_ )+X4  ), t0, r1, t2, t3, r4 );
+	float	N10011 = Dot( Permute( Permute( Permute( Permute( Permute( X0  )+X1  )+X2_ )+X3_ )+X4  ), r0, r1, t2, t3, r4 );
+	float	N10100 = Dot( Permute( Permute( Permute( Permute( Permute( X0_ )+X1_ )+X2  )+X3_ )+X4  ), t0, t1, r2, t3, r4 );
+	float	N10101 = Dot( Permute( Permute( Permute( Permute( Permute( X0  )+X1_ )+X2  )+X3_ )+X4  ), r0, t1, r2, t3, r4 );
+	float	N10110 = Dot( Permute( Permute( Permute( Permute( Permute( X0_ )+X1  )+X2  )+X3_ )+X4  ), t0, r1, r2, t3, r4 );
+	float	N10111 = Dot( Permute( Permute( Permute( Permute( Permute( X0  )+X1  )+X2  )+X3_ )+X4  ), r0, r1, r2, t3, r4 );
+	float	N11000 = Dot( Permute( Permute( Permute( Permute( Permute( X0_ )+X1_ )+X2_ )+X3  )+X4  ), t0, t1, t2, r3, r4 );
+	float	N11001 = Dot( Permute( Permute( Permute( Permute( Permute( X0  )+X1_ )+X2_ )+X3  )+X4  ), r0, t1, t2, r3, r4 );
+	float	N11010 = Dot( Permute( Permute( Permute( Permute( Permute( X0_ )+X1  )+X2_ )+X3  )+X4  ), t0, r1, t2, r3, r4 );
+	float	N11011 = Dot( Permute( Permute( Permute( Permute( Permute( X0  )+X1  )+X2_ )+X3  )+X4  ), r0, r1, t2, r3, r4 );
+	float	N11100 = Dot( Permute( Permute( Permute( Permute( Permute( X0_ )+X1_ )+X2  )+X3  )+X4  ), t0, t1, r2, r3, r4 );
+	float	N11101 = Dot( Permute( Permute( Permute( Permute( Permute( X0  )+X1_ )+X2  )+X3  )+X4  ), r0, t1, r2, r3, r4 );
+	float	N11110 = Dot( Permute( Permute( Permute( Permute( Permute( X0_ )+X1  )+X2  )+X3  )+X4  ), t0, r1, r2, r3, r4 );
+	float	N11111 = Dot( Permute( Permute( Permute( Permute( Permute( X0  )+X1  )+X2  )+X3  )+X4  ), r0, r1, r2, r3, r4 );
 
 	t0 = SCurve( t0 );
 	t1 = SCurve( t1 );
@@ -245,71 +287,71 @@ float	Noise::Perlin( const float4& uvwr, const float2& st ) const
 	NOISE_INDICES( BIAS_S, st.x, 4 )
 	NOISE_INDICES( BIAS_T, st.y, 5 )
 
-	float	N000000 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1_]+X2_]+X3_]+X4_]+X5_], t0, t1, t2, t3, t4, t5 );
-	float	N000001 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1_]+X2_]+X3_]+X4_]+X5_], r0, t1, t2, t3, t4, t5 );
-	float	N000010 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1 ]+X2_]+X3_]+X4_]+X5_], t0, r1, t2, t3, t4, t5 );
-	float	N000011 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1 ]+X2_]+X3_]+X4_]+X5_], r0, r1, t2, t3, t4, t5 );
-	float	N000100 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1_]+X2 ]+X3_]+X4_]+X5_], t0, t1, r2, t3, t4, t5 );
-	float	N000101 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1_]+X2 ]+X3_]+X4_]+X5_], r0, t1, r2, t3, t4, t5 );
-	float	N000110 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1 ]+X2 ]+X3_]+X4_]+X5_], t0, r1, r2, t3, t4, t5 );
-	float	N000111 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1 ]+X2 ]+X3_]+X4_]+X5_], r0, r1, r2, t3, t4, t5 );
-	float	N001000 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1_]+X2_]+X3 ]+X4_]+X5_], t0, t1, t2, r3, t4, t5 );
-	float	N001001 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1_]+X2_]+X3 ]+X4_]+X5_], r0, t1, t2, r3, t4, t5 );
-	float	N001010 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1 ]+X2_]+X3 ]+X4_]+X5_], t0, r1, t2, r3, t4, t5 );
-	float	N001011 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1 ]+X2_]+X3 ]+X4_]+X5_], r0, r1, t2, r3, t4, t5 );
-	float	N001100 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1_]+X2 ]+X3 ]+X4_]+X5_], t0, t1, r2, r3, t4, t5 );
-	float	N001101 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1_]+X2 ]+X3 ]+X4_]+X5_], r0, t1, r2, r3, t4, t5 );
-	float	N001110 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1 ]+X2 ]+X3 ]+X4_]+X5_], t0, r1, r2, r3, t4, t5 );
-	float	N001111 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1 ]+X2 ]+X3 ]+X4_]+X5_], r0, r1, r2, r3, t4, t5 );
-	float	N010000 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1_]+X2_]+X3_]+X4 ]+X5_], t0, t1, t2, t3, r4, t5 );
-	float	N010001 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1_]+X2_]+X3_]+X4 ]+X5_], r0, t1, t2, t3, r4, t5 );
-	float	N010010 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1 ]+X2_]+X3_]+X4 ]+X5_], t0, r1, t2, t3, r4, t5 );
-	float	N010011 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1 ]+X2_]+X3_]+X4 ]+X5_], r0, r1, t2, t3, r4, t5 );
-	float	N010100 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1_]+X2 ]+X3_]+X4 ]+X5_], t0, t1, r2, t3, r4, t5 );
-	float	N010101 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1_]+X2 ]+X3_]+X4 ]+X5_], r0, t1, r2, t3, r4, t5 );
-	float	N010110 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1 ]+X2 ]+X3_]+X4 ]+X5_], t0, r1, r2, t3, r4, t5 );
-	float	N010111 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1 ]+X2 ]+X3_]+X4 ]+X5_], r0, r1, r2, t3, r4, t5 );
-	float	N011000 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1_]+X2_]+X3 ]+X4 ]+X5_], t0, t1, t2, r3, r4, t5 );
-	float	N011001 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1_]+X2_]+X3 ]+X4 ]+X5_], r0, t1, t2, r3, r4, t5 );
-	float	N011010 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1 ]+X2_]+X3 ]+X4 ]+X5_], t0, r1, t2, r3, r4, t5 );
-	float	N011011 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1 ]+X2_]+X3 ]+X4 ]+X5_], r0, r1, t2, r3, r4, t5 );
-	float	N011100 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1_]+X2 ]+X3 ]+X4 ]+X5_], t0, t1, r2, r3, r4, t5 );
-	float	N011101 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1_]+X2 ]+X3 ]+X4 ]+X5_], r0, t1, r2, r3, r4, t5 );
-	float	N011110 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1 ]+X2 ]+X3 ]+X4 ]+X5_], t0, r1, r2, r3, r4, t5 );
-	float	N011111 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1 ]+X2 ]+X3 ]+X4 ]+X5_], r0, r1, r2, r3, r4, t5 );
-
-	float	N100000 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1_]+X2_]+X3_]+X4_]+X5 ], t0, t1, t2, t3, t4, r5 );
-	float	N100001 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1_]+X2_]+X3_]+X4_]+X5 ], r0, t1, t2, t3, t4, r5 );
-	float	N100010 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1 ]+X2_]+X3_]+X4_]+X5 ], t0, r1, t2, t3, t4, r5 );
-	float	N100011 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1 ]+X2_]+X3_]+X4_]+X5 ], r0, r1, t2, t3, t4, r5 );
-	float	N100100 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1_]+X2 ]+X3_]+X4_]+X5 ], t0, t1, r2, t3, t4, r5 );
-	float	N100101 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1_]+X2 ]+X3_]+X4_]+X5 ], r0, t1, r2, t3, t4, r5 );
-	float	N100110 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1 ]+X2 ]+X3_]+X4_]+X5 ], t0, r1, r2, t3, t4, r5 );
-	float	N100111 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1 ]+X2 ]+X3_]+X4_]+X5 ], r0, r1, r2, t3, t4, r5 );
-	float	N101000 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1_]+X2_]+X3 ]+X4_]+X5 ], t0, t1, t2, r3, t4, r5 );
-	float	N101001 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1_]+X2_]+X3 ]+X4_]+X5 ], r0, t1, t2, r3, t4, r5 );
-	float	N101010 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1 ]+X2_]+X3 ]+X4_]+X5 ], t0, r1, t2, r3, t4, r5 );
-	float	N101011 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1 ]+X2_]+X3 ]+X4_]+X5 ], r0, r1, t2, r3, t4, r5 );
-	float	N101100 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1_]+X2 ]+X3 ]+X4_]+X5 ], t0, t1, r2, r3, t4, r5 );
-	float	N101101 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1_]+X2 ]+X3 ]+X4_]+X5 ], r0, t1, r2, r3, t4, r5 );
-	float	N101110 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1 ]+X2 ]+X3 ]+X4_]+X5 ], t0, r1, r2, r3, t4, r5 );
-	float	N101111 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1 ]+X2 ]+X3 ]+X4_]+X5 ], r0, r1, r2, r3, t4, r5 );
-	float	N110000 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1_]+X2_]+X3_]+X4 ]+X5 ], t0, t1, t2, t3, r4, r5 );
-	float	N110001 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1_]+X2_]+X3_]+X4 ]+X5 ], r0, t1, t2, t3, r4, r5 );
-	float	N110010 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1 ]+X2_]+X3_]+X4 ]+X5 ], t0, r1, t2, t3, r4, r5 );
-	float	N110011 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1 ]+X2_]+X3_]+X4 ]+X5 ], r0, r1, t2, t3, r4, r5 );
-	float	N110100 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1_]+X2 ]+X3_]+X4 ]+X5 ], t0, t1, r2, t3, r4, r5 );
-	float	N110101 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1_]+X2 ]+X3_]+X4 ]+X5 ], r0, t1, r2, t3, r4, r5 );
-	float	N110110 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1 ]+X2 ]+X3_]+X4 ]+X5 ], t0, r1, r2, t3, r4, r5 );
-	float	N110111 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1 ]+X2 ]+X3_]+X4 ]+X5 ], r0, r1, r2, t3, r4, r5 );
-	float	N111000 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1_]+X2_]+X3 ]+X4 ]+X5 ], t0, t1, t2, r3, r4, r5 );
-	float	N111001 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1_]+X2_]+X3 ]+X4 ]+X5 ], r0, t1, t2, r3, r4, r5 );
-	float	N111010 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1 ]+X2_]+X3 ]+X4 ]+X5 ], t0, r1, t2, r3, r4, r5 );
-	float	N111011 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1 ]+X2_]+X3 ]+X4 ]+X5 ], r0, r1, t2, r3, r4, r5 );
-	float	N111100 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1_]+X2 ]+X3 ]+X4 ]+X5 ], t0, t1, r2, r3, r4, r5 );
-	float	N111101 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1_]+X2 ]+X3 ]+X4 ]+X5 ], r0, t1, r2, r3, r4, r5 );
-	float	N111110 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0_]+X1 ]+X2 ]+X3 ]+X4 ]+X5 ], t0, r1, r2, r3, r4, r5 );
-	float	N111111 = Dot( m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[m_pPermutation[X0 ]+X1 ]+X2 ]+X3 ]+X4 ]+X5 ], r0, r1, r2, r3, r4, r5 );
+	float	N000000 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0_ )+X1_ )+X2_ )+X3_ )+X4_ )+X5_ ), t0, t1, t2, t3, t4, t5 );
+	float	N000001 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0  )+X1_ )+X2_ )+X3_ )+X4_ )+X5_ ), r0, t1, t2, t3, t4, t5 );
+	float	N000010 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0_ )+X1  )+X2_ )+X3_ )+X4_ )+X5_ ), t0, r1, t2, t3, t4, t5 );
+	float	N000011 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0  )+X1  )+X2_ )+X3_ )+X4_ )+X5_ ), r0, r1, t2, t3, t4, t5 );
+	float	N000100 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0_ )+X1_ )+X2  )+X3_ )+X4_ )+X5_ ), t0, t1, r2, t3, t4, t5 );
+	float	N000101 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0  )+X1_ )+X2  )+X3_ )+X4_ )+X5_ ), r0, t1, r2, t3, t4, t5 );
+	float	N000110 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0_ )+X1  )+X2  )+X3_ )+X4_ )+X5_ ), t0, r1, r2, t3, t4, t5 );
+	float	N000111 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0  )+X1  )+X2  )+X3_ )+X4_ )+X5_ ), r0, r1, r2, t3, t4, t5 );
+	float	N001000 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0_ )+X1_ )+X2_ )+X3  )+X4_ )+X5_ ), t0, t1, t2, r3, t4, t5 );
+	float	N001001 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0  )+X1_ )+X2_ )+X3  )+X4_ )+X5_ ), r0, t1, t2, r3, t4, t5 );
+	float	N001010 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0_ )+X1  )+X2_ )+X3  )+X4_ )+X5_ ), t0, r1, t2, r3, t4, t5 );
+	float	N001011 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0  )+X1  )+X2_ )+X3  )+X4_ )+X5_ ), r0, r1, t2, r3, t4, t5 );
+	float	N001100 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0_ )+X1_ )+X2  )+X3  )+X4_ )+X5_ ), t0, t1, r2, r3, t4, t5 );
+	float	N001101 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0  )+X1_ )+X2  )+X3  )+X4_ )+X5_ ), r0, t1, r2, r3, t4, t5 );
+	float	N001110 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0_ )+X1  )+X2  )+X3  )+X4_ )+X5_ ), t0, r1, r2, r3, t4, t5 );
+	float	N001111 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0  )+X1  )+X2  )+X3  )+X4_ )+X5_ ), r0, r1, r2, r3, t4, t5 );
+	float	N010000 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0_ )+X1_ )+X2_ )+X3_ )+X4  )+X5_ ), t0, t1, t2, t3, r4, t5 );
+	float	N010001 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0  )+X1_ )+X2_ )+X3_ )+X4  )+X5_ ), r0, t1, t2, t3, r4, t5 );
+	float	N010010 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0_ )+X1  )+X2_ )+X3_ )+X4  )+X5_ ), t0, r1, t2, t3, r4, t5 );
+	float	N010011 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0  )+X1  )+X2_ )+X3_ )+X4  )+X5_ ), r0, r1, t2, t3, r4, t5 );
+	float	N010100 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0_ )+X1_ )+X2  )+X3_ )+X4  )+X5_ ), t0, t1, r2, t3, r4, t5 );
+	float	N010101 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0  )+X1_ )+X2  )+X3_ )+X4  )+X5_ ), r0, t1, r2, t3, r4, t5 );
+	float	N010110 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0_ )+X1  )+X2  )+X3_ )+X4  )+X5_ ), t0, r1, r2, t3, r4, t5 );
+	float	N010111 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0  )+X1  )+X2  )+X3_ )+X4  )+X5_ ), r0, r1, r2, t3, r4, t5 );
+	float	N011000 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0_ )+X1_ )+X2_ )+X3  )+X4  )+X5_ ), t0, t1, t2, r3, r4, t5 );
+	float	N011001 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0  )+X1_ )+X2_ )+X3  )+X4  )+X5_ ), r0, t1, t2, r3, r4, t5 );
+	float	N011010 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0_ )+X1  )+X2_ )+X3  )+X4  )+X5_ ), t0, r1, t2, r3, r4, t5 );
+	float	N011011 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0  )+X1  )+X2_ )+X3  )+X4  )+X5_ ), r0, r1, t2, r3, r4, t5 );
+	float	N011100 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0_ )+X1_ )+X2  )+X3  )+X4  )+X5_ ), t0, t1, r2, r3, r4, t5 );
+	float	N011101 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0  )+X1_ )+X2  )+X3  )+X4  )+X5_ ), r0, t1, r2, r3, r4, t5 );
+	float	N011110 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0_ )+X1  )+X2  )+X3  )+X4  )+X5_ ), t0, r1, r2, r3, r4, t5 );
+	float	N011111 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0  )+X1  )+X2  )+X3  )+X4  )+X5_ ), r0, r1, r2, r3, r4, t5 );
+
+	float	N100000 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0_ )+X1_ )+X2_ )+X3_ )+X4_ )+X5  ), t0, t1, t2, t3, t4, r5 );
+	float	N100001 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0  )+X1_ )+X2_ )+X3_ )+X4_ )+X5  ), r0, t1, t2, t3, t4, r5 );
+	float	N100010 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0_ )+X1  )+X2_ )+X3_ )+X4_ )+X5  ), t0, r1, t2, t3, t4, r5 );
+	float	N100011 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0  )+X1  )+X2_ )+X3_ )+X4_ )+X5  ), r0, r1, t2, t3, t4, r5 );
+	float	N100100 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0_ )+X1_ )+X2  )+X3_ )+X4_ )+X5  ), t0, t1, r2, t3, t4, r5 );
+	float	N100101 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0  )+X1_ )+X2  )+X3_ )+X4_ )+X5  ), r0, t1, r2, t3, t4, r5 );
+	float	N100110 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0_ )+X1  )+X2  )+X3_ )+X4_ )+X5  ), t0, r1, r2, t3, t4, r5 );
+	float	N100111 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0  )+X1  )+X2  )+X3_ )+X4_ )+X5  ), r0, r1, r2, t3, t4, r5 );
+	float	N101000 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0_ )+X1_ )+X2_ )+X3  )+X4_ )+X5  ), t0, t1, t2, r3, t4, r5 );
+	float	N101001 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0  )+X1_ )+X2_ )+X3  )+X4_ )+X5  ), r0, t1, t2, r3, t4, r5 );
+	float	N101010 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0_ )+X1  )+X2_ )+X3  )+X4_ )+X5  ), t0, r1, t2, r3, t4, r5 );
+	float	N101011 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0  )+X1  )+X2_ )+X3  )+X4_ )+X5  ), r0, r1, t2, r3, t4, r5 );
+	float	N101100 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0_ )+X1_ )+X2  )+X3  )+X4_ )+X5  ), t0, t1, r2, r3, t4, r5 );
+	float	N101101 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0  )+X1_ )+X2  )+X3  )+X4_ )+X5  ), r0, t1, r2, r3, t4, r5 );
+	float	N101110 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0_ )+X1  )+X2  )+X3  )+X4_ )+X5  ), t0, r1, r2, r3, t4, r5 );
+	float	N101111 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0  )+X1  )+X2  )+X3  )+X4_ )+X5  ), r0, r1, r2, r3, t4, r5 );
+	float	N110000 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0_ )+X1_ )+X2_ )+X3_ )+X4  )+X5  ), t0, t1, t2, t3, r4, r5 );
+	float	N110001 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0  )+X1_ )+X2_ )+X3_ )+X4  )+X5  ), r0, t1, t2, t3, r4, r5 );
+	float	N110010 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0_ )+X1  )+X2_ )+X3_ )+X4  )+X5  ), t0, r1, t2, t3, r4, r5 );
+	float	N110011 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0  )+X1  )+X2_ )+X3_ )+X4  )+X5  ), r0, r1, t2, t3, r4, r5 );
+	float	N110100 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0_ )+X1_ )+X2  )+X3_ )+X4  )+X5  ), t0, t1, r2, t3, r4, r5 );
+	float	N110101 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0  )+X1_ )+X2  )+X3_ )+X4  )+X5  ), r0, t1, r2, t3, r4, r5 );
+	float	N110110 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0_ )+X1  )+X2  )+X3_ )+X4  )+X5  ), t0, r1, r2, t3, r4, r5 );
+	float	N110111 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0  )+X1  )+X2  )+X3_ )+X4  )+X5  ), r0, r1, r2, t3, r4, r5 );
+	float	N111000 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0_ )+X1_ )+X2_ )+X3  )+X4  )+X5  ), t0, t1, t2, r3, r4, r5 );
+	float	N111001 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0  )+X1_ )+X2_ )+X3  )+X4  )+X5  ), r0, t1, t2, r3, r4, r5 );
+	float	N111010 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0_ )+X1  )+X2_ )+X3  )+X4  )+X5  ), t0, r1, t2, r3, r4, r5 );
+	float	N111011 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0  )+X1  )+X2_ )+X3  )+X4  )+X5  ), r0, r1, t2, r3, r4, r5 );
+	float	N111100 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0_ )+X1_ )+X2  )+X3  )+X4  )+X5  ), t0, t1, r2, r3, r4, r5 );
+	float	N111101 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0  )+X1_ )+X2  )+X3  )+X4  )+X5  ), r0, t1, r2, r3, r4, r5 );
+	float	N111110 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0_ )+X1  )+X2  )+X3  )+X4  )+X5  ), t0, r1, r2, r3, r4, r5 );
+	float	N111111 = Dot( Permute( Permute( Permute( Permute( Permute( Permute( X0  )+X1  )+X2  )+X3  )+X4  )+X5  ), r0, r1, r2, r3, r4, r5 );
 
 	t0 = SCurve( t0 );
 	t1 = SCurve( t1 );
@@ -389,6 +431,308 @@ float	Noise::WrapPerlin( const float3& uvw ) const
 	return Perlin( Pos0, Pos1 );
 }
 
+//////////////////////////////////////////////////////////////////////////
+// Batch evaluation
+//
+// The lattice indices are computed exactly like the NOISE_INDICES() macro does, and the SSE kernels perform the same
+//	operations in the same order as Dot(), SCurve() and the Lerp() functions so we get the same results as the scalar versions.
+// The SSE kernels evaluate 4 points at once: the gradient lookups are gathered per lane then transposed so the dot products,
+//	S-curves and interpolations are computed for the 4 lanes in a single go.
+//
+namespace
+{
+	inline void	LatticeIndices( float _Bias, float _Var, U32& _X_, U32& _X, float& _t )
+	{
+		float	fX = (_Bias+_Var) * NOISE_SIZE;
+		int		X_ = floorf( fX );
+		_t = fX - X_;
+		_X_ = X_ & NOISE_MASK;
+		_X = (X_ + 1) & NOISE_MASK;
+	}
+
+#ifdef NUAJ_MATH_SSE
+	inline __m128	LerpSSE( __m128 _p0, __m128 _p1, __m128 _x )
+	{
+		return _mm_add_ps( _p0, _mm_mul_ps( _mm_sub_ps( _p1, _p0 ), _x ) );
+	}
+
+	inline __m128	BiLerpSSE( __m128 _p0, __m128 _p1, __m128 _p2, __m128 _p3, __m128 _x, __m128 _y )
+	{
+		return LerpSSE( LerpSSE( _p0, _p1, _x ), LerpSSE( _p3, _p2, _x ), _y );
+	}
+
+	// The 8 values are indexed by their corner bits and interpolated in the same order as the scalar calls to TriLerp()
+	inline __m128	TriLerpSSE( const __m128* _pN, __m128 _x, __m128 _y, __m128 _z )
+	{
+		return LerpSSE( BiLerpSSE( _pN[0], _pN[1], _pN[3], _pN[2], _x, _y ), BiLerpSSE( _pN[4], _pN[5], _pN[7], _pN[6], _x, _y ), _z );
+	}
+
+	// WARNING: Must match Noise::SCurve() !
+	inline __m128	SCurveSSE( __m128 _t )
+	{
+		__m128	Poly = _mm_add_ps( _mm_set1_ps( 10.0f ), _mm_mul_ps( _t, _mm_add_ps( _mm_set1_ps( -15.0f ), _mm_mul_ps( _t, _mm_set1_ps( 6.0f ) ) ) ) );
+		return _mm_mul_ps( _mm_mul_ps( _mm_mul_ps( _t, _t ), _t ), Poly );
+	}
+#endif
+}
+
+// Chains the permutations of dimensions [_StartDimension,_EndDimension[ for the corners of a lattice cell
+// Corner C uses the upper index of dimension D if bit D of C is set (i.e. corner 0b011 is for X0, X1 and X2_)
+// _pHashes must already contain the 2^_StartDimension hashes of the previous dimensions and receives 2^_EndDimension hashes
+void	Noise::HashCorners( int _StartDimension, int _EndDimension, const U32* _pX_, const U32* _pX, U32* _pHashes ) const
+{
+	if ( _StartDimension == 0 )
+	{
+		_pHashes[0] = Permute( _pX_[0] );
+		_pHashes[1] = Permute( _pX[0] );
+		_StartDimension = 1;
+	}
+	for ( int Dimension=_StartDimension; Dimension < _EndDimension; Dimension++ )
+	{
+		int	CornersCount = 1 << Dimension;
+		for ( int Corner=0; Corner < CornersCount; Corner++ )
+		{
+			U32	Hash = _pHashes[Corner];
+			_pHashes[Corner] = Permute( Hash + _pX_[Dimension] );
+			_pHashes[CornersCount+Corner] = Permute( Hash + _pX[Dimension] );
+		}
+	}
+}
+
+#ifdef NUAJ_MATH_SSE
+
+struct	Noise::PerlinLanes
+{
+	U32		ppHashes[4][64];	// Chained permutations of the cell corners for each lane (cf. HashCorners())
+	float	ppT[4][6];			// Fractional offsets within the cell for each lane and dimension
+};
+
+void	Noise::Perlin3SSE( const PerlinLanes& _Lanes, float _pResults[4] ) const
+{
+	__m128	One = _mm_set1_ps( 1.0f );
+	__m128	pT[3], pR[3];
+	for ( int Dimension=0; Dimension < 3; Dimension++ )
+	{
+		pT[Dimension] = _mm_set_ps( _Lanes.ppT[3][Dimension], _Lanes.ppT[2][Dimension], _Lanes.ppT[1][Dimension], _Lanes.ppT[0][Dimension] );
+		pR[Dimension] = _mm_sub_ps( pT[Dimension], One );
+	}
+
+	__m128	pN[8];
+	float	ppTemp[4][8];
+	for ( int Corner=0; Corner < 8; Corner++ )
+	{
+		__m128	V0 = _mm_loadu_ps( Gradient( m_pNoise3, 2, 3, _Lanes.ppHashes[0][Corner], ppTemp[0] ) );
+		__m128	V1 = _mm_loadu_ps( Gradient( m_pNoise3, 2, 3, _Lanes.ppHashes[1][Corner], ppTemp[1] ) );
+		__m128	V2 = _mm_loadu_ps( Gradient( m_pNoise3, 2, 3, _Lanes.ppHashes[2][Corner], ppTemp[2] ) );
+		__m128	V3 = _mm_loadu_ps( Gradient( m_pNoise3, 2, 3, _Lanes.ppHashes[3][Corner], ppTemp[3] ) );
+		_MM_TRANSPOSE4_PS( V0, V1, V2, V3 );	// V0 now contains the X components of the 4 lanes, V1 the Y components, etc.
+
+		__m128	N = _mm_mul_ps( V0, Corner & 1 ? pR[0] : pT[0] );
+				N = _mm_add_ps( N, _mm_mul_ps( V1, Corner & 2 ? pR[1] : pT[1] ) );
+				N = _mm_add_ps( N, _mm_mul_ps( V2, Corner & 4 ? pR[2] : pT[2] ) );
+		pN[Corner] = N;
+	}
+
+	_mm_storeu_ps( _pResults, TriLerpSSE( pN, SCurveSSE( pT[0] ), SCurveSSE( pT[1] ), SCurveSSE( pT[2] ) ) );
+}
+
+void	Noise::Perlin6SSE( const PerlinLanes& _Lanes, float _pResults[4] ) const
+{
+	__m128	One = _mm_set1_ps( 1.0f );
+	__m128	pT[6], pR[6];
+	for ( int Dimension=0; Dimension < 6; Dimension++ )
+	{
+		pT[Dimension] = _mm_set_ps( _Lanes.ppT[3][Dimension], _Lanes.ppT[2][Dimension], _Lanes.ppT[1][Dimension], _Lanes.ppT[0][Dimension] );
+		pR[Dimension] = _mm_sub_ps( pT[Dimension], One );
+	}
+
+	__m128	pN[64];
+	float	ppTemp[4][8];
+	for ( int Corner=0; Corner < 64; Corner++ )
+	{
+		const float*	pV0 = Gradient( m_pNoise6, 3, 6, _Lanes.ppHashes[0][Corner], ppTemp[0] );
+		const float*	pV1 = Gradient( m_pNoise6, 3, 6, _Lanes.ppHashes[1][Corner], ppTemp[1] );
+		const float*	pV2 = Gradient( m_pNoise6, 3, 6, _Lanes.ppHashes[2][Corner], ppTemp[2] );
+		const float*	pV3 = Gradient( m_pNoise6, 3, 6, _Lanes.ppHashes[3][Corner], ppTemp[3] );
+
+		__m128	V0 = _mm_loadu_ps( pV0 );
+		__m128	V1 = _mm_loadu_ps( pV1 );
+		__m128	V2 = _mm_loadu_ps( pV2 );
+		__m128	V3 = _mm_loadu_ps( pV3 );
+		_MM_TRANSPOSE4_PS( V0, V1, V2, V3 );	// Components 0 to 3 of the 4 lanes
+
+		__m128	V4 = _mm_loadu_ps( pV0+4 );
+		__m128	V5 = _mm_loadu_ps( pV1+4 );
+		__m128	V6 = _mm_loadu_ps( pV2+4 );
+		__m128	V7 = _mm_loadu_ps( pV3+4 );
+		_MM_TRANSPOSE4_PS( V4, V5, V6, V7 );	// Components 4 & 5 of the 4 lanes (6 & 7 are unused)
+
+		__m128	N = _mm_mul_ps( V0, Corner & 1 ? pR[0] : pT[0] );
+				N = _mm_add_ps( N, _mm_mul_ps( V1, Corner & 2 ? pR[1] : pT[1] ) );
+				N = _mm_add_ps( N, _mm_mul_ps( V2, Corner & 4 ? pR[2] : pT[2] ) );
+				N = _mm_add_ps( N, _mm_mul_ps( V3, Corner & 8 ? pR[3] : pT[3] ) );
+				N = _mm_add_ps( N, _mm_mul_ps( V4, Corner & 16 ? pR[4] : pT[4] ) );
+				N = _mm_add_ps( N, _mm_mul_ps( V5, Corner & 32 ? pR[5] : pT[5] ) );
+		pN[Corner] = N;
+	}
+
+	__m128	S0 = SCurveSSE( pT[0] );
+	__m128	S1 = SCurveSSE( pT[1] );
+	__m128	S2 = SCurveSSE( pT[2] );
+
+	__m128	pN3[8];
+	for ( int Group=0; Group < 8; Group++ )
+		pN3[Group] = TriLerpSSE( pN + 8*Group, S0, S1, S2 );
+
+	_mm_storeu_ps( _pResults, TriLerpSSE( pN3, SCurveSSE( pT[3] ), SCurveSSE( pT[4] ), SCurveSSE( pT[5] ) ) );
+}
+
+#endif
+
+void	Noise::WrapLatticeIndices( int _Axis, float _u, U32 _pX_[2], U32 _pX[2], float _pT[2] ) const
+{
+	static const float	pBiases[6] = { BIAS_U, BIAS_V, BIAS_W, BIAS_R, BIAS_S, BIAS_T };
+	const float2&		Center = _Axis == 0 ? m_WrapCenter0 : (_Axis == 1 ? m_WrapCenter1 : m_WrapCenter2);
+
+	float	Angle = TWOPI * _u;
+	LatticeIndices( pBiases[2*_Axis+0], Center.x + m_WrapRadius * cosf( Angle ), _pX_[0], _pX[0], _pT[0] );
+	LatticeIndices( pBiases[2*_Axis+1], Center.y + m_WrapRadius * sinf( Angle ), _pX_[1], _pX[1], _pT[1] );
+}
+
+void	Noise::PerlinBatch( const float3* _pUVW, float* _pResults, int _Count ) const
+{
+#ifdef NUAJ_MATH_SSE
+	PerlinLanes	Lanes;
+	float		pResults[4];
+	for ( int Index=0; Index < _Count; Index+=4 )
+	{
+		int	LanesCount = MIN( 4, _Count - Index );
+		for ( int Lane=0; Lane < 4; Lane++ )
+		{
+			const float3&	UVW = _pUVW[Index + MIN( Lane, LanesCount-1 )];	// Unused lanes replicate the last point
+			U32				pX_[3], pX[3];
+			LatticeIndices( BIAS_U, UVW.x, pX_[0], pX[0], Lanes.ppT[Lane][0] );
+			LatticeIndices( BIAS_V, UVW.y, pX_[1], pX[1], Lanes.ppT[Lane][1] );
+			LatticeIndices( BIAS_W, UVW.z, pX_[2], pX[2], Lanes.ppT[Lane][2] );
+			HashCorners( 0, 3, pX_, pX, Lanes.ppHashes[Lane] );
+		}
+
+		Perlin3SSE( Lanes, pResults );
+		memcpy( _pResults + Index, pResults, LanesCount*sizeof(float) );
+	}
+#else
+	for ( int Index=0; Index < _Count; Index++ )
+		_pResults[Index] = Perlin( _pUVW[Index] );
+#endif
+}
+
+void	Noise::WrapPerlinBatch( const float3* _pUVW, float* _pResults, int _Count ) const
+{
+#ifdef NUAJ_MATH_SSE
+	PerlinLanes	Lanes;
+	float		pResults[4];
+	for ( int Index=0; Index < _Count; Index+=4 )
+	{
+		int	LanesCount = MIN( 4, _Count - Index );
+		for ( int Lane=0; Lane < 4; Lane++ )
+		{
+			const float3&	UVW = _pUVW[Index + MIN( Lane, LanesCount-1 )];	// Unused lanes replicate the last point
+			U32				pX_[6], pX[6];
+			WrapLatticeIndices( 0, UVW.x, &pX_[0], &pX[0], &Lanes.ppT[Lane][0] );
+			WrapLatticeIndices( 1, UVW.y, &pX_[2], &pX[2], &Lanes.ppT[Lane][2] );
+			WrapLatticeIndices( 2, UVW.z, &pX_[4], &pX[4], &Lanes.ppT[Lane][4] );
+			HashCorners( 0, 6, pX_, pX, Lanes.ppHashes[Lane] );
+		}
+
+		Perlin6SSE( Lanes, pResults );
+		memcpy( _pResults + Index, pResults, LanesCount*sizeof(float) );
+	}
+#else
+	for ( int Index=0; Index < _Count; Index++ )
+		_pResults[Index] = WrapPerlin( _pUVW[Index] );
+#endif
+}
+
+void	Noise::WrapPerlinLattice( const float3& _Offset, int _SizeX, int _SizeY, int _SizeZ, float* _pResults, int _Stride, int _Z0, int _Z1 ) const
+{
+	if ( _Z1 < 0 )
+		_Z1 = _SizeZ;
+	ASSERT( _Z0 >= 0 && _Z0 <= _Z1 && _Z1 <= _SizeZ, "Invalid slices range!" );
+
+	U8*	pResult = (U8*) _pResults + _SizeX*_SizeY*_Z0*_Stride;
+
+#ifdef NUAJ_MATH_SSE
+	// Each axis drives 2 of the 6 dimensions of the wrapping noise so we only need to compute their indices once per row/column/slice
+	struct	AxisIndices
+	{
+		U32		pX_[2];
+		U32		pX[2];
+		float	pT[2];
+	};
+
+	AxisIndices*	pAxisX = new AxisIndices[_SizeX+_SizeY+_SizeZ];
+	AxisIndices*	pAxisY = pAxisX + _SizeX;
+	AxisIndices*	pAxisZ = pAxisY + _SizeY;
+	for ( int X=0; X < _SizeX; X++ )
+		WrapLatticeIndices( 0, float(X) / _SizeX + _Offset.x, pAxisX[X].pX_, pAxisX[X].pX, pAxisX[X].pT );
+	for ( int Y=0; Y < _SizeY; Y++ )
+		WrapLatticeIndices( 1, float(Y) / _SizeY + _Offset.y, pAxisY[Y].pX_, pAxisY[Y].pX, pAxisY[Y].pT );
+	for ( int Z=_Z0; Z < _Z1; Z++ )
+		WrapLatticeIndices( 2, float(Z) / _SizeZ + _Offset.z, pAxisZ[Z].pX_, pAxisZ[Z].pX, pAxisZ[Z].pT );
+
+	// The first 4 dimensions only depend on X & Y so we hash them once and walk the Z axis last
+	PerlinLanes	Lanes;
+	float		pResults[4];
+	U32			ppHashesXY[4][16];
+	int			SliceStride = _SizeX*_SizeY*_Stride;
+	for ( int Y=0; Y < _SizeY; Y++ )
+		for ( int X=0; X < _SizeX; X+=4 )
+		{
+			int	LanesCount = MIN( 4, _SizeX - X );
+			for ( int Lane=0; Lane < 4; Lane++ )
+			{
+				const AxisIndices&	AxisX = pAxisX[X + MIN( Lane, LanesCount-1 )];	// Unused lanes replicate the last point
+				const AxisIndices&	AxisY = pAxisY[Y];
+				U32	pX_[4] = { AxisX.pX_[0], AxisX.pX_[1], AxisY.pX_[0], AxisY.pX_[1] };
+				U32	pX[4] = { AxisX.pX[0], AxisX.pX[1], AxisY.pX[0], AxisY.pX[1] };
+				HashCorners( 0, 4, pX_, pX, ppHashesXY[Lane] );
+
+				Lanes.ppT[Lane][0] = AxisX.pT[0];
+				Lanes.ppT[Lane][1] = AxisX.pT[1];
+				Lanes.ppT[Lane][2] = AxisY.pT[0];
+				Lanes.ppT[Lane][3] = AxisY.pT[1];
+			}
+
+			U8*	pScanline = pResult + (_SizeX*Y + X) * _Stride;
+			for ( int Z=_Z0; Z < _Z1; Z++, pScanline+=SliceStride )
+			{
+				const AxisIndices&	AxisZ = pAxisZ[Z];
+				U32	pX_[6] = { 0, 0, 0, 0, AxisZ.pX_[0], AxisZ.pX_[1] };	// Only the last 2 dimensions are used
+				U32	pX[6] = { 0, 0, 0, 0, AxisZ.pX[0], AxisZ.pX[1] };
+				for ( int Lane=0; Lane < 4; Lane++ )
+				{
+					memcpy( Lanes.ppHashes[Lane], ppHashesXY[Lane], 16*sizeof(U32) );
+					HashCorners( 4, 6, pX_, pX, Lanes.ppHashes[Lane] );
+
+					Lanes.ppT[Lane][4] = AxisZ.pT[0];
+					Lanes.ppT[Lane][5] = AxisZ.pT[1];
+				}
+
+				Perlin6SSE( Lanes, pResults );
+				for ( int Lane=0; Lane < LanesCount; Lane++ )
+					*((float*) (pScanline + Lane*_Stride)) = pResults[Lane];
+			}
+		}
+
+	delete[] pAxisX;
+#else
+	for ( int Z=_Z0; Z < _Z1; Z++ )
+		for ( int Y=0; Y < _SizeY; Y++ )
+			for ( int X=0; X < _SizeX; X++, pResult+=_Stride )
+				*((float*) pResult) = WrapPerlin( float3( float(X) / _SizeX + _Offset.x, float(Y) / _SizeY + _Offset.y, float(Z) / _SizeZ + _Offset.z ) );
+#endif
+}
+
 //////////////////////////////////////////////////////////////////////////
 // Cellular noise
 void	Noise::SetCellularWrappingParameters( int _SizeX, int _SizeY, int _SizeZ )
@@ -965,6 +1309,294 @@ float	Noise::Wavelet( const float2& _UV ) const
 	return Result;
 }
 
+//////////////////////////////////////////////////////////////////////////
+// 3D Wavelet Noise
+// Same construction as the 2D tile, following the paper exactly: the gaussian noise is downsampled then upsampled
+//	along each axis to get its low frequencies, which are subtracted to keep the band-limited residual alone.
+// The fill, the 3 separable passes and the final combinations are spread across the worker threads by rows or slices,
+//	each row/slice only depends on the previous pass so the result doesn't depend on the amount of threads.
+//
+namespace
+{
+	static const int	WAVELET_ARAD = 16;
+
+	// Wavelet analysis coefficients for quadratic B-splines (cf. Chapter 3.3 of the paper)
+	static const float	WAVELET_COEFFICIENTS[2*WAVELET_ARAD] =
+	{
+		0.000334f,-0.001528f, 0.000410f, 0.003545f,-0.000938f,-0.008233f, 0.002172f, 0.019120f,
+		-0.005040f,-0.044412f, 0.011655f, 0.103311f,-0.025936f,-0.243780f, 0.033979f, 0.655340f,
+		0.655340f, 0.033979f,-0.243780f,-0.025936f, 0.103311f, 0.011655f,-0.044412f,-0.005040f,
+		0.019120f, 0.002172f,-0.008233f,-0.000938f, 0.003546f, 0.000410f,-0.001528f, 0.000334f
+	};
+
+	class	Wavelet3DTask : public IJob
+	{
+	public:
+
+		enum PASS
+		{
+			PASS_FILL,			// Gaussian noise into the noise & the temp tiles (per slice)
+			PASS_FILTER_X,		// Downsample/upsample the temp tile in place (per row)
+			PASS_FILTER_Y,
+			PASS_FILTER_Z,
+			PASS_RESIDUAL,		// Noise -= Temp (per slice)
+			PASS_OFFSET,		// Temp = odd-offset noise (per slice)
+			PASS_ADD,			// Noise += Temp (per slice)
+		};
+
+	protected:
+
+		float*			m_pNoise;
+		float*			m_pTemp;
+		int				m_POT;
+		int				m_Size;
+		int				m_Mask;
+		U32				m_Seed;
+
+		PASS			m_Pass;
+		int				m_ItemsCount;
+		volatile LONG	m_NextItemIndex;
+
+	public:
+
+		Wavelet3DTask( float* _pNoise, float* _pTemp, int _POT, U32 _Seed )
+			: m_pNoise( _pNoise ), m_pTemp( _pTemp ), m_POT( _POT ), m_Size( 1 << _POT ), m_Mask( (1 << _POT)-1 ), m_Seed( _Seed )	{}
+
+		void			Execute( PASS _Pass )
+		{
+			m_Pass = _Pass;
+			bool	bRows = _Pass >= PASS_FILTER_X && _Pass <= PASS_FILTER_Z;
+			m_ItemsCount = bRows ? m_Size*m_Size : m_Size;
+			m_NextItemIndex = 0;
+
+			JobQueue&	Jobs = gs_Device.Jobs();
+			int			HelpersCount = MIN( Jobs.GetHelpersCount(), m_ItemsCount-1 );
+			for ( int HelperIndex=0; HelperIndex < HelpersCount; HelperIndex++ )
+				Jobs.Push( *this );
+			Run();
+			if ( HelpersCount > 0 )
+				Jobs.Wait();
+		}
+
+		virtual void	Run()
+		{
+			for ( ;; )
+			{
+				int	ItemIndex = InterlockedIncrement( &m_NextItemIndex ) - 1;
+				if ( ItemIndex >= m_ItemsCount )
+					return;
+
+				if ( m_Pass >= PASS_FILTER_X && m_Pass <= PASS_FILTER_Z )
+					FilterRow( ItemIndex );
+				else
+					ProcessSlice( ItemIndex );
+			}
+		}
+
+	protected:
+
+		void			FilterRow( int _RowIndex )
+		{
+			int	SliceSize = m_Size*m_Size;
+			int	Start, Stride;
+			switch ( m_Pass )
+			{
+			case PASS_FILTER_X:	Start = _RowIndex << m_POT; Stride = 1; break;
+			case PASS_FILTER_Y:	Start = (_RowIndex & m_Mask) + ((_RowIndex >> m_POT) << (2*m_POT)); Stride = m_Size; break;
+			default:			Start = _RowIndex; Stride = SliceSize; break;
+			}
+
+			float	pRow[1 << Noise::MAX_WAVELET3D_POT];
+			float	pHalfRow[1 << (Noise::MAX_WAVELET3D_POT-1)];
+			float*	pSource = m_pTemp + Start;
+			for ( int i=0; i < m_Size; i++ )
+				pRow[i] = pSource[i*Stride];
+
+			// Downsample
+			const float*	pWeights = &WAVELET_COEFFICIENTS[WAVELET_ARAD];
+			int				HalfSize = m_Size >> 1;
+			for ( int i=0; i < HalfSize; i++ )
+			{
+				float	Sum = 0.0f;
+				for ( int k=-WAVELET_ARAD; k < WAVELET_ARAD; k++ )
+					Sum += pWeights[k] * pRow[(2*i+k) & m_Mask];
+				pHalfRow[i] = Sum;
+			}
+
+			// Upsample again by reconstructing the lower frequency quadratic B-spline
+			int	HalfMask = HalfSize - 1;
+			for ( int i=0; i < m_Size; i++ )
+			{
+				int		k = i >> 1;
+				float	w = (i & 1) ? 0.25f : 0.75f;
+				pSource[i*Stride] = w * pHalfRow[k] + (1.0f - w) * pHalfRow[(k+1) & HalfMask];
+			}
+		}
+
+		void			ProcessSlice( int _Z )
+		{
+			int		SliceSize = m_Size*m_Size;
+			float*	pNoise = m_pNoise + _Z*SliceSize;
+			float*	pTemp = m_pTemp + _Z*SliceSize;
+			switch ( m_Pass )
+			{
+			case PASS_FILL:
+				RandomStream::GaussBatch( m_Seed, 0, U32(_Z*SliceSize), U32(SliceSize), pNoise );
+				for ( int i=0; i < SliceSize; i++ )
+					pTemp[i] = pNoise[i] *= 0.25f;	// Same scale as the 2D tile
+				break;
+
+			case PASS_RESIDUAL:
+				for ( int i=0; i < SliceSize; i++ )
+					pNoise[i] -= pTemp[i];
+				break;
+
+			case PASS_OFFSET:
+			{	// Avoid even/odd variance difference by adding an odd-offset version of the noise to itself
+				int				Offset = (m_Size >> 1) + 1;
+				const float*	pSourceSlice = m_pNoise + (((_Z+Offset) & m_Mask) << (2*m_POT));
+				for ( int Y=0; Y < m_Size; Y++ )
+				{
+					const float*	pSourceRow = pSourceSlice + (((Y+Offset) & m_Mask) << m_POT);
+					for ( int X=0; X < m_Size; X++ )
+						*pTemp++ = pSourceRow[(X+Offset) & m_Mask];
+				}
+				break;
+			}
+
+			case PASS_ADD:
+				for ( int i=0; i < SliceSize; i++ )
+					pNoise[i] += pTemp[i];
+				break;
+			}
+		}
+	};
+}
+
+void	Noise::Create3DWaveletNoiseTile( int _POT, U32 _Seed )
+{
+	ASSERT( _POT >= 2 && _POT <= MAX_WAVELET3D_POT, "Unsupported 3D wavelet tile size!" );
+	if ( m_pWavelet3D != NULL )
+		delete[] m_pWavelet3D;
+
+	int	Size = 1 << _POT;
+	m_Wavelet3DPOT = _POT;
+	m_Wavelet3DSize = Size;
+	m_Wavelet3DMask = Size - 1;
+	m_pWavelet3D = new float[Size*Size*Size];
+	float*	pTemp = new float[Size*Size*Size];
+
+	Wavelet3DTask	Task( m_pWavelet3D, pTemp, _POT, _Seed );
+	Task.Execute( Wavelet3DTask::PASS_FILL );
+	Task.Execute( Wavelet3DTask::PASS_FILTER_X );
+	Task.Execute( Wavelet3DTask::PASS_FILTER_Y );
+	Task.Execute( Wavelet3DTask::PASS_FILTER_Z );
+	Task.Execute( Wavelet3DTask::PASS_RESIDUAL );
+	Task.Execute( Wavelet3DTask::PASS_OFFSET );
+	Task.Execute( Wavelet3DTask::PASS_ADD );
+
+	delete[] pTemp;
+
+	// Measure the variance of a band so multi-band sums can be normalized
+	static const int	VARIANCE_SAMPLES = 4096;
+	RandomStream	Stream( _Seed, 1 );
+	double			SumSquares = 0.0;
+	m_Wavelet3DVariance = 1.0f;
+	for ( int SampleIndex=0; SampleIndex < VARIANCE_SAMPLES; SampleIndex++ )
+	{
+		float3	UVW;
+		UVW.x = Stream.Uniform();
+		UVW.y = Stream.Uniform();
+		UVW.z = Stream.Uniform();
+		float	Value = Wavelet( UVW );
+		SumSquares += Value * Value;
+	}
+	m_Wavelet3DVariance = MAX( 1e-6f, float(SumSquares / VARIANCE_SAMPLES) );
+}
+
+float	Noise::Wavelet( const float3& _UVW ) const
+{
+	ASSERT( m_pWavelet3D != NULL, "Did you forget to call Create3DWaveletNoiseTile() ?" );
+
+	float	pPixelPosition[3] =	{ _UVW.x * m_Wavelet3DSize, _UVW.y * m_Wavelet3DSize, _UVW.z * m_Wavelet3DSize };
+
+	// Evaluate quadratic B-spline basis functions
+	int		pPixelCenter[3];
+	float	ppWeights[3][3];
+	for ( int i=0; i < 3; i++ )
+	{
+		float	fPositionOffset = pPixelPosition[i] - 0.5f;
+		pPixelCenter[i] = int(ceilf( fPositionOffset ));
+		float	t = pPixelCenter[i] - fPositionOffset;
+		float	r = 1.0f - t;
+
+		ppWeights[i][0] = 0.5f * t*t;
+		ppWeights[i][2] = 0.5f * r*r;
+		ppWeights[i][1] = 1.0f - ppWeights[i][0] - ppWeights[i][2];
+	}
+
+	// Evaluate noise by weighting noise coefficients by basis function values
+	float	Result = 0.0f;
+	for ( int fz=-1; fz <= 1; fz++ )
+	{
+		const float*	pSlice = m_pWavelet3D + (((pPixelCenter[2] + fz) & m_Wavelet3DMask) << (2*m_Wavelet3DPOT));
+		for ( int fy=-1; fy <= 1; fy++ )
+		{
+			const float*	pRow = pSlice + (((pPixelCenter[1] + fy) & m_Wavelet3DMask) << m_Wavelet3DPOT);
+			float			WeightYZ = ppWeights[2][fz+1] * ppWeights[1][fy+1];
+			for ( int fx=-1; fx <= 1; fx++ )
+				Result += WeightYZ * ppWeights[0][fx+1] * pRow[(pPixelCenter[0] + fx) & m_Wavelet3DMask];
+		}
+	}
+
+	return Result;
+}
+
+float	Noise::WaveletMultiBand( const float3& _UVW, int _FirstBand, int _BandsCount, const float* _pBandWeights ) const
+{
+	float	Result = 0.0f;
+	float	SumSquaredWeights = 0.0f;
+	float	Frequency = float(1 << _FirstBand);
+	for ( int Band=0; Band < _BandsCount; Band++, Frequency *= 2.0f )
+	{
+		float3	UVW;
+		UVW.x = Frequency * _UVW.x;
+		UVW.y = Frequency * _UVW.y;
+		UVW.z = Frequency * _UVW.z;
+		Result += _pBandWeights[Band] * Wavelet( UVW );
+		SumSquaredWeights += _pBandWeights[Band] * _pBandWeights[Band];
+	}
+
+	// Bands are independent so their variances add up
+	return SumSquaredWeights > 0.0f ? Result / sqrtf( SumSquaredWeights * m_Wavelet3DVariance ) : 0.0f;
+}
+
+Texture3D*	Noise::CreateWavelet3DTexture( Device& _Device ) const
+{
+	ASSERT( m_pWavelet3D != NULL, "Did you forget to call Create3DWaveletNoiseTile() ?" );
+
+	int					Size = m_Wavelet3DSize;
+	PixelFormatR16F*	pTexels = new PixelFormatR16F[Size*Size*Size];
+	PixelFormatR16F*	pTexel = pTexels;
+	float				InvSize = 1.0f / Size;
+	for ( int Z=0; Z < Size; Z++ )
+		for ( int Y=0; Y < Size; Y++ )
+			for ( int X=0; X < Size; X++, pTexel++ )
+			{
+				float3	UVW;
+				UVW.x = (X + 0.5f) * InvSize;
+				UVW.y = (Y + 0.5f) * InvSize;
+				UVW.z = (Z + 0.5f) * InvSize;
+				pTexel->R = Wavelet( UVW );
+			}
+
+	void*		pContent = pTexels;
+	Texture3D*	pResult = new Texture3D( _Device, Size, Size, Size, PixelFormatR16F::DESCRIPTOR, 1, &pContent );
+	delete[] pTexels;
+
+	return pResult;
+}
+
 //////////////////////////////////////////////////////////////////////////
 // Algorithms
 float	Noise::FractionalBrownianMotion( GetNoise2DDelegate _GetNoise, void* _pData, const float2& _UV, float _FrequencyFactor, float _AmplitudeFactor, int _OctavesCount ) const
@@ -1,6 +1,11 @@
 //////////////////////////////////////////////////////////////////////////
 // Perlin Noise
 //
+// By default, the gradients & permutations are read from tables of NOISE_SIZE entries built from the seed.
+// In hashed mode they're computed from an integer hash of the lattice indices instead: no tables are allocated so
+//	evaluation doesn't depend on the cache, at the cost of a few integer multiplies and a square root per lattice corner.
+//	The noise has the same properties (same period, same distribution of gradients) but doesn't give the same values.
+//
 #pragma once
 
 #define NOISE_POT	12
@@ -23,6 +28,8 @@ public:
 	static const U32	OFFSET_BASIS = 2166136261;
 	static const U32	FNV_PRIME = 16777619;
 
+	static const int	MAX_WAVELET3D_POT = 8;	// Up to 256^3 tiles
+
 public:		// NESTED TYPES
 
 	// WARNING: Notice you get an array of three SQUARED distances !
@@ -40,7 +47,8 @@ protected:	// FIELDS
 	float*		m_pNoise4;
 	float*		m_pNoise5;
 	float*		m_pNoise6;
-	U32*		m_pPermutation;
+	U32*		m_pPermutation;		// NULL in hashed mode, like the gradient tables
+	U32			m_HashSeed;
 
 	// Wrapping parameters for Perlin noise
 	float		m_WrapRadius;
@@ -59,9 +67,15 @@ protected:	// FIELDS
 	int			m_WaveletMask;
 	float*		m_pWavelet2D;
 
+	int			m_Wavelet3DPOT;
+	int			m_Wavelet3DSize;
+	int			m_Wavelet3DMask;
+	float*		m_pWavelet3D;
+	float		m_Wavelet3DVariance;	// Variance of a single band, measured once the tile is built
+
 public:		// METHODS
 
-	Noise( int _Seed );
+	Noise( int _Seed, bool _bHashed=false );
  	~Noise();
 
 	// --------- PERLIN ---------
@@ -81,6 +95,24 @@ public:		// METHODS
 	float	WrapPerlin( const float2& uv ) const;
 	float	WrapPerlin( const float3& uvw ) const;
 
+	// Batch evaluation, giving the same results as calling the single point versions above for each point
+	// (4 points are evaluated at once when NUAJ_MATH_SSE is defined)
+	void	PerlinBatch( const float3* _pUVW, float* _pResults, int _Count ) const;
+	void	WrapPerlinBatch( const float3* _pUVW, float* _pResults, int _Count ) const;
+
+	// Fills a regular grid of wrapping noise sampled at _Offset + float3( X/_SizeX, Y/_SizeY, Z/_SizeZ ), X varying first
+	// Results are written every _Stride bytes so you can fill a single component of an array of vectors
+	// This is much faster than WrapPerlinBatch() as the wrapping and lattice indices are only computed once per row/column/slice
+	// Only the slices [_Z0,_Z1[ are written if specified (-1 for all the remaining slices), so several threads can fill different slices
+	void	WrapPerlinLattice( const float3& _Offset, int _SizeX, int _SizeY, int _SizeZ, float* _pResults, int _Stride=sizeof(float), int _Z0=0, int _Z1=-1 ) const;
+
+	// Tables & wrapping parameters so shaders can evaluate the same wrapping noise (cf. VolumetricBuildFractal.hlsl)
+	bool			IsHashed() const					{ return m_pPermutation == NULL; }
+	const U32*		GetPermutationTable() const			{ ASSERT( !IsHashed(), "No tables in hashed mode!" ); return m_pPermutation; }	// 2*NOISE_SIZE entries
+	const float*	GetGradients6D() const				{ ASSERT( !IsHashed(), "No tables in hashed mode!" ); return m_pNoise6; }		// 8 floats per entry, only the first 6 are used
+	float			GetWrapRadius() const				{ return m_WrapRadius; }
+	const float2&	GetWrapCenter( int _Index ) const	{ return _Index == 0 ? m_WrapCenter0 : (_Index == 1 ? m_WrapCenter1 : m_WrapCenter2); }
+
 	// --------- CELLULAR ---------
 	void	SetCellularWrappingParameters( int _SizeX, int _SizeY, int _SizeZ );
 	void	CellularGetCenter( int _CellX, int _CellY, float2& _Center, bool _bWrap=false ) const;
@@ -94,6 +126,18 @@ public:		// METHODS
 	void	Create2DWaveletNoiseTile( int _POT );
 	float	Wavelet( const float2& uv ) const;
 
+	// 3D tiles are built on the worker threads and give the same tile whatever the amount of threads (cf. RandomStream)
+	// uvw is in tile units (i.e. the noise wraps every integer) and a single band covers the frequencies [Size/4,Size/2]
+	void	Create3DWaveletNoiseTile( int _POT, U32 _Seed=1 );
+	float	Wavelet( const float3& uvw ) const;
+
+	// Sums _BandsCount bands of doubling frequencies starting at band _FirstBand (i.e. uvw scaled by 2^_FirstBand), each weighted
+	//	by _pBandWeights[Band], and normalizes the result to a unit variance. Bands don't overlap so the sum doesn't alias.
+	float	WaveletMultiBand( const float3& uvw, int _FirstBand, int _BandsCount, const float* _pBandWeights ) const;
+
+	// Creates a R16F texture of the 3D tile evaluated at the texel centers, to be sampled trilinearly with wrapping
+	Texture3D*	CreateWavelet3DTexture( Device& _Device ) const;
+
 	// --------- ALGORITHMS ---------
 	float	FractionalBrownianMotion( GetNoise2DDelegate _GetNoise, void* _pData, const float2& uv, float _FrequencyFactor=2.0f, float _AmplitudeFactor=0.5f, int _OctavesCount=4 ) const;
 	float	RidgedMultiFractal( GetNoise2DDelegate _GetNoise, void* _pData, const float2& _UV, float _FrequencyFactor=2.0f, float _AmplitudeFactor=0.5f, int _OctavesCount=4 ) const;
@@ -144,15 +188,31 @@ private:
 	}
 #endif
 
-	float	Dot( U32 _Permutation, float u ) const												{ return m_pNoise1[_Permutation] * u; }
-	float	Dot( U32 _Permutation, float u, float v ) const										{ float* V = &m_pNoise2[_Permutation<<1]; return V[0] * u + V[1] * v; }
-	float	Dot( U32 _Permutation, float u, float v, float w ) const							{ float* V = &m_pNoise3[_Permutation<<2]; return V[0] * u + V[1] * v + V[2] * w; }
-	float	Dot( U32 _Permutation, float u, float v, float w, float r ) const					{ float* V = &m_pNoise4[_Permutation<<2]; return V[0] * u + V[1] * v + V[2] * w + V[3] * r; }
-	float	Dot( U32 _Permutation, float u, float v, float w, float r, float s ) const			{ float* V = &m_pNoise5[_Permutation<<3]; return V[0] * u + V[1] * v + V[2] * w + V[3] * r + V[4] * s; }
-	float	Dot( U32 _Permutation, float u, float v, float w, float r, float s, float t ) const	{ float* V = &m_pNoise6[_Permutation<<3]; return V[0] * u + V[1] * v + V[2] * w + V[3] * r + V[4] * s + V[5] * t; }
+	// Permutation & gradient lookups, either from the tables or from the hash in hashed mode
+	// Permuted indices are always in [0,NOISE_SIZE[ so chaining Permute( Permute( X ) + Y ) stays within the table
+	U32		Permute( U32 _Index ) const															{ if ( m_pPermutation != NULL ) return m_pPermutation[_Index]; U32 Hash = (_Index ^ m_HashSeed) * 0x9E3779B1u; Hash ^= Hash >> 16; Hash *= 0x85EBCA6Bu; Hash ^= Hash >> 13; return Hash & NOISE_MASK; }
+	const float*	Gradient( const float* _pTable, int _Shift, int _Dimensions, U32 _Permutation, float _pTemp[8] ) const	{ return _pTable != NULL ? _pTable + (_Permutation << _Shift) : HashGradient( _Permutation, _Dimensions, _pTemp ); }
+	const float*	HashGradient( U32 _Permutation, int _Dimensions, float _pGradient[8] ) const;
+
+	float	Dot( U32 _Permutation, float u ) const												{ float T[8]; const float* V = Gradient( m_pNoise1, 0, 1, _Permutation, T ); return V[0] * u; }
+	float	Dot( U32 _Permutation, float u, float v ) const										{ float T[8]; const float* V = Gradient( m_pNoise2, 1, 2, _Permutation, T ); return V[0] * u + V[1] * v; }
+	float	Dot( U32 _Permutation, float u, float v, float w ) const							{ float T[8]; const float* V = Gradient( m_pNoise3, 2, 3, _Permutation, T ); return V[0] * u + V[1] * v + V[2] * w; }
+	float	Dot( U32 _Permutation, float u, float v, float w, float r ) const					{ float T[8]; const float* V = Gradient( m_pNoise4, 2, 4, _Permutation, T ); return V[0] * u + V[1] * v + V[2] * w + V[3] * r; }
+	float	Dot( U32 _Permutation, float u, float v, float w, float r, float s ) const			{ float T[8]; const float* V = Gradient( m_pNoise5, 3, 5, _Permutation, T ); return V[0] * u + V[1] * v + V[2] * w + V[3] * r + V[4] * s; }
+	float	Dot( U32 _Permutation, float u, float v, float w, float r, float s, float t ) const	{ float T[8]; const float* V = Gradient( m_pNoise6, 3, 6, _Permutation, T ); return V[0] * u + V[1] * v + V[2] * w + V[3] * r + V[4] * s + V[5] * t; }
 
 	int		PoissonPointsCount( U32 _Random ) const;
 
+	// Computes the lattice indices & fractional offsets of the 2 dimensions used by wrapping noise for the given axis
+	void	WrapLatticeIndices( int _Axis, float _u, U32 _pX_[2], U32 _pX[2], float _pT[2] ) const;
+	void	HashCorners( int _StartDimension, int _EndDimension, const U32* _pX_, const U32* _pX, U32* _pHashes ) const;
+
+#ifdef NUAJ_MATH_SSE
+	struct	PerlinLanes;	// Lattice indices & offsets of 4 points, one per SSE lane
+	void	Perlin3SSE( const PerlinLanes& _Lanes, float _pResults[4] ) const;
+	void	Perlin6SSE( const PerlinLanes& _Lanes, float _pResults[4] ) const;
+#endif
+
 	void	WaveletDownsampleUpsample( float* _pSource, float* _pTarget, int _X, int _Y, int _Size, int _Stride ) const;
 
 public:
@@ -1,7 +1,7 @@
 #include "../GodComplex.h"
 
-#define VWRITE( pVertex, P, N, T, B, UV )	AppendVertex( _Writer, pVertex, P, N, T, B, UV, _TweakVertex, _pUserData );	VerticesCount--
-#define IWRITE( pIndex, i )					_Writer.AppendIndex( pIndex, i );	IndicesCount--
+#define VWRITE( pVertex, P, N, T, B, UV )	WriteVertex( pVertex, P, N, T, B, UV, _TweakVertex, _pUserData );	VerticesCount--
+#define IWRITE( pIndex, i )					*pIndex++ = U32(i);	IndicesCount--
 
 
 //////////////////////////////////////////////////////////////////////////
@@ -15,14 +15,11 @@ void	GeometryBuilder::BuildSphere( int _PhiSubdivisions, int _ThetaSubdivisions,
 	int	IndicesCount = (2*(BandLength+1+1)) * BandsCount - 2;
 
 	// Create the buffers
-	void*	pVerticesArray = NULL;
-	void*	pIndicesArray = NULL;
-	_Writer.CreateBuffers( VerticesCount, IndicesCount, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP, pVerticesArray, pIndicesArray );
-	ASSERT( pVerticesArray != NULL, "Invalid vertex buffer !" );
-	ASSERT( pIndicesArray != NULL, "Invalid index buffer !" );
+	Vertex*	pVerticesArray = new Vertex[VerticesCount];
+	U32*	pIndicesArray = new U32[IndicesCount];
 
-	void*		pVertex = pVerticesArray;
-	void*		pIndex = pIndicesArray;
+	Vertex*	pVertex = pVerticesArray;
+	U32*	pIndex = pIndicesArray;
 
 	//////////////////////////////////////////////////////////////////////////
 	// Build vertices
@@ -148,7 +145,7 @@ void	GeometryBuilder::BuildSphere( int _PhiSubdivisions, int _ThetaSubdivisions,
 
 	//////////////////////////////////////////////////////////////////////////
 	// Finalize
-	_Writer.Finalize( pVerticesArray, pIndicesArray );
+	Finalize( _Writer, int(pVertex - pVerticesArray), pVerticesArray, int(pIndex - pIndicesArray), pIndicesArray );
 }
 
 void	GeometryBuilder::BuildCylinder( int _RadialSubdivisions, int _VerticalSubdivisions, bool _bIncludeCaps, IGeometryWriter& _Writer, const MapperBase* _pMapper, TweakVertexDelegate _TweakVertex, void* _pUserData )
@@ -163,14 +160,11 @@ void	GeometryBuilder::BuildCylinder( int _RadialSubdivisions, int _VerticalSubdi
 	int	IndicesCount = 2 * (BandLength+1) * (BandsCount-1) - 2;
 
 	// Create the buffers
-	void*	pVerticesArray = NULL;
-	void*	pIndicesArray = NULL;
-	_Writer.CreateBuffers( VerticesCount, IndicesCount, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP, pVerticesArray, pIndicesArray );
-	ASSERT( pVerticesArray != NULL, "Invalid vertex buffer !" );
-	ASSERT( pIndicesArray != NULL, "Invalid index buffer !" );
+	Vertex*	pVerticesArray = new Vertex[VerticesCount];
+	U32*	pIndicesArray = new U32[IndicesCount];
 
-	void*		pVertex = pVerticesArray;
-	void*		pIndex = pIndicesArray;
+	Vertex*	pVertex = pVerticesArray;
+	U32*	pIndex = pIndicesArray;
 
 	//////////////////////////////////////////////////////////////////////////
 	// Build vertices
@@ -298,7 +292,7 @@ void	GeometryBuilder::BuildCylinder( int _RadialSubdivisions, int _VerticalSubdi
 
 	//////////////////////////////////////////////////////////////////////////
 	// Finalize
-	_Writer.Finalize( pVerticesArray, pIndicesArray );
+	Finalize( _Writer, int(pVertex - pVerticesArray), pVerticesArray, int(pIndex - pIndicesArray), pIndicesArray );
 }
 
 void	GeometryBuilder::BuildTorus( int _PhiSubdivisions, int _ThetaSubdivisions, float _LargeRadius, float _SmallRadius, IGeometryWriter& _Writer, const MapperBase* _pMapper, TweakVertexDelegate _TweakVertex, void* _pUserData )
@@ -310,14 +304,11 @@ void	GeometryBuilder::BuildTorus( int _PhiSubdivisions, int _ThetaSubdivisions,
 	int	IndicesCount = 2*(BandLength+1+1) * BandsCount - 2;
 
 	// Create the buffers
-	void*	pVerticesArray = NULL;
-	void*	pIndicesArray = NULL;
-	_Writer.CreateBuffers( VerticesCount, IndicesCount, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP, pVerticesArray, pIndicesArray );
-	ASSERT( pVerticesArray != NULL, "Invalid vertex buffer !" );
-	ASSERT( pIndicesArray != NULL, "Invalid index buffer !" );
+	Vertex*	pVerticesArray = new Vertex[VerticesCount];
+	U32*	pIndicesArray = new U32[IndicesCount];
 
-	void*		pVertex = pVerticesArray;
-	void*		pIndex = pIndicesArray;
+	Vertex*	pVertex = pVerticesArray;
+	U32*	pIndex = pIndicesArray;
 
 	//////////////////////////////////////////////////////////////////////////
 	// Build vertices
@@ -379,7 +370,7 @@ void	GeometryBuilder::BuildTorus( int _PhiSubdivisions, int _ThetaSubdivisions,
 
 	//////////////////////////////////////////////////////////////////////////
 	// Finalize
-	_Writer.Finalize( pVerticesArray, pIndicesArray );
+	Finalize( _Writer, int(pVertex - pVerticesArray), pVerticesArray, int(pIndex - pIndicesArray), pIndicesArray );
 }
 
 void	GeometryBuilder::BuildPlane( int _SubdivisionsX, int _SubdivisionsY, const float3& _X, const float3& _Y, IGeometryWriter& _Writer, const MapperBase* _pMapper, TweakVertexDelegate _TweakVertex, void* _pUserData )
@@ -390,14 +381,11 @@ void	GeometryBuilder::BuildPlane( int _SubdivisionsX, int _SubdivisionsY, const
 	int	IndicesCount = 2*(_SubdivisionsX+1+1) * _SubdivisionsY - 2;
 
 	// Create the buffers
-	void*	pVerticesArray = NULL;
-	void*	pIndicesArray = NULL;
-	_Writer.CreateBuffers( VerticesCount, IndicesCount, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP, pVerticesArray, pIndicesArray );
-	ASSERT( pVerticesArray != NULL, "Invalid vertex buffer !" );
-	ASSERT( pIndicesArray != NULL, "Invalid index buffer !" );
+	Vertex*	pVerticesArray = new Vertex[VerticesCount];
+	U32*	pIndicesArray = new U32[IndicesCount];
 
-	void*		pVertex = pVerticesArray;
-	void*		pIndex = pIndicesArray;
+	Vertex*	pVertex = pVerticesArray;
+	U32*	pIndex = pIndicesArray;
 
 	//////////////////////////////////////////////////////////////////////////
 	// Build vertices
@@ -450,7 +438,7 @@ void	GeometryBuilder::BuildPlane( int _SubdivisionsX, int _SubdivisionsY, const
 
 	//////////////////////////////////////////////////////////////////////////
 	// Finalize
-	_Writer.Finalize( pVerticesArray, pIndicesArray );
+	Finalize( _Writer, int(pVertex - pVerticesArray), pVerticesArray, int(pIndex - pIndicesArray), pIndicesArray );
 }
 
 void	GeometryBuilder::BuildCube( int _SubdivisionsX, int _SubdivisionsY, int _SubdivisionsZ, IGeometryWriter& _Writer, const MapperBase* _pMapper, TweakVertexDelegate _TweakVertex, void* _pUserData )
@@ -465,14 +453,11 @@ void	GeometryBuilder::BuildCube( int _SubdivisionsX, int _SubdivisionsY, int _Su
 	int	IndicesCount = 2*( (2*(SizeZ+1) * _SubdivisionsY - 2) + (2*(SizeX+1) * _SubdivisionsZ - 2) + (2*(SizeX+1) * _SubdivisionsZ - 2) ) + 2*5;
 
 	// Create the buffers
-	void*	pVerticesArray = NULL;
-	void*	pIndicesArray = NULL;
-	_Writer.CreateBuffers( VerticesCount, IndicesCount, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP, pVerticesArray, pIndicesArray );
-	ASSERT( pVerticesArray != NULL, "Invalid vertex buffer !" );
-	ASSERT( pIndicesArray != NULL, "Invalid index buffer !" );
+	Vertex*	pVerticesArray = new Vertex[VerticesCount];
+	U32*	pIndicesArray = new U32[IndicesCount];
 
-	void*	pVertex = pVerticesArray;
-	void*	pIndex = pIndicesArray;
+	Vertex*	pVertex = pVerticesArray;
+	U32*	pIndex = pIndicesArray;
 
 	//////////////////////////////////////////////////////////////////////////
 	// Build vertices
@@ -570,25 +555,228 @@ void	GeometryBuilder::BuildCube( int _SubdivisionsX, int _SubdivisionsY, int _Su
 
 	//////////////////////////////////////////////////////////////////////////
 	// Finalize
-	_Writer.Finalize( pVerticesArray, pIndicesArray );
+	Finalize( _Writer, int(pVertex - pVerticesArray), pVerticesArray, int(pIndex - pIndicesArray), pIndicesArray );
 }
 
-void	GeometryBuilder::AppendVertex( IGeometryWriter& _Writer, void*& _pVertex, const float3& _Position, const float3& _Normal, const float3& _Tangent, const float3& _BiTangent, const float2& _UV, TweakVertexDelegate _TweakVertex, void* _pUserData )
+void	GeometryBuilder::WriteVertex( Vertex*& _pVertex, const float3& _Position, const float3& _Normal, const float3& _Tangent, const float3& _BiTangent, const float2& _UV, TweakVertexDelegate _TweakVertex, void* _pUserData )
 {
-	if ( _TweakVertex == NULL )
+	Vertex&	V = *_pVertex++;
+	V.Position = _Position;
+	V.Normal = _Normal;
+	V.Tangent = _Tangent;
+	V.BiTangent = _BiTangent;
+	V.UV = _UV;
+
+	// Ask the user to tweak the vertices
+	if ( _TweakVertex != NULL )
+		(*_TweakVertex)( V.Position, V.Normal, V.Tangent, V.BiTangent, V.UV, _pUserData );
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// Post-transform cache optimization
+// This is Tom Forsyth's "Linear-speed vertex cache optimisation": we greedily emit the triangle with the best score among the
+//	triangles using the vertices currently in a simulated LRU cache, the score of a triangle being the sum of the scores of its
+//	vertices that favor vertices recently used and vertices with few remaining triangles (so we don't leave isolated triangles behind)
+//
+namespace
+{
+	const int	VERTEX_CACHE_SIZE = 32;
+
+	float	ComputeVertexScore( int _CachePosition, int _RemainingTrianglesCount )
+	{
+		if ( _RemainingTrianglesCount == 0 )
+			return -1.0f;	// No longer used
+
+		float	Score = 0.0f;
+		if ( _CachePosition >= 3 )
+			Score = powf( 1.0f - float(_CachePosition - 3) / (VERTEX_CACHE_SIZE - 3), 1.5f );
+		else if ( _CachePosition >= 0 )
+			Score = 0.75f;	// Used by the last triangle: quite a good score but we don't want to favor thin strips either
+
+		Score += 2.0f * powf( float(_RemainingTrianglesCount), -0.5f );
+		return Score;
+	}
+
+	void	OptimizeTrianglesOrder( int _VerticesCount, int _TrianglesCount, U32* _pIndices )
+	{
+		if ( _TrianglesCount == 0 )
+			return;
+
+		// Build the list of triangles using each vertex
+		int*	pRemainingCount = new int[_VerticesCount];	// Amount of triangles still to emit for each vertex
+		int*	pTrianglesOffset = new int[_VerticesCount+1];
+		int*	pVertexTriangles = new int[3*_TrianglesCount];
+		memset( pRemainingCount, 0, _VerticesCount*sizeof(int) );
+		for ( int i=0; i < 3*_TrianglesCount; i++ )
+			pRemainingCount[_pIndices[i]]++;
+
+		pTrianglesOffset[0] = 0;
+		for ( int VertexIndex=0; VertexIndex < _VerticesCount; VertexIndex++ )
+		{
+			pTrianglesOffset[VertexIndex+1] = pTrianglesOffset[VertexIndex] + pRemainingCount[VertexIndex];
+			pRemainingCount[VertexIndex] = 0;
+		}
+		for ( int TriangleIndex=0; TriangleIndex < _TrianglesCount; TriangleIndex++ )
+			for ( int i=0; i < 3; i++ )
+			{
+				U32	VertexIndex = _pIndices[3*TriangleIndex+i];
+				pVertexTriangles[pTrianglesOffset[VertexIndex] + pRemainingCount[VertexIndex]++] = TriangleIndex;
+			}
+
+		int*	pCachePosition = new int[_VerticesCount];
+		float*	pVertexScore = new float[_VerticesCount];
+		for ( int VertexIndex=0; VertexIndex < _VerticesCount; VertexIndex++ )
+		{
+			pCachePosition[VertexIndex] = -1;
+			pVertexScore[VertexIndex] = ComputeVertexScore( -1, pRemainingCount[VertexIndex] );
+		}
+
+		bool*	pEmitted = new bool[_TrianglesCount];
+		memset( pEmitted, 0, _TrianglesCount*sizeof(bool) );
+		U32*	pSourceIndices = new U32[3*_TrianglesCount];
+		memcpy( pSourceIndices, _pIndices, 3*_TrianglesCount*sizeof(U32) );
+
+		int		pCache[VERTEX_CACHE_SIZE+3];
+		int		CacheSize = 0;
+		int		NextUnvisitedTriangle = 0;	// Cursor used to restart on a new triangle when the cache gives no candidate
+		int		BestTriangle = -1;
+		for ( int EmittedCount=0; EmittedCount < _TrianglesCount; EmittedCount++ )
+		{
+			if ( BestTriangle < 0 )
+			{
+				while ( pEmitted[NextUnvisitedTriangle] )
+					NextUnvisitedTriangle++;
+				BestTriangle = NextUnvisitedTriangle;
+			}
+
+			// Emit the triangle
+			pEmitted[BestTriangle] = true;
+			const U32*	pTriangle = &pSourceIndices[3*BestTriangle];
+			memcpy( &_pIndices[3*EmittedCount], pTriangle, 3*sizeof(U32) );
+
+			// Remove it from the lists of its vertices (the remaining triangles of a vertex are kept at the start of its list)
+			for ( int i=0; i < 3; i++ )
+			{
+				U32		VertexIndex = pTriangle[i];
+				int*	pTriangles = &pVertexTriangles[pTrianglesOffset[VertexIndex]];
+				int		Last = --pRemainingCount[VertexIndex];
+				for ( int j=0; j < Last; j++ )
+					if ( pTriangles[j] == BestTriangle )
+					{
+						pTriangles[j] = pTriangles[Last];
+						pTriangles[Last] = BestTriangle;
+						break;
+					}
+			}
+
+			// Move the vertices of the triangle at the top of the cache
+			int	pNewCache[VERTEX_CACHE_SIZE+3];
+			int	NewCacheSize = 0;
+			for ( int i=0; i < 3; i++ )
+				pNewCache[NewCacheSize++] = pTriangle[i];
+			for ( int i=0; i < CacheSize; i++ )
+				if ( pCache[i] != int(pTriangle[0]) && pCache[i] != int(pTriangle[1]) && pCache[i] != int(pTriangle[2]) )
+					pNewCache[NewCacheSize++] = pCache[i];
+
+			// Update the scores of the cached vertices, and of the vertices that got pushed out of the cache
+			for ( int i=0; i < NewCacheSize; i++ )
+			{
+				int	VertexIndex = pNewCache[i];
+				pCachePosition[VertexIndex] = i < VERTEX_CACHE_SIZE ? i : -1;
+				pVertexScore[VertexIndex] = ComputeVertexScore( pCachePosition[VertexIndex], pRemainingCount[VertexIndex] );
+			}
+			CacheSize = MIN( NewCacheSize, VERTEX_CACHE_SIZE );
+			memcpy( pCache, pNewCache, CacheSize*sizeof(int) );
+
+			// Find the best triangle among the ones using the cached vertices
+			BestTriangle = -1;
+			float	BestScore = -1.0f;
+			for ( int i=0; i < CacheSize; i++ )
+			{
+				int			VertexIndex = pCache[i];
+				const int*	pTriangles = &pVertexTriangles[pTrianglesOffset[VertexIndex]];
+				for ( int j=0; j < pRemainingCount[VertexIndex]; j++ )
+				{
+					const U32*	pCandidate = &pSourceIndices[3*pTriangles[j]];
+					float		Score = pVertexScore[pCandidate[0]] + pVertexScore[pCandidate[1]] + pVertexScore[pCandidate[2]];
+					if ( Score > BestScore )
+					{
+						BestScore = Score;
+						BestTriangle = pTriangles[j];
+					}
+				}
+			}
+		}
+
+		delete[] pSourceIndices;
+		delete[] pEmitted;
+		delete[] pVertexScore;
+		delete[] pCachePosition;
+		delete[] pVertexTriangles;
+		delete[] pTrianglesOffset;
+		delete[] pRemainingCount;
+	}
+}
+
+void	GeometryBuilder::Finalize( IGeometryWriter& _Writer, int _VerticesCount, Vertex* _pVertices, int _StripIndicesCount, U32* _pStripIndices )
+{
+	// Convert the strip into a list, dropping the degenerate triangles
+	int		TrianglesCount = 0;
+	U32*	pIndices = new U32[3*MAX( 0, _StripIndicesCount-2 )];
+	for ( int i=0; i < _StripIndicesCount-2; i++ )
+	{
+		U32	I0 = _pStripIndices[i];
+		U32	I1 = _pStripIndices[i+1];
+		U32	I2 = _pStripIndices[i+2];
+		if ( I0 == I1 || I1 == I2 || I2 == I0 )
+			continue;
+
+		U32*	pTriangle = &pIndices[3*TrianglesCount++];
+		pTriangle[0] = (i & 1) ? I1 : I0;	// Odd triangles of a strip have a reversed winding
+		pTriangle[1] = (i & 1) ? I0 : I1;
+		pTriangle[2] = I2;
+	}
+	delete[] _pStripIndices;
+
+	OptimizeTrianglesOrder( _VerticesCount, TrianglesCount, pIndices );
+
+	// Reorder the vertices in the order they're first used so the vertex fetches are linear too
+	int*	pRemap = new int[_VerticesCount];
+	for ( int VertexIndex=0; VertexIndex < _VerticesCount; VertexIndex++ )
+		pRemap[VertexIndex] = -1;
+
+	Vertex*	pVertices = new Vertex[_VerticesCount];
+	int		UsedVerticesCount = 0;
+	for ( int i=0; i < 3*TrianglesCount; i++ )
 	{
-		_Writer.AppendVertex( _pVertex, _Position, _Normal, _Tangent, _BiTangent, _UV );
-		return;
+		int&	NewIndex = pRemap[pIndices[i]];
+		if ( NewIndex < 0 )
+		{
+			NewIndex = UsedVerticesCount++;
+			pVertices[NewIndex] = _pVertices[pIndices[i]];
+		}
+		pIndices[i] = NewIndex;
+	}
+	delete[] pRemap;
+	delete[] _pVertices;
+
+	// Use 16-bits indices whenever possible
+	int		IndicesCount = 3*TrianglesCount;
+	if ( UsedVerticesCount <= 65536 )
+	{
+		U16*	pIndices16 = new U16[MAX( 1, IndicesCount )];
+		for ( int i=0; i < IndicesCount; i++ )
+			pIndices16[i] = U16(pIndices[i]);
+
+		_Writer.Write( UsedVerticesCount, pVertices, IndicesCount, pIndices16, DXGI_FORMAT_R16_UINT, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST );
+		delete[] pIndices16;
 	}
+	else
+		_Writer.Write( UsedVerticesCount, pVertices, IndicesCount, pIndices, DXGI_FORMAT_R32_UINT, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST );
 
-	// Ask the user to tweak the vertices first !
-	float3	P = _Position;
-	float3	N = _Normal;
-	float3	T = _Tangent;
-	float3	B = _BiTangent;
-	float2	UV = _UV;
-	(*_TweakVertex)( P, N, T, B, UV, _pUserData );
-	_Writer.AppendVertex( _pVertex, P, N, T, B, UV );
+	delete[] pIndices;
+	delete[] pVertices;
 }
 
 
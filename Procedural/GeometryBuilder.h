@@ -1,6 +1,10 @@
 //////////////////////////////////////////////////////////////////////////
 // Helps to build a primitive
 //
+// The builders write their vertices and triangle strips into plain arrays, the strips are then converted into a triangle list
+//	whose triangles are reordered for the post-transform vertex cache and whose vertices are reordered in the order they're
+//	first used. The writer finally receives that list in a single call, with 16-bits indices whenever there are at most 65536 vertices.
+//
 #pragma once
 
 class	GeometryBuilder
@@ -72,13 +76,21 @@ public:		// NESTED TYPES
 		virtual void	Map( const float3& _Position, const float3& _Normal, const float3& _Tangent, float2& _UV, bool _bIsBandEndVertex ) const;
 	};
 
+	struct	Vertex
+	{
+		float3	Position;
+		float3	Normal;
+		float3	Tangent;
+		float3	BiTangent;
+		float2	UV;
+	};
+
 	class	IGeometryWriter
 	{
 	public:
-		virtual void	CreateBuffers( int _VerticesCount, int _IndicesCount, D3D11_PRIMITIVE_TOPOLOGY _Topology, void*& _pVertices, void*& _pIndices ) = 0;
-		virtual void	AppendVertex( void*& _pVertex, const float3& _Position, const float3& _Normal, const float3& _Tangent, const float3& _BiTangent, const float2& _UV ) = 0;
-		virtual void	AppendIndex( void*& _pIndex, int _Index ) = 0;
-		virtual void	Finalize( void* _pVertices, void* _pIndices ) = 0;
+		// Receives the final geometry, _pIndices are U16 if _IndexFormat is DXGI_FORMAT_R16_UINT or U32 if it's DXGI_FORMAT_R32_UINT
+		// The arrays are released once the method returns so you must copy them
+		virtual void	Write( int _VerticesCount, const Vertex* _pVertices, int _IndicesCount, const void* _pIndices, DXGI_FORMAT _IndexFormat, D3D11_PRIMITIVE_TOPOLOGY _Topology ) = 0;
 	};
 
 	typedef void	(*TweakVertexDelegate)( float3& _Position, float3& _Normal, float3& _Tangent, const float3& _BiTangent, float2& _UV, void* _pUserData );
@@ -102,5 +114,8 @@ public:		// METHODS
 
 private:
 
-	static void		AppendVertex( IGeometryWriter& _Writer, void*& _pVertex, const float3& _Position, const float3& _Normal, const float3& _Tangent, const float3& _BiTangent, const float2& _UV, TweakVertexDelegate _TweakVertex=NULL, void* _pUserData=NULL );
+	static void		WriteVertex( Vertex*& _pVertex, const float3& _Position, const float3& _Normal, const float3& _Tangent, const float3& _BiTangent, const float2& _UV, TweakVertexDelegate _TweakVertex, void* _pUserData );
+
+	// Optimizes the triangle strip and sends it to the writer (the arrays are deleted)
+	static void		Finalize( IGeometryWriter& _Writer, int _VerticesCount, Vertex* _pVertices, int _StripIndicesCount, U32* _pStripIndices );
 };
@@ -0,0 +1,224 @@
+#include "../GodComplex.h"
+
+static const int	THREADS_X = 16;		// Threads per group of the 2D kernels, cf. JumpFlood.hlsl
+static const int	THREADS_Y = 16;
+static const int	SPLAT_GROUP_SIZE = 256;
+
+ComputeShader*				JumpFlood::ms_ppKernels[JumpFlood::KERNELS_COUNT] = { NULL };
+CB<JumpFlood::CBJumpFlood>*	JumpFlood::ms_pCB_JumpFlood = NULL;
+
+static const char*	gs_ppKernelEntryPoints[JumpFlood::KERNELS_COUNT] =
+{
+	"CS_Clear",
+	"CS_SplatSeeds",
+	"CS_SplatMask",
+	"CS_Step",
+	"CS_Resolve",
+	"CS_ResolveSigned",
+};
+
+JumpFlood::JumpFlood( int _Width, int _Height, bool _bWrap )
+	: m_Width( _Width )
+	, m_Height( _Height )
+	, m_bWrap( _bWrap )
+	, m_Current( 0 )
+	, m_pSB_Seeds( NULL )
+{
+	for ( int BufferIndex=0; BufferIndex < 2; BufferIndex++ )
+		m_ppSeeds[BufferIndex] = new Texture2D( gs_Device, m_Width, m_Height, 1, PixelFormatRGBA32F::DESCRIPTOR, 1, NULL, false, true );
+	m_pResult = new Texture2D( gs_Device, m_Width, m_Height, 1, PixelFormatRGBA32F::DESCRIPTOR, 1, NULL, false, true );
+}
+
+JumpFlood::~JumpFlood()
+{
+	delete m_pSB_Seeds;
+	delete m_pResult;
+	for ( int BufferIndex=0; BufferIndex < 2; BufferIndex++ )
+		delete m_ppSeeds[BufferIndex];
+}
+
+bool	JumpFlood::BuildVoronoi( const float2* _pSeeds, int _SeedsCount )
+{
+	ASSERT( _SeedsCount > 0, "Need at least one seed!" );
+	if ( !CreateKernels() )
+		return false;
+
+	// Upload the seeds
+	if ( m_pSB_Seeds == NULL || m_pSB_Seeds->GetElementsCount() < _SeedsCount )
+	{
+		delete m_pSB_Seeds;
+		m_pSB_Seeds = new StructuredBuffer( gs_Device, sizeof(float2), _SeedsCount, true );
+	}
+	m_pSB_Seeds->Write( (void*) _pSeeds, _SeedsCount );
+
+	ms_pCB_JumpFlood->m.SeedsCount = _SeedsCount;
+	ms_pCB_JumpFlood->m.Flags = m_bWrap ? FLAG_WRAP : 0;
+
+	// Splat them into the cleared seed texture
+	m_Current = 0;
+	Dispatch( KERNEL_CLEAR, (m_Width+THREADS_X-1) / THREADS_X, (m_Height+THREADS_Y-1) / THREADS_Y );
+
+	m_pSB_Seeds->SetInput( 10 );
+	Dispatch( KERNEL_SPLAT_SEEDS, (_SeedsCount+SPLAT_GROUP_SIZE-1) / SPLAT_GROUP_SIZE, 1 );
+	m_pSB_Seeds->RemoveFromLastAssignedSlots();
+
+	Flood();
+
+	// Write the result
+	m_ppSeeds[m_Current]->SetCS( 10 );
+	m_pResult->SetCSUAV( 0 );
+	Dispatch( KERNEL_RESOLVE, (m_Width+THREADS_X-1) / THREADS_X, (m_Height+THREADS_Y-1) / THREADS_Y );
+	gs_Device.RemoveShaderResources( 10, 1, Device::SSF_COMPUTE_SHADER );
+	m_pResult->RemoveFromLastAssignedSlotUAV();
+
+	return true;
+}
+
+bool	JumpFlood::BuildDistanceField( Texture2D& _Mask, float _Threshold )
+{
+	ASSERT( _Mask.GetWidth() == m_Width && _Mask.GetHeight() == m_Height, "The mask must have the same size!" );
+	if ( !CreateKernels() )
+		return false;
+
+	int	GroupsCountX = (m_Width+THREADS_X-1) / THREADS_X;
+	int	GroupsCountY = (m_Height+THREADS_Y-1) / THREADS_Y;
+	ms_pCB_JumpFlood->m.Threshold = _Threshold;
+
+	// 1] Flood the inside texels to get the distance to the shape from the outside
+	ms_pCB_JumpFlood->m.Flags = (m_bWrap ? FLAG_WRAP : 0) | FLAG_INSIDE;
+	m_Current = 0;
+	_Mask.SetCS( 10 );
+	Dispatch( KERNEL_SPLAT_MASK, GroupsCountX, GroupsCountY );
+	gs_Device.RemoveShaderResources( 10, 1, Device::SSF_COMPUTE_SHADER );
+
+	Flood();
+
+	m_ppSeeds[m_Current]->SetCS( 10 );
+	m_pResult->SetCSUAV( 0 );
+	Dispatch( KERNEL_RESOLVE, GroupsCountX, GroupsCountY );
+	gs_Device.RemoveShaderResources( 10, 1, Device::SSF_COMPUTE_SHADER );
+	m_pResult->RemoveFromLastAssignedSlotUAV();
+
+	// 2] Flood the outside texels to get the distance to the border from the inside
+	ms_pCB_JumpFlood->m.Flags = m_bWrap ? FLAG_WRAP : 0;
+	m_Current = 0;
+	_Mask.SetCS( 10 );
+	Dispatch( KERNEL_SPLAT_MASK, GroupsCountX, GroupsCountY );
+	gs_Device.RemoveShaderResources( 10, 1, Device::SSF_COMPUTE_SHADER );
+
+	Flood();
+
+	// 3] Combine both distances into the free seed texture, that becomes the result
+	Texture2D&	Free = *m_ppSeeds[1-m_Current];
+	m_ppSeeds[m_Current]->SetCS( 10 );
+	m_pResult->SetCS( 11 );
+	Free.SetCSUAV( 0 );
+	Dispatch( KERNEL_RESOLVE_SIGNED, GroupsCountX, GroupsCountY );
+	gs_Device.RemoveShaderResources( 10, 2, Device::SSF_COMPUTE_SHADER );
+	Free.RemoveFromLastAssignedSlotUAV();
+
+	m_pResult->CopyFrom( Free );
+
+	return true;
+}
+
+void	JumpFlood::CopyTo( TextureBuilder& _Target, float _DistanceFactor ) const
+{
+	ASSERT( _Target.GetWidth() == m_Width && _Target.GetHeight() == m_Height, "Builders must have the same size!" );
+
+	Texture2D	Staging( gs_Device, m_Width, m_Height, 1, PixelFormatRGBA32F::DESCRIPTOR, 1, NULL, true );
+	Staging.CopyFrom( *m_pResult );
+
+	D3D11_MAPPED_SUBRESOURCE&	Mapped = Staging.Map( 0, 0 );
+	Pixel	P;
+	for ( int Y=0; Y < m_Height; Y++ )
+	{
+		const float4*	pScanline = (const float4*) ((U8*) Mapped.pData + Y * Mapped.RowPitch);
+		for ( int X=0; X < m_Width; X++, pScanline++ )
+		{
+			_Target.Get( X, Y, 0, P );
+			P.RGBA.Set( pScanline->x, _DistanceFactor * pScanline->y, _DistanceFactor * pScanline->z, pScanline->w );
+			_Target.Set( X, Y, P );
+		}
+	}
+	Staging.UnMap( 0, 0 );
+}
+
+void	JumpFlood::ReleaseKernels()
+{
+	for ( int KernelIndex=0; KernelIndex < KERNELS_COUNT; KernelIndex++ )
+	{
+		delete ms_ppKernels[KernelIndex];
+		ms_ppKernels[KernelIndex] = NULL;
+	}
+
+	delete ms_pCB_JumpFlood;
+	ms_pCB_JumpFlood = NULL;
+}
+
+bool	JumpFlood::CreateKernels()
+{
+	// Create the kernels the first time they're needed
+	for ( int KernelIndex=0; KernelIndex < KERNELS_COUNT; KernelIndex++ )
+		if ( ms_ppKernels[KernelIndex] == NULL )
+			ms_ppKernels[KernelIndex] = CreateComputeShader( IDR_SHADER_JUMP_FLOOD, "./Resources/Shaders/JumpFlood.hlsl", gs_ppKernelEntryPoints[KernelIndex] );
+	if ( ms_pCB_JumpFlood == NULL )
+	{
+		ms_pCB_JumpFlood = new CB<CBJumpFlood>( gs_Device, 10 );
+		memset( &ms_pCB_JumpFlood->m, 0, sizeof(CBJumpFlood) );
+	}
+
+	for ( int KernelIndex=0; KernelIndex < KERNELS_COUNT; KernelIndex++ )
+		if ( ms_ppKernels[KernelIndex]->HasErrors() )
+			return false;
+
+	ms_pCB_JumpFlood->m.Width = m_Width;
+	ms_pCB_JumpFlood->m.Height = m_Height;
+	ms_pCB_JumpFlood->m.InvWidth = 1.0f / m_Width;
+	return true;
+}
+
+// Dispatches a kernel reading whatever was bound by the caller and writing the current seed texture, when not bound by the caller
+void	JumpFlood::Dispatch( KERNEL _Kernel, int _GroupsCountX, int _GroupsCountY )
+{
+	ComputeShader&	Kernel = *ms_ppKernels[_Kernel];
+	if ( !Kernel.Use() )
+		return;
+
+	ms_pCB_JumpFlood->UpdateData();
+
+	bool	bWritesSeeds = _Kernel == KERNEL_CLEAR || _Kernel == KERNEL_SPLAT_SEEDS || _Kernel == KERNEL_SPLAT_MASK;
+	if ( bWritesSeeds )
+		m_ppSeeds[m_Current]->SetCSUAV( 0 );
+
+	Kernel.Dispatch( _GroupsCountX, _GroupsCountY, 1 );
+
+	if ( bWritesSeeds )
+		m_ppSeeds[m_Current]->RemoveFromLastAssignedSlotUAV();
+}
+
+// The jump flood passes: steps of N/2, N/4, ..., 1 then a last step of 1
+void	JumpFlood::Flood()
+{
+	int	Size = 1;
+	while ( Size < MAX( m_Width, m_Height ) )
+		Size <<= 1;
+
+	int	GroupsCountX = (m_Width+THREADS_X-1) / THREADS_X;
+	int	GroupsCountY = (m_Height+THREADS_Y-1) / THREADS_Y;
+	for ( int Step=Size >> 1; Step >= 0; Step >>= 1 )
+	{
+		ms_pCB_JumpFlood->m.Step = MAX( 1, Step );
+
+		int	Next = 1 - m_Current;
+		m_ppSeeds[m_Current]->SetCS( 10 );
+		m_ppSeeds[Next]->SetCSUAV( 0 );
+		Dispatch( KERNEL_STEP, GroupsCountX, GroupsCountY );
+		gs_Device.RemoveShaderResources( 10, 1, Device::SSF_COMPUTE_SHADER );
+		m_ppSeeds[Next]->RemoveFromLastAssignedSlotUAV();
+		m_Current = Next;
+
+		if ( Step == 0 )
+			break;	// That was the extra pass
+	}
+}
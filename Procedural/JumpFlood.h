@@ -0,0 +1,108 @@
+//////////////////////////////////////////////////////////////////////////
+// GPU Voronoi & distance field generator using the jump flooding algorithm
+// Each texel of a seed texture stores the nearest seed found so far. Seeds are splatted into their texel, then each
+//	pass looks at the 8 texels at +/-Step around each texel and keeps the nearest of their seeds, Step being halved from
+//	half the texture size down to 1 (plus a last pass at 1 that fixes most of the remaining errors). That's log2(N)+1 passes
+//	whatever the amount of seeds, instead of comparing each texel with each seed.
+//
+// The result is a RGBA32F texture of the same size, with distances in units of the texture width (i.e. in UV space):
+//	_ BuildVoronoi() writes (Nearest Seed ID, Distance to the seed, Distance to the seed, 0)
+//	_ BuildDistanceField() writes (Nearest Texel ID, Distance to the shape's border, Signed distance, 0) where
+//		the texel ID is the Width*Y+X index of the nearest texel on the other side of the border and the signed
+//		distance is negative inside the shape
+//
+// Usage:
+//	JumpFlood	Flood( 1024, 1024, true );	// Wrapping
+//	Flood.BuildVoronoi( pCellCenters, CellsCount );
+//	Flood.CopyTo( TB, float(EFFECT_PARTICLES_COUNT) );	// Read back into a TextureBuilder (expressing distances in cell units)
+//	(or use Flood.GetResult() directly as a texture)
+//
+// NOTE: Seeds falling into the same texel are merged (the last one remains). The compute shader slots t10-t11 & u0 are overwritten.
+//
+#pragma once
+
+class	JumpFlood
+{
+public:		// NESTED TYPES
+
+	enum KERNEL
+	{
+		KERNEL_CLEAR,
+		KERNEL_SPLAT_SEEDS,
+		KERNEL_SPLAT_MASK,
+		KERNEL_STEP,
+		KERNEL_RESOLVE,
+		KERNEL_RESOLVE_SIGNED,
+
+		KERNELS_COUNT
+	};
+
+	// The kernel flags
+	enum FLAGS
+	{
+		FLAG_WRAP = 1,				// Distances are computed on a torus (the texture tiles)
+		FLAG_INSIDE = 2,			// The mask splat keeps the texels inside the shape (outside otherwise)
+	};
+
+protected:
+
+	// WARNING: must match the cbJumpFlood constant buffer in JumpFlood.hlsl!
+	struct	CBJumpFlood
+	{
+		U32		Width;
+		U32		Height;
+		U32		Step;
+		U32		Flags;
+
+		U32		SeedsCount;
+		float	Threshold;
+		float	InvWidth;
+		U32		__PAD;
+	};
+
+protected:	// FIELDS
+
+	int					m_Width;
+	int					m_Height;
+	bool				m_bWrap;
+
+	Texture2D*			m_ppSeeds[2];		// Nearest seed ping-pong (XY = seed position in texels, Z = seed ID, negative if none)
+	int					m_Current;
+	Texture2D*			m_pResult;
+
+	StructuredBuffer*	m_pSB_Seeds;		// Seed positions in UV, grown as needed
+
+	static ComputeShader*	ms_ppKernels[KERNELS_COUNT];
+	static CB<CBJumpFlood>*	ms_pCB_JumpFlood;
+
+public:		// PROPERTIES
+
+	int				GetWidth() const		{ return m_Width; }
+	int				GetHeight() const		{ return m_Height; }
+	Texture2D&		GetResult() const		{ return *m_pResult; }
+
+public:		// METHODS
+
+	JumpFlood( int _Width, int _Height, bool _bWrap );
+	~JumpFlood();
+
+	// Computes the Voronoi diagram of the seeds given in UV space, a seed's ID being its index in the array
+	// Returns false if the kernels failed to compile
+	bool			BuildVoronoi( const float2* _pSeeds, int _SeedsCount );
+
+	// Computes the signed distance field of a shape, the texels of the mask whose red component is >= _Threshold being inside
+	//	(the mask must have the same size)
+	bool			BuildDistanceField( Texture2D& _Mask, float _Threshold=0.5f );
+
+	// Reads the result back into the RGBA of the mip 0 of a CPU builder (same size), distances are multiplied by _DistanceFactor
+	void			CopyTo( TextureBuilder& _Target, float _DistanceFactor=1.0f ) const;
+
+	// Releases the kernels, that are created the first time a flood needs them
+	static void		ReleaseKernels();
+
+protected:
+
+	bool			CreateKernels();
+	void			Dispatch( KERNEL _Kernel, int _ThreadsCountX, int _ThreadsCountY );
+	void			Flood();
+};
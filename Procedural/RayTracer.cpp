@@ -1,6 +1,11 @@
 #include "../GodComplex.h"
 
-RayTracer::RayTracer() : m_pQuads( NULL )
+RayTracer::RayTracer()
+	: m_QuadsCount( 0 )
+	, m_pQuads( NULL )
+	, m_TrianglesCount( 0 )
+	, m_MaxDepth( 0 )
+	, m_bBVHDirty( false )
 {
 }
 RayTracer::~RayTracer()
@@ -68,3 +73,621 @@ void	RayTracer::ExitGeometry()
 	m_pQuads = NULL;
 }
 
+
+
+//////////////////////////////////////////////////////////////////////////
+// Triangles
+//
+namespace
+{
+	const int	MAX_LEAF_TRIANGLES = 4;
+	const int	MAX_DEPTH = 60;				// Beyond that depth we create leaves anyway (the traversal stack must be larger than that!)
+	const int	TRAVERSAL_STACK_SIZE = 64;
+	const int	SAH_BINS_COUNT = 16;
+	const float	SAH_TRAVERSAL_COST = 1.0f;	// Cost of traversing a node, relative to the cost of intersecting a triangle
+
+	struct	BBox
+	{
+		float3	Min, Max;
+
+		BBox() : Min( float3::MaxFlt ), Max( -float3::MaxFlt )	{}
+		void	Grow( const float3& _P )	{ Min = Min.Min( _P ); Max = Max.Max( _P ); }
+		void	Grow( const BBox& _BBox )	{ Min = Min.Min( _BBox.Min ); Max = Max.Max( _BBox.Max ); }
+		float	HalfArea() const
+		{
+			if ( Min.x > Max.x )
+				return 0.0f;	// Empty
+			float3	D = Max - Min;
+			return D.x * D.y + D.y * D.z + D.z * D.x;
+		}
+	};
+
+	// Slab test of a ray against a node's bounding box, returns the entry distance or FLOAT32_MAX if the box is missed
+	float	IntersectBBox( const RayTracer::Node& _Node, const float3& _Position, const float3& _InvDirection, float _MaxDistance )
+	{
+		float	tx0 = (_Node.BBoxMin.x - _Position.x) * _InvDirection.x;
+		float	tx1 = (_Node.BBoxMax.x - _Position.x) * _InvDirection.x;
+		float	ty0 = (_Node.BBoxMin.y - _Position.y) * _InvDirection.y;
+		float	ty1 = (_Node.BBoxMax.y - _Position.y) * _InvDirection.y;
+		float	tz0 = (_Node.BBoxMin.z - _Position.z) * _InvDirection.z;
+		float	tz1 = (_Node.BBoxMax.z - _Position.z) * _InvDirection.z;
+		float	tNear = MAX( MAX( MIN( tx0, tx1 ), MIN( ty0, ty1 ) ), MIN( tz0, tz1 ) );
+		float	tFar = MIN( MIN( MAX( tx0, tx1 ), MAX( ty0, ty1 ) ), MAX( tz0, tz1 ) );
+		return tNear <= tFar && tFar >= 0.0f && tNear <= _MaxDistance ? tNear : FLOAT32_MAX;
+	}
+
+	// Moller-Trumbore intersection (triangles are double-sided)
+	bool	IntersectTriangle( const RayTracer::Triangle_Internal& _Triangle, const float3& _Position, const float3& _Direction, float _MaxDistance, float& _Distance, float2& _Barycentrics )
+	{
+		float3	PVec = _Direction ^ _Triangle.E2;
+		float	Det = _Triangle.E1 | PVec;
+		if ( Det == 0.0f )
+			return false;	// Parallel to the triangle
+		float	InvDet = 1.0f / Det;
+
+		float3	TVec = _Position - _Triangle.P0;
+		float	u = (TVec | PVec) * InvDet;
+		if ( u < 0.0f || u > 1.0f )
+			return false;
+
+		float3	QVec = TVec ^ _Triangle.E1;
+		float	v = (_Direction | QVec) * InvDet;
+		if ( v < 0.0f || u + v > 1.0f )
+			return false;
+
+		float	t = (_Triangle.E2 | QVec) * InvDet;
+		if ( t <= 0.0f || t >= _MaxDistance )
+			return false;
+
+		_Distance = t;
+		_Barycentrics.Set( u, v );
+		return true;
+	}
+
+	float3	Reciprocal( const float3& _Direction )
+	{
+		return float3( _Direction.x != 0.0f ? 1.0f / _Direction.x : FLOAT32_MAX, _Direction.y != 0.0f ? 1.0f / _Direction.y : FLOAT32_MAX, _Direction.z != 0.0f ? 1.0f / _Direction.z : FLOAT32_MAX );
+	}
+
+	__m128	ReciprocalSSE( __m128 _Direction )
+	{
+		__m128	IsZero = _mm_cmpeq_ps( _Direction, _mm_setzero_ps() );
+		__m128	Inv = _mm_div_ps( _mm_set1_ps( 1.0f ), _Direction );
+		return _mm_or_ps( _mm_and_ps( IsZero, _mm_set1_ps( FLOAT32_MAX ) ), _mm_andnot_ps( IsZero, Inv ) );
+	}
+
+	// Packet slab test, returns the entry distances of the lanes in _Mask that hit the box (the others are set to FLOAT32_MAX)
+	__m128	IntersectBBoxSSE( const RayTracer::Node& _Node, const __m128 _pPosition[3], const __m128 _pInvDirection[3], __m128 _MaxDistance, __m128 _Mask )
+	{
+		__m128	tx0 = _mm_mul_ps( _mm_sub_ps( _mm_set1_ps( _Node.BBoxMin.x ), _pPosition[0] ), _pInvDirection[0] );
+		__m128	tx1 = _mm_mul_ps( _mm_sub_ps( _mm_set1_ps( _Node.BBoxMax.x ), _pPosition[0] ), _pInvDirection[0] );
+		__m128	ty0 = _mm_mul_ps( _mm_sub_ps( _mm_set1_ps( _Node.BBoxMin.y ), _pPosition[1] ), _pInvDirection[1] );
+		__m128	ty1 = _mm_mul_ps( _mm_sub_ps( _mm_set1_ps( _Node.BBoxMax.y ), _pPosition[1] ), _pInvDirection[1] );
+		__m128	tz0 = _mm_mul_ps( _mm_sub_ps( _mm_set1_ps( _Node.BBoxMin.z ), _pPosition[2] ), _pInvDirection[2] );
+		__m128	tz1 = _mm_mul_ps( _mm_sub_ps( _mm_set1_ps( _Node.BBoxMax.z ), _pPosition[2] ), _pInvDirection[2] );
+		__m128	tNear = _mm_max_ps( _mm_max_ps( _mm_min_ps( tx0, tx1 ), _mm_min_ps( ty0, ty1 ) ), _mm_min_ps( tz0, tz1 ) );
+		__m128	tFar = _mm_min_ps( _mm_min_ps( _mm_max_ps( tx0, tx1 ), _mm_max_ps( ty0, ty1 ) ), _mm_max_ps( tz0, tz1 ) );
+
+		__m128	Hit = _mm_and_ps( _mm_and_ps( _mm_cmple_ps( tNear, tFar ), _mm_cmpge_ps( tFar, _mm_setzero_ps() ) ), _mm_cmple_ps( tNear, _MaxDistance ) );
+				Hit = _mm_and_ps( Hit, _Mask );
+		return _mm_or_ps( _mm_and_ps( Hit, tNear ), _mm_andnot_ps( Hit, _mm_set1_ps( FLOAT32_MAX ) ) );
+	}
+
+	// Returns the smallest of the 4 lanes
+	float	HorizontalMin( __m128 _V )
+	{
+		__m128	M = _mm_min_ps( _V, _mm_shuffle_ps( _V, _V, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+				M = _mm_min_ps( M, _mm_shuffle_ps( M, M, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+		return _mm_cvtss_f32( M );
+	}
+}
+
+template< typename INDEX > void	RayTracer::AddTrianglesInternal( int _VerticesCount, const float3* _pPositions, int _Stride, int _FacesCount, const INDEX* _pFaces, const float4x4& _Local2World, void* _pTag )
+{
+	// Transform the vertices once
+	float3*	pWorldPositions = new float3[_VerticesCount];
+	for ( int VertexIndex=0; VertexIndex < _VerticesCount; VertexIndex++ )
+	{
+		const float3&	P = *((const float3*) ((const U8*) _pPositions + _Stride * VertexIndex));
+		pWorldPositions[VertexIndex] = float3( float4( P, 1.0f ) * _Local2World );
+	}
+
+	m_Triangles.Reserve( m_Triangles.GetCount() + _FacesCount );
+	for ( int FaceIndex=0; FaceIndex < _FacesCount; FaceIndex++ )
+	{
+		const INDEX*	pFace = &_pFaces[3*FaceIndex];
+		ASSERT( pFace[0] < U32(_VerticesCount) && pFace[1] < U32(_VerticesCount) && pFace[2] < U32(_VerticesCount), "Vertex index out of range!" );
+
+		Triangle_Internal&	Triangle = m_Triangles.Append();
+		Triangle.P0 = pWorldPositions[pFace[0]];
+		Triangle.E1 = pWorldPositions[pFace[1]] - Triangle.P0;
+		Triangle.E2 = pWorldPositions[pFace[2]] - Triangle.P0;
+		Triangle.TriangleIndex = m_Triangles.GetCount()-1;
+		Triangle.pTag = _pTag;
+	}
+
+	delete[] pWorldPositions;
+	m_bBVHDirty = true;
+}
+
+void	RayTracer::AddTriangles( int _VerticesCount, const float3* _pPositions, int _Stride, int _FacesCount, const U32* _pFaces, const float4x4& _Local2World, void* _pTag )
+{
+	AddTrianglesInternal( _VerticesCount, _pPositions, _Stride, _FacesCount, _pFaces, _Local2World, _pTag );
+}
+
+void	RayTracer::AddTriangles( int _VerticesCount, const float3* _pPositions, int _Stride, int _FacesCount, const U16* _pFaces, const float4x4& _Local2World, void* _pTag )
+{
+	AddTrianglesInternal( _VerticesCount, _pPositions, _Stride, _FacesCount, _pFaces, _Local2World, _pTag );
+}
+
+void	RayTracer::AddPrimitive( const Scene::Mesh& _Mesh, const Scene::Mesh::Primitive& _Primitive )
+{
+	ASSERT( _Primitive.m_VertexFormat == Scene::Mesh::Primitive::P3N3G3B3T2, "Unsupported vertex format!" );
+	if ( _Primitive.m_IndexFormat == DXGI_FORMAT_R16_UINT )
+		AddTriangles( _Primitive.m_VerticesCount, (const float3*) _Primitive.m_pVertices, sizeof(Scene::Mesh::Primitive::VF_P3N3G3B3T2), _Primitive.m_FacesCount, (const U16*) _Primitive.m_pFaces, _Mesh.m_Local2World, (void*) &_Primitive );
+	else
+		AddTriangles( _Primitive.m_VerticesCount, (const float3*) _Primitive.m_pVertices, sizeof(Scene::Mesh::Primitive::VF_P3N3G3B3T2), _Primitive.m_FacesCount, (const U32*) _Primitive.m_pFaces, _Mesh.m_Local2World, (void*) &_Primitive );
+}
+
+void	RayTracer::AddScene( const Scene& _Scene )
+{
+	for ( int MeshIndex=0; MeshIndex < _Scene.m_MeshesCount; MeshIndex++ )
+	{
+		const Scene::Mesh&	Mesh = *_Scene.m_ppMeshes[MeshIndex];
+		for ( int PrimitiveIndex=0; PrimitiveIndex < Mesh.m_PrimitivesCount; PrimitiveIndex++ )
+			AddPrimitive( Mesh, Mesh.m_pPrimitives[PrimitiveIndex] );
+	}
+}
+
+void	RayTracer::ClearTriangles()
+{
+	m_Triangles.Clear();
+	m_Nodes.Clear();
+	m_TrianglesCount = 0;
+	m_MaxDepth = 0;
+	m_bBVHDirty = false;
+}
+
+void	RayTracer::BuildBVH()
+{
+	m_Nodes.Clear();
+	m_TrianglesCount = m_Triangles.GetCount();
+	m_MaxDepth = 0;
+	m_bBVHDirty = false;
+	if ( m_TrianglesCount == 0 )
+		return;
+
+	float3*	pCentroids = new float3[m_TrianglesCount];
+	for ( int TriangleIndex=0; TriangleIndex < m_TrianglesCount; TriangleIndex++ )
+	{
+		const Triangle_Internal&	Triangle = m_Triangles[TriangleIndex];
+		pCentroids[TriangleIndex] = Triangle.P0 + (Triangle.E1 + Triangle.E2) / 3.0f;
+	}
+
+	m_Nodes.Init( 2*m_TrianglesCount );	// A binary tree with N leaves has at most 2N-1 nodes
+	m_Nodes.Append();
+	m_MaxDepth = BuildNode( 0, 0, m_TrianglesCount, pCentroids, 1 );
+
+	delete[] pCentroids;
+}
+
+int		RayTracer::BuildNode( int _NodeIndex, int _FirstTriangle, int _TrianglesCount, float3* _pCentroids, int _Depth )
+{
+	// Compute the bounding boxes of the triangles and of their centroids
+	BBox	Bounds, CentroidBounds;
+	for ( int TriangleIndex=_FirstTriangle; TriangleIndex < _FirstTriangle+_TrianglesCount; TriangleIndex++ )
+	{
+		const Triangle_Internal&	Triangle = m_Triangles[TriangleIndex];
+		Bounds.Grow( Triangle.P0 );
+		Bounds.Grow( Triangle.P0 + Triangle.E1 );
+		Bounds.Grow( Triangle.P0 + Triangle.E2 );
+		CentroidBounds.Grow( _pCentroids[TriangleIndex] );
+	}
+
+	Node&	N = m_Nodes[_NodeIndex];
+	N.BBoxMin = Bounds.Min;
+	N.BBoxMax = Bounds.Max;
+	N.ChildOrFirstTriangle = _FirstTriangle;
+	N.TrianglesCount = _TrianglesCount;
+	if ( _TrianglesCount <= MAX_LEAF_TRIANGLES || _Depth >= MAX_DEPTH )
+		return _Depth;
+
+	// Find the best split among the bins of the 3 axes
+	int		BestAxis = -1;
+	int		BestSplit = 0;
+	float	BestCost = FLOAT32_MAX;
+	for ( int Axis=0; Axis < 3; Axis++ )
+	{
+		float	Min = (&CentroidBounds.Min.x)[Axis];
+		float	Max = (&CentroidBounds.Max.x)[Axis];
+		if ( Max <= Min )
+			continue;	// All the centroids lie in the same plane
+		float	BinFactor = SAH_BINS_COUNT / (Max - Min);
+
+		BBox	pBinBounds[SAH_BINS_COUNT];
+		int		pBinCounts[SAH_BINS_COUNT];
+		memset( pBinCounts, 0, SAH_BINS_COUNT*sizeof(int) );
+		for ( int TriangleIndex=_FirstTriangle; TriangleIndex < _FirstTriangle+_TrianglesCount; TriangleIndex++ )
+		{
+			const Triangle_Internal&	Triangle = m_Triangles[TriangleIndex];
+			int		BinIndex = MIN( SAH_BINS_COUNT-1, int( BinFactor * ((&_pCentroids[TriangleIndex].x)[Axis] - Min) ) );
+			pBinCounts[BinIndex]++;
+			pBinBounds[BinIndex].Grow( Triangle.P0 );
+			pBinBounds[BinIndex].Grow( Triangle.P0 + Triangle.E1 );
+			pBinBounds[BinIndex].Grow( Triangle.P0 + Triangle.E2 );
+		}
+
+		// Sweep from the right to get the cost of the right sides, then from the left
+		float	pRightCosts[SAH_BINS_COUNT];
+		BBox	Right;
+		int		RightCount = 0;
+		for ( int BinIndex=SAH_BINS_COUNT-1; BinIndex > 0; BinIndex-- )
+		{
+			Right.Grow( pBinBounds[BinIndex] );
+			RightCount += pBinCounts[BinIndex];
+			pRightCosts[BinIndex] = RightCount * Right.HalfArea();
+		}
+
+		BBox	Left;
+		int		LeftCount = 0;
+		for ( int Split=1; Split < SAH_BINS_COUNT; Split++ )
+		{
+			Left.Grow( pBinBounds[Split-1] );
+			LeftCount += pBinCounts[Split-1];
+			if ( LeftCount == 0 || LeftCount == _TrianglesCount )
+				continue;
+
+			float	Cost = LeftCount * Left.HalfArea() + pRightCosts[Split];
+			if ( Cost < BestCost )
+			{
+				BestCost = Cost;
+				BestAxis = Axis;
+				BestSplit = Split;
+			}
+		}
+	}
+
+	// Partition the triangles
+	int		LeftCount = _TrianglesCount / 2;	// Fallback when all the centroids are identical
+	if ( BestAxis >= 0 )
+	{
+		float	LeafCost = float(_TrianglesCount);
+		float	SplitCost = SAH_TRAVERSAL_COST + BestCost / MAX( 1e-30f, Bounds.HalfArea() );
+		if ( SplitCost >= LeafCost && _TrianglesCount <= 4*MAX_LEAF_TRIANGLES )
+			return _Depth;	// Not worth splitting
+
+		float	Min = (&CentroidBounds.Min.x)[BestAxis];
+		float	BinFactor = SAH_BINS_COUNT / ((&CentroidBounds.Max.x)[BestAxis] - Min);
+		int		i = _FirstTriangle;
+		int		j = _FirstTriangle + _TrianglesCount - 1;
+		while ( i <= j )
+		{
+			int	BinIndex = MIN( SAH_BINS_COUNT-1, int( BinFactor * ((&_pCentroids[i].x)[BestAxis] - Min) ) );
+			if ( BinIndex < BestSplit )
+			{
+				i++;
+				continue;
+			}
+
+			Triangle_Internal	TempTriangle = m_Triangles[i];
+			m_Triangles[i] = m_Triangles[j];
+			m_Triangles[j] = TempTriangle;
+			float3	TempCentroid = _pCentroids[i];
+			_pCentroids[i] = _pCentroids[j];
+			_pCentroids[j] = TempCentroid;
+			j--;
+		}
+		LeftCount = i - _FirstTriangle;
+	}
+
+	// Create the 2 children
+	int		ChildIndex = m_Nodes.GetCount();
+	m_Nodes.Append();
+	m_Nodes.Append();
+	m_Nodes[_NodeIndex].ChildOrFirstTriangle = ChildIndex;
+	m_Nodes[_NodeIndex].TrianglesCount = 0;
+
+	int		LeftDepth = BuildNode( ChildIndex, _FirstTriangle, LeftCount, _pCentroids, _Depth+1 );
+	int		RightDepth = BuildNode( ChildIndex+1, _FirstTriangle + LeftCount, _TrianglesCount - LeftCount, _pCentroids, _Depth+1 );
+	return MAX( LeftDepth, RightDepth );
+}
+
+bool	RayTracer::TraceClosest( const float3& _Position, const float3& _Direction, float _MaxDistance, Hit& _Hit ) const
+{
+	ASSERT( !m_bBVHDirty, "Triangles were added since the last call to BuildBVH()!" );
+
+	_Hit.Distance = FLOAT32_MAX;
+	_Hit.TriangleIndex = -1;
+	_Hit.pTag = NULL;
+	if ( m_Nodes.GetCount() == 0 )
+		return false;
+
+	float3	InvDirection = Reciprocal( _Direction );
+	float	MaxDistance = _MaxDistance;
+	int		HitTriangle = -1;
+
+	int		pStack[TRAVERSAL_STACK_SIZE];
+	int		StackSize = 0;
+	if ( IntersectBBox( m_Nodes[0], _Position, InvDirection, MaxDistance ) == FLOAT32_MAX )
+		return false;
+	pStack[StackSize++] = 0;
+
+	while ( StackSize > 0 )
+	{
+		const Node&	N = m_Nodes[pStack[--StackSize]];
+		if ( N.TrianglesCount > 0 )
+		{	// Leaf
+			for ( int TriangleIndex=N.ChildOrFirstTriangle; TriangleIndex < N.ChildOrFirstTriangle+N.TrianglesCount; TriangleIndex++ )
+				if ( IntersectTriangle( m_Triangles[TriangleIndex], _Position, _Direction, MaxDistance, MaxDistance, _Hit.Barycentrics ) )
+					HitTriangle = TriangleIndex;
+			continue;
+		}
+
+		// Push the farthest child first so we visit the nearest first
+		float	tLeft = IntersectBBox( m_Nodes[N.ChildOrFirstTriangle], _Position, InvDirection, MaxDistance );
+		float	tRight = IntersectBBox( m_Nodes[N.ChildOrFirstTriangle+1], _Position, InvDirection, MaxDistance );
+		int		Near = tLeft <= tRight ? N.ChildOrFirstTriangle : N.ChildOrFirstTriangle+1;
+		int		Far = tLeft <= tRight ? N.ChildOrFirstTriangle+1 : N.ChildOrFirstTriangle;
+		if ( MAX( tLeft, tRight ) != FLOAT32_MAX )
+			pStack[StackSize++] = Far;
+		if ( MIN( tLeft, tRight ) != FLOAT32_MAX )
+			pStack[StackSize++] = Near;
+	}
+
+	if ( HitTriangle < 0 )
+		return false;
+
+	_Hit.Distance = MaxDistance;
+	_Hit.TriangleIndex = m_Triangles[HitTriangle].TriangleIndex;
+	_Hit.pTag = m_Triangles[HitTriangle].pTag;
+	return true;
+}
+
+bool	RayTracer::TraceAny( const float3& _Position, const float3& _Direction, float _MaxDistance ) const
+{
+	ASSERT( !m_bBVHDirty, "Triangles were added since the last call to BuildBVH()!" );
+	if ( m_Nodes.GetCount() == 0 )
+		return false;
+
+	float3	InvDirection = Reciprocal( _Direction );
+	int		pStack[TRAVERSAL_STACK_SIZE];
+	int		StackSize = 0;
+	pStack[StackSize++] = 0;
+
+	float	Distance;
+	float2	Barycentrics;
+	while ( StackSize > 0 )
+	{
+		const Node&	N = m_Nodes[pStack[--StackSize]];
+		if ( IntersectBBox( N, _Position, InvDirection, _MaxDistance ) == FLOAT32_MAX )
+			continue;
+
+		if ( N.TrianglesCount > 0 )
+		{	// Leaf
+			for ( int TriangleIndex=N.ChildOrFirstTriangle; TriangleIndex < N.ChildOrFirstTriangle+N.TrianglesCount; TriangleIndex++ )
+				if ( IntersectTriangle( m_Triangles[TriangleIndex], _Position, _Direction, _MaxDistance, Distance, Barycentrics ) )
+					return true;
+			continue;
+		}
+
+		pStack[StackSize++] = N.ChildOrFirstTriangle+1;
+		pStack[StackSize++] = N.ChildOrFirstTriangle;
+	}
+
+	return false;
+}
+
+int		RayTracer::TracePacket( RayPacket& _Packet, bool _bAnyHit ) const
+{
+	ASSERT( !m_bBVHDirty, "Triangles were added since the last call to BuildBVH()!" );
+
+	int		pHitTriangles[4] = { -1, -1, -1, -1 };
+	float	pBarycentricsU[4], pBarycentricsV[4];
+
+	__m128	pPosition[3], pDirection[3], pInvDirection[3];
+	pPosition[0] = _mm_loadu_ps( _Packet.pPositionX );
+	pPosition[1] = _mm_loadu_ps( _Packet.pPositionY );
+	pPosition[2] = _mm_loadu_ps( _Packet.pPositionZ );
+	pDirection[0] = _mm_loadu_ps( _Packet.pDirectionX );
+	pDirection[1] = _mm_loadu_ps( _Packet.pDirectionY );
+	pDirection[2] = _mm_loadu_ps( _Packet.pDirectionZ );
+	for ( int i=0; i < 3; i++ )
+		pInvDirection[i] = ReciprocalSSE( pDirection[i] );
+
+	__m128	MaxDistance = _mm_loadu_ps( _Packet.pMaxDistance );
+	__m128	Active = _mm_cmpge_ps( MaxDistance, _mm_setzero_ps() );	// Lanes still looking for a hit
+	__m128	HitMask = _mm_setzero_ps();
+
+	int		pStack[TRAVERSAL_STACK_SIZE];
+	int		StackSize = 0;
+	if ( m_Nodes.GetCount() > 0 && _mm_movemask_ps( Active ) != 0 )
+		pStack[StackSize++] = 0;
+
+	const __m128	Zero = _mm_setzero_ps();
+	const __m128	One = _mm_set1_ps( 1.0f );
+	while ( StackSize > 0 )
+	{
+		const Node&	N = m_Nodes[pStack[--StackSize]];
+		__m128	tNear = IntersectBBoxSSE( N, pPosition, pInvDirection, MaxDistance, Active );
+		if ( _mm_movemask_ps( _mm_cmplt_ps( tNear, _mm_set1_ps( FLOAT32_MAX ) ) ) == 0 )
+			continue;	// No lane hits the node
+
+		if ( N.TrianglesCount == 0 )
+		{	// Visit the child that is the nearest for the lanes first
+			const Node&	Left = m_Nodes[N.ChildOrFirstTriangle];
+			const Node&	Right = m_Nodes[N.ChildOrFirstTriangle+1];
+			float	tLeft = HorizontalMin( IntersectBBoxSSE( Left, pPosition, pInvDirection, MaxDistance, Active ) );
+			float	tRight = HorizontalMin( IntersectBBoxSSE( Right, pPosition, pInvDirection, MaxDistance, Active ) );
+			if ( tLeft <= tRight )
+			{
+				pStack[StackSize++] = N.ChildOrFirstTriangle+1;
+				pStack[StackSize++] = N.ChildOrFirstTriangle;
+			}
+			else
+			{
+				pStack[StackSize++] = N.ChildOrFirstTriangle;
+				pStack[StackSize++] = N.ChildOrFirstTriangle+1;
+			}
+			continue;
+		}
+
+		// Intersect the 4 rays with the triangles of the leaf (Moller-Trumbore)
+		for ( int TriangleIndex=N.ChildOrFirstTriangle; TriangleIndex < N.ChildOrFirstTriangle+N.TrianglesCount; TriangleIndex++ )
+		{
+			const Triangle_Internal&	T = m_Triangles[TriangleIndex];
+			__m128	E1x = _mm_set1_ps( T.E1.x ), E1y = _mm_set1_ps( T.E1.y ), E1z = _mm_set1_ps( T.E1.z );
+			__m128	E2x = _mm_set1_ps( T.E2.x ), E2y = _mm_set1_ps( T.E2.y ), E2z = _mm_set1_ps( T.E2.z );
+
+			// PVec = Direction ^ E2
+			__m128	Px = _mm_sub_ps( _mm_mul_ps( pDirection[1], E2z ), _mm_mul_ps( pDirection[2], E2y ) );
+			__m128	Py = _mm_sub_ps( _mm_mul_ps( pDirection[2], E2x ), _mm_mul_ps( pDirection[0], E2z ) );
+			__m128	Pz = _mm_sub_ps( _mm_mul_ps( pDirection[0], E2y ), _mm_mul_ps( pDirection[1], E2x ) );
+			__m128	Det = _mm_add_ps( _mm_add_ps( _mm_mul_ps( E1x, Px ), _mm_mul_ps( E1y, Py ) ), _mm_mul_ps( E1z, Pz ) );
+			__m128	InvDet = _mm_div_ps( One, Det );
+
+			__m128	Tx = _mm_sub_ps( pPosition[0], _mm_set1_ps( T.P0.x ) );
+			__m128	Ty = _mm_sub_ps( pPosition[1], _mm_set1_ps( T.P0.y ) );
+			__m128	Tz = _mm_sub_ps( pPosition[2], _mm_set1_ps( T.P0.z ) );
+			__m128	u = _mm_mul_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( Tx, Px ), _mm_mul_ps( Ty, Py ) ), _mm_mul_ps( Tz, Pz ) ), InvDet );
+
+			// QVec = TVec ^ E1
+			__m128	Qx = _mm_sub_ps( _mm_mul_ps( Ty, E1z ), _mm_mul_ps( Tz, E1y ) );
+			__m128	Qy = _mm_sub_ps( _mm_mul_ps( Tz, E1x ), _mm_mul_ps( Tx, E1z ) );
+			__m128	Qz = _mm_sub_ps( _mm_mul_ps( Tx, E1y ), _mm_mul_ps( Ty, E1x ) );
+			__m128	v = _mm_mul_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( pDirection[0], Qx ), _mm_mul_ps( pDirection[1], Qy ) ), _mm_mul_ps( pDirection[2], Qz ) ), InvDet );
+			__m128	t = _mm_mul_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( E2x, Qx ), _mm_mul_ps( E2y, Qy ) ), _mm_mul_ps( E2z, Qz ) ), InvDet );
+
+			__m128	Hit = _mm_and_ps( Active, _mm_cmpneq_ps( Det, Zero ) );
+					Hit = _mm_and_ps( Hit, _mm_and_ps( _mm_cmpge_ps( u, Zero ), _mm_cmple_ps( u, One ) ) );
+					Hit = _mm_and_ps( Hit, _mm_and_ps( _mm_cmpge_ps( v, Zero ), _mm_cmple_ps( _mm_add_ps( u, v ), One ) ) );
+					Hit = _mm_and_ps( Hit, _mm_and_ps( _mm_cmpgt_ps( t, Zero ), _mm_cmplt_ps( t, MaxDistance ) ) );
+			int		HitBits = _mm_movemask_ps( Hit );
+			if ( HitBits == 0 )
+				continue;
+
+			MaxDistance = _mm_or_ps( _mm_and_ps( Hit, t ), _mm_andnot_ps( Hit, MaxDistance ) );
+			HitMask = _mm_or_ps( HitMask, Hit );
+
+			float	pU[4], pV[4];
+			_mm_storeu_ps( pU, u );
+			_mm_storeu_ps( pV, v );
+			for ( int Lane=0; Lane < 4; Lane++ )
+				if ( HitBits & (1 << Lane) )
+				{
+					pHitTriangles[Lane] = TriangleIndex;
+					pBarycentricsU[Lane] = pU[Lane];
+					pBarycentricsV[Lane] = pV[Lane];
+				}
+
+			if ( _bAnyHit )
+				Active = _mm_andnot_ps( Hit, Active );	// These lanes are done
+		}
+
+		if ( _mm_movemask_ps( Active ) == 0 )
+			break;	// All the lanes found a hit
+	}
+
+	// Write the results
+	float	pDistances[4];
+	_mm_storeu_ps( pDistances, MaxDistance );
+	for ( int Lane=0; Lane < 4; Lane++ )
+	{
+		Hit&	Result = _Packet.pResults[Lane];
+		if ( pHitTriangles[Lane] < 0 )
+		{
+			Result.Distance = FLOAT32_MAX;
+			Result.TriangleIndex = -1;
+			Result.pTag = NULL;
+			continue;
+		}
+
+		const Triangle_Internal&	T = m_Triangles[pHitTriangles[Lane]];
+		Result.Distance = pDistances[Lane];
+		Result.TriangleIndex = T.TriangleIndex;
+		Result.Barycentrics.Set( pBarycentricsU[Lane], pBarycentricsV[Lane] );
+		Result.pTag = T.pTag;
+	}
+
+	return _mm_movemask_ps( HitMask );
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// Batches of rays are split into chunks of packets that are traced by the worker threads
+static const int	BATCH_CHUNK_SIZE = 64;	// Amount of rays per chunk (a multiple of 4)
+
+class	RayTracer::BatchTask : public IJob
+{
+	const RayTracer&	m_Owner;
+	int					m_RaysCount;
+	BatchRay*			m_pRays;
+	bool				m_bAnyHit;
+	int					m_ChunksCount;
+	volatile LONG		m_NextChunkIndex;
+
+public:
+
+	BatchTask( const RayTracer& _Owner, int _RaysCount, BatchRay* _pRays, bool _bAnyHit )
+		: m_Owner( _Owner )
+		, m_RaysCount( _RaysCount )
+		, m_pRays( _pRays )
+		, m_bAnyHit( _bAnyHit )
+		, m_NextChunkIndex( 0 )
+	{
+		m_ChunksCount = (_RaysCount + BATCH_CHUNK_SIZE-1) / BATCH_CHUNK_SIZE;
+	}
+
+	void			Execute()
+	{
+		JobQueue&	Jobs = gs_Device.Jobs();
+		int			HelpersCount = MIN( Jobs.GetHelpersCount(), m_ChunksCount-1 );
+		for ( int HelperIndex=0; HelperIndex < HelpersCount; HelperIndex++ )
+			Jobs.Push( *this );
+		Run();
+		if ( HelpersCount > 0 )
+			Jobs.Wait();
+	}
+
+	virtual void	Run()
+	{
+		RayPacket	Packet;
+		for ( ;; )
+		{
+			int	ChunkIndex = InterlockedIncrement( &m_NextChunkIndex ) - 1;
+			if ( ChunkIndex >= m_ChunksCount )
+				return;
+
+			int	ChunkStart = BATCH_CHUNK_SIZE * ChunkIndex;
+			int	ChunkEnd = MIN( ChunkStart + BATCH_CHUNK_SIZE, m_RaysCount );
+			for ( int PacketStart=ChunkStart; PacketStart < ChunkEnd; PacketStart+=4 )
+			{
+				int	LanesCount = MIN( 4, ChunkEnd - PacketStart );
+				for ( int Lane=0; Lane < 4; Lane++ )
+				{
+					const BatchRay&	Ray = m_pRays[PacketStart + MIN( Lane, LanesCount-1 )];
+					Packet.pPositionX[Lane] = Ray.Position.x;
+					Packet.pPositionY[Lane] = Ray.Position.y;
+					Packet.pPositionZ[Lane] = Ray.Position.z;
+					Packet.pDirectionX[Lane] = Ray.Direction.x;
+					Packet.pDirectionY[Lane] = Ray.Direction.y;
+					Packet.pDirectionZ[Lane] = Ray.Direction.z;
+					Packet.pMaxDistance[Lane] = Lane < LanesCount ? Ray.MaxDistance : -1.0f;	// Disable the lanes past the end of the batch
+				}
+
+				m_Owner.TracePacket( Packet, m_bAnyHit );
+
+				for ( int Lane=0; Lane < LanesCount; Lane++ )
+					m_pRays[PacketStart + Lane].Result = Packet.pResults[Lane];
+			}
+		}
+	}
+};
+
+void	RayTracer::TraceBatch( int _RaysCount, BatchRay* _pRays, bool _bAnyHit ) const
+{
+	if ( _RaysCount <= 0 )
+		return;
+
+	BatchTask	Task( *this, _RaysCount, _pRays, _bAnyHit );
+	Task.Execute();
+}
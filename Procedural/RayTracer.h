@@ -1,6 +1,20 @@
 //////////////////////////////////////////////////////////////////////////
 // Helps to ray trace a bunch of rays
-// We only raytrace for quads at the moment
+//
+// Two kinds of geometry are supported:
+//	_ A few quads that are simply traced one after another (cf. InitGeometry())
+//	_ Triangle meshes, e.g. the primitives of a Scene, that are organized into a bounding volume hierarchy (cf. AddTriangles())
+//
+// The BVH is built top-down with the surface area heuristic (SAH) evaluated on bins, leaves contain at most 4 triangles.
+// Rays can be traced one at a time, as packets of 4 rays traversing the BVH together with SSE, or as large batches
+//	that are split into packets and traced by the worker threads. Packets are much faster when their rays are coherent
+//	(i.e. same origin and similar directions, like the rays of a hemisphere for AO or the texels of a cube map face).
+//
+// Each query comes in 2 flavors:
+//	_ Closest hit returns the nearest intersection along the ray
+//	_ Any hit returns as soon as an intersection is found, which is all you need for shadows, AO or visibility
+//
+// THREAD SAFETY: Once the BVH is built, any number of threads can trace rays concurrently
 //
 #pragma once
 
@@ -41,12 +55,71 @@ public:		// NESTED TYPES
 		float4	SizeAndInvSize;	// XY=0.5*Size ZW=1/(0.5*Size)
 	};
 
+	// The result of a query against the triangles
+	struct	Hit
+	{
+		float		Distance;		// Distance to the hit (FLOAT32_MAX if there is no hit)
+		int			TriangleIndex;	// Index of the hit triangle (-1 if there is no hit)
+		float2		Barycentrics;	// Weights of the triangle's 2nd and 3rd vertices at the hit position
+		void*		pTag;			// The tag of the triangles that were hit (cf. AddTriangles())
+	};
+
+	// A ray of a batch (cf. TraceBatch())
+	struct	BatchRay
+	{
+		float3		Position;
+		float3		Direction;		// Doesn't need to be normalized, distances are then expressed in units of that direction's length
+		float		MaxDistance;
+		Hit			Result;
+	};
+
+	// A packet of 4 rays in SoA layout (cf. TracePacket())
+	// Set MaxDistance to a negative value to disable a lane
+	struct	RayPacket
+	{
+		float		pPositionX[4], pPositionY[4], pPositionZ[4];
+		float		pDirectionX[4], pDirectionY[4], pDirectionZ[4];
+		float		pMaxDistance[4];
+		Hit			pResults[4];
+	};
+
+	struct	Triangle_Internal
+	{
+		float3		P0;
+		float3		E1, E2;			// Edges P1-P0 & P2-P0
+		int			TriangleIndex;	// Index of the triangle in the order it was added
+		void*		pTag;
+	};
+
+	struct	Node
+	{
+		float3		BBoxMin;
+		int			ChildOrFirstTriangle;	// Index of the 1st child for internal nodes (the 2nd child follows), of the 1st triangle for leaves
+		float3		BBoxMax;
+		int			TrianglesCount;			// 0 for internal nodes
+	};
+
+	class	BatchTask;
+
 
 protected:	// FIELDS
 
 	int				m_QuadsCount;
 	Quad_Internal*	m_pQuads;
 
+	List<Triangle_Internal>	m_Triangles;	// Reordered in the order of the BVH leaves once BuildBVH() is called
+	List<Node>				m_Nodes;		// The root is node 0
+	int						m_TrianglesCount;
+	int						m_MaxDepth;
+	bool					m_bBVHDirty;
+
+
+public:		// PROPERTIES
+
+	int				GetTrianglesCount() const	{ return m_TrianglesCount; }
+	int				GetNodesCount() const		{ return m_Nodes.GetCount(); }
+	int				GetMaxDepth() const			{ return m_MaxDepth; }
+
 
 public:		// METHODS
 
@@ -59,4 +132,40 @@ public:		// METHODS
 	bool	Trace( Ray& _Ray );
 
 	void	ExitGeometry();
+
+
+	// =================== Triangles ===================
+	// Adds triangles to the BVH (you must call BuildBVH() once you added all the triangles)
+	//	_pPositions, the positions of the vertices with a stride of _Stride bytes
+	//	_pFaces, 3 indices per face
+	//	_pTag, a user tag returned by the queries that hit these triangles
+	void	AddTriangles( int _VerticesCount, const float3* _pPositions, int _Stride, int _FacesCount, const U32* _pFaces, const float4x4& _Local2World, void* _pTag=NULL );
+	void	AddTriangles( int _VerticesCount, const float3* _pPositions, int _Stride, int _FacesCount, const U16* _pFaces, const float4x4& _Local2World, void* _pTag=NULL );
+
+	// Adds the primitive of a scene mesh, transformed into WORLD space (the tag is the primitive)
+	void	AddPrimitive( const Scene::Mesh& _Mesh, const Scene::Mesh::Primitive& _Primitive );
+
+	// Adds all the primitives of all the meshes of a scene
+	void	AddScene( const Scene& _Scene );
+
+	void	BuildBVH();
+	void	ClearTriangles();
+
+	// Single ray queries
+	bool	TraceClosest( const float3& _Position, const float3& _Direction, float _MaxDistance, Hit& _Hit ) const;
+	bool	TraceAny( const float3& _Position, const float3& _Direction, float _MaxDistance ) const;
+
+	// Traces a packet of 4 rays together, returns a mask of the lanes that hit something
+	// When _bAnyHit is true, the hit infos other than the distance are not filled
+	int		TracePacket( RayPacket& _Packet, bool _bAnyHit ) const;
+
+	// Traces a batch of rays using all the worker threads
+	// Consecutive rays should be coherent as they're traced in packets of 4
+	void	TraceBatch( int _RaysCount, BatchRay* _pRays, bool _bAnyHit ) const;
+
+protected:
+
+	template< typename INDEX > void	AddTrianglesInternal( int _VerticesCount, const float3* _pPositions, int _Stride, int _FacesCount, const INDEX* _pFaces, const float4x4& _Local2World, void* _pTag );
+
+	int		BuildNode( int _NodeIndex, int _FirstTriangle, int _TrianglesCount, float3* _pCentroids, int _Depth );
 };
@@ -1,17 +1,36 @@
 #include "../GodComplex.h"
 
-TextureBuilder::TextureBuilder( int _Width, int _Height )
+TextureBuilder::TextureBuilder( int _Width, int _Height, U32 _PlanarChannels )
 	: m_ppBufferSpecific( NULL )
+	, m_SpecificArraySize( 0 )
+	, m_ppBufferGeneric( NULL )
+	, m_PlanarChannels( _PlanarChannels )
+	, m_pPlanes( NULL )
 	, m_Width( _Width )
 	, m_Height( _Height )
 	, m_bMipLevelsBuilt( false )
 {
+	ALLOCATION_TAG( "TextureBuilder" );
 	m_MipLevelsCount = Texture2D::ComputeMipLevelsCount( _Width, _Height, 0 );
-	m_ppBufferGeneric = new Pixel*[m_MipLevelsCount];
+	if ( m_PlanarChannels == 0 )
+		m_ppBufferGeneric = new Pixel*[m_MipLevelsCount];
+	else
+		m_pPlanes = new Planes[m_MipLevelsCount];
 	m_pMipSizes = new int[2*m_MipLevelsCount];
 	for ( int MipLevelIndex=0; MipLevelIndex < m_MipLevelsCount; MipLevelIndex++ )
 	{
-		m_ppBufferGeneric[MipLevelIndex] = new Pixel[_Width*_Height];
+		int	PixelsCount = _Width*_Height;
+		if ( m_pPlanes == NULL )
+			m_ppBufferGeneric[MipLevelIndex] = new Pixel[PixelsCount];
+		else
+		{	// Only allocate the planes of the requested channels (our allocators return zeroed memory)
+			Planes&	P = m_pPlanes[MipLevelIndex];
+			P.pRGBA = m_PlanarChannels & CHANNEL_RGBA ? new float4[PixelsCount] : NULL;
+			P.pHeight = m_PlanarChannels & CHANNEL_HEIGHT ? new float[PixelsCount] : NULL;
+			P.pRoughness = m_PlanarChannels & CHANNEL_ROUGHNESS ? new float[PixelsCount] : NULL;
+			P.pMetallic = m_PlanarChannels & CHANNEL_METALLIC ? new float[PixelsCount] : NULL;
+			P.pMatID = m_PlanarChannels & CHANNEL_MATID ? new int[PixelsCount] : NULL;
+		}
 		m_pMipSizes[2*MipLevelIndex+0] = _Width;
 		m_pMipSizes[2*MipLevelIndex+1] = _Height;
 		Texture2D::NextMipSize( _Width, _Height );
@@ -21,9 +40,20 @@ TextureBuilder::TextureBuilder( int _Width, int _Height )
 TextureBuilder::~TextureBuilder()
 {
 	for ( int MipLevelIndex=0; MipLevelIndex < m_MipLevelsCount; MipLevelIndex++ )
-		delete[] m_ppBufferGeneric[MipLevelIndex];
+		if ( m_pPlanes == NULL )
+			delete[] m_ppBufferGeneric[MipLevelIndex];
+		else
+		{
+			Planes&	P = m_pPlanes[MipLevelIndex];
+			delete[] P.pRGBA;
+			delete[] P.pHeight;
+			delete[] P.pRoughness;
+			delete[] P.pMetallic;
+			delete[] P.pMatID;
+		}
 	delete[] m_pMipSizes;
 	delete[] m_ppBufferGeneric;
+	delete[] m_pPlanes;
 	ReleaseSpecificBuffer();
 }
 
@@ -33,6 +63,238 @@ const void**	TextureBuilder::GetLastConvertedMips() const
 	return (const void**) m_ppBufferSpecific;
 }
 
+//////////////////////////////////////////////////////////////////////////
+// Planar storage
+// Pixels are gathered from and scattered to the stored planes only, missing channels are left untouched
+namespace
+{
+	void	LoadPixel( const TextureBuilder::Planes& _Planes, int _Index, Pixel& _Pixel )
+	{
+		if ( _Planes.pRGBA != NULL )
+			_Pixel.RGBA = _Planes.pRGBA[_Index];
+		if ( _Planes.pHeight != NULL )
+			_Pixel.Height = _Planes.pHeight[_Index];
+		if ( _Planes.pRoughness != NULL )
+			_Pixel.Roughness = _Planes.pRoughness[_Index];
+		if ( _Planes.pMetallic != NULL )
+			_Pixel.Metallic = _Planes.pMetallic[_Index];
+		if ( _Planes.pMatID != NULL )
+			_Pixel.MatID = _Planes.pMatID[_Index];
+	}
+
+	void	StorePixel( const TextureBuilder::Planes& _Planes, int _Index, const Pixel& _Pixel )
+	{
+		if ( _Planes.pRGBA != NULL )
+			_Planes.pRGBA[_Index] = _Pixel.RGBA;
+		if ( _Planes.pHeight != NULL )
+			_Planes.pHeight[_Index] = _Pixel.Height;
+		if ( _Planes.pRoughness != NULL )
+			_Planes.pRoughness[_Index] = _Pixel.Roughness;
+		if ( _Planes.pMetallic != NULL )
+			_Planes.pMetallic[_Index] = _Pixel.Metallic;
+		if ( _Planes.pMatID != NULL )
+			_Planes.pMatID[_Index] = _Pixel.MatID;
+	}
+
+	// Bilinear interpolation of 4 pixels (Metallic is left untouched and MatID is taken from the first pixel)
+	void	BilerpPixels( const Pixel& V00, const Pixel& V01, const Pixel& V10, const Pixel& V11, float x, float y, Pixel& _Pixel )
+	{
+		float	rx = 1.0f - x;
+		float	ry = 1.0f - y;
+
+		float4	V0 = rx * V00.RGBA + x * V01.RGBA;
+		float4	V1 = rx * V10.RGBA + x * V11.RGBA;
+		float		H0 = rx * V00.Height + x * V01.Height;
+		float		H1 = rx * V10.Height + x * V11.Height;
+		float		R0 = rx * V00.Roughness + x * V01.Roughness;
+		float		R1 = rx * V10.Roughness + x * V11.Roughness;
+
+		_Pixel.RGBA.x = ry * V0.x + y * V1.x;
+		_Pixel.RGBA.y = ry * V0.y + y * V1.y;
+		_Pixel.RGBA.z = ry * V0.z + y * V1.z;
+		_Pixel.RGBA.w = ry * V0.w + y * V1.w;
+		_Pixel.Height = ry * H0 + y * H1;
+		_Pixel.Roughness = ry * R0 + y * R1;
+		_Pixel.MatID = V00.MatID;	// Arbitrary!
+	}
+}
+
+inline const Pixel&	TextureBuilder::Fetch( int _MipLevel, int _Index, Pixel& _Temp ) const
+{
+	if ( m_pPlanes == NULL )
+		return m_ppBufferGeneric[_MipLevel][_Index];
+
+	LoadPixel( m_pPlanes[_MipLevel], _Index, _Temp );
+	return _Temp;
+}
+
+float*	TextureBuilder::GetChannel( int _MipLevel, CHANNEL _Channel, int& _Stride ) const
+{
+	if ( m_pPlanes == NULL )
+	{
+		Pixel*	pPixels = m_ppBufferGeneric[_MipLevel];
+		_Stride = sizeof(Pixel) / sizeof(float);
+		switch ( _Channel )
+		{
+		case CHANNEL_RGBA:		return &pPixels->RGBA.x;
+		case CHANNEL_HEIGHT:	return &pPixels->Height;
+		case CHANNEL_ROUGHNESS:	return &pPixels->Roughness;
+		case CHANNEL_METALLIC:	return &pPixels->Metallic;
+		case CHANNEL_MATID:		return (float*) &pPixels->MatID;
+		}
+		return NULL;
+	}
+
+	const Planes&	P = m_pPlanes[_MipLevel];
+	_Stride = _Channel == CHANNEL_RGBA ? 4 : 1;
+	switch ( _Channel )
+	{
+	case CHANNEL_RGBA:		return P.pRGBA != NULL ? &P.pRGBA->x : NULL;
+	case CHANNEL_HEIGHT:	return P.pHeight;
+	case CHANNEL_ROUGHNESS:	return P.pRoughness;
+	case CHANNEL_METALLIC:	return P.pMetallic;
+	case CHANNEL_MATID:		return (float*) P.pMatID;
+	}
+	return NULL;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// Tiled execution
+// The area to process is split into square tiles small enough to fit in cache, the tiles are then
+//	grabbed one by one by the calling thread and the job system's workers until none is left
+// Since the job system accepts jobs from any job thread, fills called from a job (e.g. an InitGraph task) use the idle workers too
+namespace
+{
+	static const int	TILE_SIZE = 64;		// 64x64 fat pixels = 128Kb
+
+	class	TiledTask : public IParallelForKernel
+	{
+		int				m_Width;
+		int				m_Height;
+		int				m_TilesCountX;
+		int				m_TilesCount;
+
+	public:
+
+		virtual void	ProcessTile( int _X0, int _Y0, int _X1, int _Y1 ) = 0;
+
+		void			Execute( int _Width, int _Height, bool _bParallel )
+		{
+			m_Width = _Width;
+			m_Height = _Height;
+			m_TilesCountX = (_Width + TILE_SIZE-1) / TILE_SIZE;
+			m_TilesCount = m_TilesCountX * ((_Height + TILE_SIZE-1) / TILE_SIZE);
+
+			if ( !_bParallel || m_TilesCount == 1 || gs_Jobs.GetHelpersCount() == 0 )
+			{	// Process the whole area in a single pass, scanline after scanline
+				ProcessTile( 0, 0, _Width, _Height );
+				return;
+			}
+
+			gs_Jobs.ParallelFor( m_TilesCount, 1, *this );
+		}
+
+		virtual void	Run( int _StartTileIndex, int _EndTileIndex )
+		{
+			for ( int TileIndex=_StartTileIndex; TileIndex < _EndTileIndex; TileIndex++ )
+			{
+				int	X0 = TILE_SIZE * (TileIndex % m_TilesCountX);
+				int	Y0 = TILE_SIZE * (TileIndex / m_TilesCountX);
+				ProcessTile( X0, Y0, MIN( X0+TILE_SIZE, m_Width ), MIN( Y0+TILE_SIZE, m_Height ) );
+			}
+		}
+	};
+
+	class	FillTask : public TiledTask
+	{
+		TextureBuilder::FillDelegate	m_pFiller;
+		void*							m_pData;
+		Pixel*							m_pBuffer;
+		const TextureBuilder::Planes*	m_pPlanes;	// Used instead of the buffer in planar storage
+		int								m_Width;
+		int								m_Height;
+
+	public:
+
+		FillTask( TextureBuilder::FillDelegate _pFiller, void* _pData, Pixel* _pBuffer, const TextureBuilder::Planes* _pPlanes, int _Width, int _Height )
+			: m_pFiller( _pFiller ), m_pData( _pData ), m_pBuffer( _pBuffer ), m_pPlanes( _pPlanes ), m_Width( _Width ), m_Height( _Height )	{}
+
+		virtual void	ProcessTile( int _X0, int _Y0, int _X1, int _Y1 )
+		{
+			float2	UV;
+			if ( m_pPlanes != NULL )
+			{	// Gather the stored channels, fill and scatter them back
+				for ( int Y=_Y0; Y < _Y1; Y++ )
+				{
+					int	Index = m_Width * Y + _X0;
+					UV.y = float(Y) / m_Height;
+					for ( int X=_X0; X < _X1; X++, Index++ )
+					{
+						UV.x = float(X) / m_Width;
+
+						Pixel	P;
+						LoadPixel( *m_pPlanes, Index, P );
+						(*m_pFiller)( X, Y, UV, P, m_pData );
+						StorePixel( *m_pPlanes, Index, P );
+					}
+				}
+				return;
+			}
+
+			for ( int Y=_Y0; Y < _Y1; Y++ )
+			{
+				Pixel*	pScanline = m_pBuffer + m_Width * Y + _X0;
+				UV.y = float(Y) / m_Height;
+				for ( int X=_X0; X < _X1; X++, pScanline++ )
+				{
+					UV.x = float(X) / m_Width;
+					(*m_pFiller)( X, Y, UV, *pScanline, m_pData );
+				}
+			}
+		}
+	};
+
+	class	MipTask : public TiledTask
+	{
+		Pixel*			m_pSource;
+		int				m_SourceWidth;
+		int				m_SourceHeight;
+		Pixel*			m_pTarget;
+		int				m_Width;
+		bool			m_bTreatRGBAsNormal;
+		bool			m_bNormalizeNormals;
+
+	public:
+
+		MipTask( Pixel* _pSource, int _SourceWidth, int _SourceHeight, Pixel* _pTarget, int _Width, bool _bTreatRGBAsNormal, bool _bNormalizeNormals )
+			: m_pSource( _pSource ), m_SourceWidth( _SourceWidth ), m_SourceHeight( _SourceHeight ), m_pTarget( _pTarget ), m_Width( _Width ), m_bTreatRGBAsNormal( _bTreatRGBAsNormal ), m_bNormalizeNormals( _bNormalizeNormals )	{}
+
+		virtual void	ProcessTile( int _X0, int _Y0, int _X1, int _Y1 );
+	};
+
+	// Same as the MipTask but for planar storage, each stored plane is reduced separately
+	class	PlanarMipTask : public TiledTask
+	{
+		const TextureBuilder::Planes&	m_Source;
+		int								m_SourceWidth;
+		int								m_SourceHeight;
+		const TextureBuilder::Planes&	m_Target;
+		int								m_Width;
+		bool							m_bTreatRGBAsNormal;
+		bool							m_bNormalizeNormals;
+
+		void			ReduceScanline( const float* _pSource, float* _pTarget, int _Y, int _X0, int _X1 ) const;
+
+	public:
+
+		PlanarMipTask( const TextureBuilder::Planes& _Source, int _SourceWidth, int _SourceHeight, const TextureBuilder::Planes& _Target, int _Width, bool _bTreatRGBAsNormal, bool _bNormalizeNormals )
+			: m_Source( _Source ), m_SourceWidth( _SourceWidth ), m_SourceHeight( _SourceHeight ), m_Target( _Target ), m_Width( _Width ), m_bTreatRGBAsNormal( _bTreatRGBAsNormal ), m_bNormalizeNormals( _bNormalizeNormals )	{}
+
+		virtual void	ProcessTile( int _X0, int _Y0, int _X1, int _Y1 );
+	};
+}
+
 namespace Fillers
 {
 	struct __FillerSampleStruct
@@ -63,7 +325,7 @@ void	TextureBuilder::CopyFromFast( const TextureBuilder& _Source )
 	Param.H = _Source.GetHeight();
 	Param.MipLevel = 0;
 //	Fill( Fillers::CopyFillerFast, (void*) &Param );
-	Fill( Fillers::CopyFiller, (void*) &Param );
+	Fill( Fillers::CopyFiller, (void*) &Param, &_Source != this );
 }
 
 void	TextureBuilder::CopyFrom( const TextureBuilder& _Source )
@@ -87,12 +349,20 @@ void	TextureBuilder::CopyFrom( const TextureBuilder& _Source )
 	Param.H = _Source.m_pMipSizes[2*MipLevel+1];
 	Param.MipLevel = MipLevel;
 
-	Fill( Fillers::CopyFiller, (void*) &Param );
+	Fill( Fillers::CopyFiller, (void*) &Param, &_Source != this );
 }
 
 void	TextureBuilder::Clear( const Pixel& _Pixel )
 {
 	// Clear the mip level 0
+	if ( m_pPlanes != NULL )
+	{
+		for ( int Index=0; Index < m_Width*m_Height; Index++ )
+			StorePixel( m_pPlanes[0], Index, _Pixel );
+		m_bMipLevelsBuilt = false;
+		return;
+	}
+
 	for ( int Y=0; Y < m_Height; Y++ )
 	{
 		Pixel*	pScanline = m_ppBufferGeneric[0] + m_Width * Y;
@@ -102,20 +372,60 @@ void	TextureBuilder::Clear( const Pixel& _Pixel )
 	m_bMipLevelsBuilt = false;
 }
 
-void	TextureBuilder::Fill( FillDelegate _Filler, void* _pData )
+void	TextureBuilder::Fill( FillDelegate _Filler, void* _pData, bool _bThreadSafe )
 {
 	// Fill the mip level 0
-	float2	UV;
-	for ( int Y=0; Y < m_Height; Y++ )
+	FillTask	Task( _Filler, _pData, m_pPlanes == NULL ? m_ppBufferGeneric[0] : NULL, m_pPlanes, m_Width, m_Height );
+	Task.Execute( m_Width, m_Height, _bThreadSafe );
+
+	m_bMipLevelsBuilt = false;
+}
+
+namespace
+{
+	struct	IterateData
 	{
-		Pixel*	pScanline = m_ppBufferGeneric[0] + m_Width * Y;
-		UV.y = float(Y) / m_Height;
-		for ( int X=0; X < m_Width; X++, pScanline++ )
+		TextureBuilder::IterateDelegate	pIterator;
+		void*							pData;
+		const TextureBuilder*			pFront;
+	};
+
+	void	FillIteration( int _X, int _Y, const float2& _UV, Pixel& _Pixel, void* _pData )
+	{
+		IterateData&	Params = *((IterateData*) _pData);
+		Params.pFront->Get( _X, _Y, 0, _Pixel );	// The back buffer holds the iteration before the previous one
+		(*Params.pIterator)( _X, _Y, _UV, *Params.pFront, _Pixel, Params.pData );
+	}
+}
+
+void	TextureBuilder::Iterate( IterateDelegate _Iterator, void* _pData, int _IterationsCount )
+{
+	// Each iteration fills the back buffer from the front buffer then they're swapped
+	// The back buffer uses the same storage so we can swap the mip level 0 pointers instead of copying
+	TextureBuilder	Back( m_Width, m_Height, m_PlanarChannels );
+
+	IterateData	Params;
+	Params.pIterator = _Iterator;
+	Params.pData = _pData;
+	Params.pFront = this;
+	for ( int IterationIndex=0; IterationIndex < _IterationsCount; IterationIndex++ )
+	{
+		Back.Fill( FillIteration, &Params, true );
+
+		if ( m_pPlanes != NULL )
 		{
-			UV.x = float(X) / m_Width;
-			(*_Filler)( X, Y, UV, *pScanline, _pData );
+			Planes	Temp = m_pPlanes[0];
+			m_pPlanes[0] = Back.m_pPlanes[0];
+			Back.m_pPlanes[0] = Temp;
+		}
+		else
+		{
+			Pixel*	pTemp = m_ppBufferGeneric[0];
+			m_ppBufferGeneric[0] = Back.m_ppBufferGeneric[0];
+			Back.m_ppBufferGeneric[0] = pTemp;
 		}
 	}
+
 	m_bMipLevelsBuilt = false;
 }
 
@@ -129,7 +439,21 @@ void	TextureBuilder::Get( int _X, int _Y, int _MipLevel, Pixel& _Color ) const
 	ASSERT( _X >= 0 && _X < W, "X out of range !" );
 	ASSERT( _Y >= 0 && _Y < H, "Y out of range !" );
 
-	_Color = m_ppBufferGeneric[_MipLevel][W*_Y+_X];
+	Pixel	Temp;
+	_Color = Fetch( _MipLevel, W*_Y+_X, Temp );
+}
+
+void	TextureBuilder::Set( int _X, int _Y, const Pixel& _Color )
+{
+	ASSERT( _X >= 0 && _X < m_Width, "X out of range !" );
+	ASSERT( _Y >= 0 && _Y < m_Height, "Y out of range !" );
+
+	if ( m_pPlanes != NULL )
+		StorePixel( m_pPlanes[0], m_Width*_Y+_X, _Color );
+	else
+		m_ppBufferGeneric[0][m_Width*_Y+_X] = _Color;
+
+	m_bMipLevelsBuilt = false;
 }
 
 void	TextureBuilder::SampleWrap( float _X, float _Y, int _MipLevel, Pixel& _Pixel ) const
@@ -141,37 +465,29 @@ void	TextureBuilder::SampleWrap( float _X, float _Y, int _MipLevel, Pixel& _Pixe
 
 	int		X0 = floorf( _X );
 	float	x = _X - X0;
-	float	rx = 1.0f - x;
 	int		X1 = (100*W+X0+1) % W;
 			X0 = (100*W+X0) % W;
 
 	int		Y0 = floorf( _Y );
 	float	y = _Y - Y0;
-	float	ry = 1.0f - y;
 	int		Y1 = (100*H+Y0+1) % H;
 			Y0 = (100*H+Y0) % H;
 
 	ASSERT( X0 >= 0 && X0 < W && X1 >= 0 && X1 < W, "X out of range !" );	// Should never happen
 	ASSERT( Y0 >= 0 && Y0 < H && Y1 >= 0 && Y1 < H, "Y out of range !" );	// Should never happen
-	Pixel&	V00 = m_ppBufferGeneric[_MipLevel][W*Y0+X0];
-	Pixel&	V01 = m_ppBufferGeneric[_MipLevel][W*Y0+X1];
-	Pixel&	V10 = m_ppBufferGeneric[_MipLevel][W*Y1+X0];
-	Pixel&	V11 = m_ppBufferGeneric[_MipLevel][W*Y1+X1];
-
-	float4	V0 = rx * V00.RGBA + x * V01.RGBA;
-	float4	V1 = rx * V10.RGBA + x * V11.RGBA;
-	float		H0 = rx * V00.Height + x * V01.Height;
-	float		H1 = rx * V10.Height + x * V11.Height;
-	float		R0 = rx * V00.Roughness + x * V01.Roughness;
-	float		R1 = rx * V10.Roughness + x * V11.Roughness;
-
-	_Pixel.RGBA.x = ry * V0.x + y * V1.x;
-	_Pixel.RGBA.y = ry * V0.y + y * V1.y;
-	_Pixel.RGBA.z = ry * V0.z + y * V1.z;
-	_Pixel.RGBA.w = ry * V0.w + y * V1.w;
-	_Pixel.Height = ry * H0 + y * H1;
-	_Pixel.Roughness = ry * R0 + y * R1;
-	_Pixel.MatID = V00.MatID;	// Arbitrary!
+	if ( m_pPlanes != NULL )
+	{
+		Pixel	pTemp[4];
+		LoadPixel( m_pPlanes[_MipLevel], W*Y0+X0, pTemp[0] );
+		LoadPixel( m_pPlanes[_MipLevel], W*Y0+X1, pTemp[1] );
+		LoadPixel( m_pPlanes[_MipLevel], W*Y1+X0, pTemp[2] );
+		LoadPixel( m_pPlanes[_MipLevel], W*Y1+X1, pTemp[3] );
+		BilerpPixels( pTemp[0], pTemp[1], pTemp[2], pTemp[3], x, y, _Pixel );
+		return;
+	}
+
+	Pixel*	pPixels = m_ppBufferGeneric[_MipLevel];
+	BilerpPixels( pPixels[W*Y0+X0], pPixels[W*Y0+X1], pPixels[W*Y1+X0], pPixels[W*Y1+X1], x, y, _Pixel );
 }
 
 void	TextureBuilder::SampleClamp( float _X, float _Y, int _MipLevel, Pixel& _Pixel ) const
@@ -183,40 +499,32 @@ void	TextureBuilder::SampleClamp( float _X, float _Y, int _MipLevel, Pixel& _Pix
 
 	int		X0 = floorf( _X );
 	float	x = _X - X0;
-	float	rx = 1.0f - x;
 	int		X1 = CLAMP( (X0+1), 0, W-1 );
 			X0 = CLAMP( X0, 0, W-1 );
 
 	int		Y0 = floorf( _Y );
 	float	y = _Y - Y0;
-	float	ry = 1.0f - y;
 	int		Y1 = CLAMP( (Y0+1), 0, H-1 );
 			Y0 = CLAMP( Y0, 0, H-1 );
 
-	Pixel&	V00 = m_ppBufferGeneric[_MipLevel][W*Y0+X0];
-	Pixel&	V01 = m_ppBufferGeneric[_MipLevel][W*Y0+X1];
-	Pixel&	V10 = m_ppBufferGeneric[_MipLevel][W*Y1+X0];
-	Pixel&	V11 = m_ppBufferGeneric[_MipLevel][W*Y1+X1];
-
-	float4	V0 = rx * V00.RGBA + x * V01.RGBA;
-	float4	V1 = rx * V10.RGBA + x * V11.RGBA;
-	float		H0 = rx * V00.Height + x * V01.Height;
-	float		H1 = rx * V10.Height + x * V11.Height;
-	float		R0 = rx * V00.Roughness + x * V01.Roughness;
-	float		R1 = rx * V10.Roughness + x * V11.Roughness;
+	if ( m_pPlanes != NULL )
+	{
+		Pixel	pTemp[4];
+		LoadPixel( m_pPlanes[_MipLevel], W*Y0+X0, pTemp[0] );
+		LoadPixel( m_pPlanes[_MipLevel], W*Y0+X1, pTemp[1] );
+		LoadPixel( m_pPlanes[_MipLevel], W*Y1+X0, pTemp[2] );
+		LoadPixel( m_pPlanes[_MipLevel], W*Y1+X1, pTemp[3] );
+		BilerpPixels( pTemp[0], pTemp[1], pTemp[2], pTemp[3], x, y, _Pixel );
+		return;
+	}
 
-	_Pixel.RGBA.x = ry * V0.x + y * V1.x;
-	_Pixel.RGBA.y = ry * V0.y + y * V1.y;
-	_Pixel.RGBA.z = ry * V0.z + y * V1.z;
-	_Pixel.RGBA.w = ry * V0.w + y * V1.w;
-	_Pixel.Height = ry * H0 + y * H1;
-	_Pixel.Roughness = ry * R0 + y * R1;
-	_Pixel.MatID = V00.MatID;	// Arbitrary!
+	Pixel*	pPixels = m_ppBufferGeneric[_MipLevel];
+	BilerpPixels( pPixels[W*Y0+X0], pPixels[W*Y0+X1], pPixels[W*Y1+X0], pPixels[W*Y1+X1], x, y, _Pixel );
 }
 
 void	TextureBuilder::GenerateMips( bool _bTreatRGBAsNormal, bool _bNormalizeNormals ) const
 {
-	// Build remaining mip levels
+	// Build remaining mip levels, each level being reduced in parallel from the previous one
 	int	Width = m_Width;
 	int	Height = m_Height;
 	for ( int MipLevelIndex=1; MipLevelIndex < m_MipLevelsCount; MipLevelIndex++ )
@@ -225,11 +533,25 @@ void	TextureBuilder::GenerateMips( bool _bTreatRGBAsNormal, bool _bNormalizeNorm
 		int		SourceHeight = Height;
 		Texture2D::NextMipSize( Width, Height );
 
-		Pixel*	pSource = m_ppBufferGeneric[MipLevelIndex-1];
-		Pixel*	pTarget = m_ppBufferGeneric[MipLevelIndex];
-		for ( int Y=0; Y < Height; Y++ )
+		if ( m_pPlanes != NULL )
 		{
-			int	Y0 = (Y << 1) + 0;
+			PlanarMipTask	Task( m_pPlanes[MipLevelIndex-1], SourceWidth, SourceHeight, m_pPlanes[MipLevelIndex], Width, _bTreatRGBAsNormal, _bNormalizeNormals );
+			Task.Execute( Width, Height, true );
+			continue;
+		}
+
+		MipTask	Task( m_ppBufferGeneric[MipLevelIndex-1], SourceWidth, SourceHeight, m_ppBufferGeneric[MipLevelIndex], Width, _bTreatRGBAsNormal, _bNormalizeNormals );
+		Task.Execute( Width, Height, true );
+	}
+
+	m_bMipLevelsBuilt = true;
+}
+
+void	MipTask::ProcessTile( int _X0, int _Y0, int _X1, int _Y1 )
+{
+	for ( int Y=_Y0; Y < _Y1; Y++ )
+	{
+		int	Y0 = (Y << 1) + 0;
 
 // Phnomne curieux:
 // Dans mon programme de test avec le LOD de texture de noise, j'avais un bug o la texture rebouclait bizarrement dans les niveaux de mips suprieurs.
@@ -241,51 +563,112 @@ void	TextureBuilder::GenerateMips( bool _bTreatRGBAsNormal, bool _bNormalizeNorm
 // On parle ici de framerate qui change  cause du CONTENU d'une texture quand mme ! C'est pas rien ! Depuis quand les cartes sont dpendantes du contenu des textures ???
 //
 #if 0
-			int	Y1 = (Y0+1) % Height;	// TODO: Handle WRAP/CLAMP
+		int	Y1 = (Y0+1) % Height;	// TODO: Handle WRAP/CLAMP
 #else
-			int	Y1 = (Y0+1) % SourceHeight;	// TODO: Handle WRAP/CLAMP
+		int	Y1 = (Y0+1) % m_SourceHeight;	// TODO: Handle WRAP/CLAMP
 #endif
 
-			Pixel*	pScanline = pTarget + Width * Y;
-			for ( int X=0; X < Width; X++, pScanline++ )
-			{
-				int	X0 = (X << 1) + 0;
+		Pixel*	pScanline = m_pTarget + m_Width * Y + _X0;
+		for ( int X=_X0; X < _X1; X++, pScanline++ )
+		{
+			int	X0 = (X << 1) + 0;
 #if 0
-				int	X1 = (X0+1) % Width;	// TODO: Handle WRAP/CLAMP
+			int	X1 = (X0+1) % Width;	// TODO: Handle WRAP/CLAMP
 #else
-				int	X1 = (X0+1) % SourceWidth;	// TODO: Handle WRAP/CLAMP
+			int	X1 = (X0+1) % m_SourceWidth;	// TODO: Handle WRAP/CLAMP
 #endif
 
-				Pixel&	V00 = pSource[SourceWidth*Y0+X0];
-				Pixel&	V01 = pSource[SourceWidth*Y0+X1];
-				Pixel&	V10 = pSource[SourceWidth*Y1+X0];
-				Pixel&	V11 = pSource[SourceWidth*Y1+X1];
+			Pixel&	V00 = m_pSource[m_SourceWidth*Y0+X0];
+			Pixel&	V01 = m_pSource[m_SourceWidth*Y0+X1];
+			Pixel&	V10 = m_pSource[m_SourceWidth*Y1+X0];
+			Pixel&	V11 = m_pSource[m_SourceWidth*Y1+X1];
 
-				if ( _bTreatRGBAsNormal )
-				{
-					float3	N00 = float3(V00.RGBA);
-					float3	N01 = float3(V01.RGBA);
-					float3	N10 = float3(V10.RGBA);
-					float3	N11 = float3(V11.RGBA);
+			if ( m_bTreatRGBAsNormal )
+			{
+				float3	N00 = float3(V00.RGBA);
+				float3	N01 = float3(V01.RGBA);
+				float3	N10 = float3(V10.RGBA);
+				float3	N11 = float3(V11.RGBA);
+
+				float3	N = 0.25f * (N00 + N01 + N10 + N11);
+				if ( m_bNormalizeNormals )
+					N.Normalize();
+				pScanline->RGBA.x = N.x;
+				pScanline->RGBA.y = N.y;
+				pScanline->RGBA.z = N.z;
+				pScanline->RGBA.w = 0.25f * (V00.RGBA.w + V01.RGBA.w + V10.RGBA.w + V11.RGBA.w);
+			}
+			else
+				pScanline->RGBA = 0.25f * (V00.RGBA + V01.RGBA + V10.RGBA + V11.RGBA);
+			pScanline->Height = 0.25f * (V00.Height + V01.Height + V10.Height + V11.Height);
+			pScanline->Roughness = 0.25f * (V00.Roughness + V01.Roughness + V10.Roughness + V11.Roughness);
+			pScanline->MatID = V00.MatID;	// Arbitrary! We really should choose the material shared by most of the pixels... Need to create a mini hashtable... Pain... See later...
+		}
+	}
+}
+
+void	PlanarMipTask::ReduceScanline( const float* _pSource, float* _pTarget, int _Y, int _X0, int _X1 ) const
+{
+	if ( _pTarget == NULL )
+		return;	// Channel is not stored
+
+	const float*	pSource0 = _pSource + m_SourceWidth * ((_Y << 1) + 0);
+	const float*	pSource1 = _pSource + m_SourceWidth * (((_Y << 1) + 1) % m_SourceHeight);
+	float*			pScanline = _pTarget + m_Width * _Y;
+	for ( int X=_X0; X < _X1; X++ )
+	{
+		int	X0 = (X << 1) + 0;
+		int	X1 = (X0+1) % m_SourceWidth;
+		pScanline[X] = 0.25f * (pSource0[X0] + pSource0[X1] + pSource1[X0] + pSource1[X1]);
+	}
+}
+
+void	PlanarMipTask::ProcessTile( int _X0, int _Y0, int _X1, int _Y1 )
+{
+	for ( int Y=_Y0; Y < _Y1; Y++ )
+	{
+		int	Y0 = (Y << 1) + 0;
+		int	Y1 = (Y0+1) % m_SourceHeight;
+
+		if ( m_Target.pRGBA != NULL )
+		{
+			float4*	pSource0 = m_Source.pRGBA + m_SourceWidth * Y0;
+			float4*	pSource1 = m_Source.pRGBA + m_SourceWidth * Y1;
+			float4*	pScanline = m_Target.pRGBA + m_Width * Y;
+			for ( int X=_X0; X < _X1; X++ )
+			{
+				int	X0 = (X << 1) + 0;
+				int	X1 = (X0+1) % m_SourceWidth;
 
-					float3	N = 0.25f * (N00 + N01 + N10 + N11);
-					if ( _bNormalizeNormals )
+				float4&	V00 = pSource0[X0];
+				float4&	V01 = pSource0[X1];
+				float4&	V10 = pSource1[X0];
+				float4&	V11 = pSource1[X1];
+
+				if ( m_bTreatRGBAsNormal )
+				{
+					float3	N = 0.25f * (float3(V00) + float3(V01) + float3(V10) + float3(V11));
+					if ( m_bNormalizeNormals )
 						N.Normalize();
-					pScanline->RGBA.x = N.x;
-					pScanline->RGBA.y = N.y;
-					pScanline->RGBA.z = N.z;
-					pScanline->RGBA.w = 0.25f * (V00.RGBA.w + V01.RGBA.w + V10.RGBA.w + V11.RGBA.w);
+					pScanline[X].Set( N.x, N.y, N.z, 0.25f * (V00.w + V01.w + V10.w + V11.w) );
 				}
 				else
-					pScanline->RGBA = 0.25f * (V00.RGBA + V01.RGBA + V10.RGBA + V11.RGBA);
-				pScanline->Height = 0.25f * (V00.Height + V01.Height + V10.Height + V11.Height);
-				pScanline->Roughness = 0.25f * (V00.Roughness + V01.Roughness + V10.Roughness + V11.Roughness);
-				pScanline->MatID = V00.MatID;	// Arbitrary! We really should choose the material shared by most of the pixels... Need to create a mini hashtable... Pain... See later...
+					pScanline[X] = 0.25f * (V00 + V01 + V10 + V11);
 			}
 		}
-	}
 
-	m_bMipLevelsBuilt = true;
+		ReduceScanline( m_Source.pHeight, m_Target.pHeight, Y, _X0, _X1 );
+		ReduceScanline( m_Source.pRoughness, m_Target.pRoughness, Y, _X0, _X1 );
+		ReduceScanline( m_Source.pMetallic, m_Target.pMetallic, Y, _X0, _X1 );
+
+		if ( m_Target.pMatID != NULL )
+		{
+			const int*	pSource0 = m_Source.pMatID + m_SourceWidth * Y0;
+			int*		pScanline = m_Target.pMatID + m_Width * Y;
+			for ( int X=_X0; X < _X1; X++ )
+				pScanline[X] = pSource0[X << 1];	// Arbitrary! (cf. MipTask)
+		}
+	}
 }
 
 TextureBuilder::ConversionParams	TextureBuilder::CONV_RGBA =
@@ -372,6 +755,119 @@ TextureBuilder::ConversionParams	TextureBuilder::CONV_NxNyNzH =
 	-1,		// int		PosAO;
 };
 
+//////////////////////////////////////////////////////////////////////////
+// Block compression
+// Each converted mip of each array slice is split into bands of block rows that the worker threads compress concurrently
+namespace
+{
+	static const int	BAND_BLOCK_ROWS = 16;	// Rows of 4x4 blocks compressed by a job at once
+
+	class	CompressTask : public IJob
+	{
+		const IPixelFormatDescriptor&	m_Format;
+		void**			m_ppBuffers;			// The RGBA32F sub-resources, replaced by the compressed ones in the end
+		int				m_SubResourcesCount;
+		int				m_MipLevelsCount;
+		const int*		m_pMipSizes;
+		U8**			m_ppCompressed;
+		int*			m_pFirstBands;			// Index of the first band of each sub-resource (+ the total amount of bands)
+		volatile LONG	m_NextBandIndex;
+
+	public:
+
+		CompressTask( const IPixelFormatDescriptor& _Format, void** _ppBuffers, int _MipLevelsCount, int _ArraySize, const int* _pMipSizes )
+			: m_Format( _Format ), m_ppBuffers( _ppBuffers ), m_SubResourcesCount( _MipLevelsCount*_ArraySize ), m_MipLevelsCount( _MipLevelsCount ), m_pMipSizes( _pMipSizes ), m_NextBandIndex( 0 )
+		{
+			m_ppCompressed = new U8*[m_SubResourcesCount];
+			m_pFirstBands = new int[m_SubResourcesCount+1];
+			m_pFirstBands[0] = 0;
+			for ( int SubResourceIndex=0; SubResourceIndex < m_SubResourcesCount; SubResourceIndex++ )
+			{
+				int	MipLevelIndex = SubResourceIndex % m_MipLevelsCount;
+				int	Width = m_pMipSizes[2*MipLevelIndex+0];
+				int	Height = m_pMipSizes[2*MipLevelIndex+1];
+				m_ppCompressed[SubResourceIndex] = new U8[BlockCompressor::GetCompressedSize( m_Format, Width, Height )];
+
+				int	BlockRowsCount = (Height+3) >> 2;
+				m_pFirstBands[SubResourceIndex+1] = m_pFirstBands[SubResourceIndex] + (BlockRowsCount + BAND_BLOCK_ROWS-1) / BAND_BLOCK_ROWS;
+			}
+		}
+		~CompressTask()
+		{
+			delete[] m_pFirstBands;
+			delete[] m_ppCompressed;
+		}
+
+		void			Execute()
+		{
+			JobQueue&	Jobs = gs_Device.Jobs();
+			int			HelpersCount = MIN( Jobs.GetHelpersCount(), m_pFirstBands[m_SubResourcesCount]-1 );
+			for ( int HelperIndex=0; HelperIndex < HelpersCount; HelperIndex++ )
+				Jobs.Push( *this );
+			Run();
+			if ( HelpersCount > 0 )
+				Jobs.Wait();
+
+			// Replace the uncompressed sub-resources
+			for ( int SubResourceIndex=0; SubResourceIndex < m_SubResourcesCount; SubResourceIndex++ )
+			{
+				delete[] (U8*) m_ppBuffers[SubResourceIndex];
+				m_ppBuffers[SubResourceIndex] = m_ppCompressed[SubResourceIndex];
+			}
+		}
+
+		virtual void	Run()
+		{
+			int	SubResourceIndex = 0;
+			for ( ;; )
+			{
+				int	BandIndex = InterlockedIncrement( &m_NextBandIndex ) - 1;
+				if ( BandIndex >= m_pFirstBands[m_SubResourcesCount] )
+					return;
+
+				while ( BandIndex >= m_pFirstBands[SubResourceIndex+1] )
+					SubResourceIndex++;	// Bands are handed out in order so we never need to look back
+
+				int	MipLevelIndex = SubResourceIndex % m_MipLevelsCount;
+				int	BlockY0 = BAND_BLOCK_ROWS * (BandIndex - m_pFirstBands[SubResourceIndex]);
+				int	BlockY1 = MIN( BlockY0 + BAND_BLOCK_ROWS, (m_pMipSizes[2*MipLevelIndex+1]+3) >> 2 );
+				BlockCompressor::Compress( m_Format, (const float4*) m_ppBuffers[SubResourceIndex], m_pMipSizes[2*MipLevelIndex+0], m_pMipSizes[2*MipLevelIndex+1], m_ppCompressed[SubResourceIndex], BlockY0, BlockY1 );
+			}
+		}
+	};
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Conversion
+namespace
+{
+	// Linearly interpolated sRGB => Linear table used by Convert() instead of a powf() per component
+	// The error is below 1e-6, way under what any of our formats can store
+	static const int	SRGB_TABLE_SIZE = 1024;
+	static float		gs_psRGB2Linear[SRGB_TABLE_SIZE+1];
+	static volatile bool	gs_bsRGBTableBuilt = false;
+
+	void	BuildsRGBTable()
+	{
+		if ( gs_bsRGBTableBuilt )
+			return;
+		for ( int Index=0; Index <= SRGB_TABLE_SIZE; Index++ )
+			gs_psRGB2Linear[Index] = TextureBuilder::sRGB2Linear( float(Index) / SRGB_TABLE_SIZE );
+		gs_bsRGBTableBuilt = true;	// Concurrent builds write the same values so we don't care
+	}
+
+	float	sRGB2LinearFast( float _sRGB )
+	{
+		if ( _sRGB <= 0.0f || _sRGB >= 1.0f )
+			return TextureBuilder::sRGB2Linear( _sRGB );	// Out of the table (HDR colors)
+
+		float	x = _sRGB * SRGB_TABLE_SIZE;
+		int		Index = int( x );
+		float	t = x - Index;
+		return gs_psRGB2Linear[Index] + t * (gs_psRGB2Linear[Index+1] - gs_psRGB2Linear[Index]);
+	}
+}
+
 void**	TextureBuilder::Convert( const IPixelFormatDescriptor& _Format, const ConversionParams& _Params, int& _ArraySize, float _NormalFactor, bool _bNormalizeNormals, float _AOFactor ) const
 {
 	if ( !m_bMipLevelsBuilt )
@@ -380,23 +876,25 @@ void**	TextureBuilder::Convert( const IPixelFormatDescriptor& _Format, const Con
 	ReleaseSpecificBuffer();
 
 	//////////////////////////////////////////////////////////////////////////
-	// Generate normal
-	TextureBuilder	TBNormal( m_Width, m_Height );
+	// Generate normal (only the RGBA channel is needed)
+	TextureBuilder*	pTBNormal = NULL;
 	if ( _Params.PosNormalX != -1 )
 	{
 		ASSERT( _Params.PosNormalY != -1, "You must specify a position for the Y component of the normal if PosNormalX is not -1!" );
 		bool	bNormalize = _bNormalizeNormals || _Params.PosNormalZ == -1;
-		Generators::ComputeNormal( *this, TBNormal, _NormalFactor, bNormalize );
-		TBNormal.GenerateMips( true, true );
+		pTBNormal = new TextureBuilder( m_Width, m_Height, CHANNEL_RGBA );
+		Generators::ComputeNormal( *this, *pTBNormal, _NormalFactor, bNormalize );
+		pTBNormal->GenerateMips( true, true );
 	}
 
 	//////////////////////////////////////////////////////////////////////////
 	// Generate AO
-	TextureBuilder	TBAO( m_Width, m_Height );
+	TextureBuilder*	pTBAO = NULL;
 	if ( _Params.PosAO != -1 )
 	{
-		Generators::ComputeAO( *this, TBNormal, _AOFactor );
-		TBAO.GenerateMips();
+		pTBAO = new TextureBuilder( m_Width, m_Height, CHANNEL_RGBA );
+		Generators::ComputeAO( *this, *pTBAO, _AOFactor );
+		pTBAO->GenerateMips();
 	}
 
 	//////////////////////////////////////////////////////////////////////////
@@ -419,8 +917,19 @@ void**	TextureBuilder::Convert( const IPixelFormatDescriptor& _Format, const Con
 	//////////////////////////////////////////////////////////////////////////
 	// Allocate buffers
 	m_ppBufferSpecific = new void*[m_MipLevelsCount*_ArraySize];
+	m_SpecificArraySize = _ArraySize;
+
+	// Block-compressed formats are first converted to floats then compressed
+	bool							bCompressed = _Format.BlockSize() > 1;
+	const IPixelFormatDescriptor&	WriteFormat = bCompressed ? (const IPixelFormatDescriptor&) PixelFormatRGBA32F::DESCRIPTOR : _Format;
+	ASSERT( !bCompressed || BlockCompressor::IsSupported( _Format ), "Unsupported block-compressed format!" );
 
-	int	PixelSize = _Format.Size();
+	// Scanlines are assembled as floats then written all at once by the format, directly into the buffer for RGBA32F
+	bool	bDirectWrite = &WriteFormat == &PixelFormatRGBA32F::DESCRIPTOR;
+	float4*	pScanlineBuffer = bDirectWrite ? NULL : new float4[m_Width];
+	BuildsRGBTable();
+
+	int	PixelSize = WriteFormat.Size();
 	for ( int ArrayIndex=0; ArrayIndex < _ArraySize; ArrayIndex++ )
 	{
 		int	Width = m_Width;
@@ -429,30 +938,55 @@ void**	TextureBuilder::Convert( const IPixelFormatDescriptor& _Format, const Con
 
 		for ( int MipLevelIndex=0; MipLevelIndex < m_MipLevelsCount; MipLevelIndex++ )
 		{
-			Pixel*	pSource0 = m_ppBufferGeneric[MipLevelIndex];
-			Pixel*	pSource1 = TBNormal.GetMips()[MipLevelIndex];
-			Pixel*	pSource2 = TBAO.GetMips()[MipLevelIndex];
+			// Find where each component comes from once and for all
+			ComponentSource	pSources[4];
+			for ( int ComponentIndex=0; ComponentIndex < 4; ComponentIndex++ )
+				ResolveComponent( ComponentsOffset+ComponentIndex, _Params, MipLevelIndex, pTBNormal, pTBAO, pSources[ComponentIndex] );
 
 			U8*		pDest = new U8[Width*Height*PixelSize];
 			m_ppBufferSpecific[m_MipLevelsCount*ArrayIndex+MipLevelIndex] = (void*) pDest;
 
-			// Copy
+			// Copy, one component of a whole scanline at a time so the transform is only switched once per scanline
 			for ( int Y=0; Y < Height; Y++ )
 			{
-				float4	Temp;
-				Pixel*		pScanlineSource0 = &pSource0[Width*Y];
-				Pixel*		pScanlineSource1 = &pSource1[Width*Y];
-				Pixel*		pScanlineSource2 = &pSource2[Width*Y];
-				U8*			pScanlineDest = &pDest[PixelSize*Width*Y];
-				for ( int X=0; X < Width; X++, pScanlineDest+=PixelSize, pScanlineSource0++, pScanlineSource1++, pScanlineSource2++ )
+				U8*		pScanlineDest = &pDest[PixelSize*Width*Y];
+				float4*	pScanline = bDirectWrite ? (float4*) pScanlineDest : pScanlineBuffer;
+				for ( int ComponentIndex=0; ComponentIndex < 4; ComponentIndex++ )
 				{
-					Temp.x = BuildComponent( ComponentsOffset+0, _Params, *pScanlineSource0, *pScanlineSource1, *pScanlineSource2 );
-					Temp.y = BuildComponent( ComponentsOffset+1, _Params, *pScanlineSource0, *pScanlineSource1, *pScanlineSource2 );
-					Temp.z = BuildComponent( ComponentsOffset+2, _Params, *pScanlineSource0, *pScanlineSource1, *pScanlineSource2 );
-					Temp.w = BuildComponent( ComponentsOffset+3, _Params, *pScanlineSource0, *pScanlineSource1, *pScanlineSource2 );
-
-					_Format.Write( pScanlineDest, Temp );
+					const ComponentSource&	Source = pSources[ComponentIndex];
+					float*					pTarget = &pScanline->x + ComponentIndex;
+					if ( Source.pSource == NULL )
+					{	// Empty component => WASTE !!!!
+						for ( int X=0; X < Width; X++, pTarget+=4 )
+							*pTarget = 0.0f;
+						continue;
+					}
+
+					int				Stride = Source.Stride;
+					const float*	pValue = Source.pSource + Stride * Width * Y;
+					switch ( Source.Transform )
+					{
+					case ComponentSource::NONE:
+						for ( int X=0; X < Width; X++, pTarget+=4, pValue+=Stride )
+							*pTarget = *pValue;
+						break;
+					case ComponentSource::LINEARIZE:
+						for ( int X=0; X < Width; X++, pTarget+=4, pValue+=Stride )
+							*pTarget = sRGB2LinearFast( *pValue );
+						break;
+					case ComponentSource::PACK_NORMAL:
+						for ( int X=0; X < Width; X++, pTarget+=4, pValue+=Stride )
+							*pTarget = 0.5f + 0.5f * *pValue;
+						break;
+					case ComponentSource::FROM_INT:
+						for ( int X=0; X < Width; X++, pTarget+=4, pValue+=Stride )
+							*pTarget = float( *((const int*) pValue) );
+						break;
+					}
 				}
+
+				if ( !bDirectWrite )
+					WriteFormat.WriteScanline( pScanlineDest, pScanline, Width );
 			}
 
 			// Downsample
@@ -460,6 +994,16 @@ void**	TextureBuilder::Convert( const IPixelFormatDescriptor& _Format, const Con
 		}
 	}
 
+	delete[] pScanlineBuffer;
+	delete pTBAO;
+	delete pTBNormal;
+
+	if ( bCompressed )
+	{
+		CompressTask	Task( _Format, m_ppBufferSpecific, m_MipLevelsCount, _ArraySize, m_pMipSizes );
+		Task.Execute();
+	}
+
 	return m_ppBufferSpecific;
 }
 
@@ -478,7 +1022,8 @@ Texture2D*	TextureBuilder::Concat( int _SourcesCount, void** _pppArrays[], int _
 		TotalArraySize += _ArraySizes[SourceIndex];
 
 	// Concatenate all arrays into one giant array
-	void**	ppFinalArray = new void*[m_MipLevelsCount*TotalArraySize];
+	ScopedMemoryMarker	Marker( gs_MemoryArena );
+	void**	ppFinalArray = (void**) Alloc( m_MipLevelsCount*TotalArraySize*sizeof(void*) );
 	TotalArraySize = 0;
 	for ( int SourceIndex=0; SourceIndex < _SourcesCount; SourceIndex++ )
 		for ( int ArrayIndex=0; ArrayIndex < _ArraySizes[SourceIndex]; ArrayIndex++ )
@@ -491,59 +1036,65 @@ Texture2D*	TextureBuilder::Concat( int _SourcesCount, void** _pppArrays[], int _
 
 	Texture2D*	pResult = new Texture2D( gs_Device, m_Width, m_Height, TotalArraySize, _Format, m_MipLevelsCount, ppFinalArray, _bStaging, _bWriteable );
 
-	delete[] ppFinalArray;
-
 	return pResult;
 }
 
-float	TextureBuilder::BuildComponent( int _ComponentIndex, const ConversionParams& _Params, Pixel& _Pixel0, Pixel& _Pixel1, Pixel& _Pixel2 ) const
+void	TextureBuilder::ResolveComponent( int _ComponentIndex, const ConversionParams& _Params, int _MipLevel, const TextureBuilder* _pNormal, const TextureBuilder* _pAO, ComponentSource& _Source ) const
 {
+	const TextureBuilder*	pBuilder = this;
+	CHANNEL					Channel = CHANNEL_RGBA;
+	int						Offset = 0;
+	_Source.Transform = ComponentSource::NONE;
+
 	// Check if it's the color
-	if ( _Params.bLinearizeColors )
-	{
-		if ( _ComponentIndex == _Params.PosR )
-			return sRGB2Linear( _Pixel0.RGBA.x );
-		if ( _ComponentIndex == _Params.PosG )
-			return sRGB2Linear( _Pixel0.RGBA.y );
-		if ( _ComponentIndex == _Params.PosB )
-			return sRGB2Linear( _Pixel0.RGBA.z );
-	}
-	else
-	{
-		if ( _ComponentIndex == _Params.PosR )
-			return _Pixel0.RGBA.x;
-		if ( _ComponentIndex == _Params.PosG )
-			return _Pixel0.RGBA.y;
-		if ( _ComponentIndex == _Params.PosB )
-			return _Pixel0.RGBA.z;
-	}
-	if ( _ComponentIndex == _Params.PosA )
-		return _Pixel0.RGBA.w;
+	if ( _ComponentIndex == _Params.PosR )
+		Offset = 0;
+	else if ( _ComponentIndex == _Params.PosG )
+		Offset = 1;
+	else if ( _ComponentIndex == _Params.PosB )
+		Offset = 2;
+	else if ( _ComponentIndex == _Params.PosA )
+		Offset = 3;
 
 	// Check if it's the height or roughness
-	if ( _ComponentIndex == _Params.PosHeight )
-		return _Pixel0.Height;
-	if ( _ComponentIndex == _Params.PosRoughness )
-		return _Pixel0.Roughness;
+	else if ( _ComponentIndex == _Params.PosHeight )
+		Channel = CHANNEL_HEIGHT;
+	else if ( _ComponentIndex == _Params.PosRoughness )
+		Channel = CHANNEL_ROUGHNESS;
 
 	// Check if it's the material ID
-	if ( _ComponentIndex == _Params.PosMatID )
-		return float(_Pixel0.MatID);
+	else if ( _ComponentIndex == _Params.PosMatID )
+	{
+		Channel = CHANNEL_MATID;
+		_Source.Transform = ComponentSource::FROM_INT;
+	}
 
 	// Check if it's the normal
-	if ( _ComponentIndex == _Params.PosNormalX )
-		return _Params.bPackNormal ? 0.5f * (1.0f + _Pixel1.RGBA.x) : _Pixel1.RGBA.x;
-	if ( _ComponentIndex == _Params.PosNormalY )
-		return _Params.bPackNormal ? 0.5f * (1.0f + _Pixel1.RGBA.y) : _Pixel1.RGBA.y;
-	if ( _ComponentIndex == _Params.PosNormalZ )
-		return _Params.bPackNormal ? 0.5f * (1.0f + _Pixel1.RGBA.z) : _Pixel1.RGBA.z;
+	else if ( _ComponentIndex == _Params.PosNormalX || _ComponentIndex == _Params.PosNormalY || _ComponentIndex == _Params.PosNormalZ )
+	{
+		pBuilder = _pNormal;
+		Offset = _ComponentIndex == _Params.PosNormalX ? 0 : (_ComponentIndex == _Params.PosNormalY ? 1 : 2);
+		if ( _Params.bPackNormal )
+			_Source.Transform = ComponentSource::PACK_NORMAL;
+	}
 
 	// Check if it's the ambient occlusion
-	if ( _ComponentIndex == _Params.PosAO )
-		return _Pixel2.RGBA.x;
+	else if ( _ComponentIndex == _Params.PosAO )
+		pBuilder = _pAO;
 
-	// Empty component => WASTE !!!!
-	return 0.0f;
+	// Empty component
+	else
+	{
+		_Source.pSource = NULL;
+		_Source.Stride = 0;
+		return;
+	}
+
+	if ( _Params.bLinearizeColors && pBuilder == this && Channel == CHANNEL_RGBA && Offset < 3 )
+		_Source.Transform = ComponentSource::LINEARIZE;
+
+	float*	pChannel = pBuilder->GetChannel( _MipLevel, Channel, _Source.Stride );
+	_Source.pSource = pChannel != NULL ? pChannel + Offset : NULL;
 }
 
 float	TextureBuilder::sRGB2Linear( float _sRGB )
@@ -561,9 +1112,11 @@ void	TextureBuilder::ReleaseSpecificBuffer() const
 	if ( m_ppBufferSpecific == NULL )
 		return;
 
-	for ( int MipLevelIndex=0; MipLevelIndex < m_MipLevelsCount; MipLevelIndex++ )
-		delete[] m_ppBufferSpecific[MipLevelIndex];
+	for ( int SubResourceIndex=0; SubResourceIndex < m_MipLevelsCount*m_SpecificArraySize; SubResourceIndex++ )
+		delete[] (U8*) m_ppBufferSpecific[SubResourceIndex];
 	delete[] m_ppBufferSpecific;
+	m_ppBufferSpecific = NULL;
+	m_SpecificArraySize = 0;
 }
 
 
@@ -576,18 +1129,21 @@ void	TextureBuilder::LoadFromRAWFile( const char* _pPath, bool _bAsHeight )
 {
 	int		Size = 4*m_Width*m_Height;
 
-	U8*		pRAW = new U8[Size];
+	ScopedMemoryMarker	Marker( gs_MemoryArena );
+	U8*		pRAW = (U8*) Alloc( Size );
 	FILE*	pFile = fopen( _pPath, "rb" );
 	ASSERT( pFile != NULL, "Invalid file!" );
 	fread_s( pRAW, Size, 1, Size, pFile );
 	fclose( pFile );
 
+	Pixel	Temp;
 	for ( int Y=0; Y < m_Height; Y++ )
 	{
 		U8*		pScanlineSource = &pRAW[4*m_Width*Y];
-		Pixel*	pScanlineTarget = &m_ppBufferGeneric[0][m_Width*Y];
-		for ( int X=0; X < m_Width; X++, pScanlineTarget++ )
+		for ( int X=0; X < m_Width; X++ )
 		{
+			Pixel*	pScanlineTarget = m_pPlanes != NULL ? &Temp : &m_ppBufferGeneric[0][m_Width*Y+X];
+
 			float	R = *pScanlineSource++ / 255.0f;
 			float	G = *pScanlineSource++ / 255.0f;
 			float	B = *pScanlineSource++ / 255.0f;
@@ -603,11 +1159,12 @@ void	TextureBuilder::LoadFromRAWFile( const char* _pPath, bool _bAsHeight )
 				pScanlineTarget->Height = 0.0f;
 			}
 			pScanlineTarget->Roughness = 0.0f;
+
+			if ( m_pPlanes != NULL )
+				StorePixel( m_pPlanes[0], m_Width*Y+X, Temp );
 		}
 	}
 
-	delete[] pRAW;
-
 	m_bMipLevelsBuilt = false;
 }
 
@@ -617,18 +1174,21 @@ void	TextureBuilder::LoadFromFloatFile( const char* _pPath )
 {
 	int		Size = 3*m_Width*m_Height;
 
-	float*	pRAW = new float[Size];
+	ScopedMemoryMarker	Marker( gs_MemoryArena );
+	float*	pRAW = (float*) Alloc( Size*sizeof(float) );
 	FILE*	pFile = fopen( _pPath, "rb" );
 	ASSERT( pFile != NULL, "Invalid file!" );
 	fread_s( pRAW, Size*sizeof(float), sizeof(float), Size, pFile );
 	fclose( pFile );
 
+	Pixel	Temp;
 	for ( int Y=0; Y < m_Height; Y++ )
 	{
 		float*	pScanlineSource = &pRAW[3*m_Width*Y];
-		Pixel*	pScanlineTarget = &m_ppBufferGeneric[0][m_Width*Y];
-		for ( int X=0; X < m_Width; X++, pScanlineTarget++ )
+		for ( int X=0; X < m_Width; X++ )
 		{
+			Pixel*	pScanlineTarget = m_pPlanes != NULL ? &Temp : &m_ppBufferGeneric[0][m_Width*Y+X];
+
 			float	R = *pScanlineSource++;
 			float	G = *pScanlineSource++;
 			float	B = *pScanlineSource++;
@@ -637,11 +1197,12 @@ void	TextureBuilder::LoadFromFloatFile( const char* _pPath )
 			pScanlineTarget->RGBA.Set( R, G, B, A );
 			pScanlineTarget->Height = 0.0f;
 			pScanlineTarget->Roughness = 0.0f;
+
+			if ( m_pPlanes != NULL )
+				StorePixel( m_pPlanes[0], m_Width*Y+X, Temp );
 		}
 	}
 
-	delete[] pRAW;
-
 	m_bMipLevelsBuilt = false;
 }
 
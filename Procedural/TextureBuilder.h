@@ -2,6 +2,11 @@
 // Helps to build a texture and its mip levels to provide a valid buffer when constructing a Texture2D
 // Note that the resulting texture is always a Texture2DArray where the various fields are populated as dictated by the ConversionParams structure
 //
+// By default, each mip level is stored as an array of fat pixels (cf. FatPixel.h).
+// If you only need a few channels (e.g. a height field or a simple color), you can tell the constructor to use a planar
+//	storage where each channel is stored in its own plane and only the requested channels are allocated. Writing a channel
+//	that is not stored has no effect and reading it always returns 0.
+//
 #pragma once
 
 #include "FatPixel.h"
@@ -12,8 +17,40 @@ protected:	// CONSTANTS
 
 public:		// NESTED TYPES
 
+	// Called by Fill() for each pixel of the mip level 0
+	// THREAD SAFETY: If Fill() is told the delegate is thread-safe, the texture is split into tiles processed concurrently by
+	//	several threads in no particular order. The delegate must then only write _Pixel and only read data that doesn't change
+	//	during the fill: no other pixel of the builder being filled, no accumulation into _pData, no global random generator...
 	typedef void	(*FillDelegate)( int _X, int _Y, const float2& _UV, Pixel& _Pixel, void* _pData );
 
+	// Called by Iterate() for each pixel of the mip level 0 at each iteration
+	// _Front holds the result of the previous iteration (the builder's content for the first one) and _Pixel initially is the
+	//	same pixel of _Front. The builder is never read while being written so iterations are always processed in parallel and
+	//	the result doesn't depend on the processing order. The delegate must only read _Front and constant data from _pData.
+	typedef void	(*IterateDelegate)( int _X, int _Y, const float2& _UV, const TextureBuilder& _Front, Pixel& _Pixel, void* _pData );
+
+	// The channels of a pixel that can be stored in planar storage
+	enum CHANNEL
+	{
+		CHANNEL_RGBA = 1,
+		CHANNEL_HEIGHT = 2,
+		CHANNEL_ROUGHNESS = 4,
+		CHANNEL_METALLIC = 8,
+		CHANNEL_MATID = 16,
+
+		CHANNELS_ALL = 31
+	};
+
+	// The planes of a mip level in planar storage (NULL for channels that are not stored)
+	struct	Planes
+	{
+		float4*	pRGBA;
+		float*	pHeight;
+		float*	pRoughness;
+		float*	pMetallic;
+		int*	pMatID;
+	};
+
 	// The complex structure that is guiding the texture conversion
 	// Use -1 in field positions to avoid storing the field
 	// * If you use only [1,4] fields, a single texture will be generated
@@ -65,9 +102,12 @@ protected:	// FIELDS
 	int				m_MipLevelsCount;
 	mutable bool	m_bMipLevelsBuilt;
 
-	Pixel**			m_ppBufferGeneric;		// Generic buffer consisting of meta-pixels
+	Pixel**			m_ppBufferGeneric;		// Generic buffer consisting of meta-pixels (NULL in planar storage)
+	U32				m_PlanarChannels;		// The channels stored in planar storage (0 when using fat pixels)
+	Planes*			m_pPlanes;				// One set of planes per mip level (NULL when using fat pixels)
 	int*			m_pMipSizes;
 	mutable void**	m_ppBufferSpecific;		// Specific buffer of given pixel format
+	mutable int		m_SpecificArraySize;	// Array size of the specific buffer
 
 
 public:		// PROPERTIES
@@ -77,25 +117,36 @@ public:		// PROPERTIES
 	int				GetWidth( int _MipLevel ) const		{ return m_pMipSizes[(_MipLevel<<1)+0]; }
 	int				GetHeight( int _MipLevel ) const	{ return m_pMipSizes[(_MipLevel<<1)+1]; }
 
-	Pixel**			GetMips()							{ return m_ppBufferGeneric; }
+	bool			IsPlanar() const					{ return m_pPlanes != NULL; }
+	U32				GetPlanarChannels() const			{ return m_PlanarChannels; }
+	Pixel**			GetMips()							{ ASSERT( !IsPlanar(), "Fat pixels are not available in planar storage! Use GetPlanes() or Get()/Set() instead." ); return m_ppBufferGeneric; }
+	const Planes&	GetPlanes( int _MipLevel ) const	{ ASSERT( IsPlanar(), "Planes are only available in planar storage!" ); return m_pPlanes[_MipLevel]; }
 	const void**	GetLastConvertedMips() const;
 
 
 public:		// METHODS
 
-	TextureBuilder( int _Width, int _Height );
+	TextureBuilder( int _Width, int _Height, U32 _PlanarChannels=0 );	// Specify a combination of CHANNEL flags to use planar storage
  	~TextureBuilder();
 
 	void			CopyFromFast( const TextureBuilder& _Source );	// Copies from a source TB using mip 0 only
 	void			CopyFrom( const TextureBuilder& _Source );		// Same but if the sizes are different and target is smaller, the copy will be performed using the best mip level as source (implies generation of the mip maps on the source builder)
 	void			Clear( const Pixel& _Pixel );
-	void			Fill( FillDelegate _Filler, void* _pData );
+	void			Fill( FillDelegate _Filler, void* _pData, bool _bThreadSafe=false );	// Set _bThreadSafe to spread the work across the worker threads (cf. FillDelegate)
+	void			Iterate( IterateDelegate _Iterator, void* _pData, int _IterationsCount );	// Double-buffered fills for iterative generators (cf. IterateDelegate)
 	void			Get( int _X, int _Y, int _MipLevel, Pixel& _Color ) const;
+	void			Set( int _X, int _Y, const Pixel& _Color );	// Writes into the mip level 0
 	void			SampleWrap( float _X, float _Y, int _MipLevel, Pixel& _Pixel ) const;
 	void			SampleClamp( float _X, float _Y, int _MipLevel, Pixel& _Pixel ) const;
-	void			GenerateMips( bool _bTreatRGBAsNormal=false, bool _bNormalizeNormals=true ) const;
+	void			GenerateMips( bool _bTreatRGBAsNormal=false, bool _bNormalizeNormals=true ) const;	// Mip levels are reduced in parallel
+	void			InvalidateMips()					{ m_bMipLevelsBuilt = false; }	// Call this after writing directly into GetMips()[0] or GetPlanes(0)
+
+	// Returns the address of the first value of a channel (the X component for CHANNEL_RGBA) and the stride between 2 pixels in
+	//	floats, whatever the storage. Returns NULL if the channel is not stored. NOTE: MatID values are ints!
+	float*			GetChannel( int _MipLevel, CHANNEL _Channel, int& _Stride ) const;
 
 	// Converts the generic content into an array of mip-maps of a specific pixel format, ready to build a Texture2D
+	// Block-compressed formats (cf. BlockCompressor) are compressed on the worker threads
 	// NOTE: You don't need to delete the returned pointers
 	void**			Convert( const IPixelFormatDescriptor& _Format, const ConversionParams& _Params, int& _ArraySize, float _NormalFactor=1, bool _bNormalizeNormals=true, float _AOFactor=1 ) const;
 
@@ -120,6 +171,24 @@ public:		// METHODS
 
 
 private:
+
+	// Where Convert() reads a component from
+	struct	ComponentSource
+	{
+		enum TRANSFORM
+		{
+			NONE,
+			LINEARIZE,		// sRGB => Linear
+			PACK_NORMAL,	// (1+Normal)/2
+			FROM_INT,		// Material ID
+		};
+
+		const float*	pSource;	// NULL for empty components
+		int				Stride;
+		TRANSFORM		Transform;
+	};
+
 	void			ReleaseSpecificBuffer() const;
-	float			BuildComponent( int _ComponentIndex, const ConversionParams& _Params, Pixel& _Pixel0, Pixel& _Pixel1, Pixel& _Pixel2 ) const;
+	const Pixel&	Fetch( int _MipLevel, int _Index, Pixel& _Temp ) const;
+	void			ResolveComponent( int _ComponentIndex, const ConversionParams& _Params, int _MipLevel, const TextureBuilder* _pNormal, const TextureBuilder* _pAO, ComponentSource& _Source ) const;
 };
@@ -0,0 +1,152 @@
+#include "../GodComplex.h"
+
+ComputeShader*					TextureBuilderGPU::ms_ppKernels[TextureBuilderGPU::KERNELS_COUNT] = { NULL };
+CB<TextureBuilderGPU::KernelParams>*	TextureBuilderGPU::ms_pCB_Kernel = NULL;
+
+static const char*	gs_ppKernelEntryPoints[TextureBuilderGPU::KERNELS_COUNT] =
+{
+	"CS_Normal",
+	"CS_AO",
+	"CS_BlurH",
+	"CS_BlurV",
+	"CS_Erode",
+	"CS_Dilate",
+};
+
+TextureBuilderGPU::KernelParams::KernelParams()
+{
+	memset( this, 0, sizeof(KernelParams) );
+}
+
+TextureBuilderGPU::TextureBuilderGPU( int _Width, int _Height )
+	: m_Width( _Width )
+	, m_Height( _Height )
+	, m_Current( 0 )
+{
+	for ( int PlaneIndex=0; PlaneIndex < PLANES_COUNT; PlaneIndex++ )
+		for ( int BufferIndex=0; BufferIndex < 2; BufferIndex++ )
+			m_ppPlanes[PlaneIndex][BufferIndex] = new Texture2D( gs_Device, m_Width, m_Height, 1, PixelFormatRGBA32F::DESCRIPTOR, 1, NULL, false, true );
+}
+
+TextureBuilderGPU::~TextureBuilderGPU()
+{
+	for ( int PlaneIndex=0; PlaneIndex < PLANES_COUNT; PlaneIndex++ )
+		for ( int BufferIndex=0; BufferIndex < 2; BufferIndex++ )
+			delete m_ppPlanes[PlaneIndex][BufferIndex];
+}
+
+void	TextureBuilderGPU::CopyFrom( const TextureBuilder& _Source )
+{
+	ASSERT( _Source.GetWidth() == m_Width && _Source.GetHeight() == m_Height, "Builders must have the same size!" );
+
+	// Split the fat pixels into the 2 planes
+	int		PixelsCount = m_Width * m_Height;
+	float4*	pRGBA = new float4[2*PixelsCount];
+	float4*	pMaterial = pRGBA + PixelsCount;
+
+	Pixel	P;
+	for ( int Y=0; Y < m_Height; Y++ )
+		for ( int X=0; X < m_Width; X++ )
+		{
+			_Source.Get( X, Y, 0, P );
+			pRGBA[m_Width*Y+X] = P.RGBA;
+			pMaterial[m_Width*Y+X].Set( P.Height, P.Roughness, P.Metallic, float(P.MatID) );
+		}
+
+	// Upload through staging textures (UAVs can't be created with an initial content)
+	const void*	ppContents[PLANES_COUNT] = { pRGBA, pMaterial };
+	for ( int PlaneIndex=0; PlaneIndex < PLANES_COUNT; PlaneIndex++ )
+	{
+		const void*	ppContent[1] = { ppContents[PlaneIndex] };
+		Texture2D	Staging( gs_Device, m_Width, m_Height, 1, PixelFormatRGBA32F::DESCRIPTOR, 1, ppContent, true );
+		m_ppPlanes[PlaneIndex][m_Current]->CopyFrom( Staging );
+	}
+
+	delete[] pRGBA;
+}
+
+void	TextureBuilderGPU::CopyTo( TextureBuilder& _Target ) const
+{
+	ASSERT( _Target.GetWidth() == m_Width && _Target.GetHeight() == m_Height, "Builders must have the same size!" );
+
+	Texture2D	Staging( gs_Device, m_Width, m_Height, 1, PixelFormatRGBA32F::DESCRIPTOR, 1, NULL, true );
+	for ( int PlaneIndex=0; PlaneIndex < PLANES_COUNT; PlaneIndex++ )
+	{
+		Staging.CopyFrom( *m_ppPlanes[PlaneIndex][m_Current] );
+
+		D3D11_MAPPED_SUBRESOURCE&	Mapped = Staging.Map( 0, 0 );
+		Pixel	P;
+		for ( int Y=0; Y < m_Height; Y++ )
+		{
+			const float4*	pScanline = (const float4*) ((U8*) Mapped.pData + Y * Mapped.RowPitch);
+			for ( int X=0; X < m_Width; X++, pScanline++ )
+			{
+				_Target.Get( X, Y, 0, P );
+				if ( PlaneIndex == PLANE_RGBA )
+					P.RGBA = *pScanline;
+				else
+				{
+					P.Height = pScanline->x;
+					P.Roughness = pScanline->y;
+					P.Metallic = pScanline->z;
+					P.MatID = int(pScanline->w);
+				}
+				_Target.Set( X, Y, P );	// Works with both storages
+			}
+		}
+		Staging.UnMap( 0, 0 );
+	}
+}
+
+void	TextureBuilderGPU::Run( KERNEL _Kernel, const TextureBuilderGPU& _Source, const KernelParams& _Params )
+{
+	ASSERT( _Source.m_Width == m_Width && _Source.m_Height == m_Height, "Builders must have the same size!" );
+
+	// Create the kernels the first time they're needed
+	if ( ms_ppKernels[_Kernel] == NULL )
+	{
+		ms_ppKernels[_Kernel] = CreateComputeShader( IDR_SHADER_TEXTURE_BUILDER_GPU, "./Resources/Shaders/TextureBuilderGPU.hlsl", gs_ppKernelEntryPoints[_Kernel] );
+		ASSERT( !ms_ppKernels[_Kernel]->HasErrors(), "Failed to compile texture builder kernel!" );
+	}
+	if ( ms_pCB_Kernel == NULL )
+		ms_pCB_Kernel = new CB<KernelParams>( gs_Device, 10 );
+
+	ComputeShader&	Kernel = *ms_ppKernels[_Kernel];
+	if ( !Kernel.Use() )
+		return;
+
+	ms_pCB_Kernel->m = _Params;
+	ms_pCB_Kernel->m.Width = m_Width;
+	ms_pCB_Kernel->m.Height = m_Height;
+	ms_pCB_Kernel->UpdateData();
+
+	// Read the current planes of the source and the target, write the other planes of the target
+	int	Next = 1 - m_Current;
+	_Source.m_ppPlanes[PLANE_RGBA][_Source.m_Current]->SetCS( 10 );
+	_Source.m_ppPlanes[PLANE_MATERIAL][_Source.m_Current]->SetCS( 11 );
+	m_ppPlanes[PLANE_RGBA][m_Current]->SetCS( 12 );
+	m_ppPlanes[PLANE_MATERIAL][m_Current]->SetCS( 13 );
+	m_ppPlanes[PLANE_RGBA][Next]->SetCSUAV( 0 );
+	m_ppPlanes[PLANE_MATERIAL][Next]->SetCSUAV( 1 );
+
+	Kernel.Dispatch( (m_Width+15) >> 4, (m_Height+15) >> 4, 1 );
+
+	gs_Device.RemoveShaderResources( 10, 4, Device::SSF_COMPUTE_SHADER );
+	m_ppPlanes[PLANE_RGBA][Next]->RemoveFromLastAssignedSlotUAV();
+	m_ppPlanes[PLANE_MATERIAL][Next]->RemoveFromLastAssignedSlotUAV();
+
+	// Kernels always write both planes so we can simply swap
+	m_Current = Next;
+}
+
+void	TextureBuilderGPU::ReleaseKernels()
+{
+	for ( int KernelIndex=0; KernelIndex < KERNELS_COUNT; KernelIndex++ )
+	{
+		delete ms_ppKernels[KernelIndex];
+		ms_ppKernels[KernelIndex] = NULL;
+	}
+
+	delete ms_pCB_Kernel;
+	ms_pCB_Kernel = NULL;
+}
@@ -0,0 +1,96 @@
+//////////////////////////////////////////////////////////////////////////
+// The GPU counterpart of the TextureBuilder
+// The fat pixels live in 2 UAV textures (planes) and the generators & filters dispatch compute shaders on them instead of
+//	filling the texture on the CPU:
+//	_ The RGBA plane stores Pixel::RGBA
+//	_ The material plane stores Pixel::Height, Pixel::Roughness, Pixel::Metallic and Pixel::MatID (as a float)
+//
+// Each plane is double-buffered: a kernel reads the current planes and writes the other ones, that are then swapped.
+//	That's why a builder can be both the source and the target of an operation.
+//
+// Nothing is ever read back to the CPU unless you call CopyTo(), you can also directly use the planes as textures.
+//
+#pragma once
+
+class	TextureBuilderGPU
+{
+public:		// NESTED TYPES
+
+	enum PLANE
+	{
+		PLANE_RGBA,
+		PLANE_MATERIAL,
+
+		PLANES_COUNT
+	};
+
+	enum KERNEL
+	{
+		KERNEL_NORMAL,
+		KERNEL_AO,
+		KERNEL_BLUR_H,
+		KERNEL_BLUR_V,
+		KERNEL_ERODE,
+		KERNEL_DILATE,
+
+		KERNELS_COUNT
+	};
+
+	// The kernel flags
+	enum FLAGS
+	{
+		FLAG_NORMALIZE = 1,			// Normalize the computed normals
+		FLAG_WRITE_ONLY_ALPHA = 2,	// Only write the alpha channel of the RGBA plane
+		FLAG_WRAP = 4,				// Wrap the texture coordinates (clamp otherwise)
+	};
+
+	// The parameters sent to the kernels (WARNING: must match the cbKernel constant buffer in TextureBuilderGPU.hlsl!)
+	struct	KernelParams
+	{
+		U32		Width;
+		U32		Height;
+		float	HeightFactor;
+		U32		Flags;
+		float2	Direction;
+		U32		KernelSize;			// Blur half size, erosion/dilation radius or AO directions count
+		U32		SamplesCount;		// AO samples count
+		float	WeightFactor;		// Gaussian exponent factor
+		float	InvSumWeights;		// Gaussian normalizer
+
+		KernelParams();
+	};
+
+
+protected:	// FIELDS
+
+	int				m_Width;
+	int				m_Height;
+
+	Texture2D*		m_ppPlanes[PLANES_COUNT][2];
+	int				m_Current;		// Index of the current planes
+
+	static ComputeShader*	ms_ppKernels[KERNELS_COUNT];
+	static CB<KernelParams>*	ms_pCB_Kernel;
+
+
+public:		// PROPERTIES
+
+	int				GetWidth() const					{ return m_Width; }
+	int				GetHeight() const					{ return m_Height; }
+	Texture2D&		GetPlane( PLANE _Plane ) const		{ return *m_ppPlanes[_Plane][m_Current]; }
+
+
+public:		// METHODS
+
+	TextureBuilderGPU( int _Width, int _Height );
+	~TextureBuilderGPU();
+
+	void			CopyFrom( const TextureBuilder& _Source );	// Uploads the mip 0 of a CPU builder (both must have the same size)
+	void			CopyTo( TextureBuilder& _Target ) const;	// Reads the planes back into the mip 0 of a CPU builder (mips will need to be rebuilt)
+
+	// Runs a kernel reading the current planes of the source and writing the other planes of this builder, which become current
+	void			Run( KERNEL _Kernel, const TextureBuilderGPU& _Source, const KernelParams& _Params );
+
+	// Releases the kernels, that are created the first time a builder runs them
+	static void		ReleaseKernels();
+};
@@ -0,0 +1,452 @@
+#include "../GodComplex.h"
+
+//////////////////////////////////////////////////////////////////////////
+// Built-in nodes
+namespace
+{
+	void	EvaluateBlur( const TextureBuilder** _ppInputs, const float* _pParams, TextureBuilder& _Target, void* _pData )
+	{
+		_Target.CopyFromFast( *_ppInputs[0] );
+		Filters::BlurGaussian( _Target, _pParams[0], _pParams[1], _pParams[2] != 0.0f, _pParams[3] );
+	}
+
+	void	EvaluateNormal( const TextureBuilder** _ppInputs, const float* _pParams, TextureBuilder& _Target, void* _pData )
+	{
+		Generators::ComputeNormal( *_ppInputs[0], _Target, _pParams[0], _pParams[1] != 0.0f );
+	}
+
+	void	EvaluateAO( const TextureBuilder** _ppInputs, const float* _pParams, TextureBuilder& _Target, void* _pData )
+	{
+		Generators::ComputeAO( *_ppInputs[0], _Target, _pParams[0], int(_pParams[1]), int(_pParams[2]) );
+	}
+
+	struct	__BlendStruct
+	{
+		const TextureBuilder*	pA;
+		const TextureBuilder*	pB;
+		const TextureBuilder*	pMask;
+		float					Factor;
+	};
+	void	FillBlend( int _X, int _Y, const float2& _UV, Pixel& _Pixel, void* _pData )
+	{
+		__BlendStruct&	Params = *((__BlendStruct*) _pData);
+
+		Pixel	B;
+		Params.pA->Get( _X, _Y, 0, _Pixel );
+		Params.pB->Get( _X, _Y, 0, B );
+
+		float	t = Params.Factor;
+		if ( Params.pMask != NULL )
+		{
+			Pixel	Mask;
+			Params.pMask->Get( _X, _Y, 0, Mask );
+			t *= Mask.RGBA.w;
+		}
+
+		_Pixel.Blend( B, t );
+	}
+	void	EvaluateBlend( const TextureBuilder** _ppInputs, const float* _pParams, TextureBuilder& _Target, void* _pData )
+	{
+		__BlendStruct	Params;
+		Params.pA = _ppInputs[0];
+		Params.pB = _ppInputs[1];
+		Params.pMask = _pParams[1] != 0.0f ? _ppInputs[2] : NULL;
+		Params.Factor = _pParams[0];
+
+		_Target.Fill( FillBlend, &Params, true );
+	}
+
+	// 64-bits FNV-1a
+	static const U64	FNV_OFFSET_BASIS_64 = 14695981039346656037ULL;
+	static const U64	FNV_PRIME_64 = 1099511628211ULL;
+
+	U64		HashBytes( U64 _Hash, const void* _pData, int _Size )
+	{
+		const U8*	pBytes = (const U8*) _pData;
+		for ( int i=0; i < _Size; i++ )
+		{
+			_Hash ^= pBytes[i];
+			_Hash *= FNV_PRIME_64;
+		}
+		return _Hash;
+	}
+}
+
+TextureGraph::TextureGraph()
+	: m_NodesCount( 0 )
+{
+#ifdef _DEBUG
+	m_pCacheDirectory[0] = '\0';
+#endif
+}
+
+TextureGraph::~TextureGraph()
+{
+	ReleaseResults();
+}
+
+int		TextureGraph::AddNode( const char* _pName, int _Width, int _Height, EvaluateDelegate _Evaluate, void* _pData, U32 _PlanarChannels )
+{
+	ASSERT( m_NodesCount < MAX_NODES, "Too many texture graph nodes!" );
+
+	Node&	N = m_pNodes[m_NodesCount];
+	N.pName = _pName;
+	N.pType = NULL;
+	N.Evaluate = _Evaluate;
+	N.pData = _pData;
+	N.Width = _Width;
+	N.Height = _Height;
+	N.PlanarChannels = _PlanarChannels;
+	N.bNormalMips = false;
+	N.InputsCount = 0;
+	memset( N.pParams, 0, MAX_PARAMS*sizeof(float) );
+	N.Version = 0;
+	N.Hash = 0;
+	N.ResultHash = 0;
+	N.pResult = NULL;
+	N.State = DIRTY;
+	N.Duration = 0.0;
+
+	return m_NodesCount++;
+}
+
+void	TextureGraph::AddInput( int _Node, int _Input )
+{
+	ASSERT( _Node < m_NodesCount && _Input < _Node, "Nodes can only read nodes declared before them!" );
+	Node&	N = m_pNodes[_Node];
+	ASSERT( N.InputsCount < MAX_INPUTS, "Too many inputs!" );
+	N.pInputs[N.InputsCount++] = _Input;
+}
+
+void	TextureGraph::SetParam( int _Node, int _ParamIndex, float _Value )
+{
+	ASSERT( _Node < m_NodesCount && _ParamIndex < MAX_PARAMS, "Invalid node or parameter index!" );
+	m_pNodes[_Node].pParams[_ParamIndex] = _Value;
+}
+
+float	TextureGraph::GetParam( int _Node, int _ParamIndex ) const
+{
+	ASSERT( _Node < m_NodesCount && _ParamIndex < MAX_PARAMS, "Invalid node or parameter index!" );
+	return m_pNodes[_Node].pParams[_ParamIndex];
+}
+
+void	TextureGraph::Touch( int _Node )
+{
+	ASSERT( _Node < m_NodesCount, "Invalid node index!" );
+	m_pNodes[_Node].Version++;
+}
+
+int		TextureGraph::AddBlur( const char* _pName, int _Input, float _SizeX, float _SizeY, bool _bWrap, float _MinWeight )
+{
+	const Node&	Source = m_pNodes[_Input];
+	int			NodeIndex = AddNode( _pName, Source.Width, Source.Height, EvaluateBlur, NULL, Source.PlanarChannels );
+	m_pNodes[NodeIndex].pType = "Blur";
+	AddInput( NodeIndex, _Input );
+	SetParam( NodeIndex, 0, _SizeX );
+	SetParam( NodeIndex, 1, _SizeY );
+	SetParam( NodeIndex, 2, _bWrap ? 1.0f : 0.0f );
+	SetParam( NodeIndex, 3, _MinWeight );
+	return NodeIndex;
+}
+
+int		TextureGraph::AddNormal( const char* _pName, int _Input, float _HeightFactor, bool _bNormalize )
+{
+	const Node&	Source = m_pNodes[_Input];
+	int			NodeIndex = AddNode( _pName, Source.Width, Source.Height, EvaluateNormal, NULL, TextureBuilder::CHANNEL_RGBA );
+	m_pNodes[NodeIndex].pType = "Normal";
+	m_pNodes[NodeIndex].bNormalMips = true;
+	AddInput( NodeIndex, _Input );
+	SetParam( NodeIndex, 0, _HeightFactor );
+	SetParam( NodeIndex, 1, _bNormalize ? 1.0f : 0.0f );
+	return NodeIndex;
+}
+
+int		TextureGraph::AddAO( const char* _pName, int _Input, float _HeightFactor, int _DirectionsCount, int _SamplesCount )
+{
+	const Node&	Source = m_pNodes[_Input];
+	int			NodeIndex = AddNode( _pName, Source.Width, Source.Height, EvaluateAO, NULL, TextureBuilder::CHANNEL_RGBA );
+	m_pNodes[NodeIndex].pType = "AO";
+	AddInput( NodeIndex, _Input );
+	SetParam( NodeIndex, 0, _HeightFactor );
+	SetParam( NodeIndex, 1, float(_DirectionsCount) );
+	SetParam( NodeIndex, 2, float(_SamplesCount) );
+	return NodeIndex;
+}
+
+int		TextureGraph::AddBlend( const char* _pName, int _InputA, int _InputB, float _Factor, int _Mask )
+{
+	const Node&	A = m_pNodes[_InputA];
+	const Node&	B = m_pNodes[_InputB];
+	ASSERT( A.Width == B.Width && A.Height == B.Height, "Blended nodes must have the same size!" );
+	ASSERT( _Mask < 0 || (m_pNodes[_Mask].Width == A.Width && m_pNodes[_Mask].Height == A.Height), "The blend mask must have the same size as the blended nodes!" );
+
+	U32			PlanarChannels = A.PlanarChannels != 0 && B.PlanarChannels != 0 ? A.PlanarChannels | B.PlanarChannels : 0;	// Fat pixels if either input has them
+	int			NodeIndex = AddNode( _pName, A.Width, A.Height, EvaluateBlend, NULL, PlanarChannels );
+	m_pNodes[NodeIndex].pType = "Blend";
+	AddInput( NodeIndex, _InputA );
+	AddInput( NodeIndex, _InputB );
+	if ( _Mask >= 0 )
+		AddInput( NodeIndex, _Mask );
+	SetParam( NodeIndex, 0, _Factor );
+	SetParam( NodeIndex, 1, _Mask >= 0 ? 1.0f : 0.0f );
+	return NodeIndex;
+}
+
+int		TextureGraph::Run()
+{
+	ASSERT( gs_Device.Jobs().IsOwner(), "The graph must run on the thread owning the device!" );
+
+	LARGE_INTEGER	Start;
+	QueryPerformanceCounter( &Start );
+
+	// Find the nodes whose inputs or parameters changed (inputs are declared first so their hash is already up to date)
+	int	DirtyCount = 0;
+	int	LoadedCount = 0;
+	for ( int NodeIndex=0; NodeIndex < m_NodesCount; NodeIndex++ )
+	{
+		Node&	N = m_pNodes[NodeIndex];
+		N.Hash = ComputeHash( N );
+		N.State = N.pResult != NULL && N.Hash == N.ResultHash ? CLEAN : DIRTY;
+		N.Duration = 0.0;
+
+#ifdef _DEBUG
+		if ( N.State == DIRTY && LoadResult( N ) )
+		{
+			N.ResultHash = N.Hash;
+			N.State = CLEAN;
+			LoadedCount++;
+		}
+#endif
+		if ( N.State == DIRTY )
+			DirtyCount++;
+	}
+
+	// Evaluate the dirty nodes by waves of nodes whose inputs are ready
+	JobQueue*	pQueue = NULL;	// Our own counter so waiting for the nodes doesn't wait for the device's jobs
+	int			EvaluatedCount = 0;
+	while ( EvaluatedCount < DirtyCount )
+	{
+		int	pReady[MAX_NODES];
+		int	ReadyCount = 0;
+		for ( int NodeIndex=0; NodeIndex < m_NodesCount; NodeIndex++ )
+		{
+			Node&	N = m_pNodes[NodeIndex];
+			if ( N.State != DIRTY )
+				continue;
+
+			bool	bReady = true;
+			for ( int InputIndex=0; InputIndex < N.InputsCount; InputIndex++ )
+			{
+				const Node&	Input = m_pNodes[N.pInputs[InputIndex]];
+				bReady &= Input.State != DIRTY;
+				N.ppInputResults[InputIndex] = Input.pResult;
+			}
+			if ( bReady )
+				pReady[ReadyCount++] = NodeIndex;
+		}
+		ASSERT( ReadyCount > 0, "No node is ready!" );
+
+		if ( ReadyCount == 1 )
+			m_pNodes[pReady[0]].Run();	// A single node runs here so its kernels can use the device's workers
+		else
+		{
+			if ( pQueue == NULL )
+				pQueue = new JobQueue();
+			for ( int ReadyIndex=0; ReadyIndex < ReadyCount; ReadyIndex++ )
+				pQueue->Push( m_pNodes[pReady[ReadyIndex]] );
+			pQueue->Wait();
+		}
+
+		for ( int ReadyIndex=0; ReadyIndex < ReadyCount; ReadyIndex++ )
+		{
+			Node&	N = m_pNodes[pReady[ReadyIndex]];
+			N.ResultHash = N.Hash;
+			N.State = EVALUATED;
+#ifdef _DEBUG
+			SaveResult( N );
+#endif
+		}
+		EvaluatedCount += ReadyCount;
+	}
+	delete pQueue;
+
+	if ( EvaluatedCount > 0 || LoadedCount > 0 )
+	{
+		for ( int NodeIndex=0; NodeIndex < m_NodesCount; NodeIndex++ )
+			if ( m_pNodes[NodeIndex].State == EVALUATED )
+				print( "Texture node \"%s\": evaluated in %.1f ms\n", m_pNodes[NodeIndex].pName, 1000.0 * m_pNodes[NodeIndex].Duration );
+		print( "Texture graph ran in %.1f ms (%d nodes evaluated, %d loaded from the cache, %d up to date)\n", 1000.0 * GetSeconds( Start ), EvaluatedCount, LoadedCount, m_NodesCount - EvaluatedCount - LoadedCount );
+	}
+
+	return EvaluatedCount;
+}
+
+const TextureBuilder&	TextureGraph::GetResult( int _Node ) const
+{
+	ASSERT( _Node < m_NodesCount && m_pNodes[_Node].pResult != NULL, "Node was not evaluated! Did you forget to call Run()?" );
+	return *m_pNodes[_Node].pResult;
+}
+
+void	TextureGraph::ReleaseResults()
+{
+	for ( int NodeIndex=0; NodeIndex < m_NodesCount; NodeIndex++ )
+	{
+		delete m_pNodes[NodeIndex].pResult;
+		m_pNodes[NodeIndex].pResult = NULL;
+	}
+}
+
+void	TextureGraph::Node::Run()
+{
+	LARGE_INTEGER	EvaluateStart;
+	QueryPerformanceCounter( &EvaluateStart );
+
+	if ( pResult == NULL )
+		pResult = new TextureBuilder( Width, Height, PlanarChannels );
+	else
+		pResult->Clear( Pixel() );
+
+	Evaluate( ppInputResults, pParams, *pResult, pData );
+	pResult->GenerateMips( bNormalMips );	// So dependent nodes can read the result concurrently
+
+	Duration = GetSeconds( EvaluateStart );
+}
+
+U64		TextureGraph::ComputeHash( const Node& _Node ) const
+{
+	const char*	pIdentifier = _Node.pType != NULL ? _Node.pType : _Node.pName;
+
+	U64	Hash = FNV_OFFSET_BASIS_64;
+	Hash = HashBytes( Hash, pIdentifier, int(strlen( pIdentifier )) );
+	Hash = HashBytes( Hash, &_Node.Width, sizeof(int) );
+	Hash = HashBytes( Hash, &_Node.Height, sizeof(int) );
+	Hash = HashBytes( Hash, &_Node.PlanarChannels, sizeof(U32) );
+	Hash = HashBytes( Hash, &_Node.bNormalMips, sizeof(bool) );
+	Hash = HashBytes( Hash, _Node.pParams, MAX_PARAMS*sizeof(float) );
+	Hash = HashBytes( Hash, &_Node.Version, sizeof(U32) );
+	for ( int InputIndex=0; InputIndex < _Node.InputsCount; InputIndex++ )
+		Hash = HashBytes( Hash, &m_pNodes[_Node.pInputs[InputIndex]].Hash, sizeof(U64) );
+
+	return Hash;
+}
+
+double	TextureGraph::GetSeconds( const LARGE_INTEGER& _Start )
+{
+	LARGE_INTEGER	Frequency, End;
+	QueryPerformanceFrequency( &Frequency );
+	QueryPerformanceCounter( &End );
+	return double(End.QuadPart - _Start.QuadPart) / Frequency.QuadPart;
+}
+
+#ifdef _DEBUG
+//////////////////////////////////////////////////////////////////////////
+// Disk cache
+// A cache file stores the size and the stored channels of the result then the mip level 0 of each stored channel
+//	(mips are generated again when loading)
+//
+namespace
+{
+	static const TextureBuilder::CHANNEL	CACHED_CHANNELS[] = { TextureBuilder::CHANNEL_RGBA, TextureBuilder::CHANNEL_HEIGHT, TextureBuilder::CHANNEL_ROUGHNESS, TextureBuilder::CHANNEL_METALLIC, TextureBuilder::CHANNEL_MATID };
+	static const int						CACHED_CHANNELS_COUNT = sizeof(CACHED_CHANNELS) / sizeof(TextureBuilder::CHANNEL);
+
+	int		GetChannelComponentsCount( TextureBuilder::CHANNEL _Channel )	{ return _Channel == TextureBuilder::CHANNEL_RGBA ? 4 : 1; }
+}
+
+void	TextureGraph::SetCacheDirectory( const char* _pDirectory )
+{
+	if ( _pDirectory == NULL )
+	{
+		m_pCacheDirectory[0] = '\0';
+		return;
+	}
+
+	strcpy_s( m_pCacheDirectory, MAX_PATH, _pDirectory );
+	CreateDirectoryA( m_pCacheDirectory, NULL );	// Fails if it already exists, which is fine
+}
+
+void	TextureGraph::GetCacheFileName( U64 _Hash, char _pFileName[MAX_PATH] ) const
+{
+	sprintf_s( _pFileName, MAX_PATH, "%s/%016I64X.tgc", m_pCacheDirectory, _Hash );
+}
+
+bool	TextureGraph::LoadResult( Node& _Node ) const
+{
+	if ( m_pCacheDirectory[0] == '\0' )
+		return false;
+
+	char	pFileName[MAX_PATH];
+	GetCacheFileName( _Node.Hash, pFileName );
+	FILE*	pFile = NULL;
+	if ( fopen_s( &pFile, pFileName, "rb" ) != 0 || pFile == NULL )
+		return false;
+
+	int		pHeader[3];
+	U32		StoredChannels = _Node.PlanarChannels != 0 ? _Node.PlanarChannels : U32(TextureBuilder::CHANNELS_ALL);
+	bool	bValid = fread( pHeader, sizeof(int), 3, pFile ) == 3 && pHeader[0] == _Node.Width && pHeader[1] == _Node.Height && U32(pHeader[2]) == StoredChannels;
+	if ( bValid )
+	{
+		if ( _Node.pResult == NULL )
+			_Node.pResult = new TextureBuilder( _Node.Width, _Node.Height, _Node.PlanarChannels );
+
+		int		PixelsCount = _Node.Width * _Node.Height;
+		float*	pLine = new float[4*_Node.Width];
+		for ( int ChannelIndex=0; bValid && ChannelIndex < CACHED_CHANNELS_COUNT; ChannelIndex++ )
+		{
+			int		Stride;
+			float*	pTarget = _Node.pResult->GetChannel( 0, CACHED_CHANNELS[ChannelIndex], Stride );
+			if ( pTarget == NULL )
+				continue;
+
+			int		ComponentsCount = GetChannelComponentsCount( CACHED_CHANNELS[ChannelIndex] );
+			for ( int Y=0; bValid && Y < _Node.Height; Y++ )
+			{
+				bValid = fread( pLine, ComponentsCount*sizeof(float), _Node.Width, pFile ) == size_t(_Node.Width);
+				for ( int X=0; X < _Node.Width; X++, pTarget+=Stride )
+					memcpy( pTarget, &pLine[ComponentsCount*X], ComponentsCount*sizeof(float) );	// Copies the MatID bits as they are
+			}
+		}
+		delete[] pLine;
+
+		_Node.pResult->InvalidateMips();
+		_Node.pResult->GenerateMips( _Node.bNormalMips );
+	}
+	fclose( pFile );
+
+	return bValid;
+}
+
+void	TextureGraph::SaveResult( const Node& _Node ) const
+{
+	if ( m_pCacheDirectory[0] == '\0' )
+		return;
+
+	char	pFileName[MAX_PATH];
+	GetCacheFileName( _Node.Hash, pFileName );
+	FILE*	pFile = NULL;
+	if ( fopen_s( &pFile, pFileName, "wb" ) != 0 || pFile == NULL )
+		return;	// Not cached then...
+
+	int	pHeader[3] = { _Node.Width, _Node.Height, int(_Node.PlanarChannels != 0 ? _Node.PlanarChannels : U32(TextureBuilder::CHANNELS_ALL)) };
+	fwrite( pHeader, sizeof(int), 3, pFile );
+
+	float*	pLine = new float[4*_Node.Width];
+	for ( int ChannelIndex=0; ChannelIndex < CACHED_CHANNELS_COUNT; ChannelIndex++ )
+	{
+		int				Stride;
+		const float*	pSource = _Node.pResult->GetChannel( 0, CACHED_CHANNELS[ChannelIndex], Stride );
+		if ( pSource == NULL )
+			continue;
+
+		int		ComponentsCount = GetChannelComponentsCount( CACHED_CHANNELS[ChannelIndex] );
+		for ( int Y=0; Y < _Node.Height; Y++ )
+		{
+			for ( int X=0; X < _Node.Width; X++, pSource+=Stride )
+				memcpy( &pLine[ComponentsCount*X], pSource, ComponentsCount*sizeof(float) );
+			fwrite( pLine, ComponentsCount*sizeof(float), _Node.Width, pFile );
+		}
+	}
+	delete[] pLine;
+
+	fclose( pFile );
+}
+#endif
@@ -0,0 +1,143 @@
+//////////////////////////////////////////////////////////////////////////
+// Procedural Texture Graph
+// Declares a procedural texture as a graph of nodes (noise, draw, blur, normal, AO, blend...) instead of a sequence of
+//	calls on texture builders, so the results of the nodes can be kept between evaluations.
+//
+// Each node has a hash of its type, size, parameters, version and of the hashes of its inputs, Run() only evaluates
+//	the nodes whose hash changed since their last evaluation: tweaking a parameter only evaluates that node and the nodes
+//	depending on it. The nodes whose inputs are ready are evaluated concurrently when there are several of them.
+// In debug, the results can also be cached on disk (cf. SetCacheDirectory()) so a new launch only evaluates what changed.
+//
+// Usage:
+//	TextureGraph	Graph;
+//	int	Panels = Graph.AddNode( "Panels", 1024, 1024, EvaluatePanels, &Data );	// Custom node (e.g. noise or draw)
+//	Graph.SetParam( Panels, 0, 20.0f );												// Read by EvaluatePanels() in _pParams[0]
+//	int	Blurred = Graph.AddBlur( "PanelsBlur", Panels, 4.0f, 4.0f );
+//	int	Normal = Graph.AddNormal( "PanelsNormal", Blurred, 2.0f );
+//	Graph.Run();
+//	Texture2D*	pTexture = Graph.GetResult( Normal ).CreateTexture( PixelFormatRGBA8::DESCRIPTOR, TextureBuilder::CONV_RGBA );
+//
+//	Graph.SetParam( Panels, 0, 30.0f );
+//	Graph.Run();	// Evaluates the 3 nodes again, then only the normal node if we change the height factor of the normal node
+//
+// NOTE: Evaluation delegates run on worker threads: they must not use the device nor the global random generator (use a
+//	RandomStream seeded by a parameter instead) and must only read the data given by _pData (cf. TextureBuilder::FillDelegate).
+// The hashes only know about the parameters: call Touch() when a node's delegate or _pData content changes otherwise.
+// The results are complete with their mip levels so they're ready for CreateTexture() and can be read concurrently.
+//
+#pragma once
+
+class TextureGraph
+{
+public:		// CONSTANTS
+
+	static const int	MAX_NODES = 64;
+	static const int	MAX_INPUTS = 4;
+	static const int	MAX_PARAMS = 8;
+
+public:		// NESTED TYPES
+
+	// Writes the node's result into _Target (cleared with Pixel() before the call)
+	//	_ppInputs, the results of the node's inputs in the order they were added
+	//	_pParams, the node's parameters (cf. SetParam())
+	typedef void	(*EvaluateDelegate)( const TextureBuilder** _ppInputs, const float* _pParams, TextureBuilder& _Target, void* _pData );
+
+private:
+
+	enum STATE
+	{
+		CLEAN,		// Result is up to date
+		DIRTY,		// Must be evaluated
+		EVALUATED,	// Evaluated during this run
+	};
+
+	class	Node : public IJob
+	{
+	public:
+		const char*			pName;
+		const char*			pType;			// Built-in node type, or NULL for custom nodes
+		EvaluateDelegate	Evaluate;
+		void*				pData;
+		int					Width;
+		int					Height;
+		U32					PlanarChannels;
+		bool				bNormalMips;	// Mips are built as normals
+
+		int					pInputs[MAX_INPUTS];
+		int					InputsCount;
+		float				pParams[MAX_PARAMS];
+		U32					Version;
+
+		U64					Hash;
+		U64					ResultHash;
+		TextureBuilder*		pResult;
+		STATE				State;
+		double				Duration;		// In seconds
+		const TextureBuilder*	ppInputResults[MAX_INPUTS];
+
+	public:
+		virtual void	Run();
+	};
+
+private:	// FIELDS
+
+	Node		m_pNodes[MAX_NODES];
+	int			m_NodesCount;
+
+#ifdef _DEBUG
+	char		m_pCacheDirectory[MAX_PATH];
+#endif
+
+public:		// PROPERTIES
+
+	int			GetNodesCount() const	{ return m_NodesCount; }
+
+public:		// METHODS
+
+	TextureGraph();
+	~TextureGraph();
+
+	// Adds a custom node (e.g. a noise or a drawing), _PlanarChannels is a combination of TextureBuilder::CHANNEL flags (cf. TextureBuilder)
+	// Returns the index of the node to declare its inputs and to read its result
+	int			AddNode( const char* _pName, int _Width, int _Height, EvaluateDelegate _Evaluate, void* _pData, U32 _PlanarChannels=0 );
+
+	// _Input's result is given to _Node's delegate (nodes can only read nodes declared before them)
+	void		AddInput( int _Node, int _Input );
+
+	void		SetParam( int _Node, int _ParamIndex, float _Value );
+	float		GetParam( int _Node, int _ParamIndex ) const;
+
+	// Forces the node (and the ones depending on it) to be evaluated again on the next Run()
+	void		Touch( int _Node );
+
+	// Built-in nodes, of the size of their (first) input
+	int			AddBlur( const char* _pName, int _Input, float _SizeX, float _SizeY, bool _bWrap=true, float _MinWeight=0.05f );	// cf. Filters::BlurGaussian()
+	int			AddNormal( const char* _pName, int _Input, float _HeightFactor=1.0f, bool _bNormalize=true );						// cf. Generators::ComputeNormal()
+	int			AddAO( const char* _pName, int _Input, float _HeightFactor=1.0f, int _DirectionsCount=8, int _SamplesCount=8 );	// cf. Generators::ComputeAO()
+	int			AddBlend( const char* _pName, int _InputA, int _InputB, float _Factor=0.5f, int _Mask=-1 );	// Lerps A to B by _Factor (times the alpha of _Mask if any)
+
+	// Evaluates the nodes whose hash changed since their last evaluation, returns the amount of evaluated nodes
+	int			Run();
+
+	const TextureBuilder&	GetResult( int _Node ) const;
+
+	// Releases all the results (the next Run() evaluates everything)
+	void		ReleaseResults();
+
+#ifdef _DEBUG
+	// Results are also saved to & loaded from "<Directory>/<Hash>.tgc" files, NULL disables the disk cache
+	void		SetCacheDirectory( const char* _pDirectory );
+#endif
+
+private:
+
+	U64			ComputeHash( const Node& _Node ) const;
+
+#ifdef _DEBUG
+	bool		LoadResult( Node& _Node ) const;
+	void		SaveResult( const Node& _Node ) const;
+	void		GetCacheFileName( U64 _Hash, char _pFileName[MAX_PATH] ) const;
+#endif
+
+	static double	GetSeconds( const LARGE_INTEGER& _Start );
+};
@@ -0,0 +1,394 @@
+#include "../GodComplex.h"
+
+VirtualTexture::VirtualTexture( Device& _Device, int _PagesPOT, int _SlotsPerSide, PageDelegate _Delegate, void* _pData, const IPixelFormatDescriptor& _Format, const TextureBuilder::ConversionParams& _ConversionParams, int _ScreenWidth, int _ScreenHeight, int _FeedbackDownsampling, int _ProducersCount )
+	: m_Device( _Device )
+	, m_Delegate( _Delegate )
+	, m_pData( _pData )
+	, m_Format( _Format )
+	, m_ConversionParams( _ConversionParams )
+	, m_PagesPOT( _PagesPOT )
+	, m_MipsCount( _PagesPOT+1 )
+	, m_bPageTableDirty( true )
+	, m_SlotsPerSide( _SlotsPerSide )
+	, m_FrameIndex( 0 )
+	, m_ProducersCount( 0 )
+	, m_bQuit( false )
+	, m_QueueReadIndex( 0 )
+	, m_QueueCount( 0 )
+	, m_InFlightCount( 0 )
+	, m_ProducedCount( 0 )
+{
+	ASSERT( _PagesPOT >= 0 && _PagesPOT <= MAX_PAGES_POT, "Virtual texture too large!" );
+	ASSERT( _SlotsPerSide*SLOT_SIZE <= 8192 && _SlotsPerSide*_SlotsPerSide < PRODUCING_SLOT, "Atlas too large!" );
+
+	// Build the coarsest page right away (this also tells us the array size of the conversion)
+	TextureBuilder	Page( SLOT_SIZE, SLOT_SIZE );
+	float			BorderUV = float(PAGE_BORDER) / PAGE_SIZE;
+	m_Delegate( m_MipsCount-1, 0, 0, float2( -BorderUV, -BorderUV ), float2( 1.0f + BorderUV, 1.0f + BorderUV ), Page, m_pData );
+	void**	ppContent = Page.Convert( m_Format, m_ConversionParams, m_ArraySize );
+	int		PageMipsCount = Texture2D::ComputeMipLevelsCount( SLOT_SIZE, SLOT_SIZE, 0 );
+
+	// Create the GPU resources
+	int	AtlasSize = m_SlotsPerSide * SLOT_SIZE;
+	int	PagesCount = 1 << m_PagesPOT;
+	m_pTexAtlas = new Texture2D( m_Device, AtlasSize, AtlasSize, m_ArraySize, m_Format, 1, NULL );
+	m_pTexUpload = new Texture2D( m_Device, SLOT_SIZE, SLOT_SIZE, m_ArraySize, m_Format, 1, NULL );
+	m_pTexPageTable = new Texture2D( m_Device, PagesCount, PagesCount, 1, PixelFormatRGBA16_UINT::DESCRIPTOR, m_MipsCount, NULL );
+	m_pTexFeedback = new Texture2D( m_Device, MAX( 1, _ScreenWidth / _FeedbackDownsampling ), MAX( 1, _ScreenHeight / _FeedbackDownsampling ), 1, PixelFormatRGBA16_UINT::DESCRIPTOR, 1, NULL );
+	m_pFeedbackTickets[0] = m_pFeedbackTickets[1] = -1;
+
+	m_pCB_VirtualTexture = new CB<CBVirtualTexture>( m_Device, 12 );
+	m_pCB_VirtualTexture->m.PagesCount = float(PagesCount);
+	m_pCB_VirtualTexture->m.MaxMip = float(m_MipsCount-1);
+	m_pCB_VirtualTexture->m.FeedbackMipBias = logf( float(_FeedbackDownsampling) ) / logf( 2.0f );	// Feedback derivatives are larger by the downsampling factor
+	m_pCB_VirtualTexture->m.AtlasInvSize.Set( 1.0f / AtlasSize, 1.0f / AtlasSize );
+
+	// Residency & page table
+	m_ppResidency = new U16*[m_MipsCount];
+	m_ppPageTable = new PixelFormatRGBA16_UINT*[m_MipsCount];
+	for ( int MipLevel=0; MipLevel < m_MipsCount; MipLevel++ )
+	{
+		int	MipPagesCount = PagesCount >> MipLevel;
+		m_ppResidency[MipLevel] = new U16[MipPagesCount*MipPagesCount];
+		for ( int PageIndex=0; PageIndex < MipPagesCount*MipPagesCount; PageIndex++ )
+			m_ppResidency[MipLevel][PageIndex] = NO_SLOT;
+		m_ppPageTable[MipLevel] = new PixelFormatRGBA16_UINT[MipPagesCount*MipPagesCount];
+	}
+
+	m_pSlots = new Slot[m_SlotsPerSide*m_SlotsPerSide];
+	for ( int SlotIndex=0; SlotIndex < m_SlotsPerSide*m_SlotsPerSide; SlotIndex++ )
+	{
+		m_pSlots[SlotIndex].Key = -1;
+		m_pSlots[SlotIndex].LastUsedFrame = 0;
+		m_pSlots[SlotIndex].bLocked = false;
+	}
+
+	// Upload the coarsest page into slot 0 for good
+	U8*		pContent = new U8[m_ArraySize*SLOT_SIZE*SLOT_SIZE*m_Format.Size()];
+	int		SliceSize = SLOT_SIZE*SLOT_SIZE*m_Format.Size();
+	for ( int SliceIndex=0; SliceIndex < m_ArraySize; SliceIndex++ )
+		memcpy( pContent + SliceIndex*SliceSize, ppContent[SliceIndex*PageMipsCount], SliceSize );
+
+	ProducedPage	CoarsestPage;
+	CoarsestPage.Key = MakeKey( m_MipsCount-1, 0, 0 );
+	CoarsestPage.pContent = pContent;
+	UploadPage( CoarsestPage );
+	m_pSlots[0].bLocked = true;
+	delete[] pContent;
+
+	RebuildPageTable();
+
+	// Start the producers
+	InitializeCriticalSection( &m_Lock );
+	m_hQueued = CreateSemaphore( NULL, 0, MAX_QUEUED_PAGES + MAX_PRODUCERS, NULL );
+
+	if ( _ProducersCount < 0 )
+	{
+		SYSTEM_INFO	Info;
+		GetSystemInfo( &Info );
+		_ProducersCount = int(Info.dwNumberOfProcessors) / 2;
+	}
+	_ProducersCount = CLAMP( _ProducersCount, 1, MAX_PRODUCERS );
+	for ( int ProducerIndex=0; ProducerIndex < _ProducersCount; ProducerIndex++ )
+	{
+		DWORD	ThreadID;
+		m_phProducers[m_ProducersCount] = CreateThread( NULL, 0, ProducerThread, this, 0, &ThreadID );
+		if ( m_phProducers[m_ProducersCount] == NULL )
+			break;	// Live with what we got...
+		SetThreadPriority( m_phProducers[m_ProducersCount], THREAD_PRIORITY_BELOW_NORMAL );	// Don't steal time from the render thread
+		m_ProducersCount++;
+	}
+	ASSERT( m_ProducersCount > 0, "Failed to create the page producer threads!" );
+}
+
+VirtualTexture::~VirtualTexture()
+{
+	// Wake the producers up so they notice they must quit
+	m_bQuit = true;
+	ReleaseSemaphore( m_hQueued, m_ProducersCount, NULL );
+	if ( m_ProducersCount > 0 )
+		WaitForMultipleObjects( m_ProducersCount, m_phProducers, TRUE, INFINITE );
+	for ( int ProducerIndex=0; ProducerIndex < m_ProducersCount; ProducerIndex++ )
+		CloseHandle( m_phProducers[ProducerIndex] );
+
+	for ( int ProducedIndex=0; ProducedIndex < m_ProducedCount; ProducedIndex++ )
+		delete[] m_pProduced[ProducedIndex].pContent;
+
+	CloseHandle( m_hQueued );
+	DeleteCriticalSection( &m_Lock );
+
+	// Resolve the pending readbacks so the staging textures aren't released while in use
+	for ( int TicketIndex=0; TicketIndex < 2; TicketIndex++ )
+		while ( m_pFeedbackTickets[TicketIndex] >= 0 && m_pTexFeedback->TryResolve( m_pFeedbackTickets[TicketIndex] ) == NULL )
+			Sleep( 1 );
+
+	for ( int MipLevel=0; MipLevel < m_MipsCount; MipLevel++ )
+	{
+		delete[] m_ppResidency[MipLevel];
+		delete[] m_ppPageTable[MipLevel];
+	}
+	delete[] m_ppResidency;
+	delete[] m_ppPageTable;
+	delete[] m_pSlots;
+
+	delete m_pCB_VirtualTexture;
+	delete m_pTexFeedback;
+	delete m_pTexPageTable;
+	delete m_pTexUpload;
+	delete m_pTexAtlas;
+}
+
+void	VirtualTexture::SubmitFeedback()
+{
+	for ( int TicketIndex=0; TicketIndex < 2; TicketIndex++ )
+		if ( m_pFeedbackTickets[TicketIndex] < 0 )
+		{
+			m_pFeedbackTickets[TicketIndex] = m_pTexFeedback->ReadAsync();	// -1 if the readback ring is full, we'll skip this frame's feedback
+			return;
+		}
+}
+
+void	VirtualTexture::Update( int _MaxUploads )
+{
+	m_FrameIndex++;
+
+	// Read the feedback the GPU is done with
+	for ( int TicketIndex=0; TicketIndex < 2; TicketIndex++ )
+	{
+		if ( m_pFeedbackTickets[TicketIndex] < 0 )
+			continue;
+
+		Texture2D*	pStaging = m_pTexFeedback->TryResolve( m_pFeedbackTickets[TicketIndex] );
+		if ( pStaging == NULL )
+			continue;	// Not yet...
+
+		m_pFeedbackTickets[TicketIndex] = -1;
+		ReadFeedback( *pStaging );
+	}
+
+	// Upload the produced pages
+	ProducedPage	pUploads[MAX_QUEUED_PAGES];
+	int				UploadsCount = 0;
+	EnterCriticalSection( &m_Lock );
+	UploadsCount = MIN( _MaxUploads, m_ProducedCount );
+	memcpy( pUploads, m_pProduced, UploadsCount*sizeof(ProducedPage) );
+	m_ProducedCount -= UploadsCount;
+	memmove( m_pProduced, m_pProduced + UploadsCount, m_ProducedCount*sizeof(ProducedPage) );
+	LeaveCriticalSection( &m_Lock );
+
+	for ( int UploadIndex=0; UploadIndex < UploadsCount; UploadIndex++ )
+	{
+		UploadPage( pUploads[UploadIndex] );
+		delete[] pUploads[UploadIndex].pContent;
+	}
+	m_InFlightCount -= UploadsCount;
+
+	if ( m_bPageTableDirty )
+		RebuildPageTable();
+}
+
+void	VirtualTexture::Set() const
+{
+	m_pCB_VirtualTexture->UpdateData();
+	m_pTexPageTable->Set( 33, true );
+	m_pTexAtlas->Set( 34, true );
+}
+
+U16&	VirtualTexture::Residency( int _Key ) const
+{
+	int	MipLevel = _Key >> (2*MAX_PAGES_POT);
+	int	PageX = _Key & ((1 << MAX_PAGES_POT)-1);
+	int	PageY = (_Key >> MAX_PAGES_POT) & ((1 << MAX_PAGES_POT)-1);
+	return m_ppResidency[MipLevel][(PageY << (m_PagesPOT-MipLevel)) + PageX];
+}
+
+void	VirtualTexture::ReadFeedback( Texture2D& _Staging )
+{
+	D3D11_MAPPED_SUBRESOURCE&	Mapped = _Staging.Map( 0, 0 );
+	for ( int Y=0; Y < _Staging.GetHeight(); Y++ )
+	{
+		const PixelFormatRGBA16_UINT*	pScanline = (const PixelFormatRGBA16_UINT*) ((const U8*) Mapped.pData + Y*Mapped.RowPitch);
+		for ( int X=0; X < _Staging.GetWidth(); X++, pScanline++ )
+		{
+			if ( pScanline->A == 0 || pScanline->B >= m_MipsCount )
+				continue;	// Nothing rendered there
+
+			int	MipLevel = pScanline->B;
+			int	MipPagesCount = 1 << (m_PagesPOT - MipLevel);
+			int	PageX = MIN( int(pScanline->R), MipPagesCount-1 );
+			int	PageY = MIN( int(pScanline->G), MipPagesCount-1 );
+
+			// Keep the page that's actually sampled there alive
+			const PixelFormatRGBA16_UINT&	Entry = m_ppPageTable[MipLevel][PageY*MipPagesCount+PageX];
+			m_pSlots[Entry.G*m_SlotsPerSide+Entry.R].LastUsedFrame = m_FrameIndex;
+
+			if ( Entry.B != MipLevel )
+				RequestPage( MipLevel, PageX, PageY );
+		}
+	}
+	_Staging.UnMap( 0, 0 );
+}
+
+// Queues the page after its missing coarser pages so the texture refines progressively
+void	VirtualTexture::RequestPage( int _MipLevel, int _PageX, int _PageY )
+{
+	for ( int MipLevel=m_MipsCount-1; MipLevel >= _MipLevel; MipLevel-- )
+	{
+		int		Shift = MipLevel - _MipLevel;
+		int		Key = MakeKey( MipLevel, _PageX >> Shift, _PageY >> Shift );
+		U16&	Slot = Residency( Key );
+		if ( Slot == PRODUCING_SLOT )
+			return;	// Its finer pages will be requested again once it's there
+		if ( Slot != NO_SLOT )
+		{
+			m_pSlots[Slot].LastUsedFrame = m_FrameIndex;
+			continue;
+		}
+
+		if ( m_InFlightCount >= MAX_QUEUED_PAGES )
+			return;	// We'll ask again with the next feedback
+
+		Slot = PRODUCING_SLOT;
+		m_InFlightCount++;
+
+		EnterCriticalSection( &m_Lock );
+		m_pQueue[(m_QueueReadIndex + m_QueueCount) % MAX_QUEUED_PAGES] = Key;
+		m_QueueCount++;
+		LeaveCriticalSection( &m_Lock );
+		ReleaseSemaphore( m_hQueued, 1, NULL );
+		return;
+	}
+}
+
+void	VirtualTexture::UploadPage( const ProducedPage& _Page )
+{
+	int		SlotIndex = FindFreeSlot();
+	if ( SlotIndex < 0 )
+	{	// Everything is in use this frame, drop the page and let the feedback ask for it again
+		Residency( _Page.Key ) = NO_SLOT;
+		return;
+	}
+
+	Slot&	S = m_pSlots[SlotIndex];
+	if ( S.Key >= 0 )
+		Residency( S.Key ) = NO_SLOT;	// Evict
+
+	S.Key = _Page.Key;
+	S.LastUsedFrame = m_FrameIndex;
+	Residency( _Page.Key ) = U16(SlotIndex);
+
+	int	SliceSize = SLOT_SIZE*SLOT_SIZE*m_Format.Size();
+	int	SlotX = (SlotIndex % m_SlotsPerSide) * SLOT_SIZE;
+	int	SlotY = (SlotIndex / m_SlotsPerSide) * SLOT_SIZE;
+	for ( int SliceIndex=0; SliceIndex < m_ArraySize; SliceIndex++ )
+	{
+		m_pTexUpload->UpdateSubResource( 0, SliceIndex, _Page.pContent + SliceIndex*SliceSize, SLOT_SIZE*m_Format.Size(), SliceSize );
+		m_pTexAtlas->CopyRegionFrom( *m_pTexUpload, SliceIndex, 0, 0, SLOT_SIZE, SLOT_SIZE, SlotX, SlotY );
+	}
+
+	m_bPageTableDirty = true;
+}
+
+// Returns a free slot or the least recently used one that wasn't used this frame
+int		VirtualTexture::FindFreeSlot() const
+{
+	int	BestSlotIndex = -1;
+	U32	OldestFrame = m_FrameIndex;
+	for ( int SlotIndex=0; SlotIndex < m_SlotsPerSide*m_SlotsPerSide; SlotIndex++ )
+	{
+		const Slot&	S = m_pSlots[SlotIndex];
+		if ( S.Key < 0 )
+			return SlotIndex;
+		if ( !S.bLocked && S.LastUsedFrame < OldestFrame )
+		{
+			OldestFrame = S.LastUsedFrame;
+			BestSlotIndex = SlotIndex;
+		}
+	}
+
+	return BestSlotIndex;
+}
+
+// Each entry points to its own page if it's resident, otherwise to its parent's entry
+void	VirtualTexture::RebuildPageTable()
+{
+	for ( int MipLevel=m_MipsCount-1; MipLevel >= 0; MipLevel-- )
+	{
+		int						MipPagesCount = 1 << (m_PagesPOT - MipLevel);
+		const U16*				pResidency = m_ppResidency[MipLevel];
+		PixelFormatRGBA16_UINT*	pEntry = m_ppPageTable[MipLevel];
+		for ( int PageY=0; PageY < MipPagesCount; PageY++ )
+			for ( int PageX=0; PageX < MipPagesCount; PageX++, pEntry++ )
+			{
+				U16	Slot = *pResidency++;
+				if ( Slot < PRODUCING_SLOT )
+				{
+					pEntry->R = U16(Slot % m_SlotsPerSide);
+					pEntry->G = U16(Slot / m_SlotsPerSide);
+					pEntry->B = U16(MipLevel);
+					pEntry->A = 1;
+				}
+				else
+				{
+					ASSERT( MipLevel < m_MipsCount-1, "The coarsest page must always be resident!" );
+					*pEntry = m_ppPageTable[MipLevel+1][(PageY >> 1)*(MipPagesCount >> 1) + (PageX >> 1)];
+				}
+			}
+
+		m_pTexPageTable->UpdateSubResource( MipLevel, 0, m_ppPageTable[MipLevel], MipPagesCount*sizeof(PixelFormatRGBA16_UINT), MipPagesCount*MipPagesCount*sizeof(PixelFormatRGBA16_UINT) );
+	}
+
+	m_bPageTableDirty = false;
+}
+
+U8*		VirtualTexture::ProducePage( int _Key ) const
+{
+	int	MipLevel = _Key >> (2*MAX_PAGES_POT);
+	int	PageX = _Key & ((1 << MAX_PAGES_POT)-1);
+	int	PageY = (_Key >> MAX_PAGES_POT) & ((1 << MAX_PAGES_POT)-1);
+
+	float	PageUV = 1.0f / (1 << (m_PagesPOT - MipLevel));
+	float	BorderUV = PageUV * PAGE_BORDER / PAGE_SIZE;
+	float2	UVMin( PageX * PageUV - BorderUV, PageY * PageUV - BorderUV );
+	float2	UVMax( (PageX+1) * PageUV + BorderUV, (PageY+1) * PageUV + BorderUV );
+
+	TextureBuilder	Page( SLOT_SIZE, SLOT_SIZE );
+	m_Delegate( MipLevel, PageX, PageY, UVMin, UVMax, Page, m_pData );
+
+	int		ArraySize;
+	void**	ppContent = Page.Convert( m_Format, m_ConversionParams, ArraySize );
+	int		PageMipsCount = Texture2D::ComputeMipLevelsCount( SLOT_SIZE, SLOT_SIZE, 0 );
+	int		SliceSize = SLOT_SIZE*SLOT_SIZE*m_Format.Size();
+	U8*		pContent = new U8[ArraySize*SliceSize];
+	for ( int SliceIndex=0; SliceIndex < ArraySize; SliceIndex++ )
+		memcpy( pContent + SliceIndex*SliceSize, ppContent[SliceIndex*PageMipsCount], SliceSize );
+
+	return pContent;
+}
+
+DWORD WINAPI	VirtualTexture::ProducerThread( LPVOID _pParam )
+{
+	VirtualTexture&	Owner = *((VirtualTexture*) _pParam);
+	while ( true )
+	{
+		WaitForSingleObject( Owner.m_hQueued, INFINITE );
+		if ( Owner.m_bQuit )
+			break;
+
+		EnterCriticalSection( &Owner.m_Lock );
+		int	Key = Owner.m_pQueue[Owner.m_QueueReadIndex];
+		Owner.m_QueueReadIndex = (Owner.m_QueueReadIndex + 1) % MAX_QUEUED_PAGES;
+		Owner.m_QueueCount--;
+		LeaveCriticalSection( &Owner.m_Lock );
+
+		ProducedPage	Page;
+		Page.Key = Key;
+		Page.pContent = Owner.ProducePage( Key );
+
+		EnterCriticalSection( &Owner.m_Lock );
+		Owner.m_pProduced[Owner.m_ProducedCount++] = Page;	// Can't overflow since in-flight pages are bounded by MAX_QUEUED_PAGES
+		LeaveCriticalSection( &Owner.m_Lock );
+	}
+
+	return 0;
+}
@@ -0,0 +1,157 @@
+//////////////////////////////////////////////////////////////////////////
+// Virtual Texture
+// A procedural texture of up to 2^MAX_PAGES_POT x PAGE_SIZE texels on a side (i.e. way beyond Texture2D::MAX_TEXTURE_SIZE) of
+//	which only the pages actually seen are built and kept in a fixed-size atlas of physical pages.
+//
+// _ The scene is first rendered at a low resolution into the feedback target with a shader returning VTFeedback( UV ), the
+//	feedback is read back asynchronously and tells which pages (mip, X, Y) are needed (cf. Inc/VirtualTexture.hlsl)
+// _ The missing pages (and their missing coarser pages first) are queued to producer threads that build them with a TextureBuilder
+//	through the page delegate and convert them to the atlas format
+// _ Update() uploads the produced pages into the least recently used slots of the atlas and rebuilds the page table, where each
+//	entry points to the slot of the most detailed resident page covering it. The coarsest page is always resident.
+//
+// Usage:
+//	VirtualTexture	VT( gs_Device, 10, 30, FillPage, &Data, PixelFormatRGBA8::DESCRIPTOR, TextureBuilder::CONV_RGBA, 1280, 720 );
+//	(...)
+//	// Every frame
+//	gs_Device.ClearRenderTarget( VT.GetFeedbackTarget(), float4::Zero );
+//	(...)						// Render the scene into VT.GetFeedbackTarget() with a shader returning VTFeedback( UV )
+//	VT.SubmitFeedback();
+//	VT.Update();
+//	VT.Set();					// Page table, atlas & constant buffer for the scene shader sampling with VTSample()
+//
+// NOTE: The page delegate runs on the producer threads: it must not use the device nor the global random generator and must only
+//	read data that doesn't change (cf. TextureBuilder::FillDelegate). Data-parallel kernels it calls run serially on its thread.
+// The atlas must have an uncompressed format since it's written by copies from the GPU.
+//
+#pragma once
+
+class VirtualTexture
+{
+public:		// CONSTANTS
+
+	static const int	PAGE_SIZE = 128;			// !!IMPORTANT ==> Must correspond to VT_PAGE_SIZE in Inc/VirtualTexture.hlsl!!
+	static const int	PAGE_BORDER = 4;			// !!IMPORTANT ==> Must correspond to VT_PAGE_BORDER in Inc/VirtualTexture.hlsl!!
+	static const int	SLOT_SIZE = PAGE_SIZE + 2*PAGE_BORDER;	// Size of a page in the atlas, with its borders for filtering
+	static const int	MAX_PAGES_POT = 10;			// 1024 pages on a side at mip 0, i.e. 131072 texels
+	static const int	MAX_PRODUCERS = 4;
+	static const int	MAX_QUEUED_PAGES = 256;		// Pages waiting for or being built by the producers
+
+	static const U16	NO_SLOT = 0xFFFF;			// Page is not resident
+	static const U16	PRODUCING_SLOT = 0xFFFE;	// Page is queued or being built
+
+public:		// NESTED TYPES
+
+	// Builds a page of the virtual texture, the builder is SLOT_SIZE x SLOT_SIZE and covers [_UVMin,_UVMax] of the virtual texture,
+	//	borders included (so these UVs can be slightly outside [0,1]: procedural textures are expected to wrap)
+	typedef void	(*PageDelegate)( int _MipLevel, int _PageX, int _PageY, const float2& _UVMin, const float2& _UVMax, TextureBuilder& _Page, void* _pData );
+
+	struct	CBVirtualTexture
+	{
+		float	PagesCount;			// Pages on a side at mip 0
+		float	MaxMip;				// Mip of the single coarsest page
+		float	FeedbackMipBias;	// Compensates the lower resolution of the feedback target
+		float	__PAD;
+		float2	AtlasInvSize;
+		float2	__PAD2;
+	};
+
+private:
+
+	struct	Slot
+	{
+		int		Key;				// Page occupying the slot (-1 if free)
+		U32		LastUsedFrame;
+		bool	bLocked;			// Never evicted (the coarsest page)
+	};
+
+	struct	ProducedPage
+	{
+		int		Key;
+		U8*		pContent;			// ArraySize slices of SLOT_SIZE x SLOT_SIZE pixels
+	};
+
+private:	// FIELDS
+
+	Device&				m_Device;
+
+	PageDelegate		m_Delegate;
+	void*				m_pData;
+	const IPixelFormatDescriptor&				m_Format;
+	const TextureBuilder::ConversionParams&		m_ConversionParams;
+	int					m_ArraySize;		// Given by the conversion params
+
+	int					m_PagesPOT;
+	int					m_MipsCount;
+	U16**				m_ppResidency;		// Slot of each page of each mip (or NO_SLOT/PRODUCING_SLOT)
+	PixelFormatRGBA16_UINT**	m_ppPageTable;	// CPU copy of the page table: X,Y=Slot, Z=Mip of the resident page, W=1
+	bool				m_bPageTableDirty;
+
+	int					m_SlotsPerSide;
+	Slot*				m_pSlots;
+	U32					m_FrameIndex;
+
+	Texture2D*			m_pTexPageTable;
+	Texture2D*			m_pTexAtlas;
+	Texture2D*			m_pTexUpload;		// A single slot uploaded then copied into the atlas
+	Texture2D*			m_pTexFeedback;
+	int					m_pFeedbackTickets[2];	// Readbacks in flight (-1 if none)
+	CB<CBVirtualTexture>*	m_pCB_VirtualTexture;
+
+	// Producers
+	HANDLE				m_phProducers[MAX_PRODUCERS];
+	int					m_ProducersCount;
+	CRITICAL_SECTION	m_Lock;				// Protects the queue & the produced pages
+	HANDLE				m_hQueued;			// Semaphore counting the queued pages
+	volatile bool		m_bQuit;
+
+	int					m_pQueue[MAX_QUEUED_PAGES];	// Ring of page keys
+	int					m_QueueReadIndex;
+	int					m_QueueCount;
+	int					m_InFlightCount;	// Queued + being built + produced but not uploaded
+
+	ProducedPage		m_pProduced[MAX_QUEUED_PAGES];
+	int					m_ProducedCount;
+
+public:		// PROPERTIES
+
+	int			GetMipsCount() const			{ return m_MipsCount; }
+	int			GetPagesCount() const			{ return 1 << m_PagesPOT; }
+	Texture2D&	GetFeedbackTarget()				{ return *m_pTexFeedback; }
+	Texture2D&	GetPageTable()					{ return *m_pTexPageTable; }
+	Texture2D&	GetAtlas()						{ return *m_pTexAtlas; }
+	int			GetInFlightPagesCount() const	{ return m_InFlightCount; }
+
+public:		// METHODS
+
+	// _PagesPOT, the virtual texture is 2^_PagesPOT pages on a side at mip 0
+	// _SlotsPerSide, the atlas holds _SlotsPerSide x _SlotsPerSide pages
+	// _ScreenWidth, _ScreenHeight, _FeedbackDownsampling, the feedback target is the screen size divided by the downsampling factor
+	// NOTE: The coarsest page is built by the constructor
+	VirtualTexture( Device& _Device, int _PagesPOT, int _SlotsPerSide, PageDelegate _Delegate, void* _pData, const IPixelFormatDescriptor& _Format, const TextureBuilder::ConversionParams& _ConversionParams, int _ScreenWidth, int _ScreenHeight, int _FeedbackDownsampling=8, int _ProducersCount=-1 );
+	~VirtualTexture();
+
+	// Queues the readback of the feedback target once the scene was rendered into it
+	void		SubmitFeedback();
+
+	// Reads the feedback that's available, queues the missing pages and uploads at most _MaxUploads produced pages (render thread only)
+	void		Update( int _MaxUploads=8 );
+
+	// Sets the page table in t33, the atlas in t34 and the constant buffer in b12 (cf. Inc/VirtualTexture.hlsl)
+	void		Set() const;
+
+private:
+
+	static int	MakeKey( int _MipLevel, int _PageX, int _PageY )	{ return (_MipLevel << (2*MAX_PAGES_POT)) | (_PageY << MAX_PAGES_POT) | _PageX; }
+	U16&		Residency( int _Key ) const;
+
+	void		ReadFeedback( Texture2D& _Staging );
+	void		RequestPage( int _MipLevel, int _PageX, int _PageY );
+	void		UploadPage( const ProducedPage& _Page );
+	int			FindFreeSlot() const;
+	void		RebuildPageTable();
+
+	U8*			ProducePage( int _Key ) const;
+
+	static DWORD WINAPI	ProducerThread( LPVOID _pParam );
+};
@@ -0,0 +1,373 @@
+#include "../GodComplex.h"
+
+#ifdef NUAJ_MATH_SSE
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	// Dispatches items to the worker threads, each thread grabs the next item until there are none left
+	class	ParallelTask : public IJob
+	{
+		int				m_ItemsCount;
+		volatile LONG	m_NextItemIndex;
+
+	public:
+
+		ParallelTask() : m_ItemsCount( 0 ), m_NextItemIndex( 0 )	{}
+
+		void			Execute( int _ItemsCount )
+		{
+			m_ItemsCount = _ItemsCount;
+			m_NextItemIndex = 0;
+
+			JobQueue&	Jobs = gs_Device.Jobs();
+			int			HelpersCount = MIN( Jobs.GetHelpersCount(), m_ItemsCount-1 );
+			for ( int HelperIndex=0; HelperIndex < HelpersCount; HelperIndex++ )
+				Jobs.Push( *this );
+			Run();
+			if ( HelpersCount > 0 )
+				Jobs.Wait();
+		}
+
+		virtual void	Run()
+		{
+			for ( ;; )
+			{
+				int	ItemIndex = InterlockedIncrement( &m_NextItemIndex ) - 1;
+				if ( ItemIndex >= m_ItemsCount )
+					return;
+				Process( ItemIndex );
+			}
+		}
+
+		virtual void	Process( int _ItemIndex ) = 0;
+	};
+
+	// Fills a slab of slices of the mip 0
+	class	FillTask : public ParallelTask
+	{
+	public:
+		VolumeBuilder&						m_Owner;
+		VolumeBuilder::FillSlabDelegate		m_pFiller;
+		void*								m_pData;
+		int									m_SlabSize;
+
+		FillTask( VolumeBuilder& _Owner, VolumeBuilder::FillSlabDelegate _Filler, void* _pData, int _SlabSize ) : m_Owner( _Owner ), m_pFiller( _Filler ), m_pData( _pData ), m_SlabSize( _SlabSize )	{}
+
+		virtual void	Process( int _ItemIndex )
+		{
+			int	Z0 = m_SlabSize * _ItemIndex;
+			int	Z1 = MIN( Z0 + m_SlabSize, m_Owner.GetDepth() );
+			(*m_pFiller)( m_Owner, Z0, Z1, m_pData );
+		}
+	};
+
+	// Averages 2x2x2 voxels of the source mip into a slice of the target mip
+	class	MipTask : public ParallelTask
+	{
+	public:
+		int				m_ChannelsCount;
+		const float*	m_pSource;
+		int				m_SourceWidth, m_SourceHeight, m_SourceDepth;
+		float*			m_pTarget;
+		int				m_Width, m_Height;
+
+		virtual void	Process( int _Z )
+		{
+			int	SourceRowSize = m_ChannelsCount * m_SourceWidth;
+			int	SourceSliceSize = SourceRowSize * m_SourceHeight;
+
+			// Odd or unit sizes read the last voxel twice
+			const float*	pSlice0 = m_pSource + SourceSliceSize * MIN( 2*_Z, m_SourceDepth-1 );
+			const float*	pSlice1 = m_pSource + SourceSliceSize * MIN( 2*_Z+1, m_SourceDepth-1 );
+			float*			pTarget = m_pTarget + m_ChannelsCount * m_Width * m_Height * _Z;
+			for ( int Y=0; Y < m_Height; Y++ )
+			{
+				int				Y0 = SourceRowSize * MIN( 2*Y, m_SourceHeight-1 );
+				int				Y1 = SourceRowSize * MIN( 2*Y+1, m_SourceHeight-1 );
+				const float*	pScanline00 = pSlice0 + Y0;
+				const float*	pScanline01 = pSlice0 + Y1;
+				const float*	pScanline10 = pSlice1 + Y0;
+				const float*	pScanline11 = pSlice1 + Y1;
+				for ( int X=0; X < m_Width; X++ )
+				{
+					int	X0 = m_ChannelsCount * MIN( 2*X, m_SourceWidth-1 );
+					int	X1 = m_ChannelsCount * MIN( 2*X+1, m_SourceWidth-1 );
+					for ( int ChannelIndex=0; ChannelIndex < m_ChannelsCount; ChannelIndex++ )
+					{
+						float	V  = pScanline00[X0+ChannelIndex] + pScanline00[X1+ChannelIndex];	// From slice 0, current line
+								V += pScanline01[X0+ChannelIndex] + pScanline01[X1+ChannelIndex];	// From slice 0, next line
+								V += pScanline10[X0+ChannelIndex] + pScanline10[X1+ChannelIndex];	// From slice 1, current line
+								V += pScanline11[X0+ChannelIndex] + pScanline11[X1+ChannelIndex];	// From slice 1, next line
+						*pTarget++ = 0.125f * V;
+					}
+				}
+			}
+		}
+	};
+
+	// Converts floats to halves with the same truncation as half( float )
+	void	ConvertToHalf( const float* _pSource, U16* _pTarget, int _Count )
+	{
+		int	Index = 0;
+#ifdef NUAJ_MATH_SSE
+		const __m128i	SIGN_MASK = _mm_set1_epi32( 0x8000 );
+		const __m128i	EXPONENT_MASK = _mm_set1_epi32( 0xFF );
+		const __m128i	MANTISSA_MASK = _mm_set1_epi32( 0x007FFFFF );
+		const __m128i	NAN_MANTISSA_MASK = _mm_set1_epi32( 0x03FF );
+		const __m128i	MAX_EXPONENT = _mm_set1_epi32( 0x7C00 );
+		const __m128i	EXPONENT_BIAS = _mm_set1_epi32( 127-15 );
+		const __m128i	INFINITE = _mm_set1_epi32( 255 );
+		const __m128i	OVERFLOW_THRESHOLD = _mm_set1_epi32( 127+15 );	// Exponent > 15
+		const __m128i	UNDERFLOW_THRESHOLD = _mm_set1_epi32( 127-15 );	// Exponent > -15
+
+		for ( ; Index+4 <= _Count; Index+=4 )
+		{
+			__m128i	F32 = _mm_castps_si128( _mm_loadu_ps( _pSource + Index ) );
+			__m128i	Sign = _mm_and_si128( _mm_srli_epi32( F32, 16 ), SIGN_MASK );
+			__m128i	Exponent = _mm_and_si128( _mm_srli_epi32( F32, 23 ), EXPONENT_MASK );
+			__m128i	Mantissa = _mm_and_si128( F32, MANTISSA_MASK );
+
+			__m128i	bInfinite = _mm_cmpeq_epi32( Exponent, INFINITE );
+			__m128i	bOverflow = _mm_cmpgt_epi32( Exponent, OVERFLOW_THRESHOLD );	// Includes infinite & NaN
+			__m128i	bRepresentable = _mm_andnot_si128( bOverflow, _mm_cmpgt_epi32( Exponent, UNDERFLOW_THRESHOLD ) );
+
+			__m128i	Representable = _mm_or_si128( _mm_slli_epi32( _mm_sub_epi32( Exponent, EXPONENT_BIAS ), 10 ), _mm_srli_epi32( Mantissa, 13 ) );
+			__m128i	Overflow = _mm_or_si128( MAX_EXPONENT, _mm_and_si128( bInfinite, _mm_and_si128( Mantissa, NAN_MANTISSA_MASK ) ) );
+
+			__m128i	Result = _mm_or_si128( Sign, _mm_or_si128( _mm_and_si128( bRepresentable, Representable ), _mm_and_si128( bOverflow, Overflow ) ) );
+
+			// Sign-extend the 16 bits so the saturating pack keeps them intact
+			Result = _mm_srai_epi32( _mm_slli_epi32( Result, 16 ), 16 );
+			_mm_storel_epi64( (__m128i*) (_pTarget + Index), _mm_packs_epi32( Result, Result ) );
+		}
+#endif
+		for ( ; Index < _Count; Index++ )
+			_pTarget[Index] = half( _pSource[Index] ).raw;
+	}
+
+	// Converts a slice of a mip to the texture's format
+	class	ConvertTask : public ParallelTask
+	{
+	public:
+		const IPixelFormatDescriptor*	m_pFormat;
+		int				m_ChannelsCount;
+		bool			m_bHalf;		// True if the channels map directly to the half components of the format
+		const float*	m_pSource;
+		U8*				m_pTarget;
+		int				m_SliceSize;	// Voxels count in a slice
+
+		virtual void	Process( int _Z )
+		{
+			const float*	pSource = m_pSource + m_ChannelsCount * m_SliceSize * _Z;
+			U8*				pTarget = m_pTarget + m_pFormat->Size() * m_SliceSize * _Z;
+			if ( m_bHalf )
+			{
+				ConvertToHalf( pSource, (U16*) pTarget, m_ChannelsCount * m_SliceSize );
+				return;
+			}
+
+			for ( int VoxelIndex=0; VoxelIndex < m_SliceSize; VoxelIndex++, pSource+=m_ChannelsCount, pTarget+=m_pFormat->Size() )
+			{
+				float4	Value( 0, 0, 0, 0 );
+				for ( int ChannelIndex=0; ChannelIndex < MIN( 4, m_ChannelsCount ); ChannelIndex++ )
+					(&Value.x)[ChannelIndex] = pSource[ChannelIndex];
+				m_pFormat->Write( pTarget, Value );
+			}
+		}
+	};
+
+	int		GetHalfComponentsCount( const IPixelFormatDescriptor& _Format )
+	{
+		switch ( _Format.DirectXFormat() )
+		{
+		case DXGI_FORMAT_R16_FLOAT:				return 1;
+		case DXGI_FORMAT_R16G16_FLOAT:			return 2;
+		case DXGI_FORMAT_R16G16B16A16_FLOAT:	return 4;
+		}
+		return 0;
+	}
+}
+
+VolumeBuilder::VolumeBuilder( int _Width, int _Height, int _Depth, int _ChannelsCount, int _MipLevelsCount )
+	: m_Width( _Width )
+	, m_Height( _Height )
+	, m_Depth( _Depth )
+	, m_ChannelsCount( _ChannelsCount )
+{
+	m_MipLevelsCount = Texture3D::ComputeMipLevelsCount( _Width, _Height, _Depth, _MipLevelsCount );
+	ASSERT( m_MipLevelsCount <= MAX_MIP_LEVELS, "Too many mip levels!" );
+
+	int	Width = m_Width, Height = m_Height, Depth = m_Depth;
+	for ( int MipLevel=0; MipLevel < m_MipLevelsCount; MipLevel++ )
+	{
+		m_ppMips[MipLevel] = new float[m_ChannelsCount*Width*Height*Depth];
+		Texture3D::NextMipSize( Width, Height, Depth );
+	}
+}
+
+VolumeBuilder::~VolumeBuilder()
+{
+	for ( int MipLevel=0; MipLevel < m_MipLevelsCount; MipLevel++ )
+		delete[] m_ppMips[MipLevel];
+}
+
+void	VolumeBuilder::Fill( FillSlabDelegate _Filler, void* _pData )
+{
+	// Split the volume into about 4 slabs per thread so threads that finish early can grab another one
+	int	SlabsCount = 4 * (1 + gs_Device.Jobs().GetWorkersCount());
+	int	SlabSize = MAX( 1, (m_Depth + SlabsCount-1) / SlabsCount );
+		SlabsCount = (m_Depth + SlabSize-1) / SlabSize;
+
+	FillTask	Task( *this, _Filler, _pData, SlabSize );
+	Task.Execute( SlabsCount );
+}
+
+void	VolumeBuilder::GenerateMips()
+{
+	MipTask	Task;
+	Task.m_ChannelsCount = m_ChannelsCount;
+	Task.m_SourceWidth = m_Width;
+	Task.m_SourceHeight = m_Height;
+	Task.m_SourceDepth = m_Depth;
+	for ( int MipLevel=1; MipLevel < m_MipLevelsCount; MipLevel++ )
+	{
+		int	Width = Task.m_SourceWidth, Height = Task.m_SourceHeight, Depth = Task.m_SourceDepth;
+		Texture3D::NextMipSize( Width, Height, Depth );
+
+		Task.m_pSource = m_ppMips[MipLevel-1];
+		Task.m_pTarget = m_ppMips[MipLevel];
+		Task.m_Width = Width;
+		Task.m_Height = Height;
+		Task.Execute( Depth );
+
+		Task.m_SourceWidth = Width;
+		Task.m_SourceHeight = Height;
+		Task.m_SourceDepth = Depth;
+	}
+}
+
+Texture3D*	VolumeBuilder::CreateTexture( const IPixelFormatDescriptor& _Format, const char* _pCacheFileName ) const
+{
+	U8*		ppContent[MAX_MIP_LEVELS];
+
+	ConvertTask	Task;
+	Task.m_pFormat = &_Format;
+	Task.m_ChannelsCount = m_ChannelsCount;
+	Task.m_bHalf = GetHalfComponentsCount( _Format ) == m_ChannelsCount;
+
+	int	Width = m_Width, Height = m_Height, Depth = m_Depth;
+	for ( int MipLevel=0; MipLevel < m_MipLevelsCount; MipLevel++ )
+	{
+		ppContent[MipLevel] = new U8[_Format.Size()*Width*Height*Depth];
+
+		Task.m_pSource = m_ppMips[MipLevel];
+		Task.m_pTarget = ppContent[MipLevel];
+		Task.m_SliceSize = Width*Height;
+		Task.Execute( Depth );
+
+		Texture3D::NextMipSize( Width, Height, Depth );
+	}
+
+	Texture3D*	pResult = new Texture3D( gs_Device, m_Width, m_Height, m_Depth, _Format, m_MipLevelsCount, (void**) ppContent );
+
+	if ( _pCacheFileName != NULL )
+		SaveCachedTexture( _pCacheFileName, m_Width, m_Height, m_Depth, _Format, m_MipLevelsCount, (void**) ppContent );
+
+	for ( int MipLevel=0; MipLevel < m_MipLevelsCount; MipLevel++ )
+		delete[] ppContent[MipLevel];
+
+	return pResult;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// POM caching (cf. TextureFilePOM for the file layout)
+void	VolumeBuilder::SaveCachedTexture( const char* _pFileName, int _Width, int _Height, int _Depth, const IPixelFormatDescriptor& _Format, int _MipLevelsCount, const void* const* _ppMips )
+{
+	FILE*	pFile = NULL;
+	fopen_s( &pFile, _pFileName, "wb" );
+	ASSERT( pFile != NULL, "Can't create cache file!" );
+	if ( pFile == NULL )
+		return;
+
+	U8	Type = TextureFilePOM::TEX_3D;
+	U8	Format = U32(_Format.DirectXFormat()) & 0xFF;
+	fwrite( &Type, sizeof(U8), 1, pFile );
+	fwrite( &Format, sizeof(U8), 1, pFile );
+
+	U32	pDimensions[4] = { _Width, _Height, _Depth, _MipLevelsCount };
+	fwrite( pDimensions, sizeof(U32), 4, pFile );
+
+	for ( int MipLevel=0; MipLevel < _MipLevelsCount; MipLevel++ )
+	{
+		U32	RowPitch = _Width * _Format.Size();
+		U32	DepthPitch = _Height * RowPitch;
+		fwrite( &RowPitch, sizeof(U32), 1, pFile );
+		fwrite( &DepthPitch, sizeof(U32), 1, pFile );
+		fwrite( _ppMips[MipLevel], _Depth * DepthPitch, 1, pFile );
+
+		Texture3D::NextMipSize( _Width, _Height, _Depth );
+	}
+
+	fclose( pFile );
+}
+
+Texture3D*	VolumeBuilder::LoadCachedTexture( const char* _pFileName, int _Width, int _Height, int _Depth, const IPixelFormatDescriptor& _Format, int _MipLevelsCount )
+{
+	HANDLE	hFile = CreateFileA( _pFileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+	if ( hFile == INVALID_HANDLE_VALUE )
+		return NULL;
+
+	Texture3D*	pResult = NULL;
+	DWORD		FileSize = GetFileSize( hFile, NULL );
+	HANDLE		hMapping = FileSize != INVALID_FILE_SIZE ? CreateFileMappingA( hFile, NULL, PAGE_READONLY, 0, 0, NULL ) : NULL;
+	const U8*	pView = hMapping != NULL ? (const U8*) MapViewOfFile( hMapping, FILE_MAP_READ, 0, 0, 0 ) : NULL;
+	if ( pView != NULL )
+	{
+		// Check the header matches what we expect
+		_MipLevelsCount = Texture3D::ComputeMipLevelsCount( _Width, _Height, _Depth, _MipLevelsCount );
+
+		const U32*	pDimensions = (const U32*) (pView + 2);
+		bool	bValid = FileSize >= 2 + 4*sizeof(U32)
+					  && pView[0] == TextureFilePOM::TEX_3D
+					  && pView[1] == (U32(_Format.DirectXFormat()) & 0xFF)
+					  && pDimensions[0] == U32(_Width) && pDimensions[1] == U32(_Height) && pDimensions[2] == U32(_Depth)
+					  && pDimensions[3] == U32(_MipLevelsCount);
+
+		// Point each mip straight into the view
+		const void*						ppContent[MAX_MIP_LEVELS];
+		TextureFilePOM::MipDescriptor	pMipDescriptors[MAX_MIP_LEVELS];
+
+		DWORD	Offset = 2 + 4*sizeof(U32);
+		int		Depth = _Depth;
+		for ( int MipLevel=0; bValid && MipLevel < _MipLevelsCount; MipLevel++ )
+		{
+			bValid = Offset + 2*sizeof(U32) <= FileSize;
+			if ( !bValid )
+				break;
+
+			const U32*	pPitches = (const U32*) (pView + Offset);
+			pMipDescriptors[MipLevel].RowPitch = pPitches[0];
+			pMipDescriptors[MipLevel].DepthPitch = pPitches[1];
+			Offset += 2*sizeof(U32);
+
+			ppContent[MipLevel] = pView + Offset;
+			Offset += Depth * pPitches[1];
+			bValid = Offset <= FileSize;
+
+			Depth = MAX( 1, Depth >> 1 );
+		}
+
+		if ( bValid )
+			pResult = new Texture3D( gs_Device, _Width, _Height, _Depth, _Format, _MipLevelsCount, ppContent, pMipDescriptors );
+
+		UnmapViewOfFile( pView );	// The immutable texture has its own copy
+	}
+
+	if ( hMapping != NULL )
+		CloseHandle( hMapping );
+	CloseHandle( hFile );
+
+	return pResult;
+}
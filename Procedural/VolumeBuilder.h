@@ -0,0 +1,68 @@
+//////////////////////////////////////////////////////////////////////////
+// Builds 3D textures on the CPU
+// The volume stores interleaved float channels, X varying first then Y then Z:
+//	_ Fill() calls the delegate for slabs of Z slices on the worker threads
+//	_ GenerateMips() builds the mips with a 2x2x2 box filter, also in parallel
+//	_ CreateTexture() converts the mips to the texture's format (16-bits float formats are converted 4 values at a time with SSE)
+//
+// The converted mips can be cached in a POM file that LoadCachedTexture() maps straight into a new texture at next launch
+//	instead of generating the volume again.
+//
+#pragma once
+
+class	VolumeBuilder
+{
+protected:	// CONSTANTS
+
+	static const int	MAX_MIP_LEVELS = 14;
+
+public:		// NESTED TYPES
+
+	// Fills the slices [_Z0,_Z1[ of the mip 0
+	// WARNING: The delegate is called concurrently by several threads on different slabs so it must only write to its own slices!
+	typedef void	(*FillSlabDelegate)( VolumeBuilder& _Builder, int _Z0, int _Z1, void* _pData );
+
+protected:	// FIELDS
+
+	int			m_Width;
+	int			m_Height;
+	int			m_Depth;
+	int			m_ChannelsCount;
+	int			m_MipLevelsCount;
+	float*		m_ppMips[MAX_MIP_LEVELS];
+
+public:		// PROPERTIES
+
+	int			GetWidth() const				{ return m_Width; }
+	int			GetHeight() const				{ return m_Height; }
+	int			GetDepth() const				{ return m_Depth; }
+	int			GetChannelsCount() const		{ return m_ChannelsCount; }
+	int			GetMipLevelsCount() const		{ return m_MipLevelsCount; }
+
+	float*		GetMip( int _MipLevel ) const	{ return m_ppMips[_MipLevel]; }
+	float*		GetSlice( int _Z ) const		{ return m_ppMips[0] + m_ChannelsCount * m_Width * m_Height * _Z; }	// Slice of the mip 0
+
+public:		// METHODS
+
+	// _MipLevelsCount, 0 for the entire mip chain
+	VolumeBuilder( int _Width, int _Height, int _Depth, int _ChannelsCount, int _MipLevelsCount=0 );
+	~VolumeBuilder();
+
+	// Fills the mip 0 in parallel
+	void		Fill( FillSlabDelegate _Filler, void* _pData );
+
+	// Builds the mips from the mip 0 (odd sizes clamp the last voxel instead of reading past the border)
+	void		GenerateMips();
+
+	// Converts the mips into a new immutable texture
+	// Channels are written to the X, Y, Z & W components of the pixels in that order, missing channels are 0
+	// If _pCacheFileName is not NULL, the converted mips are also saved in that POM file
+	Texture3D*	CreateTexture( const IPixelFormatDescriptor& _Format, const char* _pCacheFileName=NULL ) const;
+
+	// Saves mips of the given format as a POM file (pitches are tightly packed)
+	static void	SaveCachedTexture( const char* _pFileName, int _Width, int _Height, int _Depth, const IPixelFormatDescriptor& _Format, int _MipLevelsCount, const void* const* _ppMips );
+
+	// Maps a POM file and creates an immutable texture directly from its content
+	// Returns NULL if the file doesn't exist or doesn't match the expected size/format/mips (you should then build the volume again)
+	static Texture3D*	LoadCachedTexture( const char* _pFileName, int _Width, int _Height, int _Depth, const IPixelFormatDescriptor& _Format, int _MipLevelsCount=0 );
+};
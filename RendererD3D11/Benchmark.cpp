@@ -0,0 +1,146 @@
+#include "Benchmark.h"
+#include "Components/Texture2D.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+Benchmark::Benchmark( Device& _Device, const char* _pName, int _WarmUpFramesCount, int _MeasuredFramesCount )
+	: m_Device( _Device )
+	, m_pName( _pName )
+	, m_WarmUpFramesCount( _WarmUpFramesCount )
+	, m_MeasuredFramesCount( CLAMP( _MeasuredFramesCount, 1, MAX_FRAMES ) )
+	, m_FramesCount( 0 )
+	, m_LastFrameIndex( _Device.GetLastFrameStats().FrameIndex )
+{
+	ASSERT( _MeasuredFramesCount > 0 && _MeasuredFramesCount <= MAX_FRAMES, "Invalid amount of measured frames!" );
+	m_pCPUDurations = new float[m_MeasuredFramesCount];
+	m_pGPUDurations = new float[m_MeasuredFramesCount];
+}
+
+Benchmark::~Benchmark()
+{
+	delete[] m_pGPUDurations;
+	delete[] m_pCPUDurations;
+}
+
+bool	Benchmark::Update()
+{
+	if ( IsComplete() )
+		return false;
+
+	const Device::FrameStats&	Stats = m_Device.GetLastFrameStats();
+	if ( Stats.FrameIndex == m_LastFrameIndex )
+		return true;	// Nothing was presented since the last update
+	m_LastFrameIndex = Stats.FrameIndex;
+
+	if ( !IsWarmingUp() )
+	{
+		int	MeasuredFrameIndex = m_FramesCount - m_WarmUpFramesCount;
+		m_pCPUDurations[MeasuredFrameIndex] = Stats.CPUDuration;
+		m_pGPUDurations[MeasuredFrameIndex] = Stats.GPUDuration;
+	}
+	m_FramesCount++;
+
+	return !IsComplete();
+}
+
+static int	CompareDurations( const void* _pA, const void* _pB )
+{
+	float	A = *((const float*) _pA);
+	float	B = *((const float*) _pB);
+	return A < B ? -1 : (A > B ? +1 : 0);
+}
+
+Benchmark::Statistics	Benchmark::Compute( const float* _pDurations ) const
+{
+	Statistics	Result;
+	memset( &Result, 0, sizeof(Statistics) );
+
+	int	Count = MAX( 0, MIN( m_FramesCount - m_WarmUpFramesCount, m_MeasuredFramesCount ) );
+	if ( Count == 0 )
+		return Result;
+
+	float*	pSorted = new float[Count];
+	memcpy( pSorted, _pDurations, Count * sizeof(float) );
+	qsort( pSorted, Count, sizeof(float), CompareDurations );
+
+	double	Sum = 0.0;
+	for ( int FrameIndex=0; FrameIndex < Count; FrameIndex++ )
+		Sum += pSorted[FrameIndex];
+
+	Result.Mean = float( Sum / Count );
+	Result.Median = pSorted[Count / 2];
+	Result.Percentile90 = pSorted[MIN( Count-1, (90 * Count) / 100 )];
+	Result.Percentile99 = pSorted[MIN( Count-1, (99 * Count) / 100 )];
+	Result.Max = pSorted[Count-1];
+
+	delete[] pSorted;
+
+	return Result;
+}
+
+void	Benchmark::Write( const char* _pFileName ) const
+{
+	FILE*	pFile = NULL;
+	fopen_s( &pFile, _pFileName, "w" );
+	ASSERT( pFile != NULL, "Failed to create the benchmark file!" );
+	if ( pFile == NULL )
+		return;
+
+	Statistics	CPU = GetCPUStatistics();
+	Statistics	GPU = GetGPUStatistics();
+
+	fprintf( pFile, "{\n" );
+	fprintf( pFile, "\t\"name\": \"%s\",\n", m_pName );
+	fprintf( pFile, "\t\"width\": %d,\n", m_Device.DefaultRenderTarget().GetWidth() );
+	fprintf( pFile, "\t\"height\": %d,\n", m_Device.DefaultRenderTarget().GetHeight() );
+	fprintf( pFile, "\t\"warmup_frames\": %d,\n", m_WarmUpFramesCount );
+	fprintf( pFile, "\t\"measured_frames\": %d,\n", MAX( 0, m_FramesCount - m_WarmUpFramesCount ) );
+	fprintf( pFile, "\t\"cpu_ms\": { \"mean\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p99\": %.4f, \"max\": %.4f },\n", CPU.Mean, CPU.Median, CPU.Percentile90, CPU.Percentile99, CPU.Max );
+	fprintf( pFile, "\t\"gpu_ms\": { \"mean\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p99\": %.4f, \"max\": %.4f }\n", GPU.Mean, GPU.Median, GPU.Percentile90, GPU.Percentile99, GPU.Max );
+	fprintf( pFile, "}\n" );
+
+	fclose( pFile );
+}
+
+// Reads the median of a section of a file written by Write()
+static bool	ReadMedian( const char* _pContent, const char* _pSection, float& _Median )
+{
+	const char*	pSection = strstr( _pContent, _pSection );
+	if ( pSection == NULL )
+		return false;
+	const char*	pMedian = strstr( pSection, "\"p50\":" );
+	if ( pMedian == NULL )
+		return false;
+
+	return sscanf_s( pMedian + 6, "%f", &_Median ) == 1;
+}
+
+bool	Benchmark::Compare( const char* _pBaselineFileName, float _Tolerance ) const
+{
+	FILE*	pFile = NULL;
+	fopen_s( &pFile, _pBaselineFileName, "rb" );
+	if ( pFile == NULL )
+		return true;	// No baseline yet
+
+	char	pContent[4096];
+	size_t	Length = fread( pContent, 1, sizeof(pContent)-1, pFile );
+	pContent[Length] = '\0';
+	fclose( pFile );
+
+	char	pName[256];
+	sprintf_s( pName, "\"name\": \"%s\"", m_pName );
+	if ( strstr( pContent, pName ) == NULL )
+		return true;	// Another benchmark
+
+	float	BaselineCPU, BaselineGPU;
+	if ( !ReadMedian( pContent, "\"cpu_ms\"", BaselineCPU ) || !ReadMedian( pContent, "\"gpu_ms\"", BaselineGPU ) )
+	{
+		ASSERT( false, "Invalid benchmark baseline file!" );
+		return true;
+	}
+
+	bool	bCPURegressed = GetCPUStatistics().Median > (1.0f + _Tolerance) * BaselineCPU;
+	bool	bGPURegressed = BaselineGPU > 0.0f && GetGPUStatistics().Median > (1.0f + _Tolerance) * BaselineGPU;	// No GPU timings without GPU_PROFILING
+
+	return !bCPURegressed && !bGPURegressed;
+}
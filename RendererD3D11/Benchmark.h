@@ -0,0 +1,80 @@
+//////////////////////////////////////////////////////////////////////////
+// Benchmark
+// Measures the CPU & GPU durations of a fixed amount of frames after a warm-up and writes their statistics as JSON.
+// The results can be compared to a baseline file written by a previous run so performance regressions can be caught
+//	before a release.
+//
+// Usage:
+//	Benchmark	Bench( gs_Device, "GlobalIllum2", 60, 600 );
+//	while ( Bench.Update() )	// After each Device::Present()
+//		(...)
+//	Bench.Write( "./Benchmark.json" );
+//	bool	bRegressed = !Bench.Compare( "./Benchmark.baseline.json", 0.05f );	// Tolerate 5% slower
+//
+// NOTE: GPU durations come from the GPU profiler and are a few frames late, the first measured frames of a run
+//	are still decorrelated from the warm-up since the warm-up is longer than GPUProfiler::FRAMES_COUNT.
+//
+#pragma once
+
+#include "Device.h"
+
+class Benchmark
+{
+public:		// CONSTANTS
+
+	static const int	MAX_FRAMES = 3600;
+
+public:		// NESTED TYPES
+
+	struct	Statistics
+	{
+		float	Mean;
+		float	Median;
+		float	Percentile90;
+		float	Percentile99;
+		float	Max;
+	};
+
+private:	// FIELDS
+
+	Device&			m_Device;
+	const char*		m_pName;
+
+	int				m_WarmUpFramesCount;
+	int				m_MeasuredFramesCount;
+	int				m_FramesCount;			// Frames presented since the start (including the warm-up)
+	U32				m_LastFrameIndex;
+
+	float*			m_pCPUDurations;
+	float*			m_pGPUDurations;
+
+public:		// PROPERTIES
+
+	int			GetFramesCount() const		{ return m_FramesCount; }
+	bool		IsWarmingUp() const			{ return m_FramesCount < m_WarmUpFramesCount; }
+	bool		IsComplete() const			{ return m_FramesCount >= m_WarmUpFramesCount + m_MeasuredFramesCount; }
+
+	// Statistics of the measured frames (ms)
+	Statistics	GetCPUStatistics() const	{ return Compute( m_pCPUDurations ); }
+	Statistics	GetGPUStatistics() const	{ return Compute( m_pGPUDurations ); }
+
+public:		// METHODS
+
+	// NOTE: The name pointer must be persistent (i.e. use string literals!)
+	Benchmark( Device& _Device, const char* _pName, int _WarmUpFramesCount, int _MeasuredFramesCount );
+	~Benchmark();
+
+	// Records the last presented frame, returns false once all the frames were measured
+	bool		Update();
+
+	// Writes the statistics as JSON
+	void		Write( const char* _pFileName ) const;
+
+	// Compares the medians to the ones of a baseline file, returns false if either is more than _Tolerance slower (e.g. 0.05 for 5%)
+	// Returns true if the baseline doesn't exist or is for another benchmark
+	bool		Compare( const char* _pBaselineFileName, float _Tolerance ) const;
+
+private:
+
+	Statistics	Compute( const float* _pDurations ) const;
+};
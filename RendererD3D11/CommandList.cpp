@@ -0,0 +1,70 @@
+#include "CommandList.h"
+
+CommandList::CommandList( Device& _Device )
+	: m_Device( _Device )
+	, m_pCommandList( NULL )
+	, m_pRecorder( NULL )
+{
+	Device::Check( m_Device.DXDevice().CreateDeferredContext( 0, &m_State.pContext ) );
+}
+
+CommandList::~CommandList()
+{
+	if ( m_pCommandList != NULL )
+		m_pCommandList->Release();
+	if ( m_State.pContext != NULL )
+		m_State.pContext->Release();
+}
+
+void	CommandList::Begin()
+{
+	ASSERT( m_pCommandList == NULL, "Previous recording was not executed!" );
+	m_Device.InheritImmediateState( m_State );
+	m_Device.BeginDeferredState( m_State );
+}
+
+void	CommandList::End()
+{
+	FinishRecording();
+}
+
+void	CommandList::RecordAsync( IRecorder& _Recorder )
+{
+	ASSERT( m_pCommandList == NULL, "Previous recording was not executed!" );
+	m_pRecorder = &_Recorder;
+	m_Device.InheritImmediateState( m_State );	// Snapshot now, the immediate context may change while we're recording
+	m_Device.Jobs().Push( *this );
+}
+
+void	CommandList::Run()
+{
+	ASSERT( m_pRecorder != NULL, "Invalid recorder!" );
+
+	m_Device.BeginDeferredState( m_State );
+	m_pRecorder->Record( *this );
+	FinishRecording();
+
+	m_pRecorder = NULL;
+}
+
+void	CommandList::FinishRecording()
+{
+	m_Device.EndDeferredState();
+	Device::Check( m_State.pContext->FinishCommandList( FALSE, &m_pCommandList ) );	// The deferred context is reset to the default state
+}
+
+void	CommandList::Execute()
+{
+	ASSERT( m_Device.IsImmediate(), "Command lists can only be executed on the immediate context!" );
+	ASSERT( m_pCommandList != NULL, "Nothing was recorded!" );
+
+	m_Device.FlushBindings();	// Commands issued so far must come first
+	m_Device.DXImmediateContext().ExecuteCommandList( m_pCommandList, TRUE );	// Restore the immediate context's state afterward so our shadow tables remain valid
+
+	// The recorded commands count in the frame that executes them
+	m_Device.m_ImmediateState.Counters.Add( m_State.Counters );
+	m_State.Counters.Reset();
+
+	m_pCommandList->Release();
+	m_pCommandList = NULL;
+}
@@ -0,0 +1,78 @@
+//////////////////////////////////////////////////////////////////////////
+// Command List
+// Records rendering commands into a D3D11 deferred context so they can be executed later on the immediate context
+//
+// While a command list is recording, the Device routes the recording thread's calls (DXContext(), bindings, states, etc.)
+//	to the deferred context so all the usual components can be used as-is.
+// The deferred context starts with the bindings the immediate context had when the recording was requested.
+//
+// Usage (asynchronous):
+//	class ShadowPass : public CommandList::IRecorder { virtual void Record( CommandList& _CommandList ) { (...) } };
+//	m_pCLShadow->RecordAsync( ShadowPass );
+//	m_pCLScene->RecordAsync( ScenePass );
+//	m_Device.Jobs().Wait();
+//	m_pCLShadow->Execute();	// Executed in order on the immediate context
+//	m_pCLScene->Execute();
+//
+// Usage (synchronous, on the calling thread):
+//	m_pCL->Begin();
+//	(...)
+//	m_pCL->End();
+//	m_pCL->Execute();
+//
+// NOTE: Components are not thread-safe! Jobs recorded in parallel must not write to the same components (e.g. constant buffers)
+//
+#pragma once
+
+#include "Device.h"
+#include "JobQueue.h"
+
+class CommandList : public IJob
+{
+public:		// NESTED TYPES
+
+	class	IRecorder
+	{
+	public:
+		virtual void	Record( CommandList& _CommandList ) = 0;
+	};
+
+private:	// FIELDS
+
+	Device&					m_Device;
+	Device::ContextState	m_State;		// Our deferred context and its shadow state
+	ID3D11CommandList*		m_pCommandList;	// The recorded list, waiting for execution
+	IRecorder*				m_pRecorder;
+
+public:		// PROPERTIES
+
+	Device&					GetDevice()			{ return m_Device; }
+	ID3D11DeviceContext&	DXContext()			{ return *m_State.pContext; }
+	bool					IsRecorded() const	{ return m_pCommandList != NULL; }
+
+	U32						GetBindingCallsCount() const	{ return m_State.BindingCallsCount; }
+
+public:		// METHODS
+
+	CommandList( Device& _Device );
+	~CommandList();
+
+	// Records the commands issued by the calling thread until End() is called
+	void		Begin();
+	void		End();
+
+	// Records the commands issued by the recorder on a worker thread
+	// You must call Device::Jobs().Wait() before executing the list
+	void		RecordAsync( IRecorder& _Recorder );
+
+	// Executes the recorded commands on the immediate context (the immediate context's state is left untouched)
+	void		Execute();
+
+public:	// IJob Members
+
+	virtual void	Run();
+
+private:
+
+	void		FinishRecording();
+};
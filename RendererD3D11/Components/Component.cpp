@@ -1,6 +1,6 @@
 #include "Component.h"
 
-Component::Component( Device& _Device ) : m_Device( _Device ), m_pPrevious( NULL ), m_pNext( NULL ), m_pTag( NULL )
+Component::Component( Device& _Device ) : m_Device( _Device ), m_Handle( 0 ), m_pTag( NULL ), m_pMemoryTag( NULL )
 {
 	m_Device.RegisterComponent( *this );
 }
@@ -14,3 +14,24 @@ void	Component::Check( HRESULT _Result ) const
 {
 	m_Device.Check( _Result );
 }
+
+U32		Component::GetBufferSize( ID3D11Buffer* _pBuffer )
+{
+	if ( _pBuffer == NULL )
+		return 0;
+
+	D3D11_BUFFER_DESC	Desc;
+	_pBuffer->GetDesc( &Desc );
+	return Desc.ByteWidth;
+}
+
+Device::MEMORY_CATEGORY	Component::GetTextureCategory( D3D11_USAGE _Usage, UINT _BindFlags )
+{
+	if ( _Usage == D3D11_USAGE_STAGING )
+		return Device::MC_STAGING;
+	if ( _BindFlags & D3D11_BIND_DEPTH_STENCIL )
+		return Device::MC_DEPTH_STENCIL;
+	if ( _BindFlags & (D3D11_BIND_RENDER_TARGET | D3D11_BIND_UNORDERED_ACCESS) )
+		return Device::MC_RENDER_TARGET;
+	return Device::MC_TEXTURE;
+}
@@ -6,12 +6,12 @@ class Component
 protected:  // FIELDS
 
 	Device&		m_Device;
-	Component*	m_pPrevious;
-	Component*	m_pNext;
+	U32			m_Handle;	// Our slot in the device's components table (cf. Device::GetComponent())
 
 public:
 
 	void*		m_pTag;		// User tag
+	const char*	m_pMemoryTag;	// Optional persistent name reported by Device::DumpVideoMemoryUsage() (e.g. "Sky Tables")
 
 public:		// METHODS
 
@@ -19,7 +19,17 @@ public:		// METHODS
 	virtual ~Component();
 
 	Device&		GetDevice()	{ return m_Device; }
+	U32			GetHandle() const	{ return m_Handle; }	// Keep the handle rather than a pointer to find out whether the component still exists
 	void		Check( HRESULT _Result ) const;
 
+	// The estimated video memory used by the component and what it's used for (cf. Device::GetVideoMemoryUsage())
+	virtual U64	GetVideoMemorySize() const	{ return 0; }
+	virtual Device::MEMORY_CATEGORY	GetVideoMemoryCategory() const	{ return Device::MC_TEXTURE; }
+
+protected:
+
+	static U32	GetBufferSize( ID3D11Buffer* _pBuffer );	// 0 if NULL
+	static Device::MEMORY_CATEGORY	GetTextureCategory( D3D11_USAGE _Usage, UINT _BindFlags );
+
 	friend class Device;
 };
@@ -12,10 +12,13 @@
 
 ComputeShader*	ComputeShader::ms_pCurrentShader = NULL;
 
-ComputeShader::ComputeShader( Device& _Device, const char* _pShaderFileName, const char* _pShaderCode, D3D_SHADER_MACRO* _pMacros, const char* _pEntryPoint, ID3DInclude* _pIncludeOverride )
+ComputeShader::ComputeShader( Device& _Device, const char* _pShaderFileName, const char* _pShaderCode, D3D_SHADER_MACRO* _pMacros, const char* _pEntryPoint, ID3DInclude* _pIncludeOverride, bool _bDeferCompilation )
 	: Component( _Device )
 	, m_pCS( NULL )
 	, m_pShaderPath( NULL )
+#ifndef GODCOMPLEX
+	, m_BindingsCount( 0 )
+#endif
 #if defined(_DEBUG) || !defined(GODCOMPLEX)
 	, m_LastShaderModificationTime( 0 )
 #endif
@@ -86,7 +89,8 @@ ComputeShader::ComputeShader( Device& _Device, const char* _pShaderFileName, con
 #endif
 
 	// Compile immediately
-	CompileShaders( _pShaderCode );
+	if ( !_bDeferCompilation )
+		CompileShaders( _pShaderCode );
 #endif
 }
 
@@ -96,6 +100,9 @@ ComputeShader::ComputeShader( Device& _Device, const char* _pShaderFileName, ID3
 	, m_pShaderPath( NULL )
 	, m_pIncludeOverride( NULL )
 	, m_bHasErrors( false )
+#ifndef GODCOMPLEX
+	, m_BindingsCount( 0 )
+#endif
 #if defined(_DEBUG) || !defined(GODCOMPLEX)
 	, m_LastShaderModificationTime( 0 )
 #endif
@@ -164,6 +171,8 @@ void	ComputeShader::CompileShaders( const char* _pShaderCode, ID3DBlob* _pCS ) {
 
 		#ifndef GODCOMPLEX
 			m_CSConstants.Enumerate( *pShader );
+			for ( int BindingIndex=0; BindingIndex < m_BindingsCount; BindingIndex++ )
+				ResolveBinding( m_pBindings[BindingIndex] );
 		#endif
 
 		m_bHasErrors = false;	// Not in error state anymore
@@ -182,6 +191,7 @@ bool	ComputeShader::Use()
 		return false;	// Someone else is locking it !
 
 	m_Device.DXContext().CSSetShader( m_pCS, NULL, 0 );
+	m_Device.CountShaderSwitch();
 	ms_pCurrentShader = this;
 
 	Unlock();
@@ -195,7 +205,23 @@ void	ComputeShader::Dispatch( int _GroupsCountX, int _GroupsCountY, int _GroupsC
 	if ( !Lock() )
 		return;	// Someone else is locking it !
 
+	m_Device.FlushBindings();
 	m_Device.DXContext().Dispatch( _GroupsCountX, _GroupsCountY, _GroupsCountZ );
+	m_Device.CountDispatch();
+
+	Unlock();
+}
+
+void	ComputeShader::DispatchIndirect( StructuredBuffer& _Args, U32 _ByteOffset )
+{
+	ASSERT( ms_pCurrentShader == this, "You must call Use() before calling Run() on a ComputeShader!" );
+	ASSERT( (_ByteOffset & 3) == 0, "Indirect arguments must be 4 bytes aligned!" );
+	if ( !Lock() )
+		return;	// Someone else is locking it !
+
+	m_Device.FlushBindings();
+	m_Device.DXContext().DispatchIndirect( _Args.GetBuffer(), _ByteOffset );
+	m_Device.CountDispatch();
 
 	Unlock();
 }
@@ -265,7 +291,7 @@ void	ComputeShader::SetConstantBuffer( int _BufferSlot, ConstantBuffer& _Buffer
 		return;	// Someone else is locking it !
 
 	ID3D11Buffer*	pBuffer = _Buffer.GetBuffer();
-	m_Device.DXContext().CSSetConstantBuffers( _BufferSlot, 1, &pBuffer );
+	m_Device.SetConstantBuffer( Device::SSF_COMPUTE_SHADER, _BufferSlot, pBuffer );
 
 	Unlock();
 }
@@ -275,7 +301,7 @@ void	ComputeShader::SetTexture( int _BufferSlot, ID3D11ShaderResourceView* _pDat
 	if ( !Lock() )
 		return;	// Someone else is locking it !
 
-	m_Device.DXContext().CSSetShaderResources( _BufferSlot, 1, &_pData );
+	m_Device.SetShaderResource( Device::SSF_COMPUTE_SHADER, _BufferSlot, _pData );
 
 	Unlock();
 }
@@ -286,7 +312,7 @@ void	ComputeShader::SetStructuredBuffer( int _BufferSlot, StructuredBuffer& _Buf
 		return;	// Someone else is locking it !
 
 	ID3D11ShaderResourceView*	pView = _Buffer.GetShaderView();
-	m_Device.DXContext().CSSetShaderResources( _BufferSlot, 1, &pView );
+	m_Device.SetShaderResource( Device::SSF_COMPUTE_SHADER, _BufferSlot, pView );
 
 	Unlock();
 }
@@ -298,7 +324,7 @@ void	ComputeShader::SetUnorderedAccessView( int _BufferSlot, StructuredBuffer& _
 
 	ID3D11UnorderedAccessView*	pUAV = _Buffer.GetUnorderedAccessView();
 	U32							UAVInitCount = -1;
-	m_Device.DXContext().CSSetUnorderedAccessViews( _BufferSlot, 1, &pUAV, &UAVInitCount );
+	m_Device.SetUnorderedAccessView( _BufferSlot, pUAV, UAVInitCount );
 
 	Unlock();
 }
@@ -346,7 +372,7 @@ bool	ComputeShader::SetConstantBuffer( const char* _pBufferName, ConstantBuffer&
 	{
 		int	SlotIndex = m_CSConstants.GetConstantBufferIndex( _pBufferName );
 		if ( SlotIndex != -1 )
-			m_Device.DXContext().CSSetConstantBuffers( SlotIndex, 1, &pBuffer );
+			m_Device.SetConstantBuffer( Device::SSF_COMPUTE_SHADER, SlotIndex, pBuffer );
 		bUsed |= SlotIndex != -1;
 	}
 
@@ -364,7 +390,7 @@ bool	ComputeShader::SetTexture( const char* _pTextureName, ID3D11ShaderResourceV
 	{
 		int	SlotIndex = m_CSConstants.GetShaderResourceViewIndex( _pTextureName );
 		if ( SlotIndex != -1 )
-			m_Device.DXContext().CSSetShaderResources( SlotIndex, 1, &_pData );
+			m_Device.SetShaderResource( Device::SSF_COMPUTE_SHADER, SlotIndex, _pData );
 		bUsed |= SlotIndex != -1;
 	}
 
@@ -384,7 +410,7 @@ bool	ComputeShader::SetStructuredBuffer( const char* _pBufferName, StructuredBuf
 		if ( SlotIndex != -1 )
 		{
 			ID3D11ShaderResourceView*	pView = _Buffer.GetShaderView();
-			m_Device.DXContext().CSSetShaderResources( SlotIndex, 1, &pView );
+			m_Device.SetShaderResource( Device::SSF_COMPUTE_SHADER, SlotIndex, pView );
 		}
 		bUsed |= SlotIndex != -1;
 	}
@@ -406,7 +432,7 @@ bool	ComputeShader::SetUnorderedAccessView( const char* _pBufferName, Structured
 		{
 			ID3D11UnorderedAccessView*	pUAV = _Buffer.GetUnorderedAccessView();
 			U32							UAVInitCount = -1;
-			m_Device.DXContext().CSSetUnorderedAccessViews( SlotIndex, 1, &pUAV, &UAVInitCount );
+			m_Device.SetUnorderedAccessView( SlotIndex, pUAV, UAVInitCount );
 		}
 
 		bUsed |= SlotIndex != -1;
@@ -417,6 +443,164 @@ bool	ComputeShader::SetUnorderedAccessView( const char* _pBufferName, Structured
 	return	bUsed;
 }
 
+bool	ComputeShader::SetConstantBuffer( StringID _BufferID, ConstantBuffer& _Buffer )
+{
+	if ( !Lock() )
+		return	true;	// Someone else is locking it !
+
+	int	SlotIndex = m_CSConstants.GetConstantBufferIndex( _BufferID );
+	if ( SlotIndex != -1 )
+		m_Device.SetConstantBuffer( Device::SSF_COMPUTE_SHADER, SlotIndex, _Buffer.GetBuffer() );
+
+	Unlock();
+
+	return	SlotIndex != -1;
+}
+
+bool	ComputeShader::SetTexture( StringID _TextureID, ID3D11ShaderResourceView* _pData )
+{
+	if ( !Lock() )
+		return	true;	// Someone else is locking it !
+
+	int	SlotIndex = m_CSConstants.GetShaderResourceViewIndex( _TextureID );
+	if ( SlotIndex != -1 )
+		m_Device.SetShaderResource( Device::SSF_COMPUTE_SHADER, SlotIndex, _pData );
+
+	Unlock();
+
+	return	SlotIndex != -1;
+}
+
+bool	ComputeShader::SetStructuredBuffer( StringID _BufferID, StructuredBuffer& _Buffer )
+{
+	if ( !Lock() )
+		return	true;	// Someone else is locking it !
+
+	int	SlotIndex = m_CSConstants.GetStructuredBufferIndex( _BufferID );
+	if ( SlotIndex != -1 )
+		m_Device.SetShaderResource( Device::SSF_COMPUTE_SHADER, SlotIndex, _Buffer.GetShaderView() );
+
+	Unlock();
+
+	return	SlotIndex != -1;
+}
+
+bool	ComputeShader::SetUnorderedAccessView( StringID _BufferID, StructuredBuffer& _Buffer )
+{
+	if ( !Lock() )
+		return	true;	// Someone else is locking it !
+
+	int	SlotIndex = m_CSConstants.GetUnorderedAccesViewIndex( _BufferID );
+	if ( SlotIndex != -1 )
+	{
+		U32	UAVInitCount = -1;
+		m_Device.SetUnorderedAccessView( SlotIndex, _Buffer.GetUnorderedAccessView(), UAVInitCount );
+	}
+
+	Unlock();
+
+	return	SlotIndex != -1;
+}
+
+bool	ComputeShader::SetConstantBuffer( BindingHandle _Binding, ConstantBuffer& _Buffer )
+{
+	if ( !Lock() )
+		return	true;	// Someone else is locking it !
+
+	int	SlotIndex = GetBindingSlot( _Binding, BT_CONSTANT_BUFFER );
+	if ( SlotIndex != -1 )
+		m_Device.SetConstantBuffer( Device::SSF_COMPUTE_SHADER, SlotIndex, _Buffer.GetBuffer() );
+
+	Unlock();
+
+	return	SlotIndex != -1;
+}
+
+bool	ComputeShader::SetTexture( BindingHandle _Binding, ID3D11ShaderResourceView* _pData )
+{
+	if ( !Lock() )
+		return	true;	// Someone else is locking it !
+
+	int	SlotIndex = GetBindingSlot( _Binding, BT_TEXTURE );
+	if ( SlotIndex != -1 )
+		m_Device.SetShaderResource( Device::SSF_COMPUTE_SHADER, SlotIndex, _pData );
+
+	Unlock();
+
+	return	SlotIndex != -1;
+}
+
+bool	ComputeShader::SetStructuredBuffer( BindingHandle _Binding, StructuredBuffer& _Buffer )
+{
+	if ( !Lock() )
+		return	true;	// Someone else is locking it !
+
+	int	SlotIndex = GetBindingSlot( _Binding, BT_STRUCTURED_BUFFER );
+	if ( SlotIndex != -1 )
+		m_Device.SetShaderResource( Device::SSF_COMPUTE_SHADER, SlotIndex, _Buffer.GetShaderView() );
+
+	Unlock();
+
+	return	SlotIndex != -1;
+}
+
+bool	ComputeShader::SetUnorderedAccessView( BindingHandle _Binding, StructuredBuffer& _Buffer )
+{
+	if ( !Lock() )
+		return	true;	// Someone else is locking it !
+
+	int	SlotIndex = GetBindingSlot( _Binding, BT_UAV );
+	if ( SlotIndex != -1 )
+	{
+		U32	UAVInitCount = -1;
+		m_Device.SetUnorderedAccessView( SlotIndex, _Buffer.GetUnorderedAccessView(), UAVInitCount );
+	}
+
+	Unlock();
+
+	return	SlotIndex != -1;
+}
+
+ComputeShader::BindingHandle	ComputeShader::AddBinding( StringID _ID, BINDING_TYPE _Type )
+{
+	BindingHandle	Result;
+	for ( Result.Index=0; Result.Index < m_BindingsCount; Result.Index++ )
+		if ( m_pBindings[Result.Index].Type == _Type && m_pBindings[Result.Index].ID == _ID )
+			return Result;	// Already resolved
+
+	ASSERT( m_BindingsCount < MAX_BINDINGS, "Too many bindings!" );
+	Binding&	B = m_pBindings[m_BindingsCount];
+	B.ID = _ID;
+	B.Type = _Type;
+	B.Slot = -1;
+	m_BindingsCount++;
+
+	if ( Lock() )
+	{	// Otherwise it's compiling and the binding will be resolved once it's done
+		ResolveBinding( B );
+		Unlock();
+	}
+
+	return Result;
+}
+
+int		ComputeShader::GetBindingSlot( BindingHandle _Binding, BINDING_TYPE _Type ) const
+{
+	ASSERT( _Binding.Index >= 0 && _Binding.Index < m_BindingsCount && m_pBindings[_Binding.Index].Type == _Type, "Invalid binding!" );
+	return m_pBindings[_Binding.Index].Slot;
+}
+
+void	ComputeShader::ResolveBinding( Binding& _Binding ) const
+{
+	switch ( _Binding.Type )
+	{
+	case BT_CONSTANT_BUFFER:	_Binding.Slot = m_CSConstants.GetConstantBufferIndex( _Binding.ID ); break;
+	case BT_TEXTURE:			_Binding.Slot = m_CSConstants.GetShaderResourceViewIndex( _Binding.ID ); break;
+	case BT_STRUCTURED_BUFFER:	_Binding.Slot = m_CSConstants.GetStructuredBufferIndex( _Binding.ID ); break;
+	case BT_UAV:				_Binding.Slot = m_CSConstants.GetUnorderedAccesViewIndex( _Binding.ID ); break;
+	}
+}
+
 static void	DeleteBindingDescriptors( int _EntryIndex, ComputeShader::ShaderConstants::BindingDesc*& _pValue, void* _pUserData )
 {
 	delete _pValue;
@@ -425,6 +609,8 @@ ComputeShader::ShaderConstants::~ShaderConstants()
 {
 	m_ConstantBufferName2Descriptor.ForEach( DeleteBindingDescriptors, NULL );
 	m_TextureName2Descriptor.ForEach( DeleteBindingDescriptors, NULL );
+	m_StructuredBufferName2Descriptor.ForEach( DeleteBindingDescriptors, NULL );
+	m_UAVName2Descriptor.ForEach( DeleteBindingDescriptors, NULL );
 }
 void	ComputeShader::ShaderConstants::Enumerate( ID3DBlob& _ShaderBlob )
 {
@@ -441,18 +627,22 @@ void	ComputeShader::ShaderConstants::Enumerate( ID3DBlob& _ShaderBlob )
 		pReflector->GetResourceBindingDesc( ResourceIndex, &BindDesc );
 
 		BindingDesc**	ppDesc = NULL;
+		FlatDictionary<StringID, BindingDesc*>*	pID2Descriptor = NULL;
 		switch ( BindDesc.Type )
 		{
 		case D3D_SIT_TEXTURE:
-			ppDesc = &m_TextureName2Descriptor.Add( BindDesc.Name );
+			ppDesc = &m_TextureName2Descriptor.AddUnique( BindDesc.Name );
+			pID2Descriptor = &m_TextureID2Descriptor;
 			break;
 
 		case D3D_SIT_CBUFFER:
-			ppDesc = &m_ConstantBufferName2Descriptor.Add( BindDesc.Name );
+			ppDesc = &m_ConstantBufferName2Descriptor.AddUnique( BindDesc.Name );
+			pID2Descriptor = &m_ConstantBufferID2Descriptor;
 			break;
 
 		case D3D_SIT_STRUCTURED:
-			ppDesc = &m_StructuredBufferName2Descriptor.Add( BindDesc.Name );
+			ppDesc = &m_StructuredBufferName2Descriptor.AddUnique( BindDesc.Name );
+			pID2Descriptor = &m_StructuredBufferID2Descriptor;
 			break;
 
 		case D3D_SIT_UAV_RWTYPED:
@@ -461,18 +651,21 @@ void	ComputeShader::ShaderConstants::Enumerate( ID3DBlob& _ShaderBlob )
 		case D3D_SIT_UAV_APPEND_STRUCTURED:
 		case D3D_SIT_UAV_CONSUME_STRUCTURED:
 		case D3D_SIT_UAV_RWSTRUCTURED_WITH_COUNTER:
-			ppDesc = &m_UAVName2Descriptor.Add( BindDesc.Name );
+			ppDesc = &m_UAVName2Descriptor.AddUnique( BindDesc.Name );
+			pID2Descriptor = &m_UAVID2Descriptor;
 			break;
 		}
 		if ( ppDesc == NULL )
 			continue;	// We're not interested in that type !
 
+		delete *ppDesc;	// Replace any descriptor from a previous compilation
 		*ppDesc = new BindingDesc();
 		(*ppDesc)->SetName( BindDesc.Name );
 		(*ppDesc)->Slot = BindDesc.BindPoint;
 #ifdef __DEBUG_UPLOAD_ONLY_ONCE
 		(*ppDesc)->bUploaded = false;	// Not uploaded yet !
 #endif
+		pID2Descriptor->AddUnique( StringID::FromString( BindDesc.Name ), *ppDesc );
 	}
 
 	pReflector->Release();
@@ -557,6 +750,23 @@ int		ComputeShader::ShaderConstants::GetUnorderedAccesViewIndex( const char* _pU
 	return ppValue != NULL ? (*ppValue)->Slot : -1;
 }
 
+int		ComputeShader::ShaderConstants::GetSlot( const FlatDictionary<StringID, BindingDesc*>& _ID2Descriptor, StringID _ID )
+{
+	BindingDesc**	ppValue = _ID2Descriptor.Get( _ID );
+
+#ifdef __DEBUG_UPLOAD_ONLY_ONCE
+	// Ensure the resource is uploaded only once !
+	if ( ppValue != NULL )
+	{
+		if ( (*ppValue)->bUploaded )
+			return -1;
+		(*ppValue)->bUploaded = true;	// Now it has been uploaded ! Don't come back !
+	}
+#endif
+
+	return ppValue != NULL ? (*ppValue)->Slot : -1;
+}
+
 const char*	ComputeShader::GetShaderPath( const char* _pShaderFileName ) const
 {
 	char*	pResult = NULL;
@@ -610,6 +820,17 @@ void		ComputeShader::WatchShadersModifications()
 	ms_WatchedShaders.ForEach( WatchShader, NULL );
 }
 
+void		ComputeShader::WatchShaderFile( int _EntryIndex, ComputeShader*& _Value, void* _pUserData )
+{
+	if ( !_stricmp( _Value->m_pShaderFileName, (const char*) _pUserData ) )
+		_Value->WatchShaderModifications();	// Several shaders can be compiled from the same file
+}
+
+void		ComputeShader::NotifyFileChanged( const char* _pShaderFileName )
+{
+	ms_WatchedShaders.ForEach( WatchShaderFile, (void*) _pShaderFileName );
+}
+
 #ifdef COMPUTE_SHADER_COMPILE_THREADED
 void	ThreadCompileComputeShader( void* _pData )
 {
@@ -693,7 +914,7 @@ void		ComputeShader::RebuildShader()
 
 void		ComputeShader::ForceRecompile()
 {
-	m_LastShaderModificationTime++;	// So we're sure it will be recompiled on next watch!
+	m_LastShaderModificationTime--;	// So we're sure it will be recompiled on next watch!
 }
 
 time_t		ComputeShader::GetFileModTime( const char* _pFileName )
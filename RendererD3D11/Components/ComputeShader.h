@@ -56,10 +56,14 @@ public:		// NESTED TYPES
 
 	public:
 
-		DictionaryString<BindingDesc*>	m_ConstantBufferName2Descriptor;
-		DictionaryString<BindingDesc*>	m_TextureName2Descriptor;
-		DictionaryString<BindingDesc*>	m_StructuredBufferName2Descriptor;
-		DictionaryString<BindingDesc*>	m_UAVName2Descriptor;
+		FlatDictionary<const char*, BindingDesc*>	m_ConstantBufferName2Descriptor;
+		FlatDictionary<const char*, BindingDesc*>	m_TextureName2Descriptor;
+		FlatDictionary<const char*, BindingDesc*>	m_StructuredBufferName2Descriptor;
+		FlatDictionary<const char*, BindingDesc*>	m_UAVName2Descriptor;
+		FlatDictionary<StringID, BindingDesc*>		m_ConstantBufferID2Descriptor;	// Same descriptors as the name dictionaries, keyed by interned name
+		FlatDictionary<StringID, BindingDesc*>		m_TextureID2Descriptor;
+		FlatDictionary<StringID, BindingDesc*>		m_StructuredBufferID2Descriptor;
+		FlatDictionary<StringID, BindingDesc*>		m_UAVID2Descriptor;
 
 		~ShaderConstants();
 
@@ -68,8 +72,23 @@ public:		// NESTED TYPES
 		int		GetShaderResourceViewIndex( const char* _pTextureName ) const;
 		int		GetStructuredBufferIndex( const char* _pBufferName ) const;
 		int		GetUnorderedAccesViewIndex( const char* _pUAVName ) const;
-		
+		int		GetConstantBufferIndex( StringID _BufferID ) const				{ return GetSlot( m_ConstantBufferID2Descriptor, _BufferID ); }
+		int		GetShaderResourceViewIndex( StringID _TextureID ) const			{ return GetSlot( m_TextureID2Descriptor, _TextureID ); }
+		int		GetStructuredBufferIndex( StringID _BufferID ) const			{ return GetSlot( m_StructuredBufferID2Descriptor, _BufferID ); }
+		int		GetUnorderedAccesViewIndex( StringID _UAVID ) const				{ return GetSlot( m_UAVID2Descriptor, _UAVID ); }
+
+	private:
+		static int	GetSlot( const FlatDictionary<StringID, BindingDesc*>& _ID2Descriptor, StringID _ID );
+	};
+
+	// A resource resolved once by name (cf. GetConstantBufferBinding() & co)
+	// The handle stays valid when the shader is recompiled, its slot is simply resolved again by Enumerate
+	struct	BindingHandle
+	{
+		int		Index;
 	};
+
+	static const int	MAX_BINDINGS = 32;
 #endif
 
 
@@ -90,6 +109,22 @@ private:	// FIELDS
 	ShaderConstants			m_CSConstants;
 
 	Dictionary<const char*>	m_Pointer2FileName;
+
+	enum	BINDING_TYPE
+	{
+		BT_CONSTANT_BUFFER,
+		BT_TEXTURE,
+		BT_STRUCTURED_BUFFER,
+		BT_UAV,
+	};
+	struct	Binding
+	{
+		StringID		ID;
+		BINDING_TYPE	Type;
+		int				Slot;		// -1 if the shader doesn't use it
+	};
+	Binding					m_pBindings[MAX_BINDINGS];
+	int						m_BindingsCount;
 #endif
 
 	static ComputeShader*	ms_pCurrentShader;
@@ -101,7 +136,7 @@ public:	 // PROPERTIES
 
 public:	 // METHODS
 
-	ComputeShader( Device& _Device, const char* _pShaderFileName, const char* _pShaderCode, D3D_SHADER_MACRO* _pMacros, const char* _pEntryPoint, ID3DInclude* _pIncludeOverride );
+	ComputeShader( Device& _Device, const char* _pShaderFileName, const char* _pShaderCode, D3D_SHADER_MACRO* _pMacros, const char* _pEntryPoint, ID3DInclude* _pIncludeOverride, bool _bDeferCompilation=false );
 	ComputeShader( Device& _Device, const char* _pShaderFileName, ID3DBlob* _pCS );
 	~ComputeShader();
 
@@ -114,10 +149,34 @@ public:	 // METHODS
 	bool			SetTexture( const char* _pTextureName, ID3D11ShaderResourceView* _pData );
 	bool			SetStructuredBuffer( const char* _pBufferName, StructuredBuffer& _Buffer );
 	bool			SetUnorderedAccessView( const char* _pBufferName, StructuredBuffer& _Buffer );
+
+	// Same with an interned name (e.g. GCX_ID( "_TexSource" )), which saves hashing & comparing the string on each call
+	bool			SetConstantBuffer( StringID _BufferID, ConstantBuffer& _Buffer );
+	bool			SetTexture( StringID _TextureID, ID3D11ShaderResourceView* _pData );
+	bool			SetStructuredBuffer( StringID _BufferID, StructuredBuffer& _Buffer );
+	bool			SetUnorderedAccessView( StringID _BufferID, StructuredBuffer& _Buffer );
+
+	// Resolve the name once at init then set with the handle, which is a simple array read instead of a hash lookup
+	BindingHandle	GetConstantBufferBinding( const char* _pBufferName )		{ return AddBinding( StringID::FromString( _pBufferName ), BT_CONSTANT_BUFFER ); }
+	BindingHandle	GetTextureBinding( const char* _pTextureName )				{ return AddBinding( StringID::FromString( _pTextureName ), BT_TEXTURE ); }
+	BindingHandle	GetStructuredBufferBinding( const char* _pBufferName )		{ return AddBinding( StringID::FromString( _pBufferName ), BT_STRUCTURED_BUFFER ); }
+	BindingHandle	GetUnorderedAccessViewBinding( const char* _pBufferName )	{ return AddBinding( StringID::FromString( _pBufferName ), BT_UAV ); }
+	BindingHandle	GetConstantBufferBinding( StringID _BufferID )				{ return AddBinding( _BufferID, BT_CONSTANT_BUFFER ); }
+	BindingHandle	GetTextureBinding( StringID _TextureID )					{ return AddBinding( _TextureID, BT_TEXTURE ); }
+	BindingHandle	GetStructuredBufferBinding( StringID _BufferID )			{ return AddBinding( _BufferID, BT_STRUCTURED_BUFFER ); }
+	BindingHandle	GetUnorderedAccessViewBinding( StringID _BufferID )			{ return AddBinding( _BufferID, BT_UAV ); }
+	bool			SetConstantBuffer( BindingHandle _Binding, ConstantBuffer& _Buffer );
+	bool			SetTexture( BindingHandle _Binding, ID3D11ShaderResourceView* _pData );
+	bool			SetStructuredBuffer( BindingHandle _Binding, StructuredBuffer& _Buffer );
+	bool			SetUnorderedAccessView( BindingHandle _Binding, StructuredBuffer& _Buffer );
 #endif
 
 	bool			Use();
 
+	// Compiles the shader from source (this is what the constructor does unless you asked to defer compilation)
+	// NOTE: This can be called from any thread as long as nobody is using the shader in the meantime
+	void			Compile( const char* _pShaderCode )	{ CompileShaders( _pShaderCode ); }
+
 	// Runs the compute shader using as many thread groups as necessary
 	//	_GroupsCountXYZ, the amount of thread groups to run the shader on (up to 65535)
 	//
@@ -125,6 +184,10 @@ public:	 // METHODS
 	//
 	void			Dispatch( int _GroupsCountX, int _GroupsCountY, int _GroupsCountZ );
 
+	// Runs the compute shader with the thread groups counts read by the GPU from _Args at _ByteOffset (3 U32)
+	//	_Args must have been created with StructuredBuffer::DRAW_INDIRECT_ARGS
+	void			DispatchIndirect( StructuredBuffer& _Args, U32 _ByteOffset=0 );
+
 
 public:	// ID3DInclude Members
 
@@ -138,6 +201,10 @@ private:
 	const char*		CopyString( const char* _pShaderFileName ) const;
 #ifndef GODCOMPLEX
 	const char*		GetShaderPath( const char* _pShaderFileName ) const;
+
+	BindingHandle	AddBinding( StringID _ID, BINDING_TYPE _Type );
+	int				GetBindingSlot( BindingHandle _Binding, BINDING_TYPE _Type ) const;
+	void			ResolveBinding( Binding& _Binding ) const;
 #endif
 
 
@@ -174,11 +241,13 @@ private:
 	static DictionaryString<ComputeShader*>	ms_WatchedShaders;
 	time_t			m_LastShaderModificationTime;
 	time_t			GetFileModTime( const char* _pFileName );
+	static void		WatchShaderFile( int _EntryIndex, ComputeShader*& _Value, void* _pUserData );
 #endif
 
 public:
 	// Call this every time you need to rebuild shaders whose code has changed
 	static void		WatchShadersModifications();
+	static void		NotifyFileChanged( const char* _pShaderFileName );	// Rebuilds only the shaders using that file (e.g. notified by a FileWatcher)
 	void			WatchShaderModifications();
 	void			ForceRecompile();	// Called externally by the IncludesManager if an include file was changed
 };
@@ -1,22 +1,40 @@
 #include "ConstantBuffer.h"
 
-ConstantBuffer::ConstantBuffer( Device& _Device, int _Size, void* _pData, bool _IsConstantBuffer )
+ConstantBuffer::ConstantBuffer( Device& _Device, int _Size, void* _pData, bool _IsConstantBuffer, bool _bPartialUpdates )
 	: Component( _Device )
+	, m_pShadow( NULL )
+	, m_bShadowValid( false )
+	, m_bDefaultUsage( false )
 	, m_pShaderResourceView( NULL )
 {
+	ASSERT( !_bPartialUpdates || (!_IsConstantBuffer && _pData == NULL), "Partial updates are only supported by dynamic tbuffers!" );
 	m_IsConstantBuffer = _IsConstantBuffer;
+	m_bPartialUpdates = _bPartialUpdates;
+	m_ShaderStages = Device::SSF_ALL;
+	m_bTransient = false;
+	m_pTransientData = NULL;
+	m_TransientFirstConstant = 0;
+	m_TransientGeneration = 0;
 	m_Size = _Size;
 
 	// Pad to 16
 	_Size = (_Size+15) & ~0xF;
 	m_PaddedSize = _Size;
 
+	// Updated constant buffers keep a copy of their data to only upload what changed
+	if ( m_IsConstantBuffer && _pData == NULL )
+	{
+		m_pShadow = new U8[_Size];
+		m_bDefaultUsage = m_Device.SupportsConstantBufferPartialUpdates();	// Updated through UpdateSubresource1() instead of being mapped
+	}
+
 	// Create the vertex buffer
+	bool	bDefaultUsage = _bPartialUpdates || m_bDefaultUsage;
 	D3D11_BUFFER_DESC   Desc;
 	Desc.ByteWidth = _Size;
-	Desc.Usage = _pData != NULL ? D3D11_USAGE_IMMUTABLE : D3D11_USAGE_DYNAMIC;
+	Desc.Usage = _pData != NULL ? D3D11_USAGE_IMMUTABLE : (bDefaultUsage ? D3D11_USAGE_DEFAULT : D3D11_USAGE_DYNAMIC);	// Partial updates go through UpdateSubresource()
 	Desc.BindFlags = m_IsConstantBuffer ? D3D11_BIND_CONSTANT_BUFFER : D3D11_BIND_SHADER_RESOURCE;
-	Desc.CPUAccessFlags = _pData == NULL ? D3D11_CPU_ACCESS_WRITE : 0;
+	Desc.CPUAccessFlags = _pData == NULL && !bDefaultUsage ? D3D11_CPU_ACCESS_WRITE : 0;
 	Desc.MiscFlags = 0;
 	Desc.StructureByteStride = 0;
 
@@ -48,7 +66,11 @@ ConstantBuffer::ConstantBuffer( Device& _Device, int _Size, void* _pData, bool _
 ConstantBuffer::~ConstantBuffer()
 {
 	ASSERT( m_pBuffer != NULL, "Invalid constant buffer to destroy!" );
-	m_pBuffer->Release(); m_pBuffer = NULL;
+	m_Device.FlushBindings();	// Make sure the device doesn't hold pending bindings to our views once they're released
+	m_Device.DeferRelease( m_pBuffer ); m_pBuffer = NULL;	// Frames in flight may still use it
+
+	delete[] m_pShadow;
+	m_pShadow = NULL;
 
 	if ( m_pShaderResourceView )
 		m_pShaderResourceView->Release();
@@ -57,62 +79,139 @@ ConstantBuffer::~ConstantBuffer()
 
 void	ConstantBuffer::UpdateData( const void* _pData )
 {
+	if ( m_bTransient && m_Device.SupportsConstantOffsets() && m_Device.IsImmediate() )
+	{	// Suballocate from the ring
+		m_pTransientData = _pData;
+		m_TransientFirstConstant = m_Device.AllocateConstants( _pData, m_Size );
+		m_TransientGeneration = m_Device.ConstantRingGeneration();
+		return;
+	}
+	m_pTransientData = NULL;
+
+	if ( m_bPartialUpdates )
+	{	// Default memory can't be mapped
+		UpdateDataRange( _pData, 0, m_Size );
+		return;
+	}
+
+	int	Offset = 0;
+	int	Size = m_PaddedSize;
+	if ( m_pShadow != NULL )
+	{
+		bool	bImmediate = m_Device.IsImmediate();	// A command list must upload the buffer itself and we don't know when it will execute
+		if ( bImmediate && !FindChangedRange( _pData, Offset, Size ) )
+		{
+			m_Device.CountConstantUpload( true );
+			return;	// Unchanged!
+		}
+
+		memcpy( m_pShadow, _pData, m_Size );
+		m_bShadowValid = bImmediate;
+	}
+	m_Device.CountConstantUpload( false );
+
+	if ( m_bDefaultUsage )
+	{
+		// The shadow is the source since it's padded like the buffer
+		if ( m_Device.IsImmediate() && Size < m_PaddedSize )
+		{	// Only the changed 16 bytes constants go up
+			D3D11_BOX	Box;
+			Box.left = Offset;
+			Box.right = Offset + Size;
+			Box.top = 0;	Box.bottom = 1;
+			Box.front = 0;	Box.back = 1;
+			m_Device.DXContext1().UpdateSubresource1( m_pBuffer, 0, &Box, m_pShadow + Offset, 0, 0, 0 );
+		}
+		else
+			m_Device.DXContext().UpdateSubresource( m_pBuffer, 0, NULL, m_pShadow, 0, 0 );	// Deferred contexts only update whole buffers
+		m_Device.CountUpload( Size );
+		return;
+	}
+
 	D3D11_MAPPED_SUBRESOURCE	SubResource;
-	m_Device.DXContext().Map( m_pBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &SubResource );
+	m_Device.Map( m_pBuffer, 0, D3D11_MAP_WRITE_DISCARD, SubResource, "ConstantBuffer::UpdateData" );
 
 	memcpy( SubResource.pData, _pData, m_Size );
 
 	m_Device.DXContext().Unmap( m_pBuffer, 0 );
+	m_Device.CountUpload( m_Size );
 }
 
-void	ConstantBuffer::Set( int _SlotIndex )
-{
-	SetVS( _SlotIndex );
-	SetHS( _SlotIndex );
-	SetDS( _SlotIndex );
-	SetGS( _SlotIndex );
-	SetPS( _SlotIndex );
-	SetCS( _SlotIndex );
-}
-void	ConstantBuffer::SetVS( int _SlotIndex )
-{
-	if ( m_IsConstantBuffer )
-		m_Device.DXContext().VSSetConstantBuffers( _SlotIndex, 1, &m_pBuffer );
-	else
-		m_Device.DXContext().VSSetShaderResources( _SlotIndex, 1, &m_pShaderResourceView );
-}
-void	ConstantBuffer::SetHS( int _SlotIndex )
+// Returns false if the data is the same as the last upload, otherwise the range of the 16 bytes constants that changed
+bool	ConstantBuffer::FindChangedRange( const void* _pData, int& _Offset, int& _Size ) const
 {
-	if ( m_IsConstantBuffer )
-		m_Device.DXContext().HSSetConstantBuffers( _SlotIndex, 1, &m_pBuffer );
-	else
-		m_Device.DXContext().HSSetShaderResources( _SlotIndex, 1, &m_pShaderResourceView );
-}
-void	ConstantBuffer::SetDS( int _SlotIndex )
-{
-	if ( m_IsConstantBuffer )
-		m_Device.DXContext().DSSetConstantBuffers( _SlotIndex, 1, &m_pBuffer );
-	else
-		m_Device.DXContext().DSSetShaderResources( _SlotIndex, 1, &m_pShaderResourceView );
-}
-void	ConstantBuffer::SetGS( int _SlotIndex )
-{
-	if ( m_IsConstantBuffer )
-		m_Device.DXContext().GSSetConstantBuffers( _SlotIndex, 1, &m_pBuffer );
-	else
-		m_Device.DXContext().GSSetShaderResources( _SlotIndex, 1, &m_pShaderResourceView );
+	_Offset = 0;
+	_Size = m_PaddedSize;
+	if ( !m_bShadowValid )
+		return true;	// Everything changed
+
+	const U8*	pData = (const U8*) _pData;
+	if ( memcmp( pData, m_pShadow, m_Size ) == 0 )
+		return false;
+
+	int			First = 0;
+	while ( pData[First] == m_pShadow[First] )
+		First++;
+	int			Last = m_Size-1;
+	while ( pData[Last] == m_pShadow[Last] )
+		Last--;
+
+	_Offset = First & ~15;
+	_Size = MIN( ((Last + 16) & ~15), m_PaddedSize ) - _Offset;
+	return true;
 }
-void	ConstantBuffer::SetPS( int _SlotIndex )
+
+// The runtime copies the source data into its own upload memory and schedules the copy on the GPU timeline, so updating a range
+//	the GPU is still reading from the previous frame doesn't stall. Only the bytes of the range are transferred.
+void	ConstantBuffer::UpdateDataRange( const void* _pData, int _Offset, int _Size )
 {
-	if ( m_IsConstantBuffer )
-		m_Device.DXContext().PSSetConstantBuffers( _SlotIndex, 1, &m_pBuffer );
-	else
-		m_Device.DXContext().PSSetShaderResources( _SlotIndex, 1, &m_pShaderResourceView );
+	ASSERT( m_bPartialUpdates, "Buffer wasn't created for partial updates!" );
+	ASSERT( _Offset >= 0 && _Offset + _Size <= m_PaddedSize, "Range out of bounds!" );
+	if ( _Size <= 0 )
+		return;
+
+	D3D11_BOX	Box;
+	Box.left = _Offset;
+	Box.right = _Offset + _Size;
+	Box.top = 0;	Box.bottom = 1;
+	Box.front = 0;	Box.back = 1;
+	m_Device.DXContext().UpdateSubresource( m_pBuffer, 0, &Box, _pData, 0, 0 );
+	m_Device.CountUpload( _Size );
 }
-void	ConstantBuffer::SetCS( int _SlotIndex )
+
+// The device's shadow tables take the whole stage mask in a single call
+void	ConstantBuffer::Set( int _SlotIndex )	{ SetStages( m_ShaderStages, _SlotIndex ); }
+void	ConstantBuffer::SetVS( int _SlotIndex )	{ SetStages( Device::SSF_VERTEX_SHADER, _SlotIndex ); }
+void	ConstantBuffer::SetHS( int _SlotIndex )	{ SetStages( Device::SSF_HULL_SHADER, _SlotIndex ); }
+void	ConstantBuffer::SetDS( int _SlotIndex )	{ SetStages( Device::SSF_DOMAIN_SHADER, _SlotIndex ); }
+void	ConstantBuffer::SetGS( int _SlotIndex )	{ SetStages( Device::SSF_GEOMETRY_SHADER, _SlotIndex ); }
+void	ConstantBuffer::SetPS( int _SlotIndex )	{ SetStages( Device::SSF_PIXEL_SHADER, _SlotIndex ); }
+void	ConstantBuffer::SetCS( int _SlotIndex )	{ SetStages( Device::SSF_COMPUTE_SHADER, _SlotIndex ); }
+
+void	ConstantBuffer::SetStages( U32 _ShaderStages, int _SlotIndex )
 {
+	if ( m_pTransientData != NULL )
+	{
+		if ( m_Device.IsImmediate() )
+		{
+			if ( m_TransientGeneration != m_Device.ConstantRingGeneration() )
+				UpdateData( m_pTransientData );	// The ring wrapped since our last update, our range is gone
+
+			U32	NumConstants = ((m_PaddedSize >> 4) + 15) & ~15;
+			m_Device.SetConstantBufferRange( _ShaderStages, _SlotIndex, m_Device.ConstantRing(), m_TransientFirstConstant, NumConstants );
+			return;
+		}
+
+		// Deferred contexts can't bind ranges so fall back to our own buffer
+		const void*	pData = m_pTransientData;
+		bool		bTransient = m_bTransient;
+		m_bTransient = false;
+		UpdateData( pData );
+		m_bTransient = bTransient;
+	}
+
 	if ( m_IsConstantBuffer )
-		m_Device.DXContext().CSSetConstantBuffers( _SlotIndex, 1, &m_pBuffer );
+		m_Device.SetConstantBuffer( _ShaderStages, _SlotIndex, m_pBuffer );
 	else
-		m_Device.DXContext().CSSetShaderResources( _SlotIndex, 1, &m_pShaderResourceView );
+		m_Device.SetShaderResource( _ShaderStages, _SlotIndex, m_pShaderResourceView );
 }
@@ -7,9 +7,23 @@ class ConstantBuffer : public Component
 private:	// FIELDS
 
 	bool			m_IsConstantBuffer;
+	bool			m_bPartialUpdates;	// True if the buffer lives in default memory and supports range updates (cf. UpdateDataRange())
+	U32				m_ShaderStages;		// Combination of Device::SHADER_STAGE_FLAGS the buffer is bound to by Set()
+
+	// Transient constants are suballocated from the device's constant ring instead of renaming our own buffer (cf. SetTransient())
+	bool			m_bTransient;
+	const void*		m_pTransientData;	// Last data uploaded to the ring (NULL if our own buffer holds the data)
+	U32				m_TransientFirstConstant;
+	U32				m_TransientGeneration;
 	int				m_Size;
 	int				m_PaddedSize;
 
+	// The last data uploaded by the immediate context, so unchanged constants aren't uploaded again and only the changed range
+	//	is when the device supports partial constant buffer updates
+	U8*				m_pShadow;			// NULL for immutable buffers and tbuffers
+	bool			m_bShadowValid;		// False until the first upload or after an upload on a deferred context
+	bool			m_bDefaultUsage;	// True if the constant buffer lives in default memory to be partially updated
+
 	ID3D11Buffer*   m_pBuffer;
 	ID3D11ShaderResourceView*	m_pShaderResourceView;
 
@@ -17,13 +31,22 @@ public:	 // PROPERTIES
 
 	ID3D11Buffer*	GetBuffer()		{ return m_pBuffer; }
 
+	// Restricts the stages bound by Set() to the ones actually reading the buffer
+	U32				GetShaderStages() const				{ return m_ShaderStages; }
+	void			SetShaderStages( U32 _ShaderStages )	{ m_ShaderStages = _ShaderStages; }
+
+	// Makes UpdateData() allocate from the device's transient constant ring when D3D11.1 constant offsets are available
+	// Use this for constants updated once per draw, the data given to UpdateData() must stay valid until the next update.
+	void			SetTransient( bool _bTransient )		{ ASSERT( m_IsConstantBuffer, "Only constant buffers can be transient!" ); m_bTransient = _bTransient; m_pTransientData = NULL; }
+
 
 public:	 // METHODS
 
-	ConstantBuffer( Device& _Device, int _Size, void* _pData=NULL, bool _IsConstantBuffer=true );
+	ConstantBuffer( Device& _Device, int _Size, void* _pData=NULL, bool _IsConstantBuffer=true, bool _bPartialUpdates=false );
 	~ConstantBuffer();
 
 	void		UpdateData( const void* _pData );
+	void		UpdateDataRange( const void* _pData, int _Offset, int _Size );	// Only available for tbuffers created with partial updates
 
 	void		Set( int _SlotIndex );
 	void		SetVS( int _SlotIndex );
@@ -32,6 +55,14 @@ public:	 // METHODS
 	void		SetGS( int _SlotIndex );
 	void		SetPS( int _SlotIndex );
 	void		SetCS( int _SlotIndex );
+
+	// Transient buffers living in the device's constant ring have no buffer of their own
+	virtual U64	GetVideoMemorySize() const	{ return GetBufferSize( m_pBuffer ); }
+	virtual Device::MEMORY_CATEGORY	GetVideoMemoryCategory() const	{ return m_IsConstantBuffer ? Device::MC_CONSTANT_BUFFER : Device::MC_BUFFER; }
+
+private:
+	void		SetStages( U32 _ShaderStages, int _SlotIndex );
+	bool		FindChangedRange( const void* _pData, int& _Offset, int& _Size ) const;
 };
 
 template<typename T> class	CB : public ConstantBuffer
@@ -45,7 +76,11 @@ public:
 
 public:		// METHODS
 
-	CB( Device& _Device, int _SlotIndex, bool _bIKnowWhatImDoing=false ) : ConstantBuffer( _Device, sizeof(T) ), m_SlotIndex( _SlotIndex )	{ ASSERT( _SlotIndex >= 10 || _bIKnowWhatImDoing, "WARNING: Assigning a reserved constant buffer slot ! (i.e. all slots [0,9] are reserved for global constants)" ); }
+	CB( Device& _Device, int _SlotIndex, bool _bIKnowWhatImDoing=false, U32 _ShaderStages=Device::SSF_ALL ) : ConstantBuffer( _Device, sizeof(T) ), m_SlotIndex( _SlotIndex )
+	{
+		ASSERT( _SlotIndex >= 10 || _bIKnowWhatImDoing, "WARNING: Assigning a reserved constant buffer slot ! (i.e. all slots [0,9] are reserved for global constants)" );
+		SetShaderStages( _ShaderStages );
+	}
 	void		UpdateData()	{ ConstantBuffer::UpdateData( &m ); Set( m_SlotIndex ); }
 };
 
@@ -60,7 +95,7 @@ public:
 
 public:		// METHODS
 
-	TB( Device& _Device, int _SlotIndex, bool _bIKnowWhatImDoing=false ) : ConstantBuffer( _Device, N*sizeof(T), NULL, false ), m_SlotIndex( _SlotIndex )
+	TB( Device& _Device, int _SlotIndex, bool _bIKnowWhatImDoing=false, bool _bPartialUpdates=false ) : ConstantBuffer( _Device, N*sizeof(T), NULL, false, _bPartialUpdates ), m_SlotIndex( _SlotIndex )
 	{
 		ASSERT( _SlotIndex >= 10 || _bIKnowWhatImDoing, "WARNING: Assigning a reserved constant buffer slot ! (i.e. all slots [0,9] are reserved for global constants)" );
 		m = new T[N];
@@ -70,4 +105,10 @@ public:		// METHODS
 		delete[] m;
 	}
 	void		UpdateData()	{ ConstantBuffer::UpdateData( m ); Set( m_SlotIndex ); }
+	void		UpdateRange( int _FirstElement, int _ElementsCount )
+	{
+		ASSERT( _FirstElement >= 0 && _FirstElement + _ElementsCount <= N, "Element range out of bounds!" );
+		ConstantBuffer::UpdateDataRange( &m[_FirstElement], _FirstElement * sizeof(T), _ElementsCount * sizeof(T) );
+		Set( m_SlotIndex );
+	}
 };
\ No newline at end of file
@@ -0,0 +1,140 @@
+#include "DynamicGeometry.h"
+
+DynamicGeometry::DynamicGeometry( Device& _Device ) : Component( _Device )
+	, m_pVB( NULL )
+	, m_pIB( NULL )
+	, m_VBOffset( VERTEX_RING_SIZE )	// First append will discard
+	, m_IBOffset( INDEX_RING_SIZE )
+	, m_pBatchMaterial( NULL )
+	, m_pBatchFormat( NULL )
+	, m_BatchVerticesCount( 0 )
+{
+	{   // Create the vertex ring
+		D3D11_BUFFER_DESC   Desc;
+		Desc.ByteWidth = VERTEX_RING_SIZE;
+		Desc.Usage = D3D11_USAGE_DYNAMIC;
+		Desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		Desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		Desc.MiscFlags = 0;
+		Desc.StructureByteStride = 0;
+
+		Check( m_Device.DXDevice().CreateBuffer( &Desc, NULL, &m_pVB ) );
+	}
+
+	{   // Create the index ring
+		D3D11_BUFFER_DESC   Desc;
+		Desc.ByteWidth = INDEX_RING_SIZE;
+		Desc.Usage = D3D11_USAGE_DYNAMIC;
+		Desc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+		Desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		Desc.MiscFlags = 0;
+		Desc.StructureByteStride = 0;
+
+		Check( m_Device.DXDevice().CreateBuffer( &Desc, NULL, &m_pIB ) );
+	}
+}
+
+DynamicGeometry::~DynamicGeometry()
+{
+	ASSERT( m_pBatchMaterial == NULL, "A batch was not ended!" );
+
+	m_pVB->Release(); m_pVB = NULL;
+	m_pIB->Release(); m_pIB = NULL;
+}
+
+void	DynamicGeometry::Draw( Shader& _Material, D3D11_PRIMITIVE_TOPOLOGY _Topology, const IVertexFormatDescriptor& _Format, int _VerticesCount, const void* _pVertices, int _IndicesCount, const void* _pIndices, DXGI_FORMAT _IndexFormat )
+{
+	ASSERT( m_Device.CurrentMaterial() == &_Material, "Attempting to render with a material that is not the currently used material!" );
+	ASSERT( m_Device.IsImmediate(), "Dynamic geometry can only be drawn from the immediate context!" );
+	ASSERT( _pIndices == NULL || _IndexFormat == DXGI_FORMAT_R16_UINT || _IndexFormat == DXGI_FORMAT_R32_UINT, "Unsupported index format!" );
+	ASSERT( _Material.GetFormat().IsSubset( _Format ), "Material and geometry must use a compatible vertex format!" );
+	if ( _VerticesCount == 0 )
+		return;
+
+	ID3D11InputLayout*	pLayout = _Material.GetVertexLayout();
+	if ( pLayout == NULL )
+		return;	// Material is not initialied yet...
+
+	U32	Stride = _Format.Size();
+	U32	VBOffset = Append( m_pVB, VERTEX_RING_SIZE, m_VBOffset, Stride, _pVertices, _VerticesCount * Stride );
+
+	m_Device.SetInputLayout( pLayout );
+	m_Device.SetPrimitiveTopology( _Topology );
+	m_Device.SetVertexBuffers( 1, &m_pVB, &Stride, &VBOffset );
+	m_Device.CountDraw();
+
+	if ( _pIndices != NULL )
+	{
+		U32	IndexSize = _IndexFormat == DXGI_FORMAT_R16_UINT ? sizeof(U16) : sizeof(U32);
+		U32	IBOffset = Append( m_pIB, INDEX_RING_SIZE, m_IBOffset, IndexSize, _pIndices, _IndicesCount * IndexSize );
+
+		m_Device.SetIndexBuffer( m_pIB, _IndexFormat );
+		m_Device.FlushBindings();
+		m_Device.DXContext().DrawIndexed( _IndicesCount, IBOffset / IndexSize, 0 );
+	}
+	else
+	{
+		m_Device.SetIndexBuffer( NULL, DXGI_FORMAT_UNKNOWN );
+		m_Device.FlushBindings();
+		m_Device.DXContext().Draw( _VerticesCount, 0 );
+	}
+}
+
+void	DynamicGeometry::BeginBatch( Shader& _Material, D3D11_PRIMITIVE_TOPOLOGY _Topology, const IVertexFormatDescriptor& _Format )
+{
+	ASSERT( m_pBatchMaterial == NULL, "A batch is already started!" );
+	m_pBatchMaterial = &_Material;
+	m_BatchTopology = _Topology;
+	m_pBatchFormat = &_Format;
+	m_BatchVerticesCount = 0;
+}
+
+void*	DynamicGeometry::AddVertices( int _VerticesCount )
+{
+	ASSERT( m_pBatchMaterial != NULL, "No batch started!" );
+	U32	Stride = m_pBatchFormat->Size();
+	ASSERT( _VerticesCount * Stride <= BATCH_SIZE, "Too many vertices for a single batch!" );
+
+	if ( (m_BatchVerticesCount + _VerticesCount) * Stride > BATCH_SIZE )
+		FlushBatch();
+
+	void*	pVertices = m_pBatchVertices + m_BatchVerticesCount * Stride;
+	m_BatchVerticesCount += _VerticesCount;
+	return pVertices;
+}
+
+void	DynamicGeometry::EndBatch()
+{
+	ASSERT( m_pBatchMaterial != NULL, "No batch started!" );
+	FlushBatch();
+	m_pBatchMaterial = NULL;
+}
+
+void	DynamicGeometry::FlushBatch()
+{
+	Draw( *m_pBatchMaterial, m_BatchTopology, *m_pBatchFormat, m_BatchVerticesCount, m_pBatchVertices );
+	m_BatchVerticesCount = 0;
+}
+
+U32		DynamicGeometry::Append( ID3D11Buffer* _pBuffer, U32 _RingSize, U32& _RingOffset, U32 _Alignment, const void* _pData, U32 _Size )
+{
+	ASSERT( _Size <= _RingSize, "Dynamic geometry is too large for the ring!" );
+
+	// Align the offset so it's a whole amount of vertices/indices
+	U32			Offset = ((_RingOffset + _Alignment-1) / _Alignment) * _Alignment;
+	D3D11_MAP	MapType = D3D11_MAP_WRITE_NO_OVERWRITE;
+	if ( Offset + _Size > _RingSize )
+	{	// Wrap around
+		MapType = D3D11_MAP_WRITE_DISCARD;
+		Offset = 0;
+	}
+
+	D3D11_MAPPED_SUBRESOURCE	SubResource;
+	Check( m_Device.Map( _pBuffer, 0, MapType, SubResource, "DynamicGeometry" ) );
+	memcpy( (U8*) SubResource.pData + Offset, _pData, _Size );
+	m_Device.DXContext().Unmap( _pBuffer, 0 );
+	m_Device.CountUpload( _Size );
+
+	_RingOffset = Offset + _Size;
+	return Offset;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Component.h"
+#include "../Structures/VertexFormats.h"
+#include "Shader.h"
+
+// Vertex & index rings that dynamic geometry is appended to every frame (cf. Device::Dynamic())
+// Each draw's vertices and indices are written after the previous ones with NO_OVERWRITE so many small dynamic draws share the
+//	same buffers without renaming them, the rings are only mapped with DISCARD when they wrap around.
+// Draws can use any vertex format: vertices are bound at their byte offset in the ring so formats of different sizes can be mixed.
+//
+// Usage:
+//	m_Device.Dynamic().Draw( M, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST, VertexFormatPt4::DESCRIPTOR, 4, pVertices, 6, pIndices, DXGI_FORMAT_R16_UINT );
+//
+//	// Or batch debug lines/sprites immediate-mode style, the batch is drawn whenever it's full and when it's ended
+//	m_Device.Dynamic().BeginBatch( M, D3D11_PRIMITIVE_TOPOLOGY_LINELIST, VertexFormatP3T2::DESCRIPTOR );
+//	VertexFormatP3T2*	pLine = (VertexFormatP3T2*) m_Device.Dynamic().AddVertices( 2 );
+//	(...)
+//	m_Device.Dynamic().EndBatch();
+//
+// NOTE: NO_OVERWRITE isn't allowed on deferred contexts so dynamic geometry can only be drawn from the immediate context.
+class DynamicGeometry : public Component
+{
+public:		// CONSTANTS
+
+	static const U32		VERTEX_RING_SIZE = 2 << 20;
+	static const U32		INDEX_RING_SIZE = 1 << 20;
+	static const U32		BATCH_SIZE = 64 << 10;		// Size of the CPU buffer accumulating the batched vertices
+
+private:	// FIELDS
+
+	ID3D11Buffer*					m_pVB;
+	ID3D11Buffer*					m_pIB;
+	U32								m_VBOffset;			// Where the next vertices will be appended (in bytes)
+	U32								m_IBOffset;
+
+	// Current batch
+	Shader*							m_pBatchMaterial;	// NULL if no batch is started
+	D3D11_PRIMITIVE_TOPOLOGY		m_BatchTopology;
+	const IVertexFormatDescriptor*	m_pBatchFormat;
+	U8								m_pBatchVertices[BATCH_SIZE];
+	int								m_BatchVerticesCount;
+
+public:	 // METHODS
+
+	DynamicGeometry( Device& _Device );
+	~DynamicGeometry();
+
+	// Appends the geometry to the rings and draws it right away (_IndexFormat is either DXGI_FORMAT_R16_UINT or DXGI_FORMAT_R32_UINT)
+	void			Draw( Shader& _Material, D3D11_PRIMITIVE_TOPOLOGY _Topology, const IVertexFormatDescriptor& _Format, int _VerticesCount, const void* _pVertices, int _IndicesCount=0, const void* _pIndices=NULL, DXGI_FORMAT _IndexFormat=DXGI_FORMAT_R16_UINT );
+
+	// Immediate-mode batching of non-indexed geometry
+	void			BeginBatch( Shader& _Material, D3D11_PRIMITIVE_TOPOLOGY _Topology, const IVertexFormatDescriptor& _Format );
+	void*			AddVertices( int _VerticesCount );	// Returns where to write the vertices, always add whole primitives so a flush doesn't split them
+	void			EndBatch();
+
+private:
+
+	// Copies the data at the end of a ring and returns its offset (in bytes)
+	U32				Append( ID3D11Buffer* _pBuffer, U32 _RingSize, U32& _RingOffset, U32 _Alignment, const void* _pData, U32 _Size );
+	void			FlushBatch();
+};
@@ -0,0 +1,108 @@
+#include "GeometryPool.h"
+
+GeometryPool::GeometryPool( Device& _Device, int _MaxVerticesCount, int _MaxIndicesCount, DXGI_FORMAT _IndexFormat, const IVertexFormatDescriptor& _Format ) : Component( _Device )
+	, m_Format( _Format )
+	, m_IndexFormat( _IndexFormat )
+	, m_pVB( NULL )
+	, m_pIB( NULL )
+	, m_MaxVerticesCount( _MaxVerticesCount )
+	, m_MaxIndicesCount( _MaxIndicesCount )
+	, m_VerticesCount( 0 )
+	, m_IndicesCount( 0 )
+{
+	ASSERT( _IndexFormat == DXGI_FORMAT_R16_UINT || _IndexFormat == DXGI_FORMAT_R32_UINT, "Unsupported index format!" );
+	ASSERT( _MaxVerticesCount > 0, "Invalid pool size!" );
+	m_Stride = _Format.Size();
+
+	{   // Create the vertex buffer
+		D3D11_BUFFER_DESC   Desc;
+		Desc.ByteWidth = m_MaxVerticesCount * m_Stride;
+		Desc.Usage = D3D11_USAGE_DEFAULT;	// Filled by UpdateSubresource() as primitives get allocated
+		Desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		Desc.CPUAccessFlags = 0;
+		Desc.MiscFlags = 0;
+		Desc.StructureByteStride = 0;
+
+		Check( m_Device.DXDevice().CreateBuffer( &Desc, NULL, &m_pVB ) );
+	}
+
+	if ( m_MaxIndicesCount > 0 )
+	{   // Create the index buffer
+		D3D11_BUFFER_DESC   Desc;
+		Desc.ByteWidth = m_MaxIndicesCount * (m_IndexFormat == DXGI_FORMAT_R16_UINT ? sizeof(U16) : sizeof(U32));
+		Desc.Usage = D3D11_USAGE_DEFAULT;
+		Desc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+		Desc.CPUAccessFlags = 0;
+		Desc.MiscFlags = 0;
+		Desc.StructureByteStride = 0;
+
+		Check( m_Device.DXDevice().CreateBuffer( &Desc, NULL, &m_pIB ) );
+	}
+}
+
+GeometryPool::~GeometryPool()
+{
+	ASSERT( m_pVB != NULL, "Invalid vertex buffer to destroy !" );
+
+	m_Device.DeferRelease( m_pVB ); m_pVB = NULL;	// Frames in flight may still draw from them
+	m_Device.DeferRelease( m_pIB ); m_pIB = NULL;
+}
+
+void	GeometryPool::Reset()
+{
+	m_VerticesCount = 0;
+	m_IndicesCount = 0;
+}
+
+void	GeometryPool::Allocate( int _VerticesCount, const void* _pVertices, int _IndicesCount, const void* _pIndices, DXGI_FORMAT _IndexFormat, int& _BaseVertex, int& _StartIndex )
+{
+	ASSERT( CanAllocate( _VerticesCount, _IndicesCount ), "Geometry pool is full!" );
+	ASSERT( m_Device.IsImmediate(), "Geometry can only be allocated from the thread owning the immediate context!" );
+
+	_BaseVertex = m_VerticesCount;
+	_StartIndex = m_IndicesCount;
+
+	Write( _BaseVertex, _VerticesCount, _pVertices, _StartIndex, _IndicesCount, _pIndices, _IndexFormat );
+
+	m_VerticesCount += _VerticesCount;
+	if ( _pIndices != NULL )
+		m_IndicesCount += _IndicesCount;
+}
+
+void	GeometryPool::Write( int _BaseVertex, int _VerticesCount, const void* _pVertices, int _StartIndex, int _IndicesCount, const void* _pIndices, DXGI_FORMAT _IndexFormat )
+{
+	ASSERT( _BaseVertex + _VerticesCount <= m_MaxVerticesCount && _StartIndex + _IndicesCount <= m_MaxIndicesCount, "Writing outside of the pool!" );
+	ASSERT( m_Device.IsImmediate(), "Geometry can only be written from the thread owning the immediate context!" );
+
+	// Copy vertices
+	D3D11_BOX	Box;
+	Box.left = _BaseVertex * m_Stride;
+	Box.right = (_BaseVertex + _VerticesCount) * m_Stride;
+	Box.top = 0;	Box.bottom = 1;
+	Box.front = 0;	Box.back = 1;
+	m_Device.DXContext().UpdateSubresource( m_pVB, 0, &Box, _pVertices, 0, 0 );
+
+	if ( _pIndices == NULL || _IndicesCount == 0 )
+		return;
+
+	// Copy indices
+	ASSERT( m_pIB != NULL, "Pool was created without indices!" );
+	ASSERT( _IndexFormat == m_IndexFormat || _IndexFormat == DXGI_FORMAT_R16_UINT, "Can't store 32-bits indices into a 16-bits pool!" );
+
+	U32*			pWidenedIndices = NULL;
+	const void*		pIndices = _pIndices;
+	if ( _IndexFormat != m_IndexFormat )
+	{	// Widen the 16-bits indices
+		pWidenedIndices = new U32[_IndicesCount];
+		for ( int i=0; i < _IndicesCount; i++ )
+			pWidenedIndices[i] = ((const U16*) _pIndices)[i];
+		pIndices = pWidenedIndices;
+	}
+
+	U32	IndexSize = m_IndexFormat == DXGI_FORMAT_R16_UINT ? sizeof(U16) : sizeof(U32);
+	Box.left = _StartIndex * IndexSize;
+	Box.right = (_StartIndex + _IndicesCount) * IndexSize;
+	m_Device.DXContext().UpdateSubresource( m_pIB, 0, &Box, pIndices, 0, 0 );
+
+	delete[] pWidenedIndices;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Component.h"
+#include "../Structures/VertexFormats.h"
+
+// Large vertex & index buffers that static primitives are suballocated from (cf. the Primitive constructor taking a pool)
+// All the primitives of a pool share the same buffers and the same vertex format so consecutive draws only differ
+//	by their BaseVertexLocation/StartIndexLocation and the input assembler doesn't need to be rebound in between.
+// Space is allocated linearly and can only be reclaimed all at once with Reset(), this is meant for geometry that lives as long as the scene.
+class GeometryPool : public Component
+{
+private:	// FIELDS
+
+	const IVertexFormatDescriptor&	m_Format;
+	DXGI_FORMAT						m_IndexFormat;		// DXGI_FORMAT_R32_UINT or DXGI_FORMAT_R16_UINT
+	U32								m_Stride;
+
+	ID3D11Buffer*					m_pVB;
+	ID3D11Buffer*					m_pIB;
+	int								m_MaxVerticesCount;
+	int								m_MaxIndicesCount;
+	int								m_VerticesCount;	// Allocated so far
+	int								m_IndicesCount;
+
+
+public:	 // PROPERTIES
+
+	const IVertexFormatDescriptor&	GetFormat() const		{ return m_Format; }
+	DXGI_FORMAT		GetIndexFormat() const		{ return m_IndexFormat; }
+	int				GetVerticesCount() const	{ return m_VerticesCount; }
+	int				GetIndicesCount() const		{ return m_IndicesCount; }
+
+
+public:	 // METHODS
+
+	GeometryPool( Device& _Device, int _MaxVerticesCount, int _MaxIndicesCount, DXGI_FORMAT _IndexFormat, const IVertexFormatDescriptor& _Format );	// _IndexFormat is either DXGI_FORMAT_R16_UINT or DXGI_FORMAT_R32_UINT
+	~GeometryPool();
+
+	// The whole buffers, allocated or not (the primitives suballocated from the pool don't count them)
+	virtual U64		GetVideoMemorySize() const	{ return GetBufferSize( m_pVB ) + GetBufferSize( m_pIB ); }
+	virtual Device::MEMORY_CATEGORY	GetVideoMemoryCategory() const	{ return Device::MC_GEOMETRY; }
+
+	bool			CanAllocate( int _VerticesCount, int _IndicesCount ) const	{ return m_VerticesCount + _VerticesCount <= m_MaxVerticesCount && m_IndicesCount + _IndicesCount <= m_MaxIndicesCount; }
+
+	// Forgets about all the allocations
+	// The primitives allocated so far keep a reference to the buffers but their content will be overwritten by the next allocations
+	void			Reset();
+
+private:
+
+	// Copies the vertices & indices at the end of the buffers and returns where they were placed
+	// 16-bits indices are widened if the pool uses 32-bits indices
+	void			Allocate( int _VerticesCount, const void* _pVertices, int _IndicesCount, const void* _pIndices, DXGI_FORMAT _IndexFormat, int& _BaseVertex, int& _StartIndex );
+
+	// Copies the vertices & indices over an existing allocation (cf. Primitive::Rewrite())
+	void			Write( int _BaseVertex, int _VerticesCount, const void* _pVertices, int _StartIndex, int _IndicesCount, const void* _pIndices, DXGI_FORMAT _IndexFormat );
+
+	friend class Primitive;
+};
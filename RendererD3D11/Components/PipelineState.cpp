@@ -0,0 +1,66 @@
+#include "PipelineState.h"
+#include "Shader.h"
+#include "States.h"
+#include "ConstantBuffer.h"
+
+PipelineState::PipelineState( Shader& _Shader, RasterizerState* _pRasterizerState, DepthStencilState* _pDepthStencilState, BlendState* _pBlendState )
+	: m_Shader( _Shader )
+	, m_pRasterizerState( _pRasterizerState )
+	, m_pDepthStencilState( _pDepthStencilState )
+	, m_pBlendState( _pBlendState )
+	, m_TexturesCount( 0 )
+	, m_ConstantBuffersCount( 0 )
+	, m_bSealed( false )
+{
+	UpdateSortKey();
+}
+
+void	PipelineState::AddTexture( U32 _ShaderStages, int _SlotIndex, ID3D11ShaderResourceView* _pView )
+{
+	ASSERT( !m_bSealed, "Can't change a pipeline state once it was applied!" );
+	ASSERT( m_TexturesCount < MAX_STATIC_TEXTURES, "Too many static textures!" );
+	TextureBinding&	Binding = m_pTextures[m_TexturesCount++];
+	Binding.Stages = _ShaderStages;
+	Binding.Slot = _SlotIndex;
+	Binding.pView = _pView;
+}
+
+void	PipelineState::AddConstantBuffer( U32 _ShaderStages, int _SlotIndex, ConstantBuffer& _Buffer )
+{
+	ASSERT( !m_bSealed, "Can't change a pipeline state once it was applied!" );
+	ASSERT( m_ConstantBuffersCount < MAX_STATIC_CONSTANT_BUFFERS, "Too many static constant buffers!" );
+	ASSERT( _Buffer.GetBuffer() != NULL, "Transient constant buffers move within the constant ring and can't be bound statically!" );
+	ConstantBufferBinding&	Binding = m_pConstantBuffers[m_ConstantBuffersCount++];
+	Binding.Stages = _ShaderStages;
+	Binding.Slot = _SlotIndex;
+	Binding.pBuffer = _Buffer.GetBuffer();
+}
+
+// The states are immutable & shared by the device so their pointers identify them
+void	PipelineState::UpdateSortKey()
+{
+	// FNV-1a on the pointers, folded to 16 bits
+	const void*	ppStates[3] = { m_pRasterizerState, m_pDepthStencilState, m_pBlendState };
+	const void*	pShader = &m_Shader;
+
+	U32			ShaderHash = 2166136261U;
+	const U8*	pData = (const U8*) &pShader;
+	for ( int i=0; i < sizeof(pShader); i++ )
+		ShaderHash = (ShaderHash ^ pData[i]) * 16777619U;
+
+	U32			StatesHash = 2166136261U;
+	pData = (const U8*) ppStates;
+	for ( int i=0; i < sizeof(ppStates); i++ )
+		StatesHash = (StatesHash ^ pData[i]) * 16777619U;
+
+	m_SortKey = (((ShaderHash >> 16) ^ ShaderHash) << 16) | (((StatesHash >> 16) ^ StatesHash) & 0xFFFF);
+}
+
+void	PipelineState::BindStatic() const
+{
+	Device&	D = m_Shader.GetDevice();
+	for ( int TextureIndex=0; TextureIndex < m_TexturesCount; TextureIndex++ )
+		D.SetShaderResource( m_pTextures[TextureIndex].Stages, m_pTextures[TextureIndex].Slot, m_pTextures[TextureIndex].pView );
+	for ( int BufferIndex=0; BufferIndex < m_ConstantBuffersCount; BufferIndex++ )
+		D.SetConstantBuffer( m_pConstantBuffers[BufferIndex].Stages, m_pConstantBuffers[BufferIndex].Slot, m_pConstantBuffers[BufferIndex].pBuffer );
+}
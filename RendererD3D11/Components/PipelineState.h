@@ -0,0 +1,95 @@
+#pragma once
+#include "../Device.h"
+
+class	Shader;
+class	RasterizerState;
+class	DepthStencilState;
+class	BlendState;
+class	ConstantBuffer;
+
+// An immutable bundle of everything a draw needs besides its geometry and per-draw constants:
+//	the material (i.e. its shaders & input layout), the rasterizer, depth stencil & blend states and the "static" resources
+//	bound to fixed slots for every draw using it (e.g. the scene's constant buffers or a lookup texture)
+// Applying it with Device::SetPipelineState() diffs it against what the context currently uses: the material & states are skipped
+//	with a single comparison when the same pipeline state is applied again, otherwise only the ones that changed are sent.
+//	The static resources always go through the binding tables, which drop them unless another draw overwrote their slots.
+// The sort key groups the pipeline states by material first then by states, use it as the most significant bits of draw sort keys
+//	so draws sharing a pipeline state are submitted together.
+//
+// Usage:
+//	PipelineState*	pPSO = new PipelineState( *pMaterial, Device.m_pRS_CullBack, Device.m_pDS_ReadWriteLess, Device.m_pBS_Disabled );
+//	pPSO->AddConstantBuffer( Device::SSF_ALL, 9, *pCB_Scene );
+//	pPSO->AddTexture( Device::SSF_PIXEL_SHADER, 12, pTexLUT->GetSRV() );
+//	(...)
+//	if ( Device.SetPipelineState( *pPSO ) )
+//		Prim.Render( pPSO->GetShader() );
+//
+// NOTE: The static bindings must be added before the pipeline state is applied for the first time, it can't be changed afterward.
+//	Unlike the states, it's not a component since it holds no D3D object, only references to the material, states & resources.
+//	The material is referenced, not copied, so a recompiled material is picked up (the device forgets the current material at each Present()).
+class	PipelineState
+{
+public:		// CONSTANTS
+
+	static const int	MAX_STATIC_TEXTURES = 8;
+	static const int	MAX_STATIC_CONSTANT_BUFFERS = 4;
+
+protected:	// NESTED TYPES
+
+	struct	TextureBinding
+	{
+		U32							Stages;		// Combination of Device::SHADER_STAGE_FLAGS
+		int							Slot;
+		ID3D11ShaderResourceView*	pView;
+	};
+
+	struct	ConstantBufferBinding
+	{
+		U32							Stages;
+		int							Slot;
+		ID3D11Buffer*				pBuffer;
+	};
+
+protected:	// FIELDS
+
+	Shader&					m_Shader;
+	RasterizerState*		m_pRasterizerState;
+	DepthStencilState*		m_pDepthStencilState;
+	BlendState*				m_pBlendState;
+
+	TextureBinding			m_pTextures[MAX_STATIC_TEXTURES];
+	int						m_TexturesCount;
+	ConstantBufferBinding	m_pConstantBuffers[MAX_STATIC_CONSTANT_BUFFERS];
+	int						m_ConstantBuffersCount;
+
+	U32						m_SortKey;
+	mutable bool			m_bSealed;		// Set once applied
+
+public:		// PROPERTIES
+
+	Shader&				GetShader() const				{ return m_Shader; }
+	RasterizerState*	GetRasterizerState() const		{ return m_pRasterizerState; }
+	DepthStencilState*	GetDepthStencilState() const	{ return m_pDepthStencilState; }
+	BlendState*			GetBlendState() const			{ return m_pBlendState; }
+
+	// 16 bits of material hash then 16 bits of states hash
+	U32					GetSortKey() const				{ return m_SortKey; }
+
+public:		// METHODS
+
+	// NULL states are left as they are when the pipeline state is applied (like Device::SetStates())
+	PipelineState( Shader& _Shader, RasterizerState* _pRasterizerState, DepthStencilState* _pDepthStencilState, BlendState* _pBlendState );
+
+	// Static bindings, set on each stage of _ShaderStages when the pipeline state is applied
+	void		AddTexture( U32 _ShaderStages, int _SlotIndex, ID3D11ShaderResourceView* _pView );
+	void		AddConstantBuffer( U32 _ShaderStages, int _SlotIndex, ConstantBuffer& _Buffer );
+
+protected:
+
+	void		UpdateSortKey();
+
+	// Sends the static bindings to the device's binding tables (cf. Device::SetPipelineState())
+	void		BindStatic() const;
+
+	friend class	Device;
+};
@@ -7,12 +7,38 @@ Primitive::Primitive( Device& _Device, int _VerticesCount, const void* _pVertice
 	, m_Topology( _Topology )
 	, m_pVB( NULL )
 	, m_pIB( NULL )
+	, m_IndexFormat( DXGI_FORMAT_R32_UINT )
 	, m_BoundVertexStreamsCount( 0 )
+	, m_BaseVertex( 0 )
+	, m_StartIndex( 0 )
+	, m_bPooled( false )
+	, m_pDepthStream( NULL )
+	, m_DepthStreamOffset( 0 )
 {
 	m_Stride = _Format.Size();
 	Build( _pVertices, _pIndices, false );
 }
 
+Primitive::Primitive( Device& _Device, int _VerticesCount, const void* _pVertices, int _IndicesCount, const void* _pIndices, DXGI_FORMAT _IndexFormat, D3D11_PRIMITIVE_TOPOLOGY _Topology, const IVertexFormatDescriptor& _Format ) : Component( _Device )
+	, m_VerticesCount( _VerticesCount )
+	, m_IndicesCount( _IndicesCount )
+	, m_Format( _Format )
+	, m_Topology( _Topology )
+	, m_pVB( NULL )
+	, m_pIB( NULL )
+	, m_IndexFormat( _IndexFormat )
+	, m_BoundVertexStreamsCount( 0 )
+	, m_BaseVertex( 0 )
+	, m_StartIndex( 0 )
+	, m_bPooled( false )
+	, m_pDepthStream( NULL )
+	, m_DepthStreamOffset( 0 )
+{
+	ASSERT( _IndexFormat == DXGI_FORMAT_R16_UINT || _IndexFormat == DXGI_FORMAT_R32_UINT, "Unsupported index format!" );
+	m_Stride = _Format.Size();
+	Build( _pVertices, _pIndices, false );
+}
+
 Primitive::Primitive( Device& _Device, const IVertexFormatDescriptor& _Format ) : Component( _Device )
 	, m_Format( _Format )
 	, m_VerticesCount( 0 )
@@ -20,31 +46,74 @@ Primitive::Primitive( Device& _Device, const IVertexFormatDescriptor& _Format )
 	, m_Topology( D3D11_PRIMITIVE_TOPOLOGY_UNDEFINED )
 	, m_pVB( NULL )
 	, m_pIB( NULL )
+	, m_IndexFormat( DXGI_FORMAT_R32_UINT )
 	, m_BoundVertexStreamsCount( 0 )
+	, m_BaseVertex( 0 )
+	, m_StartIndex( 0 )
+	, m_bPooled( false )
+	, m_pDepthStream( NULL )
+	, m_DepthStreamOffset( 0 )
 {
 	m_Stride = _Format.Size();
 	// Deferred construction...
 }
 
-Primitive::Primitive( Device& _Device, int _VerticesCount, int _IndicesCount, D3D11_PRIMITIVE_TOPOLOGY _Topology, const IVertexFormatDescriptor& _Format ) : Component( _Device )
+Primitive::Primitive( Device& _Device, int _VerticesCount, int _IndicesCount, D3D11_PRIMITIVE_TOPOLOGY _Topology, const IVertexFormatDescriptor& _Format, DXGI_FORMAT _IndexFormat ) : Component( _Device )
 	, m_VerticesCount( _VerticesCount )
 	, m_IndicesCount( _IndicesCount )
 	, m_Format( _Format )
 	, m_Topology( _Topology )
 	, m_pVB( NULL )
 	, m_pIB( NULL )
+	, m_IndexFormat( _IndexFormat )
 	, m_BoundVertexStreamsCount( 0 )
+	, m_BaseVertex( 0 )
+	, m_StartIndex( 0 )
+	, m_bPooled( false )
+	, m_pDepthStream( NULL )
+	, m_DepthStreamOffset( 0 )
 {
 	m_Stride = _Format.Size();
 	Build( NULL, NULL, true );
 }
 
+Primitive::Primitive( GeometryPool& _Pool, int _VerticesCount, const void* _pVertices, int _IndicesCount, const void* _pIndices, DXGI_FORMAT _IndexFormat, D3D11_PRIMITIVE_TOPOLOGY _Topology ) : Component( _Pool.GetDevice() )
+	, m_VerticesCount( _VerticesCount )
+	, m_IndicesCount( _IndicesCount )
+	, m_Format( _Pool.GetFormat() )
+	, m_Topology( _Topology )
+	, m_pVB( NULL )
+	, m_pIB( NULL )
+	, m_IndexFormat( _Pool.GetIndexFormat() )
+	, m_BoundVertexStreamsCount( 0 )
+	, m_BaseVertex( 0 )
+	, m_StartIndex( 0 )
+	, m_bPooled( true )
+	, m_pDepthStream( NULL )
+	, m_DepthStreamOffset( 0 )
+{
+	m_Stride = m_Format.Size();
+	_Pool.Allocate( _VerticesCount, _pVertices, _IndicesCount, _pIndices, _IndexFormat, m_BaseVertex, m_StartIndex );
+
+	// Share the pool's buffers
+	m_pVB = _Pool.m_pVB;
+	m_pVB->AddRef();
+	if ( _pIndices != NULL )
+	{
+		m_pIB = _Pool.m_pIB;
+		m_pIB->AddRef();
+	}
+
+	InitRenderParameters( _pIndices != NULL );
+}
+
 Primitive::~Primitive()
 {
 	ASSERT( m_pVB != NULL, "Invalid vertex buffer to destroy !" );
 
-	m_pVB->Release(); m_pVB = NULL;
-	if ( m_pIB != NULL ) m_pIB->Release(); m_pIB = NULL;
+	delete m_pDepthStream;
+	m_Device.DeferRelease( m_pVB ); m_pVB = NULL;	// Frames in flight may still draw from them
+	m_Device.DeferRelease( m_pIB ); m_pIB = NULL;
 }
 
 void	Primitive::Render( Shader& _Material )
@@ -53,33 +122,17 @@ void	Primitive::Render( Shader& _Material )
 }
 void	Primitive::Render( Shader& _Material, int _StartVertex, int _VerticesCount, int _StartIndex, int _IndicesCount, int _BaseVertexOffset )
 {
-	ASSERT( m_Device.CurrentMaterial() == &_Material, "Attempting to render with a material that is not the currently used material!" );
-
-	ID3D11InputLayout*	pLayout = _Material.GetVertexLayout();
-	if ( pLayout == NULL )
+	if ( !Bind( _Material ) )
 		return;	// Material is not initialied yet...
 
-	// Ensure material & primitive use the same vertex format
-	const IVertexFormatDescriptor&	PrimitiveFormat = m_BoundVertexStreamsCount == 1 ? m_Format : m_CompositeFormat;
-//	ASSERT( PrimitiveFormat == _Material.GetFormat(), "Material and Primitive must use the same vertex format !" );
-	ASSERT( _Material.GetFormat().IsSubset( PrimitiveFormat ), "Material and Primitive must use a compatible vertex format!" );
-
-	m_Device.DXContext().IASetInputLayout( pLayout );
-	m_Device.DXContext().IASetPrimitiveTopology( m_Topology );
-
-	U32 Offset = 0;
-//	m_Device.DXContext().IASetVertexBuffers( 0, 1, &m_pVB, &m_Stride, &Offset );
-	m_Device.DXContext().IASetVertexBuffers( 0, m_BoundVertexStreamsCount, m_ppVertexBuffers, m_pStrides, m_pOffsets );
-
+	m_Device.CountDraw();
 	if ( m_pIB != NULL )
 	{
-		m_Device.DXContext().IASetIndexBuffer( m_pIB, DXGI_FORMAT_R32_UINT, 0 );
-		m_Device.DXContext().DrawIndexed( _IndicesCount, _StartIndex, _BaseVertexOffset );
+		m_Device.DXContext().DrawIndexed( _IndicesCount, m_StartIndex + _StartIndex, m_BaseVertex + _BaseVertexOffset );
 	}
 	else
 	{
-		m_Device.DXContext().IASetIndexBuffer( NULL, DXGI_FORMAT_UNKNOWN, 0 );
-		m_Device.DXContext().Draw( _VerticesCount, _StartVertex );
+		m_Device.DXContext().Draw( _VerticesCount, m_BaseVertex + _StartVertex );
 	}
 }
 
@@ -88,38 +141,65 @@ void	Primitive::RenderInstanced( Shader& _Material, int _InstancesCount )
 	RenderInstanced( _Material, _InstancesCount, 0, m_VerticesCount, 0, m_IndicesCount, 0 );
 }
 void	Primitive::RenderInstanced( Shader& _Material, int _InstancesCount, int _StartVertex, int _VerticesCount, int _StartIndex, int _IndicesCount, int _BaseVertexOffset )
+{
+	if ( !Bind( _Material ) )
+		return;	// Material is not initialied yet...
+
+	m_Device.CountDraw();
+	if ( m_pIB != NULL )
+	{
+		m_Device.DXContext().DrawIndexedInstanced( _IndicesCount, _InstancesCount, m_StartIndex + _StartIndex, m_BaseVertex + _BaseVertexOffset, 0 );
+	}
+	else
+	{
+		m_Device.DXContext().DrawInstanced( _VerticesCount, _InstancesCount, m_BaseVertex + _StartVertex, 0 );
+	}
+}
+
+void	Primitive::RenderIndirect( Shader& _Material, StructuredBuffer& _Args, U32 _ByteOffset )
+{
+	ASSERT( (_ByteOffset & 3) == 0, "Indirect arguments must be 4 bytes aligned!" );
+	if ( !Bind( _Material ) )
+		return;	// Material is not initialied yet...
+
+	m_Device.CountDraw();
+	if ( m_pIB != NULL )
+		m_Device.DXContext().DrawIndexedInstancedIndirect( _Args.GetBuffer(), _ByteOffset );
+	else
+		m_Device.DXContext().DrawInstancedIndirect( _Args.GetBuffer(), _ByteOffset );
+}
+
+bool	Primitive::Bind( Shader& _Material )
 {
 	ASSERT( m_Device.CurrentMaterial() == &_Material, "Attempting to render with a material that is not the currently used material!" );
 
 	ID3D11InputLayout*	pLayout = _Material.GetVertexLayout();
 	if ( pLayout == NULL )
-		return;	// Material is not initialied yet...
+		return false;
 
 	// Ensure material & primitive use the same vertex format
 	const IVertexFormatDescriptor&	PrimitiveFormat = m_BoundVertexStreamsCount == 1 ? m_Format : m_CompositeFormat;
 //	ASSERT( PrimitiveFormat == _Material.GetFormat(), "Material and Primitive must use the same vertex format !" );
 	ASSERT( _Material.GetFormat().IsSubset( PrimitiveFormat ), "Material and Primitive must use a compatible vertex format!" );
 
-	m_Device.DXContext().IASetInputLayout( pLayout );
-	m_Device.DXContext().IASetPrimitiveTopology( m_Topology );
-
-	U32 Offset = 0;
-//	m_Device.DXContext().IASetVertexBuffers( 0, 1, &m_pVB, &m_Stride, &Offset );
-	m_Device.DXContext().IASetVertexBuffers( 0, m_BoundVertexStreamsCount, m_ppVertexBuffers, m_pStrides, m_pOffsets );
-
+	// Redundant changes are dropped by the device, primitives sharing a GeometryPool only differ by their offsets
+	m_Device.SetInputLayout( pLayout );
+	m_Device.SetPrimitiveTopology( m_Topology );
+	if ( m_pDepthStream != NULL && &_Material.GetFormat() == &m_pDepthStream->m_Format )
+		m_Device.SetVertexBuffers( 1, &m_pDepthStream->m_pVB, &m_pDepthStream->m_Stride, &m_DepthStreamOffset );	// Depth-only material
+	else
+		m_Device.SetVertexBuffers( m_BoundVertexStreamsCount, m_ppVertexBuffers, m_pStrides, m_pOffsets );
 	if ( m_pIB != NULL )
-	{
-		m_Device.DXContext().IASetIndexBuffer( m_pIB, DXGI_FORMAT_R32_UINT, 0 );
-		m_Device.DXContext().DrawIndexedInstanced( _IndicesCount, _InstancesCount, _StartIndex, _BaseVertexOffset, 0 );
-	}
+		m_Device.SetIndexBuffer( m_pIB, m_IndexFormat );
 	else
-	{
-		m_Device.DXContext().IASetIndexBuffer( NULL, DXGI_FORMAT_UNKNOWN, 0 );
-		m_Device.DXContext().DrawInstanced( _VerticesCount, _InstancesCount, _StartVertex, 0 );
-	}
+		m_Device.SetIndexBuffer( NULL, DXGI_FORMAT_UNKNOWN );
+
+	m_Device.FlushBindings();
+
+	return true;
 }
 
-void	Primitive::Build( const void* _pVertices, const U32* _pIndices, bool _bDynamic )
+void	Primitive::Build( const void* _pVertices, const void* _pIndices, bool _bDynamic )
 {
 //	ASSERT( m_VerticesCount <= 65536, "Time to upgrade to U32 indices!" );
 
@@ -143,23 +223,14 @@ void	Primitive::Build( const void* _pVertices, const U32* _pIndices, bool _bDyna
 		}
 		else
 			Check( m_Device.DXDevice().CreateBuffer( &Desc, NULL, &m_pVB ) );
-
-		// Initialize as if we had only one bound vertex stream
-#ifdef _DEBUG
-		m_ppBoundPrimitives[0] = this;	// We're the first and only bound primitive at the time
-#endif
-		m_BoundVertexStreamsCount = 1;
-		m_ppVertexBuffers[0] = m_pVB;
-		m_pStrides[0] = m_Stride;
-		m_pOffsets[0] = 0;
-		m_CompositeFormat.AggregateVertexFormat( m_Format );
 	}
 
-	if ( _pIndices != NULL )
+	bool	bIndexed = _pIndices != NULL || (_bDynamic && m_IndicesCount > 0);
+	if ( bIndexed )
 	{   // Create the index buffer
 		D3D11_BUFFER_DESC   Desc;
 //		Desc.ByteWidth = m_IndicesCount * sizeof(U16);		 // For now, we only support U16 primitives
-		Desc.ByteWidth = m_IndicesCount * sizeof(U32);
+		Desc.ByteWidth = m_IndicesCount * (m_IndexFormat == DXGI_FORMAT_R16_UINT ? sizeof(U16) : sizeof(U32));
 		Desc.Usage = _bDynamic ? D3D11_USAGE_DYNAMIC : D3D11_USAGE_IMMUTABLE;
 		Desc.BindFlags = D3D11_BIND_INDEX_BUFFER;
 		Desc.CPUAccessFlags = _bDynamic ? D3D11_CPU_ACCESS_WRITE : 0;
@@ -179,58 +250,87 @@ void	Primitive::Build( const void* _pVertices, const U32* _pIndices, bool _bDyna
 			Check( m_Device.DXDevice().CreateBuffer( &Desc, NULL, &m_pIB ) );
 	}
 
+	InitRenderParameters( bIndexed );
+}
+
+void	Primitive::InitRenderParameters( bool _bIndexed )
+{
+	// Initialize as if we had only one bound vertex stream
+#ifdef _DEBUG
+	m_ppBoundPrimitives[0] = this;	// We're the first and only bound primitive at the time
+#endif
+	m_BoundVertexStreamsCount = 1;
+	m_ppVertexBuffers[0] = m_pVB;
+	m_pStrides[0] = m_Stride;
+	m_pOffsets[0] = 0;	// Our draws start at m_BaseVertex
+	m_CompositeFormat.AggregateVertexFormat( m_Format );
+
 	switch ( m_Topology )
 	{
 	case D3D11_PRIMITIVE_TOPOLOGY_POINTLIST:
-		m_FacesCount = _pIndices != NULL ? m_IndicesCount : m_VerticesCount;
+		m_FacesCount = _bIndexed ? m_IndicesCount : m_VerticesCount;
 		break;
 
 	case D3D11_PRIMITIVE_TOPOLOGY_LINELIST:
-		m_FacesCount = _pIndices != NULL ? m_IndicesCount / 2 : m_VerticesCount / 2;
+		m_FacesCount = _bIndexed ? m_IndicesCount / 2 : m_VerticesCount / 2;
 		break;
 
 	case D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST:
-		m_FacesCount = _pIndices != NULL ? m_IndicesCount / 3 : m_VerticesCount / 3;
+		m_FacesCount = _bIndexed ? m_IndicesCount / 3 : m_VerticesCount / 3;
 		break;
 
 	case D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP:
-		m_FacesCount = _pIndices != NULL ? m_IndicesCount - 2 : m_VerticesCount - 2;
+		m_FacesCount = _bIndexed ? m_IndicesCount - 2 : m_VerticesCount - 2;
 		break;
 
 	default:
 		if ( m_Topology >= D3D11_PRIMITIVE_TOPOLOGY_1_CONTROL_POINT_PATCHLIST && m_Topology <= D3D11_PRIMITIVE_TOPOLOGY_32_CONTROL_POINT_PATCHLIST )
 		{	// For patches, it depends on the amount of control points
 			int	ControlPointsPerPatch = 1 + (m_Topology - D3D11_PRIMITIVE_TOPOLOGY_1_CONTROL_POINT_PATCHLIST);
-			m_FacesCount = (_pIndices != NULL ? m_IndicesCount : m_VerticesCount) / ControlPointsPerPatch;
+			m_FacesCount = (_bIndexed ? m_IndicesCount : m_VerticesCount) / ControlPointsPerPatch;
 		}
 		else
 			ASSERT( FALSE, "Unsupported primitive type !" );
 	}
 }
 
-void	Primitive::UpdateDynamic( void* _pVertices, U16* _pIndices, int _VerticesCount, int _IndicesCount )
+void	Primitive::UpdateDynamic( const void* _pVertices, const void* _pIndices, int _VerticesCount, int _IndicesCount )
 {
 	ASSERT( _pVertices != NULL, "Invalid vertices !" );
+	ASSERT( _VerticesCount <= m_VerticesCount && _IndicesCount <= m_IndicesCount, "Dynamic buffers are too small!" );
 	{
 		D3D11_MAPPED_SUBRESOURCE	SubResource;
-		Device::Check( m_Device.DXContext().Map( m_pVB, 0, D3D11_MAP_WRITE_DISCARD, 0, &SubResource ) );
-		memcpy( SubResource.pData, _pVertices, (_VerticesCount != -1 ? _VerticesCount : m_VerticesCount) * m_Stride );
+		Device::Check( m_Device.Map( m_pVB, 0, D3D11_MAP_WRITE_DISCARD, SubResource, "Primitive::UpdateDynamic (vertices)" ) );
+		U32	Size = (_VerticesCount != -1 ? _VerticesCount : m_VerticesCount) * m_Stride;
+		memcpy( SubResource.pData, _pVertices, Size );
 		m_Device.DXContext().Unmap( m_pVB, 0 );
+		m_Device.CountUpload( Size );
 	}
 
 	if ( _pIndices != NULL )
 	{
+		ASSERT( m_pIB != NULL, "Primitive has no index buffer!" );
 		D3D11_MAPPED_SUBRESOURCE	SubResource;
-		Device::Check( m_Device.DXContext().Map( m_pIB, 0, D3D11_MAP_WRITE_DISCARD, 0, &SubResource ) );
-		memcpy( SubResource.pData, _pVertices, (_IndicesCount != -1 ? _IndicesCount : m_IndicesCount) * sizeof(U16) );
+		Device::Check( m_Device.Map( m_pIB, 0, D3D11_MAP_WRITE_DISCARD, SubResource, "Primitive::UpdateDynamic (indices)" ) );
+		U32	Size = (_IndicesCount != -1 ? _IndicesCount : m_IndicesCount) * (m_IndexFormat == DXGI_FORMAT_R16_UINT ? sizeof(U16) : sizeof(U32));
+		memcpy( SubResource.pData, _pIndices, Size );
 		m_Device.DXContext().Unmap( m_pIB, 0 );
+		m_Device.CountUpload( Size );
 	}
 }
 
+void	Primitive::Rewrite( GeometryPool& _Pool, const void* _pVertices, int _IndicesCount, const void* _pIndices, DXGI_FORMAT _IndexFormat )
+{
+	ASSERT( m_bPooled && _Pool.m_pVB == m_pVB, "Primitive was not allocated from that pool!" );
+	ASSERT( _IndicesCount <= m_IndicesCount && (_pIndices == NULL || m_pIB != NULL), "Too many indices for the allocation!" );
+	_Pool.Write( m_BaseVertex, m_VerticesCount, _pVertices, m_StartIndex, _IndicesCount, _pIndices, _IndexFormat );
+}
+
 void	Primitive::BindVertexStream( U32 _StreamIndex, Primitive& _BoundPrimitive, int _StartIndex )
 {
 	ASSERT( _StreamIndex < MAX_BOUND_VERTEX_STREAMS, "Stream index out of range!" );
 	ASSERT( _StreamIndex <= m_BoundVertexStreamsCount, "Stream index out of range! You must bind streams sequentially!" );
+	bool	bNewStream = _StreamIndex == m_BoundVertexStreamsCount;
 	m_BoundVertexStreamsCount = MAX( m_BoundVertexStreamsCount, _StreamIndex+1 );
 
 #ifdef _DEBUG
@@ -238,47 +338,55 @@ void	Primitive::BindVertexStream( U32 _StreamIndex, Primitive& _BoundPrimitive,
 #endif
 	m_ppVertexBuffers[_StreamIndex] = _BoundPrimitive.m_pVB;
 	m_pStrides[_StreamIndex] = _BoundPrimitive.m_Stride;
-	m_pOffsets[_StreamIndex] = _StartIndex * _BoundPrimitive.m_Format.Size();	// The offset is in BYTES!
+	int	StartVertex = _BoundPrimitive.m_BaseVertex + _StartIndex - m_BaseVertex;	// Our draws add m_BaseVertex to the vertex index of all streams
+	ASSERT( StartVertex >= 0, "Bound vertex stream starts before our base vertex!" );
+	m_pOffsets[_StreamIndex] = StartVertex * _BoundPrimitive.m_Format.Size();	// The offset is in BYTES!
 
 	// Aggregate vertex format into our composite format
 	// This format will be used at runtime to compare with rendering material format instead of the simple original format the primitive was constructed with...
-	m_CompositeFormat.AggregateVertexFormat( _BoundPrimitive.m_Format );
+	if ( bNewStream )
+		m_CompositeFormat.AggregateVertexFormat( _BoundPrimitive.m_Format );
+}
+
+void	Primitive::SetDepthStream( Primitive* _pDepthPrimitive )
+{
+	ASSERT( _pDepthPrimitive == NULL || _pDepthPrimitive->m_VerticesCount == m_VerticesCount, "The depth stream must have the same vertices!" );
+
+	delete m_pDepthStream;
+	m_pDepthStream = _pDepthPrimitive;
+	if ( m_pDepthStream == NULL )
+		return;
+
+	// Same as BindVertexStream(), our draws add m_BaseVertex to the vertex index
+	int	StartVertex = m_pDepthStream->m_BaseVertex - m_BaseVertex;
+	ASSERT( StartVertex >= 0, "Depth stream starts before our base vertex!" );
+	m_DepthStreamOffset = StartVertex * m_pDepthStream->m_Stride;
 }
 
 #ifdef SUPPORT_GEO_BUILDERS
 
 // IGeometryWriter Implementation
-void	Primitive::CreateBuffers( int _VerticesCount, int _IndicesCount, D3D11_PRIMITIVE_TOPOLOGY _Topology, void*& _pVertices, void*& _pIndices )
+void	Primitive::Write( int _VerticesCount, const GeometryBuilder::Vertex* _pVertices, int _IndicesCount, const void* _pIndices, DXGI_FORMAT _IndexFormat, D3D11_PRIMITIVE_TOPOLOGY _Topology )
 {
-	ASSERT( _VerticesCount <= 65536, "Too many vertices !" );	// Time to start accounting for large meshes d00d !
+	ASSERT( _IndexFormat == DXGI_FORMAT_R16_UINT || _IndexFormat == DXGI_FORMAT_R32_UINT, "Unsupported index format!" );
 
 	m_VerticesCount = _VerticesCount;
 	m_IndicesCount = _IndicesCount;
+	m_IndexFormat = _IndexFormat;
 	m_Topology = _Topology;
 
-	_pVertices = new U8[m_VerticesCount * m_Format.Size()];
-	_pIndices = new U32[m_IndicesCount];
-}
-
-void	Primitive::AppendVertex( void*& _pVertex, const float3& _Position, const float3& _Normal, const float3& _Tangent, const float3& _BiTangent, const float2& _UV )
-{
-	m_Format.Write( _pVertex, _Position, _Normal, _Tangent, _BiTangent, _UV );
-	_pVertex = (void*) ((U8*) _pVertex + m_Format.Size());
-}
-
-void	Primitive::AppendIndex( void*& _pIndex, int _Index )
-{
-	ASSERT( _Index < m_VerticesCount, "Index out of range !" );
-	*((U32*) _pIndex) = _Index;
-	_pIndex = (void*) ((U8*) _pIndex + sizeof(U32));
-}
+	// Convert the vertices into our format
+	U8*	pVertices = new U8[m_VerticesCount * m_Stride];
+	U8*	pVertex = pVertices;
+	for ( int VertexIndex=0; VertexIndex < m_VerticesCount; VertexIndex++, pVertex+=m_Stride )
+	{
+		const GeometryBuilder::Vertex&	V = _pVertices[VertexIndex];
+		m_Format.Write( pVertex, V.Position, V.Normal, V.Tangent, V.BiTangent, V.UV );
+	}
 
-void	Primitive::Finalize( void* _pVertices, void* _pIndices )
-{
-	Build( _pVertices, (U32*) _pIndices, false );
+	Build( pVertices, _pIndices, false );
 
-	delete[] _pVertices;
-	delete[] _pIndices;
+	delete[] pVertices;
 }
 
 #endif
\ No newline at end of file
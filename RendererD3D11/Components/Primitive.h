@@ -7,6 +7,8 @@
 #include "Component.h"
 #include "../Structures/VertexFormats.h"
 #include "Shader.h"
+#include "GeometryPool.h"
+#include "StructuredBuffer.h"
 
 #ifdef SUPPORT_GEO_BUILDERS
 #include "../../Procedural/GeometryBuilder.h"
@@ -26,10 +28,14 @@ private:	// FIELDS
 
 	ID3D11Buffer*					m_pVB;
 	ID3D11Buffer*					m_pIB;
+	DXGI_FORMAT						m_IndexFormat;		// DXGI_FORMAT_R32_UINT or DXGI_FORMAT_R16_UINT
 	int								m_VerticesCount;
 	int								m_IndicesCount;
 	int								m_FacesCount;
 	U32								m_Stride;
+	int								m_BaseVertex;		// Where our vertices start in the vertex buffer (0 unless suballocated from a GeometryPool)
+	int								m_StartIndex;		// Where our indices start in the index buffer (0 unless suballocated from a GeometryPool)
+	bool							m_bPooled;			// True if the buffers belong to a GeometryPool (which then accounts for their memory)
 
 	// Render parameters
 	U32								m_BoundVertexStreamsCount;
@@ -41,27 +47,50 @@ private:	// FIELDS
 	Primitive*						m_ppBoundPrimitives[MAX_BOUND_VERTEX_STREAMS];	// The primitive that contains the vertex stream to bind to our primitive
 #endif
 
+	// Position-only stream bound instead of the streams above for depth passes (cf. SetDepthStream())
+	Primitive*						m_pDepthStream;
+	U32								m_DepthStreamOffset;
+
 
 public:	 // PROPERTIES
 
 	int				GetVerticesCount() const	{ return m_VerticesCount; }
 	int				GetIndicesCount() const		{ return m_IndicesCount; }
 	int				GetFacesCount() const		{ return m_FacesCount; }
+	int				GetBaseVertex() const		{ return m_BaseVertex; }
+	int				GetStartIndex() const		{ return m_StartIndex; }
+	Primitive*		GetDepthStream() const		{ return m_pDepthStream; }
 
 
 public:	 // METHODS
 
 	Primitive( Device& _Device, int _VerticesCount, const void* _pVertices, int _IndicesCount, const U32* _pIndices, D3D11_PRIMITIVE_TOPOLOGY _Topology, const IVertexFormatDescriptor& _Format );
+	Primitive( Device& _Device, int _VerticesCount, const void* _pVertices, int _IndicesCount, const void* _pIndices, DXGI_FORMAT _IndexFormat, D3D11_PRIMITIVE_TOPOLOGY _Topology, const IVertexFormatDescriptor& _Format );	// _IndexFormat is either DXGI_FORMAT_R16_UINT or DXGI_FORMAT_R32_UINT
 	Primitive( Device& _Device, const IVertexFormatDescriptor& _Format );	// Used by geometry builders
-	Primitive( Device& _Device, int _VerticesCount, int _IndicesCount, D3D11_PRIMITIVE_TOPOLOGY _Topology, const IVertexFormatDescriptor& _Format );	// Used to build dynamic buffers
+	Primitive( Device& _Device, int _VerticesCount, int _IndicesCount, D3D11_PRIMITIVE_TOPOLOGY _Topology, const IVertexFormatDescriptor& _Format, DXGI_FORMAT _IndexFormat=DXGI_FORMAT_R16_UINT );	// Used to build dynamic buffers (no index buffer if _IndicesCount is 0)
+	Primitive( GeometryPool& _Pool, int _VerticesCount, const void* _pVertices, int _IndicesCount, const void* _pIndices, DXGI_FORMAT _IndexFormat, D3D11_PRIMITIVE_TOPOLOGY _Topology );	// Suballocates static geometry from the pool's buffers, using the pool's vertex format
 	~Primitive();
 
+	virtual U64		GetVideoMemorySize() const	{ return m_bPooled ? 0 : GetBufferSize( m_pVB ) + GetBufferSize( m_pIB ); }
+	virtual Device::MEMORY_CATEGORY	GetVideoMemoryCategory() const	{ return Device::MC_GEOMETRY; }
+
 	void			Render( Shader& _Material );
 	void			Render( Shader& _Material, int _StartVertex, int _VerticesCount, int _StartIndex, int _IndicesCount, int _BaseVertexOffset );
 	void			RenderInstanced( Shader& _Material, int _InstancesCount );
 	void			RenderInstanced( Shader& _Material, int _InstancesCount, int _StartVertex, int _VerticesCount, int _StartIndex, int _IndicesCount, int _BaseVertexOffset );
 
-	void			UpdateDynamic( void* _pVertices, U16* _pIndices, int _VerticesCount=-1, int _IndicesCount=-1 );
+	// Renders with the arguments written by the GPU in _Args at _ByteOffset (created with StructuredBuffer::DRAW_INDIRECT_ARGS)
+	//	Indexed primitives read 5 U32 { IndicesCount, InstancesCount, StartIndex, BaseVertex, StartInstance }, the others 4 U32 { VerticesCount, InstancesCount, StartVertex, StartInstance }
+	// NOTE: The arguments are absolute, add GetStartIndex()/GetBaseVertex() yourself for primitives suballocated from a GeometryPool
+	void			RenderIndirect( Shader& _Material, StructuredBuffer& _Args, U32 _ByteOffset=0 );
+
+	// Rewrites the content of a dynamic primitive, the indices must use the primitive's index format
+	// NOTE: This renames the whole buffers, prefer Device::Dynamic() for geometry that changes every frame
+	void			UpdateDynamic( const void* _pVertices, const void* _pIndices, int _VerticesCount=-1, int _IndicesCount=-1 );
+
+	// Rewrites the content of a primitive suballocated from _Pool in place (e.g. reloaded static geometry)
+	// The vertices count can't change and at most GetIndicesCount() indices can be written, the primitive keeps the size of its allocation
+	void			Rewrite( GeometryPool& _Pool, const void* _pVertices, int _IndicesCount, const void* _pIndices, DXGI_FORMAT _IndexFormat );
 
 	// Binds additional vertex streams from another primitive
 	// This allows, for example, to add a separate vertex buffer to this primitive's VB
@@ -73,21 +102,33 @@ public:	 // METHODS
 	//
 	// Just create a primitive with the P3 vertex format, and bind it a primitive 
 	//
-	//	_StartIndex, the index of the start vertex
+	//	_StartIndex, the index of the vertex of the bound stream matching our first vertex
+	//
+	// Binding a stream index that was already bound only replaces its buffer (e.g. the bound primitive was rebuilt)
+	//
+	// NOTE: BaseVertexLocation applies to all the streams so the stream offset of a primitive suballocated from a pool is relative to its base vertex.
+	//	If the bound stream is laid out in the same order as the pool (i.e. _StartIndex == GetBaseVertex()) then the stream is bound at offset 0
+	//	and all the primitives of the pool share the exact same vertex buffer bindings.
 	//
 	void			BindVertexStream( U32 _StreamIndex, Primitive& _BoundPrimitive, int _StartIndex=0 );
 
+	// Attaches a tightly packed copy of the vertex positions (or whatever a depth-only pass needs) that gets bound alone instead
+	//	of all the streams above when rendering with a material created with the exact same vertex format as the depth primitive.
+	// Shadow & depth passes then only fetch the positions instead of the whole fat vertices.
+	// The depth primitive is owned (and deleted) by this primitive and must hold the same vertices in the same order, if both are
+	//	suballocated from pools then allocate them in the same order so they share the same base vertex.
+	void			SetDepthStream( Primitive* _pDepthPrimitive );
+
 
 #ifdef SUPPORT_GEO_BUILDERS
 	// IGeometryWriter implementation
-	virtual void	CreateBuffers( int _VerticesCount, int _IndicesCount, D3D11_PRIMITIVE_TOPOLOGY _Topology, void*& _pVertices, void*& _pIndices );
-	virtual void	AppendVertex( void*& _pVertex, const float3& _Position, const float3& _Normal, const float3& _Tangent, const float3& _BiTangent, const float2& _UV );
-	virtual void	AppendIndex( void*& _pIndex, int _Index );
-	virtual void	Finalize( void* _pVertices, void* _pIndices );
+	virtual void	Write( int _VerticesCount, const GeometryBuilder::Vertex* _pVertices, int _IndicesCount, const void* _pIndices, DXGI_FORMAT _IndexFormat, D3D11_PRIMITIVE_TOPOLOGY _Topology );
 #endif
 
 private:
 
-	void			Build( const void* _pVertices, const U32* _pIndices, bool _bDynamic );
+	void			Build( const void* _pVertices, const void* _pIndices, bool _bDynamic );
+	bool			Bind( Shader& _Material );	// Binds the input assembler state, returns false if the material isn't ready
+	void			InitRenderParameters( bool _bIndexed );
 };
 
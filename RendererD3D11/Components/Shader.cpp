@@ -1,6 +1,8 @@
 
 #include "Shader.h"
 #include "ConstantBuffer.h"
+#include "States.h"
+#include "../JobQueue.h"
 
 #include <stdio.h>
 #include <io.h>
@@ -9,8 +11,11 @@
 #include "D3D11Shader.h"
 
 bool	Shader::ms_LoadFromBinary = false;
+#ifdef SHADER_CACHE_FILE
+ShaderCache	Shader::ms_Cache( SHADER_CACHE_FILE );
+#endif
 
-Shader::Shader( Device& _Device, const char* _pShaderFileName, const IVertexFormatDescriptor& _Format, const char* _pShaderCode, D3D_SHADER_MACRO* _pMacros, const char* _pEntryPointVS, const char* _pEntryPointHS, const char* _pEntryPointDS, const char* _pEntryPointGS, const char* _pEntryPointPS, ID3DInclude* _pIncludeOverride )
+Shader::Shader( Device& _Device, const char* _pShaderFileName, const IVertexFormatDescriptor& _Format, const char* _pShaderCode, D3D_SHADER_MACRO* _pMacros, const char* _pEntryPointVS, const char* _pEntryPointHS, const char* _pEntryPointDS, const char* _pEntryPointGS, const char* _pEntryPointPS, ID3DInclude* _pIncludeOverride, bool _bDeferCompilation )
 	: Component( _Device )
 	, m_Format( _Format )
 	, m_pVertexLayout( NULL )
@@ -20,6 +25,11 @@ Shader::Shader( Device& _Device, const char* _pShaderFileName, const IVertexForm
 	, m_pGS( NULL )
 	, m_pPS( NULL )
 	, m_pShaderPath( NULL )
+	, m_SamplersCount( 0 )
+#ifndef GODCOMPLEX
+	, m_BindingsCount( 0 )
+	, m_DeclaredSamplersCount( 0 )
+#endif
 #if defined(_DEBUG) || !defined(GODCOMPLEX)
 	, m_LastShaderModificationTime( 0 )
 #endif
@@ -93,7 +103,8 @@ Shader::Shader( Device& _Device, const char* _pShaderFileName, const IVertexForm
 #endif
 
 	// Compile immediately
-	CompileShaders( _pShaderCode );
+	if ( !_bDeferCompilation )
+		CompileShaders( _pShaderCode );
 #endif
 }
 
@@ -114,6 +125,11 @@ Shader::Shader( Device& _Device, const char* _pShaderFileName, const IVertexForm
 	, m_pShaderPath( NULL )
 	, m_pIncludeOverride( NULL )
 	, m_bHasErrors( false )
+	, m_SamplersCount( 0 )
+#ifndef GODCOMPLEX
+	, m_BindingsCount( 0 )
+	, m_DeclaredSamplersCount( 0 )
+#endif
 #if defined(_DEBUG) || !defined(GODCOMPLEX)
 	, m_LastShaderModificationTime( 0 )
 #endif
@@ -150,10 +166,70 @@ Shader::~Shader() {
 	if ( m_pMacros != NULL )		{ delete[] m_pMacros; m_pMacros = NULL; }
 }
 
+namespace
+{
+	// Compiles one of the optional stages on the device's workers
+	class	StageCompilationJob : public IJob
+	{
+	public:
+		const char*			pShaderFileName;
+		const char*			pShaderCode;
+		D3D_SHADER_MACRO*	pMacros;
+		const char*			pEntryPoint;
+		const char*			pTarget;
+		ID3DInclude*		pInclude;
+		bool				bQueued;
+		ID3DBlob*			pBlob;
+
+		StageCompilationJob() : bQueued( false ), pBlob( NULL ) {}
+
+		virtual void	Run()	{ pBlob = Shader::CompileShader( pShaderFileName, pShaderCode, pMacros, pEntryPoint, pTarget, pInclude ); }
+
+		void	Queue( JobQueue& _Queue, const char* _pShaderFileName, const char* _pShaderCode, D3D_SHADER_MACRO* _pMacros, const char* _pEntryPoint, const char* _pTarget, ID3DInclude* _pInclude )
+		{
+			if ( _pEntryPoint == NULL )
+				return;	// Unused stage
+
+			pShaderFileName = _pShaderFileName;
+			pShaderCode = _pShaderCode;
+			pMacros = _pMacros;
+			pEntryPoint = _pEntryPoint;
+			pTarget = _pTarget;
+			pInclude = _pInclude;
+			bQueued = true;
+			_Queue.Push( *this );
+		}
+	};
+}
+
 void	Shader::CompileShaders( const char* _pShaderCode, ID3DBlob* _pVS, ID3DBlob* _pHS, ID3DBlob* _pDS, ID3DBlob* _pGS, ID3DBlob* _pPS ) {
 
 	m_bHasErrors = false;
 
+	//////////////////////////////////////////////////////////////////////////
+	// Fan the optional stages out to the workers while the vertex shader is compiled here
+	// The vertex shader stays on the calling thread so the include dependencies are still tracked (all the stages come from the same file),
+	//	and batches of shaders already compiled by workers (cf. BeginShaderCompilation()) simply compile their stages in sequence.
+	// Our own include handler isn't thread-safe (it registers the included files' paths) so only the include override can be shared.
+	StageCompilationJob	JobHS, JobDS, JobGS, JobPS;
+	bool	bParallelStages = _pShaderCode != NULL && m_pIncludeOverride != NULL && m_Device.Jobs().IsOwner() && m_Device.Jobs().GetWorkersCount() > 0
+						   && int(m_pEntryPointHS != NULL) + int(m_pEntryPointDS != NULL) + int(m_pEntryPointGS != NULL) + int(m_pEntryPointPS != NULL) > 0;
+	#ifdef _DEBUG
+		bParallelStages &= m_pEntryPointPS == NULL || *m_pEntryPointPS != 1;	// CSO TEST below
+	#endif
+	if ( bParallelStages ) {
+		JobQueue&	Jobs = m_Device.Jobs();
+		#ifndef DIRECTX10
+			JobHS.Queue( Jobs, m_pShaderFileName, _pShaderCode, m_pMacros, _pHS == NULL ? m_pEntryPointHS : NULL, "hs_5_0", this );
+			JobDS.Queue( Jobs, m_pShaderFileName, _pShaderCode, m_pMacros, _pDS == NULL ? m_pEntryPointDS : NULL, "ds_5_0", this );
+			JobGS.Queue( Jobs, m_pShaderFileName, _pShaderCode, m_pMacros, _pGS == NULL ? m_pEntryPointGS : NULL, "gs_5_0", this );
+			JobPS.Queue( Jobs, m_pShaderFileName, _pShaderCode, m_pMacros, _pPS == NULL ? m_pEntryPointPS : NULL, "ps_5_0", this );
+		#else
+			JobGS.Queue( Jobs, m_pShaderFileName, _pShaderCode, m_pMacros, _pGS == NULL ? m_pEntryPointGS : NULL, "gs_4_0", this );
+			JobPS.Queue( Jobs, m_pShaderFileName, _pShaderCode, m_pMacros, _pPS == NULL ? m_pEntryPointPS : NULL, "ps_4_0", this );
+		#endif
+	}
+
 	ID3DBlob*   pShaderVS = NULL;
 	ID3DBlob*   pShaderHS = NULL;
 	ID3DBlob*   pShaderDS = NULL;
@@ -189,6 +265,22 @@ void	Shader::CompileShaders( const char* _pShaderCode, ID3DBlob* _pVS, ID3DBlob*
 	} else
 		m_bHasErrors = true;
 
+	if ( bParallelStages ) {
+		// The stages must be done before we go on (their blobs are released below even if we don't use them)
+		m_Device.Jobs().Wait();
+		if ( JobHS.bQueued )	_pHS = JobHS.pBlob;
+		if ( JobDS.bQueued )	_pDS = JobDS.pBlob;
+		if ( JobGS.bQueued )	_pGS = JobGS.pBlob;
+		if ( JobPS.bQueued )	_pPS = JobPS.pBlob;
+		pShaderHS = _pHS;
+		pShaderDS = _pDS;
+		pShaderGS = _pGS;
+		pShaderPS = _pPS;
+
+		// Don't compile a failed stage again below
+		m_bHasErrors |= (JobHS.bQueued && _pHS == NULL) || (JobDS.bQueued && _pDS == NULL) || (JobGS.bQueued && _pGS == NULL) || (JobPS.bQueued && _pPS == NULL);
+	}
+
 	//////////////////////////////////////////////////////////////////////////
 	// Compile the optional hull shader
 	if ( !m_bHasErrors && (m_pEntryPointHS != NULL || _pHS != NULL) ) {
@@ -299,6 +391,10 @@ void	Shader::CompileShaders( const char* _pShaderCode, ID3DBlob* _pVS, ID3DBlob*
 				m_GSConstants.Enumerate( *pShaderGS );
 			if ( pShaderPS != NULL )
 				m_PSConstants.Enumerate( *pShaderPS );
+
+			for ( int BindingIndex=0; BindingIndex < m_BindingsCount; BindingIndex++ )
+				ResolveBinding( m_pBindings[BindingIndex] );
+			ResolveSamplers();
 		#endif
 	}
 
@@ -384,6 +480,14 @@ ID3DBlob*   Shader::CompileShader( const char* _pShaderFileName, const char* _pS
 	size_t	CodeSize = pCodeText->GetBufferSize();
 	size_t	CodeLength = strlen( (char*) pCodePointer );
 
+	#ifdef SHADER_CACHE_FILE
+		// The preprocessed code contains all the includes and has the macros applied so it's all we need to identify the shader
+		ShaderCache::Key	CacheKey = ShaderCache::ComputeKey( pCodePointer, CodeSize, _pEntryPoint, _pTarget, Flags1, Flags2 );
+		pCode = ms_Cache.Find( CacheKey );
+		pErrors = NULL;
+		bool	bCached = pCode != NULL;
+		if ( !bCached )
+	#endif
 	D3DCompile( pCodePointer, CodeSize, _pShaderFileName, _pMacros, _pInclude, _pEntryPoint, _pTarget, Flags1, Flags2, &pCode, &pErrors );
 
 	#if defined(_DEBUG) || defined(DEBUG_SHADER)
@@ -402,6 +506,11 @@ ID3DBlob*   Shader::CompileShader( const char* _pShaderFileName, const char* _pS
 			ASSERT( pCode != NULL, "Shader compilation failed => No error provided but didn't output any shader either!" );
 	#endif
 
+	#ifdef SHADER_CACHE_FILE
+		if ( pCode != NULL && !bCached )
+			ms_Cache.Store( CacheKey, *pCode );
+	#endif
+
 	// Save the binary blob to disk
 	#if defined(SAVE_SHADER_BLOB_TO) && !defined(RENDERDOC) && !defined(NSIGHT)
 		if ( pCode != NULL ) {
@@ -416,11 +525,39 @@ ID3DBlob*   Shader::CompileShader( const char* _pShaderFileName, const char* _pS
 
 ID3DBlob*   Shader::CompileShader( const char* _pShaderFileName, const char* _pShaderCode, D3D_SHADER_MACRO* _pMacros, const char* _pEntryPoint, const char* _pTarget, ID3DInclude* _pInclude, bool _bComputeShader ) {
 	U8*	pBigBlob = (U8*) _pShaderCode;	// Actually a giant blob...
-	return LoadBinaryBlobFromAggregate( pBigBlob, _pEntryPoint );
+	if ( _pMacros != NULL ) {
+		// Look for the permutation first
+		char	pVariantName[1024];
+		BuildVariantName( pVariantName, _pEntryPoint, _pMacros );
+		ID3DBlob*	pVariant = LoadBinaryBlobFromAggregate( pBigBlob, pVariantName );
+		if ( pVariant != NULL )
+			return pVariant;
+	}
+	return LoadBinaryBlobFromAggregate( pBigBlob, _pEntryPoint );	// Aggregates built before permutations only store the entry points
 }
 
 #endif	// #ifdef _DEBUG
 
+void	Shader::SetSamplerState( int _Slot, const SamplerState& _Sampler, U32 _ShaderStages )
+{
+	ASSERT( _Slot >= 0 && _Slot < D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT, "Invalid sampler slot!" );
+	for ( int SamplerIndex=0; SamplerIndex < m_SamplersCount; SamplerIndex++ )
+	{
+		SamplerBinding&	B = m_pSamplers[SamplerIndex];
+		if ( B.Slot == _Slot && B.Stages == _ShaderStages )
+		{	// Replace
+			B.pSampler = &_Sampler;
+			return;
+		}
+	}
+
+	ASSERT( m_SamplersCount < MAX_SAMPLERS, "Too many samplers!" );
+	SamplerBinding&	B = m_pSamplers[m_SamplersCount++];
+	B.Slot = _Slot;
+	B.Stages = _ShaderStages;
+	B.pSampler = &_Sampler;
+}
+
 bool	Shader::Use()
 {
 	if ( HasErrors() )
@@ -431,14 +568,24 @@ bool	Shader::Use()
 
 	ASSERT( m_pVertexLayout != NULL, "Can't use a material with an invalid vertex layout!" );
 
-	m_Device.DXContext().IASetInputLayout( m_pVertexLayout );
+	m_Device.SetInputLayout( m_pVertexLayout );
 	m_Device.DXContext().VSSetShader( m_pVS, NULL, 0 );
 	m_Device.DXContext().HSSetShader( m_pHS, NULL, 0 );
 	m_Device.DXContext().DSSetShader( m_pDS, NULL, 0 );
 	m_Device.DXContext().GSSetShader( m_pGS, NULL, 0 );
 	m_Device.DXContext().PSSetShader( m_pPS, NULL, 0 );
 
-	m_Device.m_pCurrentMaterial = this;
+	// Redundant samplers are dropped by the device's binding tables
+	for ( int SamplerIndex=0; SamplerIndex < m_SamplersCount; SamplerIndex++ )
+		m_Device.SetSamplerState( m_pSamplers[SamplerIndex].Stages, m_pSamplers[SamplerIndex].Slot, *m_pSamplers[SamplerIndex].pSampler );
+#ifndef GODCOMPLEX
+	for ( int SamplerIndex=0; SamplerIndex < m_DeclaredSamplersCount; SamplerIndex++ )
+		m_Device.SetSamplerState( m_pDeclaredSamplers[SamplerIndex].Stages, m_pDeclaredSamplers[SamplerIndex].Slot, *m_pDeclaredSamplers[SamplerIndex].pSampler );
+#endif
+
+	m_Device.State().pCurrentMaterial = this;
+	m_Device.State().pCurrentPipelineState = NULL;
+	m_Device.CountShaderSwitch();
 
 	Unlock();
 
@@ -510,15 +657,15 @@ void	Shader::SetConstantBuffer( int _BufferSlot, ConstantBuffer& _Buffer )
 		return;	// Someone else is locking it !
 
 	ID3D11Buffer*	pBuffer = _Buffer.GetBuffer();
-	m_Device.DXContext().VSSetConstantBuffers( _BufferSlot, 1, &pBuffer );
+	m_Device.SetConstantBuffer( Device::SSF_VERTEX_SHADER, _BufferSlot, pBuffer );
 	if ( m_pHS != NULL )
-		m_Device.DXContext().HSSetConstantBuffers( _BufferSlot, 1, &pBuffer );
+		m_Device.SetConstantBuffer( Device::SSF_HULL_SHADER, _BufferSlot, pBuffer );
 	if ( m_pDS != NULL )
-		m_Device.DXContext().DSSetConstantBuffers( _BufferSlot, 1, &pBuffer );
+		m_Device.SetConstantBuffer( Device::SSF_DOMAIN_SHADER, _BufferSlot, pBuffer );
 	if ( m_pGS != NULL )
-		m_Device.DXContext().GSSetConstantBuffers( _BufferSlot, 1, &pBuffer );
+		m_Device.SetConstantBuffer( Device::SSF_GEOMETRY_SHADER, _BufferSlot, pBuffer );
 	if ( m_pPS != NULL )
-		m_Device.DXContext().PSSetConstantBuffers( _BufferSlot, 1, &pBuffer );
+		m_Device.SetConstantBuffer( Device::SSF_PIXEL_SHADER, _BufferSlot, pBuffer );
 
 	Unlock();
 }
@@ -528,15 +675,15 @@ void	Shader::SetTexture( int _BufferSlot, ID3D11ShaderResourceView* _pData )
 	if ( !Lock() )
 		return;	// Someone else is locking it !
 
-	m_Device.DXContext().VSSetShaderResources( _BufferSlot, 1, &_pData );
+	m_Device.SetShaderResource( Device::SSF_VERTEX_SHADER, _BufferSlot, _pData );
 	if ( m_pHS != NULL )
-		m_Device.DXContext().HSSetShaderResources( _BufferSlot, 1, &_pData );
+		m_Device.SetShaderResource( Device::SSF_HULL_SHADER, _BufferSlot, _pData );
 	if ( m_pDS != NULL )
-		m_Device.DXContext().DSSetShaderResources( _BufferSlot, 1, &_pData );
+		m_Device.SetShaderResource( Device::SSF_DOMAIN_SHADER, _BufferSlot, _pData );
 	if ( m_pGS != NULL )
-		m_Device.DXContext().GSSetShaderResources( _BufferSlot, 1, &_pData );
+		m_Device.SetShaderResource( Device::SSF_GEOMETRY_SHADER, _BufferSlot, _pData );
 	if ( m_pPS != NULL )
-		m_Device.DXContext().PSSetShaderResources( _BufferSlot, 1, &_pData );
+		m_Device.SetShaderResource( Device::SSF_PIXEL_SHADER, _BufferSlot, _pData );
 
 	Unlock();
 }
@@ -587,31 +734,31 @@ bool	Shader::SetConstantBuffer( const char* _pBufferName, ConstantBuffer& _Buffe
 		{
 			int	SlotIndex = m_VSConstants.GetConstantBufferIndex( _pBufferName );
 			if ( SlotIndex != -1 )
-				m_Device.DXContext().VSSetConstantBuffers( SlotIndex, 1, &pBuffer );
+				m_Device.SetConstantBuffer( Device::SSF_VERTEX_SHADER, SlotIndex, pBuffer );
 			bUsed |= SlotIndex != -1;
 		}
 		{
 			int	SlotIndex = m_HSConstants.GetConstantBufferIndex( _pBufferName );
 			if ( SlotIndex != -1 )
-				m_Device.DXContext().HSSetConstantBuffers( SlotIndex, 1, &pBuffer );
+				m_Device.SetConstantBuffer( Device::SSF_HULL_SHADER, SlotIndex, pBuffer );
 			bUsed |= SlotIndex != -1;
 		}
 		{
 			int	SlotIndex = m_DSConstants.GetConstantBufferIndex( _pBufferName );
 			if ( SlotIndex != -1 )
-				m_Device.DXContext().DSSetConstantBuffers( SlotIndex, 1, &pBuffer );
+				m_Device.SetConstantBuffer( Device::SSF_DOMAIN_SHADER, SlotIndex, pBuffer );
 			bUsed |= SlotIndex != -1;
 		}
 		{
 			int	SlotIndex = m_GSConstants.GetConstantBufferIndex( _pBufferName );
 			if ( SlotIndex != -1 )
-				m_Device.DXContext().GSSetConstantBuffers( SlotIndex, 1, &pBuffer );
+				m_Device.SetConstantBuffer( Device::SSF_GEOMETRY_SHADER, SlotIndex, pBuffer );
 			bUsed |= SlotIndex != -1;
 		}
 		{
 			int	SlotIndex = m_PSConstants.GetConstantBufferIndex( _pBufferName );
 			if ( SlotIndex != -1 )
-				m_Device.DXContext().PSSetConstantBuffers( SlotIndex, 1, &pBuffer );
+				m_Device.SetConstantBuffer( Device::SSF_PIXEL_SHADER, SlotIndex, pBuffer );
 			bUsed |= SlotIndex != -1;
 		}
 	}
@@ -633,31 +780,80 @@ bool	Shader::SetTexture( const char* _pBufferName, ID3D11ShaderResourceView* _pD
 		{
 			int	SlotIndex = m_VSConstants.GetShaderResourceViewIndex( _pBufferName );
 			if ( SlotIndex != -1 )
-				m_Device.DXContext().VSSetShaderResources( SlotIndex, 1, &_pData );
+				m_Device.SetShaderResource( Device::SSF_VERTEX_SHADER, SlotIndex, _pData );
 			bUsed |= SlotIndex != -1;
 		}
 		{
 			int	SlotIndex = m_HSConstants.GetShaderResourceViewIndex( _pBufferName );
 			if ( SlotIndex != -1 )
-				m_Device.DXContext().HSSetShaderResources( SlotIndex, 1, &_pData );
+				m_Device.SetShaderResource( Device::SSF_HULL_SHADER, SlotIndex, _pData );
 			bUsed |= SlotIndex != -1;
 		}
 		{
 			int	SlotIndex = m_DSConstants.GetShaderResourceViewIndex( _pBufferName );
 			if ( SlotIndex != -1 )
-				m_Device.DXContext().DSSetShaderResources( SlotIndex, 1, &_pData );
+				m_Device.SetShaderResource( Device::SSF_DOMAIN_SHADER, SlotIndex, _pData );
 			bUsed |= SlotIndex != -1;
 		}
 		{
 			int	SlotIndex = m_GSConstants.GetShaderResourceViewIndex( _pBufferName );
 			if ( SlotIndex != -1 )
-				m_Device.DXContext().GSSetShaderResources( SlotIndex, 1, &_pData );
+				m_Device.SetShaderResource( Device::SSF_GEOMETRY_SHADER, SlotIndex, _pData );
 			bUsed |= SlotIndex != -1;
 		}
 		{
 			int	SlotIndex = m_PSConstants.GetShaderResourceViewIndex( _pBufferName );
 			if ( SlotIndex != -1 )
-				m_Device.DXContext().PSSetShaderResources( SlotIndex, 1, &_pData );
+				m_Device.SetShaderResource( Device::SSF_PIXEL_SHADER, SlotIndex, _pData );
+			bUsed |= SlotIndex != -1;
+		}
+	}
+
+	Unlock();
+
+	return	bUsed;
+}
+
+bool	Shader::SetConstantBuffer( StringID _BufferID, ConstantBuffer& _Buffer )
+{
+	if ( !Lock() )
+		return	true;	// Someone else is locking it !
+
+	bool	bUsed = true;
+	if ( m_pVertexLayout != NULL )
+	{
+		bUsed = false;
+		ID3D11Buffer*			pBuffer = _Buffer.GetBuffer();
+		const ShaderConstants*	ppStages[STAGES_COUNT] = { &m_VSConstants, &m_HSConstants, &m_DSConstants, &m_GSConstants, &m_PSConstants };
+		for ( int StageIndex=0; StageIndex < STAGES_COUNT; StageIndex++ )
+		{
+			int	SlotIndex = ppStages[StageIndex]->GetConstantBufferIndex( _BufferID );
+			if ( SlotIndex != -1 )
+				m_Device.SetConstantBuffer( 1 << StageIndex, SlotIndex, pBuffer );
+			bUsed |= SlotIndex != -1;
+		}
+	}
+
+	Unlock();
+
+	return	bUsed;
+}
+
+bool	Shader::SetTexture( StringID _TextureID, ID3D11ShaderResourceView* _pData )
+{
+	if ( !Lock() )
+		return	true;	// Someone else is locking it !
+
+	bool	bUsed = true;
+	if ( m_pVertexLayout != NULL )
+	{
+		bUsed = false;
+		const ShaderConstants*	ppStages[STAGES_COUNT] = { &m_VSConstants, &m_HSConstants, &m_DSConstants, &m_GSConstants, &m_PSConstants };
+		for ( int StageIndex=0; StageIndex < STAGES_COUNT; StageIndex++ )
+		{
+			int	SlotIndex = ppStages[StageIndex]->GetShaderResourceViewIndex( _TextureID );
+			if ( SlotIndex != -1 )
+				m_Device.SetShaderResource( 1 << StageIndex, SlotIndex, _pData );
 			bUsed |= SlotIndex != -1;
 		}
 	}
@@ -667,6 +863,122 @@ bool	Shader::SetTexture( const char* _pBufferName, ID3D11ShaderResourceView* _pD
 	return	bUsed;
 }
 
+bool	Shader::SetConstantBuffer( BindingHandle _Binding, ConstantBuffer& _Buffer )
+{
+	ASSERT( _Binding.Index >= 0 && _Binding.Index < m_BindingsCount && !m_pBindings[_Binding.Index].bTexture, "Invalid constant buffer binding!" );
+	if ( !Lock() )
+		return	true;	// Someone else is locking it !
+
+	bool			bUsed = false;
+	const Binding&	B = m_pBindings[_Binding.Index];
+	ID3D11Buffer*	pBuffer = _Buffer.GetBuffer();
+	for ( int StageIndex=0; StageIndex < STAGES_COUNT; StageIndex++ )
+		if ( B.pSlots[StageIndex] != -1 )
+		{
+			m_Device.SetConstantBuffer( 1 << StageIndex, B.pSlots[StageIndex], pBuffer );
+			bUsed = true;
+		}
+
+	Unlock();
+
+	return	bUsed;
+}
+
+bool	Shader::SetTexture( BindingHandle _Binding, ID3D11ShaderResourceView* _pData )
+{
+	ASSERT( _Binding.Index >= 0 && _Binding.Index < m_BindingsCount && m_pBindings[_Binding.Index].bTexture, "Invalid texture binding!" );
+	if ( !Lock() )
+		return	true;	// Someone else is locking it !
+
+	bool			bUsed = false;
+	const Binding&	B = m_pBindings[_Binding.Index];
+	for ( int StageIndex=0; StageIndex < STAGES_COUNT; StageIndex++ )
+		if ( B.pSlots[StageIndex] != -1 )
+		{
+			m_Device.SetShaderResource( 1 << StageIndex, B.pSlots[StageIndex], _pData );
+			bUsed = true;
+		}
+
+	Unlock();
+
+	return	bUsed;
+}
+
+Shader::BindingHandle	Shader::AddBinding( StringID _ID, bool _bTexture )
+{
+	BindingHandle	Result;
+	for ( Result.Index=0; Result.Index < m_BindingsCount; Result.Index++ )
+		if ( m_pBindings[Result.Index].bTexture == _bTexture && m_pBindings[Result.Index].ID == _ID )
+			return Result;	// Already resolved
+
+	ASSERT( m_BindingsCount < MAX_BINDINGS, "Too many bindings!" );
+	Binding&	B = m_pBindings[m_BindingsCount];
+	B.ID = _ID;
+	B.bTexture = _bTexture;
+	for ( int StageIndex=0; StageIndex < STAGES_COUNT; StageIndex++ )
+		B.pSlots[StageIndex] = -1;
+	m_BindingsCount++;
+
+	if ( Lock() )
+	{	// Otherwise it's compiling and the binding will be resolved once it's done
+		ResolveBinding( B );
+		Unlock();
+	}
+
+	return Result;
+}
+
+void	Shader::ResolveBinding( Binding& _Binding ) const
+{
+	const ShaderConstants*	ppStages[STAGES_COUNT] = { &m_VSConstants, &m_HSConstants, &m_DSConstants, &m_GSConstants, &m_PSConstants };
+	for ( int StageIndex=0; StageIndex < STAGES_COUNT; StageIndex++ )
+		_Binding.pSlots[StageIndex] = _Binding.bTexture ? ppStages[StageIndex]->GetShaderResourceViewIndex( _Binding.ID ) : ppStages[StageIndex]->GetConstantBufferIndex( _Binding.ID );
+}
+
+struct	ResolveSamplerContext
+{
+	Shader*	pShader;
+	U32		StageFlag;
+};
+void	Shader::ResolveSamplers()
+{
+	m_DeclaredSamplersCount = 0;
+
+	ShaderConstants*	ppStages[STAGES_COUNT] = { &m_VSConstants, &m_HSConstants, &m_DSConstants, &m_GSConstants, &m_PSConstants };
+	for ( int StageIndex=0; StageIndex < STAGES_COUNT; StageIndex++ )
+	{
+		ResolveSamplerContext	Context = { this, 1U << StageIndex };
+		ppStages[StageIndex]->m_SamplerName2Descriptor.ForEach( ResolveSampler, &Context );
+	}
+}
+void	Shader::ResolveSampler( int _EntryIndex, ShaderConstants::BindingDesc*& _pValue, void* _pUserData )
+{
+	if ( _pValue->Slot < Device::SAMPLERS_COUNT )
+		return;	// Global sampler, always bound
+
+	ResolveSamplerContext&	Context = *((ResolveSamplerContext*) _pUserData);
+	Shader&			Owner = *Context.pShader;
+	SamplerState*	pSampler = Owner.m_Device.FindSamplerState( _pValue->pName );
+	if ( pSampler == NULL )
+		return;	// Unknown to the device, it's up to the user to call SetSamplerState()
+
+	for ( int SamplerIndex=0; SamplerIndex < Owner.m_DeclaredSamplersCount; SamplerIndex++ )
+	{
+		SamplerBinding&	B = Owner.m_pDeclaredSamplers[SamplerIndex];
+		if ( B.Slot == _pValue->Slot && B.pSampler == pSampler )
+		{	// Same sampler declared by another stage
+			B.Stages |= Context.StageFlag;
+			return;
+		}
+	}
+
+	ASSERT( Owner.m_DeclaredSamplersCount < MAX_SAMPLERS, "Too many declared samplers!" );
+	SamplerBinding&	B = Owner.m_pDeclaredSamplers[Owner.m_DeclaredSamplersCount++];
+	B.Slot = _pValue->Slot;
+	B.Stages = Context.StageFlag;
+	B.pSampler = pSampler;
+}
+
 static void	DeleteBindingDescriptors( int _EntryIndex, Shader::ShaderConstants::BindingDesc*& _pValue, void* _pUserData )
 {
 	delete _pValue;
@@ -675,6 +987,7 @@ Shader::ShaderConstants::~ShaderConstants()
 {
 	m_ConstantBufferName2Descriptor.ForEach( DeleteBindingDescriptors, NULL );
 	m_TextureName2Descriptor.ForEach( DeleteBindingDescriptors, NULL );
+	m_SamplerName2Descriptor.ForEach( DeleteBindingDescriptors, NULL );
 }
 void	Shader::ShaderConstants::Enumerate( ID3DBlob& _ShaderBlob )
 {
@@ -691,25 +1004,35 @@ void	Shader::ShaderConstants::Enumerate( ID3DBlob& _ShaderBlob )
 		pReflector->GetResourceBindingDesc( ResourceIndex, &BindDesc );
 
 		BindingDesc**	ppDesc = NULL;
+		FlatDictionary<StringID, BindingDesc*>*	pID2Descriptor = NULL;
 		switch ( BindDesc.Type )
 		{
 		case D3D_SIT_TEXTURE:
-			ppDesc = &m_TextureName2Descriptor.Add( BindDesc.Name );
+			ppDesc = &m_TextureName2Descriptor.AddUnique( BindDesc.Name );
+			pID2Descriptor = &m_TextureID2Descriptor;
 			break;
 
 		case D3D_SIT_CBUFFER:
-			ppDesc = &m_ConstantBufferName2Descriptor.Add( BindDesc.Name );
+			ppDesc = &m_ConstantBufferName2Descriptor.AddUnique( BindDesc.Name );
+			pID2Descriptor = &m_ConstantBufferID2Descriptor;
+			break;
+
+		case D3D_SIT_SAMPLER:
+			ppDesc = &m_SamplerName2Descriptor.AddUnique( BindDesc.Name );
 			break;
 		}
 		if ( ppDesc == NULL )
 			continue;	// We're not interested in that type !
 
+		delete *ppDesc;	// Replace any descriptor from a previous compilation
 		*ppDesc = new BindingDesc();
 		(*ppDesc)->SetName( BindDesc.Name );
 		(*ppDesc)->Slot = BindDesc.BindPoint;
 #ifdef __DEBUG_UPLOAD_ONLY_ONCE
 		(*ppDesc)->bUploaded = false;	// Not uploaded yet !
 #endif
+		if ( pID2Descriptor != NULL )
+			pID2Descriptor->AddUnique( StringID::FromString( BindDesc.Name ), *ppDesc );
 	}
 
 	pReflector->Release();
@@ -760,6 +1083,40 @@ int		Shader::ShaderConstants::GetShaderResourceViewIndex( const char* _pTextureN
 	return ppValue != NULL ? (*ppValue)->Slot : -1;
 }
 
+int		Shader::ShaderConstants::GetConstantBufferIndex( StringID _BufferID ) const
+{
+	BindingDesc**	ppValue = m_ConstantBufferID2Descriptor.Get( _BufferID );
+
+#ifdef __DEBUG_UPLOAD_ONLY_ONCE
+	// Ensure the buffer is uploaded only once !
+	if ( ppValue != NULL )
+	{
+		if ( (*ppValue)->bUploaded )
+			return -1;
+		(*ppValue)->bUploaded = true;	// Now it has been uploaded ! Don't come back !
+	}
+#endif
+
+	return ppValue != NULL ? (*ppValue)->Slot : -1;
+}
+
+int		Shader::ShaderConstants::GetShaderResourceViewIndex( StringID _TextureID ) const
+{
+	BindingDesc**	ppValue = m_TextureID2Descriptor.Get( _TextureID );
+
+#ifdef __DEBUG_UPLOAD_ONLY_ONCE
+	// Ensure the texture is uploaded only once !
+	if ( ppValue != NULL )
+	{
+		if ( (*ppValue)->bUploaded )
+			return -1;
+		(*ppValue)->bUploaded = true;	// Now it has been uploaded ! Don't come back !
+	}
+#endif
+
+	return ppValue != NULL ? (*ppValue)->Slot : -1;
+}
+
 const char*	Shader::GetShaderPath( const char* _pShaderFileName ) const
 {
 	char*	pResult = NULL;
@@ -813,6 +1170,17 @@ void		Shader::WatchShadersModifications()
 	ms_WatchedShaders.ForEach( WatchShader, NULL );
 }
 
+void		Shader::WatchShaderFile( int _EntryIndex, Shader*& _Value, void* _pUserData )
+{
+	if ( !_stricmp( _Value->m_pShaderFileName, (const char*) _pUserData ) )
+		_Value->WatchShaderModifications();	// Several shaders can be compiled from the same file
+}
+
+void		Shader::NotifyFileChanged( const char* _pShaderFileName )
+{
+	ms_WatchedShaders.ForEach( WatchShaderFile, (void*) _pShaderFileName );
+}
+
 #ifdef MATERIAL_COMPILE_THREADED
 void	ThreadCompileMaterial( void* _pData )
 {
@@ -939,20 +1307,6 @@ Shader*	Shader::CreateFromBinaryBlob( Device& _Device, const char* _pShaderFileN
 	return pResult;
 }
 
-void	Shader::BuildMacroSignature( char _pSignature[1024], D3D_SHADER_MACRO* _pMacros ) {
-	char*	pCurrent = _pSignature;
-	while ( _pMacros != NULL && _pMacros->Name != NULL ) {
-		*pCurrent++ = '_';
-		strcpy_s( pCurrent, 1024-(pCurrent-_pSignature), _pMacros->Name );
-		pCurrent += strlen( _pMacros->Name );
-		*pCurrent++ = '=';
-		strcpy_s( pCurrent, 1024-(pCurrent-_pSignature), _pMacros->Definition );
-		pCurrent += strlen( _pMacros->Definition );
-		_pMacros++;
-	}
-	*pCurrent = '\0';
-}
-
 void	Shader::SaveBinaryBlob( const char* _pShaderFileName, D3D_SHADER_MACRO* _pMacros, const char* _pEntryPoint, ID3DBlob& _Blob )
 {
 	ASSERT( _pShaderFileName != NULL, "Can't save binary blob => Invalid shader file name!" );
@@ -984,11 +1338,13 @@ void	Shader::SaveBinaryBlob( const char* _pShaderFileName, D3D_SHADER_MACRO* _pM
 	ASSERT( pFile != NULL, "Can't create binary shader file!" );
 
 	// Write the entry point's length
-	int	Length = strlen( _pEntryPoint )+1;
+	char	pVariantName[1024];
+	BuildVariantName( pVariantName, _pEntryPoint, _pMacros );
+	int	Length = strlen( pVariantName )+1;
 	fwrite( &Length, sizeof(int), 1, pFile );
 
 	// Write the entry point name
-	fwrite( _pEntryPoint, 1, Length, pFile );
+	fwrite( pVariantName, 1, Length, pFile );
 
 	// Write the blob's length
 	Length = _Blob.GetBufferSize();
@@ -1040,7 +1396,9 @@ ID3DBlob*	Shader::LoadBinaryBlob( const char* _pShaderFileName, D3D_SHADER_MACRO
 	// Read the entry point name
 	char	pEntryPointCheck[1024];
 	fread_s( pEntryPointCheck, 1024, 1, Length, pFile );
-	ASSERT( !strcmp( _pEntryPoint, pEntryPointCheck ), "Entry point names mismatch!" );
+	char	pVariantName[1024];
+	BuildVariantName( pVariantName, _pEntryPoint, _pMacros );
+	ASSERT( !strcmp( pVariantName, pEntryPointCheck ) || !strcmp( _pEntryPoint, pEntryPointCheck ), "Entry point names mismatch!" );
 
 	// Read the blob's length
 	int	BlobSize;
@@ -1063,6 +1421,61 @@ ID3DBlob*	Shader::LoadBinaryBlob( const char* _pShaderFileName, D3D_SHADER_MACRO
 #endif	// #if defined(_DEBUG) && defined(SAVE_SHADER_BLOB_TO)
 
 
+void	Shader::BuildMacroSignature( char _pSignature[1024], D3D_SHADER_MACRO* _pMacros ) {
+	char*	pCurrent = _pSignature;
+	while ( _pMacros != NULL && _pMacros->Name != NULL ) {
+		*pCurrent++ = '_';
+		strcpy_s( pCurrent, 1024-(pCurrent-_pSignature), _pMacros->Name );
+		pCurrent += strlen( _pMacros->Name );
+		*pCurrent++ = '=';
+		strcpy_s( pCurrent, 1024-(pCurrent-_pSignature), _pMacros->Definition );
+		pCurrent += strlen( _pMacros->Definition );
+		_pMacros++;
+	}
+	*pCurrent = '\0';
+}
+
+void	Shader::BuildVariantName( char _pVariantName[1024], const char* _pEntryPoint, D3D_SHADER_MACRO* _pMacros ) {
+	char	pMacrosSignature[1024];
+	BuildMacroSignature( pMacrosSignature, _pMacros );
+	sprintf_s( _pVariantName, 1024, "%s%s", _pEntryPoint, pMacrosSignature );
+}
+
+// A blob pointing straight into the aggregate instead of copying it
+// The aggregate is a resource mapped for the lifetime of the executable so there's nothing to release but the blob itself
+class	AggregateBlob : public ID3DBlob
+{
+	const U8*	m_pContent;
+	U32			m_Size;
+	LONG		m_RefCount;
+
+public:
+	AggregateBlob( const U8* _pContent, U32 _Size ) : m_pContent( _pContent ), m_Size( _Size ), m_RefCount( 1 )	{}
+
+	STDMETHOD(QueryInterface)( THIS_ REFIID _riid, LPVOID* _ppvObject )
+	{
+		if ( _riid != __uuidof(ID3DBlob) && _riid != __uuidof(IUnknown) )
+		{
+			*_ppvObject = NULL;
+			return E_NOINTERFACE;
+		}
+		*_ppvObject = this;
+		AddRef();
+		return S_OK;
+	}
+	STDMETHOD_(ULONG, AddRef)( THIS )	{ return InterlockedIncrement( &m_RefCount ); }
+	STDMETHOD_(ULONG, Release)( THIS )
+	{
+		ULONG	RefCount = InterlockedDecrement( &m_RefCount );
+		if ( RefCount == 0 )
+			delete this;
+		return RefCount;
+	}
+
+	STDMETHOD_(LPVOID, GetBufferPointer)( THIS )	{ return (LPVOID) m_pContent; }
+	STDMETHOD_(SIZE_T, GetBufferSize)( THIS )		{ return m_Size; }
+};
+
 ID3DBlob*	Shader::LoadBinaryBlobFromAggregate( const U8* _pAggregate, const char* _pEntryPoint )
 {
 	U16	BlobsCount = *((U16*) _pAggregate); _pAggregate+=2;	// Amount of blobs in the big blob
@@ -1079,16 +1492,8 @@ ID3DBlob*	Shader::LoadBinaryBlobFromAggregate( const U8* _pAggregate, const char
 
 			U16	BlobSize = *((U16*) _pAggregate); _pAggregate+=2;			// Retrieve the size of the blob
 
-			// Create a D3DBlob
-			ID3DBlob*	pResult = NULL;
-			D3DCreateBlob( BlobSize, &pResult );
-
-			// Copy our blob content
-			void*		pBlobContent = pResult->GetBufferPointer();
-			memcpy( pBlobContent, _pAggregate, BlobSize );
-
 			// Yoohoo!
-			return pResult;
+			return new AggregateBlob( _pAggregate, BlobSize );
 		}
 
 		// Not that blob either... Skip the jump offset...
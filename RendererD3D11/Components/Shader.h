@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Component.h"
+#include "ShaderCache.h"
 #include "../Structures/VertexFormats.h"
 
 #define WATCH_SHADER_MODIFICATIONS	// Define this to reload shaders from disk if they changed (comment to ship a demo with embedded shaders)
@@ -38,6 +39,15 @@
 #define USE_BINARY_BLOBS			// Define this to use pre-compiled binary blobs resources rather than text files
 #endif
 
+#if defined(SURE_DEBUG) || !defined(GODCOMPLEX)
+	// Define this to keep compiled shaders in a persistent cache file (only relevant when shaders are compiled at runtime)
+	#ifdef GODCOMPLEX
+		#define SHADER_CACHE_FILE		"./Resources/Shaders/Binary/ShaderCache.bin"
+	#else
+		#define SHADER_CACHE_FILE		"./Shaders/Binary/ShaderCache.bin"
+	#endif
+#endif
+
 
 class ConstantBuffer;
 
@@ -55,6 +65,10 @@ class ConstantBuffer;
 
 class Shader : public Component, ID3DInclude
 {
+public:		// CONSTANTS
+
+	static const int	MAX_SAMPLERS = 8;	// Samplers of the shader bound by Use() on top of the device's global ones
+
 public:		// NESTED TYPES
 
 #ifndef GODCOMPLEX
@@ -77,15 +91,30 @@ public:		// NESTED TYPES
 
 	public:
 
-		DictionaryString<BindingDesc*>	m_ConstantBufferName2Descriptor;
-		DictionaryString<BindingDesc*>	m_TextureName2Descriptor;
+		FlatDictionary<const char*, BindingDesc*>	m_ConstantBufferName2Descriptor;
+		FlatDictionary<const char*, BindingDesc*>	m_TextureName2Descriptor;
+		FlatDictionary<const char*, BindingDesc*>	m_SamplerName2Descriptor;
+		FlatDictionary<StringID, BindingDesc*>		m_ConstantBufferID2Descriptor;	// Same descriptors as the name dictionaries, keyed by interned name
+		FlatDictionary<StringID, BindingDesc*>		m_TextureID2Descriptor;
 
 		~ShaderConstants();
 
 		void	Enumerate( ID3DBlob& _ShaderBlob );
 		int		GetConstantBufferIndex( const char* _pBufferName ) const;
+		int		GetConstantBufferIndex( StringID _BufferID ) const;
 		int		GetShaderResourceViewIndex( const char* _pTextureName ) const;
+		int		GetShaderResourceViewIndex( StringID _TextureID ) const;
 	};
+
+	// A constant buffer or texture resolved once by name (cf. GetConstantBufferBinding()/GetTextureBinding())
+	// The handle stays valid when the shader is recompiled, its slots are simply resolved again by Enumerate
+	struct	BindingHandle
+	{
+		int		Index;
+	};
+
+	static const int	MAX_BINDINGS = 32;
+	static const int	STAGES_COUNT = 5;	// VS, HS, DS, GS, PS (in the same order as Device::SHADER_STAGE_FLAGS)
 #endif
 
 
@@ -118,6 +147,15 @@ private:	// FIELDS
 
 	bool					m_bHasErrors;
 
+	struct	SamplerBinding
+	{
+		int					Slot;
+		U32					Stages;		// Combination of Device::SHADER_STAGE_FLAGS
+		const SamplerState*	pSampler;
+	};
+	SamplerBinding			m_pSamplers[MAX_SAMPLERS];			// Set with SetSamplerState()
+	int						m_SamplersCount;
+
 	#ifndef GODCOMPLEX
 		ShaderConstants			m_VSConstants;
 		ShaderConstants			m_HSConstants;
@@ -126,12 +164,27 @@ private:	// FIELDS
 		ShaderConstants			m_PSConstants;
 
 		Dictionary<const char*>	m_Pointer2FileName;
+
+		struct	Binding
+		{
+			StringID		ID;
+			bool			bTexture;
+			int				pSlots[STAGES_COUNT];	// -1 if the stage doesn't use it
+		};
+		Binding					m_pBindings[MAX_BINDINGS];
+		int						m_BindingsCount;
+
+		SamplerBinding			m_pDeclaredSamplers[MAX_SAMPLERS];	// Named samplers declared by the shaders (cf. ResolveSamplers())
+		int						m_DeclaredSamplersCount;
 	#endif
 
 
 public:
 	static bool				ms_LoadFromBinary;	// A flag you can set to force loading from binary files without having to write a specific code for that
 												// Use the helper class ScopedForceMaterialsLoadFromBinary below
+#ifdef SHADER_CACHE_FILE
+	static ShaderCache		ms_Cache;			// The persistent cache of compiled shaders (shared with compute shaders)
+#endif
 
 
 public:	 // PROPERTIES
@@ -154,7 +207,7 @@ public:	 // PROPERTIES
 
 public:	 // METHODS
 
-	Shader( Device& _Device, const char* _pShaderFileName, const IVertexFormatDescriptor& _Format, const char* _pShaderCode, D3D_SHADER_MACRO* _pMacros, const char* _pEntryPointVS, const char* _pEntryPointHS, const char* _pEntryPointDS, const char* _pEntryPointGS, const char* _pEntryPointPS, ID3DInclude* _pIncludeOverride );
+	Shader( Device& _Device, const char* _pShaderFileName, const IVertexFormatDescriptor& _Format, const char* _pShaderCode, D3D_SHADER_MACRO* _pMacros, const char* _pEntryPointVS, const char* _pEntryPointHS, const char* _pEntryPointDS, const char* _pEntryPointGS, const char* _pEntryPointPS, ID3DInclude* _pIncludeOverride, bool _bDeferCompilation=false );
 	Shader( Device& _Device, const char* _pShaderFileName, const IVertexFormatDescriptor& _Format, ID3DBlob* _pVS, ID3DBlob* _pHS, ID3DBlob* _pDS, ID3DBlob* _pGS, ID3DBlob* _pPS );
 	~Shader();
 
@@ -163,12 +216,32 @@ public:	 // METHODS
 #ifndef GODCOMPLEX
 	bool			SetConstantBuffer( const char* _pBufferName, ConstantBuffer& _Buffer );
 	bool			SetTexture( const char* _pTextureName, ID3D11ShaderResourceView* _pData );
+
+	// Same with an interned name (e.g. GCX_ID( "_TexShadowMap" )), which saves hashing & comparing the string on each call
+	bool			SetConstantBuffer( StringID _BufferID, ConstantBuffer& _Buffer );
+	bool			SetTexture( StringID _TextureID, ID3D11ShaderResourceView* _pData );
+
+	// Resolve the name once at init then set with the handle, which only writes the slots of the stages using it
+	BindingHandle	GetConstantBufferBinding( const char* _pBufferName )	{ return AddBinding( StringID::FromString( _pBufferName ), false ); }
+	BindingHandle	GetTextureBinding( const char* _pTextureName )			{ return AddBinding( StringID::FromString( _pTextureName ), true ); }
+	BindingHandle	GetConstantBufferBinding( StringID _BufferID )			{ return AddBinding( _BufferID, false ); }
+	BindingHandle	GetTextureBinding( StringID _TextureID )				{ return AddBinding( _TextureID, true ); }
+	bool			SetConstantBuffer( BindingHandle _Binding, ConstantBuffer& _Buffer );
+	bool			SetTexture( BindingHandle _Binding, ID3D11ShaderResourceView* _pData );
 #endif
 
+	// The sampler will be bound to that slot of these stages each time the shader is used
+	// Use this for samplers the shaders don't declare by a name known to the device (cf. Device::RegisterSamplerState())
+	void			SetSamplerState( int _Slot, const SamplerState& _Sampler, U32 _ShaderStages=Device::SSF_ALL );
+
 	// Must call this before using the material
 	// Returns false if the shader cannot be used (like when it's in error state)
 	bool			Use();
 
+	// Compiles the shader from source (this is what the constructor does unless you asked to defer compilation)
+	// NOTE: This can be called from any thread as long as nobody is using the shader in the meantime
+	void			Compile( const char* _pShaderCode )	{ CompileShaders( _pShaderCode ); }
+
 	// Static shader compilation helper (also used by ComputeShader)
 	static ID3DBlob*	CompileShader( const char* _pShaderFileName, const char* _pShaderCode, D3D_SHADER_MACRO* _pMacros, const char* _pEntryPoint, const char* _pTarget, ID3DInclude* _pInclude, bool _bComputeShader=false );
 
@@ -185,6 +258,13 @@ private:
 	const char*		CopyString( const char* _pShaderFileName ) const;
 #ifndef GODCOMPLEX
 	const char*		GetShaderPath( const char* _pShaderFileName ) const;
+
+	BindingHandle	AddBinding( StringID _ID, bool _bTexture );
+	void			ResolveBinding( Binding& _Binding ) const;
+
+	// Finds the samplers declared by the shaders at slots >= Device::SAMPLERS_COUNT among the device's named samplers
+	void			ResolveSamplers();
+	static void		ResolveSampler( int _EntryIndex, ShaderConstants::BindingDesc*& _pValue, void* _pUserData );
 #endif
 
 	// Returns true if the shaders are safe to access (i.e. have been compiled and no other thread is accessing them)
@@ -214,12 +294,17 @@ public:
 
 	static void			SaveBinaryBlob( const char* _pShaderFileName, D3D_SHADER_MACRO* _pMacros, const char* _pEntryPoint, ID3DBlob& _Blob );
 	static ID3DBlob*	LoadBinaryBlob( const char* _pShaderFileName, D3D_SHADER_MACRO* _pMacros, const char* _pEntryPoint );	// NOTE: It's the caller's responsibility to release the blob!
-	static void			BuildMacroSignature( char _pSignature[1024], D3D_SHADER_MACRO* _pMacros );
 #endif
+	static void			BuildMacroSignature( char _pSignature[1024], D3D_SHADER_MACRO* _pMacros );
+
+	// Builds the name of a blob compiled with macros: "<EntryPoint><Macros signature>" (e.g. "PS_EMISSIVE=1")
+	// This is the name stored in the .FXBIN file so the permutations of a given entry point don't collide in the aggregate
+	static void			BuildVariantName( char _pVariantName[1024], const char* _pEntryPoint, D3D_SHADER_MACRO* _pMacros );
 
 	// After .FXBIN files are processed by the ConcatenateShader project (Tools.sln), they are packed together in
 	//	a single aggregate containing all the entry points for a given original HLSL file.
 	// Each binary blob (FXBIN file) can be retrieved using this helper method...
+	// NOTE: The returned blob points into the aggregate, which must outlive it (cf. LoadResourceShader())
 	static ID3DBlob*	LoadBinaryBlobFromAggregate( const U8* _pAggregate, const char* _pEntryPoint );
 
 private:
@@ -231,11 +316,13 @@ private:
 	static DictionaryString<Shader*>	ms_WatchedShaders;
 	time_t			m_LastShaderModificationTime;
 	time_t			GetFileModTime( const char* _pFileName );
+	static void		WatchShaderFile( int _EntryIndex, Shader*& _Value, void* _pUserData );
 #endif
 
 public:
 	// Call this every time you need to rebuild shaders whose code has changed
 	static void		WatchShadersModifications();
+	static void		NotifyFileChanged( const char* _pShaderFileName );	// Rebuilds only the shaders using that file (e.g. notified by a FileWatcher)
 	void			WatchShaderModifications();
 	void			ForceRecompile();	// Called externally by the IncludesManager if an include file was changed
 };
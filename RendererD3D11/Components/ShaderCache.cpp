@@ -0,0 +1,212 @@
+#include "ShaderCache.h"
+
+#include "D3Dcompiler.h"
+
+ShaderCache::ShaderCache( const char* _pFileName )
+	: m_pFileName( _pFileName )
+	, m_bLoaded( false )
+	, m_Entries( 1024 )
+	, m_HitsCount( 0 )
+	, m_MissesCount( 0 )
+{
+	InitializeCriticalSection( &m_Lock );
+}
+
+ShaderCache::~ShaderCache()
+{
+	m_Entries.ForEach( ReleaseEntry, NULL );
+	DeleteCriticalSection( &m_Lock );
+}
+
+void	ShaderCache::ReleaseEntry( int _EntryIndex, Entry& _Value, void* _pUserData )
+{
+	_Value.pBlob->Release();
+}
+
+namespace
+{
+	// FNV-1a
+	U32	HashFNV( U32 _Hash, const void* _pData, size_t _Size )
+	{
+		const U8*	pData = (const U8*) _pData;
+		for ( size_t i=0; i < _Size; i++ )
+			_Hash = (_Hash ^ pData[i]) * 16777619U;
+		return _Hash;
+	}
+
+	// SDBM
+	U32	HashSDBM( U32 _Hash, const void* _pData, size_t _Size )
+	{
+		const U8*	pData = (const U8*) _pData;
+		for ( size_t i=0; i < _Size; i++ )
+			_Hash = pData[i] + (_Hash << 6) + (_Hash << 16) - _Hash;
+		return _Hash;
+	}
+}
+
+ShaderCache::Key	ShaderCache::ComputeKey( const void* _pSource, size_t _SourceSize, const char* _pEntryPoint, const char* _pTarget, U32 _Flags1, U32 _Flags2 )
+{
+	U32	pFlags[2] = { _Flags1, _Flags2 };
+
+	Key	Result;
+	Result.Hash = HashFNV( 2166136261U, _pSource, _SourceSize );
+	Result.Hash = HashFNV( Result.Hash, _pEntryPoint, strlen(_pEntryPoint)+1 );
+	Result.Hash = HashFNV( Result.Hash, _pTarget, strlen(_pTarget)+1 );
+	Result.Hash = HashFNV( Result.Hash, pFlags, sizeof(pFlags) );
+
+	Result.Check = HashSDBM( 0, _pSource, _SourceSize );
+	Result.Check = HashSDBM( Result.Check, _pEntryPoint, strlen(_pEntryPoint)+1 );
+	Result.Check = HashSDBM( Result.Check, _pTarget, strlen(_pTarget)+1 );
+	Result.Check = HashSDBM( Result.Check, pFlags, sizeof(pFlags) );
+
+	return Result;
+}
+
+ID3DBlob*	ShaderCache::Find( const Key& _Key )
+{
+	EnterCriticalSection( &m_Lock );
+
+	if ( !m_bLoaded )
+		Load();
+
+	ID3DBlob*	pResult = NULL;
+	Entry*		pEntry = m_Entries.Get( _Key.Hash );
+	if ( pEntry != NULL && pEntry->K.Check == _Key.Check )
+	{
+		pResult = pEntry->pBlob;
+		pResult->AddRef();
+		m_HitsCount++;
+	}
+	else
+		m_MissesCount++;
+
+	LeaveCriticalSection( &m_Lock );
+
+	return pResult;
+}
+
+void	ShaderCache::Store( const Key& _Key, ID3DBlob& _Blob )
+{
+	EnterCriticalSection( &m_Lock );
+
+	if ( !m_bLoaded )
+		Load();
+
+	AddEntry( _Key, _Blob );
+
+	// Append to the file
+	FILE*	pFile = NULL;
+	fopen_s( &pFile, m_pFileName, "ab" );
+	if ( pFile != NULL )
+	{
+		fseek( pFile, 0, SEEK_END );
+		if ( ftell( pFile ) == 0 )
+		{	// New file, write the header first
+			U32	pHeader[2] = { MAGIC, VERSION };
+			fwrite( pHeader, sizeof(U32), 2, pFile );
+		}
+
+		WriteRecord( pFile, _Key, _Blob );
+		fclose( pFile );
+	}
+
+	LeaveCriticalSection( &m_Lock );
+}
+
+void	ShaderCache::AddEntry( const Key& _Key, ID3DBlob& _Blob )
+{
+	Entry*	pEntry = m_Entries.Get( _Key.Hash );
+	if ( pEntry != NULL )
+		pEntry->pBlob->Release();	// Replace colliding entry
+	else
+		pEntry = &m_Entries.Add( _Key.Hash );
+
+	pEntry->K = _Key;
+	pEntry->pBlob = &_Blob;
+	_Blob.AddRef();
+}
+
+void	ShaderCache::WriteRecord( FILE* _pFile, const Key& _Key, ID3DBlob& _Blob )
+{
+	U32	pRecord[3] = { _Key.Hash, _Key.Check, U32(_Blob.GetBufferSize()) };
+	fwrite( pRecord, sizeof(U32), 3, _pFile );
+	fwrite( _Blob.GetBufferPointer(), 1, _Blob.GetBufferSize(), _pFile );
+}
+
+void	ShaderCache::WriteEntry( int _EntryIndex, Entry& _Value, void* _pUserData )
+{
+	WriteRecord( (FILE*) _pUserData, _Value.K, *_Value.pBlob );
+}
+
+// Writes the valid entries to a brand new file
+void	ShaderCache::Rewrite()
+{
+	FILE*	pFile = NULL;
+	fopen_s( &pFile, m_pFileName, "wb" );
+	if ( pFile == NULL )
+		return;
+
+	U32	pHeader[2] = { MAGIC, VERSION };
+	fwrite( pHeader, sizeof(U32), 2, pFile );
+	m_Entries.ForEach( WriteEntry, pFile );
+
+	fclose( pFile );
+}
+
+void	ShaderCache::Load()
+{
+	m_bLoaded = true;
+
+	FILE*	pFile = NULL;
+	fopen_s( &pFile, m_pFileName, "rb" );
+	if ( pFile == NULL )
+		return;	// No cache yet
+
+	fseek( pFile, 0, SEEK_END );
+	long	FileSize = ftell( pFile );
+	fseek( pFile, 0, SEEK_SET );
+
+	U32		pHeader[2] = { 0, 0 };
+	fread_s( pHeader, sizeof(pHeader), sizeof(U32), 2, pFile );
+	if ( pHeader[0] != MAGIC || pHeader[1] != VERSION || U32(FileSize) > MAX_FILE_SIZE )
+	{	// Invalid or too large, start anew
+		fclose( pFile );
+		remove( m_pFileName );
+		return;
+	}
+
+	bool	bCorrupted = false;
+	while ( true )
+	{
+		U32		pRecord[3];
+		size_t	ReadCount = fread_s( pRecord, sizeof(pRecord), sizeof(U32), 3, pFile );
+		if ( ReadCount != 3 )
+		{
+			bCorrupted = ReadCount != 0;
+			break;	// End of file
+		}
+
+		ID3DBlob*	pBlob = NULL;
+		if ( pRecord[2] == 0 || pRecord[2] > U32(FileSize) || D3DCreateBlob( pRecord[2], &pBlob ) != S_OK )
+		{
+			bCorrupted = true;
+			break;
+		}
+		if ( fread_s( pBlob->GetBufferPointer(), pRecord[2], 1, pRecord[2], pFile ) != pRecord[2] )
+		{	// Truncated record (i.e. the app was killed while writing)
+			pBlob->Release();
+			bCorrupted = true;
+			break;
+		}
+
+		Key	K = { pRecord[0], pRecord[1] };
+		AddEntry( K, *pBlob );
+		pBlob->Release();
+	}
+
+	fclose( pFile );
+
+	// Don't append after garbage, keep only what we could read
+	if ( bCorrupted )
+		Rewrite();
+}
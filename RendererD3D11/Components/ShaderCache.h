@@ -0,0 +1,81 @@
+//////////////////////////////////////////////////////////////////////////
+// Persistent cache of compiled shaders
+// Compiled bytecodes are stored in a single file, indexed by a key built from the preprocessed source code
+//	(i.e. the shader file, its whole transitive include set and the macros), the entry point, the target profile and
+//	the compilation flags. Any change to any of these yields a new key so a cached entry is never stale.
+//
+// The file is read once on first access, new entries are then appended to it as soon as they are compiled.
+// The file is started anew if it gets larger than MAX_FILE_SIZE (simply delete it to flush the cache).
+//
+#pragma once
+
+#include "../Device.h"
+
+#include <stdio.h>
+
+class ShaderCache
+{
+public:		// CONSTANTS
+
+	static const U32	MAGIC = 0x48534346;			// "FCSH"
+	static const U32	VERSION = 1;
+	static const U32	MAX_FILE_SIZE = 64 << 20;	// Don't let the file grow too much with stale entries
+
+public:		// NESTED TYPES
+
+	// We use 2 different 32-bits hashes of the same data to make collisions very unlikely
+	struct	Key
+	{
+		U32		Hash;		// Used as the dictionary key
+		U32		Check;		// Must also match
+	};
+
+protected:
+
+	struct	Entry
+	{
+		Key			K;
+		ID3DBlob*	pBlob;
+	};
+
+private:	// FIELDS
+
+	const char*			m_pFileName;
+	bool				m_bLoaded;
+	CRITICAL_SECTION	m_Lock;		// Shaders may be compiled by multiple threads
+
+	Dictionary<Entry>	m_Entries;
+
+	int					m_HitsCount;
+	int					m_MissesCount;
+
+public:		// PROPERTIES
+
+	int			GetEntriesCount() const	{ return m_Entries.GetEntriesCount(); }
+	int			GetHitsCount() const	{ return m_HitsCount; }
+	int			GetMissesCount() const	{ return m_MissesCount; }
+
+public:		// METHODS
+
+	ShaderCache( const char* _pFileName );
+	~ShaderCache();
+
+	static Key	ComputeKey( const void* _pSource, size_t _SourceSize, const char* _pEntryPoint, const char* _pTarget, U32 _Flags1, U32 _Flags2 );
+
+	// Returns the cached bytecode or NULL if not found
+	// NOTE: It's the caller's responsibility to release the blob!
+	ID3DBlob*	Find( const Key& _Key );
+
+	// Stores a freshly compiled bytecode (both in memory and on disk)
+	void		Store( const Key& _Key, ID3DBlob& _Blob );
+
+private:
+
+	void		Load();
+	void		Rewrite();
+	void		AddEntry( const Key& _Key, ID3DBlob& _Blob );
+
+	static void	WriteRecord( FILE* _pFile, const Key& _Key, ID3DBlob& _Blob );
+	static void	WriteEntry( int _EntryIndex, Entry& _Value, void* _pUserData );
+	static void	ReleaseEntry( int _EntryIndex, Entry& _Value, void* _pUserData );
+};
@@ -29,3 +29,25 @@ BlendState::~BlendState()
 {
 	m_pState->Release();
 }
+
+SamplerState::SamplerState( Device& _Device, const D3D11_SAMPLER_DESC& _Description ) : Component( _Device )
+{
+	m_Description = _Description;
+	m_Hash = ComputeHash( _Description );
+	m_Device.DXDevice().CreateSamplerState( &_Description, &m_pState );
+	ASSERT( m_pState, "Failed state creation!" );
+}
+SamplerState::~SamplerState()
+{
+	m_pState->Release();
+}
+
+U32	SamplerState::ComputeHash( const D3D11_SAMPLER_DESC& _Description )
+{
+	// FNV-1a (the description has no padding)
+	const U8*	pData = (const U8*) &_Description;
+	U32			Hash = 2166136261U;
+	for ( int i=0; i < sizeof(D3D11_SAMPLER_DESC); i++ )
+		Hash = (Hash ^ pData[i]) * 16777619U;
+	return Hash;
+}
@@ -36,3 +36,20 @@ public: // METHODS
 	BlendState( Device& _Device, D3D11_BLEND_DESC& _Description );
 	virtual ~BlendState();
 };
+
+// Samplers are usually obtained from the device's cache rather than created directly (cf. Device::GetSamplerState())
+class	SamplerState : public Component
+{
+public:	// FIELDS
+
+	ID3D11SamplerState*	m_pState;
+	D3D11_SAMPLER_DESC	m_Description;
+	U32					m_Hash;
+
+public: // METHODS
+
+	SamplerState( Device& _Device, const D3D11_SAMPLER_DESC& _Description );
+	virtual ~SamplerState();
+
+	static U32	ComputeHash( const D3D11_SAMPLER_DESC& _Description );
+};
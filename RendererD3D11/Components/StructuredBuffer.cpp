@@ -6,11 +6,40 @@
 //
 StructuredBuffer*	StructuredBuffer::ms_ppOutputs[D3D11_PS_CS_UAV_REGISTER_COUNT] = { NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL };
 
-StructuredBuffer::StructuredBuffer( Device& _Device, int _ElementSize, int _ElementsCount, bool _bWriteable )
+StructuredBuffer::StructuredBuffer( Device& _Device, int _ElementSize, int _ElementsCount, bool _bWriteable, U32 _Flags )
 	: Component( _Device )
+	, m_Flags( _Flags )
+	, m_ViewFormat( DXGI_FORMAT_UNKNOWN )
+	, m_pReadBackRing( NULL )
+{
+	Init( _ElementSize, _ElementsCount, _bWriteable );
+}
+
+StructuredBuffer::StructuredBuffer( Device& _Device, const IPixelFormatDescriptor& _Format, int _ElementsCount, bool _bWriteable, U32 _Flags )
+	: Component( _Device )
+	, m_Flags( _Flags )
+	, m_ViewFormat( _Format.DirectXFormat() )
+	, m_pReadBackRing( NULL )
+{
+	ASSERT( (_Flags & (RAW | DRAW_INDIRECT_ARGS | APPEND | COUNTER)) == 0, "Typed buffers can't have raw or counter views!" );
+	Init( _Format.Size(), _ElementsCount, _bWriteable );
+}
+
+StructuredBuffer::StructuredBuffer( Device& _Device, int _ElementSize, int _ElementsCount, const void* _pContent, U32 _Flags )
+	: Component( _Device )
+	, m_Flags( _Flags )
+	, m_ViewFormat( DXGI_FORMAT_UNKNOWN )
+	, m_pReadBackRing( NULL )
+{
+	ASSERT( _pContent != NULL, "Invalid content!" );
+	Init( _ElementSize, _ElementsCount, false, _pContent );
+}
+
+void	StructuredBuffer::Init( int _ElementSize, int _ElementsCount, bool _bWriteable, const void* _pContent )
 {
 	ASSERT( _ElementSize > 0, "Buffer must have at least one element!" );
-	ASSERT( (_ElementSize&3)==0, "Element size must be a multiple of 4!" );
+	ASSERT( (_ElementSize&3)==0 || IsTyped(), "Element size must be a multiple of 4!" );
+	ASSERT( (m_Flags & (APPEND | COUNTER)) == 0 || !IsRaw(), "Only structured buffers can have a counter!" );
 
 	for ( int ShaderStageIndex=0; ShaderStageIndex < 6; ShaderStageIndex++ )
 		m_LastAssignedSlots[ShaderStageIndex] = -1;
@@ -26,48 +55,49 @@ StructuredBuffer::StructuredBuffer( Device& _Device, int _ElementSize, int _Elem
 	Desc.Usage = D3D11_USAGE_DEFAULT;
 	Desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
 	Desc.CPUAccessFlags = 0;
-	Desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
-	Desc.StructureByteStride = _ElementSize;
+	Desc.MiscFlags = IsRaw() ? D3D11_RESOURCE_MISC_BUFFER_ALLOW_RAW_VIEWS : (IsTyped() ? 0 : D3D11_RESOURCE_MISC_BUFFER_STRUCTURED);
+	Desc.StructureByteStride = IsRaw() || IsTyped() ? 0 : _ElementSize;
+	if ( m_Flags & DRAW_INDIRECT_ARGS )
+		Desc.MiscFlags |= D3D11_RESOURCE_MISC_DRAWINDIRECT_ARGS;
+
+	D3D11_SUBRESOURCE_DATA	InitData;
+	InitData.pSysMem = _pContent;
+	InitData.SysMemPitch = m_Size;
+	InitData.SysMemSlicePitch = m_Size;
 
-	Check( m_Device.DXDevice().CreateBuffer( &Desc, NULL, &m_pBuffer ) );
+	Check( m_Device.DXDevice().CreateBuffer( &Desc, _pContent != NULL ? &InitData : NULL, &m_pBuffer ) );
 
 	// Create the CPU accessible version of the buffer
 	Desc.Usage = D3D11_USAGE_STAGING;
 	Desc.BindFlags = 0;
 	Desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ | (_bWriteable ? D3D11_CPU_ACCESS_WRITE : 0);
+	Desc.MiscFlags &= D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;	// Staging buffers can't have the other flags
 	
 	Check( m_Device.DXDevice().CreateBuffer( &Desc, NULL, &m_pCPUBuffer ) );
 
-
-	//////////////////////////////////////////////////////////////////////////
-	// Create the Shader Resource View for the reading
-	D3D11_SHADER_RESOURCE_VIEW_DESC	ViewDesc;
-	ViewDesc.Format = DXGI_FORMAT_UNKNOWN;
-	ViewDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
-	ViewDesc.Buffer.FirstElement = 0;
-	ViewDesc.Buffer.NumElements = _ElementsCount;
-
-	Check( m_Device.DXDevice().CreateShaderResourceView( m_pBuffer, &ViewDesc, &m_pShaderView ) );
-
- 
-	// Create the Unordered Access View for the Buffers
-	// This is used for writing the buffer during the sort and transpose
-	D3D11_UNORDERED_ACCESS_VIEW_DESC	UnorderedViewDesc;
-	UnorderedViewDesc.Format = DXGI_FORMAT_UNKNOWN;
-	UnorderedViewDesc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
-	UnorderedViewDesc.Buffer.FirstElement = 0;
-	UnorderedViewDesc.Buffer.NumElements = _ElementsCount;
-	UnorderedViewDesc.Buffer.Flags = 0;
-
-	Check( m_Device.DXDevice().CreateUnorderedAccessView( m_pBuffer, &UnorderedViewDesc, &m_pUnorderedAccessView ) );
+	// Create the views of the whole buffer
+	m_pShaderView = CreateShaderView( 0, _ElementsCount );
+	m_pUnorderedAccessView = CreateUnorderedAccessView( 0, _ElementsCount );
 }
 
 StructuredBuffer::~StructuredBuffer()
 {
+	m_Device.FlushBindings();	// Make sure the device doesn't hold pending bindings to our views once they're released
+	if ( m_pReadBackRing != NULL )
+	{
+		for ( int SlotIndex=0; SlotIndex < READBACK_RING_SIZE; SlotIndex++ )
+		{
+			m_pReadBackRing->ppStaging[SlotIndex]->Release();
+			m_pReadBackRing->ppEvents[SlotIndex]->Release();
+		}
+		delete m_pReadBackRing;
+	}
+	m_CachedSRVs.ReleaseAll();
+	m_CachedUAVs.ReleaseAll();
 	m_pUnorderedAccessView->Release();
 	m_pShaderView->Release();
-	m_pCPUBuffer->Release();
-	m_pBuffer->Release();
+	m_Device.DeferRelease( m_pCPUBuffer );	// Frames in flight may still use them
+	m_Device.DeferRelease( m_pBuffer );
 }
 
 void	StructuredBuffer::Read( void* _pData, int _ElementsCount ) const
@@ -79,7 +109,7 @@ void	StructuredBuffer::Read( void* _pData, int _ElementsCount ) const
 
 	// Read from staging resource
 	D3D11_MAPPED_SUBRESOURCE	SubResource;
-	Check( m_Device.DXContext().Map( m_pCPUBuffer, 0, D3D11_MAP_READ, 0, &SubResource ) );
+	Check( m_Device.Map( m_pCPUBuffer, 0, D3D11_MAP_READ, SubResource, "StructuredBuffer::Read" ) );
 	ASSERT( SubResource.pData != NULL, "Failed to Map resource for reading!" );
 
 	memcpy( _pData, SubResource.pData, Size );
@@ -87,21 +117,205 @@ void	StructuredBuffer::Read( void* _pData, int _ElementsCount ) const
 	m_Device.DXContext().Unmap( m_pCPUBuffer, 0 );
 }
 
-void	StructuredBuffer::Write( void* _pData, int _ElementsCount )
+void	StructuredBuffer::ReadRange( void* _pData, int _FirstElement, int _ElementsCount ) const
 {
-	int	Size = m_ElementSize * (_ElementsCount < 0 ? m_ElementsCount : _ElementsCount);
+	ASSERT( _FirstElement >= 0 && _ElementsCount >= 0 && _FirstElement + _ElementsCount <= m_ElementsCount, "Range out of bounds!" );
+	if ( _ElementsCount == 0 )
+		return;
+
+	// Copy the range from the actual buffer, at the same place in the staging buffer
+	U32			Offset = m_ElementSize * _FirstElement;
+	D3D11_BOX	Box;
+	Box.left = Offset;
+	Box.right = Offset + m_ElementSize * _ElementsCount;
+	Box.top = 0;	Box.bottom = 1;
+	Box.front = 0;	Box.back = 1;
+	m_Device.DXContext().CopySubresourceRegion( m_pCPUBuffer, 0, Offset, 0, 0, m_pBuffer, 0, &Box );
 
-	// Write to staging resource
 	D3D11_MAPPED_SUBRESOURCE	SubResource;
-	Check( m_Device.DXContext().Map( m_pCPUBuffer, 0, D3D11_MAP_WRITE, 0, &SubResource ) );
-	ASSERT( SubResource.pData != NULL, "Failed to Map resource for writing!" );
+	Check( m_Device.Map( m_pCPUBuffer, 0, D3D11_MAP_READ, SubResource, "StructuredBuffer::ReadRange" ) );
+	ASSERT( SubResource.pData != NULL, "Failed to Map resource for reading!" );
 
-	memcpy( SubResource.pData, _pData, Size );
+	memcpy( _pData, (const U8*) SubResource.pData + Offset, Box.right - Box.left );
 
 	m_Device.DXContext().Unmap( m_pCPUBuffer, 0 );
+}
+
+int		StructuredBuffer::ReadAsync( int _ElementsCount ) const
+{
+	if ( m_pReadBackRing == NULL )
+	{	// Create the ring of staging buffers
+		m_pReadBackRing = new ReadBackRing;
+		m_pReadBackRing->NextTicket = 0;
+
+		D3D11_BUFFER_DESC	Desc;
+		Desc.ByteWidth = m_Size;
+		Desc.Usage = D3D11_USAGE_STAGING;
+		Desc.BindFlags = 0;
+		Desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+		Desc.MiscFlags = IsRaw() || IsTyped() ? 0 : D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+		Desc.StructureByteStride = IsRaw() || IsTyped() ? 0 : m_ElementSize;
+
+		D3D11_QUERY_DESC	QueryDesc;
+		QueryDesc.Query = D3D11_QUERY_EVENT;
+		QueryDesc.MiscFlags = 0;
+
+		for ( int SlotIndex=0; SlotIndex < READBACK_RING_SIZE; SlotIndex++ )
+		{
+			Check( m_Device.DXDevice().CreateBuffer( &Desc, NULL, &m_pReadBackRing->ppStaging[SlotIndex] ) );
+			Check( m_Device.DXDevice().CreateQuery( &QueryDesc, &m_pReadBackRing->ppEvents[SlotIndex] ) );
+			m_pReadBackRing->pTickets[SlotIndex] = -1;
+		}
+	}
+
+	int	Ticket = m_pReadBackRing->NextTicket;
+	int	SlotIndex = Ticket % READBACK_RING_SIZE;
+	if ( m_pReadBackRing->pTickets[SlotIndex] != -1 )
+		return -1;	// Oldest readback not resolved yet...
+
+	m_pReadBackRing->NextTicket = (Ticket + 1) & 0x7FFFFFFF;
+	m_pReadBackRing->pTickets[SlotIndex] = Ticket;
+	m_pReadBackRing->pSizes[SlotIndex] = m_ElementSize * (_ElementsCount < 0 ? m_ElementsCount : _ElementsCount);
+
+	// Queue the copy followed by the event that will tell us when it's done
+	m_Device.DXContext().CopyResource( m_pReadBackRing->ppStaging[SlotIndex], m_pBuffer );
+	m_Device.DXContext().End( m_pReadBackRing->ppEvents[SlotIndex] );
+
+	return Ticket;
+}
+
+bool	StructuredBuffer::TryResolve( int _Ticket, void* _pData ) const
+{
+	ASSERT( m_pReadBackRing != NULL && _Ticket >= 0, "Invalid readback ticket!" );
+	int	SlotIndex = _Ticket % READBACK_RING_SIZE;
+	ASSERT( m_pReadBackRing->pTickets[SlotIndex] == _Ticket, "Readback ticket was already resolved!" );
+
+	// Check the copy has been executed without flushing the command buffer (the next Present() will)
+	if ( m_Device.DXContext().GetData( m_pReadBackRing->ppEvents[SlotIndex], NULL, 0, D3D11_ASYNC_GETDATA_DONOTFLUSH ) != S_OK )
+		return false;	// Not yet...
+
+	// The staging buffer should now be idle so mapping it won't stall
+	D3D11_MAPPED_SUBRESOURCE	SubResource;
+	HRESULT	Result = m_Device.Map( m_pReadBackRing->ppStaging[SlotIndex], 0, D3D11_MAP_READ, SubResource, "StructuredBuffer::TryResolve", true );
+	if ( Result == DXGI_ERROR_WAS_STILL_DRAWING )
+		return false;	// Not yet after all... (DO_NOT_WAIT mode only)
+	Check( Result );
+	ASSERT( SubResource.pData != NULL, "Failed to Map resource for reading!" );
+
+	memcpy( _pData, SubResource.pData, m_pReadBackRing->pSizes[SlotIndex] );
+
+	m_Device.DXContext().Unmap( m_pReadBackRing->ppStaging[SlotIndex], 0 );
+
+	m_pReadBackRing->pTickets[SlotIndex] = -1;
+	return true;
+}
+
+void	StructuredBuffer::Write( void* _pData, int _ElementsCount )
+{
+	int	Size = m_ElementSize * (_ElementsCount < 0 ? m_ElementsCount : _ElementsCount);
+
+	// Go through the device's upload ring so we neither wait for the staging buffer nor copy the elements that weren't written
+	m_Device.UploadBuffer( *m_pBuffer, 0, _pData, Size );
+}
+
+void	StructuredBuffer::WriteRange( const void* _pData, int _FirstElement, int _ElementsCount )
+{
+	ASSERT( _FirstElement >= 0 && _ElementsCount >= 0 && _FirstElement + _ElementsCount <= m_ElementsCount, "Range out of bounds!" );
+	if ( _ElementsCount == 0 )
+		return;
+
+	m_Device.UploadBuffer( *m_pBuffer, m_ElementSize * _FirstElement, _pData, m_ElementSize * _ElementsCount );
+}
+
+ID3D11ShaderResourceView*	StructuredBuffer::GetShaderView( int _FirstElement, int _ElementsCount ) const
+{
+	if ( _ElementsCount == 0 )
+		_ElementsCount = m_ElementsCount - _FirstElement;
+	ASSERT( _FirstElement >= 0 && _FirstElement + _ElementsCount <= m_ElementsCount, "View is out of the buffer!" );
+	if ( _FirstElement == 0 && _ElementsCount == m_ElementsCount )
+		return m_pShaderView;
+
+	// Check if we already have it
+	ASSERT( _FirstElement < 65536 && _ElementsCount < 65536, "Sub-range views are limited to the first 64K elements!" );
+	U32	Hash = _FirstElement | (_ElementsCount << 16);
+	ID3D11ShaderResourceView*	pExistingView = m_CachedSRVs.Get( Hash );
+	if ( pExistingView != NULL )
+		return pExistingView;
+
+	ID3D11ShaderResourceView*	pView = CreateShaderView( _FirstElement, _ElementsCount );
+	m_CachedSRVs.Add( Hash, pView );
+
+	return pView;
+}
+
+ID3D11UnorderedAccessView*	StructuredBuffer::GetUnorderedAccessView( int _FirstElement, int _ElementsCount ) const
+{
+	if ( _ElementsCount == 0 )
+		_ElementsCount = m_ElementsCount - _FirstElement;
+	ASSERT( _FirstElement >= 0 && _FirstElement + _ElementsCount <= m_ElementsCount, "View is out of the buffer!" );
+	if ( _FirstElement == 0 && _ElementsCount == m_ElementsCount )
+		return m_pUnorderedAccessView;
+
+	// Check if we already have it
+	ASSERT( _FirstElement < 65536 && _ElementsCount < 65536, "Sub-range views are limited to the first 64K elements!" );
+	U32	Hash = _FirstElement | (_ElementsCount << 16);
+	ID3D11UnorderedAccessView*	pExistingView = m_CachedUAVs.Get( Hash );
+	if ( pExistingView != NULL )
+		return pExistingView;
+
+	ID3D11UnorderedAccessView*	pView = CreateUnorderedAccessView( _FirstElement, _ElementsCount );
+	m_CachedUAVs.Add( Hash, pView );
+
+	return pView;
+}
+
+ID3D11ShaderResourceView*	StructuredBuffer::CreateShaderView( int _FirstElement, int _ElementsCount ) const
+{
+	D3D11_SHADER_RESOURCE_VIEW_DESC	ViewDesc;
+	if ( IsRaw() )
+	{	// Raw views address the buffer as 32-bits words
+		ViewDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+		ViewDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFEREX;
+		ViewDesc.BufferEx.FirstElement = (_FirstElement * m_ElementSize) >> 2;
+		ViewDesc.BufferEx.NumElements = (_ElementsCount * m_ElementSize) >> 2;
+		ViewDesc.BufferEx.Flags = D3D11_BUFFEREX_SRV_FLAG_RAW;
+	}
+	else
+	{	// Structured or typed
+		ViewDesc.Format = m_ViewFormat;
+		ViewDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+		ViewDesc.Buffer.FirstElement = _FirstElement;
+		ViewDesc.Buffer.NumElements = _ElementsCount;
+	}
 
-	// Copy to actual buffer
-	m_Device.DXContext().CopyResource( m_pBuffer, m_pCPUBuffer );
+	ID3D11ShaderResourceView*	pView;
+	Check( m_Device.DXDevice().CreateShaderResourceView( m_pBuffer, &ViewDesc, &pView ) );
+	return pView;
+}
+
+ID3D11UnorderedAccessView*	StructuredBuffer::CreateUnorderedAccessView( int _FirstElement, int _ElementsCount ) const
+{
+	D3D11_UNORDERED_ACCESS_VIEW_DESC	ViewDesc;
+	ViewDesc.Format = IsRaw() ? DXGI_FORMAT_R32_TYPELESS : m_ViewFormat;
+	ViewDesc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+	ViewDesc.Buffer.FirstElement = IsRaw() ? (_FirstElement * m_ElementSize) >> 2 : _FirstElement;
+	ViewDesc.Buffer.NumElements = IsRaw() ? (_ElementsCount * m_ElementSize) >> 2 : _ElementsCount;
+	ViewDesc.Buffer.Flags = IsRaw() ? D3D11_BUFFER_UAV_FLAG_RAW : 0;
+	if ( m_Flags & APPEND )
+		ViewDesc.Buffer.Flags |= D3D11_BUFFER_UAV_FLAG_APPEND;
+	if ( m_Flags & COUNTER )
+		ViewDesc.Buffer.Flags |= D3D11_BUFFER_UAV_FLAG_COUNTER;
+
+	ID3D11UnorderedAccessView*	pView;
+	Check( m_Device.DXDevice().CreateUnorderedAccessView( m_pBuffer, &ViewDesc, &pView ) );
+	return pView;
+}
+
+void	StructuredBuffer::CopyCount( StructuredBuffer& _Target, U32 _ByteOffset ) const
+{
+	ASSERT( (m_Flags & (APPEND | COUNTER)) != 0, "Buffer has no counter!" );
+	ASSERT( (_ByteOffset & 3) == 0, "Counter must be copied at a 4 bytes aligned offset!" );
+	m_Device.DXContext().CopyStructureCount( _Target.m_pBuffer, _ByteOffset, m_pUnorderedAccessView );
 }
 
 void	StructuredBuffer::Clear( U32 _pValue[4] )
@@ -127,7 +341,7 @@ void	StructuredBuffer::SetInput( int _SlotIndex )
 		for ( int OutputSlotIndex=0; OutputSlotIndex < D3D11_PS_CS_UAV_REGISTER_COUNT; OutputSlotIndex++ )
 			if ( m_pAssignedToOutputSlot[OutputSlotIndex] != -1 )
 			{	// We're still assigned to an output...
-				m_Device.DXContext().CSSetUnorderedAccessViews( OutputSlotIndex, 1, &pView, &UAVInitialCount );
+				m_Device.SetUnorderedAccessView( OutputSlotIndex, pView, UAVInitialCount );
 				m_pAssignedToOutputSlot[OutputSlotIndex] = -1;
 				ms_ppOutputs[OutputSlotIndex] = NULL;
 			}
@@ -135,12 +349,7 @@ void	StructuredBuffer::SetInput( int _SlotIndex )
 
 	// We can now safely assign it as an input
 	ID3D11ShaderResourceView*	pView = GetShaderView();
-	m_Device.DXContext().VSSetShaderResources( _SlotIndex, 1, &pView );
-	m_Device.DXContext().HSSetShaderResources( _SlotIndex, 1, &pView );
-	m_Device.DXContext().DSSetShaderResources( _SlotIndex, 1, &pView );
-	m_Device.DXContext().GSSetShaderResources( _SlotIndex, 1, &pView );
-	m_Device.DXContext().PSSetShaderResources( _SlotIndex, 1, &pView );
-	m_Device.DXContext().CSSetShaderResources( _SlotIndex, 1, &pView );
+	m_Device.SetShaderResource( Device::SSF_ALL, _SlotIndex, pView );
 
 	m_LastAssignedSlots[0] = _SlotIndex;
 	m_LastAssignedSlots[1] = _SlotIndex;
@@ -150,14 +359,13 @@ void	StructuredBuffer::SetInput( int _SlotIndex )
 	m_LastAssignedSlots[5] = _SlotIndex;
 }
 
-void	StructuredBuffer::SetOutput( int _SlotIndex ) {
+void	StructuredBuffer::SetOutput( int _SlotIndex, U32 _InitialCount ) {
 #ifdef _DEBUG
 	ASSERT( ms_ppOutputs[_SlotIndex] != this, "StructureBuffer already assigned to this output slot! It's only a warning, you can ignore this but you should consider removing this redundant SetOutput() from your code..." );
 #endif
 
 	ID3D11UnorderedAccessView*	pView = GetUnorderedAccessView();
-	U32							UAVInitialCount = -1;
-	m_Device.DXContext().CSSetUnorderedAccessViews( _SlotIndex, 1, &pView, &UAVInitialCount );
+	m_Device.SetUnorderedAccessView( _SlotIndex, pView, _InitialCount );
 
 	// Remove any previous output buffer
 	if ( ms_ppOutputs[_SlotIndex] != NULL )
@@ -184,3 +392,16 @@ void	StructuredBuffer::RemoveFromLastAssignedSlots() const
 			m_LastAssignedSlots[ShaderStageIndex] = -1;
 		}
 }
+
+void	StructuredBuffer::RemoveFromLastAssignedSlotUAV() const
+{
+	U32							UAVInitialCount = -1;
+	ID3D11UnorderedAccessView*	pView = NULL;
+	for ( int OutputSlotIndex=0; OutputSlotIndex < D3D11_PS_CS_UAV_REGISTER_COUNT; OutputSlotIndex++ )
+		if ( m_pAssignedToOutputSlot[OutputSlotIndex] != -1 )
+		{
+			m_Device.SetUnorderedAccessView( OutputSlotIndex, pView, UAVInitialCount );
+			m_pAssignedToOutputSlot[OutputSlotIndex] = -1;
+			ms_ppOutputs[OutputSlotIndex] = NULL;
+		}
+}
@@ -1,15 +1,44 @@
 #pragma once
 
 #include "Component.h"
+#include "../Structures/PixelFormats.h"
+#include "../Structures/ViewCache.h"
 
 // This is the class that is used to pass values to the shader and read back the results
 class	StructuredBuffer : public Component
 {
+public:		// NESTED TYPES
+
+	enum	FLAGS
+	{
+		RAW = 1,					// Views are raw (ByteAddressBuffer/RWByteAddressBuffer) instead of structured
+		DRAW_INDIRECT_ARGS = 2,		// Can feed Primitive::RenderIndirect()/ComputeShader::DispatchIndirect() (implies RAW since argument buffers can't be structured)
+		APPEND = 4,					// The UAV is an AppendStructuredBuffer/ConsumeStructuredBuffer (structured buffers only)
+		COUNTER = 8,				// The UAV has a hidden counter for IncrementCounter()/DecrementCounter() (structured buffers only)
+	};
+
+protected:	// CONSTANTS
+
+	static const int	READBACK_RING_SIZE = 3;		// Maximum amount of asynchronous readbacks in flight
+
+protected:	// NESTED TYPES
+
+	struct	ReadBackRing
+	{
+		ID3D11Buffer*	ppStaging[READBACK_RING_SIZE];
+		ID3D11Query*	ppEvents[READBACK_RING_SIZE];
+		int				pTickets[READBACK_RING_SIZE];	// -1 if the staging buffer is free
+		int				pSizes[READBACK_RING_SIZE];
+		int				NextTicket;
+	};
+
 protected:	// FIELDS
 
 	int							m_ElementSize;
 	int							m_ElementsCount;
 	int							m_Size;
+	U32							m_Flags;
+	DXGI_FORMAT					m_ViewFormat;		// Format of typed buffers, DXGI_FORMAT_UNKNOWN for structured & raw buffers
 
 	ID3D11Buffer*				m_pBuffer;
 	ID3D11Buffer*				m_pCPUBuffer;
@@ -17,9 +46,16 @@ protected:	// FIELDS
 	ID3D11ShaderResourceView*	m_pShaderView;
 	ID3D11UnorderedAccessView*  m_pUnorderedAccessView;
 
+	// Cached sub-range views
+	mutable ViewCache<ID3D11ShaderResourceView>		m_CachedSRVs;
+	mutable ViewCache<ID3D11UnorderedAccessView>	m_CachedUAVs;
+
+	// Staging buffers for asynchronous readbacks (allocated on first use, cf. ReadAsync())
+	mutable ReadBackRing*		m_pReadBackRing;
+
 	// Structure to keep track of current inputs/outputs
 	mutable int					m_LastAssignedSlots[6];
-	int							m_pAssignedToOutputSlot[D3D11_PS_CS_UAV_REGISTER_COUNT];
+	mutable int					m_pAssignedToOutputSlot[D3D11_PS_CS_UAV_REGISTER_COUNT];
 	static StructuredBuffer*	ms_ppOutputs[D3D11_PS_CS_UAV_REGISTER_COUNT];
 
 
@@ -28,30 +64,64 @@ public:		// PROPERTIES
 	int				GetElementSize() const		{ return m_ElementSize; }
 	int				GetElementsCount() const	{ return m_ElementsCount; }
 	int				GetSize() const				{ return m_Size; }
+	bool			IsRaw() const				{ return (m_Flags & (RAW | DRAW_INDIRECT_ARGS)) != 0; }
+	bool			IsTyped() const				{ return m_ViewFormat != DXGI_FORMAT_UNKNOWN; }
+
+	ID3D11Buffer*				GetBuffer()					{ return m_pBuffer; }
 
 	ID3D11ShaderResourceView*	GetShaderView()				{ return m_pShaderView; }
 	ID3D11UnorderedAccessView*	GetUnorderedAccessView()	{ return m_pUnorderedAccessView; }
 
+	// Views of a range of elements (_ElementsCount=0 means up to the end of the buffer), created on demand and cached
+	ID3D11ShaderResourceView*	GetShaderView( int _FirstElement, int _ElementsCount ) const;
+	ID3D11UnorderedAccessView*	GetUnorderedAccessView( int _FirstElement, int _ElementsCount ) const;
+
 public:		// METHODS
 
-	StructuredBuffer( Device& _Device, int _ElementSize, int _ElementsCount, bool _bWriteable );
+	StructuredBuffer( Device& _Device, int _ElementSize, int _ElementsCount, bool _bWriteable, U32 _Flags=0 );	// _Flags is a combination of FLAGS
+	StructuredBuffer( Device& _Device, const IPixelFormatDescriptor& _Format, int _ElementsCount, bool _bWriteable, U32 _Flags=0 );	// Typed buffer (Buffer<T>/RWBuffer<T>, e.g. R32_UINT for atomics)
+	StructuredBuffer( Device& _Device, int _ElementSize, int _ElementsCount, const void* _pContent, U32 _Flags=0 );	// Created with its content, so it can be created by a loader thread (cf. Device::ExecuteOnRenderThread())
 	~StructuredBuffer();
 
 	// Read/Write for CPU interchange
 	void			Read( void* _pData, int _ElementsCount=-1 ) const;
 	void			Write( void* _pData, int _ElementsCount=-1 );
 
+	// Same for a range of elements, only the range is copied
+	void			ReadRange( void* _pData, int _FirstElement, int _ElementsCount ) const;
+	void			WriteRange( const void* _pData, int _FirstElement, int _ElementsCount );
+
+	// Asynchronous read for GPU feedback that doesn't stall the pipeline
+	// ReadAsync() queues a copy into a staging buffer and returns a ticket, or -1 if all the staging buffers are still in flight.
+	// TryResolve() returns false until the GPU has executed the copy (usually a couple of frames later) then reads the data and frees the ticket.
+	// Every ticket must eventually be resolved.
+	int				ReadAsync( int _ElementsCount=-1 ) const;
+	bool			TryResolve( int _Ticket, void* _pData ) const;
+
 	// Clear of the unordered access view
 	void			Clear( U32 _pValue[4] );
 	void			Clear( const float4& _Value );
 
 	// Uploads the buffer to the shader
 	void			SetInput( int _SlotIndex );
-	void			SetOutput( int _SlotIndex );
+	void			SetOutput( int _SlotIndex, U32 _InitialCount=-1 );	// _InitialCount resets the counter of APPEND/COUNTER buffers (-1 keeps it)
+
+	// Copies the hidden counter of an APPEND/COUNTER buffer into another buffer (e.g. to feed ComputeShader::DispatchIndirect())
+	void			CopyCount( StructuredBuffer& _Target, U32 _ByteOffset ) const;
 
 	// Removes the structured buffer from any last assigned SRV slots
 	void			RemoveFromLastAssignedSlots() const;
 	void			RemoveFromLastAssignedSlotUAV() const;
+
+	// Including the staging copy used by Read() (the staging buffers of ReadAsync() are allocated on demand and not counted)
+	virtual U64	GetVideoMemorySize() const	{ return GetBufferSize( m_pBuffer ) + GetBufferSize( m_pCPUBuffer ); }
+	virtual Device::MEMORY_CATEGORY	GetVideoMemoryCategory() const	{ return Device::MC_BUFFER; }
+
+protected:
+
+	void						Init( int _ElementSize, int _ElementsCount, bool _bWriteable, const void* _pContent=NULL );
+	ID3D11ShaderResourceView*	CreateShaderView( int _FirstElement, int _ElementsCount ) const;
+	ID3D11UnorderedAccessView*	CreateUnorderedAccessView( int _FirstElement, int _ElementsCount ) const;
 };
 
 
@@ -79,17 +149,21 @@ public:		// PROPERTIES
 public:		// METHODS
 
 	SB() : m( NULL ), m_pBuffer( NULL )		{}
-	SB( Device& _Device, int _ElementsCount, bool _bWriteable ) : m( NULL ), m_pBuffer( NULL ) { Init( _Device, _ElementsCount, _bWriteable ); }
+	SB( Device& _Device, int _ElementsCount, bool _bWriteable, U32 _Flags=0 ) : m( NULL ), m_pBuffer( NULL ) { Init( _Device, _ElementsCount, _bWriteable, _Flags ); }
 	~SB()									{ delete m_pBuffer; delete[] m; }
 
-	void	Init( Device& _Device, int _ElementsCount, bool _bWriteable )
+	void	Init( Device& _Device, int _ElementsCount, bool _bWriteable, U32 _Flags=0 )
 	{
 		m = new T[_ElementsCount];
-		m_pBuffer = new StructuredBuffer( _Device, sizeof(T), _ElementsCount, _bWriteable );
+		m_pBuffer = new StructuredBuffer( _Device, sizeof(T), _ElementsCount, _bWriteable, _Flags );
 	}
 
+	StructuredBuffer&	GetStructuredBuffer()	{ return *m_pBuffer; }
+
 	void	Read( int _ElementsCount=-1 )		{ m_pBuffer->Read( m, _ElementsCount ); }
 	void	Write( int _ElementsCount=-1 )		{ m_pBuffer->Write( m, _ElementsCount ); }
+	int		ReadAsync( int _ElementsCount=-1 )	{ return m_pBuffer->ReadAsync( _ElementsCount ); }
+	bool	TryResolve( int _Ticket )			{ return m_pBuffer->TryResolve( _Ticket, m ); }
 	void	Clear( U32 _pValue[4] )				{ m_pBuffer->Clear( _pValue ); }
 	void	Clear( const float4& _Value )		{ m_pBuffer->Clear( _Value ); }
 	void	SetInput( int _SlotIndex, bool _bIKnowWhatImDoing=false )
@@ -97,6 +171,92 @@ public:		// METHODS
 		ASSERT( _SlotIndex >= 10 || _bIKnowWhatImDoing, "WARNING: Assigning a reserved texture slot! (i.e. all slots [0,9] are reserved for global textures)" );
 		m_pBuffer->SetInput( _SlotIndex );
 	}
-	void	SetOutput( int _SlotIndex )			{ m_pBuffer->SetOutput( _SlotIndex ); }
+	void	SetOutput( int _SlotIndex, U32 _InitialCount=-1 )	{ m_pBuffer->SetOutput( _SlotIndex, _InitialCount ); }
 	void	RemoveFromLastAssignedSlots() const	{ m_pBuffer->RemoveFromLastAssignedSlots(); }
 };
+
+
+//////////////////////////////////////////////////////////////////////////
+// Helper class for the structured buffers rewritten every frame (e.g. dynamic lights & objects)
+// Each frame that writes moves on to the next buffer of a ring (i.e. frame N writes buffer N % RING_SIZE when writing every frame),
+//	so an upload never has to wait for the frames in flight to be done reading the buffer it targets. Before a buffer gets written again, the last frame that used it is explicitly waited for
+//	(cf. Device::WaitForFrame()) so the syncs show in the frame statistics instead of hiding in the driver.
+// SetInput() binds the last written buffer, so a frame that doesn't write still sees the last content.
+//
+template<typename T> class	FrameSB
+{
+public:		// CONSTANTS
+
+	static const int	RING_SIZE = 3;
+
+public:		// FIELDS
+
+	T*					m;
+
+protected:
+
+	Device*				m_pDevice;
+	StructuredBuffer*	m_ppBuffers[RING_SIZE];
+	U32					m_pUsedFrames[RING_SIZE];	// The last frame each buffer was written or bound in (~0U if never used)
+	int					m_CurrentBuffer;			// The last written buffer
+	U32					m_WrittenFrame;				// The frame it was written in
+
+public:		// PROPERTIES
+
+	int							GetElementSize() const		{ return sizeof(T); }
+	int							GetElementsCount() const	{ return m_ppBuffers[0]->GetElementsCount(); }
+	int							GetSize() const				{ return m_ppBuffers[0]->GetSize(); }
+	ID3D11ShaderResourceView*	GetShaderView()				{ return GetStructuredBuffer().GetShaderView(); }
+
+	// The last written buffer
+	StructuredBuffer&	GetStructuredBuffer()	{ return *m_ppBuffers[m_CurrentBuffer]; }
+
+public:		// METHODS
+
+	FrameSB( Device& _Device, int _ElementsCount ) : m_pDevice( &_Device ), m_CurrentBuffer( 0 ), m_WrittenFrame( ~0U )
+	{
+		m = new T[_ElementsCount];
+		memset( m, 0, _ElementsCount * sizeof(T) );
+		for ( int BufferIndex=0; BufferIndex < RING_SIZE; BufferIndex++ )
+		{
+			m_ppBuffers[BufferIndex] = new StructuredBuffer( _Device, sizeof(T), _ElementsCount, false );
+			m_pUsedFrames[BufferIndex] = ~0U;
+		}
+	}
+	~FrameSB()
+	{
+		for ( int BufferIndex=0; BufferIndex < RING_SIZE; BufferIndex++ )
+			delete m_ppBuffers[BufferIndex];
+		delete[] m;
+	}
+
+	// Uploads the first elements of m to the next buffer of the ring and makes it the bound one
+	// NOTE: Writing again in the same frame overwrites that buffer, like a regular SB would
+	void	Write( int _ElementsCount=-1 )
+	{
+		U32	FrameIndex = m_pDevice->GetFrameIndex();
+		if ( m_WrittenFrame != FrameIndex )
+		{
+			m_CurrentBuffer = (m_CurrentBuffer + 1) % RING_SIZE;
+			m_WrittenFrame = FrameIndex;
+			U32	UsedFrame = m_pUsedFrames[m_CurrentBuffer];
+			if ( UsedFrame != ~0U )
+				m_pDevice->WaitForFrame( UsedFrame, "FrameSB::Write" );	// Usually completed already unless RING_SIZE frames or more are in flight
+		}
+		m_pUsedFrames[m_CurrentBuffer] = FrameIndex;
+
+		m_ppBuffers[m_CurrentBuffer]->Write( m, _ElementsCount );
+	}
+
+	void	SetInput( int _SlotIndex, bool _bIKnowWhatImDoing=false )
+	{
+		ASSERT( _SlotIndex >= 10 || _bIKnowWhatImDoing, "WARNING: Assigning a reserved texture slot! (i.e. all slots [0,9] are reserved for global textures)" );
+		m_pUsedFrames[m_CurrentBuffer] = m_pDevice->GetFrameIndex();
+		m_ppBuffers[m_CurrentBuffer]->SetInput( _SlotIndex );
+	}
+	void	RemoveFromLastAssignedSlots() const
+	{
+		for ( int BufferIndex=0; BufferIndex < RING_SIZE; BufferIndex++ )
+			m_ppBuffers[BufferIndex]->RemoveFromLastAssignedSlots();
+	}
+};
@@ -5,6 +5,9 @@ Texture2D::Texture2D( Device& _Device, ID3D11Texture2D& _Texture, const IPixelFo
 	, m_Format( _Format )
 	, m_bIsDepthStencil( false )
 	, m_bIsCubeMap( false )
+	, m_bCanGenerateMips( false )
+	, m_bAutoGenerateMips( false )
+	, m_pReadBackRing( NULL )
 {
 	D3D11_TEXTURE2D_DESC	Desc;
 	_Texture.GetDesc( &Desc );
@@ -30,6 +33,9 @@ Texture2D::Texture2D( Device& _Device, int _Width, int _Height, int _ArraySize,
 	, m_MipLevelsCount( _MipLevelsCount )
 	, m_bIsDepthStencil( false )
 	, m_bIsCubeMap( false )
+	, m_bCanGenerateMips( false )
+	, m_bAutoGenerateMips( false )
+	, m_pReadBackRing( NULL )
 {
 	if ( m_ArraySize < 0 )
 	{	// Special cube map case!
@@ -48,6 +54,9 @@ Texture2D::Texture2D( Device& _Device, int _Width, int _Height, const IDepthSten
 	, m_Format( _Format )
 	, m_bIsDepthStencil( true )
 	, m_bIsCubeMap( false )
+	, m_bCanGenerateMips( false )
+	, m_bAutoGenerateMips( false )
+	, m_pReadBackRing( NULL )
 {
 	ASSERT( _Width <= MAX_TEXTURE_SIZE, "Texture size out of range!" );
 	ASSERT( _Height <= MAX_TEXTURE_SIZE, "Texture size out of range!" );
@@ -77,22 +86,27 @@ Texture2D::Texture2D( Device& _Device, int _Width, int _Height, const IDepthSten
 	Check( m_Device.DXDevice().CreateTexture2D( &Desc, NULL, &m_pTexture ) );
 }
 
-static void		ReleaseDirectXObject( int _EntryIndex, void*& _pValue, void* _pUserData )
-{
-	IUnknown*	pObject = (IUnknown*) _pValue;
-	pObject->Release();
-}
-
 Texture2D::~Texture2D()
 {
 	ASSERT( m_pTexture != NULL, "Invalid texture to destroy!" );
+	m_Device.FlushBindings();	// Make sure the device doesn't hold pending bindings to our views once they're released
+
+	m_CachedSRVs.ReleaseAll();
+	m_CachedRTVs.ReleaseAll();
+	m_CachedUAVs.ReleaseAll();
+	m_CachedDSVs.ReleaseAll();
 
-	m_CachedSRVs.ForEach( ReleaseDirectXObject, NULL );
-	m_CachedRTVs.ForEach( ReleaseDirectXObject, NULL );
-	m_CachedUAVs.ForEach( ReleaseDirectXObject, NULL );
-	m_CachedDSVs.ForEach( ReleaseDirectXObject, NULL );
+	if ( m_pReadBackRing != NULL )
+	{
+		for ( int SlotIndex=0; SlotIndex < READBACK_RING_SIZE; SlotIndex++ )
+		{
+			delete m_pReadBackRing->ppStaging[SlotIndex];
+			m_pReadBackRing->ppEvents[SlotIndex]->Release();
+		}
+		delete m_pReadBackRing;
+	}
 
-	m_pTexture->Release();
+	m_Device.DeferRelease( m_pTexture );	// Frames in flight may still sample it
 	m_pTexture = NULL;
 }
 
@@ -129,6 +143,14 @@ void	Texture2D::Init( const void* const* _ppContent, bool _bStaging, bool _bUnOr
 		Desc.CPUAccessFlags = D3D11_CPU_ACCESS_FLAG( 0 );
 		Desc.BindFlags = _ppContent != NULL ? D3D11_BIND_SHADER_RESOURCE : (D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE | (_bUnOrderedAccess ? D3D11_BIND_UNORDERED_ACCESS: 0));
 		Desc.MiscFlags = m_bIsCubeMap ? D3D11_RESOURCE_MISC_TEXTURECUBE : 0;
+
+		if ( _ppContent == NULL && m_MipLevelsCount > 1 )
+		{	// Render targets with mips can be downsampled by the hardware if the format allows it
+			UINT	FormatSupport = 0;
+			m_bCanGenerateMips = SUCCEEDED( m_Device.DXDevice().CheckFormatSupport( Desc.Format, &FormatSupport ) ) && (FormatSupport & D3D11_FORMAT_SUPPORT_MIP_AUTOGEN) != 0;
+			if ( m_bCanGenerateMips )
+				Desc.MiscFlags |= D3D11_RESOURCE_MISC_GENERATE_MIPS;
+		}
 	}
 
 	if ( _ppContent != NULL )
@@ -141,8 +163,9 @@ void	Texture2D::Init( const void* const* _ppContent, bool _bStaging, bool _bUnOr
 			int	Height = m_Height;
 			for ( int MipLevelIndex=0; MipLevelIndex < m_MipLevelsCount; MipLevelIndex++ )
 			{
-				int	RowPitch = _pMipDescriptors != NULL ? _pMipDescriptors[MipLevelIndex].RowPitch : Width * m_Format.Size();
-				int	DepthPitch = _pMipDescriptors != NULL ? _pMipDescriptors[MipLevelIndex].DepthPitch : Height * RowPitch;
+				int	BlockSize = ((const IPixelFormatDescriptor&) m_Format).BlockSize();	// Pitches of block-compressed formats are given in rows of blocks
+				int	RowPitch = _pMipDescriptors != NULL ? _pMipDescriptors[MipLevelIndex].RowPitch : ((Width+BlockSize-1) / BlockSize) * m_Format.Size();
+				int	DepthPitch = _pMipDescriptors != NULL ? _pMipDescriptors[MipLevelIndex].DepthPitch : ((Height+BlockSize-1) / BlockSize) * RowPitch;
 
 				pInitialData[ArrayIndex*m_MipLevelsCount+MipLevelIndex].pSysMem = _ppContent[ArrayIndex*m_MipLevelsCount+MipLevelIndex];
 				pInitialData[ArrayIndex*m_MipLevelsCount+MipLevelIndex].SysMemPitch = RowPitch;
@@ -171,7 +194,7 @@ ID3D11ShaderResourceView*	Texture2D::GetSRV( int _MipLevelStart, int _MipLevelsC
 	U32	Hash = (_MipLevelStart << 0) | (_ArrayStart << 4) | (_MipLevelsCount << (4+12)) | (_ArraySize << (4+12+4));	// Re-organized to have most likely changes (i.e. mip & array starts) first
 		Hash ^= _AsArray ? 0x80000000UL : 0;
 
-	ID3D11ShaderResourceView*	pExistingView = (ID3D11ShaderResourceView*) m_CachedSRVs.Get( Hash );
+	ID3D11ShaderResourceView*	pExistingView = m_CachedSRVs.Get( Hash );
 	if ( pExistingView != NULL )
 		return pExistingView;
 
@@ -221,7 +244,7 @@ ID3D11RenderTargetView*		Texture2D::GetRTV( int _MipLevelIndex, int _ArrayStart,
 	// Check if we already have it
 //	U32	Hash = _ArraySize | ((_ArrayStart | (_MipLevelIndex << 12)) << 12);
 	U32	Hash = (_MipLevelIndex << 0) | (_ArrayStart << 4) | (_ArraySize << (4+12));	// Re-organized to have most likely changes (i.e. mip & array starts) first
-	ID3D11RenderTargetView*	pExistingView = (ID3D11RenderTargetView*) m_CachedRTVs.Get( Hash );
+	ID3D11RenderTargetView*	pExistingView = m_CachedRTVs.Get( Hash );
 	if ( pExistingView != NULL )
 		return pExistingView;
 
@@ -249,7 +272,7 @@ ID3D11UnorderedAccessView*	Texture2D::GetUAV( int _MipLevelIndex, int _ArrayStar
 	// Check if we already have it
 //	U32	Hash = _ArraySize | ((_ArrayStart | (_MipLevelIndex << 12)) << 12);
 	U32	Hash = (_MipLevelIndex << 0) | (_ArrayStart << 4) | (_ArraySize << (4+12));	// Re-organized to have most likely changes (i.e. mip & array starts) first
-	ID3D11UnorderedAccessView*	pExistingView = (ID3D11UnorderedAccessView*) m_CachedUAVs.Get( Hash );
+	ID3D11UnorderedAccessView*	pExistingView = m_CachedUAVs.Get( Hash );
 	if ( pExistingView != NULL )
 		return pExistingView;
 
@@ -276,7 +299,7 @@ ID3D11DepthStencilView*		Texture2D::GetDSV( int _ArrayStart, int _ArraySize ) co
 
 	// Check if we already have it
 	U32	Hash = (_ArrayStart << 0) | (_ArraySize << 12);
-	ID3D11DepthStencilView*	pExistingView = (ID3D11DepthStencilView*) m_CachedDSVs.Get( Hash );
+	ID3D11DepthStencilView*	pExistingView = m_CachedDSVs.Get( Hash );
 	if ( pExistingView != NULL )
 		return pExistingView;
 
@@ -301,12 +324,7 @@ void	Texture2D::Set( int _SlotIndex, bool _bIKnowWhatImDoing, ID3D11ShaderResour
 	ASSERT( _SlotIndex >= 10 || _bIKnowWhatImDoing, "WARNING: Assigning a reserved texture slot! (i.e. all slots [0,9] are reserved for global textures)" );
 
 	_pView = _pView != NULL ? _pView : GetSRV( 0, 0, 0, 0 );
-	m_Device.DXContext().VSSetShaderResources( _SlotIndex, 1, &_pView );
-	m_Device.DXContext().HSSetShaderResources( _SlotIndex, 1, &_pView );
-	m_Device.DXContext().DSSetShaderResources( _SlotIndex, 1, &_pView );
-	m_Device.DXContext().GSSetShaderResources( _SlotIndex, 1, &_pView );
-	m_Device.DXContext().PSSetShaderResources( _SlotIndex, 1, &_pView );
-	m_Device.DXContext().CSSetShaderResources( _SlotIndex, 1, &_pView );
+	m_Device.SetShaderResource( Device::SSF_ALL, _SlotIndex, _pView );
 	m_LastAssignedSlots[0] = _SlotIndex;
 	m_LastAssignedSlots[1] = _SlotIndex;
 	m_LastAssignedSlots[2] = _SlotIndex;
@@ -320,7 +338,7 @@ void	Texture2D::SetVS( int _SlotIndex, bool _bIKnowWhatImDoing, ID3D11ShaderReso
 	ASSERT( _SlotIndex >= 10 || _bIKnowWhatImDoing, "WARNING: Assigning a reserved texture slot! (i.e. all slots [0,9] are reserved for global textures)" );
 
 	_pView = _pView != NULL ? _pView : GetSRV( 0, 0, 0, 0 );
-	m_Device.DXContext().VSSetShaderResources( _SlotIndex, 1, &_pView );
+	m_Device.SetShaderResource( Device::SSF_VERTEX_SHADER, _SlotIndex, _pView );
 	m_LastAssignedSlots[0] = _SlotIndex;
 }
 void	Texture2D::SetHS( int _SlotIndex, bool _bIKnowWhatImDoing, ID3D11ShaderResourceView* _pView ) const
@@ -328,7 +346,7 @@ void	Texture2D::SetHS( int _SlotIndex, bool _bIKnowWhatImDoing, ID3D11ShaderReso
 	ASSERT( _SlotIndex >= 10 || _bIKnowWhatImDoing, "WARNING: Assigning a reserved texture slot! (i.e. all slots [0,9] are reserved for global textures)" );
 
 	_pView = _pView != NULL ? _pView : GetSRV( 0, 0, 0, 0 );
-	m_Device.DXContext().HSSetShaderResources( _SlotIndex, 1, &_pView );
+	m_Device.SetShaderResource( Device::SSF_HULL_SHADER, _SlotIndex, _pView );
 	m_LastAssignedSlots[1] = _SlotIndex;
 }
 void	Texture2D::SetDS( int _SlotIndex, bool _bIKnowWhatImDoing, ID3D11ShaderResourceView* _pView ) const
@@ -336,7 +354,7 @@ void	Texture2D::SetDS( int _SlotIndex, bool _bIKnowWhatImDoing, ID3D11ShaderReso
 	ASSERT( _SlotIndex >= 10 || _bIKnowWhatImDoing, "WARNING: Assigning a reserved texture slot! (i.e. all slots [0,9] are reserved for global textures)" );
 
 	_pView = _pView != NULL ? _pView : GetSRV( 0, 0, 0, 0 );
-	m_Device.DXContext().DSSetShaderResources( _SlotIndex, 1, &_pView );
+	m_Device.SetShaderResource( Device::SSF_DOMAIN_SHADER, _SlotIndex, _pView );
 	m_LastAssignedSlots[2] = _SlotIndex;
 }
 void	Texture2D::SetGS( int _SlotIndex, bool _bIKnowWhatImDoing, ID3D11ShaderResourceView* _pView ) const
@@ -344,7 +362,7 @@ void	Texture2D::SetGS( int _SlotIndex, bool _bIKnowWhatImDoing, ID3D11ShaderReso
 	ASSERT( _SlotIndex >= 10 || _bIKnowWhatImDoing, "WARNING: Assigning a reserved texture slot! (i.e. all slots [0,9] are reserved for global textures)" );
 
 	_pView = _pView != NULL ? _pView : GetSRV( 0, 0, 0, 0 );
-	m_Device.DXContext().GSSetShaderResources( _SlotIndex, 1, &_pView );
+	m_Device.SetShaderResource( Device::SSF_GEOMETRY_SHADER, _SlotIndex, _pView );
 	m_LastAssignedSlots[3] = _SlotIndex;
 }
 void	Texture2D::SetPS( int _SlotIndex, bool _bIKnowWhatImDoing, ID3D11ShaderResourceView* _pView ) const
@@ -352,7 +370,7 @@ void	Texture2D::SetPS( int _SlotIndex, bool _bIKnowWhatImDoing, ID3D11ShaderReso
 	ASSERT( _SlotIndex >= 10 || _bIKnowWhatImDoing, "WARNING: Assigning a reserved texture slot! (i.e. all slots [0,9] are reserved for global textures)" );
 
 	_pView = _pView != NULL ? _pView : GetSRV( 0, 0, 0, 0 );
-	m_Device.DXContext().PSSetShaderResources( _SlotIndex, 1, &_pView );
+	m_Device.SetShaderResource( Device::SSF_PIXEL_SHADER, _SlotIndex, _pView );
 	m_LastAssignedSlots[4] = _SlotIndex;
 }
 void	Texture2D::SetCS( int _SlotIndex, bool _bIKnowWhatImDoing, ID3D11ShaderResourceView* _pView ) const
@@ -360,7 +378,7 @@ void	Texture2D::SetCS( int _SlotIndex, bool _bIKnowWhatImDoing, ID3D11ShaderReso
 	ASSERT( _SlotIndex >= 10 || _bIKnowWhatImDoing, "WARNING: Assigning a reserved texture slot! (i.e. all slots [0,9] are reserved for global textures)" );
 
 	_pView = _pView != NULL ? _pView : GetSRV( 0, 0, 0, 0 );
-	m_Device.DXContext().CSSetShaderResources( _SlotIndex, 1, &_pView );
+	m_Device.SetShaderResource( Device::SSF_COMPUTE_SHADER, _SlotIndex, _pView );
 	m_LastAssignedSlots[5] = _SlotIndex;
 }
 
@@ -387,7 +405,7 @@ void	Texture2D::SetCSUAV( int _SlotIndex, ID3D11UnorderedAccessView* _pView ) co
 {
 	_pView = _pView != NULL ? _pView : GetUAV( 0, 0, 0 );
 	UINT	InitialCount = -1;
-	m_Device.DXContext().CSSetUnorderedAccessViews( _SlotIndex, 1, &_pView, &InitialCount );
+	m_Device.SetUnorderedAccessView( _SlotIndex, _pView, InitialCount );
 	m_LastAssignedSlotsUAV = _SlotIndex;
 }
 
@@ -396,7 +414,7 @@ void	Texture2D::RemoveFromLastAssignedSlotUAV() const
 	ID3D11UnorderedAccessView*	pNULL = NULL;
 	UINT	InitialCount = -1;
 	if ( m_LastAssignedSlotsUAV != -1 )
-		m_Device.DXContext().CSSetUnorderedAccessViews( m_LastAssignedSlotsUAV, 1, &pNULL, &InitialCount );
+		m_Device.SetUnorderedAccessView( m_LastAssignedSlotsUAV, pNULL, InitialCount );
 	m_LastAssignedSlotsUAV = -1;
 }
 
@@ -410,9 +428,29 @@ void	Texture2D::CopyFrom( Texture2D& _SourceTexture )
 	m_Device.DXContext().CopyResource( m_pTexture, _SourceTexture.m_pTexture );
 }
 
+void	Texture2D::CopyRegionFrom( const Texture2D& _SourceTexture, int _ArrayIndex, int _SourceX, int _SourceY, int _Width, int _Height, int _TargetX, int _TargetY )
+{
+	ASSERT( _SourceTexture.m_Format.DirectXFormat() == m_Format.DirectXFormat(), "Format mismatch!" );
+	ASSERT( _ArrayIndex < m_ArraySize && _ArrayIndex < _SourceTexture.m_ArraySize, "Array index out of range!" );
+	ASSERT( _SourceX >= 0 && _SourceY >= 0 && _SourceX+_Width <= _SourceTexture.m_Width && _SourceY+_Height <= _SourceTexture.m_Height, "Source rectangle out of range!" );
+	ASSERT( _TargetX >= 0 && _TargetY >= 0 && _TargetX+_Width <= m_Width && _TargetY+_Height <= m_Height, "Target rectangle out of range!" );
+	if ( _Width <= 0 || _Height <= 0 )
+		return;
+
+	D3D11_BOX	SourceBox;
+	SourceBox.left = _SourceX;
+	SourceBox.top = _SourceY;
+	SourceBox.front = 0;
+	SourceBox.right = _SourceX + _Width;
+	SourceBox.bottom = _SourceY + _Height;
+	SourceBox.back = 1;
+
+	m_Device.DXContext().CopySubresourceRegion( m_pTexture, CalcSubResource( 0, _ArrayIndex ), _TargetX, _TargetY, 0, _SourceTexture.m_pTexture, _SourceTexture.CalcSubResource( 0, _ArrayIndex ), &SourceBox );
+}
+
 D3D11_MAPPED_SUBRESOURCE&	Texture2D::Map( int _MipLevelIndex, int _ArrayIndex )
 {
-	Check( m_Device.DXContext().Map( m_pTexture, CalcSubResource( _MipLevelIndex, _ArrayIndex ), D3D11_MAP_READ, 0, &m_LockedResource ) );
+	Check( m_Device.Map( m_pTexture, CalcSubResource( _MipLevelIndex, _ArrayIndex ), D3D11_MAP_READ, m_LockedResource, "Texture2D::Map" ) );
 	return m_LockedResource;
 }
 
@@ -421,6 +459,110 @@ void	Texture2D::UnMap( int _MipLevelIndex, int _ArrayIndex )
 	m_Device.DXContext().Unmap( m_pTexture, CalcSubResource( _MipLevelIndex, _ArrayIndex ) );
 }
 
+void	Texture2D::UpdateSubResource( int _MipLevelIndex, int _ArrayIndex, const void* _pContent, int _RowPitch, int _DepthPitch )
+{
+	ASSERT( _MipLevelIndex < m_MipLevelsCount && _ArrayIndex < m_ArraySize, "Sub-resource out of range!" );
+	m_Device.DXContext().UpdateSubresource( m_pTexture, CalcSubResource( _MipLevelIndex, _ArrayIndex ), NULL, _pContent, _RowPitch, _DepthPitch );
+	m_Device.CountUpload( _DepthPitch );
+}
+
+void	Texture2D::SetMinLOD( float _MinLOD )
+{
+	m_Device.DXContext().SetResourceMinLOD( m_pTexture, _MinLOD );
+}
+
+bool	Texture2D::GenerateMips() const
+{
+	if ( !m_bCanGenerateMips )
+		return false;
+
+	m_Device.DXContext().GenerateMips( GetSRV() );
+	return true;
+}
+
+void	Texture2D::SetAutoGenerateMips( bool _bEnable )
+{
+	ASSERT( !_bEnable || m_bCanGenerateMips, "This texture can't have its mips generated by the hardware!" );
+	m_bAutoGenerateMips = _bEnable && m_bCanGenerateMips;
+}
+
+int		Texture2D::ReadAsync()
+{
+	ASSERT( !m_bIsDepthStencil, "Depth stencil textures can't be read back!" );
+	if ( m_pReadBackRing == NULL )
+	{	// Create the ring of staging textures
+		m_pReadBackRing = new ReadBackRing;
+		m_pReadBackRing->NextTicket = 0;
+
+		D3D11_QUERY_DESC	QueryDesc;
+		QueryDesc.Query = D3D11_QUERY_EVENT;
+		QueryDesc.MiscFlags = 0;
+
+		for ( int SlotIndex=0; SlotIndex < READBACK_RING_SIZE; SlotIndex++ )
+		{
+			m_pReadBackRing->ppStaging[SlotIndex] = new Texture2D( m_Device, m_Width, m_Height, m_ArraySize, (const IPixelFormatDescriptor&) m_Format, m_MipLevelsCount, NULL, true );
+			Check( m_Device.DXDevice().CreateQuery( &QueryDesc, &m_pReadBackRing->ppEvents[SlotIndex] ) );
+			m_pReadBackRing->pTickets[SlotIndex] = -1;
+		}
+	}
+
+	int	Ticket = m_pReadBackRing->NextTicket;
+	int	SlotIndex = Ticket % READBACK_RING_SIZE;
+	if ( m_pReadBackRing->pTickets[SlotIndex] != -1 )
+		return -1;	// Oldest readback not resolved yet...
+
+	m_pReadBackRing->NextTicket = (Ticket + 1) & 0x7FFFFFFF;
+	m_pReadBackRing->pTickets[SlotIndex] = Ticket;
+
+	// Queue the copy followed by the event that will tell us when it's done
+	m_pReadBackRing->ppStaging[SlotIndex]->CopyFrom( *this );
+	m_Device.DXContext().End( m_pReadBackRing->ppEvents[SlotIndex] );
+
+	return Ticket;
+}
+
+Texture2D*	Texture2D::TryResolve( int _Ticket )
+{
+	ASSERT( m_pReadBackRing != NULL && _Ticket >= 0, "Invalid readback ticket!" );
+	int	SlotIndex = _Ticket % READBACK_RING_SIZE;
+	ASSERT( m_pReadBackRing->pTickets[SlotIndex] == _Ticket, "Readback ticket was already resolved!" );
+
+	// Check the copy has been executed without flushing the command buffer (the next Present() will)
+	if ( m_Device.DXContext().GetData( m_pReadBackRing->ppEvents[SlotIndex], NULL, 0, D3D11_ASYNC_GETDATA_DONOTFLUSH ) != S_OK )
+		return NULL;	// Not yet...
+
+	m_pReadBackRing->pTickets[SlotIndex] = -1;
+	return m_pReadBackRing->ppStaging[SlotIndex];
+}
+
+U64		Texture2D::GetVideoMemorySize() const
+{
+	if ( m_pTexture == NULL )
+		return 0;
+
+	int	BlockSize = m_bIsDepthStencil ? 1 : ((const IPixelFormatDescriptor&) m_Format).BlockSize();
+	U64	SliceSize = 0;
+	int	Width = m_Width;
+	int	Height = m_Height;
+	for ( int MipLevelIndex=0; MipLevelIndex < m_MipLevelsCount; MipLevelIndex++ )
+	{
+		SliceSize += U64( (Width+BlockSize-1) / BlockSize ) * ((Height+BlockSize-1) / BlockSize) * m_Format.Size();
+		NextMipSize( Width, Height );
+	}
+
+	return SliceSize * m_ArraySize;
+}
+
+Device::MEMORY_CATEGORY	Texture2D::GetVideoMemoryCategory() const
+{
+	if ( m_pTexture == NULL )
+		return Device::MC_TEXTURE;
+
+	D3D11_TEXTURE2D_DESC	Desc;
+	m_pTexture->GetDesc( &Desc );
+	return GetTextureCategory( Desc.Usage, Desc.BindFlags );
+}
+
 void	Texture2D::NextMipSize( int& _Width, int& _Height )
 {
 	_Width = MAX( 1, _Width >> 1 );
@@ -441,7 +583,7 @@ int	 Texture2D::ComputeMipLevelsCount( int _Width, int _Height, int _MipLevelsCo
 	return _MipLevelsCount;
 }
 
-int	Texture2D::CalcSubResource( int _MipLevelIndex, int _ArrayIndex )
+int	Texture2D::CalcSubResource( int _MipLevelIndex, int _ArrayIndex ) const
 {
 	return _MipLevelIndex + (_ArrayIndex * m_MipLevelsCount);
 }
@@ -557,6 +699,9 @@ Texture2D::Texture2D( Device& _Device, const TextureFilePOM& _POM, bool _bUnOrde
 	, m_MipLevelsCount( _POM.m_MipsCount )
 	, m_bIsDepthStencil( false )
 	, m_bIsCubeMap( _POM.m_Type == TextureFilePOM::TEX_CUBE )
+	, m_bCanGenerateMips( false )
+	, m_bAutoGenerateMips( false )
+	, m_pReadBackRing( NULL )
 {
 	Init( _POM.m_ppContent, false, _bUnOrderedAccess, _POM.m_pMipsDescriptors );
 }
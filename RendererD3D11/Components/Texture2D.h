@@ -3,6 +3,7 @@
 #include "Component.h"
 #include "../Structures/PixelFormats.h"
 #include "../Structures/DepthStencilFormats.h"
+#include "../Structures/ViewCache.h"
 #include "../../Utility/TextureFilePOM.h"
 
 class Texture2D : public Component
@@ -11,8 +12,15 @@ protected:	// CONSTANTS
 
 	static const int	MAX_TEXTURE_SIZE = 8192;	// Should be enough!
 	static const int	MAX_TEXTURE_POT = 13;
+	static const int	READBACK_RING_SIZE = 3;		// Maximum amount of asynchronous readbacks in flight
 
-	static const int	HASHTABLE_SIZE = 1 << 13;	// 8Kb per hashtable, 3 hashtable per texture => 24Kb overhead
+	struct	ReadBackRing
+	{
+		Texture2D*		ppStaging[READBACK_RING_SIZE];
+		ID3D11Query*	ppEvents[READBACK_RING_SIZE];
+		int				pTickets[READBACK_RING_SIZE];	// -1 if the staging texture is free
+		int				NextTicket;
+	};
 
 private:	// FIELDS
 
@@ -24,18 +32,23 @@ private:	// FIELDS
 	const IFormatDescriptor&		m_Format;
 	bool							m_bIsDepthStencil;
 	bool							m_bIsCubeMap;
+	bool							m_bCanGenerateMips;		// True if the texture was created with D3D11_RESOURCE_MISC_GENERATE_MIPS (cf. GenerateMips())
+	bool							m_bAutoGenerateMips;	// True if the mips get generated each time the texture stops being the render target
 
 	ID3D11Texture2D*				m_pTexture;
 
 	// Cached resource views
-	mutable DictionaryU32			m_CachedSRVs;
-	mutable DictionaryU32			m_CachedRTVs;
-	mutable DictionaryU32			m_CachedUAVs;
-	mutable DictionaryU32			m_CachedDSVs;
+	mutable ViewCache<ID3D11ShaderResourceView>		m_CachedSRVs;
+	mutable ViewCache<ID3D11RenderTargetView>		m_CachedRTVs;
+	mutable ViewCache<ID3D11UnorderedAccessView>	m_CachedUAVs;
+	mutable ViewCache<ID3D11DepthStencilView>		m_CachedDSVs;
 	mutable int						m_LastAssignedSlots[6];
 	mutable int						m_LastAssignedSlotsUAV;
 	D3D11_MAPPED_SUBRESOURCE		m_LockedResource;
 
+	// Staging textures for asynchronous readbacks (allocated on first use, cf. ReadAsync())
+	ReadBackRing*					m_pReadBackRing;
+
 
 public:	 // PROPERTIES
 
@@ -44,6 +57,8 @@ public:	 // PROPERTIES
 	int							GetArraySize() const		{ return m_ArraySize; }
 	int							GetMipLevelsCount() const	{ return m_MipLevelsCount; }
 	bool						IsCubeMap() const			{ return m_bIsCubeMap; }
+	bool						CanGenerateMips() const		{ return m_bCanGenerateMips; }
+	bool						GetAutoGenerateMips() const	{ return m_bAutoGenerateMips; }
 	const IFormatDescriptor&	GetFormatDescriptor() const	{ return m_Format; }
 
 	float3						GetdUV() const				{ return float3( 1.0f / m_Width, 1.0f / m_Height, 0.0f ); }
@@ -82,9 +97,30 @@ public:	 // METHODS
 
 	// Texture access by the CPU
 	void		CopyFrom( Texture2D& _SourceTexture );
+	void		CopyRegionFrom( const Texture2D& _SourceTexture, int _ArrayIndex, int _SourceX, int _SourceY, int _Width, int _Height, int _TargetX, int _TargetY );	// Copies a rectangle of the first mip of a single array slice
 	D3D11_MAPPED_SUBRESOURCE&	Map( int _MipLevelIndex, int _ArrayIndex );
 	void		UnMap( int _MipLevelIndex, int _ArrayIndex );
 
+	// Uploads the content of a single mip of a default usage texture (cf. TextureStreamer)
+	void		UpdateSubResource( int _MipLevelIndex, int _ArrayIndex, const void* _pContent, int _RowPitch, int _DepthPitch );
+	// Clamps the most detailed mip all the views can sample (e.g. while the higher mips are still streaming in)
+	void		SetMinLOD( float _MinLOD );
+
+	// Rebuilds the mips 1 to N of a render target from its mip 0 with the hardware downsampler
+	// Only render targets with mips whose format supports D3D11_FORMAT_SUPPORT_MIP_AUTOGEN can do that (cf. CanGenerateMips()),
+	//	returns false otherwise so the caller can fall back to the compute downsampler (cf. Utility/MipGenerator.h)
+	bool		GenerateMips() const;
+	// When enabled, the Device calls GenerateMips() each time the texture gets unbound as render target so its mips always match
+	//	what was rendered last (only for textures that CanGenerateMips())
+	void		SetAutoGenerateMips( bool _bEnable );
+
+	// Asynchronous read for GPU feedback that doesn't stall the pipeline
+	// ReadAsync() queues a copy of the entire texture into a staging texture and returns a ticket, or -1 if all the staging textures are still in flight.
+	// TryResolve() returns NULL until the GPU has executed the copy (usually a couple of frames later), then the staging texture that can be
+	//	mapped without stalling. It stays valid until its slot gets reused by a later ReadAsync(). Every ticket must eventually be resolved.
+	int			ReadAsync();
+	Texture2D*	TryResolve( int _Ticket );
+
 #if defined(_DEBUG) || !defined(GODCOMPLEX)
 	// I/O for staging textures
 	void		Save( const char* _pFileName );
@@ -97,7 +133,11 @@ public:	 // METHODS
 public:
 	static void	NextMipSize( int& _Width, int& _Height );
 	static int	ComputeMipLevelsCount( int _Width, int _Height, int _MipLevelsCount );
-	int			CalcSubResource( int _MipLevelIndex, int _ArrayIndex );
+	int			CalcSubResource( int _MipLevelIndex, int _ArrayIndex ) const;
+
+	// All the mips of all the slices (the staging textures used by ReadAsync() are components of their own)
+	virtual U64	GetVideoMemorySize() const;
+	virtual Device::MEMORY_CATEGORY	GetVideoMemoryCategory() const;
 
 private:
 	// _bStaging, true if this is a staging texture (i.e. CPU accessible as read/write)
@@ -11,25 +11,31 @@ Texture3D::Texture3D( Device& _Device, int _Width, int _Height, int _Depth, cons
 	Init( _ppContent, _bStaging, _bUnOrderedAccess );
 }
 
-static void		ReleaseDirectXObject( int _EntryIndex, void*& _pValue, void* _pUserData )
+Texture3D::Texture3D( Device& _Device, int _Width, int _Height, int _Depth, const IPixelFormatDescriptor& _Format, int _MipLevelsCount, const void* const* _ppContent, const TextureFilePOM::MipDescriptor* _pMipDescriptors )
+	: Component( _Device )
+	, m_Width( _Width )
+	, m_Height( _Height )
+	, m_Depth( _Depth )
+	, m_Format( _Format )
+	, m_MipLevelsCount( _MipLevelsCount )
 {
-	IUnknown*	pObject = (IUnknown*) _pValue;
-	pObject->Release();
+	Init( _ppContent, false, false, _pMipDescriptors );
 }
 
 Texture3D::~Texture3D()
 {
 	ASSERT( m_pTexture != NULL, "Invalid texture to destroy !" );
+	m_Device.FlushBindings();	// Make sure the device doesn't hold pending bindings to our views once they're released
 
-	m_CachedSRVs.ForEach( ReleaseDirectXObject, NULL );
-	m_CachedRTVs.ForEach( ReleaseDirectXObject, NULL );
-	m_CachedUAVs.ForEach( ReleaseDirectXObject, NULL );
+	m_CachedSRVs.ReleaseAll();
+	m_CachedRTVs.ReleaseAll();
+	m_CachedUAVs.ReleaseAll();
 
-	m_pTexture->Release();
+	m_Device.DeferRelease( m_pTexture );	// Frames in flight may still sample it
 	m_pTexture = NULL;
 }
 
-void	Texture3D::Init( const void* const* _ppContent, bool _bStaging, bool _bUnOrderedAccess, TextureFilePOM::MipDescriptor* _pMipDescriptors )
+void	Texture3D::Init( const void* const* _ppContent, bool _bStaging, bool _bUnOrderedAccess, const TextureFilePOM::MipDescriptor* _pMipDescriptors )
 {
 	ASSERT( m_Width <= MAX_TEXTURE_SIZE, "Texture size out of range !" );
 	ASSERT( m_Height <= MAX_TEXTURE_SIZE, "Texture size out of range !" );
@@ -100,7 +106,7 @@ ID3D11ShaderResourceView*	Texture3D::GetSRV( int _MipLevelStart, int _MipLevelsC
 		Hash = _MipLevelStart | (_MipLevelsCount << 4);
 	Hash ^= _AsArray ? 0x80000000UL : 0;
 
-	ID3D11ShaderResourceView*	pExistingView = (ID3D11ShaderResourceView*) m_CachedSRVs.Get( Hash );
+	ID3D11ShaderResourceView*	pExistingView = m_CachedSRVs.Get( Hash );
 	if ( pExistingView != NULL )
 		return pExistingView;
 
@@ -137,7 +143,7 @@ ID3D11RenderTargetView*		Texture3D::GetRTV( int _MipLevelIndex, int _FirstWSlice
 	// Check if we already have it
 //	U32	Hash = _WSize | ((_FirstWSlice | (_MipLevelIndex << 12)) << 12);
 	U32	Hash = (_MipLevelIndex << 0) | (_FirstWSlice << 12) | (_WSize << (4+12));	// Re-organized to have most likely changes (i.e. mip & slice starts) first
-	ID3D11RenderTargetView*	pExistingView = (ID3D11RenderTargetView*) m_CachedRTVs.Get( Hash );
+	ID3D11RenderTargetView*	pExistingView = m_CachedRTVs.Get( Hash );
 	if ( pExistingView != NULL )
 		return pExistingView;
 
@@ -164,7 +170,7 @@ ID3D11UnorderedAccessView*	Texture3D::GetUAV( int _MipLevelIndex, int _FirstWSli
 	// Check if we already have it
 //	U32	Hash = _WSize | ((_FirstWSlice | (_MipLevelIndex << 12)) << 12);
 	U32	Hash = (_MipLevelIndex << 0) | (_FirstWSlice << 12) | (_WSize << (4+12));	// Re-organized to have most likely changes (i.e. mip & slice starts) first
-	ID3D11UnorderedAccessView*	pExistingView = (ID3D11UnorderedAccessView*) m_CachedUAVs.Get( Hash );
+	ID3D11UnorderedAccessView*	pExistingView = m_CachedUAVs.Get( Hash );
 	if ( pExistingView != NULL )
 		return pExistingView;
 
@@ -189,12 +195,7 @@ void	Texture3D::Set( int _SlotIndex, bool _bIKnowWhatImDoing, ID3D11ShaderResour
 	ASSERT( _SlotIndex >= 10 || _bIKnowWhatImDoing, "WARNING: Assigning a reserved texture slot ! (i.e. all slots [0,9] are reserved for global textures)" );
 
 	_pView = _pView != NULL ? _pView : GetSRV( 0, 0 );
-	m_Device.DXContext().VSSetShaderResources( _SlotIndex, 1, &_pView );
-	m_Device.DXContext().HSSetShaderResources( _SlotIndex, 1, &_pView );
-	m_Device.DXContext().DSSetShaderResources( _SlotIndex, 1, &_pView );
-	m_Device.DXContext().GSSetShaderResources( _SlotIndex, 1, &_pView );
-	m_Device.DXContext().PSSetShaderResources( _SlotIndex, 1, &_pView );
-	m_Device.DXContext().CSSetShaderResources( _SlotIndex, 1, &_pView );
+	m_Device.SetShaderResource( Device::SSF_ALL, _SlotIndex, _pView );
 	m_LastAssignedSlots[0] = _SlotIndex;
 	m_LastAssignedSlots[1] = _SlotIndex;
 	m_LastAssignedSlots[2] = _SlotIndex;
@@ -207,7 +208,7 @@ void	Texture3D::SetVS( int _SlotIndex, bool _bIKnowWhatImDoing, ID3D11ShaderReso
 	ASSERT( _SlotIndex >= 10 || _bIKnowWhatImDoing, "WARNING: Assigning a reserved texture slot ! (i.e. all slots [0,9] are reserved for global textures)" );
 
 	_pView = _pView != NULL ? _pView : GetSRV( 0, 0 );
-	m_Device.DXContext().VSSetShaderResources( _SlotIndex, 1, &_pView );
+	m_Device.SetShaderResource( Device::SSF_VERTEX_SHADER, _SlotIndex, _pView );
 	m_LastAssignedSlots[0] = _SlotIndex;
 }
 void	Texture3D::SetHS( int _SlotIndex, bool _bIKnowWhatImDoing, ID3D11ShaderResourceView* _pView ) const
@@ -215,7 +216,7 @@ void	Texture3D::SetHS( int _SlotIndex, bool _bIKnowWhatImDoing, ID3D11ShaderReso
 	ASSERT( _SlotIndex >= 10 || _bIKnowWhatImDoing, "WARNING: Assigning a reserved texture slot ! (i.e. all slots [0,9] are reserved for global textures)" );
 
 	_pView = _pView != NULL ? _pView : GetSRV( 0, 0 );
-	m_Device.DXContext().HSSetShaderResources( _SlotIndex, 1, &_pView );
+	m_Device.SetShaderResource( Device::SSF_HULL_SHADER, _SlotIndex, _pView );
 	m_LastAssignedSlots[1] = _SlotIndex;
 }
 void	Texture3D::SetDS( int _SlotIndex, bool _bIKnowWhatImDoing, ID3D11ShaderResourceView* _pView ) const
@@ -223,7 +224,7 @@ void	Texture3D::SetDS( int _SlotIndex, bool _bIKnowWhatImDoing, ID3D11ShaderReso
 	ASSERT( _SlotIndex >= 10 || _bIKnowWhatImDoing, "WARNING: Assigning a reserved texture slot ! (i.e. all slots [0,9] are reserved for global textures)" );
 
 	_pView = _pView != NULL ? _pView : GetSRV( 0, 0 );
-	m_Device.DXContext().DSSetShaderResources( _SlotIndex, 1, &_pView );
+	m_Device.SetShaderResource( Device::SSF_DOMAIN_SHADER, _SlotIndex, _pView );
 	m_LastAssignedSlots[2] = _SlotIndex;
 }
 void	Texture3D::SetGS( int _SlotIndex, bool _bIKnowWhatImDoing, ID3D11ShaderResourceView* _pView ) const
@@ -231,7 +232,7 @@ void	Texture3D::SetGS( int _SlotIndex, bool _bIKnowWhatImDoing, ID3D11ShaderReso
 	ASSERT( _SlotIndex >= 10 || _bIKnowWhatImDoing, "WARNING: Assigning a reserved texture slot ! (i.e. all slots [0,9] are reserved for global textures)" );
 
 	_pView = _pView != NULL ? _pView : GetSRV( 0, 0 );
-	m_Device.DXContext().GSSetShaderResources( _SlotIndex, 1, &_pView );
+	m_Device.SetShaderResource( Device::SSF_GEOMETRY_SHADER, _SlotIndex, _pView );
 	m_LastAssignedSlots[3] = _SlotIndex;
 }
 void	Texture3D::SetPS( int _SlotIndex, bool _bIKnowWhatImDoing, ID3D11ShaderResourceView* _pView ) const
@@ -239,7 +240,7 @@ void	Texture3D::SetPS( int _SlotIndex, bool _bIKnowWhatImDoing, ID3D11ShaderReso
 	ASSERT( _SlotIndex >= 10 || _bIKnowWhatImDoing, "WARNING: Assigning a reserved texture slot ! (i.e. all slots [0,9] are reserved for global textures)" );
 
 	_pView = _pView != NULL ? _pView : GetSRV( 0, 0 );
-	m_Device.DXContext().PSSetShaderResources( _SlotIndex, 1, &_pView );
+	m_Device.SetShaderResource( Device::SSF_PIXEL_SHADER, _SlotIndex, _pView );
 	m_LastAssignedSlots[4] = _SlotIndex;
 }
 void	Texture3D::SetCS( int _SlotIndex, bool _bIKnowWhatImDoing, ID3D11ShaderResourceView* _pView ) const
@@ -247,7 +248,7 @@ void	Texture3D::SetCS( int _SlotIndex, bool _bIKnowWhatImDoing, ID3D11ShaderReso
 	ASSERT( _SlotIndex >= 10 || _bIKnowWhatImDoing, "WARNING: Assigning a reserved texture slot ! (i.e. all slots [0,9] are reserved for global textures)" );
 
 	_pView = _pView != NULL ? _pView : GetSRV( 0, 0 );
-	m_Device.DXContext().CSSetShaderResources( _SlotIndex, 1, &_pView );
+	m_Device.SetShaderResource( Device::SSF_COMPUTE_SHADER, _SlotIndex, _pView );
 	m_LastAssignedSlots[5] = _SlotIndex;
 }
 
@@ -273,7 +274,7 @@ void	Texture3D::SetCSUAV( int _SlotIndex, ID3D11UnorderedAccessView* _pView ) co
 {
 	_pView = _pView != NULL ? _pView : GetUAV( 0, 0, 0 );
 	UINT	InitialCount = -1;
-	m_Device.DXContext().CSSetUnorderedAccessViews( _SlotIndex, 1, &_pView, &InitialCount );
+	m_Device.SetUnorderedAccessView( _SlotIndex, _pView, InitialCount );
 	m_LastAssignedSlotsUAV = _SlotIndex;
 }
 
@@ -282,7 +283,7 @@ void	Texture3D::RemoveFromLastAssignedSlotUAV() const
 	ID3D11UnorderedAccessView*	pNULL = NULL;
 	UINT	InitialCount = -1;
 	if ( m_LastAssignedSlotsUAV != -1 )
-		m_Device.DXContext().CSSetUnorderedAccessViews( m_LastAssignedSlotsUAV, 1, &pNULL, &InitialCount );
+		m_Device.SetUnorderedAccessView( m_LastAssignedSlotsUAV, pNULL, InitialCount );
 	m_LastAssignedSlotsUAV = -1;
 }
 
@@ -298,7 +299,7 @@ void	Texture3D::CopyFrom( Texture3D& _SourceTexture )
 
 D3D11_MAPPED_SUBRESOURCE&	Texture3D::Map( int _MipLevelIndex )
 {
-	Check( m_Device.DXContext().Map( m_pTexture, _MipLevelIndex, D3D11_MAP_READ, 0, &m_LockedResource ) );
+	Check( m_Device.Map( m_pTexture, _MipLevelIndex, D3D11_MAP_READ, m_LockedResource, "Texture3D::Map" ) );
 	return m_LockedResource;
 }
 
@@ -307,6 +308,35 @@ void	Texture3D::UnMap( int _MipLevelIndex )
 	m_Device.DXContext().Unmap( m_pTexture, _MipLevelIndex );
 }
 
+U64		Texture3D::GetVideoMemorySize() const
+{
+	if ( m_pTexture == NULL )
+		return 0;
+
+	int	BlockSize = m_Format.BlockSize();
+	U64	Size = 0;
+	int	Width = m_Width;
+	int	Height = m_Height;
+	int	Depth = m_Depth;
+	for ( int MipLevelIndex=0; MipLevelIndex < m_MipLevelsCount; MipLevelIndex++ )
+	{
+		Size += U64( (Width+BlockSize-1) / BlockSize ) * ((Height+BlockSize-1) / BlockSize) * Depth * m_Format.Size();
+		NextMipSize( Width, Height, Depth );
+	}
+
+	return Size;
+}
+
+Device::MEMORY_CATEGORY	Texture3D::GetVideoMemoryCategory() const
+{
+	if ( m_pTexture == NULL )
+		return Device::MC_TEXTURE;
+
+	D3D11_TEXTURE3D_DESC	Desc;
+	m_pTexture->GetDesc( &Desc );
+	return GetTextureCategory( Desc.Usage, Desc.BindFlags );
+}
+
 void	Texture3D::NextMipSize( int& _Width, int& _Height, int& _Depth )
 {
 	_Width = MAX( 1, _Width >> 1 );
@@ -2,6 +2,7 @@
 
 #include "Component.h"
 #include "../Structures/PixelFormats.h"
+#include "../Structures/ViewCache.h"
 #include "../../Utility/TextureFilePOM.h"
 
 class Texture3D : public Component
@@ -22,9 +23,9 @@ private:	// FIELDS
 	ID3D11Texture3D*	m_pTexture;
 
 	// Cached resource views
-	mutable DictionaryU32			m_CachedSRVs;
-	mutable DictionaryU32			m_CachedRTVs;
-	mutable DictionaryU32			m_CachedUAVs;
+	mutable ViewCache<ID3D11ShaderResourceView>		m_CachedSRVs;
+	mutable ViewCache<ID3D11RenderTargetView>		m_CachedRTVs;
+	mutable ViewCache<ID3D11UnorderedAccessView>	m_CachedUAVs;
 	mutable int						m_LastAssignedSlots[6];
 	mutable int						m_LastAssignedSlotsUAV;
 	D3D11_MAPPED_SUBRESOURCE		m_LockedResource;
@@ -44,6 +45,8 @@ public:	 // METHODS
 
 	// NOTE: If _ppContents == NULL then the texture is considered a render target !
 	Texture3D( Device& _Device, int _Width, int _Height, int _Depth, const IPixelFormatDescriptor& _Format, int _MipLevelsCount, const void* const* _ppContent, bool _bStaging=false, bool _bUnOrderedAccess=false );
+	// Creates an immutable texture whose mips have the given row & depth pitches (e.g. mips mapped straight from a POM file)
+	Texture3D( Device& _Device, int _Width, int _Height, int _Depth, const IPixelFormatDescriptor& _Format, int _MipLevelsCount, const void* const* _ppContent, const TextureFilePOM::MipDescriptor* _pMipDescriptors );
 	~Texture3D();
 
 	// _AsArray is used to force the SRV as viewing a Texture2DArray instead of a Texture3D (note that otherwise, _FirstWSlice and _WSize are not used)
@@ -83,11 +86,14 @@ public:
 	static void	NextMipSize( int& _Width, int& _Height, int& _Depth );
 	static int	ComputeMipLevelsCount( int _Width, int _Height, int _Depth, int _MipLevelsCount );
 
+	virtual U64	GetVideoMemorySize() const;
+	virtual Device::MEMORY_CATEGORY	GetVideoMemoryCategory() const;
+
 private:
 	// _bStaging, true if this is a staging texture (i.e. CPU accessible as read/write)
 	// _bUnOrderedAccess, true if the texture can also be used as a UAV (Random access read/write from a compute shader)
 	// _pMipDescriptors, if not NULL then the row pitch & depth pitch will be read from this array for each mip level
 	//
-	void		Init( const void* const* _ppContent, bool _bStaging=false, bool _bUnOrderedAccess=false, TextureFilePOM::MipDescriptor* _pMipDescriptors=NULL );
+	void		Init( const void* const* _ppContent, bool _bStaging=false, bool _bUnOrderedAccess=false, const TextureFilePOM::MipDescriptor* _pMipDescriptors=NULL );
 };
 
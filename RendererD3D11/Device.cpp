@@ -4,34 +4,111 @@
 #include "Components/Texture3D.h"
 #include "Components/StructuredBuffer.h"
 #include "Components/States.h"
+#include "Components/PipelineState.h"
+#include "GPUProfiler.h"
+#include "JobQueue.h"
+#include "RenderTargetPool.h"
+#include "Components/DynamicGeometry.h"
+#include "../Utility/Jobs.h"
+
+Device::ContextState::ContextState()
+	: pContext( NULL )
+	, pCurrentMaterial( NULL )
+	, pCurrentRasterizerState( NULL )
+	, pCurrentDepthStencilState( NULL )
+	, pCurrentBlendState( NULL )
+	, pCurrentPipelineState( NULL )
+	, pAutoMipsTarget( NULL )
+	, DirtyStagesMask( 0 )
+	, BindingRequestsCount( 0 )
+	, BindingCallsCount( 0 ) {
+	IA.Invalidate();
+	Counters.Reset();
+	for ( int StageIndex=0; StageIndex < SHADER_STAGES_COUNT; StageIndex++ )
+		for ( int SlotIndex=0; SlotIndex < SHADOW_CB_SLOTS; SlotIndex++ )
+		{
+			pStageBindings[StageIndex].pCBFirstConstants[SlotIndex] = 0;
+			pStageBindings[StageIndex].pCBNumConstants[SlotIndex] = D3D11_REQ_CONSTANT_BUFFER_ELEMENT_COUNT;
+		}
+}
+
+void	Device::FrameCounters::Add( const FrameCounters& _Other )
+{
+	DrawsCount += _Other.DrawsCount;
+	DispatchesCount += _Other.DispatchesCount;
+	ShaderSwitchesCount += _Other.ShaderSwitchesCount;
+	StateChangesCount += _Other.StateChangesCount;
+	RenderTargetSwitchesCount += _Other.RenderTargetSwitchesCount;
+	UploadedBytes += _Other.UploadedBytes;
+	ConstantUploadsCount += _Other.ConstantUploadsCount;
+	SkippedConstantUploadsCount += _Other.SkippedConstantUploadsCount;
+	MapsCount += _Other.MapsCount;
+	MapStallsCount += _Other.MapStallsCount;
+	MapWaitDuration += _Other.MapWaitDuration;
+	FenceWaitsCount += _Other.FenceWaitsCount;
+	FenceWaitDuration += _Other.FenceWaitDuration;
+}
+
+const float	Device::MAP_STALL_THRESHOLD = 0.5f;
 
 Device::Device()
 	: m_pDevice( NULL )
 	, m_pDeviceContext( NULL )
-	, m_pComponentsStackTop( NULL )
-	, m_pCurrentMaterial( NULL )
-	, m_pCurrentRasterizerState( NULL )
-	, m_pCurrentDepthStencilState( NULL )
-	, m_pCurrentBlendState( NULL )
+	, m_pDeviceContext1( NULL )
+	, m_bHDR10Output( false )
+	, m_bVSRenderTargetArrayIndex( false )
+	, m_bConstantBufferPartialUpdates( false )
+	, m_DedicatedVideoMemory( 0 )
+	, m_bOverBudget( false )
+	, m_FirstFreeComponentSlot( ~0U )
+	, m_ComponentsCount( 0 )
+	, m_FirstDeferredRelease( 0 )
+	, m_SamplerStatesCount( 0 )
+	, m_NamedSamplersCount( 0 )
+	, m_ContextStateTLS( TLS_OUT_OF_INDEXES )
+	, m_pJobs( NULL )
+	, m_pRenderTargets( NULL )
+	, m_pDynamicGeometry( NULL )
+	, m_pUploadRing( NULL )
+	, m_UploadRingOffset( 0 )
+	, m_pConstantRing( NULL )
+	, m_ConstantRingOffset( 0 )
+	, m_ConstantRingGeneration( 0 )
+#ifdef GPU_PROFILING
+	, m_pProfiler( NULL )
+#endif
+	, m_FrameIndex( 0 )
+	, m_CompletedFramesCount( 0 )
+	, m_MaxFramesInFlight( 2 )
+	, m_LastBindingRequestsCount( 0 )
+	, m_LastBindingCallsCount( 0 )
+	, m_MapSitesCount( 0 )
+	, m_bMapDoNotWait( false )
 	, m_BlendFactors( 1, 1, 1, 1 )
 	, m_BlendMasks( ~0 )
 	, m_StencilRef( 0 ) {
+	InitializeCriticalSection( &m_Lock );
+	m_RenderThreadID = GetCurrentThreadId();
 }
 
-int		Device::ComponentsCount() const
+Component*	Device::GetComponent( U32 _Handle ) const
 {
-	int			Count = -2 - m_StatesCount;	// Start without counting for our internal back buffer & depth stencil components
-	Component*	pCurrent = m_pComponentsStackTop;
-	while ( pCurrent != NULL )
+	U32	SlotIndex = _Handle & COMPONENT_INDEX_MASK;
+
+	EnterCriticalSection( const_cast<CRITICAL_SECTION*>( &m_Lock ) );
+	Component*	pResult = NULL;
+	if ( SlotIndex < U32(m_ComponentSlots.GetCount()) )
 	{
-		Count++;
-		pCurrent = pCurrent->m_pPrevious;
+		const ComponentSlot&	Slot = m_ComponentSlots[SlotIndex];
+		if ( Slot.Generation == (_Handle >> COMPONENT_INDEX_BITS) )
+			pResult = Slot.pComponent;
 	}
+	LeaveCriticalSection( const_cast<CRITICAL_SECTION*>( &m_Lock ) );
 
-	return Count;
+	return pResult;
 }
 
-bool	Device::Init( HWND _Handle, bool _Fullscreen, bool _sRGB )
+bool	Device::Init( HWND _Handle, bool _Fullscreen, bool _sRGB, bool _HDR10 )
 {
 	RECT	Rect;
 	if ( !GetWindowRect( _Handle, &Rect ) )
@@ -40,11 +117,16 @@ bool	Device::Init( HWND _Handle, bool _Fullscreen, bool _sRGB )
 	int	Width = Rect.right - Rect.left;
 	int	Height = Rect.bottom - Rect.top;
 
-	return Init( Width, Height, _Handle, _Fullscreen, _sRGB );
+	return Init( Width, Height, _Handle, _Fullscreen, _sRGB, _HDR10 );
 }
 
-bool	Device::Init( U32 _Width, U32 _Height, HWND _Handle, bool _Fullscreen, bool _sRGB )
+bool	Device::Init( U32 _Width, U32 _Height, HWND _Handle, bool _Fullscreen, bool _sRGB, bool _HDR10 )
 {
+#ifndef HDR10_OUTPUT
+	ASSERT( !_HDR10, "HDR10 swap chains require HDR10_OUTPUT!" );
+	_HDR10 = false;
+#endif
+
 	// Create a swap chain with 2 back buffers
 	DXGI_SWAP_CHAIN_DESC	SwapChainDesc;
 
@@ -70,6 +152,16 @@ bool	Device::Init( U32 _Width, U32 _Height, HWND _Handle, bool _Fullscreen, bool
 	SwapChainDesc.Windowed = !_Fullscreen;
 	SwapChainDesc.Flags = 0;
 
+#ifdef HDR10_OUTPUT
+	if ( _HDR10 )
+	{	// The HDR color spaces are only available to flip model swap chains, which can't be sRGB
+		SwapChainDesc.BufferDesc.Format = DXGI_FORMAT_R10G10B10A2_UNORM;
+		SwapChainDesc.BufferUsage = DXGI_USAGE_BACK_BUFFER | DXGI_USAGE_RENDER_TARGET_OUTPUT;
+		SwapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
+		_sRGB = false;
+	}
+#endif
+
 	int	FeatureLevelsCount = 1;
 	#ifdef DIRECTX10
 		#ifdef TRY_DIRECTX10_1
@@ -85,28 +177,106 @@ bool	Device::Init( U32 _Width, U32 _Height, HWND _Handle, bool _Fullscreen, bool
 	D3D_FEATURE_LEVEL	ObtainedFeatureLevel;
 
 
+	// Each thread can be bound to a different context state (the immediate context is used when nothing is bound)
+	m_RenderThreadID = GetCurrentThreadId();
+	m_ContextStateTLS = TlsAlloc();
+	ASSERT( m_ContextStateTLS != TLS_OUT_OF_INDEXES, "Failed to allocate TLS slot for context states!" );
+
 	#if defined(_DEBUG) && !defined(NSIGHT)
 		UINT	DebugFlags = D3D11_CREATE_DEVICE_DEBUG;
 	#else
 		UINT	DebugFlags = 0;
 	#endif
 
- 	if ( !Check(
-		D3D11CreateDeviceAndSwapChain( NULL, D3D_DRIVER_TYPE_HARDWARE, NULL,
+	#ifdef _DEBUG
+		UINT	VideoFlags = D3D11_CREATE_DEVICE_VIDEO_SUPPORT;	// So Media Foundation can decode into our textures (cf. Utility/VideoSource.h)
+	#else
+		UINT	VideoFlags = 0;
+	#endif
+
+	HRESULT	Result = D3D11CreateDeviceAndSwapChain( NULL, D3D_DRIVER_TYPE_HARDWARE, NULL,
+			DebugFlags | VideoFlags,
+			FeatureLevels, FeatureLevelsCount,
+			D3D11_SDK_VERSION,
+			&SwapChainDesc, &m_pSwapChain,
+			&m_pDevice, &ObtainedFeatureLevel, &m_pDeviceContext );
+	if ( FAILED( Result ) && VideoFlags != 0 )
+		Result = D3D11CreateDeviceAndSwapChain( NULL, D3D_DRIVER_TYPE_HARDWARE, NULL,	// No video support on that driver/OS, videos will fail to open
 			DebugFlags,
 			FeatureLevels, FeatureLevelsCount,
 			D3D11_SDK_VERSION,
 			&SwapChainDesc, &m_pSwapChain,
-			&m_pDevice, &ObtainedFeatureLevel, &m_pDeviceContext ) )
-		)
+			&m_pDevice, &ObtainedFeatureLevel, &m_pDeviceContext );
+ 	if ( !Check( Result ) )
 		return false;
 
+	m_ImmediateState.pContext = m_pDeviceContext;
+
+#ifdef HDR10_OUTPUT
+	// Present the back buffer as PQ-encoded Rec.2020 if the display supports it
+	m_bHDR10Output = false;
+	IDXGISwapChain3*	pSwapChain3 = NULL;
+	if ( _HDR10 && SUCCEEDED( m_pSwapChain->QueryInterface( __uuidof(IDXGISwapChain3), (void**) &pSwapChain3 ) ) )
+	{
+		UINT	ColorSpaceSupport = 0;
+		if (	SUCCEEDED( pSwapChain3->CheckColorSpaceSupport( DXGI_COLOR_SPACE_RGB_FULL_G2084_NONE_P2020, &ColorSpaceSupport ) )
+			&&	(ColorSpaceSupport & DXGI_SWAP_CHAIN_COLOR_SPACE_SUPPORT_FLAG_PRESENT) != 0 )
+			m_bHDR10Output = SUCCEEDED( pSwapChain3->SetColorSpace1( DXGI_COLOR_SPACE_RGB_FULL_G2084_NONE_P2020 ) );
+		pSwapChain3->Release();
+	}
+#endif
+
+	// Constant buffer offsets require the D3D11.1 runtime and driver support
+	D3D11_FEATURE_DATA_D3D11_OPTIONS	Options;
+	if (	SUCCEEDED( m_pDevice->CheckFeatureSupport( D3D11_FEATURE_D3D11_OPTIONS, &Options, sizeof(Options) ) )
+		&&	Options.ConstantBufferOffsetting && Options.MapNoOverwriteOnDynamicConstantBuffer )
+	{
+		if ( FAILED( m_pDeviceContext->QueryInterface( __uuidof(ID3D11DeviceContext1), (void**) &m_pDeviceContext1 ) ) )
+			m_pDeviceContext1 = NULL;
+	}
+	m_bConstantBufferPartialUpdates = m_pDeviceContext1 != NULL && Options.ConstantBufferPartialUpdate != FALSE;	// Only the changed range of the constants gets uploaded (cf. ConstantBuffer::UpdateData())
+
+	// Letting the vertex shader pick the render target slice requires the D3D11.3 runtime and driver support
+	m_bVSRenderTargetArrayIndex = false;
+#ifdef D3D11_3_OPTIONS
+	D3D11_FEATURE_DATA_D3D11_OPTIONS3	Options3;
+	if ( SUCCEEDED( m_pDevice->CheckFeatureSupport( D3D11_FEATURE_D3D11_OPTIONS3, &Options3, sizeof(Options3) ) ) )
+		m_bVSRenderTargetArrayIndex = Options3.VPAndRTArrayIndexFromAnyShaderFeedingRasterizer != FALSE;
+#endif
+
+	// Retrieve the adapter's memory for the budget (cf. GetVideoMemoryBudget())
+#ifdef VIDEO_MEMORY_BUDGET
+	m_pAdapter3 = NULL;
+#endif
+	IDXGIDevice*	pDXGIDevice = NULL;
+	if ( SUCCEEDED( m_pDevice->QueryInterface( __uuidof(IDXGIDevice), (void**) &pDXGIDevice ) ) )
+	{
+		IDXGIAdapter*	pAdapter = NULL;
+		if ( SUCCEEDED( pDXGIDevice->GetAdapter( &pAdapter ) ) )
+		{
+			DXGI_ADAPTER_DESC	AdapterDesc;
+			if ( SUCCEEDED( pAdapter->GetDesc( &AdapterDesc ) ) )
+				m_DedicatedVideoMemory = AdapterDesc.DedicatedVideoMemory;
+#ifdef VIDEO_MEMORY_BUDGET
+			if ( FAILED( pAdapter->QueryInterface( __uuidof(IDXGIAdapter3), (void**) &m_pAdapter3 ) ) )
+				m_pAdapter3 = NULL;
+#endif
+			pAdapter->Release();
+		}
+		pDXGIDevice->Release();
+	}
+
+	// We don't know anything about the context's bindings yet
+	InvalidateBindings();
+
 	// Store the default render target
 	ID3D11Texture2D*	pDefaultRenderSurface;
 	m_pSwapChain->GetBuffer( 0, __uuidof( ID3D11Texture2D ), (void**) &pDefaultRenderSurface );
 	ASSERT( pDefaultRenderSurface != NULL, "Failed to retrieve default render surface !" );
 
-	if ( _sRGB )
+	if ( _HDR10 )
+		m_pDefaultRenderTarget = new Texture2D( *this, *pDefaultRenderSurface, PixelFormatRGB10A2::DESCRIPTOR );
+	else if ( _sRGB )
 		m_pDefaultRenderTarget = new Texture2D( *this, *pDefaultRenderSurface, PixelFormatRGBA8_sRGB::DESCRIPTOR );
 	else
 		m_pDefaultRenderTarget = new Texture2D( *this, *pDefaultRenderSurface, PixelFormatRGBA8::DESCRIPTOR );
@@ -276,19 +446,24 @@ bool	Device::Init( U32 _Width, U32 _Height, HWND _Handle, bool _Fullscreen, bool
 	Desc.MinLOD = -D3D11_FLOAT32_MAX;
 	Desc.MaxLOD = D3D11_FLOAT32_MAX;
 
-	m_pDevice->CreateSamplerState( &Desc, &m_ppSamplers[0] );	// Linear Clamp
+	m_ppSamplers[0] = RegisterSamplerState( "LinearClamp", Desc ).m_pState;
 	Desc.Filter = D3D11_FILTER_MIN_MAG_MIP_POINT;
-	m_pDevice->CreateSamplerState( &Desc, &m_ppSamplers[1] );	// Point Clamp
+	m_ppSamplers[1] = RegisterSamplerState( "PointClamp", Desc ).m_pState;
 
 	Desc.AddressU = Desc.AddressV = Desc.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
-	m_pDevice->CreateSamplerState( &Desc, &m_ppSamplers[3] );	// Point Wrap
+	m_ppSamplers[3] = RegisterSamplerState( "PointWrap", Desc ).m_pState;
+	Desc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+	m_ppSamplers[2] = RegisterSamplerState( "LinearWrap", Desc ).m_pState;
+
+	// Anisotropic filtering is only for the shaders asking for it (e.g. terrain at grazing angles)
+	Desc.Filter = D3D11_FILTER_ANISOTROPIC;
+	RegisterSamplerState( "AnisotropicWrap", Desc );
 	Desc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
-	m_pDevice->CreateSamplerState( &Desc, &m_ppSamplers[2] );	// Linear Wrap
 
 	Desc.AddressU = Desc.AddressV = Desc.AddressW = D3D11_TEXTURE_ADDRESS_MIRROR;
-	m_pDevice->CreateSamplerState( &Desc, &m_ppSamplers[4] );	// Linear Mirror
+	m_ppSamplers[4] = RegisterSamplerState( "LinearMirror", Desc ).m_pState;
 	Desc.Filter = D3D11_FILTER_MIN_MAG_MIP_POINT;
-	m_pDevice->CreateSamplerState( &Desc, &m_ppSamplers[5] );	// Point Mirror
+	m_ppSamplers[5] = RegisterSamplerState( "PointMirror", Desc ).m_pState;
 
 	Desc.AddressU = Desc.AddressV = Desc.AddressW = D3D11_TEXTURE_ADDRESS_BORDER;
 	Desc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
@@ -296,22 +471,73 @@ bool	Device::Init( U32 _Width, U32 _Height, HWND _Handle, bool _Fullscreen, bool
 	Desc.BorderColor[1] = 0.0f;
 	Desc.BorderColor[2] = 0.0f;
 	Desc.BorderColor[3] = 0.0f;
-	m_pDevice->CreateSamplerState( &Desc, &m_ppSamplers[6] );	// Linear Black Border
+	m_ppSamplers[6] = RegisterSamplerState( "LinearBlackBorder", Desc ).m_pState;
 
 	// Shadow sampler with comparison
 	Desc.AddressU = Desc.AddressV = Desc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
 	Desc.Filter = D3D11_FILTER_COMPARISON_MIN_MAG_MIP_LINEAR;
 	Desc.ComparisonFunc = D3D11_COMPARISON_LESS_EQUAL;
-	m_pDevice->CreateSamplerState( &Desc, &m_ppSamplers[7] );
+	m_ppSamplers[7] = RegisterSamplerState( "ShadowComparison", Desc ).m_pState;
 
 
 	// Upload them once and for all
-	m_pDeviceContext->VSSetSamplers( 0, SAMPLERS_COUNT, m_ppSamplers );
-	m_pDeviceContext->HSSetSamplers( 0, SAMPLERS_COUNT, m_ppSamplers );
-	m_pDeviceContext->DSSetSamplers( 0, SAMPLERS_COUNT, m_ppSamplers );
-	m_pDeviceContext->GSSetSamplers( 0, SAMPLERS_COUNT, m_ppSamplers );
-	m_pDeviceContext->PSSetSamplers( 0, SAMPLERS_COUNT, m_ppSamplers );
-	m_pDeviceContext->CSSetSamplers( 0, SAMPLERS_COUNT, m_ppSamplers );
+	SetSamplers( SSF_ALL, 0, SAMPLERS_COUNT, m_ppSamplers );
+	FlushBindings();
+
+	m_pJobs = new JobQueue();
+	m_pRenderTargets = new RenderTargetPool( *this );
+	m_pDynamicGeometry = new DynamicGeometry( *this );
+
+	{	// Create the upload ring
+		D3D11_BUFFER_DESC	Desc;
+		Desc.ByteWidth = UPLOAD_RING_SIZE;
+		Desc.Usage = D3D11_USAGE_DYNAMIC;
+		Desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;	// Dynamic buffers need at least one bind flag although it's only used as a copy source
+		Desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		Desc.MiscFlags = 0;
+		Desc.StructureByteStride = 0;
+
+		Check( m_pDevice->CreateBuffer( &Desc, NULL, &m_pUploadRing ) );
+		m_UploadRingOffset = UPLOAD_RING_SIZE;	// First upload will discard
+	}
+
+	if ( m_pDeviceContext1 != NULL )
+	{	// Create the transient constants ring
+		D3D11_BUFFER_DESC	Desc;
+		Desc.ByteWidth = CONSTANT_RING_SIZE;
+		Desc.Usage = D3D11_USAGE_DYNAMIC;
+		Desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		Desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		Desc.MiscFlags = 0;
+		Desc.StructureByteStride = 0;
+
+		Check( m_pDevice->CreateBuffer( &Desc, NULL, &m_pConstantRing ) );
+		m_ConstantRingOffset = CONSTANT_RING_SIZE;	// First allocation will discard
+	}
+
+#ifdef GPU_PROFILING
+	m_pProfiler = new GPUProfiler( *this );
+#endif
+
+	{	// Create the end of frame events
+		D3D11_QUERY_DESC	Desc;
+		Desc.Query = D3D11_QUERY_EVENT;
+		Desc.MiscFlags = 0;
+		for ( int FrameIndex=0; FrameIndex < MAX_FRAMES_IN_FLIGHT; FrameIndex++ )
+			Check( m_pDevice->CreateQuery( &Desc, &m_ppFrameEvents[FrameIndex] ) );
+		m_FrameIndex = 0;
+		m_CompletedFramesCount = 0;
+		SetMaxFramesInFlight( m_MaxFramesInFlight );
+	}
+
+	{	// Start measuring the first frame
+		LARGE_INTEGER	Frequency;
+		QueryPerformanceFrequency( &Frequency );
+		m_TicksToMilliseconds = 1000.0 / Frequency.QuadPart;
+		QueryPerformanceCounter( &m_LastPresentTicks );
+		memset( &m_LastFrameStats, 0, sizeof(FrameStats) );
+		m_ImmediateState.Counters.Reset();
+	}
 
 	return true;
 }
@@ -321,21 +547,55 @@ void	Device::Exit()
 	if ( m_pDevice == NULL )
 		return; // Already released !
 
-	// Dispose of all the registered components in reverse order (we should only be left with default targets & states if you were clean)
-	while ( m_pComponentsStackTop != NULL )
-		delete m_pComponentsStackTop;  // DIE !!
+#ifdef GPU_PROFILING
+	delete m_pProfiler; m_pProfiler = NULL;
+#endif
+
+	delete m_pJobs; m_pJobs = NULL;	// Waits for pending jobs
+	FlushRenderThreadJobs();		// Jobs posted by loader threads may own components
+	delete m_pRenderTargets; m_pRenderTargets = NULL;
+	delete m_pDynamicGeometry; m_pDynamicGeometry = NULL;
+
+	for ( int FrameIndex=0; FrameIndex < MAX_FRAMES_IN_FLIGHT; FrameIndex++ )
+		m_ppFrameEvents[FrameIndex]->Release();
+
+	m_pUploadRing->Release(); m_pUploadRing = NULL;
+	if ( m_pConstantRing != NULL )
+		m_pConstantRing->Release();
+	m_pConstantRing = NULL;
 
-	// Dispose of samplers
-	for ( int SamplerIndex=0; SamplerIndex < SAMPLERS_COUNT; SamplerIndex++ )
-		m_ppSamplers[SamplerIndex]->Release();
+	// Dispose of all the registered components, last slots first (we should only be left with default targets & states if you were clean)
+	for ( int SlotIndex=m_ComponentSlots.GetCount()-1; SlotIndex >= 0; SlotIndex-- )
+		if ( m_ComponentSlots[SlotIndex].pComponent != NULL )
+			delete m_ComponentSlots[SlotIndex].pComponent;  // DIE !!
+	m_ComponentSlots.Clear();
+	m_FirstFreeComponentSlot = ~0U;
+
+	// The cached samplers were components
+	m_SamplerStatesCount = 0;
+	m_NamedSamplersCount = 0;
 
 	m_pSwapChain->Release();
 
 	m_pDeviceContext->ClearState();
 	m_pDeviceContext->Flush();
 
+	FlushDeferredReleases( ~0U );	// Nothing references the deferred objects anymore
+
+	if ( m_pDeviceContext1 != NULL )
+		m_pDeviceContext1->Release();
+	m_pDeviceContext1 = NULL;
+#ifdef VIDEO_MEMORY_BUDGET
+	if ( m_pAdapter3 != NULL )
+		m_pAdapter3->Release();
+	m_pAdapter3 = NULL;
+#endif
 	m_pDeviceContext->Release(); m_pDeviceContext = NULL;
+	m_ImmediateState.pContext = NULL;
 	m_pDevice->Release(); m_pDevice = NULL;
+
+	TlsFree( m_ContextStateTLS );
+	m_ContextStateTLS = TLS_OUT_OF_INDEXES;
 }
 
 void	Device::ClearRenderTarget( const Texture2D& _Target, const float4& _Color )
@@ -350,7 +610,7 @@ void	Device::ClearRenderTarget( const Texture3D& _Target, const float4& _Color )
 
 void	Device::ClearRenderTarget( ID3D11RenderTargetView& _TargetView, const float4& _Color )
 {
-	m_pDeviceContext->ClearRenderTargetView( &_TargetView, &_Color.x );
+	State().pContext->ClearRenderTargetView( &_TargetView, &_Color.x );
 }
 
 void	Device::ClearDepthStencil( const Texture2D& _DepthStencil, float _Z, U8 _Stencil, bool _bClearDepth, bool _bClearStencil )
@@ -359,7 +619,7 @@ void	Device::ClearDepthStencil( const Texture2D& _DepthStencil, float _Z, U8 _St
 }
 void	Device::ClearDepthStencil( ID3D11DepthStencilView& _DepthStencil, float _Z, U8 _Stencil, bool _bClearDepth, bool _bClearStencil )
 {
-	m_pDeviceContext->ClearDepthStencilView( &_DepthStencil, (_bClearDepth ? D3D11_CLEAR_DEPTH : 0) | (_bClearStencil ? D3D11_CLEAR_STENCIL : 0), _Z, _Stencil );
+	State().pContext->ClearDepthStencilView( &_DepthStencil, (_bClearDepth ? D3D11_CLEAR_DEPTH : 0) | (_bClearStencil ? D3D11_CLEAR_STENCIL : 0), _Z, _Stencil );
 }
 
 void	Device::SetRenderTarget( const Texture2D& _Target, const Texture2D* _pDepthStencil, const D3D11_VIEWPORT* _pViewport )
@@ -368,6 +628,8 @@ void	Device::SetRenderTarget( const Texture2D& _Target, const Texture2D* _pDepth
 	ID3D11DepthStencilView*	pDepthStencilView = _pDepthStencil != NULL ? _pDepthStencil->GetDSV() : NULL;
 
 	SetRenderTargets( _Target.GetWidth(), _Target.GetHeight(), 1, &pTargetView, pDepthStencilView, _pViewport );
+	if ( _Target.GetAutoGenerateMips() )
+		State().pAutoMipsTarget = &_Target;
 }
 
 void	Device::SetRenderTarget( const Texture3D& _Target, const Texture2D* _pDepthStencil, const D3D11_VIEWPORT* _pViewport )
@@ -384,7 +646,7 @@ void	Device::SetRenderTarget( int _Width, int _Height, const ID3D11RenderTargetV
 	SetRenderTargets( _Width, _Height, 1, (ID3D11RenderTargetView* const*) &pTargetView, _pDepthStencil, _pViewport );
 }
 
-void	Device::SetRenderTargets( int _Width, int _Height, int _TargetsCount, ID3D11RenderTargetView* const * _ppTargets, ID3D11DepthStencilView* _pDepthStencil, const D3D11_VIEWPORT* _pViewport )
+void	Device::SetRenderTargets( int _Width, int _Height, int _TargetsCount, ID3D11RenderTargetView* const * _ppTargets, ID3D11DepthStencilView* _pDepthStencil, const D3D11_VIEWPORT* _pViewport, int _ViewportsCount )
 {
 	if ( _pViewport == NULL )
 	{	// Use default viewport
@@ -395,48 +657,366 @@ void	Device::SetRenderTargets( int _Width, int _Height, int _TargetsCount, ID3D1
 		Viewport.Height = float(_Height);
 		Viewport.MinDepth = 0.0f;
 		Viewport.MaxDepth = 1.0f;
-		m_pDeviceContext->RSSetViewports( 1, &Viewport );
+		State().pContext->RSSetViewports( 1, &Viewport );
 	}
 	else
-		m_pDeviceContext->RSSetViewports( 1, _pViewport );
+		State().pContext->RSSetViewports( _ViewportsCount, _pViewport );
+
+	// Binding render targets may silently unbind shader resources so we must send pending bindings first
+	//	and forget about what we thought was bound afterward
+	FlushBindings();
+	State().pContext->OMSetRenderTargets( _TargetsCount, _ppTargets, _pDepthStencil );
+	State().Counters.RenderTargetSwitchesCount++;
+	InvalidateShaderResources();
+
+	if ( State().pAutoMipsTarget != NULL )
+	{	// The previous target is now unbound and can generate its mips
+		State().pAutoMipsTarget->GenerateMips();
+		State().pAutoMipsTarget = NULL;
+	}
+}
+
+void	Device::SetPixelShaderUAVs( int _Width, int _Height, int _UAVsCount, ID3D11UnorderedAccessView* const * _ppUAVs )
+{
+	D3D11_VIEWPORT	Viewport;
+	Viewport.TopLeftX = 0;
+	Viewport.TopLeftY = 0;
+	Viewport.Width = float(_Width);
+	Viewport.Height = float(_Height);
+	Viewport.MinDepth = 0.0f;
+	Viewport.MaxDepth = 1.0f;
+	State().pContext->RSSetViewports( 1, &Viewport );
+
+	// Same as SetRenderTargets(), the UAVs may silently unbind shader resources
+	FlushBindings();
+	State().pContext->OMSetRenderTargetsAndUnorderedAccessViews( 0, NULL, NULL, 0, _UAVsCount, _ppUAVs, NULL );
+	State().Counters.RenderTargetSwitchesCount++;
+	InvalidateShaderResources();
+
+	if ( State().pAutoMipsTarget != NULL )
+	{	// The previous target is now unbound and can generate its mips
+		State().pAutoMipsTarget->GenerateMips();
+		State().pAutoMipsTarget = NULL;
+	}
+}
 
-	m_pDeviceContext->OMSetRenderTargets( _TargetsCount, _ppTargets, _pDepthStencil );
+void	Device::UploadBuffer( ID3D11Buffer& _Target, U32 _TargetOffset, const void* _pData, U32 _Size )
+{
+	if ( _Size == 0 )
+		return;
+	CountUpload( _Size );
+	if ( !IsImmediate() || _Size > UPLOAD_RING_SIZE )
+	{	// Deferred contexts can't map with NO_OVERWRITE so let the runtime handle the copy
+		D3D11_BOX	Box;
+		Box.left = _TargetOffset;
+		Box.right = _TargetOffset + _Size;
+		Box.top = 0;	Box.bottom = 1;
+		Box.front = 0;	Box.back = 1;
+		DXContext().UpdateSubresource( &_Target, 0, &Box, _pData, 0, 0 );
+		return;
+	}
+
+	// Suballocate from the ring (16 bytes aligned)
+	D3D11_MAP	MapType = D3D11_MAP_WRITE_NO_OVERWRITE;
+	if ( m_UploadRingOffset + _Size > UPLOAD_RING_SIZE )
+	{	// Wrap around
+		MapType = D3D11_MAP_WRITE_DISCARD;
+		m_UploadRingOffset = 0;
+	}
+	U32	Offset = m_UploadRingOffset;
+	m_UploadRingOffset = (Offset + _Size + 15) & ~15U;
+
+	D3D11_MAPPED_SUBRESOURCE	SubResource;
+	Check( Map( m_pUploadRing, 0, MapType, SubResource, "Device::UploadBuffer" ) );
+	memcpy( (U8*) SubResource.pData + Offset, _pData, _Size );
+	m_pDeviceContext->Unmap( m_pUploadRing, 0 );
+
+	// Copy only the written bytes
+	D3D11_BOX	Box;
+	Box.left = Offset;
+	Box.right = Offset + _Size;
+	Box.top = 0;	Box.bottom = 1;
+	Box.front = 0;	Box.back = 1;
+	m_pDeviceContext->CopySubresourceRegion( &_Target, 0, _TargetOffset, 0, 0, m_pUploadRing, 0, &Box );
+}
+
+U32		Device::AllocateConstants( const void* _pData, U32 _Size )
+{
+	ASSERT( SupportsConstantOffsets(), "Constant buffer offsets are not supported!" );
+	ASSERT( IsImmediate(), "Transient constants can only be allocated from the thread owning the immediate context!" );
+	ASSERT( _Size <= 16*D3D11_REQ_CONSTANT_BUFFER_ELEMENT_COUNT, "Too many constants!" );
+
+	U32			AlignedSize = (_Size + CONSTANT_RING_ALIGNMENT-1) & ~(CONSTANT_RING_ALIGNMENT-1);
+	D3D11_MAP	MapType = D3D11_MAP_WRITE_NO_OVERWRITE;
+	if ( m_ConstantRingOffset + AlignedSize > CONSTANT_RING_SIZE )
+	{	// Wrap around
+		MapType = D3D11_MAP_WRITE_DISCARD;
+		m_ConstantRingOffset = 0;
+		m_ConstantRingGeneration++;
+	}
+	U32	Offset = m_ConstantRingOffset;
+	m_ConstantRingOffset += AlignedSize;
+
+	D3D11_MAPPED_SUBRESOURCE	SubResource;
+	Check( Map( m_pConstantRing, 0, MapType, SubResource, "Device::AllocateConstants" ) );
+	memcpy( (U8*) SubResource.pData + Offset, _pData, _Size );
+	m_pDeviceContext->Unmap( m_pConstantRing, 0 );
+	CountUpload( _Size );
+
+	return Offset >> 4;
+}
+
+HRESULT	Device::Map( ID3D11Resource* _pResource, U32 _SubResource, D3D11_MAP _MapType, D3D11_MAPPED_SUBRESOURCE& _Mapped, const char* _pSite, bool _bCanDefer )
+{
+	if ( !IsImmediate() )	// Deferred contexts only map with DISCARD, which never waits
+		return DXContext().Map( _pResource, _SubResource, _MapType, 0, &_Mapped );
+
+	MapSite&		Site = FindMapSite( _pSite );
+	LARGE_INTEGER	Start, End;
+	QueryPerformanceCounter( &Start );
+
+	HRESULT	Result = DXGI_ERROR_WAS_STILL_DRAWING;
+	bool	bCanAttempt = _MapType != D3D11_MAP_WRITE_DISCARD && _MapType != D3D11_MAP_WRITE_NO_OVERWRITE;	// DO_NOT_WAIT isn't allowed with these
+	if ( m_bMapDoNotWait && bCanAttempt )
+	{
+		Result = m_pDeviceContext->Map( _pResource, _SubResource, _MapType, D3D11_MAP_FLAG_DO_NOT_WAIT, &_Mapped );
+		if ( Result == DXGI_ERROR_WAS_STILL_DRAWING )
+		{
+			Site.DeferredCount++;
+			if ( _bCanDefer )
+				return Result;	// The caller will try again later
+		}
+	}
+	if ( Result == DXGI_ERROR_WAS_STILL_DRAWING )
+		Result = m_pDeviceContext->Map( _pResource, _SubResource, _MapType, 0, &_Mapped );
+
+	QueryPerformanceCounter( &End );
+	float	Wait = float( (End.QuadPart - Start.QuadPart) * m_TicksToMilliseconds );
+
+	FrameCounters&	Counters = m_ImmediateState.Counters;
+	Counters.MapsCount++;
+	Counters.MapWaitDuration += Wait;
+	Site.MapsCount++;
+	Site.TotalWait += Wait;
+	if ( Wait > MAP_STALL_THRESHOLD )
+	{
+		Counters.MapStallsCount++;
+		Site.StallsCount++;
+		if ( Wait > Site.MaxWait )
+		{	// Only report the worst stalls so a site stalling every frame doesn't flood the output
+			char	pWarning[256];
+			_snprintf_s( pWarning, 256, _TRUNCATE, "WARNING: Map() stalled for %.2f ms in %s (%d stalls out of %d maps)\n", Wait, Site.pName, Site.StallsCount, Site.MapsCount );
+			OutputDebugStringA( pWarning );
+		}
+	}
+	Site.MaxWait = MAX( Site.MaxWait, Wait );
+
+	return Result;
+}
+
+void	Device::GetVideoMemoryUsage( VideoMemoryUsage& _Usage ) const
+{
+	memset( &_Usage, 0, sizeof(VideoMemoryUsage) );
+
+	EnterCriticalSection( const_cast<CRITICAL_SECTION*>( &m_Lock ) );
+	for ( int SlotIndex=0; SlotIndex < m_ComponentSlots.GetCount(); SlotIndex++ )
+	{
+		const Component*	pComponent = m_ComponentSlots[SlotIndex].pComponent;
+		if ( pComponent == NULL )
+			continue;
+
+		U64	Size = pComponent->GetVideoMemorySize();
+		if ( Size == 0 )
+			continue;	// Shaders, states, transient buffers...
+
+		MEMORY_CATEGORY	Category = pComponent->GetVideoMemoryCategory();
+		_Usage.pSizes[Category] += Size;
+		_Usage.pCounts[Category]++;
+	}
+	LeaveCriticalSection( const_cast<CRITICAL_SECTION*>( &m_Lock ) );
+
+	// Add our own rings
+	ID3D11Buffer*	ppRings[] = { m_pUploadRing, m_pConstantRing };
+	for ( int RingIndex=0; RingIndex < 2; RingIndex++ )
+		if ( ppRings[RingIndex] != NULL )
+		{
+			_Usage.pSizes[MC_INTERNAL] += Component::GetBufferSize( ppRings[RingIndex] );
+			_Usage.pCounts[MC_INTERNAL]++;
+		}
+
+	for ( int CategoryIndex=0; CategoryIndex < MEMORY_CATEGORIES_COUNT; CategoryIndex++ )
+		_Usage.Total += _Usage.pSizes[CategoryIndex];
+}
+
+void	Device::DumpVideoMemoryUsage( int _LargestCount ) const
+{
+	static const char*	ppCategoryNames[MEMORY_CATEGORIES_COUNT] = { "Textures", "Render Targets", "Depth Stencils", "Staging", "Buffers", "Constant Buffers", "Geometry", "Internal" };
+	static const int	MAX_LARGEST = 64;
+
+	VideoMemoryUsage	Usage;
+	GetVideoMemoryUsage( Usage );
+
+	char	pLine[256];
+	U64		Budget = GetVideoMemoryBudget();
+	_snprintf_s( pLine, 256, _TRUNCATE, "Video memory: %.1f MB used out of a %.1f MB budget\n", Usage.Total / (1024.0*1024.0), Budget / (1024.0*1024.0) );
+	OutputDebugStringA( pLine );
+	for ( int CategoryIndex=0; CategoryIndex < MEMORY_CATEGORIES_COUNT; CategoryIndex++ )
+	{
+		_snprintf_s( pLine, 256, _TRUNCATE, "	%-16s %8.2f MB (%d)\n", ppCategoryNames[CategoryIndex], Usage.pSizes[CategoryIndex] / (1024.0*1024.0), Usage.pCounts[CategoryIndex] );
+		OutputDebugStringA( pLine );
+	}
+
+	// Keep the largest components sorted by decreasing size
+	_LargestCount = MIN( _LargestCount, MAX_LARGEST );
+	const Component*	ppLargest[MAX_LARGEST];
+	U64					pLargestSizes[MAX_LARGEST];
+	int					LargestCount = 0;
+
+	EnterCriticalSection( const_cast<CRITICAL_SECTION*>( &m_Lock ) );
+	for ( int SlotIndex=0; SlotIndex < m_ComponentSlots.GetCount(); SlotIndex++ )
+	{
+		const Component*	pComponent = m_ComponentSlots[SlotIndex].pComponent;
+		if ( pComponent == NULL )
+			continue;
+
+		U64	Size = pComponent->GetVideoMemorySize();
+		if ( Size == 0 || _LargestCount <= 0 || (LargestCount == _LargestCount && Size <= pLargestSizes[LargestCount-1]) )
+			continue;
+
+		int	InsertIndex = MIN( LargestCount, _LargestCount-1 );
+		for ( ; InsertIndex > 0 && pLargestSizes[InsertIndex-1] < Size; InsertIndex-- )
+		{
+			ppLargest[InsertIndex] = ppLargest[InsertIndex-1];
+			pLargestSizes[InsertIndex] = pLargestSizes[InsertIndex-1];
+		}
+		ppLargest[InsertIndex] = pComponent;
+		pLargestSizes[InsertIndex] = Size;
+		LargestCount = MIN( LargestCount+1, _LargestCount );
+	}
+
+	for ( int LargestIndex=0; LargestIndex < LargestCount; LargestIndex++ )
+	{
+		const Component&	C = *ppLargest[LargestIndex];
+		_snprintf_s( pLine, 256, _TRUNCATE, "	#%2d %8.2f MB  %-16s %s\n", LargestIndex, pLargestSizes[LargestIndex] / (1024.0*1024.0), ppCategoryNames[C.GetVideoMemoryCategory()], C.m_pMemoryTag != NULL ? C.m_pMemoryTag : "" );
+		OutputDebugStringA( pLine );
+	}
+	LeaveCriticalSection( const_cast<CRITICAL_SECTION*>( &m_Lock ) );
+}
+
+U64		Device::GetVideoMemoryBudget() const
+{
+#ifdef VIDEO_MEMORY_BUDGET
+	DXGI_QUERY_VIDEO_MEMORY_INFO	Info;
+	if ( m_pAdapter3 != NULL && SUCCEEDED( m_pAdapter3->QueryVideoMemoryInfo( 0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &Info ) ) )
+		return Info.Budget;
+#endif
+	return m_DedicatedVideoMemory;
+}
+
+bool	Device::CheckVideoMemoryBudget( float _WarningRatio )
+{
+	U64	Budget = GetVideoMemoryBudget();
+	if ( Budget == 0 )
+		return true;	// Unknown (e.g. WARP or shared memory adapters without DXGI 1.4)
+
+	VideoMemoryUsage	Usage;
+	GetVideoMemoryUsage( Usage );
+
+	bool	bOverBudget = Usage.Total > U64( _WarningRatio * Budget );
+	if ( bOverBudget && !m_bOverBudget )
+	{
+		char	pWarning[256];
+		_snprintf_s( pWarning, 256, _TRUNCATE, "WARNING: Video memory usage of %.1f MB is over %d%% of the %.1f MB budget!\n", Usage.Total / (1024.0*1024.0), int( 100.0f * _WarningRatio ), Budget / (1024.0*1024.0) );
+		OutputDebugStringA( pWarning );
+		DumpVideoMemoryUsage();
+	}
+	m_bOverBudget = bOverBudget;
+
+	return !bOverBudget;
+}
+
+Device::MapSite&	Device::FindMapSite( const char* _pSite )
+{
+	for ( int SiteIndex=0; SiteIndex < m_MapSitesCount; SiteIndex++ )
+		if ( m_pMapSites[SiteIndex].pName == _pSite || !strcmp( m_pMapSites[SiteIndex].pName, _pSite ) )
+			return m_pMapSites[SiteIndex];
+
+	ASSERT( m_MapSitesCount < MAX_MAP_SITES, "Too many map sites! The last one gets all the others' maps." );
+	if ( m_MapSitesCount == MAX_MAP_SITES )
+		return m_pMapSites[MAX_MAP_SITES-1];
+
+	MapSite&	Site = m_pMapSites[m_MapSitesCount++];
+	memset( &Site, 0, sizeof(MapSite) );
+	Site.pName = _pSite;
+	return Site;
 }
 
 void	Device::RemoveRenderTargets()
 {
 	static ID3D11RenderTargetView*	ppEmpty[8] = { NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, };
-	m_pDeviceContext->OMSetRenderTargets( 8, ppEmpty, NULL );
+	FlushBindings();
+	State().pContext->OMSetRenderTargets( 8, ppEmpty, NULL );
+	InvalidateShaderResources();
 }
 
 void	Device::RemoveUAVs() {
 	static ID3D11UnorderedAccessView*	ppEmpty[8] = { NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, };
-	UINT	pInitialCount[8] = { -1 };
-	m_pDeviceContext->OMSetRenderTargetsAndUnorderedAccessViews( D3D11_KEEP_RENDER_TARGETS_AND_DEPTH_STENCIL, NULL, NULL, 0, 8, ppEmpty, pInitialCount );
-	m_pDeviceContext->CSSetUnorderedAccessViews( 0, 8, ppEmpty, pInitialCount );
+	UINT	pInitialCount[8] = { -1, -1, -1, -1, -1, -1, -1, -1 };
+	FlushBindings();
+	State().pContext->OMSetRenderTargetsAndUnorderedAccessViews( D3D11_KEEP_RENDER_TARGETS_AND_DEPTH_STENCIL, NULL, NULL, 0, 8, ppEmpty, pInitialCount );
+	InvalidateShaderResources();
+
+	SetUnorderedAccessViews( 0, 8, ppEmpty );
 }
 
 void	Device::SetStates( RasterizerState* _pRasterizerState, DepthStencilState* _pDepthStencilState, BlendState* _pBlendState )
 {
-	if ( _pRasterizerState != NULL && _pRasterizerState != m_pCurrentRasterizerState )
+	ContextState&	S = State();
+	if ( _pRasterizerState != NULL && _pRasterizerState != S.pCurrentRasterizerState )
 	{
-		m_pDeviceContext->RSSetState( _pRasterizerState->m_pState );
-		m_pCurrentRasterizerState = _pRasterizerState;
+		S.pContext->RSSetState( _pRasterizerState->m_pState );
+		S.pCurrentRasterizerState = _pRasterizerState;
+		S.pCurrentPipelineState = NULL;
+		S.Counters.StateChangesCount++;
 	}
 
-	if ( _pDepthStencilState != NULL && _pDepthStencilState != m_pCurrentDepthStencilState )
+	if ( _pDepthStencilState != NULL && _pDepthStencilState != S.pCurrentDepthStencilState )
 	{
-		m_pDeviceContext->OMSetDepthStencilState( _pDepthStencilState->m_pState, m_StencilRef );
-		m_pCurrentDepthStencilState = _pDepthStencilState;
+		S.pContext->OMSetDepthStencilState( _pDepthStencilState->m_pState, m_StencilRef );
+		S.pCurrentDepthStencilState = _pDepthStencilState;
+		S.pCurrentPipelineState = NULL;
+		S.Counters.StateChangesCount++;
 	}
 
-	if ( _pBlendState != NULL && _pBlendState != m_pCurrentBlendState )
+	if ( _pBlendState != NULL && _pBlendState != S.pCurrentBlendState )
 	{
-		m_pDeviceContext->OMSetBlendState( _pBlendState->m_pState, &m_BlendFactors.x, m_BlendMasks );
-		m_pCurrentBlendState = _pBlendState;
+		S.pContext->OMSetBlendState( _pBlendState->m_pState, &m_BlendFactors.x, m_BlendMasks );
+		S.pCurrentBlendState = _pBlendState;
+		S.pCurrentPipelineState = NULL;
+		S.Counters.StateChangesCount++;
 	}
 }
 
+bool	Device::SetPipelineState( const PipelineState& _PipelineState )
+{
+	ContextState&	S = State();
+	_PipelineState.m_bSealed = true;
+
+	if ( &_PipelineState != S.pCurrentPipelineState )
+	{
+		if ( &_PipelineState.m_Shader != S.pCurrentMaterial && !_PipelineState.m_Shader.Use() )
+			return false;
+
+		SetStates( _PipelineState.m_pRasterizerState, _PipelineState.m_pDepthStencilState, _PipelineState.m_pBlendState );
+		S.pCurrentPipelineState = &_PipelineState;
+	}
+
+	// Other draws may have overwritten these slots since, the binding tables drop them otherwise
+	_PipelineState.BindStatic();
+
+	return true;
+}
+
 void	Device::SetStatesReferences( const float4& _BlendFactors, U32 _BlendSampleMask, U8 _StencilRef )
 {
 	m_BlendFactors = _BlendFactors;
@@ -451,57 +1031,686 @@ void	Device::SetScissorRect( const D3D11_RECT* _pScissor )
 		DefaultRenderTarget().GetWidth(),
 		DefaultRenderTarget().GetHeight()
 	};
-	m_pDeviceContext->RSSetScissorRects( 1, _pScissor != NULL ? _pScissor : &Full );
+	State().pContext->RSSetScissorRects( 1, _pScissor != NULL ? _pScissor : &Full );
 }
 
 void	Device::RemoveShaderResources( int _SlotIndex, int _SlotsCount, U32 _ShaderStages )
 {
-	static bool							ViewsInitialized = false;
-	static ID3D11ShaderResourceView*	ppNULL[128];
-	if ( !ViewsInitialized )
-	{
-		memset( ppNULL, NULL, _SlotsCount*sizeof(ID3D11ShaderResourceView*) );
-		ViewsInitialized = true;
-	}
-
-	if ( (_ShaderStages & SSF_VERTEX_SHADER) != 0 )
-		m_pDeviceContext->VSSetShaderResources( _SlotIndex, _SlotsCount, ppNULL );
-	if ( (_ShaderStages & SSF_HULL_SHADER) != 0 )
-		m_pDeviceContext->HSSetShaderResources( _SlotIndex, _SlotsCount, ppNULL );
-	if ( (_ShaderStages & SSF_DOMAIN_SHADER) != 0 )
-		m_pDeviceContext->DSSetShaderResources( _SlotIndex, _SlotsCount, ppNULL );
-	if ( (_ShaderStages & SSF_GEOMETRY_SHADER) != 0 )
-		m_pDeviceContext->GSSetShaderResources( _SlotIndex, _SlotsCount, ppNULL );
-	if ( (_ShaderStages & SSF_PIXEL_SHADER) != 0 )
-		m_pDeviceContext->PSSetShaderResources( _SlotIndex, _SlotsCount, ppNULL );
-	if ( (_ShaderStages & SSF_COMPUTE_SHADER) != 0 )
-		m_pDeviceContext->CSSetShaderResources( _SlotIndex, _SlotsCount, ppNULL );
+	static ID3D11ShaderResourceView*	ppNULL[SHADOW_SRV_SLOTS] = { NULL };	// Static arrays are zero-initialized anyway
+
+	SetShaderResources( _ShaderStages, _SlotIndex, _SlotsCount, ppNULL );
 	if ( (_ShaderStages & SSF_COMPUTE_SHADER_UAV) != 0 )
+		SetUnorderedAccessViews( _SlotIndex, _SlotsCount, (ID3D11UnorderedAccessView**) ppNULL );
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Input assembler
+//
+void	Device::SetInputLayout( ID3D11InputLayout* _pLayout )
+{
+	ContextState&	S = State();
+	S.BindingRequestsCount++;
+	if ( _pLayout == S.IA.pInputLayout )
+		return;
+
+	S.pContext->IASetInputLayout( _pLayout );
+	S.IA.pInputLayout = _pLayout;
+	S.BindingCallsCount++;
+}
+
+void	Device::SetPrimitiveTopology( D3D11_PRIMITIVE_TOPOLOGY _Topology )
+{
+	ContextState&	S = State();
+	S.BindingRequestsCount++;
+	if ( _Topology == S.IA.Topology )
+		return;
+
+	S.pContext->IASetPrimitiveTopology( _Topology );
+	S.IA.Topology = _Topology;
+	S.BindingCallsCount++;
+}
+
+void	Device::SetVertexBuffers( U32 _StreamsCount, ID3D11Buffer* const* _ppBuffers, const U32* _pStrides, const U32* _pOffsets )
+{
+	ASSERT( _StreamsCount <= SHADOW_VERTEX_STREAMS, "Too many vertex streams!" );
+
+	ContextState&	S = State();
+	S.BindingRequestsCount++;
+	bool	bChanged = _StreamsCount != S.IA.VertexStreamsCount;
+	for ( U32 StreamIndex=0; StreamIndex < _StreamsCount && !bChanged; StreamIndex++ )
+		bChanged = _ppBuffers[StreamIndex] != S.IA.ppVertexBuffers[StreamIndex]
+				|| _pStrides[StreamIndex] != S.IA.pStrides[StreamIndex]
+				|| _pOffsets[StreamIndex] != S.IA.pOffsets[StreamIndex];
+	if ( !bChanged )
+		return;
+
+	S.pContext->IASetVertexBuffers( 0, _StreamsCount, _ppBuffers, _pStrides, _pOffsets );
+	S.IA.VertexStreamsCount = _StreamsCount;
+	memcpy( S.IA.ppVertexBuffers, _ppBuffers, _StreamsCount*sizeof(ID3D11Buffer*) );
+	memcpy( S.IA.pStrides, _pStrides, _StreamsCount*sizeof(U32) );
+	memcpy( S.IA.pOffsets, _pOffsets, _StreamsCount*sizeof(U32) );
+	S.BindingCallsCount++;
+}
+
+void	Device::SetIndexBuffer( ID3D11Buffer* _pBuffer, DXGI_FORMAT _Format )
+{
+	ContextState&	S = State();
+	S.BindingRequestsCount++;
+	if ( _pBuffer == S.IA.pIndexBuffer && _Format == S.IA.IndexFormat )
+		return;
+
+	S.pContext->IASetIndexBuffer( _pBuffer, _Format, 0 );
+	S.IA.pIndexBuffer = _pBuffer;
+	S.IA.IndexFormat = _Format;
+	S.BindingCallsCount++;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Binding shadow tables
+//
+void	Device::SetShaderResources( U32 _ShaderStages, int _SlotIndex, int _SlotsCount, ID3D11ShaderResourceView* const* _ppViews )
+{
+	ContextState&	S = State();
+	for ( int StageIndex=0; StageIndex < SHADER_STAGES_COUNT; StageIndex++ )
+	{
+		if ( (_ShaderStages & (1 << StageIndex)) == 0 )
+			continue;
+
+		SRVTable&	Table = S.pStageBindings[StageIndex].SRVs;
+		for ( int SlotIndex=0; SlotIndex < _SlotsCount; SlotIndex++ )
+			if ( Table.Set( _SlotIndex + SlotIndex, _ppViews[SlotIndex] ) )
+				S.DirtyStagesMask |= 1 << StageIndex;
+
+		S.BindingRequestsCount += _SlotsCount;
+	}
+}
+
+void	Device::SetConstantBuffers( U32 _ShaderStages, int _SlotIndex, int _SlotsCount, ID3D11Buffer* const* _ppBuffers )
+{
+	ContextState&	S = State();
+	for ( int StageIndex=0; StageIndex < SHADER_STAGES_COUNT; StageIndex++ )
+	{
+		if ( (_ShaderStages & (1 << StageIndex)) == 0 )
+			continue;
+
+		StageBindings&	B = S.pStageBindings[StageIndex];
+		for ( int SlotIndex=0; SlotIndex < _SlotsCount; SlotIndex++ )
+		{
+			int		CBSlotIndex = _SlotIndex + SlotIndex;
+			bool	bChanged = B.CBs.Set( CBSlotIndex, _ppBuffers[SlotIndex] );
+			if ( B.IsCBRange( CBSlotIndex ) )
+			{	// Back to the whole buffer
+				B.pCBFirstConstants[CBSlotIndex] = 0;
+				B.pCBNumConstants[CBSlotIndex] = D3D11_REQ_CONSTANT_BUFFER_ELEMENT_COUNT;
+				B.CBs.Force( CBSlotIndex );
+				bChanged = true;
+			}
+			if ( bChanged )
+				S.DirtyStagesMask |= 1 << StageIndex;
+		}
+
+		S.BindingRequestsCount += _SlotsCount;
+	}
+}
+
+void	Device::SetConstantBufferRange( U32 _ShaderStages, int _SlotIndex, ID3D11Buffer* _pBuffer, U32 _FirstConstant, U32 _NumConstants )
+{
+	ASSERT( SupportsConstantOffsets() && IsImmediate(), "Constant ranges are only supported on the immediate D3D11.1 context!" );
+	ASSERT( (_FirstConstant & 15) == 0 && (_NumConstants & 15) == 0, "Constant ranges must be multiples of 16 constants!" );
+
+	ContextState&	S = State();
+	for ( int StageIndex=0; StageIndex < SHADER_STAGES_COUNT; StageIndex++ )
+	{
+		if ( (_ShaderStages & (1 << StageIndex)) == 0 )
+			continue;
+
+		StageBindings&	B = S.pStageBindings[StageIndex];
+		bool			bChanged = B.CBs.Set( _SlotIndex, _pBuffer );
+		if ( B.pCBFirstConstants[_SlotIndex] != _FirstConstant || B.pCBNumConstants[_SlotIndex] != _NumConstants )
+		{	// Same buffer but another range still needs a call
+			B.pCBFirstConstants[_SlotIndex] = _FirstConstant;
+			B.pCBNumConstants[_SlotIndex] = _NumConstants;
+			B.CBs.Force( _SlotIndex );
+			bChanged = true;
+		}
+		if ( bChanged )
+			S.DirtyStagesMask |= 1 << StageIndex;
+
+		S.BindingRequestsCount++;
+	}
+}
+
+void	Device::SetSamplers( U32 _ShaderStages, int _SlotIndex, int _SlotsCount, ID3D11SamplerState* const* _ppSamplers )
+{
+	ContextState&	S = State();
+	for ( int StageIndex=0; StageIndex < SHADER_STAGES_COUNT; StageIndex++ )
+	{
+		if ( (_ShaderStages & (1 << StageIndex)) == 0 )
+			continue;
+
+		SamplerTable&	Table = S.pStageBindings[StageIndex].Samplers;
+		for ( int SlotIndex=0; SlotIndex < _SlotsCount; SlotIndex++ )
+			if ( Table.Set( _SlotIndex + SlotIndex, _ppSamplers[SlotIndex] ) )
+				S.DirtyStagesMask |= 1 << StageIndex;
+
+		S.BindingRequestsCount += _SlotsCount;
+	}
+}
+
+void	Device::SetSamplerState( U32 _ShaderStages, int _SlotIndex, const SamplerState& _Sampler )
+{
+	ID3D11SamplerState*	pState = _Sampler.m_pState;
+	SetSamplers( _ShaderStages, _SlotIndex, 1, &pState );
+}
+
+SamplerState&	Device::GetSamplerState( const D3D11_SAMPLER_DESC& _Desc )
+{
+	U32	Hash = SamplerState::ComputeHash( _Desc );
+	for ( int SamplerIndex=0; SamplerIndex < m_SamplerStatesCount; SamplerIndex++ )
 	{
-		U32	UAVInitCount = -1;
-		m_pDeviceContext->CSSetUnorderedAccessViews( _SlotIndex, _SlotsCount, (ID3D11UnorderedAccessView**) ppNULL, &UAVInitCount );
+		SamplerState&	Sampler = *m_ppSamplerStates[SamplerIndex];
+		if ( Sampler.m_Hash == Hash && !memcmp( &Sampler.m_Description, &_Desc, sizeof(D3D11_SAMPLER_DESC) ) )
+			return Sampler;
+	}
+
+	ASSERT( m_SamplerStatesCount < MAX_SAMPLER_STATES, "Too many distinct samplers!" );
+	SamplerState*	pSampler = new SamplerState( *this, _Desc ); m_StatesCount++;
+	m_ppSamplerStates[m_SamplerStatesCount++] = pSampler;
+
+	return *pSampler;
+}
+
+SamplerState&	Device::RegisterSamplerState( const char* _pName, const D3D11_SAMPLER_DESC& _Desc )
+{
+	SamplerState&	Sampler = GetSamplerState( _Desc );
+	for ( int NamedIndex=0; NamedIndex < m_NamedSamplersCount; NamedIndex++ )
+		if ( !strcmp( m_pNamedSamplers[NamedIndex].pName, _pName ) )
+		{	// Registered again: the name now designates the new sampler
+			m_pNamedSamplers[NamedIndex].pSampler = &Sampler;
+			return Sampler;
+		}
+
+	ASSERT( m_NamedSamplersCount < MAX_NAMED_SAMPLERS, "Too many named samplers!" );
+	NamedSampler&	Entry = m_pNamedSamplers[m_NamedSamplersCount++];
+	Entry.pName = _pName;
+	Entry.pSampler = &Sampler;
+
+	return Sampler;
+}
+
+SamplerState*	Device::FindSamplerState( const char* _pName ) const
+{
+	for ( int NamedIndex=0; NamedIndex < m_NamedSamplersCount; NamedIndex++ )
+		if ( !strcmp( m_pNamedSamplers[NamedIndex].pName, _pName ) )
+			return m_pNamedSamplers[NamedIndex].pSampler;
+
+	return NULL;
+}
+
+void	Device::SetUnorderedAccessViews( int _SlotIndex, int _SlotsCount, ID3D11UnorderedAccessView* const* _ppViews, const UINT* _pInitialCounts )
+{
+	ContextState&	S = State();
+	for ( int SlotIndex=0; SlotIndex < _SlotsCount; SlotIndex++ )
+	{
+		int		UAVSlotIndex = _SlotIndex + SlotIndex;
+		UINT	InitialCount = _pInitialCounts != NULL ? _pInitialCounts[SlotIndex] : -1;
+
+		bool	bChanged = S.CSUAVs.Set( UAVSlotIndex, _ppViews[SlotIndex] );
+		if ( InitialCount != -1 )
+		{	// Resetting the counter requires a call anyway
+			S.CSUAVs.Force( UAVSlotIndex );
+			bChanged = true;
+		}
+		S.pCSUAVInitialCounts[UAVSlotIndex] = InitialCount;
+
+		if ( bChanged )
+			S.DirtyStagesMask |= SSF_COMPUTE_SHADER_UAV;
+	}
+
+	S.BindingRequestsCount += _SlotsCount;
+}
+
+namespace
+{
+	void	BindSRVs( ID3D11DeviceContext& _Context, int _StageIndex, int _SlotIndex, int _SlotsCount, ID3D11ShaderResourceView* const* _ppViews )
+	{
+		switch ( _StageIndex )
+		{
+		case 0: _Context.VSSetShaderResources( _SlotIndex, _SlotsCount, _ppViews ); break;
+		case 1: _Context.HSSetShaderResources( _SlotIndex, _SlotsCount, _ppViews ); break;
+		case 2: _Context.DSSetShaderResources( _SlotIndex, _SlotsCount, _ppViews ); break;
+		case 3: _Context.GSSetShaderResources( _SlotIndex, _SlotsCount, _ppViews ); break;
+		case 4: _Context.PSSetShaderResources( _SlotIndex, _SlotsCount, _ppViews ); break;
+		case 5: _Context.CSSetShaderResources( _SlotIndex, _SlotsCount, _ppViews ); break;
+		}
+	}
+	void	BindCBs( ID3D11DeviceContext& _Context, int _StageIndex, int _SlotIndex, int _SlotsCount, ID3D11Buffer* const* _ppBuffers )
+	{
+		switch ( _StageIndex )
+		{
+		case 0: _Context.VSSetConstantBuffers( _SlotIndex, _SlotsCount, _ppBuffers ); break;
+		case 1: _Context.HSSetConstantBuffers( _SlotIndex, _SlotsCount, _ppBuffers ); break;
+		case 2: _Context.DSSetConstantBuffers( _SlotIndex, _SlotsCount, _ppBuffers ); break;
+		case 3: _Context.GSSetConstantBuffers( _SlotIndex, _SlotsCount, _ppBuffers ); break;
+		case 4: _Context.PSSetConstantBuffers( _SlotIndex, _SlotsCount, _ppBuffers ); break;
+		case 5: _Context.CSSetConstantBuffers( _SlotIndex, _SlotsCount, _ppBuffers ); break;
+		}
+	}
+	void	BindCBRanges( ID3D11DeviceContext1& _Context, int _StageIndex, int _SlotIndex, int _SlotsCount, ID3D11Buffer* const* _ppBuffers, const UINT* _pFirstConstants, const UINT* _pNumConstants )
+	{
+		switch ( _StageIndex )
+		{
+		case 0: _Context.VSSetConstantBuffers1( _SlotIndex, _SlotsCount, _ppBuffers, _pFirstConstants, _pNumConstants ); break;
+		case 1: _Context.HSSetConstantBuffers1( _SlotIndex, _SlotsCount, _ppBuffers, _pFirstConstants, _pNumConstants ); break;
+		case 2: _Context.DSSetConstantBuffers1( _SlotIndex, _SlotsCount, _ppBuffers, _pFirstConstants, _pNumConstants ); break;
+		case 3: _Context.GSSetConstantBuffers1( _SlotIndex, _SlotsCount, _ppBuffers, _pFirstConstants, _pNumConstants ); break;
+		case 4: _Context.PSSetConstantBuffers1( _SlotIndex, _SlotsCount, _ppBuffers, _pFirstConstants, _pNumConstants ); break;
+		case 5: _Context.CSSetConstantBuffers1( _SlotIndex, _SlotsCount, _ppBuffers, _pFirstConstants, _pNumConstants ); break;
+		}
+	}
+	void	BindSamplers( ID3D11DeviceContext& _Context, int _StageIndex, int _SlotIndex, int _SlotsCount, ID3D11SamplerState* const* _ppSamplers )
+	{
+		switch ( _StageIndex )
+		{
+		case 0: _Context.VSSetSamplers( _SlotIndex, _SlotsCount, _ppSamplers ); break;
+		case 1: _Context.HSSetSamplers( _SlotIndex, _SlotsCount, _ppSamplers ); break;
+		case 2: _Context.DSSetSamplers( _SlotIndex, _SlotsCount, _ppSamplers ); break;
+		case 3: _Context.GSSetSamplers( _SlotIndex, _SlotsCount, _ppSamplers ); break;
+		case 4: _Context.PSSetSamplers( _SlotIndex, _SlotsCount, _ppSamplers ); break;
+		case 5: _Context.CSSetSamplers( _SlotIndex, _SlotsCount, _ppSamplers ); break;
+		}
+	}
+}
+
+void	Device::FlushBindings()
+{
+	ContextState&	S = State();
+	if ( S.DirtyStagesMask == 0 )
+		return;	// Nothing to do
+
+	// Send UAVs first so buffers that were previously bound as outputs are unbound before we attempt to bind them as inputs
+	bool	bUAVsChanged = false;
+	if ( (S.DirtyStagesMask & SSF_COMPUTE_SHADER_UAV) != 0 )
+	{
+		int	StartSlot = S.CSUAVs.DirtyMin, SlotsCount;
+		while ( (SlotsCount = S.CSUAVs.NextRun( StartSlot )) > 0 )
+		{
+			S.pContext->CSSetUnorderedAccessViews( StartSlot, SlotsCount, &S.CSUAVs.ppPending[StartSlot], &S.pCSUAVInitialCounts[StartSlot] );
+			for ( int SlotIndex=0; SlotIndex < SlotsCount; SlotIndex++ )
+				S.pCSUAVInitialCounts[StartSlot+SlotIndex] = -1;
+
+			StartSlot += SlotsCount;
+			S.BindingCallsCount++;
+			bUAVsChanged = true;
+		}
+		S.CSUAVs.Clean();
+	}
+
+	for ( int StageIndex=0; StageIndex < SHADER_STAGES_COUNT; StageIndex++ )
+	{
+		if ( (S.DirtyStagesMask & (1 << StageIndex)) == 0 )
+			continue;
+
+		StageBindings&	B = S.pStageBindings[StageIndex];
+		int				StartSlot, SlotsCount;
+		if ( B.SRVs.IsDirty() )
+		{
+			StartSlot = B.SRVs.DirtyMin;
+			while ( (SlotsCount = B.SRVs.NextRun( StartSlot )) > 0 )
+			{
+				BindSRVs( *S.pContext, StageIndex, StartSlot, SlotsCount, &B.SRVs.ppPending[StartSlot] );
+				StartSlot += SlotsCount;
+				S.BindingCallsCount++;
+			}
+			B.SRVs.Clean();
+		}
+		if ( B.CBs.IsDirty() )
+		{
+			StartSlot = B.CBs.DirtyMin;
+			while ( (SlotsCount = B.CBs.NextRun( StartSlot )) > 0 )
+			{
+				bool	bRanges = false;
+				for ( int SlotIndex=StartSlot; SlotIndex < StartSlot+SlotsCount; SlotIndex++ )
+					bRanges |= B.IsCBRange( SlotIndex );
+
+				if ( bRanges )
+					BindCBRanges( *m_pDeviceContext1, StageIndex, StartSlot, SlotsCount, &B.CBs.ppPending[StartSlot], &B.pCBFirstConstants[StartSlot], &B.pCBNumConstants[StartSlot] );
+				else
+					BindCBs( *S.pContext, StageIndex, StartSlot, SlotsCount, &B.CBs.ppPending[StartSlot] );
+				StartSlot += SlotsCount;
+				S.BindingCallsCount++;
+			}
+			B.CBs.Clean();
+		}
+		if ( B.Samplers.IsDirty() )
+		{
+			StartSlot = B.Samplers.DirtyMin;
+			while ( (SlotsCount = B.Samplers.NextRun( StartSlot )) > 0 )
+			{
+				BindSamplers( *S.pContext, StageIndex, StartSlot, SlotsCount, &B.Samplers.ppPending[StartSlot] );
+				StartSlot += SlotsCount;
+				S.BindingCallsCount++;
+			}
+			B.Samplers.Clean();
+		}
+	}
+
+	S.DirtyStagesMask = 0;
+
+	// Binding UAVs may have silently unbound some inputs, we can't trust our SRV tables anymore
+	if ( bUAVsChanged )
+		InvalidateShaderResources();
+}
+
+void	Device::InvalidateShaderResources()
+{
+	ContextState&	S = State();
+	for ( int StageIndex=0; StageIndex < SHADER_STAGES_COUNT; StageIndex++ )
+		S.pStageBindings[StageIndex].SRVs.Invalidate();
+}
+
+void	Device::InvalidateBindings()
+{
+	ContextState&	S = State();
+	if ( S.pContext != NULL )
+		FlushBindings();
+
+	for ( int StageIndex=0; StageIndex < SHADER_STAGES_COUNT; StageIndex++ )
+	{
+		StageBindings&	B = S.pStageBindings[StageIndex];
+		B.SRVs.Invalidate();
+		B.CBs.Invalidate();
+		B.Samplers.Invalidate();
+	}
+	S.CSUAVs.Invalidate();
+	for ( int SlotIndex=0; SlotIndex < SHADOW_UAV_SLOTS; SlotIndex++ )
+		S.pCSUAVInitialCounts[SlotIndex] = -1;
+	S.IA.Invalidate();
+
+	S.DirtyStagesMask = 0;
+}
+
+void	Device::InheritImmediateState( ContextState& _State )
+{
+	ASSERT( IsImmediate(), "Bindings must be inherited from the thread that owns the immediate context!" );
+
+	// Deferred contexts start from the default pipeline state: nothing is known to be bound yet but we want
+	//	whatever is pending/bound on the immediate context (i.e. samplers, global constant buffers and textures) to be available
+	//	to the recorded commands as well, so we copy the immediate's bindings as pending requests
+	for ( int StageIndex=0; StageIndex < SHADER_STAGES_COUNT; StageIndex++ )
+	{
+		StageBindings&			Dst = _State.pStageBindings[StageIndex];
+		const StageBindings&	Src = m_ImmediateState.pStageBindings[StageIndex];
+		Dst.SRVs.Invalidate();
+		Dst.CBs.Invalidate();
+		Dst.Samplers.Invalidate();
+		for ( int SlotIndex=0; SlotIndex < SHADOW_SRV_SLOTS; SlotIndex++ )
+			Dst.SRVs.Set( SlotIndex, Src.SRVs.ppPending[SlotIndex] );
+		for ( int SlotIndex=0; SlotIndex < SHADOW_CB_SLOTS; SlotIndex++ )
+			if ( !Src.IsCBRange( SlotIndex ) )
+				Dst.CBs.Set( SlotIndex, Src.CBs.ppPending[SlotIndex] );	// Transient ranges only live on the immediate context
+		for ( int SlotIndex=0; SlotIndex < SHADOW_SAMPLER_SLOTS; SlotIndex++ )
+			Dst.Samplers.Set( SlotIndex, Src.Samplers.ppPending[SlotIndex] );
+	}
+	_State.CSUAVs.Invalidate();	// Don't inherit outputs!
+	for ( int SlotIndex=0; SlotIndex < SHADOW_UAV_SLOTS; SlotIndex++ )
+		_State.pCSUAVInitialCounts[SlotIndex] = -1;
+	_State.DirtyStagesMask = SSF_ALL;
+
+	_State.pCurrentMaterial = NULL;
+	_State.pCurrentRasterizerState = NULL;
+	_State.pCurrentDepthStencilState = NULL;
+	_State.pCurrentBlendState = NULL;
+	_State.pCurrentPipelineState = NULL;
+	_State.IA.Invalidate();
+}
+
+void	Device::BeginDeferredState( ContextState& _State )
+{
+	ASSERT( IsImmediate(), "This thread is already recording a command list!" );
+	ASSERT( _State.pContext != NULL, "Invalid deferred context!" );
+	TlsSetValue( m_ContextStateTLS, &_State );
+}
+
+void	Device::EndDeferredState()
+{
+	ASSERT( !IsImmediate(), "This thread is not recording a command list!" );
+	FlushBindings();
+	TlsSetValue( m_ContextStateTLS, NULL );
+}
+
+void	Device::Present( bool _bVSync )
+{
+	ASSERT( IsImmediate(), "Present() must be called by the thread owning the immediate context!" );
+
+	FlushRenderThreadJobs();
+
+	m_pDeviceContext->End( m_ppFrameEvents[m_FrameIndex % MAX_FRAMES_IN_FLIGHT] );
+	m_pSwapChain->Present( _bVSync ? 1 : 0, 0 );
+
+	// Capture the frame's statistics
+	LARGE_INTEGER	Ticks;
+	QueryPerformanceCounter( &Ticks );
+
+	FrameStats&	Stats = m_LastFrameStats;
+	Stats.FrameIndex = m_FrameIndex;
+	Stats.CPUDuration = float( (Ticks.QuadPart - m_LastPresentTicks.QuadPart) * m_TicksToMilliseconds );
+#ifdef GPU_PROFILING
+	Stats.GPUDuration = m_pProfiler->GetLastFrameDuration();
+#else
+	Stats.GPUDuration = 0.0f;
+#endif
+	Stats.Counters = m_ImmediateState.Counters;
+	Stats.BindingRequestsCount = m_ImmediateState.BindingRequestsCount - m_LastBindingRequestsCount;	// Binding stats are reset by the user, not by us
+	Stats.BindingCallsCount = m_ImmediateState.BindingCallsCount - m_LastBindingCallsCount;
+
+	m_LastPresentTicks = Ticks;
+	m_LastBindingRequestsCount = m_ImmediateState.BindingRequestsCount;
+	m_LastBindingCallsCount = m_ImmediateState.BindingCallsCount;
+	m_ImmediateState.Counters.Reset();
+
+	// Materials may be recompiled between frames (cf. Shader::WatchShadersModifications()) so the next pipeline state uses its material again
+	m_ImmediateState.pCurrentMaterial = NULL;
+	m_ImmediateState.pCurrentPipelineState = NULL;
+
+	m_FrameIndex++;
+
+	if ( m_FrameIndex < U32(m_MaxFramesInFlight) )
+		return;	// Not enough frames queued yet
+
+	// Wait until the GPU is done with the frame that is too old (the event was already flushed by Present())
+	U32				CompletedFrameIndex = m_FrameIndex - m_MaxFramesInFlight;
+	ID3D11Query*	pEvent = m_ppFrameEvents[CompletedFrameIndex % MAX_FRAMES_IN_FLIGHT];
+	while ( m_pDeviceContext->GetData( pEvent, NULL, 0, D3D11_ASYNC_GETDATA_DONOTFLUSH ) == S_FALSE )
+		SwitchToThread();
+	m_CompletedFramesCount = MAX( m_CompletedFramesCount, CompletedFrameIndex+1 );
+
+	FlushDeferredReleases( CompletedFrameIndex );
+}
+
+bool	Device::IsFrameCompleted( U32 _FrameIndex )
+{
+	ASSERT( IsImmediate(), "Frames can only be checked by the thread owning the immediate context!" );
+	ASSERT( _FrameIndex < m_FrameIndex, "That frame wasn't presented yet!" );
+	if ( _FrameIndex < m_CompletedFramesCount )
+		return true;
+
+	// Any frame this recent still has its event in the ring (older ones were waited for by Present())
+	ASSERT( m_FrameIndex - _FrameIndex <= U32(MAX_FRAMES_IN_FLIGHT), "Frame event was reused!" );
+	if ( m_pDeviceContext->GetData( m_ppFrameEvents[_FrameIndex % MAX_FRAMES_IN_FLIGHT], NULL, 0, D3D11_ASYNC_GETDATA_DONOTFLUSH ) != S_OK )
+		return false;
+
+	m_CompletedFramesCount = _FrameIndex+1;	// The GPU executes the frames in order
+	return true;
+}
+
+void	Device::WaitForFrame( U32 _FrameIndex, const char* _pSite )
+{
+	if ( IsFrameCompleted( _FrameIndex ) )
+		return;
+
+	LARGE_INTEGER	Start, End;
+	QueryPerformanceCounter( &Start );
+
+	while ( !IsFrameCompleted( _FrameIndex ) )
+		SwitchToThread();	// The event was already flushed by Present()
+
+	QueryPerformanceCounter( &End );
+	float	Wait = float( (End.QuadPart - Start.QuadPart) * m_TicksToMilliseconds );
+
+	FrameCounters&	Counters = m_ImmediateState.Counters;
+	Counters.FenceWaitsCount++;
+	Counters.FenceWaitDuration += Wait;
+
+	MapSite&	Site = FindMapSite( _pSite );
+	Site.MapsCount++;
+	Site.TotalWait += Wait;
+	if ( Wait > MAP_STALL_THRESHOLD )
+		Site.StallsCount++;
+	Site.MaxWait = MAX( Site.MaxWait, Wait );
+}
+
+void	Device::DeferRelease( IUnknown* _pObject )
+{
+	if ( _pObject == NULL )
+		return;
+	if ( m_pDeviceContext == NULL )
+	{
+		_pObject->Release();
+		return;
+	}
+
+	EnterCriticalSection( &m_Lock );
+	DeferredRelease&	Entry = m_DeferredReleases.Append();
+	Entry.pObject = _pObject;
+	Entry.FrameIndex = m_FrameIndex;
+	LeaveCriticalSection( &m_Lock );
+}
+
+void	Device::FlushDeferredReleases( U32 _LastCompletedFrame )
+{
+	EnterCriticalSection( &m_Lock );
+
+	U32	EntriesCount = U32(m_DeferredReleases.GetCount());
+	while ( m_FirstDeferredRelease < EntriesCount && m_DeferredReleases[m_FirstDeferredRelease].FrameIndex <= _LastCompletedFrame )
+	{
+		m_DeferredReleases[m_FirstDeferredRelease].pObject->Release();
+		m_FirstDeferredRelease++;
+	}
+
+	// Move the remaining entries back to the start once most of the list is released so it doesn't grow forever
+	if ( m_FirstDeferredRelease == EntriesCount )
+	{
+		m_DeferredReleases.Clear();
+		m_FirstDeferredRelease = 0;
+	}
+	else if ( m_FirstDeferredRelease > EntriesCount / 2 )
+	{
+		U32	RemainingCount = EntriesCount - m_FirstDeferredRelease;
+		memmove( &m_DeferredReleases[0], &m_DeferredReleases[m_FirstDeferredRelease], RemainingCount * sizeof(DeferredRelease) );
+		m_DeferredReleases.SetCount( RemainingCount );
+		m_FirstDeferredRelease = 0;
+	}
+
+	LeaveCriticalSection( &m_Lock );
+}
+
+void	Device::ExecuteOnRenderThread( IJob& _Job )
+{
+	if ( IsRenderThread() )
+	{
+		_Job.Run();
+		return;
+	}
+
+	EnterCriticalSection( &m_Lock );
+	m_RenderThreadJobs.Append( &_Job );
+	LeaveCriticalSection( &m_Lock );
+}
+
+void	Device::FlushRenderThreadJobs()
+{
+	// Jobs may post new jobs or destroy components so run them outside of the lock, on a copy of the list
+	EnterCriticalSection( &m_Lock );
+	int	JobsCount = m_RenderThreadJobs.GetCount();
+	if ( JobsCount == 0 )
+	{
+		LeaveCriticalSection( &m_Lock );
+		return;
+	}
+	List<IJob*>	Jobs( JobsCount );
+	Jobs.AppendRange( m_RenderThreadJobs );
+	m_RenderThreadJobs.Clear();
+	LeaveCriticalSection( &m_Lock );
+
+	for ( int JobIndex=0; JobIndex < JobsCount; JobIndex++ )
+		Jobs[JobIndex]->Run();
+}
+
+void	Device::SetMaxFramesInFlight( int _FramesCount )
+{
+	ASSERT( _FramesCount >= 1 && _FramesCount <= MAX_FRAMES_IN_FLIGHT, "Invalid amount of frames in flight!" );
+	m_MaxFramesInFlight = CLAMP( _FramesCount, 1, MAX_FRAMES_IN_FLIGHT );
+
+	// Also tell DXGI not to queue more frames than that, otherwise Present() blocks on its own queue with a larger latency
+	IDXGIDevice1*	pDXGIDevice = NULL;
+	if ( SUCCEEDED( m_pDevice->QueryInterface( __uuidof(IDXGIDevice1), (void**) &pDXGIDevice ) ) )
+	{
+		pDXGIDevice->SetMaximumFrameLatency( m_MaxFramesInFlight );
+		pDXGIDevice->Release();
 	}
 }
 
 void	Device::RegisterComponent( Component& _Component )
 {
-	// Attach to the end of the list
-	if ( m_pComponentsStackTop != NULL )
-		m_pComponentsStackTop->m_pNext = &_Component;
-	_Component.m_pPrevious = m_pComponentsStackTop;
+	EnterCriticalSection( &m_Lock );
 
-	m_pComponentsStackTop = &_Component;
+	// Reuse a free slot or append a new one
+	U32	SlotIndex = m_FirstFreeComponentSlot;
+	if ( SlotIndex != ~0U )
+		m_FirstFreeComponentSlot = m_ComponentSlots[SlotIndex].NextFreeSlot;
+	else
+	{
+		SlotIndex = m_ComponentSlots.GetCount();
+		ASSERT( SlotIndex <= COMPONENT_INDEX_MASK, "Too many components!" );
+		ComponentSlot&	NewSlot = m_ComponentSlots.Append();
+		NewSlot.Generation = 1;
+	}
+
+	ComponentSlot&	Slot = m_ComponentSlots[SlotIndex];
+	Slot.pComponent = &_Component;
+	Slot.NextFreeSlot = ~0U;
+	_Component.m_Handle = (Slot.Generation << COMPONENT_INDEX_BITS) | SlotIndex;
+	m_ComponentsCount++;
+
+	LeaveCriticalSection( &m_Lock );
 }
 
 void	Device::UnRegisterComponent( Component& _Component )
 {
-	// Link over
-	if ( _Component.m_pPrevious != NULL )
-		_Component.m_pPrevious->m_pNext = _Component.m_pNext;
-	if ( _Component.m_pNext != NULL )
-		_Component.m_pNext->m_pPrevious = _Component.m_pPrevious;
-	else
-		m_pComponentsStackTop = _Component.m_pPrevious;	// We were the top of the stack !
+	U32	SlotIndex = _Component.m_Handle & COMPONENT_INDEX_MASK;
+
+	if ( State().pAutoMipsTarget != NULL && static_cast<const Component*>( State().pAutoMipsTarget ) == &_Component )
+		State().pAutoMipsTarget = NULL;		// Destroyed while bound, there's no point generating its mips
+
+	EnterCriticalSection( &m_Lock );
+	if ( SlotIndex >= U32(m_ComponentSlots.GetCount()) )
+	{
+		LeaveCriticalSection( &m_Lock );
+		return;	// The table was already cleared (cf. Exit())
+	}
+
+	ComponentSlot&	Slot = m_ComponentSlots[SlotIndex];
+	ASSERT( Slot.pComponent == &_Component, "Component handle mismatch!" );
+	Slot.pComponent = NULL;
+	Slot.Generation = (Slot.Generation + 1) & (~0U >> COMPONENT_INDEX_BITS);
+	if ( Slot.Generation == 0 )
+		Slot.Generation = 1;	// Handle 0 must stay invalid
+	Slot.NextFreeSlot = m_FirstFreeComponentSlot;
+	m_FirstFreeComponentSlot = SlotIndex;
+	m_ComponentsCount--;
+
+	LeaveCriticalSection( &m_Lock );
 }
 
 bool	Device::Check( HRESULT _Result )
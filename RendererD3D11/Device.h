@@ -8,6 +8,8 @@
 //#define DIRECTX10		// Define this to use DX10, otherwise DX11 will be used
 #define TRY_DIRECTX10_1	// Define this to attempt using DX10.1
 
+#define GPU_PROFILING	// Define this to enable the GPU profiler (timestamp queries, a few per scope. Comment to strip all profiling scopes)
+
 class Component;
 class Shader;
 class Texture2D;
@@ -15,10 +17,35 @@ class Texture3D;
 class RasterizerState;
 class DepthStencilState;
 class BlendState;
+class SamplerState;
+class PipelineState;
+class GPUProfiler;
+class JobQueue;
+class RenderTargetPool;
+class DynamicGeometry;
+class CommandList;
+class IJob;
 
 class Device
 {
-	static const int	SAMPLERS_COUNT = 8;
+	static const int	SAMPLERS_COUNT = 8;			// Global samplers bound once and for all in slots [0,SAMPLERS_COUNT[ of all the stages
+	static const int	MAX_SAMPLER_STATES = 64;	// Distinct sampler descriptions in the cache (cf. GetSamplerState())
+	static const int	MAX_NAMED_SAMPLERS = 32;
+
+	static const int	SHADER_STAGES_COUNT = 6;	// VS, HS, DS, GS, PS, CS (in the same order as the SHADER_STAGE_FLAGS)
+	static const int	SHADOW_SRV_SLOTS = D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT;
+	static const int	SHADOW_CB_SLOTS = D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT;
+	static const int	SHADOW_SAMPLER_SLOTS = D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT;
+	static const int	SHADOW_UAV_SLOTS = D3D11_PS_CS_UAV_REGISTER_COUNT;
+	static const int	SHADOW_VERTEX_STREAMS = 8;	// Same as Primitive::MAX_BOUND_VERTEX_STREAMS
+	static const U32	UPLOAD_RING_SIZE = 4 << 20;	// Size of the dynamic buffer used to upload data to default buffers (cf. UploadBuffer())
+	static const U32	CONSTANT_RING_SIZE = 1 << 20;	// Size of the dynamic constant buffer transient constants are suballocated from (cf. AllocateConstants())
+	static const U32	CONSTANT_RING_ALIGNMENT = 256;	// D3D11.1 offsets must be multiples of 16 constants
+	static const int	MAX_MAP_SITES = 64;				// Call sites the map waits are attributed to (cf. Map())
+	static const float	MAP_STALL_THRESHOLD;			// A map waiting longer than this (ms) is reported as a stall
+	static const int	MAX_FRAMES_IN_FLIGHT = 4;	// Size of the ring of end of frame events (cf. SetMaxFramesInFlight())
+	static const U32	COMPONENT_INDEX_BITS = 20;	// Component handles store the slot index in their lower bits and the slot's generation in the upper bits
+	static const U32	COMPONENT_INDEX_MASK = (1 << COMPONENT_INDEX_BITS) - 1;
 
 public:		// NESTED TYPES
 
@@ -35,26 +62,318 @@ public:		// NESTED TYPES
 		SSF_ALL					= (1 << 6)-1	// WARNING: SSF_ALL doesn't include UAVs!
 	};
 
+	// What the video memory of a component is used for (cf. Component::GetVideoMemoryCategory())
+	enum	MEMORY_CATEGORY
+	{
+		MC_TEXTURE,
+		MC_RENDER_TARGET,			// Including UAV textures
+		MC_DEPTH_STENCIL,
+		MC_STAGING,					// Textures & buffers the CPU reads back
+		MC_BUFFER,					// Structured buffers
+		MC_CONSTANT_BUFFER,
+		MC_GEOMETRY,				// Vertex & index buffers
+		MC_INTERNAL,				// The device's own rings (not components)
+
+		MEMORY_CATEGORIES_COUNT
+	};
+
+	// The estimated video memory used by the components, per category (cf. GetVideoMemoryUsage())
+	struct	VideoMemoryUsage
+	{
+		U64		pSizes[MEMORY_CATEGORIES_COUNT];		// Bytes
+		int		pCounts[MEMORY_CATEGORIES_COUNT];		// Amount of resources
+		U64		Total;
+	};
+
+	// Shadow copy of the slots of a single shader stage
+	// We keep track of what was requested (pending) and what the context really has (bound) so redundant calls
+	//	can be dropped and contiguous slots can be sent in a single call when the bindings are flushed.
+	template<typename T, int SLOTS_COUNT> struct	BindingTable
+	{
+		T*		ppPending[SLOTS_COUNT];		// What we want bound at next draw/dispatch
+		T*		ppBound[SLOTS_COUNT];		// What we know to be bound in the context
+		int		DirtyMin;					// Dirty range of slots (empty if DirtyMin > DirtyMax)
+		int		DirtyMax;
+
+		static T*	Unknown()	{ return (T*) -1; }	// Special value indicating we don't know what's bound
+
+		bool	IsDirty() const	{ return DirtyMin <= DirtyMax; }
+		bool	NeedsBinding( int _SlotIndex ) const	{ return ppPending[_SlotIndex] != ppBound[_SlotIndex] && ppPending[_SlotIndex] != Unknown(); }
+
+		void	Invalidate()
+		{
+			for ( int SlotIndex=0; SlotIndex < SLOTS_COUNT; SlotIndex++ )
+				ppPending[SlotIndex] = ppBound[SlotIndex] = Unknown();
+			DirtyMin = SLOTS_COUNT;
+			DirtyMax = -1;
+		}
+
+		// Returns true if the slot really changed
+		bool	Set( int _SlotIndex, T* _pValue )
+		{
+			ASSERT( _SlotIndex >= 0 && _SlotIndex < SLOTS_COUNT, "Slot index out of range!" );
+			if ( ppPending[_SlotIndex] == _pValue )
+				return false;	// Redundant!
+
+			ppPending[_SlotIndex] = _pValue;
+			DirtyMin = MIN( DirtyMin, _SlotIndex );
+			DirtyMax = MAX( DirtyMax, _SlotIndex );
+			return true;
+		}
+
+		// Finds the next run of consecutive slots to bind, starting from _StartSlot, and marks them as bound
+		// Returns the amount of slots in the run and updates _StartSlot to the start of the run (0 if no more runs)
+		int		NextRun( int& _StartSlot )
+		{
+			int	SlotIndex = _StartSlot;
+			while ( SlotIndex <= DirtyMax && !NeedsBinding( SlotIndex ) )
+				SlotIndex++;
+			_StartSlot = SlotIndex;
+			while ( SlotIndex <= DirtyMax && NeedsBinding( SlotIndex ) )
+			{
+				ppBound[SlotIndex] = ppPending[SlotIndex];
+				SlotIndex++;
+			}
+			return SlotIndex - _StartSlot;
+		}
+
+		// Forces the slot to be sent again at next flush even if it's the same
+		void	Force( int _SlotIndex )
+		{
+			ppBound[_SlotIndex] = Unknown();
+			DirtyMin = MIN( DirtyMin, _SlotIndex );
+			DirtyMax = MAX( DirtyMax, _SlotIndex );
+		}
+
+		void	Clean()
+		{
+			DirtyMin = SLOTS_COUNT;
+			DirtyMax = -1;
+		}
+	};
+
+	typedef BindingTable<ID3D11ShaderResourceView, SHADOW_SRV_SLOTS>	SRVTable;
+	typedef BindingTable<ID3D11Buffer, SHADOW_CB_SLOTS>					CBTable;
+	typedef BindingTable<ID3D11SamplerState, SHADOW_SAMPLER_SLOTS>		SamplerTable;
+	typedef BindingTable<ID3D11UnorderedAccessView, SHADOW_UAV_SLOTS>	UAVTable;
+
+	// Shadow copy of the input assembler state
+	// Primitives suballocated from the same GeometryPool share all of it so consecutive draws only change their offsets
+	struct	InputAssemblerState
+	{
+		ID3D11InputLayout*			pInputLayout;
+		D3D11_PRIMITIVE_TOPOLOGY	Topology;
+		U32							VertexStreamsCount;
+		ID3D11Buffer*				ppVertexBuffers[SHADOW_VERTEX_STREAMS];
+		U32							pStrides[SHADOW_VERTEX_STREAMS];
+		U32							pOffsets[SHADOW_VERTEX_STREAMS];
+		ID3D11Buffer*				pIndexBuffer;
+		DXGI_FORMAT					IndexFormat;
+
+		// Special values indicating we don't know what's bound
+		void	Invalidate()
+		{
+			pInputLayout = (ID3D11InputLayout*) -1;
+			Topology = (D3D11_PRIMITIVE_TOPOLOGY) -1;
+			VertexStreamsCount = ~0U;
+			pIndexBuffer = (ID3D11Buffer*) -1;
+			IndexFormat = DXGI_FORMAT_UNKNOWN;
+		}
+	};
+
+	struct	StageBindings
+	{
+		SRVTable		SRVs;
+		CBTable			CBs;
+		SamplerTable	Samplers;
+
+		// Constant ranges of the pending CBs (D3D11.1 only, whole buffers are [0,D3D11_REQ_CONSTANT_BUFFER_ELEMENT_COUNT])
+		UINT			pCBFirstConstants[SHADOW_CB_SLOTS];
+		UINT			pCBNumConstants[SHADOW_CB_SLOTS];
+
+		bool	IsCBRange( int _SlotIndex ) const	{ return pCBFirstConstants[_SlotIndex] != 0 || pCBNumConstants[_SlotIndex] != D3D11_REQ_CONSTANT_BUFFER_ELEMENT_COUNT; }
+	};
+
+	// What a context did since its counters were reset
+	struct	FrameCounters
+	{
+		U32		DrawsCount;
+		U32		DispatchesCount;
+		U32		ShaderSwitchesCount;			// Materials & compute shaders that were used
+		U32		StateChangesCount;				// Rasterizer, depth stencil & blend states that were actually changed
+		U32		RenderTargetSwitchesCount;
+		U32		UploadedBytes;					// Bytes written through Map/UpdateSubresource (constants, dynamic geometry, buffers & textures)
+		U32		ConstantUploadsCount;			// Constant buffer updates that reached the GPU (cf. ConstantBuffer::UpdateData())
+		U32		SkippedConstantUploadsCount;	// Constant buffer updates skipped because the data didn't change
+		U32		MapsCount;						// Maps issued through Map() on the immediate context
+		U32		MapStallsCount;					// Maps that waited longer than MAP_STALL_THRESHOLD
+		float	MapWaitDuration;				// Total time the maps waited (ms)
+		U32		FenceWaitsCount;				// Explicit waits for the GPU to complete a frame (cf. WaitForFrame())
+		float	FenceWaitDuration;				// Total time these waits took (ms)
+
+		void	Reset()								{ memset( this, 0, sizeof(FrameCounters) ); }
+		void	Add( const FrameCounters& _Other );
+	};
+
+	// The statistics of a whole frame, captured by Present()
+	struct	FrameStats
+	{
+		U32				FrameIndex;
+		float			CPUDuration;				// Time between the last two Present() (ms)
+		float			GPUDuration;				// Last frame measured by the GPU profiler, a few frames late (ms, 0 without GPU_PROFILING)
+		FrameCounters	Counters;					// Including the commands of the executed command lists
+		U32				BindingRequestsCount;
+		U32				BindingCallsCount;
+	};
+
+	// The maps issued by a call site on the immediate context and how long they waited since the device was initialized
+	struct	MapSite
+	{
+		const char*	pName;
+		U32			MapsCount;
+		U32			StallsCount;				// Maps that waited longer than MAP_STALL_THRESHOLD
+		U32			DeferredCount;				// DO_NOT_WAIT attempts the GPU refused (cf. SetMapDoNotWait())
+		float		TotalWait;					// ms
+		float		MaxWait;					// ms
+	};
+
+	// Everything we track about a single device context
+	// The immediate context has its own state, each CommandList owns another one for its deferred context.
+	// The state used by the Device methods is the one bound to the calling thread (i.e. the immediate state unless
+	//	the thread is currently recording a command list), so components don't need to know which context they talk to.
+	struct	ContextState
+	{
+		ID3D11DeviceContext*	pContext;
+
+		Shader*					pCurrentMaterial;		// The currently used material
+		RasterizerState*		pCurrentRasterizerState;
+		DepthStencilState*		pCurrentDepthStencilState;
+		BlendState*				pCurrentBlendState;
+		const PipelineState*	pCurrentPipelineState;	// The last pipeline state applied, NULL once its material or states were changed by other means
+		InputAssemblerState		IA;
+		const Texture2D*		pAutoMipsTarget;		// The bound render target whose mips must be generated once it's unbound (cf. Texture2D::SetAutoGenerateMips())
+
+		// Binding shadow tables
+		StageBindings			pStageBindings[SHADER_STAGES_COUNT];
+		UAVTable				CSUAVs;
+		UINT					pCSUAVInitialCounts[SHADOW_UAV_SLOTS];
+		U32						DirtyStagesMask;		// 1 bit per stage + bit 6 for CS UAVs
+		U32						BindingRequestsCount;	// Amount of slots that were requested to be bound
+		U32						BindingCallsCount;		// Amount of API calls that were actually issued
+		FrameCounters			Counters;
+
+		ContextState();
+	};
+
 private:	// FIELDS
 
 	ID3D11Device*			m_pDevice;
 	ID3D11DeviceContext*	m_pDeviceContext;
+	ID3D11DeviceContext1*	m_pDeviceContext1;		// NULL if the runtime or the driver don't support constant buffer offsets
 	IDXGISwapChain*			m_pSwapChain;
+	bool					m_bHDR10Output;			// True if the back buffer is presented as PQ-encoded Rec.2020 (cf. Init())
+	bool					m_bVSRenderTargetArrayIndex;	// True if the vertex shader can output SV_RenderTargetArrayIndex (requires D3D11_3_OPTIONS)
+	bool					m_bConstantBufferPartialUpdates;	// True if UpdateSubresource1() accepts a box on constant buffers (requires D3D11.1)
+	U64						m_DedicatedVideoMemory;	// Reported by the adapter, used as the budget when the OS can't tell (cf. GetVideoMemoryBudget())
+	bool					m_bOverBudget;			// True once the usage crossed the budget warning, until it falls back below (cf. CheckVideoMemoryBudget())
+#ifdef VIDEO_MEMORY_BUDGET
+	IDXGIAdapter3*			m_pAdapter3;			// NULL on systems older than Windows 10
+#endif
 
 	Texture2D*				m_pDefaultRenderTarget;	// The back buffer to render to the screen
 	Texture2D*				m_pDefaultDepthStencil;	// The default depth stencil
 
 	ID3D11SamplerState*		m_ppSamplers[SAMPLERS_COUNT];
 
-	Component*				m_pComponentsStackTop;	// Remember this is the stack TOP so access the components using their m_pNext pointer to reach back to the bottom
+	// Sampler cache
+	// The samplers are looked up by the hash of their description and owned by the device, so effects asking for the same
+	//	filtering & addressing share the same state object. Named samplers are bound by Shader::Use() to the shaders declaring them.
+	struct	NamedSampler
+	{
+		const char*		pName;
+		SamplerState*	pSampler;
+	};
+	SamplerState*			m_ppSamplerStates[MAX_SAMPLER_STATES];
+	int						m_SamplerStatesCount;
+	NamedSampler			m_pNamedSamplers[MAX_NAMED_SAMPLERS];
+	int						m_NamedSamplersCount;
+
+	// Components table
+	// Each component owns a slot for its whole life, freed slots are chained and reused by the next components with an incremented
+	//	generation so the handles of destroyed components never resolve to the components that replaced them (cf. GetComponent())
+	struct	ComponentSlot
+	{
+		Component*	pComponent;				// NULL if the slot is free
+		U32			Generation;				// Incremented each time the slot is freed, never 0 so 0 is never a valid handle
+		U32			NextFreeSlot;			// Next free slot if this one is free
+	};
+	List<ComponentSlot>		m_ComponentSlots;
+	U32						m_FirstFreeComponentSlot;	// ~0U if there are no free slots
+	int						m_ComponentsCount;
 
-	Shader*				m_pCurrentMaterial;		// The currently used material
-	RasterizerState*		m_pCurrentRasterizerState;
-	DepthStencilState*		m_pCurrentDepthStencilState;
-	BlendState*				m_pCurrentBlendState;
+	// Deferred releases
+	// Objects released by destroyed components are only released once the GPU completed the frame they were released in (cf. DeferRelease())
+	struct	DeferredRelease
+	{
+		IUnknown*	pObject;
+		U32			FrameIndex;
+	};
+	List<DeferredRelease>	m_DeferredReleases;		// In increasing frame order
+	U32						m_FirstDeferredRelease;	// The entries before this one are already released
 
 	int						m_StatesCount;
 
+	// Free-threading
+	// Components may be created by loader threads (cf. ExecuteOnRenderThread()) so the handle table, the deferred releases
+	//	and the render thread jobs are guarded by a single lock
+	CRITICAL_SECTION		m_Lock;
+	DWORD					m_RenderThreadID;		// The thread that initialized the device and owns the immediate context
+	List<IJob*>				m_RenderThreadJobs;		// Jobs posted by other threads, executed by the next Present()
+
+	ContextState			m_ImmediateState;		// State of the immediate context
+	DWORD					m_ContextStateTLS;		// TLS slot storing the ContextState bound to each thread (NULL means immediate)
+
+	JobQueue*				m_pJobs;				// The worker threads used to record command lists
+	RenderTargetPool*		m_pRenderTargets;		// The transient render targets shared by all the passes
+	DynamicGeometry*		m_pDynamicGeometry;		// The vertex & index rings shared by all the dynamic draws
+
+	// Upload ring
+	// Uploads are suballocated linearly from a single dynamic buffer mapped with NO_OVERWRITE and copied to their target on the GPU.
+	//	When the ring wraps, it's mapped with DISCARD so the driver renames it and we never write into a region the GPU may still be copying from.
+	ID3D11Buffer*			m_pUploadRing;
+	U32						m_UploadRingOffset;
+
+	// Transient constants ring (D3D11.1 only)
+	// Same principle as the upload ring except the ring itself is bound as a constant buffer with offsets, so per-draw constants
+	//	don't each rename their own small buffer. The generation is incremented on each wrap: ranges of older generations are lost.
+	ID3D11Buffer*			m_pConstantRing;
+	U32						m_ConstantRingOffset;
+	U32						m_ConstantRingGeneration;
+
+#ifdef GPU_PROFILING
+	GPUProfiler*			m_pProfiler;
+#endif
+
+	// Frame pipelining
+	// An event is issued at the end of each frame and Present() waits for the one of the frame that is m_MaxFramesInFlight frames old,
+	//	so the CPU never gets too far ahead of the GPU and the input sampled for a frame is displayed with a bounded latency.
+	ID3D11Query*			m_ppFrameEvents[MAX_FRAMES_IN_FLIGHT];
+	U32						m_FrameIndex;
+	U32						m_CompletedFramesCount;	// The frames before this one are known to be completed by the GPU
+	int						m_MaxFramesInFlight;
+
+	// Frame statistics
+	double					m_TicksToMilliseconds;
+	LARGE_INTEGER			m_LastPresentTicks;
+	U32						m_LastBindingRequestsCount;
+	U32						m_LastBindingCallsCount;
+	FrameStats				m_LastFrameStats;
+
+	// Map tracking
+	MapSite					m_pMapSites[MAX_MAP_SITES];
+	int						m_MapSitesCount;
+	bool					m_bMapDoNotWait;
+
 	// Default blend & stencil refs
 	float4				m_BlendFactors;
 	U32						m_BlendMasks;
@@ -90,16 +409,51 @@ public:
 public:	 // PROPERTIES
 
 	bool					IsInitialized() const		{ return m_pDeviceContext != NULL; }
-	int						ComponentsCount() const;
+	int						ComponentsCount() const		{ return m_ComponentsCount - 2 - m_StatesCount; }	// Without counting our internal back buffer, depth stencil & states components
+	int						DeferredReleasesCount() const	{ return m_DeferredReleases.GetCount() - m_FirstDeferredRelease; }
+
+	// Returns the component with that handle, or NULL if the component was destroyed since (cf. Component::GetHandle())
+	Component*				GetComponent( U32 _Handle ) const;
 
 	ID3D11Device&			DXDevice()					{ return *m_pDevice; }
-	ID3D11DeviceContext&	DXContext()					{ return *m_pDeviceContext; }
+	ID3D11DeviceContext&	DXContext()					{ return *State().pContext; }	// The context bound to the calling thread (immediate or deferred)
+	ID3D11DeviceContext&	DXImmediateContext()		{ return *m_pDeviceContext; }
+	bool					IsImmediate()				{ return &State() == &m_ImmediateState; }	// True if the calling thread talks to the immediate context
+	bool					IsRenderThread() const		{ return GetCurrentThreadId() == m_RenderThreadID; }	// True if the calling thread is the one that initialized the device
 	IDXGISwapChain&			DXSwapChain()				{ return *m_pSwapChain; }
+	bool					IsHDR10Output() const		{ return m_bHDR10Output; }
 
 	const Texture2D&		DefaultRenderTarget() const	{ return *m_pDefaultRenderTarget; }
 	const Texture2D&		DefaultDepthStencil() const	{ return *m_pDefaultDepthStencil; }
 
-	Shader*				CurrentMaterial()			{ return m_pCurrentMaterial; }
+	Shader*				CurrentMaterial()			{ return State().pCurrentMaterial; }
+
+	U32						GetBindingRequestsCount()	{ return State().BindingRequestsCount; }
+	U32						GetBindingCallsCount()		{ return State().BindingCallsCount; }
+	void					ResetBindingStats()			{ State().BindingRequestsCount = State().BindingCallsCount = 0; }
+
+	JobQueue&				Jobs()						{ return *m_pJobs; }
+	RenderTargetPool&		RenderTargets()				{ return *m_pRenderTargets; }
+	DynamicGeometry&		Dynamic()					{ return *m_pDynamicGeometry; }
+
+	bool					SupportsConstantOffsets() const		{ return m_pDeviceContext1 != NULL; }
+	bool					SupportsVSRenderTargetArrayIndex() const	{ return m_bVSRenderTargetArrayIndex; }	// Otherwise a GS must select the slice
+	bool					SupportsConstantBufferPartialUpdates() const	{ return m_bConstantBufferPartialUpdates; }
+	ID3D11DeviceContext1&	DXContext1()						{ ASSERT( m_pDeviceContext1 != NULL, "D3D11.1 isn't supported!" ); return *m_pDeviceContext1; }	// The immediate context only
+	ID3D11Buffer*			ConstantRing()						{ return m_pConstantRing; }
+	U32						ConstantRingGeneration() const		{ return m_ConstantRingGeneration; }
+
+	U32						GetFrameIndex() const		{ return m_FrameIndex; }
+	int						GetMaxFramesInFlight() const	{ return m_MaxFramesInFlight; }
+	const FrameStats&		GetLastFrameStats() const	{ return m_LastFrameStats; }		// Statistics of the last presented frame
+
+	int						GetMapSitesCount() const	{ return m_MapSitesCount; }
+	const MapSite&			GetMapSite( int _Index ) const	{ return m_pMapSites[_Index]; }
+	bool					IsMapDoNotWait() const		{ return m_bMapDoNotWait; }
+
+#ifdef GPU_PROFILING
+	GPUProfiler&			Profiler()					{ return *m_pProfiler; }
+#endif
 
 
 public:	 // METHODS
@@ -108,8 +462,10 @@ public:	 // METHODS
 //	~Device();	// Don't declare a destructor since the Device exists as a static singleton instance: in release mode, this implies calling some annoying atexit() function that will yield a link error!
 				// Simply don't forget to call Exit() at the end of your program and that should do the trick...
 
-	bool	Init( HWND _Handle, bool _Fullscreen, bool _sRGB );
-	bool	Init( U32 _Width, U32 _Height, HWND _Handle, bool _Fullscreen, bool _sRGB );
+	// _HDR10, requests a 10 bits back buffer presented as PQ-encoded Rec.2020 (requires HDR10_OUTPUT and an HDR display)
+	//	If the display doesn't support it, we fall back to a 10 bits sRGB-encoded back buffer (cf. IsHDR10Output())
+	bool	Init( HWND _Handle, bool _Fullscreen, bool _sRGB, bool _HDR10=false );
+	bool	Init( U32 _Width, U32 _Height, HWND _Handle, bool _Fullscreen, bool _sRGB, bool _HDR10=false );
 	void	Exit();
 
 	// Helpers
@@ -121,9 +477,14 @@ public:	 // METHODS
 	void	SetRenderTarget( const Texture2D& _Target, const Texture2D* _pDepthStencil=NULL, const D3D11_VIEWPORT* _pViewport=NULL );
 	void	SetRenderTarget( const Texture3D& _Target, const Texture2D* _pDepthStencil=NULL, const D3D11_VIEWPORT* _pViewport=NULL );
 	void	SetRenderTarget( int _Width, int _Height, const ID3D11RenderTargetView& _Target, ID3D11DepthStencilView* _pDepthStencil=NULL, const D3D11_VIEWPORT* _pViewport=NULL );
-	void	SetRenderTargets( int _Width, int _Height, int _TargetsCount, ID3D11RenderTargetView* const * _ppTargets, ID3D11DepthStencilView* _pDepthStencil=NULL, const D3D11_VIEWPORT* _pViewport=NULL );
+	void	SetRenderTargets( int _Width, int _Height, int _TargetsCount, ID3D11RenderTargetView* const * _ppTargets, ID3D11DepthStencilView* _pDepthStencil=NULL, const D3D11_VIEWPORT* _pViewport=NULL, int _ViewportsCount=1 );	// Several viewports can be given for a geometry shader to select with SV_ViewportArrayIndex
+	void	SetPixelShaderUAVs( int _Width, int _Height, int _UAVsCount, ID3D11UnorderedAccessView* const * _ppUAVs );	// Rasterizes a _Width x _Height viewport without render target nor depth stencil, the pixel shader only writes the UAVs in u0 onward (unbind with RemoveUAVs())
 	void	SetStates( RasterizerState* _pRasterizerState, DepthStencilState* _pDepthStencilState, BlendState* _pBlendState );
 	void	SetStatesReferences( const float4& _BlendMasks, U32 _BlendSampleMask, U8 _StencilRef );
+
+	// Uses the material, the states & the static bindings of a pipeline state, only sending what changed since the last one
+	// Returns false if the material can't be used (e.g. it's compiling or in error state)
+	bool	SetPipelineState( const PipelineState& _PipelineState );
 	void	SetScissorRect( const D3D11_RECT* _pScissor=NULL );
 
 	// Clears the shader resource registers
@@ -134,15 +495,152 @@ public:	 // METHODS
 	void	RemoveRenderTargets();
 	void	RemoveUAVs();
 
+	// Resource bindings
+	// All bindings go through shadow tables: redundant bindings are dropped and the actual API calls are only issued
+	//	(coalesced by contiguous slot ranges) when FlushBindings() is called, which is done automatically before each draw/dispatch.
+	// _ShaderStages is a combination of SHADER_STAGE_FLAGS telling which stages to bind to
+	void	SetShaderResources( U32 _ShaderStages, int _SlotIndex, int _SlotsCount, ID3D11ShaderResourceView* const* _ppViews );
+	void	SetShaderResource( U32 _ShaderStages, int _SlotIndex, ID3D11ShaderResourceView* _pView )	{ SetShaderResources( _ShaderStages, _SlotIndex, 1, &_pView ); }
+	void	SetConstantBuffers( U32 _ShaderStages, int _SlotIndex, int _SlotsCount, ID3D11Buffer* const* _ppBuffers );
+	void	SetConstantBuffer( U32 _ShaderStages, int _SlotIndex, ID3D11Buffer* _pBuffer )				{ SetConstantBuffers( _ShaderStages, _SlotIndex, 1, &_pBuffer ); }
+	void	SetSamplers( U32 _ShaderStages, int _SlotIndex, int _SlotsCount, ID3D11SamplerState* const* _ppSamplers );
+	void	SetSamplerState( U32 _ShaderStages, int _SlotIndex, const SamplerState& _Sampler );
+	void	SetUnorderedAccessViews( int _SlotIndex, int _SlotsCount, ID3D11UnorderedAccessView* const* _ppViews, const UINT* _pInitialCounts=NULL );	// Compute shader UAVs only
+	void	SetUnorderedAccessView( int _SlotIndex, ID3D11UnorderedAccessView* _pView, UINT _InitialCount=-1 )		{ SetUnorderedAccessViews( _SlotIndex, 1, &_pView, &_InitialCount ); }
+
+	// Input assembler
+	// Unlike resources, these are sent right away but redundant changes are dropped all the same
+	void	SetInputLayout( ID3D11InputLayout* _pLayout );
+	void	SetPrimitiveTopology( D3D11_PRIMITIVE_TOPOLOGY _Topology );
+	void	SetVertexBuffers( U32 _StreamsCount, ID3D11Buffer* const* _ppBuffers, const U32* _pStrides, const U32* _pOffsets );
+	void	SetIndexBuffer( ID3D11Buffer* _pBuffer, DXGI_FORMAT _Format );
+
+	// Uploads data to a range of a default usage buffer without waiting for the GPU (immediate context only, UpdateSubresource() is used otherwise)
+	void	UploadBuffer( ID3D11Buffer& _Target, U32 _TargetOffset, const void* _pData, U32 _Size );
+
+	// Copies constants into the transient ring and returns the first constant of their range (immediate context & D3D11.1 only)
+	// The range is valid until the ring's generation changes (cf. ConstantRingGeneration())
+	U32		AllocateConstants( const void* _pData, U32 _Size );
+
+	// Binds a range of constants of a buffer (cf. AllocateConstants())
+	void	SetConstantBufferRange( U32 _ShaderStages, int _SlotIndex, ID3D11Buffer* _pBuffer, U32 _FirstConstant, U32 _NumConstants );
+
+	// Sampler cache
+	// Returns the sampler with that description, created the first time it's asked for (the device owns it)
+	SamplerState&	GetSamplerState( const D3D11_SAMPLER_DESC& _Desc );
+
+	// Names a sampler so shaders declaring "SamplerState <Name> : register( s<N> )" with N >= SAMPLERS_COUNT get it bound by Shader::Use()
+	// NOTE: The name must be a persistent string
+	// The global samplers are registered as LinearClamp, PointClamp, LinearWrap, PointWrap, LinearMirror, PointMirror, LinearBlackBorder
+	//	& ShadowComparison, and AnisotropicWrap is registered without being bound globally so only the shaders asking for it pay for it.
+	SamplerState&	RegisterSamplerState( const char* _pName, const D3D11_SAMPLER_DESC& _Desc );
+	SamplerState*	FindSamplerState( const char* _pName ) const;
+
+	// Sends all pending bindings to the context
+	void	FlushBindings();
+
+	// Presents the back buffer then waits for the GPU if it's more than GetMaxFramesInFlight() frames late
+	// The objects whose release was deferred until a frame that the GPU is done with are released then
+	void	Present( bool _bVSync=false );
+
+	// Tells if the GPU completed a frame that was presented (cf. GetFrameIndex()) without waiting
+	bool	IsFrameCompleted( U32 _FrameIndex );
+
+	// Waits for the GPU to complete a frame that was presented, e.g. before rewriting a resource the frame used
+	// The wait is counted in the frame statistics and attributed to _pSite like a map (cf. Map())
+	void	WaitForFrame( U32 _FrameIndex, const char* _pSite );
+
+	// Releases the object once the GPU completed the current frame, rather than right away while commands of the frames in flight
+	//	may still reference it (components release their resources with this when they're destroyed)
+	// NOTE: The object is released right away if the device is not initialized
+	void	DeferRelease( IUnknown* _pObject );
+
+	// Free-threaded creation
+	// Loader threads can create components whose content is provided at creation (e.g. a Texture2D or Texture3D with its content,
+	//	a Primitive with its vertices or a StructuredBuffer with its initial content) since that only talks to the device, never to a context.
+	//	Anything else (uploads, bindings, generating mips, destroying a component...) must be posted to the render thread with this.
+	// The job is executed right away when called from the render thread, otherwise at the start of the next Present(), in posting order
+	// NOTE: The job must stay alive until it's executed (e.g. allocate it and have it delete itself at the end of Run())
+	void	ExecuteOnRenderThread( IJob& _Job );
+
+	// Frame statistics
+	// Components report what they do on the context bound to the calling thread, command lists add their counters to the
+	//	immediate context's when they're executed and Present() captures the whole frame (cf. GetLastFrameStats())
+	void	CountDraw()								{ State().Counters.DrawsCount++; }
+	void	CountDispatch()							{ State().Counters.DispatchesCount++; }
+	void	CountShaderSwitch()						{ State().Counters.ShaderSwitchesCount++; }
+	void	CountUpload( U32 _Size )				{ State().Counters.UploadedBytes += _Size; }
+	void	CountConstantUpload( bool _bSkipped )	{ if ( _bSkipped ) State().Counters.SkippedConstantUploadsCount++; else State().Counters.ConstantUploadsCount++; }
+
+	// Maps a resource with the context bound to the calling thread
+	// On the immediate context, the time the call waited for the GPU is attributed to _pSite (a persistent string naming the call
+	//	site or the resource) and a debug warning is output each time a site stalls longer than it ever did.
+	// In DO_NOT_WAIT mode, read & write maps are first attempted without waiting: if the GPU still uses the resource, sites that
+	//	can retry later (_bCanDefer) get DXGI_ERROR_WAS_STILL_DRAWING and the others fall back to a blocking map.
+	HRESULT	Map( ID3D11Resource* _pResource, U32 _SubResource, D3D11_MAP _MapType, D3D11_MAPPED_SUBRESOURCE& _Mapped, const char* _pSite, bool _bCanDefer=false );
+
+	// Enables the DO_NOT_WAIT attempts (cf. Map())
+	void	SetMapDoNotWait( bool _bDoNotWait )		{ m_bMapDoNotWait = _bDoNotWait; }
+
+	// Video memory accounting
+	// Each component estimates its own footprint from its description (formats, mips, array slices...) and the device sums them up.
+	//	This iterates on all the components so call it from time to time rather than every frame.
+	// NOTE: This ignores the driver's own padding & alignments and the resources created directly with DXDevice()
+	void	GetVideoMemoryUsage( VideoMemoryUsage& _Usage ) const;
+
+	// Outputs the usage per category and the _LargestCount largest components (with their memory tag if they have one) to the debugger
+	void	DumpVideoMemoryUsage( int _LargestCount=16 ) const;
+
+	// Returns the amount of video memory the OS lets us use (DXGI 1.4 with VIDEO_MEMORY_BUDGET), or else the adapter's dedicated memory
+	U64		GetVideoMemoryBudget() const;
+
+	// Outputs a debug warning when the usage exceeds _WarningRatio of the budget (only once until it falls back below)
+	// Returns false if the usage is over that limit
+	bool	CheckVideoMemoryBudget( float _WarningRatio=0.9f );
+
+	// Sets how many frames the GPU may lag behind the CPU, in [1,MAX_FRAMES_IN_FLIGHT] (1 means the CPU always waits for the previous frame)
+	// Also limits the amount of frames DXGI queues before Present() blocks.
+	void	SetMaxFramesInFlight( int _FramesCount );
+
+	// Forgets everything we know about what's bound to the context
+	// You must call this if you ever talk to DXContext() directly to change resource bindings!
+	void	InvalidateBindings();
+
 private:
 
 	void	RegisterComponent( Component& _Component );
 	void	UnRegisterComponent( Component& _Component );
 
+	void	InvalidateShaderResources();
+
+	// Releases the deferred objects of all the frames up to _LastCompletedFrame
+	void	FlushDeferredReleases( U32 _LastCompletedFrame );
+
+	// Executes the jobs posted by other threads (cf. ExecuteOnRenderThread())
+	void	FlushRenderThreadJobs();
+
+	MapSite&	FindMapSite( const char* _pSite );
+
+	// Returns the context state bound to the calling thread
+	ContextState&	State()
+	{
+		ContextState*	pState = (ContextState*) TlsGetValue( m_ContextStateTLS );
+		return pState != NULL ? *pState : m_ImmediateState;
+	}
+
+	// Initializes a deferred context state with the immediate context's bindings since deferred contexts don't inherit anything
+	// NOTE: Must be called by the thread owning the immediate context, before the recording thread starts
+	void	InheritImmediateState( ContextState& _State );
+
+	// Binds a deferred context state to the calling thread until EndDeferredState() reverts to the immediate context
+	void	BeginDeferredState( ContextState& _State );
+	void	EndDeferredState();
+
 public:
 	static bool	Check( HRESULT _Result );
 
 	friend class Component;
 	friend class Shader;
+	friend class CommandList;
 };
 
@@ -0,0 +1,80 @@
+#include "FrameStatsCapture.h"
+#include <stdio.h>
+
+FrameStatsCapture::FrameStatsCapture( Device& _Device )
+	: m_Device( _Device )
+	, m_pFrames( NULL )
+	, m_FramesCount( 0 )
+	, m_CapturedCount( 0 )
+	, m_LastFrameIndex( ~0U )
+{
+	m_pFileName[0] = '\0';
+}
+
+FrameStatsCapture::~FrameStatsCapture()
+{
+	Stop();
+}
+
+void	FrameStatsCapture::Start( const char* _pFileName, int _FramesCount )
+{
+	ASSERT( _FramesCount > 0 && _FramesCount <= MAX_FRAMES, "Invalid amount of frames to capture!" );
+	Stop();
+
+	strcpy_s( m_pFileName, _pFileName );
+	m_FramesCount = CLAMP( _FramesCount, 1, MAX_FRAMES );
+	m_pFrames = new Device::FrameStats[m_FramesCount];
+	m_CapturedCount = 0;
+	m_LastFrameIndex = m_Device.GetLastFrameStats().FrameIndex;	// Don't record the frame that was presented before we started
+}
+
+void	FrameStatsCapture::Update()
+{
+	if ( !IsCapturing() )
+		return;
+
+	const Device::FrameStats&	Stats = m_Device.GetLastFrameStats();
+	if ( Stats.FrameIndex == m_LastFrameIndex )
+		return;	// Nothing was presented since the last update
+
+	m_LastFrameIndex = Stats.FrameIndex;
+	m_pFrames[m_CapturedCount++] = Stats;
+	if ( m_CapturedCount == m_FramesCount )
+		Stop();
+}
+
+void	FrameStatsCapture::Stop()
+{
+	if ( !IsCapturing() )
+		return;
+
+	FILE*	pFile = NULL;
+	fopen_s( &pFile, m_pFileName, "w" );
+	ASSERT( pFile != NULL, "Failed to create the frame statistics file!" );
+	if ( pFile != NULL )
+	{
+		fprintf( pFile, "Frame,CPU (ms),GPU (ms),Draws,Dispatches,Shader Switches,State Changes,RT Switches,Uploaded Bytes,CB Uploads,CB Skipped,Binding Requests,Binding Calls,Maps,Map Stalls,Map Wait (ms),Fence Waits,Fence Wait (ms)\n" );
+		for ( int FrameIndex=0; FrameIndex < m_CapturedCount; FrameIndex++ )
+		{
+			const Device::FrameStats&	S = m_pFrames[FrameIndex];
+			fprintf( pFile, "%d,%.3f,%.3f,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%.3f,%d,%.3f\n", S.FrameIndex, S.CPUDuration, S.GPUDuration,
+				S.Counters.DrawsCount, S.Counters.DispatchesCount, S.Counters.ShaderSwitchesCount, S.Counters.StateChangesCount,
+				S.Counters.RenderTargetSwitchesCount, S.Counters.UploadedBytes, S.Counters.ConstantUploadsCount, S.Counters.SkippedConstantUploadsCount, S.BindingRequestsCount, S.BindingCallsCount,
+				S.Counters.MapsCount, S.Counters.MapStallsCount, S.Counters.MapWaitDuration, S.Counters.FenceWaitsCount, S.Counters.FenceWaitDuration );
+		}
+		fclose( pFile );
+	}
+
+	delete[] m_pFrames;
+	m_pFrames = NULL;
+}
+
+int		FrameStatsCapture::Format( const Device::FrameStats& _Stats, char* _pBuffer, int _BufferSize )
+{
+	return _snprintf_s( _pBuffer, _BufferSize, _TRUNCATE, "CPU %.2f ms GPU %.2f ms - %d draws %d dispatches %d shaders %d states %d RTs %d KB %d/%d CBs - %d/%d binds - %d maps (%d stalls, %.2f ms) - %d fences (%.2f ms)",
+		_Stats.CPUDuration, _Stats.GPUDuration, _Stats.Counters.DrawsCount, _Stats.Counters.DispatchesCount, _Stats.Counters.ShaderSwitchesCount,
+		_Stats.Counters.StateChangesCount, _Stats.Counters.RenderTargetSwitchesCount, _Stats.Counters.UploadedBytes >> 10,
+		_Stats.Counters.ConstantUploadsCount, _Stats.Counters.ConstantUploadsCount + _Stats.Counters.SkippedConstantUploadsCount,
+		_Stats.BindingCallsCount, _Stats.BindingRequestsCount, _Stats.Counters.MapsCount, _Stats.Counters.MapStallsCount, _Stats.Counters.MapWaitDuration,
+		_Stats.Counters.FenceWaitsCount, _Stats.Counters.FenceWaitDuration );
+}
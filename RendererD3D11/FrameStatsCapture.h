@@ -0,0 +1,54 @@
+//////////////////////////////////////////////////////////////////////////
+// Frame Statistics Capture
+// Records the statistics of the device over a window of frames and writes them as CSV (one line per frame) once the window is
+//	complete, so runs of the same content can be compared to catch regressions.
+//
+// Usage:
+//	FrameStatsCapture	Capture( gs_Device );
+//	Capture.Start( "./FrameStats.csv", 600 );		// Capture the next 600 frames
+//	(...)
+//	Capture.Update();	// Every frame, after Device::Present()
+//
+// Format() writes a single line summary of a frame that can be shown on screen.
+//
+#pragma once
+
+#include "Device.h"
+
+class FrameStatsCapture
+{
+public:		// CONSTANTS
+
+	static const int	MAX_FRAMES = 3600;
+
+private:	// FIELDS
+
+	Device&					m_Device;
+
+	char					m_pFileName[MAX_PATH];
+	Device::FrameStats*		m_pFrames;
+	int						m_FramesCount;		// Frames to capture
+	int						m_CapturedCount;
+	U32						m_LastFrameIndex;
+
+public:		// PROPERTIES
+
+	bool		IsCapturing() const		{ return m_pFrames != NULL; }
+
+public:		// METHODS
+
+	FrameStatsCapture( Device& _Device );
+	~FrameStatsCapture();
+
+	// Starts capturing the next frames (a capture in progress is written first)
+	void		Start( const char* _pFileName, int _FramesCount );
+
+	// Records the last presented frame and writes the file when the window is complete
+	void		Update();
+
+	// Writes what was captured so far and stops
+	void		Stop();
+
+	// Writes a single line summary of a frame, returns the amount of characters written
+	static int	Format( const Device::FrameStats& _Stats, char* _pBuffer, int _BufferSize );
+};
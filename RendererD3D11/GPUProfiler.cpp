@@ -0,0 +1,333 @@
+#include "GPUProfiler.h"
+#include "../Utility/Trace.h"
+
+GPUProfiler::GPUProfiler( Device& _Device )
+	: m_Device( _Device )
+	, m_FrameIndex( 0 )
+	, m_bInFrame( false )
+	, m_ScopesCount( 0 )
+	, m_StackDepth( 0 )
+	, m_AverageFactor( 1.0f / 32.0f )
+	, m_LastFrameDuration( 0.0f )
+	, m_AverageFrameDuration( 0.0f )
+	, m_DroppedFramesCount( 0 )
+	, m_DisjointFramesCount( 0 )
+{
+	D3D11_QUERY_DESC	DisjointDesc;
+	DisjointDesc.Query = D3D11_QUERY_TIMESTAMP_DISJOINT;
+	DisjointDesc.MiscFlags = 0;
+
+	D3D11_QUERY_DESC	TimeStampDesc;
+	TimeStampDesc.Query = D3D11_QUERY_TIMESTAMP;
+	TimeStampDesc.MiscFlags = 0;
+
+	// Create all the queries once and for all
+	for ( int FrameIndex=0; FrameIndex < FRAMES_COUNT; FrameIndex++ )
+	{
+		FrameQueries&	F = m_pFrames[FrameIndex];
+		F.ScopesCount = 0;
+		F.bPending = false;
+		F.FrameIndex = 0;
+
+		Device::Check( m_Device.DXDevice().CreateQuery( &DisjointDesc, &F.pDisjoint ) );
+		Device::Check( m_Device.DXDevice().CreateQuery( &TimeStampDesc, &F.pFrameBegin ) );
+		Device::Check( m_Device.DXDevice().CreateQuery( &TimeStampDesc, &F.pFrameEnd ) );
+
+		for ( int ScopeIndex=0; ScopeIndex < MAX_SCOPES_PER_FRAME; ScopeIndex++ )
+		{
+			ScopeQuery&	S = F.pScopes[ScopeIndex];
+			S.ScopeIndex = -1;
+			Device::Check( m_Device.DXDevice().CreateQuery( &TimeStampDesc, &S.pBegin ) );
+			Device::Check( m_Device.DXDevice().CreateQuery( &TimeStampDesc, &S.pEnd ) );
+		}
+	}
+}
+
+GPUProfiler::~GPUProfiler()
+{
+	for ( int FrameIndex=0; FrameIndex < FRAMES_COUNT; FrameIndex++ )
+		ReleaseFrame( m_pFrames[FrameIndex] );
+}
+
+void	GPUProfiler::ReleaseFrame( FrameQueries& _Frame )
+{
+	_Frame.pDisjoint->Release();
+	_Frame.pFrameBegin->Release();
+	_Frame.pFrameEnd->Release();
+	for ( int ScopeIndex=0; ScopeIndex < MAX_SCOPES_PER_FRAME; ScopeIndex++ )
+	{
+		_Frame.pScopes[ScopeIndex].pBegin->Release();
+		_Frame.pScopes[ScopeIndex].pEnd->Release();
+	}
+}
+
+void	GPUProfiler::BeginFrame()
+{
+	ASSERT( !m_bInFrame, "Did you forget to call EndFrame()?" );
+
+	FrameQueries&	F = m_pFrames[m_FrameIndex % FRAMES_COUNT];
+	if ( F.bPending && !Collect( F ) )
+		m_DroppedFramesCount++;	// The GPU is more than FRAMES_COUNT frames late! We have no other choice than to drop that frame...
+
+	F.ScopesCount = 0;
+	F.bPending = false;
+	F.FrameIndex = m_FrameIndex;
+
+	ID3D11DeviceContext&	Context = m_Device.DXContext();
+#ifdef TRACING
+	if ( gs_Trace.IsRecording() && !gs_Trace.IsGPUClockSynchronized() )
+		SynchronizeTraceClock();
+#endif
+	Context.Begin( F.pDisjoint );
+	Context.End( F.pFrameBegin );
+
+	m_StackDepth = 0;
+	m_bInFrame = true;
+}
+
+void	GPUProfiler::EndFrame()
+{
+	ASSERT( m_bInFrame, "Did you forget to call BeginFrame()?" );
+	ASSERT( m_StackDepth == 0, "Some scopes were not closed! Check your BeginScope()/EndScope() pairs..." );
+
+	// Close any dangling scope anyway
+	while ( m_StackDepth > 0 )
+		EndScope();
+
+	FrameQueries&	F = m_pFrames[m_FrameIndex % FRAMES_COUNT];
+
+	ID3D11DeviceContext&	Context = m_Device.DXContext();
+	Context.End( F.pFrameEnd );
+	Context.End( F.pDisjoint );
+	F.bPending = true;
+
+	m_bInFrame = false;
+	m_FrameIndex++;
+
+	// Attempt to read back older frames without ever waiting for the GPU (oldest first)
+	for ( int FrameOffset=FRAMES_COUNT-1; FrameOffset > 0; FrameOffset-- )
+	{
+		FrameQueries&	OldFrame = m_pFrames[(m_FrameIndex + FRAMES_COUNT - FrameOffset) % FRAMES_COUNT];
+		if ( OldFrame.bPending && !Collect( OldFrame ) )
+			break;	// Not ready yet, more recent frames won't be either...
+	}
+}
+
+void	GPUProfiler::BeginScope( const char* _pName )
+{
+	if ( !m_bInFrame )
+		return;	// Profiling outside of a frame is ignored
+	if ( !m_Device.IsImmediate() )
+		return;	// Scopes issued while recording command lists are ignored (queries can only be read back on the immediate context, profile the execution instead)
+
+	ASSERT( m_StackDepth < MAX_DEPTH, "Scopes stack overflow! Increase MAX_DEPTH..." );
+	FrameQueries&	F = m_pFrames[m_FrameIndex % FRAMES_COUNT];
+	if ( m_StackDepth >= MAX_DEPTH || F.ScopesCount >= MAX_SCOPES_PER_FRAME )
+	{	// Too many scopes, simply ignore that one
+		m_StackDepth++;
+		return;
+	}
+
+	int	ParentScopeIndex = m_StackDepth > 0 && m_pStack[m_StackDepth-1] >= 0 ? F.pScopes[m_pStack[m_StackDepth-1]].ScopeIndex : -1;
+	int	ScopeIndex = RegisterScope( _pName, ParentScopeIndex );
+	if ( ScopeIndex < 0 )
+	{	// Failed to register...
+		m_pStack[m_StackDepth++] = -1;
+		return;
+	}
+
+	ScopeQuery&	Q = F.pScopes[F.ScopesCount];
+	Q.ScopeIndex = ScopeIndex;
+	m_Device.DXContext().End( Q.pBegin );
+
+	m_pStack[m_StackDepth++] = F.ScopesCount++;
+}
+
+void	GPUProfiler::EndScope()
+{
+	if ( !m_bInFrame || !m_Device.IsImmediate() )
+		return;
+
+	ASSERT( m_StackDepth > 0, "EndScope() called without a matching BeginScope()!" );
+	if ( m_StackDepth <= 0 )
+		return;
+
+	m_StackDepth--;
+	if ( m_StackDepth >= MAX_DEPTH )
+		return;	// Ignored scope
+
+	int	QueryIndex = m_pStack[m_StackDepth];
+	if ( QueryIndex < 0 )
+		return;	// Ignored scope
+
+	FrameQueries&	F = m_pFrames[m_FrameIndex % FRAMES_COUNT];
+	m_Device.DXContext().End( F.pScopes[QueryIndex].pEnd );
+}
+
+int		GPUProfiler::RegisterScope( const char* _pName, int _ParentIndex )
+{
+	// Look for an existing scope
+	for ( int ScopeIndex=0; ScopeIndex < m_ScopesCount; ScopeIndex++ )
+	{
+		const ScopeStats&	S = m_pScopes[ScopeIndex];
+		if ( S.ParentIndex == _ParentIndex && (S.pShortName == _pName || !strcmp( S.pShortName, _pName )) )
+			return ScopeIndex;
+	}
+
+	ASSERT( m_ScopesCount < MAX_SCOPES, "Too many GPU profiling scopes! Increase MAX_SCOPES..." );
+	if ( m_ScopesCount >= MAX_SCOPES )
+		return -1;
+
+	// Create a new one
+	ScopeStats&	S = m_pScopes[m_ScopesCount];
+	S.pShortName = _pName;
+	S.ParentIndex = _ParentIndex;
+	S.Depth = _ParentIndex >= 0 ? m_pScopes[_ParentIndex].Depth + 1 : 0;
+	S.LastDuration = 0.0f;
+	S.AverageDuration = 0.0f;
+	S.MaxDuration = 0.0f;
+	S.FrameLastSeen = ~0U;
+
+	if ( _ParentIndex >= 0 )
+		sprintf_s( S.pName, MAX_NAME_LENGTH, "%s/%s", m_pScopes[_ParentIndex].pName, _pName );
+	else
+		strcpy_s( S.pName, MAX_NAME_LENGTH, _pName );
+
+	return m_ScopesCount++;
+}
+
+bool	GPUProfiler::Collect( FrameQueries& _Frame )
+{
+	ID3D11DeviceContext&	Context = m_Device.DXContext();
+
+	D3D11_QUERY_DATA_TIMESTAMP_DISJOINT	Disjoint;
+	if ( Context.GetData( _Frame.pDisjoint, &Disjoint, sizeof(Disjoint), D3D11_ASYNC_GETDATA_DONOTFLUSH ) != S_OK )
+		return false;	// Not ready yet
+
+	UINT64	FrameBegin, FrameEnd;
+	if ( Context.GetData( _Frame.pFrameBegin, &FrameBegin, sizeof(UINT64), D3D11_ASYNC_GETDATA_DONOTFLUSH ) != S_OK )
+		return false;
+	if ( Context.GetData( _Frame.pFrameEnd, &FrameEnd, sizeof(UINT64), D3D11_ASYNC_GETDATA_DONOTFLUSH ) != S_OK )
+		return false;
+
+	_Frame.bPending = false;
+
+	if ( Disjoint.Disjoint )
+	{	// Timestamps are unreliable (e.g. the GPU clock changed during the frame)
+		m_DisjointFramesCount++;
+		return true;
+	}
+
+	double	ToMilliseconds = 1000.0 / double(Disjoint.Frequency);
+
+	m_LastFrameDuration = float( (FrameEnd - FrameBegin) * ToMilliseconds );
+	m_AverageFrameDuration += m_AverageFactor * (m_LastFrameDuration - m_AverageFrameDuration);
+#ifdef TRACING
+	gs_Trace.RecordGPU( "GPU Frame", FrameBegin, FrameEnd, Disjoint.Frequency );
+#endif
+
+	for ( int QueryIndex=0; QueryIndex < _Frame.ScopesCount; QueryIndex++ )
+	{
+		ScopeQuery&	Q = _Frame.pScopes[QueryIndex];
+
+		UINT64	Begin, End;
+		if ( Context.GetData( Q.pBegin, &Begin, sizeof(UINT64), D3D11_ASYNC_GETDATA_DONOTFLUSH ) != S_OK
+			|| Context.GetData( Q.pEnd, &End, sizeof(UINT64), D3D11_ASYNC_GETDATA_DONOTFLUSH ) != S_OK )
+			continue;	// Shouldn't happen since the entire frame is done...
+
+		float		Duration = float( (End - Begin) * ToMilliseconds );
+		ScopeStats&	S = m_pScopes[Q.ScopeIndex];
+#ifdef TRACING
+		gs_Trace.RecordGPU( S.pShortName, Begin, End, Disjoint.Frequency );
+#endif
+		if ( S.FrameLastSeen == _Frame.FrameIndex )
+		{	// Scope was issued several times in the same frame: accumulate
+			S.LastDuration += Duration;
+			S.AverageDuration += m_AverageFactor * Duration;
+		}
+		else
+		{
+			S.LastDuration = Duration;
+			S.AverageDuration += m_AverageFactor * (Duration - S.AverageDuration);
+			S.FrameLastSeen = _Frame.FrameIndex;
+		}
+		S.MaxDuration = MAX( S.MaxDuration, S.LastDuration );
+	}
+
+	return true;
+}
+
+#ifdef TRACING
+// Measures a GPU timestamp against the QPC clock so the tracer can put the GPU scopes on the CPU's timeline
+// We wait for the GPU to be idle first so the timestamp is taken as soon as it's submitted, the remaining error is the time
+//	it takes us to notice the query is done. This stalls once when the recording starts.
+void	GPUProfiler::SynchronizeTraceClock()
+{
+	ID3D11DeviceContext&	Context = m_Device.DXContext();
+
+	D3D11_QUERY_DESC	Desc;
+	Desc.Query = D3D11_QUERY_EVENT;
+	Desc.MiscFlags = 0;
+	ID3D11Query*	pIdle = NULL;
+	Device::Check( m_Device.DXDevice().CreateQuery( &Desc, &pIdle ) );
+
+	Desc.Query = D3D11_QUERY_TIMESTAMP;
+	ID3D11Query*	pTimeStamp = NULL;
+	Device::Check( m_Device.DXDevice().CreateQuery( &Desc, &pTimeStamp ) );
+
+	BOOL	bIdle;
+	Context.End( pIdle );
+	while ( Context.GetData( pIdle, &bIdle, sizeof(BOOL), 0 ) != S_OK )
+		YieldProcessor();
+
+	UINT64	GPUTicks;
+	Context.End( pTimeStamp );
+	Context.Flush();
+	while ( Context.GetData( pTimeStamp, &GPUTicks, sizeof(UINT64), 0 ) != S_OK )
+		YieldProcessor();
+	gs_Trace.SetGPUClock( GPUTicks, Tracer::Now() );
+
+	pTimeStamp->Release();
+	pIdle->Release();
+}
+#endif
+
+int		GPUProfiler::FindScope( const char* _pFullName ) const
+{
+	for ( int ScopeIndex=0; ScopeIndex < m_ScopesCount; ScopeIndex++ )
+		if ( !strcmp( m_pScopes[ScopeIndex].pName, _pFullName ) )
+			return ScopeIndex;
+
+	return -1;
+}
+
+int		GPUProfiler::Export( char* _pBuffer, int _BufferSize ) const
+{
+	int	Length = _snprintf_s( _pBuffer, _BufferSize, _TRUNCATE, "GPU Frame %.3f ms (avg %.3f ms) - %d dropped\n", m_LastFrameDuration, m_AverageFrameDuration, m_DroppedFramesCount );
+	if ( Length < 0 )
+		return 0;
+
+	// Output scopes in registration order (parents always come before their children)
+	for ( int ScopeIndex=0; ScopeIndex < m_ScopesCount; ScopeIndex++ )
+	{
+		const ScopeStats&	S = m_pScopes[ScopeIndex];
+
+		int	LineLength = _snprintf_s( _pBuffer + Length, _BufferSize - Length, _TRUNCATE, "%*s%-32s avg %7.3f ms  last %7.3f ms  max %7.3f ms\n", 2*S.Depth, "", S.pShortName, S.AverageDuration, S.LastDuration, S.MaxDuration );
+		if ( LineLength < 0 )
+			break;	// Buffer is full
+		Length += LineLength;
+	}
+
+	return Length;
+}
+
+void	GPUProfiler::Reset()
+{
+	for ( int ScopeIndex=0; ScopeIndex < m_ScopesCount; ScopeIndex++ )
+	{
+		ScopeStats&	S = m_pScopes[ScopeIndex];
+		S.LastDuration = S.AverageDuration = S.MaxDuration = 0.0f;
+	}
+	m_LastFrameDuration = m_AverageFrameDuration = 0.0f;
+	m_DroppedFramesCount = m_DisjointFramesCount = 0;
+}
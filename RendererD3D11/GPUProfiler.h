@@ -0,0 +1,148 @@
+//////////////////////////////////////////////////////////////////////////
+// GPU Profiler
+// Measures GPU time spent in nested named scopes using D3D11 timestamp queries
+//
+// Usage:
+//	gs_Device.Profiler().BeginFrame();
+//	{
+//		GPU_PROFILE_SCOPE( m_Device, "GI" );
+//		{
+//			GPU_PROFILE_SCOPE( m_Device, "ShadowMap" );		// Will show up as "GI/ShadowMap"
+//			(...)
+//		}
+//	}
+//	gs_Device.Profiler().EndFrame();
+//
+// Queries are ring-buffered over FRAMES_COUNT frames and are only read back when the GPU
+//	is done with them, so profiling never stalls the pipeline: results are simply FRAMES_COUNT frames late.
+// If a frame's queries are still not available by the time we need to recycle them, the frame is dropped.
+// While the tracer records (cf. Utility/Trace.h), the scopes read back are also added to its GPU timeline.
+//
+#pragma once
+
+#include "Device.h"
+
+class GPUProfiler
+{
+public:		// CONSTANTS
+
+	static const int	FRAMES_COUNT = 4;		// Amount of frames in flight we keep queries for
+	static const int	MAX_SCOPES = 64;		// Maximum amount of distinct scopes we can track
+	static const int	MAX_SCOPES_PER_FRAME = 128;	// Maximum amount of scopes we can issue in a single frame
+	static const int	MAX_DEPTH = 16;			// Maximum scope nesting depth
+	static const int	MAX_NAME_LENGTH = 64;	// Maximum length of a scope's full path (e.g. "GI/ShadowMap")
+
+public:		// NESTED TYPES
+
+	// The persistent statistics for a single scope
+	struct	ScopeStats
+	{
+		char		pName[MAX_NAME_LENGTH];	// Full path name of the scope (e.g. "GI/ShadowMap")
+		const char*	pShortName;				// The name that was used to register the scope
+		int			ParentIndex;			// Index of the parent scope (-1 for root scopes)
+		int			Depth;					// Nesting depth (0 for root scopes)
+		float		LastDuration;			// Last measured duration (ms)
+		float		AverageDuration;		// Rolling average (ms)
+		float		MaxDuration;			// Maximum measured duration (ms)
+		U32			FrameLastSeen;			// The last frame this scope was measured
+	};
+
+protected:
+
+	// A single scope occurrence within a frame
+	struct	ScopeQuery
+	{
+		int					ScopeIndex;
+		ID3D11Query*		pBegin;
+		ID3D11Query*		pEnd;
+	};
+
+	// All the queries issued in a single frame
+	struct	FrameQueries
+	{
+		ID3D11Query*		pDisjoint;
+		ID3D11Query*		pFrameBegin;
+		ID3D11Query*		pFrameEnd;
+		ScopeQuery			pScopes[MAX_SCOPES_PER_FRAME];
+		int					ScopesCount;
+		bool				bPending;		// True if the queries were issued and not read back yet
+		U32					FrameIndex;
+	};
+
+private:	// FIELDS
+
+	Device&				m_Device;
+
+	FrameQueries		m_pFrames[FRAMES_COUNT];
+	U32					m_FrameIndex;		// Index of the current frame
+	bool				m_bInFrame;
+
+	ScopeStats			m_pScopes[MAX_SCOPES];
+	int					m_ScopesCount;
+
+	int					m_pStack[MAX_DEPTH];// Stack of scope query indices currently open
+	int					m_StackDepth;
+
+	float				m_AverageFactor;	// Rolling average factor (default is 1/32)
+	float				m_LastFrameDuration;
+	float				m_AverageFrameDuration;
+	U32					m_DroppedFramesCount;
+	U32					m_DisjointFramesCount;
+
+public:		// PROPERTIES
+
+	int					GetScopesCount() const					{ return m_ScopesCount; }
+	const ScopeStats&	GetScope( int _ScopeIndex ) const		{ return m_pScopes[_ScopeIndex]; }
+	float				GetLastFrameDuration() const			{ return m_LastFrameDuration; }
+	float				GetAverageFrameDuration() const			{ return m_AverageFrameDuration; }
+	U32					GetDroppedFramesCount() const			{ return m_DroppedFramesCount; }
+
+	// Sets the rolling average factor (i.e. Average = lerp( Average, NewValue, Factor ))
+	void				SetAverageFactor( float _Factor )		{ m_AverageFactor = _Factor; }
+
+public:		// METHODS
+
+	GPUProfiler( Device& _Device );
+	~GPUProfiler();
+
+	void		BeginFrame();
+	void		EndFrame();
+
+	// NOTE: The name pointer must be persistent (i.e. use string literals!)
+	void		BeginScope( const char* _pName );
+	void		EndScope();
+
+	// Returns the index of a scope given its full path (e.g. "GI/ShadowMap") or -1 if not found
+	int			FindScope( const char* _pFullName ) const;
+
+	// Writes the rolling averages as a text report (one line per scope, indented by depth)
+	// Returns the amount of characters written
+	int			Export( char* _pBuffer, int _BufferSize ) const;
+
+	// Resets all statistics
+	void		Reset();
+
+private:
+
+	int			RegisterScope( const char* _pName, int _ParentIndex );
+	bool		Collect( FrameQueries& _Frame );
+	void		ReleaseFrame( FrameQueries& _Frame );
+	void		SynchronizeTraceClock();	// Gives the tracer the QPC time of a GPU timestamp (cf. Utility/Trace.h)
+};
+
+// Scoped helper so you don't forget to close the scope
+class	GPUProfileScope
+{
+	GPUProfiler&	m_Profiler;
+public:
+	GPUProfileScope( GPUProfiler& _Profiler, const char* _pName ) : m_Profiler( _Profiler )	{ m_Profiler.BeginScope( _pName ); }
+	~GPUProfileScope()																		{ m_Profiler.EndScope(); }
+};
+
+#ifdef GPU_PROFILING
+#define GPU_PROFILE_CONCAT2( a, b )			a##b
+#define GPU_PROFILE_CONCAT( a, b )			GPU_PROFILE_CONCAT2( a, b )
+#define GPU_PROFILE_SCOPE( _Device, _Name )	GPUProfileScope	GPU_PROFILE_CONCAT( __GPUProfileScope, __LINE__ )( (_Device).Profiler(), _Name );
+#else
+#define GPU_PROFILE_SCOPE( _Device, _Name )
+#endif
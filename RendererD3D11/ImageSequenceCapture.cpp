@@ -0,0 +1,436 @@
+#include "ImageSequenceCapture.h"
+#include "Components/Texture2D.h"
+#include <stdio.h>
+
+//////////////////////////////////////////////////////////////////////////
+// Color conversions
+static float	sRGB2Linear( float _Value )
+{
+	return _Value <= 0.04045f ? _Value / 12.92f : powf( (_Value + 0.055f) / 1.055f, 2.4f );
+}
+
+static float	Linear2sRGB( float _Value )
+{
+	_Value = SATURATE( _Value );
+	return _Value <= 0.0031308f ? 12.92f * _Value : 1.055f * powf( _Value, 1.0f / 2.4f ) - 0.055f;
+}
+
+static bool		IsSRGB( DXGI_FORMAT _Format )
+{
+	return _Format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB || _Format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB || _Format == DXGI_FORMAT_BC1_UNORM_SRGB || _Format == DXGI_FORMAT_BC3_UNORM_SRGB;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// PNG writer
+// The image is stored uncompressed (i.e. "stored" deflate blocks), encoding is then only bound by the disk
+static U32	gs_pCRCTable[256];
+
+static void	InitCRCTable()
+{
+	for ( U32 i=0; i < 256; i++ )
+	{
+		U32	CRC = i;
+		for ( int Bit=0; Bit < 8; Bit++ )
+			CRC = (CRC & 1) ? 0xEDB88320U ^ (CRC >> 1) : CRC >> 1;
+		gs_pCRCTable[i] = CRC;
+	}
+}
+
+static U32	UpdateCRC( U32 _CRC, const U8* _pData, U32 _Size )
+{
+	for ( U32 i=0; i < _Size; i++ )
+		_CRC = gs_pCRCTable[(_CRC ^ _pData[i]) & 0xFF] ^ (_CRC >> 8);
+	return _CRC;
+}
+
+static U32	Adler32( const U8* _pData, U32 _Size )
+{
+	U32	A = 1, B = 0;
+	while ( _Size > 0 )
+	{
+		U32	Count = MIN( _Size, 5552U );	// The largest amount of bytes before B can overflow
+		_Size -= Count;
+		for ( ; Count > 0; Count--, _pData++ )
+		{
+			A += *_pData;
+			B += A;
+		}
+		A %= 65521;
+		B %= 65521;
+	}
+	return (B << 16) | A;
+}
+
+static void	WriteBigEndian( U8* _pTarget, U32 _Value )
+{
+	_pTarget[0] = U8( _Value >> 24 );
+	_pTarget[1] = U8( _Value >> 16 );
+	_pTarget[2] = U8( _Value >> 8 );
+	_pTarget[3] = U8( _Value );
+}
+
+static void	WritePNGChunk( FILE* _pFile, const char* _pType, const U8* _pData, U32 _Size )
+{
+	U8	pHeader[8];
+	WriteBigEndian( pHeader, _Size );
+	memcpy( pHeader+4, _pType, 4 );
+
+	U8	pCRC[4];
+	WriteBigEndian( pCRC, UpdateCRC( UpdateCRC( 0xFFFFFFFFU, pHeader+4, 4 ), _pData, _Size ) ^ 0xFFFFFFFFU );
+
+	fwrite( pHeader, 1, 8, _pFile );
+	fwrite( _pData, 1, _Size, _pFile );
+	fwrite( pCRC, 1, 4, _pFile );
+}
+
+static bool	WritePNG( const char* _pFileName, int _Width, int _Height, const float4* _pPixels, float _Normalization, bool _bSRGB )
+{
+	// Build the scanlines, each preceded by its filter type (0 = None)
+	U32	RowSize = 1 + 3 * _Width;
+	U32	RawSize = RowSize * _Height;
+	U8*	pRaw = new U8[RawSize];
+	U8*	pTarget = pRaw;
+	for ( int Y=0; Y < _Height; Y++ )
+	{
+		*pTarget++ = 0;
+		for ( int X=0; X < _Width; X++, _pPixels++ )
+		{
+			float4	Color = *_pPixels * _Normalization;
+			if ( _bSRGB )
+				Color.Set( Linear2sRGB( Color.x ), Linear2sRGB( Color.y ), Linear2sRGB( Color.z ), Color.w );
+			*pTarget++ = U8( 255.0f * SATURATE( Color.x ) + 0.5f );
+			*pTarget++ = U8( 255.0f * SATURATE( Color.y ) + 0.5f );
+			*pTarget++ = U8( 255.0f * SATURATE( Color.z ) + 0.5f );
+		}
+	}
+
+	// Wrap them in a zlib stream of stored blocks
+	U32	BlocksCount = MAX( 1U, (RawSize + 65534) / 65535 );
+	U32	ZLibSize = 2 + RawSize + 5 * BlocksCount + 4;
+	U8*	pZLib = new U8[ZLibSize];
+	U8*	pStream = pZLib;
+	*pStream++ = 0x78;	// Deflate with a 32K window
+	*pStream++ = 0x01;	// No dictionary, fastest compression (the check bits make the header a multiple of 31)
+	for ( U32 Offset=0; Offset < RawSize || Offset == 0; )
+	{
+		U32	Size = MIN( RawSize - Offset, 65535U );
+		bool	bLast = Offset + Size >= RawSize;
+		*pStream++ = bLast ? 1 : 0;
+		*pStream++ = U8( Size );
+		*pStream++ = U8( Size >> 8 );
+		*pStream++ = U8( ~Size );
+		*pStream++ = U8( ~Size >> 8 );
+		memcpy( pStream, pRaw + Offset, Size );
+		pStream += Size;
+		Offset += Size;
+		if ( bLast )
+			break;
+	}
+	WriteBigEndian( pStream, Adler32( pRaw, RawSize ) );
+	delete[] pRaw;
+
+	FILE*	pFile = NULL;
+	fopen_s( &pFile, _pFileName, "wb" );
+	if ( pFile == NULL )
+	{
+		delete[] pZLib;
+		return false;
+	}
+
+	static const U8	pSignature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	fwrite( pSignature, 1, 8, pFile );
+
+	U8	pIHDR[13];
+	WriteBigEndian( pIHDR+0, _Width );
+	WriteBigEndian( pIHDR+4, _Height );
+	pIHDR[8] = 8;	// Bits per channel
+	pIHDR[9] = 2;	// RGB
+	pIHDR[10] = 0;	// Deflate
+	pIHDR[11] = 0;	// Adaptive filtering
+	pIHDR[12] = 0;	// Not interlaced
+	WritePNGChunk( pFile, "IHDR", pIHDR, 13 );
+	WritePNGChunk( pFile, "IDAT", pZLib, ZLibSize );
+	WritePNGChunk( pFile, "IEND", NULL, 0 );
+
+	fclose( pFile );
+	delete[] pZLib;
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// EXR writer
+// Single-part scanline file without compression, channels are stored as halves in alphabetical order (B, G, R)
+class	EXRHeader
+{
+public:
+	U8		m_pData[512];
+	U32		m_Size;
+
+	EXRHeader() : m_Size( 0 )	{}
+
+	void	Write( const void* _pData, U32 _Size )	{ ASSERT( m_Size + _Size <= sizeof(m_pData), "EXR header overflow!" ); memcpy( m_pData + m_Size, _pData, _Size ); m_Size += _Size; }
+	void	Write( U8 _Value )						{ Write( &_Value, 1 ); }
+	void	Write( U32 _Value )						{ Write( &_Value, 4 ); }	// Little endian
+	void	Write( float _Value )					{ Write( &_Value, 4 ); }
+	void	Write( const char* _pString )			{ Write( _pString, U32(strlen( _pString )) + 1 ); }
+	void	Attribute( const char* _pName, const char* _pType, U32 _Size )	{ Write( _pName ); Write( _pType ); Write( _Size ); }
+};
+
+static bool	WriteEXR( const char* _pFileName, int _Width, int _Height, const float4* _pPixels, float _Normalization )
+{
+	EXRHeader	Header;
+	Header.Write( 20000630U );	// Magic number
+	Header.Write( 2U );			// Version 2, single-part scanline
+
+	const char*	ppChannels[3] = { "B", "G", "R" };
+	Header.Attribute( "channels", "chlist", 3 * (2 + 16) + 1 );
+	for ( int ChannelIndex=0; ChannelIndex < 3; ChannelIndex++ )
+	{
+		Header.Write( ppChannels[ChannelIndex] );
+		Header.Write( 1U );		// HALF
+		Header.Write( 0U );		// pLinear & reserved
+		Header.Write( 1U );		// X sampling
+		Header.Write( 1U );		// Y sampling
+	}
+	Header.Write( U8(0) );
+
+	Header.Attribute( "compression", "compression", 1 );
+	Header.Write( U8(0) );		// NO_COMPRESSION
+
+	U32	pWindow[4] = { 0, 0, U32(_Width-1), U32(_Height-1) };
+	Header.Attribute( "dataWindow", "box2i", 16 );
+	Header.Write( pWindow, 16 );
+	Header.Attribute( "displayWindow", "box2i", 16 );
+	Header.Write( pWindow, 16 );
+
+	Header.Attribute( "lineOrder", "lineOrder", 1 );
+	Header.Write( U8(0) );		// INCREASING_Y
+
+	Header.Attribute( "pixelAspectRatio", "float", 4 );
+	Header.Write( 1.0f );
+	Header.Attribute( "screenWindowCenter", "v2f", 8 );
+	Header.Write( 0.0f );
+	Header.Write( 0.0f );
+	Header.Attribute( "screenWindowWidth", "float", 4 );
+	Header.Write( 1.0f );
+	Header.Write( U8(0) );		// End of the header
+
+	FILE*	pFile = NULL;
+	fopen_s( &pFile, _pFileName, "wb" );
+	if ( pFile == NULL )
+		return false;
+
+	fwrite( Header.m_pData, 1, Header.m_Size, pFile );
+
+	// Offsets of the scanlines, one per block without compression
+	U32	ScanlineSize = 3 * _Width * sizeof(half);
+	U64	Offset = Header.m_Size + 8 * _Height;
+	for ( int Y=0; Y < _Height; Y++, Offset += 8 + ScanlineSize )
+		fwrite( &Offset, 8, 1, pFile );
+
+	half*	pScanline = new half[3*_Width];
+	for ( int Y=0; Y < _Height; Y++ )
+	{
+		for ( int X=0; X < _Width; X++, _pPixels++ )
+		{
+			float4	Color = *_pPixels * _Normalization;
+			pScanline[0*_Width+X] = half( MAX( 0.0f, Color.z ) );
+			pScanline[1*_Width+X] = half( MAX( 0.0f, Color.y ) );
+			pScanline[2*_Width+X] = half( MAX( 0.0f, Color.x ) );
+		}
+
+		U32	pBlockHeader[2] = { U32(Y), ScanlineSize };
+		fwrite( pBlockHeader, 4, 2, pFile );
+		fwrite( pScanline, 1, ScanlineSize, pFile );
+	}
+	delete[] pScanline;
+
+	fclose( pFile );
+	return true;
+}
+
+void	ImageSequenceCapture::EncodeJob::Run()
+{
+	bool	bSucceeded = m_Format == PNG ? WritePNG( m_pFileName, m_Width, m_Height, m_pPixels, m_Normalization, m_bSRGB ) : WriteEXR( m_pFileName, m_Width, m_Height, m_pPixels, m_Normalization );
+	ASSERT( bSucceeded, "Failed to write a captured image! Does the folder exist?" );
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Decodes the rows of a mapped staging texture and adds them to the sum of the sub-frames
+class	AccumulateKernel : public IParallelForKernel
+{
+public:
+	const IPixelFormatDescriptor&	m_Format;
+	const U8*						m_pSource;
+	U32								m_RowPitch;
+	int								m_Width;
+	bool							m_bSRGB;
+	float4*							m_pTarget;
+
+	AccumulateKernel( const IPixelFormatDescriptor& _Format, const D3D11_MAPPED_SUBRESOURCE& _Mapped, int _Width, bool _bSRGB, float4* _pTarget )
+		: m_Format( _Format ), m_pSource( (const U8*) _Mapped.pData ), m_RowPitch( _Mapped.RowPitch ), m_Width( _Width ), m_bSRGB( _bSRGB ), m_pTarget( _pTarget )	{}
+
+	virtual void	Run( int _Start, int _End )
+	{
+		int	PixelSize = m_Format.Size();
+		for ( int Y=_Start; Y < _End; Y++ )
+		{
+			const U8*	pSource = m_pSource + Y * m_RowPitch;
+			float4*		pTarget = m_pTarget + Y * m_Width;
+			for ( int X=0; X < m_Width; X++, pSource+=PixelSize, pTarget++ )
+			{
+				float4	Color = m_Format.Read( pSource );
+				if ( m_bSRGB )
+					Color.Set( sRGB2Linear( Color.x ), sRGB2Linear( Color.y ), sRGB2Linear( Color.z ), Color.w );
+				*pTarget = *pTarget + Color;
+			}
+		}
+	}
+};
+
+//////////////////////////////////////////////////////////////////////////
+// Capture
+ImageSequenceCapture::ImageSequenceCapture( Device& _Device, const char* _pFileNamePrefix, int _FramesPerSecond, int _FramesCount, FORMAT _Format, int _SubFramesCount )
+	: m_Device( _Device )
+	, m_Format( _Format )
+	, m_FramesPerSecond( _FramesPerSecond )
+	, m_FramesCount( _FramesCount )
+	, m_SubFramesCount( MAX( 1, _SubFramesCount ) )
+	, m_SubFrameIndex( 0 )
+	, m_NextSlotIndex( 0 )
+	, m_PendingCount( 0 )
+	, m_Width( 0 )
+	, m_Height( 0 )
+	, m_NextJobIndex( 0 )
+	, m_pCurrentJob( NULL )
+{
+	ASSERT( _FramesPerSecond > 0 && _FramesCount > 0, "Invalid capture!" );
+	strcpy_s( m_pFileNamePrefix, MAX_PATH, _pFileNamePrefix );
+	memset( m_pSlots, 0, STAGING_RING_SIZE*sizeof(StagingSlot) );
+
+	InitCRCTable();
+}
+
+ImageSequenceCapture::~ImageSequenceCapture()
+{
+	Finish();
+}
+
+U32		ImageSequenceCapture::GetSamplePosition() const
+{
+	return U32( U64(m_SubFrameIndex) * SAMPLE_RATE / (m_FramesPerSecond * m_SubFramesCount) );
+}
+
+void	ImageSequenceCapture::Grab( const Texture2D& _Source )
+{
+	if ( IsComplete() )
+		return;
+
+	if ( m_pSlots[0].pStaging == NULL )
+	{	// Create the ring on the first grab
+		m_Width = _Source.GetWidth();
+		m_Height = _Source.GetHeight();
+		const IPixelFormatDescriptor&	Format = (const IPixelFormatDescriptor&) _Source.GetFormatDescriptor();
+		for ( int SlotIndex=0; SlotIndex < STAGING_RING_SIZE; SlotIndex++ )
+			m_pSlots[SlotIndex].pStaging = new Texture2D( m_Device, m_Width, m_Height, 1, Format, 1, NULL, true );
+	}
+	ASSERT( _Source.GetWidth() == m_Width && _Source.GetHeight() == m_Height, "The captured texture changed size!" );
+
+	// The oldest copy must be mapped before its staging texture gets reused
+	if ( m_PendingCount == STAGING_RING_SIZE )
+	{
+		m_Device.WaitForFrame( m_pSlots[m_NextSlotIndex].FrameIndex, "ImageSequenceCapture::Grab" );
+		ResolveOldest();
+	}
+
+	StagingSlot&	Slot = m_pSlots[(m_NextSlotIndex + m_PendingCount) % STAGING_RING_SIZE];
+	Slot.pStaging->CopyRegionFrom( _Source, 0, 0, 0, m_Width, m_Height, 0, 0 );	// Only the first mip
+	Slot.FrameIndex = m_Device.GetFrameIndex();
+	Slot.SubFrameIndex = m_SubFrameIndex;
+	m_PendingCount++;
+}
+
+bool	ImageSequenceCapture::Update()
+{
+	if ( IsComplete() )
+		return false;
+
+	m_SubFrameIndex++;
+
+	// Map the copies of the frames the GPU completed, in order
+	while ( m_PendingCount > 0 && m_Device.IsFrameCompleted( m_pSlots[m_NextSlotIndex].FrameIndex ) )
+		ResolveOldest();
+
+	return !IsComplete();
+}
+
+void	ImageSequenceCapture::Finish()
+{
+	while ( m_PendingCount > 0 )
+	{
+		m_Device.WaitForFrame( m_pSlots[m_NextSlotIndex].FrameIndex, "ImageSequenceCapture::Finish" );
+		ResolveOldest();
+	}
+	if ( m_pCurrentJob != NULL )
+		SubmitJob();	// Last image of an interrupted capture, averaged over the sub-frames it got
+
+	for ( int JobIndex=0; JobIndex < ENCODE_JOBS_COUNT; JobIndex++ )
+		gs_Jobs.Wait( m_pJobs[JobIndex].m_Counter );
+
+	for ( int SlotIndex=0; SlotIndex < STAGING_RING_SIZE; SlotIndex++ )
+	{
+		delete m_pSlots[SlotIndex].pStaging;
+		m_pSlots[SlotIndex].pStaging = NULL;
+	}
+}
+
+void	ImageSequenceCapture::ResolveOldest()
+{
+	StagingSlot&	Slot = m_pSlots[m_NextSlotIndex];
+	m_NextSlotIndex = (m_NextSlotIndex + 1) % STAGING_RING_SIZE;
+	m_PendingCount--;
+
+	const IPixelFormatDescriptor&	Format = (const IPixelFormatDescriptor&) Slot.pStaging->GetFormatDescriptor();
+	bool		bSRGB = IsSRGB( Format.DirectXFormat() );
+	EncodeJob&	Job = AcquireJob( Slot.SubFrameIndex / m_SubFramesCount, bSRGB );
+
+	// Decode & accumulate on all the threads, the GPU completed the copy so the map doesn't stall
+	D3D11_MAPPED_SUBRESOURCE&	Mapped = Slot.pStaging->Map( 0, 0 );
+	AccumulateKernel	Kernel( Format, Mapped, m_Width, bSRGB, Job.m_pPixels );
+	gs_Jobs.ParallelFor( m_Height, 16, Kernel );
+	Slot.pStaging->UnMap( 0, 0 );
+
+	if ( (Slot.SubFrameIndex % m_SubFramesCount) == m_SubFramesCount-1 )
+		SubmitJob();	// Got all the sub-frames of the image
+}
+
+ImageSequenceCapture::EncodeJob&	ImageSequenceCapture::AcquireJob( int _ImageIndex, bool _bSRGB )
+{
+	if ( m_pCurrentJob != NULL )
+		return *m_pCurrentJob;	// The sub-frames are resolved in order so it's the same image
+
+	EncodeJob&	Job = m_pJobs[m_NextJobIndex];
+	m_NextJobIndex = (m_NextJobIndex + 1) % ENCODE_JOBS_COUNT;
+	gs_Jobs.Wait( Job.m_Counter );	// Still encoding an older image...
+
+	if ( Job.m_pPixels == NULL )
+		Job.m_pPixels = new float4[m_Width*m_Height];
+	memset( Job.m_pPixels, 0, m_Width*m_Height*sizeof(float4) );
+
+	Job.m_Format = m_Format;
+	Job.m_Width = m_Width;
+	Job.m_Height = m_Height;
+	Job.m_Normalization = 1.0f / m_SubFramesCount;
+	Job.m_bSRGB = _bSRGB;
+	sprintf_s( Job.m_pFileName, MAX_PATH, "%s%05d.%s", m_pFileNamePrefix, _ImageIndex, m_Format == PNG ? "png" : "exr" );
+
+	m_pCurrentJob = &Job;
+	return Job;
+}
+
+void	ImageSequenceCapture::SubmitJob()
+{
+	if ( m_pCurrentJob != NULL )
+		gs_Jobs.Run( *m_pCurrentJob, m_pCurrentJob->m_Counter );
+	m_pCurrentJob = NULL;
+}
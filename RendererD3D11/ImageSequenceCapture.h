@@ -0,0 +1,128 @@
+//////////////////////////////////////////////////////////////////////////
+// Image Sequence Capture
+// Renders the intro offline into numbered image files, for reproducible quality comparisons and video export:
+//	_ Time advances by a fixed virtual step per frame whatever the rendering takes. The frame times are derived from the frame
+//		index through the audio sample position (cf. GetSamplePosition()) so they never drift from the music.
+//	_ Each grabbed frame is copied into a ring of staging textures. It's only mapped once the device reports the GPU completed
+//		its frame, so the capture never stalls the pipeline unless the whole ring is in flight.
+//	_ The pixels are encoded into uncompressed PNG (8 bits RGB) or EXR (half RGB) files by jobs on the workers.
+//	_ With supersampling, every output image averages several sub-frames rendered at evenly spaced times within the frame
+//		(i.e. a shutter that's open the whole frame).
+//
+// Usage:
+//	ImageSequenceCapture	Capture( gs_Device, "./Capture/Frame", 60, 3600 );	// 1 minute at 60 fps into ./Capture/Frame00000.png, etc.
+//	while ( !Capture.IsComplete() )
+//	{
+//		Render( Capture.GetTime(), Capture.GetDeltaTime() );
+//		Capture.Grab( SourceTexture );					// Before presenting, the back buffer is discarded by Present()
+//		gs_Device.Present();
+//		Capture.Update();
+//	}
+//	Capture.Finish();									// Writes the frames still in flight
+//
+// NOTE: The folder of the files must exist. PNG expects a tone-mapped source (e.g. the back buffer) while EXR expects
+//	a linear HDR source, any format IPixelFormatDescriptor::Read() can decode is supported.
+//
+#pragma once
+
+#include "Device.h"
+#include "../Utility/Jobs.h"
+
+class ImageSequenceCapture
+{
+public:		// CONSTANTS
+
+	static const int	STAGING_RING_SIZE = 4;		// Frames in flight between the GPU copy and the mapping
+	static const int	ENCODE_JOBS_COUNT = 8;		// Images being encoded at once (each holds a frame of pixels)
+
+public:		// NESTED TYPES
+
+	enum FORMAT
+	{
+		PNG,
+		EXR,
+	};
+
+private:
+
+	class	EncodeJob : public IJob
+	{
+	public:
+		FORMAT		m_Format;
+		int			m_Width;
+		int			m_Height;
+		float4*		m_pPixels;		// Sum of the sub-frames
+		float		m_Normalization;
+		bool		m_bSRGB;		// The sum is linear but the PNG must be sRGB-encoded again
+		char		m_pFileName[MAX_PATH];
+		JobCounter	m_Counter;
+
+		EncodeJob() : m_pPixels( NULL )	{}
+		~EncodeJob()					{ delete[] m_pPixels; }
+
+		virtual void	Run();
+	};
+
+	struct	StagingSlot
+	{
+		Texture2D*	pStaging;
+		U32			FrameIndex;		// The device frame the copy belongs to
+		int			SubFrameIndex;
+	};
+
+private:	// FIELDS
+
+	Device&			m_Device;
+	char			m_pFileNamePrefix[MAX_PATH];
+	FORMAT			m_Format;
+	int				m_FramesPerSecond;
+	int				m_FramesCount;			// Images to capture
+	int				m_SubFramesCount;		// Sub-frames averaged into each image
+
+	int				m_SubFrameIndex;		// Sub-frames rendered since the start
+	int				m_NextSlotIndex;		// Oldest slot of the ring
+	int				m_PendingCount;
+	StagingSlot		m_pSlots[STAGING_RING_SIZE];
+
+	int				m_Width;
+	int				m_Height;
+	EncodeJob		m_pJobs[ENCODE_JOBS_COUNT];
+	int				m_NextJobIndex;
+	EncodeJob*		m_pCurrentJob;			// The job accumulating the sub-frames of the current image, NULL if none
+
+public:		// PROPERTIES
+
+	FORMAT		GetFormat() const			{ return m_Format; }
+	bool		IsComplete() const			{ return m_SubFrameIndex >= m_FramesCount * m_SubFramesCount; }
+	int			GetImageIndex() const		{ return m_SubFrameIndex / m_SubFramesCount; }
+
+	// Virtual clock of the current sub-frame
+	U32			GetSamplePosition() const;
+	float		GetTime() const				{ return float(GetSamplePosition()) / SAMPLE_RATE; }
+	float		GetDeltaTime() const		{ return 1.0f / (m_FramesPerSecond * m_SubFramesCount); }
+
+public:		// METHODS
+
+	// _pFileNamePrefix, the image index and the extension are appended to it
+	// _SubFramesCount, the amount of sub-frames averaged into each image (1 disables the supersampling)
+	ImageSequenceCapture( Device& _Device, const char* _pFileNamePrefix, int _FramesPerSecond, int _FramesCount, FORMAT _Format=PNG, int _SubFramesCount=1 );
+	~ImageSequenceCapture();
+
+	// Queues the copy of the current sub-frame, must be called once per frame before Device::Present()
+	void		Grab( const Texture2D& _Source );
+
+	// Advances to the next sub-frame after Device::Present() and maps the copies the GPU completed, returns false once all the frames were grabbed
+	bool		Update();
+
+	// Waits for the copies still in flight and for the encoding of all the images, then releases the staging textures
+	// NOTE: Must be called before the device exits
+	void		Finish();
+
+private:
+
+	static const U32	SAMPLE_RATE = 44100;	// !!IMPORTANT ==> Must correspond to SynthStream::SAMPLE_RATE!!
+
+	void		ResolveOldest();
+	EncodeJob&	AcquireJob( int _ImageIndex, bool _bSRGB );
+	void		SubmitJob();
+};
@@ -0,0 +1,28 @@
+#include "JobQueue.h"
+
+JobQueue::JobQueue()
+	: m_OwnerThreadID( GetCurrentThreadId() )
+{
+	ASSERT( gs_Jobs.IsInitialized(), "The job system must be initialized before creating job queues!" );
+}
+
+JobQueue::~JobQueue()
+{
+	Wait();
+}
+
+void	JobQueue::Push( IJob& _Job )
+{
+	ASSERT( IsOwner(), "Only the owner thread can push jobs!" );
+	gs_Jobs.Run( _Job, m_Pending );
+}
+
+void	JobQueue::Wait()
+{
+	gs_Jobs.Wait( m_Pending );
+}
+
+bool	JobQueue::Wait( DWORD _TimeOut )
+{
+	return gs_Jobs.Wait( m_Pending, _TimeOut );
+}
@@ -0,0 +1,58 @@
+//////////////////////////////////////////////////////////////////////////
+// Job Queue
+// A group of jobs pushed by a single "owner" thread and executed by the engine's job system (cf. Utility/Jobs.h)
+// The queue doesn't have any thread of its own: it's a counter of its pending jobs, so each subsystem can wait for its own
+//	jobs while all of them share the same workers.
+//
+// Usage:
+//	class MyJob : public IJob { public: virtual void Run() { (...) } };
+//	MyJob	A, B;
+//	gs_Device.Jobs().Push( A );
+//	gs_Device.Jobs().Push( B );
+//	(...)						// Do something else meanwhile
+//	gs_Device.Jobs().Wait();	// The calling thread helps executing the remaining jobs then waits for the others to complete
+//
+// NOTE: Push() and Wait() must always be called from the thread that created the queue (cf. IsOwner()).
+// If there are no workers (single core machine) or the calling thread's deque is full, jobs are simply executed by the calling thread.
+// Data-parallel kernels that may run from any job should rather use JobSystem::ParallelFor() that doesn't need an owner.
+//
+#pragma once
+
+#include "Renderer.h"
+#include "../Utility/Jobs.h"
+
+class JobQueue
+{
+public:		// CONSTANTS
+
+	static const int	MAX_WORKERS = JobSystem::MAX_WORKERS;
+	static const int	MAX_PENDING_JOBS = 256;
+
+private:	// FIELDS
+
+	DWORD				m_OwnerThreadID;	// The thread allowed to Push() and Wait()
+	JobCounter			m_Pending;			// Jobs that were pushed but are not finished yet
+
+public:		// PROPERTIES
+
+	int			GetWorkersCount() const	{ return gs_Jobs.GetWorkersCount(); }
+
+	// Returns the amount of workers the calling thread can push jobs to: 0 from any other thread than the owner
+	//	(e.g. a job of another queue), so data-parallel kernels simply run on that thread instead
+	int			GetHelpersCount() const	{ return IsOwner() ? gs_Jobs.GetHelpersCount() : 0; }
+
+	// Returns true if called from the thread that created the queue (i.e. jobs can be pushed from here)
+	bool		IsOwner() const			{ return GetCurrentThreadId() == m_OwnerThreadID; }
+
+public:		// METHODS
+
+	JobQueue();
+	~JobQueue();
+
+	void		Push( IJob& _Job );
+	void		Wait();
+
+	// Helps with the remaining jobs for at most _TimeOut milliseconds
+	// Returns true if all the jobs are done (useful to report progress while waiting)
+	bool		Wait( DWORD _TimeOut );
+};
@@ -0,0 +1,460 @@
+#include "RenderGraph.h"
+#include "Device.h"
+#include "RenderTargetPool.h"
+#include "GPUProfiler.h"
+#include "Components/Texture2D.h"
+#include "Components/StructuredBuffer.h"
+
+RenderGraph::RenderGraph( Device& _Device )
+	: m_Device( _Device )
+	, m_ResourcesCount( 0 )
+	, m_PassesCount( 0 )
+	, m_OrderCount( 0 )
+	, m_bInterleave( true )
+	, m_CulledPassesCount( 0 )
+	, m_MovedPassesCount( 0 )
+	, m_UnbindsCount( 0 )
+	, m_bExecuting( false )
+{
+}
+
+RenderGraph::~RenderGraph()
+{
+	ASSERT( !m_bExecuting, "Render graph destroyed while executing!" );
+}
+
+Texture2D&	RenderGraph::GetTexture( Resource _Resource ) const
+{
+	ASSERT( _Resource >= 0 && _Resource < m_ResourcesCount, "Invalid resource!" );
+	const ResourceInfos&	R = m_pResources[_Resource];
+	ASSERT( R.pTexture != NULL, "Resource is not a texture or the transient texture is not available outside of the passes using it!" );
+	return *R.pTexture;
+}
+
+StructuredBuffer&	RenderGraph::GetBuffer( Resource _Resource ) const
+{
+	ASSERT( _Resource >= 0 && _Resource < m_ResourcesCount, "Invalid resource!" );
+	const ResourceInfos&	R = m_pResources[_Resource];
+	ASSERT( R.pBuffer != NULL, "Resource is not a buffer!" );
+	return *R.pBuffer;
+}
+
+RenderGraph::Resource	RenderGraph::Import( const char* _pName, Texture2D& _Texture, bool _bOutput )
+{
+	ASSERT( !m_bExecuting, "Resources can't be declared while the graph executes!" );
+	ASSERT( m_ResourcesCount < MAX_RESOURCES, "Too many render graph resources!" );
+	ResourceInfos&	R = m_pResources[m_ResourcesCount];
+	memset( &R, 0, sizeof(ResourceInfos) );
+	R.pName = _pName;
+	R.pTexture = &_Texture;
+	R.bOutput = _bOutput;
+
+	return m_ResourcesCount++;
+}
+
+RenderGraph::Resource	RenderGraph::Import( const char* _pName, StructuredBuffer& _Buffer, bool _bOutput )
+{
+	ASSERT( !m_bExecuting, "Resources can't be declared while the graph executes!" );
+	ASSERT( m_ResourcesCount < MAX_RESOURCES, "Too many render graph resources!" );
+	ResourceInfos&	R = m_pResources[m_ResourcesCount];
+	memset( &R, 0, sizeof(ResourceInfos) );
+	R.pName = _pName;
+	R.pBuffer = &_Buffer;
+	R.bOutput = _bOutput;
+
+	return m_ResourcesCount++;
+}
+
+RenderGraph::Resource	RenderGraph::CreateTexture( const char* _pName, int _Width, int _Height, int _ArraySize, const IPixelFormatDescriptor& _Format, int _MipLevelsCount, bool _bUnOrderedAccess )
+{
+	ASSERT( !m_bExecuting, "Resources can't be declared while the graph executes!" );
+	ASSERT( m_ResourcesCount < MAX_RESOURCES, "Too many render graph resources!" );
+	ResourceInfos&	R = m_pResources[m_ResourcesCount];
+	memset( &R, 0, sizeof(ResourceInfos) );
+	R.pName = _pName;
+	R.bTransient = true;
+	R.Width = _Width;
+	R.Height = _Height;
+	R.ArraySize = _ArraySize;
+	R.MipLevelsCount = _MipLevelsCount;
+	R.pFormat = &_Format;
+	R.bUnOrderedAccess = _bUnOrderedAccess;
+
+	return m_ResourcesCount++;
+}
+
+int		RenderGraph::AddPass( const char* _pName, IRenderPass& _Renderer, U32 _PassID, bool _bHasSideEffects )
+{
+	ASSERT( !m_bExecuting, "Passes can't be declared while the graph executes!" );
+	ASSERT( m_PassesCount < MAX_PASSES, "Too many render graph passes!" );
+	PassInfos&	P = m_pPasses[m_PassesCount];
+	P.pName = _pName;
+	P.pRenderer = &_Renderer;
+	P.PassID = _PassID;
+	P.bHasSideEffects = _bHasSideEffects;
+	P.Hint = HINT_NONE;
+	P.bCulled = false;
+	P.AccessesCount = 0;
+
+	return m_PassesCount++;
+}
+
+void	RenderGraph::AddAccess( int _PassIndex, Resource _Resource, ACCESS _Type )
+{
+	ASSERT( _PassIndex >= 0 && _PassIndex < m_PassesCount, "Invalid pass!" );
+	ASSERT( _Resource >= 0 && _Resource < m_ResourcesCount, "Invalid resource!" );
+	PassInfos&	P = m_pPasses[_PassIndex];
+	for ( int AccessIndex=0; AccessIndex < P.AccessesCount; AccessIndex++ )
+		ASSERT( P.pAccesses[AccessIndex].ResourceIndex != _Resource, "A pass can only access a resource once! (use ReadWrite() for UAVs)" );
+	ASSERT( P.AccessesCount < MAX_ACCESSES_PER_PASS, "Too many accesses for a single pass!" );
+
+	Access&	A = P.pAccesses[P.AccessesCount++];
+	A.ResourceIndex = _Resource;
+	A.Type = _Type;
+}
+
+void	RenderGraph::SetHint( int _PassIndex, PASS_HINT _Hint )
+{
+	ASSERT( _PassIndex >= 0 && _PassIndex < m_PassesCount, "Invalid pass!" );
+	m_pPasses[_PassIndex].Hint = _Hint;
+}
+
+void	RenderGraph::Execute()
+{
+	ASSERT( !m_bExecuting, "Render graph is already executing!" );
+	m_bExecuting = true;
+	m_UnbindsCount = 0;
+
+	Compile();
+
+	for ( int Position=0; Position < m_OrderCount; Position++ )
+	{
+		PassInfos&	P = m_pPasses[m_pOrder[Position]];
+		GPU_PROFILE_SCOPE( m_Device, P.pName );
+
+		// Acquire the transient textures first used by this pass
+		for ( int AccessIndex=0; AccessIndex < P.AccessesCount; AccessIndex++ )
+		{
+			ResourceInfos&	R = m_pResources[P.pAccesses[AccessIndex].ResourceIndex];
+			if ( R.bTransient && R.FirstPosition == Position )
+			{
+				R.pTexture = &m_Device.RenderTargets().Acquire( R.Width, R.Height, R.ArraySize, *R.pFormat, R.MipLevelsCount, R.bUnOrderedAccess );
+				R.Binding = BINDING_NONE;
+			}
+		}
+
+		ResolveHazards( P );
+
+		P.pRenderer->ExecutePass( *this, P.PassID );
+
+		// Release the transient textures last used by this pass
+		for ( int AccessIndex=0; AccessIndex < P.AccessesCount; AccessIndex++ )
+		{
+			ResourceInfos&	R = m_pResources[P.pAccesses[AccessIndex].ResourceIndex];
+			if ( !R.bTransient || R.LastPosition != Position )
+				continue;
+
+			if ( R.Binding == BINDING_SRV || R.Binding == BINDING_UAV )
+				Unbind( R );	// The next owner of the pooled target must not find it still bound
+			m_Device.RenderTargets().Release( *R.pTexture );
+			R.pTexture = NULL;
+			R.Binding = BINDING_NONE;
+		}
+	}
+
+	m_bExecuting = false;
+	Clear();
+}
+
+// Walks the passes backward from the outputs: a pass is kept if it has side effects or if it writes a resource that's needed,
+//	the resources it reads then become needed by the passes before it
+void	RenderGraph::Compile()
+{
+	for ( int ResourceIndex=0; ResourceIndex < m_ResourcesCount; ResourceIndex++ )
+	{
+		ResourceInfos&	R = m_pResources[ResourceIndex];
+		R.bNeeded = R.bOutput;
+		R.FirstPosition = -1;
+		R.LastPosition = -1;
+		R.Binding = R.bTransient ? BINDING_NONE : BINDING_UNKNOWN;
+	}
+
+	m_CulledPassesCount = 0;
+	for ( int PassIndex=m_PassesCount-1; PassIndex >= 0; PassIndex-- )
+	{
+		PassInfos&	P = m_pPasses[PassIndex];
+		P.bCulled = !P.bHasSideEffects;
+		for ( int AccessIndex=0; AccessIndex < P.AccessesCount && P.bCulled; AccessIndex++ )
+		{
+			const Access&	A = P.pAccesses[AccessIndex];
+			if ( A.Type != ACCESS_READ && m_pResources[A.ResourceIndex].bNeeded )
+				P.bCulled = false;
+		}
+		if ( P.bCulled )
+		{
+			m_CulledPassesCount++;
+			continue;
+		}
+
+		// Writes don't clear the needed flag: a pass may only write part of a target (or blend into it) so the previous writers are kept
+		for ( int AccessIndex=0; AccessIndex < P.AccessesCount; AccessIndex++ )
+		{
+			const Access&	A = P.pAccesses[AccessIndex];
+			if ( A.Type != ACCESS_WRITE )
+				m_pResources[A.ResourceIndex].bNeeded = true;
+		}
+	}
+
+	Schedule();
+
+	// Find the lifetime of each resource among the remaining passes
+	for ( int Position=0; Position < m_OrderCount; Position++ )
+	{
+		const PassInfos&	P = m_pPasses[m_pOrder[Position]];
+		for ( int AccessIndex=0; AccessIndex < P.AccessesCount; AccessIndex++ )
+		{
+			ResourceInfos&	R = m_pResources[P.pAccesses[AccessIndex].ResourceIndex];
+			if ( R.FirstPosition == -1 )
+				R.FirstPosition = Position;
+			R.LastPosition = Position;
+		}
+	}
+
+#ifdef _DEBUG
+	for ( int ResourceIndex=0; ResourceIndex < m_ResourcesCount; ResourceIndex++ )
+	{
+		const ResourceInfos&	R = m_pResources[ResourceIndex];
+		if ( R.bTransient && R.FirstPosition != -1 )
+		{
+			const PassInfos&	FirstPass = m_pPasses[m_pOrder[R.FirstPosition]];
+			for ( int AccessIndex=0; AccessIndex < FirstPass.AccessesCount; AccessIndex++ )
+				if ( FirstPass.pAccesses[AccessIndex].ResourceIndex == ResourceIndex )
+					ASSERT( FirstPass.pAccesses[AccessIndex].Type != ACCESS_READ, "A transient texture is read before being written!" );
+		}
+	}
+#endif
+}
+
+// Orders the passes that are kept: the graphics passes in the order they were added, with the async compute passes in between
+// Each compute pass first gets the range of slots its dependencies on the graphics passes allow, then its maximum is narrowed to
+//	the maximums of the compute passes depending on it so whatever slot it picks, they still have a valid slot after it.
+void	RenderGraph::Schedule()
+{
+	int	pGraphics[MAX_PASSES];
+	int	GraphicsCount = 0;
+	for ( int PassIndex=0; PassIndex < m_PassesCount; PassIndex++ )
+	{
+		PassInfos&	P = m_pPasses[PassIndex];
+		if ( P.bCulled )
+			continue;
+
+		if ( P.Hint != HINT_ASYNC_COMPUTE )
+		{
+			pGraphics[GraphicsCount++] = PassIndex;
+			continue;
+		}
+
+		P.DeclaredSlot = P.Slot = GraphicsCount;
+		P.MinSlot = 0;
+		P.MaxSlot = -1;		// Computed below, once all the graphics passes are known
+	}
+
+	m_MovedPassesCount = 0;
+	if ( m_bInterleave )
+	{
+		// Ranges allowed by the graphics passes
+		for ( int PassIndex=0; PassIndex < m_PassesCount; PassIndex++ )
+		{
+			PassInfos&	P = m_pPasses[PassIndex];
+			if ( P.bCulled || P.Hint != HINT_ASYNC_COMPUTE )
+				continue;
+
+			P.MaxSlot = GraphicsCount;
+			for ( int GraphicsIndex=0; GraphicsIndex < GraphicsCount; GraphicsIndex++ )
+			{
+				if ( !Conflicts( P, m_pPasses[pGraphics[GraphicsIndex]] ) )
+					continue;
+
+				if ( pGraphics[GraphicsIndex] < PassIndex )
+					P.MinSlot = MAX( P.MinSlot, GraphicsIndex+1 );
+				else
+					P.MaxSlot = MIN( P.MaxSlot, GraphicsIndex );
+			}
+		}
+
+		// A compute pass can't go past the compute passes depending on it (walked backward so the limits chain up)
+		for ( int PassIndex=m_PassesCount-1; PassIndex >= 0; PassIndex-- )
+		{
+			PassInfos&	P = m_pPasses[PassIndex];
+			if ( P.bCulled || P.Hint != HINT_ASYNC_COMPUTE )
+				continue;
+
+			for ( int NextIndex=PassIndex+1; NextIndex < m_PassesCount; NextIndex++ )
+			{
+				const PassInfos&	Next = m_pPasses[NextIndex];
+				if ( !Next.bCulled && Next.Hint == HINT_ASYNC_COMPUTE && Conflicts( P, Next ) )
+					P.MaxSlot = MIN( P.MaxSlot, Next.MaxSlot );
+			}
+		}
+
+		// Pick the best slot of each range, after the slots picked by the compute passes it depends on
+		int	pSlotPassesCount[MAX_PASSES+1];
+		memset( pSlotPassesCount, 0, (GraphicsCount+1)*sizeof(int) );
+		for ( int PassIndex=0; PassIndex < m_PassesCount; PassIndex++ )
+		{
+			PassInfos&	P = m_pPasses[PassIndex];
+			if ( P.bCulled || P.Hint != HINT_ASYNC_COMPUTE )
+				continue;
+
+			int	MinSlot = P.MinSlot;
+			for ( int PreviousIndex=0; PreviousIndex < PassIndex; PreviousIndex++ )
+			{
+				const PassInfos&	Previous = m_pPasses[PreviousIndex];
+				if ( !Previous.bCulled && Previous.Hint == HINT_ASYNC_COMPUTE && Conflicts( P, Previous ) )
+					MinSlot = MAX( MinSlot, Previous.Slot );
+			}
+			ASSERT( MinSlot <= P.MaxSlot, "Invalid compute pass range!" );
+
+			// Slots where nothing can be gained are left alone, equal scores go to the slot hosting the fewest compute passes
+			P.Slot = CLAMP( P.DeclaredSlot, MinSlot, P.MaxSlot );
+			int	BestScore = 0;
+			for ( int Slot=MinSlot; Slot <= P.MaxSlot; Slot++ )
+			{
+				int	Score = GetSlotScore( Slot, pGraphics, GraphicsCount );
+				if ( Score > BestScore || (Score == BestScore && Score > 0 && pSlotPassesCount[Slot] < pSlotPassesCount[P.Slot]) )
+				{
+					BestScore = Score;
+					P.Slot = Slot;
+				}
+			}
+
+			pSlotPassesCount[P.Slot]++;
+			if ( P.Slot != P.DeclaredSlot )
+				m_MovedPassesCount++;
+		}
+	}
+
+	// Build the execution order, the compute passes sharing a slot keep the order they were added in
+	m_OrderCount = 0;
+	for ( int Slot=0; Slot <= GraphicsCount; Slot++ )
+	{
+		for ( int PassIndex=0; PassIndex < m_PassesCount; PassIndex++ )
+		{
+			const PassInfos&	P = m_pPasses[PassIndex];
+			if ( !P.bCulled && P.Hint == HINT_ASYNC_COMPUTE && P.Slot == Slot )
+				m_pOrder[m_OrderCount++] = PassIndex;
+		}
+		if ( Slot < GraphicsCount )
+			m_pOrder[m_OrderCount++] = pGraphics[Slot];
+	}
+}
+
+bool	RenderGraph::Conflicts( const PassInfos& _Pass0, const PassInfos& _Pass1 )
+{
+	for ( int AccessIndex0=0; AccessIndex0 < _Pass0.AccessesCount; AccessIndex0++ )
+	{
+		const Access&	A0 = _Pass0.pAccesses[AccessIndex0];
+		for ( int AccessIndex1=0; AccessIndex1 < _Pass1.AccessesCount; AccessIndex1++ )
+		{
+			const Access&	A1 = _Pass1.pAccesses[AccessIndex1];
+			if ( A0.ResourceIndex == A1.ResourceIndex && (A0.Type != ACCESS_READ || A1.Type != ACCESS_READ) )
+				return true;
+		}
+	}
+
+	return false;
+}
+
+// A slot right after a bandwidth-bound pass is worth 2, right before an ALU-bound pass is worth 1
+int		RenderGraph::GetSlotScore( int _Slot, const int* _pGraphics, int _GraphicsCount ) const
+{
+	int	Score = 0;
+	if ( _Slot > 0 && m_pPasses[_pGraphics[_Slot-1]].Hint == HINT_BANDWIDTH )
+		Score += 2;
+	if ( _Slot < _GraphicsCount && m_pPasses[_pGraphics[_Slot]].Hint == HINT_ALU )
+		Score += 1;
+
+	return Score;
+}
+
+// Only unbinds the resources this pass uses differently from the way they're currently bound
+// Imported resources start the graph in an unknown state: writing them unbinds their shader resource views in case the caller
+//	left them bound (that's free if they were never bound), while they're expected not to be left bound as targets or UAVs
+void	RenderGraph::ResolveHazards( const PassInfos& _Pass )
+{
+	bool	bSetsTargets = false;
+	for ( int AccessIndex=0; AccessIndex < _Pass.AccessesCount; AccessIndex++ )
+	{
+		const Access&	A = _Pass.pAccesses[AccessIndex];
+		ResourceInfos&	R = m_pResources[A.ResourceIndex];
+		switch ( A.Type )
+		{
+		case ACCESS_READ:
+			if ( R.Binding == BINDING_TARGET || R.Binding == BINDING_UAV )
+				Unbind( R );
+			break;
+
+		case ACCESS_WRITE:
+			ASSERT( R.pTexture != NULL, "Only textures can be written as render targets!" );
+			if ( R.Binding == BINDING_SRV || R.Binding == BINDING_UAV || R.Binding == BINDING_UNKNOWN )
+				Unbind( R );
+			bSetsTargets = true;
+			break;
+
+		case ACCESS_READ_WRITE:
+			if ( R.Binding == BINDING_SRV || R.Binding == BINDING_TARGET || R.Binding == BINDING_UNKNOWN )
+				Unbind( R );
+			break;
+		}
+	}
+
+	// Setting the render targets of this pass replaces the previous ones without any explicit unbind
+	if ( bSetsTargets )
+		for ( int ResourceIndex=0; ResourceIndex < m_ResourcesCount; ResourceIndex++ )
+			if ( m_pResources[ResourceIndex].Binding == BINDING_TARGET )
+				m_pResources[ResourceIndex].Binding = BINDING_NONE;
+
+	// Record how the pass binds its resources
+	for ( int AccessIndex=0; AccessIndex < _Pass.AccessesCount; AccessIndex++ )
+	{
+		const Access&	A = _Pass.pAccesses[AccessIndex];
+		m_pResources[A.ResourceIndex].Binding = A.Type == ACCESS_READ ? BINDING_SRV : (A.Type == ACCESS_WRITE ? BINDING_TARGET : BINDING_UAV);
+	}
+}
+
+void	RenderGraph::Unbind( ResourceInfos& _Resource )
+{
+	if ( _Resource.Binding != BINDING_UNKNOWN )
+		m_UnbindsCount++;
+	switch ( _Resource.Binding )
+	{
+	case BINDING_TARGET:
+		// D3D11 can't unbind a single target, all the targets get unbound at once
+		m_Device.RemoveRenderTargets();
+		for ( int ResourceIndex=0; ResourceIndex < m_ResourcesCount; ResourceIndex++ )
+			if ( m_pResources[ResourceIndex].Binding == BINDING_TARGET )
+				m_pResources[ResourceIndex].Binding = BINDING_NONE;
+		break;
+
+	case BINDING_UAV:
+		if ( _Resource.pTexture != NULL )
+			_Resource.pTexture->RemoveFromLastAssignedSlotUAV();
+		else
+			_Resource.pBuffer->RemoveFromLastAssignedSlotUAV();
+		break;
+
+	default:
+		if ( _Resource.pTexture != NULL )
+			_Resource.pTexture->RemoveFromLastAssignedSlots();
+		else
+			_Resource.pBuffer->RemoveFromLastAssignedSlots();
+		break;
+	}
+	_Resource.Binding = BINDING_NONE;
+}
+
+void	RenderGraph::Clear()
+{
+	m_ResourcesCount = 0;
+	m_PassesCount = 0;
+}
@@ -0,0 +1,219 @@
+//////////////////////////////////////////////////////////////////////////
+// Render Graph
+// Describes a frame as a list of passes declaring the resources they read and write, so the graph rather than each effect
+//	takes care of the bindings between passes:
+//	_ Passes whose outputs are never read by a pass that is kept are culled (e.g. a debug pass writing a target nobody displays)
+//	_ A resource is only unbound when a pass is about to use it in another way than the pass before it did (e.g. a target
+//		that was rendered to and is now read, or a texture that was read and is now written), all the other bindings are left alone
+//	_ Transient textures are acquired from the render target pool right before the first pass using them and released right
+//		after the last one, so the next transient of the same description reuses the same target within the frame
+//
+// Passes are executed in the order they were added, which is always a valid order since a pass can only read what the passes
+//	added before it wrote. Resources that must stay valid after the graph executed (e.g. the back buffer or a history) are imported
+//	as outputs, and passes that have an effect the graph can't see (e.g. reading back to the CPU) are added with _bHasSideEffects.
+//
+// Interleaving
+// D3D11 has a single queue but the GPU still overlaps consecutive work that doesn't depend on each other, so independent compute
+//	passes (HINT_ASYNC_COMPUTE) are moved between the graphics passes where they have the best chance to fill the bubbles:
+//	right after a bandwidth-bound pass (HINT_BANDWIDTH) and preferably before an ALU-bound one (HINT_ALU).
+//	_ A compute pass can move anywhere between the last pass it depends on and the first pass depending on it, i.e. the closest
+//		passes sharing one of its resources with at least one of them writing it (graphics passes never move)
+//	_ A compute pass stays where it was added when no slot of its range follows a bandwidth-bound pass or precedes an ALU-bound one
+//	_ Each pass is measured by its own GPU profiler scope (named after the pass) so the gain can be checked with SetInterleaving()
+//	These hints and dependencies are what a D3D12 backend needs to submit the compute passes to an actual async queue.
+//
+// Usage:
+//	class MyEffect : public IRenderPass { virtual void ExecutePass( RenderGraph& _Graph, U32 _PassID ) { (...) } };
+//
+//	RenderGraph::Resource	Target = Graph.Import( "Target", m_RTTarget );
+//	RenderGraph::Resource	Temp = Graph.CreateTexture( "Temp", W, H, 1, PixelFormatRGBA16F::DESCRIPTOR );
+//	RenderGraph::Resource	BackBuffer = Graph.Import( "BackBuffer", m_Device.DefaultRenderTarget(), true );
+//	int	Pass = Graph.AddPass( "Blur", *this, PASS_BLUR );
+//	Graph.Read( Pass, Target );
+//	Graph.Write( Pass, Temp );
+//	Graph.SetHint( Pass, RenderGraph::HINT_BANDWIDTH );
+//	(...)
+//	Graph.Execute();	// Calls ExecutePass() for each pass that is kept, Graph.GetTexture( Temp ) is valid during the passes
+//
+// NOTE: The graph is cleared after each Execute() and must be declared again every frame (declaring is just filling a few arrays).
+// Passes still bind their resources themselves, the graph only removes the bindings that would conflict.
+// An async compute pass must not change the render targets since it may run between 2 graphics passes sharing them, and a graphics
+//	pass relying on targets set by the pass before it must declare them (so compute passes using them can't get in between).
+//
+#pragma once
+
+#include "Renderer.h"
+
+class Device;
+class Texture2D;
+class StructuredBuffer;
+class IPixelFormatDescriptor;
+class RenderGraph;
+
+// Interface implemented by whoever renders the passes of a graph (usually the effect declaring them)
+class	IRenderPass
+{
+public:
+	// Renders a pass
+	//	_Graph, the graph executing the pass (to retrieve its transient textures)
+	//	_PassID, the ID given to RenderGraph::AddPass()
+	virtual void	ExecutePass( RenderGraph& _Graph, U32 _PassID ) = 0;
+};
+
+class	RenderGraph
+{
+public:		// CONSTANTS
+
+	static const int	MAX_PASSES = 64;
+	static const int	MAX_RESOURCES = 64;
+	static const int	MAX_ACCESSES_PER_PASS = 16;
+
+public:		// NESTED TYPES
+
+	typedef int	Resource;	// Index of a resource in the graph
+	static const Resource	INVALID_RESOURCE = -1;
+
+	enum	ACCESS
+	{
+		ACCESS_READ = 0,		// Read through a shader resource view
+		ACCESS_WRITE = 1,		// Rendered to as a render target or a depth stencil
+		ACCESS_READ_WRITE = 2,	// Read & written through an unordered access view
+	};
+
+	// What limits a pass, telling the graph where it's worth interleaving independent compute work (cf. SetHint())
+	enum	PASS_HINT
+	{
+		HINT_NONE = 0,
+		HINT_BANDWIDTH,			// Graphics pass limited by memory (e.g. full screen resolves, shadow maps, depth only passes)
+		HINT_ALU,				// Graphics pass limited by shading (e.g. the lit scene)
+		HINT_ASYNC_COMPUTE,		// Compute pass the graph may move between the graphics passes
+	};
+
+private:
+
+	enum	BINDING
+	{
+		BINDING_NONE = 0,
+		BINDING_UNKNOWN,		// Imported resources may have been left bound as shader resources before the graph executes
+		BINDING_SRV,
+		BINDING_TARGET,
+		BINDING_UAV,
+	};
+
+	struct	ResourceInfos
+	{
+		const char*						pName;
+		Texture2D*						pTexture;
+		StructuredBuffer*				pBuffer;
+		bool							bOutput;		// Must be kept valid after the graph executed
+
+		// Transient textures description (pTexture is NULL until acquired)
+		bool							bTransient;
+		int								Width;
+		int								Height;
+		int								ArraySize;
+		int								MipLevelsCount;
+		const IPixelFormatDescriptor*	pFormat;
+		bool							bUnOrderedAccess;
+
+		// Set up by Compile()
+		bool							bNeeded;
+		int								FirstPosition;	// Positions of the first & last passes using the resource in the execution order
+		int								LastPosition;
+
+		// Set up by Execute()
+		BINDING							Binding;
+	};
+
+	struct	Access
+	{
+		Resource	ResourceIndex;
+		ACCESS		Type;
+	};
+
+	struct	PassInfos
+	{
+		const char*		pName;
+		IRenderPass*	pRenderer;
+		U32				PassID;
+		bool			bHasSideEffects;
+		PASS_HINT		Hint;
+		bool			bCulled;
+
+		// Set up by Compile() for async compute passes, slot N is right before the Nth graphics pass
+		int				DeclaredSlot;
+		int				MinSlot;
+		int				MaxSlot;
+		int				Slot;
+
+		int				AccessesCount;
+		Access			pAccesses[MAX_ACCESSES_PER_PASS];
+	};
+
+private:	// FIELDS
+
+	Device&				m_Device;
+
+	ResourceInfos		m_pResources[MAX_RESOURCES];
+	int					m_ResourcesCount;
+	PassInfos			m_pPasses[MAX_PASSES];
+	int					m_PassesCount;
+	int					m_pOrder[MAX_PASSES];		// Indices of the passes that are kept, in execution order
+	int					m_OrderCount;
+	bool				m_bInterleave;
+
+	// Statistics of the last execution
+	int					m_CulledPassesCount;
+	int					m_MovedPassesCount;
+	int					m_UnbindsCount;
+
+	bool				m_bExecuting;
+
+public:		// PROPERTIES
+
+	int			GetPassesCount() const			{ return m_PassesCount; }
+	int			GetCulledPassesCount() const	{ return m_CulledPassesCount; }	// Amount of passes culled by the last Execute()
+	int			GetUnbindsCount() const			{ return m_UnbindsCount; }		// Amount of unbinds issued by the last Execute()
+	int			GetMovedPassesCount() const		{ return m_MovedPassesCount; }	// Amount of async compute passes the last Execute() moved from where they were added
+
+	// Enables moving the async compute passes (enabled by default), disable it to measure what interleaving brings
+	void		SetInterleaving( bool _bInterleave )	{ m_bInterleave = _bInterleave; }
+	bool		IsInterleaving() const					{ return m_bInterleave; }
+
+	// Returns the actual resource, transient textures are only available while their passes execute
+	Texture2D&			GetTexture( Resource _Resource ) const;
+	StructuredBuffer&	GetBuffer( Resource _Resource ) const;
+
+public:		// METHODS
+
+	RenderGraph( Device& _Device );
+	~RenderGraph();
+
+	// Declares the resources
+	// Imported resources are owned by the caller, _bOutput tells the graph they're used after it executed so their writers are never culled
+	Resource	Import( const char* _pName, Texture2D& _Texture, bool _bOutput=false );
+	Resource	Import( const char* _pName, StructuredBuffer& _Buffer, bool _bOutput=false );
+	Resource	CreateTexture( const char* _pName, int _Width, int _Height, int _ArraySize, const IPixelFormatDescriptor& _Format, int _MipLevelsCount=1, bool _bUnOrderedAccess=false );
+
+	// Declares the passes and what they access
+	// A pass that blends into a target reads its previous content: it only needs to declare the write, all the previous writers are kept
+	int			AddPass( const char* _pName, IRenderPass& _Renderer, U32 _PassID, bool _bHasSideEffects=false );
+	void		Read( int _PassIndex, Resource _Resource )				{ AddAccess( _PassIndex, _Resource, ACCESS_READ ); }
+	void		Write( int _PassIndex, Resource _Resource )				{ AddAccess( _PassIndex, _Resource, ACCESS_WRITE ); }
+	void		ReadWrite( int _PassIndex, Resource _Resource )			{ AddAccess( _PassIndex, _Resource, ACCESS_READ_WRITE ); }
+	void		SetHint( int _PassIndex, PASS_HINT _Hint );
+
+	// Culls the passes, executes the remaining ones with their hazards resolved, then clears the graph
+	void		Execute();
+
+private:
+
+	void		AddAccess( int _PassIndex, Resource _Resource, ACCESS _Type );
+	void		Compile();
+	void		Schedule();
+	static bool	Conflicts( const PassInfos& _Pass0, const PassInfos& _Pass1 );	// True if one of the passes writes a resource the other uses
+	int			GetSlotScore( int _Slot, const int* _pGraphics, int _GraphicsCount ) const;
+	void		ResolveHazards( const PassInfos& _Pass );
+	void		Unbind( ResourceInfos& _Resource );
+	void		Clear();
+};
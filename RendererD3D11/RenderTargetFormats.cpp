@@ -0,0 +1,36 @@
+#include "RenderTargetFormats.h"
+#include "Structures/PixelFormats.h"
+
+const IPixelFormatDescriptor&	RenderTargetFormats::Select( USAGE _Usage )
+{
+	switch ( _Usage )
+	{
+#ifdef FULL_PRECISION_RENDER_TARGETS
+	case HDR_COLOR:			return PixelFormatRGBA16F::DESCRIPTOR;
+	case HDR_COLOR_ALPHA:	return PixelFormatRGBA16F::DESCRIPTOR;
+	case DEPTH_COPY:		return PixelFormatR32F::DESCRIPTOR;
+	case NORMAL:			return PixelFormatRG16F::DESCRIPTOR;
+	case GBUFFER_NORMAL:	return PixelFormatRG32F::DESCRIPTOR;
+	case GBUFFER_MATERIAL:	return PixelFormatRGBA16F::DESCRIPTOR;
+#else
+	case HDR_COLOR:			return PixelFormatR11G11B10F::DESCRIPTOR;
+	case HDR_COLOR_ALPHA:	return PixelFormatRGBA16F::DESCRIPTOR;
+	case DEPTH_COPY:		return PixelFormatR16_UNORM::DESCRIPTOR;
+	case NORMAL:			return PixelFormatRG8_SNORM::DESCRIPTOR;
+	case GBUFFER_NORMAL:	return PixelFormatRG16_UNORM::DESCRIPTOR;
+	case GBUFFER_MATERIAL:	return PixelFormatRGBA8::DESCRIPTOR;
+#endif
+	}
+
+	ASSERT( false, "Unsupported render target usage!" );
+	return PixelFormatRGBA16F::DESCRIPTOR;
+}
+
+bool	RenderTargetFormats::IsReducedBandwidth()
+{
+#ifdef FULL_PRECISION_RENDER_TARGETS
+	return false;
+#else
+	return true;
+#endif
+}
@@ -0,0 +1,48 @@
+//////////////////////////////////////////////////////////////////////////
+// Render Target Formats
+// Central policy choosing the pixel format of a render target from what it's used for, so the intermediate targets don't
+//	default to RGBA16F/R32F when they don't need alpha or that much precision. Post-processes are bandwidth-bound so:
+//	_ HDR colors without alpha use R11G11B10_FLOAT, half the size of RGBA16F
+//	_ Depth copies normalized in [0,1] (e.g. linear depth / far clip) use R16_UNORM instead of R32F
+//	_ Normals are octahedral-encoded (cf. EncodeOctahedral() in Inc/PackedVertex.hlsl) and stored as R8G8_SNORM
+//	_ G-Buffer normals keep 16 bits per octahedral component and materials are packed in 8 bits per channel (cf. Inc/GBuffer.hlsl)
+//
+// Defining FULL_PRECISION_RENDER_TARGETS (cf. Renderer.h) makes every usage fall back to its full format so the quality and
+//	the timings of the same frame can be compared between both builds.
+//
+// Usage:
+//	gs_pRTHDR = new Texture2D( gs_Device, RESX, RESY, 1, RenderTargetFormats::Select( RenderTargetFormats::HDR_COLOR ), 1, NULL );
+//
+// NOTE: R11G11B10_FLOAT has no sign bit and only 6 bits of mantissa (5 for blue), targets accumulating negative values
+//	or tiny increments must stay RGBA16F (i.e. HDR_COLOR_ALPHA).
+// Targets copied into each other (e.g. with Texture2D::CopyFrom()) must be created with the same usage.
+//
+#pragma once
+
+#include "Renderer.h"
+
+class IPixelFormatDescriptor;
+
+class RenderTargetFormats
+{
+public:		// NESTED TYPES
+
+	enum USAGE
+	{
+		HDR_COLOR,			// R11G11B10_FLOAT		(full: R16G16B16A16_FLOAT)
+		HDR_COLOR_ALPHA,	// R16G16B16A16_FLOAT	(full: R16G16B16A16_FLOAT)
+		DEPTH_COPY,			// R16_UNORM			(full: R32_FLOAT)
+		NORMAL,				// R8G8_SNORM			(full: R16G16_FLOAT)
+		GBUFFER_NORMAL,		// R16G16_UNORM			(full: R32G32_FLOAT)
+		GBUFFER_MATERIAL,	// R8G8B8A8_UNORM		(full: R16G16B16A16_FLOAT)
+
+		USAGES_COUNT
+	};
+
+public:		// METHODS
+
+	static const IPixelFormatDescriptor&	Select( USAGE _Usage );
+
+	// True if the reduced-bandwidth formats are used (i.e. FULL_PRECISION_RENDER_TARGETS isn't defined)
+	static bool								IsReducedBandwidth();
+};
@@ -0,0 +1,102 @@
+#include "RenderTargetPool.h"
+#include "Device.h"
+#include "Components/Texture2D.h"
+
+RenderTargetPool::RenderTargetPool( Device& _Device )
+	: m_Device( _Device )
+	, m_TargetsCount( 0 )
+	, m_FrameIndex( 0 )
+{
+}
+
+RenderTargetPool::~RenderTargetPool()
+{
+	for ( int TargetIndex=0; TargetIndex < m_TargetsCount; TargetIndex++ )
+		delete m_pTargets[TargetIndex].pTexture;
+}
+
+int		RenderTargetPool::GetTargetsInUseCount() const
+{
+	int	Count = 0;
+	for ( int TargetIndex=0; TargetIndex < m_TargetsCount; TargetIndex++ )
+		if ( m_pTargets[TargetIndex].bInUse )
+			Count++;
+	return Count;
+}
+
+Texture2D&	RenderTargetPool::Acquire( int _Width, int _Height, int _ArraySize, const IPixelFormatDescriptor& _Format, int _MipLevelsCount, bool _bUnOrderedAccess )
+{
+	// Look for an available target with the same description
+	for ( int TargetIndex=0; TargetIndex < m_TargetsCount; TargetIndex++ )
+	{
+		PooledTarget&	T = m_pTargets[TargetIndex];
+		if (	T.bInUse
+			||	T.Width != _Width || T.Height != _Height || T.ArraySize != _ArraySize || T.MipLevelsCount != _MipLevelsCount
+			||	T.pFormat != &_Format || T.bUnOrderedAccess != _bUnOrderedAccess )
+			continue;
+
+		T.bInUse = true;
+		T.bKeptAcrossFrames = false;
+		T.LastUsedFrame = m_FrameIndex;
+		return *T.pTexture;
+	}
+
+	// Create a new one
+	ASSERT( m_TargetsCount < MAX_TARGETS, "Too many pooled render targets! Did you forget to release them?" );
+	PooledTarget&	T = m_pTargets[m_TargetsCount++];
+	T.pTexture = new Texture2D( m_Device, _Width, _Height, _ArraySize, _Format, _MipLevelsCount, NULL, false, _bUnOrderedAccess );
+	T.Width = _Width;
+	T.Height = _Height;
+	T.ArraySize = _ArraySize;
+	T.MipLevelsCount = _MipLevelsCount;
+	T.pFormat = &_Format;
+	T.bUnOrderedAccess = _bUnOrderedAccess;
+	T.bInUse = true;
+	T.bKeptAcrossFrames = false;
+	T.LastUsedFrame = m_FrameIndex;
+
+	return *T.pTexture;
+}
+
+void	RenderTargetPool::Release( Texture2D& _Target )
+{
+	for ( int TargetIndex=0; TargetIndex < m_TargetsCount; TargetIndex++ )
+		if ( m_pTargets[TargetIndex].pTexture == &_Target )
+		{
+			ASSERT( m_pTargets[TargetIndex].bInUse, "Render target was already released!" );
+			m_pTargets[TargetIndex].bInUse = false;
+			m_pTargets[TargetIndex].bKeptAcrossFrames = false;
+			return;
+		}
+
+	ASSERT( false, "Render target doesn't belong to the pool!" );
+}
+
+void	RenderTargetPool::KeepAcrossFrames( Texture2D& _Target )
+{
+	for ( int TargetIndex=0; TargetIndex < m_TargetsCount; TargetIndex++ )
+		if ( m_pTargets[TargetIndex].pTexture == &_Target )
+		{
+			ASSERT( m_pTargets[TargetIndex].bInUse, "Only acquired render targets can be kept!" );
+			m_pTargets[TargetIndex].bKeptAcrossFrames = true;
+			return;
+		}
+
+	ASSERT( false, "Render target doesn't belong to the pool!" );
+}
+
+void	RenderTargetPool::EndFrame()
+{
+	for ( int TargetIndex=m_TargetsCount-1; TargetIndex >= 0; TargetIndex-- )
+	{
+		PooledTarget&	T = m_pTargets[TargetIndex];
+		ASSERT( !T.bInUse || T.bKeptAcrossFrames, "A pooled render target is still in use at the end of the frame!" );
+		if ( T.bInUse || m_FrameIndex - T.LastUsedFrame < MAX_IDLE_FRAMES )
+			continue;
+
+		delete T.pTexture;
+		m_pTargets[TargetIndex] = m_pTargets[--m_TargetsCount];
+	}
+
+	m_FrameIndex++;
+}
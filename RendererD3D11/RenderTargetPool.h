@@ -0,0 +1,74 @@
+//////////////////////////////////////////////////////////////////////////
+// Render Target Pool
+// Hands out transient render targets to passes that only need them for a short while, instead of each effect keeping its
+//	own permanent intermediate targets. A target released by a pass is handed to the next request with the same description,
+//	whichever effect it comes from, so intermediate targets are shared by all the effects rendering in the same frame.
+// Targets that weren't used for MAX_IDLE_FRAMES frames are destroyed.
+//
+// Usage:
+//	Texture2D&	Temp = m_Device.RenderTargets().Acquire( W, H, 1, PixelFormatRGBA16F::DESCRIPTOR );
+//	(...)		// Render to it and read it back during the pass
+//	m_Device.RenderTargets().Release( Temp );
+//
+// NOTE: The content of an acquired target is undefined, clear it if you need to.
+// A target that must survive the frame (e.g. a temporal history) is kept with KeepAcrossFrames() until it's released.
+// D3D11 can't place several resources in the same memory so targets are reused as a whole, only when their descriptions match.
+//
+#pragma once
+
+#include "Renderer.h"
+
+class Device;
+class Texture2D;
+class IPixelFormatDescriptor;
+
+class RenderTargetPool
+{
+public:		// CONSTANTS
+
+	static const int	MAX_TARGETS = 64;
+	static const U32	MAX_IDLE_FRAMES = 8;		// Unused targets are destroyed after that many frames
+
+private:	// NESTED TYPES
+
+	struct	PooledTarget
+	{
+		Texture2D*						pTexture;
+		int								Width;
+		int								Height;
+		int								ArraySize;
+		int								MipLevelsCount;
+		const IPixelFormatDescriptor*	pFormat;
+		bool							bUnOrderedAccess;
+		bool							bInUse;
+		bool							bKeptAcrossFrames;
+		U32								LastUsedFrame;
+	};
+
+private:	// FIELDS
+
+	Device&				m_Device;
+
+	PooledTarget		m_pTargets[MAX_TARGETS];
+	int					m_TargetsCount;
+	U32					m_FrameIndex;
+
+public:		// PROPERTIES
+
+	int			GetTargetsCount() const		{ return m_TargetsCount; }
+	int			GetTargetsInUseCount() const;
+
+public:		// METHODS
+
+	RenderTargetPool( Device& _Device );
+	~RenderTargetPool();
+
+	Texture2D&	Acquire( int _Width, int _Height, int _ArraySize, const IPixelFormatDescriptor& _Format, int _MipLevelsCount=1, bool _bUnOrderedAccess=false );
+	void		Release( Texture2D& _Target );
+
+	// Allows an acquired target to stay in use past EndFrame(), the owner releases it when it acquires its replacement
+	void		KeepAcrossFrames( Texture2D& _Target );
+
+	// Destroys the targets that have been idle for too long (call once per frame, when all the targets but the kept ones have been released)
+	void		EndFrame();
+};
@@ -4,9 +4,22 @@
 //#define WIN32_LEAN_AND_MEAN			 // Exclude rarely-used stuff from Windows headers
 
 #pragma pack(4)		// MEGA IMPORTANT LINE OR MIS-ALIGNED DIRECTX STRUCTURES WILL COME AND BITE YOUR ASS!
-#include "d3d11.h"
+#include "d3d11_1.h"
 #include "dxgi.h"
 
+//#define HDR10_OUTPUT	// Define this to allow HDR10 swap chains (cf. Device::Init()), this requires the DXGI 1.4 headers of the Windows 10 SDK
+//#define VIDEO_MEMORY_BUDGET	// Define this to query the video memory budget granted by the OS (cf. Device::GetVideoMemoryBudget()), this requires the DXGI 1.4 headers of the Windows 10 SDK
+#if defined(HDR10_OUTPUT) || defined(VIDEO_MEMORY_BUDGET)
+#include "dxgi1_4.h"
+#endif
+
+//#define D3D11_3_OPTIONS	// Define this to query the D3D11.3 features (cf. Device::SupportsVSRenderTargetArrayIndex()), this requires the D3D11.3 headers of the Windows 10 SDK
+#ifdef D3D11_3_OPTIONS
+#include "d3d11_3.h"
+#endif
+
+//#define FULL_PRECISION_RENDER_TARGETS	// Define this to create the render targets with their full formats instead of the reduced-bandwidth ones (cf. RenderTargetFormats), to compare quality & performance
+
 #ifdef _DEBUG
 #include "d3d9.h"
 #endif
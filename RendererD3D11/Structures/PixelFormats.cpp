@@ -4,10 +4,13 @@
 PixelFormatR8::Desc				PixelFormatR8::DESCRIPTOR;
 PixelFormatRGBA8::Desc			PixelFormatRGBA8::DESCRIPTOR;
 PixelFormatRGBA8_sRGB::Desc		PixelFormatRGBA8_sRGB::DESCRIPTOR;
+PixelFormatRGB10A2::Desc		PixelFormatRGB10A2::DESCRIPTOR;
+PixelFormatR11G11B10F::Desc		PixelFormatR11G11B10F::DESCRIPTOR;
 PixelFormatR16F::Desc			PixelFormatR16F::DESCRIPTOR;
 PixelFormatR16_UNORM::Desc		PixelFormatR16_UNORM::DESCRIPTOR;
 PixelFormatRG16F::Desc			PixelFormatRG16F::DESCRIPTOR;
 PixelFormatRG16_UNORM::Desc		PixelFormatRG16_UNORM::DESCRIPTOR;
+PixelFormatRG8_SNORM::Desc		PixelFormatRG8_SNORM::DESCRIPTOR;
 PixelFormatRGBA16_UINT::Desc	PixelFormatRGBA16_UINT::DESCRIPTOR;
 PixelFormatRGBA16_UNORM::Desc	PixelFormatRGBA16_UNORM::DESCRIPTOR;
 PixelFormatRGBA16F::Desc		PixelFormatRGBA16F::DESCRIPTOR;
@@ -16,5 +19,95 @@ PixelFormatR32_UINT::Desc		PixelFormatR32_UINT::DESCRIPTOR;
 PixelFormatRG32F::Desc			PixelFormatRG32F::DESCRIPTOR;
 PixelFormatRGBA32F::Desc		PixelFormatRGBA32F::DESCRIPTOR;
 PixelFormatRGBA32_UINT::Desc	PixelFormatRGBA32_UINT::DESCRIPTOR;
+PixelFormatBC1_UNORM::Desc		PixelFormatBC1_UNORM::DESCRIPTOR;
+PixelFormatBC1_UNORM_sRGB::Desc	PixelFormatBC1_UNORM_sRGB::DESCRIPTOR;
 PixelFormatBC3_UNORM::Desc		PixelFormatBC3_UNORM::DESCRIPTOR;
 PixelFormatBC3_UNORM_sRGB::Desc	PixelFormatBC3_UNORM_sRGB::DESCRIPTOR;
+PixelFormatBC4_UNORM::Desc		PixelFormatBC4_UNORM::DESCRIPTOR;
+PixelFormatBC5_UNORM::Desc		PixelFormatBC5_UNORM::DESCRIPTOR;
+
+
+//////////////////////////////////////////////////////////////////////////
+// Scanline writers
+#ifdef NUAJ_MATH_SSE
+#include <emmintrin.h>
+#endif
+
+// Same as FLOAT2BYTE() on each component (i.e. clamped & truncated), 4 pixels at a time
+static void	WriteScanlineRGBA8( U8* _pPixels, const float4* _pColors, int _Count )
+{
+	int	Index = 0;
+#ifdef NUAJ_MATH_SSE
+	const __m128	Zero = _mm_setzero_ps();
+	const __m128	Max = _mm_set1_ps( 255.0f );
+	for ( ; Index+4 <= _Count; Index+=4 )
+	{
+		const float*	pSource = &_pColors[Index].x;
+		__m128i	P0 = _mm_cvttps_epi32( _mm_min_ps( _mm_max_ps( _mm_mul_ps( _mm_loadu_ps( pSource+0 ), Max ), Zero ), Max ) );
+		__m128i	P1 = _mm_cvttps_epi32( _mm_min_ps( _mm_max_ps( _mm_mul_ps( _mm_loadu_ps( pSource+4 ), Max ), Zero ), Max ) );
+		__m128i	P2 = _mm_cvttps_epi32( _mm_min_ps( _mm_max_ps( _mm_mul_ps( _mm_loadu_ps( pSource+8 ), Max ), Zero ), Max ) );
+		__m128i	P3 = _mm_cvttps_epi32( _mm_min_ps( _mm_max_ps( _mm_mul_ps( _mm_loadu_ps( pSource+12 ), Max ), Zero ), Max ) );
+		_mm_storeu_si128( (__m128i*) &_pPixels[4*Index], _mm_packus_epi16( _mm_packs_epi32( P0, P1 ), _mm_packs_epi32( P2, P3 ) ) );
+	}
+#endif
+	for ( ; Index < _Count; Index++ )
+	{
+		U8*	pPixel = &_pPixels[4*Index];
+		pPixel[0] = FLOAT2BYTE( _pColors[Index].x );
+		pPixel[1] = FLOAT2BYTE( _pColors[Index].y );
+		pPixel[2] = FLOAT2BYTE( _pColors[Index].z );
+		pPixel[3] = FLOAT2BYTE( _pColors[Index].w );
+	}
+}
+
+void	PixelFormatRGBA8::Desc::WriteScanline( U8* _pPixels, const float4* _pColors, int _Count ) const			{ WriteScanlineRGBA8( _pPixels, _pColors, _Count ); }
+void	PixelFormatRGBA8_sRGB::Desc::WriteScanline( U8* _pPixels, const float4* _pColors, int _Count ) const	{ WriteScanlineRGBA8( _pPixels, _pColors, _Count ); }
+
+
+//////////////////////////////////////////////////////////////////////////
+// Packed floats
+// The 11 and 10 bits floats of R11G11B10_FLOAT have no sign bit, a 5 bits exponent biased by 15 like halves
+//	and a 6 or 5 bits mantissa. Values are truncated like the GPU does when it writes the format.
+//
+static U32	EncodeUnsignedFloat( float _Value, int _MantissaBits )
+{
+	U32	Bits = *((U32*) &_Value);
+	if ( (Bits & 0x80000000) != 0 || Bits == 0 )
+		return 0;	// Negative or zero
+	if ( (Bits & 0x7F800000) == 0x7F800000 )
+		return (Bits & 0x007FFFFF) != 0 ? (0x1F << _MantissaBits) | 1 : 0x1F << _MantissaBits;	// NaN or +Inf
+
+	int	Exponent = int( (Bits >> 23) & 0xFF ) - 127 + 15;
+	if ( Exponent >= 31 )
+		return (30 << _MantissaBits) | ((1 << _MantissaBits) - 1);	// Clamp to the largest finite value
+	if ( Exponent <= 0 )
+	{	// Denormal
+		int	Shift = 23 - _MantissaBits + 1 - Exponent;
+		return Shift < 32 ? (0x00800000 | (Bits & 0x007FFFFF)) >> Shift : 0;
+	}
+
+	return (Exponent << _MantissaBits) | ((Bits & 0x007FFFFF) >> (23 - _MantissaBits));
+}
+
+static float	DecodeUnsignedFloat( U32 _Value, int _MantissaBits )
+{
+	U32	Exponent = _Value >> _MantissaBits;
+	U32	Mantissa = _Value & ((1 << _MantissaBits) - 1);
+	if ( Exponent == 0 )
+		return Mantissa * (1.0f / 16384.0f) / (1 << _MantissaBits);	// Denormal, 2^-14 * Mantissa / 2^MantissaBits
+
+	U32	Bits = Exponent == 31 ? 0x7F800000 | Mantissa : ((Exponent - 15 + 127) << 23) | (Mantissa << (23 - _MantissaBits));
+	return *((float*) &Bits);
+}
+
+void	PixelFormatR11G11B10F::Desc::Write( U8* _pPixel, const float4& _Color ) const
+{
+	PixelFormatR11G11B10F&	P = (PixelFormatR11G11B10F&)( *_pPixel );
+	P.RGB = EncodeUnsignedFloat( _Color.x, 6 ) | (EncodeUnsignedFloat( _Color.y, 6 ) << 11) | (EncodeUnsignedFloat( _Color.z, 5 ) << 22);
+}
+
+float4	PixelFormatR11G11B10F::Desc::Read( const U8* _pPixel ) const
+{
+	const PixelFormatR11G11B10F&	P = (const PixelFormatR11G11B10F&)( *_pPixel );
+	return float4( DecodeUnsignedFloat( P.RGB & 0x7FF, 6 ), DecodeUnsignedFloat( (P.RGB >> 11) & 0x7FF, 6 ), DecodeUnsignedFloat( P.RGB >> 22, 5 ), 1.0f );
+}
@@ -13,6 +13,10 @@ public: // PROPERTIES
 	virtual int			Size() const = 0;
 	virtual void		Write( U8* _pPixel, const float4& _Color ) const = 0;
 	virtual float4	Read( const U8* _pPixel ) const = 0;
+	virtual int			BlockSize() const	{ return 1; }	// Width & height of the pixel blocks (4 for block-compressed formats)
+
+	// Writes a whole scanline of colors, the most used formats override this with a vectorized version (cf. PixelFormats.cpp)
+	virtual void		WriteScanline( U8* _pPixels, const float4* _pColors, int _Count ) const	{ int S = Size(); for ( int i=0; i < _Count; i++, _pPixels+=S ) Write( _pPixels, _pColors[i] ); }
 };
 
 struct PixelFormatR8 : public PixelFormat
@@ -46,6 +50,7 @@ public:
 		virtual DXGI_FORMAT	DirectXFormat() const			{ return DXGI_FORMAT_R8G8B8A8_UNORM; }
 		virtual int			Size() const					{ return sizeof(PixelFormatRGBA8); }
 		virtual void		Write( U8* _pPixel, const float4& _Color ) const	{ PixelFormatRGBA8& P = (PixelFormatRGBA8&)( *_pPixel ); P.R = FLOAT2BYTE( _Color.x ); P.G = FLOAT2BYTE( _Color.y ); P.B = FLOAT2BYTE( _Color.z ); P.A = FLOAT2BYTE( _Color.w ); }
+		virtual void		WriteScanline( U8* _pPixels, const float4* _pColors, int _Count ) const;
 		virtual float4	Read( const U8* _pPixel ) const						{ const PixelFormatRGBA8& P = (const PixelFormatRGBA8&)( *_pPixel ); return float4( NUAJBYTE2FLOAT( P.R ), NUAJBYTE2FLOAT( P.G ), NUAJBYTE2FLOAT( P.B ), NUAJBYTE2FLOAT( P.A ) ); }
 	} DESCRIPTOR;
 
@@ -66,6 +71,7 @@ public:
 		virtual DXGI_FORMAT	DirectXFormat() const			{ return DXGI_FORMAT_R8G8B8A8_UNORM_SRGB; }
 		virtual int			Size() const					{ return sizeof(PixelFormatRGBA8_sRGB); }
 		virtual void		Write( U8* _pPixel, const float4& _Color ) const	{ PixelFormatRGBA8_sRGB& P = (PixelFormatRGBA8_sRGB&)( *_pPixel ); P.R = FLOAT2BYTE( _Color.x ); P.G = FLOAT2BYTE( _Color.y ); P.B = FLOAT2BYTE( _Color.z ); P.A = FLOAT2BYTE( _Color.w ); }
+		virtual void		WriteScanline( U8* _pPixels, const float4* _pColors, int _Count ) const;
 		virtual float4	Read( const U8* _pPixel ) const						{ const PixelFormatRGBA8_sRGB& P = (const PixelFormatRGBA8_sRGB&)( *_pPixel ); return float4( NUAJBYTE2FLOAT( P.R ), NUAJBYTE2FLOAT( P.G ), NUAJBYTE2FLOAT( P.B ), NUAJBYTE2FLOAT( P.A ) ); }
 	} DESCRIPTOR;
 
@@ -75,6 +81,49 @@ public:
 
 };
 
+// 10 bits per color channel, used by HDR10 swap chains (cf. Device::Init())
+struct PixelFormatRGB10A2 : public PixelFormat
+{
+public:
+
+	static class Desc : public IPixelFormatDescriptor
+	{
+	public:
+
+		virtual DXGI_FORMAT	DirectXFormat() const			{ return DXGI_FORMAT_R10G10B10A2_UNORM; }
+		virtual int			Size() const					{ return sizeof(PixelFormatRGB10A2); }
+		virtual void		Write( U8* _pPixel, const float4& _Color ) const	{ PixelFormatRGB10A2& P = (PixelFormatRGB10A2&)( *_pPixel ); P.RGBA = U32( 1023.0f * SATURATE( _Color.x ) + 0.5f ) | (U32( 1023.0f * SATURATE( _Color.y ) + 0.5f ) << 10) | (U32( 1023.0f * SATURATE( _Color.z ) + 0.5f ) << 20) | (U32( 3.0f * SATURATE( _Color.w ) + 0.5f ) << 30); }
+		virtual float4		Read( const U8* _pPixel ) const						{ const PixelFormatRGB10A2& P = (const PixelFormatRGB10A2&)( *_pPixel ); return float4( (P.RGBA & 0x3FF) / 1023.0f, ((P.RGBA >> 10) & 0x3FF) / 1023.0f, ((P.RGBA >> 20) & 0x3FF) / 1023.0f, (P.RGBA >> 30) / 3.0f ); }
+	} DESCRIPTOR;
+
+public:
+
+	U32	RGBA;
+
+};
+
+// Unsigned floats packed on 32 bits (6 bits mantissa for R & G, 5 bits for B, 5 bits exponent each), half the bandwidth of RGBA16F
+//	for HDR colors that don't need alpha (cf. RenderTargetFormats). Negative values are clamped to 0.
+struct PixelFormatR11G11B10F : public PixelFormat
+{
+public:
+
+	static class Desc : public IPixelFormatDescriptor
+	{
+	public:
+
+		virtual DXGI_FORMAT	DirectXFormat() const			{ return DXGI_FORMAT_R11G11B10_FLOAT; }
+		virtual int			Size() const					{ return sizeof(PixelFormatR11G11B10F); }
+		virtual void		Write( U8* _pPixel, const float4& _Color ) const;	// Cf. PixelFormats.cpp
+		virtual float4		Read( const U8* _pPixel ) const;
+	} DESCRIPTOR;
+
+public:
+
+	U32	RGB;
+
+};
+
 struct PixelFormatRGBA16F : public PixelFormat {
 public:
 
@@ -85,6 +134,7 @@ public:
 		virtual DXGI_FORMAT	DirectXFormat() const			{ return DXGI_FORMAT_R16G16B16A16_FLOAT; }
 		virtual int			Size() const					{ return sizeof(PixelFormatRGBA16F); }
 		virtual void		Write( U8* _pPixel, const float4& _Color ) const	{ PixelFormatRGBA16F& P = (PixelFormatRGBA16F&)( *_pPixel ); P.R = _Color.x; P.G = _Color.y; P.B = _Color.z; P.A = _Color.w; }
+		virtual void		WriteScanline( U8* _pPixels, const float4* _pColors, int _Count ) const	{ half::Encode( &_pColors->x, (half*) _pPixels, 4*_Count ); }
 		virtual float4		Read( const U8* _pPixel ) const						{ const PixelFormatRGBA16F& P = (const PixelFormatRGBA16F&)( *_pPixel ); return float4( P.R, P.G, P.B, P.A ); }
 	} DESCRIPTOR;
 
@@ -174,6 +224,27 @@ public:
 
 };
 
+// Signed [-1,1] pairs, typically octahedral-encoded normals (cf. EncodeOctahedral() in Inc/PackedVertex.hlsl)
+struct PixelFormatRG8_SNORM : public PixelFormat
+{
+public:
+
+	static class Desc : public IPixelFormatDescriptor
+	{
+	public:
+
+		virtual DXGI_FORMAT	DirectXFormat() const			{ return DXGI_FORMAT_R8G8_SNORM; }
+		virtual int			Size() const					{ return sizeof(PixelFormatRG8_SNORM); }
+		virtual void		Write( U8* _pPixel, const float4& _Color ) const	{ PixelFormatRG8_SNORM& P = (PixelFormatRG8_SNORM&)( *_pPixel ); P.R = S8( floorf( 127.0f * MIN( 1.0f, MAX( -1.0f, _Color.x ) ) + 0.5f ) ); P.G = S8( floorf( 127.0f * MIN( 1.0f, MAX( -1.0f, _Color.y ) ) + 0.5f ) ); }
+		virtual float4		Read( const U8* _pPixel ) const						{ const PixelFormatRG8_SNORM& P = (const PixelFormatRG8_SNORM&)( *_pPixel ); return float4( MAX( -1.0f, P.R / 127.0f ), MAX( -1.0f, P.G / 127.0f ), 0, 0 ); }
+	} DESCRIPTOR;
+
+public:
+
+	S8	R, G;
+
+};
+
 // Warning: Truly stores INTs!! Use UNORM if you intend to store floats in [0,1]
 struct PixelFormatRGBA16_UINT : public PixelFormat
 {
@@ -286,6 +357,7 @@ public:
 		virtual DXGI_FORMAT	DirectXFormat() const			{ return DXGI_FORMAT_R32G32B32A32_FLOAT; }
 		virtual int			Size() const					{ return sizeof(PixelFormatRGBA32F); }
 		virtual void		Write( U8* _pPixel, const float4& _Color ) const	{ PixelFormatRGBA32F& P = (PixelFormatRGBA32F&)( *_pPixel ); P.R = _Color.x; P.G = _Color.y; P.B = _Color.z; P.A = _Color.w; }
+		virtual void		WriteScanline( U8* _pPixels, const float4* _pColors, int _Count ) const	{ memcpy( _pPixels, _pColors, _Count*sizeof(float4) ); }
 		virtual float4		Read( const U8* _pPixel ) const						{ const PixelFormatRGBA32F& P = (const PixelFormatRGBA32F&)( *_pPixel ); return float4( P.R, P.G, P.B, P.A ); }
 	} DESCRIPTOR;
 
@@ -319,6 +391,48 @@ public:
 // COMPRESSED FORMATS
 //////////////////////////////////////////////////////////////////////////
 //
+// Block-compressed formats encode blocks of 4x4 pixels, their Size() is the size of a block (cf. BlockCompressor)
+//
+struct PixelFormatBC1_UNORM : public PixelFormat
+{
+public:
+
+	static class Desc : public IPixelFormatDescriptor
+	{
+	public:
+
+		virtual DXGI_FORMAT	DirectXFormat() const			{ return DXGI_FORMAT_BC1_UNORM; }
+		virtual int			Size() const					{ return sizeof(PixelFormatBC1_UNORM); }
+		virtual int			BlockSize() const				{ return 4; }
+		virtual void		Write( U8* _pPixel, const float4& _Color ) const	{ ASSERT( false, "Can't write individual BC1 pixels!" ); }
+		virtual float4		Read( const U8* _pPixel ) const						{ ASSERT( false, "Can't read individual BC1 pixels!" ); return float4::Zero; }
+	} DESCRIPTOR;
+
+public:
+
+	U8		pBlock[8];
+};
+
+struct PixelFormatBC1_UNORM_sRGB : public PixelFormat
+{
+public:
+
+	static class Desc : public IPixelFormatDescriptor
+	{
+	public:
+
+		virtual DXGI_FORMAT	DirectXFormat() const			{ return DXGI_FORMAT_BC1_UNORM_SRGB; }
+		virtual int			Size() const					{ return sizeof(PixelFormatBC1_UNORM_sRGB); }
+		virtual int			BlockSize() const				{ return 4; }
+		virtual void		Write( U8* _pPixel, const float4& _Color ) const	{ ASSERT( false, "Can't write individual BC1 pixels!" ); }
+		virtual float4		Read( const U8* _pPixel ) const						{ ASSERT( false, "Can't read individual BC1 pixels!" ); return float4::Zero; }
+	} DESCRIPTOR;
+
+public:
+
+	U8		pBlock[8];
+};
+
 struct PixelFormatBC3_UNORM : public PixelFormat
 {
 public:
@@ -329,13 +443,14 @@ public:
 
 		virtual DXGI_FORMAT	DirectXFormat() const			{ return DXGI_FORMAT_BC3_UNORM; }
 		virtual int			Size() const					{ return sizeof(PixelFormatBC3_UNORM); }
+		virtual int			BlockSize() const				{ return 4; }
 		virtual void		Write( U8* _pPixel, const float4& _Color ) const	{ ASSERT( false, "Can't write individual BC3 pixels!" ); }
 		virtual float4		Read( const U8* _pPixel ) const						{ ASSERT( false, "Can't read individual BC3 pixels!" ); return float4::Zero; }
 	} DESCRIPTOR;
 
 public:
 
-	U8		value;
+	U8		pBlock[16];
 };
 
 struct PixelFormatBC3_UNORM_sRGB : public PixelFormat
@@ -348,11 +463,52 @@ public:
 
 		virtual DXGI_FORMAT	DirectXFormat() const			{ return DXGI_FORMAT_BC3_UNORM_SRGB; }
 		virtual int			Size() const					{ return sizeof(PixelFormatBC3_UNORM_sRGB); }
+		virtual int			BlockSize() const				{ return 4; }
 		virtual void		Write( U8* _pPixel, const float4& _Color ) const	{ ASSERT( false, "Can't write individual BC3 pixels!" ); }
 		virtual float4		Read( const U8* _pPixel ) const						{ ASSERT( false, "Can't read individual BC3 pixels!" ); return float4::Zero; }
 	} DESCRIPTOR;
 
 public:
 
-	U8		value;
+	U8		pBlock[16];
+};
+
+struct PixelFormatBC4_UNORM : public PixelFormat
+{
+public:
+
+	static class Desc : public IPixelFormatDescriptor
+	{
+	public:
+
+		virtual DXGI_FORMAT	DirectXFormat() const			{ return DXGI_FORMAT_BC4_UNORM; }
+		virtual int			Size() const					{ return sizeof(PixelFormatBC4_UNORM); }
+		virtual int			BlockSize() const				{ return 4; }
+		virtual void		Write( U8* _pPixel, const float4& _Color ) const	{ ASSERT( false, "Can't write individual BC4 pixels!" ); }
+		virtual float4		Read( const U8* _pPixel ) const						{ ASSERT( false, "Can't read individual BC4 pixels!" ); return float4::Zero; }
+	} DESCRIPTOR;
+
+public:
+
+	U8		pBlock[8];
+};
+
+struct PixelFormatBC5_UNORM : public PixelFormat
+{
+public:
+
+	static class Desc : public IPixelFormatDescriptor
+	{
+	public:
+
+		virtual DXGI_FORMAT	DirectXFormat() const			{ return DXGI_FORMAT_BC5_UNORM; }
+		virtual int			Size() const					{ return sizeof(PixelFormatBC5_UNORM); }
+		virtual int			BlockSize() const				{ return 4; }
+		virtual void		Write( U8* _pPixel, const float4& _Color ) const	{ ASSERT( false, "Can't write individual BC5 pixels!" ); }
+		virtual float4		Read( const U8* _pPixel ) const						{ ASSERT( false, "Can't read individual BC5 pixels!" ); return float4::Zero; }
+	} DESCRIPTOR;
+
+public:
+
+	U8		pBlock[16];
 };
@@ -84,6 +84,21 @@ D3D11_INPUT_ELEMENT_DESC	VertexFormatP3N3G3B3T2::Desc::ms_pInputElements[] =
 	{ TEXCOORD, 0, DXGI_FORMAT_R32G32_FLOAT, 0, 48, D3D11_INPUT_PER_VERTEX_DATA, 0 },
 };
 
+VertexFormatPackedP3N3G3B3T2::Desc	VertexFormatPackedP3N3G3B3T2::DESCRIPTOR;
+D3D11_INPUT_ELEMENT_DESC	VertexFormatPackedP3N3G3B3T2::Desc::ms_pInputElements[] =
+{
+	{ POSITION, 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	{ NORMAL, 0, DXGI_FORMAT_R16G16_SNORM, 0, 8, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	{ TANGENT, 0, DXGI_FORMAT_R16G16_SNORM, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	{ TEXCOORD, 0, DXGI_FORMAT_R16G16_FLOAT, 0, 16, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+};
+
+VertexFormatPackedP4::Desc	VertexFormatPackedP4::DESCRIPTOR;
+D3D11_INPUT_ELEMENT_DESC	VertexFormatPackedP4::Desc::ms_pInputElements[] =
+{
+	{ POSITION, 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+};
+
 VertexFormatU32::Desc	VertexFormatU32::DESCRIPTOR;
 D3D11_INPUT_ELEMENT_DESC	VertexFormatU32::Desc::ms_pInputElements[] =
 {
@@ -161,6 +176,58 @@ void	VertexFormatP3N3G3B3T2::Desc::Write( void* _pVertex, const float3& _Positio
 	V.UV = _UV;
 }
 
+namespace
+{
+	U16		QuantizeUNorm16( float _Value )
+	{
+		return U16( floorf( 65535.0f * MIN( 1.0f, MAX( 0.0f, _Value ) ) + 0.5f ) );
+	}
+
+	S16		QuantizeSNorm16( float _Value )
+	{
+		return S16( floorf( 32767.0f * MIN( 1.0f, MAX( -1.0f, _Value ) ) + 0.5f ) );
+	}
+
+	// Octahedral mapping of a unit vector (cf. "A Survey of Efficient Representations for Independent Unit Vectors", Cigolle et al.)
+	void	EncodeOctahedral( const float3& _Direction, S16 _pResult[2] )
+	{
+		float	L1 = fabsf( _Direction.x ) + fabsf( _Direction.y ) + fabsf( _Direction.z );
+		float	X = L1 > 0.0f ? _Direction.x / L1 : 0.0f;
+		float	Y = L1 > 0.0f ? _Direction.y / L1 : 0.0f;
+		if ( _Direction.z < 0.0f )
+		{	// Fold the lower hemisphere over the diagonals
+			float	FoldedX = (1.0f - fabsf( Y )) * (X >= 0.0f ? 1.0f : -1.0f);
+			float	FoldedY = (1.0f - fabsf( X )) * (Y >= 0.0f ? 1.0f : -1.0f);
+			X = FoldedX;
+			Y = FoldedY;
+		}
+		_pResult[0] = QuantizeSNorm16( X );
+		_pResult[1] = QuantizeSNorm16( Y );
+	}
+}
+
+void	VertexFormatPackedP3N3G3B3T2::Desc::Write( void* _pVertex, const float3& _Position, const float3& _Normal, const float3& _Tangent, const float3& _BiTangent, const float2& _UV ) const
+{
+	VertexFormatPackedP3N3G3B3T2&	V = *((VertexFormatPackedP3N3G3B3T2*) _pVertex);
+	V.Position[0] = QuantizeUNorm16( _Position.x );
+	V.Position[1] = QuantizeUNorm16( _Position.y );
+	V.Position[2] = QuantizeUNorm16( _Position.z );
+	V.Position[3] = ((_Normal ^ _Tangent) | _BiTangent) >= 0.0f ? 0xFFFF : 0;	// Bitangent is rebuilt as +/- Normal x Tangent
+	EncodeOctahedral( _Normal, V.Normal );
+	EncodeOctahedral( _Tangent, V.Tangent );
+	V.UV[0] = half( _UV.x );
+	V.UV[1] = half( _UV.y );
+}
+
+void	VertexFormatPackedP4::Desc::Write( void* _pVertex, const float3& _Position, const float3& _Normal, const float3& _Tangent, const float3& _BiTangent, const float2& _UV ) const
+{
+	VertexFormatPackedP4&	V = *((VertexFormatPackedP4*) _pVertex);
+	V.Position[0] = QuantizeUNorm16( _Position.x );
+	V.Position[1] = QuantizeUNorm16( _Position.y );
+	V.Position[2] = QuantizeUNorm16( _Position.z );
+	V.Position[3] = 0xFFFF;
+}
+
 void	VertexFormatU32::Desc::Write( void* _pVertex, const float3& _Position, const float3& _Normal, const float3& _Tangent, const float3& _BiTangent, const float2& _UV ) const
 {
 	VertexFormatU32&	V = *((VertexFormatU32*) _pVertex);
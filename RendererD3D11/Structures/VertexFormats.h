@@ -320,6 +320,60 @@ public:
 
 };
 
+// Packed version of VertexFormatP3N3G3B3T2 (20 bytes instead of 56)
+// Position quantized in the primitive's bounding box, W stores the bitangent's sign
+// Octahedral normal
+// Octahedral tangent
+// Half UV
+// NOTE: Write() expects the position already normalized in [0,1] within the primitive's bounding box (cf. Resources/Shaders/Inc/PackedVertex.hlsl for decoding)
+struct VertexFormatPackedP3N3G3B3T2
+{
+public:
+
+	static class Desc : public IVertexFormatDescriptor
+	{
+		static D3D11_INPUT_ELEMENT_DESC	ms_pInputElements[4];
+
+	public:
+
+		virtual int			Size() const							{ return sizeof(VertexFormatPackedP3N3G3B3T2); }
+		virtual const D3D11_INPUT_ELEMENT_DESC*  GetInputElements() const	{ return ms_pInputElements; }
+		virtual int			GetInputElementsCount() const			{ return 4; }
+		virtual void		Write( void* _pVertex, const float3& _Position, const float3& _Normal, const float3& _Tangent, const float3& _BiTangent, const float2& _UV ) const;
+	} DESCRIPTOR;
+
+public:
+
+	U16		Position[4];
+	S16		Normal[2];
+	S16		Tangent[2];
+	half	UV[2];
+
+};
+
+// Quantized position only, to read VertexFormatPackedP3N3G3B3T2 vertices in depth passes
+struct VertexFormatPackedP4
+{
+public:
+
+	static class Desc : public IVertexFormatDescriptor
+	{
+		static D3D11_INPUT_ELEMENT_DESC	ms_pInputElements[1];
+
+	public:
+
+		virtual int			Size() const							{ return sizeof(VertexFormatPackedP4); }
+		virtual const D3D11_INPUT_ELEMENT_DESC*  GetInputElements() const	{ return ms_pInputElements; }
+		virtual int			GetInputElementsCount() const			{ return 1; }
+		virtual void		Write( void* _pVertex, const float3& _Position, const float3& _Normal, const float3& _Tangent, const float3& _BiTangent, const float2& _UV ) const;
+	} DESCRIPTOR;
+
+public:
+
+	U16		Position[4];
+
+};
+
 // Simple U32
 struct VertexFormatU32
 {
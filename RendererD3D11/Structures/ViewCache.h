@@ -0,0 +1,135 @@
+//////////////////////////////////////////////////////////////////////////
+// View Cache
+// A compact open-addressing cache of D3D views keyed by their packed mip/array range
+//
+// Textures usually only ever create a handful of views so the first INLINE_CAPACITY entries are stored inline:
+//	the keys are packed together so a lookup only touches a single cache line.
+// Should a texture need more views (e.g. one RTV per slice of a large array), the cache grows on the heap.
+//
+// NOTE: A view is never NULL so a NULL view marks an empty slot and any key is valid
+//
+#pragma once
+
+#include "../Renderer.h"
+
+template<typename T> class	ViewCache
+{
+public:		// CONSTANTS
+
+	static const int	INLINE_CAPACITY_POT = 3;
+	static const int	INLINE_CAPACITY = 1 << INLINE_CAPACITY_POT;
+
+private:	// FIELDS
+
+	U32*		m_pKeys;
+	T**			m_ppViews;
+	int			m_CapacityPOT;
+	int			m_Count;
+
+	U32			m_pInlineKeys[INLINE_CAPACITY];
+	T*			m_ppInlineViews[INLINE_CAPACITY];
+
+public:		// PROPERTIES
+
+	int			GetCount() const	{ return m_Count; }
+
+public:		// METHODS
+
+	ViewCache()
+		: m_pKeys( m_pInlineKeys )
+		, m_ppViews( m_ppInlineViews )
+		, m_CapacityPOT( INLINE_CAPACITY_POT )
+		, m_Count( 0 )
+	{
+		memset( m_ppInlineViews, 0, INLINE_CAPACITY*sizeof(T*) );
+	}
+
+	~ViewCache()
+	{
+		if ( m_pKeys != m_pInlineKeys )
+		{
+			delete[] m_pKeys;
+			delete[] m_ppViews;
+		}
+	}
+
+	// Returns the cached view or NULL if not found
+	T*			Get( U32 _Key ) const
+	{
+		U32	Mask = (1 << m_CapacityPOT) - 1;
+		for ( U32 SlotIndex=Hash( _Key ); ; SlotIndex=(SlotIndex+1) & Mask )
+		{
+			T*	pView = m_ppViews[SlotIndex];
+			if ( pView == NULL )
+				return NULL;	// Reached an empty slot
+			if ( m_pKeys[SlotIndex] == _Key )
+				return pView;
+		}
+	}
+
+	// Stores a new view (the key must not already exist)
+	void		Add( U32 _Key, T* _pView )
+	{
+		ASSERT( _pView != NULL, "Can't cache a NULL view!" );
+		if ( 4*(m_Count+1) > 3 << m_CapacityPOT )
+			Grow();	// Keep the load factor below 75%
+
+		Insert( _Key, _pView );
+		m_Count++;
+	}
+
+	// Releases all the cached views
+	void		ReleaseAll()
+	{
+		int	Capacity = 1 << m_CapacityPOT;
+		for ( int SlotIndex=0; SlotIndex < Capacity; SlotIndex++ )
+			if ( m_ppViews[SlotIndex] != NULL )
+			{
+				m_ppViews[SlotIndex]->Release();
+				m_ppViews[SlotIndex] = NULL;
+			}
+		m_Count = 0;
+	}
+
+private:
+
+	// Fibonacci hashing spreads the packed bit fields over the whole table
+	U32			Hash( U32 _Key ) const	{ return (_Key * 2654435769U) >> (32 - m_CapacityPOT); }
+
+	void		Insert( U32 _Key, T* _pView )
+	{
+		U32	Mask = (1 << m_CapacityPOT) - 1;
+		U32	SlotIndex = Hash( _Key );
+		while ( m_ppViews[SlotIndex] != NULL )
+		{
+			ASSERT( m_pKeys[SlotIndex] != _Key, "View already cached!" );
+			SlotIndex = (SlotIndex+1) & Mask;
+		}
+
+		m_pKeys[SlotIndex] = _Key;
+		m_ppViews[SlotIndex] = _pView;
+	}
+
+	void		Grow()
+	{
+		U32*	pOldKeys = m_pKeys;
+		T**		ppOldViews = m_ppViews;
+		int		OldCapacity = 1 << m_CapacityPOT;
+
+		m_CapacityPOT++;
+		int		Capacity = 1 << m_CapacityPOT;
+		m_pKeys = new U32[Capacity];
+		m_ppViews = new T*[Capacity];
+		memset( m_ppViews, 0, Capacity*sizeof(T*) );
+
+		for ( int SlotIndex=0; SlotIndex < OldCapacity; SlotIndex++ )
+			if ( ppOldViews[SlotIndex] != NULL )
+				Insert( pOldKeys[SlotIndex], ppOldViews[SlotIndex] );
+
+		if ( pOldKeys != m_pInlineKeys )
+		{
+			delete[] pOldKeys;
+			delete[] ppOldViews;
+		}
+	}
+};
@@ -0,0 +1,179 @@
+#include "TextureStreamer.h"
+#include "Device.h"
+#include "Components/Texture2D.h"
+#include "../Utility/TextureFilePOM.h"
+
+TextureStreamer::TextureStreamer( Device& _Device )
+	: m_Device( _Device )
+	, m_TexturesCount( 0 )
+	, m_bQuit( false )
+	, m_RequestsReadIndex( 0 )
+	, m_RequestsCount( 0 )
+{
+	InitializeCriticalSection( &m_Lock );
+	m_hRequests = CreateSemaphore( NULL, 0, MAX_TEXTURES + 1, NULL );
+
+	DWORD	ThreadID;
+	m_hLoader = CreateThread( NULL, 0, LoaderThread, this, 0, &ThreadID );
+	ASSERT( m_hLoader != NULL, "Failed to create the texture loader thread!" );
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	// Wake the loader up so it notices it must quit
+	m_bQuit = true;
+	ReleaseSemaphore( m_hRequests, 1, NULL );
+	WaitForSingleObject( m_hLoader, INFINITE );
+	CloseHandle( m_hLoader );
+
+	for ( int TextureIndex=0; TextureIndex < m_TexturesCount; TextureIndex++ )
+		delete m_pTextures[TextureIndex].pLoadedMip;
+
+	CloseHandle( m_hRequests );
+	DeleteCriticalSection( &m_Lock );
+}
+
+int		TextureStreamer::GetResidentMip( const Texture2D& _Texture ) const
+{
+	int	TextureIndex = Find( _Texture );
+	return TextureIndex >= 0 ? m_pTextures[TextureIndex].ResidentMip : 0;
+}
+
+Texture2D*	TextureStreamer::Load( const char* _pFileName, int _ResidentMipsCount )
+{
+	ASSERT( m_TexturesCount < MAX_TEXTURES, "Too many streamed textures!" );
+
+	// Read the whole mip chain's descriptors but only the content of the last mips
+	TextureFilePOM	POM;
+	POM.Load( _pFileName, 0, 0 );
+	ASSERT( POM.m_Type != TextureFilePOM::TEX_3D, "Only 2D textures can be streamed!" );
+	int	FirstResidentMip = MAX( 0, POM.m_MipsCount - _ResidentMipsCount );
+	POM.Load( _pFileName, FirstResidentMip );
+
+	int	ArraySize = POM.m_Type == TextureFilePOM::TEX_CUBE ? -POM.m_ArraySizeOrDepth : POM.m_ArraySizeOrDepth;
+	Texture2D*	pTexture = new Texture2D( m_Device, POM.m_Width, POM.m_Height, ArraySize, *POM.m_pPixelFormat, POM.m_MipsCount, NULL );
+	for ( int MipLevelIndex=FirstResidentMip; MipLevelIndex < POM.m_MipsCount; MipLevelIndex++ )
+		for ( int SliceIndex=0; SliceIndex < POM.m_ArraySizeOrDepth; SliceIndex++ )
+			pTexture->UpdateSubResource( MipLevelIndex, SliceIndex, POM.m_ppContent[MipLevelIndex+POM.m_MipsCount*SliceIndex], POM.m_pMipsDescriptors[MipLevelIndex].RowPitch, POM.m_pMipsDescriptors[MipLevelIndex].DepthPitch );
+	pTexture->SetMinLOD( float(FirstResidentMip) );
+
+	StreamedTexture&	T = m_pTextures[m_TexturesCount];
+	strcpy_s( T.pFileName, _pFileName );
+	T.pTexture = pTexture;
+	T.ResidentMip = FirstResidentMip;
+	T.DesiredMip = 0;
+	T.LoadingMip = -1;
+	T.pLoadedMip = NULL;
+	T.UploadedSlices = 0;
+
+	QueueNextMip( m_TexturesCount++ );
+
+	return pTexture;
+}
+
+void	TextureStreamer::RequestMip( const Texture2D& _Texture, int _MipLevelIndex )
+{
+	int	TextureIndex = Find( _Texture );
+	ASSERT( TextureIndex >= 0, "Texture is not streamed!" );
+
+	// We can't evict mips that are already resident but we can stop streaming the higher ones
+	m_pTextures[TextureIndex].DesiredMip = _MipLevelIndex;
+	QueueNextMip( TextureIndex );
+}
+
+void	TextureStreamer::Update( U32 _BytesBudget )
+{
+	ASSERT( m_Device.IsImmediate(), "Textures must be uploaded from the thread owning the immediate context!" );
+
+	U32	UploadedBytes = 0;
+	for ( int TextureIndex=0; TextureIndex < m_TexturesCount; TextureIndex++ )
+	{
+		StreamedTexture&	T = m_pTextures[TextureIndex];
+
+		EnterCriticalSection( &m_Lock );
+		TextureFilePOM*		pPOM = T.pLoadedMip;
+		LeaveCriticalSection( &m_Lock );
+		if ( pPOM == NULL )
+			continue;	// Nothing to upload yet...
+
+		// Upload as many slices as the budget allows (always at least one per frame so huge mips still make progress)
+		int	MipLevelIndex = T.LoadingMip;
+		int	SliceSize = pPOM->m_pMipsDescriptors[MipLevelIndex].DepthPitch;
+		while ( T.UploadedSlices < pPOM->m_ArraySizeOrDepth && (UploadedBytes == 0 || UploadedBytes + SliceSize <= _BytesBudget) )
+		{
+			T.pTexture->UpdateSubResource( MipLevelIndex, T.UploadedSlices, pPOM->m_ppContent[MipLevelIndex+pPOM->m_MipsCount*T.UploadedSlices], pPOM->m_pMipsDescriptors[MipLevelIndex].RowPitch, SliceSize );
+			T.UploadedSlices++;
+			UploadedBytes += SliceSize;
+		}
+		if ( T.UploadedSlices < pPOM->m_ArraySizeOrDepth )
+			return;	// Out of budget
+
+		// The mip is complete and can be sampled
+		T.pTexture->SetMinLOD( float(MipLevelIndex) );
+		T.ResidentMip = MipLevelIndex;
+		T.LoadingMip = -1;
+		T.UploadedSlices = 0;
+
+		EnterCriticalSection( &m_Lock );
+		T.pLoadedMip = NULL;
+		LeaveCriticalSection( &m_Lock );
+		delete pPOM;
+
+		QueueNextMip( TextureIndex );
+		if ( UploadedBytes >= _BytesBudget )
+			return;
+	}
+}
+
+int		TextureStreamer::Find( const Texture2D& _Texture ) const
+{
+	for ( int TextureIndex=0; TextureIndex < m_TexturesCount; TextureIndex++ )
+		if ( m_pTextures[TextureIndex].pTexture == &_Texture )
+			return TextureIndex;
+	return -1;
+}
+
+void	TextureStreamer::QueueNextMip( int _TextureIndex )
+{
+	StreamedTexture&	T = m_pTextures[_TextureIndex];
+	if ( T.LoadingMip != -1 || T.ResidentMip <= T.DesiredMip )
+		return;	// Already loading or done
+
+	T.LoadingMip = T.ResidentMip - 1;
+
+	EnterCriticalSection( &m_Lock );
+	m_pRequests[(m_RequestsReadIndex + m_RequestsCount) % MAX_TEXTURES] = _TextureIndex;	// A texture has at most one request in the ring
+	m_RequestsCount++;
+	LeaveCriticalSection( &m_Lock );
+
+	ReleaseSemaphore( m_hRequests, 1, NULL );
+}
+
+DWORD WINAPI	TextureStreamer::LoaderThread( LPVOID _pParam )
+{
+	TextureStreamer&	Owner = *((TextureStreamer*) _pParam);
+	while ( true )
+	{
+		WaitForSingleObject( Owner.m_hRequests, INFINITE );
+		if ( Owner.m_bQuit )
+			break;
+
+		EnterCriticalSection( &Owner.m_Lock );
+		int	TextureIndex = Owner.m_pRequests[Owner.m_RequestsReadIndex];
+		Owner.m_RequestsReadIndex = (Owner.m_RequestsReadIndex + 1) % MAX_TEXTURES;
+		Owner.m_RequestsCount--;
+		LeaveCriticalSection( &Owner.m_Lock );
+
+		// The file name and the requested mip don't change while the request is pending
+		StreamedTexture&	T = Owner.m_pTextures[TextureIndex];
+		TextureFilePOM*		pPOM = new TextureFilePOM();
+		pPOM->Load( T.pFileName, T.LoadingMip, 1 );
+		pPOM->Prefetch();	// Mapped files would otherwise be read from disk by the render thread's upload
+
+		EnterCriticalSection( &Owner.m_Lock );
+		T.pLoadedMip = pPOM;
+		LeaveCriticalSection( &Owner.m_Lock );
+	}
+
+	return 0;
+}
@@ -0,0 +1,86 @@
+//////////////////////////////////////////////////////////////////////////
+// Texture Streamer
+// Creates textures from POM files with only their lowest mips resident, a background thread then reads the higher mips
+//	one at a time and the render thread uploads them within a per-frame byte budget.
+// Each texture's views are clamped with SetMinLOD() to the most detailed mip that's fully uploaded.
+//
+// Usage:
+//	TextureStreamer	Streamer( gs_Device );
+//	Texture2D*		pTexture = Streamer.Load( "MyTexture.pom" );	// Returns right away with the low mips
+//	(...)
+//	Streamer.Update( 2 << 20 );		// Every frame, from the render thread (uploads at most 2MB)
+//
+// NOTE: The full mip chain is allocated from the start, D3D11.0 has no way to commit memory for individual mips.
+//	Streaming bounds the loading time and the system memory instead.
+// You can stop the streaming of a texture at a given mip with RequestMip() (e.g. from the feedback of which mips are actually sampled).
+//
+#pragma once
+
+#include "Renderer.h"
+
+class Device;
+class Texture2D;
+class TextureFilePOM;
+
+class TextureStreamer
+{
+public:		// CONSTANTS
+
+	static const int	MAX_TEXTURES = 256;
+	static const int	DEFAULT_RESIDENT_MIPS = 4;		// Amount of low mips loaded synchronously by Load()
+
+private:	// NESTED TYPES
+
+	struct	StreamedTexture
+	{
+		char			pFileName[256];
+		Texture2D*		pTexture;
+		int				ResidentMip;		// Most detailed mip that can be sampled
+		int				DesiredMip;			// Most detailed mip we want to stream in (cf. RequestMip())
+		int				LoadingMip;			// Mip being read by the loader thread (-1 if none)
+		TextureFilePOM*	pLoadedMip;			// Set by the loader thread once LoadingMip is read
+		int				UploadedSlices;		// Amount of slices of the loaded mip already uploaded
+	};
+
+private:	// FIELDS
+
+	Device&				m_Device;
+
+	StreamedTexture		m_pTextures[MAX_TEXTURES];
+	int					m_TexturesCount;
+
+	HANDLE				m_hLoader;
+	CRITICAL_SECTION	m_Lock;				// Protects the requests ring and the pLoadedMip fields
+	HANDLE				m_hRequests;		// Semaphore counting the queued requests
+	volatile bool		m_bQuit;
+
+	int					m_pRequests[MAX_TEXTURES];	// Ring buffer of indices of textures waiting for their LoadingMip
+	int					m_RequestsReadIndex;
+	int					m_RequestsCount;
+
+public:		// PROPERTIES
+
+	int			GetTexturesCount() const	{ return m_TexturesCount; }
+	int			GetResidentMip( const Texture2D& _Texture ) const;
+
+public:		// METHODS
+
+	TextureStreamer( Device& _Device );
+	~TextureStreamer();		// Doesn't delete the textures
+
+	// Loads the lowest mips of a POM texture and queues the others
+	Texture2D*	Load( const char* _pFileName, int _ResidentMipsCount=DEFAULT_RESIDENT_MIPS );
+
+	// Sets the most detailed mip worth streaming in (0 by default)
+	void		RequestMip( const Texture2D& _Texture, int _MipLevelIndex );
+
+	// Uploads the mips read by the loader thread and queues the next ones (render thread only)
+	void		Update( U32 _BytesBudget );
+
+private:
+
+	int			Find( const Texture2D& _Texture ) const;
+	void		QueueNextMip( int _TextureIndex );
+
+	static DWORD WINAPI	LoaderThread( LPVOID _pParam );
+};
@@ -0,0 +1,194 @@
+//////////////////////////////////////////////////////////////////////////
+// Tiled compute depth of field (cf. EffectDOF::RenderComputeDOF() with COMPUTE_DOF)
+// The screen is divided into TILE_SIZE x TILE_SIZE pixels tiles, each handled by a single group in all 3 kernels:
+//	_ CS_Tiles, computes the signed circle of confusion (CoC) from the depth buffer, downsamples the HDR color & CoC to half resolution
+//		and stores the min & max absolute CoC of the tile
+//	_ CS_Gather, operates at half resolution on the tiles whose CoC (dilated by the neighbor tiles since the bokeh of a tile can spill
+//		into its neighbors) is large enough. The group prefetches its tile + a MAX_COC_RADIUS apron into groupshared memory then each
+//		thread gathers the samples whose CoC covers it. In-focus tiles exit right away.
+//	_ CS_Combine, blends the sharp full resolution color with the gathered half resolution one based on the pixel's CoC, in-focus tiles
+//		simply copy the sharp color.
+//
+// Negative CoC are in front of the focus plane and positive ones behind, sizes are expressed in half resolution pixels.
+//
+#include "Inc/Global.hlsl"
+
+#define	TILE_SIZE			32		// In full resolution pixels, !!IMPORTANT ==> Must correspond to EffectDOF::DOF_TILE_SIZE!!
+#define	HALF_TILE_SIZE		(TILE_SIZE/2)
+#define	MAX_COC_RADIUS		8		// In half resolution pixels, !!IMPORTANT ==> Must correspond to EffectDOF::DOF_MAX_COC_RADIUS!!
+#define	APRON_SIZE			(HALF_TILE_SIZE + 2*MAX_COC_RADIUS)
+#define	GATHER_RINGS		4		// Sample rings of the gather disk, ring R has 8*R samples
+
+cbuffer	cbComputeDOF : register( b13 )
+{
+	uint2	_TargetSize;			// Full resolution size
+	uint2	_TilesCount;
+	float	_FocusDistance;			// Distance to the focus plane
+	float	_FocusRange;			// Distance from the focus plane where the CoC reaches MAX_COC_RADIUS
+	float	_InFocusThreshold;		// CoC below which a tile is considered sharp
+	float	__PAD;
+};
+
+Texture2D<float4>	_TexSource : register( t10 );		// Full resolution HDR color
+Texture2D<float>	_TexDepth : register( t11 );		// Full resolution hardware depth
+Texture2D<float2>	_TexTiles : register( t12 );		// X=Min |CoC| Y=Max |CoC| of each tile
+Texture2D<float4>	_TexHalf : register( t13 );			// Half resolution RGB=Color A=CoC
+Texture2D<float4>	_TexGather : register( t14 );		// Half resolution RGB=Blurred color A=Coverage
+
+RWTexture2D<float2>	_OutTiles : register( u0 );
+RWTexture2D<float4>	_Out : register( u1 );				// Half resolution color & CoC (CS_Tiles), gathered color (CS_Gather) or final color (CS_Combine)
+
+float	GetCoC( uint2 _PixelPosition )
+{
+	float	Zproj = _TexDepth[min( _PixelPosition, _TargetSize-1 )];
+	float	Near = _CameraData.z;
+	float	Far = _CameraData.w;
+	float	Z = Near * Far / (Far - Zproj * (Far - Near));
+	return MAX_COC_RADIUS * clamp( (Z - _FocusDistance) / _FocusRange, -1.0, 1.0 );
+}
+
+// Max CoC of the tile and its 8 neighbors
+float	GetDilatedTileCoC( uint2 _TileIndex )
+{
+	float	MaxCoC = 0.0;
+	for ( int Y=-1; Y <= 1; Y++ )
+		for ( int X=-1; X <= 1; X++ )
+			MaxCoC = max( MaxCoC, _TexTiles[clamp( int2(_TileIndex) + int2( X, Y ), 0, int2(_TilesCount)-1 )].y );
+	return MaxCoC;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// Classification & downsampling: each thread handles a 2x2 block of full resolution pixels
+groupshared float2	gs_TileMinMax[HALF_TILE_SIZE*HALF_TILE_SIZE];
+
+[numthreads( HALF_TILE_SIZE, HALF_TILE_SIZE, 1 )]
+void	CS_Tiles( uint3 _GroupID : SV_GROUPID, uint3 _ThreadID : SV_DISPATCHTHREADID, uint _ThreadIndex : SV_GROUPINDEX )
+{
+	uint2	PixelPosition = 2 * _ThreadID.xy;
+
+	float4	Color = 0.0;
+	float	CoC = 0.0;
+	float	MinCoC = MAX_COC_RADIUS, MaxCoC = 0.0;
+	[unroll]
+	for ( uint i=0; i < 4; i++ )
+	{
+		uint2	P = min( PixelPosition + uint2( i & 1, i >> 1 ), _TargetSize-1 );
+		float	PixelCoC = GetCoC( P );
+		Color += _TexSource[P];
+		CoC += PixelCoC;
+		MinCoC = min( MinCoC, abs( PixelCoC ) );
+		MaxCoC = max( MaxCoC, abs( PixelCoC ) );
+	}
+	_Out[_ThreadID.xy] = float4( 0.25 * Color.xyz, 0.25 * CoC );
+
+	// Reduce the tile's min & max
+	gs_TileMinMax[_ThreadIndex] = float2( MinCoC, MaxCoC );
+	GroupMemoryBarrierWithGroupSync();
+
+	[unroll]
+	for ( uint Stride=HALF_TILE_SIZE*HALF_TILE_SIZE/2; Stride > 0; Stride >>= 1 )
+	{
+		if ( _ThreadIndex < Stride )
+		{
+			float2	Other = gs_TileMinMax[_ThreadIndex + Stride];
+			gs_TileMinMax[_ThreadIndex] = float2( min( gs_TileMinMax[_ThreadIndex].x, Other.x ), max( gs_TileMinMax[_ThreadIndex].y, Other.y ) );
+		}
+		GroupMemoryBarrierWithGroupSync();
+	}
+
+	if ( _ThreadIndex == 0 )
+		_OutTiles[_GroupID.xy] = gs_TileMinMax[0];
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// Half resolution gather
+groupshared float4	gs_Apron[APRON_SIZE*APRON_SIZE];
+groupshared float	gs_DilatedCoC;
+
+[numthreads( HALF_TILE_SIZE, HALF_TILE_SIZE, 1 )]
+void	CS_Gather( uint3 _GroupID : SV_GROUPID, uint3 _ThreadID : SV_DISPATCHTHREADID, uint _ThreadIndex : SV_GROUPINDEX )
+{
+	if ( _ThreadIndex == 0 )
+		gs_DilatedCoC = GetDilatedTileCoC( _GroupID.xy );
+	GroupMemoryBarrierWithGroupSync();
+
+	float	DilatedCoC = gs_DilatedCoC;
+	if ( DilatedCoC < _InFocusThreshold )
+		return;	// The whole tile is sharp, CS_Combine won't read it
+
+	// Prefetch the tile & its apron
+	uint2	HalfSize = (_TargetSize + 1) >> 1;
+	int2	ApronOrigin = int2( HALF_TILE_SIZE * _GroupID.xy ) - MAX_COC_RADIUS;
+	for ( uint ApronIndex=_ThreadIndex; ApronIndex < APRON_SIZE*APRON_SIZE; ApronIndex += HALF_TILE_SIZE*HALF_TILE_SIZE )
+	{
+		int2	P = clamp( ApronOrigin + int2( ApronIndex % APRON_SIZE, ApronIndex / APRON_SIZE ), 0, int2(HalfSize)-1 );
+		gs_Apron[ApronIndex] = _TexHalf[P];
+	}
+	GroupMemoryBarrierWithGroupSync();
+
+	if ( any( _ThreadID.xy >= HalfSize ) )
+		return;
+
+	// Gather the samples whose CoC reaches us on concentric rings scaled by the dilated CoC
+	int2	Center = int2( _ThreadID.xy ) - ApronOrigin;
+	float4	CenterSample = gs_Apron[APRON_SIZE * Center.y + Center.x];
+	float	CenterWeight = 1.0 / max( 1.0, abs( CenterSample.w ) * abs( CenterSample.w ) );
+	float3	SumColor = CenterWeight * CenterSample.xyz;
+	float	SumWeight = CenterWeight;
+
+	float	RingStep = DilatedCoC / GATHER_RINGS;
+	for ( uint Ring=1; Ring <= GATHER_RINGS; Ring++ )
+	{
+		float	Distance = Ring * RingStep;
+		uint	SamplesCount = 8 * Ring;
+		for ( uint SampleIndex=0; SampleIndex < SamplesCount; SampleIndex++ )
+		{
+			float	Angle = 6.283185307 * (SampleIndex + 0.5 * (Ring & 1)) / SamplesCount;
+			int2	Offset = int2( round( Distance * float2( cos( Angle ), sin( Angle ) ) ) );
+			float4	Sample = gs_Apron[APRON_SIZE * (Center.y + Offset.y) + Center.x + Offset.x];
+
+			// Background samples can't bleed over a sharper foreground
+			float	SampleCoC = Sample.w < CenterSample.w ? abs( Sample.w ) : min( abs( Sample.w ), abs( CenterSample.w ) );
+			float	Weight = saturate( SampleCoC - Distance + 1.0 ) / max( 1.0, SampleCoC * SampleCoC );	// Bokeh energy is spread over its disk
+			SumColor += Weight * Sample.xyz;
+			SumWeight += Weight;
+		}
+	}
+
+	_Out[_ThreadID.xy] = float4( SumColor / SumWeight, saturate( abs( CenterSample.w ) ) );
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// Full resolution combine: each thread handles a 2x2 block of full resolution pixels
+[numthreads( HALF_TILE_SIZE, HALF_TILE_SIZE, 1 )]
+void	CS_Combine( uint3 _GroupID : SV_GROUPID, uint3 _ThreadID : SV_DISPATCHTHREADID, uint _ThreadIndex : SV_GROUPINDEX )
+{
+	if ( _ThreadIndex == 0 )
+		gs_DilatedCoC = GetDilatedTileCoC( _GroupID.xy );
+	GroupMemoryBarrierWithGroupSync();
+
+	bool	bSharpTile = gs_DilatedCoC < _InFocusThreshold;
+	float2	HalfSize = float2( (_TargetSize + 1) >> 1 );
+
+	[unroll]
+	for ( uint i=0; i < 4; i++ )
+	{
+		uint2	P = 2 * _ThreadID.xy + uint2( i & 1, i >> 1 );
+		if ( any( P >= _TargetSize ) )
+			continue;
+
+		float4	Sharp = _TexSource[P];
+		if ( bSharpTile )
+		{
+			_Out[P] = Sharp;
+			continue;
+		}
+
+		float4	Blurred = _TexGather.SampleLevel( LinearClamp, (0.5 * (P + 0.5)) / HalfSize, 0.0 );
+		float	Blend = saturate( 2.0 * abs( GetCoC( P ) ) - 0.5 );	// Start blending once the CoC covers a full resolution pixel
+		_Out[P] = float4( lerp( Sharp.xyz, Blurred.xyz, Blend ), Sharp.w );
+	}
+}
@@ -0,0 +1,188 @@
+//////////////////////////////////////////////////////////////////////////
+// Tiled deferred shading (cf. EffectDeferred::ShadeTiled() with TILED_DEFERRED_SHADING)
+// A single dispatch accumulates all the lights: each group handles a TILE_SIZE x TILE_SIZE tile of the screen,
+//	_ the threads reduce the tile's depth range in groupshared memory
+//	_ all the lights are culled against the tile's view space bounds in parallel, the visible ones being listed in groupshared memory
+//	_ each thread shades its pixel with the tile's list
+//
+// The G-Buffer layout depends on COMPACT_GBUFFER (cf. Inc/GBuffer.hlsl), the position is reconstructed from the depth buffer.
+// A non-zero _DebugView outputs one of the G-Buffer's attributes instead of the lighting.
+//
+#include "Inc/Global.hlsl"
+#include "Inc/GBuffer.hlsl"
+
+#define	TILE_SIZE				16		// !!IMPORTANT ==> Must correspond to EffectDeferred::TILE_SIZE!!
+#define	THREADS_COUNT			(TILE_SIZE*TILE_SIZE)
+#define	MAX_LIGHTS_PER_TILE		512
+
+#define	LIGHT_TYPE_OMNI			0		// !!IMPORTANT ==> Must correspond to EffectDeferred::Light::LIGHT_TYPE!!
+#define	LIGHT_TYPE_SPOT			1
+#define	LIGHT_TYPE_DIRECTIONAL	2
+
+#define	DEBUG_VIEW_NONE			0		// !!IMPORTANT ==> Must correspond to EffectDeferred::DEBUG_VIEW!!
+#define	DEBUG_VIEW_NORMAL		1
+#define	DEBUG_VIEW_ALBEDO		2
+#define	DEBUG_VIEW_ROUGHNESS	3
+#define	DEBUG_VIEW_METAL		4
+#define	DEBUG_VIEW_DEPTH		5
+
+cbuffer	cbTiledShading : register( b11 )
+{
+	uint2	_ScreenSize;
+	uint	_LightsCount;
+	uint	_DebugView;
+	float3	_Ambient;
+};
+
+struct	LightStruct
+{
+	float3	Position;
+	uint	Type;
+	float3	Direction;
+	float	__PAD1;
+	float3	Color;
+	float	__PAD2;
+	float4	Data;				// OMNI: X=Hotspot radius Y=Falloff radius, SPOT: X=Cos(Hotspot angle) Y=Cos(Falloff angle) Z=Length, DIRECTIONAL: X=Hotspot radius Y=Falloff radius Z=Length
+};
+
+Texture2D<float>				_TexDepth : register( t11 );
+StructuredBuffer<LightStruct>	_Lights : register( t12 );
+
+RWTexture2D<float4>				_OutLightAccumulation : register( u0 );
+
+groupshared uint	gs_MinZ;
+groupshared uint	gs_MaxZ;
+groupshared uint	gs_TileLightsCount;
+groupshared uint	gs_TileLightIndices[MAX_LIGHTS_PER_TILE];
+
+bool	IsLightInTile( LightStruct _Light, float3 _TileMin, float3 _TileMax )
+{
+	float	Radius;
+	switch ( _Light.Type )
+	{
+	case LIGHT_TYPE_OMNI:	Radius = _Light.Data.y; break;
+	case LIGHT_TYPE_SPOT:	Radius = _Light.Data.z; break;
+	default:				return true;	// Directional lights affect every tile
+	}
+
+	float3	ViewPosition = mul( float4( _Light.Position, 1.0 ), _World2Camera ).xyz;
+	float3	Delta = ViewPosition - clamp( ViewPosition, _TileMin, _TileMax );
+	return dot( Delta, Delta ) <= Radius * Radius;
+}
+
+float3	ComputeLight( LightStruct _Light, float3 _Position, float3 _Normal, float3 _View, float3 _DiffuseAlbedo, float3 _SpecularAlbedo, float _SpecularExponent )
+{
+	float3	ToLight;
+	float	Attenuation;
+	if ( _Light.Type == LIGHT_TYPE_DIRECTIONAL )
+	{
+		ToLight = -_Light.Direction;
+		Attenuation = 1.0;
+	}
+	else
+	{
+		ToLight = _Light.Position - _Position;
+		float	Distance = length( ToLight );
+		ToLight /= Distance;
+
+		if ( _Light.Type == LIGHT_TYPE_OMNI )
+			Attenuation = 1.0 - smoothstep( _Light.Data.x, _Light.Data.y, Distance );
+		else
+			Attenuation = smoothstep( _Light.Data.y, _Light.Data.x, dot( -ToLight, _Light.Direction ) ) * saturate( 1.0 - Distance / _Light.Data.z );
+	}
+
+	float	NdotL = saturate( dot( _Normal, ToLight ) );
+	float3	Half = normalize( ToLight + _View );
+	float3	Specular = _SpecularAlbedo * pow( saturate( dot( _Normal, Half ) ), _SpecularExponent );
+	return Attenuation * NdotL * _Light.Color * (_DiffuseAlbedo + Specular);
+}
+
+[numthreads( TILE_SIZE, TILE_SIZE, 1 )]
+void	CS( uint3 _GroupID : SV_GROUPID, uint3 _ThreadID : SV_DISPATCHTHREADID, uint _ThreadIndex : SV_GROUPINDEX )
+{
+	if ( _ThreadIndex == 0 )
+	{
+		gs_MinZ = 0x7F7FFFFF;	// FLT_MAX
+		gs_MaxZ = 0;
+		gs_TileLightsCount = 0;
+	}
+	GroupMemoryBarrierWithGroupSync();
+
+	//////////////////////////////////////////////////////////////////////////
+	// Reduce the depth range of the tile (positive floats keep their order as uints)
+	uint2	PixelPosition = min( _ThreadID.xy, _ScreenSize-1 );
+	float	Zproj = _TexDepth[PixelPosition];
+	float	Near = _CameraData.z;
+	float	Far = _CameraData.w;
+	float	Z = Near * Far / (Far - Zproj * (Far - Near));
+	bool	bSky = Zproj >= 1.0;
+	if ( !bSky )
+	{
+		InterlockedMin( gs_MinZ, asuint( Z ) );
+		InterlockedMax( gs_MaxZ, asuint( Z ) );
+	}
+	GroupMemoryBarrierWithGroupSync();
+
+	//////////////////////////////////////////////////////////////////////////
+	// Cull the lights against the view space bounds of the tile
+	float	ZMin = asfloat( gs_MinZ );
+	float	ZMax = asfloat( gs_MaxZ );
+	if ( ZMin <= ZMax )
+	{	// Not a sky tile
+		float2	NDCMin = 2.0 * (TILE_SIZE * _GroupID.xy) / _ScreenSize - 1.0;
+		float2	NDCMax = 2.0 * (TILE_SIZE * (_GroupID.xy+1)) / _ScreenSize - 1.0;
+		float2	TanMin = _CameraData.xy * float2( NDCMin.x, -NDCMax.y );	// Tile rows go down the screen
+		float2	TanMax = _CameraData.xy * float2( NDCMax.x, -NDCMin.y );
+		float3	TileMin = float3( min( TanMin * ZMin, TanMin * ZMax ), ZMin );
+		float3	TileMax = float3( max( TanMax * ZMin, TanMax * ZMax ), ZMax );
+
+		for ( uint LightIndex=_ThreadIndex; LightIndex < _LightsCount; LightIndex += THREADS_COUNT )
+			if ( IsLightInTile( _Lights[LightIndex], TileMin, TileMax ) )
+			{
+				uint	TileLightIndex;
+				InterlockedAdd( gs_TileLightsCount, 1, TileLightIndex );
+				if ( TileLightIndex < MAX_LIGHTS_PER_TILE )
+					gs_TileLightIndices[TileLightIndex] = LightIndex;
+			}
+	}
+	GroupMemoryBarrierWithGroupSync();
+
+	if ( any( _ThreadID.xy >= _ScreenSize ) )
+		return;
+	if ( bSky )
+	{
+		_OutLightAccumulation[_ThreadID.xy] = 0.0;
+		return;
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+	// Shade the pixel with the lights of the tile
+	float2	NDC = 2.0 * (_ThreadID.xy + 0.5) / _ScreenSize - 1.0;
+	float3	ViewPosition = Z * float3( _CameraData.xy * float2( NDC.x, -NDC.y ), 1.0 );
+	float3	Position = mul( float4( ViewPosition, 1.0 ), _Camera2World ).xyz;
+	float3	View = normalize( _Camera2World[3].xyz - Position );
+
+	GBufferSample	GBuffer = ReadGBuffer( _ThreadID.xy );
+
+	if ( _DebugView != DEBUG_VIEW_NONE )
+	{
+		float3	Debug = 0.0;
+		switch ( _DebugView )
+		{
+		case DEBUG_VIEW_NORMAL:		Debug = 0.5 + 0.5 * GBuffer.Normal; break;
+		case DEBUG_VIEW_ALBEDO:		Debug = GBuffer.Albedo; break;
+		case DEBUG_VIEW_ROUGHNESS:	Debug = GBuffer.Roughness; break;
+		case DEBUG_VIEW_METAL:		Debug = GBuffer.Metal; break;
+		case DEBUG_VIEW_DEPTH:		Debug = Z / Far; break;
+		}
+		_OutLightAccumulation[_ThreadID.xy] = float4( Debug, 1.0 );
+		return;
+	}
+
+	float3	Lighting = _Ambient * GBuffer.DiffuseAlbedo;
+	uint	TileLightsCount = min( gs_TileLightsCount, MAX_LIGHTS_PER_TILE );
+	for ( uint TileLightIndex=0; TileLightIndex < TileLightsCount; TileLightIndex++ )
+		Lighting += ComputeLight( _Lights[gs_TileLightIndices[TileLightIndex]], Position, GBuffer.Normal, View, GBuffer.DiffuseAlbedo, GBuffer.SpecularAlbedo, GBuffer.SpecularExponent );
+
+	_OutLightAccumulation[_ThreadID.xy] = float4( Lighting, 1.0 );
+}
@@ -0,0 +1,160 @@
+//////////////////////////////////////////////////////////////////////////
+// Hierarchical min/max depth pyramid (cf. Utility/DepthPyramid.h)
+// Each texel stores X=Nearest, Y=Farthest linear depth of the full resolution pixels it covers.
+// The pyramid's mip 0 is padded to a multiple of 64 so mips 0 to 6 are exact halves of each other:
+//	_ CS_Tiles, each group reduces a 64x64 tile of the depth buffer: every thread writes a 4x4 block of mip 0, its 2x2 block
+//		of mip 1 and its texel of mip 2, then the group keeps reducing its 16x16 texels of mip 2 in group-shared memory down
+//		to the single texel of mip 6
+//	_ CS_Tail, a single group reduces the (at most 64x64) mip 6 down to the last 1x1 mip in group-shared memory.
+//		Below mip 6 the sizes are halved rounding down, the last texel of an odd level also covers the extra column/row.
+//
+#include "Inc/Global.hlsl"
+
+#define	TILE_SIZE			64		// Pixels of mip 0 reduced by a CS_Tiles group
+#define	TAIL_THREADS		32		// Threads per side of the single CS_Tail group, covers mip 7 at most (4096 pixels at mip 0)
+#define	TAIL_MIPS_COUNT		6		// Mips 7 to 12
+
+cbuffer	cbDepthPyramid : register( b10 )
+{
+	uint2	_DepthSize;				// Size of the depth stencil buffer
+	uint2	_TailSize;				// Size of the mip 6
+	uint	_MipsCount;				// Total amount of mips in the pyramid
+};
+
+Texture2D<float>		_TexDepth : register( t10 );	// Full resolution depth stencil
+Texture2D<float2>		_TexMip6 : register( t11 );
+
+RWTexture2D<float2>		_OutMip0 : register( u0 );
+RWTexture2D<float2>		_OutMip1 : register( u1 );
+RWTexture2D<float2>		_OutMip2 : register( u2 );
+RWTexture2D<float2>		_OutMip3 : register( u3 );
+RWTexture2D<float2>		_OutMip4 : register( u4 );
+RWTexture2D<float2>		_OutMip5 : register( u5 );
+RWTexture2D<float2>		_OutMip6 : register( u6 );
+
+RWTexture2D<float2>		_OutTail[TAIL_MIPS_COUNT] : register( u0 );	// Mips 7 to 12
+
+// Converts a depth buffer value into a view depth
+float	LinearizeDepth( float _Z )
+{
+	float	Near = _CameraData.z;
+	float	Far = _CameraData.w;
+	return Near * Far / (Far - _Z * (Far - Near));
+}
+
+float2	MinMax( float2 a, float2 b )
+{
+	return float2( min( a.x, b.x ), max( a.y, b.y ) );
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+groupshared float2	gs_Tile[16*16];
+
+[numthreads( 16, 16, 1 )]
+void	CS_Tiles( uint3 _GroupID : SV_GroupID, uint3 _GroupThreadID : SV_GroupThreadID )
+{
+	// 1] Reduce the thread's 4x4 block, the padding repeats the last row & column of the depth buffer
+	uint2	Block = _GroupID.xy << 4 | _GroupThreadID.xy;
+	uint2	Pixel = Block << 2;
+	uint2	MaxPixel = _DepthSize - 1;
+
+	float2	Mip2 = float2( 1e6, 0.0 );
+	[unroll]
+	for ( uint Y1=0; Y1 < 2; Y1++ )
+		[unroll]
+		for ( uint X1=0; X1 < 2; X1++ )
+		{
+			float2	Mip1 = float2( 1e6, 0.0 );
+			[unroll]
+			for ( uint Y0=0; Y0 < 2; Y0++ )
+				[unroll]
+				for ( uint X0=0; X0 < 2; X0++ )
+				{
+					uint2	P = Pixel + uint2( 2*X1+X0, 2*Y1+Y0 );
+					float	Z = LinearizeDepth( _TexDepth[min( P, MaxPixel )] );
+					_OutMip0[P] = float2( Z, Z );
+					Mip1 = MinMax( Mip1, Z );
+				}
+
+			_OutMip1[(Block << 1) + uint2( X1, Y1 )] = Mip1;
+			Mip2 = MinMax( Mip2, Mip1 );
+		}
+
+	_OutMip2[Block] = Mip2;
+
+	// 2] Reduce the tile's 16x16 texels of mip 2 in group-shared memory
+	uint	ThreadIndex = 16 * _GroupThreadID.y + _GroupThreadID.x;
+	gs_Tile[ThreadIndex] = Mip2;
+	GroupMemoryBarrierWithGroupSync();
+
+	[unroll]
+	for ( uint Mip=3; Mip <= 6; Mip++ )
+	{
+		uint	Size = 64 >> Mip;
+		bool	bActive = all( _GroupThreadID.xy < Size );
+		uint2	Source = _GroupThreadID.xy << 1;
+		float2	Value = float2( 1e6, 0.0 );
+		if ( bActive )
+			Value = MinMax( MinMax( gs_Tile[16*Source.y+Source.x], gs_Tile[16*Source.y+Source.x+1] ),
+							MinMax( gs_Tile[16*(Source.y+1)+Source.x], gs_Tile[16*(Source.y+1)+Source.x+1] ) );
+		GroupMemoryBarrierWithGroupSync();
+
+		if ( bActive )
+		{
+			gs_Tile[ThreadIndex] = Value;
+			uint2	Texel = _GroupID.xy * Size + _GroupThreadID.xy;
+			if ( Mip == 3 )			_OutMip3[Texel] = Value;
+			else if ( Mip == 4 )	_OutMip4[Texel] = Value;
+			else if ( Mip == 5 )	_OutMip5[Texel] = Value;
+			else					_OutMip6[Texel] = Value;
+		}
+		GroupMemoryBarrierWithGroupSync();
+	}
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+groupshared float2	gs_Tail[64*64];
+
+[numthreads( TAIL_THREADS, TAIL_THREADS, 1 )]
+void	CS_Tail( uint3 _GroupThreadID : SV_GroupThreadID )
+{
+	// Load the mip 6, 2x2 texels per thread
+	[unroll]
+	for ( uint i=0; i < 4; i++ )
+	{
+		uint2	Texel = (_GroupThreadID.xy << 1) + uint2( i & 1, i >> 1 );
+		if ( all( Texel < _TailSize ) )
+			gs_Tail[64*Texel.y+Texel.x] = _TexMip6[Texel];
+	}
+	GroupMemoryBarrierWithGroupSync();
+
+	uint2	SourceSize = _TailSize;
+	[unroll]
+	for ( uint Mip=0; Mip < TAIL_MIPS_COUNT; Mip++ )
+	{
+		uint2	Size = max( 1, SourceSize >> 1 );
+		bool	bActive = 7+Mip < _MipsCount && all( _GroupThreadID.xy < Size );
+
+		float2	Value = float2( 1e6, 0.0 );
+		if ( bActive )
+		{	// The last texel of each row & column takes the texels left by the rounding
+			uint2	Start = _GroupThreadID.xy << 1;
+			uint2	End = min( _GroupThreadID.xy == Size-1 ? SourceSize : Start + 2, SourceSize );
+			for ( uint Y=Start.y; Y < End.y; Y++ )
+				for ( uint X=Start.x; X < End.x; X++ )
+					Value = MinMax( Value, gs_Tail[64*Y+X] );
+		}
+		GroupMemoryBarrierWithGroupSync();
+
+		if ( bActive )
+		{
+			gs_Tail[64*_GroupThreadID.y+_GroupThreadID.x] = Value;
+			_OutTail[Mip][_GroupThreadID.xy] = Value;
+		}
+		GroupMemoryBarrierWithGroupSync();
+
+		SourceSize = Size;
+	}
+}
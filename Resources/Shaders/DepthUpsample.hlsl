@@ -0,0 +1,117 @@
+//////////////////////////////////////////////////////////////////////////
+// Depth-aware upsampling of low resolution effects (cf. Utility/DepthUpsampler.h)
+//
+//	_ CS_DownsampleDepth, stores the nearest & farthest linear depths of the full resolution pixels covered by each low resolution pixel
+//	_ CS_Upsample, bilinearly interpolates the low resolution source where its depths match the full resolution depth
+//		and falls back to the low resolution pixel with the closest depth on edges so no halo bleeds across them.
+//		Define TARGET_ARRAY to write texture arrays (1 slice per thread group in Z).
+//
+#include "Inc/Global.hlsl"
+
+cbuffer	cbUpsample : register( b10 )
+{
+	uint2	_TargetSize;			// Full resolution
+	uint2	_SourceSize;			// Low resolution
+	uint	_DownsampleShift;		// Log2 of the downsampling factor
+	float	_DepthThreshold;		// Relative depth difference above which a pixel is considered to be on an edge
+};
+
+Texture2D<float>		_TexDepth : register( t10 );		// Full resolution depth stencil
+Texture2D<float2>		_TexLowResDepth : register( t11 );	// X=Nearest, Y=Farthest linear depth
+Texture2DArray<float4>	_TexSource : register( t12 );
+
+RWTexture2D<float2>		_OutDepth : register( u0 );
+#ifdef TARGET_ARRAY
+RWTexture2DArray<float4>	_Out : register( u0 );
+#else
+RWTexture2D<float4>		_Out : register( u0 );
+#endif
+
+// Converts a depth buffer value into a view depth
+float	LinearizeDepth( float _Z )
+{
+	float	Near = _CameraData.z;
+	float	Far = _CameraData.w;
+	return Near * Far / (Far - _Z * (Far - Near));
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+[numthreads( 8, 8, 1 )]
+void	CS_DownsampleDepth( uint3 _ThreadID : SV_DispatchThreadID )
+{
+	if ( any( _ThreadID.xy >= _SourceSize ) )
+		return;
+
+	uint	BlockSize = 1 << _DownsampleShift;
+	uint2	Start = _ThreadID.xy << _DownsampleShift;
+	uint2	End = min( Start + BlockSize, _TargetSize );
+
+	float2	NearFar = float2( 1e6, 0.0 );
+	for ( uint Y=Start.y; Y < End.y; Y++ )
+		for ( uint X=Start.x; X < End.x; X++ )
+		{
+			float	Z = LinearizeDepth( _TexDepth[uint2( X, Y )] );
+			NearFar = float2( min( NearFar.x, Z ), max( NearFar.y, Z ) );
+		}
+
+	_OutDepth[_ThreadID.xy] = NearFar;
+}
+
+//////////////////////////////////////////////////////////////////////////
+[numthreads( 8, 8, 1 )]
+void	CS_Upsample( uint3 _ThreadID : SV_DispatchThreadID )
+{
+	if ( any( _ThreadID.xy >= _TargetSize ) )
+		return;
+
+	float	Z = LinearizeDepth( _TexDepth[_ThreadID.xy] );
+	uint	Slice = _ThreadID.z;
+
+	// Locate the 4 closest low resolution pixels
+	float2	Position = (_ThreadID.xy + 0.5) / (1 << _DownsampleShift) - 0.5;
+	float2	Base = floor( Position );
+	float2	t = Position - Base;
+	int2	MaxPixel = int2( _SourceSize ) - 1;
+	int2	pPixels[4] = {
+		clamp( int2( Base ), 0, MaxPixel ),
+		clamp( int2( Base ) + int2( 1, 0 ), 0, MaxPixel ),
+		clamp( int2( Base ) + int2( 0, 1 ), 0, MaxPixel ),
+		clamp( int2( Base ) + int2( 1, 1 ), 0, MaxPixel ),
+	};
+
+	// Find the low resolution pixel with the closest depth and whether any of them differs too much
+	float	MaxDelta = 0.0;
+	float	MinDelta = 1e6;
+	uint	Nearest = 0;
+	[unroll]
+	for ( uint i=0; i < 4; i++ )
+	{
+		float2	NearFar = _TexLowResDepth[pPixels[i]];
+		float	Delta = min( abs( NearFar.x - Z ), abs( NearFar.y - Z ) );
+		MaxDelta = max( MaxDelta, Delta );
+		if ( Delta < MinDelta )
+		{
+			MinDelta = Delta;
+			Nearest = i;
+		}
+	}
+
+	float4	Result;
+	if ( MaxDelta < _DepthThreshold * Z )
+	{	// Continuous surface, interpolate
+		float4	V00 = _TexSource[uint3( pPixels[0], Slice )];
+		float4	V10 = _TexSource[uint3( pPixels[1], Slice )];
+		float4	V01 = _TexSource[uint3( pPixels[2], Slice )];
+		float4	V11 = _TexSource[uint3( pPixels[3], Slice )];
+		Result = lerp( lerp( V00, V10, t.x ), lerp( V01, V11, t.x ), t.y );
+	}
+	else	// Edge, use nearest-depth
+		Result = _TexSource[uint3( pPixels[Nearest], Slice )];
+
+#ifdef TARGET_ARRAY
+	_Out[_ThreadID] = Result;
+#else
+	_Out[_ThreadID.xy] = Result;
+#endif
+}
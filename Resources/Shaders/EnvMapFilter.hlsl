@@ -0,0 +1,226 @@
+//////////////////////////////////////////////////////////////////////////
+// Environment map prefiltering for image-based lighting (cf. Utility/EnvMapFilter.h)
+//	_ CS_Prefilter, one thread per texel of a mip of the prefiltered lat/long map: importance-samples the GGX lobe around
+//		the texel's direction (N = V = R) and reads each sample from the source mip whose texels cover the sample's solid angle
+//		(cf. "Real Shading in Unreal Engine 4", Karis 2013 & GPU Gems 3 chapter 20)
+//	_ CS_BRDF, pre-integrates the GGX BRDF into the scale (R) & bias (G) to apply to F0, indexed by (N.V, roughness)
+//	_ CS_ProjectSH, a single group where each thread projects a strip of the source mip onto SH9 weighted by the texels' solid angle,
+//		the 256 partial sums are then reduced in groupshared memory
+//
+#include "Inc/Global.hlsl"
+
+#define	THREADS_X	8
+#define	THREADS_Y	8
+#define	SH_THREADS	256
+
+cbuffer	cbEnvMapFilter : register( b10 )
+{
+	uint2	_SourceSize;		// Size of the source's mip 0
+	uint	_SourceMipsCount;
+	uint	_SamplesCount;
+	uint2	_TargetSize;		// Size of the mip being written (or of the SH source mip)
+	float	_Roughness;			// Perceptual roughness of the mip being written
+	uint	_SHSourceMip;
+};
+
+Texture2D<float4>			_TexSource : register( t10 );
+RWTexture2D<float4>			_Target : register( u0 );		// Prefiltered mip or BRDF table
+RWStructuredBuffer<float4>	_SH : register( u1 );			// 9 coefficients
+
+// Y-up lat/long mapping, cf. EnvMapFilter.h
+float3	LatLongUVToDirection( float2 _UV )
+{
+	float	Phi = 2.0 * PI * _UV.x;
+	float	Theta = PI * _UV.y;
+	float	SinTheta = sin( Theta );
+	return float3( SinTheta * cos( Phi ), cos( Theta ), SinTheta * sin( Phi ) );
+}
+
+float2	DirectionToLatLongUV( float3 _Direction )
+{
+	float	Phi = atan2( _Direction.z, _Direction.x );
+	float	Theta = acos( clamp( _Direction.y, -1.0, 1.0 ) );
+	return float2( frac( 0.5 * Phi / PI ), Theta / PI );
+}
+
+float2	Hammersley( uint _Index, uint _Count )
+{
+	return float2( (_Index + 0.5) / _Count, reversebits( _Index ) * 2.3283064365386963e-10 );
+}
+
+// Returns a half vector distributed by D_GGX * N.H around _Normal
+float3	ImportanceSampleGGX( float2 _Xi, float _Alpha, float3 _Normal )
+{
+	float	Phi = 2.0 * PI * _Xi.x;
+	float	CosTheta = sqrt( (1.0 - _Xi.y) / (1.0 + (_Alpha*_Alpha - 1.0) * _Xi.y) );
+	float	SinTheta = sqrt( 1.0 - CosTheta*CosTheta );
+	float3	H = float3( SinTheta * cos( Phi ), SinTheta * sin( Phi ), CosTheta );
+
+	float3	Up = abs( _Normal.z ) < 0.999 ? float3( 0, 0, 1 ) : float3( 1, 0, 0 );
+	float3	TangentX = normalize( cross( Up, _Normal ) );
+	float3	TangentY = cross( _Normal, TangentX );
+	return TangentX * H.x + TangentY * H.y + _Normal * H.z;
+}
+
+float	D_GGX( float _NdotH, float _Alpha )
+{
+	float	a2 = _Alpha * _Alpha;
+	float	Den = _NdotH * _NdotH * (a2 - 1.0) + 1.0;
+	return a2 / (PI * Den * Den);
+}
+
+// Height-correlated Smith visibility, G / (4 N.L N.V)
+float	V_SmithGGXCorrelated( float _NdotV, float _NdotL, float _Alpha )
+{
+	float	a2 = _Alpha * _Alpha;
+	float	GGXV = _NdotL * sqrt( _NdotV * _NdotV * (1.0 - a2) + a2 );
+	float	GGXL = _NdotV * sqrt( _NdotL * _NdotL * (1.0 - a2) + a2 );
+	return 0.5 / (GGXV + GGXL);
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+[numthreads( THREADS_X, THREADS_Y, 1 )]
+void	CS_Prefilter( uint3 _DispatchThreadID : SV_DispatchThreadID )
+{
+	uint2	Texel = _DispatchThreadID.xy;
+	if ( any( Texel >= _TargetSize ) )
+		return;
+
+	float3	N = LatLongUVToDirection( (Texel + 0.5) / _TargetSize );
+	float	Alpha = _Roughness * _Roughness;
+	float	MaxMip = _SourceMipsCount - 1.0;
+
+	float	SourceTexelSolidAngle = 4.0 * PI / (_SourceSize.x * _SourceSize.y);	// Averaged over the sphere
+	if ( Alpha == 0.0 )
+	{	// Mirror mip, simply resample the source at the target's resolution
+		float	Mip = clamp( log2( float(_SourceSize.x) / _TargetSize.x ), 0.0, MaxMip );
+		_Target[Texel] = float4( _TexSource.SampleLevel( LinearWrap, DirectionToLatLongUV( N ), Mip ).xyz, 1.0 );
+		return;
+	}
+
+	float3	Sum = 0.0;
+	float	SumWeights = 0.0;
+	for ( uint SampleIndex=0; SampleIndex < _SamplesCount; SampleIndex++ )
+	{
+		float3	H = ImportanceSampleGGX( Hammersley( SampleIndex, _SamplesCount ), Alpha, N );
+		float	NdotH = saturate( dot( N, H ) );
+		float3	L = 2.0 * NdotH * H - N;
+		float	NdotL = dot( N, L );
+		if ( NdotL <= 0.0 )
+			continue;
+
+		// With N = V, the PDF of L is D * N.H / (4 V.H) = D / 4
+		float	PDF = 0.25 * D_GGX( NdotH, Alpha );
+		float	SampleSolidAngle = 1.0 / (_SamplesCount * PDF + 1e-6);
+		float	Mip = clamp( 0.5 * log2( SampleSolidAngle / SourceTexelSolidAngle ) + 1.0, 0.0, MaxMip );
+
+		Sum += NdotL * _TexSource.SampleLevel( LinearWrap, DirectionToLatLongUV( L ), Mip ).xyz;
+		SumWeights += NdotL;
+	}
+
+	_Target[Texel] = float4( Sum / max( 1e-6, SumWeights ), 1.0 );
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+#define	BRDF_SAMPLES_COUNT	512
+
+[numthreads( THREADS_X, THREADS_Y, 1 )]
+void	CS_BRDF( uint3 _DispatchThreadID : SV_DispatchThreadID )
+{
+	uint2	Texel = _DispatchThreadID.xy;
+	float	NdotV = (Texel.x + 0.5) / _TargetSize.x;
+	float	Roughness = (Texel.y + 0.5) / _TargetSize.y;
+	float	Alpha = Roughness * Roughness;
+
+	float3	N = float3( 0, 0, 1 );
+	float3	V = float3( sqrt( 1.0 - NdotV*NdotV ), 0.0, NdotV );
+
+	float2	ScaleBias = 0.0;
+	for ( uint SampleIndex=0; SampleIndex < BRDF_SAMPLES_COUNT; SampleIndex++ )
+	{
+		float3	H = ImportanceSampleGGX( Hammersley( SampleIndex, BRDF_SAMPLES_COUNT ), Alpha, N );
+		float	VdotH = saturate( dot( V, H ) );
+		float3	L = 2.0 * VdotH * H - V;
+		float	NdotL = saturate( L.z );
+		if ( NdotL <= 0.0 )
+			continue;
+
+		// BRDF * N.L / PDF with PDF = D * N.H / (4 V.H)
+		float	NdotH = saturate( H.z );
+		float	G = V_SmithGGXCorrelated( NdotV, NdotL, Alpha ) * 4.0 * NdotL * VdotH / NdotH;
+		float	Fc = pow( 1.0 - VdotH, 5.0 );
+		ScaleBias += G * float2( 1.0 - Fc, Fc );
+	}
+
+	_Target[Texel] = float4( ScaleBias / BRDF_SAMPLES_COUNT, 0.0, 0.0 );
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// Same basis & order as SH::BuildSHCoeffs_YUp()
+void	EvaluateSH( float3 _Direction, out float _Y[9] )
+{
+	const float	f0 = 0.28209479177387814347403972578039;	// 0.5 / sqrt(PI)
+	const float	f1 = 1.7320508075688772935274463415059 * f0;
+	const float	f2 = 3.8729833462074168851792653997824 * f0;
+	const float	f3 = 1.1180339887498948482045868343656 * f0;
+
+	_Y[0] = f0;
+	_Y[1] = -f1 * _Direction.x;
+	_Y[2] = f1 * _Direction.y;
+	_Y[3] = -f1 * _Direction.z;
+	_Y[4] = f2 * _Direction.x * _Direction.z;
+	_Y[5] = -f2 * _Direction.x * _Direction.y;
+	_Y[6] = f3 * (3.0 * _Direction.y*_Direction.y - 1.0);
+	_Y[7] = -f2 * _Direction.z * _Direction.y;
+	_Y[8] = f2 * 0.5 * (_Direction.z*_Direction.z - _Direction.x*_Direction.x);
+}
+
+groupshared float3	gs_SH[SH_THREADS];
+
+[numthreads( SH_THREADS, 1, 1 )]
+void	CS_ProjectSH( uint _ThreadIndex : SV_GROUPINDEX )
+{
+	float3	pSH[9];
+	[unroll]
+	for ( uint i=0; i < 9; i++ )
+		pSH[i] = 0.0;
+
+	// Each thread takes every SH_THREADS-th texel, weighted by its solid angle dPhi * dTheta * sin(Theta)
+	uint	TexelsCount = _TargetSize.x * _TargetSize.y;
+	float	dPhiTheta = (2.0 * PI / _TargetSize.x) * (PI / _TargetSize.y);
+	for ( uint TexelIndex=_ThreadIndex; TexelIndex < TexelsCount; TexelIndex+=SH_THREADS )
+	{
+		uint2	Texel = uint2( TexelIndex % _TargetSize.x, TexelIndex / _TargetSize.x );
+		float2	UV = (Texel + 0.5) / _TargetSize;
+		float3	Direction = LatLongUVToDirection( UV );
+		float3	Radiance = _TexSource.Load( int3( Texel, _SHSourceMip ) ).xyz * dPhiTheta * sin( PI * UV.y );
+
+		float	Y[9];
+		EvaluateSH( Direction, Y );
+		[unroll]
+		for ( uint i=0; i < 9; i++ )
+			pSH[i] += Y[i] * Radiance;
+	}
+
+	// Reduce each coefficient over the group
+	[unroll]
+	for ( uint CoeffIndex=0; CoeffIndex < 9; CoeffIndex++ )
+	{
+		gs_SH[_ThreadIndex] = pSH[CoeffIndex];
+		GroupMemoryBarrierWithGroupSync();
+
+		for ( uint Stride=SH_THREADS/2; Stride > 0; Stride >>= 1 )
+		{
+			if ( _ThreadIndex < Stride )
+				gs_SH[_ThreadIndex] += gs_SH[_ThreadIndex + Stride];
+			GroupMemoryBarrierWithGroupSync();
+		}
+
+		if ( _ThreadIndex == 0 )
+			_SH[CoeffIndex] = float4( gs_SH[0], 0.0 );
+		GroupMemoryBarrierWithGroupSync();
+	}
+}
@@ -0,0 +1,16 @@
+//////////////////////////////////////////////////////////////////////////
+// Resets a slot of the shadow atlas to the far plane before its faces get rendered again (cf. EffectGlobalIllum2::RenderShadowAtlas())
+// The depth view can only be cleared entirely so the CPU restricts the viewport to the slot and draws the screen quad at Z=1
+//	with a "greater" depth test: every texel closer than the far plane gets overwritten.
+//
+#include "Inc/Global.hlsl"
+
+struct	VS_IN
+{
+	float4	__Position : SV_POSITION;
+};
+
+float4	VS( VS_IN _In ) : SV_POSITION
+{
+	return float4( _In.__Position.xy, 1.0, 1.0 );
+}
@@ -0,0 +1,102 @@
+//////////////////////////////////////////////////////////////////////////
+// Assigns the static & dynamic lights to the camera clusters (cf. EffectGlobalIllum2::CullLightClusters() with CLUSTERED_LIGHTS)
+// Clusters are screen tiles divided into exponential depth slices (cf. Inc/LightClusters.hlsl). Lights are numbered with the static
+//	lights first, followed by the dynamic lights.
+//
+// CS is dispatched with one thread per cluster:
+//	_ The lights whose influence sphere intersects the cluster's view space bounds are counted (directional lights affect all clusters)
+//	_ The cluster allocates that many entries of the shared index list with an atomic add on _OutIndicesCounter
+//	_ The lights are enumerated again to write their indices, clamped to the size of the list
+//
+#include "Inc/Global.hlsl"
+#include "Inc/LightClusters.hlsl"
+
+#define	THREADS_X	4
+#define	THREADS_Y	4
+#define	THREADS_Z	4
+
+#define	LIGHT_TYPE_DIRECTIONAL	1	// !!IMPORTANT ==> Must correspond to Scene::Light::DIRECTIONAL!!
+
+cbuffer	cbScene : register( b9 )
+{
+	uint	_StaticLightsCount;
+	uint	_DynamicLightsCount;
+	uint	_ProbesCount;
+};
+
+struct	LightStruct
+{
+	uint	Type;
+	float3	Position;
+	float3	Direction;
+	float3	Color;
+	float4	Parms;					// X=Falloff radius, Y=Cutoff radius, Z=Cos(Falloff angle), W=Cos(Cutoff angle)
+};
+
+StructuredBuffer<LightStruct>	_LightsStatic : register( t5 );
+StructuredBuffer<LightStruct>	_LightsDynamic : register( t6 );
+
+RWStructuredBuffer<uint2>		_OutClusterRanges : register( u0 );		// X=Start in the index list, Y=Count
+RWStructuredBuffer<uint>		_OutClusterLightIndices : register( u1 );
+RWStructuredBuffer<uint>		_OutIndicesCounter : register( u2 );	// Must be cleared to 0 before dispatch
+
+LightStruct	GetLight( uint _LightIndex )
+{
+	return _LightIndex < _StaticLightsCount ? _LightsStatic[_LightIndex] : _LightsDynamic[_LightIndex - _StaticLightsCount];
+}
+
+bool	IsLightInCluster( LightStruct _Light, float3 _ClusterMin, float3 _ClusterMax )
+{
+	if ( _Light.Type == LIGHT_TYPE_DIRECTIONAL )
+		return true;
+
+	// Distance where the light's irradiance becomes negligible
+	float	Intensity = max( max( _Light.Color.x, _Light.Color.y ), _Light.Color.z );
+	float	Radius = sqrt( Intensity / _ClusterInfluenceThreshold );
+	if ( Radius <= 0.0 )
+		return false;	// Switched off
+
+	float3	ViewPosition = mul( float4( _Light.Position, 1.0 ), _World2Camera ).xyz;
+	float3	Closest = clamp( ViewPosition, _ClusterMin, _ClusterMax );
+	float3	Delta = ViewPosition - Closest;
+	return dot( Delta, Delta ) <= Radius * Radius;
+}
+
+[numthreads( THREADS_X, THREADS_Y, THREADS_Z )]
+void	CS( uint3 _ThreadID : SV_DISPATCHTHREADID )
+{
+	if ( any( _ThreadID >= _ClustersCount ) )
+		return;
+
+	// Compute the view space bounds of the cluster's frustum
+	float2	NDCMin = 2.0 * _ThreadID.xy / _ClustersCount.xy - 1.0;
+	float2	NDCMax = 2.0 * (_ThreadID.xy + 1) / _ClustersCount.xy - 1.0;
+	float2	TanMin = _CameraData.xy * float2( NDCMin.x, -NDCMax.y );	// Tile rows go down the screen
+	float2	TanMax = _CameraData.xy * float2( NDCMax.x, -NDCMin.y );
+	float	ZMin = GetClusterSliceZ( _ThreadID.z );
+	float	ZMax = GetClusterSliceZ( _ThreadID.z+1 );
+
+	float3	ClusterMin = float3( min( TanMin * ZMin, TanMin * ZMax ), ZMin );
+	float3	ClusterMax = float3( max( TanMax * ZMin, TanMax * ZMax ), ZMax );
+
+	// Count the lights
+	uint	LightsCount = _StaticLightsCount + _DynamicLightsCount;
+	uint	ClusterLightsCount = 0;
+	for ( uint LightIndex=0; LightIndex < LightsCount; LightIndex++ )
+		if ( IsLightInCluster( GetLight( LightIndex ), ClusterMin, ClusterMax ) )
+			ClusterLightsCount++;
+
+	// Allocate our range of the index list
+	uint	Start;
+	InterlockedAdd( _OutIndicesCounter[0], ClusterLightsCount, Start );
+	ClusterLightsCount = Start < _ClusterMaxIndices ? min( ClusterLightsCount, _ClusterMaxIndices - Start ) : 0;
+
+	uint	ClusterIndex = _ThreadID.x + _ClustersCount.x * (_ThreadID.y + _ClustersCount.y * _ThreadID.z);
+	_OutClusterRanges[ClusterIndex] = uint2( Start, ClusterLightsCount );
+
+	// Write the indices
+	uint	WrittenCount = 0;
+	for ( uint LightIndex=0; LightIndex < LightsCount && WrittenCount < ClusterLightsCount; LightIndex++ )
+		if ( IsLightInCluster( GetLight( LightIndex ), ClusterMin, ClusterMax ) )
+			_OutClusterLightIndices[Start + WrittenCount++] = LightIndex;
+}
@@ -0,0 +1,177 @@
+//////////////////////////////////////////////////////////////////////////
+// Projects the MRT cube map rendered for a probe into SH (cf. SHProbeNetwork::PreComputeProbes())
+// The cube map is viewed as an array of 18 slices: albedo (cube 0) + (normal + distance) (cube 1) + (static lighting + emissive surface index) (cube 2)
+//
+// This is the GPU version of the static lighting & occlusion encoding of SHProbeEncoder::EncodeProbe():
+//	_ CS projects tiles of the cube faces and reduces them in group shared memory to a partial SH per tile
+//	_ CS_Reduce sums the partial SH into the final 9 coefficients that are read back by the CPU
+//
+// Each coefficient is a float4 with the static lighting in XYZ and the occlusion in W
+//
+// Faces may have been rendered at a lower resolution in the top-left corner of their slices (cf. ADAPTIVE_PROBE_CUBE_MAPS),
+//	their texels are then replicated over the CUBE_MAP_SIZE pixels like SHProbeEncoder::ReadBackProbeCubeMap() does
+//
+#define	CUBE_MAP_SIZE	128
+#define	THREADS_X		8
+#define	THREADS_Y		8
+#define	TILE_SIZE		32										// Each thread projects 4x4 pixels of its tile
+#define	TILES_COUNT		(CUBE_MAP_SIZE / TILE_SIZE)				// Amount of tiles along each dimension of a cube face
+#define	PARTIALS_COUNT	(6 * TILES_COUNT * TILES_COUNT)			// Amount of partial SH written by CS (must match SHProbeNetwork::PROBE_SH_PARTIALS_COUNT)
+#define	REDUCE_THREADS	128										// Next power of 2 above PARTIALS_COUNT
+
+static const float	PI = 3.1415926535897932384626433832795;
+static const float	Z_INFINITY_TEST = 0.99 * 1e6;				// Same as SHProbeEncoder::Z_INFINITY_TEST
+
+// Same SH coefficients as SHProbeEncoder::Pixel::InitSH()
+static const float	f0 = 0.5 / sqrt(PI);
+static const float	f1 = sqrt(3.0) * f0;
+static const float	f2 = sqrt(15.0) * f0;
+static const float	f3 = sqrt(5.0) * 0.5 * f0;
+
+// Same face transforms as SHProbeEncoder's constructor
+static const float3	SideAt[6] = {
+	float3(  1,  0,  0 ),
+	float3( -1,  0,  0 ),
+	float3(  0,  1,  0 ),
+	float3(  0, -1,  0 ),
+	float3(  0,  0,  1 ),
+	float3(  0,  0, -1 ),
+};
+static const float3	SideRight[6] = {
+	float3(  0, 0, -1 ),
+	float3(  0, 0,  1 ),
+	float3(  1, 0,  0 ),
+	float3(  1, 0,  0 ),
+	float3(  1, 0,  0 ),
+	float3( -1, 0,  0 ),
+};
+
+struct	SHCoeffs4 {
+	float4	pSH[9];
+};
+
+cbuffer	cbCubeMapFaces : register( b11 )
+{
+	uint4	_FaceSizes[2];		// Resolution each face was rendered at (must divide CUBE_MAP_SIZE), only the first 6 are used
+};
+
+Texture2DArray<float4>			_TexCubeMap : register( t0 );
+StructuredBuffer<SHCoeffs4>		_Partials : register( t1 );
+
+RWStructuredBuffer<SHCoeffs4>	_OutSH : register( u0 );		// Partial SH for CS, final SH for CS_Reduce
+
+groupshared float4	gs_SH[REDUCE_THREADS][9];
+
+
+// Smoothes the static lit color & infinity of the pixel like SHProbeEncoder::SmoothCubeMapPixels() does
+// NOTE: Unlike the CPU version, neighbors are clamped to the cube face instead of being fetched from the adjacent faces
+void	SmoothPixel( int2 _P, uint _CubeFaceIndex, out float3 _SmoothedStaticLitColor, out float _SmoothedInfinity )
+{
+	uint	FaceSize = _FaceSizes[_CubeFaceIndex >> 2][_CubeFaceIndex & 3];
+
+	float3	SumColor = 0.0;
+	float	SumInfinity = 0.0;
+	uint	Count = 0;
+	for ( int Y=-1; Y <= 1; Y++ )
+		for ( int X=-1; X <= 1; X++ )
+		{
+			int2	P = clamp( _P + int2( X, Y ), 0, CUBE_MAP_SIZE-1 ) * FaceSize / CUBE_MAP_SIZE;	// Texel of the face covering that pixel
+			float	Distance = _TexCubeMap[uint3( P, 6*1+_CubeFaceIndex )].w;
+			if ( Distance > Z_INFINITY_TEST )
+			{
+				SumInfinity += 1.0;
+				continue;
+			}
+
+			SumColor += _TexCubeMap[uint3( P, 6*2+_CubeFaceIndex )].xyz;
+			Count++;
+		}
+
+	_SmoothedStaticLitColor = Count > 0 ? SumColor / Count : 0.0;
+	_SmoothedInfinity = SumInfinity / 9.0;
+}
+
+// Reduces the 9 coefficients of the first _ThreadsCount threads into gs_SH[0]
+void	Reduce( uint _ThreadIndex, uint _ThreadsCount )
+{
+	for ( uint Stride=_ThreadsCount >> 1; Stride > 0; Stride >>= 1 )
+	{
+		if ( _ThreadIndex < Stride )
+		{
+			[unroll]
+			for ( int i=0; i < 9; i++ )
+				gs_SH[_ThreadIndex][i] += gs_SH[_ThreadIndex+Stride][i];
+		}
+		GroupMemoryBarrierWithGroupSync();
+	}
+}
+
+[numthreads( THREADS_X, THREADS_Y, 1 )]
+void	CS( uint3 _GroupID : SV_GROUPID, uint3 _GroupThreadID : SV_GROUPTHREADID, uint _GroupIndex : SV_GROUPINDEX )
+{
+	uint	CubeFaceIndex = _GroupID.z;
+	float3	Right = SideRight[CubeFaceIndex];
+	float3	Up = cross( SideAt[CubeFaceIndex], Right );
+	float3	At = SideAt[CubeFaceIndex];
+
+	float	dA = 4.0 / (CUBE_MAP_SIZE * CUBE_MAP_SIZE);	// Cube face is supposed to be in [-1,+1], yielding a 2x2 square units
+
+	float4	SH[9];
+	[unroll]
+	for ( int i=0; i < 9; i++ )
+		SH[i] = 0.0;
+
+	uint2	TileStart = TILE_SIZE * _GroupID.xy + _GroupThreadID.xy;
+	for ( uint Y=0; Y < TILE_SIZE; Y+=THREADS_Y )
+		for ( uint X=0; X < TILE_SIZE; X+=THREADS_X )
+		{
+			int2	P = TileStart + uint2( X, Y );
+
+			// Build world-space view vector & solid angle (dw = cos(Theta).dA / r^2 with cos(Theta) = 1/r)
+			float3	csView = float3( 2.0 * (0.5 + P.x) / CUBE_MAP_SIZE - 1.0, 1.0 - 2.0 * (0.5 + P.y) / CUBE_MAP_SIZE, 1.0 );
+			float	Distance2Texel = length( csView );
+			csView /= Distance2Texel;
+			float3	View = csView.x * Right + csView.y * Up + csView.z * At;
+			float	SolidAngle = dA / (Distance2Texel * Distance2Texel * Distance2Texel);
+
+			float3	SmoothedStaticLitColor;
+			float	SmoothedInfinity;
+			SmoothPixel( P, CubeFaceIndex, SmoothedStaticLitColor, SmoothedInfinity );
+
+			float4	Value = SolidAngle * float4( SmoothedStaticLitColor, SmoothedInfinity );
+			SH[0] += f0 * Value;
+			SH[1] += -f1 * View.x * Value;
+			SH[2] += f1 * View.y * Value;
+			SH[3] += -f1 * View.z * Value;
+			SH[4] += f2 * View.x * View.z * Value;
+			SH[5] += -f2 * View.x * View.y * Value;
+			SH[6] += f3 * (3.0 * View.y*View.y - 1.0) * Value;
+			SH[7] += -f2 * View.z * View.y * Value;
+			SH[8] += f2 * 0.5 * (View.z*View.z - View.x*View.x) * Value;
+		}
+
+	[unroll]
+	for ( int j=0; j < 9; j++ )
+		gs_SH[_GroupIndex][j] = SH[j];
+	GroupMemoryBarrierWithGroupSync();
+
+	Reduce( _GroupIndex, THREADS_X * THREADS_Y );
+
+	uint	PartialIndex = TILES_COUNT * (TILES_COUNT * _GroupID.z + _GroupID.y) + _GroupID.x;
+	if ( _GroupIndex < 9 )
+		_OutSH[PartialIndex].pSH[_GroupIndex] = gs_SH[0][_GroupIndex];
+}
+
+[numthreads( REDUCE_THREADS, 1, 1 )]
+void	CS_Reduce( uint _GroupIndex : SV_GROUPINDEX )
+{
+	[unroll]
+	for ( int i=0; i < 9; i++ )
+		gs_SH[_GroupIndex][i] = _GroupIndex < PARTIALS_COUNT ? _Partials[_GroupIndex].pSH[i] : 0.0;
+	GroupMemoryBarrierWithGroupSync();
+
+	Reduce( _GroupIndex, REDUCE_THREADS );
+
+	if ( _GroupIndex < 9 )
+		_OutSH[0].pSH[_GroupIndex] = gs_SH[0][_GroupIndex];
+}
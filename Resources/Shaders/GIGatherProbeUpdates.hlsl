@@ -0,0 +1,80 @@
+//////////////////////////////////////////////////////////////////////////
+// Gathers the update infos of the probes to update this frame (cf. SHProbeNetwork::UpdateDynamicProbes())
+// The static infos of all the probes are uploaded once at load time, each frame the CPU only sends the list of probes to update
+//	and the current colors of the emissive materials.
+//
+// CS is dispatched with one group per updated probe and writes the update buffers in the exact layout expected by GIUpdateProbe.hlsl:
+//	_ Thread 0 copies the probe's update infos and rebases its emissive surfaces start
+//	_ Each thread copies one of the probe's 128 samples
+//	_ The first threads copy the probe's emissive surfaces along with the color of their material
+//
+#define	SAMPLES_COUNT	128			// Must match SHProbe::SAMPLES_COUNT
+
+struct	ProbeUpdateRequest {
+	uint	ProbeIndex;				// Index of the probe to update
+	uint	EmissiveSurfacesStart;	// Index of the probe's first emissive surface in the output buffer
+};
+
+struct	RuntimeProbeUpdateInfo {
+	uint	Index;
+	uint	EmissiveSurfacesStart;
+	uint	EmissiveSurfacesCount;
+	uint4	NeighborProbeIDs;
+	float4	SHConvolution[9];
+};
+
+struct	RuntimeProbeUpdateSampleInfo {
+	float3	Position;
+	float3	Normal;
+	float3	Albedo;
+	float	Radius;
+};
+
+struct	StaticEmissiveSurfaceInfo {
+	uint	EmissiveMaterialIndex;	// Index of the surface's material in _EmissiveMaterialColors
+	float	SH[9];
+};
+
+struct	RuntimeProbeUpdateEmissiveSurfaceInfo {
+	float3	EmissiveColor;
+	float	SH[9];
+};
+
+StructuredBuffer<ProbeUpdateRequest>				_ProbeUpdateRequests : register( t17 );
+StructuredBuffer<RuntimeProbeUpdateInfo>			_StaticProbeUpdateInfos : register( t18 );		// One per probe, emissive surfaces start is the index in _StaticEmissiveSurfaces
+StructuredBuffer<RuntimeProbeUpdateSampleInfo>		_StaticProbeSamples : register( t19 );			// SAMPLES_COUNT per probe
+StructuredBuffer<StaticEmissiveSurfaceInfo>			_StaticEmissiveSurfaces : register( t20 );
+StructuredBuffer<float3>							_EmissiveMaterialColors : register( t21 );
+
+RWStructuredBuffer<RuntimeProbeUpdateInfo>				_OutProbeUpdateInfos : register( u0 );
+RWStructuredBuffer<RuntimeProbeUpdateSampleInfo>		_OutProbeSamples : register( u1 );
+RWStructuredBuffer<RuntimeProbeUpdateEmissiveSurfaceInfo>	_OutEmissiveSurfaces : register( u2 );
+
+[numthreads( SAMPLES_COUNT, 1, 1 )]
+void	CS( uint3 _GroupID : SV_GROUPID, uint _GroupIndex : SV_GROUPINDEX )
+{
+	uint					ProbeUpdateIndex = _GroupID.x;
+	ProbeUpdateRequest		Request = _ProbeUpdateRequests[ProbeUpdateIndex];
+	RuntimeProbeUpdateInfo	Infos = _StaticProbeUpdateInfos[Request.ProbeIndex];
+
+	// Copy the sample
+	_OutProbeSamples[SAMPLES_COUNT * ProbeUpdateIndex + _GroupIndex] = _StaticProbeSamples[SAMPLES_COUNT * Request.ProbeIndex + _GroupIndex];
+
+	// Copy the emissive surface
+	if ( _GroupIndex < Infos.EmissiveSurfacesCount )
+	{
+		StaticEmissiveSurfaceInfo				Surface = _StaticEmissiveSurfaces[Infos.EmissiveSurfacesStart + _GroupIndex];
+		RuntimeProbeUpdateEmissiveSurfaceInfo	Out;
+		Out.EmissiveColor = _EmissiveMaterialColors[Surface.EmissiveMaterialIndex];
+		Out.SH = Surface.SH;
+
+		_OutEmissiveSurfaces[Request.EmissiveSurfacesStart + _GroupIndex] = Out;
+	}
+
+	// Copy the probe infos
+	if ( _GroupIndex == 0 )
+	{
+		Infos.EmissiveSurfacesStart = Request.EmissiveSurfacesStart;
+		_OutProbeUpdateInfos[ProbeUpdateIndex] = Infos;
+	}
+}
@@ -0,0 +1,74 @@
+//////////////////////////////////////////////////////////////////////////
+// Resamples the final probe SH into a level of the irradiance volume (cf. SHProbeIrradianceVolume::Update())
+// CS is dispatched with one thread per cell of the level: the 4 probes of the tetrahedron containing the cell's center are
+//	blended and their L1 SH written to the 3 RGB channel textures, where the level occupies the slices [LevelIndex*Size, (LevelIndex+1)*Size[
+//	(the UAVs are views of that slab only so the thread's cell is its own index).
+//
+#include "Inc/Global.hlsl"
+#include "Inc/SHProbeStorage.hlsl"
+#include "Inc/ProbeGrid.hlsl"
+#include "Inc/ProbeTetrahedra.hlsl"
+
+#define	THREADS_X	4
+#define	THREADS_Y	4
+#define	THREADS_Z	4
+
+cbuffer	cbIrradianceVolume : register( b10 )
+{
+	float3	_wsLevelMin;			// World position of the minimum corner of the level
+	float	_CellSize;
+	uint	_LevelIndex;
+	uint	_LevelSize;				// Cells per axis
+};
+
+StructuredBuffer<SHProbeStorage>	_ProbeSHFinal : register( t8 );
+
+RWTexture3D<float4>		_OutSHRed : register( u0 );
+RWTexture3D<float4>		_OutSHGreen : register( u1 );
+RWTexture3D<float4>		_OutSHBlue : register( u2 );
+
+[numthreads( THREADS_X, THREADS_Y, THREADS_Z )]
+void	CS_Update( uint3 _CellIndex : SV_DISPATCHTHREADID )
+{
+	if ( any( _CellIndex >= _LevelSize ) )
+		return;
+
+	float3	wsPosition = _wsLevelMin + (_CellIndex + 0.5) * _CellSize;
+
+	float4	Weights;
+	uint	TetrahedronIndex = FindProbeTetrahedronNear( wsPosition, Weights );
+
+	float4	SHRed = 0.0, SHGreen = 0.0, SHBlue = 0.0;
+	if ( TetrahedronIndex != ~0U )
+	{
+		uint4	ProbeIDs = _ProbeTetrahedra[TetrahedronIndex].ProbeIDs;
+
+		[unroll]
+		for ( uint i=0; i < 4; i++ )
+		{
+			float3	SH[9];
+			DecodeProbeSH( _ProbeSHFinal[ProbeIDs[i]], SH );
+
+			SHRed += Weights[i] * float4( SH[0].x, SH[1].x, SH[2].x, SH[3].x );
+			SHGreen += Weights[i] * float4( SH[0].y, SH[1].y, SH[2].y, SH[3].y );
+			SHBlue += Weights[i] * float4( SH[0].z, SH[1].z, SH[2].z, SH[3].z );
+		}
+	}
+	else
+	{	// No tetrahedra, use the nearest probe if any
+		uint	ProbeID = FetchNearestProbe( wsPosition );
+		if ( ProbeID != ~0U )
+		{
+			float3	SH[9];
+			DecodeProbeSH( _ProbeSHFinal[ProbeID], SH );
+
+			SHRed = float4( SH[0].x, SH[1].x, SH[2].x, SH[3].x );
+			SHGreen = float4( SH[0].y, SH[1].y, SH[2].y, SH[3].y );
+			SHBlue = float4( SH[0].z, SH[1].z, SH[2].z, SH[3].z );
+		}
+	}
+
+	_OutSHRed[_CellIndex] = SHRed;
+	_OutSHGreen[_CellIndex] = SHGreen;
+	_OutSHBlue[_CellIndex] = SHBlue;
+}
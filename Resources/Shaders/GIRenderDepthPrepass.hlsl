@@ -0,0 +1,36 @@
+//////////////////////////////////////////////////////////////////////////
+// Lays down the scene's depth before it gets shaded (cf. DEPTH_PREPASS in EffectGlobalIllum2.h)
+// Reads the position-only streams of the scene primitives, the scene pass then only shades the visible pixels.
+// Positions must be transformed exactly like GIRenderScene2.hlsl does so the shading pass passes its "less equal" test.
+//
+#include "Inc/Global.hlsl"
+#include "Inc/PackedVertex.hlsl"
+
+cbuffer	cbObject : register( b10 )		// !!IMPORTANT ==> Must correspond to EffectGlobalIllum2::CBObject!!
+{
+	float4x4	_Local2World;
+	float3		_QuantizationMin;
+	float		__ObjectPAD0;
+	float3		_QuantizationSize;
+	uint		_InstancesStart;
+};
+
+#if PACKED_VERTICES
+typedef VS_IN_PACKED_POSITION	VS_IN;
+#else
+struct	VS_IN
+{
+	float3	Position : POSITION;
+};
+#endif
+
+float4	VS( VS_IN _In ) : SV_POSITION
+{
+#if PACKED_VERTICES
+	float3	Position = DecodePackedPosition( _In.Position, _QuantizationMin, _QuantizationSize );
+#else
+	float3	Position = _In.Position;
+#endif
+	float4	WorldPosition = mul( float4( Position, 1.0 ), _Local2World );
+	return mul( WorldPosition, _World2Proj );
+}
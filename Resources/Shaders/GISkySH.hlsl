@@ -0,0 +1,98 @@
+//////////////////////////////////////////////////////////////////////////
+// Projects the ambient sky onto SH9 (cf. EffectGlobalIllum2::UpdateSkySH())
+// The sky follows the CIE overcast model (1 + 2 cos(θ)) / 3, clamped below the horizon, tinted by the sky color.
+// CS is a single group where each thread integrates a strip of a regular (θ,ϕ) grid weighted by the cells' solid angle,
+//	the 256 partial sums are then reduced in groupshared memory and thread l*(l+1)+m writes coefficient (l,m):
+//	_ _OutSkySH[0..8] is the sky radiance windowed per band by exp(-(PI l/3)²/2) to avoid ringing (cf. Inc/SkySH.hlsl)
+//	_ _OutSkySH[9..17] is the same radiance convolved with the clamped cosine lobe, the irradiance received by a normal
+//
+#include "Inc/Global.hlsl"
+
+#define	THREADS_COUNT	256
+#define	MAX_THETA		40		// The grid has MAX_THETA x 2*MAX_THETA cells
+
+cbuffer	cbSkySH : register( b10 )
+{
+	float3	_SkyColor;			// Intensity * color, zero when the sky is disabled
+};
+
+RWStructuredBuffer<float4>	_OutSkySH : register( u0 );	// 9 radiance coefficients followed by the 9 irradiance coefficients
+
+// Same basis & order as SH::BuildSHCoeffs_YUp()
+void	EvaluateSH( float3 _Direction, out float _Y[9] )
+{
+	const float	f0 = 0.28209479177387814347403972578039;	// 0.5 / sqrt(PI)
+	const float	f1 = 1.7320508075688772935274463415059 * f0;
+	const float	f2 = 3.8729833462074168851792653997824 * f0;
+	const float	f3 = 1.1180339887498948482045868343656 * f0;
+
+	_Y[0] = f0;
+	_Y[1] = -f1 * _Direction.x;
+	_Y[2] = f1 * _Direction.y;
+	_Y[3] = -f1 * _Direction.z;
+	_Y[4] = f2 * _Direction.x * _Direction.z;
+	_Y[5] = -f2 * _Direction.x * _Direction.y;
+	_Y[6] = f3 * (3.0 * _Direction.y*_Direction.y - 1.0);
+	_Y[7] = -f2 * _Direction.z * _Direction.y;
+	_Y[8] = f2 * 0.5 * (_Direction.z*_Direction.z - _Direction.x*_Direction.x);
+}
+
+groupshared float	gs_SH[9][THREADS_COUNT];
+
+[numthreads( THREADS_COUNT, 1, 1 )]
+void	CS( uint _ThreadIndex : SV_GROUPINDEX )
+{
+	float	pSH[9];
+	[unroll]
+	for ( uint i=0; i < 9; i++ )
+		pSH[i] = 0.0;
+
+	const uint	CellsCount = MAX_THETA * 2 * MAX_THETA;
+	const float	dPhidTheta = (PI / MAX_THETA) * (PI / MAX_THETA);
+	for ( uint CellIndex=_ThreadIndex; CellIndex < CellsCount; CellIndex+=THREADS_COUNT )
+	{
+		float	Theta = PI * (0.5 + CellIndex / (2*MAX_THETA)) / MAX_THETA;
+		float	Phi = PI * (CellIndex % (2*MAX_THETA)) / MAX_THETA;
+		float	CosTheta = cos( Theta );
+		float	SinTheta = sin( Theta );
+		float3	Direction = float3( sin( Phi ) * SinTheta, CosTheta, cos( Phi ) * SinTheta );
+
+		float	Luminance = (1.0 + 2.0 * max( -0.5, CosTheta )) / 3.0;
+		float	SolidAngle = SinTheta * dPhidTheta;
+
+		float	Y[9];
+		EvaluateSH( Direction, Y );
+		[unroll]
+		for ( uint i=0; i < 9; i++ )
+			pSH[i] += Y[i] * Luminance * SolidAngle;
+	}
+
+	// Reduce all the coefficients at once
+	[unroll]
+	for ( uint CoeffIndex=0; CoeffIndex < 9; CoeffIndex++ )
+		gs_SH[CoeffIndex][_ThreadIndex] = pSH[CoeffIndex];
+	GroupMemoryBarrierWithGroupSync();
+
+	for ( uint Stride=THREADS_COUNT/2; Stride > 0; Stride >>= 1 )
+	{
+		if ( _ThreadIndex < Stride )
+		{
+			[unroll]
+			for ( uint CoeffIndex=0; CoeffIndex < 9; CoeffIndex++ )
+				gs_SH[CoeffIndex][_ThreadIndex] += gs_SH[CoeffIndex][_ThreadIndex + Stride];
+		}
+		GroupMemoryBarrierWithGroupSync();
+	}
+
+	if ( _ThreadIndex >= 9 )
+		return;
+
+	uint	l = _ThreadIndex < 1 ? 0 : (_ThreadIndex < 4 ? 1 : 2);
+	float	Window = exp( -0.5 * (PI * l / 3.0) * (PI * l / 3.0) );
+	float3	Radiance = (Window / (4.0 * PI)) * gs_SH[_ThreadIndex][0] * _SkyColor;	// Same normalization as the CIE projection this replaces
+
+	const float	pCosineLobe[3] = { PI, 2.0 * PI / 3.0, 0.25 * PI };	// Clamped cosine convolution of each band (Ramamoorthi & Hanrahan 2001)
+
+	_OutSkySH[_ThreadIndex] = float4( Radiance, 0.0 );
+	_OutSkySH[9+_ThreadIndex] = float4( pCosineLobe[l] * Radiance, 0.0 );
+}
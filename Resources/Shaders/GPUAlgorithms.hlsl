@@ -0,0 +1,288 @@
+//////////////////////////////////////////////////////////////////////////
+// GPU parallel primitives (cf. Utility/GPUAlgorithms.h)
+//
+//	_ CS_ScanBlocks & CS_AddBlockOffsets, exclusive prefix sum: each group scans a block of SCAN_BLOCK_SIZE elements in
+//		groupshared memory (work-efficient up & down sweeps) and writes its total, the totals are scanned the same way
+//		then added back to the blocks
+//	_ CS_Compact, scatters the flagged elements to their scanned offsets and writes the indirect dispatch arguments
+//	_ CS_Reduce, one group per segment reduces the segment with a tree in groupshared memory
+//	_ CS_RadixCount & CS_RadixScatter, one pass of an LSD radix sort of key-value pairs on RADIX_BITS bits: the groups
+//		count the digits of their block, the (digit-major) counts are scanned into each group's offsets per digit,
+//		then each group sorts its block locally by digit with 1-bit splits and scatters it, which keeps the sort stable
+//
+cbuffer	cbGPUAlgorithms : register( b10 )
+{
+	uint		_Count;				// Amount of elements (or segments for CS_Reduce)
+	uint		_Shift;				// Radix sort: position of the digit in the keys
+	uint		_GroupsCount;		// Radix sort: amount of blocks
+	uint		_ArgsGroupSize;		// Compaction: threads per group of the dispatch fed by the arguments
+
+	uint		_SegmentSize;		// Reduction: elements per segment
+	uint		_Operation;			// Reduction: 0=Sum 1=Min 2=Max
+};
+
+StructuredBuffer<uint>		_Input : register( t10 );
+StructuredBuffer<uint>		_InputValues : register( t11 );	// Radix sort values, compaction flags
+StructuredBuffer<uint>		_InputOffsets : register( t12 );	// Scanned block totals, compaction offsets, radix digit offsets
+StructuredBuffer<float>		_InputFloat : register( t13 );
+
+RWStructuredBuffer<uint>	_Output : register( u0 );
+RWStructuredBuffer<uint>	_OutputValues : register( u1 );	// Radix sort values, scan block totals
+RWByteAddressBuffer			_OutputArgs : register( u1 );		// Compaction: ThreadGroupCountXYZ + elements count
+RWStructuredBuffer<float>	_OutputFloat : register( u0 );
+
+
+//////////////////////////////////////////////////////////////////////////
+// Prefix sum
+#define SCAN_GROUP_SIZE	256
+#define SCAN_BLOCK_SIZE	512		// !!IMPORTANT ==> Must correspond to SCAN_BLOCK_SIZE in GPUAlgorithms.h!!
+
+groupshared uint	gs_Scan[SCAN_BLOCK_SIZE];
+
+// Exclusive scan of gs_Scan, returns the total
+uint	ScanBlock( uint _ThreadIndex )
+{
+	uint	Offset = 1;
+	[unroll]
+	for ( uint UpCount=SCAN_BLOCK_SIZE >> 1; UpCount > 0; UpCount >>= 1 )
+	{
+		GroupMemoryBarrierWithGroupSync();
+		[branch]
+		if ( _ThreadIndex < UpCount )
+			gs_Scan[Offset * (2*_ThreadIndex+2) - 1] += gs_Scan[Offset * (2*_ThreadIndex+1) - 1];
+		Offset <<= 1;
+	}
+	GroupMemoryBarrierWithGroupSync();
+
+	uint	Total = gs_Scan[SCAN_BLOCK_SIZE-1];
+	GroupMemoryBarrierWithGroupSync();
+	if ( _ThreadIndex == 0 )
+		gs_Scan[SCAN_BLOCK_SIZE-1] = 0;
+
+	[unroll]
+	for ( uint DownCount=1; DownCount < SCAN_BLOCK_SIZE; DownCount <<= 1 )
+	{
+		Offset >>= 1;
+		GroupMemoryBarrierWithGroupSync();
+		[branch]
+		if ( _ThreadIndex < DownCount )
+		{
+			uint	A = Offset * (2*_ThreadIndex+1) - 1;
+			uint	B = Offset * (2*_ThreadIndex+2) - 1;
+			uint	Left = gs_Scan[A];
+			gs_Scan[A] = gs_Scan[B];
+			gs_Scan[B] += Left;
+		}
+	}
+	GroupMemoryBarrierWithGroupSync();
+
+	return Total;
+}
+
+[numthreads( SCAN_GROUP_SIZE, 1, 1 )]
+void	CS_ScanBlocks( uint3 _GroupID : SV_GROUPID, uint _ThreadIndex : SV_GROUPINDEX )
+{
+	uint	Index = SCAN_BLOCK_SIZE * _GroupID.x + 2 * _ThreadIndex;
+	gs_Scan[2*_ThreadIndex+0] = Index+0 < _Count ? _Input[Index+0] : 0;
+	gs_Scan[2*_ThreadIndex+1] = Index+1 < _Count ? _Input[Index+1] : 0;
+
+	uint	Total = ScanBlock( _ThreadIndex );
+
+	if ( Index+0 < _Count )
+		_Output[Index+0] = gs_Scan[2*_ThreadIndex+0];
+	if ( Index+1 < _Count )
+		_Output[Index+1] = gs_Scan[2*_ThreadIndex+1];
+	if ( _ThreadIndex == 0 )
+		_OutputValues[_GroupID.x] = Total;
+}
+
+[numthreads( SCAN_GROUP_SIZE, 1, 1 )]
+void	CS_AddBlockOffsets( uint3 _GroupID : SV_GROUPID, uint _ThreadIndex : SV_GROUPINDEX )
+{
+	uint	Offset = _InputOffsets[_GroupID.x];
+	uint	Index = SCAN_BLOCK_SIZE * _GroupID.x + 2 * _ThreadIndex;
+	if ( Index+0 < _Count )
+		_Output[Index+0] += Offset;
+	if ( Index+1 < _Count )
+		_Output[Index+1] += Offset;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// Stream compaction
+#define COMPACT_GROUP_SIZE	256
+
+[numthreads( COMPACT_GROUP_SIZE, 1, 1 )]
+void	CS_Compact( uint3 _ThreadID : SV_DISPATCHTHREADID )
+{
+	uint	Index = _ThreadID.x;
+	if ( Index >= _Count )
+		return;
+
+	uint	Offset = _InputOffsets[Index];
+	uint	Flag = _InputValues[Index];
+	if ( Flag != 0 )
+		_Output[Offset] = _Input[Index];
+
+	if ( Index == _Count-1 )
+	{	// The last offset gives the total
+		uint	Total = Offset + Flag;
+		_OutputArgs.Store4( 0, uint4( (Total + _ArgsGroupSize-1) / _ArgsGroupSize, 1, 1, Total ) );
+	}
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// Segmented reduction
+#define REDUCE_GROUP_SIZE	256
+
+groupshared float	gs_Reduce[REDUCE_GROUP_SIZE];
+
+float	Reduce( float a, float b )
+{
+	return _Operation == 0 ? a + b : (_Operation == 1 ? min( a, b ) : max( a, b ));
+}
+
+[numthreads( REDUCE_GROUP_SIZE, 1, 1 )]
+void	CS_Reduce( uint3 _GroupID : SV_GROUPID, uint _ThreadIndex : SV_GROUPINDEX )
+{
+	float	Identity = _Operation == 0 ? 0.0 : (_Operation == 1 ? 3.402823466e+38 : -3.402823466e+38);
+
+	// Each thread reduces a strided part of the segment
+	uint	Start = _SegmentSize * _GroupID.x;
+	float	Result = Identity;
+	for ( uint Index=_ThreadIndex; Index < _SegmentSize; Index += REDUCE_GROUP_SIZE )
+		Result = Reduce( Result, _InputFloat[Start + Index] );
+	gs_Reduce[_ThreadIndex] = Result;
+
+	[unroll]
+	for ( uint Stride=REDUCE_GROUP_SIZE >> 1; Stride > 0; Stride >>= 1 )
+	{
+		GroupMemoryBarrierWithGroupSync();
+		[branch]
+		if ( _ThreadIndex < Stride )
+			gs_Reduce[_ThreadIndex] = Reduce( gs_Reduce[_ThreadIndex], gs_Reduce[_ThreadIndex + Stride] );
+	}
+
+	if ( _ThreadIndex == 0 )
+		_OutputFloat[_GroupID.x] = gs_Reduce[0];
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// Radix sort
+#define RADIX_BITS				4		// !!IMPORTANT ==> Must correspond to RADIX_BITS in GPUAlgorithms.h!!
+#define RADIX_DIGITS			(1 << RADIX_BITS)
+#define RADIX_GROUP_SIZE		256
+#define RADIX_ROUNDS			4		// Elements per thread
+#define RADIX_BLOCK_SIZE		(RADIX_GROUP_SIZE * RADIX_ROUNDS)	// !!IMPORTANT ==> Must correspond to RADIX_BLOCK_SIZE in GPUAlgorithms.h!!
+
+groupshared uint	gs_DigitCounts[RADIX_DIGITS];
+
+[numthreads( RADIX_GROUP_SIZE, 1, 1 )]
+void	CS_RadixCount( uint3 _GroupID : SV_GROUPID, uint _ThreadIndex : SV_GROUPINDEX )
+{
+	if ( _ThreadIndex < RADIX_DIGITS )
+		gs_DigitCounts[_ThreadIndex] = 0;
+	GroupMemoryBarrierWithGroupSync();
+
+	uint	Start = RADIX_BLOCK_SIZE * _GroupID.x;
+	[unroll]
+	for ( uint Round=0; Round < RADIX_ROUNDS; Round++ )
+	{
+		uint	Index = Start + RADIX_GROUP_SIZE * Round + _ThreadIndex;
+		if ( Index < _Count )
+			InterlockedAdd( gs_DigitCounts[(_Input[Index] >> _Shift) & (RADIX_DIGITS-1)], 1 );
+	}
+	GroupMemoryBarrierWithGroupSync();
+
+	// Digit-major so the scan of the whole list gives each group's offset for each digit
+	if ( _ThreadIndex < RADIX_DIGITS )
+		_Output[_GroupsCount * _ThreadIndex + _GroupID.x] = gs_DigitCounts[_ThreadIndex];
+}
+
+groupshared uint2	gs_Sort[RADIX_GROUP_SIZE];		// X=Key Y=Value
+groupshared uint	gs_Split[2*RADIX_GROUP_SIZE];	// Double-buffered scan of the split flags
+groupshared uint	gs_Digits[RADIX_GROUP_SIZE];
+groupshared uint	gs_DigitStarts[RADIX_DIGITS];	// Position of the first element of each digit in the sorted round
+groupshared uint	gs_DigitBases[RADIX_DIGITS];	// Destination of the next element of each digit
+
+// Exclusive scan of a flag per thread
+uint	ScanSplit( uint _ThreadIndex, uint _Flag, out uint _Total )
+{
+	uint	Buffer = 0;
+	gs_Split[_ThreadIndex] = _Flag;
+	GroupMemoryBarrierWithGroupSync();
+
+	[unroll]
+	for ( uint Offset=1; Offset < RADIX_GROUP_SIZE; Offset <<= 1 )
+	{
+		uint	Sum = gs_Split[Buffer + _ThreadIndex];
+		if ( _ThreadIndex >= Offset )
+			Sum += gs_Split[Buffer + max( _ThreadIndex, Offset ) - Offset];
+		Buffer ^= RADIX_GROUP_SIZE;
+		gs_Split[Buffer + _ThreadIndex] = Sum;
+		GroupMemoryBarrierWithGroupSync();
+	}
+
+	uint	Inclusive = gs_Split[Buffer + _ThreadIndex];
+	_Total = gs_Split[Buffer + RADIX_GROUP_SIZE-1];
+	GroupMemoryBarrierWithGroupSync();
+
+	return Inclusive - _Flag;
+}
+
+[numthreads( RADIX_GROUP_SIZE, 1, 1 )]
+void	CS_RadixScatter( uint3 _GroupID : SV_GROUPID, uint _ThreadIndex : SV_GROUPINDEX )
+{
+	if ( _ThreadIndex < RADIX_DIGITS )
+		gs_DigitBases[_ThreadIndex] = _InputOffsets[_GroupsCount * _ThreadIndex + _GroupID.x];
+
+	uint	Start = RADIX_BLOCK_SIZE * _GroupID.x;
+	for ( uint Round=0; Round < RADIX_ROUNDS; Round++ )
+	{
+		uint	RoundStart = Start + RADIX_GROUP_SIZE * Round;
+		uint	ValidCount = RoundStart < _Count ? min( RADIX_GROUP_SIZE, _Count - RoundStart ) : 0;	// No early exit, the barriers must be reached by the whole group
+
+		// The elements past the end get the last digit so they're sorted after all the valid ones
+		uint	Index = RoundStart + _ThreadIndex;
+		uint2	KeyValue = _ThreadIndex < ValidCount ? uint2( _Input[Index], _InputValues[Index] ) : uint2( ~0U, 0 );
+
+		// Stable sort of the round by digit, one bit at a time: the 0s keep their order first, then the 1s
+		for ( uint Bit=0; Bit < RADIX_BITS; Bit++ )
+		{
+			uint	Flag = 1 - ((KeyValue.x >> (_Shift + Bit)) & 1);
+			uint	ZerosCount;
+			uint	ZerosBefore = ScanSplit( _ThreadIndex, Flag, ZerosCount );
+			uint	Position = Flag != 0 ? ZerosBefore : ZerosCount + _ThreadIndex - ZerosBefore;
+
+			gs_Sort[Position] = KeyValue;
+			GroupMemoryBarrierWithGroupSync();
+			KeyValue = gs_Sort[_ThreadIndex];
+			GroupMemoryBarrierWithGroupSync();
+		}
+
+		// Find where each digit starts in the sorted round
+		uint	Digit = (KeyValue.x >> _Shift) & (RADIX_DIGITS-1);
+		gs_Digits[_ThreadIndex] = Digit;
+		GroupMemoryBarrierWithGroupSync();
+		if ( _ThreadIndex == 0 || gs_Digits[max( _ThreadIndex, 1 ) - 1] != Digit )
+			gs_DigitStarts[Digit] = _ThreadIndex;
+		GroupMemoryBarrierWithGroupSync();
+
+		uint	Rank = _ThreadIndex - gs_DigitStarts[Digit];
+		bool	bValid = _ThreadIndex < ValidCount;
+		if ( bValid )
+		{
+			uint	Destination = gs_DigitBases[Digit] + Rank;
+			_Output[Destination] = KeyValue.x;
+			_OutputValues[Destination] = KeyValue.y;
+		}
+		GroupMemoryBarrierWithGroupSync();
+
+		// The last element of each digit advances the digit's base for the next round
+		if ( bValid && (_ThreadIndex == ValidCount-1 || gs_Digits[min( _ThreadIndex+1, RADIX_GROUP_SIZE-1 )] != Digit) )
+			gs_DigitBases[Digit] += Rank + 1;
+		GroupMemoryBarrierWithGroupSync();
+	}
+}
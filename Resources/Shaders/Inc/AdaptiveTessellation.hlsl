@@ -0,0 +1,81 @@
+//////////////////////////////////////////////////////////////////////////
+// Screen-space adaptive tessellation of patches (cf. EffectRoom::CBTesselate)
+// Each edge is split so the generated segments span about _TargetEdgePixels on screen. The length of an edge is measured as the
+//	projected diameter of its bounding sphere rather than of the edge itself, so both patches sharing an edge compute the same
+//	factor (no cracks) and the factor doesn't drop when the edge is seen end-on.
+// Patches entirely outside of the frustum or facing away from the camera get 0 edge factors so the tessellator discards them
+//	before any domain shader invocation.
+// _TesselationBudget globally scales the factors down (e.g. lowered by the CPU when the scene produces too many triangles).
+//
+// Usage (in the patch constant function, with world space control points & normals):
+//	if ( IsPatchCulled( FrustumOutCode( P0, Displacement ) & FrustumOutCode( P1, Displacement ) & ..., IsBackFacing( P0, N0 ) && IsBackFacing( P1, N1 ) && ... ) )
+//		return 0 factors;
+//	Out.Edges[0] = EdgeTessFactor( P0, P1 );
+//	Out.Inside[0] = InsideTessFactor( Out.Edges[0], Out.Edges[2] );
+//
+#ifndef _ADAPTIVE_TESSELLATION_INC_
+#define _ADAPTIVE_TESSELLATION_INC_
+
+cbuffer	cbTesselate : register( b10 )	// !!IMPORTANT ==> Must correspond to EffectRoom::CBTesselate!!
+{
+	float3	_dUV;
+	float	_TargetEdgePixels;		// Screen length of the generated edges
+	float	_MaxTesselationFactor;	// Up to 64
+	float	_TesselationBudget;		// Global scale of the factors in ]0,1]
+};
+
+static const float	BACKFACE_THRESHOLD = 0.2;	// Cosine margin so displaced silhouettes of slightly back-facing patches are kept
+
+// Screen diameter (in pixels) of the sphere bounding the edge
+float	ProjectedEdgeLength( float3 _wsP0, float3 _wsP1 )
+{
+	float3	Center = 0.5 * (_wsP0 + _wsP1);
+	float3	Offset = 0.5 * length( _wsP1 - _wsP0 ) * _Camera2World[0].xyz;	// Along the camera's right axis so both ends share the same W
+
+	float4	ProjP0 = mul( float4( Center - Offset, 1.0 ), _World2Proj );
+	float4	ProjP1 = mul( float4( Center + Offset, 1.0 ), _World2Proj );
+	float	W = max( 1e-3, ProjP0.w );	// Edges crossing the near plane get the maximum factor
+
+	return 0.5 * abs( ProjP1.x - ProjP0.x ) / (W * _dUV.x);
+}
+
+float	EdgeTessFactor( float3 _wsP0, float3 _wsP1 )
+{
+	return clamp( _TesselationBudget * ProjectedEdgeLength( _wsP0, _wsP1 ) / _TargetEdgePixels, 1.0, _MaxTesselationFactor );
+}
+
+float	InsideTessFactor( float _EdgeFactor0, float _EdgeFactor1 )
+{
+	return max( _EdgeFactor0, _EdgeFactor1 );
+}
+
+// Returns the bits of the frustum planes the position lies outside of, inflated by the maximum displacement of the surface
+//	(all the control points of a patch must be outside of the same plane for the patch to be culled)
+uint	FrustumOutCode( float3 _wsPosition, float _Displacement )
+{
+	float4	Proj = mul( float4( _wsPosition, 1.0 ), _World2Proj );
+	float2	ProjScale = float2( mul( float4( _Camera2World[0].xyz, 0.0 ), _World2Proj ).x, mul( float4( _Camera2World[1].xyz, 0.0 ), _World2Proj ).y );
+	float2	Margin = abs( _Displacement * ProjScale );
+
+	uint	Code = 0;
+	Code |= Proj.x < -Proj.w - Margin.x ? 1U : 0U;
+	Code |= Proj.x > Proj.w + Margin.x ? 2U : 0U;
+	Code |= Proj.y < -Proj.w - Margin.y ? 4U : 0U;
+	Code |= Proj.y > Proj.w + Margin.y ? 8U : 0U;
+	Code |= Proj.w < -_Displacement ? 16U : 0U;	// Behind the camera
+	return Code;
+}
+
+bool	IsBackFacing( float3 _wsPosition, float3 _wsNormal )
+{
+	return dot( _wsNormal, normalize( _wsPosition - _Camera2World[3].xyz ) ) > BACKFACE_THRESHOLD;
+}
+
+// _CombinedOutCode, the AND of the FrustumOutCode() of all the control points
+// _bBackFacing, true if all the control points are back-facing
+bool	IsPatchCulled( uint _CombinedOutCode, bool _bBackFacing )
+{
+	return _CombinedOutCode != 0 || _bBackFacing;
+}
+
+#endif
@@ -0,0 +1,58 @@
+//////////////////////////////////////////////////////////////////////////
+// Sparse brick volumes (cf. Procedural/BrickVolume.h)
+// The indirection has one entry per brick of the volume giving the slot of the brick in the atlas, where each slot is the
+//	brick with a border of 1 voxel. Empty bricks point to the slot 0 that holds the empty value.
+//
+// Usage:
+//	#define BRICK_SIZE	16				// Before the include if the volume wasn't built with bricks of 8 voxels
+//	#include "Inc/BrickVolume.hlsl"
+//	(...)
+//	float4	Density = BrickVolumeSample( LinearClamp, UVW );
+//	if ( BrickVolumeIsEmpty( UVW ) ) { ... }	// Leap over the brick when ray-marching
+//
+#ifndef _BRICK_VOLUME_INC_
+#define _BRICK_VOLUME_INC_
+
+#ifndef BRICK_SIZE
+#define BRICK_SIZE	8					// !!IMPORTANT ==> Must correspond to the brick size given to the BrickVolume!!
+#endif
+
+static const float	BRICK_BORDER = 1.0;	// !!IMPORTANT ==> Must correspond to BrickVolume::BRICK_BORDER!!
+static const float	BRICK_SLOT_SIZE = BRICK_SIZE + 2.0 * BRICK_BORDER;
+
+Texture3D<uint4>	_TexBrickIndirection : register( t35 );	// XYZ=Slot of the brick in the atlas, W=1 if the brick isn't empty
+Texture3D			_TexBrickAtlas : register( t36 );
+
+// Returns the indirection entry of the brick containing _UVW and the voxel position of _UVW within the brick
+uint4	BrickVolumeGetBrick( float3 _UVW, out float3 _BrickPosition )
+{
+	uint3	BricksCount;
+	_TexBrickIndirection.GetDimensions( BricksCount.x, BricksCount.y, BricksCount.z );
+
+	float3	VolumePosition = saturate( _UVW ) * BricksCount * BRICK_SIZE;
+	uint3	Brick = min( uint3( VolumePosition / BRICK_SIZE ), BricksCount-1 );
+	_BrickPosition = VolumePosition - Brick * BRICK_SIZE;
+
+	return _TexBrickIndirection.Load( int4( Brick, 0 ) );
+}
+
+bool	BrickVolumeIsEmpty( float3 _UVW )
+{
+	float3	BrickPosition;
+	return BrickVolumeGetBrick( _UVW, BrickPosition ).w == 0;
+}
+
+// Trilinear sampling is seamless across bricks thanks to their borders (the atlas has no mips)
+float4	BrickVolumeSample( SamplerState _Sampler, float3 _UVW )
+{
+	float3	BrickPosition;
+	uint4	Entry = BrickVolumeGetBrick( _UVW, BrickPosition );
+
+	float3	AtlasSize;
+	_TexBrickAtlas.GetDimensions( AtlasSize.x, AtlasSize.y, AtlasSize.z );
+
+	float3	AtlasPosition = Entry.xyz * BRICK_SLOT_SIZE + BRICK_BORDER + BrickPosition;
+	return _TexBrickAtlas.SampleLevel( _Sampler, AtlasPosition / AtlasSize, 0.0 );
+}
+
+#endif	// _BRICK_VOLUME_INC_
@@ -0,0 +1,59 @@
+//////////////////////////////////////////////////////////////////////////
+// Empty space skipping for the cloud ray-march (cf. EffectVolumetric::BuildFractalTexture())
+// _TexFractalMinMax stores the min & max of the quantized fractal noise (_TexFractal1) in coarse cells of the same UVW space,
+//	dilated by one voxel so trilinear sampling never yields a value outside of the cell's range.
+//
+// Usage in the march loop:
+//	float	Skip = ComputeEmptySpaceSkip( UVW, dUVW, NoiseThreshold );
+//	if ( Skip > 0.0 ) { Distance += Skip * StepSize; continue; }	// No cloud in that cell, leap to its exit
+//	(...)
+//	if ( IsOpaque( Extinction ) ) break;						// Early termination
+//
+// NoiseThreshold is the noise value below which the density is 0 for the current coverage (i.e. the noise offset the density function subtracts).
+//
+#ifndef _CLOUD_EMPTY_SPACE_INC_
+#define _CLOUD_EMPTY_SPACE_INC_
+
+static const float3	FRACTAL_SIZE = float3( 180.0, 180.0, 16.0 );
+static const float3	EMPTY_SPACE_CELL_SIZE = float3( 6.0, 6.0, 4.0 );	// !!IMPORTANT ==> Must correspond to EffectVolumetric::FRACTAL_EMPTY_SPACE_CELL_XY/Z!!
+static const float3	EMPTY_SPACE_CELLS_COUNT = FRACTAL_SIZE / EMPTY_SPACE_CELL_SIZE;
+
+static const float	FRACTAL_SCALE_MIN = -0.15062222;	// !!IMPORTANT ==> Must correspond to the R8 packing in EffectVolumetric::BuildFractalTexture()!!
+static const float	FRACTAL_SCALE_MAX = 0.16956991;
+
+static const float	OPACITY_TERMINATION_EXTINCTION = 0.01;			// Stop marching once less than 1% of the background goes through
+
+Texture3D<float4>	_TexFractalMinMax : register( t18 );
+
+// Returns the (min,max) noise values found in the cell containing _UVW
+float2	GetCellNoiseRange( float3 _UVW )
+{
+	int3	Cell = int3( floor( frac( float3( _UVW.xy, 0.0 ) ) * EMPTY_SPACE_CELLS_COUNT ) );
+			Cell.z = clamp( int( _UVW.z * EMPTY_SPACE_CELLS_COUNT.z ), 0, int(EMPTY_SPACE_CELLS_COUNT.z) - 1 );	// No wrapping in Z
+
+	float2	MinMax = _TexFractalMinMax.Load( int4( Cell, 0 ) ).xy;
+	return lerp( FRACTAL_SCALE_MIN, FRACTAL_SCALE_MAX, MinMax );
+}
+
+// Returns the amount of steps we can leap over from _UVW when following _dUVW (the UVW increment of a single step)
+//	or 0 if the cell may contain some cloud
+float	ComputeEmptySpaceSkip( float3 _UVW, float3 _dUVW, float _NoiseThreshold )
+{
+	if ( GetCellNoiseRange( _UVW ).y > _NoiseThreshold )
+		return 0.0;	// Some cloud in there
+
+	// Find the distance to the exit of the cell, in steps
+	float3	CellPosition = _UVW * EMPTY_SPACE_CELLS_COUNT;
+	float3	Direction = _dUVW * EMPTY_SPACE_CELLS_COUNT;
+	float3	Exit = Direction > 0.0 ? floor( CellPosition ) + 1.0 : ceil( CellPosition ) - 1.0;
+	float3	StepsToExit = abs( Direction ) > 1e-6 ? (Exit - CellPosition) / Direction : 1e6;
+
+	return max( 1.0, ceil( min( min( StepsToExit.x, StepsToExit.y ), StepsToExit.z ) ) );
+}
+
+bool	IsOpaque( float3 _Extinction )
+{
+	return all( _Extinction < OPACITY_TERMINATION_EXTINCTION );
+}
+
+#endif
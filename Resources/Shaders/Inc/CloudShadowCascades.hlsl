@@ -0,0 +1,51 @@
+//////////////////////////////////////////////////////////////////////////
+// Cascaded cloud transmittance map (cf. EffectVolumetric::RenderShadowCascades() with CLOUD_SHADOW_CASCADES)
+// The transmittance map bound at t4 stores SHADOW_CASCADES_COUNT cascades of 2 slices each (the same 2 slices the single map used to have)
+//	from the coarsest (cascade 0 at slices 0 & 1) to the finest, each covering half the size of the previous one.
+// The cascades are fixed in the world and centered on the camera so the finest one gives a constant close-range resolution.
+//
+// Usage:
+//	float3	UVSlice = GetShadowCascadeUVSlice( WorldPositionKm );	// XY=UV, Z=first slice of the cascade
+//	float4	C0 = _TexTransmittanceMap.SampleLevel( LinearClamp, float3( UVSlice.xy, UVSlice.z ), 0.0 );
+//	float4	C1 = _TexTransmittanceMap.SampleLevel( LinearClamp, float3( UVSlice.xy, UVSlice.z+1 ), 0.0 );
+//
+#ifndef _CLOUD_SHADOW_CASCADES_INC_
+#define _CLOUD_SHADOW_CASCADES_INC_
+
+static const uint	SHADOW_CASCADES_COUNT = 4;	// !!IMPORTANT ==> Must correspond to EffectVolumetric::SHADOW_CASCADES_COUNT!!
+static const float	SHADOW_CASCADE_BORDER_UV = 0.02;	// Margin kept inside a cascade so bilinear filtering never reads the texels being scrolled in
+
+cbuffer	cbShadowCascades : register( b11 )
+{
+	float4x4	_World2Cascade[SHADOW_CASCADES_COUNT];	// XY=Cascade UV, Z=Same as the legacy World2Shadow
+};
+
+// Returns the UV in the finest cascade containing the position and the index of the cascade's first slice
+float3	GetShadowCascadeUVSlice( float3 _WorldPositionKm, out float _ZShadow )
+{
+	float4	Position = float4( _WorldPositionKm, 1.0 );
+	float3	Shadow = mul( Position, _World2Cascade[0] ).xyz;
+	uint	CascadeIndex = 0;
+
+	[unroll]
+	for ( uint i=1; i < SHADOW_CASCADES_COUNT; i++ )
+	{
+		float3	CascadeShadow = mul( Position, _World2Cascade[i] ).xyz;
+		if ( all( CascadeShadow.xy > SHADOW_CASCADE_BORDER_UV ) && all( CascadeShadow.xy < 1.0 - SHADOW_CASCADE_BORDER_UV ) )
+		{
+			Shadow = CascadeShadow;
+			CascadeIndex = i;
+		}
+	}
+
+	_ZShadow = Shadow.z;
+	return float3( Shadow.xy, 2.0 * CascadeIndex );
+}
+
+float3	GetShadowCascadeUVSlice( float3 _WorldPositionKm )
+{
+	float	ZShadow;
+	return GetShadowCascadeUVSlice( _WorldPositionKm, ZShadow );
+}
+
+#endif
@@ -0,0 +1,41 @@
+//////////////////////////////////////////////////////////////////////////
+// Hierarchical min/max depth pyramid bound at t56 (cf. Utility/DepthPyramid.h)
+// Each texel of mip N stores X=Nearest, Y=Farthest linear depth of the 2^N x 2^N block of screen pixels starting at texel<<N.
+// The pyramid is built once per frame after the opaque geometry, so effects needing conservative depth bounds (occlusion
+//	culling, ray marching start & end, SSAO/SSR tracing, tile classification, etc.) share a single reduction.
+//
+// Usage:
+//	float2	NearFar = DepthPyramidLoad( PixelPosition, 3 );			// Depth bounds of the 8x8 block containing the pixel
+//	float2	NearFar = DepthPyramidRect( PixelMin, PixelMax );		// Conservative depth bounds of a screen rectangle
+//
+#ifndef _DEPTH_PYRAMID_INC_
+#define _DEPTH_PYRAMID_INC_
+
+Texture2D<float2>	_TexDepthPyramid : register( t56 );
+
+// Returns the depth bounds of the block of the given mip containing the pixel
+float2	DepthPyramidLoad( uint2 _Pixel, uint _Mip )
+{
+	uint2	Size;
+	uint	MipsCount;
+	_TexDepthPyramid.GetDimensions( _Mip, Size.x, Size.y, MipsCount );
+	return _TexDepthPyramid.Load( int3( min( _Pixel >> _Mip, Size-1 ), _Mip ) );
+}
+
+// Returns the conservative depth bounds of the screen rectangle [_PixelMin,_PixelMax] (inclusive) with 4 fetches
+//	in the smallest mip where the rectangle covers at most 2x2 texels
+float2	DepthPyramidRect( uint2 _PixelMin, uint2 _PixelMax )
+{
+	uint2	Extent = _PixelMax - _PixelMin;
+	uint2	Size;
+	uint	MipsCount;
+	_TexDepthPyramid.GetDimensions( 0, Size.x, Size.y, MipsCount );
+	uint	Mip = min( firstbithigh( max( 1, max( Extent.x, Extent.y ) ) ) + 1, MipsCount-1 );
+	float2	A = DepthPyramidLoad( uint2( _PixelMin.x, _PixelMin.y ), Mip );
+	float2	B = DepthPyramidLoad( uint2( _PixelMax.x, _PixelMin.y ), Mip );
+	float2	C = DepthPyramidLoad( uint2( _PixelMin.x, _PixelMax.y ), Mip );
+	float2	D = DepthPyramidLoad( uint2( _PixelMax.x, _PixelMax.y ), Mip );
+	return float2( min( min( A.x, B.x ), min( C.x, D.x ) ), max( max( A.y, B.y ), max( C.y, D.y ) ) );
+}
+
+#endif
@@ -0,0 +1,49 @@
+//////////////////////////////////////////////////////////////////////////
+// Dynamic objects drawn with a single instanced call (cf. EffectGlobalIllum2::DynamicObjectInstance)
+// The vertex shader fetches its instance with SV_InstanceID and resolves the probes lighting it on the GPU, so the CPU only uploads
+//	the objects' positions once per frame whatever their amount.
+//
+// Usage:
+//	#include "Inc/ProbeGrid.hlsl"
+//	#include "Inc/ProbeTetrahedra.hlsl"
+//	#include "Inc/DynamicObjects.hlsl"
+//	(...)
+//	DynamicObjectInstance	Object = _DynamicObjects[_In.InstanceID];
+//	float3	wsPosition = Object.Position + Object.Radius * _In.Position;
+//	uint4	ProbeIDs;
+//	float4	ProbeWeights;
+//	GetDynamicObjectProbes( Object, ProbeIDs, ProbeWeights );
+//
+#ifndef _DYNAMIC_OBJECTS_INC_
+#define _DYNAMIC_OBJECTS_INC_
+
+struct	DynamicObjectInstance
+{
+	float3	Position;
+	float	Radius;
+	float3	PreviousPosition;		// Position at the previous frame
+	uint	__PAD;
+};
+
+StructuredBuffer<DynamicObjectInstance>	_DynamicObjects : register( t44 );
+
+#if defined(_PROBE_GRID_INC_) && defined(_PROBE_TETRAHEDRA_INC_)
+// Returns the 4 probes to blend for the object's indirect lighting & their weights (that sum to 1)
+// The probes only depend on the object's center so all the vertices of an instance get the same result
+void	GetDynamicObjectProbes( DynamicObjectInstance _Object, out uint4 _ProbeIDs, out float4 _Weights )
+{
+	uint	TetrahedronIndex = FindProbeTetrahedronNear( _Object.Position, _Weights );
+	if ( TetrahedronIndex != ~0U )
+	{
+		_ProbeIDs = _ProbeTetrahedra[TetrahedronIndex].ProbeIDs;
+		return;
+	}
+
+	// No tetrahedra, the nearest probe gets all the weight (or none if there are no probes at all)
+	uint	ProbeID = FetchNearestProbe( _Object.Position );
+	_ProbeIDs = uint4( ProbeID != ~0U ? ProbeID : 0, 0, 0, 0 );
+	_Weights = float4( ProbeID != ~0U ? 1.0 : 0.0, 0.0, 0.0, 0.0 );
+}
+#endif
+
+#endif
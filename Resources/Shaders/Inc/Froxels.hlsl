@@ -0,0 +1,57 @@
+//////////////////////////////////////////////////////////////////////////
+// Froxel fog (cf. EffectVolumetric::RenderFroxels() with FROXEL_FOG)
+// The camera frustum is cut into _FroxelsSize cells: XY follow the screen UVs and Z is split into exponential slices
+//	from _FroxelNearKm to _FroxelFarKm. The integrated volume bound at t19 stores, for each froxel, the fog accumulated
+//	from the camera up to the far end of the froxel's slice: RGB=In-scattered light, A=Transmittance.
+//
+// Usage in any opaque or transparent shader:
+//	SurfaceColor = ApplyFroxelFog( SurfaceColor, ScreenUV, ViewZKm );
+//
+#ifndef _FROXELS_INC_
+#define _FROXELS_INC_
+
+static const uint	MAX_FROXEL_POINT_LIGHTS = 8;	// !!IMPORTANT ==> Must correspond to EffectVolumetric::MAX_FROXEL_POINT_LIGHTS!!
+
+cbuffer	cbFroxels : register( b12 )
+{
+	uint3		_FroxelsSize;
+	uint		_FroxelPointLightsCount;
+	float		_FroxelNearKm;
+	float		_FroxelFarKm;
+	float		_FroxelTemporalWeight;
+	uint		_bFroxelHistoryValid;
+	float4x4	_FroxelPreviousWorld2Proj;
+	float		_FroxelJitterZ;
+	uint		_bFroxelTerrainShadow;
+	float2		__FroxelPAD;
+	float4		_FroxelPointLights[2*MAX_FROXEL_POINT_LIGHTS];	// 2 per light: XYZ=Position (km) W=Radius (km), then RGB=Intensity
+};
+
+Texture3D<float4>	_TexFroxelFog : register( t19 );
+
+// Converts a normalized slice position in [0,1] into a view depth (km) and back
+float	FroxelWToViewZ( float _W )
+{
+	return _FroxelNearKm * pow( _FroxelFarKm / _FroxelNearKm, _W );
+}
+
+float	ViewZToFroxelW( float _ViewZ )
+{
+	return log( max( _ViewZ, 1e-6 ) / _FroxelNearKm ) / log( _FroxelFarKm / _FroxelNearKm );
+}
+
+// Returns the fog between the camera and a surface at the given depth: RGB=In-scattered light, A=Transmittance
+float4	SampleFroxelFog( float2 _UV, float _ViewZ )
+{
+	// Texel k holds the fog up to the end of slice k, i.e. up to W=(k+1)/SizeZ
+	float	W = ViewZToFroxelW( _ViewZ ) - 0.5 / _FroxelsSize.z;
+	return _TexFroxelFog.SampleLevel( LinearClamp, float3( _UV, saturate( W ) ), 0.0 );
+}
+
+float3	ApplyFroxelFog( float3 _Color, float2 _UV, float _ViewZ )
+{
+	float4	Fog = SampleFroxelFog( _UV, _ViewZ );
+	return _Color * Fog.w + Fog.xyz;
+}
+
+#endif
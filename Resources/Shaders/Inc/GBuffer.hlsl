@@ -0,0 +1,125 @@
+//////////////////////////////////////////////////////////////////////////
+// Deferred G-Buffer layout (cf. EffectDeferred with COMPACT_GBUFFER)
+// The position is never stored, it's reconstructed from the depth buffer. With COMPACT_GBUFFER the G-Buffer is 8 bytes per pixel:
+//	t10: RG = Octahedral world normal remapped to [0,1] (cf. RenderTargetFormats::GBUFFER_NORMAL)
+//	t13: RGB = Albedo, A = Roughness on 7 bits | Metal on 1 bit (cf. RenderTargetFormats::GBUFFER_MATERIAL)
+// Otherwise it's the original 2 RGBA16F slices (32 bytes per pixel):
+//	t10 Slice 0: XYZ=World normal W=Specular exponent
+//	t10 Slice 1: XYZ=Diffuse albedo W=Specular albedo
+//
+// Both layouts are decoded into the same GBufferSample so the lighting doesn't depend on the layout.
+//
+// Usage:
+//	GBUFFER_OUT	PS( PS_IN _In )	{ return EncodeGBuffer( Normal, Albedo, Roughness, Metal ); }	// In DeferredFillGBuffer.hlsl
+//	GBufferSample	Sample = ReadGBuffer( PixelPosition );							// In the lighting pass
+//
+#ifndef _GBUFFER_INC_
+#define _GBUFFER_INC_
+
+#include "Inc/PackedVertex.hlsl"
+
+static const float	DIELECTRIC_F0 = 0.04;	// Specular albedo of non-metals
+
+struct	GBufferSample
+{
+	float3	Normal;
+	float3	Albedo;
+	float	Roughness;
+	float	Metal;
+
+	// Derived terms for the Blinn-Phong lighting
+	float3	DiffuseAlbedo;
+	float3	SpecularAlbedo;
+	float	SpecularExponent;
+};
+
+// Blinn-Phong exponent matching the GGX lobe of alpha = Roughness²
+float	Roughness2SpecularExponent( float _Roughness )
+{
+	float	Alpha2 = max( 1e-4, _Roughness * _Roughness * _Roughness * _Roughness );
+	return 2.0 / Alpha2 - 2.0;
+}
+
+float	SpecularExponent2Roughness( float _SpecularExponent )
+{
+	return pow( 2.0 / (_SpecularExponent + 2.0), 0.25 );
+}
+
+#ifdef COMPACT_GBUFFER
+
+struct	GBUFFER_OUT
+{
+	float2	Normal		: SV_TARGET0;
+	float4	Material	: SV_TARGET1;
+};
+
+Texture2D<float2>	_TexGBufferNormal : register( t10 );
+Texture2D<float4>	_TexGBufferMaterial : register( t13 );
+
+GBUFFER_OUT	EncodeGBuffer( float3 _Normal, float3 _Albedo, float _Roughness, float _Metal )
+{
+	uint	PackedRoughnessMetal = (uint( 127.0 * saturate( _Roughness ) + 0.5 ) << 1) | (_Metal > 0.5 ? 1U : 0U);
+
+	GBUFFER_OUT	Out;
+	Out.Normal = 0.5 + 0.5 * EncodeOctahedral( normalize( _Normal ) );
+	Out.Material = float4( saturate( _Albedo ), PackedRoughnessMetal / 255.0 );
+	return Out;
+}
+
+GBufferSample	ReadGBuffer( uint2 _PixelPosition )
+{
+	float4	Material = _TexGBufferMaterial[_PixelPosition];
+	uint	PackedRoughnessMetal = uint( 255.0 * Material.w + 0.5 );
+
+	GBufferSample	Out;
+	Out.Normal = DecodeOctahedral( 2.0 * _TexGBufferNormal[_PixelPosition] - 1.0 );
+	Out.Albedo = Material.xyz;
+	Out.Roughness = (PackedRoughnessMetal >> 1) / 127.0;
+	Out.Metal = PackedRoughnessMetal & 1U;
+
+	Out.DiffuseAlbedo = Out.Albedo * (1.0 - Out.Metal);
+	Out.SpecularAlbedo = lerp( DIELECTRIC_F0, Out.Albedo, Out.Metal );
+	Out.SpecularExponent = Roughness2SpecularExponent( Out.Roughness );
+	return Out;
+}
+
+#else	// Original RGBA16F layout
+
+struct	GBUFFER_OUT
+{
+	float4	Normal_SpecularExponent			: SV_TARGET0;
+	float4	DiffuseAlbedo_SpecularAlbedo	: SV_TARGET1;
+};
+
+Texture2DArray<float4>	_TexGBuffer : register( t10 );
+
+GBUFFER_OUT	EncodeGBuffer( float3 _Normal, float3 _Albedo, float _Roughness, float _Metal )
+{
+	float	SpecularAlbedo = lerp( DIELECTRIC_F0, dot( _Albedo, float3( 0.2126, 0.7152, 0.0722 ) ), _Metal );
+
+	GBUFFER_OUT	Out;
+	Out.Normal_SpecularExponent = float4( normalize( _Normal ), Roughness2SpecularExponent( _Roughness ) );
+	Out.DiffuseAlbedo_SpecularAlbedo = float4( _Albedo * (1.0 - _Metal), SpecularAlbedo );
+	return Out;
+}
+
+GBufferSample	ReadGBuffer( uint2 _PixelPosition )
+{
+	float4	Normal_SpecularExponent = _TexGBuffer[uint3( _PixelPosition, 0 )];
+	float4	DiffuseAlbedo_SpecularAlbedo = _TexGBuffer[uint3( _PixelPosition, 1 )];
+
+	GBufferSample	Out;
+	Out.Normal = normalize( Normal_SpecularExponent.xyz );
+	Out.Albedo = DiffuseAlbedo_SpecularAlbedo.xyz;
+	Out.Roughness = SpecularExponent2Roughness( Normal_SpecularExponent.w );
+	Out.Metal = 0.0;
+
+	Out.DiffuseAlbedo = DiffuseAlbedo_SpecularAlbedo.xyz;
+	Out.SpecularAlbedo = DiffuseAlbedo_SpecularAlbedo.w;
+	Out.SpecularExponent = Normal_SpecularExponent.w;
+	return Out;
+}
+
+#endif
+
+#endif
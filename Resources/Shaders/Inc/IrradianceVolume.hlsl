@@ -0,0 +1,69 @@
+//////////////////////////////////////////////////////////////////////////
+// Camera-centered irradiance volume resampled from the probe network (cf. SHProbeIrradianceVolume)
+// The volume is made of nested levels of IRRADIANCE_VOLUME_SIZE^3 cells each twice as large as the previous level's, stacked
+//	along Z in 3 textures storing the L1 SH of the red, green & blue channels. Dynamic objects and particles sample it
+//	with a single fetch per channel instead of looking up the probes themselves.
+//
+// Usage:
+//	float3	SH[4];
+//	SampleIrradianceVolume( wsPosition, SH );
+//	(...)									// Evaluate the SH like the probes' with the L2 band left to 0
+//
+#ifndef _IRRADIANCE_VOLUME_INC_
+#define _IRRADIANCE_VOLUME_INC_
+
+static const uint	IRRADIANCE_VOLUME_LEVELS = 3;		// !!IMPORTANT ==> Must correspond to SHProbeIrradianceVolume::LEVELS_COUNT!!
+static const uint	IRRADIANCE_VOLUME_SIZE = 32;		// !!IMPORTANT ==> Must correspond to SHProbeIrradianceVolume::LEVEL_SIZE!!
+
+struct	IrradianceVolumeLevel
+{
+	float3	wsMin;					// World position of the minimum corner of the level
+	float	InvSize;				// 1 / (CellSize * IRRADIANCE_VOLUME_SIZE)
+};
+
+Texture3D	_TexIrradianceVolumeRed : register( t40 );
+Texture3D	_TexIrradianceVolumeGreen : register( t41 );
+Texture3D	_TexIrradianceVolumeBlue : register( t42 );
+StructuredBuffer<IrradianceVolumeLevel>	_IrradianceVolumeLevels : register( t43 );
+
+// Returns the finest level containing the position with a margin of one cell (so the trilinear filtering never reads the neighbor level)
+//	and the position's UVW within the level, the coarsest level is clamped
+uint	GetIrradianceVolumeLevel( float3 _wsPosition, out float3 _UVW )
+{
+	const float	Margin = 1.0 / IRRADIANCE_VOLUME_SIZE;
+
+	uint	LevelIndex = 0;
+	[loop]
+	for ( ; LevelIndex < IRRADIANCE_VOLUME_LEVELS; LevelIndex++ )
+	{
+		IrradianceVolumeLevel	Level = _IrradianceVolumeLevels[LevelIndex];
+		_UVW = (_wsPosition - Level.wsMin) * Level.InvSize;
+		if ( all( _UVW >= Margin && _UVW <= 1.0 - Margin ) )
+			return LevelIndex;
+	}
+
+	_UVW = saturate( _UVW );
+	return IRRADIANCE_VOLUME_LEVELS-1;
+}
+
+// Returns the 4 L1 SH coefficients at the provided world position
+void	SampleIrradianceVolume( float3 _wsPosition, out float3 _SH[4] )
+{
+	float3	UVW;
+	uint	LevelIndex = GetIrradianceVolumeLevel( _wsPosition, UVW );
+
+	// Keep the W coordinate within the level's slices
+	UVW.z = clamp( UVW.z * IRRADIANCE_VOLUME_SIZE, 0.5, IRRADIANCE_VOLUME_SIZE - 0.5 );
+	UVW.z = (LevelIndex * IRRADIANCE_VOLUME_SIZE + UVW.z) / (IRRADIANCE_VOLUME_LEVELS * IRRADIANCE_VOLUME_SIZE);
+
+	float4	SHRed = _TexIrradianceVolumeRed.SampleLevel( LinearClamp, UVW, 0.0 );
+	float4	SHGreen = _TexIrradianceVolumeGreen.SampleLevel( LinearClamp, UVW, 0.0 );
+	float4	SHBlue = _TexIrradianceVolumeBlue.SampleLevel( LinearClamp, UVW, 0.0 );
+
+	_SH[0] = float3( SHRed.x, SHGreen.x, SHBlue.x );
+	_SH[1] = float3( SHRed.y, SHGreen.y, SHBlue.y );
+	_SH[2] = float3( SHRed.z, SHGreen.z, SHBlue.z );
+	_SH[3] = float3( SHRed.w, SHGreen.w, SHBlue.w );
+}
+
+#endif
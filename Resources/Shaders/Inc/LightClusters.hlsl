@@ -0,0 +1,51 @@
+//////////////////////////////////////////////////////////////////////////
+// Clustered lights (cf. EffectGlobalIllum2::CullLightClusters() with CLUSTERED_LIGHTS)
+// The view frustum is divided into _ClustersCount.x x _ClustersCount.y screen tiles, each cut into _ClustersCount.z slices whose depth grows
+//	exponentially from the near to the far clip. GICullLightClusters.hlsl lists the lights affecting each cluster in a compact index list.
+// Light indices number the static lights first, followed by the dynamic lights.
+//
+// Usage in the scene pixel shader:
+//	uint2	Range = GetClusterLightsRange( _In.__Position.xy, ViewZ );
+//	for ( uint i=0; i < Range.y; i++ )
+//	{
+//		uint	LightIndex = _ClusterLightIndices[Range.x+i];
+//		LightStruct	Light = LightIndex < _StaticLightsCount ? _SBLightsStatic[LightIndex] : _SBLightsDynamic[LightIndex-_StaticLightsCount];
+//		(...)
+//	}
+//
+#ifndef _LIGHT_CLUSTERS_INC_
+#define _LIGHT_CLUSTERS_INC_
+
+cbuffer	cbLightClusters : register( b12 )
+{
+	uint3	_ClustersCount;
+	uint	_ClusterMaxIndices;				// Size of the index list
+	float2	_ClusterZNearFar;				// Depth range covered by the slices
+	float2	_ClusterScreenSize;				// Size of the render target in pixels
+	float	_ClusterInfluenceThreshold;		// Irradiance below which a light doesn't affect a cluster anymore
+};
+
+StructuredBuffer<uint2>	_ClusterRanges : register( t27 );			// X=Start in the index list, Y=Count
+StructuredBuffer<uint>	_ClusterLightIndices : register( t28 );
+
+// Returns the view depth of the start of a slice
+float	GetClusterSliceZ( uint _SliceIndex )
+{
+	return _ClusterZNearFar.x * pow( _ClusterZNearFar.y / _ClusterZNearFar.x, float(_SliceIndex) / _ClustersCount.z );
+}
+
+uint	GetClusterIndex( float2 _PixelPosition, float _ViewZ )
+{
+	uint2	Tile = min( uint2( _PixelPosition * _ClustersCount.xy / _ClusterScreenSize ), _ClustersCount.xy-1 );
+	float	Slice = _ClustersCount.z * log( max( 1.0, _ViewZ / _ClusterZNearFar.x ) ) / log( _ClusterZNearFar.y / _ClusterZNearFar.x );
+	uint	SliceIndex = min( uint( Slice ), _ClustersCount.z-1 );
+	return Tile.x + _ClustersCount.x * (Tile.y + _ClustersCount.y * SliceIndex);
+}
+
+// Returns the start & count of the cluster's lights in _ClusterLightIndices
+uint2	GetClusterLightsRange( float2 _PixelPosition, float _ViewZ )
+{
+	return _ClusterRanges[GetClusterIndex( _PixelPosition, _ViewZ )];
+}
+
+#endif
@@ -0,0 +1,62 @@
+//////////////////////////////////////////////////////////////////////////
+// Scene material textures packed into texture arrays (cf. TextureArrayPacker and EffectGlobalIllum2 with TEXTURE_ARRAYS defined)
+// All the arrays are bound once for the entire scene and each material stores the slots of its textures, a slot being
+//	the index of the array in its upper 16 bits and the slice in its lower 16 bits.
+//
+// Usage:
+//	#include "Inc/MaterialTextureArrays.hlsl"
+//	(...)
+//	MaterialTextures	Textures = _MaterialTextures[_MaterialID];
+//	float3	DiffuseAlbedo = SampleMaterialTexture( Textures.DiffuseSlot, LinearWrap, UV, 1.0 ).xyz;
+//
+#ifndef _MATERIAL_TEXTURE_ARRAYS_INC_
+#define _MATERIAL_TEXTURE_ARRAYS_INC_
+
+static const uint	MAX_MATERIAL_TEXTURE_ARRAYS = 8;	// !!IMPORTANT ==> Must correspond to EffectGlobalIllum2::MAX_MATERIAL_TEXTURE_ARRAYS!!
+static const uint	INVALID_TEXTURE_SLOT = ~0U;
+
+struct	MaterialTextures
+{
+	uint	DiffuseSlot;
+	uint	NormalSlot;
+	uint	SpecularSlot;
+	uint	__PAD;
+};
+
+Texture2DArray<float4>	_TexMaterialArray0 : register( t45 );
+Texture2DArray<float4>	_TexMaterialArray1 : register( t46 );
+Texture2DArray<float4>	_TexMaterialArray2 : register( t47 );
+Texture2DArray<float4>	_TexMaterialArray3 : register( t48 );
+Texture2DArray<float4>	_TexMaterialArray4 : register( t49 );
+Texture2DArray<float4>	_TexMaterialArray5 : register( t50 );
+Texture2DArray<float4>	_TexMaterialArray6 : register( t51 );
+Texture2DArray<float4>	_TexMaterialArray7 : register( t52 );
+
+StructuredBuffer<MaterialTextures>	_MaterialTextures : register( t53 );	// Indexed by material ID
+
+// Samples the texture of the provided slot, or returns _Default for INVALID_TEXTURE_SLOT
+// The derivatives are computed before branching so the mips stay correct whatever the array each pixel of the quad reads
+float4	SampleMaterialTexture( uint _Slot, SamplerState _Sampler, float2 _UV, float4 _Default )
+{
+	float2	dUVdx = ddx( _UV );
+	float2	dUVdy = ddy( _UV );
+	float3	UVW = float3( _UV, _Slot & 0xFFFF );
+
+	float4	Result = _Default;
+	[branch]
+	switch ( _Slot >> 16 )
+	{
+	case 0: Result = _TexMaterialArray0.SampleGrad( _Sampler, UVW, dUVdx, dUVdy ); break;
+	case 1: Result = _TexMaterialArray1.SampleGrad( _Sampler, UVW, dUVdx, dUVdy ); break;
+	case 2: Result = _TexMaterialArray2.SampleGrad( _Sampler, UVW, dUVdx, dUVdy ); break;
+	case 3: Result = _TexMaterialArray3.SampleGrad( _Sampler, UVW, dUVdx, dUVdy ); break;
+	case 4: Result = _TexMaterialArray4.SampleGrad( _Sampler, UVW, dUVdx, dUVdy ); break;
+	case 5: Result = _TexMaterialArray5.SampleGrad( _Sampler, UVW, dUVdx, dUVdy ); break;
+	case 6: Result = _TexMaterialArray6.SampleGrad( _Sampler, UVW, dUVdx, dUVdy ); break;
+	case 7: Result = _TexMaterialArray7.SampleGrad( _Sampler, UVW, dUVdx, dUVdy ); break;
+	}
+
+	return Result;
+}
+
+#endif
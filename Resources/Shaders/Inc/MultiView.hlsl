@@ -0,0 +1,64 @@
+//////////////////////////////////////////////////////////////////////////
+// Multi-view rendering (cf. Utility/MultiView.h)
+// Each object is drawn once, instanced for each view seeing it: the vertex shader finds the view of its instance and the slice
+//	of the render target array is selected with SV_RenderTargetArrayIndex, output by a pass-through geometry shader since
+//	D3D11.0 doesn't let the vertex shader output it.
+//
+// Usage:
+//	VS_OUT	VS( VS_IN _In, uint _InstanceID : SV_INSTANCEID )
+//	{
+//		uint	ViewIndex = MultiViewIndex( _InstanceID );
+//		Out.__Position = mul( WorldPosition, _MultiViewWorld2Proj[ViewIndex] );
+//		Out.ViewIndex = ViewIndex;		// Declared as "nointerpolation uint ViewIndex : VIEW_INDEX"
+//	}
+//
+//	[maxvertexcount( 3 )]
+//	void	GS( triangle VS_OUT _In[3], inout TriangleStream<PS_IN> _Out )
+//	{
+//		for ( uint i=0; i < 3; i++ )
+//		{
+//			PS_IN	Out;
+//			(...)							// Copy the vertex
+//			Out.RTIndex = _In[0].ViewIndex;	// Declared as "uint RTIndex : SV_RENDERTARGETARRAYINDEX"
+//			_Out.Append( Out );
+//		}
+//	}
+//
+// When the device lets the vertex shader output SV_RenderTargetArrayIndex (cf. Device::SupportsVSRenderTargetArrayIndex()), the GS
+//	can be dropped and the VS directly writes "Out.RTIndex = ViewIndex;". Otherwise, an object drawn with a single instance and a
+//	single bit in its mask is only rendered into that view, in whatever slice the CPU bound (cf. EffectGlobalIllum2::RenderShadowMapPointStatic()).
+//
+#ifndef _MULTIVIEW_INC_
+#define _MULTIVIEW_INC_
+
+static const uint	MULTIVIEW_MAX_VIEWS = 6;	// !!IMPORTANT ==> Must correspond to MultiView::MAX_VIEWS!!
+
+// !!IMPORTANT ==> Must correspond to MultiView::CBMultiView!!
+cbuffer	cbMultiView : register( b8 )
+{
+	float4x4	_MultiViewCamera2World[MULTIVIEW_MAX_VIEWS];
+	float4x4	_MultiViewWorld2Proj[MULTIVIEW_MAX_VIEWS];
+	uint		_MultiViewsCount;
+};
+
+// !!IMPORTANT ==> Must correspond to MultiView::CBMultiViewObject!!
+cbuffer	cbMultiViewObject : register( b6 )
+{
+	uint		_MultiViewMask;		// Bit of each view the object is drawn into, one instance per bit
+};
+
+// The view of an instance is the one of the _InstanceID-th bit of the object's mask
+uint	MultiViewIndex( uint _InstanceID )
+{
+	uint	Mask = _MultiViewMask;
+	for ( uint i=0; i < _InstanceID; i++ )
+		Mask &= Mask - 1;	// Clear the lowest bit
+	return firstbitlow( Mask );
+}
+
+float3	MultiViewPosition( uint _ViewIndex )
+{
+	return _MultiViewCamera2World[_ViewIndex][3].xyz;
+}
+
+#endif	// _MULTIVIEW_INC_
@@ -0,0 +1,57 @@
+//////////////////////////////////////////////////////////////////////////
+// Decoding of the packed scene vertices (cf. VertexFormatPackedP3N3G3B3T2 in RendererD3D11/Structures/VertexFormats.h)
+// Scene shaders compiled with PACKED_VERTICES=1 declare their input as VS_IN_PACKED and rebuild the full vertex with DecodePackedVertex()
+//	using the quantization bounds of the primitive being rendered (cf. EffectGlobalIllum2::CBObject):
+//	_ Position is quantized on 16 bits within the primitive's local bounding box, W stores the sign of the bitangent
+//	_ Normal and tangent are octahedral-encoded on 2x16 bits
+//	_ UVs are stored as halves
+//
+#ifndef _PACKED_VERTEX_INC_
+#define _PACKED_VERTEX_INC_
+
+struct	VS_IN_PACKED
+{
+	float4	Position	: POSITION;		// UNORM16, XYZ in [0,1] within the primitive's bounds, W = 1 for a positive bitangent
+	float2	Normal		: NORMAL;		// SNORM16, octahedral
+	float2	Tangent		: TANGENT;		// SNORM16, octahedral
+	float2	UV			: TEXCOORD0;	// FLOAT16
+};
+
+// Position-only input for depth passes (cf. VertexFormatPackedP4)
+struct	VS_IN_PACKED_POSITION
+{
+	float4	Position	: POSITION;
+};
+
+// Inverse of DecodeOctahedral(), also used to store normals in R8G8_SNORM targets (cf. RenderTargetFormats::NORMAL)
+float2	EncodeOctahedral( float3 _Direction )
+{
+	float2	Oct = _Direction.xy / (abs( _Direction.x ) + abs( _Direction.y ) + abs( _Direction.z ));
+	if ( _Direction.z < 0.0 )
+		Oct = (1.0 - abs( Oct.yx )) * (Oct.xy >= 0.0 ? 1.0 : -1.0);
+	return Oct;
+}
+
+float3	DecodeOctahedral( float2 _Oct )
+{
+	float3	N = float3( _Oct, 1.0 - abs( _Oct.x ) - abs( _Oct.y ) );
+	float	t = saturate( -N.z );
+	N.xy += N.xy >= 0.0 ? -t : t;
+	return normalize( N );
+}
+
+float3	DecodePackedPosition( float4 _Position, float3 _QuantizationMin, float3 _QuantizationSize )
+{
+	return _QuantizationMin + _Position.xyz * _QuantizationSize;
+}
+
+void	DecodePackedVertex( VS_IN_PACKED _In, float3 _QuantizationMin, float3 _QuantizationSize, out float3 _Position, out float3 _Normal, out float3 _Tangent, out float3 _BiTangent, out float2 _UV )
+{
+	_Position = DecodePackedPosition( _In.Position, _QuantizationMin, _QuantizationSize );
+	_Normal = DecodeOctahedral( _In.Normal );
+	_Tangent = DecodeOctahedral( _In.Tangent );
+	_BiTangent = (2.0 * _In.Position.w - 1.0) * cross( _Normal, _Tangent );
+	_UV = _In.UV;
+}
+
+#endif	// _PACKED_VERTEX_INC_
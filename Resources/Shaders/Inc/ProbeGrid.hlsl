@@ -0,0 +1,55 @@
+//////////////////////////////////////////////////////////////////////////
+// Nearest probe lookup on the GPU
+// Mirror of the PointGrid built by SHProbeNetwork::LoadProbes() and bound by SHProbeNetwork::BindSceneInputs()
+//
+#ifndef _PROBE_GRID_INC_
+#define _PROBE_GRID_INC_
+
+struct	ProbeGridInfos
+{
+	float3	Min;				// Minimum corner of the grid
+	float	InvCellSize;
+	uint3	Size;				// Amount of cells along each axis
+	uint	ProbesCount;
+};
+
+struct	ProbeGridCell
+{
+	uint	CandidatesStart;
+	uint	CandidatesCount;
+};
+
+StructuredBuffer<ProbeGridInfos>	_ProbeGridInfos : register( t22 );
+StructuredBuffer<ProbeGridCell>		_ProbeGridCells : register( t23 );
+StructuredBuffer<uint>				_ProbeGridCandidates : register( t24 );
+StructuredBuffer<float3>			_ProbeGridPositions : register( t25 );
+
+// Returns the ID of the probe nearest to the provided world position
+// NOTE: Unlike the CPU version, positions outside of the grid are clamped to the nearest cell so the result is only approximate there
+uint	FetchNearestProbe( float3 _wsPosition )
+{
+	ProbeGridInfos	Infos = _ProbeGridInfos[0];
+	if ( Infos.ProbesCount == 0 )
+		return ~0U;
+
+	uint3			CellPos = uint3( clamp( int3( floor( (_wsPosition - Infos.Min) * Infos.InvCellSize ) ), 0, int3( Infos.Size ) - 1 ) );
+	ProbeGridCell	Cell = _ProbeGridCells[CellPos.x + Infos.Size.x * (CellPos.y + Infos.Size.y * CellPos.z)];
+
+	uint	Result = ~0U;
+	float	BestDistanceSq = 1e38;
+	for ( uint i=0; i < Cell.CandidatesCount; i++ )
+	{
+		uint	ProbeID = _ProbeGridCandidates[Cell.CandidatesStart + i];
+		float3	Delta = _ProbeGridPositions[ProbeID] - _wsPosition;
+		float	DistanceSq = dot( Delta, Delta );
+		if ( DistanceSq < BestDistanceSq )
+		{
+			BestDistanceSq = DistanceSq;
+			Result = ProbeID;
+		}
+	}
+
+	return Result;
+}
+
+#endif
@@ -0,0 +1,88 @@
+//////////////////////////////////////////////////////////////////////////
+// Probe tetrahedra lookup on the GPU
+// Mirror of the Tetrahedralization built by SHProbeNetwork::LoadProbes() and bound by SHProbeNetwork::BindSceneInputs()
+// The 4 probes of the returned tetrahedron are blended with the returned weights, keep the tetrahedron to start the next
+//	query from it (e.g. per object or per vertex of the previous frame) so the walk is only a step or two long.
+// Shaders without any previous tetrahedron can include Inc/ProbeGrid.hlsl first and use FindProbeTetrahedronNear() that starts
+//	from a tetrahedron of the nearest probe.
+//
+#ifndef _PROBE_TETRAHEDRA_INC_
+#define _PROBE_TETRAHEDRA_INC_
+
+static const uint	MAX_WALK_STEPS = 256;	// !!IMPORTANT ==> Must correspond to Tetrahedralization::MAX_WALK_STEPS!!
+
+struct	ProbeTetrahedron
+{
+	uint4	ProbeIDs;			// ~0U if there are no tetrahedra at all
+	uint4	Neighbors;			// Tetrahedron across the face opposite each probe, ~0U on the hull
+};
+
+// Weights of the 3 first probes are dot( Row, float4( Position, 1 ) ), the weights sum to 1
+struct	ProbeTetrahedronBarycentrics
+{
+	float4	Row0;
+	float4	Row1;
+	float4	Row2;
+};
+
+StructuredBuffer<ProbeTetrahedron>				_ProbeTetrahedra : register( t37 );
+StructuredBuffer<ProbeTetrahedronBarycentrics>	_ProbeTetrahedraBarycentrics : register( t38 );
+StructuredBuffer<uint>							_ProbeTetrahedronOfProbe : register( t39 );	// A tetrahedron using each probe
+
+float4	ComputeProbeTetrahedronWeights( uint _TetrahedronIndex, float3 _wsPosition )
+{
+	ProbeTetrahedronBarycentrics	B = _ProbeTetrahedraBarycentrics[_TetrahedronIndex];
+	float4	P = float4( _wsPosition, 1.0 );
+	float3	W = float3( dot( B.Row0, P ), dot( B.Row1, P ), dot( B.Row2, P ) );
+	return float4( W, 1.0 - W.x - W.y - W.z );
+}
+
+// Returns the index of the tetrahedron containing the provided world position by walking from _StartTetrahedron (any value works)
+//	and the weights of its 4 probes, or ~0U if there are no tetrahedra
+// Outside of the tetrahedralization, returns the tetrahedron of the hull the walk came out of with its weights clamped & normalized
+uint	FindProbeTetrahedron( float3 _wsPosition, uint _StartTetrahedron, out float4 _Weights )
+{
+	_Weights = 0.0;
+	if ( _ProbeTetrahedra[0].ProbeIDs.x == ~0U )
+		return ~0U;
+
+	uint	TetrahedraCount, Stride;
+	_ProbeTetrahedra.GetDimensions( TetrahedraCount, Stride );
+
+	uint	Current = _StartTetrahedron < TetrahedraCount ? _StartTetrahedron : 0;
+	[loop]
+	for ( uint Step=0; Step < MAX_WALK_STEPS; Step++ )
+	{
+		_Weights = ComputeProbeTetrahedronWeights( Current, _wsPosition );
+
+		// Cross the face opposite the most negative weight
+		float	MinWeight = min( min( _Weights.x, _Weights.y ), min( _Weights.z, _Weights.w ) );
+		if ( MinWeight >= -1e-5 )
+			return Current;	// Inside
+
+		uint	FaceIndex = MinWeight == _Weights.x ? 0 : (MinWeight == _Weights.y ? 1 : (MinWeight == _Weights.z ? 2 : 3));
+		uint	Next = _ProbeTetrahedra[Current].Neighbors[FaceIndex];
+		if ( Next == ~0U )
+			break;	// Outside of the hull
+
+		Current = Next;
+	}
+
+	// Outside (or the walk gave up): keep the blend of the nearest tetrahedron found
+	_Weights = max( 0.0, _Weights );
+	_Weights /= dot( _Weights, 1.0 );
+
+	return Current;
+}
+
+#ifdef _PROBE_GRID_INC_
+// Same as above but starts from the nearest probe
+uint	FindProbeTetrahedronNear( float3 _wsPosition, out float4 _Weights )
+{
+	uint	NearestProbeID = FetchNearestProbe( _wsPosition );
+	uint	StartTetrahedron = NearestProbeID != ~0U ? _ProbeTetrahedronOfProbe[NearestProbeID] : 0;
+	return FindProbeTetrahedron( _wsPosition, StartTetrahedron, _Weights );
+}
+#endif
+
+#endif
@@ -0,0 +1,107 @@
+//////////////////////////////////////////////////////////////////////////
+// Storage of the runtime probe SH buffers (cf. SHProbeNetwork::SH_STORAGE_FORMAT)
+// Shaders accessing the static, dynamic, dynamic sun or final SH buffers are compiled with SH_STORAGE_FORMAT set to the network's format
+//	and declare them as StructuredBuffer<SHProbeStorage>, coefficients are then read & written through DecodeProbeSH() & EncodeProbeSH():
+//	_ 0 = SH_STORAGE_FLOAT, 9 float3 coefficients
+//	_ 1 = SH_STORAGE_HALF, 27 half coefficients (R0 G0 B0 R1 ...) packed by pairs, low word first
+//	_ 2 = SH_STORAGE_L1, only the first 4 float3 coefficients (the L2 band is decoded as 0)
+//
+#ifndef _SH_PROBE_STORAGE_INC_
+#define _SH_PROBE_STORAGE_INC_
+
+#ifndef SH_STORAGE_FORMAT
+#define SH_STORAGE_FORMAT	0
+#endif
+
+#if SH_STORAGE_FORMAT == 1
+
+struct	SHProbeStorage
+{
+	uint	pPacked[14];
+};
+
+void	DecodeProbeSH( SHProbeStorage _Storage, out float3 _SH[9] )
+{
+	float	pCoeffs[28];
+	[unroll]
+	for ( uint PairIndex=0; PairIndex < 14; PairIndex++ )
+	{
+		pCoeffs[2*PairIndex+0] = f16tof32( _Storage.pPacked[PairIndex] );
+		pCoeffs[2*PairIndex+1] = f16tof32( _Storage.pPacked[PairIndex] >> 16 );
+	}
+
+	[unroll]
+	for ( uint i=0; i < 9; i++ )
+		_SH[i] = float3( pCoeffs[3*i+0], pCoeffs[3*i+1], pCoeffs[3*i+2] );
+}
+
+SHProbeStorage	EncodeProbeSH( float3 _SH[9] )
+{
+	float	pCoeffs[28];
+	[unroll]
+	for ( uint i=0; i < 9; i++ )
+	{
+		pCoeffs[3*i+0] = _SH[i].x;
+		pCoeffs[3*i+1] = _SH[i].y;
+		pCoeffs[3*i+2] = _SH[i].z;
+	}
+	pCoeffs[27] = 0.0;
+
+	SHProbeStorage	Result;
+	[unroll]
+	for ( uint PairIndex=0; PairIndex < 14; PairIndex++ )
+		Result.pPacked[PairIndex] = f32tof16( pCoeffs[2*PairIndex+0] ) | (f32tof16( pCoeffs[2*PairIndex+1] ) << 16);
+
+	return Result;
+}
+
+#elif SH_STORAGE_FORMAT == 2
+
+struct	SHProbeStorage
+{
+	float3	pSH[4];
+};
+
+void	DecodeProbeSH( SHProbeStorage _Storage, out float3 _SH[9] )
+{
+	[unroll]
+	for ( uint i=0; i < 4; i++ )
+		_SH[i] = _Storage.pSH[i];
+	[unroll]
+	for ( uint j=4; j < 9; j++ )
+		_SH[j] = 0.0;
+}
+
+SHProbeStorage	EncodeProbeSH( float3 _SH[9] )
+{
+	SHProbeStorage	Result;
+	[unroll]
+	for ( uint i=0; i < 4; i++ )
+		Result.pSH[i] = _SH[i];
+
+	return Result;
+}
+
+#else
+
+struct	SHProbeStorage
+{
+	float3	pSH[9];
+};
+
+void	DecodeProbeSH( SHProbeStorage _Storage, out float3 _SH[9] )
+{
+	_SH = _Storage.pSH;
+}
+
+SHProbeStorage	EncodeProbeSH( float3 _SH[9] )
+{
+	SHProbeStorage	Result;
+	Result.pSH = _SH;
+
+	return Result;
+}
+
+#endif
+
+#endif	// _SH_PROBE_STORAGE_INC_
@@ -0,0 +1,16 @@
+//////////////////////////////////////////////////////////////////////////
+// Per-instance transforms of the scene primitives drawn with a single instanced call (cf. Scene::InstanceGroup & INSTANCED_SHADOW_MAPS in EffectGlobalIllum2.h)
+// Shaders compiled with INSTANCED=1 fetch the Local=>World transform of each instance in the structured buffer holding the transforms
+//	of all the scene instances group after group, the object CB tells where the group being drawn starts.
+//
+#ifndef _SCENE_INSTANCING_INC_
+#define _SCENE_INSTANCING_INC_
+
+StructuredBuffer<float4x4>	_InstanceLocal2World : register( t26 );
+
+float4x4	GetInstanceLocal2World( uint _InstancesStart, uint _InstanceID )
+{
+	return _InstanceLocal2World[_InstancesStart + _InstanceID];
+}
+
+#endif	// _SCENE_INSTANCING_INC_
@@ -0,0 +1,105 @@
+//////////////////////////////////////////////////////////////////////////
+// Point light shadow atlas (cf. EffectGlobalIllum2::PrepareShadowAtlas() with SHADOW_ATLAS)
+// A single depth atlas is divided into SHADOW_ATLAS_PAGE_SIZE pages. Each shadowed light owns a slot of 3x2 pages holding its 6 cube
+//	faces in the usual +X,-X,+Y,-Y,+Z,-Z order, face F being in page (F%3, F/3) of the slot. Depending on the light's importance, faces
+//	are rendered at the full page size or only in the top-left corner of their page (_UVFaceSize).
+// Slots are reassigned on the CPU each frame so a light may lose its slot, _ShadowAtlasLightSlots then returns SHADOW_ATLAS_NO_SLOT
+//	and the light is considered unshadowed.
+//
+// Usage in the shadow map shader compiled with SHADOW_ATLAS=1 (the GS emits each triangle once per face):
+//	Out.__Position = ShadowAtlasProject( WorldPosition, FaceIndex );
+//	Out.ViewportIndex = FaceIndex;	// SV_ViewportArrayIndex, the CPU sets one viewport per face
+//
+// Usage in the scene shader, with light indices numbered like for the light clusters (static then dynamic lights):
+//	float	Shadow = GetShadowAtlas( LightIndex, WorldPosition );
+//
+#ifndef _SHADOW_ATLAS_INC_
+#define _SHADOW_ATLAS_INC_
+
+#define	SHADOW_ATLAS_NO_SLOT	0xFFFFFFFF	// !!IMPORTANT ==> Must correspond to EffectGlobalIllum2::SHADOW_ATLAS_NO_SLOT!!
+
+static const float	SHADOW_ATLAS_NEAR_FACTOR = 0.01;	// Near clip of the faces as a fraction of the far clip
+static const float	SHADOW_ATLAS_SIZE = 4096.0;			// !!IMPORTANT ==> Must correspond to EffectGlobalIllum2::SHADOW_ATLAS_SIZE!!
+static const float	SHADOW_ATLAS_PAGE_UV = 256.0 / SHADOW_ATLAS_SIZE;	// !!IMPORTANT ==> Must correspond to EffectGlobalIllum2::SHADOW_ATLAS_PAGE_SIZE!!
+
+// Light being rendered into the atlas
+cbuffer	cbShadowAtlas : register( b13 )
+{
+	float3	_ShadowAtlasPosition;
+	float	_ShadowAtlasFarClipDistance;
+};
+
+struct	ShadowAtlasLight
+{
+	float3	Position;
+	float	FarClipDistance;
+	float2	UVOrigin;				// UV of the slot's top-left corner
+	float	UVFaceSize;				// UV size of a face's viewport
+	float	__PAD;
+};
+
+Texture2D<float>					_TexShadowAtlas : register( t29 );
+StructuredBuffer<uint>				_ShadowAtlasLightSlots : register( t30 );	// Slot of each light or SHADOW_ATLAS_NO_SLOT
+StructuredBuffer<ShadowAtlasLight>	_ShadowAtlasLights : register( t31 );		// !!IMPORTANT ==> Must correspond to EffectGlobalIllum2::ShadowAtlasLight!!
+
+// Returns the face's right, up & at axes
+void	GetShadowAtlasFaceAxes( uint _FaceIndex, out float3 _Right, out float3 _Up, out float3 _At )
+{
+	switch ( _FaceIndex )
+	{
+	case 0:	_Right = float3(  0, 0, -1 ); _Up = float3( 0, 1,  0 ); _At = float3(  1,  0,  0 ); break;
+	case 1:	_Right = float3(  0, 0,  1 ); _Up = float3( 0, 1,  0 ); _At = float3( -1,  0,  0 ); break;
+	case 2:	_Right = float3(  1, 0,  0 ); _Up = float3( 0, 0, -1 ); _At = float3(  0,  1,  0 ); break;
+	case 3:	_Right = float3(  1, 0,  0 ); _Up = float3( 0, 0,  1 ); _At = float3(  0, -1,  0 ); break;
+	case 4:	_Right = float3(  1, 0,  0 ); _Up = float3( 0, 1,  0 ); _At = float3(  0,  0,  1 ); break;
+	default:_Right = float3( -1, 0,  0 ); _Up = float3( 0, 1,  0 ); _At = float3(  0,  0, -1 ); break;
+	}
+}
+
+// Projects a point with the 90 degrees frustum of a face, Z is the same hyperbolic depth a regular perspective projection would give
+float4	ShadowAtlasProject( float3 _Delta, uint _FaceIndex, float _FarClipDistance )
+{
+	float3	Right, Up, At;
+	GetShadowAtlasFaceAxes( _FaceIndex, Right, Up, At );
+
+	float	Near = SHADOW_ATLAS_NEAR_FACTOR * _FarClipDistance;
+	float	Q = _FarClipDistance / (_FarClipDistance - Near);
+	float	Z = dot( _Delta, At );
+	return float4( dot( _Delta, Right ), dot( _Delta, Up ), Q * (Z - Near), Z );
+}
+
+float4	ShadowAtlasProject( float3 _WorldPosition, uint _FaceIndex )
+{
+	return ShadowAtlasProject( _WorldPosition - _ShadowAtlasPosition, _FaceIndex, _ShadowAtlasFarClipDistance );
+}
+
+// Returns 1 if the position is lit by the light, 0 if it's in shadow
+float	GetShadowAtlas( uint _LightIndex, float3 _WorldPosition, float _Bias=0.001 )
+{
+	uint	SlotIndex = _ShadowAtlasLightSlots[_LightIndex];
+	if ( SlotIndex == SHADOW_ATLAS_NO_SLOT )
+		return 1.0;
+
+	ShadowAtlasLight	Light = _ShadowAtlasLights[SlotIndex];
+	float3	Delta = _WorldPosition - Light.Position;
+	float3	AbsDelta = abs( Delta );
+	uint	FaceIndex = AbsDelta.x >= AbsDelta.y && AbsDelta.x >= AbsDelta.z ? (Delta.x >= 0.0 ? 0 : 1)
+					  : AbsDelta.y >= AbsDelta.z ? (Delta.y >= 0.0 ? 2 : 3)
+					  : (Delta.z >= 0.0 ? 4 : 5);
+
+	float4	Projected = ShadowAtlasProject( Delta, FaceIndex, Light.FarClipDistance );
+	if ( Projected.w > Light.FarClipDistance )
+		return 1.0;
+
+	float3	NDC = Projected.xyz / Projected.w;
+	float2	FaceUV = float2( 0.5 + 0.5 * NDC.x, 0.5 - 0.5 * NDC.y );
+
+	// Stay half a texel inside the face so we never read the neighbor page
+	float	HalfTexel = 0.5 / SHADOW_ATLAS_SIZE;
+	float2	UV = Light.UVOrigin + SHADOW_ATLAS_PAGE_UV * float2( FaceIndex % 3, FaceIndex / 3 ) + clamp( FaceUV * Light.UVFaceSize, HalfTexel, Light.UVFaceSize - HalfTexel );
+
+	float	Z = _TexShadowAtlas.SampleLevel( PointClamp, UV, 0.0 );
+	return NDC.z - _Bias < Z ? 1.0 : 0.0;
+}
+
+#endif
@@ -0,0 +1,79 @@
+//////////////////////////////////////////////////////////////////////////
+// Sky-view & aerial-perspective lookup tables (cf. EffectVolumetric::RenderSkyLUTs() with SKY_LUTS)
+// Both tables are recomputed each frame around the camera from the scattering & transmittance tables:
+//	_ The sky-view LUT bound at t54 is a latitude/longitude map of the sky radiance seen from the camera. Longitude is the
+//		azimuth relative to the sun and latitude is warped to keep most of the texels near the horizon where the sky changes fast.
+//	_ The aerial-perspective volume bound at t55 covers the camera frustum with linear slices up to _AerialPerspectiveFarKm
+//		and stores the fog between the camera and each texel: RGB=In-scattered light, A=Transmittance
+//
+// Usage:
+//	SkyColor = SampleSkyView( View );
+//	SurfaceColor = ApplyAerialPerspective( SurfaceColor, ScreenUV, ViewZKm );
+//
+#ifndef _SKY_LUTS_INC_
+#define _SKY_LUTS_INC_
+
+cbuffer	cbSkyLUTs : register( b5 )		// !!IMPORTANT ==> Must correspond to EffectVolumetric::CBSkyLUTs!!
+{
+	uint2		_SkyViewSize;
+	float		_AerialPerspectiveFarKm;
+	float		__SkyLUTsPAD0;
+	uint3		_AerialPerspectiveSize;
+	float		__SkyLUTsPAD1;
+	float3		_SkyLUTsSunDirection;		// Sun direction projected on the horizontal plane, the longitude origin
+	float		__SkyLUTsPAD2;
+};
+
+Texture2D<float4>	_TexSkyView : register( t54 );
+Texture3D<float4>	_TexAerialPerspective : register( t55 );
+
+// Converts a world view direction into sky-view UVs and back
+float2	SkyViewDirectionToUV( float3 _View )
+{
+	float	Latitude = asin( clamp( _View.y, -1.0, 1.0 ) );					// In [-PI/2,PI/2], 0 at the horizon
+	float	V = 0.5 + 0.5 * sign( Latitude ) * sqrt( abs( Latitude ) / (0.5 * PI) );
+
+	float3	SunX = _SkyLUTsSunDirection;
+	float3	SunZ = float3( -SunX.z, 0.0, SunX.x );
+	float	Longitude = atan2( dot( _View, SunZ ), dot( _View, SunX ) );	// In [-PI,PI], 0 toward the sun
+	float	U = 0.5 + 0.5 * Longitude / PI;
+
+	return float2( U, 1.0 - V );
+}
+
+float3	SkyViewUVToDirection( float2 _UV )
+{
+	float	V = 2.0 * (1.0 - _UV.y) - 1.0;
+	float	Latitude = sign( V ) * V * V * (0.5 * PI);
+	float	Longitude = PI * (2.0 * _UV.x - 1.0);
+
+	float3	SunX = _SkyLUTsSunDirection;
+	float3	SunZ = float3( -SunX.z, 0.0, SunX.x );
+	float	CosLatitude = cos( Latitude );
+	return CosLatitude * (cos( Longitude ) * SunX + sin( Longitude ) * SunZ) + float3( 0, sin( Latitude ), 0 );
+}
+
+float3	SampleSkyView( float3 _View )
+{
+	return _TexSkyView.SampleLevel( LinearWrap, SkyViewDirectionToUV( _View ), 0.0 ).xyz;
+}
+
+// Returns the fog between the camera and a surface at the given depth: RGB=In-scattered light, A=Transmittance
+float4	SampleAerialPerspective( float2 _UV, float _ViewZ )
+{
+	// Texel k holds the fog up to the end of slice k
+	float	W = _ViewZ / _AerialPerspectiveFarKm - 0.5 / _AerialPerspectiveSize.z;
+	float4	Fog = _TexAerialPerspective.SampleLevel( LinearClamp, float3( _UV, saturate( W ) ), 0.0 );
+
+	// Fade in the first slice, that starts at the camera
+	float	FirstSliceW = 1.0 / _AerialPerspectiveSize.z;
+	return lerp( float4( 0, 0, 0, 1 ), Fog, saturate( (W + 0.5 * FirstSliceW) / FirstSliceW ) );
+}
+
+float3	ApplyAerialPerspective( float3 _Color, float2 _UV, float _ViewZ )
+{
+	float4	Fog = SampleAerialPerspective( _UV, _ViewZ );
+	return _Color * Fog.w + Fog.xyz;
+}
+
+#endif
@@ -0,0 +1,41 @@
+//////////////////////////////////////////////////////////////////////////
+// Ambient sky SH computed on the GPU by GISkySH.hlsl (cf. EffectGlobalIllum2::UpdateSkySH())
+// The buffer stays bound at t57 so the probe update & scene shaders read the sky without any CPU round trip:
+//	_ _SkySH[0..8] is the windowed sky radiance, to multiply with a probe's occlusion SH
+//	_ _SkySH[9..17] is the sky irradiance (radiance convolved with the clamped cosine lobe)
+//
+// Usage:
+//	float3	SkyIrradiance = EvaluateSkyIrradiance( wsNormal );
+//
+#ifndef _SKY_SH_INC_
+#define _SKY_SH_INC_
+
+StructuredBuffer<float4>	_SkySH : register( t57 );
+
+// Same basis & order as SH::BuildSHCoeffs_YUp()
+float3	EvaluateSkySH( float3 _Direction, uint _Offset )
+{
+	const float	f0 = 0.28209479177387814347403972578039;	// 0.5 / sqrt(PI)
+	const float	f1 = 1.7320508075688772935274463415059 * f0;
+	const float	f2 = 3.8729833462074168851792653997824 * f0;
+	const float	f3 = 1.1180339887498948482045868343656 * f0;
+
+	float3	Result = f0 * _SkySH[_Offset+0].xyz;
+	Result -= f1 * _Direction.x * _SkySH[_Offset+1].xyz;
+	Result += f1 * _Direction.y * _SkySH[_Offset+2].xyz;
+	Result -= f1 * _Direction.z * _SkySH[_Offset+3].xyz;
+	Result += f2 * _Direction.x * _Direction.z * _SkySH[_Offset+4].xyz;
+	Result -= f2 * _Direction.x * _Direction.y * _SkySH[_Offset+5].xyz;
+	Result += f3 * (3.0 * _Direction.y*_Direction.y - 1.0) * _SkySH[_Offset+6].xyz;
+	Result -= f2 * _Direction.z * _Direction.y * _SkySH[_Offset+7].xyz;
+	Result += f2 * 0.5 * (_Direction.z*_Direction.z - _Direction.x*_Direction.x) * _SkySH[_Offset+8].xyz;
+	return Result;
+}
+
+// Irradiance received by a surface of normal _Normal from the whole unoccluded sky
+float3	EvaluateSkyIrradiance( float3 _Normal )
+{
+	return max( 0.0, EvaluateSkySH( _Normal, 9 ) );
+}
+
+#endif
@@ -0,0 +1,56 @@
+//////////////////////////////////////////////////////////////////////////
+// Sun shadow cascades (cf. EffectGlobalIllum2::PrepareSunShadowCascades() with SUN_SHADOW_CASCADES)
+// The camera frustum is split into SUN_SHADOW_CASCADES_COUNT slices, each one covered by a slice of _TexSunShadowCascades whose
+//	transform maps its bounding sphere to [(-1,-1,0),(+1,+1,1)] exactly like the whole scene shadow map's World2Light.
+// Cascades follow the camera by whole texels so the shadow doesn't shimmer, and the far cascades are only updated every few frames:
+//	a cascade's transform is only changed together with its content so the lookup always matches what was rendered.
+// Positions outside all the cascades should use the regular whole scene shadow map.
+//
+// Usage in the scene shader compiled with SUN_SHADOW_CASCADES=1:
+//	float	Shadow;
+//	if ( !GetSunShadowCascades( WorldPosition, Shadow ) )
+//		Shadow = (...);	// Whole scene shadow map
+//
+#ifndef _SUN_SHADOW_CASCADES_INC_
+#define _SUN_SHADOW_CASCADES_INC_
+
+static const uint	SUN_SHADOW_CASCADES_COUNT = 4;			// !!IMPORTANT ==> Must correspond to EffectGlobalIllum2::SUN_SHADOW_CASCADES_COUNT!!
+static const float	SUN_SHADOW_CASCADE_SIZE = 1024.0;		// !!IMPORTANT ==> Must correspond to EffectGlobalIllum2::SUN_SHADOW_CASCADE_SIZE!!
+static const float	SUN_SHADOW_CASCADE_BORDER = 2.0 / SUN_SHADOW_CASCADE_SIZE;	// Margin kept inside a cascade for the filtering footprint
+
+cbuffer	cbSunShadowCascades : register( b4 )
+{
+	float4x4	_World2SunCascade[SUN_SHADOW_CASCADES_COUNT];
+	float4		_SunCascadeBias;							// Depth bias of each cascade
+};
+
+Texture2DArray<float>	_TexSunShadowCascades : register( t32 );
+
+// Returns false if the position isn't covered by any cascade
+bool	GetSunShadowCascades( float3 _WorldPosition, out float _Shadow )
+{
+	_Shadow = 1.0;
+
+	float4	Position = float4( _WorldPosition, 1.0 );
+	[unroll]
+	for ( uint CascadeIndex=0; CascadeIndex < SUN_SHADOW_CASCADES_COUNT; CascadeIndex++ )
+	{
+		float3	CascadePosition = mul( Position, _World2SunCascade[CascadeIndex] ).xyz;
+		if ( any( abs( CascadePosition.xy ) > 1.0 - SUN_SHADOW_CASCADE_BORDER ) )
+			continue;	// Try the next, larger cascade
+
+		// 2x2 PCF with bilinear weights
+		float2	UV = float2( 0.5 + 0.5 * CascadePosition.x, 0.5 - 0.5 * CascadePosition.y );
+		float2	Texel = UV * SUN_SHADOW_CASCADE_SIZE - 0.5;
+		float2	t = frac( Texel );
+		float4	Z = _TexSunShadowCascades.GatherRed( LinearClamp, float3( (floor( Texel ) + 1.0) / SUN_SHADOW_CASCADE_SIZE, CascadeIndex ) );	// W=(0,0) Z=(1,0) X=(0,1) Y=(1,1)
+		float4	Lit = CascadePosition.z - _SunCascadeBias[CascadeIndex] <= Z ? 1.0 : 0.0;
+
+		_Shadow = lerp( lerp( Lit.w, Lit.z, t.x ), lerp( Lit.x, Lit.y, t.x ), t.y );
+		return true;
+	}
+
+	return false;
+}
+
+#endif
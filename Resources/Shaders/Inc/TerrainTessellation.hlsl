@@ -0,0 +1,85 @@
+//////////////////////////////////////////////////////////////////////////
+// Tessellated terrain patches (cf. EffectVolumetric::RenderTerrainPatches() with TESSELLATED_TERRAIN)
+// The CPU selects a quadtree of square patches in the terrain's local [-1,1] XZ plane, splitting the nodes whose projected size is too large
+//	and discarding the ones outside of the frustum. Each patch is drawn as an instance of a single 4 control points patch that the hull shader
+//	tessellates with _TessellationFactor, divided by 2^Shift along the edges shared with a neighbor Shift levels coarser so the vertices
+//	always match on both sides of a level transition.
+//
+// Usage (in VolumetricTerrain.hlsl, once VS_IN, PS_IN and VS() are declared):
+//	#ifdef TESSELLATED_TERRAIN
+//	#include "Inc/TerrainTessellation.hlsl"	// Provides VS_Patch, HS_Patch & DS_Patch, the domain shader feeds each generated vertex to VS()
+//	#endif
+//
+#ifndef _TERRAIN_TESSELLATION_INC_
+#define _TERRAIN_TESSELLATION_INC_
+
+cbuffer	cbTerrainTessellation : register( b13 )
+{
+	float	_TessellationFactor;	// Edge & inside factor of a patch, a power of 2
+	float3	__PAD;
+};
+
+struct	TerrainPatch
+{
+	float2	Position;				// Local XZ position of the patch's min corner
+	float	Size;					// Local size of the patch
+	uint	EdgeShifts;				// 8 bits per edge in the order of SV_TessFactor: -X, -Z, +X, +Z
+};
+
+StructuredBuffer<TerrainPatch>	_TerrainPatches : register( t15 );	// !!IMPORTANT ==> Must correspond to EffectVolumetric::TerrainPatch!!
+
+struct	HS_IN
+{
+	float3	Position : POSITION;	// Local position
+	uint	PatchIndex : PATCH_INDEX;
+};
+
+struct	HS_CONSTANT_OUT
+{
+	float	Edges[4] : SV_TessFactor;
+	float	Inside[2] : SV_InsideTessFactor;
+};
+
+// The patch primitive is a unit square in XZ, scaled & offset into the terrain
+HS_IN	VS_Patch( VS_IN _In, uint _InstanceID : SV_INSTANCEID )
+{
+	TerrainPatch	Patch = _TerrainPatches[_InstanceID];
+
+	HS_IN	Out;
+	Out.Position = float3( Patch.Position.x + Patch.Size * _In.Position.x, 0.0, Patch.Position.y + Patch.Size * _In.Position.z );
+	Out.PatchIndex = _InstanceID;
+	return Out;
+}
+
+HS_CONSTANT_OUT	HS_PatchConstant( InputPatch<HS_IN, 4> _Patch )
+{
+	uint	EdgeShifts = _TerrainPatches[_Patch[0].PatchIndex].EdgeShifts;
+
+	HS_CONSTANT_OUT	Out;
+	[unroll]
+	for ( uint Edge=0; Edge < 4; Edge++ )
+		Out.Edges[Edge] = max( 1.0, _TessellationFactor / (1U << ((EdgeShifts >> (8*Edge)) & 0xFF)) );
+	Out.Inside[0] = Out.Inside[1] = _TessellationFactor;
+	return Out;
+}
+
+[domain( "quad" )]
+[partitioning( "integer" )]
+[outputtopology( "triangle_ccw" )]	// V runs along +Z so counter-clockwise in the domain yields clockwise triangles seen from above
+[outputcontrolpoints( 4 )]
+[patchconstantfunc( "HS_PatchConstant" )]
+HS_IN	HS_Patch( InputPatch<HS_IN, 4> _Patch, uint _ControlPointID : SV_OUTPUTCONTROLPOINTID )
+{
+	return _Patch[_ControlPointID];
+}
+
+// Control points are ordered (0,0), (1,0), (1,1), (0,1) and U runs along +X
+[domain( "quad" )]
+PS_IN	DS_Patch( HS_CONSTANT_OUT _Constants, float2 _UV : SV_DOMAINLOCATION, const OutputPatch<HS_IN, 4> _Patch )
+{
+	VS_IN	In;
+	In.Position = lerp( lerp( _Patch[0].Position, _Patch[1].Position, _UV.x ), lerp( _Patch[3].Position, _Patch[2].Position, _UV.x ), _UV.y );
+	return VS( In );
+}
+
+#endif
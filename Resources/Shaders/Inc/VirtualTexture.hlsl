@@ -0,0 +1,66 @@
+//////////////////////////////////////////////////////////////////////////
+// Virtual texturing (cf. Procedural/VirtualTexture.h)
+// The virtual texture is made of PAGE_SIZE pages, the resident ones are stored with a border in the slots of an atlas and the page
+//	table tells, for each page of each mip, in which slot the most detailed resident page covering it is (possibly a coarser one).
+//
+// Usage in the feedback pass, rendered at a lower resolution into VirtualTexture::GetFeedbackTarget() (cleared to 0):
+//	return VTFeedback( UV );
+//
+// Usage in the scene shader:
+//	float4	Color = VTSample( LinearClamp, UV );
+//
+#ifndef _VIRTUAL_TEXTURE_INC_
+#define _VIRTUAL_TEXTURE_INC_
+
+static const float	VT_PAGE_SIZE = 128.0;	// !!IMPORTANT ==> Must correspond to VirtualTexture::PAGE_SIZE!!
+static const float	VT_PAGE_BORDER = 4.0;	// !!IMPORTANT ==> Must correspond to VirtualTexture::PAGE_BORDER!!
+static const float	VT_SLOT_SIZE = VT_PAGE_SIZE + 2.0 * VT_PAGE_BORDER;
+
+// !!IMPORTANT ==> Must correspond to VirtualTexture::CBVirtualTexture!!
+cbuffer	cbVirtualTexture : register( b12 )
+{
+	float	_VTPagesCount;			// Pages on a side at mip 0
+	float	_VTMaxMip;				// Mip of the single coarsest page
+	float	_VTFeedbackMipBias;		// Compensates the lower resolution of the feedback pass
+	float2	_VTAtlasInvSize;
+};
+
+Texture2D<uint4>	_TexVTPageTable : register( t33 );	// XY=Slot of the resident page, Z=Its mip
+Texture2DArray		_TexVTAtlas : register( t34 );
+
+// Virtual mip level from the UV derivatives
+float	VTComputeMip( float2 _dUVdx, float2 _dUVdy, float _Bias )
+{
+	float	TexelsCount = _VTPagesCount * VT_PAGE_SIZE;
+	float2	dx = _dUVdx * TexelsCount;
+	float2	dy = _dUVdy * TexelsCount;
+	return clamp( 0.5 * log2( max( dot( dx, dx ), dot( dy, dy ) ) ) + _Bias, 0.0, _VTMaxMip );
+}
+
+uint2	VTGetPage( float2 _UV, uint _MipLevel )
+{
+	uint	PagesCount = uint(_VTPagesCount) >> _MipLevel;
+	return min( uint2( _UV * PagesCount ), PagesCount-1 );
+}
+
+// Returns the page needed at this pixel: XY=Page, Z=Mip, W=1 to tell it from the cleared pixels
+uint4	VTFeedback( float2 _UV )
+{
+	uint	MipLevel = uint( VTComputeMip( ddx( _UV ), ddy( _UV ), -_VTFeedbackMipBias ) );
+	return uint4( VTGetPage( frac( _UV ), MipLevel ), MipLevel, 1 );
+}
+
+// Samples the most detailed resident page, the atlas only has a mip 0 so filtering is bilinear within the chosen mip
+float4	VTSample( SamplerState _Sampler, float2 _UV, uint _Slice=0 )
+{
+	uint	MipLevel = uint( VTComputeMip( ddx( _UV ), ddy( _UV ), 0.0 ) );
+	_UV = frac( _UV );
+	uint4	Entry = _TexVTPageTable.Load( int3( VTGetPage( _UV, MipLevel ), MipLevel ) );
+
+	float	ResidentPagesCount = float( uint(_VTPagesCount) >> Entry.z );
+	float2	PageUV = _UV * ResidentPagesCount - floor( _UV * ResidentPagesCount );
+	float2	AtlasUV = (Entry.xy * VT_SLOT_SIZE + VT_PAGE_BORDER + PageUV * VT_PAGE_SIZE) * _VTAtlasInvSize;
+	return _TexVTAtlas.SampleLevel( _Sampler, float3( AtlasUV, _Slice ), 0.0 );
+}
+
+#endif
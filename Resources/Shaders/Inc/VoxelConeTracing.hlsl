@@ -0,0 +1,145 @@
+//////////////////////////////////////////////////////////////////////////
+// Voxel cone tracing through the camera-centered radiance clipmap (cf. Utility/VoxelGI.h)
+// The clipmap is made of nested levels of VOXEL_CLIPMAP_SIZE^3 voxels each twice as large as the previous level's, stacked
+//	along Z in 2 textures:
+//	_ t58 is the isotropic radiance of the voxels (A = opacity, the radiance is premultiplied)
+//	_ t59 is the 6 directional volumes (+X, -X, +Y, -Y, +Z, -Z stacked along X) at half the resolution with their mips,
+//		each texel of direction D is the radiance & opacity of its 8 children composited along D
+// A cone samples the level & mip whose voxels match its diameter, the directional volumes are blended by the squared
+//	components of the cone's direction (cf. "Interactive Indirect Illumination Using Voxel Cone Tracing", Crassin et al. 2011)
+//
+// Usage (the scene shader is compiled with VOXEL_GI=1):
+//	float3	Irradiance = ConeTraceDiffuse( wsPosition, wsNormal );		// Replaces the probes' irradiance, sky included
+//	float3	Radiance = ConeTraceSpecular( wsPosition, wsNormal, wsView, Roughness );
+//
+#ifndef _VOXEL_CONE_TRACING_INC_
+#define _VOXEL_CONE_TRACING_INC_
+
+#include "Inc/SkySH.hlsl"
+
+#define	VOXEL_CLIPMAP_SIZE	64		// !!IMPORTANT ==> Must correspond to VoxelGI::CLIPMAP_SIZE!!
+static const uint	VOXEL_LEVELS_MAX = 4;			// !!IMPORTANT ==> Must correspond to VoxelGI::LEVELS_COUNT!!
+static const uint	VOXEL_ANISO_SIZE = VOXEL_CLIPMAP_SIZE / 2;
+static const float	VOXEL_ANISO_MAX_MIP = 5.0;		// !!IMPORTANT ==> Must correspond to VoxelGI::ANISO_MIPS_COUNT-1!!
+
+cbuffer	cbVoxelGI : register( b7 )	// !!IMPORTANT ==> Must correspond to VoxelGI::CBVoxelGI!!
+{
+	float4		_VoxelLevels[VOXEL_LEVELS_MAX];	// XYZ = world position of the minimum corner of the level, W = voxel size
+	uint		_VoxelLevelsCount;
+	float		_VoxelMaxDistance;				// Extent of the coarsest level, cones stop there
+};
+
+Texture3D<float4>	_TexVoxelRadiance : register( t58 );
+Texture3D<float4>	_TexVoxelAnisotropic : register( t59 );
+
+// Samples the clipmap at the provided position with a filter as wide as _Diameter, seen along _Direction
+float4	SampleVoxels( float3 _wsPosition, float _Diameter, float3 _Direction )
+{
+	// Coarsest of the level matching the diameter and of the finest level containing the position
+	uint	LevelIndex = uint( clamp( floor( log2( _Diameter / _VoxelLevels[0].w ) ), 0.0, _VoxelLevelsCount-1.0 ) );
+	float3	UVW;
+	[loop]
+	for ( ; LevelIndex < _VoxelLevelsCount; LevelIndex++ )
+	{
+		UVW = (_wsPosition - _VoxelLevels[LevelIndex].xyz) / (_VoxelLevels[LevelIndex].w * VOXEL_CLIPMAP_SIZE);
+		if ( all( UVW > 0.0 && UVW < 1.0 ) )
+			break;
+	}
+	if ( LevelIndex == _VoxelLevelsCount )
+		return 0.0;	// Outside of the clipmap
+
+	float	LOD = clamp( log2( _Diameter / _VoxelLevels[LevelIndex].w ), 0.0, 1.0 + VOXEL_ANISO_MAX_MIP );
+
+	// Isotropic radiance, keeping W within the level's slices
+	float4	Isotropic = 0.0;
+	if ( LOD < 1.0 )
+	{
+		float3	IsoUVW = UVW;
+		IsoUVW.z = (LevelIndex * VOXEL_CLIPMAP_SIZE + clamp( UVW.z * VOXEL_CLIPMAP_SIZE, 0.5, VOXEL_CLIPMAP_SIZE - 0.5 )) / (_VoxelLevelsCount * VOXEL_CLIPMAP_SIZE);
+		Isotropic = _TexVoxelRadiance.SampleLevel( LinearClamp, IsoUVW, 0.0 );
+		if ( LOD == 0.0 )
+			return Isotropic;
+	}
+
+	// Directional volumes, keeping UVW half a texel of the mip away from the faces' & levels' boundaries
+	float	Mip = max( 0.0, LOD - 1.0 );
+	float	Margin = 0.5 * exp2( ceil( Mip ) );
+	float3	AnisoUVW = clamp( UVW * VOXEL_ANISO_SIZE, Margin, VOXEL_ANISO_SIZE - Margin );
+	AnisoUVW.z = (LevelIndex * VOXEL_ANISO_SIZE + AnisoUVW.z) / (_VoxelLevelsCount * VOXEL_ANISO_SIZE);
+
+	float3	Weights = _Direction * _Direction;
+	uint3	Faces = uint3( _Direction.x > 0.0 ? 0 : 1, _Direction.y > 0.0 ? 2 : 3, _Direction.z > 0.0 ? 4 : 5 );
+	float4	Anisotropic = 0.0;
+	[unroll]
+	for ( uint Axis=0; Axis < 3; Axis++ )
+	{
+		float3	FaceUVW = float3( (Faces[Axis] * VOXEL_ANISO_SIZE + AnisoUVW.x) / (6 * VOXEL_ANISO_SIZE), AnisoUVW.y / VOXEL_ANISO_SIZE, AnisoUVW.z );
+		Anisotropic += Weights[Axis] * _TexVoxelAnisotropic.SampleLevel( LinearClamp, FaceUVW, Mip );
+	}
+
+	return LOD < 1.0 ? lerp( Isotropic, Anisotropic, LOD ) : Anisotropic;
+}
+
+// Marches a cone of half-angle tangent _Aperture front to back, returns the gathered radiance (RGB) and occlusion (A)
+float4	ConeTrace( float3 _wsOrigin, float3 _Direction, float _Aperture, float _MaxDistance )
+{
+	float	VoxelSize = _VoxelLevels[0].w;
+	float4	Result = 0.0;
+	float	Distance = VoxelSize;	// Skip the voxels of the surface itself
+	[loop]
+	while ( Distance < _MaxDistance && Result.w < 0.95 )
+	{
+		float	Diameter = max( VoxelSize, 2.0 * _Aperture * Distance );
+		float4	Sample = SampleVoxels( _wsOrigin + Distance * _Direction, Diameter, _Direction );
+
+		// Steps are half a diameter long while the opacity was integrated over a whole voxel
+		float	CorrectedOpacity = 1.0 - pow( saturate( 1.0 - Sample.w ), 0.5 );
+		Sample.xyz *= Sample.w > 0.0 ? CorrectedOpacity / Sample.w : 0.0;
+		Result += (1.0 - Result.w) * float4( Sample.xyz, CorrectedOpacity );
+
+		Distance += 0.5 * Diameter;
+	}
+
+	return Result;
+}
+
+// Irradiance from 6 cones of 60° aperture covering the hemisphere, the sky fills whatever the cones didn't hit
+//	(cone weights from "The Tomorrow Children: Lighting and Mining with Voxels", McLaren 2015, they sum to PI)
+float3	ConeTraceDiffuse( float3 _wsPosition, float3 _wsNormal )
+{
+	const float	Aperture = 0.57735026918962576450914878050196;	// tan(30°)
+	const float	CenterWeight = 0.25 * PI;
+	const float	SideWeight = 0.15 * PI;
+
+	float3	Up = abs( _wsNormal.y ) < 0.999 ? float3( 0, 1, 0 ) : float3( 1, 0, 0 );
+	float3	Tangent = normalize( cross( Up, _wsNormal ) );
+	float3	BiTangent = cross( _wsNormal, Tangent );
+
+	float3	Origin = _wsPosition + _VoxelLevels[0].w * _wsNormal;
+
+	float4	Cone = ConeTrace( Origin, _wsNormal, Aperture, _VoxelMaxDistance );
+	float3	Irradiance = CenterWeight * (Cone.xyz + (1.0 - Cone.w) * max( 0.0, EvaluateSkySH( _wsNormal, 0 ) ));
+	[loop]
+	for ( uint ConeIndex=0; ConeIndex < 5; ConeIndex++ )
+	{
+		float	Phi = 2.0 * PI * ConeIndex / 5.0;
+		float3	Direction = 0.5 * _wsNormal + 0.86602540378443864676372317075294 * (cos( Phi ) * Tangent + sin( Phi ) * BiTangent);	// 60° off the normal
+
+		Cone = ConeTrace( Origin, Direction, Aperture, _VoxelMaxDistance );
+		Irradiance += SideWeight * (Cone.xyz + (1.0 - Cone.w) * max( 0.0, EvaluateSkySH( Direction, 0 ) ));
+	}
+
+	return Irradiance;
+}
+
+// Radiance reflected toward the camera from a single cone along the mirror direction, as wide as the GGX lobe
+float3	ConeTraceSpecular( float3 _wsPosition, float3 _wsNormal, float3 _wsView, float _Roughness )
+{
+	float3	Reflected = reflect( -_wsView, _wsNormal );
+	float	Aperture = clamp( _Roughness * _Roughness, 0.02, 1.0 );	// tan(half-angle) ~ alpha
+
+	float4	Cone = ConeTrace( _wsPosition + _VoxelLevels[0].w * _wsNormal, Reflected, Aperture, _VoxelMaxDistance );
+	return Cone.xyz + (1.0 - Cone.w) * max( 0.0, EvaluateSkySH( Reflected, 0 ) );
+}
+
+#endif
@@ -0,0 +1,146 @@
+//////////////////////////////////////////////////////////////////////////
+// Jump flooding kernels (cf. Procedural/JumpFlood.h)
+// The seed textures store (Seed position in texels, Seed ID, 0) with a negative ID for texels that didn't find any seed yet
+//
+#define	THREADS_X	16
+#define	THREADS_Y	16
+#define	SPLAT_GROUP_SIZE	256
+
+#define	FLAG_WRAP		1
+#define	FLAG_INSIDE		2
+
+static const float	INFINITY = 1e30;
+
+cbuffer	cbJumpFlood : register( b10 )
+{
+	uint2	_Size;
+	uint	_Step;
+	uint	_Flags;
+	uint	_SeedsCount;
+	float	_Threshold;
+	float	_InvWidth;
+};
+
+StructuredBuffer<float2>	_Seeds : register( t10 );		// Seed positions in UV
+Texture2D<float4>			_TexSeeds : register( t10 );	// Current nearest seeds
+Texture2D<float4>			_TexMask : register( t10 );
+Texture2D<float4>			_TexPreviousResult : register( t11 );
+
+RWTexture2D<float4>			_Out : register( u0 );
+
+// Vector from the texel to the seed, the shortest one on the torus when wrapping
+float2	ToSeed( float2 _Position, float2 _Seed )
+{
+	float2	Delta = _Seed - _Position;
+	if ( _Flags & FLAG_WRAP )
+		Delta -= _Size * round( Delta / _Size );
+	return Delta;
+}
+
+[numthreads( THREADS_X, THREADS_Y, 1 )]
+void	CS_Clear( uint3 _DispatchThreadID : SV_DISPATCHTHREADID )
+{
+	if ( any( _DispatchThreadID.xy >= _Size ) )
+		return;
+
+	_Out[_DispatchThreadID.xy] = float4( 0, 0, -1, 0 );
+}
+
+[numthreads( SPLAT_GROUP_SIZE, 1, 1 )]
+void	CS_SplatSeeds( uint3 _DispatchThreadID : SV_DISPATCHTHREADID )
+{
+	uint	SeedIndex = _DispatchThreadID.x;
+	if ( SeedIndex >= _SeedsCount )
+		return;
+
+	float2	Position = _Seeds[SeedIndex] * _Size;
+	int2	Texel = int2( floor( Position ) );
+	if ( _Flags & FLAG_WRAP )
+		Texel = (Texel % int2( _Size ) + int2( _Size )) % int2( _Size );
+	else
+		Texel = clamp( Texel, 0, int2( _Size ) - 1 );
+
+	_Out[Texel] = float4( Position, SeedIndex, 0 );
+}
+
+[numthreads( THREADS_X, THREADS_Y, 1 )]
+void	CS_SplatMask( uint3 _DispatchThreadID : SV_DISPATCHTHREADID )
+{
+	uint2	Texel = _DispatchThreadID.xy;
+	if ( any( Texel >= _Size ) )
+		return;
+
+	bool	bInside = _TexMask[Texel].x >= _Threshold;
+	bool	bSeed = bInside == ((_Flags & FLAG_INSIDE) != 0);
+	_Out[Texel] = bSeed ? float4( Texel + 0.5, _Size.x * Texel.y + Texel.x, 0 ) : float4( 0, 0, -1, 0 );
+}
+
+[numthreads( THREADS_X, THREADS_Y, 1 )]
+void	CS_Step( uint3 _DispatchThreadID : SV_DISPATCHTHREADID )
+{
+	int2	Texel = int2( _DispatchThreadID.xy );
+	if ( any( Texel >= int2( _Size ) ) )
+		return;
+
+	float2	Position = Texel + 0.5;
+	float4	Nearest = _TexSeeds[Texel];
+	float	NearestSqDistance = Nearest.z >= 0.0 ? dot( ToSeed( Position, Nearest.xy ), ToSeed( Position, Nearest.xy ) ) : INFINITY;
+
+	for ( int Y=-1; Y <= 1; Y++ )
+		for ( int X=-1; X <= 1; X++ )
+		{
+			if ( X == 0 && Y == 0 )
+				continue;
+
+			int2	Neighbor = Texel + _Step * int2( X, Y );
+			if ( _Flags & FLAG_WRAP )
+				Neighbor = (Neighbor % int2( _Size ) + int2( _Size )) % int2( _Size );
+			else if ( any( Neighbor < 0 ) || any( Neighbor >= int2( _Size ) ) )
+				continue;
+
+			float4	Seed = _TexSeeds[Neighbor];
+			if ( Seed.z < 0.0 )
+				continue;
+
+			float2	Delta = ToSeed( Position, Seed.xy );
+			float	SqDistance = dot( Delta, Delta );
+			if ( SqDistance < NearestSqDistance )
+			{
+				Nearest = Seed;
+				NearestSqDistance = SqDistance;
+			}
+		}
+
+	_Out[Texel] = Nearest;
+}
+
+// Writes (Seed ID, Distance, Distance, 0)
+[numthreads( THREADS_X, THREADS_Y, 1 )]
+void	CS_Resolve( uint3 _DispatchThreadID : SV_DISPATCHTHREADID )
+{
+	uint2	Texel = _DispatchThreadID.xy;
+	if ( any( Texel >= _Size ) )
+		return;
+
+	float4	Nearest = _TexSeeds[Texel];
+	float	Distance = Nearest.z >= 0.0 ? _InvWidth * length( ToSeed( Texel + 0.5, Nearest.xy ) ) : INFINITY;
+	_Out[Texel] = float4( Nearest.z, Distance, Distance, 0 );
+}
+
+// Combines the distance to the inside texels (previous result) with the distance to the outside texels (current seeds)
+//	into (Texel ID, Distance, Signed Distance, 0)
+[numthreads( THREADS_X, THREADS_Y, 1 )]
+void	CS_ResolveSigned( uint3 _DispatchThreadID : SV_DISPATCHTHREADID )
+{
+	uint2	Texel = _DispatchThreadID.xy;
+	if ( any( Texel >= _Size ) )
+		return;
+
+	float4	ToInside = _TexPreviousResult[Texel];
+	float4	NearestOutside = _TexSeeds[Texel];
+	float	DistanceToOutside = NearestOutside.z >= 0.0 ? _InvWidth * length( ToSeed( Texel + 0.5, NearestOutside.xy ) ) : INFINITY;
+
+	// Inside texels are their own nearest inside texel
+	bool	bInside = ToInside.y == 0.0;
+	_Out[Texel] = bInside ? float4( NearestOutside.z, DistanceToOutside, -DistanceToOutside, 0 ) : float4( ToInside.x, ToInside.y, ToInside.y, 0 );
+}
@@ -0,0 +1,111 @@
+//////////////////////////////////////////////////////////////////////////
+// Compute mip downsampler (cf. Utility/MipGenerator.h)
+// Each dispatch writes a single mip from the previous one, one thread per target texel:
+//	_ CS_Box averages the source texels covered by the target texel. When a source size is odd, the target texel covers
+//		1.5 source texels on that axis so 3 texels get weighted by their coverage instead of 2 (no texel gets dropped)
+//	_ CS_Kaiser uses a 4x4 Kaiser-windowed sinc (Beta=4, radius of 2 source texels) that keeps the mips sharper than the box,
+//		it falls back to the box weights on the axes whose source size is odd
+// When the texels are sRGB-encoded in a linear format (sRGB formats can't be UAVs), they're filtered in linear space.
+//
+#define	THREADS_X	16
+#define	THREADS_Y	16
+
+cbuffer	cbMipGenerator : register( b10 )
+{
+	uint2	_SourceSize;
+	uint2	_TargetSize;
+	uint	_bSRGB;			// True if the texels are sRGB-encoded
+};
+
+Texture2D<float4>		_TexSource : register( t10 );	// The previous mip
+RWTexture2D<float4>		_Target : register( u0 );
+
+float3	SRGB2Linear( float3 _sRGB )
+{
+	return _sRGB <= 0.04045 ? _sRGB / 12.92 : pow( (_sRGB + 0.055) / 1.055, 2.4 );
+}
+
+float3	Linear2SRGB( float3 _Linear )
+{
+	return _Linear <= 0.0031308 ? 12.92 * _Linear : 1.055 * pow( _Linear, 1.0 / 2.4 ) - 0.055;
+}
+
+float4	LoadSource( int2 _Texel )
+{
+	float4	Value = _TexSource[clamp( _Texel, 0, int2(_SourceSize) - 1 )];
+	if ( _bSRGB )
+		Value.xyz = SRGB2Linear( Value.xyz );
+	return Value;
+}
+
+void	StoreTarget( uint2 _Texel, float4 _Value )
+{
+	if ( _bSRGB )
+		_Target[_Texel] = float4( Linear2SRGB( saturate( _Value.xyz ) ), _Value.w );
+	else
+		_Target[_Texel] = _Value;
+}
+
+// Returns the weights of the 3 source texels starting at 2*_Texel covered by the target texel
+float3	BoxWeights( uint _Texel, uint _SourceSize, uint _TargetSize )
+{
+	if ( _SourceSize == 1 )
+		return float3( 1, 0, 0 );	// The other axis is still being downsampled
+	if ( (_SourceSize & 1) == 0 )
+		return float3( 0.5, 0.5, 0 );
+
+	float	InvSize = 1.0 / _SourceSize;	// Source = 2*Target+1
+	return float3( _TargetSize - _Texel, _TargetSize, _Texel + 1 ) * InvSize;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+[numthreads( THREADS_X, THREADS_Y, 1 )]
+void	CS_Box( uint3 _DispatchThreadID : SV_DispatchThreadID )
+{
+	uint2	Texel = _DispatchThreadID.xy;
+	if ( any( Texel >= _TargetSize ) )
+		return;
+
+	float3	WeightsX = BoxWeights( Texel.x, _SourceSize.x, _TargetSize.x );
+	float3	WeightsY = BoxWeights( Texel.y, _SourceSize.y, _TargetSize.y );
+	int2	Source = Texel << 1;
+
+	float4	Sum = 0.0;
+	[unroll]
+	for ( uint Y=0; Y < 3; Y++ )
+		[unroll]
+		for ( uint X=0; X < 3; X++ )
+			if ( WeightsX[X] * WeightsY[Y] > 0.0 )
+				Sum += WeightsX[X] * WeightsY[Y] * LoadSource( Source + int2( X, Y ) );
+
+	StoreTarget( Texel, Sum );
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+static const float4	KAISER_WEIGHTS = float4( 0.0524, 0.4476, 0.4476, 0.0524 );	// Taps at -1.5, -0.5, +0.5, +1.5 source texels from the target texel's center
+
+[numthreads( THREADS_X, THREADS_Y, 1 )]
+void	CS_Kaiser( uint3 _DispatchThreadID : SV_DispatchThreadID )
+{
+	uint2	Texel = _DispatchThreadID.xy;
+	if ( any( Texel >= _TargetSize ) )
+		return;
+
+	// Odd axes use the 3 box weights on the texels 2*Texel to 2*Texel+2
+	bool2	bOdd = (_SourceSize & 1) != 0;
+	float4	WeightsX = bOdd.x ? float4( 0.0, BoxWeights( Texel.x, _SourceSize.x, _TargetSize.x ) ) : KAISER_WEIGHTS;
+	float4	WeightsY = bOdd.y ? float4( 0.0, BoxWeights( Texel.y, _SourceSize.y, _TargetSize.y ) ) : KAISER_WEIGHTS;
+	int2	Source = int2( Texel << 1 ) - 1;
+
+	float4	Sum = 0.0;
+	[unroll]
+	for ( uint Y=0; Y < 4; Y++ )
+		[unroll]
+		for ( uint X=0; X < 4; X++ )
+			if ( WeightsX[X] * WeightsY[Y] > 0.0 )
+				Sum += WeightsX[X] * WeightsY[Y] * LoadSource( Source + int2( X, Y ) );
+
+	StoreTarget( Texel, Sum );
+}
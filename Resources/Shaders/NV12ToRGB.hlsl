@@ -0,0 +1,48 @@
+//////////////////////////////////////////////////////////////////////////
+// Converts a decoded NV12 video frame into linear RGB (cf. Utility/VideoSource.h)
+//
+//	_ CS_Convert, reads the full resolution luma plane and bilinearly upsamples the half resolution chroma plane of a
+//		decoder texture slice, applies the YUV->RGB matrix of the video (BT.601 or BT.709, limited or full range)
+//		then linearizes the sRGB-like transfer so the frame can be lit and blended like our other textures.
+//
+#include "Inc/Global.hlsl"
+
+cbuffer	cbConvert : register( b10 )
+{
+	uint2	_FrameSize;
+	float4	_RowR;					// Coefficients applied to (Y,U,V,1) for each component
+	float4	_RowG;
+	float4	_RowB;
+};
+
+Texture2DArray<float>	_TexLuma : register( t10 );		// Always a single slice of the decoder texture
+Texture2DArray<float2>	_TexChroma : register( t11 );
+
+RWTexture2D<float4>		_Out : register( u0 );
+
+float3	Linearize( float3 _Color )
+{
+	return _Color <= 0.04045 ? _Color / 12.92 : pow( (_Color + 0.055) / 1.055, 2.4 );
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+[numthreads( 8, 8, 1 )]
+void	CS_Convert( uint3 _DispatchThreadID : SV_DISPATCHTHREADID )
+{
+	uint2	PixelPosition = _DispatchThreadID.xy;
+	if ( any( PixelPosition >= _FrameSize ) )
+		return;
+
+	// The decoder texture can be larger than the frame (e.g. 1088 lines for 1080p) so we normalize with its actual size
+	uint3	LumaSize;
+	_TexLuma.GetDimensions( LumaSize.x, LumaSize.y, LumaSize.z );
+
+	float	Y = _TexLuma[uint3( PixelPosition, 0 )];
+	float2	UV = _TexChroma.SampleLevel( LinearClamp, float3( (PixelPosition + 0.5) / LumaSize.xy, 0.0 ), 0.0 );
+
+	float4	YUV1 = float4( Y, UV, 1.0 );
+	float3	RGB = saturate( float3( dot( _RowR, YUV1 ), dot( _RowG, YUV1 ), dot( _RowB, YUV1 ) ) );
+
+	_Out[PixelPosition] = float4( Linearize( RGB ), 1.0 );
+}
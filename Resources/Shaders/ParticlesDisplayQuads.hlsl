@@ -0,0 +1,75 @@
+//////////////////////////////////////////////////////////////////////////
+// Displays the compute particles as camera-facing quads (cf. EffectParticles::Render() with PARTICLES_COMPUTE)
+// The screen quad is instanced once per entry of the sort list, which is ordered back to front (cf. ParticlesSimulateCS.hlsl).
+// There is no indirect draw so the CPU always draws the maximum amount of instances and the ones beyond the amount of live particles
+//	are collapsed outside of the clip volume.
+//
+#include "Inc/Global.hlsl"
+
+cbuffer	cbSimulate : register( b11 )
+{
+	uint	_MaxParticlesCount;
+	uint	_EmitCount;
+	float	_DeltaTime;
+	float	_Time;
+
+	float3	_EmitterCenter;
+	float	_EmitterGreatRadius;
+	float	_EmitterSmallRadius;
+	float	_LifeTime;
+	float	_ParticleSize;
+	float	_EmissivePower;
+};
+
+struct	Particle
+{
+	float3	Position;
+	float	Life;
+	float3	Velocity;
+	float	Seed;
+};
+
+StructuredBuffer<Particle>	_Particles : register( t10 );
+StructuredBuffer<uint2>		_SortList : register( t11 );
+StructuredBuffer<uint>		_Counters : register( t12 );
+
+struct	VS_IN
+{
+	float4	__Position : SV_POSITION;	// XY=Quad corner in [-1,+1]
+	uint	InstanceID : SV_INSTANCEID;
+};
+
+struct	PS_IN
+{
+	float4	__Position : SV_POSITION;
+	float2	UV : TEXCOORD0;
+	float4	Color : COLOR;
+};
+
+PS_IN	VS( VS_IN _In )
+{
+	PS_IN	Out;
+	Out.UV = _In.__Position.xy;
+	if ( _In.InstanceID >= _Counters[1] )
+	{	// Not a live particle
+		Out.__Position = float4( 0, 0, -1, 1 );
+		Out.Color = 0.0;
+		return Out;
+	}
+
+	Particle	P = _Particles[_SortList[_In.InstanceID].y];
+
+	float	Size = _ParticleSize * (0.5 + P.Seed) * sin( 3.14159265 * P.Life );	// Grow then shrink
+	float3	WorldPosition = P.Position + Size * (_In.__Position.x * _Camera2World[0].xyz + _In.__Position.y * _Camera2World[1].xyz);
+	Out.__Position = mul( float4( WorldPosition, 1.0 ), _World2Proj );
+
+	float3	Color = lerp( float3( 1.0, 0.3, 0.05 ), float3( 1.0, 0.9, 0.6 ), P.Life );
+	Out.Color = float4( _EmissivePower * Color, saturate( 2.0 * P.Life ) );
+	return Out;
+}
+
+float4	PS( PS_IN _In ) : SV_TARGET0
+{
+	float	Alpha = _In.Color.w * saturate( 1.0 - dot( _In.UV, _In.UV ) );
+	return float4( _In.Color.xyz, Alpha );
+}
@@ -0,0 +1,199 @@
+//////////////////////////////////////////////////////////////////////////
+// Compute particles engine (cf. EffectParticles::Render() with PARTICLES_COMPUTE)
+// Particles live in a pool of _MaxParticlesCount structured elements, the free slots being listed in a dead list:
+//	_ CS_Emit pops _EmitCount slots from the dead list and spawns particles on the surface of the torus
+//	_ CS_Simulate integrates every live particle of the pool, pushes the ones that die back into the dead list and appends the
+//		survivors to the sort list with their distance to the camera
+//	_ CS_SortLocal & CS_SortStep bitonic sort the whole sort list so the display draws the particles back to front
+//
+// The StructuredBuffer class doesn't create append/consume views so the dead & sort lists are managed with atomics on _Counters
+//	instead: _Counters[0] is the dead list's size, _Counters[1] the amount of particles appended to the sort list this frame.
+//
+#include "Inc/Global.hlsl"
+
+#define	SORT_GROUP_SIZE		1024	// !!IMPORTANT ==> Must correspond to EffectParticles::SORT_GROUP_SIZE!!
+#define	THREADS_COUNT		256
+
+cbuffer	cbSimulate : register( b11 )
+{
+	uint	_MaxParticlesCount;
+	uint	_EmitCount;					// Particles to spawn this frame
+	float	_DeltaTime;
+	float	_Time;
+
+	float3	_EmitterCenter;
+	float	_EmitterGreatRadius;
+	float	_EmitterSmallRadius;
+	float	_LifeTime;					// Life time of a particle in seconds
+	float	_ParticleSize;
+	float	_EmissivePower;
+};
+
+cbuffer	cbSort : register( b12 )
+{
+	uint	_SortBlockSize;				// Size of the bitonic sequences being merged, 0 to fully sort each group's block
+	uint	_SortStride;				// Distance between the compared elements
+};
+
+struct	Particle
+{
+	float3	Position;
+	float	Life;						// 1 at birth, dead once <= 0
+	float3	Velocity;
+	float	Seed;
+};
+
+RWStructuredBuffer<Particle>	_Particles : register( u0 );
+RWStructuredBuffer<uint>		_DeadList : register( u1 );
+RWStructuredBuffer<uint2>		_SortList : register( u2 );		// X=Sort key (far particles first) Y=Particle index
+RWStructuredBuffer<uint>		_Counters : register( u3 );
+
+float	Hash( uint _Seed )
+{
+	_Seed = (_Seed ^ 61) ^ (_Seed >> 16);
+	_Seed *= 9;
+	_Seed = _Seed ^ (_Seed >> 4);
+	_Seed *= 0x27D4EB2D;
+	_Seed = _Seed ^ (_Seed >> 15);
+	return float(_Seed & 0xFFFFFF) / 16777216.0;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// Emission
+[numthreads( THREADS_COUNT, 1, 1 )]
+void	CS_Emit( uint3 _ThreadID : SV_DISPATCHTHREADID )
+{
+	if ( _ThreadID.x == 0 )
+		_Counters[1] = 0;	// Nobody appends to the sort list before CS_Simulate
+	if ( _ThreadID.x >= _EmitCount )
+		return;
+
+	// Pop a free slot
+	uint	DeadCount;
+	InterlockedAdd( _Counters[0], 0xFFFFFFFF, DeadCount );
+	if ( DeadCount == 0 || DeadCount > _MaxParticlesCount )
+	{	// The pool is full, restore the counter
+		InterlockedAdd( _Counters[0], 1 );
+		return;
+	}
+	uint	ParticleIndex = _DeadList[DeadCount-1];
+
+	// Spawn on the surface of the torus, flying away along the normal
+	uint	Seed = ParticleIndex ^ asuint( _Time );
+	float	Alpha = 6.283185307 * Hash( Seed );			// Angle on the great circle
+	float	Beta = 6.283185307 * Hash( Seed + 1 );		// Angle on the small circle
+
+	float3	T = float3( cos( Alpha ), 0.0, -sin( Alpha ) );
+	float3	Normal = cos( Beta ) * T + float3( 0, sin( Beta ), 0 );
+
+	Particle	P;
+	P.Position = _EmitterCenter + _EmitterGreatRadius * T + _EmitterSmallRadius * Normal;
+	P.Velocity = (0.2 + 0.3 * Hash( Seed + 2 )) * Normal;
+	P.Life = 1.0;
+	P.Seed = Hash( Seed + 3 );
+	_Particles[ParticleIndex] = P;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// Simulation
+[numthreads( THREADS_COUNT, 1, 1 )]
+void	CS_Simulate( uint3 _ThreadID : SV_DISPATCHTHREADID )
+{
+	uint	ParticleIndex = _ThreadID.x;
+	if ( ParticleIndex >= _MaxParticlesCount )
+		return;
+
+	Particle	P = _Particles[ParticleIndex];
+	if ( P.Life <= 0.0 )
+		return;	// Already in the dead list
+
+	P.Life -= _DeltaTime / _LifeTime;
+	if ( P.Life <= 0.0 )
+	{	// Give the slot back
+		P.Life = 0.0;
+		_Particles[ParticleIndex] = P;
+
+		uint	DeadIndex;
+		InterlockedAdd( _Counters[0], 1, DeadIndex );
+		_DeadList[DeadIndex] = ParticleIndex;
+		return;
+	}
+
+	// Swirl around the torus' axis while rising slowly, with some drag
+	float3	ToAxis = float3( _EmitterCenter.x - P.Position.x, 0.0, _EmitterCenter.z - P.Position.z );
+	float3	Swirl = float3( -ToAxis.z, 0.0, ToAxis.x );
+	float3	Acceleration = 0.5 * Swirl + 0.2 * ToAxis + float3( 0, 0.1 + 0.1 * P.Seed, 0 ) - 0.5 * P.Velocity;
+	P.Velocity += _DeltaTime * Acceleration;
+	P.Position += _DeltaTime * P.Velocity;
+	_Particles[ParticleIndex] = P;
+
+	// Append to the sort list, the key of the farthest particles is the smallest
+	float3	ToCamera = _Camera2World[3].xyz - P.Position;
+	uint	SortIndex;
+	InterlockedAdd( _Counters[1], 1, SortIndex );
+	_SortList[SortIndex] = uint2( ~asuint( length( ToCamera ) ), ParticleIndex );
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// Bitonic sort of the whole list in ascending key order, the unused entries are cleared to 0xFFFFFFFF by the CPU so they end up last
+//	_ CS_SortLocal sorts or merges a block of SORT_GROUP_SIZE entries in groupshared memory (i.e. all the strides < SORT_GROUP_SIZE)
+//	_ CS_SortStep performs a single compare & swap pass with a stride >= SORT_GROUP_SIZE
+//
+groupshared uint2	gs_Sort[SORT_GROUP_SIZE];
+
+void	CompareAndSwap( inout uint2 _A, inout uint2 _B, bool _Ascending )
+{
+	if ( (_A.x > _B.x) == _Ascending )
+	{
+		uint2	Temp = _A;
+		_A = _B;
+		_B = Temp;
+	}
+}
+
+[numthreads( SORT_GROUP_SIZE, 1, 1 )]
+void	CS_SortLocal( uint3 _ThreadID : SV_DISPATCHTHREADID, uint _ThreadIndex : SV_GROUPINDEX )
+{
+	gs_Sort[_ThreadIndex] = _SortList[_ThreadID.x];
+	GroupMemoryBarrierWithGroupSync();
+
+	uint	BlockSizeStart = _SortBlockSize == 0 ? 2 : _SortBlockSize;
+	uint	BlockSizeEnd = _SortBlockSize == 0 ? SORT_GROUP_SIZE : _SortBlockSize;
+	for ( uint BlockSize=BlockSizeStart; BlockSize <= BlockSizeEnd; BlockSize <<= 1 )
+	{
+		bool	Ascending = (_ThreadID.x & BlockSize) == 0;
+		for ( uint Stride=min( BlockSize, SORT_GROUP_SIZE ) >> 1; Stride > 0; Stride >>= 1 )
+		{
+			uint	Other = _ThreadIndex ^ Stride;
+			if ( Other > _ThreadIndex )
+			{
+				uint2	A = gs_Sort[_ThreadIndex];
+				uint2	B = gs_Sort[Other];
+				CompareAndSwap( A, B, Ascending );
+				gs_Sort[_ThreadIndex] = A;
+				gs_Sort[Other] = B;
+			}
+			GroupMemoryBarrierWithGroupSync();
+		}
+	}
+
+	_SortList[_ThreadID.x] = gs_Sort[_ThreadIndex];
+}
+
+[numthreads( SORT_GROUP_SIZE, 1, 1 )]
+void	CS_SortStep( uint3 _ThreadID : SV_DISPATCHTHREADID )
+{
+	uint	Index = _ThreadID.x;
+	uint	Other = Index ^ _SortStride;
+	if ( Other < Index )
+		return;
+
+	uint2	A = _SortList[Index];
+	uint2	B = _SortList[Other];
+	CompareAndSwap( A, B, (Index & _SortBlockSize) == 0 );
+	_SortList[Index] = A;
+	_SortList[Other] = B;
+}
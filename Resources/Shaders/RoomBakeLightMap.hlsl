@@ -0,0 +1,143 @@
+//////////////////////////////////////////////////////////////////////////
+// Progressive light map baker (cf. EffectRoom::BakeLightMaps() with PROGRESSIVE_LIGHTMAPS)
+// Each frame traces a few more paths from every texel of a face of the room and accumulates them into _LightMapAccum,
+//	then writes the average into the face's area of the light map array.
+// The 4 neons are stored in separate channels (i.e. per-light layers) so the display recombines them linearly with the animated
+//	light intensities.
+//
+// The room is an empty convex box so every point sees the whole room: paths never need a visibility test and the neons are sampled
+//	directly at each vertex of the path (next event estimation), the neon emitting a unit radiance.
+//
+#include "Inc/Global.hlsl"
+
+#define	ROOM_HEIGHT			5.0		// !!IMPORTANT ==> Must correspond to ROOM_HEIGHT in EffectRoom.h!!
+#define	ROOM_SIZE			10.0	// !!IMPORTANT ==> Must correspond to ROOM_SIZE in EffectRoom.h!!
+#define	ROOM_BOUNCES_COUNT	4		// !!IMPORTANT ==> Must correspond to ROOM_BOUNCES_COUNT in EffectRoom.h!!
+#define	ROOM_ALBEDO			0.75	// Average reflectance of the panels
+
+static const float2	NEON_SIZE = float2( 1.0, 8.0 );						// !!IMPORTANT ==> Must correspond to the neons built in EffectRoom::BuildRoom()!!
+static const float	NEON_FIRST_X = -0.5 * ROOM_SIZE + 0.5 * (ROOM_SIZE - 7.0 * NEON_SIZE.x);
+static const float	NEON_Z = -0.5 * ROOM_SIZE + 0.5 * (ROOM_SIZE - NEON_SIZE.y);
+
+cbuffer	cbBake : register( b11 )
+{
+	uint2	_LightMapSize;				// Size of the face's light map
+	uint	_TargetSlice;				// Slice of the light map array receiving the face
+	uint	_TargetOffsetY;				// Walls are packed 2 by 2 in a slice
+	uint	_FirstSampleIndex;			// Index of the first sample traced this frame
+	uint	_SamplesCount;				// Samples traced this frame
+	float	_InvTotalSamplesCount;		// 1 / Samples accumulated so far
+};
+
+struct	LightMapInfos
+{
+	float3	Position;
+	uint	Seed0;
+	float3	Normal;
+	uint	Seed1;
+	float3	Tangent;
+	uint	Seed2;
+	float3	BiTangent;
+	uint	Seed3;
+};
+
+StructuredBuffer<LightMapInfos>	_LightMapInfos : register( t10 );
+RWStructuredBuffer<float4>		_LightMapAccum : register( u0 );		// Sum of the irradiance samples, one channel per neon
+RWTexture2DArray<float4>		_OutLightMaps : register( u1 );
+
+uint	WangHash( uint _Seed )
+{
+	_Seed = (_Seed ^ 61) ^ (_Seed >> 16);
+	_Seed *= 9;
+	_Seed = _Seed ^ (_Seed >> 4);
+	_Seed *= 0x27D4EB2D;
+	return _Seed ^ (_Seed >> 15);
+}
+
+float	Random( inout uint _State )
+{
+	_State = 1664525 * _State + 1013904223;
+	return float(_State >> 8) / 16777216.0;
+}
+
+// Irradiance from each neon at a point of the room
+float4	ComputeDirectIrradiance( float3 _Position, float3 _Normal, inout uint _State )
+{
+	float4	Irradiance = 0.0;
+	[unroll]
+	for ( uint NeonIndex=0; NeonIndex < 4; NeonIndex++ )
+	{
+		float3	NeonPosition = float3( NEON_FIRST_X + 2.0 * NEON_SIZE.x * NeonIndex + NEON_SIZE.x * Random( _State ), ROOM_HEIGHT, NEON_Z + NEON_SIZE.y * Random( _State ) );
+		float3	ToNeon = NeonPosition - _Position;
+		float	SqDistance = max( 1e-4, dot( ToNeon, ToNeon ) );
+		ToNeon *= rsqrt( SqDistance );
+
+		float	CosSurface = saturate( dot( ToNeon, _Normal ) );
+		float	CosNeon = saturate( -ToNeon.y );	// Neons face down
+		Irradiance[NeonIndex] = CosSurface * CosNeon * (NEON_SIZE.x * NEON_SIZE.y) / SqDistance;
+	}
+	return Irradiance;
+}
+
+// Intersects a ray started inside the room with its walls, returns the hit position & the wall's normal
+float3	IntersectRoom( float3 _Position, float3 _Direction, out float3 _Normal )
+{
+	float3	BoxMin = float3( -0.5 * ROOM_SIZE, 0.0, -0.5 * ROOM_SIZE );
+	float3	BoxMax = float3( +0.5 * ROOM_SIZE, ROOM_HEIGHT, +0.5 * ROOM_SIZE );
+	float3	Exit = (_Direction > 0.0 ? BoxMax - _Position : BoxMin - _Position) / (abs( _Direction ) > 1e-6 ? _Direction : 1e-6);
+
+	float	Distance = min( min( Exit.x, Exit.y ), Exit.z );
+	_Normal = Distance == Exit.x ? float3( -sign( _Direction.x ), 0, 0 ) : (Distance == Exit.y ? float3( 0, -sign( _Direction.y ), 0 ) : float3( 0, 0, -sign( _Direction.z ) ));
+	return _Position + Distance * _Direction;
+}
+
+// Cosine-weighted direction around the normal
+float3	SampleHemisphere( float3 _Normal, float3 _Tangent, float3 _BiTangent, inout uint _State )
+{
+	float	Phi = 6.283185307 * Random( _State );
+	float	SqSinTheta = Random( _State );
+	float	SinTheta = sqrt( SqSinTheta );
+	return SinTheta * (cos( Phi ) * _Tangent + sin( Phi ) * _BiTangent) + sqrt( 1.0 - SqSinTheta ) * _Normal;
+}
+
+[numthreads( 8, 8, 1 )]
+void	CS( uint3 _ThreadID : SV_DISPATCHTHREADID )
+{
+	if ( any( _ThreadID.xy >= _LightMapSize ) )
+		return;
+
+	uint			TexelIndex = _LightMapSize.x * _ThreadID.y + _ThreadID.x;
+	LightMapInfos	Infos = _LightMapInfos[TexelIndex];
+
+	float4	Sum = 0.0;
+	for ( uint SampleIndex=0; SampleIndex < _SamplesCount; SampleIndex++ )
+	{
+		uint	State = WangHash( TexelIndex ^ WangHash( Infos.Seed0 + _FirstSampleIndex + SampleIndex ) );
+
+		float3	Position = Infos.Position;
+		float3	Normal = Infos.Normal;
+		float3	Tangent = Infos.Tangent;
+		float3	BiTangent = Infos.BiTangent;
+
+		// E(x) = Ed(x) + Albedo * Ed(y) + Albedo^2 * Ed(z) + ... with cosine-weighted directions
+		float4	Irradiance = ComputeDirectIrradiance( Position, Normal, State );
+		float	Throughput = 1.0;
+		for ( uint BounceIndex=0; BounceIndex < ROOM_BOUNCES_COUNT; BounceIndex++ )
+		{
+			float3	Direction = SampleHemisphere( Normal, Tangent, BiTangent, State );
+			Position = IntersectRoom( Position, Direction, Normal );
+			Position += 1e-3 * Normal;
+			Tangent = normalize( cross( abs( Normal.y ) > 0.5 ? float3( 1, 0, 0 ) : float3( 0, 1, 0 ), Normal ) );
+			BiTangent = cross( Normal, Tangent );
+
+			Throughput *= ROOM_ALBEDO;
+			Irradiance += Throughput * ComputeDirectIrradiance( Position, Normal, State );
+		}
+
+		Sum += Irradiance;
+	}
+
+	float4	Accum = _LightMapAccum[TexelIndex] + Sum;
+	_LightMapAccum[TexelIndex] = Accum;
+	_OutLightMaps[uint3( _ThreadID.x, _TargetOffsetY + _ThreadID.y, _TargetSlice )] = Accum * _InvTotalSamplesCount;
+}
@@ -0,0 +1,98 @@
+//////////////////////////////////////////////////////////////////////////
+// Tessellation test of a displaced quad patch (cf. the disabled tessellation test in EffectRoom)
+// The factors come from the screen length of the patch's edges (cf. Inc/AdaptiveTessellation.hlsl) so the displacement keeps
+//	the same density in pixels whatever the distance, and the patches out of view or facing away are discarded by the hull shader.
+//
+#include "Inc/Global.hlsl"
+#include "Inc/AdaptiveTessellation.hlsl"
+
+#define	DISPLACEMENT_HEIGHT	0.1		// Maximum displacement along the normal
+
+struct	VS_IN
+{
+	float3	Position	: POSITION;
+	float2	UV			: TEXCOORD0;
+};
+
+struct	HS_CONSTANT_OUT
+{
+	float	Edges[4] : SV_TessFactor;
+	float	Inside[2] : SV_InsideTessFactor;
+	float3	Normal : NORMAL;
+};
+
+struct	PS_IN
+{
+	float4	__Position	: SV_POSITION;
+	float3	Normal		: NORMAL;
+	float2	UV			: TEXCOORD0;
+};
+
+float	Displacement( float2 _UV )
+{
+	return DISPLACEMENT_HEIGHT * sin( 8.0 * PI * _UV.x ) * sin( 8.0 * PI * _UV.y );
+}
+
+VS_IN	VS( VS_IN _In )
+{
+	return _In;
+}
+
+// Control points are ordered (0,0), (0,1), (1,1), (1,0) in UV, so SV_TessFactor's U=0, V=0, U=1, V=1 edges are P0P1, P0P3, P3P2 & P1P2
+HS_CONSTANT_OUT	HS_PatchConstant( InputPatch<VS_IN, 4> _Patch )
+{
+	float3	P0 = _Patch[0].Position;
+	float3	P1 = _Patch[1].Position;
+	float3	P2 = _Patch[2].Position;
+	float3	P3 = _Patch[3].Position;
+
+	HS_CONSTANT_OUT	Out;
+	Out.Normal = normalize( cross( P1 - P0, P3 - P0 ) );
+
+	uint	OutCode = FrustumOutCode( P0, DISPLACEMENT_HEIGHT ) & FrustumOutCode( P1, DISPLACEMENT_HEIGHT ) & FrustumOutCode( P2, DISPLACEMENT_HEIGHT ) & FrustumOutCode( P3, DISPLACEMENT_HEIGHT );
+	bool	bBackFacing = IsBackFacing( P0, Out.Normal ) && IsBackFacing( P1, Out.Normal ) && IsBackFacing( P2, Out.Normal ) && IsBackFacing( P3, Out.Normal );
+	if ( IsPatchCulled( OutCode, bBackFacing ) )
+	{
+		Out.Edges[0] = Out.Edges[1] = Out.Edges[2] = Out.Edges[3] = 0.0;
+		Out.Inside[0] = Out.Inside[1] = 0.0;
+		return Out;
+	}
+
+	Out.Edges[0] = EdgeTessFactor( P0, P1 );
+	Out.Edges[1] = EdgeTessFactor( P0, P3 );
+	Out.Edges[2] = EdgeTessFactor( P3, P2 );
+	Out.Edges[3] = EdgeTessFactor( P1, P2 );
+	Out.Inside[0] = InsideTessFactor( Out.Edges[1], Out.Edges[3] );	// Along U
+	Out.Inside[1] = InsideTessFactor( Out.Edges[0], Out.Edges[2] );	// Along V
+	return Out;
+}
+
+[domain( "quad" )]
+[partitioning( "fractional_odd" )]
+[outputtopology( "triangle_cw" )]
+[outputcontrolpoints( 4 )]
+[patchconstantfunc( "HS_PatchConstant" )]
+[maxtessfactor( 64.0 )]
+VS_IN	HS( InputPatch<VS_IN, 4> _Patch, uint _ControlPointID : SV_OUTPUTCONTROLPOINTID )
+{
+	return _Patch[_ControlPointID];
+}
+
+[domain( "quad" )]
+PS_IN	DS( HS_CONSTANT_OUT _Constants, float2 _UV : SV_DOMAINLOCATION, const OutputPatch<VS_IN, 4> _Patch )
+{
+	float3	wsPosition = lerp( lerp( _Patch[0].Position, _Patch[3].Position, _UV.x ), lerp( _Patch[1].Position, _Patch[2].Position, _UV.x ), _UV.y );
+	float2	UV = lerp( lerp( _Patch[0].UV, _Patch[3].UV, _UV.x ), lerp( _Patch[1].UV, _Patch[2].UV, _UV.x ), _UV.y );
+	wsPosition += Displacement( UV ) * _Constants.Normal;
+
+	PS_IN	Out;
+	Out.__Position = mul( float4( wsPosition, 1.0 ), _World2Proj );
+	Out.Normal = _Constants.Normal;
+	Out.UV = UV;
+	return Out;
+}
+
+float4	PS( PS_IN _In ) : SV_TARGET0
+{
+	return float4( _In.UV, 0, 1 );
+}
@@ -0,0 +1,171 @@
+//////////////////////////////////////////////////////////////////////////
+// Temporal anti-aliasing (cf. Utility/TemporalAA.h)
+//
+//	_ CS_CameraVelocity, reconstructs each pixel's world position from the depth and reprojects it with the previous frame's camera
+//	_ VS/PS_ObjectVelocity, draws a moving object over the camera velocity with its own motion
+//	_ CS_Resolve, reprojects the history with the dilated velocity, clamps it to the YCoCg bounding box of the current pixel's
+//		3x3 neighborhood and blends the current frame into it. The blend is weighted by the inverse luminance so the
+//		bright HDR samples don't flicker.
+//
+// The velocity is (previous UV - current UV) with the jitter of both frames removed, so a static scene has a null velocity.
+//
+#include "Inc/Global.hlsl"
+
+cbuffer	cbTemporalAA : register( b10 )
+{
+	uint2		_TargetSize;
+	float		_HistoryWeight;			// Weight of the history when it's valid
+	uint		_HistoryValid;
+
+	float4x4	_TAAWorld2Proj;			// Current frame, jittered
+	float4x4	_TAAProj2World;
+	float4x4	_TAAPreviousWorld2Proj;	// Previous frame, jittered
+	float4		_TAAJitter;				// XY=Current jitter, ZW=Previous jitter (in NDC)
+};
+
+cbuffer	cbObjectMotion : register( b11 )
+{
+	float4x4	_Local2World;
+	float4x4	_PreviousLocal2World;
+};
+
+Texture2D<float4>		_TexSource : register( t10 );
+Texture2D<float>		_TexDepth : register( t11 );
+Texture2D<float2>		_TexVelocity : register( t12 );
+Texture2D<float4>		_TexHistory : register( t13 );
+
+RWTexture2D<float2>		_OutVelocity : register( u0 );
+RWTexture2D<float4>		_Out : register( u0 );
+
+// Converts the difference of 2 jittered projections into a difference of unjittered UVs
+float2	ProjectedVelocity( float4 _PreviousProj, float4 _CurrentProj )
+{
+	float2	PreviousNDC = _PreviousProj.xy / _PreviousProj.w - _TAAJitter.zw;
+	float2	CurrentNDC = _CurrentProj.xy / _CurrentProj.w - _TAAJitter.xy;
+	return float2( 0.5, -0.5 ) * (PreviousNDC - CurrentNDC);
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+[numthreads( 8, 8, 1 )]
+void	CS_CameraVelocity( uint3 _ThreadID : SV_DispatchThreadID )
+{
+	if ( any( _ThreadID.xy >= _TargetSize ) )
+		return;
+
+	float2	UV = (_ThreadID.xy + 0.5) / _TargetSize;
+	float4	CurrentProj = float4( 2.0 * UV.x - 1.0, 1.0 - 2.0 * UV.y, _TexDepth[_ThreadID.xy], 1.0 );
+
+	float4	WorldPosition = mul( CurrentProj, _TAAProj2World );
+			WorldPosition /= WorldPosition.w;
+
+	_OutVelocity[_ThreadID.xy] = ProjectedVelocity( mul( WorldPosition, _TAAPreviousWorld2Proj ), CurrentProj );
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+struct	VS_IN
+{
+	float3	Position : POSITION;
+};
+
+struct	PS_IN
+{
+	float4	__Position : SV_POSITION;
+	float4	CurrentProj : CURRENT_PROJ;
+	float4	PreviousProj : PREVIOUS_PROJ;
+};
+
+PS_IN	VS_ObjectVelocity( VS_IN _In )
+{
+	float4	CurrentWorld = mul( float4( _In.Position, 1.0 ), _Local2World );
+	float4	PreviousWorld = mul( float4( _In.Position, 1.0 ), _PreviousLocal2World );
+
+	PS_IN	Out;
+	Out.__Position = mul( CurrentWorld, _TAAWorld2Proj );
+	Out.CurrentProj = Out.__Position;
+	Out.PreviousProj = mul( PreviousWorld, _TAAPreviousWorld2Proj );
+	return Out;
+}
+
+float2	PS_ObjectVelocity( PS_IN _In ) : SV_TARGET0
+{
+	return ProjectedVelocity( _In.PreviousProj, _In.CurrentProj );
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+float3	RGB2YCoCg( float3 _RGB )
+{
+	return float3(	 0.25 * _RGB.x + 0.5 * _RGB.y + 0.25 * _RGB.z,
+					 0.5  * _RGB.x				  - 0.5  * _RGB.z,
+					-0.25 * _RGB.x + 0.5 * _RGB.y - 0.25 * _RGB.z );
+}
+
+float3	YCoCg2RGB( float3 _YCoCg )
+{
+	return float3(	_YCoCg.x + _YCoCg.y - _YCoCg.z,
+					_YCoCg.x			+ _YCoCg.z,
+					_YCoCg.x - _YCoCg.y - _YCoCg.z );
+}
+
+// Clips the history toward the center of the box rather than clamping each channel, which keeps its hue
+float3	ClipToBox( float3 _History, float3 _Min, float3 _Max )
+{
+	float3	Center = 0.5 * (_Max + _Min);
+	float3	Extent = 0.5 * (_Max - _Min) + 1e-4;
+	float3	Offset = _History - Center;
+	float3	Ratio = abs( Offset / Extent );
+	float	MaxRatio = max( Ratio.x, max( Ratio.y, Ratio.z ) );
+	return MaxRatio > 1.0 ? Center + Offset / MaxRatio : _History;
+}
+
+[numthreads( 8, 8, 1 )]
+void	CS_Resolve( uint3 _ThreadID : SV_DispatchThreadID )
+{
+	if ( any( _ThreadID.xy >= _TargetSize ) )
+		return;
+
+	int2	MaxPixel = int2( _TargetSize ) - 1;
+
+	// Neighborhood color bounds & closest depth
+	float3	Current = 0.0;
+	float3	Min = 1e6;
+	float3	Max = -1e6;
+	float	ClosestZ = 1.0;
+	int2	ClosestPixel = _ThreadID.xy;
+	for ( int Y=-1; Y <= 1; Y++ )
+		for ( int X=-1; X <= 1; X++ )
+		{
+			int2	Pixel = clamp( int2( _ThreadID.xy ) + int2( X, Y ), 0, MaxPixel );
+			float3	Color = RGB2YCoCg( _TexSource[Pixel].xyz );
+			Min = min( Min, Color );
+			Max = max( Max, Color );
+			if ( X == 0 && Y == 0 )
+				Current = Color;
+
+			float	Z = _TexDepth[Pixel];
+			if ( Z < ClosestZ )
+			{
+				ClosestZ = Z;
+				ClosestPixel = Pixel;
+			}
+		}
+
+	// Reproject with the velocity of the closest pixel so silhouettes carry their object's motion
+	float2	UV = (_ThreadID.xy + 0.5) / _TargetSize;
+	float2	HistoryUV = UV + _TexVelocity[ClosestPixel];
+
+	float3	Result = Current;
+	if ( _HistoryValid != 0 && all( HistoryUV == saturate( HistoryUV ) ) )
+	{
+		float3	History = ClipToBox( RGB2YCoCg( _TexHistory.SampleLevel( LinearClamp, HistoryUV, 0.0 ).xyz ), Min, Max );
+
+		// Weigh by the inverse luminance so a single bright sample can't dominate the blend
+		float	CurrentWeight = (1.0 - _HistoryWeight) / (1.0 + Current.x);
+		float	HistoryWeight = _HistoryWeight / (1.0 + History.x);
+		Result = (CurrentWeight * Current + HistoryWeight * History) / (CurrentWeight + HistoryWeight);
+	}
+
+	_Out[_ThreadID.xy] = float4( max( 0.0, YCoCg2RGB( Result ) ), 1.0 );
+}
@@ -0,0 +1,220 @@
+//////////////////////////////////////////////////////////////////////////
+// Texture builder kernels (cf. Procedural/TextureBuilderGPU.h)
+// These are the GPU versions of the Generators & Filters fill functions, the fat pixels are stored in 2 planes:
+//	_ RGBA
+//	_ Material = (Height, Roughness, Metallic, MatID)
+//
+// Kernels read the current planes of the source/target and write the next planes of the target
+//
+#define	THREADS_X	16
+#define	THREADS_Y	16
+
+static const float	PI = 3.1415926535897932384626433832795;
+static const float	HALFPI = 0.5 * PI;
+
+#define	FLAG_NORMALIZE			1
+#define	FLAG_WRITE_ONLY_ALPHA	2
+#define	FLAG_WRAP				4
+
+cbuffer	cbKernel : register( b10 )
+{
+	uint2	_Size;
+	float	_HeightFactor;
+	uint	_Flags;
+	float2	_Direction;
+	uint	_KernelSize;		// Blur half size, erosion/dilation radius or AO directions count
+	uint	_SamplesCount;
+	float	_WeightFactor;		// Gaussian exponent factor
+	float	_InvSumWeights;		// Gaussian normalizer
+};
+
+Texture2D<float4>	_TexSourceRGBA : register( t10 );
+Texture2D<float4>	_TexSourceMaterial : register( t11 );
+Texture2D<float4>	_TexTargetRGBA : register( t12 );		// Current content of the target
+Texture2D<float4>	_TexTargetMaterial : register( t13 );
+
+RWTexture2D<float4>	_OutRGBA : register( u0 );
+RWTexture2D<float4>	_OutMaterial : register( u1 );
+
+int2	WrapCoords( int2 _P )
+{
+	int2	Size = int2( _Size );
+	return (_P % Size + Size) % Size;
+}
+
+int2	ClampCoords( int2 _P )
+{
+	return clamp( _P, 0, int2( _Size ) - 1 );
+}
+
+float4	Fetch( Texture2D<float4> _Tex, int2 _P, bool _bWrap )
+{
+	return _Tex[_bWrap ? WrapCoords( _P ) : ClampCoords( _P )];
+}
+
+// Same as TextureBuilder::SampleWrap()/SampleClamp()
+float4	Sample( Texture2D<float4> _Tex, float2 _Position, bool _bWrap )
+{
+	float2	P0 = floor( _Position );
+	float2	t = _Position - P0;
+	int2	X0 = int2( P0 );
+
+	float4	V00 = Fetch( _Tex, X0, _bWrap );
+	float4	V01 = Fetch( _Tex, X0 + int2( 1, 0 ), _bWrap );
+	float4	V10 = Fetch( _Tex, X0 + int2( 0, 1 ), _bWrap );
+	float4	V11 = Fetch( _Tex, X0 + int2( 1, 1 ), _bWrap );
+
+	return lerp( lerp( V00, V01, t.x ), lerp( V10, V11, t.x ), t.y );
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// Normal Map
+[numthreads( THREADS_X, THREADS_Y, 1 )]
+void	CS_Normal( uint3 _DispatchThreadID : SV_DISPATCHTHREADID )
+{
+	int2	P = _DispatchThreadID.xy;
+	if ( any( _DispatchThreadID.xy >= _Size ) )
+		return;
+
+	float	Center = _TexSourceMaterial[P].x;
+	float	Left = Fetch( _TexSourceMaterial, P + int2( -1, 0 ), true ).x;
+	float	Right = Fetch( _TexSourceMaterial, P + int2( +1, 0 ), true ).x;
+	float	Top = Fetch( _TexSourceMaterial, P + int2( 0, -1 ), true ).x;
+	float	Bottom = Fetch( _TexSourceMaterial, P + int2( 0, +1 ), true ).x;
+
+	float3	Dx = float3( 1.0, 0.0, _HeightFactor * (Right - Left) );
+	float3	Dy = float3( 0.0, -1.0, _HeightFactor * (Bottom - Top) );
+
+	float3	Normal = cross( Dy, Dx );
+	if ( _Flags & FLAG_NORMALIZE )
+		Normal = normalize( Normal );
+
+	_OutRGBA[P] = float4( Normal, Center );
+	_OutMaterial[P] = _TexTargetMaterial[P];
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// AO (cf. Generators::ComputeAO() for the algorithm)
+[numthreads( THREADS_X, THREADS_Y, 1 )]
+void	CS_AO( uint3 _DispatchThreadID : SV_DISPATCHTHREADID )
+{
+	int2	P = _DispatchThreadID.xy;
+	if ( any( _DispatchThreadID.xy >= _Size ) )
+		return;
+
+	float	SumAO = 0.0;
+	for ( uint DirectionIndex=0; DirectionIndex < _KernelSize; DirectionIndex++ )
+	{
+		float	Angle = 2.0 * PI * DirectionIndex / _KernelSize;
+		float2	Direction;
+		sincos( Angle, Direction.y, Direction.x );
+
+		float2	Position = P;
+		float	MaxSlope = 0.0;
+		for ( uint SampleIndex=0; SampleIndex < _SamplesCount; SampleIndex++ )
+		{
+			Position += Direction;	// March one step
+
+			float	Height = Sample( _TexSourceMaterial, Position, true ).x;
+			float	Slope = _HeightFactor * Height / (1.0 + SampleIndex);	// The slope of the horizon
+			MaxSlope = max( MaxSlope, Slope );
+		}
+
+		// Accumulate visibility
+		SumAO += HALFPI - atan( MaxSlope );
+	}
+	SumAO /= HALFPI * _KernelSize;	// Normalize
+
+	_OutRGBA[P] = _Flags & FLAG_WRITE_ONLY_ALPHA ? float4( _TexTargetRGBA[P].xyz, SumAO ) : SumAO;
+	_OutMaterial[P] = _TexTargetMaterial[P];
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// Gaussian Blur (blurs RGBA, height & roughness)
+void	Blur( int2 _P, int2 _Step )
+{
+	bool	bWrap = (_Flags & FLAG_WRAP) != 0;
+
+	float4	CenterMaterial = _TexSourceMaterial[_P];
+	float4	SumRGBA = _TexSourceRGBA[_P];
+	float2	SumHR = CenterMaterial.xy;
+	for ( uint i=0; i < _KernelSize; i++ )
+	{
+		float	Weight = exp( _WeightFactor * (1+i)*(1+i) );
+		int2	Offset = int(1+i) * _Step;
+
+		SumRGBA += Weight * (Fetch( _TexSourceRGBA, _P - Offset, bWrap ) + Fetch( _TexSourceRGBA, _P + Offset, bWrap ));
+		SumHR += Weight * (Fetch( _TexSourceMaterial, _P - Offset, bWrap ).xy + Fetch( _TexSourceMaterial, _P + Offset, bWrap ).xy);
+	}
+
+	_OutRGBA[_P] = _InvSumWeights * SumRGBA;
+	_OutMaterial[_P] = float4( _InvSumWeights * SumHR, CenterMaterial.zw );
+}
+
+[numthreads( THREADS_X, THREADS_Y, 1 )]
+void	CS_BlurH( uint3 _DispatchThreadID : SV_DISPATCHTHREADID )
+{
+	if ( any( _DispatchThreadID.xy >= _Size ) )
+		return;
+
+	Blur( _DispatchThreadID.xy, int2( 1, 0 ) );
+}
+
+[numthreads( THREADS_X, THREADS_Y, 1 )]
+void	CS_BlurV( uint3 _DispatchThreadID : SV_DISPATCHTHREADID )
+{
+	if ( any( _DispatchThreadID.xy >= _Size ) )
+		return;
+
+	Blur( _DispatchThreadID.xy, int2( 0, 1 ) );
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// Erosion & Dilation (always wrap, like the CPU versions)
+[numthreads( THREADS_X, THREADS_Y, 1 )]
+void	CS_Erode( uint3 _DispatchThreadID : SV_DISPATCHTHREADID )
+{
+	int2	P = _DispatchThreadID.xy;
+	if ( any( _DispatchThreadID.xy >= _Size ) )
+		return;
+
+	int		Size = _KernelSize;
+	float4	MinRGBA = 3.402823466e+38;
+	float2	MinHR = 3.402823466e+38;
+	for ( int Y=-Size; Y <= Size; Y++ )
+		for ( int X=-Size; X <= Size; X++ )
+		{
+			int2	SampleP = WrapCoords( P + int2( X, Y ) );
+			MinRGBA = min( MinRGBA, _TexSourceRGBA[SampleP] );
+			MinHR = min( MinHR, _TexSourceMaterial[SampleP].xy );
+		}
+
+	_OutRGBA[P] = MinRGBA;
+	_OutMaterial[P] = float4( MinHR, _TexTargetMaterial[P].zw );
+}
+
+[numthreads( THREADS_X, THREADS_Y, 1 )]
+void	CS_Dilate( uint3 _DispatchThreadID : SV_DISPATCHTHREADID )
+{
+	int2	P = _DispatchThreadID.xy;
+	if ( any( _DispatchThreadID.xy >= _Size ) )
+		return;
+
+	int		Size = _KernelSize;
+	float4	MaxRGBA = -3.402823466e+38;
+	float2	MaxHR = -3.402823466e+38;
+	for ( int Y=-Size; Y <= Size; Y++ )
+		for ( int X=-Size; X <= Size; X++ )
+		{
+			int2	SampleP = WrapCoords( P + int2( X, Y ) );
+			MaxRGBA = max( MaxRGBA, _TexSourceRGBA[SampleP] );
+			MaxHR = max( MaxHR, _TexSourceMaterial[SampleP].xy );
+		}
+
+	_OutRGBA[P] = MaxRGBA;
+	_OutMaterial[P] = float4( MaxHR, _TexTargetMaterial[P].zw );
+}
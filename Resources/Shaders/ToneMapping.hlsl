@@ -0,0 +1,242 @@
+//////////////////////////////////////////////////////////////////////////
+// HDR tone mapping with auto-exposure (cf. Utility/ToneMapper.h)
+//
+//	_ CS_Histogram, bins the log2 luminance of each pixel of a 16x16 tile into shared memory then merges the tile's bins
+//		into the global histogram with atomic adds. Bin 0 receives the black pixels.
+//	_ CS_Exposure, a single group averages the log2 luminance of the histogram between the low & high percentiles,
+//		adapts the luminance of the previous frame toward it and clears the histogram for the next frame
+//	_ CS_BakeLUT, bakes the filmic curve & the output encoding into a LUT indexed by the log2 of the exposed color
+//	_ PS, exposes the HDR color and looks the display color up in the LUT
+//
+#include "Inc/Global.hlsl"
+
+static const uint	HISTOGRAM_BINS_COUNT = 64;	// !!IMPORTANT ==> Must correspond to ToneMapper::HISTOGRAM_BINS_COUNT!!
+static const uint	LUT_SIZE = 32;				// !!IMPORTANT ==> Must correspond to ToneMapper::LUT_SIZE!!
+static const float	LUT_MIN_LOG2 = -12.0;		// Range of the exposed colors covered by the LUT
+static const float	LUT_MAX_LOG2 = 8.0;
+
+static const uint	OUTPUT_LINEAR = 0;
+static const uint	OUTPUT_SRGB = 1;
+static const uint	OUTPUT_HDR10 = 2;
+
+cbuffer	cbToneMapping : register( b10 )
+{
+	uint2	_TargetSize;
+	float	_MinLogLuminance;		// Range of the histogram in log2 luminance
+	float	_LogLuminanceRange;
+
+	float	_DeltaTime;
+	float	_AdaptationSpeedUp;
+	float	_AdaptationSpeedDown;
+	float	_KeyValue;				// Luminance the average luminance is exposed to
+
+	float	_ExposureCompensation;	// In EV
+	uint	_ResetAdaptation;		// 1 to use the target luminance right away
+	float	_LowPercentile;			// Fraction of the darkest & brightest pixels ignored by the average
+	float	_HighPercentile;
+
+	float	_WhitePoint;			// Exposed luminance mapped to white by the filmic curve
+	uint	_OutputEncoding;
+	float	_PaperWhiteNits;		// HDR10: luminance of the SDR white
+	float	_DisplayMaxNits;		// HDR10: peak luminance of the display
+};
+
+// !!IMPORTANT ==> Must correspond to ToneMapper::Exposure!!
+struct	Exposure
+{
+	float	AdaptedLuminance;
+	float	TargetLuminance;
+	float	Exposure;
+	float	__PAD;
+};
+
+Texture2D<float4>					_TexHDR : register( t10 );
+Texture3D<float4>					_TexLUT : register( t11 );
+StructuredBuffer<Exposure>			_Exposure : register( t12 );
+
+RWStructuredBuffer<uint>			_OutHistogram : register( u0 );
+RWStructuredBuffer<Exposure>		_OutExposure : register( u1 );
+RWTexture3D<float4>					_OutLUT : register( u0 );
+
+float	Luminance( float3 _Color )
+{
+	return dot( _Color, float3( 0.2126, 0.7152, 0.0722 ) );
+}
+
+uint	LuminanceBin( float _Luminance )
+{
+	if ( _Luminance < 1e-6 )
+		return 0;
+
+	float	t = saturate( (log2( _Luminance ) - _MinLogLuminance) / _LogLuminanceRange );
+	return 1 + uint( t * (HISTOGRAM_BINS_COUNT - 2) );
+}
+
+float	BinLogLuminance( uint _Bin )
+{
+	return _Bin == 0 ? _MinLogLuminance : _MinLogLuminance + (_Bin - 0.5) / (HISTOGRAM_BINS_COUNT - 2) * _LogLuminanceRange;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+groupshared uint	gs_Bins[HISTOGRAM_BINS_COUNT];
+
+[numthreads( 16, 16, 1 )]
+void	CS_Histogram( uint3 _DispatchThreadID : SV_DISPATCHTHREADID, uint _GroupIndex : SV_GROUPINDEX )
+{
+	if ( _GroupIndex < HISTOGRAM_BINS_COUNT )
+		gs_Bins[_GroupIndex] = 0;
+
+	GroupMemoryBarrierWithGroupSync();
+
+	if ( all( _DispatchThreadID.xy < _TargetSize ) )
+		InterlockedAdd( gs_Bins[LuminanceBin( Luminance( _TexHDR[_DispatchThreadID.xy].xyz ) )], 1 );
+
+	GroupMemoryBarrierWithGroupSync();
+
+	// Merge the tile's bins with the global histogram
+	if ( _GroupIndex < HISTOGRAM_BINS_COUNT && gs_Bins[_GroupIndex] != 0 )
+		InterlockedAdd( _OutHistogram[_GroupIndex], gs_Bins[_GroupIndex] );
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+[numthreads( HISTOGRAM_BINS_COUNT, 1, 1 )]
+void	CS_Exposure( uint _GroupIndex : SV_GROUPINDEX )
+{
+	gs_Bins[_GroupIndex] = _OutHistogram[_GroupIndex];
+	_OutHistogram[_GroupIndex] = 0;	// Ready for the next frame
+
+	GroupMemoryBarrierWithGroupSync();
+
+	if ( _GroupIndex != 0 )
+		return;
+
+	// Average the log luminance between the percentiles
+	float	PixelsCount = 0.0;
+	for ( uint Bin=0; Bin < HISTOGRAM_BINS_COUNT; Bin++ )
+		PixelsCount += gs_Bins[Bin];
+
+	float	LowCount = _LowPercentile * PixelsCount;
+	float	HighCount = _HighPercentile * PixelsCount;
+	float	SumLogLuminance = 0.0;
+	float	SumWeights = 0.0;
+	for ( uint Bin=0; Bin < HISTOGRAM_BINS_COUNT; Bin++ )
+	{
+		float	Count = gs_Bins[Bin];
+
+		float	Ignored = min( Count, LowCount );
+		Count -= Ignored;
+		LowCount -= Ignored;
+		HighCount -= Ignored;
+
+		Count = min( Count, HighCount );
+		HighCount -= Count;
+
+		SumLogLuminance += Count * BinLogLuminance( Bin );
+		SumWeights += Count;
+	}
+
+	float	TargetLogLuminance = SumWeights > 0.0 ? SumLogLuminance / SumWeights : 0.0;
+
+	// Adapt in log space so the speed is perceptually uniform
+	Exposure	Result = _OutExposure[0];
+	float	AdaptedLogLuminance = TargetLogLuminance;
+	if ( _ResetAdaptation == 0 )
+	{
+		float	PreviousLogLuminance = log2( max( 1e-6, Result.AdaptedLuminance ) );
+		float	Speed = TargetLogLuminance > PreviousLogLuminance ? _AdaptationSpeedUp : _AdaptationSpeedDown;
+		AdaptedLogLuminance = lerp( PreviousLogLuminance, TargetLogLuminance, 1.0 - exp( -_DeltaTime * Speed ) );
+	}
+
+	Result.TargetLuminance = exp2( TargetLogLuminance );
+	Result.AdaptedLuminance = exp2( AdaptedLogLuminance );
+	Result.Exposure = _KeyValue / Result.AdaptedLuminance * exp2( _ExposureCompensation );
+	_OutExposure[0] = Result;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// Uncharted 2 filmic curve
+float3	Filmic( float3 x )
+{
+	const float	A = 0.15;	// Shoulder strength
+	const float	B = 0.50;	// Linear strength
+	const float	C = 0.10;	// Linear angle
+	const float	D = 0.20;	// Toe strength
+	const float	E = 0.02;	// Toe numerator
+	const float	F = 0.30;	// Toe denominator
+	return ((x * (A * x + C * B) + D * E) / (x * (A * x + B) + D * F)) - E / F;
+}
+
+float3	sRGBEncode( float3 _Color )
+{
+	return _Color <= 0.0031308 ? 12.92 * _Color : 1.055 * pow( _Color, 1.0 / 2.4 ) - 0.055;
+}
+
+// SMPTE ST.2084 inverse EOTF
+float3	PQEncode( float3 _Nits )
+{
+	const float	m1 = 0.1593017578125;
+	const float	m2 = 78.84375;
+	const float	c1 = 0.8359375;
+	const float	c2 = 18.8515625;
+	const float	c3 = 18.6875;
+
+	float3	Ym1 = pow( saturate( _Nits / 10000.0 ), m1 );
+	return pow( (c1 + c2 * Ym1) / (1.0 + c3 * Ym1), m2 );
+}
+
+// HDR10 keeps the exposed colors linear up to a knee then rolls them off toward the display's peak
+float3	HDRRollOff( float3 _Color, float _Peak )
+{
+	float	Knee = 0.75 * _Peak;
+	float	Range = _Peak - Knee;
+	return _Color < Knee ? _Color : Knee + Range * (1.0 - exp( -(_Color - Knee) / Range ));
+}
+
+[numthreads( 4, 4, 4 )]
+void	CS_BakeLUT( uint3 _DispatchThreadID : SV_DISPATCHTHREADID )
+{
+	float3	UVW = _DispatchThreadID / (LUT_SIZE - 1.0);
+	float3	Color = exp2( lerp( LUT_MIN_LOG2, LUT_MAX_LOG2, UVW ) );
+
+	float3	Display;
+	if ( _OutputEncoding == OUTPUT_HDR10 )
+	{
+		const float3x3	Rec709ToRec2020 = {
+			0.6274, 0.3293, 0.0433,
+			0.0691, 0.9195, 0.0114,
+			0.0164, 0.0880, 0.8956,
+		};
+		float3	Color2020 = mul( Rec709ToRec2020, Color );
+		Display = PQEncode( _PaperWhiteNits * HDRRollOff( Color2020, _DisplayMaxNits / _PaperWhiteNits ) );
+	}
+	else
+	{
+		Display = saturate( Filmic( Color ) / Filmic( _WhitePoint ) );
+		if ( _OutputEncoding == OUTPUT_SRGB )
+			Display = sRGBEncode( Display );
+	}
+
+	_OutLUT[_DispatchThreadID] = float4( Display, 1.0 );
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+struct	VS_IN
+{
+	float4	__Position : SV_POSITION;
+};
+
+VS_IN	VS( VS_IN _In )	{ return _In; }
+
+float4	PS( VS_IN _In ) : SV_TARGET0
+{
+	float3	Color = _Exposure[0].Exposure * _TexHDR[uint2( _In.__Position.xy )].xyz;
+
+	float3	UVW = saturate( (log2( max( 1e-8, Color ) ) - LUT_MIN_LOG2) / (LUT_MAX_LOG2 - LUT_MIN_LOG2) );
+	UVW = (UVW * (LUT_SIZE - 1.0) + 0.5) / LUT_SIZE;	// Texel centers
+
+	return float4( _TexLUT.SampleLevel( LinearClamp, UVW, 0.0 ).xyz, 1.0 );
+}
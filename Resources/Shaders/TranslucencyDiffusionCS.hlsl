@@ -0,0 +1,123 @@
+//////////////////////////////////////////////////////////////////////////
+// Compute light diffusion through the translucent volume (cf. EffectTranslucency::Diffuse() with COMPUTE_DIFFUSION)
+// The irradiance front is marched slice by slice from Z=0 to Z=2 like the pixel shader passes of TranslucencyDiffusion.hlsl,
+//	but a single dispatch advances SLICES_PER_DISPATCH slices:
+//	_ each group owns a TILE_SIZE x TILE_SIZE tile of the irradiance map plus an APRON_SIZE apron on every side
+//	_ the slice's irradiance of the whole region lives in groupshared memory where the threads gather their phase-weighted neighbors
+//	_ the gather reaches 2 texels away so the valid area of the region shrinks by 2 texels every slice, only the central tile is
+//		still valid after SLICES_PER_DISPATCH slices and gets written out. The apron is simply computed redundantly by the neighbor groups.
+//
+// The same kernel also runs the coarse level of the multigrid mode (cf. DIFFUSION_MULTIGRID), the grid is then half the size of the
+//	ZBuffer and the first fine dispatch bilinearly upsamples the coarse irradiance.
+//
+// ZBuffer layout (cf. TranslucencyBuildZBuffer.hlsl):
+//	X=External object front Z Y=External object back Z Z=Internal object front Z W=Internal object back Z
+//
+#include "Inc/Global.hlsl"
+
+#define	TILE_SIZE				16		// !!IMPORTANT ==> Must correspond to EffectTranslucency::DIFFUSION_TILE_SIZE!!
+#define	SLICES_PER_DISPATCH		4		// !!IMPORTANT ==> Must correspond to EffectTranslucency::DIFFUSION_SLICES_PER_DISPATCH!!
+#define	APRON_SIZE				(2*SLICES_PER_DISPATCH)
+#define	REGION_SIZE				(TILE_SIZE + 2*APRON_SIZE)
+
+cbuffer	cbDiffusion : register( b10 )
+{
+	float	_BBoxSize;
+	float	_SliceThickness;
+	float	_TexelSize;
+	float3	_ExtinctionCoeff;
+	float3	_Albedo;
+	float3	_Phase0;
+	float3	_Phase1;
+	float3	_Phase2;
+	float3	_ExternalLight;
+	float3	_InternalEmissive;
+};
+
+cbuffer	cbSolver : register( b11 )
+{
+	uint	_GridSize;				// Size of the irradiance grid (DIFFUSION_SIZE or DIFFUSION_SIZE/2 for the coarse level)
+	uint	_ZBufferScale;			// Amount of ZBuffer texels covered by a grid texel
+	float	_FirstZ;				// Z of the first slice advanced by this dispatch
+	float	_SliceDeltaZ;			// Z extent of a slice (in ZBuffer units)
+	float	_GridSliceThickness;	// Thickness of a slice on this grid (in meters)
+};
+
+Texture2D<float4>	_TexZBuffer : register( t10 );
+Texture2D<float4>	_TexSource : register( t11 );		// Irradiance of the last slice of the previous dispatch
+
+RWTexture2D<float4>	_Out : register( u0 );
+
+groupshared float3	gs_Irradiance[REGION_SIZE*REGION_SIZE];
+
+// Reads a neighbor's irradiance from the region (0 when out of the medium)
+float3	Fetch( int2 _Position, int2 _Offset )
+{
+	int2	P = clamp( _Position + _Offset, 0, REGION_SIZE-1 );
+	return gs_Irradiance[REGION_SIZE * P.y + P.x];
+}
+
+// Conservative bounds of the objects covered by a grid texel
+float4	GetZBounds( uint2 _GridPosition )
+{
+	uint2	ZBufferPosition = _ZBufferScale * _GridPosition;
+	float4	Bounds = float4( 2.0, 0.0, 2.0, 0.0 );
+	for ( uint Y=0; Y < _ZBufferScale; Y++ )
+		for ( uint X=0; X < _ZBufferScale; X++ )
+		{
+			float4	Z = _TexZBuffer[ZBufferPosition + uint2( X, Y )];
+			Bounds = float4( min( Bounds.x, Z.x ), max( Bounds.y, Z.y ), min( Bounds.z, Z.z ), max( Bounds.w, Z.w ) );
+		}
+	return Bounds;
+}
+
+[numthreads( REGION_SIZE, REGION_SIZE, 1 )]
+void	CS( uint3 _GroupID : SV_GROUPID, uint3 _GroupThreadID : SV_GROUPTHREADID, uint _ThreadIndex : SV_GROUPINDEX )
+{
+	int2	RegionPosition = int2( _GroupThreadID.xy );
+	int2	GridPosition = int2( TILE_SIZE * _GroupID.xy ) - APRON_SIZE + RegionPosition;
+	bool	bInsideGrid = all( GridPosition >= 0 ) && all( GridPosition < int(_GridSize) );
+
+	float4	ZBounds = bInsideGrid ? GetZBounds( uint2(GridPosition) ) : float4( 2.0, 0.0, 2.0, 0.0 );	// Texels outside the grid stay out of the medium
+	float3	Irradiance = _TexSource.SampleLevel( LinearClamp, (GridPosition + 0.5) / _GridSize, 0.0 ).xyz;
+
+	float3	Transmittance = exp( -_ExtinctionCoeff * _GridSliceThickness );
+
+	for ( uint SliceIndex=0; SliceIndex < SLICES_PER_DISPATCH; SliceIndex++ )
+	{
+		float	Z0 = _FirstZ + SliceIndex * _SliceDeltaZ;
+		float	Z1 = Z0 + _SliceDeltaZ;
+		bool	bInMedium = Z1 > ZBounds.x && Z0 < ZBounds.y;
+
+		gs_Irradiance[_ThreadIndex] = bInMedium ? Irradiance : 0.0;
+		GroupMemoryBarrierWithGroupSync();
+
+		if ( bInMedium )
+		{
+			if ( Z0 <= ZBounds.x )
+				Irradiance = _ExternalLight;	// Entering the external object's front face
+			else
+			{
+				// Phase-weighted gather of the previous slice: center, ring of 8 at 1 texel and ring of 12 at 2 texels (no corners)
+				float3	Ring1 = Fetch( RegionPosition, int2( -1, -1 ) ) + Fetch( RegionPosition, int2( 0, -1 ) ) + Fetch( RegionPosition, int2( 1, -1 ) )
+							  + Fetch( RegionPosition, int2( -1, 0 ) ) + Fetch( RegionPosition, int2( 1, 0 ) )
+							  + Fetch( RegionPosition, int2( -1, 1 ) ) + Fetch( RegionPosition, int2( 0, 1 ) ) + Fetch( RegionPosition, int2( 1, 1 ) );
+				float3	Ring2 = 0.0;
+				[unroll]
+				for ( int i=-1; i <= 1; i++ )
+					Ring2 += Fetch( RegionPosition, int2( i, -2 ) ) + Fetch( RegionPosition, int2( i, 2 ) ) + Fetch( RegionPosition, int2( -2, i ) ) + Fetch( RegionPosition, int2( 2, i ) );
+
+				float3	Scattered = _Albedo * (_Phase0 * Irradiance + _Phase1 * Ring1 + _Phase2 * Ring2);
+				Irradiance = Transmittance * Irradiance + (1.0 - Transmittance) * Scattered;
+			}
+
+			if ( Z1 > ZBounds.z && Z0 < ZBounds.w )
+				Irradiance += (1.0 - Transmittance) * _InternalEmissive;	// Crossing the emissive internal object
+		}
+		GroupMemoryBarrierWithGroupSync();
+	}
+
+	// Only the central tile is still valid
+	if ( bInsideGrid && all( RegionPosition >= APRON_SIZE ) && all( RegionPosition < APRON_SIZE + TILE_SIZE ) )
+		_Out[GridPosition] = float4( Irradiance, 0.0 );
+}
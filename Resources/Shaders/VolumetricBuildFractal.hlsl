@@ -0,0 +1,195 @@
+//////////////////////////////////////////////////////////////////////////
+// Compute shader generation of the wide cloud fractal (cf. EffectVolumetric::BuildFractalTexture() with BUILD_FRACTAL_USING_CS)
+// This is the GPU version of FillFractal(): each octave is a Noise::WrapPerlin() whose permutation & 6D gradient tables are uploaded
+//	as structured buffers so we evaluate exactly the same noise as the CPU.
+//
+// Kernels are dispatched in that order:
+//	_ CS_Noise, evaluates the fractal in the first mip of the R32F scratch volume
+//	_ CS_Downsample, builds each next mip of the scratch volume from the previous one (same box filter as VolumeBuilder::GenerateMips())
+//	_ CS_Pack, quantizes each mip of the scratch volume into the final R8 volume
+//	_ CS_MinMax, builds the min/max volume used for empty space skipping from the quantized first mip (cf. Inc/CloudEmptySpace.hlsl)
+//
+#define	THREADS_X	8
+#define	THREADS_Y	8
+#define	THREADS_Z	4
+
+#define	NOISE_SIZE	4096					// !!IMPORTANT ==> Must correspond to NOISE_SIZE in Noise.h!!
+#define	NOISE_MASK	(NOISE_SIZE-1)
+
+static const float	TWOPI = 6.283185307179586476925286766559;
+
+// Same as Noise::BIAS_U, BIAS_V, BIAS_W, BIAS_R, BIAS_S & BIAS_T
+static const float	BIASES[6] = { 0.1316519815, 0.1984632145, 0.1621987463, 0.7685431298, 0.4646579661, 0.9887465321 };
+
+cbuffer	cbFractal : register( b10 )
+{
+	uint3	_Size;					// Size of the mip we're writing
+	uint	_OctavesCount;
+	uint3	_SourceSize;			// Size of the mip we're reading (CS_Downsample)
+	float	_Normalizer;
+	float2	_ScaleMinMax;			// Range of the values mapped to [0,1] by CS_Pack
+	uint2	_CellSize;				// X=XY size, Y=Z size of the min/max cells (CS_MinMax)
+};
+
+struct	Octave
+{
+	float2	WrapCenter0;
+	float2	WrapCenter1;
+	float2	WrapCenter2;
+	float	WrapRadius;
+	float	Amplitude;
+};
+
+StructuredBuffer<uint>		_Permutations : register( t10 );	// 2*NOISE_SIZE entries per octave
+StructuredBuffer<float4>	_Gradients : register( t11 );		// 2 float4 per entry, NOISE_SIZE entries per octave (only the first 6 components are used)
+StructuredBuffer<Octave>	_Octaves : register( t12 );
+Texture3D<float>			_TexSource : register( t13 );
+
+RWTexture3D<float>			_Out : register( u0 );
+RWTexture3D<float4>			_OutMinMax : register( u1 );
+
+
+//////////////////////////////////////////////////////////////////////////
+// Same as Noise::Perlin( float4, float2 )
+float	Perlin6( uint _OctaveIndex, float _Position[6] )
+{
+	uint	PermutationOffset = 2*NOISE_SIZE * _OctaveIndex;
+	uint	GradientOffset = 2*NOISE_SIZE * _OctaveIndex;
+
+	uint	pX_[6], pX[6];
+	float	pT[6];
+	[unroll]
+	for ( uint Dimension=0; Dimension < 6; Dimension++ )
+	{
+		float	fX = (BIASES[Dimension] + _Position[Dimension]) * NOISE_SIZE;
+		int		X_ = int( floor( fX ) );
+		pT[Dimension] = fX - X_;
+		pX_[Dimension] = uint(X_) & NOISE_MASK;
+		pX[Dimension] = (pX_[Dimension] + 1) & NOISE_MASK;
+	}
+
+	// Compute the contributions of the 64 corners of the lattice cell (bit D of the corner index selects the upper index of dimension D)
+	float	pCorners[64];
+	[loop]
+	for ( uint Corner=0; Corner < 64; Corner++ )
+	{
+		uint	Hash = 0;
+		float	Dot = 0.0;
+		[unroll]
+		for ( uint Dimension=0; Dimension < 6; Dimension++ )
+		{
+			bool	bUpper = (Corner >> Dimension) & 1;
+			Hash = _Permutations[PermutationOffset + Hash + (bUpper ? pX[Dimension] : pX_[Dimension])];
+		}
+
+		float4	G0 = _Gradients[GradientOffset + 2*Hash+0];
+		float4	G1 = _Gradients[GradientOffset + 2*Hash+1];
+		float	pGradient[6] = { G0.x, G0.y, G0.z, G0.w, G1.x, G1.y };
+		[unroll]
+		for ( uint Dimension=0; Dimension < 6; Dimension++ )
+			Dot += pGradient[Dimension] * (((Corner >> Dimension) & 1) ? pT[Dimension] - 1.0 : pT[Dimension]);
+
+		pCorners[Corner] = Dot;
+	}
+
+	// Interpolate one dimension after the other using the same quintic S-curve as Noise::SCurve()
+	uint	Count = 64;
+	[unroll]
+	for ( uint Dimension=0; Dimension < 6; Dimension++ )
+	{
+		float	t = pT[Dimension];
+				t = t * t * t * (10.0 + t * (-15.0 + t * 6.0));
+
+		Count >>= 1;
+		for ( uint i=0; i < Count; i++ )
+			pCorners[i] = lerp( pCorners[2*i], pCorners[2*i+1], t );
+	}
+
+	return pCorners[0];
+}
+
+// Same as Noise::WrapPerlin( float3 )
+float	WrapPerlin( uint _OctaveIndex, float3 _UVW )
+{
+	Octave	O = _Octaves[_OctaveIndex];
+
+	float3	Angles = TWOPI * _UVW;
+	float	pPosition[6] = {
+		O.WrapCenter0.x + O.WrapRadius * cos( Angles.x ), O.WrapCenter0.y + O.WrapRadius * sin( Angles.x ),
+		O.WrapCenter1.x + O.WrapRadius * cos( Angles.y ), O.WrapCenter1.y + O.WrapRadius * sin( Angles.y ),
+		O.WrapCenter2.x + O.WrapRadius * cos( Angles.z ), O.WrapCenter2.y + O.WrapRadius * sin( Angles.z ),
+	};
+
+	return Perlin6( _OctaveIndex, pPosition );
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+[numthreads( THREADS_X, THREADS_Y, THREADS_Z )]
+void	CS_Noise( uint3 _ThreadID : SV_DispatchThreadID )
+{
+	if ( any( _ThreadID >= _Size ) )
+		return;
+
+	float3	UVW = float3( _ThreadID ) / _Size.x;	// Keep a cubic aspect ratio for voxels like FillFractal() does
+
+	float	V = 0.0;
+	for ( uint OctaveIndex=0; OctaveIndex < _OctavesCount; OctaveIndex++ )
+		V += _Octaves[OctaveIndex].Amplitude * WrapPerlin( OctaveIndex, UVW );
+
+	_Out[_ThreadID] = _Normalizer * V;
+}
+
+[numthreads( THREADS_X, THREADS_Y, THREADS_Z )]
+void	CS_Downsample( uint3 _ThreadID : SV_DispatchThreadID )
+{
+	if ( any( _ThreadID >= _Size ) )
+		return;
+
+	// Odd or unit sizes read the last voxel twice
+	uint3	P0 = min( 2*_ThreadID, _SourceSize-1 );
+	uint3	P1 = min( 2*_ThreadID+1, _SourceSize-1 );
+
+	float	V  = _TexSource[uint3( P0.x, P0.y, P0.z )] + _TexSource[uint3( P1.x, P0.y, P0.z )];
+			V += _TexSource[uint3( P0.x, P1.y, P0.z )] + _TexSource[uint3( P1.x, P1.y, P0.z )];
+			V += _TexSource[uint3( P0.x, P0.y, P1.z )] + _TexSource[uint3( P1.x, P0.y, P1.z )];
+			V += _TexSource[uint3( P0.x, P1.y, P1.z )] + _TexSource[uint3( P1.x, P1.y, P1.z )];
+
+	_Out[_ThreadID] = 0.125 * V;
+}
+
+[numthreads( THREADS_X, THREADS_Y, THREADS_Z )]
+void	CS_Pack( uint3 _ThreadID : SV_DispatchThreadID )
+{
+	if ( any( _ThreadID >= _Size ) )
+		return;
+
+	// Same quantization as the CPU packing, min( 255, int(256 * V) ) / 255
+	float	V = (_TexSource[_ThreadID] - _ScaleMinMax.x) / (_ScaleMinMax.y - _ScaleMinMax.x);
+	_Out[_ThreadID] = min( 255.0, floor( 256.0 * saturate( V ) ) ) / 255.0;
+}
+
+// Same as BuildMinMaxCells(): cells are dilated by 1 voxel, wrapping in XY and clamping in Z
+[numthreads( THREADS_X, THREADS_Y, THREADS_Z )]
+void	CS_MinMax( uint3 _ThreadID : SV_DispatchThreadID )
+{
+	if ( any( _ThreadID >= _Size ) )
+		return;
+
+	int3	CellSize = int3( _CellSize.xx, _CellSize.y );
+	int3	SourceSize = int3( _SourceSize );
+	int3	Start = int3( _ThreadID ) * CellSize - 1;
+	int3	End = Start + CellSize + 1;
+
+	float	Min = 1.0, Max = 0.0;
+	for ( int Z=Start.z; Z <= End.z; Z++ )
+		for ( int Y=Start.y; Y <= End.y; Y++ )
+			for ( int X=Start.x; X <= End.x; X++ )
+			{
+				float	V = _TexSource[uint3( (X + SourceSize.x) % SourceSize.x, (Y + SourceSize.y) % SourceSize.y, clamp( Z, 0, SourceSize.z-1 ) )];
+				Min = min( Min, V );
+				Max = max( Max, V );
+			}
+
+	_OutMinMax[_ThreadID] = float4( Min, Max, 0, 0 );
+}
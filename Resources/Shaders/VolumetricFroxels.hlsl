@@ -0,0 +1,172 @@
+//////////////////////////////////////////////////////////////////////////
+// Froxel fog injection & integration (cf. EffectVolumetric::RenderFroxels() with FROXEL_FOG)
+//
+// Kernels are dispatched in that order:
+//	_ CS_Inject, computes the height fog's extinction and the light it scatters toward the camera in each froxel:
+//		sun (attenuated by the atmosphere's transmittance & the terrain shadow), sky irradiance and point lights.
+//		Samples are jittered within their slice each frame and blended with the previous frame's reprojected froxels.
+//	_ CS_Integrate, walks each froxel column from the camera to accumulate the scattering & transmittance (cf. Inc/Froxels.hlsl)
+//
+#include "Inc/Global.hlsl"
+#include "Inc/Froxels.hlsl"
+
+static const float	GROUND_RADIUS_KM = 6360.0;			// !!IMPORTANT ==> Must correspond to EffectVolumetric.cpp!!
+static const float	ATMOSPHERE_THICKNESS_KM = 60.0;
+static const float	TRANSMITTANCE_TAN_MAX = 1.5;
+static const float	TRANSMITTANCE_COS_THETA_MIN = -0.15;
+
+cbuffer	cbAtmosphere : register( b7 )		// !!IMPORTANT ==> Must correspond to EffectVolumetric::CBAtmosphere!!
+{
+	float3		_LightDirection;
+	float		_SunIntensity;
+	float2		_AirParams;
+	float		_GodraysStrengthRayleigh;
+	float		_GodraysStrengthMie;
+	float4		_FogParams;					// X=Scattering Coeff, Y=Extinction Coeff, Z=Reference Altitude (km), W=Anisotropy
+	float		_AltitudeOffset;
+};
+
+cbuffer	cbShadow : register( b8 )			// !!IMPORTANT ==> Must correspond to EffectVolumetric::CBShadow!!
+{
+	float4x4	_World2Shadow;
+	float4x4	_Shadow2World;
+	float4x4	_World2TerrainShadow;
+	float2		_ShadowZMinMax;
+};
+
+Texture2D<float4>	_TexTransmittance : register( t6 );
+Texture2D<float4>	_TexIrradiance : register( t9 );
+Texture3D<float4>	_TexFroxelsHistory : register( t10 );	// Previous frame's injected froxels (CS_Inject) or this frame's (CS_Integrate)
+Texture2D<float>	_TexTerrainShadow : register( t11 );
+
+RWTexture3D<float4>	_Out : register( u0 );
+
+
+//////////////////////////////////////////////////////////////////////////
+// Same mapping as EffectVolumetric::GetTransmittance()
+float3	GetTransmittance( float _AltitudeKm, float _CosTheta )
+{
+	float	NormalizedAltitude = sqrt( max( 0.0, _AltitudeKm ) / ATMOSPHERE_THICKNESS_KM );
+ 	float	NormalizedCosTheta = atan( (_CosTheta - TRANSMITTANCE_COS_THETA_MIN) / (1.0 - TRANSMITTANCE_COS_THETA_MIN) * tan( TRANSMITTANCE_TAN_MAX ) ) / TRANSMITTANCE_TAN_MAX;
+	return _TexTransmittance.SampleLevel( LinearClamp, float2( NormalizedCosTheta, NormalizedAltitude ), 0.0 ).xyz;
+}
+
+// Same mapping as the irradiance table computation
+float3	GetIrradiance( float _AltitudeKm, float _CosThetaSun )
+{
+	float2	UV = float2( (_CosThetaSun + 0.2) / 1.2, saturate( _AltitudeKm / ATMOSPHERE_THICKNESS_KM ) );
+	return _TexIrradiance.SampleLevel( LinearClamp, UV, 0.0 ).xyz;
+}
+
+float	PhaseHG( float _CosTheta, float g )
+{
+	float	Denominator = 1.0 + g*g - 2.0*g*_CosTheta;
+	return (1.0 - g*g) / (4.0 * PI * Denominator * sqrt( Denominator ));
+}
+
+float	GetTerrainShadow( float3 _WorldPositionKm )
+{
+	if ( !_bFroxelTerrainShadow )
+		return 1.0;
+
+	float4	Proj = mul( float4( _WorldPositionKm, 1.0 ), _World2TerrainShadow );
+	float2	UV = float2( 0.5 * (1.0 + Proj.x), 0.5 * (1.0 - Proj.y) );
+	if ( any( UV < 0.0 ) || any( UV > 1.0 ) )
+		return 1.0;
+
+	float	Z = _TexTerrainShadow.SampleLevel( LinearClamp, UV, 0.0 );
+	return Proj.z <= Z + 1e-3 ? 1.0 : 0.0;
+}
+
+// Returns the view vector (with Z=1) going through the center of the froxel column
+float3	GetFroxelView( uint2 _Column )
+{
+	float2	UV = (_Column + 0.5) / _FroxelsSize.xy;
+	return float3( _CameraData.x * (2.0 * UV.x - 1.0), _CameraData.y * (1.0 - 2.0 * UV.y), 1.0 );
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// Writes RGB=Scattered light toward the camera (per km), A=Extinction (per km)
+[numthreads( 4, 4, 4 )]
+void	CS_Inject( uint3 _ThreadID : SV_DispatchThreadID )
+{
+	if ( any( _ThreadID >= _FroxelsSize ) )
+		return;
+
+	float	ViewZ = FroxelWToViewZ( (_ThreadID.z + _FroxelJitterZ) / _FroxelsSize.z );
+	float3	View = GetFroxelView( _ThreadID.xy );
+	float3	WorldPosition = mul( float4( ViewZ * View, 1.0 ), _Camera2World ).xyz;
+	float3	CameraPosition = _Camera2World[3].xyz;
+	float3	ToCamera = normalize( CameraPosition - WorldPosition );
+
+	// Height fog
+	float	AltitudeKm = max( 0.0, WorldPosition.y );
+	float	Density = exp( -AltitudeKm / _FogParams.z );
+	float	Scattering = _FogParams.x * Density;
+	float	Extinction = _FogParams.y * Density;
+
+	// Sun
+	float3	Light = _SunIntensity * GetTransmittance( AltitudeKm, _LightDirection.y ) * GetTerrainShadow( WorldPosition ) * PhaseHG( dot( _LightDirection, -ToCamera ), _FogParams.w );
+
+	// Sky, considering the irradiance comes from a uniform hemisphere of radiance E/PI that is scattered isotropically
+	Light += (0.5 / PI) * GetIrradiance( AltitudeKm, _LightDirection.y );
+
+	// Point lights
+	for ( uint LightIndex=0; LightIndex < _FroxelPointLightsCount; LightIndex++ )
+	{
+		float4	PositionRadius = _FroxelPointLights[2*LightIndex+0];
+		float3	Intensity = _FroxelPointLights[2*LightIndex+1].xyz;
+		float3	ToLight = PositionRadius.xyz - WorldPosition;
+		float	Distance2 = dot( ToLight, ToLight );
+		float	Falloff = saturate( 1.0 - Distance2 * Distance2 / pow( PositionRadius.w, 4.0 ) );	// Smooth cut at the light's radius
+		Light += Intensity * (Falloff * Falloff / max( 1e-4, Distance2 )) * (1.0 / (4.0 * PI));
+	}
+
+	float4	Result = float4( Scattering * Light, Extinction );
+
+	// Accumulate the jittered samples with the previous frames
+	if ( _bFroxelHistoryValid )
+	{
+		float4	PreviousProj = mul( float4( WorldPosition, 1.0 ), _FroxelPreviousWorld2Proj );
+		if ( PreviousProj.w > 0.0 )
+		{
+			float3	PreviousUVW = float3( 0.5 * (1.0 + PreviousProj.x / PreviousProj.w), 0.5 * (1.0 - PreviousProj.y / PreviousProj.w), ViewZToFroxelW( PreviousProj.w ) );
+			if ( all( PreviousUVW >= 0.0 ) && all( PreviousUVW <= 1.0 ) )
+				Result = lerp( Result, _TexFroxelsHistory.SampleLevel( LinearClamp, PreviousUVW, 0.0 ), _FroxelTemporalWeight );
+		}
+	}
+
+	_Out[_ThreadID] = Result;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Writes RGB=Scattered light accumulated from the camera to the end of the slice, A=Transmittance
+[numthreads( 8, 8, 1 )]
+void	CS_Integrate( uint3 _ThreadID : SV_DispatchThreadID )
+{
+	if ( any( _ThreadID.xy >= _FroxelsSize.xy ) )
+		return;
+
+	float	ViewLength = length( GetFroxelView( _ThreadID.xy ) );	// Converts view depths into distances along the ray
+
+	float3	Scattering = 0.0;
+	float	Transmittance = 1.0;
+	float	ZStart = 0.0;	// The first slice starts at the camera
+	for ( uint Z=0; Z < _FroxelsSize.z; Z++ )
+	{
+		float	ZEnd = FroxelWToViewZ( float(Z+1) / _FroxelsSize.z );
+		float	StepKm = (ZEnd - ZStart) * ViewLength;
+		ZStart = ZEnd;
+
+		float4	Froxel = _TexFroxelsHistory[uint3( _ThreadID.xy, Z )];
+		float	Extinction = max( 1e-6, Froxel.w );
+		float	SliceTransmittance = exp( -Extinction * StepKm );
+
+		// Integrate the scattering over the slice, accounting for the extinction within the slice itself
+		Scattering += Transmittance * Froxel.xyz * (1.0 - SliceTransmittance) / Extinction;
+		Transmittance *= SliceTransmittance;
+
+		_Out[uint3( _ThreadID.xy, Z )] = float4( Scattering, Transmittance );
+	}
+}
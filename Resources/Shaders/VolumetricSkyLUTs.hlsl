@@ -0,0 +1,161 @@
+//////////////////////////////////////////////////////////////////////////
+// Sky-view & aerial-perspective tables computation (cf. EffectVolumetric::RenderSkyLUTs() with SKY_LUTS)
+//
+// Both kernels read the precomputed tables bound by EffectVolumetric (t6 transmittance, t8 scattering) so each texel is
+//	only a couple of 4D fetches, then the sky & the aerial perspective are single lookups for everyone else (cf. Inc/SkyLUTs.hlsl):
+//	_ CS_SkyView, writes RGB=Sky radiance in the direction of each texel of the latitude/longitude map
+//	_ CS_AerialPerspective, writes RGB=In-scattered light between the camera and the end of each slice, A=Transmittance
+//
+#include "Inc/Global.hlsl"
+#include "Inc/SkyLUTs.hlsl"
+
+static const float	GROUND_RADIUS_KM = 6360.0;			// !!IMPORTANT ==> Must correspond to EffectVolumetric.cpp!!
+static const float	ATMOSPHERE_THICKNESS_KM = 60.0;
+static const float	TRANSMITTANCE_TAN_MAX = 1.5;
+static const float	TRANSMITTANCE_COS_THETA_MIN = -0.15;
+
+static const float	RES_3D_ALTITUDE = 32.0;				// !!IMPORTANT ==> Must correspond to EffectVolumetric.h!!
+static const float	RES_3D_COS_THETA_VIEW = 128.0;
+static const float	RES_3D_COS_THETA_SUN = 32.0;
+static const float	RES_3D_COS_GAMMA = 8.0;
+
+static const float3	SIGMA_SCATTERING_RAYLEIGH = float3( 0.0058, 0.0135, 0.0331 );	// Same as the scattering tables computation (per km)
+static const float	SIGMA_SCATTERING_MIE = 0.004;
+static const float	MIE_ANISOTROPY = 0.76;
+
+cbuffer	cbAtmosphere : register( b7 )		// !!IMPORTANT ==> Must correspond to EffectVolumetric::CBAtmosphere!!
+{
+	float3		_LightDirection;
+	float		_SunIntensity;
+	float2		_AirParams;
+	float		_GodraysStrengthRayleigh;
+	float		_GodraysStrengthMie;
+	float4		_FogParams;
+	float		_AltitudeOffset;
+};
+
+Texture2D<float4>	_TexTransmittance : register( t6 );
+Texture3D<float4>	_TexScattering : register( t8 );
+
+RWTexture2D<float4>	_OutSkyView : register( u0 );
+RWTexture3D<float4>	_OutAerialPerspective : register( u0 );
+
+
+//////////////////////////////////////////////////////////////////////////
+// Same mapping as EffectVolumetric::GetTransmittance()
+float3	GetTransmittance( float _AltitudeKm, float _CosTheta )
+{
+	float	NormalizedAltitude = sqrt( max( 0.0, _AltitudeKm ) / ATMOSPHERE_THICKNESS_KM );
+ 	float	NormalizedCosTheta = atan( (_CosTheta - TRANSMITTANCE_COS_THETA_MIN) / (1.0 - TRANSMITTANCE_COS_THETA_MIN) * tan( TRANSMITTANCE_TAN_MAX ) ) / TRANSMITTANCE_TAN_MAX;
+	return _TexTransmittance.SampleLevel( LinearClamp, float2( NormalizedCosTheta, NormalizedAltitude ), 0.0 ).xyz;
+}
+
+// Transmittance along a segment of the given length, same as EffectVolumetric::GetTransmittance( Altitude, CosTheta, Distance )
+float3	GetTransmittance( float _AltitudeKm, float _CosTheta, float _DistanceKm )
+{
+	float	RadiusKm = GROUND_RADIUS_KM + _AltitudeKm;
+	float	RadiusKm2 = sqrt( RadiusKm*RadiusKm + _DistanceKm*_DistanceKm + 2.0 * RadiusKm * _CosTheta * _DistanceKm );
+	float	CosTheta2 = (RadiusKm * _CosTheta + _DistanceKm) / RadiusKm2;
+	float	AltitudeKm2 = RadiusKm2 - GROUND_RADIUS_KM;
+
+	float	CosThetaGround = -sqrt( 1.0 - (GROUND_RADIUS_KM*GROUND_RADIUS_KM) / (RadiusKm*RadiusKm) );
+	if ( _CosTheta > CosThetaGround )
+		return GetTransmittance( _AltitudeKm, _CosTheta ) / max( 1e-6, GetTransmittance( AltitudeKm2, CosTheta2 ) );
+	else
+		return GetTransmittance( AltitudeKm2, -CosTheta2 ) / max( 1e-6, GetTransmittance( _AltitudeKm, -_CosTheta ) );
+}
+
+// Fetches the 4D scattering table (RGB=Rayleigh, A=Mie red), interpolating manually along the view/sun angle
+float4	SampleScattering( float _RadiusKm, float _CosThetaView, float _CosThetaSun, float _CosGamma )
+{
+	float	TopRadiusKm = GROUND_RADIUS_KM + ATMOSPHERE_THICKNESS_KM;
+	float	H = sqrt( TopRadiusKm*TopRadiusKm - GROUND_RADIUS_KM*GROUND_RADIUS_KM );
+	float	Rho = sqrt( max( 0.0, _RadiusKm*_RadiusKm - GROUND_RADIUS_KM*GROUND_RADIUS_KM ) );
+	float	RMu = _RadiusKm * _CosThetaView;
+	float	Delta = RMu*RMu - _RadiusKm*_RadiusKm + GROUND_RADIUS_KM*GROUND_RADIUS_KM;
+	float4	Cst = RMu < 0.0 && Delta > 0.0 ? float4( 1.0, 0.0, 0.0, 0.5 - 0.5 / RES_3D_COS_THETA_VIEW ) : float4( -1.0, H*H, H, 0.5 + 0.5 / RES_3D_COS_THETA_VIEW );
+
+	float	UAltitude = 0.5 / RES_3D_ALTITUDE + Rho / H * (1.0 - 1.0 / RES_3D_ALTITUDE);
+	float	UCosThetaView = Cst.w + (RMu * Cst.x + sqrt( Delta + Cst.y )) / (Rho + Cst.z) * (0.5 - 1.0 / RES_3D_COS_THETA_VIEW);
+	float	UCosThetaSun = 0.5 / RES_3D_COS_THETA_SUN + (atan( max( _CosThetaSun, -0.1975 ) * tan( 1.26 * 1.1 ) ) / 1.1 + (1.0 - 0.26)) * 0.5 * (1.0 - 1.0 / RES_3D_COS_THETA_SUN);
+
+	float	t = 0.5 * (_CosGamma + 1.0) * (RES_3D_COS_GAMMA - 1.0);
+	float	UCosGamma = floor( t );
+	t -= UCosGamma;
+
+	float4	S0 = _TexScattering.SampleLevel( LinearClamp, float3( (UCosGamma + UCosThetaSun) / RES_3D_COS_GAMMA, UCosThetaView, UAltitude ), 0.0 );
+	float4	S1 = _TexScattering.SampleLevel( LinearClamp, float3( (UCosGamma + UCosThetaSun + 1.0) / RES_3D_COS_GAMMA, UCosThetaView, UAltitude ), 0.0 );
+	return lerp( S0, S1, t );
+}
+
+float	PhaseRayleigh( float _CosGamma )
+{
+	return (3.0 / (16.0 * PI)) * (1.0 + _CosGamma*_CosGamma);
+}
+
+float	PhaseMie( float _CosGamma, float g )
+{
+	return 1.5 * (1.0 / (4.0 * PI)) * (1.0 - g*g) * pow( 1.0 + g*g - 2.0*g*_CosGamma, -1.5 ) * (1.0 + _CosGamma*_CosGamma) / (2.0 + g*g);
+}
+
+// Applies the phase functions to the Rayleigh & Mie scattering, recovering the Mie color from its red component
+float3	ResolveScattering( float4 _Scattering, float _CosGamma )
+{
+	float3	Mie = _Scattering.xyz * _Scattering.w / max( 1e-4, _Scattering.x ) * (SIGMA_SCATTERING_RAYLEIGH.x / SIGMA_SCATTERING_MIE) * (SIGMA_SCATTERING_MIE / SIGMA_SCATTERING_RAYLEIGH);
+	return max( 0.0, _Scattering.xyz * PhaseRayleigh( _CosGamma ) + Mie * PhaseMie( _CosGamma, MIE_ANISOTROPY ) );
+}
+
+float	GetCameraAltitudeKm()
+{
+	return max( 1e-3, _Camera2World[3].y + _AltitudeOffset );
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+[numthreads( 8, 8, 1 )]
+void	CS_SkyView( uint3 _ThreadID : SV_DispatchThreadID )
+{
+	if ( any( _ThreadID.xy >= _SkyViewSize ) )
+		return;
+
+	float3	View = SkyViewUVToDirection( (_ThreadID.xy + 0.5) / _SkyViewSize );
+	float	RadiusKm = GROUND_RADIUS_KM + GetCameraAltitudeKm();
+	float	CosGamma = dot( View, _LightDirection );
+
+	float4	Scattering = SampleScattering( RadiusKm, View.y, _LightDirection.y, CosGamma );
+	_OutSkyView[_ThreadID.xy] = float4( _SunIntensity * ResolveScattering( Scattering, CosGamma ), 1.0 );
+}
+
+//////////////////////////////////////////////////////////////////////////
+[numthreads( 4, 4, 4 )]
+void	CS_AerialPerspective( uint3 _ThreadID : SV_DispatchThreadID )
+{
+	if ( any( _ThreadID >= _AerialPerspectiveSize ) )
+		return;
+
+	// View vector (with Z=1) through the center of the texel's column
+	float2	UV = (_ThreadID.xy + 0.5) / _AerialPerspectiveSize.xy;
+	float3	csView = float3( _CameraData.x * (2.0 * UV.x - 1.0), _CameraData.y * (1.0 - 2.0 * UV.y), 1.0 );
+	float	DistanceKm = (_ThreadID.z + 1.0) / _AerialPerspectiveSize.z * _AerialPerspectiveFarKm * length( csView );
+	float3	View = normalize( mul( float4( csView, 0.0 ), _Camera2World ).xyz );
+
+	// Scattering between the camera and the end of the slice is the scattering toward the camera minus the attenuated
+	//	scattering toward the end of the slice
+	float	AltitudeKm = GetCameraAltitudeKm();
+	float	RadiusKm = GROUND_RADIUS_KM + AltitudeKm;
+	float	CosThetaView = View.y;
+	float	CosThetaSun = _LightDirection.y;
+	float	CosGamma = dot( View, _LightDirection );
+
+	float	RadiusKm0 = sqrt( RadiusKm*RadiusKm + DistanceKm*DistanceKm + 2.0 * RadiusKm * CosThetaView * DistanceKm );
+	float	CosThetaView0 = (RadiusKm * CosThetaView + DistanceKm) / RadiusKm0;
+	float	CosThetaSun0 = (RadiusKm * CosThetaSun + DistanceKm * CosGamma) / RadiusKm0;
+
+	float3	Transmittance = GetTransmittance( AltitudeKm, CosThetaView, DistanceKm );
+	float4	Scattering = SampleScattering( RadiusKm, CosThetaView, CosThetaSun, CosGamma );
+	float4	Scattering0 = SampleScattering( max( GROUND_RADIUS_KM, RadiusKm0 ), CosThetaView0, CosThetaSun0, CosGamma );
+	float4	InScattering = max( 0.0, Scattering - Transmittance.xyzx * Scattering0 );
+
+	float3	Light = _SunIntensity * ResolveScattering( InScattering, CosGamma );
+	_OutAerialPerspective[_ThreadID] = float4( Light, dot( Transmittance, 1.0 / 3.0 ) );
+}
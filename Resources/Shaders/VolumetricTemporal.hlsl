@@ -0,0 +1,120 @@
+//////////////////////////////////////////////////////////////////////////
+// Temporal reprojection of the clouds (cf. EffectVolumetric::Render() with TEMPORAL_CLOUDS)
+// Each frame, only one pixel of every _PatternSize x _PatternSize block is ray-marched (the one at _MarchedOffset, following a Bayer order
+//	from one frame to the next) and the other pixels are reprojected from the previous frame's resolved clouds.
+//
+// PS_Mask tags the pixels to march in the stencil so the expensive display shader is early-rejected everywhere else
+// PS_Resolve then builds the full resolution clouds:
+//	_ Pixels marched this frame are kept as is
+//	_ Other pixels are located in the previous frame using the cloud box's front depth and the previous World=>Proj transform.
+//		The history is rejected if it falls off screen or if the depth it was computed with doesn't match, in which case
+//		we use the pixel marched this frame in the same block. Otherwise the history is clamped to the range of the
+//		neighbor pixels marched this frame so stale clouds can't ghost.
+//
+#include "Inc/Global.hlsl"
+
+cbuffer	cbTemporal : register( b10 )
+{
+	float3		_dUV;
+	uint		_PatternSize;			// 2 => 1/4 of the pixels are marched each frame, 4 => 1/16
+	int2		_MarchedOffset;			// Position of the pixel marched this frame within each block
+	int2		_TargetSize;
+	float4x4	_PreviousWorld2Proj;	// Camera's World=>Proj transform of the frame the history was built with
+	float		_DepthRejection;		// Relative depth difference above which the history is rejected
+	uint		_bHistoryValid;
+};
+
+Texture2DArray<float4>	_TexCloud : register( t10 );			// Slice 0 = Scattering, Slice 1 = Extinction (only the marched pixels are up to date)
+Texture2D<float2>		_TexCloudZ : register( t11 );			// Front & back depths of the cloud box
+Texture2D<float2>		_TexCloudZHistory : register( t12 );	// Same for the previous frame
+Texture2DArray<float4>	_TexHistory : register( t13 );			// Previous resolved clouds
+
+
+struct	VS_IN
+{
+	float4	__Position : SV_POSITION;
+};
+
+struct	PS_OUT
+{
+	float4	Scattering : SV_TARGET0;
+	float4	Extinction : SV_TARGET1;
+};
+
+VS_IN	VS( VS_IN _In )	{ return _In; }
+
+bool	IsMarched( int2 _Pixel )
+{
+	return all( (_Pixel % int(_PatternSize)) == _MarchedOffset );
+}
+
+void	PS_Mask( VS_IN _In )
+{
+	if ( !IsMarched( int2( _In.__Position.xy ) ) )
+		discard;
+}
+
+PS_OUT	PS_Resolve( VS_IN _In )
+{
+	int2	Pixel = int2( _In.__Position.xy );
+
+	PS_OUT	Current;
+	Current.Scattering = _TexCloud.Load( int4( Pixel, 0, 0 ) );
+	Current.Extinction = _TexCloud.Load( int4( Pixel, 1, 0 ) );
+	if ( IsMarched( Pixel ) )
+		return Current;
+
+	// Gather the range of the pixels marched this frame in the 3x3 blocks around us
+	int		PatternSize = int(_PatternSize);
+	int2	Block = Pixel / PatternSize;
+	int2	MaxBlock = (_TargetSize - 1 - _MarchedOffset) / PatternSize;
+
+	PS_OUT	Fresh;
+	Fresh.Scattering = _TexCloud.Load( int4( min( Block, MaxBlock ) * PatternSize + _MarchedOffset, 0, 0 ) );
+	Fresh.Extinction = _TexCloud.Load( int4( min( Block, MaxBlock ) * PatternSize + _MarchedOffset, 1, 0 ) );
+
+	float4	MinScattering = Fresh.Scattering, MaxScattering = Fresh.Scattering;
+	float4	MinExtinction = Fresh.Extinction, MaxExtinction = Fresh.Extinction;
+	for ( int Y=-1; Y <= 1; Y++ )
+		for ( int X=-1; X <= 1; X++ )
+		{
+			int2	NeighborPixel = clamp( Block + int2( X, Y ), 0, MaxBlock ) * PatternSize + _MarchedOffset;
+			float4	Scattering = _TexCloud.Load( int4( NeighborPixel, 0, 0 ) );
+			float4	Extinction = _TexCloud.Load( int4( NeighborPixel, 1, 0 ) );
+			MinScattering = min( MinScattering, Scattering );	MaxScattering = max( MaxScattering, Scattering );
+			MinExtinction = min( MinExtinction, Extinction );	MaxExtinction = max( MaxExtinction, Extinction );
+		}
+
+	if ( !_bHistoryValid )
+		return Fresh;
+
+	// Locate the pixel in the previous frame
+	float2	UV = (Pixel + 0.5) * _dUV.xy;
+	float	Z = _TexCloudZ.Load( int3( Pixel, 0 ) ).x;
+	bool	bInsideBox = Z > 0.0;
+	if ( !bInsideBox )
+		Z = _CameraData.w;	// Outside of the cloud box, only the sky is visible so consider it's far away
+
+	float3	View = float3( _CameraData.x * (2.0 * UV.x - 1.0), _CameraData.y * (1.0 - 2.0 * UV.y), 1.0 );
+	float3	WorldPosition = mul( float4( Z * View, 1.0 ), _Camera2World ).xyz;
+	float4	PreviousProj = mul( float4( WorldPosition, 1.0 ), _PreviousWorld2Proj );
+	if ( PreviousProj.w <= 0.0 )
+		return Fresh;	// Behind the previous camera
+
+	float2	PreviousUV = float2( 0.5 * (1.0 + PreviousProj.x / PreviousProj.w), 0.5 * (1.0 - PreviousProj.y / PreviousProj.w) );
+	if ( any( PreviousUV < 0.0 ) || any( PreviousUV > 1.0 ) )
+		return Fresh;	// Off screen
+
+	if ( bInsideBox )
+	{	// Reject the history if it was computed against another surface of the box
+		float	PreviousZ = _TexCloudZHistory.Load( int3( min( int2( PreviousUV / _dUV.xy ), _TargetSize - 1 ), 0 ) ).x;
+		if ( abs( PreviousZ - PreviousProj.w ) > _DepthRejection * PreviousProj.w )
+			return Fresh;
+	}
+
+	// Clamp the history to the neighborhood
+	PS_OUT	Out;
+	Out.Scattering = clamp( _TexHistory.SampleLevel( LinearClamp, float3( PreviousUV, 0.0 ), 0.0 ), MinScattering, MaxScattering );
+	Out.Extinction = clamp( _TexHistory.SampleLevel( LinearClamp, float3( PreviousUV, 1.0 ), 0.0 ), MinExtinction, MaxExtinction );
+	return Out;
+}
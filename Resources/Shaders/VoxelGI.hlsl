@@ -0,0 +1,308 @@
+//////////////////////////////////////////////////////////////////////////
+// Voxel cone-traced GI (cf. Utility/VoxelGI.h)
+//	_ VS/GS/PS voxelize the scene primitives into the albedo & normal volumes of a clipmap level: the GS projects each triangle
+//		along its dominant axis and pushes its edges half a voxel diagonal outward so thin triangles still cover all the voxels
+//		they cross (conservative rasterization done by the GS), the PS then averages the albedo & normal of the voxel with atomics
+//	_ CS_Inject lights the voxels of all the levels by the sun through its shadow map into the radiance volume (A = opacity)
+//	_ CS_BuildAnisotropic builds a mip of the 6 directional volumes: each texel composites the 2 source texels along its
+//		direction front to back then averages the 4 resulting pairs, the first mip is built from the isotropic radiance
+//
+// The voxelization material reads the object & material constant buffers of the scene shaders (b10 & b11) and the diffuse
+//	texture in t10, exactly like GIRenderScene2.hlsl does.
+//
+#include "Inc/Global.hlsl"
+#include "Inc/PackedVertex.hlsl"
+#include "Inc/VoxelConeTracing.hlsl"
+
+#define	THREADS_COUNT	4		// Threads per group in each dimension
+
+cbuffer	cbObject : register( b10 )		// !!IMPORTANT ==> Must correspond to EffectGlobalIllum2::CBObject!!
+{
+	float4x4	_Local2World;
+	float3		_QuantizationMin;
+	float		__ObjectPAD0;
+	float3		_QuantizationSize;
+	uint		_InstancesStart;
+};
+
+cbuffer	cbMaterial : register( b11 )	// !!IMPORTANT ==> Must correspond to EffectGlobalIllum2::CBMaterial!!
+{
+	uint		_MaterialID;
+	float3		_DiffuseAlbedo;
+
+	uint		_HasDiffuseTexture;
+	float3		_SpecularAlbedo;
+
+	uint		_HasSpecularTexture;
+	float3		_EmissiveColor;
+
+	float		_SpecularExponent;
+	uint		_FaceOffset;
+	uint		_HasNormalTexture;
+};
+
+cbuffer	cbVoxelize : register( b5 )	// !!IMPORTANT ==> Must correspond to VoxelGI::CBVoxelize!!
+{
+	float3		_LevelMin;				// World position of the corner of the level being voxelized
+	float		_VoxelSize;
+	uint		_MipIndex;				// Anisotropic mip being built
+	uint		_TargetSize;			// Size of a level in the anisotropic mip being built
+	uint		__VoxelizePAD0;
+	float		_ShadowBias;
+
+	float4x4	_World2SunShadow;		// Maps the sun's shadow map to [(-1,-1,0),(+1,+1,1)]
+	float3		_SunDirection;			// Toward the sun
+	float		__VoxelizePAD1;
+	float3		_SunColor;
+};
+
+Texture2D<float4>			_TexDiffuseAlbedo : register( t10 );
+
+//////////////////////////////////////////////////////////////////////////
+// Packing helpers
+// The albedo & normal of the voxels are RGBA8 moving averages: RGB is the average and A the amount of fragments averaged so far
+float4	UnpackRGBA8( uint _Value )
+{
+	return float4( _Value & 0xFF, (_Value >> 8) & 0xFF, (_Value >> 16) & 0xFF, _Value >> 24 );
+}
+
+uint	PackRGBA8( float4 _Value )
+{
+	uint4	Value = uint4( clamp( _Value, 0.0, 255.0 ) );
+	return Value.x | (Value.y << 8) | (Value.z << 16) | (Value.w << 24);
+}
+
+// Adds a fragment to the average stored in the voxel (cf. "Octree-Based Sparse Voxelization Using the GPU Hardware Rasterizer", Crassin & Green 2012)
+void	AverageRGBA8( RWTexture3D<uint> _Target, uint3 _Voxel, float3 _Value )
+{
+	float4	NewValue = float4( 255.0 * saturate( _Value ), 1.0 );
+	uint	NewPacked = PackRGBA8( NewValue );
+	uint	PreviousPacked = 0;
+	uint	CurrentPacked;
+	[allow_uav_condition]
+	for ( uint Iteration=0; Iteration < 16; Iteration++ )
+	{
+		InterlockedCompareExchange( _Target[_Voxel], PreviousPacked, NewPacked, CurrentPacked );
+		if ( CurrentPacked == PreviousPacked )
+			break;
+
+		PreviousPacked = CurrentPacked;
+		float4	Average = UnpackRGBA8( CurrentPacked );
+		if ( Average.w >= 255.0 )
+			break;	// Enough fragments
+
+		NewPacked = PackRGBA8( float4( (Average.w * Average.xyz + NewValue.xyz) / (Average.w + 1.0), Average.w + 1.0 ) );
+	}
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// Voxelization
+#if PACKED_VERTICES
+typedef VS_IN_PACKED	VS_IN;
+#else
+struct	VS_IN
+{
+	float3	Position	: POSITION;
+	float3	Normal		: NORMAL;
+	float3	Tangent		: TANGENT;
+	float3	BiTangent	: BITANGENT;
+	float2	UV			: TEXCOORD0;
+};
+#endif
+
+struct	GS_IN
+{
+	float3	VoxelPosition	: POSITION;		// In voxels within the level
+	float3	Normal			: NORMAL;
+	float2	UV				: TEXCOORD0;
+};
+
+struct	PS_IN
+{
+	float4	__Position		: SV_POSITION;
+	float3	VoxelPosition	: POSITION;
+	float3	Normal			: NORMAL;
+	float2	UV				: TEXCOORD0;
+	float4	BoundsXY		: TEXCOORD1;	// Projected bounds of the original triangle, to clip the dilation's excess
+};
+
+GS_IN	VS( VS_IN _In )
+{
+#if PACKED_VERTICES
+	float3	Position, Normal, Tangent, BiTangent;
+	float2	UV;
+	DecodePackedVertex( _In, _QuantizationMin, _QuantizationSize, Position, Normal, Tangent, BiTangent, UV );
+#else
+	float3	Position = _In.Position;
+	float3	Normal = _In.Normal;
+	float2	UV = _In.UV;
+#endif
+
+	float3	WorldPosition = mul( float4( Position, 1.0 ), _Local2World ).xyz;
+
+	GS_IN	Out;
+	Out.VoxelPosition = (WorldPosition - _LevelMin) / _VoxelSize;
+	Out.Normal = mul( float4( Normal, 0.0 ), _Local2World ).xyz;
+	Out.UV = UV;
+	return Out;
+}
+
+// Swizzles the voxel position so the dominant axis becomes Z
+float3	SwizzleAxis( float3 _Position, uint _Axis )
+{
+	return _Axis == 0 ? _Position.yzx : (_Axis == 1 ? _Position.zxy : _Position);
+}
+
+[maxvertexcount( 3 )]
+void	GS( triangle GS_IN _In[3], inout TriangleStream<PS_IN> _Stream )
+{
+	float3	FaceNormal = abs( cross( _In[1].VoxelPosition - _In[0].VoxelPosition, _In[2].VoxelPosition - _In[0].VoxelPosition ) );
+	uint	Axis = FaceNormal.x > FaceNormal.y && FaceNormal.x > FaceNormal.z ? 0 : (FaceNormal.y > FaceNormal.z ? 1 : 2);
+
+	float3	pProjected[3];
+	[unroll]
+	for ( uint i=0; i < 3; i++ )
+		pProjected[i] = SwizzleAxis( _In[i].VoxelPosition, Axis );
+
+	float4	BoundsXY = float4( min( pProjected[0].xy, min( pProjected[1].xy, pProjected[2].xy ) ), max( pProjected[0].xy, max( pProjected[1].xy, pProjected[2].xy ) ) );
+	BoundsXY += float4( -0.5, -0.5, 0.5, 0.5 );
+
+	// Push each vertex half a voxel diagonal along the normals of its 2 edges (cf. "Conservative Rasterization", Hasselgren et al., GPU Gems 2)
+	float	Winding = sign( cross( float3( pProjected[1].xy - pProjected[0].xy, 0.0 ), float3( pProjected[2].xy - pProjected[0].xy, 0.0 ) ).z );
+	float2	pDilated[3];
+	[unroll]
+	for ( uint j=0; j < 3; j++ )
+	{
+		float2	Previous = pProjected[(j+2)%3].xy;
+		float2	Current = pProjected[j].xy;
+		float2	Next = pProjected[(j+1)%3].xy;
+		float2	EdgeIn = normalize( Current - Previous + 1e-6 );
+		float2	EdgeOut = normalize( Next - Current + 1e-6 );
+		float2	NormalIn = Winding * float2( EdgeIn.y, -EdgeIn.x );
+		float2	NormalOut = Winding * float2( EdgeOut.y, -EdgeOut.x );
+		pDilated[j] = Current + 0.5 * (NormalIn + NormalOut) / max( 0.5, 1.0 + dot( NormalIn, NormalOut ) );
+	}
+
+	[unroll]
+	for ( uint k=0; k < 3; k++ )
+	{
+		PS_IN	Out;
+		Out.__Position = float4( 2.0 * pDilated[k] / VOXEL_CLIPMAP_SIZE - 1.0, pProjected[k].z / VOXEL_CLIPMAP_SIZE, 1.0 );
+		Out.__Position.y = -Out.__Position.y;
+		Out.VoxelPosition = _In[k].VoxelPosition;
+		Out.Normal = _In[k].Normal;
+		Out.UV = _In[k].UV;
+		Out.BoundsXY = float4( BoundsXY.x, VOXEL_CLIPMAP_SIZE - BoundsXY.w, BoundsXY.z, VOXEL_CLIPMAP_SIZE - BoundsXY.y );	// In pixels, Y goes down
+		_Stream.Append( Out );
+	}
+}
+
+RWTexture3D<uint>	_VoxelAlbedo : register( u0 );	// The slab of the level being voxelized
+RWTexture3D<uint>	_VoxelNormal : register( u1 );
+
+void	PS( PS_IN _In )
+{
+	if ( any( _In.__Position.xy < _In.BoundsXY.xy ) || any( _In.__Position.xy > _In.BoundsXY.zw ) )
+		discard;
+
+	int3	Voxel = int3( floor( _In.VoxelPosition ) );
+	if ( any( Voxel < 0 ) || any( Voxel >= VOXEL_CLIPMAP_SIZE ) )
+		return;
+
+	float3	Albedo = _DiffuseAlbedo;
+	if ( _HasDiffuseTexture )
+		Albedo *= _TexDiffuseAlbedo.Sample( LinearWrap, _In.UV ).xyz;
+
+	AverageRGBA8( _VoxelAlbedo, uint3( Voxel ), Albedo );
+	AverageRGBA8( _VoxelNormal, uint3( Voxel ), 0.5 + 0.5 * normalize( _In.Normal ) );
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// Radiance injection
+Texture2D<float>			_TexSunShadowMap : register( t11 );
+Texture3D<uint>				_TexVoxelAlbedo : register( t12 );	// All the levels stacked in depth
+Texture3D<uint>				_TexVoxelNormal : register( t13 );
+RWTexture3D<float4>			_VoxelRadiance : register( u2 );
+
+[numthreads( THREADS_COUNT, THREADS_COUNT, THREADS_COUNT )]
+void	CS_Inject( uint3 _DispatchThreadID : SV_DispatchThreadID )
+{
+	uint3	Voxel = _DispatchThreadID;
+	float4	Albedo = UnpackRGBA8( _TexVoxelAlbedo[Voxel] );
+	if ( Albedo.w == 0.0 )
+	{	// Empty
+		_VoxelRadiance[Voxel] = 0.0;
+		return;
+	}
+	Albedo.xyz /= 255.0;
+
+	float3	Normal = 2.0 * UnpackRGBA8( _TexVoxelNormal[Voxel] ).xyz / 255.0 - 1.0;
+	float	NormalLength = length( Normal );
+	float	NdotL = NormalLength > 0.1 ? saturate( dot( Normal / NormalLength, _SunDirection ) ) : 0.5;	// Voxels of opposite faces have no clear normal
+
+	// Voxel position in the level of its slab (cf. cbVoxelGI in Inc/VoxelConeTracing.hlsl)
+	uint	LevelIndex = Voxel.z / VOXEL_CLIPMAP_SIZE;
+	float4	LevelMinSize = _VoxelLevels[LevelIndex];	// XYZ = corner, W = voxel size
+	float3	WorldPosition = LevelMinSize.xyz + (float3( Voxel.x, Voxel.y, Voxel.z % VOXEL_CLIPMAP_SIZE ) + 0.5) * LevelMinSize.w;
+
+	// Sun shadow, pushed a voxel out of the surface
+	float3	ShadowPosition = mul( float4( WorldPosition + LevelMinSize.w * (NormalLength > 0.1 ? Normal / NormalLength : _SunDirection), 1.0 ), _World2SunShadow ).xyz;
+	float	Shadow = 1.0;
+	if ( all( abs( ShadowPosition.xy ) < 1.0 ) )
+	{
+		float2	UV = float2( 0.5 + 0.5 * ShadowPosition.x, 0.5 - 0.5 * ShadowPosition.y );
+		Shadow = ShadowPosition.z - _ShadowBias <= _TexSunShadowMap.SampleLevel( PointClamp, UV, 0.0 ) ? 1.0 : 0.0;
+	}
+
+	float3	Radiance = Albedo.xyz * _SunColor * (NdotL * Shadow / PI);
+	_VoxelRadiance[Voxel] = float4( Radiance, 1.0 );	// Opaque voxels, the radiance is premultiplied by the opacity
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// Anisotropic mips
+// The 6 directional volumes are stacked in X in the order +X, -X, +Y, -Y, +Z, -Z: the texels of direction +X are seen by
+//	rays traveling toward +X, so their front is the source texel with the smaller X.
+Texture3D<float4>			_TexSource : register( t14 );		// Radiance (first mip) or the previous anisotropic mip
+RWTexture3D<float4>			_AnisotropicTarget : register( u3 );
+
+float4	CompositeFrontToBack( float4 _Front, float4 _Back )
+{
+	return _Front + (1.0 - _Front.w) * _Back;
+}
+
+[numthreads( THREADS_COUNT, THREADS_COUNT, THREADS_COUNT )]
+void	CS_BuildAnisotropic( uint3 _DispatchThreadID : SV_DispatchThreadID )
+{
+	uint3	Texel = _DispatchThreadID;
+	if ( Texel.x >= 6 * _TargetSize || Texel.y >= _TargetSize || Texel.z >= _VoxelLevelsCount * _TargetSize )
+		return;
+
+	uint	Direction = Texel.x / _TargetSize;
+	uint3	Local = uint3( Texel.x % _TargetSize, Texel.y, Texel.z % _TargetSize );
+	uint	LevelIndex = Texel.z / _TargetSize;
+
+	// The first mip reads the isotropic radiance, the next ones read the same direction in the previous mip
+	uint	SourceSize = 2 * _TargetSize;
+	uint3	SourceOrigin = uint3( _MipIndex != 0 ? Direction * SourceSize : 0, 0, LevelIndex * SourceSize ) + 2 * Local;
+
+	uint	Axis = Direction >> 1;
+	bool	bNegative = (Direction & 1) != 0;
+	uint3	AxisStep = Axis == 0 ? uint3( 1, 0, 0 ) : (Axis == 1 ? uint3( 0, 1, 0 ) : uint3( 0, 0, 1 ));
+	uint3	OtherStep0 = Axis == 0 ? uint3( 0, 1, 0 ) : uint3( 1, 0, 0 );
+	uint3	OtherStep1 = Axis == 2 ? uint3( 0, 1, 0 ) : uint3( 0, 0, 1 );
+
+	float4	Sum = 0.0;
+	[unroll]
+	for ( uint PairIndex=0; PairIndex < 4; PairIndex++ )
+	{
+		uint3	Pair = SourceOrigin + (PairIndex & 1) * OtherStep0 + (PairIndex >> 1) * OtherStep1;
+		float4	Near = _TexSource[Pair];
+		float4	Far = _TexSource[Pair + AxisStep];
+		Sum += bNegative ? CompositeFrontToBack( Far, Near ) : CompositeFrontToBack( Near, Far );
+	}
+
+	_AnisotropicTarget[Texel] = 0.25 * Sum;
+}
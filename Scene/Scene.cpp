@@ -4,14 +4,51 @@
 
 Scene::Scene()
 	: m_pROOT( NULL )
+	, m_ppNodes( NULL )
+	, m_ppMeshes( NULL )
+	, m_ppLights( NULL )
+	, m_ppCameras( NULL )
+	, m_ppProbes( NULL )
+	, m_ChunksCount( 0 )
+	, m_pChunks( NULL )
+	, m_InstanceGroupsCount( 0 )
+	, m_pInstanceGroups( NULL )
+	, m_InstancesCount( 0 )
+	, m_ppInstances( NULL )
 	, m_MaterialsCount( 0 )
 	, m_ppMaterials( NULL )
+	, m_LevelsCount( 0 )
+	, m_pLevelsStart( NULL )
+	, m_pSlotNodes( NULL )
+	, m_pSlotParents( NULL )
+	, m_pLocal2Parent( NULL )
+	, m_pLocal2World( NULL )
+	, m_pDirty( NULL )
+	, m_bTransformsDirty( false )
+	, m_pSceneData( NULL )
+	, m_Version( 0 )
 {
 }
 Scene::~Scene()
 {
 	delete m_pROOT;
 
+	delete[] m_pDirty;
+	delete[] m_pLocal2World;
+	delete[] m_pLocal2Parent;
+	delete[] m_pSlotParents;
+	delete[] m_pSlotNodes;
+	delete[] m_pLevelsStart;
+
+	delete[] m_ppInstances;
+	delete[] m_pInstanceGroups;
+	delete[] m_pChunks;
+	delete[] m_ppProbes;
+	delete[] m_ppCameras;
+	delete[] m_ppLights;
+	delete[] m_ppMeshes;
+	delete[] m_ppNodes;
+
 	for ( int MaterialIndex=0; MaterialIndex < m_MaterialsCount; MaterialIndex++ )
 		delete m_ppMaterials[MaterialIndex];
 	delete[] m_ppMaterials;
@@ -19,12 +56,19 @@ Scene::~Scene()
 	m_MaterialsCount = 0;
 }
 
-void	Scene::Load( U16 _SceneResourceID ) {
+void	Scene::Load( U16 _SceneResourceID, int _LODsCount ) {
 	U32			SceneSize = 0;
-	const U8*	pData = LoadResourceBinary( _SceneResourceID, "SCENE", &SceneSize );
+	const U8*	pData = LoadResourceBinary( _SceneResourceID, "SCENE", &SceneSize );	// Locked resources stay valid for the lifetime of the process
+	Load( pData, SceneSize, _LODsCount );
+}
+
+void	Scene::Load( const U8* _pSceneData, U32 _SceneSize, int _LODsCount ) {
+	ASSERT( IsSceneData( _pSceneData, _SceneSize ), "Invalid scene data!" );
+	const U8*	pData = _pSceneData;
+	m_pSceneData = pData;
 
-	U32		Version = ReadU32( pData );	// Should be "GCX1"
-	ASSERT( Version == 0x31584347L, "Unsupported scene version!" );
+	m_Version = ReadU32( pData );	// Should be "GCX1" or "GCX2"
+	ASSERT( m_Version == GCX1 || m_Version == GCX2, "Unsupported scene version!" );
 
 	// ==== Read Materials ====
 	//
@@ -46,6 +90,20 @@ void	Scene::Load( U16 _SceneResourceID ) {
 	m_ProbesCount = 0;
 
 	m_pROOT = CreateNode( NULL, pData );
+
+	BuildNodeArrays();
+	BuildTransformArrays();
+	BuildInstanceGroups();
+	ComputeContentHashes();
+	BuildLODs( _LODsCount );
+}
+
+bool	Scene::IsSceneData( const U8* _pSceneData, U32 _SceneSize ) {
+	if ( _pSceneData == NULL || _SceneSize < sizeof(U32) )
+		return false;
+
+	U32	Version = *((const U32*) _pSceneData);
+	return Version == GCX1 || Version == GCX2;
 }
 
 void	Scene::PlaceTags( ISceneTagger& _SceneTagger ) {
@@ -56,6 +114,27 @@ void	Scene::PlaceTags( ISceneTagger& _SceneTagger ) {
 
 	// Tag nodes
 	m_pROOT->PlaceTag( _SceneTagger );
+	for ( int ChunkIndex=0; ChunkIndex < m_ChunksCount; ChunkIndex++ )
+		m_pChunks[ChunkIndex].m_State = Chunk::RESIDENT;
+}
+
+void	Scene::PlaceMaterialTags( ISceneTagger& _SceneTagger ) {
+	for ( int MaterialIndex=0; MaterialIndex < m_MaterialsCount; MaterialIndex++ ) {
+		m_ppMaterials[MaterialIndex]->PlaceTag( _SceneTagger );
+	}
+
+	// Only tag the root itself, its children are chunks
+	m_pROOT->m_pTag = _SceneTagger.TagNode( *this, *m_pROOT );
+	m_pROOT->PlaceTagSpecific( _SceneTagger );
+}
+
+void	Scene::PlaceTags( ISceneTagger& _SceneTagger, Chunk& _Chunk ) {
+	_Chunk.m_pRoot->PlaceTag( _SceneTagger );
+}
+
+void	Scene::PlaceTags( ISceneTagger& _SceneTagger, Mesh& _Mesh ) {
+	_Mesh.m_pTag = _SceneTagger.TagNode( *this, _Mesh );
+	_Mesh.PlaceTagSpecific( _SceneTagger );
 }
 
 void	Scene::Exit() {
@@ -66,78 +145,116 @@ void	Scene::Exit() {
 }
 
 void	Scene::Render( ISceneRenderer& _SceneRenderer, bool _SetMaterial ) const {
-	Render( m_pROOT, _SceneRenderer, _SetMaterial );
+	for ( int MeshIndex=0; MeshIndex < m_MeshesCount; MeshIndex++ ) {
+		const Mesh&	M = *m_ppMeshes[MeshIndex];
+		if ( M.m_ChunkIndex >= 0 && m_pChunks[M.m_ChunkIndex].m_State != Chunk::RESIDENT )
+			continue;	// Streamed out...
+
+		_SceneRenderer.RenderMesh( M, NULL, _SetMaterial );
+	}
 }
 
-void	Scene::Render( const Node* _pNode, ISceneRenderer& _SceneRenderer, bool _SetMaterial ) const {
-	ASSERT( _pNode != NULL, "Invalid node!" );
+void	Scene::SetLocal2Parent( Node& _Node, const float4x4& _Local2Parent ) {
+	ASSERT( &_Node.m_Owner == this, "Node belongs to another scene!" );
+	_Node.m_Local2Parent = _Local2Parent;
+	m_pLocal2Parent[_Node.m_TransformSlot] = _Local2Parent;
+	m_pDirty[_Node.m_TransformSlot] = 1;
+	m_bTransformsDirty = true;
+}
 
-	if ( _pNode->m_Type == Node::MESH )
-		_SceneRenderer.RenderMesh( (const Mesh&) *_pNode, NULL, _SetMaterial );
+// Transforms a range of slots of a single level, whose parents were all transformed by the previous level
+class	Scene::TransformsKernel : public IParallelForKernel {
+public:
+	Scene&			m_Owner;
+	int				m_LevelStart;
+	volatile LONG	m_UpdatedCount;
+	volatile LONG	m_UpdatedMeshesCount;
+
+	TransformsKernel( Scene& _Owner ) : m_Owner( _Owner ), m_LevelStart( 0 ), m_UpdatedCount( 0 ), m_UpdatedMeshesCount( 0 ) {}
+
+	virtual void	Run( int _Start, int _End ) {
+		int	UpdatedCount = 0, UpdatedMeshesCount = 0;
+		for ( int SlotIndex=m_LevelStart+_Start; SlotIndex < m_LevelStart+_End; SlotIndex++ ) {
+			int	ParentSlot = m_Owner.m_pSlotParents[SlotIndex];
+			if ( ParentSlot >= 0 )
+				m_Owner.m_pDirty[SlotIndex] |= m_Owner.m_pDirty[ParentSlot];	// Moving parents move their whole subtree
+			if ( !m_Owner.m_pDirty[SlotIndex] )
+				continue;
+
+			float4x4&	Local2World = m_Owner.m_pLocal2World[SlotIndex];
+			Local2World = ParentSlot >= 0 ? m_Owner.m_pLocal2Parent[SlotIndex] * m_Owner.m_pLocal2World[ParentSlot] : m_Owner.m_pLocal2Parent[SlotIndex];
+
+			// Write back to the node that all the renderers read
+			Node&	N = *m_Owner.m_ppNodes[m_Owner.m_pSlotNodes[SlotIndex]];
+			N.m_Local2World = Local2World;
+			if ( N.m_Type == Node::MESH ) {
+				((Mesh&) N).UpdateGlobalBBox();
+				UpdatedMeshesCount++;
+			}
+			UpdatedCount++;
+		}
 
-	// Render children
-	for ( int ChildIndex=0; ChildIndex < _pNode->m_ChildrenCount; ChildIndex++ )
-		Render( _pNode->m_ppChildren[ChildIndex], _SceneRenderer, _SetMaterial );
+		InterlockedExchangeAdd( &m_UpdatedCount, UpdatedCount );
+		InterlockedExchangeAdd( &m_UpdatedMeshesCount, UpdatedMeshesCount );
+	}
+};
+
+int		Scene::UpdateTransforms() {
+	static const int	GRAIN_SIZE = 256;	// Slots per chunk of a parallel level, smaller levels are transformed by the calling thread
+
+	if ( !m_bTransformsDirty )
+		return 0;	// Nothing moved
+
+	TransformsKernel	Kernel( *this );
+	for ( int LevelIndex=0; LevelIndex < m_LevelsCount; LevelIndex++ ) {
+		Kernel.m_LevelStart = m_pLevelsStart[LevelIndex];
+		int	SlotsCount = m_pLevelsStart[LevelIndex+1] - Kernel.m_LevelStart;
+		if ( SlotsCount > GRAIN_SIZE )
+			gs_Jobs.ParallelFor( SlotsCount, GRAIN_SIZE, Kernel );
+		else
+			Kernel.Run( 0, SlotsCount );
+	}
+
+	memset( m_pDirty, 0, m_NodesCount );
+	m_bTransformsDirty = false;
+
+	if ( Kernel.m_UpdatedMeshesCount > 0 )
+		UpdateChunksBBox();
+
+	return Kernel.m_UpdatedCount;
 }
 
 void	Scene::ForEach( IVisitor& _Visitor )
 {
-	ForEach( _Visitor, m_pROOT );
+	// Same order as a recursive depth-first walk of the hierarchy
+	for ( int NodeIndex=0; NodeIndex < m_NodesCount; NodeIndex++ )
+		_Visitor.HandleNode( *m_ppNodes[NodeIndex] );
 }
-void	Scene::ForEach( IVisitor& _Visitor, Node* _pNode )
-{
-	_Visitor.HandleNode( *_pNode );
-
-	for ( int ChildIndex=0; ChildIndex < _pNode->m_ChildrenCount; ChildIndex++ )
-	{
-		Node*	pChild = _pNode->m_ppChildren[ChildIndex];
-		ForEach( _Visitor, pChild );
-	}
-}
-
-Scene::Node*	Scene::ForEach( Node::TYPE _Type, Node* _pPrevious, int _StartAtChild ) {
-	if ( _pPrevious == NULL )
-	{
-		_pPrevious = m_pROOT;
-		m_pROOT->SetChildIndex();	// Setup child indices to accelerate search
-	}
-	
-	// Search in children first
-	for ( int ChildIndex=_StartAtChild; ChildIndex < _pPrevious->m_ChildrenCount; ChildIndex++ )
-	{
-		Scene::Node*	pChild = _pPrevious->m_ppChildren[ChildIndex];
-		if ( pChild->m_Type == _Type )
-			return pChild;
 
-		if ( pChild->m_ChildrenCount == 0 )
-			continue;
-
-		// Look in the child's children...
-		Scene::Node*	pMatch = ForEach( _Type, pChild );
-		if ( pMatch != NULL )
-			return pMatch;	// Found a match in one of the children
+Scene::Node*	Scene::ForEach( Node::TYPE _Type, Node* _pPrevious ) {
+	int		Count = 0;
+	Node**	ppNodes = GetNodes( _Type, Count );
+	if ( ppNodes != NULL ) {
+		int	NextIndex = _pPrevious != NULL ? _pPrevious->m_TypeIndex + 1 : 0;
+		return NextIndex < Count ? ppNodes[NextIndex] : NULL;
 	}
 
-	// If we couldn't find any match in the children, go back to parent to find this node among its siblings and continue to the next sibling
-	Node*	pParent = _pPrevious->m_pParent;
-	while ( pParent != NULL )
-	{
-		int		SiblingIndex = _pPrevious->m_ChildIndex;
-		if ( SiblingIndex < pParent->m_ChildrenCount-1 )
- 			return ForEach( _Type, pParent, SiblingIndex+1 );	// We found the previous node in its parent's children (i.e. among its siblings), continue search from there...
+	// Generic nodes, look for the next one
+	for ( int NodeIndex=_pPrevious != NULL ? _pPrevious->m_NodeIndex + 1 : 0; NodeIndex < m_NodesCount; NodeIndex++ )
+		if ( m_ppNodes[NodeIndex]->m_Type == _Type )
+			return m_ppNodes[NodeIndex];
 
-// 		for ( int SiblingIndex=0; SiblingIndex < pParent->m_ChildrenCount; SiblingIndex++ )
-// 		{
-// 			Node*	pSibling = pParent->m_ppChildren[SiblingIndex];
-// 			if ( pSibling == _pPrevious )
-// 				return ForEach( _Type, pParent, SiblingIndex+1 );	// We found the previous node in its parent's children (i.e. among its siblings), continue search from there...
-// 		}
+	return NULL;
+}
 
-		// Keep climbing...
-		_pPrevious = pParent;
-		pParent = pParent->m_pParent;
+Scene::Node**	Scene::GetNodes( Node::TYPE _Type, int& _Count ) const {
+	switch ( _Type ) {
+	case Node::MESH:	_Count = m_MeshesCount; return (Node**) m_ppMeshes;
+	case Node::LIGHT:	_Count = m_LightsCount; return (Node**) m_ppLights;
+	case Node::CAMERA:	_Count = m_CamerasCount; return (Node**) m_ppCameras;
+	case Node::PROBE:	_Count = m_ProbesCount; return (Node**) m_ppProbes;
 	}
-
+	_Count = 0;
 	return NULL;
 }
 
@@ -185,6 +302,391 @@ Scene::Node*	Scene::CreateNode( Node* _pParent, const U8*& _pData ) {
 	return pResult;
 }
 
+// Stores the node and its children in depth-first order, returns the index following the last stored node
+int	Scene::FlattenNode( Node* _pNode, int _ParentIndex, int _NodeIndex ) {
+	_pNode->m_NodeIndex = _NodeIndex;
+	_pNode->m_ParentIndex = _ParentIndex;
+	m_ppNodes[_NodeIndex++] = _pNode;
+
+	for ( int ChildIndex=0; ChildIndex < _pNode->m_ChildrenCount; ChildIndex++ )
+		_NodeIndex = FlattenNode( _pNode->m_ppChildren[ChildIndex], _pNode->m_NodeIndex, _NodeIndex );
+
+	return _NodeIndex;
+}
+
+void	Scene::BuildNodeArrays() {
+	m_ppNodes = new Node*[m_NodesCount];
+	int	NodesCount = FlattenNode( m_pROOT, -1, 0 );
+	ASSERT( NodesCount == m_NodesCount, "Nodes count mismatch!" );
+
+	m_ppMeshes = new Mesh*[m_MeshesCount];
+	m_ppLights = new Light*[m_LightsCount];
+	m_ppCameras = new Camera*[m_CamerasCount];
+	m_ppProbes = new Probe*[m_ProbesCount];
+
+	int	MeshIndex = 0, LightIndex = 0, CameraIndex = 0, ProbeIndex = 0;
+	m_GlobalBBoxMin = float3::MaxFlt;
+	m_GlobalBBoxMax = -float3::MaxFlt;
+	for ( int NodeIndex=0; NodeIndex < m_NodesCount; NodeIndex++ ) {
+		Node*	pNode = m_ppNodes[NodeIndex];
+		switch ( pNode->m_Type ) {
+		case Node::MESH: {
+			Mesh*	pMesh = (Mesh*) pNode;
+			pMesh->m_MeshIndex = pMesh->m_TypeIndex = MeshIndex;
+			m_ppMeshes[MeshIndex++] = pMesh;
+			m_GlobalBBoxMin = m_GlobalBBoxMin.Min( pMesh->m_GlobalBBoxMin );
+			m_GlobalBBoxMax = m_GlobalBBoxMax.Max( pMesh->m_GlobalBBoxMax );
+			break;
+		}
+		case Node::LIGHT:	pNode->m_TypeIndex = LightIndex; m_ppLights[LightIndex++] = (Light*) pNode; break;
+		case Node::CAMERA:	pNode->m_TypeIndex = CameraIndex; m_ppCameras[CameraIndex++] = (Camera*) pNode; break;
+		case Node::PROBE:	pNode->m_TypeIndex = ProbeIndex; m_ppProbes[ProbeIndex++] = (Probe*) pNode; break;
+		}
+	}
+
+	// Each child of the root is a chunk, its nodes directly follow its root in the flattened array
+	m_ChunksCount = m_pROOT->m_ChildrenCount;
+	m_pChunks = new Chunk[m_ChunksCount];
+	for ( int ChunkIndex=0; ChunkIndex < m_ChunksCount; ChunkIndex++ ) {
+		Chunk&	C = m_pChunks[ChunkIndex];
+		C.m_pRoot = m_pROOT->m_ppChildren[ChunkIndex];
+		C.m_NodesStart = C.m_pRoot->m_NodeIndex;
+		C.m_NodesCount = (ChunkIndex < m_ChunksCount-1 ? m_pROOT->m_ppChildren[ChunkIndex+1]->m_NodeIndex : m_NodesCount) - C.m_NodesStart;
+		C.m_GlobalBBoxMin = float3::MaxFlt;
+		C.m_GlobalBBoxMax = -float3::MaxFlt;
+		C.m_State = Chunk::EVICTED;
+
+		for ( int NodeIndex=C.m_NodesStart; NodeIndex < C.m_NodesStart+C.m_NodesCount; NodeIndex++ ) {
+			Node*	pNode = m_ppNodes[NodeIndex];
+			pNode->m_ChunkIndex = ChunkIndex;
+			if ( pNode->m_Type != Node::MESH )
+				continue;
+
+			const Mesh*	pMesh = (const Mesh*) pNode;
+			C.m_GlobalBBoxMin = C.m_GlobalBBoxMin.Min( pMesh->m_GlobalBBoxMin );
+			C.m_GlobalBBoxMax = C.m_GlobalBBoxMax.Max( pMesh->m_GlobalBBoxMax );
+		}
+	}
+}
+
+void	Scene::BuildTransformArrays() {
+	// Compute the depth of each node, parents come before their children in the flattened array
+	int*	pDepths = new int[m_NodesCount];
+	m_LevelsCount = 0;
+	for ( int NodeIndex=0; NodeIndex < m_NodesCount; NodeIndex++ ) {
+		int	ParentIndex = m_ppNodes[NodeIndex]->m_ParentIndex;
+		pDepths[NodeIndex] = ParentIndex >= 0 ? pDepths[ParentIndex] + 1 : 0;
+		m_LevelsCount = MAX( m_LevelsCount, pDepths[NodeIndex]+1 );
+	}
+
+	// Count the nodes of each level to get where each level starts
+	m_pLevelsStart = new int[m_LevelsCount+1];
+	memset( m_pLevelsStart, 0, (m_LevelsCount+1)*sizeof(int) );
+	for ( int NodeIndex=0; NodeIndex < m_NodesCount; NodeIndex++ )
+		m_pLevelsStart[pDepths[NodeIndex]+1]++;
+	for ( int LevelIndex=0; LevelIndex < m_LevelsCount; LevelIndex++ )
+		m_pLevelsStart[LevelIndex+1] += m_pLevelsStart[LevelIndex];
+
+	// Sort the nodes by level, keeping the depth-first order within a level so siblings stay contiguous
+	int*	pLevelsNext = new int[m_LevelsCount];
+	memcpy( pLevelsNext, m_pLevelsStart, m_LevelsCount*sizeof(int) );
+
+	m_pSlotNodes = new int[m_NodesCount];
+	m_pSlotParents = new int[m_NodesCount];
+	m_pLocal2Parent = new float4x4[m_NodesCount];
+	m_pLocal2World = new float4x4[m_NodesCount];
+	m_pDirty = new U8[m_NodesCount];
+	memset( m_pDirty, 0, m_NodesCount );
+	for ( int NodeIndex=0; NodeIndex < m_NodesCount; NodeIndex++ ) {
+		Node&	N = *m_ppNodes[NodeIndex];
+		int		SlotIndex = pLevelsNext[pDepths[NodeIndex]]++;
+		N.m_TransformSlot = SlotIndex;
+		m_pSlotNodes[SlotIndex] = NodeIndex;
+		m_pSlotParents[SlotIndex] = N.m_ParentIndex >= 0 ? m_ppNodes[N.m_ParentIndex]->m_TransformSlot : -1;	// Parents were given a slot first
+		m_pLocal2Parent[SlotIndex] = N.m_Local2Parent;
+		m_pLocal2World[SlotIndex] = N.m_Local2World;
+	}
+
+	delete[] pLevelsNext;
+	delete[] pDepths;
+}
+
+void	Scene::UpdateChunksBBox() {
+	m_GlobalBBoxMin = float3::MaxFlt;
+	m_GlobalBBoxMax = -float3::MaxFlt;
+	for ( int ChunkIndex=0; ChunkIndex < m_ChunksCount; ChunkIndex++ ) {
+		Chunk&	C = m_pChunks[ChunkIndex];
+		C.m_GlobalBBoxMin = float3::MaxFlt;
+		C.m_GlobalBBoxMax = -float3::MaxFlt;
+	}
+
+	for ( int MeshIndex=0; MeshIndex < m_MeshesCount; MeshIndex++ ) {
+		const Mesh&	M = *m_ppMeshes[MeshIndex];
+		m_GlobalBBoxMin = m_GlobalBBoxMin.Min( M.m_GlobalBBoxMin );
+		m_GlobalBBoxMax = m_GlobalBBoxMax.Max( M.m_GlobalBBoxMax );
+		if ( M.m_ChunkIndex < 0 )
+			continue;
+
+		Chunk&	C = m_pChunks[M.m_ChunkIndex];
+		C.m_GlobalBBoxMin = C.m_GlobalBBoxMin.Min( M.m_GlobalBBoxMin );
+		C.m_GlobalBBoxMax = C.m_GlobalBBoxMax.Max( M.m_GlobalBBoxMax );
+	}
+}
+
+namespace {
+	U32		HashBytes( U32 _Hash, const void* _pData, U32 _Size ) {
+		const U8*	pData = (const U8*) _pData;
+		for ( U32 i=0; i < _Size; i++ )
+			_Hash = (_Hash ^ pData[i]) * 16777619U;	// FNV-1a
+		return _Hash;
+	}
+
+	U32		GetVerticesSize( const Scene::Mesh::Primitive& _Primitive ) {
+		return _Primitive.m_VerticesCount * sizeof(Scene::Mesh::Primitive::VF_P3N3G3B3T2);
+	}
+	U32		GetFacesSize( const Scene::Mesh::Primitive& _Primitive ) {
+		return 3 * _Primitive.m_FacesCount * (_Primitive.m_IndexFormat == DXGI_FORMAT_R16_UINT ? sizeof(U16) : sizeof(U32));
+	}
+
+	U32		HashMaterial( U32 _Hash, const Scene::Material& _Material ) {
+		_Hash = HashBytes( _Hash, &_Material.m_ID, sizeof(U32) );
+		_Hash = HashBytes( _Hash, &_Material.m_DiffuseAlbedo, sizeof(float3) );
+		_Hash = HashBytes( _Hash, &_Material.m_TexDiffuseAlbedo.m_ID, sizeof(U32) );
+		_Hash = HashBytes( _Hash, &_Material.m_SpecularAlbedo, sizeof(float3) );
+		_Hash = HashBytes( _Hash, &_Material.m_TexSpecularAlbedo.m_ID, sizeof(U32) );
+		_Hash = HashBytes( _Hash, &_Material.m_SpecularExponent, sizeof(float3) );
+		_Hash = HashBytes( _Hash, &_Material.m_TexNormal.m_ID, sizeof(U32) );
+		_Hash = HashBytes( _Hash, &_Material.m_EmissiveColor, sizeof(float3) );
+		return _Hash;
+	}
+
+	bool	IsSameInstance( const Scene::Mesh::Primitive& _A, const Scene::Mesh::Primitive& _B ) {
+		return _A.m_pMaterial == _B.m_pMaterial
+			&& _A.m_VertexFormat == _B.m_VertexFormat
+			&& _A.m_VerticesCount == _B.m_VerticesCount
+			&& _A.m_FacesCount == _B.m_FacesCount
+			&& _A.m_IndexFormat == _B.m_IndexFormat
+			&& !memcmp( _A.m_pVertices, _B.m_pVertices, GetVerticesSize( _A ) )
+			&& !memcmp( _A.m_pFaces, _B.m_pFaces, GetFacesSize( _A ) );
+	}
+}
+
+// Groups the primitives sharing the same material & geometry (vertices are in local space so identical placed meshes have identical data)
+void	Scene::BuildInstanceGroups() {
+	m_InstancesCount = 0;
+	for ( int MeshIndex=0; MeshIndex < m_MeshesCount; MeshIndex++ )
+		m_InstancesCount += m_ppMeshes[MeshIndex]->m_PrimitivesCount;
+
+	m_ppInstances = new Mesh::Primitive*[m_InstancesCount];
+	m_pInstanceGroups = new InstanceGroup[m_InstancesCount];	// Worst case: no primitive is shared
+	m_InstanceGroupsCount = 0;
+
+	// Assign groups, a hash collision between different geometries simply yields a new group that isn't registered
+	Dictionary<int>	Hash2GroupIndex;
+	for ( int MeshIndex=0; MeshIndex < m_MeshesCount; MeshIndex++ ) {
+		Mesh&	M = *m_ppMeshes[MeshIndex];
+		for ( int PrimitiveIndex=0; PrimitiveIndex < M.m_PrimitivesCount; PrimitiveIndex++ ) {
+			Mesh::Primitive&	P = M.m_pPrimitives[PrimitiveIndex];
+
+			U32	Hash = 2166136261U;
+			Hash = HashBytes( Hash, &P.m_pMaterial->m_ID, sizeof(U32) );
+			Hash = HashBytes( Hash, &P.m_VerticesCount, sizeof(U32) );
+			Hash = HashBytes( Hash, &P.m_FacesCount, sizeof(U32) );
+			Hash = HashBytes( Hash, P.m_pVertices, GetVerticesSize( P ) );
+			Hash = HashBytes( Hash, P.m_pFaces, GetFacesSize( P ) );
+
+			int*	pGroupIndex = Hash2GroupIndex.Get( Hash );
+			if ( pGroupIndex != NULL && IsSameInstance( *m_pInstanceGroups[*pGroupIndex].m_pMaster, P ) ) {
+				P.m_InstanceGroupIndex = *pGroupIndex;
+				m_pInstanceGroups[*pGroupIndex].m_InstancesCount++;
+				continue;
+			}
+
+			InstanceGroup&	Group = m_pInstanceGroups[m_InstanceGroupsCount];
+			Group.m_pMaster = &P;
+			Group.m_InstancesStart = 0;
+			Group.m_InstancesCount = 1;
+			P.m_InstanceGroupIndex = m_InstanceGroupsCount;
+			if ( pGroupIndex == NULL )
+				Hash2GroupIndex.Add( Hash, m_InstanceGroupsCount );
+			m_InstanceGroupsCount++;
+		}
+	}
+
+	// Store the instances group after group
+	int	InstancesStart = 0;
+	for ( int GroupIndex=0; GroupIndex < m_InstanceGroupsCount; GroupIndex++ ) {
+		m_pInstanceGroups[GroupIndex].m_InstancesStart = InstancesStart;
+		InstancesStart += m_pInstanceGroups[GroupIndex].m_InstancesCount;
+		m_pInstanceGroups[GroupIndex].m_InstancesCount = 0;
+	}
+	for ( int MeshIndex=0; MeshIndex < m_MeshesCount; MeshIndex++ ) {
+		Mesh&	M = *m_ppMeshes[MeshIndex];
+		for ( int PrimitiveIndex=0; PrimitiveIndex < M.m_PrimitivesCount; PrimitiveIndex++ ) {
+			InstanceGroup&	Group = m_pInstanceGroups[M.m_pPrimitives[PrimitiveIndex].m_InstanceGroupIndex];
+			m_ppInstances[Group.m_InstancesStart + Group.m_InstancesCount++] = &M.m_pPrimitives[PrimitiveIndex];
+		}
+	}
+}
+
+void	Scene::ComputeContentHashes() {
+	for ( int MeshIndex=0; MeshIndex < m_MeshesCount; MeshIndex++ ) {
+		Mesh&	M = *m_ppMeshes[MeshIndex];
+
+		U32	Hash = 2166136261U;
+		Hash = HashBytes( Hash, &M.m_Local2World, sizeof(float4x4) );	// Moving a parent moves the mesh too
+		Hash = HashBytes( Hash, &M.m_PrimitivesCount, sizeof(int) );
+		for ( int PrimitiveIndex=0; PrimitiveIndex < M.m_PrimitivesCount; PrimitiveIndex++ ) {
+			const Mesh::Primitive&	P = M.m_pPrimitives[PrimitiveIndex];
+			Hash = HashMaterial( Hash, *P.m_pMaterial );
+			Hash = HashBytes( Hash, &P.m_VerticesCount, sizeof(U32) );
+			Hash = HashBytes( Hash, &P.m_FacesCount, sizeof(U32) );
+			Hash = HashBytes( Hash, &P.m_IndexFormat, sizeof(DXGI_FORMAT) );
+			Hash = HashBytes( Hash, P.m_pVertices, GetVerticesSize( P ) );
+			Hash = HashBytes( Hash, P.m_pFaces, GetFacesSize( P ) );
+		}
+		M.m_ContentHash = Hash;
+	}
+}
+
+int		Scene::DiffMeshes( const Scene& _Other, bool* _pChangedMeshes ) const {
+	if ( _Other.m_NodesCount != m_NodesCount || _Other.m_MeshesCount != m_MeshesCount || _Other.m_MaterialsCount != m_MaterialsCount )
+		return -1;
+
+	// The nodes are flattened in the same order if the hierarchy didn't change
+	for ( int NodeIndex=0; NodeIndex < m_NodesCount; NodeIndex++ ) {
+		const Node&	N = *m_ppNodes[NodeIndex];
+		const Node&	O = *_Other.m_ppNodes[NodeIndex];
+		if ( O.m_Type != N.m_Type || O.m_ParentIndex != N.m_ParentIndex )
+			return -1;
+	}
+
+	// Renderers map the textures by ID
+	for ( int MaterialIndex=0; MaterialIndex < m_MaterialsCount; MaterialIndex++ ) {
+		const Material&	M = *m_ppMaterials[MaterialIndex];
+		const Material&	O = *_Other.m_ppMaterials[MaterialIndex];
+		if (	O.m_ID != M.m_ID
+			||	O.m_TexDiffuseAlbedo.m_ID != M.m_TexDiffuseAlbedo.m_ID
+			||	O.m_TexSpecularAlbedo.m_ID != M.m_TexSpecularAlbedo.m_ID
+			||	O.m_TexNormal.m_ID != M.m_TexNormal.m_ID )
+			return -1;
+	}
+
+	int	ChangedMeshesCount = 0;
+	for ( int MeshIndex=0; MeshIndex < m_MeshesCount; MeshIndex++ ) {
+		_pChangedMeshes[MeshIndex] = _Other.m_ppMeshes[MeshIndex]->m_ContentHash != m_ppMeshes[MeshIndex]->m_ContentHash;
+		if ( _pChangedMeshes[MeshIndex] )
+			ChangedMeshesCount++;
+	}
+
+	return ChangedMeshesCount;
+}
+
+void	Scene::ReplaceMeshes( Scene& _Other, const bool* _pChangedMeshes, int _LODsCount ) {
+	ASSERT( _Other.m_NodesCount == m_NodesCount && _Other.m_MeshesCount == m_MeshesCount && _Other.m_MaterialsCount == m_MaterialsCount, "Not a version of the same scene!" );
+
+	// Our instances can't keep sharing the LODs of a master that leaves, give them their own copy
+	for ( int GroupIndex=0; GroupIndex < m_InstanceGroupsCount; GroupIndex++ ) {
+		const InstanceGroup&	Group = m_pInstanceGroups[GroupIndex];
+		const Mesh::Primitive&	Master = *Group.m_pMaster;
+		if ( !_pChangedMeshes[Master.m_pOwner->m_MeshIndex] || Master.m_pLODFaces == NULL )
+			continue;
+
+		for ( int InstanceIndex=Group.m_InstancesStart; InstanceIndex < Group.m_InstancesStart+Group.m_InstancesCount; InstanceIndex++ ) {
+			Mesh::Primitive&	Instance = *m_ppInstances[InstanceIndex];
+			if ( _pChangedMeshes[Instance.m_pOwner->m_MeshIndex] || Instance.m_pLODFaces != Master.m_pLODFaces )
+				continue;
+
+			U32	Size = 3 * (Instance.m_pLODFacesStart[Instance.m_LODsCount-1] + Instance.m_pLODFacesCount[Instance.m_LODsCount-1]) * (Instance.m_IndexFormat == DXGI_FORMAT_R16_UINT ? sizeof(U16) : sizeof(U32));
+			U8*	pLODFaces = new U8[Size];
+			memcpy( pLODFaces, Instance.m_pLODFaces, Size );
+			Instance.m_pLODFaces = pLODFaces;
+			Instance.m_bOwnsLODFaces = true;
+		}
+	}
+
+	// Exchange the primitives of the changed meshes
+	for ( int MeshIndex=0; MeshIndex < m_MeshesCount; MeshIndex++ ) {
+		if ( !_pChangedMeshes[MeshIndex] )
+			continue;
+
+		Mesh&	M = *m_ppMeshes[MeshIndex];
+		Mesh&	O = *_Other.m_ppMeshes[MeshIndex];
+		Swap( M.m_pPrimitives, O.m_pPrimitives );
+		Swap( M.m_PrimitivesCount, O.m_PrimitivesCount );
+		Swap( M.m_LocalBBoxMin, O.m_LocalBBoxMin );
+		Swap( M.m_LocalBBoxMax, O.m_LocalBBoxMax );
+		Swap( M.m_ContentHash, O.m_ContentHash );
+
+		for ( int PrimitiveIndex=0; PrimitiveIndex < M.m_PrimitivesCount; PrimitiveIndex++ ) {
+			Mesh::Primitive&	P = M.m_pPrimitives[PrimitiveIndex];
+			P.m_pOwner = &M;
+
+			int	MaterialIndex = 0;
+			while ( _Other.m_ppMaterials[MaterialIndex] != P.m_pMaterial )
+				MaterialIndex++;
+			P.m_pMaterial = m_ppMaterials[MaterialIndex];
+
+			if ( PrimitiveIndex < O.m_PrimitivesCount ) {
+				P.m_pTag = O.m_pPrimitives[PrimitiveIndex].m_pTag;
+				O.m_pPrimitives[PrimitiveIndex].m_pTag = NULL;
+			}
+
+			P.BuildLODs( _LODsCount );
+		}
+		M.UpdateGlobalBBox();
+	}
+
+	// Move the nodes that moved
+	for ( int NodeIndex=0; NodeIndex < m_NodesCount; NodeIndex++ ) {
+		Node&		N = *m_ppNodes[NodeIndex];
+		const Node&	O = *_Other.m_ppNodes[NodeIndex];
+		if ( memcmp( &N.m_Local2Parent, &O.m_Local2Parent, sizeof(float4x4) ) )
+			SetLocal2Parent( N, O.m_Local2Parent );
+	}
+	UpdateTransforms();
+
+	// Take the new material properties, the textures are the same (cf. DiffMeshes())
+	for ( int MaterialIndex=0; MaterialIndex < m_MaterialsCount; MaterialIndex++ ) {
+		Material&		M = *m_ppMaterials[MaterialIndex];
+		const Material&	O = *_Other.m_ppMaterials[MaterialIndex];
+		M.m_DiffuseAlbedo = O.m_DiffuseAlbedo;
+		M.m_SpecularAlbedo = O.m_SpecularAlbedo;
+		M.m_SpecularExponent = O.m_SpecularExponent;
+		M.m_EmissiveColor = O.m_EmissiveColor;
+	}
+
+	// Identical primitives may have appeared or disappeared
+	delete[] m_ppInstances;
+	delete[] m_pInstanceGroups;
+	BuildInstanceGroups();
+
+	UpdateChunksBBox();
+}
+
+void	Scene::BuildLODs( int _LODsCount ) {
+	if ( _LODsCount <= 1 )
+		return;
+
+	// Instances share their geometry so only the group masters are simplified
+	for ( int GroupIndex=0; GroupIndex < m_InstanceGroupsCount; GroupIndex++ ) {
+		const InstanceGroup&	Group = m_pInstanceGroups[GroupIndex];
+		Mesh::Primitive&		Master = *Group.m_pMaster;
+		Master.BuildLODs( _LODsCount );
+
+		for ( int InstanceIndex=Group.m_InstancesStart; InstanceIndex < Group.m_InstancesStart+Group.m_InstancesCount; InstanceIndex++ ) {
+			Mesh::Primitive&	Instance = *m_ppInstances[InstanceIndex];
+			if ( &Instance == &Master )
+				continue;
+
+			Instance.m_LODsCount = Master.m_LODsCount;
+			memcpy( Instance.m_pLODFacesStart, Master.m_pLODFacesStart, sizeof(Master.m_pLODFacesStart) );
+			memcpy( Instance.m_pLODFacesCount, Master.m_pLODFacesCount, sizeof(Master.m_pLODFacesCount) );
+			Instance.m_pLODFaces = Master.m_pLODFaces;	// Owned by the master
+		}
+	}
+}
+
 U32	Scene::ReadU16( const U8*& _pData, bool _IsID )
 {
 	U32		Result = *((U16*) _pData);
@@ -217,6 +719,14 @@ void Scene::ReadEndNodeMarker( const U8*& _pData )
 	U16		EndMarker = ReadU16( _pData );
 	ASSERT( EndMarker == 0xABCD, "Failed to reach end node marker!" );
 }
+const U8*	Scene::AlignPayload( const U8* _pData ) const
+{
+	if ( m_Version != GCX2 )
+		return _pData;	// GCX1 payloads are packed
+
+	U32		Offset = U32( _pData - m_pSceneData );
+	return m_pSceneData + ((Offset + 15) & ~15U);
+}
 
 
 //////////////////////////////////////////////////////////////////////////
@@ -224,10 +734,14 @@ void Scene::ReadEndNodeMarker( const U8*& _pData )
 Scene::Node::Node( Scene& _Owner, Node* _pParent )
 	: m_Owner( _Owner )
 	, m_pParent( _pParent )
+	, m_NodeIndex( -1 )
+	, m_ParentIndex( -1 )
+	, m_ChunkIndex( -1 )
+	, m_TransformSlot( -1 )
+	, m_TypeIndex( -1 )
 	, m_ChildrenCount( 0 )
 	, m_ppChildren( NULL )
-	, m_pTag( NULL )
-	, m_ChildIndex( -1 ) {
+	, m_pTag( NULL ) {
 	m_Owner.m_NodesCount++;
 }
 Scene::Node::~Node()
@@ -282,21 +796,7 @@ void	Scene::Node::PlaceTag( ISceneTagger& _SceneTagger ) {
 
 	// Tag children
 	for ( int ChildIndex=0; ChildIndex < m_ChildrenCount; ChildIndex++ ) {
-		Node&	Child = *m_ppChildren[ChildIndex];
-		Child.m_ChildIndex = ChildIndex;
-		Child.PlaceTag( _SceneTagger );
-	}
-}
-
-void	Scene::Node::SetChildIndex() {
-	if ( m_pParent == NULL )
-		m_ChildIndex = 0;	// Root...
-
-	for ( int ChildIndex=0; ChildIndex < m_ChildrenCount; ChildIndex++ )
-	{
-		Node&	Child = *m_ppChildren[ChildIndex];
-		Child.m_ChildIndex = ChildIndex;
-		Child.SetChildIndex();
+		m_ppChildren[ChildIndex]->PlaceTag( _SceneTagger );
 	}
 }
 
@@ -335,6 +835,8 @@ void	Scene::Camera::InitSpecific( const U8*& _pData ) {
 // ==== Mesh ====
 Scene::Mesh::Mesh( Scene& _Owner, Node* _pParent )
 	: Node( _Owner, _pParent )
+	, m_MeshIndex( -1 )
+	, m_ContentHash( 0 )
 	, m_PrimitivesCount( 0 )
 	, m_pPrimitives( NULL ) {
 	m_Owner.m_MeshesCount++;
@@ -365,6 +867,17 @@ void	Scene::Mesh::InitSpecific( const U8*& _pData ) {
 	}
 }
 
+void	Scene::Mesh::UpdateGlobalBBox() {
+	m_GlobalBBoxMin = float3::MaxFlt;
+	m_GlobalBBoxMax = -float3::MaxFlt;
+	for ( int PrimitiveIndex=0; PrimitiveIndex < m_PrimitivesCount; PrimitiveIndex++ ) {
+		Primitive&	P = m_pPrimitives[PrimitiveIndex];
+		P.UpdateGlobalBBox();
+		m_GlobalBBoxMin = m_GlobalBBoxMin.Min( P.m_GlobalBBoxMin );
+		m_GlobalBBoxMax = m_GlobalBBoxMax.Max( P.m_GlobalBBoxMax );
+	}
+}
+
 void	Scene::Mesh::PlaceTagSpecific( ISceneTagger& _SceneTagger ) {
 	for ( int PrimitiveIndex=0; PrimitiveIndex < m_PrimitivesCount; PrimitiveIndex++ ) {
 		Primitive&	P = m_pPrimitives[PrimitiveIndex];
@@ -376,15 +889,29 @@ Scene::Mesh::Primitive::Primitive()
 	: m_pMaterial( NULL )
 	, m_FacesCount( 0 )
 	, m_pFaces( NULL )
+	, m_IndexFormat( DXGI_FORMAT_R32_UINT )
 	, m_VerticesCount( 0 )
-	, m_pVertices( NULL ) {
+	, m_pVertices( NULL )
+	, m_LODsCount( 1 )
+	, m_pLODFaces( NULL )
+	, m_pOwner( NULL )
+	, m_InstanceGroupIndex( -1 )
+	, m_pTag( NULL )
+	, m_bOwnsBuffers( false )
+	, m_bOwnsLODFaces( false ) {
 }
 Scene::Mesh::Primitive::~Primitive() {
-	delete[] m_pFaces;
-	delete[] m_pVertices;
+	if ( m_bOwnsLODFaces )
+		delete[] (U8*) m_pLODFaces;
+	if ( m_bOwnsBuffers ) {
+		delete[] (U8*) m_pFaces;
+		delete[] (U8*) m_pVertices;
+	}
 }
 
 void	Scene::Mesh::Primitive::Init( Mesh& _Owner, const U8*& _pData ) {
+	m_pOwner = &_Owner;
+
 	int	MaterialID = ReadU16( _pData, true );
 	ASSERT( MaterialID < _Owner.m_Owner.m_MaterialsCount, "Material ID out of range!" );
 	m_pMaterial = _Owner.m_Owner.m_ppMaterials[MaterialID];
@@ -400,23 +927,22 @@ void	Scene::Mesh::Primitive::Init( Mesh& _Owner, const U8*& _pData ) {
 	m_LocalBBoxMax.y = ReadF32( _pData );
 	m_LocalBBoxMax.z = ReadF32( _pData );
 
+	// GCX2 payloads are aligned so we can point straight into the scene data, GCX1 payloads are copied
+	const Scene&	Owner = _Owner.m_Owner;
+	m_bOwnsBuffers = Owner.m_Version != GCX2;
+
 	// Read indices
-	m_pFaces = new U32[3*m_FacesCount];
-	if ( m_VerticesCount <= 65536 )
-	{
-		for ( U32 FaceIndex=0; FaceIndex < m_FacesCount; FaceIndex++ )
-		{
-			m_pFaces[3*FaceIndex+0] = ReadU16( _pData );
-			m_pFaces[3*FaceIndex+1] = ReadU16( _pData );
-			m_pFaces[3*FaceIndex+2] = ReadU16( _pData );
-		}
-	}
-	else
-	{
-		int	IndexBufferSize = 3*m_FacesCount*sizeof(U32);
-		memcpy( m_pFaces, _pData, IndexBufferSize );
-		_pData += IndexBufferSize;
+	m_IndexFormat = m_VerticesCount <= 65536 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+	int		IndexBufferSize = 3*m_FacesCount * (m_IndexFormat == DXGI_FORMAT_R16_UINT ? sizeof(U16) : sizeof(U32));
+	_pData = Owner.AlignPayload( _pData );
+	if ( m_bOwnsBuffers ) {
+		U8*	pFaces = new U8[IndexBufferSize];
+		memcpy( pFaces, _pData, IndexBufferSize );
+		m_pFaces = pFaces;
+	} else {
+		m_pFaces = _pData;
 	}
+	_pData += IndexBufferSize;
 
 	// Read vertices
 	m_VertexFormat = (VERTEX_FORMAT) *_pData++;
@@ -427,20 +953,94 @@ void	Scene::Mesh::Primitive::Init( Mesh& _Owner, const U8*& _pData ) {
 	}
 
 	int		VertexBufferSize = m_VerticesCount * VertexSize;
-	m_pVertices = new U8[VertexBufferSize];
-	memcpy( m_pVertices, _pData, VertexBufferSize );
+	_pData = Owner.AlignPayload( _pData );
+	if ( m_bOwnsBuffers ) {
+		U8*	pVertices = new U8[VertexBufferSize];
+		memcpy( pVertices, _pData, VertexBufferSize );
+		m_pVertices = pVertices;
+	} else {
+		m_pVertices = _pData;
+	}
 	_pData += VertexBufferSize;
 
 	// Compute global bounding box
 	m_GlobalBBoxMin = float3::MaxFlt;
 	m_GlobalBBoxMax = -float3::MaxFlt;
-	for ( U32 VertexIndex=0; VertexIndex < m_VerticesCount; VertexIndex++ )
-	{
-		float3	LocalPosition = *((float3*) ((U8*) m_pVertices + VertexIndex * VertexSize));
-		float3	WorldPosition = float4( LocalPosition, 1 ) * _Owner.m_Local2World;
-		m_GlobalBBoxMin = m_GlobalBBoxMin.Min( WorldPosition );
-		m_GlobalBBoxMax = m_GlobalBBoxMax.Max( WorldPosition );
+	_Owner.m_Local2World.TransformBBox( (const float3*) m_pVertices, m_VerticesCount, m_GlobalBBoxMin, m_GlobalBBoxMax, VertexSize );
+
+	m_pLODFacesStart[0] = 0;
+	m_pLODFacesCount[0] = m_FacesCount;
+}
+
+// Each LOD targets half the faces of the previous one with an error budget growing with the LOD, we stop as soon as simplification stalls
+void	Scene::Mesh::Primitive::BuildLODs( int _LODsCount ) {
+	static const U32	MIN_FACES_COUNT = 64;	// Smaller primitives are not worth simplifying
+
+	_LODsCount = MIN( _LODsCount, int(MAX_LODS) );
+	if ( m_FacesCount < MIN_FACES_COUNT )
+		return;
+
+	// Each LOD has fewer faces than LOD 0 so that's enough room for all of them
+	U32*	pFaces = new U32[3*m_FacesCount*_LODsCount];
+	for ( U32 i=0; i < 3*m_FacesCount; i++ )
+		pFaces[i] = GetIndex( i );
+
+	float	Size = (m_LocalBBoxMax - m_LocalBBoxMin).Length();
+	float	MaxError = 0.01f * Size;
+	for ( int LODIndex=1; LODIndex < _LODsCount; LODIndex++, MaxError *= 2.0f ) {
+		U32	PreviousStart = m_pLODFacesStart[LODIndex-1];
+		U32	PreviousCount = m_pLODFacesCount[LODIndex-1];
+		U32	Start = PreviousStart + PreviousCount;
+		U32	Count = MeshSimplifier::Simplify( m_VerticesCount, &((const VF_P3N3G3B3T2*) m_pVertices)->P, sizeof(VF_P3N3G3B3T2), PreviousCount, pFaces + 3*PreviousStart, PreviousCount / 2, MaxError*MaxError, pFaces + 3*Start );
+		if ( Count == 0 || Count > 9 * PreviousCount / 10 )
+			break;	// Not worth it
+
+		m_pLODFacesStart[LODIndex] = Start;
+		m_pLODFacesCount[LODIndex] = Count;
+		m_LODsCount = LODIndex+1;
+	}
+
+	if ( m_LODsCount > 1 ) {
+		// Store all the LODs in the primitive's index format
+		U32		IndicesCount = 3 * (m_pLODFacesStart[m_LODsCount-1] + m_pLODFacesCount[m_LODsCount-1]);
+		if ( m_IndexFormat == DXGI_FORMAT_R16_UINT ) {
+			U16*	pLODFaces = new U16[IndicesCount];
+			for ( U32 i=0; i < IndicesCount; i++ )
+				pLODFaces[i] = U16( pFaces[i] );
+			m_pLODFaces = pLODFaces;
+		} else {
+			U32*	pLODFaces = new U32[IndicesCount];
+			memcpy( pLODFaces, pFaces, IndicesCount*sizeof(U32) );
+			m_pLODFaces = pLODFaces;
+		}
+		m_bOwnsLODFaces = true;
+	}
+
+	delete[] pFaces;
+}
+
+void	Scene::Mesh::Primitive::UpdateGlobalBBox() {
+	float3	pCorners[8];
+	for ( int CornerIndex=0; CornerIndex < 8; CornerIndex++ )
+		pCorners[CornerIndex].Set(	(CornerIndex & 1) ? m_LocalBBoxMax.x : m_LocalBBoxMin.x,
+									(CornerIndex & 2) ? m_LocalBBoxMax.y : m_LocalBBoxMin.y,
+									(CornerIndex & 4) ? m_LocalBBoxMax.z : m_LocalBBoxMin.z );
+
+	m_GlobalBBoxMin = float3::MaxFlt;
+	m_GlobalBBoxMax = -float3::MaxFlt;
+	m_pOwner->m_Local2World.TransformBBox( pCorners, 8, m_GlobalBBoxMin, m_GlobalBBoxMax );
+}
+
+int		Scene::Mesh::Primitive::SelectLOD( float _ProjectedSize ) const {
+	static const float	FULL_DETAIL_SIZE = 256.0f;	// Primitives covering more pixels use LOD 0, each halving of the size selects the next LOD
+
+	int		LODIndex = 0;
+	float	Size = FULL_DETAIL_SIZE;
+	while ( LODIndex < m_LODsCount-1 && _ProjectedSize < Size ) {
+		LODIndex++;
+		Size *= 0.5f;
 	}
+	return LODIndex;
 }
 
 
@@ -1,12 +1,31 @@
 //////////////////////////////////////////////////////////////////////////
 // Loads a binary GCX scene generated by the FBXTestConverter tool
 //
+// Two versions of the format are supported:
+//	_ GCX1, where the index & vertex payloads of the primitives are copied out of the scene data
+//	_ GCX2, the same layout except the index & vertex payloads start at 16 bytes aligned offsets from the beginning of the scene data
+//		so the primitives point straight into the (resource-locked) scene data and no copy is made.
+// In both cases, primitives with at most 65536 vertices keep their indices as U16.
+//
+// Each subtree of the root node is a chunk with its own world bounds that can be tagged & untagged independently
+//	so large scenes can be streamed in & out (cf. SceneStreamer). Meshes of chunks that are not resident are not rendered.
+//
+// The transform hierarchy is also flattened at load time into arrays of matrices sorted by depth, so moving nodes with
+//	SetLocal2Parent() then calling UpdateTransforms() once per frame recomputes the world transforms level after level,
+//	each level in parallel, without walking the node objects. Static subtrees are skipped thanks to per-node dirty flags.
+//
+// Each mesh also gets a hash of its content at load time so an edited version of the same scene can be compared mesh by mesh
+//	(cf. DiffMeshes()) and only the meshes that changed are taken from it (cf. ReplaceMeshes()), e.g. to hot reload a scene file.
+//
 #pragma once
 
 class	Scene
 {
 protected:	// CONSTANTS
 
+	static const U32	GCX1 = 0x31584347;	// "GCX1"
+	static const U32	GCX2 = 0x32584347;	// "GCX2"
+
 public:		// NESTED TYPES
 
 	class ISceneTagger;
@@ -27,6 +46,11 @@ public:		// NESTED TYPES
 			PROBE,
 		}					m_Type;
 		Node*				m_pParent;
+		int					m_NodeIndex;		// Index of the node in the scene's flattened nodes array
+		int					m_ParentIndex;		// Index of the parent node in the flattened nodes array (-1 for the root)
+		int					m_ChunkIndex;		// Index of the chunk the node belongs to (-1 for the root)
+		int					m_TransformSlot;	// Index of the node in the scene's depth-sorted transform arrays
+		int					m_TypeIndex;		// Index of the node in the scene's array of its type (e.g. m_ppLights for a light, -1 for generic nodes)
 		int					m_ChildrenCount;
 		Node**				m_ppChildren;
 		float4x4			m_Local2Parent;
@@ -34,10 +58,6 @@ public:		// NESTED TYPES
 
 		void*				m_pTag;	// Custom user tag filled with anything the user needs to render the node
 
-	private:
-		int					m_ChildIndex;		// Set at the beginning of a ForEach loop
-		void				SetChildIndex();
-
 	private:
 		Node( Scene& _Owner, Node* _pParent );
 		~Node();
@@ -110,7 +130,8 @@ public:		// NESTED TYPES
 			float3				m_GlobalBBoxMax;
 
 			U32					m_FacesCount;
-			U32*				m_pFaces;
+			const void*			m_pFaces;		// 3 indices per face, either U16 or U32 (cf. m_IndexFormat)
+			DXGI_FORMAT			m_IndexFormat;	// DXGI_FORMAT_R16_UINT or DXGI_FORMAT_R32_UINT
 
 			enum	VERTEX_FORMAT
 			{
@@ -118,7 +139,17 @@ public:		// NESTED TYPES
 
 			}					m_VertexFormat;
 			U32					m_VerticesCount;
-			void*				m_pVertices;
+			const void*			m_pVertices;
+
+			// Levels of detail sharing the primitive's vertices, LOD 0 is the full resolution primitive and each LOD has about half the faces of the previous one
+			static const int	MAX_LODS = 4;
+			int					m_LODsCount;
+			U32					m_pLODFacesStart[MAX_LODS];	// Index of each LOD's first face in m_pLODFaces
+			U32					m_pLODFacesCount[MAX_LODS];
+			const void*			m_pLODFaces;				// Faces of all the LODs one after another in m_IndexFormat, starting with LOD 0 (NULL if the primitive has a single LOD)
+
+			Mesh*				m_pOwner;
+			int					m_InstanceGroupIndex;	// Index of the group of primitives sharing the same geometry & material (cf. Scene::m_pInstanceGroups)
 
 			void*				m_pTag;	// Custom user tag filled with anything the user needs to render the node
 
@@ -130,17 +161,33 @@ public:		// NESTED TYPES
 				float2	T;
 			};
 
+			// Returns the index of a face's vertex, whatever the index format
+			U32				GetIndex( U32 _Index ) const	{ return m_IndexFormat == DXGI_FORMAT_R16_UINT ? U32( ((const U16*) m_pFaces)[_Index] ) : ((const U32*) m_pFaces)[_Index]; }
+
+			// Returns the LOD to use for a primitive covering _ProjectedSize pixels in a view (e.g. the projected diameter of its bounding sphere)
+			int				SelectLOD( float _ProjectedSize ) const;
+
+			// Recomputes the global bounding box from the local one once the owner moved (conservative, the vertices are not transformed again)
+			void			UpdateGlobalBBox();
+
 		private:
+			bool				m_bOwnsBuffers;	// True if faces & vertices were copied out of the scene data (GCX1)
+			bool				m_bOwnsLODFaces;	// False for instances that share the LODs of their group's master
+
 			Primitive();
 			~Primitive();
 
 			void			Init( Mesh& _Owner, const U8*& _pData );
+			void			BuildLODs( int _LODsCount );
 
 			friend class Mesh;
+			friend class ::Scene;
 		};
 
 	public:	// FIELDS
 
+		int					m_MeshIndex;		// Index of the mesh in the scene's flattened meshes array
+		U32					m_ContentHash;		// Hash of the world transform, geometry & materials of the primitives (cf. DiffMeshes())
 		int					m_PrimitivesCount;
 		Primitive*			m_pPrimitives;
 
@@ -149,6 +196,11 @@ public:		// NESTED TYPES
 		float3				m_GlobalBBoxMin;
 		float3				m_GlobalBBoxMax;
 
+	public:	// METHODS
+
+		// Recomputes the global bounding boxes of the mesh & its primitives once it moved
+		void			UpdateGlobalBBox();
+
 	private:
 
 		Mesh( Scene& _Owner, Node* _pParent );
@@ -240,6 +292,34 @@ public:		// NESTED TYPES
 		virtual void	RenderMesh( const Scene::Mesh& _Mesh, ::Shader* _pMaterialOverride, bool _SetMaterial=true ) abstract;
 	};
 
+	// A subtree of the root node whose nodes are contiguous in the flattened nodes array
+	class	Chunk
+	{
+	public:
+		enum	STATE {
+			EVICTED,		// Not tagged
+			PREPARING,		// Being prepared by a worker thread (cf. SceneStreamer)
+			RESIDENT,		// Tagged and rendered
+		};
+
+		Node*				m_pRoot;
+		int					m_NodesStart;		// Index of the chunk's root in the flattened nodes array
+		int					m_NodesCount;
+		float3				m_GlobalBBoxMin;	// World bounds of the chunk's meshes (empty if it has no mesh)
+		float3				m_GlobalBBoxMax;
+		volatile STATE		m_State;
+	};
+
+	// Primitives with the same material and identical geometry (e.g. placed copies of the same prop) are grouped at load time
+	//	so a renderer can create a single vertex & index buffer per group and draw all its placements with one instanced call
+	class	InstanceGroup
+	{
+	public:
+		Mesh::Primitive*	m_pMaster;			// First primitive of the group, whose geometry stands for all the instances
+		int					m_InstancesStart;	// Index of the group's first primitive in the scene's instances array
+		int					m_InstancesCount;
+	};
+
 	// Use a visitor class to browse the scene nodes
 	class	IVisitor
 	{
@@ -256,11 +336,49 @@ public:		// FIELDS
 	int					m_ProbesCount;
 	Node*				m_pROOT;
 
+	// Flattened nodes, built once at load time so browsing the scene is a simple loop
+	// The index of a node in the array of its type (cf. Node::m_TypeIndex) never changes so it can be used as an ID in GPU buffers
+	Node**				m_ppNodes;			// All the nodes in depth-first order (a parent always comes before its children)
+	Mesh**				m_ppMeshes;			// Nodes of each type, in the same order
+	Light**				m_ppLights;
+	Camera**			m_ppCameras;
+	Probe**				m_ppProbes;
+
+	float3				m_GlobalBBoxMin;	// World bounds of all the meshes
+	float3				m_GlobalBBoxMax;
+
+	int					m_ChunksCount;		// One chunk per child of the root node
+	Chunk*				m_pChunks;
+
+	int					m_InstanceGroupsCount;
+	InstanceGroup*		m_pInstanceGroups;
+	int					m_InstancesCount;	// Total amount of mesh primitives
+	Mesh::Primitive**	m_ppInstances;		// The primitives of all the groups, group after group, in the order of m_ppMeshes within a group
+
 	int					m_MaterialsCount;
 	Material**			m_ppMaterials;
 
 	const ISceneTagger*	m_pSceneTagger;
 
+private:
+
+	// Transform hierarchy, sorted by depth (i.e. the root, then its children, then their children, etc.)
+	// A slot's parent always lies in the previous level so all the slots of a level can be transformed in parallel
+	int					m_LevelsCount;
+	int*				m_pLevelsStart;		// Index of the first slot of each level, followed by the total amount of slots
+	int*				m_pSlotNodes;		// Index in m_ppNodes of the node in each slot
+	int*				m_pSlotParents;		// Slot of each slot's parent (-1 for the root)
+	float4x4*			m_pLocal2Parent;	// Transforms of each slot
+	float4x4*			m_pLocal2World;
+	U8*					m_pDirty;			// Non-zero if the slot's world transform must be recomputed
+	bool				m_bTransformsDirty;	// True if any slot is dirty
+
+	class	TransformsKernel;
+	friend class TransformsKernel;
+
+	const U8*			m_pSceneData;		// The scene data being loaded (primitives of GCX2 scenes keep pointing into it)
+	U32					m_Version;
+
 
 public:		// METHODS
 
@@ -268,30 +386,62 @@ public:		// METHODS
 	~Scene();	// WARNING: Call "ClearTags" to dispose of your tags prior destruction!
 
 
-	void			Load( U16 _SceneResourceID );
-	void			PlaceTags( ISceneTagger& _SceneTagger );
+	// Loads the scene, primitives get up to _LODsCount levels of detail (simplifying large scenes takes a while!)
+	void			Load( U16 _SceneResourceID, int _LODsCount=1 );
+	void			Load( const U8* _pSceneData, U32 _SceneSize, int _LODsCount=1 );	// The data must stay valid as long as the scene (GCX2 primitives point into it)
+	static bool		IsSceneData( const U8* _pSceneData, U32 _SceneSize );				// Checks the header of scene data (e.g. a file that is still being written)
+	void			PlaceTags( ISceneTagger& _SceneTagger );				// Tags the materials and all the nodes, every chunk becomes resident
+	void			PlaceMaterialTags( ISceneTagger& _SceneTagger );		// Tags the materials and the root node only, chunks are left to the caller
+	void			PlaceTags( ISceneTagger& _SceneTagger, Chunk& _Chunk );	// Tags (or untags, depending on the tagger) the nodes of a single chunk
+	void			PlaceTags( ISceneTagger& _SceneTagger, Mesh& _Mesh );	// Tags (or untags) a single mesh and its primitives, not its children
 	void			Render( ISceneRenderer& _SceneRenderer, bool _SetMaterial=true ) const;
 	void			Exit();
 
-	// Prefer using that routine that iterates on all nodes, select the node type yourself, rather than the other ForEach method below
+	// Moves a node relative to its parent, its world transform and the ones of its subtree are updated by the next UpdateTransforms()
+	void			SetLocal2Parent( Node& _Node, const float4x4& _Local2Parent );
+
+	// Recomputes the world transforms (and bounds) of the nodes that moved and of their children, returns the amount of updated nodes
+	// NOTE: The world bounds of the chunks and the scene are recomputed too if any mesh moved
+	int				UpdateTransforms();
+
+	// Compares the meshes with the ones of another version of the same scene (e.g. reloaded after an edit) by their content hash
+	//	_pChangedMeshes, receives true for each of our meshes whose transform, geometry or materials differ
+	// Returns the amount of changed meshes, or -1 if the node hierarchy or the material textures differ and the meshes can't be matched
+	int				DiffMeshes( const Scene& _Other, bool* _pChangedMeshes ) const;
+
+	// Takes the primitives of the changed meshes (cf. DiffMeshes()), the transforms and the material properties from another version of the scene
+	//	_Other, gets our old primitives in exchange and can be destroyed but its scene data must stay valid as long as this scene
+	//	_LODsCount, levels of detail to build for the new primitives only (so load the other scene with a single LOD)
+	// The new primitives inherit the tags of the ones they replace so the tagger can update them in place when tagging the mesh again,
+	//	untag the changed meshes first if they don't have the same primitives anymore
+	void			ReplaceMeshes( Scene& _Other, const bool* _pChangedMeshes, int _LODsCount=1 );
+
+	// Visits all the nodes in depth-first order
 	void			ForEach( IVisitor& _Visitor );
 
-	// !WARNING! I don't know how to write a proper depth-first search, this routine is SLOW AS HELL!!
-	// Iterates over all the nodes of specific type
+	// Iterates over all the nodes of a specific type, in depth-first order
 	//	_pPrevious, should be NULL for the first call to trigger a new search
-	__declspec(deprecated) Node*	ForEach( Node::TYPE _Type, Node* _pPrevious, int _StartAtChild=0 );
+	// NOTE: Prefer looping over the typed arrays (cf. GetNodes()), generic nodes have no array so each step scans the nodes
+	Node*			ForEach( Node::TYPE _Type, Node* _pPrevious );
 
-private:
+	// Returns the array of the nodes of a given type (NULL for generic nodes)
+	Node**			GetNodes( Node::TYPE _Type, int& _Count ) const;
 
-	void			Render( const Node* _pNode, ISceneRenderer& _SceneRenderer, bool _SetTextures ) const;
-
-	void			ForEach( IVisitor& _Visitor, Node* _pParent );
+private:
 
 	// Helpers
 	Node*			CreateNode( Node* _pParent, const U8*& _pData );
+	int				FlattenNode( Node* _pNode, int _ParentIndex, int _NodeIndex );
+	void			BuildNodeArrays();
+	void			BuildTransformArrays();
+	void			UpdateChunksBBox();
+	void			BuildInstanceGroups();
+	void			BuildLODs( int _LODsCount );
+	void			ComputeContentHashes();
 	static U32		ReadU16( const U8*& _pData, bool _IsID=false );
 	static U32		ReadU32( const U8*& _pData );
 	static float	ReadF32( const U8*& _pData );
 	static void		ReadEndMaterialMarker( const U8*& _pData );
 	static void		ReadEndNodeMarker( const U8*& _pData );
+	const U8*		AlignPayload( const U8* _pData ) const;
 };
@@ -0,0 +1,95 @@
+#include "../GodComplex.h"
+#include "SceneStreamer.h"
+
+SceneStreamer::SceneStreamer( Scene& _Scene, IChunkLoader& _Loader, JobQueue& _Jobs, float _LoadDistance, float _EvictDistance )
+	: m_Scene( _Scene )
+	, m_Loader( _Loader )
+	, m_Jobs( _Jobs )
+	, m_PreparingCount( 0 )
+	, m_LoadDistance( _LoadDistance )
+	, m_EvictDistance( MAX( _LoadDistance, _EvictDistance ) )
+	, m_MaxLoadsPerFrame( DEFAULT_MAX_LOADS_PER_FRAME ) {
+	m_pJobs = new PrepareJob[m_Scene.m_ChunksCount];
+	for ( int ChunkIndex=0; ChunkIndex < m_Scene.m_ChunksCount; ChunkIndex++ ) {
+		PrepareJob&	Job = m_pJobs[ChunkIndex];
+		Job.m_pOwner = this;
+		Job.m_pChunk = &m_Scene.m_pChunks[ChunkIndex];
+		Job.m_bDone = false;
+	}
+}
+
+SceneStreamer::~SceneStreamer() {
+	if ( m_PreparingCount > 0 )
+		m_Jobs.Wait();	// Jobs still reference our chunks
+
+	delete[] m_pJobs;
+}
+
+void	SceneStreamer::Update( const float3& _CameraPosition ) {
+	int	LoadsCount = 0;
+	for ( int ChunkIndex=0; ChunkIndex < m_Scene.m_ChunksCount; ChunkIndex++ ) {
+		Scene::Chunk&	C = m_Scene.m_pChunks[ChunkIndex];
+		PrepareJob&		Job = m_pJobs[ChunkIndex];
+		float			Distance = GetDistance( C, _CameraPosition );
+
+		switch ( C.m_State ) {
+		case Scene::Chunk::EVICTED:
+			if ( Distance > m_LoadDistance || m_PreparingCount >= MAX_PREPARING_CHUNKS )
+				break;
+
+			C.m_State = Scene::Chunk::PREPARING;
+			Job.m_bDone = false;
+			m_PreparingCount++;
+			m_Jobs.Push( Job );
+			break;
+
+		case Scene::Chunk::PREPARING:
+			if ( !Job.m_bDone || LoadsCount >= m_MaxLoadsPerFrame )
+				break;
+
+			m_PreparingCount--;
+			m_Loader.LoadChunk( m_Scene, C );	// Load it even if it went out of range meanwhile, it will be evicted next time
+			C.m_State = Scene::Chunk::RESIDENT;
+			LoadsCount++;
+			break;
+
+		case Scene::Chunk::RESIDENT:
+			if ( Distance <= m_EvictDistance )
+				break;
+
+			m_Loader.EvictChunk( m_Scene, C );
+			C.m_State = Scene::Chunk::EVICTED;
+			break;
+		}
+	}
+}
+
+void	SceneStreamer::EvictAll() {
+	if ( m_PreparingCount > 0 )
+		m_Jobs.Wait();
+
+	for ( int ChunkIndex=0; ChunkIndex < m_Scene.m_ChunksCount; ChunkIndex++ ) {
+		Scene::Chunk&	C = m_Scene.m_pChunks[ChunkIndex];
+		if ( C.m_State == Scene::Chunk::RESIDENT )
+			m_Loader.EvictChunk( m_Scene, C );
+		C.m_State = Scene::Chunk::EVICTED;
+	}
+	m_PreparingCount = 0;
+}
+
+// Distance from a position to the chunk's bounds (chunks without any mesh are always in range)
+float	SceneStreamer::GetDistance( const Scene::Chunk& _Chunk, const float3& _Position ) const {
+	if ( _Chunk.m_GlobalBBoxMin.x > _Chunk.m_GlobalBBoxMax.x )
+		return 0.0f;
+
+	float3	D( MAX( 0.0f, MAX( _Chunk.m_GlobalBBoxMin.x - _Position.x, _Position.x - _Chunk.m_GlobalBBoxMax.x ) ),
+			   MAX( 0.0f, MAX( _Chunk.m_GlobalBBoxMin.y - _Position.y, _Position.y - _Chunk.m_GlobalBBoxMax.y ) ),
+			   MAX( 0.0f, MAX( _Chunk.m_GlobalBBoxMin.z - _Position.z, _Position.z - _Chunk.m_GlobalBBoxMax.z ) ) );
+	return D.Length();
+}
+
+void	SceneStreamer::PrepareJob::Run() {
+	m_pOwner->m_Loader.PrepareChunk( m_pOwner->m_Scene, *m_pChunk );
+	MemoryBarrier();	// Make sure the prepared data is visible before the flag
+	m_bDone = true;
+}
@@ -0,0 +1,82 @@
+//////////////////////////////////////////////////////////////////////////
+// Streams the chunks of a scene in & out depending on their distance to the camera (cf. Scene::Chunk)
+//
+// Loading a chunk happens in 2 steps:
+//	_ PrepareChunk() is called from a worker thread of the device's job queue to decode whatever CPU data the chunk requires
+//	_ Once prepared, LoadChunk() is called from the render thread during Update() to create the GPU resources (usually by tagging the chunk)
+// A limited amount of chunks is loaded each frame to avoid hitches. Resident chunks farther than the eviction distance are evicted
+//	through EvictChunk(), also from the render thread.
+//
+// Usage:
+//	Scene.Load( ... );
+//	Scene.PlaceMaterialTags( Tagger );				// Instead of Scene.PlaceTags()
+//	SceneStreamer	Streamer( Scene, Loader, Device.Jobs() );
+//	(...)
+//	Streamer.Update( CameraPosition );				// Each frame, before rendering the scene
+//
+#pragma once
+
+class	SceneStreamer
+{
+public:		// CONSTANTS
+
+	static const int	DEFAULT_MAX_LOADS_PER_FRAME = 2;
+	static const int	MAX_PREPARING_CHUNKS = 4;
+
+public:		// NESTED TYPES
+
+	class	IChunkLoader
+	{
+	public:
+		// Called from a worker thread, must not access the device context nor the chunks' tags
+		virtual void	PrepareChunk( const Scene& _Scene, const Scene::Chunk& _Chunk )	{}
+
+		// Called from the render thread once the chunk is prepared
+		virtual void	LoadChunk( Scene& _Scene, Scene::Chunk& _Chunk ) abstract;
+
+		// Called from the render thread when the chunk goes out of range
+		virtual void	EvictChunk( Scene& _Scene, Scene::Chunk& _Chunk ) abstract;
+	};
+
+protected:
+
+	class	PrepareJob : public IJob
+	{
+	public:
+		SceneStreamer*	m_pOwner;
+		Scene::Chunk*	m_pChunk;
+		volatile bool	m_bDone;
+
+		virtual void	Run();
+	};
+
+protected:	// FIELDS
+
+	Scene&			m_Scene;
+	IChunkLoader&	m_Loader;
+	JobQueue&		m_Jobs;
+
+	PrepareJob*		m_pJobs;			// One per chunk
+	int				m_PreparingCount;
+
+public:		// PROPERTIES
+
+	float			m_LoadDistance;		// Chunks closer than this distance to the camera are loaded
+	float			m_EvictDistance;	// Chunks farther than this distance are evicted (should be larger than the load distance to avoid thrashing)
+	int				m_MaxLoadsPerFrame;
+
+public:		// METHODS
+
+	SceneStreamer( Scene& _Scene, IChunkLoader& _Loader, JobQueue& _Jobs, float _LoadDistance=100.0f, float _EvictDistance=120.0f );
+	~SceneStreamer();	// Waits for the chunks being prepared but doesn't evict the resident chunks (cf. EvictAll())
+
+	// Starts preparing the chunks that entered the load distance, loads the prepared ones and evicts the ones out of range
+	void			Update( const float3& _CameraPosition );
+
+	// Waits for the chunks being prepared and evicts all the resident chunks
+	void			EvictAll();
+
+protected:
+
+	float			GetDistance( const Scene::Chunk& _Chunk, const float3& _Position ) const;
+};
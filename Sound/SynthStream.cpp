@@ -0,0 +1,313 @@
+#include "../GodComplex.h"
+
+SynthStream::SynthStream()
+	: m_pPlayer( NULL )
+	, m_bPreRendered( false )
+	, m_LookAheadSamples( 0 )
+	, m_TailSamples( 0 )
+	, m_hThread( NULL )
+	, m_hWakeEvent( NULL )
+{
+	memset( m_ppChunks, 0, sizeof(m_ppChunks) );
+}
+
+void	SynthStream::Init( V2MPlayer& _Player, U32 _LookAheadMS )
+{
+	ASSERT( (RING_SAMPLES & (RING_SAMPLES-1)) == 0 && (RING_SAMPLES % BLOCK_SAMPLES) == 0, "Invalid ring size!" );
+
+	// Round the lookahead to whole blocks, keeping one block free so the worker never overwrites samples being read
+	U32	LookAheadBlocks = (_LookAheadMS * SAMPLE_RATE / 1000 + BLOCK_SAMPLES-1) / BLOCK_SAMPLES;
+	m_LookAheadSamples = BLOCK_SAMPLES * CLAMP( LookAheadBlocks, 1U, RING_SAMPLES / BLOCK_SAMPLES - 1 );
+
+	m_bPreRendered = false;
+	Start( _Player );
+}
+
+void	SynthStream::InitPreRendered( V2MPlayer& _Player, U32 _TailMS )
+{
+	ASSERT( (CHUNK_SAMPLES % PRERENDER_BLOCK_SAMPLES) == 0, "Invalid pre-render block size!" );
+
+	m_TailSamples = U32(U64(_TailMS) * SAMPLE_RATE / 1000);
+
+	m_bPreRendered = true;
+	Start( _Player );
+}
+
+void	SynthStream::Start( V2MPlayer& _Player )
+{
+	ASSERT( m_pPlayer == NULL, "Stream already initialized!" );
+	m_pPlayer = &_Player;
+
+	m_WritePosition = m_ReadPosition = m_FlushPosition = 0;
+	m_FlushTrackPosition = 0;
+	m_PreRenderedSamples = 0;
+	m_bPreRenderDone = 0;
+	m_Request = REQUEST_NONE;
+	m_bPlaying = false;
+	m_PlayPosition = 0;
+	m_FadeSamples = m_FadeRemainingSamples = 0;
+	m_OutputPosition = 0;
+	m_ClockOffset = 0;
+	m_UnderrunsCount = 0;
+	m_bQuit = 0;
+
+	InitializeCriticalSection( &m_Lock );
+	m_hWakeEvent = CreateEvent( NULL, FALSE, FALSE, NULL );
+
+	DWORD	ThreadID;
+	m_hThread = CreateThread( NULL, 0, SynthThread, this, 0, &ThreadID );
+	ASSERT( m_hThread != NULL, "Failed to create the synth thread!" );
+	SetThreadPriority( m_hThread, m_bPreRendered ? THREAD_PRIORITY_BELOW_NORMAL : THREAD_PRIORITY_HIGHEST );	// Don't slow the init down when pre-rendering
+}
+
+void	SynthStream::Exit()
+{
+	if ( m_pPlayer == NULL )
+		return;
+
+	InterlockedExchange( &m_bQuit, 1 );
+	SetEvent( m_hWakeEvent );
+	WaitForSingleObject( m_hThread, INFINITE );
+	CloseHandle( m_hThread );
+	CloseHandle( m_hWakeEvent );
+	DeleteCriticalSection( &m_Lock );
+
+	for ( U32 ChunkIndex=0; ChunkIndex < MAX_CHUNKS; ChunkIndex++ )
+	{
+		delete[] m_ppChunks[ChunkIndex];
+		m_ppChunks[ChunkIndex] = NULL;
+	}
+
+	m_hThread = NULL;
+	m_hWakeEvent = NULL;
+	m_pPlayer = NULL;
+}
+
+U32		SynthStream::GetPlayPosition() const
+{
+	S32	Position = S32(dsGetCurSmp()) + S32(m_ClockOffset);
+	return Position > 0 ? U32(Position) : 0;
+}
+
+void	SynthStream::Seek( U32 _SamplePosition )
+{
+	if ( m_bPreRendered )
+	{	// The output callback simply reads from the new position
+		InterlockedExchange( &m_RequestedPosition, LONG(_SamplePosition) );
+		InterlockedExchange( &m_Request, REQUEST_PLAY );
+		return;
+	}
+
+	EnterCriticalSection( &m_Lock );
+	m_pPlayer->Play( U32(U64(_SamplePosition) * 1000 / SAMPLE_RATE) );
+	Flush( _SamplePosition );
+	LeaveCriticalSection( &m_Lock );
+
+	SetEvent( m_hWakeEvent );
+}
+
+void	SynthStream::Stop( U32 _FadeTimeMS )
+{
+	if ( m_bPreRendered )
+	{	// The output callback fades or stops reading
+		InterlockedExchange( &m_RequestedFadeSamples, LONG(U64(_FadeTimeMS) * SAMPLE_RATE / 1000) );
+		InterlockedExchange( &m_Request, REQUEST_STOP );
+		return;
+	}
+
+	EnterCriticalSection( &m_Lock );
+	m_pPlayer->Stop( _FadeTimeMS );
+	Flush( ~0U );	// The clock keeps running
+	LeaveCriticalSection( &m_Lock );
+
+	SetEvent( m_hWakeEvent );
+}
+
+bool	SynthStream::WaitPreRender( DWORD _TimeOutMS )
+{
+	ASSERT( m_bPreRendered, "The stream isn't pre-rendered!" );
+	return WaitForSingleObject( m_hThread, _TimeOutMS ) == WAIT_OBJECT_0;	// The worker quits once the track is rendered
+}
+
+void	SynthStream::Flush( U32 _TrackPosition )
+{
+	// The worker renders under the lock so the write position can't move here: everything before it was rendered with the old player state
+	InterlockedExchange( &m_FlushTrackPosition, LONG(_TrackPosition) );
+	InterlockedExchange( &m_FlushPosition, m_WritePosition );
+}
+
+void __stdcall	SynthStream::RenderProxy( void* _pThis, float* _pBuffer, unsigned long _SamplesCount )
+{
+	reinterpret_cast<SynthStream*>( _pThis )->Read( _pBuffer, _SamplesCount );
+}
+
+void	SynthStream::Read( float* _pBuffer, U32 _SamplesCount )
+{
+	if ( m_bPreRendered )
+		ReadPreRendered( _pBuffer, _SamplesCount );
+	else
+		ReadStreamed( _pBuffer, _SamplesCount );
+
+	m_OutputPosition += _SamplesCount;
+}
+
+void	SynthStream::ReadStreamed( float* _pBuffer, U32 _SamplesCount )
+{
+	U32	ReadPosition = U32(m_ReadPosition);
+	U32	FlushPosition = U32(m_FlushPosition);
+	if ( S32(FlushPosition - ReadPosition) > 0 )
+	{	// Skip the samples rendered before the last Play()/Stop()
+		ReadPosition = FlushPosition;
+
+		U32	TrackPosition = U32(m_FlushTrackPosition);
+		if ( TrackPosition != ~0U )
+			InterlockedExchange( &m_ClockOffset, LONG(TrackPosition - m_OutputPosition) );
+	}
+
+	U32	AvailableSamples = U32(m_WritePosition) - ReadPosition;
+	MemoryBarrier();	// Don't read the ring before the write position that published it
+
+	U32	SamplesCount = MIN( _SamplesCount, AvailableSamples );
+	U32	RingOffset = ReadPosition & (RING_SAMPLES-1);
+	U32	FirstCount = MIN( SamplesCount, RING_SAMPLES - RingOffset );
+	memcpy( _pBuffer, m_pRing + 2*RingOffset, 2*FirstCount*sizeof(float) );
+	memcpy( _pBuffer + 2*FirstCount, m_pRing, 2*(SamplesCount - FirstCount)*sizeof(float) );
+
+	if ( SamplesCount < _SamplesCount )
+	{	// The worker is late, pad with silence
+		memset( _pBuffer + 2*SamplesCount, 0, 2*(_SamplesCount - SamplesCount)*sizeof(float) );
+		InterlockedIncrement( &m_UnderrunsCount );
+	}
+
+	InterlockedExchange( &m_ReadPosition, LONG(ReadPosition + SamplesCount) );	// Releases the consumed samples to the worker
+	SetEvent( m_hWakeEvent );
+}
+
+void	SynthStream::ReadPreRendered( float* _pBuffer, U32 _SamplesCount )
+{
+	// Apply the last request
+	LONG	Request = InterlockedExchange( &m_Request, REQUEST_NONE );
+	if ( Request == REQUEST_PLAY )
+	{
+		m_bPlaying = true;
+		m_PlayPosition = U32(m_RequestedPosition);
+		m_FadeSamples = 0;
+		InterlockedExchange( &m_ClockOffset, LONG(m_PlayPosition - m_OutputPosition) );
+	}
+	else if ( Request == REQUEST_STOP )
+	{
+		m_FadeSamples = m_FadeRemainingSamples = U32(m_RequestedFadeSamples);
+		m_bPlaying &= m_FadeSamples > 0;
+	}
+
+	U32	SamplesCount = 0;
+	if ( m_bPlaying )
+	{
+		U32		AvailableSamples = U32(m_PreRenderedSamples);
+		bool	bPreRenderDone = m_bPreRenderDone != 0;
+		MemoryBarrier();	// Don't read the chunks before the amount of samples that published them
+
+		while ( SamplesCount < _SamplesCount && m_PlayPosition < AvailableSamples )
+		{
+			U32	ChunkOffset = m_PlayPosition & (CHUNK_SAMPLES-1);
+			U32	Count = MIN( _SamplesCount - SamplesCount, MIN( CHUNK_SAMPLES - ChunkOffset, AvailableSamples - m_PlayPosition ) );
+			memcpy( _pBuffer + 2*SamplesCount, m_ppChunks[m_PlayPosition >> CHUNK_SAMPLES_POT] + 2*ChunkOffset, 2*Count*sizeof(float) );
+			SamplesCount += Count;
+			m_PlayPosition += Count;
+		}
+
+		if ( SamplesCount < _SamplesCount )
+		{
+			if ( bPreRenderDone )
+				m_bPlaying = false;	// End of the track
+			else
+			{	// The pre-render is late, skip the missing samples to stay in sync with the clock
+				m_PlayPosition += _SamplesCount - SamplesCount;
+				InterlockedIncrement( &m_UnderrunsCount );
+			}
+		}
+
+		if ( m_FadeSamples > 0 )
+		{	// Fade out
+			for ( U32 SampleIndex=0; SampleIndex < SamplesCount; SampleIndex++ )
+			{
+				float	Volume = float(m_FadeRemainingSamples) / m_FadeSamples;
+				_pBuffer[2*SampleIndex+0] *= Volume;
+				_pBuffer[2*SampleIndex+1] *= Volume;
+				m_FadeRemainingSamples -= m_FadeRemainingSamples > 0 ? 1 : 0;
+			}
+			m_bPlaying &= m_FadeRemainingSamples > 0;
+		}
+	}
+
+	memset( _pBuffer + 2*SamplesCount, 0, 2*(_SamplesCount - SamplesCount)*sizeof(float) );
+}
+
+void	SynthStream::RunStreamed()
+{
+	while ( !m_bQuit )
+	{
+		// NOTE: Flushed samples still count until the output callback skipped them, as it may be copying them right now
+		U32	WritePosition = U32(m_WritePosition);
+		U32	BufferedSamples = WritePosition - U32(m_ReadPosition);
+		if ( BufferedSamples + BLOCK_SAMPLES > m_LookAheadSamples )
+		{	// Far enough ahead, wait for the output to consume some samples
+			WaitForSingleObject( m_hWakeEvent, 10 );
+			continue;
+		}
+
+		// Blocks never straddle the end of the ring since its size is a multiple of the block size
+		EnterCriticalSection( &m_Lock );
+		WritePosition = U32(m_WritePosition);
+		m_pPlayer->Render( m_pRing + 2*(WritePosition & (RING_SAMPLES-1)), BLOCK_SAMPLES );
+		InterlockedExchange( &m_WritePosition, LONG(WritePosition + BLOCK_SAMPLES) );	// Publishes the block to the output callback
+		LeaveCriticalSection( &m_Lock );
+	}
+}
+
+void	SynthStream::RunPreRender()
+{
+	// The player is only used by this thread in this mode
+	m_pPlayer->Play( 0 );
+
+	U32	Position = 0;
+	U32	TailSamples = m_TailSamples;
+	while ( !m_bQuit )
+	{
+		U32	ChunkIndex = Position >> CHUNK_SAMPLES_POT;
+		if ( ChunkIndex >= MAX_CHUNKS )
+			break;	// Truncated!
+
+		U32	ChunkOffset = Position & (CHUNK_SAMPLES-1);
+		if ( ChunkOffset == 0 )
+			m_ppChunks[ChunkIndex] = new float[2*CHUNK_SAMPLES];
+
+		U32	Count = PRERENDER_BLOCK_SAMPLES;
+		if ( !m_pPlayer->IsPlaying() )
+		{	// The song is over, render the release of the last notes
+			if ( TailSamples == 0 )
+				break;
+			Count = MIN( Count, TailSamples );
+			TailSamples -= Count;
+		}
+
+		// Blocks never straddle 2 chunks since the chunks' size is a multiple of the block size
+		m_pPlayer->Render( m_ppChunks[ChunkIndex] + 2*ChunkOffset, Count );
+		Position += Count;
+		InterlockedExchange( &m_PreRenderedSamples, LONG(Position) );	// Publishes the block to the output callback
+	}
+
+	m_pPlayer->Stop();
+	InterlockedExchange( &m_bPreRenderDone, 1 );
+}
+
+DWORD WINAPI	SynthStream::SynthThread( LPVOID _pParam )
+{
+	SynthStream*	pStream = reinterpret_cast<SynthStream*>( _pParam );
+	if ( pStream->m_bPreRendered )
+		pStream->RunPreRender();
+	else
+		pStream->RunStreamed();
+
+	return 0;
+}
@@ -0,0 +1,148 @@
+//////////////////////////////////////////////////////////////////////////
+// Synthesizer Stream
+// Renders the V2 music ahead of the DirectSound output on a dedicated thread so a frame hitch of the intro doesn't starve
+//	the audio thread. The stream works in one of 2 modes:
+//	_ Streamed: the synth worker fills a lock-free single-producer/single-consumer ring of interleaved stereo samples up to
+//		a given lookahead, and the DirectSound callback only copies the samples out of the ring.
+//	_ Pre-rendered: the synth worker renders the whole track once into memory (typically while the intro initializes) then
+//		quits, the DirectSound callback reads the samples at the play position so there is no synth cost left at runtime
+//		and the track can be seeked to any sample.
+//
+// Usage:
+//	gs_Music.Open( pTheTune );
+//	gs_MusicStream.Init( gs_Music, 250 );		// Renders up to 250ms ahead of the output (or InitPreRendered( gs_Music ))
+//	dsInit( SynthStream::RenderProxy, &gs_MusicStream, hWnd );
+//	gs_MusicStream.Play();
+//	...
+//	float	Time = gs_MusicStream.GetPlayTime();	// Audio clock to sync on
+//	...
+//	dsClose();
+//	gs_MusicStream.Exit();
+//
+// The audio clock is the track position that is being heard (it relies on dsGetCurSmp() which compensates the output latency),
+//	it keeps running after Stop() and jumps on Play() and Seek().
+//
+// NOTE: Once the stream is initialized, the player must only be driven through the stream's Play(), Seek() and Stop() since
+//	the synth is not thread-safe. When streamed, these flush the samples already rendered ahead so they take effect immediately.
+// If the worker is late anyway (or the pre-render didn't reach the play position yet) the output is padded with silence and
+//	GetUnderrunsCount() is incremented.
+//
+#pragma once
+
+class SynthStream
+{
+public:		// CONSTANTS
+
+	static const U32	SAMPLE_RATE = 44100;
+	static const U32	BLOCK_SAMPLES = 256;			// The amount of samples the worker renders at once when streaming
+	static const U32	RING_SAMPLES = 32768;			// Must be a power of 2 and a multiple of BLOCK_SAMPLES (i.e. up to ~740ms of lookahead)
+	static const U32	DEFAULT_LOOKAHEAD_MS = 200;
+
+	static const U32	CHUNK_SAMPLES_POT = 16;			// The pre-rendered track is stored in chunks of 2^16 samples (~1.5s)
+	static const U32	CHUNK_SAMPLES = 1 << CHUNK_SAMPLES_POT;
+	static const U32	MAX_CHUNKS = 512;				// Up to ~12.7 minutes
+	static const U32	PRERENDER_BLOCK_SAMPLES = 4096;	// The amount of samples the worker renders at once when pre-rendering (must divide CHUNK_SAMPLES)
+	static const U32	DEFAULT_TAIL_MS = 2000;			// Time rendered after the end of the song for the notes to release
+
+private:
+
+	enum REQUEST
+	{
+		REQUEST_NONE,
+		REQUEST_PLAY,
+		REQUEST_STOP,
+	};
+
+private:	// FIELDS
+
+	V2MPlayer*			m_pPlayer;
+	bool				m_bPreRendered;
+	U32					m_LookAheadSamples;
+	U32					m_TailSamples;
+
+	// Streamed mode
+	float				m_pRing[2*RING_SAMPLES];		// Interleaved stereo samples
+
+	// Positions are total amounts of samples (they wrap around U32 so they vanish from the differences)
+	volatile LONG		m_WritePosition;				// Only written by the worker
+	volatile LONG		m_ReadPosition;					// Only written by the output callback
+	volatile LONG		m_FlushPosition;				// Samples before this position are stale and skipped by the output callback
+	volatile LONG		m_FlushTrackPosition;			// The track position of the sample at the flush position
+
+	// Pre-rendered mode
+	float*				m_ppChunks[MAX_CHUNKS];			// Interleaved stereo samples
+	volatile LONG		m_PreRenderedSamples;			// Only written by the worker
+	volatile LONG		m_bPreRenderDone;
+
+	volatile LONG		m_Request;						// Play/Stop request to the output callback
+	volatile LONG		m_RequestedPosition;
+	volatile LONG		m_RequestedFadeSamples;
+
+	// Only used by the output callback
+	bool				m_bPlaying;
+	U32					m_PlayPosition;
+	U32					m_FadeSamples;
+	U32					m_FadeRemainingSamples;
+	U32					m_OutputPosition;				// Total amount of samples given to DirectSound
+
+	// Audio clock
+	volatile LONG		m_ClockOffset;					// Track position = DirectSound play position + offset
+
+	volatile LONG		m_UnderrunsCount;
+
+	CRITICAL_SECTION	m_Lock;							// Protects the player between the worker and Play()/Stop()
+	HANDLE				m_hThread;
+	HANDLE				m_hWakeEvent;					// Signaled by the output callback whenever it consumed samples
+	volatile LONG		m_bQuit;
+
+public:		// PROPERTIES
+
+	bool		IsInitialized() const		{ return m_pPlayer != NULL; }
+	bool		IsPreRendered() const		{ return m_bPreRendered; }
+	U32			GetLookAheadSamples() const	{ return m_LookAheadSamples; }
+	U32			GetUnderrunsCount() const	{ return U32(m_UnderrunsCount); }
+
+	// Pre-rendered mode only
+	bool		IsPreRenderDone() const		{ return m_bPreRenderDone != 0; }
+	U32			GetPreRenderedSamples() const	{ return U32(m_PreRenderedSamples); }
+
+	// Gets the audio clock as a sample position in the track, or in seconds
+	U32			GetPlayPosition() const;
+	float		GetPlayTime() const			{ return float(GetPlayPosition()) / SAMPLE_RATE; }
+
+public:		// METHODS
+
+	SynthStream();
+
+	// Starts the synth worker on an opened player, _LookAheadMS is clamped to the ring's size
+	void		Init( V2MPlayer& _Player, U32 _LookAheadMS=DEFAULT_LOOKAHEAD_MS );
+
+	// Starts pre-rendering the whole track of an opened player, followed by _TailMS of release
+	void		InitPreRendered( V2MPlayer& _Player, U32 _TailMS=DEFAULT_TAIL_MS );
+
+	void		Exit();
+
+	// Plays from the given time or sample position in the track
+	void		Play( U32 _TimeMS=0 )		{ Seek( U32(U64(_TimeMS) * SAMPLE_RATE / 1000) ); }
+	void		Seek( U32 _SamplePosition );
+	void		Stop( U32 _FadeTimeMS=0 );
+
+	// Waits for the pre-render to complete, returns false on time out
+	bool		WaitPreRender( DWORD _TimeOutMS=INFINITE );
+
+	// DirectSound callback (cf. libv2.h), _pThis is the stream
+	static void __stdcall	RenderProxy( void* _pThis, float* _pBuffer, unsigned long _SamplesCount );
+
+private:
+
+	void		Start( V2MPlayer& _Player );
+	void		Read( float* _pBuffer, U32 _SamplesCount );
+	void		ReadStreamed( float* _pBuffer, U32 _SamplesCount );
+	void		ReadPreRendered( float* _pBuffer, U32 _SamplesCount );
+	void		Flush( U32 _TrackPosition );
+
+	void		RunStreamed();
+	void		RunPreRender();
+
+	static DWORD WINAPI	SynthThread( LPVOID _pParam );
+};
@@ -11,57 +11,59 @@ namespace DirectXTexManaged {
 
 	void TextureCreator::CreateDDS( String^ _FileName, RendererManaged::Texture2D^ _Texture ) {
 
-		::Texture2D&	Texture = *((::Texture2D*) _Texture->GetWrappedtexture());
+		// Build DTex scratch image
+		DirectX::ScratchImage*	DXT = new DirectX::ScratchImage();
+		ReadBack( *((::Texture2D*) _Texture->GetWrappedtexture()), *DXT );
+
+		// Get array of images
+		size_t						ImagesCount = DXT->GetImageCount();
+		const DirectX::Image*		pImages = DXT->GetImages();
+		const DirectX::TexMetadata&	Meta = DXT->GetMetadata();
+
+		// Save the result
+		System::IntPtr	pFileName = System::Runtime::InteropServices::Marshal::StringToHGlobalUni( _FileName );
+		LPCWSTR			wpFileName = LPCWSTR( pFileName.ToPointer() );
 
-		int	W =  Texture.GetWidth();
-		int	H = Texture.GetHeight();
-		int	A = Texture.GetArraySize();
-		int	MipsCount = Texture.GetMipLevelsCount();
+		DWORD	flags = DirectX::DDS_FLAGS_FORCE_DX10_EXT;
+		DirectX::SaveToDDSFile( pImages, ImagesCount, Meta, flags, wpFileName );
 
-		const ::IPixelFormatDescriptor&	Descriptor = static_cast< const ::IPixelFormatDescriptor& >( Texture.GetFormatDescriptor() );
+		delete DXT;
+	} 
 
-		// Copy to staging image
-		::Texture2D*	TextureStaging = new ::Texture2D( Texture.GetDevice(), W, H, A, Descriptor, MipsCount, nullptr, true, false );
-		TextureStaging->CopyFrom( Texture );
+	void	TextureCreator::ReadBack( ::Texture2D& _Texture, DirectX::ScratchImage& _Image ) {
 
-		// Build DTex scratch image
-		DirectX::ScratchImage*	DXT = new DirectX::ScratchImage();
+		int	W =  _Texture.GetWidth();
+		int	H = _Texture.GetHeight();
+		int	A = _Texture.GetArraySize();
+		int	MipsCount = _Texture.GetMipLevelsCount();
 
-		DXGI_FORMAT	DXFormat = Descriptor.DirectXFormat();
-		HRESULT	hr = DXT->Initialize2D( DXFormat, W, H, A, MipsCount );
+		const ::IPixelFormatDescriptor&	Descriptor = static_cast< const ::IPixelFormatDescriptor& >( _Texture.GetFormatDescriptor() );
+
+		// Copy to staging image
+		::Texture2D*	TextureStaging = new ::Texture2D( _Texture.GetDevice(), W, H, A, Descriptor, MipsCount, nullptr, true, false );
+		TextureStaging->CopyFrom( _Texture );
+
+		_Image.Initialize2D( Descriptor.DirectXFormat(), W, H, A, MipsCount );
 
 		// Copy staging to scratch
 		for ( int MipLevel=0; MipLevel < MipsCount; MipLevel++ ) {
 			for ( int ArrayIndex=0; ArrayIndex < A; ArrayIndex++ ) {
 				D3D11_MAPPED_SUBRESOURCE	SourceData = TextureStaging->Map( MipLevel, ArrayIndex );
 				const uint8_t*				pSourceBuffer = (uint8_t*) SourceData.pData;
-				const DirectX::Image*		pTarget = DXT->GetImage( MipLevel, ArrayIndex, 0 );
-				ASSERT( pTarget->rowPitch == SourceData.RowPitch, "Row pitches mismatch!" );
+				const DirectX::Image*		pTarget = _Image.GetImage( MipLevel, ArrayIndex, 0 );
 
-				for ( int Y=0; Y < H; Y++ ) {
+				size_t						RowsCount = pTarget->slicePitch / pTarget->rowPitch;	// Rows of blocks for compressed formats
+				size_t						RowSize = size_t(SourceData.RowPitch) < pTarget->rowPitch ? size_t(SourceData.RowPitch) : pTarget->rowPitch;
+				for ( size_t Y=0; Y < RowsCount; Y++ ) {
 					const void*	pSourceScanline = pSourceBuffer + Y * SourceData.RowPitch;
 					void*		pTargetScanline = pTarget->pixels + Y * pTarget->rowPitch;
-					memcpy_s( pTargetScanline, pTarget->rowPitch, pSourceScanline, SourceData.RowPitch );
+					memcpy_s( pTargetScanline, pTarget->rowPitch, pSourceScanline, RowSize );
 				}
+				TextureStaging->UnMap( MipLevel, ArrayIndex );
 			}
 		} 
 
 		delete TextureStaging;
-
-
-		// Get array of images
-		size_t						ImagesCount = DXT->GetImageCount();
-		const DirectX::Image*		pImages = DXT->GetImages();
-		const DirectX::TexMetadata&	Meta = DXT->GetMetadata();
-
-		// Save the result
-		System::IntPtr	pFileName = System::Runtime::InteropServices::Marshal::StringToHGlobalUni( _FileName );
-		LPCWSTR			wpFileName = LPCWSTR( pFileName.ToPointer() );
-
-		DWORD	flags = DirectX::DDS_FLAGS_FORCE_DX10_EXT;
-		hr = DirectX::SaveToDDSFile( pImages, ImagesCount, Meta, flags, wpFileName );
-
-		delete DXT;
-	} 
+	}
 
 }
\ No newline at end of file
@@ -7,6 +7,8 @@
 #pragma managed
 
 #include "../../RendererD3D11/Device.h"
+#include "TextureCompressor.h"
+#include "ImageDecoder.h"
 
 using namespace System;
 using namespace WMath;
@@ -20,62 +22,21 @@ namespace DirectXTexManaged {
 		// Creates a DDS file from a texture
 		static void CreateDDS( String^ _FileName, RendererManaged::Texture2D^ _Texture );
 
-// 		static void	CreateNormalMapBC5File( String^ _FileName, cli::array< cli::array<WMath::Vector4D^,2>^>^ _Mips )
-// 		{
-// 			int	MipsCount = _Mips->Length;
-// 
-// 			int	Width = _Mips[0]->GetLength( 0 );
-// 			int	Height = _Mips[0]->GetLength( 1 );
-// 
-// 			// Create the image and fill it with our data
-// 			DirectX::ScratchImage*	DXT = new DirectX::ScratchImage();
-// 
-// 			HRESULT	hr = DXT->Initialize2D( DXGI_FORMAT_R32G32B32A32_FLOAT, Width, Height, 1, MipsCount );
-// 
-// 			for ( int MipIndex=0; MipIndex < MipsCount; MipIndex++ )
-// 			{
-// 				int	W = Math::Max( 1, Width >> MipIndex );
-// 				int	H = Math::Max( 1, Height >> MipIndex );
-// 
-// 				cli::array<WMath::Vector4D^,2>^	Content = _Mips[MipIndex];
-// 
-// 				const DirectX::Image*	pImage = DXT->GetImage( MipIndex, 0, 0 );
-// 
-// 				for ( int Y=0; Y < H; Y++ )
-// 				{
-// 					float*	pScanline = (float*) (pImage->pixels + Y * pImage->rowPitch);
-// 					for ( int X=0; X < W; X++ )
-// 					{
-// 						float	R = Content[X,Y]->x;
-// 						float	G = Content[X,Y]->y;
-// 						float	B = Content[X,Y]->z;
-// 						float	A = Content[X,Y]->w;
-// 
-// 						*pScanline++ = R;
-// 						*pScanline++ = G;
-// 						*pScanline++ = B;
-// 						*pScanline++ = A;
-// 					}
-// 				}
-// 			}
-// 
-// 			// Get array of images
-// 			size_t						ImagesCount = DXT->GetImageCount();
-// 			const DirectX::Image*		pImages = DXT->GetImages();
-// 			const DirectX::TexMetadata&	Meta = DXT->GetMetadata();
-// 
-// 			HRESULT	hr = DXT->Initialize2D( DXGI_FORMAT_BC5_SNORM, Width, Height, 1, MipsCount );
-// 
-// 			// Save the result
-// 			System::IntPtr	pFileName = System::Runtime::InteropServices::Marshal::StringToHGlobalUni( _FileName );
-// 			LPCWSTR			wpFileName = LPCWSTR( pFileName.ToPointer() );
-// 
-// //			DWORD	flags = DirectX::DDS_FLAGS_NONE;
-// 			DWORD	flags = DirectX::DDS_FLAGS_FORCE_DX10_EXT;
-// 			hr = DirectX::SaveToDDSFile( pImages, ImagesCount, Meta, flags, wpFileName );
-// 
-// 			delete DXT;
-// 		}
+	internal:
+
+		// Copies the content of a texture into a scratch image of the same format
+		static void	ReadBack( ::Texture2D& _Texture, DirectX::ScratchImage& _Image );
+
+	public:
+
+		// Creates a BC5 DDS file from a mip chain of normals (only XY are stored)
+		static void	CreateNormalMapBC5File( String^ _FileName, cli::array< cli::array<WMath::Vector4D^,2>^>^ _Mips )
+		{
+			TextureCompressor^	Compressor = gcnew TextureCompressor( nullptr );
+			Compressor->Add( _FileName, _Mips, COMPRESSED_FORMAT::BC5_SNORM );
+			Compressor->Compress();
+			delete Compressor;
+		}
 
 		static void	CreateCubeMapFile( String^ _FileName, int _CubeSize, cli::array< cli::array< cli::array<WMath::Vector4D^,2>^>^ >^ _CubeFaces )
 		{
@@ -0,0 +1,195 @@
+#include "stdafx.h"
+
+#include "DirectXTexManaged.h"
+
+#include <vcclr.h>
+
+namespace DirectXTexManaged {
+
+	ImageDecoder::ImageDecoder( int _WorkersCount, int _MaxQueuedCount )
+	{
+		if ( _WorkersCount <= 0 )
+			_WorkersCount = Environment::ProcessorCount;
+
+		m_Queue = gcnew BlockingCollection<Request^>( Math::Max( 1, _MaxQueuedCount ) );
+		m_Pool = gcnew cli::array<ConcurrentBag<cli::array<Byte>^>^>( 32 );
+		for ( int PoolIndex=0; PoolIndex < m_Pool->Length; PoolIndex++ )
+			m_Pool[PoolIndex] = gcnew ConcurrentBag<cli::array<Byte>^>();
+
+		m_Workers = gcnew cli::array<Thread^>( _WorkersCount );
+		for ( int WorkerIndex=0; WorkerIndex < _WorkersCount; WorkerIndex++ )
+		{
+			Thread^	Worker = gcnew Thread( gcnew ThreadStart( this, &ImageDecoder::WorkerLoop ) );
+			Worker->Name = "Image Decoder #" + WorkerIndex;
+			Worker->IsBackground = true;
+			Worker->Start();
+			m_Workers[WorkerIndex] = Worker;
+		}
+	}
+
+	ImageDecoder::~ImageDecoder()
+	{
+		m_Queue->CompleteAdding();
+		for each ( Thread^ Worker in m_Workers )
+			Worker->Join();
+		delete m_Queue;
+	}
+
+	Task<DecodedImage^>^	ImageDecoder::Decode( String^ _FileName, DECODED_FORMAT _Format )
+	{
+		if ( _FileName == nullptr )
+			throw gcnew ArgumentNullException( "_FileName" );
+
+		Request^	R = gcnew Request( _FileName, _Format );
+		m_Queue->Add( R );	// Blocks while the queue is full
+		return R->m_Completion->Task;
+	}
+
+	cli::array<Task<DecodedImage^>^>^	ImageDecoder::Decode( cli::array<String^>^ _FileNames, DECODED_FORMAT _Format )
+	{
+		cli::array<Task<DecodedImage^>^>^	Result = gcnew cli::array<Task<DecodedImage^>^>( _FileNames->Length );
+		for ( int FileIndex=0; FileIndex < _FileNames->Length; FileIndex++ )
+			Result[FileIndex] = Decode( _FileNames[FileIndex], _Format );
+
+		return Result;
+	}
+
+	void	ImageDecoder::Recycle( DecodedImage^ _Image )
+	{
+		cli::array<Byte>^	Buffer = _Image->m_Pixels;
+		if ( Buffer == nullptr )
+			return;	// Already recycled
+
+		_Image->m_Pixels = nullptr;
+
+		ConcurrentBag<cli::array<Byte>^>^	Bag = m_Pool[GetPoolIndex( Buffer->Length )];
+		if ( Bag->Count < MAX_POOLED_BUFFERS_PER_SIZE )
+			Bag->Add( Buffer );
+	}
+
+	void	ImageDecoder::WorkerLoop()
+	{
+		for each ( Request^ R in m_Queue->GetConsumingEnumerable() )
+		{
+			DecodedImage^	Image = nullptr;
+			try
+			{
+				Image = DecodeFile( R );
+			}
+			catch ( Exception^ _e )
+			{
+				R->m_Completion->SetException( _e );
+				continue;
+			}
+
+			R->m_Completion->SetResult( Image );
+		}
+	}
+
+	DecodedImage^	ImageDecoder::DecodeFile( Request^ _Request )
+	{
+		String^	FileName = _Request->m_FileName;
+
+		// Map the whole file, the decoders read it straight from the file cache
+		pin_ptr<const wchar_t>	wpFileName = PtrToStringChars( FileName );
+		HANDLE	hFile = CreateFileW( wpFileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+		if ( hFile == INVALID_HANDLE_VALUE )
+			throw gcnew Exception( "Failed to open \"" + FileName + "\"!" );
+
+		HANDLE					hMapping = NULL;
+		const void*				pFileContent = NULL;
+		DirectX::ScratchImage	Loaded;
+		HRESULT					hr = E_FAIL;
+		try
+		{
+			LARGE_INTEGER	FileSize;
+			if ( !GetFileSizeEx( hFile, &FileSize ) || FileSize.QuadPart == 0 )
+				throw gcnew Exception( "\"" + FileName + "\" is empty!" );
+
+			hMapping = CreateFileMappingW( hFile, NULL, PAGE_READONLY, 0, 0, NULL );
+			if ( hMapping != NULL )
+				pFileContent = MapViewOfFile( hMapping, FILE_MAP_READ, 0, 0, 0 );
+			if ( pFileContent == NULL )
+				throw gcnew Exception( "Failed to map \"" + FileName + "\"!" );
+
+			size_t	Size = size_t( FileSize.QuadPart );
+			String^	Extension = IO::Path::GetExtension( FileName )->ToLower();
+			if ( Extension == ".dds" )
+				hr = DirectX::LoadFromDDSMemory( pFileContent, Size, DirectX::DDS_FLAGS_NONE, NULL, Loaded );
+			else if ( Extension == ".tga" )
+				hr = DirectX::LoadFromTGAMemory( pFileContent, Size, NULL, Loaded );
+			else
+				hr = DirectX::LoadFromWICMemory( pFileContent, Size, DirectX::WIC_FLAGS_NONE, NULL, Loaded );
+		}
+		finally
+		{
+			if ( pFileContent != NULL )
+				UnmapViewOfFile( pFileContent );
+			if ( hMapping != NULL )
+				CloseHandle( hMapping );
+			CloseHandle( hFile );
+		}
+
+		if ( FAILED( hr ) )
+			throw gcnew Exception( String::Format( "Failed to decode \"{0}\" (0x{1:X8})!", FileName, hr ) );
+
+		// Normalize the first image, RGBA8 keeps the sRGB encoding of the source while FLOAT4 is linear
+		const DirectX::Image&	Source = *Loaded.GetImage( 0, 0, 0 );
+		bool					bSRGB = DirectX::IsSRGB( Source.format );
+		DXGI_FORMAT				TargetFormat = _Request->m_Format == DECODED_FORMAT::FLOAT4 ? DXGI_FORMAT_R32G32B32A32_FLOAT
+											 : bSRGB ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+
+		DecodedImage^	Result = gcnew DecodedImage();
+		Result->m_FileName = FileName;
+		Result->m_Width = int( Source.width );
+		Result->m_Height = int( Source.height );
+		Result->m_Format = _Request->m_Format;
+		Result->m_bSRGB = bSRGB && _Request->m_Format == DECODED_FORMAT::RGBA8;
+
+		if ( Source.format == TargetFormat )
+		{
+			CopyPixels( Source, Result );
+			return Result;
+		}
+
+		DirectX::ScratchImage	Converted;
+		hr = DirectX::IsCompressed( Source.format )	? DirectX::Decompress( Source, TargetFormat, Converted )
+													: DirectX::Convert( Source, TargetFormat, DirectX::TEX_FILTER_DEFAULT, 0.5f, Converted );
+		if ( FAILED( hr ) )
+			throw gcnew Exception( String::Format( "Failed to convert \"{0}\" (0x{1:X8})!", FileName, hr ) );
+
+		CopyPixels( *Converted.GetImage( 0, 0, 0 ), Result );
+		return Result;
+	}
+
+	void	ImageDecoder::CopyPixels( const DirectX::Image& _Source, DecodedImage^ _Target )
+	{
+		int	Stride = _Target->Stride;
+		_Target->m_Pixels = AcquireBuffer( _Target->m_Height * Stride );
+
+		pin_ptr<Byte>	pPinned = &_Target->m_Pixels[0];
+		Byte*			pTarget = pPinned;
+		for ( int Y=0; Y < _Target->m_Height; Y++ )
+			memcpy( pTarget + Y * Stride, _Source.pixels + Y * _Source.rowPitch, Stride );
+	}
+
+	cli::array<Byte>^	ImageDecoder::AcquireBuffer( int _Size )
+	{
+		int	PoolIndex = GetPoolIndex( _Size );
+
+		cli::array<Byte>^	Buffer = nullptr;
+		if ( m_Pool[PoolIndex]->TryTake( Buffer ) )
+			return Buffer;
+
+		return gcnew cli::array<Byte>( 1 << PoolIndex );
+	}
+
+	int		ImageDecoder::GetPoolIndex( int _Size )
+	{
+		int	PoolIndex = 0;
+		while ( (1 << PoolIndex) < _Size )
+			PoolIndex++;
+
+		return PoolIndex;
+	}
+}
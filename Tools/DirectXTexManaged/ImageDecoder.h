@@ -0,0 +1,127 @@
+// ImageDecoder.h
+// Decodes batches of image files (DDS, TGA and anything WIC reads like PNG, JPG, TIFF or BMP) on a fixed pool of worker threads.
+//	_ Decode() queues a file and returns a task completed by a worker with the decoded image, so the caller can queue a whole
+//		batch and only wait where it needs the pixels.
+//	_ The queue is bounded: Decode() blocks when too many files wait for a worker, which keeps a large batch from reading the
+//		whole folder into memory before anything got decoded.
+//	_ The files are memory-mapped and decoded in place by DirectXTex, the mip 0 of the first slice is then decompressed and/or
+//		converted to RGBA8 or float4 by DirectXTex's converter (which works on XMVECTORs, i.e. SSE2).
+//	_ The pixels are copied into pooled managed arrays, give them back with Recycle() once the image was consumed so following
+//		images of the same size don't allocate.
+//
+// Usage:
+//	ImageDecoder^	Decoder = gcnew ImageDecoder( 0, 16 );	// A worker per processor, 16 files waiting at most
+//	cli::array<Task<DecodedImage^>^>^	Tasks = Decoder->Decode( FileNames, DECODED_FORMAT::RGBA8 );
+//	for each ( Task<DecodedImage^>^ T in Tasks )
+//	{
+//		DecodedImage^	Image = T->Result;				// Throws an AggregateException if the file couldn't be decoded
+//		... (use Image->Pixels, Image->Stride bytes per row)
+//		Decoder->Recycle( Image );
+//	}
+//	delete Decoder;										// Decodes the files still queued then stops the workers
+//
+// NOTE: The pooled arrays are rounded up to a power of 2 bytes and can be larger than Height * Stride.
+// RGBA8 keeps the bytes of the file as is (cf. DecodedImage::IsSRGB) while float4 is always linear, sRGB sources are decoded.
+//
+#pragma once
+
+#pragma unmanaged
+#include "DirectXTex.h"
+#pragma managed
+
+using namespace System;
+using namespace System::Collections::Concurrent;
+using namespace System::Threading;
+using namespace System::Threading::Tasks;
+
+namespace DirectXTexManaged {
+
+	public enum class	DECODED_FORMAT
+	{
+		RGBA8,		// 4 bytes per pixel
+		FLOAT4,		// 16 bytes per pixel
+	};
+
+	public ref class DecodedImage
+	{
+	internal:
+		String^				m_FileName;
+		int					m_Width;
+		int					m_Height;
+		DECODED_FORMAT		m_Format;
+		bool				m_bSRGB;
+		cli::array<Byte>^	m_Pixels;
+
+	public:		// PROPERTIES
+
+		property String^			FileName	{ String^ get() { return m_FileName; } }
+		property int				Width		{ int get() { return m_Width; } }
+		property int				Height		{ int get() { return m_Height; } }
+		property DECODED_FORMAT		Format		{ DECODED_FORMAT get() { return m_Format; } }
+		property int				Stride		{ int get() { return m_Width * (m_Format == DECODED_FORMAT::FLOAT4 ? 16 : 4); } }
+
+		// True if the RGBA8 pixels are sRGB-encoded
+		property bool				IsSRGB		{ bool get() { return m_bSRGB; } }
+
+		// The rows of pixels, from top to bottom (nullptr once recycled)
+		property cli::array<Byte>^	Pixels		{ cli::array<Byte>^ get() { return m_Pixels; } }
+	};
+
+	public ref class ImageDecoder
+	{
+	private:	// CONSTANTS
+
+		static const int	MAX_POOLED_BUFFERS_PER_SIZE = 8;
+
+	private:	// NESTED TYPES
+
+		// A file waiting for a worker
+		ref class	Request
+		{
+		public:
+			String^									m_FileName;
+			DECODED_FORMAT							m_Format;
+			TaskCompletionSource<DecodedImage^>^	m_Completion;
+
+			Request( String^ _FileName, DECODED_FORMAT _Format ) : m_FileName( _FileName ), m_Format( _Format ), m_Completion( gcnew TaskCompletionSource<DecodedImage^>() ) {}
+		};
+
+	private:	// FIELDS
+
+		BlockingCollection<Request^>^					m_Queue;
+		cli::array<Thread^>^							m_Workers;
+		cli::array<ConcurrentBag<cli::array<Byte>^>^>^	m_Pool;		// Free buffers indexed by the log2 of their size
+
+	public:		// PROPERTIES
+
+		property int	WorkersCount	{ int get() { return m_Workers->Length; } }
+
+		// The amount of files waiting for a worker
+		property int	QueuedCount		{ int get() { return m_Queue->Count; } }
+
+	public:		// METHODS
+
+		// _WorkersCount, the amount of files decoded concurrently (0 for a worker per processor)
+		// _MaxQueuedCount, the amount of files that can wait for a worker before Decode() blocks
+		ImageDecoder( int _WorkersCount, int _MaxQueuedCount );
+		~ImageDecoder();
+
+		// Queues a file, the task completes with the image or faults if it couldn't be decoded
+		Task<DecodedImage^>^				Decode( String^ _FileName, DECODED_FORMAT _Format );
+
+		// Queues several files, the tasks are in the same order
+		cli::array<Task<DecodedImage^>^>^	Decode( cli::array<String^>^ _FileNames, DECODED_FORMAT _Format );
+
+		// Gives the pixel buffer of an image back to the pool, the image can't be used anymore
+		void	Recycle( DecodedImage^ _Image );
+
+	private:
+
+		void				WorkerLoop();
+		DecodedImage^		DecodeFile( Request^ _Request );
+		void				CopyPixels( const DirectX::Image& _Source, DecodedImage^ _Target );
+
+		cli::array<Byte>^	AcquireBuffer( int _Size );
+		static int			GetPoolIndex( int _Size );
+	};
+}
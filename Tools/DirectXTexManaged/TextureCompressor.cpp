@@ -0,0 +1,248 @@
+// This is the main DLL file.
+
+#include "stdafx.h"
+
+#include "DirectXTexManaged.h"
+
+#include <vcclr.h>
+
+#include "../../RendererD3D11/Components/Texture2D.h"
+
+namespace DirectXTexManaged {
+
+	TextureCompressor::TextureCompressor( RendererManaged::Device^ _Device )
+		: m_Device( _Device )
+		, m_UseGPU( _Device != nullptr )
+		, m_MaxConcurrency( Environment::ProcessorCount )
+	{
+		m_Jobs = gcnew List<Job^>();
+	}
+
+	TextureCompressor::~TextureCompressor()
+	{
+		Clear();
+	}
+
+	void	TextureCompressor::Add( String^ _FileName, RendererManaged::Texture2D^ _Texture, COMPRESSED_FORMAT _Format )
+	{
+		DirectX::ScratchImage*	pSource = new DirectX::ScratchImage();
+		TextureCreator::ReadBack( *((::Texture2D*) _Texture->GetWrappedtexture()), *pSource );
+		Add( _FileName, pSource, _Format );
+	}
+
+	void	TextureCompressor::Add( String^ _FileName, String^ _SourceFileName, COMPRESSED_FORMAT _Format )
+	{
+		pin_ptr<const wchar_t>	wpSourceFileName = PtrToStringChars( _SourceFileName );
+
+		DirectX::ScratchImage*	pSource = new DirectX::ScratchImage();
+		HRESULT	hr = DirectX::LoadFromDDSFile( wpSourceFileName, DirectX::DDS_FLAGS_NONE, NULL, *pSource );
+		if ( FAILED( hr ) || DirectX::IsCompressed( pSource->GetMetadata().format ) )
+		{
+			delete pSource;
+			throw gcnew Exception( "Failed to load \"" + _SourceFileName + "\" or the file is already compressed!" );
+		}
+
+		Add( _FileName, pSource, _Format );
+	}
+
+	void	TextureCompressor::Add( String^ _FileName, cli::array< cli::array<WMath::Vector4D^,2>^ >^ _Mips, COMPRESSED_FORMAT _Format )
+	{
+		int	MipsCount = _Mips->Length;
+		int	Width = _Mips[0]->GetLength( 0 );
+		int	Height = _Mips[0]->GetLength( 1 );
+
+		DirectX::ScratchImage*	pSource = new DirectX::ScratchImage();
+		HRESULT	hr = pSource->Initialize2D( DXGI_FORMAT_R32G32B32A32_FLOAT, Width, Height, 1, MipsCount );
+		if ( FAILED( hr ) )
+		{
+			delete pSource;
+			throw gcnew Exception( "Failed to create the source image!" );
+		}
+
+		for ( int MipIndex=0; MipIndex < MipsCount; MipIndex++ )
+		{
+			int	W = Math::Max( 1, Width >> MipIndex );
+			int	H = Math::Max( 1, Height >> MipIndex );
+
+			cli::array<WMath::Vector4D^,2>^	Content = _Mips[MipIndex];
+			const DirectX::Image*			pImage = pSource->GetImage( MipIndex, 0, 0 );
+			for ( int Y=0; Y < H; Y++ )
+			{
+				float*	pScanline = (float*) (pImage->pixels + Y * pImage->rowPitch);
+				for ( int X=0; X < W; X++ )
+				{
+					WMath::Vector4D^	Value = Content[X,Y];
+					*pScanline++ = Value->x;
+					*pScanline++ = Value->y;
+					*pScanline++ = Value->z;
+					*pScanline++ = Value->w;
+				}
+			}
+		}
+
+		Add( _FileName, pSource, _Format );
+	}
+
+	void	TextureCompressor::Add( String^ _FileName, DirectX::ScratchImage* _pSource, COMPRESSED_FORMAT _Format )
+	{
+		m_Jobs->Add( gcnew Job( _FileName, GetDXGIFormat( _Format ), _pSource ) );
+	}
+
+	void	TextureCompressor::Clear()
+	{
+		for each ( Job^ J in m_Jobs )
+			delete J;
+		m_Jobs->Clear();
+	}
+
+	void	TextureCompressor::Compress( CompressionProgressDelegate^ _Progress, CancellationToken _Cancel )
+	{
+		// Split the jobs into images, BC6H & BC7 images go to the GPU encoder when possible
+		m_CPUItems = gcnew List<WorkItem^>();
+		List<WorkItem^>^	GPUItems = gcnew List<WorkItem^>();
+		for each ( Job^ J in m_Jobs )
+		{
+			List<WorkItem^>^	Items = m_UseGPU && J->UseGPUEncoder() ? GPUItems : m_CPUItems;
+			for ( int ImageIndex=0; ImageIndex < J->GetImagesCount(); ImageIndex++ )
+				Items->Add( gcnew WorkItem( J, ImageIndex ) );
+		}
+
+		m_CompressedCount = 0;
+		m_TotalCount = m_CPUItems->Count + GPUItems->Count;
+		m_Progress = _Progress;
+
+		// Few images are better split between threads by DirectXTex itself
+		m_CPUFlags = m_CPUItems->Count < m_MaxConcurrency ? DirectX::TEX_COMPRESS_PARALLEL : DirectX::TEX_COMPRESS_DEFAULT;
+
+		m_Options = gcnew ParallelOptions();
+		m_Options->CancellationToken = _Cancel;
+		m_Options->MaxDegreeOfParallelism = m_MaxConcurrency;
+
+		Task^	CPUTask = Task::Factory->StartNew( gcnew Action( this, &TextureCompressor::CompressOnCPU ) );
+
+		// Encode the GPU images on this thread meanwhile
+		Exception^	GPUException = nullptr;
+		try
+		{
+			for each ( WorkItem^ Item in GPUItems )
+			{
+				_Cancel.ThrowIfCancellationRequested();
+				CompressImage( Item, true );
+			}
+		}
+		catch ( Exception^ _e )
+		{
+			GPUException = _e;
+		}
+
+		try
+		{
+			CPUTask->Wait();
+		}
+		catch ( AggregateException^ _e )
+		{
+			_Cancel.ThrowIfCancellationRequested();
+			throw gcnew Exception( "Failed to compress the textures!", _e->InnerException );
+		}
+
+		_Cancel.ThrowIfCancellationRequested();
+		if ( GPUException != nullptr )
+			throw gcnew Exception( "Failed to compress the textures!", GPUException );
+
+		m_CPUItems = nullptr;
+		m_Progress = nullptr;
+
+		for each ( Job^ J in m_Jobs )
+			J->Save();
+		Clear();
+	}
+
+	void	TextureCompressor::CompressOnCPU()
+	{
+		Parallel::For( 0, m_CPUItems->Count, m_Options, gcnew Action<int>( this, &TextureCompressor::CompressCPUItem ) );
+	}
+
+	void	TextureCompressor::CompressImage( WorkItem^ _Item, bool _bGPU )
+	{
+		Job^					J = _Item->m_Job;
+		const DirectX::Image&	Source = J->m_pSource->GetImages()[_Item->m_ImageIndex];
+
+		DirectX::ScratchImage*	pCompressed = new DirectX::ScratchImage();
+		HRESULT	hr = _bGPU	? DirectX::Compress( &((::Device*) m_Device->GetWrappedDevice())->DXDevice(), Source, J->m_Format, *pCompressed )
+							: DirectX::Compress( Source, J->m_Format, m_CPUFlags, 0.5f, *pCompressed );
+		if ( FAILED( hr ) )
+		{
+			delete pCompressed;
+			throw gcnew Exception( String::Format( "Failed to compress image {0} of \"{1}\" (0x{2:X8})!", _Item->m_ImageIndex, J->m_FileName, hr ) );
+		}
+
+		delete J->m_ppCompressed[_Item->m_ImageIndex];	// From a previous cancelled compression
+		J->m_ppCompressed[_Item->m_ImageIndex] = pCompressed;
+
+		int	CompressedCount = Interlocked::Increment( m_CompressedCount );
+		if ( m_Progress != nullptr )
+			m_Progress( CompressedCount, m_TotalCount );
+	}
+
+	DXGI_FORMAT	TextureCompressor::GetDXGIFormat( COMPRESSED_FORMAT _Format )
+	{
+		switch ( _Format )
+		{
+		case COMPRESSED_FORMAT::BC1_UNORM:		return DXGI_FORMAT_BC1_UNORM;
+		case COMPRESSED_FORMAT::BC1_UNORM_sRGB:	return DXGI_FORMAT_BC1_UNORM_SRGB;
+		case COMPRESSED_FORMAT::BC3_UNORM:		return DXGI_FORMAT_BC3_UNORM;
+		case COMPRESSED_FORMAT::BC3_UNORM_sRGB:	return DXGI_FORMAT_BC3_UNORM_SRGB;
+		case COMPRESSED_FORMAT::BC4_UNORM:		return DXGI_FORMAT_BC4_UNORM;
+		case COMPRESSED_FORMAT::BC4_SNORM:		return DXGI_FORMAT_BC4_SNORM;
+		case COMPRESSED_FORMAT::BC5_UNORM:		return DXGI_FORMAT_BC5_UNORM;
+		case COMPRESSED_FORMAT::BC5_SNORM:		return DXGI_FORMAT_BC5_SNORM;
+		case COMPRESSED_FORMAT::BC6H_UF16:		return DXGI_FORMAT_BC6H_UF16;
+		case COMPRESSED_FORMAT::BC6H_SF16:		return DXGI_FORMAT_BC6H_SF16;
+		case COMPRESSED_FORMAT::BC7_UNORM:		return DXGI_FORMAT_BC7_UNORM;
+		case COMPRESSED_FORMAT::BC7_UNORM_sRGB:	return DXGI_FORMAT_BC7_UNORM_SRGB;
+		}
+		throw gcnew Exception( "Unsupported compressed format!" );
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+	// Job
+	TextureCompressor::Job::Job( String^ _FileName, DXGI_FORMAT _Format, DirectX::ScratchImage* _pSource )
+		: m_FileName( _FileName )
+		, m_Format( _Format )
+		, m_pSource( _pSource )
+	{
+		m_ppCompressed = new DirectX::ScratchImage*[_pSource->GetImageCount()];
+		memset( m_ppCompressed, 0, _pSource->GetImageCount() * sizeof(DirectX::ScratchImage*) );
+	}
+
+	TextureCompressor::Job::!Job()
+	{
+		if ( m_pSource == NULL )
+			return;
+
+		for ( size_t ImageIndex=0; ImageIndex < m_pSource->GetImageCount(); ImageIndex++ )
+			delete m_ppCompressed[ImageIndex];
+		delete[] m_ppCompressed;
+		delete m_pSource;
+		m_pSource = NULL;
+	}
+
+	void	TextureCompressor::Job::Save()
+	{
+		// The compressed images are in the same order as the source ones
+		size_t				ImagesCount = m_pSource->GetImageCount();
+		DirectX::Image*		pImages = new DirectX::Image[ImagesCount];
+		for ( size_t ImageIndex=0; ImageIndex < ImagesCount; ImageIndex++ )
+			pImages[ImageIndex] = *m_ppCompressed[ImageIndex]->GetImage( 0, 0, 0 );
+
+		DirectX::TexMetadata	Meta = m_pSource->GetMetadata();
+		Meta.format = m_Format;
+
+		pin_ptr<const wchar_t>	wpFileName = PtrToStringChars( m_FileName );
+		HRESULT	hr = DirectX::SaveToDDSFile( pImages, ImagesCount, Meta, DirectX::DDS_FLAGS_FORCE_DX10_EXT, wpFileName );
+		delete[] pImages;
+
+		if ( FAILED( hr ) )
+			throw gcnew Exception( "Failed to save \"" + m_FileName + "\"!" );
+	}
+}
@@ -0,0 +1,148 @@
+// TextureCompressor.h
+// Compresses batches of textures into BCn DDS files, all the images (i.e. mip levels and array slices) of all the queued
+//	textures being compressed concurrently.
+//
+// Usage:
+//	TextureCompressor^	Compressor = gcnew TextureCompressor( Device );	// nullptr to only use the CPU
+//	Compressor->Add( "Albedo.dds", AlbedoTexture, COMPRESSED_FORMAT::BC7_UNORM_sRGB );
+//	Compressor->Add( "Normal.dds", "NormalRGBA32F.dds", COMPRESSED_FORMAT::BC5_SNORM );
+//	Compressor->Compress( gcnew CompressionProgressDelegate( this, &Form::OnProgress ), CancelSource->Token );
+//
+// When a device is provided, BC6H and BC7 images are encoded by DirectXTex's DirectCompute encoder on the calling thread
+//	while the workers compress the other formats on the CPU. The CPU encoder splits each image between threads by itself
+//	when there are fewer images than workers.
+//
+// NOTE: Compress() must be called from the thread using the device since the GPU encoder uses its immediate context.
+// The progress delegate is called from any thread each time an image has been compressed.
+// No file is written if the compression is cancelled, the jobs stay queued until Compress() succeeds or Clear() is called.
+//
+#pragma once
+
+#pragma unmanaged
+#include "DirectXTex.h"
+#pragma managed
+
+#include "../../RendererD3D11/Device.h"
+
+using namespace System;
+using namespace System::Collections::Generic;
+using namespace System::Threading;
+using namespace System::Threading::Tasks;
+
+namespace DirectXTexManaged {
+
+	public enum class	COMPRESSED_FORMAT
+	{
+		BC1_UNORM,
+		BC1_UNORM_sRGB,
+		BC3_UNORM,
+		BC3_UNORM_sRGB,
+		BC4_UNORM,
+		BC4_SNORM,
+		BC5_UNORM,
+		BC5_SNORM,
+		BC6H_UF16,
+		BC6H_SF16,
+		BC7_UNORM,
+		BC7_UNORM_sRGB,
+	};
+
+	public delegate void	CompressionProgressDelegate( int _CompressedImagesCount, int _TotalImagesCount );
+
+	public ref class TextureCompressor
+	{
+	private:	// NESTED TYPES
+
+		// A texture to compress into a DDS file
+		ref class	Job
+		{
+		public:
+			String^					m_FileName;
+			DXGI_FORMAT				m_Format;
+			DirectX::ScratchImage*	m_pSource;
+			DirectX::ScratchImage**	m_ppCompressed;	// One per source image
+
+		public:
+			Job( String^ _FileName, DXGI_FORMAT _Format, DirectX::ScratchImage* _pSource );
+			~Job()	{ this->!Job(); }
+			!Job();
+
+			int		GetImagesCount()	{ return int( m_pSource->GetImageCount() ); }
+			bool	UseGPUEncoder()		{ return m_Format >= DXGI_FORMAT_BC6H_TYPELESS && m_Format <= DXGI_FORMAT_BC7_UNORM_SRGB; }
+
+			void	Save();
+		};
+
+		ref class	WorkItem
+		{
+		public:
+			Job^	m_Job;
+			int		m_ImageIndex;
+
+			WorkItem( Job^ _Job, int _ImageIndex ) : m_Job( _Job ), m_ImageIndex( _ImageIndex ) {}
+		};
+
+	private:	// FIELDS
+
+		RendererManaged::Device^	m_Device;
+		bool						m_UseGPU;
+		int							m_MaxConcurrency;
+		List<Job^>^					m_Jobs;
+
+		// Current compression
+		List<WorkItem^>^			m_CPUItems;
+		ParallelOptions^			m_Options;
+		DWORD						m_CPUFlags;
+		int							m_CompressedCount;
+		int							m_TotalCount;
+		CompressionProgressDelegate^	m_Progress;
+
+	public:		// PROPERTIES
+
+		// True to encode BC6H & BC7 on the GPU (the default when a device is provided)
+		property bool	UseGPU
+		{
+			bool	get()			{ return m_UseGPU; }
+			void	set( bool _Value )	{ m_UseGPU = _Value && m_Device != nullptr; }
+		}
+
+		// The maximum amount of images compressed concurrently on the CPU (defaults to the amount of processors)
+		property int	MaxConcurrency
+		{
+			int		get()			{ return m_MaxConcurrency; }
+			void	set( int _Value )	{ m_MaxConcurrency = Math::Max( 1, _Value ); }
+		}
+
+		property int	JobsCount	{ int get() { return m_Jobs->Count; } }
+
+	public:		// METHODS
+
+		TextureCompressor( RendererManaged::Device^ _Device );
+		~TextureCompressor();
+
+		// Queues a texture, read back immediately so it can be released once added
+		void	Add( String^ _FileName, RendererManaged::Texture2D^ _Texture, COMPRESSED_FORMAT _Format );
+
+		// Queues an uncompressed DDS file
+		void	Add( String^ _FileName, String^ _SourceFileName, COMPRESSED_FORMAT _Format );
+
+		// Queues a mip chain of RGBA images
+		void	Add( String^ _FileName, cli::array< cli::array<WMath::Vector4D^,2>^ >^ _Mips, COMPRESSED_FORMAT _Format );
+
+		// Compresses all the queued textures then writes their DDS files
+		// Throws an OperationCanceledException if _Cancel was signaled before all the images were compressed
+		void	Compress( CompressionProgressDelegate^ _Progress, CancellationToken _Cancel );
+		void	Compress()	{ Compress( nullptr, CancellationToken::None ); }
+
+		void	Clear();
+
+	private:
+
+		void	Add( String^ _FileName, DirectX::ScratchImage* _pSource, COMPRESSED_FORMAT _Format );
+		void	CompressOnCPU();
+		void	CompressCPUItem( int _ItemIndex )	{ CompressImage( m_CPUItems[_ItemIndex], false ); }
+		void	CompressImage( WorkItem^ _Item, bool _bGPU );
+
+		static DXGI_FORMAT	GetDXGIFormat( COMPRESSED_FORMAT _Format );
+	};
+}
@@ -0,0 +1,260 @@
+#include "stdafx.h"
+
+Batch::Batch( const char* _pManifestFileName ) : m_ManifestFileName( _pManifestFileName )
+{
+	m_HashesFileName = m_ManifestFileName + ".hashes";
+}
+
+int		Batch::Run( int _JobsCount, bool _bVerbose, bool _bForce )
+{
+	if ( !ReadManifest() )
+	{
+		fprintf( stderr, "Failed to read manifest \"%s\"!\n", m_ManifestFileName.c_str() );
+		return -1;
+	}
+	if ( !_bForce )
+		ReadHashes();
+
+	// Hash the sources to find the ones that changed since their last conversion
+	int	FailedCount = 0;
+	std::vector<int>	PendingEntries;
+	for ( int EntryIndex=0; EntryIndex < int(m_Entries.size()); EntryIndex++ )
+	{
+		Entry&	E = m_Entries[EntryIndex];
+		if ( !HashFile( E.Source.c_str(), E.Hash ) )
+		{
+			fprintf( stderr, "Can't read source \"%s\"!\n", E.Source.c_str() );
+			E.ExitCode = DWORD(-1);
+			FailedCount++;
+			continue;
+		}
+
+		std::map<std::string, unsigned __int64>::const_iterator	Previous = m_Hashes.find( E.Target );
+		E.bSkipped = Previous != m_Hashes.end() && Previous->second == E.Hash && GetFileAttributesA( E.Target.c_str() ) != INVALID_FILE_ATTRIBUTES;
+		if ( !E.bSkipped )
+			PendingEntries.push_back( EntryIndex );
+	}
+
+	// Run the conversions, starting a new one each time one completes
+	if ( _JobsCount <= 0 )
+	{
+		SYSTEM_INFO	SystemInfo;
+		GetSystemInfo( &SystemInfo );
+		_JobsCount = int(SystemInfo.dwNumberOfProcessors);
+	}
+	_JobsCount = min( _JobsCount, MAXIMUM_WAIT_OBJECTS );
+
+	std::vector<HANDLE>	Processes;
+	std::vector<int>	ProcessEntries;
+	int	NextPending = 0;
+	while ( NextPending < int(PendingEntries.size()) || Processes.size() > 0 )
+	{
+		while ( NextPending < int(PendingEntries.size()) && int(Processes.size()) < _JobsCount )
+		{
+			int		EntryIndex = PendingEntries[NextPending++];
+			Entry&	E = m_Entries[EntryIndex];
+			HANDLE	hProcess = StartConversion( E, _bVerbose );
+			if ( hProcess == NULL )
+			{
+				fprintf( stderr, "Failed to start the conversion of \"%s\"!\n", E.Source.c_str() );
+				E.ExitCode = DWORD(-1);
+				FailedCount++;
+				continue;
+			}
+
+			Processes.push_back( hProcess );
+			ProcessEntries.push_back( EntryIndex );
+		}
+		if ( Processes.size() == 0 )
+			break;
+
+		DWORD	Result = WaitForMultipleObjects( DWORD(Processes.size()), &Processes[0], FALSE, INFINITE );
+		int		ProcessIndex = int(Result - WAIT_OBJECT_0);
+		if ( ProcessIndex < 0 || ProcessIndex >= int(Processes.size()) )
+			break;	// Shouldn't happen...
+
+		Entry&	E = m_Entries[ProcessEntries[ProcessIndex]];
+		if ( !GetExitCodeProcess( Processes[ProcessIndex], &E.ExitCode ) )
+			E.ExitCode = DWORD(-1);
+		CloseHandle( Processes[ProcessIndex] );
+		Processes.erase( Processes.begin() + ProcessIndex );
+		ProcessEntries.erase( ProcessEntries.begin() + ProcessIndex );
+
+		if ( E.ExitCode == 0 )
+		{
+			printf( "Converted \"%s\"\n", E.Target.c_str() );
+			m_Hashes[E.Target] = E.Hash;
+		}
+		else
+		{
+			fprintf( stderr, "Failed to convert \"%s\" (exit code %d)\n", E.Source.c_str(), int(E.ExitCode) );
+			m_Hashes.erase( E.Target );
+			FailedCount++;
+		}
+	}
+
+	WriteHashes();
+
+	int	SkippedCount = 0;
+	for ( int EntryIndex=0; EntryIndex < int(m_Entries.size()); EntryIndex++ )
+		SkippedCount += m_Entries[EntryIndex].bSkipped ? 1 : 0;
+	printf( "%d files: %d converted, %d unchanged, %d failed\n", int(m_Entries.size()), int(m_Entries.size()) - SkippedCount - FailedCount, SkippedCount, FailedCount );
+
+	return FailedCount;
+}
+
+bool	Batch::ReadManifest()
+{
+	FILE*	pFile = NULL;
+	if ( fopen_s( &pFile, m_ManifestFileName.c_str(), "rt" ) != 0 || pFile == NULL )
+		return false;
+
+	char	pLine[4096];
+	int		LineIndex = 0;
+	while ( fgets( pLine, sizeof(pLine), pFile ) != NULL )
+	{
+		LineIndex++;
+		const char*	pCurrent = pLine;
+		std::string	Source, Target;
+		if ( !ReadToken( pCurrent, Source ) || Source[0] == '#' )
+			continue;	// Empty line or comment
+		if ( !ReadToken( pCurrent, Target ) )
+		{
+			fprintf( stderr, "%s(%d): missing target file name!\n", m_ManifestFileName.c_str(), LineIndex );
+			continue;
+		}
+
+		Entry	E;
+		E.Source = ResolvePath( Source );
+		E.Target = ResolvePath( Target );
+		E.Hash = 0;
+		E.bSkipped = false;
+		E.ExitCode = 0;
+		m_Entries.push_back( E );
+	}
+
+	fclose( pFile );
+	return true;
+}
+
+void	Batch::ReadHashes()
+{
+	FILE*	pFile = NULL;
+	if ( fopen_s( &pFile, m_HashesFileName.c_str(), "rt" ) != 0 || pFile == NULL )
+		return;	// First run
+
+	char	pLine[4096];
+	while ( fgets( pLine, sizeof(pLine), pFile ) != NULL )
+	{
+		const char*			pCurrent = pLine;
+		std::string			HashText, Target;
+		if ( !ReadToken( pCurrent, HashText ) || !ReadToken( pCurrent, Target ) )
+			continue;
+
+		m_Hashes[Target] = _strtoui64( HashText.c_str(), NULL, 16 );
+	}
+
+	fclose( pFile );
+}
+
+void	Batch::WriteHashes() const
+{
+	FILE*	pFile = NULL;
+	if ( fopen_s( &pFile, m_HashesFileName.c_str(), "wt" ) != 0 || pFile == NULL )
+	{
+		fprintf( stderr, "Failed to write \"%s\", the next batch will convert everything again!\n", m_HashesFileName.c_str() );
+		return;
+	}
+
+	for ( std::map<std::string, unsigned __int64>::const_iterator It = m_Hashes.begin(); It != m_Hashes.end(); ++It )
+		fprintf( pFile, "%016I64X \"%s\"\n", It->second, It->first.c_str() );
+
+	fclose( pFile );
+}
+
+// Runs this executable on a single file
+HANDLE	Batch::StartConversion( const Entry& _Entry, bool _bVerbose ) const
+{
+	char	pExecutable[MAX_PATH];
+	if ( GetModuleFileNameA( NULL, pExecutable, MAX_PATH ) == 0 )
+		return NULL;
+
+	std::string	CommandLine = std::string( "\"" ) + pExecutable + "\"" + (_bVerbose ? "" : " -quiet") + " \"" + _Entry.Source + "\" \"" + _Entry.Target + "\"";
+
+	STARTUPINFOA		StartupInfo;
+	PROCESS_INFORMATION	ProcessInfo;
+	memset( &StartupInfo, 0, sizeof(StartupInfo) );
+	StartupInfo.cb = sizeof(StartupInfo);
+	if ( !CreateProcessA( NULL, &CommandLine[0], NULL, NULL, FALSE, 0, NULL, NULL, &StartupInfo, &ProcessInfo ) )
+		return NULL;
+
+	CloseHandle( ProcessInfo.hThread );
+	return ProcessInfo.hProcess;
+}
+
+bool	Batch::HashFile( const char* _pFileName, unsigned __int64& _Hash )
+{
+	HANDLE	hFile = CreateFileA( _pFileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+	if ( hFile == INVALID_HANDLE_VALUE )
+		return false;
+
+	static const DWORD	BUFFER_SIZE = 1 << 20;
+	unsigned char*		pBuffer = new unsigned char[BUFFER_SIZE];
+
+	unsigned __int64	Hash = 14695981039346656037ULL;
+	DWORD				ReadSize = 0;
+	bool				bSucceeded = true;
+	while ( (bSucceeded = ReadFile( hFile, pBuffer, BUFFER_SIZE, &ReadSize, NULL ) != FALSE) && ReadSize > 0 )
+		for ( DWORD i=0; i < ReadSize; i++ )
+		{
+			Hash ^= pBuffer[i];
+			Hash *= 1099511628211ULL;
+		}
+
+	delete[] pBuffer;
+	CloseHandle( hFile );
+
+	_Hash = Hash;
+	return bSucceeded;
+}
+
+std::string	Batch::ResolvePath( const std::string& _Path ) const
+{
+	bool	bAbsolute = (_Path.size() > 1 && _Path[1] == ':') || _Path[0] == '\\' || _Path[0] == '/';
+	if ( bAbsolute )
+		return _Path;
+
+	size_t	DirectoryEnd = m_ManifestFileName.find_last_of( "\\/" );
+	if ( DirectoryEnd == std::string::npos )
+		return _Path;
+
+	return m_ManifestFileName.substr( 0, DirectoryEnd+1 ) + _Path;
+}
+
+// Reads the next space-separated or double-quoted token, returns false at the end of the line
+bool	Batch::ReadToken( const char*& _pLine, std::string& _Token )
+{
+	while ( *_pLine == ' ' || *_pLine == '\t' )
+		_pLine++;
+	if ( *_pLine == '\0' || *_pLine == '\n' || *_pLine == '\r' )
+		return false;
+
+	const char*	pStart = _pLine;
+	if ( *_pLine == '"' )
+	{
+		pStart = ++_pLine;
+		while ( *_pLine != '\0' && *_pLine != '"' && *_pLine != '\n' )
+			_pLine++;
+		_Token.assign( pStart, _pLine );
+		if ( *_pLine == '"' )
+			_pLine++;
+	}
+	else
+	{
+		while ( *_pLine != '\0' && *_pLine != ' ' && *_pLine != '\t' && *_pLine != '\n' && *_pLine != '\r' )
+			_pLine++;
+		_Token.assign( pStart, _pLine );
+	}
+
+	return _Token.size() > 0;
+}
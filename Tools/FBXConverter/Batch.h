@@ -0,0 +1,53 @@
+#pragma once
+#include "stdafx.h"
+
+//////////////////////////////////////////////////////////////////////////
+// Batch conversion of a manifest of FBX files
+//
+// The manifest lists one conversion per line: <Source.fbx> <Target.scene>
+//	_ Paths containing spaces go between double quotes, relative paths are relative to the manifest's directory
+//	_ Empty lines and lines starting with '#' are ignored
+//
+// Each conversion runs in its own child process of the converter (the FBX SDK isn't thread-safe) with up to
+//	_JobsCount processes at once. The content hash of every successfully converted source is recorded in
+//	"<Manifest>.hashes" and the sources whose hash didn't change since are skipped, as long as their target exists.
+//
+class Batch
+{
+public:
+
+	struct	Entry
+	{
+		std::string			Source;
+		std::string			Target;
+		unsigned __int64	Hash;
+		bool				bSkipped;
+		DWORD				ExitCode;
+	};
+
+protected:
+
+	std::string			m_ManifestFileName;
+	std::string			m_HashesFileName;
+	std::vector<Entry>	m_Entries;
+	std::map<std::string, unsigned __int64>	m_Hashes;	// Source hashes of the last successful conversions, keyed by target
+
+public:
+	Batch( const char* _pManifestFileName );
+
+	// Returns the amount of failed conversions, or -1 if the manifest couldn't be read
+	// _bVerbose lets the child processes print their dumps, _bForce converts even the unchanged sources
+	int		Run( int _JobsCount, bool _bVerbose, bool _bForce );
+
+	// 64-bits FNV-1a hash of a file's content, returns false if the file can't be read
+	static bool	HashFile( const char* _pFileName, unsigned __int64& _Hash );
+
+protected:
+	bool	ReadManifest();
+	void	ReadHashes();
+	void	WriteHashes() const;
+	HANDLE	StartConversion( const Entry& _Entry, bool _bVerbose ) const;
+
+	std::string	ResolvePath( const std::string& _Path ) const;
+	static bool	ReadToken( const char*& _pLine, std::string& _Token );
+};
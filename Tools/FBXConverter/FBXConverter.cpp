@@ -3,16 +3,19 @@
 
 #include "stdafx.h"
 
-#undef FBXSDK_printf
-#define FBXSDK_printf	ConsolePrint
+bool	gs_bVerbose = true;
 
 void	ConsolePrint( const char* _pText, ... )
 {
+	if ( !gs_bVerbose )
+		return;	// Formatting and outputting the dumps is a large part of the conversion time on big scenes
+
 	va_list	argptr;
 	va_start( argptr,  _pText );
 
 	char	pTemp[16384];
 	vsprintf_s( pTemp, 16384, _pText, argptr );
+	va_end( argptr );
 
 	OutputDebugString( pTemp );
 }
@@ -915,7 +918,8 @@ void	DisplayTexture(FbxGeometry* pGeometry)
 // 	}
 // }
 
-void DisplayContent( FbxNode* _pNode, Node* _pParent )
+// Builds our node hierarchy and lists the meshes in depth-first order (they are converted later, cf. ConvertMeshes())
+void DisplayContent( FbxNode* _pNode, Node* _pParent, std::vector<Mesh*>& _Meshes )
 {
 	Node*	pMyNode = NULL;
 
@@ -939,7 +943,9 @@ void DisplayContent( FbxNode* _pNode, Node* _pParent )
 		case FbxNodeAttribute::eMesh:
 			{
 				FbxMesh*	pMesh = (FbxMesh*) _pNode->GetNodeAttribute();
-				pMyNode = new Mesh( *pMesh, _pParent );
+				Mesh*		pMyMesh = new Mesh( *pMesh, _pParent );
+				_Meshes.push_back( pMyMesh );
+				pMyNode = pMyMesh;
 			}
 			break;
 
@@ -969,20 +975,61 @@ void DisplayContent( FbxNode* _pNode, Node* _pParent )
 		pMyNode = new Node( *_pNode, _pParent );
 
 	for ( int i=0; i < _pNode->GetChildCount(); i++ )
-		DisplayContent( _pNode->GetChild( i ), pMyNode );
+		DisplayContent( _pNode->GetChild( i ), pMyNode, _Meshes );
 }
 
-int _tmain( int argc, char* argv[] )
+//////////////////////////////////////////////////////////////////////////
+// Converts the meshes on a pool of worker threads
+// Each worker grabs the next mesh to convert until there's none left. Meshes only write into their own data
+//	and stay in the node hierarchy's order, so the output doesn't depend on the amount of threads or on scheduling.
+struct	ConvertMeshesContext
+{
+	std::vector<Mesh*>*	pMeshes;
+	volatile LONG		NextMeshIndex;
+};
+
+DWORD WINAPI	ConvertMeshesThread( LPVOID _pParam )
 {
-	// The example can take a FBX file as an argument.
-	if ( argc != 3 )
+	ConvertMeshesContext&	Context = *((ConvertMeshesContext*) _pParam);
+	while ( true )
 	{
-		FBXSDK_printf("\n\nUsage: FBXConverter <FBX file name> <Target file name.scene>\n\n");
-		return -1;
+		LONG	MeshIndex = InterlockedIncrement( &Context.NextMeshIndex ) - 1;
+		if ( MeshIndex >= LONG(Context.pMeshes->size()) )
+			break;
+
+		(*Context.pMeshes)[MeshIndex]->Convert();
 	}
+	return 0;
+}
 
-	FbxString	SourceFilePath = argv[1];
-	FbxString	TargetFilePath = argv[2];
+void	ConvertMeshes( std::vector<Mesh*>& _Meshes )
+{
+	SYSTEM_INFO	SystemInfo;
+	GetSystemInfo( &SystemInfo );
+	int	ThreadsCount = int(SystemInfo.dwNumberOfProcessors);
+	if ( ThreadsCount > int(_Meshes.size()) )
+		ThreadsCount = int(_Meshes.size());
+
+	ConvertMeshesContext	Context;
+	Context.pMeshes = &_Meshes;
+	Context.NextMeshIndex = 0;
+
+	std::vector<HANDLE>	Threads;
+	for ( int ThreadIndex=1; ThreadIndex < ThreadsCount; ThreadIndex++ )
+		Threads.push_back( CreateThread( NULL, 0, ConvertMeshesThread, &Context, 0, NULL ) );
+
+	ConvertMeshesThread( &Context );	// The main thread does its share
+
+	if ( Threads.size() > 0 )
+		WaitForMultipleObjects( DWORD(Threads.size()), &Threads[0], TRUE, INFINITE );
+	for ( int ThreadIndex=0; ThreadIndex < int(Threads.size()); ThreadIndex++ )
+		CloseHandle( Threads[ThreadIndex] );
+}
+
+int	ConvertFile( const char* _pSourceFileName, const char* _pTargetFileName )
+{
+	FbxString	SourceFilePath = _pSourceFileName;
+	FbxString	TargetFilePath = _pTargetFileName;
 
 	// Prepare the FBX SDK.
 	FbxManager*	Manager = NULL;
@@ -995,10 +1042,51 @@ int _tmain( int argc, char* argv[] )
 		return -1;
 	}
 
-	DisplayContent( Scene->GetRootNode(), NULL );
+	std::vector<Mesh*>	Meshes;
+	DisplayContent( Scene->GetRootNode(), NULL, Meshes );
+	ConvertMeshes( Meshes );
 
 	if ( Manager )
 		Manager->Destroy();
 
 	return 0;
 }
+
+int _tmain( int argc, char* argv[] )
+{
+	const char*	pManifestFileName = NULL;
+	int			JobsCount = 0;	// As many as cores
+	bool		bForce = false;
+	bool		bVerboseBatch = false;
+	std::vector<const char*>	FileNames;
+	for ( int ArgIndex=1; ArgIndex < argc; ArgIndex++ )
+	{
+		if ( !_stricmp( argv[ArgIndex], "-quiet" ) )
+			gs_bVerbose = false;
+		else if ( !_stricmp( argv[ArgIndex], "-verbose" ) )
+			bVerboseBatch = true;
+		else if ( !_stricmp( argv[ArgIndex], "-force" ) )
+			bForce = true;
+		else if ( !_stricmp( argv[ArgIndex], "-batch" ) && ArgIndex+1 < argc )
+			pManifestFileName = argv[++ArgIndex];
+		else if ( !_stricmp( argv[ArgIndex], "-jobs" ) && ArgIndex+1 < argc )
+			JobsCount = atoi( argv[++ArgIndex] );
+		else
+			FileNames.push_back( argv[ArgIndex] );
+	}
+
+	if ( pManifestFileName != NULL && FileNames.size() == 0 )
+	{
+		Batch	B( pManifestFileName );
+		return B.Run( JobsCount, bVerboseBatch, bForce );
+	}
+
+	if ( FileNames.size() != 2 )
+	{
+		printf( "\n\nUsage: FBXConverter [-quiet] <FBX file name> <Target file name.scene>\n"
+				"       FBXConverter -batch <Manifest file name> [-jobs <Count>] [-verbose] [-force]\n\n" );
+		return -1;
+	}
+
+	return ConvertFile( FileNames[0], FileNames[1] );
+}
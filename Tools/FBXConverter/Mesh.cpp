@@ -14,12 +14,25 @@ Mesh::Mesh( FbxMesh& _Mesh, Node* _pParent ) : Node( *_Mesh.GetNode(), _pParent
 // // 	DisplayLink(&_Mesh);
 // // 	DisplayShape(&_Mesh);
 
+	m_VerticesCount = 0;
+	m_pVertices = NULL;
+}
+
+Mesh::~Mesh()
+{
+	delete[] m_pVertices;
+}
+
+// Reads back the streams of the FBX mesh then triangulates & welds them (cf. Weld())
+// This only accesses our own FbxMesh so several meshes can be converted concurrently, once the FBX import is complete
+void	Mesh::Convert()
+{
 	// Read back vertices
-	m_VerticesCount = _Mesh.GetControlPointsCount();
+	m_VerticesCount = m_Mesh.GetControlPointsCount();
 	m_pVertices = new Vertex[m_VerticesCount];
 	for ( int VertexIndex=0; VertexIndex < m_VerticesCount; VertexIndex++ )
 	{
-		FbxVector4	V = _Mesh.GetControlPointAt( VertexIndex );
+		FbxVector4	V = m_Mesh.GetControlPointAt( VertexIndex );
 		m_pVertices[VertexIndex].x = (float) (SCALE * V[0]);
 		m_pVertices[VertexIndex].y = (float) (SCALE * V[1]);
 		m_pVertices[VertexIndex].z = (float) (SCALE * V[2]);
@@ -27,41 +40,41 @@ Mesh::Mesh( FbxMesh& _Mesh, Node* _pParent ) : Node( *_Mesh.GetNode(), _pParent
 
 	// Count streams & store types
 	{
-		int	StreamsCount = _Mesh.GetElementUVCount();
+		int	StreamsCount = m_Mesh.GetElementUVCount();
 		for ( int i=0; i < StreamsCount; i++ )
 			m_StreamTypes.push_back( UV );
 	}
 	{
-		int	StreamsCount = _Mesh.GetElementNormalCount();
+		int	StreamsCount = m_Mesh.GetElementNormalCount();
 		for ( int i=0; i < StreamsCount; i++ )
 			m_StreamTypes.push_back( NORMAL );
 	}
 	{
-		int	StreamsCount = _Mesh.GetElementTangentCount();
+		int	StreamsCount = m_Mesh.GetElementTangentCount();
 		for ( int i=0; i < StreamsCount; i++ )
 			m_StreamTypes.push_back( TANGENT );
 	}
 	{
-		int	StreamsCount = _Mesh.GetElementBinormalCount();
+		int	StreamsCount = m_Mesh.GetElementBinormalCount();
 		for ( int i=0; i < StreamsCount; i++ )
 			m_StreamTypes.push_back( BITANGENT );
 	}
 	{
-		int	StreamsCount = _Mesh.GetElementVertexColorCount();
+		int	StreamsCount = m_Mesh.GetElementVertexColorCount();
 		for ( int i=0; i < StreamsCount; i++ )
 			m_StreamTypes.push_back( VERTEX_COLOR );
 	}
 
 	// Build temporary polygons
-	m_Polygons.resize( _Mesh.GetPolygonCount() );
+	m_Polygons.resize( m_Mesh.GetPolygonCount() );
 
 	// Treat streams in the same order as we stored the types
 
 	{	//////////////////////////////////////////////////////////////////////////
 		// UVs
-		for ( int i=0; i < _Mesh.GetElementUVCount(); i++ )
+		for ( int i=0; i < m_Mesh.GetElementUVCount(); i++ )
 		{
-			FbxGeometryElementUV* pUV = _Mesh.GetElementUV( i );
+			FbxGeometryElementUV* pUV = m_Mesh.GetElementUV( i );
 
 			bool	bDirect = pUV->GetReferenceMode() == FbxGeometryElement::eDirect;
 
@@ -74,10 +87,10 @@ Mesh::Mesh( FbxMesh& _Mesh, Node* _pParent ) : Node( *_Mesh.GetNode(), _pParent
 					{
 						Polygon&	P = m_Polygons[PolygonIndex];
 
-						int	PolygonVerticesCount = _Mesh.GetPolygonSize( PolygonIndex );
+						int	PolygonVerticesCount = m_Mesh.GetPolygonSize( PolygonIndex );
 						for ( int PolygonVertexIndex=0; PolygonVertexIndex < PolygonVerticesCount; PolygonVertexIndex++ )
 						{
-							int	PolygonControlPointIndex = _Mesh.GetPolygonVertex( PolygonIndex, PolygonVertexIndex );
+							int	PolygonControlPointIndex = m_Mesh.GetPolygonVertex( PolygonIndex, PolygonVertexIndex );
 							if ( bDirect )
 								P.m_UV0.push_back( pUV->GetDirectArray().GetAt( PolygonControlPointIndex ) );
 							else
@@ -96,7 +109,7 @@ Mesh::Mesh( FbxMesh& _Mesh, Node* _pParent ) : Node( *_Mesh.GetNode(), _pParent
 						{
 							Polygon&	P = m_Polygons[PolygonIndex];
 
-							int	PolygonVerticesCount = _Mesh.GetPolygonSize( PolygonIndex );
+							int	PolygonVerticesCount = m_Mesh.GetPolygonSize( PolygonIndex );
 							for ( int PolygonVertexIndex=0; PolygonVertexIndex < PolygonVerticesCount; PolygonVertexIndex++, VertexIndex++ )
 							{
 								if ( bDirect )
@@ -121,10 +134,10 @@ Mesh::Mesh( FbxMesh& _Mesh, Node* _pParent ) : Node( *_Mesh.GetNode(), _pParent
 					{
 						Polygon&	P = m_Polygons[PolygonIndex];
 
-						int	PolygonVerticesCount = _Mesh.GetPolygonSize( PolygonIndex );
+						int	PolygonVerticesCount = m_Mesh.GetPolygonSize( PolygonIndex );
 						for ( int PolygonVertexIndex=0; PolygonVertexIndex < PolygonVerticesCount; PolygonVertexIndex++ )
 						{
-							int	PolygonControlPointIndex = _Mesh.GetPolygonVertex( PolygonIndex, PolygonVertexIndex );
+							int	PolygonControlPointIndex = m_Mesh.GetPolygonVertex( PolygonIndex, PolygonVertexIndex );
 							if ( bDirect )
 								P.m_UV1.push_back( pUV->GetDirectArray().GetAt( PolygonControlPointIndex ) );
 							else
@@ -143,7 +156,7 @@ Mesh::Mesh( FbxMesh& _Mesh, Node* _pParent ) : Node( *_Mesh.GetNode(), _pParent
 						{
 							Polygon&	P = m_Polygons[PolygonIndex];
 
-							int	PolygonVerticesCount = _Mesh.GetPolygonSize( PolygonIndex );
+							int	PolygonVerticesCount = m_Mesh.GetPolygonSize( PolygonIndex );
 							for ( int PolygonVertexIndex=0; PolygonVertexIndex < PolygonVerticesCount; PolygonVertexIndex++, VertexIndex++ )
 							{
 								if ( bDirect )
@@ -168,9 +181,9 @@ Mesh::Mesh( FbxMesh& _Mesh, Node* _pParent ) : Node( *_Mesh.GetNode(), _pParent
 	
 	{	//////////////////////////////////////////////////////////////////////////
 		// Normals
-		for ( int i=0; i < _Mesh.GetElementNormalCount(); i++ )
+		for ( int i=0; i < m_Mesh.GetElementNormalCount(); i++ )
 		{
-			FbxGeometryElementNormal* pNormal = _Mesh.GetElementNormal( i );
+			FbxGeometryElementNormal* pNormal = m_Mesh.GetElementNormal( i );
 
 			bool	bDirect = pNormal->GetReferenceMode() == FbxGeometryElement::eDirect;
 
@@ -183,10 +196,10 @@ Mesh::Mesh( FbxMesh& _Mesh, Node* _pParent ) : Node( *_Mesh.GetNode(), _pParent
 					{
 						Polygon&	P = m_Polygons[PolygonIndex];
 
-						int	PolygonVerticesCount = _Mesh.GetPolygonSize( PolygonIndex );
+						int	PolygonVerticesCount = m_Mesh.GetPolygonSize( PolygonIndex );
 						for ( int PolygonVertexIndex=0; PolygonVertexIndex < PolygonVerticesCount; PolygonVertexIndex++ )
 						{
-							int	PolygonControlPointIndex = _Mesh.GetPolygonVertex( PolygonIndex, PolygonVertexIndex );
+							int	PolygonControlPointIndex = m_Mesh.GetPolygonVertex( PolygonIndex, PolygonVertexIndex );
 							if ( bDirect )
 								P.m_Normals.push_back( pNormal->GetDirectArray().GetAt( PolygonControlPointIndex ) );
 							else
@@ -205,7 +218,7 @@ Mesh::Mesh( FbxMesh& _Mesh, Node* _pParent ) : Node( *_Mesh.GetNode(), _pParent
 						{
 							Polygon&	P = m_Polygons[PolygonIndex];
 
-							int	PolygonVerticesCount = _Mesh.GetPolygonSize( PolygonIndex );
+							int	PolygonVerticesCount = m_Mesh.GetPolygonSize( PolygonIndex );
 							for ( int PolygonVertexIndex=0; PolygonVertexIndex < PolygonVerticesCount; PolygonVertexIndex++, VertexIndex++ )
 							{
 								if ( bDirect )
@@ -230,9 +243,9 @@ Mesh::Mesh( FbxMesh& _Mesh, Node* _pParent ) : Node( *_Mesh.GetNode(), _pParent
 	
 	{	//////////////////////////////////////////////////////////////////////////
 		// Tangents
-		for ( int i=0; i < _Mesh.GetElementTangentCount(); i++ )
+		for ( int i=0; i < m_Mesh.GetElementTangentCount(); i++ )
 		{
-			FbxGeometryElementTangent* pTangent = _Mesh.GetElementTangent( i );
+			FbxGeometryElementTangent* pTangent = m_Mesh.GetElementTangent( i );
 
 			bool	bDirect = pTangent->GetReferenceMode() == FbxGeometryElement::eDirect;
 
@@ -245,10 +258,10 @@ Mesh::Mesh( FbxMesh& _Mesh, Node* _pParent ) : Node( *_Mesh.GetNode(), _pParent
 					{
 						Polygon&	P = m_Polygons[PolygonIndex];
 
-						int	PolygonVerticesCount = _Mesh.GetPolygonSize( PolygonIndex );
+						int	PolygonVerticesCount = m_Mesh.GetPolygonSize( PolygonIndex );
 						for ( int PolygonVertexIndex=0; PolygonVertexIndex < PolygonVerticesCount; PolygonVertexIndex++ )
 						{
-							int	PolygonControlPointIndex = _Mesh.GetPolygonVertex( PolygonIndex, PolygonVertexIndex );
+							int	PolygonControlPointIndex = m_Mesh.GetPolygonVertex( PolygonIndex, PolygonVertexIndex );
 							if ( bDirect )
 								P.m_Tangents.push_back( pTangent->GetDirectArray().GetAt( PolygonControlPointIndex ) );
 							else
@@ -267,7 +280,7 @@ Mesh::Mesh( FbxMesh& _Mesh, Node* _pParent ) : Node( *_Mesh.GetNode(), _pParent
 						{
 							Polygon&	P = m_Polygons[PolygonIndex];
 
-							int	PolygonVerticesCount = _Mesh.GetPolygonSize( PolygonIndex );
+							int	PolygonVerticesCount = m_Mesh.GetPolygonSize( PolygonIndex );
 							for ( int PolygonVertexIndex=0; PolygonVertexIndex < PolygonVerticesCount; PolygonVertexIndex++, VertexIndex++ )
 							{
 								if ( bDirect )
@@ -292,9 +305,9 @@ Mesh::Mesh( FbxMesh& _Mesh, Node* _pParent ) : Node( *_Mesh.GetNode(), _pParent
 	
 	{	//////////////////////////////////////////////////////////////////////////
 		// BiTangents
-		for ( int i=0; i < _Mesh.GetElementBinormalCount(); i++ )
+		for ( int i=0; i < m_Mesh.GetElementBinormalCount(); i++ )
 		{
-			FbxGeometryElementBinormal* pBiTangent = _Mesh.GetElementBinormal( i );
+			FbxGeometryElementBinormal* pBiTangent = m_Mesh.GetElementBinormal( i );
 
 			bool	bDirect = pBiTangent->GetReferenceMode() == FbxGeometryElement::eDirect;
 
@@ -307,10 +320,10 @@ Mesh::Mesh( FbxMesh& _Mesh, Node* _pParent ) : Node( *_Mesh.GetNode(), _pParent
 					{
 						Polygon&	P = m_Polygons[PolygonIndex];
 
-						int	PolygonVerticesCount = _Mesh.GetPolygonSize( PolygonIndex );
+						int	PolygonVerticesCount = m_Mesh.GetPolygonSize( PolygonIndex );
 						for ( int PolygonVertexIndex=0; PolygonVertexIndex < PolygonVerticesCount; PolygonVertexIndex++ )
 						{
-							int	PolygonControlPointIndex = _Mesh.GetPolygonVertex( PolygonIndex, PolygonVertexIndex );
+							int	PolygonControlPointIndex = m_Mesh.GetPolygonVertex( PolygonIndex, PolygonVertexIndex );
 							if ( bDirect )
 								P.m_BiTangents.push_back( pBiTangent->GetDirectArray().GetAt( PolygonControlPointIndex ) );
 							else
@@ -329,7 +342,7 @@ Mesh::Mesh( FbxMesh& _Mesh, Node* _pParent ) : Node( *_Mesh.GetNode(), _pParent
 						{
 							Polygon&	P = m_Polygons[PolygonIndex];
 
-							int	PolygonVerticesCount = _Mesh.GetPolygonSize( PolygonIndex );
+							int	PolygonVerticesCount = m_Mesh.GetPolygonSize( PolygonIndex );
 							for ( int PolygonVertexIndex=0; PolygonVertexIndex < PolygonVerticesCount; PolygonVertexIndex++, VertexIndex++ )
 							{
 								if ( bDirect )
@@ -354,9 +367,9 @@ Mesh::Mesh( FbxMesh& _Mesh, Node* _pParent ) : Node( *_Mesh.GetNode(), _pParent
 	
 	{	//////////////////////////////////////////////////////////////////////////
 		// Vertex Colors
-		for ( int i=0; i < _Mesh.GetElementVertexColorCount(); i++ )
+		for ( int i=0; i < m_Mesh.GetElementVertexColorCount(); i++ )
 		{
-			FbxGeometryElementVertexColor* pVertexColor = _Mesh.GetElementVertexColor( i );
+			FbxGeometryElementVertexColor* pVertexColor = m_Mesh.GetElementVertexColor( i );
 
 			bool	bDirect = pVertexColor->GetReferenceMode() == FbxGeometryElement::eDirect;
 
@@ -369,10 +382,10 @@ Mesh::Mesh( FbxMesh& _Mesh, Node* _pParent ) : Node( *_Mesh.GetNode(), _pParent
 					{
 						Polygon&	P = m_Polygons[PolygonIndex];
 
-						int	PolygonVerticesCount = _Mesh.GetPolygonSize( PolygonIndex );
+						int	PolygonVerticesCount = m_Mesh.GetPolygonSize( PolygonIndex );
 						for ( int PolygonVertexIndex=0; PolygonVertexIndex < PolygonVerticesCount; PolygonVertexIndex++ )
 						{
-							int	PolygonControlPointIndex = _Mesh.GetPolygonVertex( PolygonIndex, PolygonVertexIndex );
+							int	PolygonControlPointIndex = m_Mesh.GetPolygonVertex( PolygonIndex, PolygonVertexIndex );
 							if ( bDirect )
 								P.m_VertexColors.push_back( pVertexColor->GetDirectArray().GetAt( PolygonControlPointIndex ) );
 							else
@@ -391,7 +404,7 @@ Mesh::Mesh( FbxMesh& _Mesh, Node* _pParent ) : Node( *_Mesh.GetNode(), _pParent
 						{
 							Polygon&	P = m_Polygons[PolygonIndex];
 
-							int	PolygonVerticesCount = _Mesh.GetPolygonSize( PolygonIndex );
+							int	PolygonVerticesCount = m_Mesh.GetPolygonSize( PolygonIndex );
 							for ( int PolygonVertexIndex=0; PolygonVertexIndex < PolygonVerticesCount; PolygonVertexIndex++, VertexIndex++ )
 							{
 								if ( bDirect )
@@ -413,11 +426,94 @@ Mesh::Mesh( FbxMesh& _Mesh, Node* _pParent ) : Node( *_Mesh.GetNode(), _pParent
 			}
 		}
 	}
+
+	// Store control points
+	for ( int PolygonIndex=0; PolygonIndex < int(m_Polygons.size()); PolygonIndex++ )
+	{
+		Polygon&	P = m_Polygons[PolygonIndex];
+
+		int	PolygonVerticesCount = m_Mesh.GetPolygonSize( PolygonIndex );
+		for ( int PolygonVertexIndex=0; PolygonVertexIndex < PolygonVerticesCount; PolygonVertexIndex++ )
+			P.m_ControlPoints.push_back( m_Mesh.GetPolygonVertex( PolygonIndex, PolygonVertexIndex ) );
+	}
+
+	Weld();
 }
 
-Mesh::~Mesh()
+// Triangulates the polygons as fans and merges identical corners using a hash table
+// The welded vertices are created in the order their first corner is encountered so the output is deterministic
+void	Mesh::Weld()
 {
-	delete[] m_pVertices;
+	m_WeldedVertices.clear();
+	m_Indices.clear();
+
+	std::unordered_map< WeldedVertex, int, WeldedVertex::Hasher >	Vertex2Index;
+	Vertex2Index.rehash( 2 * m_VerticesCount );
+
+	std::vector<int>	PolygonIndices;
+	for ( int PolygonIndex=0; PolygonIndex < int(m_Polygons.size()); PolygonIndex++ )
+	{
+		const Polygon&	P = m_Polygons[PolygonIndex];
+
+		// Weld the corners
+		PolygonIndices.clear();
+		for ( int CornerIndex=0; CornerIndex < int(P.m_ControlPoints.size()); CornerIndex++ )
+		{
+			WeldedVertex	V;
+			memset( &V, 0, sizeof(WeldedVertex) );	// Clears the padding as well since we hash & compare raw bytes
+
+			const Vertex&	Position = m_pVertices[P.m_ControlPoints[CornerIndex]];
+			V.P[0] = Position.x; V.P[1] = Position.y; V.P[2] = Position.z;
+			if ( CornerIndex < int(P.m_Normals.size()) )
+			{
+				const FbxVector4&	N = P.m_Normals[CornerIndex];
+				V.N[0] = (float) N[0]; V.N[1] = (float) N[1]; V.N[2] = (float) N[2];
+			}
+			if ( CornerIndex < int(P.m_Tangents.size()) )
+			{
+				const FbxVector4&	G = P.m_Tangents[CornerIndex];
+				V.G[0] = (float) G[0]; V.G[1] = (float) G[1]; V.G[2] = (float) G[2];
+			}
+			if ( CornerIndex < int(P.m_BiTangents.size()) )
+			{
+				const FbxVector4&	B = P.m_BiTangents[CornerIndex];
+				V.B[0] = (float) B[0]; V.B[1] = (float) B[1]; V.B[2] = (float) B[2];
+			}
+			if ( CornerIndex < int(P.m_UV0.size()) )
+			{
+				const FbxVector2&	UV = P.m_UV0[CornerIndex];
+				V.T[0] = (float) UV[0]; V.T[1] = (float) UV[1];
+			}
+
+			std::pair< std::unordered_map< WeldedVertex, int, WeldedVertex::Hasher >::iterator, bool >	Result = Vertex2Index.insert( std::make_pair( V, int(m_WeldedVertices.size()) ) );
+			if ( Result.second )
+				m_WeldedVertices.push_back( V );	// New vertex
+			PolygonIndices.push_back( Result.first->second );
+		}
+
+		// Triangulate as a fan
+		for ( int TriangleIndex=1; TriangleIndex < int(PolygonIndices.size())-1; TriangleIndex++ )
+		{
+			m_Indices.push_back( PolygonIndices[0] );
+			m_Indices.push_back( PolygonIndices[TriangleIndex] );
+			m_Indices.push_back( PolygonIndices[TriangleIndex+1] );
+		}
+	}
+}
+
+size_t	Mesh::WeldedVertex::Hasher::operator()( const WeldedVertex& _V ) const
+{
+	// FNV-1a on the raw bytes
+	const unsigned char*	pBytes = (const unsigned char*) &_V;
+	unsigned int			Hash = 2166136261U;
+	for ( int i=0; i < sizeof(WeldedVertex); i++ )
+		Hash = (Hash ^ pBytes[i]) * 16777619U;
+	return Hash;
+}
+
+bool	Mesh::WeldedVertex::operator==( const WeldedVertex& _Other ) const
+{
+	return memcmp( this, &_Other, sizeof(WeldedVertex) ) == 0;
 }
 
 Mesh::Material::Material( FbxSurfaceMaterial* _pMaterial ) : m_pMaterial( _pMaterial )
@@ -39,6 +39,7 @@ public:
 	public:
 
 		int						m_MatID;
+		std::vector<int>		m_ControlPoints;
 		std::vector<FbxVector2>	m_UV0;
 		std::vector<FbxVector2>	m_UV1;
 		std::vector<FbxVector4>	m_Normals;
@@ -48,6 +49,22 @@ public:
 
 	};
 
+	// A triangulated vertex in the P3N3G3B3T2 layout of the scene format
+	struct	WeldedVertex
+	{
+		float	P[3];
+		float	N[3];
+		float	G[3];
+		float	B[3];
+		float	T[2];
+
+		struct	Hasher
+		{
+			size_t	operator()( const WeldedVertex& _V ) const;
+		};
+		bool	operator==( const WeldedVertex& _Other ) const;
+	};
+
 protected:
 
 	FbxMesh&					m_Mesh;
@@ -61,7 +78,16 @@ protected:
 
 	std::vector<Polygon>		m_Polygons;
 
+	std::vector<WeldedVertex>	m_WeldedVertices;
+	std::vector<int>			m_Indices;			// 3 per triangle
+
 public:
 	Mesh( FbxMesh& _Mesh, Node* _pParent );
 	~Mesh();
+
+	// Thread-safe with other meshes' conversion
+	void	Convert();
+
+protected:
+	void	Weld();
 };
\ No newline at end of file
@@ -10,14 +10,23 @@
 #include <stdio.h>
 #include <tchar.h>
 
-//#include <string>
+#include <string>
 #include <assert.h>
 #include <vector>
 #include <map>
+#include <unordered_map>
 
 #include "Windows.h"
 
 #include "fbxsdk.h"
 
+// All the dumps go through ConsolePrint() so they can be silenced (cf. -quiet)
+extern bool	gs_bVerbose;
+void	ConsolePrint( const char* _pText, ... );
+
+#undef FBXSDK_printf
+#define FBXSDK_printf	ConsolePrint
+
 #include "Node.h"
 #include "Mesh.h"
+#include "Batch.h"
@@ -0,0 +1,160 @@
+#include "../GodComplex.h"
+
+namespace
+{
+	__m128	Abs( __m128 _V )
+	{
+		return _mm_andnot_ps( _mm_set1_ps( -0.0f ), _V );
+	}
+}
+
+BoundsCuller::BoundsCuller()
+	: m_BoundsCount( 0 )
+	, m_PacketsCount( 0 )
+	, m_pPackets( NULL )
+{
+}
+
+BoundsCuller::~BoundsCuller()
+{
+	Exit();
+}
+
+void	BoundsCuller::Init( U32 _BoundsCount, const float3* _pBoundsMin, const float3* _pBoundsMax )
+{
+	Exit();
+
+	m_BoundsCount = _BoundsCount;
+	m_PacketsCount = (_BoundsCount + 3) >> 2;
+	if ( m_PacketsCount == 0 )
+		return;
+
+	m_pPackets = (Packet*) _aligned_malloc( m_PacketsCount * sizeof(Packet), 16 );
+	for ( U32 PacketIndex=0; PacketIndex < m_PacketsCount; PacketIndex++ )
+	{
+		float	pCenter[3][4];
+		float	pExtent[3][4];
+		for ( U32 i=0; i < 4; i++ )
+		{
+			U32	BoundsIndex = 4*PacketIndex+i;
+			if ( BoundsIndex < _BoundsCount )
+			{
+				float3	Center = 0.5f * (_pBoundsMin[BoundsIndex] + _pBoundsMax[BoundsIndex]);
+				float3	Extent = 0.5f * (_pBoundsMax[BoundsIndex] - _pBoundsMin[BoundsIndex]);
+				pCenter[0][i] = Center.x;	pExtent[0][i] = Extent.x;
+				pCenter[1][i] = Center.y;	pExtent[1][i] = Extent.y;
+				pCenter[2][i] = Center.z;	pExtent[2][i] = Extent.z;
+			}
+			else
+			{	// Padding boxes are never visible
+				pCenter[0][i] = pCenter[1][i] = pCenter[2][i] = 0.0f;
+				pExtent[0][i] = pExtent[1][i] = pExtent[2][i] = -MAX_FLOAT;
+			}
+		}
+
+		Packet&	P = m_pPackets[PacketIndex];
+		P.CenterX = _mm_loadu_ps( pCenter[0] );
+		P.CenterY = _mm_loadu_ps( pCenter[1] );
+		P.CenterZ = _mm_loadu_ps( pCenter[2] );
+		P.ExtentX = _mm_loadu_ps( pExtent[0] );
+		P.ExtentY = _mm_loadu_ps( pExtent[1] );
+		P.ExtentZ = _mm_loadu_ps( pExtent[2] );
+	}
+}
+
+void	BoundsCuller::Exit()
+{
+	if ( m_pPackets != NULL )
+		_aligned_free( m_pPackets );
+	m_pPackets = NULL;
+	m_PacketsCount = 0;
+	m_BoundsCount = 0;
+}
+
+U32	BoundsCuller::Cull( const float4x4& _World2Proj, U8* _pVisible ) const
+{
+	// Extract the 6 planes from the columns of the transform (positions are row vectors so clip.j = dot( float4( P, 1 ), Column j ))
+	float4	pColumns[4];
+	for ( int j=0; j < 4; j++ )
+		pColumns[j].Set( _World2Proj.m[4*0+j], _World2Proj.m[4*1+j], _World2Proj.m[4*2+j], _World2Proj.m[4*3+j] );
+
+	float4	pPlanes[6] = {
+		pColumns[3] + pColumns[0],	// X >= -W
+		pColumns[3] - pColumns[0],	// X <= W
+		pColumns[3] + pColumns[1],	// Y >= -W
+		pColumns[3] - pColumns[1],	// Y <= W
+		pColumns[2],				// Z >= 0
+		pColumns[3] - pColumns[2],	// Z <= W
+	};
+
+	__m128	pPlaneX[6], pPlaneY[6], pPlaneZ[6], pPlaneW[6];
+	for ( int PlaneIndex=0; PlaneIndex < 6; PlaneIndex++ )
+	{
+		pPlaneX[PlaneIndex] = _mm_set1_ps( pPlanes[PlaneIndex].x );
+		pPlaneY[PlaneIndex] = _mm_set1_ps( pPlanes[PlaneIndex].y );
+		pPlaneZ[PlaneIndex] = _mm_set1_ps( pPlanes[PlaneIndex].z );
+		pPlaneW[PlaneIndex] = _mm_set1_ps( pPlanes[PlaneIndex].w );
+	}
+
+	// A box is culled as soon as it lies entirely on the negative side of one of the planes
+	U32		VisibleCount = 0;
+	__m128	Zero = _mm_setzero_ps();
+	for ( U32 PacketIndex=0; PacketIndex < m_PacketsCount; PacketIndex++ )
+	{
+		const Packet&	P = m_pPackets[PacketIndex];
+		__m128	Visible = _mm_cmpeq_ps( Zero, Zero );
+		for ( int PlaneIndex=0; PlaneIndex < 6; PlaneIndex++ )
+		{
+			__m128	Distance = _mm_add_ps( _mm_add_ps( _mm_mul_ps( pPlaneX[PlaneIndex], P.CenterX ), _mm_mul_ps( pPlaneY[PlaneIndex], P.CenterY ) ), _mm_add_ps( _mm_mul_ps( pPlaneZ[PlaneIndex], P.CenterZ ), pPlaneW[PlaneIndex] ) );
+			__m128	Radius = _mm_add_ps( _mm_add_ps( _mm_mul_ps( Abs( pPlaneX[PlaneIndex] ), P.ExtentX ), _mm_mul_ps( Abs( pPlaneY[PlaneIndex] ), P.ExtentY ) ), _mm_mul_ps( Abs( pPlaneZ[PlaneIndex] ), P.ExtentZ ) );
+			Visible = _mm_and_ps( Visible, _mm_cmpge_ps( _mm_add_ps( Distance, Radius ), Zero ) );
+		}
+
+		VisibleCount += WriteVisibility( PacketIndex, Visible, _pVisible );
+	}
+
+	return VisibleCount;
+}
+
+U32	BoundsCuller::Cull( const float3& _Center, float _Radius, U8* _pVisible ) const
+{
+	__m128	CenterX = _mm_set1_ps( _Center.x );
+	__m128	CenterY = _mm_set1_ps( _Center.y );
+	__m128	CenterZ = _mm_set1_ps( _Center.z );
+	__m128	RadiusSq = _mm_set1_ps( _Radius * _Radius );
+	__m128	Zero = _mm_setzero_ps();
+
+	U32		VisibleCount = 0;
+	for ( U32 PacketIndex=0; PacketIndex < m_PacketsCount; PacketIndex++ )
+	{
+		const Packet&	P = m_pPackets[PacketIndex];
+
+		// Distance from the sphere's center to the box
+		__m128	DX = _mm_max_ps( Zero, _mm_sub_ps( Abs( _mm_sub_ps( CenterX, P.CenterX ) ), P.ExtentX ) );
+		__m128	DY = _mm_max_ps( Zero, _mm_sub_ps( Abs( _mm_sub_ps( CenterY, P.CenterY ) ), P.ExtentY ) );
+		__m128	DZ = _mm_max_ps( Zero, _mm_sub_ps( Abs( _mm_sub_ps( CenterZ, P.CenterZ ) ), P.ExtentZ ) );
+		__m128	DistanceSq = _mm_add_ps( _mm_add_ps( _mm_mul_ps( DX, DX ), _mm_mul_ps( DY, DY ) ), _mm_mul_ps( DZ, DZ ) );
+
+		__m128	Visible = _mm_and_ps( _mm_cmple_ps( DistanceSq, RadiusSq ), _mm_cmpge_ps( P.ExtentX, Zero ) );	// Padding boxes have negative extents
+		VisibleCount += WriteVisibility( PacketIndex, Visible, _pVisible );
+	}
+
+	return VisibleCount;
+}
+
+U32	BoundsCuller::WriteVisibility( U32 _PacketIndex, __m128 _Visible, U8* _pVisible ) const
+{
+	int	Mask = _mm_movemask_ps( _Visible );
+	U32	Count = 0;
+	for ( U32 i=0; i < 4; i++ )
+	{
+		U32	BoundsIndex = 4*_PacketIndex+i;
+		if ( BoundsIndex >= m_BoundsCount )
+			break;
+
+		U8	IsVisible = U8( (Mask >> i) & 1 );
+		_pVisible[BoundsIndex] = IsVisible;
+		Count += IsVisible;
+	}
+	return Count;
+}
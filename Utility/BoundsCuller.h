@@ -0,0 +1,50 @@
+//////////////////////////////////////////////////////////////////////////
+// SIMD culling of a static set of axis-aligned bounding boxes
+//
+// Boxes are stored as centers & half extents in SoA packets of 4 so each test handles 4 boxes at once with SSE.
+// Queries never modify the culler and write the visibility of each box into a caller-provided array, so several views
+//	can be culled concurrently (e.g. passes recorded in parallel).
+//
+#pragma once
+
+#include <xmmintrin.h>
+
+class	BoundsCuller
+{
+protected:	// NESTED TYPES
+
+	struct	Packet
+	{
+		__m128	CenterX, CenterY, CenterZ;
+		__m128	ExtentX, ExtentY, ExtentZ;
+	};
+
+protected:	// FIELDS
+
+	U32			m_BoundsCount;
+	U32			m_PacketsCount;
+	Packet*		m_pPackets;			// 16 bytes aligned
+
+public:		// PROPERTIES
+
+	U32			GetBoundsCount() const	{ return m_BoundsCount; }
+
+public:		// METHODS
+
+	BoundsCuller();
+	~BoundsCuller();
+
+	void		Init( U32 _BoundsCount, const float3* _pBoundsMin, const float3* _pBoundsMax );
+	void		Exit();
+
+	// Tests the boxes against the frustum of a World=>Projection transform (D3D clip space, i.e. -W<=X,Y<=W and 0<=Z<=W)
+	//	_pVisible, receives 1 for each visible box and 0 for each culled one
+	// Returns the amount of visible boxes
+	U32			Cull( const float4x4& _World2Proj, U8* _pVisible ) const;
+
+	// Tests the boxes against a sphere (e.g. the range of a point light or of a cube map)
+	U32			Cull( const float3& _Center, float _Radius, U8* _pVisible ) const;
+
+private:
+	U32			WriteVisibility( U32 _PacketIndex, __m128 _Visible, U8* _pVisible ) const;
+};
@@ -1,9 +1,12 @@
 #include "../GodComplex.h"
 
-Camera::Camera( Device& _Device ) : m_Device( _Device )
+Camera::Camera( Device& _Device ) : m_Device( _Device ), m_Jitter( 0.0f, 0.0f ), m_FrameIndex( ~0U )
 {
 	m_pCB = new CB<CBData>( m_Device, 0, true );
 	m_pCB->m.Camera2World = m_pCB->m.World2Camera = m_pCB->m.Camera2Proj = m_pCB->m.Proj2Camera = float4x4::Identity;
+	m_pCB->m.PreviousWorld2Proj = float4x4::Identity;
+	m_pCB->m.Jitter.Set( 0.0f, 0.0f, 0.0f, 0.0f );
+	m_Camera2ProjUnjittered = float4x4::Identity;
 }
 Camera::~Camera()
 {
@@ -19,7 +22,10 @@ void	Camera::SetPerspective( float _FOV, float _AspectRatio, float _Near, float
 
 	m_pCB->m.Params.Set( W, H, _Near, _Far );
 
-	m_pCB->m.Camera2Proj = float4x4::ProjectionPerspective( _FOV, _AspectRatio, _Near, _Far );
+	m_Camera2ProjUnjittered = float4x4::ProjectionPerspective( _FOV, _AspectRatio, _Near, _Far );
+	m_pCB->m.Camera2Proj = m_Camera2ProjUnjittered;
+	m_pCB->m.Camera2Proj.m[4*2+0] += m_Jitter.x;
+	m_pCB->m.Camera2Proj.m[4*2+1] += m_Jitter.y;
 
 // 	float	Q =  _Far / (_Far - _Near);
 // 	m_pCB->m.Camera2Proj.SetRow( 0, NjFloat4( 1.0f / W, 0.0f, 0.0f, 0.0f ) );
@@ -60,8 +66,36 @@ void	Camera::LookAt( const float3& _Position, const float3& _Target, const float
 	UpdateCompositions();
 }
 
+// Clip X & Y are offset by the jitter times W (i.e. the view depth) so the whole projected image slides by the jitter
+void	Camera::SetJitter( const float2& _Jitter )
+{
+	m_Jitter = _Jitter;
+
+	m_pCB->m.Camera2Proj = m_Camera2ProjUnjittered;
+	m_pCB->m.Camera2Proj.m[4*2+0] += m_Jitter.x;
+	m_pCB->m.Camera2Proj.m[4*2+1] += m_Jitter.y;
+	m_pCB->m.Proj2Camera = m_pCB->m.Camera2Proj.Inverse();
+
+	UpdateCompositions();
+}
+
 void	Camera::Upload( int _SlotIndex )
 {
+	// The last upload of a frame is the one the next frame reprojects to
+	U32	FrameIndex = m_Device.GetFrameIndex();
+	if ( FrameIndex != m_FrameIndex )
+	{
+		bool	bFirstFrame = m_FrameIndex == ~0U;
+		m_pCB->m.PreviousWorld2Proj = bFirstFrame ? m_pCB->m.World2Proj : m_FrameWorld2Proj;
+		m_pCB->m.Jitter.z = bFirstFrame ? m_Jitter.x : m_FrameJitter.x;
+		m_pCB->m.Jitter.w = bFirstFrame ? m_Jitter.y : m_FrameJitter.y;
+		m_FrameIndex = FrameIndex;
+	}
+	m_pCB->m.Jitter.x = m_Jitter.x;
+	m_pCB->m.Jitter.y = m_Jitter.y;
+	m_FrameWorld2Proj = m_pCB->m.World2Proj;
+	m_FrameJitter = m_Jitter;
+
 	m_pCB->UpdateData();
 }
 
@@ -35,6 +35,10 @@ private:	// NESTED TYPES
 		float4x4	Proj2Camera;
 		float4x4	World2Proj;
 		float4x4	Proj2World;
+
+		// Appended last so the shaders that don't need them keep the same layout
+		float4x4	PreviousWorld2Proj;	// World2Proj of the previous frame (jittered as it was)
+		float4		Jitter;				// XY=Projection jitter of this frame, ZW=Jitter of the previous frame (in NDC)
 	};
 
 private:	// FIELDS
@@ -45,6 +49,12 @@ private:	// FIELDS
 	float3		m_Position;
 	float3		m_Target;
 
+	float4x4	m_Camera2ProjUnjittered;
+	float2		m_Jitter;					// In NDC
+	U32			m_FrameIndex;				// Device frame of the last upload, ~0U before the first one
+	float4x4	m_FrameWorld2Proj;			// World2Proj & jitter of the last upload, they become the previous frame's on the next frame
+	float2		m_FrameJitter;
+
 public:		// PROPERTIES
  
 	// Gets the constant buffer to send to shaders
@@ -59,5 +69,8 @@ public:		// METHODS
 
 	void	SetPerspective( float _FOV, float _AspectRatio, float _Near, float _Far );
 	void	LookAt( const float3& _Position, const float3& _Target, const float3& _Up );
+
+	// Offsets the projection by a sub-pixel amount for temporal accumulation (cf. TemporalAA), _Jitter is in NDC
+	void	SetJitter( const float2& _Jitter );
 	void	UpdateCompositions();
 };
\ No newline at end of file
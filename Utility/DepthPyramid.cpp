@@ -0,0 +1,86 @@
+#include "../GodComplex.h"
+
+DepthPyramid::DepthPyramid( Device& _Device, int _Width, int _Height )
+	: m_Device( _Device )
+	, m_Width( _Width )
+	, m_Height( _Height )
+	, m_LastBuildFrameIndex( 0 )
+	, m_bBuilt( false )
+{
+	m_PaddedWidth = (m_Width + TILE_SIZE-1) & ~(TILE_SIZE-1);
+	m_PaddedHeight = (m_Height + TILE_SIZE-1) & ~(TILE_SIZE-1);
+	ASSERT( m_PaddedWidth <= MAX_SIZE && m_PaddedHeight <= MAX_SIZE, "Depth stencil is too large for the pyramid!" );
+
+	m_pCSTiles = CreateComputeShader( IDR_SHADER_DEPTH_PYRAMID, "./Resources/Shaders/DepthPyramid.hlsl", "CS_Tiles" );
+	m_pCSTail = CreateComputeShader( IDR_SHADER_DEPTH_PYRAMID, "./Resources/Shaders/DepthPyramid.hlsl", "CS_Tail" );
+
+	m_pTexPyramid = new Texture2D( m_Device, m_PaddedWidth, m_PaddedHeight, 1, PixelFormatRG32F::DESCRIPTOR, 0, NULL, false, true );
+	m_pCB_DepthPyramid = new CB<CBDepthPyramid>( m_Device, 10 );
+	memset( &m_pCB_DepthPyramid->m, 0, sizeof(CBDepthPyramid) );
+}
+
+DepthPyramid::~DepthPyramid()
+{
+	delete m_pCB_DepthPyramid;
+	delete m_pTexPyramid;
+	delete m_pCSTail;
+	delete m_pCSTiles;
+}
+
+void	DepthPyramid::Build( const Texture2D& _DepthStencil, bool _bForce )
+{
+	ASSERT( _DepthStencil.GetWidth() == m_Width && _DepthStencil.GetHeight() == m_Height, "Depth stencil doesn't have the pyramid's resolution!" );
+
+	U32	FrameIndex = m_Device.GetFrameIndex();
+	if ( m_bBuilt && FrameIndex == m_LastBuildFrameIndex && !_bForce )
+		return;	// Already built this frame
+
+	int	MipsCount = m_pTexPyramid->GetMipLevelsCount();
+	m_pCB_DepthPyramid->m.DepthSizeX = m_Width;
+	m_pCB_DepthPyramid->m.DepthSizeY = m_Height;
+	m_pCB_DepthPyramid->m.TailSizeX = m_PaddedWidth / TILE_SIZE;
+	m_pCB_DepthPyramid->m.TailSizeY = m_PaddedHeight / TILE_SIZE;
+	m_pCB_DepthPyramid->m.MipsCount = MipsCount;
+	m_pCB_DepthPyramid->UpdateData();
+
+	m_pTexPyramid->RemoveFromLastAssignedSlots();
+
+	// 1] Reduce the tiles into the mips 0 to 6
+	if ( m_pCSTiles->Use() )
+	{
+		_DepthStencil.SetCS( 10 );
+		for ( int MipIndex=0; MipIndex < TILE_MIPS_COUNT; MipIndex++ )
+			m_pTexPyramid->SetCSUAV( MipIndex, m_pTexPyramid->GetUAV( MipIndex ) );
+
+		m_pCSTiles->Dispatch( m_PaddedWidth / TILE_SIZE, m_PaddedHeight / TILE_SIZE, 1 );
+
+		m_Device.RemoveShaderResources( 10, 1, Device::SSF_COMPUTE_SHADER );
+		m_Device.RemoveShaderResources( 0, TILE_MIPS_COUNT, Device::SSF_COMPUTE_SHADER_UAV );
+	}
+
+	// 2] Reduce the mip 6 into the remaining mips
+	if ( MipsCount > TILE_MIPS_COUNT && m_pCSTail->Use() )
+	{
+		m_pTexPyramid->SetCS( 11, true, m_pTexPyramid->GetSRV( TILE_MIPS_COUNT-1, 1 ) );
+		for ( int MipIndex=TILE_MIPS_COUNT; MipIndex < MipsCount; MipIndex++ )
+			m_pTexPyramid->SetCSUAV( MipIndex-TILE_MIPS_COUNT, m_pTexPyramid->GetUAV( MipIndex ) );
+
+		m_pCSTail->Dispatch( 1, 1, 1 );
+
+		m_Device.RemoveShaderResources( 11, 1, Device::SSF_COMPUTE_SHADER );
+		m_Device.RemoveShaderResources( 0, MipsCount-TILE_MIPS_COUNT, Device::SSF_COMPUTE_SHADER_UAV );
+	}
+
+	m_LastBuildFrameIndex = FrameIndex;
+	m_bBuilt = true;
+}
+
+void	DepthPyramid::Set( int _SlotIndex ) const
+{
+	m_pTexPyramid->Set( _SlotIndex, true );
+}
+
+void	DepthPyramid::SetCS( int _SlotIndex ) const
+{
+	m_pTexPyramid->SetCS( _SlotIndex, true );
+}
@@ -0,0 +1,80 @@
+//////////////////////////////////////////////////////////////////////////
+// Hierarchical min/max depth pyramid shared by the effects (cf. Inc/DepthPyramid.hlsl)
+// Each texel of mip N stores X=Nearest, Y=Farthest linear depth of the 2^N x 2^N block of screen pixels it covers, so
+//	occlusion culling, SSAO/SSR tracing, volumetric ray start clamping or DOF tile classification read conservative
+//	depth bounds in a single fetch instead of each effect reducing the depth buffer on its own.
+//
+// Build() reduces the whole chain in 2 dispatches:
+//	_ One group per 64x64 tile writes the mips 0 to 6 (mip 0 is padded to a multiple of 64 so each tile maps to a single texel of mip 6)
+//	_ A single group reduces the mip 6 to the last mip in group-shared memory
+// (a single dispatch would need to bind 13 mips for a 4096 pixels wide screen but D3D11.0 only offers 8 compute UAV slots)
+//
+// Usage:
+//	gs_pDepthPyramid->Build( m_Device.DefaultDepthStencil() );	// Once the opaque geometry is rendered, later calls in the same frame are free
+//	gs_pDepthPyramid->Set( 56 );								// Shaders include Inc/DepthPyramid.hlsl
+//
+// NOTE: The compute shader slots t10-t11, u0-u6 & b10 are overwritten by Build().
+//
+#pragma once
+
+template<typename> class CB;
+
+class	DepthPyramid
+{
+public:		// CONSTANTS
+
+	static const int	SRV_SLOT = 56;			// The slot Inc/DepthPyramid.hlsl expects the pyramid in
+	static const int	TILE_SIZE = 64;			// Pixels of mip 0 reduced by each group of the first dispatch
+	static const int	TILE_MIPS_COUNT = 7;	// Mips 0 to 6 are written by the first dispatch
+	static const int	MAX_SIZE = 4096;		// Mip 6 must fit the group-shared memory of the second dispatch
+
+protected:	// NESTED TYPES
+
+	// WARNING: must match the cbDepthPyramid constant buffer in DepthPyramid.hlsl!
+	struct	CBDepthPyramid
+	{
+		U32		DepthSizeX, DepthSizeY;
+		U32		TailSizeX, TailSizeY;
+		U32		MipsCount;
+		U32		__PAD[3];
+	};
+
+protected:	// FIELDS
+
+	Device&				m_Device;
+
+	int					m_Width;				// Depth stencil resolution
+	int					m_Height;
+	int					m_PaddedWidth;			// Mip 0 resolution
+	int					m_PaddedHeight;
+
+	ComputeShader*		m_pCSTiles;
+	ComputeShader*		m_pCSTail;
+	Texture2D*			m_pTexPyramid;			// X=Nearest, Y=Farthest linear depth
+	CB<CBDepthPyramid>*	m_pCB_DepthPyramid;
+
+	U32					m_LastBuildFrameIndex;
+	bool				m_bBuilt;
+
+public:		// PROPERTIES
+
+	bool				HasErrors() const				{ return m_pCSTiles->HasErrors() || m_pCSTail->HasErrors(); }
+	int					GetWidth() const				{ return m_Width; }
+	int					GetHeight() const				{ return m_Height; }
+	int					GetMipLevelsCount() const		{ return m_pTexPyramid->GetMipLevelsCount(); }
+	Texture2D&			GetTexture() const				{ return *m_pTexPyramid; }
+
+public:		// METHODS
+
+	// _Width & _Height are the resolution of the depth stencil buffers given to Build()
+	DepthPyramid( Device& _Device, int _Width, int _Height );
+	~DepthPyramid();
+
+	// Builds the pyramid from the depth stencil buffer, does nothing if it was already built this frame unless _bForce is true
+	//	(e.g. when some geometry was added to the depth buffer in the meantime)
+	void				Build( const Texture2D& _DepthStencil, bool _bForce=false );
+
+	// Binds the pyramid to all the shader stages / to the compute shader stage
+	void				Set( int _SlotIndex=SRV_SLOT ) const;
+	void				SetCS( int _SlotIndex=SRV_SLOT ) const;
+};
@@ -0,0 +1,104 @@
+#include "../GodComplex.h"
+
+static const float	DEFAULT_DEPTH_THRESHOLD = 0.1f;	// Pixels whose low resolution neighbors are more than 10% farther or closer are on an edge
+
+DepthUpsampler::DepthUpsampler( Device& _Device, int _Width, int _Height, int _DownsampleShift )
+	: m_Device( _Device )
+	, m_Width( _Width )
+	, m_Height( _Height )
+	, m_DownsampleShift( _DownsampleShift )
+	, m_DepthThreshold( DEFAULT_DEPTH_THRESHOLD )
+	, m_pDepthPyramid( NULL )
+{
+	ASSERT( _DownsampleShift > 0 && _DownsampleShift <= 2, "Only half & quarter resolutions are supported!" );
+
+	int	BlockSize = 1 << m_DownsampleShift;
+	m_LowResWidth = (m_Width + BlockSize-1) >> m_DownsampleShift;
+	m_LowResHeight = (m_Height + BlockSize-1) >> m_DownsampleShift;
+
+	D3D_SHADER_MACRO	pMacrosArray[] = {
+		{ "TARGET_ARRAY", "1" },
+		{ NULL,	NULL }
+	};
+	m_pCSDownsampleDepth = CreateComputeShader( IDR_SHADER_DEPTH_UPSAMPLE, "./Resources/Shaders/DepthUpsample.hlsl", "CS_DownsampleDepth" );
+	m_ppCSUpsample[0] = CreateComputeShader( IDR_SHADER_DEPTH_UPSAMPLE, "./Resources/Shaders/DepthUpsample.hlsl", "CS_Upsample" );
+	m_ppCSUpsample[1] = CreateComputeShader( IDR_SHADER_DEPTH_UPSAMPLE, "./Resources/Shaders/DepthUpsample.hlsl", "CS_Upsample", pMacrosArray );
+
+	m_pTexLowResDepth = new Texture2D( m_Device, m_LowResWidth, m_LowResHeight, 1, PixelFormatRG16F::DESCRIPTOR, 1, NULL, false, true );
+	m_pCB_Upsample = new CB<CBUpsample>( m_Device, 10 );
+}
+
+DepthUpsampler::~DepthUpsampler()
+{
+	delete m_pCB_Upsample;
+	delete m_pTexLowResDepth;
+	delete m_ppCSUpsample[1];
+	delete m_ppCSUpsample[0];
+	delete m_pCSDownsampleDepth;
+}
+
+void	DepthUpsampler::DownsampleDepth( const Texture2D& _DepthStencil )
+{
+	ASSERT( _DepthStencil.GetWidth() == m_Width && _DepthStencil.GetHeight() == m_Height, "Depth stencil doesn't have the full resolution!" );
+	if ( !m_pCSDownsampleDepth->Use() )
+		return;
+
+	m_pDepthPyramid = NULL;
+	m_pCB_Upsample->m.TargetSizeX = m_Width;
+	m_pCB_Upsample->m.TargetSizeY = m_Height;
+	m_pCB_Upsample->m.SourceSizeX = m_LowResWidth;
+	m_pCB_Upsample->m.SourceSizeY = m_LowResHeight;
+	m_pCB_Upsample->m.DownsampleShift = m_DownsampleShift;
+	m_pCB_Upsample->m.DepthThreshold = m_DepthThreshold;
+	m_pCB_Upsample->UpdateData();
+
+	m_pTexLowResDepth->RemoveFromLastAssignedSlots();
+	_DepthStencil.SetCS( 10 );
+	m_pTexLowResDepth->SetCSUAV( 0 );
+
+	m_pCSDownsampleDepth->Dispatch( (m_LowResWidth+7) >> 3, (m_LowResHeight+7) >> 3, 1 );
+
+	m_Device.RemoveShaderResources( 10, 1, Device::SSF_COMPUTE_SHADER );
+	m_pTexLowResDepth->RemoveFromLastAssignedSlotUAV();
+}
+
+void	DepthUpsampler::DownsampleDepth( const DepthPyramid& _Pyramid )
+{
+	ASSERT( _Pyramid.GetWidth() == m_Width && _Pyramid.GetHeight() == m_Height, "Depth pyramid doesn't have the full resolution!" );
+
+	// The texel of mip N covers the same 2^N x 2^N block as our low resolution pixel and the mip is at least as large
+	m_pDepthPyramid = &_Pyramid;
+	m_pCB_Upsample->m.TargetSizeX = m_Width;
+	m_pCB_Upsample->m.TargetSizeY = m_Height;
+	m_pCB_Upsample->m.SourceSizeX = m_LowResWidth;
+	m_pCB_Upsample->m.SourceSizeY = m_LowResHeight;
+	m_pCB_Upsample->m.DownsampleShift = m_DownsampleShift;
+}
+
+void	DepthUpsampler::Upsample( const Texture2D& _DepthStencil, const Texture2D& _Source, const Texture2D& _Target )
+{
+	ASSERT( _Source.GetWidth() == m_LowResWidth && _Source.GetHeight() == m_LowResHeight, "Source doesn't have the low resolution!" );
+	ASSERT( _Target.GetWidth() == m_Width && _Target.GetHeight() == m_Height, "Target doesn't have the full resolution!" );
+	ASSERT( _Source.GetArraySize() == _Target.GetArraySize(), "Source & target must have the same amount of slices!" );
+
+	ComputeShader&	CS = *m_ppCSUpsample[_Target.GetArraySize() > 1 ? 1 : 0];
+	if ( !CS.Use() )
+		return;
+
+	m_pCB_Upsample->m.DepthThreshold = m_DepthThreshold;
+	m_pCB_Upsample->UpdateData();
+
+	_Target.RemoveFromLastAssignedSlots();
+	_DepthStencil.SetCS( 10 );
+	if ( m_pDepthPyramid != NULL )
+		m_pDepthPyramid->GetTexture().SetCS( 11, true, m_pDepthPyramid->GetTexture().GetSRV( m_DownsampleShift, 1 ) );
+	else
+		m_pTexLowResDepth->SetCS( 11 );
+	_Source.SetCS( 12, false, _Source.GetSRV( 0, 1, 0, 0, true ) );	// Always read as an array
+	_Target.SetCSUAV( 0 );
+
+	CS.Dispatch( (m_Width+7) >> 3, (m_Height+7) >> 3, _Target.GetArraySize() );
+
+	m_Device.RemoveShaderResources( 10, 3, Device::SSF_COMPUTE_SHADER );
+	_Target.RemoveFromLastAssignedSlotUAV();
+}
@@ -0,0 +1,72 @@
+//////////////////////////////////////////////////////////////////////////
+// Depth-aware upsampling of half or quarter resolution effects
+// Expensive effects (volumetrics, DOF, SSAO, etc.) can render at a fraction of the screen resolution and be upscaled without halos:
+//	_ DownsampleDepth() stores the nearest & farthest linear depths of each low resolution pixel's block
+//		(or simply reads them from the mip of the shared depth pyramid matching the low resolution, cf. Utility/DepthPyramid.h)
+//	_ Upsample() compares each full resolution pixel's depth to the depths of its 4 closest low resolution pixels:
+//		if they're all within _DepthThreshold (relative) the pixel is bilinearly interpolated,
+//		otherwise it's on an edge and we simply pick the low resolution pixel whose depth is the closest (nearest-depth upsampling)
+//
+// Sources & targets can be texture arrays (all the slices are upsampled at once), targets must be created with UAV support.
+//
+#pragma once
+
+template<typename> class CB;
+class DepthPyramid;
+
+class	DepthUpsampler
+{
+protected:	// NESTED TYPES
+
+	// WARNING: must match the cbUpsample constant buffer in DepthUpsample.hlsl!
+	struct	CBUpsample
+	{
+		U32		TargetSizeX, TargetSizeY;
+		U32		SourceSizeX, SourceSizeY;
+		U32		DownsampleShift;
+		float	DepthThreshold;
+		float2	__PAD;
+	};
+
+protected:	// FIELDS
+
+	Device&				m_Device;
+
+	int					m_Width;
+	int					m_Height;
+	int					m_DownsampleShift;	// 1 for half resolution, 2 for quarter resolution
+	int					m_LowResWidth;
+	int					m_LowResHeight;
+	float				m_DepthThreshold;
+
+	ComputeShader*		m_pCSDownsampleDepth;
+	ComputeShader*		m_ppCSUpsample[2];	// [0] writes single textures, [1] writes texture arrays
+	Texture2D*			m_pTexLowResDepth;	// X=Nearest, Y=Farthest linear depth
+	const DepthPyramid*	m_pDepthPyramid;	// When not NULL, the low resolution depths are read from the pyramid instead
+	CB<CBUpsample>*		m_pCB_Upsample;
+
+public:		// PROPERTIES
+
+	bool				HasErrors() const				{ return m_pCSDownsampleDepth->HasErrors() || m_ppCSUpsample[0]->HasErrors() || m_ppCSUpsample[1]->HasErrors(); }
+	int					GetLowResWidth() const			{ return m_LowResWidth; }
+	int					GetLowResHeight() const			{ return m_LowResHeight; }
+	Texture2D&			GetLowResDepth() const			{ return *m_pTexLowResDepth; }
+
+	float				GetDepthThreshold() const		{ return m_DepthThreshold; }
+	void				SetDepthThreshold( float _Threshold )	{ m_DepthThreshold = _Threshold; }
+
+public:		// METHODS
+
+	// _Width & _Height are the full resolution, the low resolution is rounded up so it covers every full resolution pixel
+	DepthUpsampler( Device& _Device, int _Width, int _Height, int _DownsampleShift );
+	~DepthUpsampler();
+
+	// Builds the low resolution depths from the full resolution depth stencil buffer (call it once the scene's depth is complete)
+	void				DownsampleDepth( const Texture2D& _DepthStencil );
+
+	// Uses the mip of the pyramid matching the low resolution as low resolution depths (the pyramid must be built for the full resolution)
+	void				DownsampleDepth( const DepthPyramid& _Pyramid );
+
+	// Upsamples the low resolution source into the full resolution target, using the depths of the last call to DownsampleDepth()
+	void				Upsample( const Texture2D& _DepthStencil, const Texture2D& _Source, const Texture2D& _Target );
+};
@@ -0,0 +1,160 @@
+#include "../GodComplex.h"
+
+static const int	THREADS_X = 8;				// Threads per group of CS_Prefilter & CS_BRDF, cf. EnvMapFilter.hlsl
+static const int	THREADS_Y = 8;
+static const int	DEFAULT_SAMPLES_COUNT = 64;
+
+EnvMapFilter::EnvMapFilter( Device& _Device, int _Width, int _MipsCount )
+	: m_Device( _Device )
+	, m_MipsCount( _MipsCount )
+	, m_SamplesCount( DEFAULT_SAMPLES_COUNT )
+	, m_FrontIndex( 0 )
+	, m_UpdateStep( 0 )
+	, m_bBRDFBaked( false )
+{
+	ASSERT( _MipsCount >= 2, "The prefiltered map needs at least a mirror mip and a rough mip!" );
+
+	m_pCSPrefilter = CreateComputeShader( IDR_SHADER_ENV_MAP_FILTER, "./Resources/Shaders/EnvMapFilter.hlsl", "CS_Prefilter" );
+	m_pCSBRDF = CreateComputeShader( IDR_SHADER_ENV_MAP_FILTER, "./Resources/Shaders/EnvMapFilter.hlsl", "CS_BRDF" );
+	m_pCSProjectSH = CreateComputeShader( IDR_SHADER_ENV_MAP_FILTER, "./Resources/Shaders/EnvMapFilter.hlsl", "CS_ProjectSH" );
+
+	for ( int BufferIndex=0; BufferIndex < 2; BufferIndex++ )
+	{
+		m_ppTexPrefiltered[BufferIndex] = new Texture2D( m_Device, _Width, _Width >> 1, 1, PixelFormatRGBA16F::DESCRIPTOR, m_MipsCount, NULL, false, true );
+		m_ppTexPrefiltered[BufferIndex]->m_pMemoryTag = "Env Map";
+		m_ppSB_SH[BufferIndex] = new SB<float4>( m_Device, 9, true );
+	}
+	m_pTexBRDF = new Texture2D( m_Device, BRDF_SIZE, BRDF_SIZE, 1, PixelFormatRG16F::DESCRIPTOR, 1, NULL, false, true );
+	m_pTexBRDF->m_pMemoryTag = "Env Map";
+
+	m_pCB_EnvMapFilter = new CB<CBEnvMapFilter>( m_Device, 10 );
+	memset( &m_pCB_EnvMapFilter->m, 0, sizeof(CBEnvMapFilter) );
+}
+
+EnvMapFilter::~EnvMapFilter()
+{
+	delete m_pCB_EnvMapFilter;
+	delete m_pTexBRDF;
+	for ( int BufferIndex=0; BufferIndex < 2; BufferIndex++ )
+	{
+		delete m_ppSB_SH[BufferIndex];
+		delete m_ppTexPrefiltered[BufferIndex];
+	}
+	delete m_pCSProjectSH;
+	delete m_pCSBRDF;
+	delete m_pCSPrefilter;
+}
+
+bool	EnvMapFilter::HasErrors() const
+{
+	return m_pCSPrefilter->HasErrors() || m_pCSBRDF->HasErrors() || m_pCSProjectSH->HasErrors();
+}
+
+bool	EnvMapFilter::Update( const Texture2D& _Source, bool _bIncremental )
+{
+	if ( !m_bBRDFBaked )
+		m_bBRDFBaked = BakeBRDF();	// Doesn't depend on the source
+
+	m_pCB_EnvMapFilter->m.SourceSizeX = _Source.GetWidth();
+	m_pCB_EnvMapFilter->m.SourceSizeY = _Source.GetHeight();
+	m_pCB_EnvMapFilter->m.SourceMipsCount = _Source.GetMipLevelsCount();
+	m_pCB_EnvMapFilter->m.SamplesCount = m_SamplesCount;
+
+	// Steps [0,MipsCount[ filter the mips, step MipsCount projects the SH
+	int	StepsCount = _bIncremental ? 1 : m_MipsCount+1 - m_UpdateStep;
+	for ( int StepIndex=0; StepIndex < StepsCount; StepIndex++ )
+	{
+		bool	bDone = m_UpdateStep < m_MipsCount ? Prefilter( _Source, m_UpdateStep ) : ProjectSH( _Source );
+		if ( !bDone )
+			return false;	// Kernels aren't ready yet, try the same step again next time
+		m_UpdateStep++;
+	}
+
+	if ( m_UpdateStep <= m_MipsCount )
+		return false;	// More steps to go
+
+	m_FrontIndex = 1 - m_FrontIndex;
+	m_UpdateStep = 0;
+	return true;
+}
+
+bool	EnvMapFilter::Prefilter( const Texture2D& _Source, int _MipLevelIndex )
+{
+	if ( !m_pCSPrefilter->Use() )
+		return false;
+
+	Texture2D&	Target = *m_ppTexPrefiltered[1-m_FrontIndex];
+
+	int	TargetWidth = Target.GetWidth();
+	int	TargetHeight = Target.GetHeight();
+	for ( int MipLevelIndex=0; MipLevelIndex < _MipLevelIndex; MipLevelIndex++ )
+		Texture2D::NextMipSize( TargetWidth, TargetHeight );
+
+	m_pCB_EnvMapFilter->m.TargetSizeX = TargetWidth;
+	m_pCB_EnvMapFilter->m.TargetSizeY = TargetHeight;
+	m_pCB_EnvMapFilter->m.Roughness = float(_MipLevelIndex) / (m_MipsCount-1);
+	m_pCB_EnvMapFilter->UpdateData();
+
+	Target.RemoveFromLastAssignedSlots();
+	_Source.SetCS( 10 );
+	Target.SetCSUAV( 0, Target.GetUAV( _MipLevelIndex, 0, 1 ) );
+
+	m_pCSPrefilter->Dispatch( (TargetWidth+THREADS_X-1) / THREADS_X, (TargetHeight+THREADS_Y-1) / THREADS_Y, 1 );
+
+	m_Device.RemoveShaderResources( 10, 1, Device::SSF_COMPUTE_SHADER );
+	Target.RemoveFromLastAssignedSlotUAV();
+
+	return true;
+}
+
+bool	EnvMapFilter::ProjectSH( const Texture2D& _Source )
+{
+	if ( !m_pCSProjectSH->Use() )
+		return false;
+
+	// Project a low mip, the SH can't hold the details anyway
+	int	SourceWidth = _Source.GetWidth();
+	int	SourceHeight = _Source.GetHeight();
+	int	SHSourceMip = 0;
+	while ( SourceWidth > SH_SOURCE_MAX_WIDTH && SHSourceMip < _Source.GetMipLevelsCount()-1 )
+	{
+		Texture2D::NextMipSize( SourceWidth, SourceHeight );
+		SHSourceMip++;
+	}
+
+	m_pCB_EnvMapFilter->m.TargetSizeX = SourceWidth;
+	m_pCB_EnvMapFilter->m.TargetSizeY = SourceHeight;
+	m_pCB_EnvMapFilter->m.SHSourceMip = SHSourceMip;
+	m_pCB_EnvMapFilter->UpdateData();
+
+	SB<float4>&	SH = *m_ppSB_SH[1-m_FrontIndex];
+	SH.RemoveFromLastAssignedSlots();
+	_Source.SetCS( 10 );
+	SH.SetOutput( 1 );
+
+	m_pCSProjectSH->Dispatch( 1, 1, 1 );
+
+	m_Device.RemoveShaderResources( 10, 1, Device::SSF_COMPUTE_SHADER );
+	SH.GetStructuredBuffer().RemoveFromLastAssignedSlotUAV();
+
+	return true;
+}
+
+bool	EnvMapFilter::BakeBRDF()
+{
+	if ( !m_pCSBRDF->Use() )
+		return false;
+
+	m_pCB_EnvMapFilter->m.TargetSizeX = BRDF_SIZE;
+	m_pCB_EnvMapFilter->m.TargetSizeY = BRDF_SIZE;
+	m_pCB_EnvMapFilter->UpdateData();
+
+	m_pTexBRDF->RemoveFromLastAssignedSlots();
+	m_pTexBRDF->SetCSUAV( 0 );
+
+	m_pCSBRDF->Dispatch( BRDF_SIZE / THREADS_X, BRDF_SIZE / THREADS_Y, 1 );
+
+	m_pTexBRDF->RemoveFromLastAssignedSlotUAV();
+
+	return true;
+}
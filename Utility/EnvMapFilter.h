@@ -0,0 +1,102 @@
+//////////////////////////////////////////////////////////////////////////
+// GPU environment map prefiltering for image-based lighting (cf. EnvMapFilter.hlsl)
+// Builds from a latitude/longitude environment map everything the split-sum approximation of the GGX specular and the
+//	diffuse ambient need, so a changing sky never goes through the CPU:
+//	_ CS_Prefilter, one dispatch per mip of the prefiltered map: importance-samples the GGX lobe of the mip's roughness
+//		(mip/(MipsCount-1) is the perceptual roughness), each sample reads the source mip matching its PDF to avoid fireflies
+//	_ CS_BRDF, bakes the scale & bias applied to F0 by the pre-integrated BRDF (RG), indexed by (N.V, roughness). Baked only once.
+//	_ CS_ProjectSH, a single group projects a low mip of the source onto SH9 (same basis as SH::BuildSHCoeffs_YUp())
+//
+// Directions map to the lat/long maps with the Y-up convention: ϕ = 2PI * U is zero on +X and PI/2 on +Z, θ = PI * V is zero on +Y
+//	Dir = ( sinθ cosϕ, cosθ, sinθ sinϕ )
+//
+// Incremental updates spread the work over several frames (one mip, then the SH, per call) for a sky that changes with
+//	the time of day. Results are double-buffered: the maps returned by the getters are always a complete set built from
+//	the same source and they're swapped once the last step is done.
+//
+// Usage:
+//	EnvMapFilter	Filter( gs_Device );
+//	Filter.Update( *pTexSky );						// Builds everything at once
+//	(...)
+//	Filter.Update( *pTexSky, true );				// Each frame, with a changing sky
+//	Filter.GetPrefiltered().SetPS( 18 );	Filter.GetBRDF().SetPS( 19 );	Filter.GetSH().SetInput( 20 );
+//
+// NOTE: The source should have its mips for the PDF-based filtering to be effective (cf. MipGenerator).
+//	The compute shader slots t10, u0, u1 & b10 are overwritten.
+//
+#pragma once
+
+template<typename> class CB;
+template<typename> class SB;
+
+class	EnvMapFilter
+{
+public:		// CONSTANTS
+
+	static const int	DEFAULT_WIDTH = 256;
+	static const int	DEFAULT_MIPS_COUNT = 6;		// Roughness steps of 0.2
+	static const int	BRDF_SIZE = 64;
+	static const int	SH_SOURCE_MAX_WIDTH = 128;	// The SH are projected from the first source mip that's at most that wide
+
+protected:	// NESTED TYPES
+
+	// WARNING: must match the cbEnvMapFilter constant buffer in EnvMapFilter.hlsl!
+	struct	CBEnvMapFilter
+	{
+		U32		SourceSizeX, SourceSizeY;
+		U32		SourceMipsCount;
+		U32		SamplesCount;
+
+		U32		TargetSizeX, TargetSizeY;
+		float	Roughness;
+		U32		SHSourceMip;
+	};
+
+protected:	// FIELDS
+
+	Device&				m_Device;
+
+	int					m_MipsCount;
+	int					m_SamplesCount;
+
+	ComputeShader*		m_pCSPrefilter;
+	ComputeShader*		m_pCSBRDF;
+	ComputeShader*		m_pCSProjectSH;
+
+	Texture2D*			m_ppTexPrefiltered[2];	// Front & back
+	SB<float4>*			m_ppSB_SH[2];			// 9 coefficients, W unused
+	Texture2D*			m_pTexBRDF;
+	CB<CBEnvMapFilter>*	m_pCB_EnvMapFilter;
+
+	int					m_FrontIndex;
+	int					m_UpdateStep;			// Next step of an incremental update: the mips, then the SH
+	bool				m_bBRDFBaked;
+
+public:		// PROPERTIES
+
+	bool				HasErrors() const;
+
+	const Texture2D&	GetPrefiltered() const	{ return *m_ppTexPrefiltered[m_FrontIndex]; }
+	const Texture2D&	GetBRDF() const			{ return *m_pTexBRDF; }
+	SB<float4>&			GetSH() const			{ return *m_ppSB_SH[m_FrontIndex]; }
+
+	// GGX samples per texel of the prefiltered mips (the default 64 is enough with the PDF-based filtering)
+	void				SetSamplesCount( int _SamplesCount )	{ m_SamplesCount = _SamplesCount; }
+
+public:		// METHODS
+
+	// _Width, the width of the prefiltered map's mip 0, its height is half of it
+	EnvMapFilter( Device& _Device, int _Width=DEFAULT_WIDTH, int _MipsCount=DEFAULT_MIPS_COUNT );
+	~EnvMapFilter();
+
+	// Filters the source into the back buffers and swaps them with the front
+	// _bIncremental, only one step is done per call and the buffers are swapped after the last one
+	// Returns true when the front buffers have been replaced by the ones built from this source
+	bool				Update( const Texture2D& _Source, bool _bIncremental=false );
+
+protected:
+
+	bool				Prefilter( const Texture2D& _Source, int _MipLevelIndex );
+	bool				ProjectSH( const Texture2D& _Source );
+	bool				BakeBRDF();
+};
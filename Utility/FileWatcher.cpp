@@ -0,0 +1,129 @@
+#include "../GodComplex.h"
+
+FileWatcher::FileWatcher( const char* _pDirectory )
+	: m_hThread( NULL )
+	, m_ChangesCount( 0 )
+	, m_bOverflow( 0 )
+{
+	strcpy_s( m_pDirectory, _pDirectory );
+	InitializeCriticalSection( &m_Lock );
+
+	memset( &m_Overlapped, 0, sizeof(OVERLAPPED) );
+	m_Overlapped.hEvent = CreateEvent( NULL, FALSE, FALSE, NULL );
+	m_hQuitEvent = CreateEvent( NULL, FALSE, FALSE, NULL );
+
+	m_hDirectory = CreateFileA( _pDirectory, FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL );
+	ASSERT( m_hDirectory != INVALID_HANDLE_VALUE, "Failed to open the directory to watch!" );
+	if ( m_hDirectory == INVALID_HANDLE_VALUE )
+		return;
+
+	DWORD	ThreadID;
+	m_hThread = CreateThread( NULL, 0, WatcherThread, this, 0, &ThreadID );
+	ASSERT( m_hThread != NULL, "Failed to create the file watcher thread!" );
+}
+
+FileWatcher::~FileWatcher()
+{
+	if ( m_hThread != NULL )
+	{
+		SetEvent( m_hQuitEvent );
+		WaitForSingleObject( m_hThread, INFINITE );
+		CloseHandle( m_hThread );
+	}
+	if ( m_hDirectory != INVALID_HANDLE_VALUE )
+		CloseHandle( m_hDirectory );
+
+	CloseHandle( m_hQuitEvent );
+	CloseHandle( m_Overlapped.hEvent );
+	DeleteCriticalSection( &m_Lock );
+}
+
+bool	FileWatcher::Pop( char _pFileName[MAX_PATH] )
+{
+	EnterCriticalSection( &m_Lock );
+	bool	bChanged = m_ChangesCount > 0;
+	if ( bChanged )
+		strcpy_s( _pFileName, MAX_PATH, m_ppChanges[--m_ChangesCount] );
+	LeaveCriticalSection( &m_Lock );
+
+	return bChanged;
+}
+
+bool	FileWatcher::HasOverflowed()
+{
+	return InterlockedExchange( &m_bOverflow, 0 ) != 0;
+}
+
+void	FileWatcher::Queue( const FILE_NOTIFY_INFORMATION& _Notification )
+{
+	if ( _Notification.Action == FILE_ACTION_REMOVED || _Notification.Action == FILE_ACTION_RENAMED_OLD_NAME )
+		return;	// Nothing to reload
+
+	char	pFileName[MAX_PATH];
+	int		DirectoryLength = sprintf_s( pFileName, "%s/", m_pDirectory );
+	int		NameLength = WideCharToMultiByte( CP_ACP, 0, _Notification.FileName, _Notification.FileNameLength / sizeof(WCHAR), pFileName + DirectoryLength, MAX_PATH - 1 - DirectoryLength, NULL, NULL );
+	if ( NameLength == 0 )
+		return;	// Path too long
+
+	pFileName[DirectoryLength+NameLength] = '\0';
+	for ( char* pChar=pFileName+DirectoryLength; *pChar != '\0'; pChar++ )
+		if ( *pChar == '\\' )
+			*pChar = '/';
+
+	EnterCriticalSection( &m_Lock );
+
+	bool	bAlreadyQueued = false;
+	for ( int ChangeIndex=0; ChangeIndex < m_ChangesCount; ChangeIndex++ )
+		if ( !_stricmp( m_ppChanges[ChangeIndex], pFileName ) )
+		{
+			bAlreadyQueued = true;
+			break;
+		}
+
+	if ( !bAlreadyQueued && m_ChangesCount < MAX_QUEUED_CHANGES )
+		strcpy_s( m_ppChanges[m_ChangesCount++], pFileName );
+	else if ( !bAlreadyQueued )
+		InterlockedExchange( &m_bOverflow, 1 );
+
+	LeaveCriticalSection( &m_Lock );
+}
+
+DWORD WINAPI	FileWatcher::WatcherThread( LPVOID _pParam )
+{
+	FileWatcher&	Owner = *((FileWatcher*) _pParam);
+	HANDLE			pEvents[2] = { Owner.m_Overlapped.hEvent, Owner.m_hQuitEvent };
+	DWORD			BytesCount;
+	while ( true )
+	{
+		if ( !ReadDirectoryChangesW( Owner.m_hDirectory, Owner.m_pNotifications, sizeof(Owner.m_pNotifications), TRUE, FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME, NULL, &Owner.m_Overlapped, NULL ) )
+			break;	// The directory is gone?
+
+		if ( WaitForMultipleObjects( 2, pEvents, FALSE, INFINITE ) != WAIT_OBJECT_0 )
+		{	// Quit but wait for the cancelled read to complete since it writes into our buffer
+			CancelIo( Owner.m_hDirectory );
+			GetOverlappedResult( Owner.m_hDirectory, &Owner.m_Overlapped, &BytesCount, TRUE );
+			break;
+		}
+
+		if ( !GetOverlappedResult( Owner.m_hDirectory, &Owner.m_Overlapped, &BytesCount, FALSE ) )
+			break;
+
+		if ( BytesCount == 0 )
+		{	// The system's buffer overflowed, we don't know what changed
+			InterlockedExchange( &Owner.m_bOverflow, 1 );
+			continue;
+		}
+
+		const U8*	pNotification = (const U8*) Owner.m_pNotifications;
+		while ( true )
+		{
+			const FILE_NOTIFY_INFORMATION&	Notification = *((const FILE_NOTIFY_INFORMATION*) pNotification);
+			Owner.Queue( Notification );
+			if ( Notification.NextEntryOffset == 0 )
+				break;
+			pNotification += Notification.NextEntryOffset;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,56 @@
+//////////////////////////////////////////////////////////////////////////
+// Directory changes notifications
+//
+// A background thread waits on ReadDirectoryChangesW() for the whole directory tree and queues the paths of the files that
+//	were written to, the main thread then simply pops them instead of polling the time stamp of every watched file.
+// Popped paths are "<Directory>/<Relative path>" with '/' separators so they can be compared to the paths given in code
+//	(e.g. "./Resources/Shaders/Inc/Global.hlsl"), but with the case of the file on disk: use _stricmp() to compare them.
+//
+// NOTE: A single save often triggers several notifications for the same file (editors write in multiple passes),
+//	don't rebuild anything twice without checking the file actually changed.
+// If too many changes occur at once, the notifications are lost and HasOverflowed() tells you to check everything.
+//
+#pragma once
+
+class FileWatcher
+{
+public:		// CONSTANTS
+
+	static const int	MAX_QUEUED_CHANGES = 64;
+
+private:	// FIELDS
+
+	char				m_pDirectory[MAX_PATH];
+
+	HANDLE				m_hDirectory;
+	HANDLE				m_hThread;
+	HANDLE				m_hQuitEvent;
+	OVERLAPPED			m_Overlapped;
+	DWORD				m_pNotifications[2048];		// FILE_NOTIFY_INFORMATION must be DWORD-aligned
+
+	CRITICAL_SECTION	m_Lock;						// Protects the queued changes
+	char				m_ppChanges[MAX_QUEUED_CHANGES][MAX_PATH];
+	int					m_ChangesCount;
+	volatile LONG		m_bOverflow;
+
+public:		// PROPERTIES
+
+	bool		IsWatching() const	{ return m_hThread != NULL; }
+
+public:		// METHODS
+
+	FileWatcher( const char* _pDirectory );
+	~FileWatcher();
+
+	// Pops the path of a changed file, returns false if nothing changed
+	bool		Pop( char _pFileName[MAX_PATH] );
+
+	// Returns true once after changes were lost
+	bool		HasOverflowed();
+
+private:
+
+	void		Queue( const FILE_NOTIFY_INFORMATION& _Notification );
+
+	static DWORD WINAPI	WatcherThread( LPVOID _pParam );
+};
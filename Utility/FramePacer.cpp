@@ -0,0 +1,66 @@
+#include "../GodComplex.h"
+
+FramePacer::FramePacer( float _StepsPerSecond )
+	: m_Step( 1.0 / _StepsPerSecond )
+	, m_Time( 0.0 )
+	, m_DeltaTime( 0.0 )
+	, m_SimulationTime( 0.0 )
+	, m_Accumulator( 0.0 )
+	, m_StepsCount( 0 )
+{
+	ASSERT( _StepsPerSecond > 0.0f, "Invalid simulation rate!" );
+
+	LARGE_INTEGER	Frequency;
+	QueryPerformanceFrequency( &Frequency );
+	m_TicksToSeconds = 1.0 / Frequency.QuadPart;
+
+	QueryPerformanceCounter( &m_StartTicks );
+	m_LastTicks = m_StartTicks;
+}
+
+double	FramePacer::GetClockTime() const
+{
+	LARGE_INTEGER	Ticks;
+	QueryPerformanceCounter( &Ticks );
+	return (Ticks.QuadPart - m_StartTicks.QuadPart) * m_TicksToSeconds;
+}
+
+void	FramePacer::BeginFrame()
+{
+	LARGE_INTEGER	Ticks;
+	QueryPerformanceCounter( &Ticks );
+
+	m_DeltaTime = (Ticks.QuadPart - m_LastTicks.QuadPart) * m_TicksToSeconds;
+	m_Time = (Ticks.QuadPart - m_StartTicks.QuadPart) * m_TicksToSeconds;
+	m_LastTicks = Ticks;
+
+	m_Accumulator += m_DeltaTime;
+	m_StepsCount = 0;
+}
+
+void	FramePacer::BeginFrame( double _Time )
+{
+	m_DeltaTime = MAX( 0.0, _Time - m_Time );	// The clock may jump backward when seeking
+	m_Time = _Time;
+
+	m_Accumulator += m_DeltaTime;
+	m_StepsCount = 0;
+}
+
+bool	FramePacer::Step()
+{
+	if ( m_Accumulator < m_Step )
+		return false;
+
+	if ( m_StepsCount >= MAX_STEPS_PER_FRAME )
+	{	// We're too late, drop the time we couldn't simulate
+		m_Accumulator = fmod( m_Accumulator, m_Step );
+		return false;
+	}
+
+	m_Accumulator -= m_Step;
+	m_SimulationTime += m_Step;
+	m_StepsCount++;
+
+	return true;
+}
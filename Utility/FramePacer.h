@@ -0,0 +1,65 @@
+//////////////////////////////////////////////////////////////////////////
+// Frame pacing
+// Samples a high resolution clock (QueryPerformanceCounter) once per frame and splits the elapsed time into fixed simulation
+//	steps so the simulation doesn't depend on the frame rate. Rendering then uses GetAlpha() to interpolate between the last
+//	two simulated states, or simply GetRenderTime() which lags the simulation by less than a step.
+//
+// Usage:
+//	Pacer.BeginFrame();
+//	while ( Pacer.Step() )
+//		Simulate( Pacer.GetSimulationTime(), Pacer.GetStep() );
+//	Render( Pacer.GetRenderTime(), Pacer.GetDeltaTime() );
+//
+// The frame time can also be driven by an external clock with BeginFrame( _Time ) (e.g. SynthStream::GetPlayTime()).
+//
+// NOTE: When a frame takes too long (e.g. breakpoint, shader recompilation), no more than MAX_STEPS_PER_FRAME steps are simulated
+//	and the remaining time is dropped so we never spiral into simulating ever more steps per frame.
+//
+#pragma once
+
+class FramePacer
+{
+public:		// CONSTANTS
+
+	static const int	MAX_STEPS_PER_FRAME = 8;
+
+private:	// FIELDS
+
+	double			m_TicksToSeconds;
+	LARGE_INTEGER	m_StartTicks;
+	LARGE_INTEGER	m_LastTicks;
+
+	double			m_Step;					// Duration of a simulation step (s)
+	double			m_Time;					// Time of the current frame since the creation of the pacer (s)
+	double			m_DeltaTime;			// Time elapsed since the previous frame (s)
+	double			m_SimulationTime;		// Time of the last simulated step (s)
+	double			m_Accumulator;			// Time left to simulate (s)
+	int				m_StepsCount;			// Steps already simulated this frame
+
+public:		// PROPERTIES
+
+	float		GetTime() const				{ return float(m_Time); }
+	float		GetDeltaTime() const		{ return float(m_DeltaTime); }
+	float		GetStep() const				{ return float(m_Step); }
+	float		GetSimulationTime() const	{ return float(m_SimulationTime); }
+
+	// Interpolation factor in [0,1[ between the previous simulated state and the last one
+	float		GetAlpha() const			{ return float(m_Accumulator / m_Step); }
+	float		GetRenderTime() const		{ return float(MAX( 0.0, m_SimulationTime - m_Step + m_Accumulator )); }
+
+public:		// METHODS
+
+	FramePacer( float _StepsPerSecond=60.0f );
+
+	// Samples the clock at the beginning of a new frame
+	void		BeginFrame();
+
+	// Begins a new frame at the given time of an external clock instead (e.g. the audio clock to sync on the music)
+	void		BeginFrame( double _Time );
+
+	// Returns true while there is a fixed step to simulate for this frame, advancing the simulation time
+	bool		Step();
+
+	// Returns the current time in seconds since the creation of the pacer
+	double		GetClockTime() const;
+};
@@ -0,0 +1,250 @@
+#include "../GodComplex.h"
+
+static const int	SCAN_GROUP_SIZE = 256;		// Threads per group of the kernels, cf. GPUAlgorithms.hlsl
+static const int	COMPACT_GROUP_SIZE = 256;
+static const int	MAX_GROUPS_COUNT = 65535;	// Maximum amount of thread groups of a 1D dispatch
+
+GPUAlgorithms::GPUAlgorithms( Device& _Device, int _MaxElementsCount )
+	: m_Device( _Device )
+	, m_MaxElementsCount( _MaxElementsCount )
+{
+	ASSERT( _MaxElementsCount > 0 && _MaxElementsCount <= MAX_GROUPS_COUNT * COMPACT_GROUP_SIZE, "Too many elements for a single dispatch!" );
+
+	m_pCSScanBlocks = CreateComputeShader( IDR_SHADER_GPU_ALGORITHMS, "./Resources/Shaders/GPUAlgorithms.hlsl", "CS_ScanBlocks" );
+	m_pCSAddBlockOffsets = CreateComputeShader( IDR_SHADER_GPU_ALGORITHMS, "./Resources/Shaders/GPUAlgorithms.hlsl", "CS_AddBlockOffsets" );
+	m_pCSCompact = CreateComputeShader( IDR_SHADER_GPU_ALGORITHMS, "./Resources/Shaders/GPUAlgorithms.hlsl", "CS_Compact" );
+	m_pCSReduce = CreateComputeShader( IDR_SHADER_GPU_ALGORITHMS, "./Resources/Shaders/GPUAlgorithms.hlsl", "CS_Reduce" );
+	m_pCSRadixCount = CreateComputeShader( IDR_SHADER_GPU_ALGORITHMS, "./Resources/Shaders/GPUAlgorithms.hlsl", "CS_RadixCount" );
+	m_pCSRadixScatter = CreateComputeShader( IDR_SHADER_GPU_ALGORITHMS, "./Resources/Shaders/GPUAlgorithms.hlsl", "CS_RadixScatter" );
+
+	// The sort scans its digit counts, which can outnumber the elements for small lists
+	int	RadixGroupsCount = (m_MaxElementsCount + RADIX_BLOCK_SIZE-1) / RADIX_BLOCK_SIZE;
+	int	DigitCountsCount = RADIX_DIGITS * RadixGroupsCount;
+
+	int	LevelCount = MAX( m_MaxElementsCount, DigitCountsCount );
+	for ( int Level=0; Level < MAX_SCAN_LEVELS; Level++ )
+	{
+		LevelCount = (LevelCount + SCAN_BLOCK_SIZE-1) / SCAN_BLOCK_SIZE;
+		m_ppSB_BlockTotals[Level] = new StructuredBuffer( m_Device, sizeof(U32), LevelCount, true );
+		m_ppSB_BlockOffsets[Level] = new StructuredBuffer( m_Device, sizeof(U32), LevelCount, true );
+	}
+	ASSERT( LevelCount == 1, "Too many elements to scan! Increase MAX_SCAN_LEVELS..." );
+
+	m_pSB_Offsets = new StructuredBuffer( m_Device, sizeof(U32), m_MaxElementsCount, true );
+	m_pSB_SortKeys = new StructuredBuffer( m_Device, sizeof(U32), m_MaxElementsCount, true );
+	m_pSB_SortValues = new StructuredBuffer( m_Device, sizeof(U32), m_MaxElementsCount, true );
+	m_pSB_DigitCounts = new StructuredBuffer( m_Device, sizeof(U32), DigitCountsCount, true );
+	m_pSB_DigitOffsets = new StructuredBuffer( m_Device, sizeof(U32), DigitCountsCount, true );
+
+	m_pCB_Algorithms = new CB<CBGPUAlgorithms>( m_Device, 10 );
+	memset( &m_pCB_Algorithms->m, 0, sizeof(CBGPUAlgorithms) );
+}
+
+GPUAlgorithms::~GPUAlgorithms()
+{
+	delete m_pCB_Algorithms;
+	delete m_pSB_DigitOffsets;
+	delete m_pSB_DigitCounts;
+	delete m_pSB_SortValues;
+	delete m_pSB_SortKeys;
+	delete m_pSB_Offsets;
+	for ( int Level=0; Level < MAX_SCAN_LEVELS; Level++ )
+	{
+		delete m_ppSB_BlockOffsets[Level];
+		delete m_ppSB_BlockTotals[Level];
+	}
+	delete m_pCSRadixScatter;
+	delete m_pCSRadixCount;
+	delete m_pCSReduce;
+	delete m_pCSCompact;
+	delete m_pCSAddBlockOffsets;
+	delete m_pCSScanBlocks;
+}
+
+bool	GPUAlgorithms::HasErrors() const
+{
+	return m_pCSScanBlocks->HasErrors() || m_pCSAddBlockOffsets->HasErrors() || m_pCSCompact->HasErrors()
+		|| m_pCSReduce->HasErrors() || m_pCSRadixCount->HasErrors() || m_pCSRadixScatter->HasErrors();
+}
+
+bool	GPUAlgorithms::Scan( StructuredBuffer& _Input, StructuredBuffer& _Output, int _Count )
+{
+	ASSERT( _Count <= m_MaxElementsCount, "Too many elements!" );
+	ASSERT( &_Input != &_Output, "The scan can't be done in place!" );
+	if ( HasErrors() )
+		return false;
+	if ( _Count <= 0 )
+		return true;
+
+	ScanLevel( _Input, _Output, _Count, 0 );
+	return true;
+}
+
+bool	GPUAlgorithms::Compact( StructuredBuffer& _Values, StructuredBuffer& _Flags, int _Count, StructuredBuffer& _Output, StructuredBuffer& _IndirectArgs, int _ArgsGroupSize )
+{
+	ASSERT( _Count <= m_MaxElementsCount, "Too many elements!" );
+	ASSERT( _IndirectArgs.IsRaw() && _IndirectArgs.GetSize() >= 4*sizeof(U32), "The indirect arguments must be a raw buffer of at least 4 U32!" );
+	if ( HasErrors() )
+		return false;
+	if ( _Count <= 0 )
+	{	// Nothing to keep, the kernel wouldn't write the arguments
+		U32	pZero[4] = { 0, 0, 0, 0 };
+		_IndirectArgs.Clear( pZero );
+		return true;
+	}
+
+	// 1] Each kept element's destination is the amount of kept elements before it
+	ScanLevel( _Flags, *m_pSB_Offsets, _Count, 0 );
+
+	// 2] Scatter
+	m_pCB_Algorithms->m.Count = _Count;
+	m_pCB_Algorithms->m.ArgsGroupSize = MAX( 1, _ArgsGroupSize );
+	m_pCB_Algorithms->UpdateData();
+
+	m_pCSCompact->Use();
+	_Values.SetInput( 10 );
+	_Flags.SetInput( 11 );
+	m_pSB_Offsets->SetInput( 12 );
+	_Output.SetOutput( 0 );
+	_IndirectArgs.SetOutput( 1 );
+
+	m_pCSCompact->Dispatch( (_Count + COMPACT_GROUP_SIZE-1) / COMPACT_GROUP_SIZE, 1, 1 );
+
+	_Values.RemoveFromLastAssignedSlots();
+	_Flags.RemoveFromLastAssignedSlots();
+	m_pSB_Offsets->RemoveFromLastAssignedSlots();
+	_Output.RemoveFromLastAssignedSlotUAV();
+	_IndirectArgs.RemoveFromLastAssignedSlotUAV();
+
+	return true;
+}
+
+bool	GPUAlgorithms::Reduce( StructuredBuffer& _Input, int _SegmentsCount, int _SegmentSize, StructuredBuffer& _Output, REDUCE_OPERATION _Operation )
+{
+	ASSERT( _SegmentsCount <= MAX_GROUPS_COUNT, "Too many segments for a single dispatch!" );
+	ASSERT( _SegmentsCount * _SegmentSize <= _Input.GetElementsCount(), "Segments out of the input!" );
+	if ( HasErrors() )
+		return false;
+	if ( _SegmentsCount <= 0 )
+		return true;
+
+	m_pCB_Algorithms->m.Count = _SegmentsCount;
+	m_pCB_Algorithms->m.SegmentSize = _SegmentSize;
+	m_pCB_Algorithms->m.Operation = _Operation;
+	m_pCB_Algorithms->UpdateData();
+
+	m_pCSReduce->Use();
+	_Input.SetInput( 13 );
+	_Output.SetOutput( 0 );
+
+	m_pCSReduce->Dispatch( _SegmentsCount, 1, 1 );
+
+	_Input.RemoveFromLastAssignedSlots();
+	_Output.RemoveFromLastAssignedSlotUAV();
+
+	return true;
+}
+
+bool	GPUAlgorithms::Sort( StructuredBuffer& _Keys, StructuredBuffer& _Values, int _Count, int _KeyBits )
+{
+	ASSERT( _Count <= m_MaxElementsCount, "Too many elements!" );
+	if ( HasErrors() )
+		return false;
+	if ( _Count <= 1 )
+		return true;
+
+	// Passes go by pairs so the result lands back into the caller's buffers
+	int	PassesCount = 2 * ((CLAMP( _KeyBits, 1, 32 ) + 2*RADIX_BITS-1) / (2*RADIX_BITS));
+	for ( int PassIndex=0; PassIndex < PassesCount; PassIndex+=2 )
+	{
+		RadixPass( _Keys, _Values, *m_pSB_SortKeys, *m_pSB_SortValues, _Count, RADIX_BITS * PassIndex );
+		RadixPass( *m_pSB_SortKeys, *m_pSB_SortValues, _Keys, _Values, _Count, RADIX_BITS * (PassIndex+1) );
+	}
+
+	return true;
+}
+
+void	GPUAlgorithms::ScanLevel( StructuredBuffer& _Input, StructuredBuffer& _Output, int _Count, int _Level )
+{
+	ASSERT( _Level < MAX_SCAN_LEVELS, "Too many elements to scan! Increase MAX_SCAN_LEVELS..." );
+
+	int					BlocksCount = (_Count + SCAN_BLOCK_SIZE-1) / SCAN_BLOCK_SIZE;
+	StructuredBuffer&	BlockTotals = *m_ppSB_BlockTotals[_Level];
+	StructuredBuffer&	BlockOffsets = *m_ppSB_BlockOffsets[_Level];
+
+	// 1] Scan each block and write its total
+	m_pCB_Algorithms->m.Count = _Count;
+	m_pCB_Algorithms->UpdateData();
+
+	m_pCSScanBlocks->Use();
+	_Input.SetInput( 10 );
+	_Output.SetOutput( 0 );
+	BlockTotals.SetOutput( 1 );
+
+	m_pCSScanBlocks->Dispatch( BlocksCount, 1, 1 );
+
+	_Input.RemoveFromLastAssignedSlots();
+	_Output.RemoveFromLastAssignedSlotUAV();
+	BlockTotals.RemoveFromLastAssignedSlotUAV();
+
+	if ( BlocksCount == 1 )
+		return;	// The only block starts at 0
+
+	// 2] Scan the totals into the blocks' offsets
+	ScanLevel( BlockTotals, BlockOffsets, BlocksCount, _Level+1 );
+
+	// 3] Offset the blocks
+	m_pCB_Algorithms->m.Count = _Count;
+	m_pCB_Algorithms->UpdateData();
+
+	m_pCSAddBlockOffsets->Use();
+	BlockOffsets.SetInput( 12 );
+	_Output.SetOutput( 0 );
+
+	m_pCSAddBlockOffsets->Dispatch( BlocksCount, 1, 1 );
+
+	BlockOffsets.RemoveFromLastAssignedSlots();
+	_Output.RemoveFromLastAssignedSlotUAV();
+}
+
+void	GPUAlgorithms::RadixPass( StructuredBuffer& _Keys, StructuredBuffer& _Values, StructuredBuffer& _SortedKeys, StructuredBuffer& _SortedValues, int _Count, int _Shift )
+{
+	int	GroupsCount = (_Count + RADIX_BLOCK_SIZE-1) / RADIX_BLOCK_SIZE;
+
+	// 1] Count the digits of each block
+	m_pCB_Algorithms->m.Count = _Count;
+	m_pCB_Algorithms->m.Shift = _Shift;
+	m_pCB_Algorithms->m.GroupsCount = GroupsCount;
+	m_pCB_Algorithms->UpdateData();
+
+	m_pCSRadixCount->Use();
+	_Keys.SetInput( 10 );
+	m_pSB_DigitCounts->SetOutput( 0 );
+
+	m_pCSRadixCount->Dispatch( GroupsCount, 1, 1 );
+
+	_Keys.RemoveFromLastAssignedSlots();
+	m_pSB_DigitCounts->RemoveFromLastAssignedSlotUAV();
+
+	// 2] Scan the counts into each block's destination per digit
+	ScanLevel( *m_pSB_DigitCounts, *m_pSB_DigitOffsets, RADIX_DIGITS * GroupsCount, 0 );
+
+	// 3] Sort each block by digit and scatter it
+	m_pCB_Algorithms->m.Count = _Count;
+	m_pCB_Algorithms->UpdateData();
+
+	m_pCSRadixScatter->Use();
+	_Keys.SetInput( 10 );
+	_Values.SetInput( 11 );
+	m_pSB_DigitOffsets->SetInput( 12 );
+	_SortedKeys.SetOutput( 0 );
+	_SortedValues.SetOutput( 1 );
+
+	m_pCSRadixScatter->Dispatch( GroupsCount, 1, 1 );
+
+	_Keys.RemoveFromLastAssignedSlots();
+	_Values.RemoveFromLastAssignedSlots();
+	m_pSB_DigitOffsets->RemoveFromLastAssignedSlots();
+	_SortedKeys.RemoveFromLastAssignedSlotUAV();
+	_SortedValues.RemoveFromLastAssignedSlotUAV();
+}
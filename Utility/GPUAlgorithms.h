@@ -0,0 +1,115 @@
+//////////////////////////////////////////////////////////////////////////
+// GPU parallel primitives
+// The compute building blocks shared by the features that process lists on the GPU (culling, sorting, binning, etc.),
+//	they all work on structured buffers of 32-bit elements (cf. GPUAlgorithms.hlsl):
+//	_ Scan() computes the exclusive prefix sum of a list of uints in 3 passes per level: the blocks are scanned in groupshared
+//		memory, their totals are scanned recursively, then added back to the blocks
+//	_ Compact() keeps the flagged elements of a list in order, and writes the arguments of a dispatch over the kept elements
+//		so the next pass can run with ComputeShader::DispatchIndirect() without reading the count back
+//	_ Reduce() sums (or takes the min/max of) each segment of a list of floats
+//	_ Sort() sorts a list of uint keys with uint values by increasing keys, with a stable LSD radix sort on RADIX_BITS bits per pass
+//
+// The temporary buffers are allocated once for a maximum amount of elements.
+//
+// Usage:
+//	GPUAlgorithms	Algorithms( gs_Device, 65536 );
+//	(...)
+//	Algorithms.Scan( Counts, Offsets, ItemsCount );
+//	Algorithms.Compact( Indices, Visible, ItemsCount, VisibleIndices, DispatchArgs, 64 );
+//	Algorithms.Sort( SortKeys, ParticleIndices, ParticlesCount, 16 );	// Only the 16 lower bits of the keys are used
+//
+// Indirect arguments buffers for Compact() are created as StructuredBuffer( gs_Device, sizeof(U32), 4, true, StructuredBuffer::DRAW_INDIRECT_ARGS ).
+//
+// NOTE: The slots t10-t13 and u0-u1 of the compute shader are overwritten.
+// The inputs & outputs must be distinct buffers, of 4 bytes elements created with _bWriteable for the ones that are written.
+//
+#pragma once
+
+template<typename> class CB;
+
+class	GPUAlgorithms
+{
+public:		// CONSTANTS
+
+	static const int	SCAN_BLOCK_SIZE = 512;		// !!IMPORTANT ==> Must correspond to SCAN_BLOCK_SIZE in GPUAlgorithms.hlsl!!
+	static const int	RADIX_BITS = 4;				// !!IMPORTANT ==> Must correspond to RADIX_BITS in GPUAlgorithms.hlsl!!
+	static const int	RADIX_DIGITS = 1 << RADIX_BITS;
+	static const int	RADIX_BLOCK_SIZE = 1024;	// !!IMPORTANT ==> Must correspond to RADIX_BLOCK_SIZE in GPUAlgorithms.hlsl!!
+	static const int	MAX_SCAN_LEVELS = 3;		// Allows scanning up to 512^3 elements
+
+public:		// NESTED TYPES
+
+	enum	REDUCE_OPERATION
+	{
+		REDUCE_SUM = 0,
+		REDUCE_MIN = 1,
+		REDUCE_MAX = 2,
+	};
+
+protected:
+
+	// WARNING: must match the cbGPUAlgorithms constant buffer in GPUAlgorithms.hlsl!
+	struct	CBGPUAlgorithms
+	{
+		U32		Count;
+		U32		Shift;
+		U32		GroupsCount;
+		U32		ArgsGroupSize;
+
+		U32		SegmentSize;
+		U32		Operation;
+		U32		__PAD[2];
+	};
+
+protected:	// FIELDS
+
+	Device&				m_Device;
+	int					m_MaxElementsCount;
+
+	ComputeShader*		m_pCSScanBlocks;
+	ComputeShader*		m_pCSAddBlockOffsets;
+	ComputeShader*		m_pCSCompact;
+	ComputeShader*		m_pCSReduce;
+	ComputeShader*		m_pCSRadixCount;
+	ComputeShader*		m_pCSRadixScatter;
+
+	StructuredBuffer*	m_ppSB_BlockTotals[MAX_SCAN_LEVELS];		// The totals of each level's blocks...
+	StructuredBuffer*	m_ppSB_BlockOffsets[MAX_SCAN_LEVELS];		// ...and their scan
+	StructuredBuffer*	m_pSB_Offsets;			// Compaction offsets
+	StructuredBuffer*	m_pSB_SortKeys;			// Radix sort ping-pong
+	StructuredBuffer*	m_pSB_SortValues;
+	StructuredBuffer*	m_pSB_DigitCounts;		// RADIX_DIGITS per block, digit-major
+	StructuredBuffer*	m_pSB_DigitOffsets;
+	CB<CBGPUAlgorithms>*	m_pCB_Algorithms;
+
+public:		// PROPERTIES
+
+	bool				HasErrors() const;
+	int					GetMaxElementsCount() const	{ return m_MaxElementsCount; }
+
+public:		// METHODS
+
+	GPUAlgorithms( Device& _Device, int _MaxElementsCount );
+	~GPUAlgorithms();
+
+	// Exclusive prefix sum: _Output[i] = _Input[0] + ... + _Input[i-1]
+	// Returns false if the kernels are not ready yet
+	bool				Scan( StructuredBuffer& _Input, StructuredBuffer& _Output, int _Count );
+
+	// Copies the _Values whose _Flags are 1 (the flags must be 0 or 1) to the beginning of _Output, in order
+	// _IndirectArgs (created with StructuredBuffer::DRAW_INDIRECT_ARGS) receives { ThreadGroupCountX, 1, 1, KeptCount } with
+	//	ThreadGroupCountX = ceil( KeptCount / _ArgsGroupSize )
+	bool				Compact( StructuredBuffer& _Values, StructuredBuffer& _Flags, int _Count, StructuredBuffer& _Output, StructuredBuffer& _IndirectArgs, int _ArgsGroupSize );
+
+	// Reduces each segment of _SegmentSize floats of _Input into a float of _Output
+	bool				Reduce( StructuredBuffer& _Input, int _SegmentsCount, int _SegmentSize, StructuredBuffer& _Output, REDUCE_OPERATION _Operation=REDUCE_SUM );
+
+	// Sorts the keys by increasing order along with their values, only the _KeyBits lower bits of the keys are sorted
+	//	(the fewer the faster: 2 passes every 8 bits)
+	bool				Sort( StructuredBuffer& _Keys, StructuredBuffer& _Values, int _Count, int _KeyBits=32 );
+
+protected:
+
+	void				ScanLevel( StructuredBuffer& _Input, StructuredBuffer& _Output, int _Count, int _Level );
+	void				RadixPass( StructuredBuffer& _Keys, StructuredBuffer& _Values, StructuredBuffer& _SortedKeys, StructuredBuffer& _SortedValues, int _Count, int _Shift );
+};
@@ -0,0 +1,144 @@
+#include "../GodComplex.h"
+
+InitGraph::InitGraph()
+	: m_TasksCount( 0 )
+{
+}
+
+int		InitGraph::AddTask( const char* _pName, TaskDelegate _Prepare, TaskDelegate _Create, void* _pData, int _Weight )
+{
+	ASSERT( m_TasksCount < MAX_TASKS, "Too many init tasks!" );
+
+	Task&	T = m_pTasks[m_TasksCount];
+	T.pName = _pName;
+	T.Prepare = _Prepare;
+	T.Create = _Create;
+	T.pData = _pData;
+	T.Weight = MAX( 1, _Weight );
+	T.DependenciesCount = 0;
+	T.State = PENDING;
+	T.ErrorCode = 0;
+	T.PrepareDuration = 0.0;
+	T.CreateDuration = 0.0;
+
+	return m_TasksCount++;
+}
+
+void	InitGraph::AddDependency( int _Task, int _DependsOn )
+{
+	ASSERT( _Task < m_TasksCount && _DependsOn < _Task, "Tasks must depend on tasks declared before them!" );
+	Task&	T = m_pTasks[_Task];
+	ASSERT( T.DependenciesCount < MAX_DEPENDENCIES, "Too many dependencies!" );
+	T.pDependencies[T.DependenciesCount++] = _DependsOn;
+}
+
+int		InitGraph::Run( IntroProgressDelegate* _pDelegate, int _ProgressStart, int _ProgressEnd )
+{
+	ASSERT( gs_Device.Jobs().IsOwner(), "The graph must run on the thread owning the device!" );
+
+	LARGE_INTEGER	Start;
+	QueryPerformanceCounter( &Start );
+
+	int	TotalWeight = 0;
+	for ( int TaskIndex=0; TaskIndex < m_TasksCount; TaskIndex++ )
+		TotalWeight += m_pTasks[TaskIndex].Weight;
+
+	JobQueue	Queue;	// Our own counter so waiting for the tasks doesn't wait for the device's jobs
+	int			CompletedCount = 0;
+	int			CompletedWeight = 0;
+	while ( CompletedCount < m_TasksCount )
+	{
+		// Start the tasks whose dependencies are done
+		for ( int TaskIndex=0; TaskIndex < m_TasksCount; TaskIndex++ )
+		{
+			Task&	T = m_pTasks[TaskIndex];
+			if ( T.State != PENDING )
+				continue;
+
+			bool	bReady = true;
+			bool	bSkipped = false;
+			for ( int DependencyIndex=0; DependencyIndex < T.DependenciesCount; DependencyIndex++ )
+			{
+				LONG	DependencyState = m_pTasks[T.pDependencies[DependencyIndex]].State;
+				bReady &= DependencyState == DONE;
+				bSkipped |= DependencyState == FAILED;
+			}
+
+			if ( bSkipped )
+			{
+				T.State = FAILED;
+				CompletedCount++;
+				CompletedWeight += T.Weight;
+			}
+			else if ( bReady && T.Prepare != NULL )
+			{
+				T.State = PREPARING;
+				Queue.Push( T );	// Runs immediately if the queue has no workers
+			}
+			else if ( bReady )
+				T.State = PREPARED;
+		}
+
+		// Create the resources of the prepared tasks
+		bool	bCreated = false;
+		for ( int TaskIndex=0; TaskIndex < m_TasksCount; TaskIndex++ )
+		{
+			Task&	T = m_pTasks[TaskIndex];
+			if ( T.State != PREPARED )
+				continue;
+
+			if ( T.ErrorCode == 0 && T.Create != NULL )
+			{
+				LARGE_INTEGER	CreateStart;
+				QueryPerformanceCounter( &CreateStart );
+				T.ErrorCode = T.Create( T.pData );
+				T.CreateDuration = GetSeconds( CreateStart );
+			}
+
+			T.State = T.ErrorCode == 0 ? DONE : FAILED;
+			CompletedCount++;
+			CompletedWeight += T.Weight;
+			bCreated = true;
+		}
+
+		if ( _pDelegate != NULL )
+			_pDelegate->func( (WININFO*) _pDelegate->pInfos, _ProgressStart + (_ProgressEnd - _ProgressStart) * CompletedWeight / MAX( 1, TotalWeight ) );
+
+		if ( !bCreated && CompletedCount < m_TasksCount )
+			Queue.Wait( 10 );	// Nothing to do on this thread until a worker is done
+	}
+
+	// Report how long each part took compared to the whole graph
+	double	SumDuration = 0.0;
+	for ( int TaskIndex=0; TaskIndex < m_TasksCount; TaskIndex++ )
+	{
+		const Task&	T = m_pTasks[TaskIndex];
+		print( "Init task \"%s\": prepared in %.1f ms, created in %.1f ms%s\n", T.pName, 1000.0 * T.PrepareDuration, 1000.0 * T.CreateDuration, T.State == DONE ? "" : " (FAILED)" );
+		SumDuration += T.PrepareDuration + T.CreateDuration;
+	}
+	print( "Init graph ran in %.1f ms (%.1f ms when executed in sequence)\n", 1000.0 * GetSeconds( Start ), 1000.0 * SumDuration );
+
+	for ( int TaskIndex=0; TaskIndex < m_TasksCount; TaskIndex++ )
+		if ( m_pTasks[TaskIndex].ErrorCode != 0 )
+			return m_pTasks[TaskIndex].ErrorCode;
+
+	return 0;
+}
+
+void	InitGraph::Task::Run()
+{
+	LARGE_INTEGER	PrepareStart;
+	QueryPerformanceCounter( &PrepareStart );
+	ErrorCode = Prepare( pData );
+	PrepareDuration = GetSeconds( PrepareStart );
+
+	InterlockedExchange( &State, PREPARED );	// Publishes the error code to the device thread
+}
+
+double	InitGraph::GetSeconds( const LARGE_INTEGER& _Start )
+{
+	LARGE_INTEGER	Frequency, End;
+	QueryPerformanceFrequency( &Frequency );
+	QueryPerformanceCounter( &End );
+	return double(End.QuadPart - _Start.QuadPart) / Frequency.QuadPart;
+}
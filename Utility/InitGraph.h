@@ -0,0 +1,98 @@
+//////////////////////////////////////////////////////////////////////////
+// Initialization Graph
+// Declares the startup steps as tasks with dependencies so the independent ones are prepared concurrently, the startup
+//	time is then bounded by the critical path rather than by the sum of all the steps.
+//
+// A task has 2 optional parts:
+//	_ Prepare() runs on a worker thread and does the CPU work (e.g. filling a texture builder, loading a file)
+//	_ Create() runs on the thread owning the device once Prepare() is done, and creates the GPU resources
+// A task only starts once the Create() parts of all its dependencies are done.
+//
+// Usage:
+//	InitGraph	Graph;
+//	int	Noise = Graph.AddTask( "Noise3D", PrepareNoise, CreateNoise, &Data, 4 );	// Weighs 4 times a simple task in the progress
+//	int	Effect = Graph.AddTask( "Effect", NULL, CreateEffect, NULL );
+//	Graph.AddDependency( Effect, Noise );
+//	if ( (ErrorCode = Graph.Run( &_Delegate )) )
+//		return ErrorCode;
+//
+// Tasks return 0 or an error code, the tasks depending on a failed task are skipped and Run() returns the error code
+//	of the first task that failed (in declaration order).
+//
+// NOTE: Prepare() must not use the device nor the global random generator (neither is thread-safe).
+// Data-parallel kernels called by Prepare() that use JobSystem::ParallelFor() (e.g. TextureBuilder::Fill()) share the idle
+//	workers, the ones pushing to the device's queue run serially on the task's worker (cf. JobQueue::GetHelpersCount()).
+//
+#pragma once
+
+class InitGraph
+{
+public:		// CONSTANTS
+
+	static const int	MAX_TASKS = 64;
+	static const int	MAX_DEPENDENCIES = 8;
+
+public:		// NESTED TYPES
+
+	typedef int	(*TaskDelegate)( void* _pData );
+
+private:
+
+	enum STATE
+	{
+		PENDING,	// Waiting for its dependencies
+		PREPARING,	// Queued or running on a worker
+		PREPARED,	// Waiting for the device thread to create its resources
+		DONE,
+		FAILED,		// Failed or skipped
+	};
+
+	class	Task : public IJob
+	{
+	public:
+		const char*		pName;
+		TaskDelegate	Prepare;
+		TaskDelegate	Create;
+		void*			pData;
+		int				Weight;
+
+		int				pDependencies[MAX_DEPENDENCIES];
+		int				DependenciesCount;
+
+		volatile LONG	State;
+		int				ErrorCode;
+		double			PrepareDuration;	// In seconds
+		double			CreateDuration;
+
+	public:
+		virtual void	Run();
+	};
+
+private:	// FIELDS
+
+	Task		m_pTasks[MAX_TASKS];
+	int			m_TasksCount;
+
+public:		// PROPERTIES
+
+	int			GetTasksCount() const	{ return m_TasksCount; }
+
+public:		// METHODS
+
+	InitGraph();
+
+	// Either delegate can be NULL, _Weight is the task's share of the reported progress
+	// Returns the index of the task to declare its dependencies
+	int			AddTask( const char* _pName, TaskDelegate _Prepare, TaskDelegate _Create, void* _pData, int _Weight=1 );
+
+	// _Task will only start once _DependsOn is done (tasks must depend on tasks declared before them)
+	void		AddDependency( int _Task, int _DependsOn );
+
+	// Executes all the tasks and reports the progress of the completed tasks' weights in [_ProgressStart,_ProgressEnd]
+	// Returns 0 or the error code of the first task that failed
+	int			Run( IntroProgressDelegate* _pDelegate=NULL, int _ProgressStart=0, int _ProgressEnd=100 );
+
+private:
+
+	static double	GetSeconds( const LARGE_INTEGER& _Start );
+};
@@ -0,0 +1,289 @@
+#include "../GodComplex.h"
+
+JobSystem	gs_Jobs;
+
+// Index of the calling thread's deque, -1 for the threads that aren't job threads
+static __declspec(thread) int	gs_ThreadIndex = -1;
+
+
+//////////////////////////////////////////////////////////////////////////
+// WorkDeque
+// The entries between top & bottom are the queued jobs. The owner works at the bottom without any lock, the only race is
+//	for the last entry that's settled by a compare & swap on top, like the thieves do.
+//
+bool	JobSystem::WorkDeque::Push( const Entry& _Entry )
+{
+	LONG	Bottom = m_Bottom;
+	if ( Bottom - m_Top >= DEQUE_SIZE )
+		return false;
+
+	m_pEntries[Bottom & (DEQUE_SIZE-1)] = _Entry;
+	MemoryBarrier();	// The entry must be visible before the thieves see the new bottom
+	m_Bottom = Bottom + 1;
+	return true;
+}
+
+bool	JobSystem::WorkDeque::Pop( Entry& _Entry )
+{
+	LONG	Bottom = m_Bottom - 1;
+	InterlockedExchange( &m_Bottom, Bottom );	// Full barrier: the thieves must see the new bottom before we read top
+	LONG	Top = m_Top;
+	if ( Top > Bottom )
+	{	// Empty
+		m_Bottom = Top;
+		return false;
+	}
+
+	_Entry = m_pEntries[Bottom & (DEQUE_SIZE-1)];
+	if ( Top != Bottom )
+		return true;	// There are other entries, no thief can reach this one
+
+	// Last entry: race with the thieves for it
+	bool	bWon = InterlockedCompareExchange( &m_Top, Top + 1, Top ) == Top;
+	m_Bottom = Top + 1;
+	return bWon;
+}
+
+bool	JobSystem::WorkDeque::Steal( Entry& _Entry )
+{
+	LONG	Top = m_Top;
+	MemoryBarrier();
+	LONG	Bottom = m_Bottom;
+	if ( Top >= Bottom )
+		return false;	// Empty
+
+	_Entry = m_pEntries[Top & (DEQUE_SIZE-1)];
+	return InterlockedCompareExchange( &m_Top, Top + 1, Top ) == Top;	// Otherwise another thief or the owner took it
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+void	JobSystem::ParallelForJob::Run()
+{
+	for ( ;; )
+	{
+		int	Start = m_GrainSize * (InterlockedIncrement( &m_NextChunkIndex ) - 1);
+		if ( Start >= m_Count )
+			return;
+
+		m_Kernel.Run( Start, MIN( Start + m_GrainSize, m_Count ) );
+	}
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+JobSystem::JobSystem()
+	: m_WorkersCount( 0 )
+	, m_pDeques( NULL )
+	, m_hWakeUp( NULL )
+	, m_SleepingCount( 0 )
+	, m_StartedWorkersCount( 0 )
+	, m_bQuit( false )
+{
+}
+
+JobSystem::~JobSystem()
+{
+	ASSERT( !IsInitialized(), "You forgot to call Exit()!" );
+}
+
+void	JobSystem::Init( int _WorkersCount )
+{
+	ASSERT( !IsInitialized(), "Job system already initialized!" );
+
+	if ( _WorkersCount < 0 )
+	{
+		SYSTEM_INFO	Info;
+		GetSystemInfo( &Info );
+		_WorkersCount = int(Info.dwNumberOfProcessors) - 1;
+	}
+	_WorkersCount = CLAMP( _WorkersCount, 0, MAX_WORKERS );
+
+	m_pDeques = new WorkDeque[1+MAX_WORKERS];
+	m_hWakeUp = CreateSemaphore( NULL, 0, MAX_WORKERS, NULL );
+	m_bQuit = false;
+	gs_ThreadIndex = 0;
+#ifdef TRACING
+	gs_Trace.SetThreadName( "Main" );
+#endif
+
+	for ( int WorkerIndex=0; WorkerIndex < _WorkersCount; WorkerIndex++ )
+	{
+		DWORD	ThreadID;
+		m_pWorkers[WorkerIndex] = CreateThread( NULL, 0, WorkerThread, this, 0, &ThreadID );
+		if ( m_pWorkers[WorkerIndex] == NULL )
+			break;	// Live with what we got...
+		m_WorkersCount++;
+	}
+}
+
+void	JobSystem::Exit()
+{
+	if ( !IsInitialized() )
+		return;
+
+	// Wake everyone up so they notice they must quit
+	m_bQuit = true;
+	for ( int WorkerIndex=0; WorkerIndex < m_WorkersCount; WorkerIndex++ )
+		ReleaseSemaphore( m_hWakeUp, 1, NULL );	// One at a time since releasing past the maximum count would fail as a whole
+	if ( m_WorkersCount > 0 )
+		WaitForMultipleObjects( m_WorkersCount, m_pWorkers, TRUE, INFINITE );
+
+	for ( int WorkerIndex=0; WorkerIndex < m_WorkersCount; WorkerIndex++ )
+		CloseHandle( m_pWorkers[WorkerIndex] );
+	m_WorkersCount = 0;
+	m_StartedWorkersCount = 0;
+
+	CloseHandle( m_hWakeUp );
+	m_hWakeUp = NULL;
+
+	delete[] m_pDeques;
+	m_pDeques = NULL;
+	gs_ThreadIndex = -1;
+}
+
+bool	JobSystem::IsJobThread() const
+{
+	return gs_ThreadIndex >= 0 && IsInitialized();
+}
+
+void	JobSystem::Run( IJob& _Job, JobCounter& _Counter )
+{
+	InterlockedIncrement( &_Counter.m_Count );
+
+	Entry	E = { &_Job, &_Counter };
+	if ( !IsJobThread() || m_WorkersCount == 0 || !m_pDeques[gs_ThreadIndex].Push( E ) )
+	{	// Nobody to give it to...
+		Execute( E );
+		return;
+	}
+
+	MemoryBarrier();	// The new bottom must be visible before we read the sleeping count (cf. WorkerThread())
+	if ( m_SleepingCount > 0 )
+		ReleaseSemaphore( m_hWakeUp, 1, NULL );
+}
+
+void	JobSystem::Wait( JobCounter& _Counter )
+{
+	int	IdleSpins = 0;
+	while ( _Counter.m_Count != 0 )
+	{
+		if ( ExecuteOne( gs_ThreadIndex ) )
+			IdleSpins = 0;
+		else if ( ++IdleSpins < IDLE_SPINS_COUNT )
+			YieldProcessor();	// The remaining jobs are being executed by other threads
+		else
+			Sleep( 0 );
+	}
+}
+
+bool	JobSystem::Wait( JobCounter& _Counter, DWORD _TimeOut )
+{
+	DWORD	Start = GetTickCount();
+	while ( _Counter.m_Count != 0 )
+	{
+		if ( !ExecuteOne( gs_ThreadIndex ) )
+			Sleep( 0 );
+		if ( GetTickCount() - Start >= _TimeOut )
+			break;
+	}
+
+	return _Counter.m_Count == 0;
+}
+
+void	JobSystem::ParallelFor( int _Count, int _GrainSize, IParallelForKernel& _Kernel )
+{
+	if ( _Count <= 0 )
+		return;
+
+	TRACE_SCOPE( "ParallelFor" );
+	_GrainSize = MAX( 1, _GrainSize );
+	int	ChunksCount = (_Count + _GrainSize-1) / _GrainSize;
+	int	HelpersCount = MIN( GetHelpersCount(), ChunksCount-1 );
+	if ( HelpersCount <= 0 )
+	{	// Not worth it or nobody to help
+		_Kernel.Run( 0, _Count );
+		return;
+	}
+
+	// Every helper grabs chunks until none is left, the helpers that start late simply find nothing to do
+	ParallelForJob	Job( _Kernel, _Count, _GrainSize );
+	JobCounter		Counter;
+	for ( int HelperIndex=0; HelperIndex < HelpersCount; HelperIndex++ )
+		Run( Job, Counter );
+	Job.Run();
+	Wait( Counter );
+}
+
+bool	JobSystem::ExecuteOne( int _ThreadIndex )
+{
+	if ( !IsInitialized() )
+		return false;
+
+	Entry	E;
+	if ( _ThreadIndex >= 0 && m_pDeques[_ThreadIndex].Pop( E ) )
+	{
+		Execute( E );
+		return true;
+	}
+
+	// Steal from the others, starting with our neighbor so the thieves don't all fight for the same deque
+	int	DequesCount = 1 + m_WorkersCount;
+	for ( int Offset=1; Offset <= DequesCount; Offset++ )
+	{
+		int	VictimIndex = (MAX( 0, _ThreadIndex ) + Offset) % DequesCount;
+		if ( VictimIndex != _ThreadIndex && m_pDeques[VictimIndex].Steal( E ) )
+		{
+			Execute( E );
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void	JobSystem::Execute( const Entry& _Entry )
+{
+	JobCounter*	pCounter = _Entry.pCounter;
+	{
+		TRACE_SCOPE( "Job" );
+		_Entry.pJob->Run();
+	}
+	InterlockedDecrement( &pCounter->m_Count );	// The waiter may destroy the job & the counter right after that
+}
+
+DWORD WINAPI	JobSystem::WorkerThread( LPVOID _pParam )
+{
+	JobSystem&	Owner = *((JobSystem*) _pParam);
+	int			ThreadIndex = InterlockedIncrement( &Owner.m_StartedWorkersCount );
+	gs_ThreadIndex = ThreadIndex;
+#ifdef TRACING
+	char	pName[Tracer::MAX_THREAD_NAME_LENGTH];
+	sprintf_s( pName, Tracer::MAX_THREAD_NAME_LENGTH, "Worker %d", ThreadIndex );
+	gs_Trace.SetThreadName( pName );
+#endif
+
+	int	IdleSpins = 0;
+	while ( !Owner.m_bQuit )
+	{
+		if ( Owner.ExecuteOne( ThreadIndex ) )
+		{
+			IdleSpins = 0;
+			continue;
+		}
+		if ( ++IdleSpins < IDLE_SPINS_COUNT )
+		{
+			YieldProcessor();
+			continue;
+		}
+
+		// Go to sleep, but look again once we're counted as sleeping so a job pushed meanwhile can't be missed
+		InterlockedIncrement( &Owner.m_SleepingCount );
+		if ( !Owner.ExecuteOne( ThreadIndex ) )
+			WaitForSingleObject( Owner.m_hWakeUp, INFINITE );
+		InterlockedDecrement( &Owner.m_SleepingCount );
+		IdleSpins = 0;
+	}
+
+	return 0;
+}
@@ -0,0 +1,155 @@
+//////////////////////////////////////////////////////////////////////////
+// Job System
+// The engine's single pool of worker threads, shared by every subsystem that wants to go parallel (cf. gs_Jobs)
+//	_ Each thread (the main thread and one worker per core) owns a lock-free Chase-Lev deque: it pushes and pops jobs at the
+//		bottom of its own deque while idle threads steal the oldest jobs from the top of the others' deques
+//	_ Jobs are counted by a JobCounter that's decremented once they're done, waiting on a counter makes the calling thread
+//		execute jobs until the counter reaches 0 so it never sits idle while there's work left
+//	_ Jobs can be pushed from any job (i.e. from the workers too), so nested parallelism simply spreads over the idle workers
+//	_ ParallelFor() splits a range into chunks of _GrainSize items that are grabbed by the calling thread and the workers
+//
+// Usage:
+//	class MyJob : public IJob { public: virtual void Run() { (...) } };
+//	MyJob		A, B;
+//	JobCounter	Counter;
+//	gs_Jobs.Run( A, Counter );
+//	gs_Jobs.Run( B, Counter );
+//	(...)						// Do something else meanwhile
+//	gs_Jobs.Wait( Counter );	// Helps executing the jobs until A & B are done
+//
+//	class MyKernel : public IParallelForKernel { public: virtual void Run( int _Start, int _End ) { (...) } };
+//	gs_Jobs.ParallelFor( ItemsCount, 64, Kernel );
+//
+// NOTE: Threads that aren't job threads (e.g. a streaming thread) have no deque, the jobs they push are executed right away.
+// A job must not block on anything else than a JobCounter or the workers may all end up waiting on each other.
+//
+#pragma once
+
+class IJob
+{
+public:
+	virtual void	Run() = 0;
+};
+
+class IParallelForKernel
+{
+public:
+	virtual void	Run( int _Start, int _End ) = 0;	// Processes the items [_Start,_End[
+};
+
+class JobCounter
+{
+	friend class JobSystem;
+
+private:	// FIELDS
+
+	volatile LONG	m_Count;	// Jobs that were pushed but are not finished yet
+
+public:		// PROPERTIES
+
+	bool		IsDone() const	{ return m_Count == 0; }
+
+public:		// METHODS
+
+	JobCounter() : m_Count( 0 )	{}
+	~JobCounter()				{ ASSERT( m_Count == 0, "Destroying a counter with pending jobs!" ); }
+};
+
+class JobSystem
+{
+public:		// CONSTANTS
+
+	static const int	MAX_WORKERS = 8;
+	static const int	DEQUE_SIZE = 1024;			// Jobs pushed to a full deque are executed right away (must be a power of 2)
+	static const int	IDLE_SPINS_COUNT = 256;		// Failed steal attempts before a worker goes to sleep
+
+private:	// NESTED TYPES
+
+	struct	Entry
+	{
+		IJob*		pJob;
+		JobCounter*	pCounter;
+	};
+
+	// Chase-Lev work-stealing deque: only the owner thread pushes & pops at the bottom, any thread can steal from the top
+	class	WorkDeque
+	{
+		volatile LONG	m_Top;
+		volatile LONG	m_Bottom;
+		Entry			m_pEntries[DEQUE_SIZE];
+
+	public:
+		WorkDeque() : m_Top( 0 ), m_Bottom( 0 )	{}
+
+		bool		Push( const Entry& _Entry );	// Returns false if the deque is full
+		bool		Pop( Entry& _Entry );
+		bool		Steal( Entry& _Entry );
+	};
+
+	class	ParallelForJob : public IJob
+	{
+		IParallelForKernel&	m_Kernel;
+		int					m_Count;
+		int					m_GrainSize;
+		volatile LONG		m_NextChunkIndex;
+
+	public:
+		ParallelForJob( IParallelForKernel& _Kernel, int _Count, int _GrainSize ) : m_Kernel( _Kernel ), m_Count( _Count ), m_GrainSize( _GrainSize ), m_NextChunkIndex( 0 )	{}
+
+		virtual void	Run();
+	};
+
+private:	// FIELDS
+
+	HANDLE				m_pWorkers[MAX_WORKERS];
+	int					m_WorkersCount;
+
+	WorkDeque*			m_pDeques;			// [0] is the main thread's, [1+WorkerIndex] are the workers'
+	HANDLE				m_hWakeUp;			// Semaphore released for the sleeping workers when jobs are pushed
+	volatile LONG		m_SleepingCount;
+	volatile LONG		m_StartedWorkersCount;	// Gives each worker its thread index
+	volatile bool		m_bQuit;
+
+public:		// PROPERTIES
+
+	bool		IsInitialized() const	{ return m_pDeques != NULL; }
+	int			GetWorkersCount() const	{ return m_WorkersCount; }
+
+	// Returns true if the calling thread is the main thread or a worker (i.e. the jobs it pushes can be stolen)
+	bool		IsJobThread() const;
+
+	// Returns the amount of workers the calling thread can share work with (0 from a thread that isn't a job thread)
+	int			GetHelpersCount() const	{ return IsJobThread() ? m_WorkersCount : 0; }
+
+public:		// METHODS
+
+	JobSystem();
+	~JobSystem();
+
+	// Must be called by the main thread, before anything uses the jobs
+	void		Init( int _WorkersCount=-1 );	// -1 uses one worker per core, minus the main thread's
+	void		Exit();
+
+	// Pushes a job, the counter is incremented now and decremented once the job is done
+	void		Run( IJob& _Job, JobCounter& _Counter );
+
+	// Executes jobs until the counter reaches 0
+	void		Wait( JobCounter& _Counter );
+
+	// Executes jobs until the counter reaches 0 or _TimeOut milliseconds elapsed (at least one job is executed if there's one)
+	// Returns true if the counter reached 0 (useful to report progress while waiting)
+	bool		Wait( JobCounter& _Counter, DWORD _TimeOut );
+
+	// Calls the kernel on chunks of _GrainSize items (the last chunk may be smaller) from the calling thread and the workers
+	// Returns once all the items were processed. Use a grain large enough to amortize the cost of grabbing a chunk.
+	void		ParallelFor( int _Count, int _GrainSize, IParallelForKernel& _Kernel );
+
+private:
+
+	bool		ExecuteOne( int _ThreadIndex );	// Pops or steals a job and executes it, returns false if there was none
+	void		Execute( const Entry& _Entry );
+
+	static DWORD WINAPI	WorkerThread( LPVOID _pParam );
+};
+
+extern JobSystem	gs_Jobs;
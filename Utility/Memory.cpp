@@ -1,29 +1,398 @@
 #include "../GodComplex.h"
+#include <stdio.h>
 
-static U8*		gs_pMemoryBuffer = NULL;
-static U8*		gs_pMemoryBufferAligned = NULL;
-static size_t	gs_MemoryOffset = 0;
+MemoryArena	gs_MemoryArena;
+MemoryArena	gs_FrameArena;
+#ifdef MICRO_BENCHMARKS
+volatile LONG	gs_AllocationsCount = 0;
+#endif
 
 void	AllocateMemoryPool()
 {
-	gs_pMemoryBuffer = (U8*) GlobalAlloc( GMEM_ZEROINIT, MEMORY_POOL_SIZE );
-	ASSERT( gs_pMemoryBuffer != NULL, "Failed to allocate giant memory octop... never mind... POOL !" );
-
-	gs_pMemoryBufferAligned = (U8*) (U32(gs_pMemoryBuffer+31) & (~31));
+	gs_MemoryArena.Init( MEMORY_POOL_SIZE );
+	gs_FrameArena.Init( FRAME_MEMORY_SIZE );
 }
 
 void	FreeMemoryPool()
 {
-	ASSERT( gs_MemoryOffset > 0, "You initialized the memory pool but didn't even use it in the end ! Nice wast of 64Mb dude !" );	// If this assert fires up then it means you didn't even use the memory pool ! Don't bother allocating 64Mb for nothing then ! ^^
-	GlobalFree( gs_pMemoryBuffer );
+	gs_FrameArena.Exit();
+	gs_MemoryArena.Exit();
 }
 
 void*	Alloc( size_t _Size )
 {
-	ASSERT( gs_pMemoryBuffer != NULL, "Alloc() called whereas memory pool is not initialized !	Did you forget to call AllocateMemoryPool() ?" );
+	ASSERT( gs_MemoryArena.IsInitialized(), "Alloc() called whereas memory pool is not initialized !	Did you forget to call AllocateMemoryPool() ?" );
+	COUNT_ALLOCATION();
+#ifdef TRACK_ALLOCATIONS
+	TrackArenaAllocation( _Size );
+#endif
+	return gs_MemoryArena.Alloc( _Size );
+}
+
+void*	FrameAlloc( size_t _Size )
+{
+	ASSERT( gs_FrameArena.IsInitialized(), "FrameAlloc() called whereas memory pool is not initialized !	Did you forget to call AllocateMemoryPool() ?" );
+	COUNT_ALLOCATION();
+#ifdef TRACK_ALLOCATIONS
+	TrackArenaAllocation( _Size );
+#endif
+	return gs_FrameArena.Alloc( _Size );
+}
+
+void	FrameMemoryReset()
+{
+	if ( gs_FrameArena.IsInitialized() )
+		gs_FrameArena.Reset();
+#ifdef TRACK_ALLOCATIONS
+	TrackerNewFrame();
+#endif
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// Linear arena
+//
+void	MemoryArena::Init( U32 _Size )
+{
+	ASSERT( m_pBuffer == NULL, "Arena already initialized!" );
+
+	m_pBuffer = (U8*) GlobalAlloc( GMEM_ZEROINIT, _Size + 31 );
+	ASSERT( m_pBuffer != NULL, "Failed to allocate giant memory octop... never mind... POOL !" );
+
+	m_pBufferAligned = (U8*) ((size_t(m_pBuffer) + 31) & ~size_t(31));
+	m_Size = _Size;
+	m_Offset = 0;
+	m_PeakOffset = 0;
+}
+
+void	MemoryArena::Exit()
+{
+	if ( m_pBuffer == NULL )
+		return;
+
+	GlobalFree( m_pBuffer );
+	m_pBuffer = m_pBufferAligned = NULL;
+	m_Size = 0;
+	m_Offset = 0;
+}
+
+void*	MemoryArena::Alloc( size_t _Size, U32 _Alignment )
+{
+	ASSERT( _Alignment <= 32 && (_Alignment & (_Alignment-1)) == 0, "Alignment must be a power of 2 no larger than 32!" );
+
+	LONG	OldOffset, NewOffset;
+	U32		AlignedOffset;
+	do
+	{
+		OldOffset = m_Offset;
+		AlignedOffset = (U32(OldOffset) + _Alignment-1) & ~(_Alignment-1);
+		if ( AlignedOffset + _Size > m_Size )
+		{
+			ASSERT( false, "Memory arena is full!" );
+			return NULL;
+		}
+		NewOffset = LONG(AlignedOffset + _Size);
+	} while ( InterlockedCompareExchange( &m_Offset, NewOffset, OldOffset ) != OldOffset );
+
+	return m_pBufferAligned + AlignedOffset;
+}
+
+void	MemoryArena::Rewind( Marker _Marker )
+{
+	U32	Offset = U32(m_Offset);
+	ASSERT( _Marker <= Offset, "Invalid marker!" );
 
-	void*	pResult = gs_pMemoryBufferAligned;
-	gs_pMemoryBufferAligned += gs_MemoryOffset;
+	m_PeakOffset = MAX( m_PeakOffset, Offset );
+	memset( m_pBufferAligned + _Marker, 0, Offset - _Marker );
+	m_Offset = LONG(_Marker);
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// Small objects pools
+//
+namespace
+{
+	static const int	POOL_PAGE_POT = 16;							// 64Kb pages
+	static const int	POOL_PAGE_SIZE = 1 << POOL_PAGE_POT;
+	static const int	POOL_PAGES_COUNT = SMALL_POOLS_SIZE / POOL_PAGE_SIZE;
+	static const int	POOL_MIN_SIZE_POT = 4;							// 16 bytes
+	static const int	POOL_CLASSES_COUNT = 5;							// 16, 32, 64, 128 and 256 bytes
+
+	struct	FreeBlock
+	{
+		FreeBlock*	pNext;
+	};
+
+	static volatile LONG	gs_PoolsLock = 0;
+	static int				gs_CommittedPagesCount = 0;
+	static U8				gs_pPageClasses[POOL_PAGES_COUNT];
+	static FreeBlock*		gs_ppFreeBlocks[POOL_CLASSES_COUNT];
+	static U8*				gs_ppClassCurrent[POOL_CLASSES_COUNT];	// Next unused block in the class's current page
+	static U8*				gs_ppClassEnd[POOL_CLASSES_COUNT];		// End of the class's current page
+
+	// The pools can be used by static constructors, before anything else got initialized, so we can only rely on a spin lock
+	void	LockPools()
+	{
+		while ( InterlockedExchange( &gs_PoolsLock, 1 ) != 0 )
+			YieldProcessor();
+	}
+	void	UnlockPools()
+	{
+		InterlockedExchange( &gs_PoolsLock, 0 );
+	}
+
+	int		GetSizeClass( size_t _Size )
+	{
+		int	Class = 0;
+		while ( (size_t(1) << (POOL_MIN_SIZE_POT + Class)) < _Size )
+			Class++;
+		return Class;
+	}
+}
+
+U8*	gs_pSmallPools = NULL;
+
+void*	PoolAlloc( size_t _Size )
+{
+	if ( _Size > MAX_POOLED_SIZE )
+		return NULL;
+
+	int		Class = GetSizeClass( _Size );
+	size_t	BlockSize = size_t(1) << (POOL_MIN_SIZE_POT + Class);
+
+	LockPools();
+
+	if ( gs_pSmallPools == NULL )
+	{	// Reserve the address space the first time
+		gs_pSmallPools = (U8*) VirtualAlloc( NULL, SMALL_POOLS_SIZE, MEM_RESERVE, PAGE_READWRITE );
+		if ( gs_pSmallPools == NULL )
+		{
+			UnlockPools();
+			return NULL;
+		}
+	}
+
+	// Recycle a freed block
+	FreeBlock*	pFree = gs_ppFreeBlocks[Class];
+	if ( pFree != NULL )
+	{
+		gs_ppFreeBlocks[Class] = pFree->pNext;
+		UnlockPools();
+
+		memset( pFree, 0, BlockSize );
+		return pFree;
+	}
+
+	// Otherwise, carve a block from the class's current page
+	if ( gs_ppClassCurrent[Class] == gs_ppClassEnd[Class] )
+	{	// Commit a new page (which is zeroed by the system)
+		if ( gs_CommittedPagesCount == POOL_PAGES_COUNT )
+		{
+			UnlockPools();
+			return NULL;
+		}
+
+		U8*	pPage = (U8*) VirtualAlloc( gs_pSmallPools + (size_t(gs_CommittedPagesCount) << POOL_PAGE_POT), POOL_PAGE_SIZE, MEM_COMMIT, PAGE_READWRITE );
+		if ( pPage == NULL )
+		{
+			UnlockPools();
+			return NULL;
+		}
+
+		gs_pPageClasses[gs_CommittedPagesCount++] = U8(Class);
+		gs_ppClassCurrent[Class] = pPage;
+		gs_ppClassEnd[Class] = pPage + POOL_PAGE_SIZE;
+	}
+
+	void*	pResult = gs_ppClassCurrent[Class];
+	gs_ppClassCurrent[Class] += BlockSize;
+
+	UnlockPools();
 
 	return pResult;
 }
+
+void	PoolFree( void* _pBlock )
+{
+	ASSERT( IsPooled( _pBlock ), "Block doesn't belong to the pools!" );
+
+	int			Class = gs_pPageClasses[((U8*) _pBlock - gs_pSmallPools) >> POOL_PAGE_POT];
+	FreeBlock*	pBlock = (FreeBlock*) _pBlock;
+
+	LockPools();
+	pBlock->pNext = gs_ppFreeBlocks[Class];
+	gs_ppFreeBlocks[Class] = pBlock;
+	UnlockPools();
+}
+
+
+#ifdef TRACK_ALLOCATIONS
+//////////////////////////////////////////////////////////////////////////
+// Allocation tracking
+//
+namespace
+{
+	static const U32	ALLOCATION_MAGIC = 0xA110CA7EU;
+
+	struct	AllocationHeader	// 16 bytes so the blocks keep the alignment of the heap
+	{
+		U32		Size;
+		U32		TagIndex;
+		U32		Magic;			// Catches the blocks that weren't allocated by our operator new
+		U32		__PAD;
+	};
+
+	static const char				gs_pUntagged[] = "Untagged";
+
+	static volatile LONG			gs_TrackerLock = 0;
+	static __declspec(thread) const char*	gs_pCurrentTag = NULL;
+	static AllocationTagStats		gs_pTags[MAX_ALLOCATION_TAGS];
+	static int						gs_TagsCount = 0;
+	static size_t					gs_LiveBytes = 0;
+	static size_t					gs_PeakBytes = 0;
+	static AllocationStats			gs_CurrentFrame;
+	static AllocationStats			gs_LastFrame;
+
+	// Same as the pools, operator new is used by static constructors before anything else got initialized
+	void	LockTracker()
+	{
+		while ( InterlockedExchange( &gs_TrackerLock, 1 ) != 0 )
+			YieldProcessor();
+	}
+	void	UnlockTracker()
+	{
+		InterlockedExchange( &gs_TrackerLock, 0 );
+	}
+
+	// Must be called with the lock held
+	U32		FindTag( const char* _pTag )
+	{
+		if ( gs_TagsCount == 0 )
+			gs_pTags[gs_TagsCount++].pName = gs_pUntagged;
+		if ( _pTag == NULL )
+			return 0;
+
+		for ( int TagIndex=0; TagIndex < gs_TagsCount; TagIndex++ )
+			if ( gs_pTags[TagIndex].pName == _pTag )
+				return TagIndex;
+
+		if ( gs_TagsCount == MAX_ALLOCATION_TAGS )
+			return 0;
+
+		gs_pTags[gs_TagsCount].pName = _pTag;
+		return gs_TagsCount++;
+	}
+}
+
+ScopedAllocationTag::ScopedAllocationTag( const char* _pTag ) : m_pPreviousTag( gs_pCurrentTag )
+{
+	gs_pCurrentTag = _pTag;
+}
+
+ScopedAllocationTag::~ScopedAllocationTag()
+{
+	gs_pCurrentTag = m_pPreviousTag;
+}
+
+void*	TrackedAlloc( size_t _Size )
+{
+	AllocationHeader*	pHeader = (AllocationHeader*) HeapBlockAlloc( sizeof(AllocationHeader) + _Size );
+	if ( pHeader == NULL )
+		return NULL;
+
+	LockTracker();
+
+	U32	TagIndex = FindTag( gs_pCurrentTag );
+	AllocationTagStats&	Tag = gs_pTags[TagIndex];
+	Tag.AllocationsCount++;
+	Tag.LiveCount++;
+	Tag.LiveBytes += _Size;
+	Tag.PeakLiveBytes = MAX( Tag.PeakLiveBytes, Tag.LiveBytes );
+
+	gs_LiveBytes += _Size;
+	gs_PeakBytes = MAX( gs_PeakBytes, gs_LiveBytes );
+	gs_CurrentFrame.AllocationsCount++;
+	gs_CurrentFrame.AllocatedBytes += U32(_Size);
+
+	UnlockTracker();
+
+	pHeader->Size = U32(_Size);
+	pHeader->TagIndex = TagIndex;
+	pHeader->Magic = ALLOCATION_MAGIC;
+	return pHeader + 1;
+}
+
+void	TrackedFree( void* _pBlock )
+{
+	if ( _pBlock == NULL )
+		return;
+
+	AllocationHeader*	pHeader = ((AllocationHeader*) _pBlock) - 1;
+	ASSERT( pHeader->Magic == ALLOCATION_MAGIC, "Block wasn't allocated by operator new or was already freed!" );
+	pHeader->Magic = 0;
+
+	LockTracker();
+
+	AllocationTagStats&	Tag = gs_pTags[pHeader->TagIndex];
+	Tag.LiveCount--;
+	Tag.LiveBytes -= pHeader->Size;
+	gs_LiveBytes -= pHeader->Size;
+
+	UnlockTracker();
+
+	HeapBlockFree( pHeader );
+}
+
+void	TrackArenaAllocation( size_t _Size )
+{
+	LockTracker();
+	gs_CurrentFrame.AllocationsCount++;
+	gs_CurrentFrame.AllocatedBytes += U32(_Size);
+	UnlockTracker();
+}
+
+void	TrackerNewFrame()
+{
+	LockTracker();
+	gs_LastFrame = gs_CurrentFrame;
+	gs_CurrentFrame.AllocationsCount = 0;
+	gs_CurrentFrame.AllocatedBytes = 0;
+	UnlockTracker();
+}
+
+const AllocationStats&	GetLastFrameAllocationStats()	{ return gs_LastFrame; }
+size_t	GetLiveAllocatedBytes()							{ return gs_LiveBytes; }
+size_t	GetPeakAllocatedBytes()							{ return gs_PeakBytes; }
+
+bool	WriteAllocationReport( const char* _pFileName )
+{
+	// Copy the statistics first, the file functions may allocate
+	LockTracker();
+	AllocationTagStats	pTags[MAX_ALLOCATION_TAGS];
+	int		TagsCount = gs_TagsCount;
+	memcpy( pTags, gs_pTags, TagsCount*sizeof(AllocationTagStats) );
+	size_t	LiveBytes = gs_LiveBytes;
+	size_t	PeakBytes = gs_PeakBytes;
+	UnlockTracker();
+
+	FILE*	pFile = NULL;
+	fopen_s( &pFile, _pFileName, "w" );
+	ASSERT( pFile != NULL, "Failed to create the allocation report!" );
+	if ( pFile == NULL )
+		return false;
+
+	fprintf( pFile, "Tag,Live Blocks,Live Bytes,Peak Live Bytes,Allocations\n" );
+	for ( int TagIndex=0; TagIndex < TagsCount; TagIndex++ )
+	{
+		const AllocationTagStats&	Tag = pTags[TagIndex];
+		if ( Tag.LiveCount > 0 )
+			fprintf( pFile, "%s,%d,%Iu,%Iu,%d\n", Tag.pName, Tag.LiveCount, Tag.LiveBytes, Tag.PeakLiveBytes, Tag.AllocationsCount );
+	}
+	fprintf( pFile, "Total,,%Iu,%Iu,\n", LiveBytes, PeakBytes );
+
+	fclose( pFile );
+	return true;
+}
+
+#endif
@@ -1,13 +1,182 @@
 //////////////////////////////////////////////////////////////////////////
 // Memory operators
 //
+// On top of the process heap, we provide:
+//	_ A linear arena (Alloc()) for allocations that live until the arena is rewound to a marker (cf. ScopedMemoryMarker)
+//	_ A scratch arena (FrameAlloc()) that is reset by the main loop at the beginning of each frame
+//	_ Size-class pools for small objects, that the global operator new uses when ROUTE_NEW_TO_POOLS is defined
+//	_ An opt-in tracker of the heap allocations per call site tag when TRACK_ALLOCATIONS is defined (cf. ALLOCATION_TAG())
+//
+// All of them return zeroed memory, like GlobalAlloc( GMEM_ZEROINIT ) always did (and a lot of code relies on that!)
+//
 #pragma once
 
 #define MEMORY_POOL_SIZE	(64*1024*1024)	// 64Mb !
+#define FRAME_MEMORY_SIZE	(4*1024*1024)	// 4Mb of scratch memory per frame
+#define SMALL_POOLS_SIZE	(64*1024*1024)	// Address space reserved for small objects (only committed as needed)
+
+#define ROUTE_NEW_TO_POOLS	// Define this to have the global operator new allocate small objects from the pools
+//#define TRACK_ALLOCATIONS	// Define this to count the allocations per tag and per frame, shown in the window's title with the leaks written at exit
+
+#ifdef MICRO_BENCHMARKS
+extern volatile LONG	gs_AllocationsCount;	// Amount of operator new, Alloc() and FrameAlloc() calls so far
+#define COUNT_ALLOCATION()	InterlockedIncrement( &gs_AllocationsCount )
+#else
+#define COUNT_ALLOCATION()
+#endif
+
+class	MemoryArena
+{
+public:		// NESTED TYPES
+
+	typedef U32	Marker;
+
+private:	// FIELDS
+
+	U8*				m_pBuffer;
+	U8*				m_pBufferAligned;
+	U32				m_Size;
+	volatile LONG	m_Offset;
+	U32				m_PeakOffset;
+
+public:		// PROPERTIES
+
+	bool		IsInitialized() const	{ return m_pBuffer != NULL; }
+	U32			GetUsedSize() const		{ return U32(m_Offset); }
+	U32			GetPeakSize() const		{ return m_PeakOffset; }
+
+public:		// METHODS
+
+	MemoryArena() : m_pBuffer( NULL ), m_pBufferAligned( NULL ), m_Size( 0 ), m_Offset( 0 ), m_PeakOffset( 0 )	{}
+
+	void		Init( U32 _Size );
+	void		Exit();
+
+	// Thread-safe (lock-free)
+	void*		Alloc( size_t _Size, U32 _Alignment=16 );
+
+	// Rewinding must only happen when no other thread allocates from the arena
+	Marker		GetMarker() const		{ return Marker(m_Offset); }
+	void		Rewind( Marker _Marker );	// Released memory is cleared so the arena keeps returning zeroed memory
+	void		Reset()					{ Rewind( 0 ); }
+};
+
+// Rewinds the arena to its current state when going out of scope
+class	ScopedMemoryMarker
+{
+	MemoryArena&			m_Arena;
+	MemoryArena::Marker		m_Marker;
+public:
+	ScopedMemoryMarker( MemoryArena& _Arena ) : m_Arena( _Arena ), m_Marker( _Arena.GetMarker() )	{}
+	~ScopedMemoryMarker()																			{ m_Arena.Rewind( m_Marker ); }
+};
+
+extern MemoryArena	gs_MemoryArena;	// The main arena used by Alloc()
+extern MemoryArena	gs_FrameArena;	// The scratch arena used by FrameAlloc()
 
 void	AllocateMemoryPool();	// Allocates a big chunck of memory that will be used as a memory pool
 void	FreeMemoryPool();		// Frees a big chunk of memory
-void*	Alloc( size_t _Size );	// Allocates a small buffer (AllocateMemoryPool must have been called first !)
+void*	Alloc( size_t _Size );	// Allocates a buffer from the main arena (AllocateMemoryPool must have been called first !)
+void*	FrameAlloc( size_t _Size );	// Allocates a buffer that is only valid until the end of the frame
+void	FrameMemoryReset();		// Called by the main loop at the beginning of each frame
+
+
+//////////////////////////////////////////////////////////////////////////
+// Small objects pools
+// The reserved address space is split into 64Kb pages, each page serving a single size class
+#define MAX_POOLED_SIZE		256
+
+extern U8*	gs_pSmallPools;
+
+void*	PoolAlloc( size_t _Size );	// Returns NULL if the size is too large or the pools are full
+void	PoolFree( void* _pBlock );
+inline bool	IsPooled( void* _pBlock )	{ return gs_pSmallPools != NULL && size_t((U8*) _pBlock - gs_pSmallPools) < SMALL_POOLS_SIZE; }
+
+#ifdef ROUTE_NEW_TO_POOLS
+
+inline void*	HeapBlockAlloc( size_t _Size )
+{
+	void*	pResult = _Size <= MAX_POOLED_SIZE ? PoolAlloc( _Size ) : NULL;
+	return pResult != NULL ? pResult : GlobalAlloc( GMEM_ZEROINIT, _Size );
+}
+inline void		HeapBlockFree( void* p )
+{
+	if ( IsPooled( p ) )
+		PoolFree( p );
+	else
+		GlobalFree( p );
+}
+
+#else
+
+inline void*	HeapBlockAlloc( size_t _Size )	{ return GlobalAlloc( GMEM_ZEROINIT, _Size ); }
+inline void		HeapBlockFree( void* p )		{ GlobalFree( p ); }
+
+#endif
+
+
+//////////////////////////////////////////////////////////////////////////
+// Allocation tracking
+// Every operator new block gets prefixed by a small header holding its size and tag, so operator delete can update the
+//	statistics of the tag. The tag of an allocation is the innermost ALLOCATION_TAG() of the calling thread ("Untagged" otherwise)
+//	and tags are compared by address, so they must be string literals.
+// Alloc() and FrameAlloc() only count in the frame statistics since arena memory is never freed block by block.
+//
+// Usage:
+//	{
+//		ALLOCATION_TAG( "List<T>" );
+//		pNewList = new U8[Size];	// Accounted to "List<T>"
+//	}
+//	GetLastFrameAllocationStats().AllocationsCount;		// What we want to drive to 0
+//	WriteAllocationReport( "./AllocationLeaks.csv" );	// Blocks still alive per tag (i.e. the leaks when called at exit)
+//
+#ifdef TRACK_ALLOCATIONS
+
+#define MAX_ALLOCATION_TAGS	256		// Further tags are accounted as "Untagged"
+
+struct	AllocationStats
+{
+	U32		AllocationsCount;	// operator new, Alloc() and FrameAlloc() calls
+	U32		AllocatedBytes;
+};
+
+struct	AllocationTagStats
+{
+	const char*	pName;
+	U32			AllocationsCount;	// Since the start
+	U32			LiveCount;
+	size_t		LiveBytes;
+	size_t		PeakLiveBytes;
+};
+
+// Tags the allocations of the calling thread until going out of scope
+class	ScopedAllocationTag
+{
+	const char*	m_pPreviousTag;
+public:
+	ScopedAllocationTag( const char* _pTag );
+	~ScopedAllocationTag();
+};
+
+#undef ALLOCATION_TAG	// No-op version of NuajAPI/API/Types.h
+#define ALLOCATION_TAG( _pTag )	ScopedAllocationTag	__AllocationTag( _pTag )
+
+void*	TrackedAlloc( size_t _Size );
+void	TrackedFree( void* _pBlock );
+void	TrackArenaAllocation( size_t _Size );		// Called by Alloc() and FrameAlloc()
+void	TrackerNewFrame();						// Called by FrameMemoryReset()
+
+const AllocationStats&	GetLastFrameAllocationStats();
+size_t	GetLiveAllocatedBytes();
+size_t	GetPeakAllocatedBytes();				// High-water mark of the live heap allocations
+bool	WriteAllocationReport( const char* _pFileName );	// CSV of the tags with blocks still alive
+
+inline void* __cdecl	operator new( size_t _Size )	{ COUNT_ALLOCATION(); return TrackedAlloc( _Size ); }
+inline void  __cdecl	operator delete( void* p )		{ TrackedFree( p ); }
+
+#else
+
+inline void* __cdecl	operator new( size_t _Size )	{ COUNT_ALLOCATION(); return HeapBlockAlloc( _Size ); }
+inline void  __cdecl	operator delete( void* p )		{ HeapBlockFree( p ); }
 
-inline void* __cdecl	operator new( size_t _Size )	{ return GlobalAlloc( GMEM_ZEROINIT, _Size ); }
-inline void  __cdecl	operator delete( void* p )		{ GlobalFree( p ); }
+#endif
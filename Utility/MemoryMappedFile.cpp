@@ -1,34 +1,89 @@
 #include "../GodComplex.h"
 
 MemoryMappedFile::MemoryMappedFile( int _Size, const char* _pFileName )
+	: m_hChangedWait( NULL )
 {
 	m_hFile = CreateFileMapping( INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, _Size, _pFileName );
 	ASSERT( m_hFile != INVALID_HANDLE_VALUE, "Failed to create File Mapping!" );
 
 	m_pMappedFile = MapViewOfFile( m_hFile, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, 0 );
 
+	// Create the change notification event & wait for it on the thread pool
+	char	pEventName[256];
+	sprintf_s( pEventName, 256, "%s_Changed", _pFileName );
+	m_hChangedEvent = CreateEventA( NULL, FALSE, FALSE, pEventName );
+	ASSERT( m_hChangedEvent != NULL, "Failed to create the File Mapping's change event!" );
+	if ( m_hChangedEvent != NULL )
+		RegisterWaitForSingleObject( &m_hChangedWait, m_hChangedEvent, OnChanged, this, INFINITE, WT_EXECUTEDEFAULT );
+
 //#define NO_INITIAL_REFRESH
 #ifdef NO_INITIAL_REFRESH
 // Doing this with another application having the file open will result in no change on our side when calling CheckForChange()
 // But we generally want a change the first time we read the file, since it's usually there we initialize new values for our variables...
-	m_Checksum = *((U32*) m_pMappedFile);	// First DWORD is the checksum
+	m_bChanged = 0;
 #else
-	m_Checksum = ~*((U32*) m_pMappedFile);	// So there will always be a change...
+	m_bChanged = 1;	// So there will always be a change...
 #endif
 }
 
 MemoryMappedFile::~MemoryMappedFile()
 {
+	if ( m_hChangedWait != NULL )
+		UnregisterWaitEx( m_hChangedWait, INVALID_HANDLE_VALUE );	// Blocks until any pending callback returns
+	if ( m_hChangedEvent != NULL )
+		CloseHandle( m_hChangedEvent );
+
 	UnmapViewOfFile( m_pMappedFile );
 	CloseHandle( m_hFile );
 }
 
+void CALLBACK	MemoryMappedFile::OnChanged( void* _pContext, BOOLEAN _bTimedOut )
+{
+	InterlockedExchange( &((MemoryMappedFile*) _pContext)->m_bChanged, 1 );
+}
+
 bool		MemoryMappedFile::CheckForChange()
 {
-	U32	Checksum = *((U32*) m_pMappedFile);
-	if ( Checksum == m_Checksum )
-		return false;	// No change...
+	return InterlockedExchange( &m_bChanged, 0 ) != 0;
+}
+
+void		MemoryMappedFile::NotifyChange()
+{
+	if ( m_hChangedEvent != NULL )
+		SetEvent( m_hChangedEvent );
+}
 
-	m_Checksum = Checksum;
-	return true;
+
+//////////////////////////////////////////////////////////////////////////
+// Read-only disk file view
+MappedDiskFile::MappedDiskFile( const char* _pFileName )
+	: m_hMapping( NULL )
+	, m_pMappedFile( NULL )
+	, m_Size( 0 )
+{
+	m_hFile = CreateFileA( _pFileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+	if ( m_hFile == INVALID_HANDLE_VALUE )
+		return;
+
+	DWORD	FileSize = GetFileSize( m_hFile, NULL );
+	if ( FileSize == INVALID_FILE_SIZE || FileSize == 0 )
+		return;	// Empty files can't be mapped
+
+	m_hMapping = CreateFileMappingA( m_hFile, NULL, PAGE_READONLY, 0, 0, NULL );
+	if ( m_hMapping == NULL )
+		return;
+
+	m_pMappedFile = (const U8*) MapViewOfFile( m_hMapping, FILE_MAP_READ, 0, 0, 0 );
+	if ( m_pMappedFile != NULL )
+		m_Size = FileSize;
+}
+
+MappedDiskFile::~MappedDiskFile()
+{
+	if ( m_pMappedFile != NULL )
+		UnmapViewOfFile( m_pMappedFile );
+	if ( m_hMapping != NULL )
+		CloseHandle( m_hMapping );
+	if ( m_hFile != INVALID_HANDLE_VALUE )
+		CloseHandle( m_hFile );
 }
@@ -1,6 +1,10 @@
 //////////////////////////////////////////////////////////////////////////
 // Memory Mapped Files support
 //
+// Changes are notified rather than polled: the process writing the mapping sets the named auto-reset event "<FileName>_Changed"
+//	(or calls NotifyChange() if it uses this class too) once it's done writing, a thread-pool wait flags the change
+//	and CheckForChange() simply consumes that flag without ever touching the shared memory.
+//
 #pragma once
 
 class MemoryMappedFile
@@ -9,7 +13,11 @@ private:
 
 	HANDLE			m_hFile;
 	void*			m_pMappedFile;
-	U32				m_Checksum;
+	HANDLE			m_hChangedEvent;
+	HANDLE			m_hChangedWait;
+	volatile LONG	m_bChanged;
+
+	static void CALLBACK	OnChanged( void* _pContext, BOOLEAN _bTimedOut );
 
 public:
 
@@ -19,16 +27,76 @@ public:
 	void*					GetMappedMemory()		{ return m_pMappedFile; }
 	template<typename T> T&	GetMappedMemory()		{ return *((T*) m_pMappedFile); }
 
-	// Check for any external change in content...
+	// Returns true once after each notified external change in content...
 	bool			CheckForChange();
+
+	// Notifies the readers of the mapping that its content changed
+	void			NotifyChange();
 };
 
+// Typed mapping that keeps a snapshot of the content as of the last 2 changes so readers can tell which parameters changed
+//	and only update what depends on them (e.g. a single constant buffer) instead of everything
 template<typename T> class MMF : protected MemoryMappedFile
 {
+private:
+
+	T		m_pSnapshots[2];	// Previous & current content
+	int		m_ChangesCount;
+
+	template<typename F> static U32	Offset( F T::* _pField )	{ return U32( size_t( &(((T*) NULL)->*_pField) ) ); }
+
+public:
+
+	MMF( const char* _pFileName ) : MemoryMappedFile( sizeof(T), _pFileName ), m_ChangesCount( 0 ) {}
+
+	T&			GetMappedMemory()	{ return MemoryMappedFile::GetMappedMemory<T>(); }
+	const T&	GetSnapshot() const	{ return m_pSnapshots[1]; }		// Content as of the last call to CheckForChange() that returned true
+	void		NotifyChange()		{ MemoryMappedFile::NotifyChange(); }
+
+	bool		CheckForChange()
+	{
+		if ( !MemoryMappedFile::CheckForChange() )
+			return false;
+
+		m_pSnapshots[0] = m_pSnapshots[1];
+		m_pSnapshots[1] = GetMappedMemory();
+		m_ChangesCount++;
+		return true;
+	}
+
+	// Tells if the fields from _pFirst to _pLast (included) changed with the last change (always true for the first change)
+	template<typename F, typename G> bool	HasChanged( F T::* _pFirst, G T::* _pLast ) const
+	{
+		if ( m_ChangesCount < 2 )
+			return true;
+
+		U32	Start = Offset( _pFirst );
+		U32	End = Offset( _pLast ) + sizeof(G);
+		ASSERT( End > Start, "Fields are in the wrong order!" );
+		return memcmp( (const U8*) &m_pSnapshots[0] + Start, (const U8*) &m_pSnapshots[1] + Start, End - Start ) != 0;
+	}
+	template<typename F> bool	HasChanged( F T::* _pField ) const	{ return HasChanged( _pField, _pField ); }
+};
+
+// Read-only view of an existing disk file
+// Use this to access binary files in place instead of reading them into memory
+class MappedDiskFile
+{
+private:
+
+	HANDLE			m_hFile;
+	HANDLE			m_hMapping;
+	const U8*		m_pMappedFile;
+	U32				m_Size;
+
 public:
 
-	MMF( const char* _pFileName ) : MemoryMappedFile( sizeof(T), _pFileName ) {}
+	MappedDiskFile( const char* _pFileName );
+	~MappedDiskFile();
+
+	bool						IsValid() const			{ return m_pMappedFile != NULL; }	// False if the file doesn't exist or couldn't be mapped
+	U32							GetSize() const			{ return m_Size; }
 
-	T&		GetMappedMemory()	{ return MemoryMappedFile::GetMappedMemory<T>(); }
-	bool	CheckForChange()	{ return MemoryMappedFile::CheckForChange(); }
+	const void*					GetMappedMemory() const	{ return m_pMappedFile; }
+	template<typename T> const T*	GetMappedMemory( U32 _Offset ) const	{ return (const T*) (m_pMappedFile + _Offset); }
 };
\ No newline at end of file
@@ -0,0 +1,276 @@
+#include "../GodComplex.h"
+
+namespace
+{
+	// Symmetric 4x4 matrix summing the squared distances to the planes around a vertex
+	struct	Quadric
+	{
+		double	a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+
+		void	Clear()
+		{
+			memset( this, 0, sizeof(Quadric) );
+		}
+
+		void	AddPlane( double a, double b, double c, double d, double _Weight )
+		{
+			a2 += _Weight * a * a;	ab += _Weight * a * b;	ac += _Weight * a * c;	ad += _Weight * a * d;
+			b2 += _Weight * b * b;	bc += _Weight * b * c;	bd += _Weight * b * d;
+			c2 += _Weight * c * c;	cd += _Weight * c * d;
+			d2 += _Weight * d * d;
+		}
+
+		void	Add( const Quadric& _Q )
+		{
+			a2 += _Q.a2;	ab += _Q.ab;	ac += _Q.ac;	ad += _Q.ad;
+			b2 += _Q.b2;	bc += _Q.bc;	bd += _Q.bd;
+			c2 += _Q.c2;	cd += _Q.cd;
+			d2 += _Q.d2;
+		}
+
+		double	Error( const float3& _P ) const
+		{
+			double	x = _P.x, y = _P.y, z = _P.z;
+			return	a2*x*x + 2.0*ab*x*y + 2.0*ac*x*z + 2.0*ad*x
+				+	b2*y*y + 2.0*bc*y*z + 2.0*bd*y
+				+	c2*z*z + 2.0*cd*z
+				+	d2;
+		}
+	};
+
+	struct	Collapse
+	{
+		U32		Cost;		// Positive float reinterpreted as an integer so collapses sort as integers
+		U32		Source;		// Vertex that disappears
+		U32		Target;		// Vertex it's merged into
+	};
+
+	U32		CostAsInteger( double _Cost )
+	{
+		float	Cost = float( MAX( 0.0, _Cost ) );
+		return *((U32*) &Cost);
+	}
+
+	// LSD radix sort on the costs, 3 passes of 11 bits
+	void	SortCollapses( U32 _Count, Collapse*& _pCollapses, Collapse*& _pTemp )
+	{
+		for ( U32 Shift=0; Shift < 33; Shift+=11 )
+		{
+			U32	pStart[2048];
+			memset( pStart, 0, 2048*sizeof(U32) );
+			for ( U32 i=0; i < _Count; i++ )
+				pStart[(_pCollapses[i].Cost >> Shift) & 0x7FF]++;
+
+			U32	Sum = 0;
+			for ( U32 Digit=0; Digit < 2048; Digit++ )
+			{
+				U32	Count = pStart[Digit];
+				pStart[Digit] = Sum;
+				Sum += Count;
+			}
+			for ( U32 i=0; i < _Count; i++ )
+				_pTemp[pStart[(_pCollapses[i].Cost >> Shift) & 0x7FF]++] = _pCollapses[i];
+
+			Collapse*	pSwap = _pCollapses;
+			_pCollapses = _pTemp;
+			_pTemp = pSwap;
+		}
+	}
+
+	// Builds the list of faces using each vertex
+	void	BuildVertexFaces( U32 _VerticesCount, U32 _FacesCount, const U32* _pFaces, U32* _pFacesStart, U32* _pVertexFaces )
+	{
+		memset( _pFacesStart, 0, (_VerticesCount+1)*sizeof(U32) );
+		for ( U32 i=0; i < 3*_FacesCount; i++ )
+			_pFacesStart[_pFaces[i]+1]++;
+		for ( U32 VertexIndex=0; VertexIndex < _VerticesCount; VertexIndex++ )
+			_pFacesStart[VertexIndex+1] += _pFacesStart[VertexIndex];
+		for ( U32 i=0; i < 3*_FacesCount; i++ )
+			_pVertexFaces[_pFacesStart[_pFaces[i]]++] = i / 3;
+		for ( U32 VertexIndex=_VerticesCount; VertexIndex > 0; VertexIndex-- )	// Restore the starts we incremented
+			_pFacesStart[VertexIndex] = _pFacesStart[VertexIndex-1];
+		_pFacesStart[0] = 0;
+	}
+
+	bool	HasVertex( const U32* _pFace, U32 _VertexIndex )
+	{
+		return _pFace[0] == _VertexIndex || _pFace[1] == _VertexIndex || _pFace[2] == _VertexIndex;
+	}
+}
+
+U32	MeshSimplifier::Simplify( U32 _VerticesCount, const float3* _pPositions, U32 _PositionStride, U32 _FacesCount, const U32* _pFaces, U32 _TargetFacesCount, float _MaxError, U32* _pResultFaces )
+{
+	ASSERT( _pResultFaces != _pFaces, "Can't simplify in place!" );
+	memcpy( _pResultFaces, _pFaces, 3*_FacesCount*sizeof(U32) );
+	if ( _FacesCount <= _TargetFacesCount )
+		return _FacesCount;
+
+	const U8*	pPositions = (const U8*) _pPositions;
+#define	POSITION( Index )	(*((const float3*) (pPositions + _PositionStride * (Index))))
+
+	//////////////////////////////////////////////////////////////////////////
+	// Accumulate the planes of the faces around each vertex
+	Quadric*	pQuadrics = new Quadric[_VerticesCount];
+	for ( U32 VertexIndex=0; VertexIndex < _VerticesCount; VertexIndex++ )
+		pQuadrics[VertexIndex].Clear();
+
+	for ( U32 FaceIndex=0; FaceIndex < _FacesCount; FaceIndex++ )
+	{
+		const U32*		pFace = _pFaces + 3*FaceIndex;
+		const float3&	P0 = POSITION( pFace[0] );
+		float3			Normal = (POSITION( pFace[1] ) - P0) ^ (POSITION( pFace[2] ) - P0);
+		float			Length = Normal.Length();
+		if ( Length < 1e-12f )
+			continue;	// Degenerate
+
+		Normal = Normal / Length;
+		double	Distance = -(Normal | P0);
+		for ( int i=0; i < 3; i++ )
+			pQuadrics[pFace[i]].AddPlane( Normal.x, Normal.y, Normal.z, Distance, 1.0 );
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+	// Collapse in passes: each pass sorts the candidate collapses and applies the cheapest ones that don't share any neighborhood
+	U32*		pFacesStart = new U32[_VerticesCount+1];
+	U32*		pVertexFaces = new U32[3*_FacesCount];
+	bool*		pLocked = new bool[_VerticesCount];
+	U8*			pTouched = new U8[_VerticesCount];
+	U32*		pRemap = new U32[_VerticesCount];
+	Collapse*	pCollapses = new Collapse[6*_FacesCount];
+	Collapse*	pTemp = new Collapse[6*_FacesCount];
+
+	U32	FacesCount = _FacesCount;
+	for ( U32 Pass=0; Pass < MAX_PASSES && FacesCount > _TargetFacesCount; Pass++ )
+	{
+		BuildVertexFaces( _VerticesCount, FacesCount, _pResultFaces, pFacesStart, pVertexFaces );
+
+		if ( Pass == 0 )
+		{	// Lock the border vertices: an edge used by a single face is on a border (collapses never create new borders)
+			memset( pLocked, 0, _VerticesCount*sizeof(bool) );
+			for ( U32 FaceIndex=0; FaceIndex < FacesCount; FaceIndex++ )
+				for ( int i=0; i < 3; i++ )
+				{
+					U32	A = _pResultFaces[3*FaceIndex+i];
+					U32	B = _pResultFaces[3*FaceIndex+(i+1)%3];
+					U32	EdgeFacesCount = 0;
+					for ( U32 j=pFacesStart[A]; j < pFacesStart[A+1]; j++ )
+						if ( HasVertex( _pResultFaces + 3*pVertexFaces[j], B ) )
+							EdgeFacesCount++;
+					if ( EdgeFacesCount == 1 )
+						pLocked[A] = pLocked[B] = true;
+				}
+		}
+
+		// List the candidate collapses along each edge
+		U32	CollapsesCount = 0;
+		for ( U32 FaceIndex=0; FaceIndex < FacesCount; FaceIndex++ )
+			for ( int i=0; i < 3; i++ )
+			{
+				U32	A = _pResultFaces[3*FaceIndex+i];
+				U32	B = _pResultFaces[3*FaceIndex+(i+1)%3];
+				for ( int Direction=0; Direction < 2; Direction++ )
+				{
+					U32	Source = Direction == 0 ? A : B;
+					U32	Target = Direction == 0 ? B : A;
+					if ( pLocked[Source] )
+						continue;
+
+					Quadric	Q = pQuadrics[Source];
+					Q.Add( pQuadrics[Target] );
+
+					Collapse&	C = pCollapses[CollapsesCount++];
+					C.Cost = CostAsInteger( Q.Error( POSITION( Target ) ) );
+					C.Source = Source;
+					C.Target = Target;
+				}
+			}
+
+		SortCollapses( CollapsesCount, pCollapses, pTemp );
+
+		// Apply the cheapest collapses
+		U32	MaxCost = CostAsInteger( _MaxError );
+		U32	FacesToRemove = FacesCount - _TargetFacesCount;
+		U32	RemovedFacesCount = 0;
+		U32	AppliedCollapsesCount = 0;
+		for ( U32 VertexIndex=0; VertexIndex < _VerticesCount; VertexIndex++ )
+			pRemap[VertexIndex] = VertexIndex;
+		memset( pTouched, 0, _VerticesCount );
+
+		for ( U32 CollapseIndex=0; CollapseIndex < CollapsesCount && RemovedFacesCount < FacesToRemove; CollapseIndex++ )
+		{
+			const Collapse&	C = pCollapses[CollapseIndex];
+			if ( C.Cost > MaxCost )
+				break;	// All the remaining collapses are too expensive
+			if ( pTouched[C.Source] || pTouched[C.Target] )
+				continue;	// Neighborhood already modified by this pass
+
+			// Check the faces around the source don't flip when it moves onto the target
+			const float3&	TargetPosition = POSITION( C.Target );
+			U32		CollapsedFacesCount = 0;
+			bool	bFlips = false;
+			for ( U32 j=pFacesStart[C.Source]; j < pFacesStart[C.Source+1] && !bFlips; j++ )
+			{
+				const U32*	pFace = _pResultFaces + 3*pVertexFaces[j];
+				if ( HasVertex( pFace, C.Target ) )
+				{
+					CollapsedFacesCount++;
+					continue;
+				}
+
+				float3	P[3] = { POSITION( pFace[0] ), POSITION( pFace[1] ), POSITION( pFace[2] ) };
+				float3	NormalBefore = (P[1] - P[0]) ^ (P[2] - P[0]);
+				for ( int i=0; i < 3; i++ )
+					if ( pFace[i] == C.Source )
+						P[i] = TargetPosition;
+				float3	NormalAfter = (P[1] - P[0]) ^ (P[2] - P[0]);
+				bFlips = (NormalBefore | NormalAfter) <= 0.0f;
+			}
+			if ( bFlips || CollapsedFacesCount == 0 )
+				continue;
+
+			pRemap[C.Source] = C.Target;
+			pQuadrics[C.Target].Add( pQuadrics[C.Source] );
+			RemovedFacesCount += CollapsedFacesCount;
+			AppliedCollapsesCount++;
+
+			// Lock the 1-ring of the source for the rest of the pass
+			for ( U32 j=pFacesStart[C.Source]; j < pFacesStart[C.Source+1]; j++ )
+			{
+				const U32*	pFace = _pResultFaces + 3*pVertexFaces[j];
+				pTouched[pFace[0]] = pTouched[pFace[1]] = pTouched[pFace[2]] = 1;
+			}
+		}
+		if ( AppliedCollapsesCount == 0 )
+			break;	// Can't simplify any further
+
+		// Remap the faces and drop the collapsed ones
+		U32	NewFacesCount = 0;
+		for ( U32 FaceIndex=0; FaceIndex < FacesCount; FaceIndex++ )
+		{
+			U32	A = pRemap[_pResultFaces[3*FaceIndex+0]];
+			U32	B = pRemap[_pResultFaces[3*FaceIndex+1]];
+			U32	C = pRemap[_pResultFaces[3*FaceIndex+2]];
+			if ( A == B || B == C || C == A )
+				continue;
+
+			_pResultFaces[3*NewFacesCount+0] = A;
+			_pResultFaces[3*NewFacesCount+1] = B;
+			_pResultFaces[3*NewFacesCount+2] = C;
+			NewFacesCount++;
+		}
+		FacesCount = NewFacesCount;
+	}
+
+#undef POSITION
+
+	delete[] pTemp;
+	delete[] pCollapses;
+	delete[] pRemap;
+	delete[] pTouched;
+	delete[] pLocked;
+	delete[] pVertexFaces;
+	delete[] pFacesStart;
+	delete[] pQuadrics;
+
+	return FacesCount;
+}
@@ -0,0 +1,26 @@
+//////////////////////////////////////////////////////////////////////////
+// Quadric error mesh simplification used to build the levels of detail of the scene primitives
+//
+// Edges are collapsed onto one of their existing vertices (half-edge collapses) so a simplified mesh only needs new indices
+//	and keeps sharing the vertex buffer (and any additional per-vertex stream) of the original mesh.
+// Vertices on borders are locked, that includes the seams where vertices are split because of their attributes (e.g. UVs),
+//	so no crack can open at a seam.
+//
+#pragma once
+
+class	MeshSimplifier
+{
+protected:	// CONSTANTS
+
+	static const U32	MAX_PASSES = 64;
+
+public:		// METHODS
+
+	// Simplifies an indexed triangle list until it has at most _TargetFacesCount faces or no collapse is cheaper than _MaxError
+	//	_pPositions, position of the first vertex, the next ones are found every _PositionStride bytes
+	//	_pFaces, 3 indices per face
+	//	_MaxError, the maximum quadric error allowed for a collapse (i.e. sum of the squared distances to the planes of the original faces around the merged vertices)
+	//	_pResultFaces, receives the faces of the simplified mesh, must be able to hold _FacesCount faces (can't be _pFaces)
+	// Returns the amount of faces of the simplified mesh
+	static U32	Simplify( U32 _VerticesCount, const float3* _pPositions, U32 _PositionStride, U32 _FacesCount, const U32* _pFaces, U32 _TargetFacesCount, float _MaxError, U32* _pResultFaces );
+};
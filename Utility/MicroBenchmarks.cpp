@@ -0,0 +1,491 @@
+#include "../GodComplex.h"
+
+#ifdef MICRO_BENCHMARKS
+
+namespace
+{
+	const double	MIN_DURATION = 0.2;		// Minimum duration (in seconds) a kernel is repeated for
+	const U32		SEED = 1;				// All inputs are generated from this seed so runs can be compared
+
+	volatile float	gs_Sink = 0.0f;			// Results are accumulated here so the compiler can't discard the measured code
+
+	// A measured kernel
+	// Setup() and Teardown() are called once per size around the measure, Run() is called repeatedly and returns the
+	//	amount of operations it processed
+	class	IMicroBenchmark
+	{
+	public:
+		virtual const char*	GetName() const = 0;
+		virtual void		Setup( int _Size )	{}
+		virtual U32			Run( int _Size ) = 0;
+		virtual void		Teardown()			{}
+	};
+
+	//////////////////////////////////////////////////////////////////////////
+	// Noises
+	float	CombineF1( float _pSqDistances[], int _pCellX[], int _pCellY[], int _pCellZ[], void* _pData )	{ return sqrtf( _pSqDistances[0] ); }
+
+	class	NoiseBenchmark : public IMicroBenchmark
+	{
+	protected:
+		Noise*	m_pNoise;
+		bool	m_bHashed;
+	public:
+		NoiseBenchmark( bool _bHashed=false ) : m_bHashed( _bHashed )	{}
+		virtual void	Setup( int _Size )	{ m_pNoise = new Noise( SEED, m_bHashed ); }
+		virtual void	Teardown()			{ delete m_pNoise; }
+	};
+
+	class	Perlin3DBenchmark : public NoiseBenchmark
+	{
+	public:
+		Perlin3DBenchmark( bool _bHashed ) : NoiseBenchmark( _bHashed )	{}
+		virtual const char*	GetName() const	{ return m_bHashed ? "Noise::Perlin3D (hashed)" : "Noise::Perlin3D"; }
+		virtual U32			Run( int _Size )
+		{
+			float	Sum = 0.0f;
+			float	Scale = 8.0f / _Size;
+			for ( int Y=0; Y < _Size; Y++ )
+				for ( int X=0; X < _Size; X++ )
+					Sum += m_pNoise->Perlin( float3( Scale * X, Scale * Y, 0.5f ) );
+			gs_Sink += Sum;
+			return _Size * _Size;
+		}
+	};
+
+	class	PerlinBatchBenchmark : public NoiseBenchmark
+	{
+		float3*	m_pUVW;
+		float*	m_pResults;
+	public:
+		PerlinBatchBenchmark( bool _bHashed ) : NoiseBenchmark( _bHashed )	{}
+		virtual const char*	GetName() const	{ return m_bHashed ? "Noise::PerlinBatch (hashed)" : "Noise::PerlinBatch"; }
+		virtual void		Setup( int _Size )
+		{
+			NoiseBenchmark::Setup( _Size );
+			m_pUVW = new float3[_Size*_Size];
+			m_pResults = new float[_Size*_Size];
+			float	Scale = 8.0f / _Size;
+			for ( int Y=0; Y < _Size; Y++ )
+				for ( int X=0; X < _Size; X++ )
+					m_pUVW[_Size*Y+X] = float3( Scale * X, Scale * Y, 0.5f );
+		}
+		virtual void		Teardown()
+		{
+			delete[] m_pResults;
+			delete[] m_pUVW;
+			NoiseBenchmark::Teardown();
+		}
+		virtual U32			Run( int _Size )
+		{
+			m_pNoise->PerlinBatch( m_pUVW, m_pResults, _Size*_Size );
+			gs_Sink += m_pResults[0];
+			return _Size * _Size;
+		}
+	};
+
+	class	Worley3DBenchmark : public NoiseBenchmark
+	{
+	public:
+		virtual const char*	GetName() const	{ return "Noise::Worley3D"; }
+		virtual U32			Run( int _Size )
+		{
+			float	Sum = 0.0f;
+			float	Scale = 8.0f / _Size;
+			for ( int Y=0; Y < _Size; Y++ )
+				for ( int X=0; X < _Size; X++ )
+					Sum += m_pNoise->Worley( float3( Scale * X, Scale * Y, 0.5f ), CombineF1, NULL );
+			gs_Sink += Sum;
+			return _Size * _Size;
+		}
+	};
+
+	class	Wavelet2DBenchmark : public NoiseBenchmark
+	{
+	public:
+		virtual const char*	GetName() const	{ return "Noise::Wavelet2D"; }
+		virtual void		Setup( int _Size )
+		{
+			NoiseBenchmark::Setup( _Size );
+			m_pNoise->Create2DWaveletNoiseTile( 7 );
+		}
+		virtual U32			Run( int _Size )
+		{
+			float	Sum = 0.0f;
+			float	Scale = 8.0f / _Size;
+			for ( int Y=0; Y < _Size; Y++ )
+				for ( int X=0; X < _Size; X++ )
+					Sum += m_pNoise->Wavelet( float2( Scale * X, Scale * Y ) );
+			gs_Sink += Sum;
+			return _Size * _Size;
+		}
+	};
+
+	//////////////////////////////////////////////////////////////////////////
+	// Texture builder, filters & generators
+	void	FillPerlin( int _X, int _Y, const float2& _UV, Pixel& _Pixel, void* _pData )
+	{
+		const Noise&	N = *((const Noise*) _pData);
+		float	Value = 0.5f + 0.5f * N.Perlin( float3( 8.0f * _UV.x, 8.0f * _UV.y, 0.5f ) );
+		_Pixel.RGBA = float4( Value, Value, Value, 1.0f );
+		_Pixel.Height = Value;
+	}
+
+	class	TextureBuilderBenchmark : public NoiseBenchmark
+	{
+	protected:
+		TextureBuilder*	m_pBuilder;
+	public:
+		virtual void	Setup( int _Size )
+		{
+			NoiseBenchmark::Setup( _Size );
+			m_pBuilder = new TextureBuilder( _Size, _Size );
+			m_pBuilder->Fill( FillPerlin, m_pNoise, true );
+		}
+		virtual void	Teardown()
+		{
+			delete m_pBuilder;
+			NoiseBenchmark::Teardown();
+		}
+	};
+
+	class	FillBenchmark : public TextureBuilderBenchmark
+	{
+		bool	m_bThreadSafe;
+	public:
+		FillBenchmark( bool _bThreadSafe ) : m_bThreadSafe( _bThreadSafe )	{}
+		virtual const char*	GetName() const	{ return m_bThreadSafe ? "TextureBuilder::Fill (threaded)" : "TextureBuilder::Fill"; }
+		virtual U32			Run( int _Size )
+		{
+			m_pBuilder->Fill( FillPerlin, m_pNoise, m_bThreadSafe );
+			return _Size * _Size;
+		}
+	};
+
+	class	GenerateMipsBenchmark : public TextureBuilderBenchmark
+	{
+	public:
+		virtual const char*	GetName() const	{ return "TextureBuilder::GenerateMips"; }
+		virtual U32			Run( int _Size )
+		{
+			m_pBuilder->GenerateMips();
+			return _Size * _Size;
+		}
+	};
+
+	class	ConvertBenchmark : public TextureBuilderBenchmark
+	{
+	public:
+		virtual const char*	GetName() const	{ return "TextureBuilder::Convert (RGBA8)"; }
+		virtual U32			Run( int _Size )
+		{
+			int	ArraySize;
+			m_pBuilder->Convert( PixelFormatRGBA8::DESCRIPTOR, TextureBuilder::CONV_RGBA, ArraySize );	// Mips are only generated by the first call
+			return _Size * _Size;
+		}
+	};
+
+	class	BlurGaussianBenchmark : public TextureBuilderBenchmark
+	{
+	public:
+		virtual const char*	GetName() const	{ return "Filters::BlurGaussian"; }
+		virtual U32			Run( int _Size )
+		{
+			Filters::BlurGaussian( *m_pBuilder, 4.0f, 4.0f );
+			return _Size * _Size;
+		}
+	};
+
+	class	ErodeBenchmark : public TextureBuilderBenchmark
+	{
+	public:
+		virtual const char*	GetName() const	{ return "Filters::Erode"; }
+		virtual U32			Run( int _Size )
+		{
+			Filters::Erode( *m_pBuilder );
+			return _Size * _Size;
+		}
+	};
+
+	class	ComputeAOBenchmark : public TextureBuilderBenchmark
+	{
+		TextureBuilder*	m_pTarget;
+	public:
+		virtual const char*	GetName() const	{ return "Generators::ComputeAO"; }
+		virtual void		Setup( int _Size )
+		{
+			TextureBuilderBenchmark::Setup( _Size );
+			m_pTarget = new TextureBuilder( _Size, _Size );
+		}
+		virtual void		Teardown()
+		{
+			delete m_pTarget;
+			TextureBuilderBenchmark::Teardown();
+		}
+		virtual U32			Run( int _Size )
+		{
+			Generators::ComputeAO( *m_pBuilder, *m_pTarget );
+			return _Size * _Size;
+		}
+	};
+
+	//////////////////////////////////////////////////////////////////////////
+	// SH
+	class	SHProduct3Benchmark : public IMicroBenchmark
+	{
+		float*	m_pCoefficients;
+	public:
+		virtual const char*	GetName() const	{ return "SH::Product3"; }
+		virtual void		Setup( int _Size )
+		{
+			_srand( SEED, RAND_DEFAULT_SEED_V );
+			m_pCoefficients = new float[9*(_Size+1)];
+			for ( int CoeffIndex=0; CoeffIndex < 9*(_Size+1); CoeffIndex++ )
+				m_pCoefficients[CoeffIndex] = _frand( -1.0f, 1.0f );
+		}
+		virtual void		Teardown()	{ delete[] m_pCoefficients; }
+		virtual U32			Run( int _Size )
+		{
+			float	pResult[9];
+			float	Sum = 0.0f;
+			for ( int ProductIndex=0; ProductIndex < _Size; ProductIndex++ )
+			{
+				SH::Product3( m_pCoefficients + 9*ProductIndex, m_pCoefficients + 9*(ProductIndex+1), pResult );
+				Sum += pResult[0];
+			}
+			gs_Sink += Sum;
+			return _Size;
+		}
+	};
+
+	//////////////////////////////////////////////////////////////////////////
+	// Octree
+	class	OctreeFetchNearestBenchmark : public IMicroBenchmark
+	{
+		Octree<int>*	m_pOctree;
+		float3*			m_pQueries;
+	public:
+		virtual const char*	GetName() const	{ return "Octree::FetchNearest"; }
+		virtual void		Setup( int _Size )
+		{
+			_srand( SEED, RAND_DEFAULT_SEED_V );
+			m_pOctree = new Octree<int>();
+			m_pOctree->Init( float3::Zero, 100.0f, 1.0f, _Size );
+			for ( int ElementIndex=0; ElementIndex < _Size; ElementIndex++ )
+				m_pOctree->Append( float3( _frand( 0, 100 ), _frand( 0, 100 ), _frand( 0, 100 ) ), 1.0f, ElementIndex );
+
+			m_pQueries = new float3[1024];
+			for ( int QueryIndex=0; QueryIndex < 1024; QueryIndex++ )
+				m_pQueries[QueryIndex] = float3( _frand( 0, 100 ), _frand( 0, 100 ), _frand( 0, 100 ) );
+		}
+		virtual void		Teardown()
+		{
+			delete[] m_pQueries;
+			delete m_pOctree;
+		}
+		virtual U32			Run( int _Size )
+		{
+			float	Sum = 0.0f;
+			for ( int QueryIndex=0; QueryIndex < 1024; QueryIndex++ )
+			{
+				float	Distance;
+				m_pOctree->FetchNearest( m_pQueries[QueryIndex], Distance );
+				Sum += Distance;
+			}
+			gs_Sink += Sum;
+			return 1024;
+		}
+	};
+
+	// Fetch() per query vs. FetchBatch() for the same 1024 queries
+	class	OctreeFetchBenchmark : public IMicroBenchmark
+	{
+	protected:
+		bool			m_bBatch;
+		Octree<int>*	m_pOctree;
+		float3*			m_pQueries;
+		int*			m_pOffsets;
+		List<int>		m_Result;
+	public:
+		OctreeFetchBenchmark( bool _bBatch ) : m_bBatch( _bBatch )	{}
+		virtual const char*	GetName() const	{ return m_bBatch ? "Octree::FetchBatch" : "Octree::Fetch"; }
+		virtual void		Setup( int _Size )
+		{
+			_srand( SEED, RAND_DEFAULT_SEED_V );
+			m_pOctree = new Octree<int>();
+			m_pOctree->Init( float3::Zero, 100.0f, 1.0f, _Size );
+			for ( int ElementIndex=0; ElementIndex < _Size; ElementIndex++ )
+				m_pOctree->Append( float3( _frand( 0, 100 ), _frand( 0, 100 ), _frand( 0, 100 ) ), _frand( 1.0f, 8.0f ), ElementIndex );
+
+			m_pQueries = new float3[1024];
+			for ( int QueryIndex=0; QueryIndex < 1024; QueryIndex++ )
+				m_pQueries[QueryIndex] = float3( _frand( 0, 100 ), _frand( 0, 100 ), _frand( 0, 100 ) );
+			m_pOffsets = new int[1024+1];
+		}
+		virtual void		Teardown()
+		{
+			delete[] m_pOffsets;
+			delete[] m_pQueries;
+			delete m_pOctree;
+		}
+		virtual U32			Run( int _Size )
+		{
+			m_Result.Clear();
+			if ( m_bBatch )
+				m_pOctree->FetchBatch( m_pQueries, 1024, m_Result, m_pOffsets );
+			else
+				for ( int QueryIndex=0; QueryIndex < 1024; QueryIndex++ )
+					m_pOctree->Fetch( m_pQueries[QueryIndex], m_Result );
+
+			gs_Sink += float(m_Result.GetCount());
+			return 1024;
+		}
+	};
+
+	//////////////////////////////////////////////////////////////////////////
+	// Dictionaries
+	// Each run adds _Size entries to an empty dictionary then queries them all
+	U32		KeyOf( int _Index )	{ return (U32) _Index * Noise::FNV_PRIME + Noise::OFFSET_BASIS; }
+
+	class	DictionaryU32Benchmark : public IMicroBenchmark
+	{
+	public:
+		virtual const char*	GetName() const	{ return "DictionaryU32 Add+Get"; }
+		virtual U32			Run( int _Size )
+		{
+			DictionaryU32	D;
+			for ( int Index=0; Index < _Size; Index++ )
+				D.Add( KeyOf( Index ), (void*) (size_t) (Index+1) );
+			size_t	Sum = 0;
+			for ( int Index=0; Index < _Size; Index++ )
+				Sum += (size_t) D.Get( KeyOf( Index ) );
+			gs_Sink += float(Sum);
+			return 2 * _Size;
+		}
+	};
+
+	class	DictionaryBenchmark : public IMicroBenchmark
+	{
+	public:
+		virtual const char*	GetName() const	{ return "Dictionary<int> Add+Get"; }
+		virtual U32			Run( int _Size )
+		{
+			Dictionary<int>	D;
+			for ( int Index=0; Index < _Size; Index++ )
+				D.Add( KeyOf( Index ), Index );
+			int	Sum = 0;
+			for ( int Index=0; Index < _Size; Index++ )
+				Sum += *D.Get( KeyOf( Index ) );
+			gs_Sink += float(Sum);
+			return 2 * _Size;
+		}
+	};
+
+	class	DictionaryStringBenchmark : public IMicroBenchmark
+	{
+		char*	m_pKeys;
+	public:
+		virtual const char*	GetName() const	{ return "DictionaryString<int> Add+Get"; }
+		virtual void		Setup( int _Size )
+		{
+			m_pKeys = new char[16*_Size];
+			for ( int Index=0; Index < _Size; Index++ )
+				sprintf_s( m_pKeys + 16*Index, 16, "Key%08X", KeyOf( Index ) );
+		}
+		virtual void		Teardown()	{ delete[] m_pKeys; }
+		virtual U32			Run( int _Size )
+		{
+			DictionaryString<int>	D;
+			for ( int Index=0; Index < _Size; Index++ )
+				D.Add( m_pKeys + 16*Index, Index );
+			int	Sum = 0;
+			for ( int Index=0; Index < _Size; Index++ )
+				Sum += *D.Get( m_pKeys + 16*Index );
+			gs_Sink += float(Sum);
+			return 2 * _Size;
+		}
+	};
+
+	double	GetSeconds( const LARGE_INTEGER& _Start, const LARGE_INTEGER& _End, const LARGE_INTEGER& _Frequency )
+	{
+		return double(_End.QuadPart - _Start.QuadPart) / _Frequency.QuadPart;
+	}
+
+	// Repeats the kernel until it ran for MIN_DURATION and writes a CSV line
+	void	Measure( IMicroBenchmark& _Benchmark, int _Size, FILE* _pFile )
+	{
+		_Benchmark.Setup( _Size );
+		_Benchmark.Run( _Size );	// Warm the caches up
+
+		LARGE_INTEGER	Frequency, Start, End;
+		QueryPerformanceFrequency( &Frequency );
+
+		LONG	AllocationsCount = gs_AllocationsCount;
+		U32		IterationsCount = 0;
+		double	OperationsCount = 0.0;
+		double	Duration = 0.0;
+		QueryPerformanceCounter( &Start );
+		do
+		{
+			OperationsCount += _Benchmark.Run( _Size );
+			IterationsCount++;
+			QueryPerformanceCounter( &End );
+			Duration = GetSeconds( Start, End, Frequency );
+		} while ( Duration < MIN_DURATION );
+		AllocationsCount = gs_AllocationsCount - AllocationsCount;
+
+		_Benchmark.Teardown();
+
+		fprintf( _pFile, "%s,%d,%d,%.3f,%.3f,%.3f\n", _Benchmark.GetName(), _Size, IterationsCount, 1e9 * Duration / OperationsCount, 1e-6 * OperationsCount / Duration, AllocationsCount / OperationsCount );
+		fflush( _pFile );
+	}
+}
+
+void	RunMicroBenchmarks( const char* _pFileName )
+{
+	FILE*	pFile = NULL;
+	fopen_s( &pFile, _pFileName, "w" );
+	ASSERT( pFile != NULL, "Failed to create the micro benchmarks file!" );
+	if ( pFile == NULL )
+		return;
+
+	fprintf( pFile, "Name,Size,Iterations,ns/op,Mops/s,Allocs/op\n" );
+
+	Perlin3DBenchmark			Perlin3D( false );
+	Perlin3DBenchmark			Perlin3DHashed( true );
+	PerlinBatchBenchmark		PerlinBatch( false );
+	PerlinBatchBenchmark		PerlinBatchHashed( true );
+	Worley3DBenchmark			Worley3D;
+	Wavelet2DBenchmark			Wavelet2D;
+	FillBenchmark				Fill( false );
+	FillBenchmark				FillThreaded( true );
+	GenerateMipsBenchmark		GenerateMips;
+	ConvertBenchmark			Convert;
+	BlurGaussianBenchmark		BlurGaussian;
+	ErodeBenchmark				Erode;
+	ComputeAOBenchmark			ComputeAO;
+
+	IMicroBenchmark*	ppTextureBenchmarks[] = { &Perlin3D, &Perlin3DHashed, &PerlinBatch, &PerlinBatchHashed, &Worley3D, &Wavelet2D, &Fill, &FillThreaded, &GenerateMips, &Convert, &BlurGaussian, &Erode, &ComputeAO };
+	int					pTextureSizes[] = { 128, 256, 512 };
+	for ( int BenchmarkIndex=0; BenchmarkIndex < sizeof(ppTextureBenchmarks) / sizeof(IMicroBenchmark*); BenchmarkIndex++ )
+		for ( int SizeIndex=0; SizeIndex < sizeof(pTextureSizes) / sizeof(int); SizeIndex++ )
+			Measure( *ppTextureBenchmarks[BenchmarkIndex], pTextureSizes[SizeIndex], pFile );
+
+	SHProduct3Benchmark			SHProduct3;
+	OctreeFetchNearestBenchmark	OctreeFetchNearest;
+	OctreeFetchBenchmark		OctreeFetch( false );
+	OctreeFetchBenchmark		OctreeFetchBatch( true );
+	DictionaryU32Benchmark		DictionaryU32Bench;
+	DictionaryBenchmark			DictionaryBench;
+	DictionaryStringBenchmark	DictionaryStringBench;
+
+	IMicroBenchmark*	ppCountBenchmarks[] = { &SHProduct3, &OctreeFetchNearest, &OctreeFetch, &OctreeFetchBatch, &DictionaryU32Bench, &DictionaryBench, &DictionaryStringBench };
+	int					pCounts[] = { 256, 4096, 65536 };
+	for ( int BenchmarkIndex=0; BenchmarkIndex < sizeof(ppCountBenchmarks) / sizeof(IMicroBenchmark*); BenchmarkIndex++ )
+		for ( int CountIndex=0; CountIndex < sizeof(pCounts) / sizeof(int); CountIndex++ )
+			Measure( *ppCountBenchmarks[BenchmarkIndex], pCounts[CountIndex], pFile );
+
+	fclose( pFile );
+}
+
+#endif
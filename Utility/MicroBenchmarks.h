@@ -0,0 +1,25 @@
+//////////////////////////////////////////////////////////////////////////
+// CPU Micro Benchmarks
+// Measures the hot CPU kernels (noises, texture builder, filters & generators, SH products, octree queries and dictionaries)
+//	on fixed-seed inputs of several sizes, so an optimization of any of them can be measured and kept from regressing.
+//
+// Usage:
+//	Define MICRO_BENCHMARKS in GodComplex.h: the executable then runs the suite right after the memory pools are allocated
+//	and quits instead of running the intro. Each kernel is repeated until it ran for at least MIN_DURATION seconds.
+//
+// The results are written as a CSV with one line per kernel and size:
+//	Name, Size, Iterations, ns/op, Mops/s, Allocs/op
+// where an "op" is the unit of work the kernel reports (e.g. a noise sample, a pixel or a dictionary query) and Allocs/op
+//	counts the operator new, Alloc() and FrameAlloc() calls (cf. COUNT_ALLOCATION() in Memory.h).
+//
+// NOTE: Setup and teardown (e.g. allocating the texture builders or filling the dictionaries to query) are not measured.
+// The multithreaded kernels (e.g. Fill() or GenerateMips()) use the device's workers, the device must be initialized first.
+//
+#pragma once
+
+#ifdef MICRO_BENCHMARKS
+
+// Runs all the micro benchmarks and writes their results into the specified CSV file
+void	RunMicroBenchmarks( const char* _pFileName );
+
+#endif
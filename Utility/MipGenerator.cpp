@@ -0,0 +1,96 @@
+#include "../GodComplex.h"
+
+static const int	THREADS_X = 16;		// Threads per group, cf. MipGenerator.hlsl
+static const int	THREADS_Y = 16;
+
+ComputeShader*					MipGenerator::ms_ppKernels[MipGenerator::FILTERS_COUNT] = { NULL };
+CB<MipGenerator::CBMipGenerator>*	MipGenerator::ms_pCB_MipGenerator = NULL;
+
+static const char*	gs_ppKernelEntryPoints[MipGenerator::FILTERS_COUNT] =
+{
+	"CS_Box",
+	"CS_Kaiser",
+};
+
+bool	MipGenerator::Generate( Texture2D& _Texture, FILTER _Filter, bool _bSRGB )
+{
+	if ( _Texture.GetMipLevelsCount() <= 1 )
+		return true;	// Nothing to generate
+
+	// The hardware box filter is usually the fastest
+	if ( _Filter == FILTER_BOX && !_bSRGB && _Texture.GenerateMips() )
+		return true;
+
+	if ( !CreateKernels() )
+		return false;
+
+	ComputeShader&	Kernel = *ms_ppKernels[_Filter];
+	if ( !Kernel.Use() )
+		return false;
+
+	_Texture.RemoveFromLastAssignedSlots();
+	ms_pCB_MipGenerator->m.bSRGB = _bSRGB;
+
+	for ( int ArrayIndex=0; ArrayIndex < _Texture.GetArraySize(); ArrayIndex++ )
+	{
+		int	SourceWidth = _Texture.GetWidth();
+		int	SourceHeight = _Texture.GetHeight();
+		for ( int MipLevelIndex=1; MipLevelIndex < _Texture.GetMipLevelsCount(); MipLevelIndex++ )
+		{
+			int	TargetWidth = SourceWidth;
+			int	TargetHeight = SourceHeight;
+			Texture2D::NextMipSize( TargetWidth, TargetHeight );
+
+			ms_pCB_MipGenerator->m.SourceSizeX = SourceWidth;
+			ms_pCB_MipGenerator->m.SourceSizeY = SourceHeight;
+			ms_pCB_MipGenerator->m.TargetSizeX = TargetWidth;
+			ms_pCB_MipGenerator->m.TargetSizeY = TargetHeight;
+			ms_pCB_MipGenerator->UpdateData();
+
+			_Texture.SetCS( 10, true, _Texture.GetSRV( MipLevelIndex-1, 1, ArrayIndex, 1, true ) );
+			_Texture.SetCSUAV( 0, _Texture.GetUAV( MipLevelIndex, ArrayIndex, 1 ) );
+
+			Kernel.Dispatch( (TargetWidth+THREADS_X-1) / THREADS_X, (TargetHeight+THREADS_Y-1) / THREADS_Y, 1 );
+
+			// Unbind before the written mip becomes the next source
+			gs_Device.RemoveShaderResources( 10, 1, Device::SSF_COMPUTE_SHADER );
+			_Texture.RemoveFromLastAssignedSlotUAV();
+
+			SourceWidth = TargetWidth;
+			SourceHeight = TargetHeight;
+		}
+	}
+
+	return true;
+}
+
+void	MipGenerator::ReleaseKernels()
+{
+	for ( int KernelIndex=0; KernelIndex < FILTERS_COUNT; KernelIndex++ )
+	{
+		delete ms_ppKernels[KernelIndex];
+		ms_ppKernels[KernelIndex] = NULL;
+	}
+
+	delete ms_pCB_MipGenerator;
+	ms_pCB_MipGenerator = NULL;
+}
+
+bool	MipGenerator::CreateKernels()
+{
+	// Create the kernels the first time they're needed
+	for ( int KernelIndex=0; KernelIndex < FILTERS_COUNT; KernelIndex++ )
+		if ( ms_ppKernels[KernelIndex] == NULL )
+			ms_ppKernels[KernelIndex] = CreateComputeShader( IDR_SHADER_MIP_GENERATOR, "./Resources/Shaders/MipGenerator.hlsl", gs_ppKernelEntryPoints[KernelIndex] );
+	if ( ms_pCB_MipGenerator == NULL )
+	{
+		ms_pCB_MipGenerator = new CB<CBMipGenerator>( gs_Device, 10 );
+		memset( &ms_pCB_MipGenerator->m, 0, sizeof(CBMipGenerator) );
+	}
+
+	for ( int KernelIndex=0; KernelIndex < FILTERS_COUNT; KernelIndex++ )
+		if ( ms_ppKernels[KernelIndex]->HasErrors() )
+			return false;
+
+	return true;
+}
@@ -0,0 +1,59 @@
+//////////////////////////////////////////////////////////////////////////
+// Rebuilds the mip chain of a texture from its mip 0 (cf. MipGenerator.hlsl)
+// Render targets whose format supports it are downsampled by the hardware (cf. Texture2D::GenerateMips()), the others
+//	(typically float or integer formats created as UAVs) are downsampled by a compute kernel, one dispatch per mip.
+// The compute kernels can also use a Kaiser filter instead of the box and filter sRGB-encoded texels in linear space.
+//
+// Usage:
+//	pTexture = new Texture2D( gs_Device, W, H, 1, PixelFormatRGBA16F::DESCRIPTOR, 0, NULL, false, true );	// All the mips, as a UAV
+//	(render into the mip 0)
+//	MipGenerator::Generate( *pTexture );
+//
+// NOTE: Single-slice textures and arrays are supported, each slice is downsampled separately.
+//	The compute shader slot t10, u0 & b10 are overwritten.
+//
+#pragma once
+
+template<typename> class CB;
+
+class	MipGenerator
+{
+public:		// NESTED TYPES
+
+	enum FILTER
+	{
+		FILTER_BOX,			// 2x2 average (3x3 weighted by coverage on odd sizes)
+		FILTER_KAISER,		// 4x4 Kaiser-windowed sinc, always done by the compute kernel
+
+		FILTERS_COUNT
+	};
+
+protected:
+
+	// WARNING: must match the cbMipGenerator constant buffer in MipGenerator.hlsl!
+	struct	CBMipGenerator
+	{
+		U32		SourceSizeX, SourceSizeY;
+		U32		TargetSizeX, TargetSizeY;
+		U32		bSRGB;
+		U32		__PAD[3];
+	};
+
+	static ComputeShader*		ms_ppKernels[FILTERS_COUNT];
+	static CB<CBMipGenerator>*	ms_pCB_MipGenerator;
+
+public:		// METHODS
+
+	// Generates the mips 1 to N of the texture from its mip 0
+	// The box filter of linear textures uses the hardware when possible, otherwise the texture must have been created as a UAV
+	// _bSRGB, true if the texels are sRGB-encoded in a linear format (sRGB formats can't be UAVs so they're limited to the hardware box filter)
+	// Returns false if the kernels failed to compile
+	static bool		Generate( Texture2D& _Texture, FILTER _Filter=FILTER_BOX, bool _bSRGB=false );
+
+	// Releases the kernels, that are created the first time a texture needs them
+	static void		ReleaseKernels();
+
+protected:
+
+	static bool		CreateKernels();
+};
@@ -0,0 +1,122 @@
+#include "../GodComplex.h"
+
+MultiView::MultiView( Device& _Device )
+	: m_Device( _Device )
+	, m_pViewVisible( NULL )
+	, m_ViewVisibleSize( 0 )
+{
+	m_pCB = new CB<CBMultiView>( m_Device, CB_SLOT, true );
+	m_pCB_Object = new CB<CBMultiViewObject>( m_Device, CB_OBJECT_SLOT, true );
+	m_pCB_Object->SetTransient( true );	// Updated for every object
+
+	m_pCB->m.ViewsCount = 0;
+	for ( int ViewIndex=0; ViewIndex < MAX_VIEWS; ViewIndex++ )
+		m_pCB->m.Camera2World[ViewIndex] = m_pCB->m.World2Proj[ViewIndex] = float4x4::Identity;
+	m_pCB_Object->m.ViewMask = 0;
+}
+MultiView::~MultiView()
+{
+	delete[] m_pViewVisible;
+	delete m_pCB_Object;
+	delete m_pCB;
+}
+
+void	MultiView::SetViewsCount( int _ViewsCount )
+{
+	ASSERT( _ViewsCount > 0 && _ViewsCount <= MAX_VIEWS, "Invalid amount of views!" );
+	m_pCB->m.ViewsCount = _ViewsCount;
+}
+
+void	MultiView::SetView( int _ViewIndex, const float4x4& _Camera2World, const float4x4& _Camera2Proj )
+{
+	ASSERT( _ViewIndex >= 0 && _ViewIndex < MAX_VIEWS, "View index out of range!" );
+	m_pCB->m.Camera2World[_ViewIndex] = _Camera2World;
+	m_pCB->m.World2Proj[_ViewIndex] = _Camera2World.Inverse() * _Camera2Proj;
+}
+
+void	MultiView::SetCubeMap( const float3& _Position, float _Near, float _Far )
+{
+	// Remember the +Z face is not oriented the same way as our Z vector: http://msdn.microsoft.com/en-us/library/windows/desktop/bb204881(v=vs.85).aspx
+	static const float3	SideAt[6] =
+	{
+		float3(  1, 0, 0 ),
+		float3( -1, 0, 0 ),
+		float3( 0,  1, 0 ),
+		float3( 0, -1, 0 ),
+		float3( 0, 0,  1 ),
+		float3( 0, 0, -1 ),
+	};
+	static const float3	SideRight[6] =
+	{
+		float3( 0, 0, -1 ),
+		float3( 0, 0,  1 ),
+		float3(  1, 0, 0 ),
+		float3(  1, 0, 0 ),
+		float3(  1, 0, 0 ),
+		float3( -1, 0, 0 ),
+	};
+
+	float4x4	Camera2Proj = float4x4::ProjectionPerspective( 0.5f * PI, 1.0f, _Near, _Far );
+	for ( int CubeFaceIndex=0; CubeFaceIndex < 6; CubeFaceIndex++ )
+	{
+		float4x4	Camera2World;
+		Camera2World.SetRow( 0, SideRight[CubeFaceIndex], 0 );
+		Camera2World.SetRow( 1, SideAt[CubeFaceIndex] ^ SideRight[CubeFaceIndex], 0 );
+		Camera2World.SetRow( 2, SideAt[CubeFaceIndex], 0 );
+		Camera2World.SetRow( 3, _Position, 1 );
+
+		SetView( CubeFaceIndex, Camera2World, Camera2Proj );
+	}
+
+	SetViewsCount( 6 );
+}
+
+void	MultiView::Set()
+{
+	ASSERT( m_pCB->m.ViewsCount > 0, "No view to render!" );
+	m_pCB->UpdateData();
+}
+
+U32	MultiView::Cull( const BoundsCuller& _Culler, U8* _pViewMasks )
+{
+	U32	BoundsCount = _Culler.GetBoundsCount();
+	if ( BoundsCount > m_ViewVisibleSize )
+	{
+		delete[] m_pViewVisible;
+		m_ViewVisibleSize = BoundsCount;
+		m_pViewVisible = new U8[m_ViewVisibleSize];
+	}
+
+	memset( _pViewMasks, 0, BoundsCount );
+	for ( U32 ViewIndex=0; ViewIndex < m_pCB->m.ViewsCount; ViewIndex++ )
+	{
+		if ( _Culler.Cull( m_pCB->m.World2Proj[ViewIndex], m_pViewVisible ) == 0 )
+			continue;
+
+		U8	ViewBit = U8( 1 << ViewIndex );
+		for ( U32 BoundsIndex=0; BoundsIndex < BoundsCount; BoundsIndex++ )
+			if ( m_pViewVisible[BoundsIndex] )
+				_pViewMasks[BoundsIndex] |= ViewBit;
+	}
+
+	U32	VisibleCount = 0;
+	for ( U32 BoundsIndex=0; BoundsIndex < BoundsCount; BoundsIndex++ )
+		if ( _pViewMasks[BoundsIndex] )
+			VisibleCount++;
+
+	return VisibleCount;
+}
+
+void	MultiView::SetObjectMask( U32 _ViewMask )
+{
+	m_pCB_Object->m.ViewMask = _ViewMask;
+	m_pCB_Object->UpdateData();
+}
+
+int		MultiView::GetInstancesCount( U32 _ViewMask )
+{
+	int	Count = 0;
+	for ( ; _ViewMask != 0; _ViewMask &= _ViewMask-1 )
+		Count++;
+	return Count;
+}
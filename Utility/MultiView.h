@@ -0,0 +1,84 @@
+//////////////////////////////////////////////////////////////////////////
+// Multi-view rendering
+// Renders up to MAX_VIEWS views (e.g. the 6 faces of a cube map or the 2 eyes of a stereo pair) with a single traversal of the scene:
+//	the objects are culled against all the views at once and each object visible in at least one view is drawn a single time,
+//	instanced once per view seeing it. The shader routes each instance to its view's slice of the render target array with
+//	SV_RenderTargetArrayIndex (cf. Inc/MultiView.hlsl) so the culling, the sort keys & the state changes are shared by all the views.
+//
+// Usage:
+//	MultiView	Views( gs_Device );
+//	Views.SetCubeMap( Position, 0.01f, 1000.0f );
+//	Views.Set();
+//	Device.SetRenderTargets( Size, Size, 1, &pRTVOfThe6Slices, pDSVOfThe6Slices );
+//	Views.Cull( MeshesCuller, pViewMasks );
+//	for each mesh with pViewMasks[MeshIndex] != 0
+//		Views.SetObjectMask( pViewMasks[MeshIndex] );
+//		Primitive.RenderInstanced( Material, MultiView::GetInstancesCount( pViewMasks[MeshIndex] ), ... );
+//
+// NOTE: Each view renders into the slice of the same index in the bound render targets & depth stencil arrays.
+//
+#pragma once
+
+class	MultiView
+{
+public:		// CONSTANTS
+
+	static const int	MAX_VIEWS = 6;
+	static const int	CB_SLOT = 8;				// !!IMPORTANT ==> Must correspond to cbMultiView in Inc/MultiView.hlsl!!
+	static const int	CB_OBJECT_SLOT = 6;			// !!IMPORTANT ==> Must correspond to cbMultiViewObject in Inc/MultiView.hlsl!!
+
+public:		// NESTED TYPES
+
+	struct	CBMultiView
+	{
+		float4x4	Camera2World[MAX_VIEWS];
+		float4x4	World2Proj[MAX_VIEWS];
+		U32			ViewsCount;
+		float3		__PAD;
+	};
+
+	struct	CBMultiViewObject
+	{
+		U32			ViewMask;					// Bit of each view the object is drawn into
+		float3		__PAD;
+	};
+
+private:	// FIELDS
+
+	Device&					m_Device;
+	CB<CBMultiView>*		m_pCB;
+	CB<CBMultiViewObject>*	m_pCB_Object;
+
+	U8*						m_pViewVisible;		// Visibility of the boxes in a single view (cf. Cull())
+	U32						m_ViewVisibleSize;
+
+public:		// PROPERTIES
+
+	int					GetViewsCount() const					{ return m_pCB->m.ViewsCount; }
+	const float4x4&		GetWorld2Proj( int _ViewIndex ) const	{ return m_pCB->m.World2Proj[_ViewIndex]; }
+	const float4x4&		GetCamera2World( int _ViewIndex ) const	{ return m_pCB->m.Camera2World[_ViewIndex]; }
+
+public:		// METHODS
+
+	MultiView( Device& _Device );
+	~MultiView();
+
+	void		SetViewsCount( int _ViewsCount );
+	void		SetView( int _ViewIndex, const float4x4& _Camera2World, const float4x4& _Camera2Proj );
+
+	// Sets the 6 views of a cube map centered on _Position, in the order of the D3D cube faces (+X, -X, +Y, -Y, +Z, -Z)
+	void		SetCubeMap( const float3& _Position, float _Near, float _Far );
+
+	// Uploads the views to the shaders
+	void		Set();
+
+	// Culls the boxes against all the views: _pViewMasks receives, for each box, the bit of each view seeing it (0 if culled by all the views)
+	// Returns the amount of boxes visible in at least one view
+	U32			Cull( const BoundsCuller& _Culler, U8* _pViewMasks );
+
+	// Tells the shaders which views the next draw calls are instanced for
+	void		SetObjectMask( U32 _ViewMask );
+
+	// Amount of instances to draw for an object (i.e. the amount of views seeing it)
+	static int	GetInstancesCount( U32 _ViewMask );
+};
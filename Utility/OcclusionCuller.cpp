@@ -0,0 +1,286 @@
+#include "../GodComplex.h"
+
+namespace
+{
+	const float	NEAR_W = 1e-4f;		// Vertices with a smaller W are considered behind the near plane
+	const float	DEPTH_BIAS = 1e-6f;	// Keeps an occluder from hiding its own bounds because of rounding errors
+}
+
+OcclusionCuller::OcclusionCuller()
+	: m_pScreenVertices( NULL )
+	, m_ScreenVerticesSize( 0 )
+	, m_bPending( false )
+	, m_bValid( false )
+	, m_RasterizedTrianglesCount( 0 )
+{
+	m_pDepth = (float*) _aligned_malloc( WIDTH * HEIGHT * sizeof(float), 16 );
+	m_Job.m_pOwner = this;
+}
+
+OcclusionCuller::~OcclusionCuller()
+{
+	Wait();
+	Clear();
+	delete[] m_pScreenVertices;
+	_aligned_free( m_pDepth );
+}
+
+int		OcclusionCuller::AddOccluder( const float4x4& _Local2World, U32 _VerticesCount, const void* _pVertices, U32 _VertexStride, U32 _TrianglesCount, const void* _pIndices, bool _b16BitsIndices )
+{
+	ASSERT( !m_bPending, "Can't add occluders while they're being rasterized!" );
+
+	Occluder&	O = m_Occluders.Append();
+	O.VerticesCount = _VerticesCount;
+	O.pVertices = new float3[_VerticesCount];
+	O.TrianglesCount = _TrianglesCount;
+	O.pIndices = new U32[3*_TrianglesCount];
+	O.BBoxMin = float3::MaxFlt;
+	O.BBoxMax = -float3::MaxFlt;
+	O.bEnabled = true;
+
+	const U8*	pVertex = (const U8*) _pVertices;
+	for ( U32 VertexIndex=0; VertexIndex < _VerticesCount; VertexIndex++, pVertex+=_VertexStride )
+	{
+		float3	Position = float4( *((const float3*) pVertex), 1.0f ) * _Local2World;
+		O.pVertices[VertexIndex] = Position;
+		O.BBoxMin = O.BBoxMin.Min( Position );
+		O.BBoxMax = O.BBoxMax.Max( Position );
+	}
+
+	for ( U32 Index=0; Index < 3*_TrianglesCount; Index++ )
+		O.pIndices[Index] = _b16BitsIndices ? U32( ((const U16*) _pIndices)[Index] ) : ((const U32*) _pIndices)[Index];
+
+	m_ScreenVerticesSize = MAX( m_ScreenVerticesSize, _VerticesCount );
+
+	return m_Occluders.GetCount()-1;
+}
+
+void	OcclusionCuller::Clear()
+{
+	ASSERT( !m_bPending, "Can't clear the occluders while they're being rasterized!" );
+
+	for ( int OccluderIndex=0; OccluderIndex < m_Occluders.GetCount(); OccluderIndex++ )
+	{
+		delete[] m_Occluders[OccluderIndex].pIndices;
+		delete[] m_Occluders[OccluderIndex].pVertices;
+	}
+	m_Occluders.Clear();
+	m_bValid = false;
+}
+
+void	OcclusionCuller::Begin( const float4x4& _World2Proj )
+{
+	Wait();	// Still rasterizing the previous frame
+
+	m_World2Proj = _World2Proj;
+	m_bPending = true;
+	gs_Jobs.Run( m_Job, m_Counter );
+}
+
+void	OcclusionCuller::Wait()
+{
+	if ( !m_bPending )
+		return;
+
+	gs_Jobs.Wait( m_Counter );
+	m_bPending = false;
+	m_bValid = true;
+}
+
+bool	OcclusionCuller::IsVisible( const float3& _BBoxMin, const float3& _BBoxMax ) const
+{
+	ASSERT( !m_bPending, "Wait() for the rasterization before testing boxes!" );
+	if ( !m_bValid )
+		return true;
+
+	float2	ScreenMin, ScreenMax;
+	float	MinDepth;
+	if ( !ProjectBox( _BBoxMin, _BBoxMax, ScreenMin, ScreenMax, MinDepth ) )
+		return true;	// Crosses the near plane
+
+	int		X0 = MAX( 0, int( floorf( ScreenMin.x ) ) );
+	int		Y0 = MAX( 0, int( floorf( ScreenMin.y ) ) );
+	int		X1 = MIN( WIDTH-1, int( floorf( ScreenMax.x ) ) );
+	int		Y1 = MIN( HEIGHT-1, int( floorf( ScreenMax.y ) ) );
+	if ( X0 > X1 || Y0 > Y1 )
+		return false;	// Off screen
+
+	// The box is hidden if all the occluders' pixels it overlaps are closer than its nearest point
+	MinDepth -= DEPTH_BIAS;
+	__m128	BoxDepth = _mm_set1_ps( MinDepth );
+	for ( int TileY=Y0 / TILE_SIZE; TileY <= Y1 / TILE_SIZE; TileY++ )
+		for ( int TileX=X0 / TILE_SIZE; TileX <= X1 / TILE_SIZE; TileX++ )
+		{
+			if ( m_pTilesMaxDepth[TILES_X*TileY+TileX] < MinDepth )
+				continue;	// The whole tile is in front of the box
+
+			int	TileX0 = MAX( X0, TileX * TILE_SIZE );
+			int	TileX1 = MIN( X1, TileX * TILE_SIZE + TILE_SIZE-1 );
+			int	TileY0 = MAX( Y0, TileY * TILE_SIZE );
+			int	TileY1 = MIN( Y1, TileY * TILE_SIZE + TILE_SIZE-1 );
+			for ( int Y=TileY0; Y <= TileY1; Y++ )
+			{
+				const float*	pScanline = m_pDepth + WIDTH * Y;
+				for ( int X=TileX0 & ~3; X <= TileX1; X+=4 )
+				{
+					int	Mask = _mm_movemask_ps( _mm_cmpge_ps( _mm_load_ps( pScanline + X ), BoxDepth ) );
+					Mask &= (0xF << MAX( 0, TileX0 - X )) & (0xF >> MAX( 0, X + 3 - TileX1 ));	// Only the pixels of the rectangle
+					if ( Mask != 0 )
+						return true;
+				}
+			}
+		}
+
+	return false;
+}
+
+void	OcclusionCuller::Rasterize()
+{
+	__m128	Far = _mm_set1_ps( 1.0f );
+	for ( int Index=0; Index < WIDTH * HEIGHT; Index+=4 )
+		_mm_store_ps( m_pDepth + Index, Far );
+
+	if ( m_ScreenVerticesSize > 0 && m_pScreenVertices == NULL )
+		m_pScreenVertices = new float4[m_ScreenVerticesSize];
+
+	m_RasterizedTrianglesCount = 0;
+	for ( int OccluderIndex=0; OccluderIndex < m_Occluders.GetCount(); OccluderIndex++ )
+	{
+		const Occluder&	O = m_Occluders[OccluderIndex];
+		if ( !O.bEnabled )
+			continue;
+
+		float2	ScreenMin, ScreenMax;
+		float	MinDepth;
+		if ( ProjectBox( O.BBoxMin, O.BBoxMax, ScreenMin, ScreenMax, MinDepth ) && (ScreenMax.x < 0.0f || ScreenMax.y < 0.0f || ScreenMin.x > WIDTH || ScreenMin.y > HEIGHT || MinDepth > 1.0f) )
+			continue;	// Off screen
+
+		for ( U32 VertexIndex=0; VertexIndex < O.VerticesCount; VertexIndex++ )
+			m_pScreenVertices[VertexIndex] = Project( O.pVertices[VertexIndex] );
+
+		const U32*	pIndices = O.pIndices;
+		for ( U32 TriangleIndex=0; TriangleIndex < O.TrianglesCount; TriangleIndex++, pIndices+=3 )
+		{
+			const float4&	V0 = m_pScreenVertices[pIndices[0]];
+			const float4&	V1 = m_pScreenVertices[pIndices[1]];
+			const float4&	V2 = m_pScreenVertices[pIndices[2]];
+			if ( V0.w == 0.0f || V1.w == 0.0f || V2.w == 0.0f )
+				continue;	// Crosses the near plane
+
+			RasterizeTriangle( V0, V1, V2 );
+		}
+	}
+
+	UpdateTilesMaxDepth();
+}
+
+void	OcclusionCuller::RasterizeTriangle( const float4& _V0, const float4& _V1, const float4& _V2 )
+{
+	float	Area = (_V1.x - _V0.x) * (_V2.y - _V0.y) - (_V1.y - _V0.y) * (_V2.x - _V0.x);
+	if ( fabs( Area ) < 1e-6f )
+		return;	// Degenerate
+
+	// Both sides are rasterized so make the triangle counter-clockwise
+	const float4&	V0 = _V0;
+	const float4&	V1 = Area > 0.0f ? _V1 : _V2;
+	const float4&	V2 = Area > 0.0f ? _V2 : _V1;
+	Area = fabs( Area );
+
+	int	X0 = MAX( 0, int( floorf( MIN( V0.x, MIN( V1.x, V2.x ) ) ) ) );
+	int	Y0 = MAX( 0, int( floorf( MIN( V0.y, MIN( V1.y, V2.y ) ) ) ) );
+	int	X1 = MIN( WIDTH-1, int( floorf( MAX( V0.x, MAX( V1.x, V2.x ) ) ) ) );
+	int	Y1 = MIN( HEIGHT-1, int( floorf( MAX( V0.y, MAX( V1.y, V2.y ) ) ) ) );
+	if ( X0 > X1 || Y0 > Y1 )
+		return;	// Off screen
+
+	m_RasterizedTrianglesCount++;
+
+	// Edge functions E_ab(P) = (b-a) x (P-a) = A.Px + B.Py + C, positive inside
+	float	A01 = V0.y - V1.y,	B01 = V1.x - V0.x,	C01 = V0.x * V1.y - V0.y * V1.x;
+	float	A12 = V1.y - V2.y,	B12 = V2.x - V1.x,	C12 = V1.x * V2.y - V1.y * V2.x;
+	float	A20 = V2.y - V0.y,	B20 = V0.x - V2.x,	C20 = V2.x * V0.y - V2.y * V0.x;
+
+	// Depth plane: Z = Z0 + (E20 * (Z1-Z0) + E01 * (Z2-Z0)) / Area
+	float	InvArea = 1.0f / Area;
+	float	DZ1 = (V1.z - V0.z) * InvArea;
+	float	DZ2 = (V2.z - V0.z) * InvArea;
+	float	AZ = A20 * DZ1 + A01 * DZ2;
+	float	BZ = B20 * DZ1 + B01 * DZ2;
+	float	CZ = V0.z + C20 * DZ1 + C01 * DZ2;
+
+	__m128	PixelOffsets = _mm_set_ps( 3.5f, 2.5f, 1.5f, 0.5f );
+	__m128	Zero = _mm_setzero_ps();
+	for ( int Y=Y0; Y <= Y1; Y++ )
+	{
+		float	PY = Y + 0.5f;
+		__m128	RowE01 = _mm_set1_ps( B01 * PY + C01 );
+		__m128	RowE12 = _mm_set1_ps( B12 * PY + C12 );
+		__m128	RowE20 = _mm_set1_ps( B20 * PY + C20 );
+		__m128	RowZ = _mm_set1_ps( BZ * PY + CZ );
+
+		float*	pScanline = m_pDepth + WIDTH * Y;
+		for ( int X=X0 & ~3; X <= X1; X+=4 )
+		{
+			__m128	PX = _mm_add_ps( _mm_set1_ps( float(X) ), PixelOffsets );
+			__m128	E01 = _mm_add_ps( _mm_mul_ps( _mm_set1_ps( A01 ), PX ), RowE01 );
+			__m128	E12 = _mm_add_ps( _mm_mul_ps( _mm_set1_ps( A12 ), PX ), RowE12 );
+			__m128	E20 = _mm_add_ps( _mm_mul_ps( _mm_set1_ps( A20 ), PX ), RowE20 );
+			__m128	Inside = _mm_and_ps( _mm_and_ps( _mm_cmpge_ps( E01, Zero ), _mm_cmpge_ps( E12, Zero ) ), _mm_cmpge_ps( E20, Zero ) );
+			if ( _mm_movemask_ps( Inside ) == 0 )
+				continue;
+
+			__m128	Z = _mm_add_ps( _mm_mul_ps( _mm_set1_ps( AZ ), PX ), RowZ );
+			__m128	Depth = _mm_load_ps( pScanline + X );
+			__m128	NewDepth = _mm_min_ps( Depth, Z );
+			_mm_store_ps( pScanline + X, _mm_or_ps( _mm_and_ps( Inside, NewDepth ), _mm_andnot_ps( Inside, Depth ) ) );
+		}
+	}
+}
+
+void	OcclusionCuller::UpdateTilesMaxDepth()
+{
+	for ( int TileY=0; TileY < TILES_Y; TileY++ )
+		for ( int TileX=0; TileX < TILES_X; TileX++ )
+		{
+			__m128	MaxDepth = _mm_setzero_ps();
+			for ( int Y=0; Y < TILE_SIZE; Y++ )
+			{
+				const float*	pScanline = m_pDepth + WIDTH * (TILE_SIZE * TileY + Y) + TILE_SIZE * TileX;
+				for ( int X=0; X < TILE_SIZE; X+=4 )
+					MaxDepth = _mm_max_ps( MaxDepth, _mm_load_ps( pScanline + X ) );
+			}
+			MaxDepth = _mm_max_ps( MaxDepth, _mm_movehl_ps( MaxDepth, MaxDepth ) );
+			MaxDepth = _mm_max_ss( MaxDepth, _mm_shuffle_ps( MaxDepth, MaxDepth, _MM_SHUFFLE( 1, 1, 1, 1 ) ) );
+			_mm_store_ss( &m_pTilesMaxDepth[TILES_X*TileY+TileX], MaxDepth );
+		}
+}
+
+bool	OcclusionCuller::ProjectBox( const float3& _BBoxMin, const float3& _BBoxMax, float2& _ScreenMin, float2& _ScreenMax, float& _MinDepth ) const
+{
+	_ScreenMin.Set( MAX_FLOAT, MAX_FLOAT );
+	_ScreenMax.Set( -MAX_FLOAT, -MAX_FLOAT );
+	_MinDepth = MAX_FLOAT;
+	for ( int CornerIndex=0; CornerIndex < 8; CornerIndex++ )
+	{
+		float3	Corner( (CornerIndex & 1) ? _BBoxMax.x : _BBoxMin.x, (CornerIndex & 2) ? _BBoxMax.y : _BBoxMin.y, (CornerIndex & 4) ? _BBoxMax.z : _BBoxMin.z );
+		float4	Screen = Project( Corner );
+		if ( Screen.w == 0.0f )
+			return false;
+
+		_ScreenMin.Set( MIN( _ScreenMin.x, Screen.x ), MIN( _ScreenMin.y, Screen.y ) );
+		_ScreenMax.Set( MAX( _ScreenMax.x, Screen.x ), MAX( _ScreenMax.y, Screen.y ) );
+		_MinDepth = MIN( _MinDepth, Screen.z );
+	}
+
+	return true;
+}
+
+float4	OcclusionCuller::Project( const float3& _Position ) const
+{
+	float4	Clip = float4( _Position, 1.0f ) * m_World2Proj;
+	if ( Clip.w < NEAR_W || Clip.z < 0.0f )
+		return float4::Zero;	// Behind the near plane
+
+	float	InvW = 1.0f / Clip.w;
+	return float4( (0.5f + 0.5f * Clip.x * InvW) * WIDTH, (0.5f - 0.5f * Clip.y * InvW) * HEIGHT, Clip.z * InvW, 1.0f );
+}
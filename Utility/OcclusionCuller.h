@@ -0,0 +1,123 @@
+//////////////////////////////////////////////////////////////////////////
+// CPU occlusion culling with a low resolution software depth buffer
+//
+// A set of occluders (e.g. the walls of the rooms) is rasterized by a job into a WIDTH x HEIGHT depth buffer while the frame
+//	goes on, then the bounds of the meshes are tested against it before they're submitted so the meshes hidden behind the
+//	occluders are neither drawn nor shaded.
+//	_ Occluders are given once in world space (i.e. static geometry), each can be enabled or disabled before a frame
+//		(e.g. when its chunk is streamed out)
+//	_ Triangles are rasterized 4 pixels at a time with SSE, their edge functions & depth being interpolated at pixel centers.
+//		Both sides are rasterized and the triangles crossing the near plane are skipped, which only loses occlusion
+//	_ A box is tested at its nearest depth against the pixels its screen rectangle overlaps, the max depth of each tile of
+//		TILE_SIZE x TILE_SIZE pixels rejects most of them at once
+//
+// Usage:
+//	OcclusionCuller	Culler;
+//	Culler.AddOccluder( Mesh2World, VerticesCount, pVertices, sizeof(Vertex), TrianglesCount, pIndices, true );
+//	(...)
+//	Culler.Begin( World2Proj );			// At the start of the frame, the rasterization runs on the workers meanwhile
+//	(...)								// Render the shadow maps, etc.
+//	Culler.Wait();						// Before the scene pass
+//	if ( Culler.IsVisible( BBoxMin, BBoxMax ) )
+//		Render( Mesh );
+//
+// NOTE: Depths are D3D clip space Z/W (0 at the near plane, 1 at the far plane), the depth buffer is cleared to 1.
+// An occluder must be opaque and closed enough: anything behind its pixels is considered hidden.
+//
+#pragma once
+
+#include <xmmintrin.h>
+#include "Jobs.h"
+
+class	OcclusionCuller
+{
+public:		// CONSTANTS
+
+	static const int	WIDTH = 256;
+	static const int	HEIGHT = 128;
+	static const int	TILE_SIZE = 8;
+	static const int	TILES_X = WIDTH / TILE_SIZE;
+	static const int	TILES_Y = HEIGHT / TILE_SIZE;
+
+protected:	// NESTED TYPES
+
+	struct	Occluder
+	{
+		float3*		pVertices;		// World positions
+		U32			VerticesCount;
+		U32*		pIndices;		// 3 per triangle
+		U32			TrianglesCount;
+		float3		BBoxMin;
+		float3		BBoxMax;
+		bool		bEnabled;
+	};
+
+	class	RasterizeJob : public IJob
+	{
+	public:
+		OcclusionCuller*	m_pOwner;
+
+		virtual void	Run()	{ m_pOwner->Rasterize(); }
+	};
+
+protected:	// FIELDS
+
+	List<Occluder>	m_Occluders;
+
+	float*			m_pDepth;				// WIDTH x HEIGHT, 16 bytes aligned
+	float			m_pTilesMaxDepth[TILES_X*TILES_Y];
+	float4*			m_pScreenVertices;		// Projected vertices of the occluder being rasterized (W is 0 if the vertex is behind the near plane)
+	U32				m_ScreenVerticesSize;
+
+	float4x4		m_World2Proj;
+	RasterizeJob	m_Job;
+	JobCounter		m_Counter;
+	bool			m_bPending;				// The rasterization was started but not waited for yet
+	bool			m_bValid;				// The depth buffer was rasterized and can be tested
+
+	U32				m_RasterizedTrianglesCount;
+
+public:		// PROPERTIES
+
+	int				GetOccludersCount() const				{ return m_Occluders.GetCount(); }
+	void			SetOccluderEnabled( int _OccluderIndex, bool _bEnabled )	{ m_Occluders[_OccluderIndex].bEnabled = _bEnabled; }
+
+	// Triangles of the last rasterization that reached the screen
+	U32				GetRasterizedTrianglesCount() const		{ return m_RasterizedTrianglesCount; }
+
+	// The depth buffer, only valid after Wait()
+	const float*	GetDepth() const						{ return m_pDepth; }
+
+public:		// METHODS
+
+	OcclusionCuller();
+	~OcclusionCuller();
+
+	// Appends an occluder, its vertices and indices are copied
+	//	_Local2World, the transform of the vertices
+	//	_pVertices, the first vertex position, the positions of the next vertices follow every _VertexStride bytes
+	//	_pIndices, 3 U16 or U32 indices per triangle
+	// Returns the index of the occluder
+	int			AddOccluder( const float4x4& _Local2World, U32 _VerticesCount, const void* _pVertices, U32 _VertexStride, U32 _TrianglesCount, const void* _pIndices, bool _b16BitsIndices );
+	void		Clear();
+
+	// Starts rasterizing the enabled occluders as seen by a World=>Projection transform on the workers
+	void		Begin( const float4x4& _World2Proj );
+
+	// Waits for the rasterization started by Begin()
+	void		Wait();
+
+	// Tells if a world box may be visible past the occluders, always true if nothing was rasterized yet
+	// NOTE: Wait() must have been called since the last Begin()
+	bool		IsVisible( const float3& _BBoxMin, const float3& _BBoxMax ) const;
+
+protected:
+
+	void		Rasterize();
+	void		RasterizeTriangle( const float4& _V0, const float4& _V1, const float4& _V2 );
+	void		UpdateTilesMaxDepth();
+
+	// Projects the 8 corners of a box, returns false if a corner is behind the near plane
+	bool		ProjectBox( const float3& _BBoxMin, const float3& _BBoxMax, float2& _ScreenMin, float2& _ScreenMax, float& _MinDepth ) const;
+	float4		Project( const float3& _Position ) const;
+};
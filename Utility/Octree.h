@@ -62,6 +62,38 @@ public:
 		Node&		GetOrCreateChildNode( U32 _X, U32 _Y, U32 _Z );
 	};
 
+private:
+
+	// The positions of a batch in structure of arrays so they're tested 4 at a time
+	// The arrays are reordered so the positions reaching a node are contiguous, they have 3 extra entries for the last loads
+	struct	BatchPositions
+	{
+		float*	pX;
+		float*	pY;
+		float*	pZ;
+		int*	pIndex;		// Index of the position in the batch
+
+		BatchPositions( int _Count );
+		~BatchPositions();
+		void	Copy( int _Target, const BatchPositions& _Source, int _SourceIndex );
+	};
+
+	// A node still to visit by FetchBatch() with the range of positions that reached it
+	struct	BatchNode
+	{
+		const Node*	pNode;
+		float3		Min;
+		float		Size;
+		int			First;
+		int			Count;
+	};
+
+	struct	BatchMatch
+	{
+		int				PositionIndex;
+		const Content*	pContent;
+	};
+
 private:	// FIELDS
 
 	float3			m_Min;
@@ -102,6 +134,14 @@ public:		// METHODS
 	//	_Result, the list that will be populated with values overlapping the provided position
 	void		Fetch( const float3& _Position, List<T>& _Result ) const;
 
+	// Fetches the values overlapping a batch of positions in a single traversal of the octree
+	//	_pPositions, the _PositionsCount positions to find overlapping values for
+	//	_Result, the list that will be populated with the values of all the positions, grouped by position
+	//	_pOffsets, receives _PositionsCount+1 indices into _Result: the values of position i are in [_pOffsets[i], _pOffsets[i+1])
+	// NOTE: Each node is visited once for all the positions reaching it and its values are tested against 4 positions at a time,
+	//	the values of a position are in the same order as Fetch() appends them
+	void		FetchBatch( const float3* _pPositions, int _PositionsCount, List<T>& _Result, int* _pOffsets ) const;
+
 	// Fetches the value closest to the provided position
 	//	_Distance, the distance to the retrieved value
 	const T*	FetchNearest( const float3& _Position, float& _Distance ) const;
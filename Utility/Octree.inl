@@ -48,6 +48,157 @@ template<typename T> void	Octree<T>::Fetch( const float3& _Position, List<T>& _R
 	m_pROOT->Fetch( _Position, _Result, m_Min, m_Size );
 }
 
+template<typename T> void	Octree<T>::FetchBatch( const float3* _pPositions, int _PositionsCount, List<T>& _Result, int* _pOffsets ) const
+{
+	int	ResultStart = _Result.GetCount();
+	for ( int PositionIndex=0; PositionIndex <= _PositionsCount; PositionIndex++ )
+		_pOffsets[PositionIndex] = 0;
+	if ( _PositionsCount == 0 )
+	{
+		_pOffsets[0] = ResultStart;
+		return;
+	}
+
+	BatchPositions	Positions( _PositionsCount );
+	BatchPositions	Partitioned( _PositionsCount );
+	for ( int PositionIndex=0; PositionIndex < _PositionsCount; PositionIndex++ )
+	{
+		Positions.pX[PositionIndex] = _pPositions[PositionIndex].x;
+		Positions.pY[PositionIndex] = _pPositions[PositionIndex].y;
+		Positions.pZ[PositionIndex] = _pPositions[PositionIndex].z;
+		Positions.pIndex[PositionIndex] = PositionIndex;
+	}
+
+	List<BatchMatch>	Matches( _PositionsCount );
+	List<BatchNode>		Stack( 64 );
+
+	BatchNode&	Root = Stack.Append();
+	Root.pNode = m_pROOT;
+	Root.Min = m_Min;
+	Root.Size = m_Size;
+	Root.First = 0;
+	Root.Count = _PositionsCount;
+
+	while ( Stack.GetCount() > 0 )
+	{
+		BatchNode	Current = Stack[Stack.GetCount()-1];
+		Stack.SetCount( Stack.GetCount()-1 );
+
+		const Node&	CurrentNode = *Current.pNode;
+		int			End = Current.First + Current.Count;
+
+		// Test this node's values against all the positions that reached it
+		int	ContentsCount = CurrentNode.m_Content.GetCount();
+		for ( int ContentIndex=0; ContentIndex < ContentsCount; ContentIndex++ )
+		{
+			const Content&	C = *CurrentNode.m_Content[ContentIndex];
+#ifdef NUAJ_MATH_SSE
+			__m128	CenterX = _mm_set1_ps( C.Position.x );
+			__m128	CenterY = _mm_set1_ps( C.Position.y );
+			__m128	CenterZ = _mm_set1_ps( C.Position.z );
+			__m128	SqRadius = _mm_set1_ps( C.SqRadius );
+			for ( int Index=Current.First; Index < End; Index+=4 )
+			{
+				__m128	DeltaX = _mm_sub_ps( CenterX, _mm_loadu_ps( Positions.pX + Index ) );
+				__m128	DeltaY = _mm_sub_ps( CenterY, _mm_loadu_ps( Positions.pY + Index ) );
+				__m128	DeltaZ = _mm_sub_ps( CenterZ, _mm_loadu_ps( Positions.pZ + Index ) );
+				__m128	SqDistance = _mm_add_ps( _mm_add_ps( _mm_mul_ps( DeltaX, DeltaX ), _mm_mul_ps( DeltaY, DeltaY ) ), _mm_mul_ps( DeltaZ, DeltaZ ) );
+				int		Mask = _mm_movemask_ps( _mm_cmple_ps( SqDistance, SqRadius ) );
+				if ( Mask == 0 )
+					continue;
+
+				int		LanesCount = MIN( 4, End - Index );	// The last lanes may belong to another node
+				for ( int Lane=0; Lane < LanesCount; Lane++ )
+					if ( Mask & (1 << Lane) )
+					{
+						BatchMatch&	Match = Matches.Append();
+						Match.PositionIndex = Positions.pIndex[Index+Lane];
+						Match.pContent = &C;
+					}
+			}
+#else
+			for ( int Index=Current.First; Index < End; Index++ )
+				if ( C.Contains( float3( Positions.pX[Index], Positions.pY[Index], Positions.pZ[Index] ) ) )
+				{
+					BatchMatch&	Match = Matches.Append();
+					Match.PositionIndex = Positions.pIndex[Index];
+					Match.pContent = &C;
+				}
+#endif
+		}
+
+		bool	bHasChildren = false;
+		for ( U32 ChildIndex=0; ChildIndex < 8; ChildIndex++ )
+			bHasChildren |= CurrentNode.m_ppCells[ChildIndex] != NULL;
+		if ( !bHasChildren )
+			continue;
+
+		// Partition the positions between the child nodes
+		float	HalfSize = 0.5f * Current.Size;
+		float3	CellCenter = Current.Min + HalfSize * float3::One;
+
+		int	pChildCounts[8] = { 0 };
+		for ( int Index=Current.First; Index < End; Index++ )
+		{
+			U32	ChildIndex = (Positions.pX[Index] >= CellCenter.x ? 1 : 0) | (Positions.pY[Index] >= CellCenter.y ? 2 : 0) | (Positions.pZ[Index] >= CellCenter.z ? 4 : 0);
+			pChildCounts[ChildIndex]++;
+		}
+
+		int	pChildFirsts[8];
+		int	pChildNexts[8];
+		int	First = Current.First;
+		for ( U32 ChildIndex=0; ChildIndex < 8; ChildIndex++ )
+		{
+			pChildFirsts[ChildIndex] = pChildNexts[ChildIndex] = First;
+			First += pChildCounts[ChildIndex];
+		}
+
+		for ( int Index=Current.First; Index < End; Index++ )
+		{
+			U32	ChildIndex = (Positions.pX[Index] >= CellCenter.x ? 1 : 0) | (Positions.pY[Index] >= CellCenter.y ? 2 : 0) | (Positions.pZ[Index] >= CellCenter.z ? 4 : 0);
+			Partitioned.Copy( pChildNexts[ChildIndex]++, Positions, Index );
+		}
+		for ( int Index=Current.First; Index < End; Index++ )
+			Positions.Copy( Index, Partitioned, Index );
+
+		// Visit the child nodes reached by any position
+		for ( U32 ChildIndex=0; ChildIndex < 8; ChildIndex++ )
+		{
+			const Node*	pChild = CurrentNode.m_ppCells[ChildIndex];
+			if ( pChild == NULL || pChildCounts[ChildIndex] == 0 )
+				continue;
+
+			BatchNode&	Child = Stack.Append();
+			Child.pNode = pChild;
+			Child.Min = float3( (ChildIndex & 1) ? CellCenter.x : Current.Min.x, (ChildIndex & 2) ? CellCenter.y : Current.Min.y, (ChildIndex & 4) ? CellCenter.z : Current.Min.z );
+			Child.Size = HalfSize;
+			Child.First = pChildFirsts[ChildIndex];
+			Child.Count = pChildCounts[ChildIndex];
+		}
+	}
+
+	// Group the matches by position, a position reaches its nodes from the root down so its values keep the order of Fetch()
+	int	MatchesCount = Matches.GetCount();
+	for ( int MatchIndex=0; MatchIndex < MatchesCount; MatchIndex++ )
+		_pOffsets[Matches[MatchIndex].PositionIndex+1]++;
+
+	_pOffsets[0] = ResultStart;
+	for ( int PositionIndex=0; PositionIndex < _PositionsCount; PositionIndex++ )
+		_pOffsets[PositionIndex+1] += _pOffsets[PositionIndex];
+
+	int*	pNexts = Partitioned.pIndex;	// Not needed anymore
+	for ( int PositionIndex=0; PositionIndex < _PositionsCount; PositionIndex++ )
+		pNexts[PositionIndex] = _pOffsets[PositionIndex];
+
+	_Result.Reserve( ResultStart + MatchesCount );
+	_Result.SetCount( ResultStart + MatchesCount );
+	for ( int MatchIndex=0; MatchIndex < MatchesCount; MatchIndex++ )
+	{
+		const BatchMatch&	Match = Matches[MatchIndex];
+		_Result[pNexts[Match.PositionIndex]++] = Match.pContent->Value;
+	}
+}
+
 template<typename T> const T*	Octree<T>::FetchNearest( const float3& _Position, float& _Distance ) const
 {
 	float		SqDistance = MAX_FLOAT;
@@ -125,7 +276,7 @@ template<typename T> void	Octree<T>::Node::Fetch( const float3& _Position, List<
 	int	ContentsCount = m_Content.GetCount();
 	for ( int ContentIndex=0; ContentIndex < ContentsCount; ContentIndex++ )
 	{
-		Content&	C = *m_Content[ContentIndex];
+		const Content&	C = *m_Content[ContentIndex];
 		if ( C.Contains( _Position ) )
 			_Result.Append( C.Value );
 	}
@@ -212,3 +363,32 @@ template<typename T> typename Octree<T>::Node&	Octree<T>::Node::GetOrCreateChild
 
 	return *m_ppCells[ChildIndex];
 }
+
+template<typename T> Octree<T>::BatchPositions::BatchPositions( int _Count )
+{
+	pX = new float[_Count+3];
+	pY = new float[_Count+3];
+	pZ = new float[_Count+3];
+	pIndex = new int[_Count+3];
+	for ( int Index=_Count; Index < _Count+3; Index++ )
+	{
+		pX[Index] = pY[Index] = pZ[Index] = 0.0f;
+		pIndex[Index] = -1;
+	}
+}
+
+template<typename T> Octree<T>::BatchPositions::~BatchPositions()
+{
+	delete[] pX;
+	delete[] pY;
+	delete[] pZ;
+	delete[] pIndex;
+}
+
+template<typename T> void	Octree<T>::BatchPositions::Copy( int _Target, const BatchPositions& _Source, int _SourceIndex )
+{
+	pX[_Target] = _Source.pX[_SourceIndex];
+	pY[_Target] = _Source.pY[_SourceIndex];
+	pZ[_Target] = _Source.pZ[_SourceIndex];
+	pIndex[_Target] = _Source.pIndex[_SourceIndex];
+}
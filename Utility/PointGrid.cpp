@@ -0,0 +1,220 @@
+#include "../GodComplex.h"
+
+namespace
+{
+	// Squared distances from a point to the nearest & farthest points of a box
+	float	MinDistanceSq( const float3& _P, const float3& _BoxMin, const float3& _BoxMax )
+	{
+		float3	D( MAX( 0.0f, MAX( _BoxMin.x - _P.x, _P.x - _BoxMax.x ) ),
+				   MAX( 0.0f, MAX( _BoxMin.y - _P.y, _P.y - _BoxMax.y ) ),
+				   MAX( 0.0f, MAX( _BoxMin.z - _P.z, _P.z - _BoxMax.z ) ) );
+		return D.LengthSq();
+	}
+	float	MaxDistanceSq( const float3& _P, const float3& _BoxMin, const float3& _BoxMax )
+	{
+		float3	D( MAX( abs( _P.x - _BoxMin.x ), abs( _P.x - _BoxMax.x ) ),
+				   MAX( abs( _P.y - _BoxMin.y ), abs( _P.y - _BoxMax.y ) ),
+				   MAX( abs( _P.z - _BoxMin.z ), abs( _P.z - _BoxMax.z ) ) );
+		return D.LengthSq();
+	}
+}
+
+PointGrid::PointGrid()
+	: m_PointsCount( 0 )
+	, m_pPoints( NULL )
+	, m_pCells( NULL )
+{
+	m_pSize[0] = m_pSize[1] = m_pSize[2] = 0;
+}
+
+PointGrid::~PointGrid()
+{
+	Exit();
+}
+
+void	PointGrid::Init( const float3* _pPoints, U32 _PointsCount, const float3& _BoundMin, const float3& _BoundMax )
+{
+	Exit();
+	if ( _PointsCount == 0 )
+		return;
+
+	m_PointsCount = _PointsCount;
+	m_pPoints = new float3[m_PointsCount];
+	memcpy( m_pPoints, _pPoints, m_PointsCount*sizeof(float3) );
+
+	//////////////////////////////////////////////////////////////////////////
+	// Choose cubic cells so there are about CELLS_PER_POINT cells per point (smaller cells have fewer candidates)
+	float3	Min = _BoundMin;
+	float3	Max = _BoundMax;
+	for ( U32 PointIndex=0; PointIndex < m_PointsCount; PointIndex++ )
+	{
+		Min = Min.Min( m_pPoints[PointIndex] );
+		Max = Max.Max( m_pPoints[PointIndex] );
+	}
+
+	float3	Extent = Max - Min;
+	float	MinExtent = MAX( 1e-3f, 1e-3f * Extent.Max() );
+	Extent = Extent.Max( MinExtent * float3::One );
+
+	m_CellSize = powf( Extent.x * Extent.y * Extent.z / (CELLS_PER_POINT * m_PointsCount), 1.0f / 3.0f );
+	m_CellSize = MAX( m_CellSize, Extent.Max() / MAX_CELLS_PER_AXIS );
+	m_InvCellSize = 1.0f / m_CellSize;
+	m_Min = Min;
+
+	m_pSize[0] = CLAMP( U32( ceilf( Extent.x * m_InvCellSize ) ), 1U, U32(MAX_CELLS_PER_AXIS) );
+	m_pSize[1] = CLAMP( U32( ceilf( Extent.y * m_InvCellSize ) ), 1U, U32(MAX_CELLS_PER_AXIS) );
+	m_pSize[2] = CLAMP( U32( ceilf( Extent.z * m_InvCellSize ) ), 1U, U32(MAX_CELLS_PER_AXIS) );
+
+	U32		CellsCount = GetCellsCount();
+	m_pCells = new Cell[CellsCount];
+
+	//////////////////////////////////////////////////////////////////////////
+	// Bucket the points into their cells
+	U32*	pCellPointsStart = new U32[CellsCount+1];
+	U32*	pCellPoints = new U32[m_PointsCount];
+	U32*	pPointCell = new U32[m_PointsCount];
+	memset( pCellPointsStart, 0, (CellsCount+1)*sizeof(U32) );
+	for ( U32 PointIndex=0; PointIndex < m_PointsCount; PointIndex++ )
+	{
+		float3	P = (m_pPoints[PointIndex] - m_Min) * m_InvCellSize;
+		U32		X = MIN( U32( MAX( 0.0f, P.x ) ), m_pSize[0]-1 );
+		U32		Y = MIN( U32( MAX( 0.0f, P.y ) ), m_pSize[1]-1 );
+		U32		Z = MIN( U32( MAX( 0.0f, P.z ) ), m_pSize[2]-1 );
+		pPointCell[PointIndex] = X + m_pSize[0] * (Y + m_pSize[1] * Z);
+		pCellPointsStart[pPointCell[PointIndex]+1]++;
+	}
+	for ( U32 CellIndex=0; CellIndex < CellsCount; CellIndex++ )
+		pCellPointsStart[CellIndex+1] += pCellPointsStart[CellIndex];
+	for ( U32 PointIndex=0; PointIndex < m_PointsCount; PointIndex++ )
+	{
+		U32	CellIndex = pPointCell[PointIndex];
+		pCellPoints[pCellPointsStart[CellIndex]++] = PointIndex;
+	}
+	for ( U32 CellIndex=CellsCount; CellIndex > 0; CellIndex-- )	// Restore the starts we incremented
+		pCellPointsStart[CellIndex] = pCellPointsStart[CellIndex-1];
+	pCellPointsStart[0] = 0;
+
+	//////////////////////////////////////////////////////////////////////////
+	// Find the candidates of each cell
+	// A point is a candidate if its distance to the cell is below the smallest distance from any point to the farthest corner of the cell.
+	// We first grow rings of cells around the cell to find that distance: a ring at distance R can't contain points closer than (R-1) cells.
+	U32		MaxRing = MAX( MAX( m_pSize[0], m_pSize[1] ), m_pSize[2] );
+	m_Candidates.Init( 8 * CellsCount );
+
+	for ( U32 Z=0; Z < m_pSize[2]; Z++ )
+		for ( U32 Y=0; Y < m_pSize[1]; Y++ )
+			for ( U32 X=0; X < m_pSize[0]; X++ )
+			{
+				float3	CellMin = m_Min + m_CellSize * float3( float(X), float(Y), float(Z) );
+				float3	CellMax = CellMin + m_CellSize * float3::One;
+
+				float	BestMaxDistanceSq = MAX_FLOAT;
+				U32		RingsCount = 0;
+				for ( U32 Pass=0; Pass < 2; Pass++ )
+				{
+					if ( Pass == 1 )
+						m_pCells[X + m_pSize[0] * (Y + m_pSize[1] * Z)].CandidatesStart = m_Candidates.GetCount();
+
+					for ( U32 Ring=0; Pass == 0 ? Ring <= MaxRing : Ring < RingsCount; Ring++ )
+					{
+						if ( Pass == 0 )
+						{
+							float	RingMinDistance = Ring > 0 ? (Ring-1) * m_CellSize : 0.0f;
+							if ( RingMinDistance * RingMinDistance > BestMaxDistanceSq )
+								break;	// No point can be a candidate from now on
+							RingsCount = Ring+1;
+						}
+
+						int		X0 = MAX( 0, int(X) - int(Ring) ), X1 = MIN( int(m_pSize[0])-1, int(X) + int(Ring) );
+						int		Y0 = MAX( 0, int(Y) - int(Ring) ), Y1 = MIN( int(m_pSize[1])-1, int(Y) + int(Ring) );
+						int		Z0 = MAX( 0, int(Z) - int(Ring) ), Z1 = MIN( int(m_pSize[2])-1, int(Z) + int(Ring) );
+						for ( int NZ=Z0; NZ <= Z1; NZ++ )
+							for ( int NY=Y0; NY <= Y1; NY++ )
+								for ( int NX=X0; NX <= X1; NX++ )
+								{
+									U32	Chebyshev = MAX( MAX( U32( abs( NX - int(X) ) ), U32( abs( NY - int(Y) ) ) ), U32( abs( NZ - int(Z) ) ) );
+									if ( Chebyshev != Ring )
+										continue;	// Not on that ring
+
+									U32	NeighborCellIndex = NX + m_pSize[0] * (NY + m_pSize[1] * NZ);
+									for ( U32 i=pCellPointsStart[NeighborCellIndex]; i < pCellPointsStart[NeighborCellIndex+1]; i++ )
+									{
+										U32				PointIndex = pCellPoints[i];
+										const float3&	P = m_pPoints[PointIndex];
+										if ( Pass == 0 )
+											BestMaxDistanceSq = MIN( BestMaxDistanceSq, MaxDistanceSq( P, CellMin, CellMax ) );
+										else if ( MinDistanceSq( P, CellMin, CellMax ) <= BestMaxDistanceSq )
+											m_Candidates.Append( PointIndex );
+									}
+								}
+					}
+				}
+
+				Cell&	C = m_pCells[X + m_pSize[0] * (Y + m_pSize[1] * Z)];
+				C.CandidatesCount = m_Candidates.GetCount() - C.CandidatesStart;
+			}
+
+	delete[] pPointCell;
+	delete[] pCellPoints;
+	delete[] pCellPointsStart;
+}
+
+void	PointGrid::Exit()
+{
+	SAFE_DELETE_ARRAY( m_pCells );
+	SAFE_DELETE_ARRAY( m_pPoints );
+	m_PointsCount = 0;
+	m_pSize[0] = m_pSize[1] = m_pSize[2] = 0;
+	m_Candidates.Clear();
+}
+
+U32	PointGrid::FetchNearest( const float3& _Position ) const
+{
+	if ( m_PointsCount == 0 )
+		return ~0U;
+
+	float3	P = (_Position - m_Min) * m_InvCellSize;
+	if (	P.x < 0.0f || P.x >= m_pSize[0]
+		||	P.y < 0.0f || P.y >= m_pSize[1]
+		||	P.z < 0.0f || P.z >= m_pSize[2] )
+		return FetchNearestLinear( _Position );	// Candidates are only valid within their cell
+
+	const Cell&	C = m_pCells[U32(P.x) + m_pSize[0] * (U32(P.y) + m_pSize[1] * U32(P.z))];
+	U32		Result = ~0U;
+	float	BestDistanceSq = MAX_FLOAT;
+	for ( U32 i=0; i < C.CandidatesCount; i++ )
+	{
+		U32		PointIndex = m_Candidates[C.CandidatesStart+i];
+		float	DistanceSq = (m_pPoints[PointIndex] - _Position).LengthSq();
+		if ( DistanceSq < BestDistanceSq )
+		{
+			BestDistanceSq = DistanceSq;
+			Result = PointIndex;
+		}
+	}
+
+	return Result;
+}
+
+void	PointGrid::FetchNearest( const float3* _pPositions, U32 _Count, U32* _pResults ) const
+{
+	for ( U32 i=0; i < _Count; i++ )
+		_pResults[i] = FetchNearest( _pPositions[i] );
+}
+
+U32	PointGrid::FetchNearestLinear( const float3& _Position ) const
+{
+	U32		Result = ~0U;
+	float	BestDistanceSq = MAX_FLOAT;
+	for ( U32 PointIndex=0; PointIndex < m_PointsCount; PointIndex++ )
+	{
+		float	DistanceSq = (m_pPoints[PointIndex] - _Position).LengthSq();
+		if ( DistanceSq < BestDistanceSq )
+		{
+			BestDistanceSq = DistanceSq;
+			Result = PointIndex;
+		}
+	}
+
+	return Result;
+}
@@ -0,0 +1,68 @@
+//////////////////////////////////////////////////////////////////////////
+// Uniform grid helper to find the nearest point among a static set of points
+//
+// Each cell stores the list of points that can be the nearest to ANY position within the cell, so a query is one cell lookup
+//	followed by a handful of distance tests whatever the amount of points (positions outside the grid fall back to a linear search).
+// Cells & candidates are stored in flat arrays that can be mirrored as-is in GPU buffers.
+//
+#pragma once
+
+#include "../NuajAPI/API/List.h"
+
+class	PointGrid
+{
+public:		// NESTED TYPES
+
+	struct	Cell
+	{
+		U32		CandidatesStart;	// Index of the cell's first candidate in the candidates array
+		U32		CandidatesCount;	// Amount of candidates for the cell
+	};
+
+protected:	// CONSTANTS
+
+	static const U32	MAX_CELLS_PER_AXIS = 64;
+	static const U32	CELLS_PER_POINT = 8;		// Yields about 8 candidates per cell
+
+protected:	// FIELDS
+
+	U32			m_PointsCount;
+	float3*		m_pPoints;
+
+	float3		m_Min;
+	float		m_CellSize;
+	float		m_InvCellSize;
+	U32			m_pSize[3];
+	Cell*		m_pCells;				// X varying first then Y then Z
+	List<U32>	m_Candidates;			// Indices of the candidate points of all the cells
+
+public:		// PROPERTIES
+
+	U32			GetPointsCount() const		{ return m_PointsCount; }
+	const float3&	GetMin() const			{ return m_Min; }
+	float		GetCellSize() const			{ return m_CellSize; }
+	U32			GetSize( int _Axis ) const	{ return m_pSize[_Axis]; }
+	U32			GetCellsCount() const		{ return m_pSize[0] * m_pSize[1] * m_pSize[2]; }
+	const Cell*	GetCells() const			{ return m_pCells; }
+	U32			GetCandidatesCount() const	{ return m_Candidates.GetCount(); }
+	const U32*	GetCandidates() const		{ return m_Candidates.GetCount() > 0 ? &m_Candidates[0] : NULL; }
+
+public:		// METHODS
+
+	PointGrid();
+	~PointGrid();
+
+	// Builds the grid for the provided points
+	//	_BoundMin, _BoundMax, the volume where queries are expected (it's automatically extended to contain all the points)
+	void		Init( const float3* _pPoints, U32 _PointsCount, const float3& _BoundMin, const float3& _BoundMax );
+	void		Exit();
+
+	// Returns the index of the point nearest to the provided position, or ~0U if the grid is empty
+	U32			FetchNearest( const float3& _Position ) const;
+
+	// Batched version, writes the index of the nearest point for each of the _Count positions
+	void		FetchNearest( const float3* _pPositions, U32 _Count, U32* _pResults ) const;
+
+private:
+	U32			FetchNearestLinear( const float3& _Position ) const;
+};
@@ -9,6 +9,9 @@
 // Project page:
 // http://www.codeproject.com/Articles/25172/Simple-Random-Number-Generation
 //
+// NOTE: The generator state is global and not thread-safe, code running on several threads must use RandomStream instead
+//	(cf. Utility/RandomStream.h) which is also reproducible whatever the amount of threads.
+//
 #pragma once
 
 #define RAND_DEFAULT_SEED_U	521288629
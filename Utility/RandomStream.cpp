@@ -0,0 +1,148 @@
+#include "../GodComplex.h"
+
+#ifdef NUAJ_MATH_SSE
+#include <emmintrin.h>
+#endif
+
+static const int	BATCH_SIZE = 256;	// Amount of values generated at once on the stack by the batch functions
+
+RandomStream::RandomStream( U32 _Seed, U32 _Stream )
+	: m_Seed( _Seed )
+	, m_Stream( _Stream )
+	, m_Position( 0 )
+	, m_CachedBlock( ~0U )
+{
+}
+
+U32		RandomStream::Next()
+{
+	U32	Block = m_Position >> 1;
+	if ( Block != m_CachedBlock )
+	{
+		Generate( m_Seed, m_Stream, Block, m_pCachedValues[0], m_pCachedValues[1] );
+		m_CachedBlock = Block;
+	}
+
+	return m_pCachedValues[m_Position++ & 1];
+}
+
+// Uses a whole block so the stream's Gauss() matches the stateless Gauss() at the block's index
+float	RandomStream::Gauss()
+{
+	m_Position = (m_Position + 1) & ~1U;
+	U32	V0 = Next();
+	U32	V1 = Next();
+	return BoxMuller( V0, V1 );
+}
+
+// Philox2x32-10: the counter is (index, stream) and the key is the seed
+void	RandomStream::Generate( U32 _Seed, U32 _Stream, U32 _Index, U32& _Value0, U32& _Value1 )
+{
+	U32	C0 = _Index;
+	U32	C1 = _Stream;
+	U32	Key = _Seed;
+	for ( int Round=0; Round < PHILOX_ROUNDS; Round++ )
+	{
+		U64	Product = U64(PHILOX_M) * C0;
+		C0 = U32(Product >> 32) ^ Key ^ C1;
+		C1 = U32(Product);
+		Key += PHILOX_W;
+	}
+
+	_Value0 = C0;
+	_Value1 = C1;
+}
+
+float	RandomStream::Gauss( U32 _Seed, U32 _Index, U32 _Stream )
+{
+	U32	V0, V1;
+	Generate( _Seed, _Stream, _Index, V0, V1 );
+	return BoxMuller( V0, V1 );
+}
+
+float	RandomStream::BoxMuller( U32 _Value0, U32 _Value1 )
+{
+	float	r = sqrtf( -2.0f * logf( ToUniformStrict( _Value0 ) ) );	// ]0,1] so the log is finite
+	float	theta = 2.0f * PI * ToUniform( _Value1 );
+	return r * cosf( theta );
+}
+
+void	RandomStream::GenerateBatch( U32 _Seed, U32 _Stream, U32 _FirstIndex, U32 _Count, U32* _pValues0, U32* _pValues1 )
+{
+	U32	i = 0;
+
+#ifdef NUAJ_MATH_SSE
+	// Same rounds on 4 consecutive indices, SSE2 only has a 32x32->64 multiply for lanes 0 & 2 so odd lanes are shifted down
+	const __m128i	M = _mm_set1_epi32( PHILOX_M );
+	const __m128i	C1Init = _mm_set1_epi32( _Stream );
+	for ( ; i+4 <= _Count; i+=4 )
+	{
+		U32		Index = _FirstIndex + i;
+		__m128i	C0 = _mm_set_epi32( Index+3, Index+2, Index+1, Index );
+		__m128i	C1 = C1Init;
+		U32		Key = _Seed;
+		for ( int Round=0; Round < PHILOX_ROUNDS; Round++ )
+		{
+			__m128i	Product02 = _mm_mul_epu32( C0, M );							// [lo0 hi0 lo2 hi2]
+			__m128i	Product13 = _mm_mul_epu32( _mm_srli_epi64( C0, 32 ), M );	// [lo1 hi1 lo3 hi3]
+			__m128i	Lo = _mm_unpacklo_epi32( _mm_shuffle_epi32( Product02, _MM_SHUFFLE( 0, 0, 2, 0 ) ), _mm_shuffle_epi32( Product13, _MM_SHUFFLE( 0, 0, 2, 0 ) ) );
+			__m128i	Hi = _mm_unpacklo_epi32( _mm_shuffle_epi32( Product02, _MM_SHUFFLE( 0, 0, 3, 1 ) ), _mm_shuffle_epi32( Product13, _MM_SHUFFLE( 0, 0, 3, 1 ) ) );
+
+			C0 = _mm_xor_si128( _mm_xor_si128( Hi, _mm_set1_epi32( Key ) ), C1 );
+			C1 = Lo;
+			Key += PHILOX_W;
+		}
+
+		_mm_storeu_si128( (__m128i*) &_pValues0[i], C0 );
+		if ( _pValues1 != NULL )
+			_mm_storeu_si128( (__m128i*) &_pValues1[i], C1 );
+	}
+#endif
+
+	// Remainder (or everything without SSE)
+	for ( ; i < _Count; i++ )
+	{
+		U32	V1;
+		Generate( _Seed, _Stream, _FirstIndex + i, _pValues0[i], V1 );
+		if ( _pValues1 != NULL )
+			_pValues1[i] = V1;
+	}
+}
+
+void	RandomStream::UniformBatch( U32 _Seed, U32 _Stream, U32 _FirstIndex, U32 _Count, float* _pValues )
+{
+	U32	pValues[BATCH_SIZE];
+	for ( U32 Start=0; Start < _Count; Start+=BATCH_SIZE )
+	{
+		U32	Count = MIN( U32(BATCH_SIZE), _Count - Start );
+		GenerateBatch( _Seed, _Stream, _FirstIndex + Start, Count, pValues, NULL );
+
+		float*	pTarget = _pValues + Start;
+		U32		i = 0;
+#ifdef NUAJ_MATH_SSE
+		const __m128	Scale = _mm_set1_ps( 1.0f / 16777216.0f );
+		for ( ; i+4 <= Count; i+=4 )
+		{
+			__m128i	V = _mm_srli_epi32( _mm_loadu_si128( (const __m128i*) &pValues[i] ), 8 );	// Fits in a signed int so the conversion is exact
+			_mm_storeu_ps( &pTarget[i], _mm_mul_ps( _mm_cvtepi32_ps( V ), Scale ) );
+		}
+#endif
+		for ( ; i < Count; i++ )
+			pTarget[i] = ToUniform( pValues[i] );
+	}
+}
+
+void	RandomStream::GaussBatch( U32 _Seed, U32 _Stream, U32 _FirstIndex, U32 _Count, float* _pValues )
+{
+	U32	pValues0[BATCH_SIZE];
+	U32	pValues1[BATCH_SIZE];
+	for ( U32 Start=0; Start < _Count; Start+=BATCH_SIZE )
+	{
+		U32	Count = MIN( U32(BATCH_SIZE), _Count - Start );
+		GenerateBatch( _Seed, _Stream, _FirstIndex + Start, Count, pValues0, pValues1 );
+
+		// The transcendental part stays scalar so it matches Gauss() exactly
+		for ( U32 i=0; i < Count; i++ )
+			_pValues[Start+i] = BoxMuller( pValues0[i], pValues1[i] );
+	}
+}
@@ -0,0 +1,76 @@
+//////////////////////////////////////////////////////////////////////////
+// Counter-based random generator
+// Unlike the MWC generator of Random.h there is no state to share: a random number is a pure function of (seed, stream, index)
+//	computed with the Philox2x32-10 bijection (Salmon et al. "Parallel Random Numbers: As Easy as 1, 2, 3", SC11).
+// Any number can be evaluated on its own so a builder split across threads gets exactly the same numbers as when it runs
+//	serially, whatever the amount of threads, as long as each item draws from its own (stream, index) range.
+//
+// Usage:
+//	// Stateless, typically indexed by texel or item
+//	float	Value = RandomStream::Uniform( Seed, TexelIndex );
+//
+//	// Sequential draws for code written around _frand(), one stream per item (or per thread if the partition is fixed)
+//	RandomStream	Stream( Seed, ItemIndex );
+//	float	a = Stream.Uniform();
+//	float	b = Stream.Gauss();
+//
+//	// Batches of consecutive indices, 4 at a time with SSE
+//	RandomStream::UniformBatch( Seed, Stream, FirstIndex, Count, pValues );
+//
+// NOTE: The SSE and scalar paths return identical bits so results don't depend on the build either.
+//
+#pragma once
+
+class	RandomStream
+{
+public:		// CONSTANTS
+
+	static const U32	PHILOX_M = 0xD256D193;
+	static const U32	PHILOX_W = 0x9E3779B9;		// Key bump (golden ratio)
+	static const int	PHILOX_ROUNDS = 10;
+
+protected:	// FIELDS
+
+	U32		m_Seed;
+	U32		m_Stream;
+	U32		m_Position;			// Index of the next draw, each Philox block provides 2 draws
+	U32		m_CachedBlock;
+	U32		m_pCachedValues[2];
+
+public:		// PROPERTIES
+
+	U32		GetSeed() const						{ return m_Seed; }
+	U32		GetStream() const					{ return m_Stream; }
+	U32		GetPosition() const					{ return m_Position; }
+	void	SetPosition( U32 _Position )		{ m_Position = _Position; }
+	void	Skip( U32 _DrawsCount )				{ m_Position += _DrawsCount; }
+
+public:		// METHODS
+
+	RandomStream( U32 _Seed, U32 _Stream=0 );
+
+	U32		Next();											// [0,2^32[
+	U32		Next( U32 _Size )							{ return U32( (U64(Next()) * _Size) >> 32 ); }	// [0,size[
+	float	Uniform()									{ return ToUniform( Next() ); }		// [0,1[
+	float	Uniform( float _Min, float _Max )			{ return _Min + (_Max - _Min) * Uniform(); }
+	float	Gauss();										// Mean 0, standard deviation 1 (consumes 2 draws)
+
+	// Stateless generation, each index yields 2 independent 32-bits numbers
+	static void		Generate( U32 _Seed, U32 _Stream, U32 _Index, U32& _Value0, U32& _Value1 );
+	static U32		Hash( U32 _Seed, U32 _Index, U32 _Stream=0 )		{ U32 V0, V1; Generate( _Seed, _Stream, _Index, V0, V1 ); return V0; }
+	static float	Uniform( U32 _Seed, U32 _Index, U32 _Stream=0 )		{ return ToUniform( Hash( _Seed, _Index, _Stream ) ); }
+	static float	Gauss( U32 _Seed, U32 _Index, U32 _Stream=0 );
+
+	// Fills _pValues[i] with Uniform( _Seed, _FirstIndex+i, _Stream ) or Gauss( _Seed, _FirstIndex+i, _Stream )
+	static void		UniformBatch( U32 _Seed, U32 _Stream, U32 _FirstIndex, U32 _Count, float* _pValues );
+	static void		GaussBatch( U32 _Seed, U32 _Stream, U32 _FirstIndex, U32 _Count, float* _pValues );
+
+	// 24 bits of mantissa so the conversion is exact, in [0,1[ or in ]0,1]
+	static float	ToUniform( U32 _Value )						{ return float(_Value >> 8) * (1.0f / 16777216.0f); }
+	static float	ToUniformStrict( U32 _Value )				{ return float((_Value >> 8) + 1) * (1.0f / 16777216.0f); }
+
+protected:
+
+	static float	BoxMuller( U32 _Value0, U32 _Value1 );
+	static void		GenerateBatch( U32 _Seed, U32 _Stream, U32 _FirstIndex, U32 _Count, U32* _pValues0, U32* _pValues1 );
+};
@@ -17,6 +17,21 @@ const U8*	LoadResourceBinary( U16 _ResourceID, const char* _pResourceType, U32*
 	return (U8*) pData;
 }
 
+#if !defined(SURE_DEBUG) && defined(GODCOMPLEX)
+// Shaders are precompiled aggregates that don't need a terminator, they're read straight from the mapped resource
+// The blobs then point into the resource too so shaders are created without copying their binary a single time (cf. Shader::CompileShader())
+
+char*	LoadResourceShader( U16 _ResourceID, U32& _CodeSize )
+{
+	return (char*) LoadResourceBinary( _ResourceID, "SHADER", &_CodeSize );
+}
+
+void	ReleaseResourceShader( char* _pShaderCode )
+{
+}
+
+#else
+
 char*	LoadResourceShader( U16 _ResourceID, U32& _CodeSize )
 {
 	const U8*	pData = LoadResourceBinary( _ResourceID, "SHADER", &_CodeSize );
@@ -31,6 +46,13 @@ char*	LoadResourceShader( U16 _ResourceID, U32& _CodeSize )
 	return pShaderSource;
 }
 
+void	ReleaseResourceShader( char* _pShaderCode )
+{
+	delete[] _pShaderCode;
+}
+
+#endif
+
 //////////////////////////////////////////////////////////////////////////
 // Add new include files to this static array below
 namespace
@@ -47,6 +69,11 @@ namespace
 //
 //////////////////////////////////////////////////////////////////////////
 
+#ifdef _DEBUG
+// The name of the shader currently being compiled is tracked per thread since shaders can be compiled in parallel
+static __declspec(thread) const char*	gs_pCurrentShaderFileName = NULL;
+#endif
+
 static class	IncludesManager : public ID3DInclude
 {
 #ifdef _DEBUG
@@ -54,23 +81,33 @@ public:
 
 	static const int	MAX_DEPENDENCIES = 64;	// A maximum of 64 shaders per include file
 
+	// The content of an include file reloaded from disk after it changed
+	// Previous contents are kept alive until exit since a shader compiling in another thread may still be reading them
+	struct CachedContent
+	{
+		CachedContent*	pPrevious;
+		char*			pData;
+		U32				Size;
+	};
+
 	struct Dependencies 
 	{
 		mutable time_t	LastModificationTime;							// Last time the include file was modified
 		int				Count;											// Amount of dependencies
 		const char**	ppDependencies;									// List of dependencies
+		mutable CachedContent*	pContent;								// The latest content read from disk, NULL while the embedded resource is up to date
 	};
 	Dependencies*						m_pDependencies;				// The list of dependencies for each include file
-	DictionaryString<Shader*>			m_pShaderName2Material;			// A map from shader file to material
-	DictionaryString<ComputeShader*>	m_pShaderName2ComputeShader;	// A map from shader file to material
+	FlatDictionary<const char*, Shader*>		m_pShaderName2Material;			// A map from shader file to material
+	FlatDictionary<const char*, ComputeShader*>	m_pShaderName2ComputeShader;	// A map from shader file to material
 
-	const char*							m_pCurrentShaderFileName;		// The name of the shader currently being compiled
+	mutable CRITICAL_SECTION			m_DependenciesLock;				// Protects the dependencies & cached contents when shaders are compiled in parallel
 #endif
 
 public:
 
 #ifdef _DEBUG
-	IncludesManager() : m_pDependencies(NULL) {}
+	IncludesManager() : m_pDependencies(NULL) { InitializeCriticalSection( &m_DependenciesLock ); }
 #else
 	IncludesManager() {}
 #endif
@@ -84,17 +121,28 @@ public:
 		for ( int FileIndex=0; FileIndex < FilesCount; FileIndex++, pPair++ )
 			if ( !strcmp( pFileName, pPair->pPath ) )
 			{	// Found it !
-				*ppData = LoadResourceBinary( pPair->ResourceID, "SHADER", pBytes );	// We read the file WITHOUT the trailing '\0' character !
-
 #ifdef SURE_DEBUG
-				if ( m_pCurrentShaderFileName != NULL )
-				{	// Add a dependency on that include
-					Dependencies&	D = m_pDependencies[FileIndex];
-					D.LastModificationTime = GetFileModTime( pPair->pFullPath );
+				EnterCriticalSection( &m_DependenciesLock );
+
+				Dependencies&	D = m_pDependencies[FileIndex];
+				if ( D.LastModificationTime == 0 )
+					D.LastModificationTime = GetFileModTime( pPair->pFullPath );	// The embedded resource matches the file as it was when we first included it
+
+				if ( D.pContent != NULL )
+				{	// The file changed since the resource was built, every compile shares the content reloaded by RebuildDependencies()
+					*ppData = D.pContent->pData;
+					*pBytes = D.pContent->Size;
+				}
+				else
+#endif
+					*ppData = LoadResourceBinary( pPair->ResourceID, "SHADER", pBytes );	// We read the file WITHOUT the trailing '\0' character !
 
+#ifdef SURE_DEBUG
+				if ( gs_pCurrentShaderFileName != NULL )
+				{	// Add a dependency on that include (nested includes also end up here so it lists all the shaders depending on it, directly or not)
 					bool	bAlreadyThere = false;
 					for ( int i=0; i < D.Count; i++ )
-						if ( !strcmp( D.ppDependencies[i], m_pCurrentShaderFileName ) )
+						if ( !strcmp( D.ppDependencies[i], gs_pCurrentShaderFileName ) )
 						{	// We already have this file listed as dependency...
 							// This occurs with nested includes if a includes b and include c which also includes b, b will be included twice and a will be added twice...
 							bAlreadyThere = true;
@@ -102,8 +150,13 @@ public:
 						}
 
 					if ( !bAlreadyThere )
-						D.ppDependencies[D.Count++] = m_pCurrentShaderFileName;
+					{
+						ASSERT( D.Count < MAX_DEPENDENCIES, "Too many shaders depend on that include file!" );
+						D.ppDependencies[D.Count++] = gs_pCurrentShaderFileName;
+					}
 				}
+
+				LeaveCriticalSection( &m_DependenciesLock );
 #endif
 
 				return S_OK;
@@ -127,7 +180,12 @@ public:
 	// Call this to rebuild dependent shaders if the include file has changed
 	void	WatchIncludeModifications() const;
 
+	// Rebuilds the shaders depending on that file, returns false if it's not an include file
+	bool	NotifyFileChanged( const char* _pFileName ) const;
+
 private:
+	void	RebuildDependencies( int _IncludeFileIndex ) const;
+	bool	ReloadContent( int _IncludeFileIndex ) const;
 	time_t	GetFileModTime( const char* _pFileName ) const;
 #endif
 
@@ -139,6 +197,96 @@ struct	ShaderResource
 	const char*	pShaderFileName;
 };
 
+//////////////////////////////////////////////////////////////////////////
+// Parallel shader compilation
+namespace
+{
+	static const int	MAX_QUEUED_SHADERS = JobQueue::MAX_PENDING_JOBS;
+
+	static volatile LONG		gs_CompiledShadersCount = 0;
+
+	class	ShaderCompilationJob : public IJob
+	{
+	public:
+		Shader*			pMaterial;
+		ComputeShader*	pComputeShader;
+		const char*		pShaderFileName;
+		char*			pShaderCode;
+
+		virtual void	Run()
+		{
+			gs_IncludesManager.SetCurrentlyCompilingShader( pShaderFileName );
+			if ( pMaterial != NULL )
+				pMaterial->Compile( pShaderCode );
+			else
+				pComputeShader->Compile( pShaderCode );
+			gs_IncludesManager.SetCurrentlyCompilingShader( NULL );
+
+			ReleaseResourceShader( pShaderCode );
+			pShaderCode = NULL;
+
+			InterlockedIncrement( &gs_CompiledShadersCount );
+		}
+
+		bool			HasErrors() const	{ return pMaterial != NULL ? pMaterial->HasErrors() : pComputeShader->HasErrors(); }
+	};
+
+	static JobQueue*			gs_pCompilationQueue = NULL;	// Non-NULL between BeginShaderCompilation() and EndShaderCompilation()
+	static ShaderCompilationJob	gs_pCompilationJobs[MAX_QUEUED_SHADERS];
+	static int					gs_QueuedShadersCount = 0;
+
+	// Returns true if the shader should be queued rather than compiled immediately
+	bool	MustQueueShader()
+	{
+		return gs_pCompilationQueue != NULL
+			&& gs_QueuedShadersCount < MAX_QUEUED_SHADERS
+			&& !Shader::ms_LoadFromBinary;	// Loading a binary blob is immediate anyway and the flag is only valid within its scope
+	}
+
+	void	QueueShader( Shader* _pMaterial, ComputeShader* _pComputeShader, const char* _pShaderFileName, char* _pShaderCode )
+	{
+		ShaderCompilationJob&	Job = gs_pCompilationJobs[gs_QueuedShadersCount++];
+		Job.pMaterial = _pMaterial;
+		Job.pComputeShader = _pComputeShader;
+		Job.pShaderFileName = _pShaderFileName;
+		Job.pShaderCode = _pShaderCode;	// The job takes ownership of the code
+		gs_pCompilationQueue->Push( Job );
+	}
+}
+
+void	BeginShaderCompilation()
+{
+	ASSERT( gs_pCompilationQueue == NULL, "Shader compilation already started! (nested batches are not supported)" );
+	gs_pCompilationQueue = new JobQueue();
+	gs_QueuedShadersCount = 0;
+	gs_CompiledShadersCount = 0;
+}
+
+int		EndShaderCompilation( IntroProgressDelegate* _pDelegate, int _ProgressStart, int _ProgressEnd )
+{
+	ASSERT( gs_pCompilationQueue != NULL, "You must call BeginShaderCompilation() first!" );
+
+	// The barrier: wait for the workers while reporting progress
+	while ( !gs_pCompilationQueue->Wait( 50 ) )
+		if ( _pDelegate != NULL )
+			_pDelegate->func( (WININFO*) _pDelegate->pInfos, _ProgressStart + (_ProgressEnd - _ProgressStart) * int(gs_CompiledShadersCount) / MAX( 1, gs_QueuedShadersCount ) );
+
+	if ( _pDelegate != NULL )
+		_pDelegate->func( (WININFO*) _pDelegate->pInfos, _ProgressEnd );
+
+	delete gs_pCompilationQueue;
+	gs_pCompilationQueue = NULL;
+
+	int	ErrorsCount = 0;
+	for ( int JobIndex=0; JobIndex < gs_QueuedShadersCount; JobIndex++ )
+		if ( gs_pCompilationJobs[JobIndex].HasErrors() )
+			ErrorsCount++;
+
+	gs_QueuedShadersCount = 0;
+
+	return ErrorsCount;
+}
+
 Shader*		CreateMaterial( U16 _ShaderResourceID, const char* _pFileName, const IVertexFormatDescriptor& _Format, const char* _pEntryPointVS, const char* _pEntryPointGS, const char* _pEntryPointPS, D3D_SHADER_MACRO* _pMacros )
 {
 	return CreateMaterial( _ShaderResourceID, _pFileName, _Format, _pEntryPointVS, NULL, NULL, _pEntryPointGS, _pEntryPointPS, _pMacros );
@@ -152,11 +300,16 @@ Shader*		CreateMaterial( U16 _ShaderResourceID, const char* _pFileName, const IV
 	char*	pShaderCode = LoadResourceShader( _ShaderResourceID, CodeSize );
 	ASSERT( pShaderCode != NULL, "Failed to load shader resource!" );
 
+	bool	bQueue = MustQueueShader();
+
 	gs_IncludesManager.SetCurrentlyCompilingShader( pFileName );
-	Shader*	pResult = new Shader( gs_Device, pFileName, _Format, pShaderCode, _pMacros, _pEntryPointVS, _pEntryPointHS, _pEntryPointDS, _pEntryPointGS, _pEntryPointPS, &gs_IncludesManager );
+	Shader*	pResult = new Shader( gs_Device, pFileName, _Format, pShaderCode, _pMacros, _pEntryPointVS, _pEntryPointHS, _pEntryPointDS, _pEntryPointGS, _pEntryPointPS, &gs_IncludesManager, bQueue );
 	gs_IncludesManager.RegisterMaterial( pFileName, *pResult );
 
-	delete pShaderCode;	// We musn't forget to delete this temporary buffer !
+	if ( bQueue )
+		QueueShader( pResult, NULL, pFileName, pShaderCode );
+	else
+		ReleaseResourceShader( pShaderCode );	// We musn't forget to delete this temporary buffer !
 
 	return pResult;
 }
@@ -169,11 +322,16 @@ ComputeShader*	CreateComputeShader( U16 _ShaderResourceID, const char* _pFileNam
 	char*	pShaderCode = LoadResourceShader( _ShaderResourceID, CodeSize );
 	ASSERT( pShaderCode != NULL, "Failed to load shader resource!" );
 
+	bool	bQueue = MustQueueShader();
+
 	gs_IncludesManager.SetCurrentlyCompilingShader( pFileName );
-	ComputeShader*	pResult = new ComputeShader( gs_Device, pFileName, pShaderCode, _pMacros, _pEntryPoint, &gs_IncludesManager );
+	ComputeShader*	pResult = new ComputeShader( gs_Device, pFileName, pShaderCode, _pMacros, _pEntryPoint, &gs_IncludesManager, bQueue );
 	gs_IncludesManager.RegisterComputeShader( pFileName, *pResult );
 
-	delete pShaderCode;	// We musn't forget to delete this temporary buffer !
+	if ( bQueue )
+		QueueShader( NULL, pResult, pFileName, pShaderCode );
+	else
+		ReleaseResourceShader( pShaderCode );	// We musn't forget to delete this temporary buffer !
 
 	return pResult;
 }
@@ -191,6 +349,25 @@ void	WatchIncludesModifications()
 
 	gs_IncludesManager.WatchIncludeModifications();
 }
+
+void	WatchShaderFilesModifications()
+{
+	static FileWatcher	Watcher( "./Resources/Shaders" );
+	if ( !Watcher.IsWatching() || Watcher.HasOverflowed() )
+	{	// We don't know what changed, check everything
+		WatchIncludesModifications();
+		Shader::WatchShadersModifications();
+		ComputeShader::WatchShadersModifications();
+	}
+
+	char	pFileName[MAX_PATH];
+	while ( Watcher.Pop( pFileName ) )
+		if ( !gs_IncludesManager.NotifyFileChanged( pFileName ) )
+		{
+			Shader::NotifyFileChanged( pFileName );
+			ComputeShader::NotifyFileChanged( pFileName );
+		}
+}
 #endif
 
 // Totally experimental
@@ -228,13 +405,15 @@ void	IncludesManager::SetCurrentlyCompilingShader( const char* _pShaderFileName
 		for ( int IncludeFileIndex=0; IncludeFileIndex < IncludesCount; IncludeFileIndex++ )
 		{
 			Dependencies&	D = m_pDependencies[IncludeFileIndex];
+			D.LastModificationTime = 0;
 			D.Count = 0;
 			D.ppDependencies = new const char*[MAX_DEPENDENCIES];
+			D.pContent = NULL;
 		}
 	}
 
 	// Store current shader's name
-	m_pCurrentShaderFileName = _pShaderFileName;
+	gs_pCurrentShaderFileName = _pShaderFileName;
 #endif
 }
 
@@ -261,8 +440,17 @@ IncludesManager::~IncludesManager()
 	{
 		Dependencies&	D = m_pDependencies[IncludeFileIndex];
 		delete[] D.ppDependencies;
+		while ( D.pContent != NULL )
+		{
+			CachedContent*	pPrevious = D.pContent->pPrevious;
+			delete[] D.pContent->pData;
+			delete D.pContent;
+			D.pContent = pPrevious;
+		}
 	}
 	delete[] m_pDependencies;
+
+	DeleteCriticalSection( &m_DependenciesLock );
 #endif
 }
 
@@ -271,39 +459,87 @@ IncludesManager::~IncludesManager()
 #include <sys/stat.h>
 
 void	IncludesManager::WatchIncludeModifications() const
+{
+	int		IncludesCount = sizeof(m_pIncludeFiles) / sizeof(IncludePair);
+	for ( int IncludeFileIndex=0; IncludeFileIndex < IncludesCount; IncludeFileIndex++ )
+		RebuildDependencies( IncludeFileIndex );
+}
+
+bool	IncludesManager::NotifyFileChanged( const char* _pFileName ) const
 {
 	int				IncludesCount = sizeof(m_pIncludeFiles) / sizeof(IncludePair);
 	IncludePair*	pPair = m_pIncludeFiles;
 	for ( int IncludeFileIndex=0; IncludeFileIndex < IncludesCount; IncludeFileIndex++, pPair++ )
-	{
-		const Dependencies&	D = m_pDependencies[IncludeFileIndex];
+		if ( !_stricmp( _pFileName, pPair->pFullPath ) )
+		{
+			RebuildDependencies( IncludeFileIndex );
+			return true;
+		}
 
-		time_t	LastModificationTime = GetFileModTime( pPair->pFullPath );
-		if ( LastModificationTime <= D.LastModificationTime )
-			continue;	// No change...
+	return false;
+}
 
-		D.LastModificationTime = LastModificationTime;	// Update last checked time...
+void	IncludesManager::RebuildDependencies( int _IncludeFileIndex ) const
+{
+	const Dependencies&	D = m_pDependencies[_IncludeFileIndex];
 
-		// Iterate on all dependencies and force recompilation
-		for ( int DependencyIndex=0; DependencyIndex < D.Count; DependencyIndex++ )
-		{
-			const char*	pShaderFile = D.ppDependencies[DependencyIndex];
-			Shader**	ppMaterial = m_pShaderName2Material.Get( pShaderFile );
-			if ( ppMaterial != NULL )
-			{	// Recompile that material...
-				(*ppMaterial)->ForceRecompile();
-				continue;
-			}
+	time_t	LastModificationTime = GetFileModTime( m_pIncludeFiles[_IncludeFileIndex].pFullPath );
+	if ( LastModificationTime <= D.LastModificationTime )
+		return;	// No change...
+
+	D.LastModificationTime = LastModificationTime;	// Update last checked time...
 
-			// Look for a compute shader then?
-			ComputeShader**	ppCS = m_pShaderName2ComputeShader.Get( pShaderFile );
-			ASSERT( ppCS != NULL, "Failed to retrieve actual dependency material/compute shader from shader file name! (Did you forget to register the material/compute shader after compilation?)" );
+	if ( !ReloadContent( _IncludeFileIndex ) )
+		return;	// Probably still being written by the editor, we'll try again on the next change
 
-			(*ppCS)->ForceRecompile();
+	// Iterate on all dependencies and force recompilation
+	// NOTE: Only the shaders that included that file (directly or through another include) are listed here
+	for ( int DependencyIndex=0; DependencyIndex < D.Count; DependencyIndex++ )
+	{
+		const char*	pShaderFile = D.ppDependencies[DependencyIndex];
+		Shader**	ppMaterial = m_pShaderName2Material.Get( pShaderFile );
+		if ( ppMaterial != NULL )
+		{	// Recompile that material...
+			(*ppMaterial)->ForceRecompile();
+			(*ppMaterial)->WatchShaderModifications();
+			continue;
 		}
+
+		// Look for a compute shader then?
+		ComputeShader**	ppCS = m_pShaderName2ComputeShader.Get( pShaderFile );
+		ASSERT( ppCS != NULL, "Failed to retrieve actual dependency material/compute shader from shader file name! (Did you forget to register the material/compute shader after compilation?)" );
+
+		(*ppCS)->ForceRecompile();
+		(*ppCS)->WatchShaderModifications();
 	}
 }
 
+bool	IncludesManager::ReloadContent( int _IncludeFileIndex ) const
+{
+	FILE*	pFile = NULL;
+	fopen_s( &pFile, m_pIncludeFiles[_IncludeFileIndex].pFullPath, "rb" );
+	if ( pFile == NULL )
+		return false;
+
+	CachedContent*	pContent = new CachedContent();
+	fseek( pFile, 0, SEEK_END );
+	pContent->Size = ftell( pFile );
+	fseek( pFile, 0, SEEK_SET );
+
+	pContent->pData = new char[MAX( 1U, pContent->Size )];
+	fread_s( pContent->pData, pContent->Size, 1, pContent->Size, pFile );
+	fclose( pFile );
+
+	// Publish it, the previous content stays valid for the compilations still reading it
+	EnterCriticalSection( &m_DependenciesLock );
+	Dependencies&	D = m_pDependencies[_IncludeFileIndex];
+	pContent->pPrevious = D.pContent;
+	D.pContent = pContent;
+	LeaveCriticalSection( &m_DependenciesLock );
+
+	return true;
+}
+
 time_t	IncludesManager::GetFileModTime( const char* _pFileName ) const
 {
 	struct _stat statInfo;
@@ -13,6 +13,27 @@
 	{ "Inc/SH.hlsl",				"./Resources/Shaders/Inc/SH.hlsl",					IDR_SHADER_INCLUDE_SH },				\
 	{ "Inc/ShadowMap.hlsl",			"./Resources/Shaders/Inc/ShadowMap.hlsl",			IDR_SHADER_INCLUDE_SHADOW_MAP },		\
 	{ "Inc/GI.hlsl",				"./Resources/Shaders/Inc/GI.hlsl",					IDR_SHADER_INCLUDE_GI },				\
+	{ "Inc/ProbeGrid.hlsl",		"./Resources/Shaders/Inc/ProbeGrid.hlsl",			IDR_SHADER_INCLUDE_PROBE_GRID },		\
+	{ "Inc/SHProbeStorage.hlsl",	"./Resources/Shaders/Inc/SHProbeStorage.hlsl",		IDR_SHADER_INCLUDE_SH_PROBE_STORAGE },	\
+	{ "Inc/PackedVertex.hlsl",	"./Resources/Shaders/Inc/PackedVertex.hlsl",	IDR_SHADER_INCLUDE_PACKED_VERTEX },	\
+	{ "Inc/SceneInstancing.hlsl",	"./Resources/Shaders/Inc/SceneInstancing.hlsl",	IDR_SHADER_INCLUDE_SCENE_INSTANCING },	\
+	{ "Inc/CloudEmptySpace.hlsl",	"./Resources/Shaders/Inc/CloudEmptySpace.hlsl",	IDR_SHADER_INCLUDE_CLOUD_EMPTY_SPACE },	\
+	{ "Inc/CloudShadowCascades.hlsl",	"./Resources/Shaders/Inc/CloudShadowCascades.hlsl",	IDR_SHADER_INCLUDE_CLOUD_SHADOW_CASCADES },	\
+	{ "Inc/Froxels.hlsl",	"./Resources/Shaders/Inc/Froxels.hlsl",	IDR_SHADER_INCLUDE_FROXELS },	\
+	{ "Inc/TerrainTessellation.hlsl",	"./Resources/Shaders/Inc/TerrainTessellation.hlsl",	IDR_SHADER_INCLUDE_TERRAIN_TESSELLATION },	\
+	{ "Inc/LightClusters.hlsl",	"./Resources/Shaders/Inc/LightClusters.hlsl",	IDR_SHADER_INCLUDE_LIGHT_CLUSTERS },	\
+	{ "Inc/ShadowAtlas.hlsl",	"./Resources/Shaders/Inc/ShadowAtlas.hlsl",	IDR_SHADER_INCLUDE_SHADOW_ATLAS },	\
+	{ "Inc/SunShadowCascades.hlsl",	"./Resources/Shaders/Inc/SunShadowCascades.hlsl",	IDR_SHADER_INCLUDE_SUN_SHADOW_CASCADES },	\
+	{ "Inc/VirtualTexture.hlsl",	"./Resources/Shaders/Inc/VirtualTexture.hlsl",		IDR_SHADER_INCLUDE_VIRTUAL_TEXTURE },	\
+	{ "Inc/MultiView.hlsl",		"./Resources/Shaders/Inc/MultiView.hlsl",			IDR_SHADER_INCLUDE_MULTIVIEW },	\
+	{ "Inc/BrickVolume.hlsl",		"./Resources/Shaders/Inc/BrickVolume.hlsl",			IDR_SHADER_INCLUDE_BRICK_VOLUME },	\
+	{ "Inc/ProbeTetrahedra.hlsl",	"./Resources/Shaders/Inc/ProbeTetrahedra.hlsl",		IDR_SHADER_INCLUDE_PROBE_TETRAHEDRA },	\
+	{ "Inc/IrradianceVolume.hlsl",	"./Resources/Shaders/Inc/IrradianceVolume.hlsl",	IDR_SHADER_INCLUDE_IRRADIANCE_VOLUME },	\
+	{ "Inc/DynamicObjects.hlsl",	"./Resources/Shaders/Inc/DynamicObjects.hlsl",		IDR_SHADER_INCLUDE_DYNAMIC_OBJECTS },	\
+	{ "Inc/SkyLUTs.hlsl",			"./Resources/Shaders/Inc/SkyLUTs.hlsl",				IDR_SHADER_INCLUDE_SKY_LUTS },	\
+	{ "Inc/DepthPyramid.hlsl",		"./Resources/Shaders/Inc/DepthPyramid.hlsl",		IDR_SHADER_INCLUDE_DEPTH_PYRAMID },	\
+	{ "Inc/AdaptiveTessellation.hlsl",	"./Resources/Shaders/Inc/AdaptiveTessellation.hlsl",	IDR_SHADER_INCLUDE_ADAPTIVE_TESSELLATION },	\
+	{ "Inc/GBuffer.hlsl",			"./Resources/Shaders/Inc/GBuffer.hlsl",				IDR_SHADER_INCLUDE_GBUFFER },	\
 
 
 #include "..\GodComplex.h"
@@ -21,6 +42,7 @@
 class IVertexFormatDescriptor;
 class Shader;
 class ComputeShader;
+struct IntroProgressDelegate;
 
 
 // Loads a binary resource in memory
@@ -29,8 +51,10 @@ class ComputeShader;
 const U8*		LoadResourceBinary( U16 _ResourceID, const char* _pResourceType, U32* _pResourceSize=NULL );
 
 // Loads a text shader resource in memory
-// IMPORTANT NOTE: You MUST destroy the returned pointer once you're done with it !
+// In release the resource is a binary aggregate (cf. Shader::LoadBinaryBlobFromAggregate()) that is returned in place instead of copied
+// IMPORTANT NOTE: You MUST release the returned pointer with ReleaseResourceShader() once you're done with it !
 char*			LoadResourceShader( U16 _ResourceID, U32& _CodeSize );
+void			ReleaseResourceShader( char* _pShaderCode );
 
 // Create a full-fledged material given the shader resource ID and the vertex format
 // NOTE: The _pFileName is only here for debug purpose and should be provided only if you wish to watch a change on the source file
@@ -41,7 +65,20 @@ Shader*		CreateMaterial( U16 _ShaderResourceID, const char* _pFileName, const IV
 // NOTE: The _pFileName is only here for debug purpose and should be provided only if you wish to watch a change on the source file
 ComputeShader*	CreateComputeShader( U16 _ShaderResourceID, const char* _pFileName, const char* _pEntryPoint, D3D_SHADER_MACRO* _pMacros=NULL );
 
+// Parallel shader compilation
+// Between BeginShaderCompilation() and EndShaderCompilation(), CreateMaterial() and CreateComputeShader() don't compile
+//	anymore but queue their shader on a pool of worker threads and return immediately.
+// EndShaderCompilation() is the barrier: it waits for all the queued shaders to be compiled, reports progress through the
+//	delegate (if any) and returns the amount of shaders that failed to compile.
+// NOTE: Queued shaders must not be used (nor checked with HasErrors()) before the barrier!
+void			BeginShaderCompilation();
+int				EndShaderCompilation( IntroProgressDelegate* _pDelegate=NULL, int _ProgressStart=0, int _ProgressEnd=100 );
+
 // Call this regularly to check for include files modifications that will trigger recompilation of dependent shaders
 void			WatchIncludesModifications();
 
+// Call this every frame instead of polling all the shaders: only the files notified as changed by a FileWatcher
+//	on the shaders directory (and the shaders including them) are rebuilt
+void			WatchShaderFilesModifications();
+
 const char*		LoadCSO( const char* _pCSOPath );
\ No newline at end of file
@@ -84,17 +84,29 @@ double	SH::ComputeSHCoeff( int l, int m, const float3& _Direction )
 	return	ComputeSHCoeff( l, m, θ, ϕ );
 }
 
-// True computation of coefficients
+// Hard-coded computation of coefficients, same as ComputeSHCoeff() for bands 0 to 2 without the polar coordinates and Legendre polynomials
+// NOTE ==> The '_Direction' vector must be normalized!!
+//
 void	SH::BuildSHCoeffs( const float3& _Direction, double _Coeffs[9] )
 {
-	// Convert from cartesian to polar coords
-	double	θ, ϕ;
-	CartesianToSpherical( _Direction, θ, ϕ );
+	const double	f0 = 0.28209479177387814347403972578039;	// 0.5 / sqrt(PI)
+	const double	f1 = 0.48860251190291992158638462283835;	// 0.5 * sqrt(3/PI)
+	const double	f2 = 1.0925484305920790705433857058027;		// 0.5 * sqrt(15/PI)
+	const double	f3 = 0.31539156525252000603089369029571;	// 0.25 * sqrt(5/PI)
+
+	double	x = _Direction.x;
+	double	y = _Direction.y;
+	double	z = _Direction.z;
 
-	int	CoeffIndex = 0;
-	for ( int l=0; l < 3; l++ )
-		for ( int m=-l; m <= l; m++ )
-			_Coeffs[CoeffIndex++] = ComputeSHCoeff( l, m, θ, ϕ );
+	_Coeffs[0] = f0;
+	_Coeffs[1] = f1 * y;
+	_Coeffs[2] = f1 * z;
+	_Coeffs[3] = f1 * x;
+	_Coeffs[4] = f2 * x * y;
+	_Coeffs[5] = f2 * y * z;
+	_Coeffs[6] = f3 * (3.0 * z*z - 1.0);
+	_Coeffs[7] = f2 * x * z;
+	_Coeffs[8] = f2 * 0.5 * (x*x - y*y);
 }
 
 
@@ -191,6 +203,188 @@ void	SH::ZHRotate_YUp( const float3& _Direction, const float3& _ZHCoeffs, double
 	_Coeffs[8] = f2 * 0.5f * (_Direction.z*_Direction.z - _Direction.x*_Direction.x);
 }
 
+namespace
+{
+	const float	SH_F0 = 0.28209479177387814347403972578039f;	// 0.5 / sqrt(PI)
+	const float	SH_F1 = 0.48860251190291992158638462283835f;	// 0.5 * sqrt(3/PI)
+	const float	SH_F2 = 1.0925484305920790705433857058027f;		// 0.5 * sqrt(15/PI)
+	const float	SH_F3 = 0.31539156525252000603089369029571f;	// 0.25 * sqrt(5/PI)
+
+	// Same as SH::BuildSHCoeffs_YUp() in single precision
+	void	EvaluateSH_YUp( const float3& _Direction, float _pY[9] )
+	{
+		_pY[0] = SH_F0;
+		_pY[1] = -SH_F1 * _Direction.x;
+		_pY[2] = SH_F1 * _Direction.y;
+		_pY[3] = -SH_F1 * _Direction.z;
+		_pY[4] = SH_F2 * _Direction.x * _Direction.z;
+		_pY[5] = -SH_F2 * _Direction.x * _Direction.y;
+		_pY[6] = SH_F3 * (3.0f * _Direction.y*_Direction.y - 1.0f);
+		_pY[7] = -SH_F2 * _Direction.z * _Direction.y;
+		_pY[8] = SH_F2 * 0.5f * (_Direction.z*_Direction.z - _Direction.x*_Direction.x);
+	}
+
+#ifdef NUAJ_MATH_SSE
+	// Same for 4 directions given as X, Y and Z vectors
+	void	EvaluateSH_YUp( __m128 _X, __m128 _Y, __m128 _Z, __m128 _pY[9] )
+	{
+		__m128	F1 = _mm_set1_ps( SH_F1 );
+		__m128	F2 = _mm_set1_ps( SH_F2 );
+		_pY[0] = _mm_set1_ps( SH_F0 );
+		_pY[1] = _mm_mul_ps( _mm_set1_ps( -SH_F1 ), _X );
+		_pY[2] = _mm_mul_ps( F1, _Y );
+		_pY[3] = _mm_mul_ps( _mm_set1_ps( -SH_F1 ), _Z );
+		_pY[4] = _mm_mul_ps( F2, _mm_mul_ps( _X, _Z ) );
+		_pY[5] = _mm_mul_ps( _mm_set1_ps( -SH_F2 ), _mm_mul_ps( _X, _Y ) );
+		_pY[6] = _mm_sub_ps( _mm_mul_ps( _mm_set1_ps( 3.0f * SH_F3 ), _mm_mul_ps( _Y, _Y ) ), _mm_set1_ps( SH_F3 ) );
+		_pY[7] = _mm_mul_ps( _mm_set1_ps( -SH_F2 ), _mm_mul_ps( _Z, _Y ) );
+		_pY[8] = _mm_mul_ps( _mm_set1_ps( 0.5f * SH_F2 ), _mm_sub_ps( _mm_mul_ps( _Z, _Z ), _mm_mul_ps( _X, _X ) ) );
+	}
+
+	float	HorizontalSum( __m128 _V )
+	{
+		__m128	Sum = _mm_add_ps( _V, _mm_movehl_ps( _V, _V ) );
+		Sum = _mm_add_ss( Sum, _mm_shuffle_ps( Sum, Sum, _MM_SHUFFLE( 1, 1, 1, 1 ) ) );
+		return _mm_cvtss_f32( Sum );
+	}
+#endif
+
+	// Evaluates the band 2 of the SH in the provided direction
+	template<typename T> T	EvaluateSHBand2_YUp( const T _SH[9], const float3& _Direction )
+	{
+		return	(SH_F2 * _Direction.x * _Direction.z) * _SH[4]
+			+	(-SH_F2 * _Direction.x * _Direction.y) * _SH[5]
+			+	(SH_F3 * (3.0f * _Direction.y*_Direction.y - 1.0f)) * _SH[6]
+			+	(-SH_F2 * _Direction.z * _Direction.y) * _SH[7]
+			+	(SH_F2 * 0.5f * (_Direction.z*_Direction.z - _Direction.x*_Direction.x)) * _SH[8];
+	}
+
+	// Rotates the SH by evaluating them in rotated fixed directions
+	// Band 1 is simply a vector transformed by the matrix.
+	// Band 2 is evaluated in the 5 directions N0=(1,0,0) N1=(0,0,1) N2=(1,1,0)/sqrt(2) N3=(1,0,1)/sqrt(2) N4=(0,1,1)/sqrt(2) transformed by
+	//	the inverse rotation, the rotated coefficients are then obtained with the (hard-coded) inverse of the matrix of the band 2 basis
+	//	functions evaluated in these directions.
+	template<typename T> void	RotateSH_YUp( const float4x4& _Rotation, const T _SH[9], T _RotatedSH[9] )
+	{
+		const float*	R = _Rotation.m;
+		const float		InvSqrt2 = 0.70710678118654752440084436210485f;
+
+		// Band 1 is the vector (-SH1, SH2, -SH3) transformed by the rotation
+		T	pRotated[9];
+		pRotated[0] = _SH[0];
+		pRotated[1] = R[0] * _SH[1] - R[4] * _SH[2] + R[8] * _SH[3];
+		pRotated[2] = -R[1] * _SH[1] + R[5] * _SH[2] - R[9] * _SH[3];
+		pRotated[3] = R[2] * _SH[1] - R[6] * _SH[2] + R[10] * _SH[3];
+
+		// Band 2 evaluated in the inverse rotated directions (i.e. the columns of the rotation)
+		float3	C0( R[0], R[4], R[8] );
+		float3	C1( R[1], R[5], R[9] );
+		float3	C2( R[2], R[6], R[10] );
+
+		T	E0 = EvaluateSHBand2_YUp( _SH, C0 );
+		T	E1 = EvaluateSHBand2_YUp( _SH, C2 );
+		T	E2 = EvaluateSHBand2_YUp( _SH, InvSqrt2 * (C0 + C1) );
+		T	E3 = EvaluateSHBand2_YUp( _SH, InvSqrt2 * (C0 + C2) );
+		T	E4 = EvaluateSHBand2_YUp( _SH, InvSqrt2 * (C1 + C2) );
+
+		const float	InvF2 = 1.0f / SH_F2;
+		const float	InvF3 = 1.0f / SH_F3;
+		pRotated[4] = InvF2 * (2.0f * E3 - E0 - E1);
+		pRotated[5] = -InvF2 * (E1 + 2.0f * E2);
+		pRotated[6] = -0.5f * InvF3 * (E0 + E1);
+		pRotated[7] = -InvF2 * (E0 + 2.0f * E4);
+		pRotated[8] = InvF2 * (E1 - E0);
+
+		for ( int i=0; i < 9; i++ )
+			_RotatedSH[i] = pRotated[i];	// Source & target may be the same
+	}
+}
+
+void	SH::Rotate_YUp( const float4x4& _Rotation, const float _SH[9], float _RotatedSH[9] )
+{
+	RotateSH_YUp( _Rotation, _SH, _RotatedSH );
+}
+
+void	SH::Rotate_YUp( const float4x4& _Rotation, const float3 _SH[9], float3 _RotatedSH[9] )
+{
+	RotateSH_YUp( _Rotation, _SH, _RotatedSH );
+}
+
+void	SH::ProjectSH_YUp( U32 _Count, const float3* _pDirections, const float* _pWeights, float _SH[9] )
+{
+	float	pY[9];
+	U32		Index = 0;
+
+#ifdef NUAJ_MATH_SSE
+	__m128	pSum[9];
+	for ( int i=0; i < 9; i++ )
+		pSum[i] = _mm_setzero_ps();
+
+	__m128	pY4[9];
+	for ( ; Index+4 <= _Count; Index+=4 )
+	{
+		const float3*	D = _pDirections + Index;
+		EvaluateSH_YUp( _mm_set_ps( D[3].x, D[2].x, D[1].x, D[0].x ), _mm_set_ps( D[3].y, D[2].y, D[1].y, D[0].y ), _mm_set_ps( D[3].z, D[2].z, D[1].z, D[0].z ), pY4 );
+
+		__m128	W = _mm_loadu_ps( _pWeights + Index );
+		for ( int i=0; i < 9; i++ )
+			pSum[i] = _mm_add_ps( pSum[i], _mm_mul_ps( pY4[i], W ) );
+	}
+
+	for ( int i=0; i < 9; i++ )
+		_SH[i] += HorizontalSum( pSum[i] );
+#endif
+
+	// Remaining directions
+	for ( ; Index < _Count; Index++ )
+	{
+		EvaluateSH_YUp( _pDirections[Index], pY );
+		for ( int i=0; i < 9; i++ )
+			_SH[i] += pY[i] * _pWeights[Index];
+	}
+}
+
+void	SH::ProjectSH_YUp( U32 _Count, const float3* _pDirections, const float3* _pWeights, float3 _SH[9] )
+{
+	float	pY[9];
+	U32		Index = 0;
+
+#ifdef NUAJ_MATH_SSE
+	__m128	pSumR[9], pSumG[9], pSumB[9];
+	for ( int i=0; i < 9; i++ )
+		pSumR[i] = pSumG[i] = pSumB[i] = _mm_setzero_ps();
+
+	__m128	pY4[9];
+	for ( ; Index+4 <= _Count; Index+=4 )
+	{
+		const float3*	D = _pDirections + Index;
+		EvaluateSH_YUp( _mm_set_ps( D[3].x, D[2].x, D[1].x, D[0].x ), _mm_set_ps( D[3].y, D[2].y, D[1].y, D[0].y ), _mm_set_ps( D[3].z, D[2].z, D[1].z, D[0].z ), pY4 );
+
+		const float3*	W = _pWeights + Index;
+		__m128	WR = _mm_set_ps( W[3].x, W[2].x, W[1].x, W[0].x );
+		__m128	WG = _mm_set_ps( W[3].y, W[2].y, W[1].y, W[0].y );
+		__m128	WB = _mm_set_ps( W[3].z, W[2].z, W[1].z, W[0].z );
+		for ( int i=0; i < 9; i++ )
+		{
+			pSumR[i] = _mm_add_ps( pSumR[i], _mm_mul_ps( pY4[i], WR ) );
+			pSumG[i] = _mm_add_ps( pSumG[i], _mm_mul_ps( pY4[i], WG ) );
+			pSumB[i] = _mm_add_ps( pSumB[i], _mm_mul_ps( pY4[i], WB ) );
+		}
+	}
+
+	for ( int i=0; i < 9; i++ )
+		_SH[i] = _SH[i] + float3( HorizontalSum( pSumR[i] ), HorizontalSum( pSumG[i] ), HorizontalSum( pSumB[i] ) );
+#endif
+
+	// Remaining directions
+	for ( ; Index < _Count; Index++ )
+	{
+		EvaluateSH_YUp( _pDirections[Index], pY );
+		for ( int i=0; i < 9; i++ )
+			_SH[i] = _SH[i] + pY[i] * _pWeights[Index];
+	}
+}
+
 /// <summary>
 /// Computes the product of 2 SH vectors of order 3
 /// (code from John Snyder "Code Generation and Factoring for Fast Evaluation of Low-order Spherical Harmonic Products and Squares")
@@ -436,77 +630,140 @@ void	SH::Product3( const float a[9], const float b[9], float c[9] )
 	// addition count=74
 }
 
-void	SH::Product3( const float3 a[9], const float b[9], float3 r[9] )
+namespace
 {
-	float	ta[9], tr[9];
-
-	// Process X
-	for ( int i=0; i < 9; i++ )
+	// Same as SH::Product3() but written once for RGB coefficients so the 3 channels are processed together
+	//	TA is the type of a and of the result (float3), TB is the type of b (float or float3)
+	template<typename TA, typename TB> void	Product3RGB( const TA a[9], const TB b[9], TA r[9] )
 	{
-		ta[i] = a[i].x;
-		tr[i] = -1e-6f;
+		TA		c[9];	// Result may be one of the sources
+		TA		ta, t;
+		TB		tb;
+
+		const float	C0 = 0.282094792935999980f;
+		const float	C1 = -0.126156626101000010f;
+		const float	C2 = 0.218509686119999990f;
+		const float	C3 = 0.252313259986999990f;
+		const float	C4 = 0.180223751576000010f;
+		const float	C5 = 0.156078347226000000f;
+		const float	C6 = 0.090111875786499998f;
+
+		// [0,0]: 0,
+		c[0] = C0*a[0]*b[0];
+
+		// [1,1]: 0,6,8,
+		ta = C0*a[0]+C1*a[6]-C2*a[8];
+		tb = C0*b[0]+C1*b[6]-C2*b[8];
+		c[1] = ta*b[1]+tb*a[1];
+		t = a[1]*b[1];
+		c[0] = c[0] + C0*t;
+		c[6] = C1*t;
+		c[8] = -C2*t;
+
+		// [1,2]: 5,
+		ta = C2*a[5];
+		tb = C2*b[5];
+		c[1] = c[1] + ta*b[2]+tb*a[2];
+		c[2] = ta*b[1]+tb*a[1];
+		t = a[1]*b[2]+a[2]*b[1];
+		c[5] = C2*t;
+
+		// [1,3]: 4,
+		ta = C2*a[4];
+		tb = C2*b[4];
+		c[1] = c[1] + ta*b[3]+tb*a[3];
+		c[3] = ta*b[1]+tb*a[1];
+		t = a[1]*b[3]+a[3]*b[1];
+		c[4] = C2*t;
+
+		// [2,2]: 0,6,
+		ta = C0*a[0]+C3*a[6];
+		tb = C0*b[0]+C3*b[6];
+		c[2] = c[2] + ta*b[2]+tb*a[2];
+		t = a[2]*b[2];
+		c[0] = c[0] + C0*t;
+		c[6] = c[6] + C3*t;
+
+		// [2,3]: 7,
+		ta = C2*a[7];
+		tb = C2*b[7];
+		c[2] = c[2] + ta*b[3]+tb*a[3];
+		c[3] = c[3] + ta*b[2]+tb*a[2];
+		t = a[2]*b[3]+a[3]*b[2];
+		c[7] = C2*t;
+
+		// [3,3]: 0,6,8,
+		ta = C0*a[0]+C1*a[6]+C2*a[8];
+		tb = C0*b[0]+C1*b[6]+C2*b[8];
+		c[3] = c[3] + ta*b[3]+tb*a[3];
+		t = a[3]*b[3];
+		c[0] = c[0] + C0*t;
+		c[6] = c[6] + C1*t;
+		c[8] = c[8] + C2*t;
+
+		// [4,4]: 0,6,
+		ta = C0*a[0]-C4*a[6];
+		tb = C0*b[0]-C4*b[6];
+		c[4] = c[4] + ta*b[4]+tb*a[4];
+		t = a[4]*b[4];
+		c[0] = c[0] + C0*t;
+		c[6] = c[6] - C4*t;
+
+		// [4,5]: 7,
+		ta = C5*a[7];
+		tb = C5*b[7];
+		c[4] = c[4] + ta*b[5]+tb*a[5];
+		c[5] = c[5] + ta*b[4]+tb*a[4];
+		t = a[4]*b[5]+a[5]*b[4];
+		c[7] = c[7] + C5*t;
+
+		// [5,5]: 0,6,8,
+		ta = C0*a[0]+C6*a[6]-C5*a[8];
+		tb = C0*b[0]+C6*b[6]-C5*b[8];
+		c[5] = c[5] + ta*b[5]+tb*a[5];
+		t = a[5]*b[5];
+		c[0] = c[0] + C0*t;
+		c[6] = c[6] + C6*t;
+		c[8] = c[8] - C5*t;
+
+		// [6,6]: 0,6,
+		ta = C0*a[0];
+		tb = C0*b[0];
+		c[6] = c[6] + ta*b[6]+tb*a[6];
+		t = a[6]*b[6];
+		c[0] = c[0] + C0*t;
+		c[6] = c[6] + C4*t;
+
+		// [7,7]: 0,6,8,
+		ta = C0*a[0]+C6*a[6]+C5*a[8];
+		tb = C0*b[0]+C6*b[6]+C5*b[8];
+		c[7] = c[7] + ta*b[7]+tb*a[7];
+		t = a[7]*b[7];
+		c[0] = c[0] + C0*t;
+		c[6] = c[6] + C6*t;
+		c[8] = c[8] + C5*t;
+
+		// [8,8]: 0,6,
+		ta = C0*a[0]-C4*a[6];
+		tb = C0*b[0]-C4*b[6];
+		c[8] = c[8] + ta*b[8]+tb*a[8];
+		t = a[8]*b[8];
+		c[0] = c[0] + C0*t;
+		c[6] = c[6] - C4*t;
+
+		for ( int i=0; i < 9; i++ )
+			r[i] = c[i];
 	}
-	Product3( ta, b, tr );
-	for ( int i=0; i < 9; i++ )
-		r[i].x = tr[i];
-
-	// Process Y
-	for ( int i=0; i < 9; i++ )
-	{
-		ta[i] = a[i].y;
-		tr[i] = -1e-6f;
-	}
-	Product3( ta, b, tr );
-	for ( int i=0; i < 9; i++ )
-		r[i].y = tr[i];
+}
 
-	// Process Z
-	for ( int i=0; i < 9; i++ )
-	{
-		ta[i] = a[i].z;
-		tr[i] = -1e-6f;
-	}
-	Product3( ta, b, tr );
-	for ( int i=0; i < 9; i++ )
-		r[i].z = tr[i];
+void	SH::Product3( const float3 a[9], const float b[9], float3 r[9] )
+{
+	Product3RGB( a, b, r );
 }
 
 void	SH::Product3( const float3 a[9], const float3 b[9], float3 r[9] )
 {
-	float	ta[9], tb[9], tr[9];
-
-	// Process X
-	for ( int i=0; i < 9; i++ )
-	{
-		ta[i] = a[i].x;
-		tb[i] = b[i].x;
-		tr[i] = -1e-6f;
-	}
-	Product3( ta, tb, tr );
-	for ( int i=0; i < 9; i++ )
-		r[i].x = tr[i];
-
-	// Process Y
-	for ( int i=0; i < 9; i++ )
-	{
-		ta[i] = a[i].y;
-		tb[i] = b[i].y;
-		tr[i] = -1e-6f;
-	}
-	Product3( ta, tb, tr );
-	for ( int i=0; i < 9; i++ )
-		r[i].y = tr[i];
-
-	// Process Z
-	for ( int i=0; i < 9; i++ )
-	{
-		ta[i] = a[i].z;
-		tb[i] = b[i].z;
-		tr[i] = -1e-6f;
-	}
-	Product3( ta, tb, tr );
-	for ( int i=0; i < 9; i++ )
-		r[i].z = tr[i];
+	Product3RGB( a, b, r );
 }
 
 /// <summary>
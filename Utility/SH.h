@@ -41,12 +41,12 @@ public:
 	static double		ComputeSHWindowedSinc( int l, int m, double _θ, double _ϕ, int _Order );
 	static double		ComputeSHWindowedCos( int l, int m, double _θ, double _ϕ, int _Order );
 
-	static void			BuildSHCoeffs( const float3& _Direction, double _Coeffs[9] );
+	static void			BuildSHCoeffs( const float3& _Direction, double _Coeffs[9] );	// Closed-form version of ComputeSHCoeff() that stays the reference
 
 	// Advanced
 	static void			Product3( const double a[9], const double b[9], double r[9] );
 	static void			Product3( const float a[9], const float b[9], float r[9] );
-	static void			Product3( const float3 a[9], const float b[9], float3 r[9] );
+	static void			Product3( const float3 a[9], const float b[9], float3 r[9] );	// RGB versions process the 3 channels at once
 	static void			Product3( const float3 a[9], const float3 b[9], float3 r[9] );
 
 	// Helpers
@@ -82,6 +82,16 @@ public:
 	static void			BuildSHSmoothCone_YUp( const float3& _Direction, float _HalfAngle, double _Coeffs[9] );
 	static void			ZHRotate_YUp( const float3& _Direction, const float3& _ZHCoeffs, double _Coeffs[9] );
 
+	// Rotates SH coefficients by the rotation part of the matrix (which must be orthonormal), as if the directions were transformed by _Rotation
+	//	(i.e. closed-form rotation of band 2 through the evaluation of the SH in 5 fixed directions, no Wigner matrices involved)
+	static void			Rotate_YUp( const float4x4& _Rotation, const float _SH[9], float _RotatedSH[9] );
+	static void			Rotate_YUp( const float4x4& _Rotation, const float3 _SH[9], float3 _RotatedSH[9] );
+
+	// Batched projection: accumulates the _Count weighted directions into _SH (that is NOT cleared first), 4 directions at a time with SSE
+	//	_pWeights, the weight of each direction (e.g. solid angle x value)
+	static void			ProjectSH_YUp( U32 _Count, const float3* _pDirections, const float* _pWeights, float _SH[9] );
+	static void			ProjectSH_YUp( U32 _Count, const float3* _pDirections, const float3* _pWeights, float3 _SH[9] );
+
 
 private:
 	static double		Factorial( int _Value );
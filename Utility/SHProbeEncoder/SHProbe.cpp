@@ -153,6 +153,66 @@ bool	SHProbe::IsInsideVoronoiCell( const float3& _wsPosition ) const {
 	return true;
 }
 
+SHProbe::CellPolygon::CellPolygon( const float3& _P, const float3& _N, float _Radius ) {
+	m_P = _P;
+	m_N = _N;
+	if ( fabsf( m_N.y ) < 1.0f-1e-3f ) {
+		m_T = float3::UnitY.Cross( m_N ).Normalize();
+		m_B = m_N.Cross( m_T );
+	} else {
+		m_T = float3::UnitZ;
+		m_B = float3::UnitX;
+	}
+
+	// Start with 4 vertices
+	const float	R = _Radius;
+	m_CurrentListIndex = 0;
+	m_pVertices[0].Init( 4 );
+	m_pVertices[0].Append( m_P + R * (-m_T + m_B) );
+	m_pVertices[0].Append( m_P + R * (-m_T - m_B) );
+	m_pVertices[0].Append( m_P + R * ( m_T - m_B) );
+	m_pVertices[0].Append( m_P + R * ( m_T + m_B) );
+}
+
+void	SHProbe::CellPolygon::Cut( const float3& _P, const float3& _N ) {
+	List<float3>&	SourceVertices = m_pVertices[m_CurrentListIndex];
+	m_CurrentListIndex ^= 1;
+	List<float3>&	TargetVertices = m_pVertices[m_CurrentListIndex];
+	TargetVertices.Init( SourceVertices.GetCount() + 1 );	// Any intersection add at most one more vertex every time...
+
+	for ( int EdgeIndex=0; EdgeIndex < SourceVertices.GetCount(); EdgeIndex++ ) {
+		float3	P0 = SourceVertices[EdgeIndex+0];
+		float3	P1 = SourceVertices[(EdgeIndex+1) % SourceVertices.GetCount()];
+		float	Dot0 = (P0 - _P).Dot( _N );
+		float	Dot1 = (P1 - _P).Dot( _N );
+		bool	InFront0 = Dot0 >= 0.0f;
+		bool	InFront1 = Dot1 >= 0.0f;
+		if ( !InFront0 && !InFront1 )
+			continue;	// This edge is completely behind the cutting plane, skip it entirely
+
+		if ( InFront0 && InFront1 ) {
+			// This edge is completely in front of the cutting plane, add P1
+			TargetVertices.Append( P1 );
+		} else {
+			// The edge intersects the plane
+			float3	D = P1 - P0;
+			float	t = -Dot0 / D.Dot( _N );
+			float3	I = P0 + t * D;
+			TargetVertices.Append( I );		// Add intersection no matter what
+			if ( InFront1 )
+				TargetVertices.Append( P1 );	// Since the edge is entering the plane, also add end point
+		}
+	}
+}
+
+float	SHProbe::CellPolygon::ComputeArea() const {
+	const List<float3>&	Vertices = GetVertices();
+	float3	Sum = float3::Zero;
+	for ( int VertexIndex=2; VertexIndex < Vertices.GetCount(); VertexIndex++ )
+		Sum = Sum + (Vertices[VertexIndex-1] - Vertices[0]).Cross( Vertices[VertexIndex] - Vertices[0] );
+	return 0.5f * Sum.Length();
+}
+
 //////////////////////////////////////////////////////////////////////////
 // I/O
 //
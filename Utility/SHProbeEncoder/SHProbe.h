@@ -91,6 +91,32 @@ public:		// FIELDS
 	static float3			ms_SampleDirections[SAMPLES_COUNT];
 
 
+public:		// NESTED TYPES
+
+	// Convex polygon lying on a Vorono plane, cut by the other planes of the cell to find the face of the cell on that plane
+	// (cf. SHProbeEncoder::BuildProbeVoronoiCell() & EffectGlobalIllum2::BuildVoronoiPrimitives())
+	class	CellPolygon {
+	protected:
+		float3			m_P;
+		float3			m_T;
+		float3			m_B;
+		float3			m_N;
+		int				m_CurrentListIndex;
+		List<float3>	m_pVertices[2];
+
+	public:
+		const List<float3>&	GetVertices() const	{ return m_pVertices[m_CurrentListIndex]; }
+		float				ComputeArea() const;
+
+	public:
+		// Starts with a square of half size _Radius centered on the plane's position
+		CellPolygon( const float3& _P, const float3& _N, float _Radius=10.0f );
+
+		// Keeps the part of the polygon in front of the provided plane
+		void	Cut( const float3& _P, const float3& _N );
+	};
+
+
 public:		// METHODS
 
 	// Tells if the specified position is within the probe's Vorono cell
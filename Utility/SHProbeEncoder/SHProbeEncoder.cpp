@@ -3,11 +3,6 @@
 const float	SHProbeEncoder::Z_INFINITY = 1e6f;
 const float	SHProbeEncoder::Z_INFINITY_TEST = 0.99f * SHProbeEncoder::Z_INFINITY;
 
-float		SHProbeEncoder::DISTANCE_THRESHOLD = 0.02f;						// 2cm
-float		SHProbeEncoder::ANGULAR_THRESHOLD = acosf( 0.5f * PI / 180 );	// 0.5
-float		SHProbeEncoder::ALBEDO_HUE_THRESHOLD = 0.04f;					// Close colors!
-float		SHProbeEncoder::ALBEDO_RGB_THRESHOLD = 0.16f;					// Close colors!
-
 const double	SHProbeEncoder::SAMPLE_SH_NORMALIZER = 1.0 / SHProbe::SAMPLES_COUNT;
 
 SHProbeEncoder::SHProbeEncoder() {
@@ -85,17 +80,6 @@ SHProbeEncoder::SHProbeEncoder() {
 				SumSolidAngle += SolidAngle;
 
 				pPixel->SolidAngle = SolidAngle;
-
-				// Build SH coefficients
-				pPixel->InitSH();
-
-
-// Make sure we get the same using precise SH coefficients
-// for ( int i=0; i < 9; i++ ) {
-// 	int	l = int( floorf( sqrtf( float( i ) ) ) );
-// 	int	m = i - l*(l+1);
-// 	pPixel->SHCoeffs[i] = SH::ComputeSHCoeff( l, m, pPixel->View );
-// }
 			}
 
 	//////////////////////////////////////////////////////////////////////////
@@ -153,7 +137,9 @@ SHProbeEncoder::SHProbeEncoder() {
 		pSample->OriginalPixelsCount++;
 
 // Debug SH
-for ( int i=0; i < 9; i++ ) SH[i] += pPixel->SolidAngle * pPixel->SHCoeffs[i];
+double	SHCoeffs[9];
+pPixel->BuildSHCoeffs( SHCoeffs );
+for ( int i=0; i < 9; i++ ) SH[i] += pPixel->SolidAngle * SHCoeffs[i];
 	}
 
 	// At this point, SH should only have a non null ambient term equal to 2*sqrt(PI)
@@ -176,8 +162,10 @@ for ( int i=0; i < 9; i++ ) SH[i] += pPixel->SolidAngle * pPixel->SHCoeffs[i];
 	// Build each sample's SH coefficients
 	pPixel = m_pCubeMapPixels;
 	for ( int i=0; i < PixelsCount; i++, pPixel++ ) {
+		double	SHCoeffs[9];
+		pPixel->BuildSHCoeffs( SHCoeffs );
 		for ( int SHCoeffIndex=0; SHCoeffIndex < 9; SHCoeffIndex++ ) {
-			pPixel->pParentSample->SH[SHCoeffIndex] += pPixel->SolidAngle * pPixel->SHCoeffs[SHCoeffIndex];
+			pPixel->pParentSample->SH[SHCoeffIndex] += pPixel->SolidAngle * SHCoeffs[SHCoeffIndex];
 		}
 	}
 
@@ -205,21 +193,68 @@ for ( int i=0; i < 9; i++ ) SH[i] += pPixel->SolidAngle * pPixel->SHCoeffs[i];
 
 
 	//////////////////////////////////////////////////////////////////////////
-	// Pre-allocate the maximum amount of radix nodes
-	Pixel::ms_RadixNodes[0] = new SHProbeEncoder::Pixel::RadixNode_t[6*CUBE_MAP_FACE_SIZE];
-	Pixel::ms_RadixNodes[1] = new SHProbeEncoder::Pixel::RadixNode_t[6*CUBE_MAP_FACE_SIZE];
+	// Sort the pixels by sample so each sample can address its pixels as a contiguous range
+	// The sort is stable so each sample's pixels are kept in increasing index order
+	{
+		RadixNode_t*	pNodes = new RadixNode_t[2*PixelsCount];
+		pPixel = m_pCubeMapPixels;
+		for ( int i=0; i < PixelsCount; i++, pPixel++ ) {
+			pNodes[i].Key = pPixel->pParentSample->Index;
+			pNodes[i].PixelIndex = i;
+		}
+
+		Sort( PixelsCount, pNodes, pNodes + PixelsCount );
+
+		m_pSamplePixels = new U32[PixelsCount];
+		for ( int i=0; i < PixelsCount; i++ )
+			m_pSamplePixels[i] = pNodes[PixelsCount+i].PixelIndex;
+
+		U32	PixelsStart = 0;
+		for ( int SampleIndex=0; SampleIndex < SHProbe::SAMPLES_COUNT; SampleIndex++ ) {
+			Sample&	S = m_pSamples[SampleIndex];
+			S.PixelsStart = PixelsStart;
+			PixelsStart += S.OriginalPixelsCount;
+		}
+		ASSERT( PixelsStart == U32(PixelsCount), "Samples don't cover the entire cube map!" );
+
+		delete[] pNodes;
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+	// Allocate the flood fill data
+	m_pFloodFillStates = new U32[PixelsCount];
+	m_pFloodFillPositions = new float3[PixelsCount];
+	m_pFloodFillNormals = new float3[PixelsCount];
+	m_pFloodFillAlbedos = new float3[PixelsCount];
+
+	m_pFloodFillPixels = new U32[m_MaxSamplePixelsCount];
+	m_pFloodFillRejectedPixels = new U32[m_MaxSamplePixelsCount];
+	m_pFloodFillSeeds = new FloodFillSeed[1+2*m_MaxSamplePixelsCount];	// Each accepted pixel pushes its top & bottom neighbors
+
+	m_ImportanceThreshold = 0.0f;
+	m_DistanceThreshold = 0.02f;						// 2cm
+	m_AngularThreshold = acosf( 0.5f * PI / 180 );		// 0.5
+	m_AlbedoHueThreshold = 0.04f;						// Close colors!
+	m_AlbedoRGBThreshold = 0.16f;						// Close colors!
+	m_bHasProjectedSH = false;
 
 	m_SamplePixelGroups.Init( m_MaxSamplePixelsCount );	// Worst case scenario: only 1 pixel per group in each sample so as many groups as pixels!
-//	m_EmissiveSurfaces.Init( 6*CUBE_MAP_FACE_SIZE );	// Worst case scenario: all pixels in the cube map are a different emissive material!
+m_EmissiveSurfaces.Reserve( 1024 );	// Maximum amount of emissive materials. ComputeFloodFill() keeps pointers to the surfaces while building them so the list must never grow!
 }
 
 SHProbeEncoder::~SHProbeEncoder() {
-	SAFE_DELETE_ARRAY( Pixel::ms_RadixNodes[1] );
-	SAFE_DELETE_ARRAY( Pixel::ms_RadixNodes[0] );
+	SAFE_DELETE_ARRAY( m_pFloodFillSeeds );
+	SAFE_DELETE_ARRAY( m_pFloodFillRejectedPixels );
+	SAFE_DELETE_ARRAY( m_pFloodFillPixels );
+	SAFE_DELETE_ARRAY( m_pFloodFillAlbedos );
+	SAFE_DELETE_ARRAY( m_pFloodFillNormals );
+	SAFE_DELETE_ARRAY( m_pFloodFillPositions );
+	SAFE_DELETE_ARRAY( m_pFloodFillStates );
+	SAFE_DELETE_ARRAY( m_pSamplePixels );
 	SAFE_DELETE_ARRAY( m_pCubeMapPixels );
 }
 
-void	SHProbeEncoder::BuildProbeNeighborIDs( Texture2D& _StagingCubeMap, SHProbe& _Probe ) {
+void	SHProbeEncoder::BuildProbeNeighborIDs( Texture2D& _StagingCubeMap, SHProbe& _Probe, const U32* _pFaceSizes ) {
 	U32	ProbesCount = m_pOwner->m_ProbesCount;
 	int	TotalPixelsCount = 6*CUBE_MAP_FACE_SIZE;
 
@@ -229,15 +264,18 @@ void	SHProbeEncoder::BuildProbeNeighborIDs( Texture2D& _StagingCubeMap, SHProbe&
 	for ( int CubeFaceIndex=0; CubeFaceIndex < 6; CubeFaceIndex++ ) {
 		Pixel*	pCubeMapPixels = &m_pCubeMapPixels[CubeFaceIndex*CUBE_MAP_FACE_SIZE];
 
-		D3D11_MAPPED_SUBRESOURCE	Map = _StagingCubeMap.Map( 0, CubeFaceIndex );
+		U32	FaceSize = _pFaceSizes != NULL ? _pFaceSizes[CubeFaceIndex] : CUBE_MAP_SIZE;
+		ASSERT( FaceSize > 0 && FaceSize <= CUBE_MAP_SIZE && (CUBE_MAP_SIZE % FaceSize) == 0, "Invalid cube face resolution!" );
 
-		float4*	pFaceData = (float4*) Map.pData;
+		D3D11_MAPPED_SUBRESOURCE	Map = _StagingCubeMap.Map( 0, CubeFaceIndex );
 
 		Pixel*	P = pCubeMapPixels;
 		for ( int Y=0; Y < CUBE_MAP_SIZE; Y++ )
-			for ( int X=0; X < CUBE_MAP_SIZE; X++, P++, pFaceData++ ) {
+			for ( int X=0; X < CUBE_MAP_SIZE; X++, P++ ) {
+				const float4*	pFaceData = GetFaceTexel( Map, FaceSize, X, Y );
+
 				// ==== Read back neighbor probes ID & distance ====
-				P->NeighborProbeID = ((U32&) pFaceData->x);
+				P->NeighborProbeID = ((const U32&) pFaceData->x);
 				P->NeighborProbeDistance = pFaceData->y;
 			}
 
@@ -279,8 +317,10 @@ void	SHProbeEncoder::BuildProbeNeighborIDs( Texture2D& _StagingCubeMap, SHProbe&
 		(*NP)->pInfo->Direction = (*NP)->pInfo->Direction + P.View;
 
 		// Accumulate SH for neighbor's exchange of energy
+		double	SHCoeffs[9];
+		P.BuildSHCoeffs( SHCoeffs );
 		for ( int i=0; i < 9; i++ ) {
-			(*NP)->SH[i] += P.SolidAngle * P.SHCoeffs[i];
+			(*NP)->SH[i] += P.SolidAngle * SHCoeffs[i];
 		}
 
 		// Check if it's a pixel we can use for direct visibility evaluation
@@ -313,8 +353,8 @@ void	SHProbeEncoder::BuildProbeNeighborIDs( Texture2D& _StagingCubeMap, SHProbe&
 
 	// Sort from most important to least important neighbor
 	{
-		class	Comparer : public IComparer<NeighborProbe> {
-		public:	virtual int		Compare( const NeighborProbe& a, const NeighborProbe& b ) const {
+		class	Comparer {
+		public:	int		Compare( const NeighborProbe& a, const NeighborProbe& b ) const {
 				if ( a.SolidAngle < b.SolidAngle )
 					return -1;
 				if ( a.SolidAngle > b.SolidAngle )
@@ -327,50 +367,23 @@ void	SHProbeEncoder::BuildProbeNeighborIDs( Texture2D& _StagingCubeMap, SHProbe&
 	}
 }
 
-void	SHProbeEncoder::BuildProbeVoronoiCell( Texture2D& _StagingCubeMap, SHProbe& _Probe ) {
-	U32	ProbesCount = m_pOwner->m_ProbesCount;
-	int	TotalPixelsCount = 6*CUBE_MAP_FACE_SIZE;
-
-	//////////////////////////////////////////////////////////////////////////
-	// 1] Read back neighbor Vorono IDs
-	//
-	for ( int CubeFaceIndex=0; CubeFaceIndex < 6; CubeFaceIndex++ ) {
-		Pixel*	pCubeMapPixels = &m_pCubeMapPixels[CubeFaceIndex*CUBE_MAP_FACE_SIZE];
-
-		D3D11_MAPPED_SUBRESOURCE	Map = _StagingCubeMap.Map( 0, CubeFaceIndex );
-
-		float4*	pFaceData = (float4*) Map.pData;
-
-		Pixel*	P = pCubeMapPixels;
-		for ( int Y=0; Y < CUBE_MAP_SIZE; Y++ )
-			for ( int X=0; X < CUBE_MAP_SIZE; X++, P++, pFaceData++ ) {
-				P->VoronoiProbeID = ((U32&) pFaceData->x);
-			}
-
-		_StagingCubeMap.UnMap( 0, CubeFaceIndex );
-	}
+void	SHProbeEncoder::BuildProbeVoronoiCell( SHProbe& _Probe ) {
+	const float3&	P0 = _Probe.m_wsPosition;
 
 	//////////////////////////////////////////////////////////////////////////
-	// 2] Build the neighbor probes network
+	// 1] Gather the bisector planes with all the directly visible neighbors
 	//
-	const float3&	P0 = _Probe.m_wsPosition;
-
-	Dictionary<SHProbe::VoronoiProbeInfo*>	VoronoiProbeID2Probe;
-	for ( int PixelIndex=0; PixelIndex < TotalPixelsCount; PixelIndex++ ) {
-		Pixel&	P = m_pCubeMapPixels[PixelIndex];
-		if ( P.VoronoiProbeID == ~0UL ) {
+	List< SHProbe::VoronoiProbeInfo >	Candidates( _Probe.m_NeighborProbes.GetCount() );
+	float	MaxDistance = 0.0f;
+	for ( int NeighborIndex=0; NeighborIndex < _Probe.m_NeighborProbes.GetCount(); NeighborIndex++ ) {
+		const SHProbe::NeighborProbeInfo&	NP = _Probe.m_NeighborProbes[NeighborIndex];
+		if ( !NP.DirectlyVisible )
 			continue;
-		}
 
-		SHProbe::VoronoiProbeInfo**	VP = VoronoiProbeID2Probe.Get( P.VoronoiProbeID );
-		if ( VP != NULL ) {
-			continue;
-		}
-
-		ASSERT( P.VoronoiProbeID < ProbesCount, "Probe index out of range!" );
+		ASSERT( NP.ProbeID < m_pOwner->m_ProbesCount, "Probe index out of range!" );
 
 		// Compute the center and normal of the plane
-		const float3&	P1 = m_pOwner->m_pProbes[P.VoronoiProbeID].m_wsPosition;
+		const float3&	P1 = m_pOwner->m_pProbes[NP.ProbeID].m_wsPosition;
 		float3			N = P0 - P1;
 		float			Distance = N.Length();
 		if ( Distance < 1e-3f ) {
@@ -379,21 +392,53 @@ void	SHProbeEncoder::BuildProbeVoronoiCell( Texture2D& _StagingCubeMap, SHProbe&
 		}
 		N = N / Distance;
 
-		SHProbe::VoronoiProbeInfo&	Temp = _Probe.m_VoronoiProbes.Append();
-		Temp.ProbeID = P.VoronoiProbeID;
+		SHProbe::VoronoiProbeInfo&	Temp = Candidates.Append();
+		Temp.ProbeID = NP.ProbeID;
 		Temp.PlanePosition = P1 + 0.5f * Distance * N;
 		Temp.PlaneNormal = N;
 
-		VP = &VoronoiProbeID2Probe.Add( P.VoronoiProbeID, &Temp );
+		MaxDistance = MAX( MaxDistance, Distance );
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+	// 2] Only keep the planes actually bounding the cell
+	// The face of the cell lying on a plane is what remains of the plane once cut by all the other planes, it's empty
+	//	if the plane is hidden behind the others
+	//
+	float	Radius = MIN( 100.0f, 2.0f * MaxDistance );	// Planes are bounded by squares of that half size, as large as the cells of the probes at the boundary of the network can get
+	float	MinArea = 1e-6f * Radius * Radius;
+
+	_Probe.m_VoronoiProbes.Init( Candidates.GetCount() );
+	for ( int PlaneIndex=0; PlaneIndex < Candidates.GetCount(); PlaneIndex++ ) {
+		const SHProbe::VoronoiProbeInfo&	Plane = Candidates[PlaneIndex];
+
+		SHProbe::CellPolygon	Polygon( Plane.PlanePosition, Plane.PlaneNormal, Radius );
+		for ( int OtherPlaneIndex=0; OtherPlaneIndex < Candidates.GetCount() && Polygon.GetVertices().GetCount() >= 3; OtherPlaneIndex++ )
+			if ( OtherPlaneIndex != PlaneIndex )
+				Polygon.Cut( Candidates[OtherPlaneIndex].PlanePosition, Candidates[OtherPlaneIndex].PlaneNormal );
+
+		if ( Polygon.GetVertices().GetCount() >= 3 && Polygon.ComputeArea() > MinArea )
+			_Probe.m_VoronoiProbes.Append( Plane );
 	}
 }
 
-void	SHProbeEncoder::EncodeProbeCubeMap( Texture2D& _StagingCubeMap, SHProbe& _Probe, U32 _SceneTotalFacesCount ) {
+void	SHProbeEncoder::EncodeProbeCubeMap( Texture2D& _StagingCubeMap, SHProbe& _Probe, U32 _SceneTotalFacesCount, const U32* _pFaceSizes ) {
+	ReadBackProbeCubeMap( _StagingCubeMap, _SceneTotalFacesCount, _pFaceSizes );
+	EncodeProbe( _Probe );
+}
+
+void	SHProbeEncoder::SetProjectedSH( const float4 _pSH[9] ) {
+	memcpy_s( m_pProjectedSH, sizeof(m_pProjectedSH), _pSH, 9*sizeof(float4) );
+	m_bHasProjectedSH = true;
+}
+
+void	SHProbeEncoder::EncodeProbe( SHProbe& _Probe ) {
+	TRACE_SCOPE( "SHProbeEncoder::EncodeProbe" );
 	int	TotalPixelsCount = 6*CUBE_MAP_FACE_SIZE;
 
 	//////////////////////////////////////////////////////////////////////////
-	// 1] Read back probe data and prepare pixels for encoding
-	ReadBackProbeCubeMap( _StagingCubeMap, _SceneTotalFacesCount );
+	// 1] Prepare the pixels read back from the cube map for encoding
+	SmoothCubeMapPixels();
 
 	_Probe.m_MeanDistance = float( m_MeanDistance );
 	_Probe.m_MeanHarmonicDistance = float( m_MeanHarmonicDistance );
@@ -408,28 +453,38 @@ void	SHProbeEncoder::EncodeProbeCubeMap( Texture2D& _StagingCubeMap, SHProbe& _P
 	//
 
 	// 2.1) ======== Build occlusion & static lighting SH ========
-	double	SHR[9] = { 0.0 };
-	double	SHG[9] = { 0.0 };
-	double	SHB[9] = { 0.0 };
-	double	SHOcclusion[9] = { 0.0 };
-
-	for ( int PixelIndex=0; PixelIndex < TotalPixelsCount; PixelIndex++ ) {
-		Pixel&	P = m_pCubeMapPixels[PixelIndex];
+	if ( m_bHasProjectedSH ) {
+		// Already projected by the GPU
 		for ( int i=0; i < 9; i++ ) {
-			// Accumulate smoothed out static lighting
-			SHR[i] += P.SolidAngle * P.SmoothedStaticLitColor.x * P.SHCoeffs[i];
-			SHG[i] += P.SolidAngle * P.SmoothedStaticLitColor.y * P.SHCoeffs[i];
-			SHB[i] += P.SolidAngle * P.SmoothedStaticLitColor.z * P.SHCoeffs[i];
-
-			// No obstacle means direct lighting from the ambient sky...
-			// Accumulate SH coefficients in that direction, weighted by the solid angle
-			SHOcclusion[i] += P.SolidAngle * P.SmoothedInfinity * P.SHCoeffs[i];
+			_Probe.m_pSHStaticLighting[i].Set( m_pProjectedSH[i].x, m_pProjectedSH[i].y, m_pProjectedSH[i].z );
+			_Probe.m_pSHOcclusion[i] = m_pProjectedSH[i].w;
+		}
+	} else {
+		double	SHR[9] = { 0.0 };
+		double	SHG[9] = { 0.0 };
+		double	SHB[9] = { 0.0 };
+		double	SHOcclusion[9] = { 0.0 };
+
+		for ( int PixelIndex=0; PixelIndex < TotalPixelsCount; PixelIndex++ ) {
+			Pixel&	P = m_pCubeMapPixels[PixelIndex];
+			double	SHCoeffs[9];
+			P.BuildSHCoeffs( SHCoeffs );
+			for ( int i=0; i < 9; i++ ) {
+				// Accumulate smoothed out static lighting
+				SHR[i] += P.SolidAngle * P.SmoothedStaticLitColor.x * SHCoeffs[i];
+				SHG[i] += P.SolidAngle * P.SmoothedStaticLitColor.y * SHCoeffs[i];
+				SHB[i] += P.SolidAngle * P.SmoothedStaticLitColor.z * SHCoeffs[i];
+
+				// No obstacle means direct lighting from the ambient sky...
+				// Accumulate SH coefficients in that direction, weighted by the solid angle
+				SHOcclusion[i] += P.SolidAngle * P.SmoothedInfinity * SHCoeffs[i];
+			}
 		}
-	}
 
-	for ( int i=0; i < 9; i++ ) {
-		_Probe.m_pSHStaticLighting[i].Set( (float) SHR[i], (float) SHG[i], (float) SHB[i] );
-		_Probe.m_pSHOcclusion[i] = (float) SHOcclusion[i];
+		for ( int i=0; i < 9; i++ ) {
+			_Probe.m_pSHStaticLighting[i].Set( (float) SHR[i], (float) SHG[i], (float) SHB[i] );
+			_Probe.m_pSHOcclusion[i] = (float) SHOcclusion[i];
+		}
 	}
 
 	// 2.2) ======== Apply filtering ========
@@ -510,39 +565,37 @@ void	SHProbeEncoder::SavePixels( const char* _FileName ) const {
 
 #pragma region Computes Sample Pixels by Flood Fill Method
 
-int	DEBUG_PixelIndex = 0;
-
 void	SHProbeEncoder::ComputeFloodFill( SHProbe& _Probe, float _SpatialDistanceWeight, float _NormalDistanceWeight, float _AlbedoDistanceWeight, float _MinimumImportanceDiscardThreshold ) {
+	TRACE_SCOPE( "SHProbeEncoder::ComputeFloodFill" );
 	int	TotalPixelsCount = 6*CUBE_MAP_FACE_SIZE;
  	U32	DiscardThreshold = U32( 0.004f * m_ScenePixelsCount );		// Discard surfaces that contain less than 0.4% of the total amount of scene pixels (arbitrary!)
 
 	// Setup the reference thresholds for pixels' acceptance
 //	Pixel.IMPORTANCE_THRESOLD = (float) ((4.0f * Math.PI / CUBE_MAP_FACE_SIZE) / (m_MeanDistance * m_MeanDistance));	// Compute an average solid angle threshold based on average pixels' distance
-	Pixel::IMPORTANCE_THRESOLD = (float) (0.1f * _MinimumImportanceDiscardThreshold / (m_MeanHarmonicDistance * m_MeanHarmonicDistance));	// Simply use the mean harmonic distance as a good approximation of important pixels
+	m_ImportanceThreshold = (float) (0.1f * _MinimumImportanceDiscardThreshold / (m_MeanHarmonicDistance * m_MeanHarmonicDistance));	// Simply use the mean harmonic distance as a good approximation of important pixels
 																									// Pixels that are further or not facing the probe will have less importance...
 
-	DISTANCE_THRESHOLD = 0.30f * _SpatialDistanceWeight;						// 30cm
-	ANGULAR_THRESHOLD = acosf( 45.0f * _NormalDistanceWeight * PI / 180.0f );	// 45 (we're very generous here!)
-	ALBEDO_HUE_THRESHOLD = 0.04f * _AlbedoDistanceWeight;						// Close colors!
-	ALBEDO_RGB_THRESHOLD = 0.32f * _AlbedoDistanceWeight;						// Close colors!
+	m_DistanceThreshold = 0.30f * _SpatialDistanceWeight;						// 30cm
+	m_AngularThreshold = acosf( 45.0f * _NormalDistanceWeight * PI / 180.0f );	// 45 (we're very generous here!)
+	m_AlbedoHueThreshold = 0.04f * _AlbedoDistanceWeight;						// Close colors!
+	m_AlbedoRGBThreshold = 0.32f * _AlbedoDistanceWeight;						// Close colors!
 
 
 	//////////////////////////////////////////////////////////////////////////
-	// Initialize the list of pixels belonging to each sample
+	// Initialize the samples and the compact flood fill data of their pixels
 	{
 		for ( int SampleIndex=0; SampleIndex < SHProbe::SAMPLES_COUNT; SampleIndex++ ) {
 			Sample&	S = m_pSamples[SampleIndex];
-			S.PixelsCount = 0;
-			S.pPixels = NULL;	// No pixel in that sample at the moment...
-		}
-
-		Pixel*	pPixel = m_pCubeMapPixels;
-		for ( int PixelIndex=0; PixelIndex < TotalPixelsCount; PixelIndex++, pPixel++ ) {
-			pPixel->pNext = pPixel->pParentSample->pPixels;
-			pPixel->pParentSample->pPixels = pPixel;
-			pPixel->pParentSample->PixelsCount++;
-			pPixel->pParentList = NULL;
-			pPixel->pNextInList = NULL;
+			S.PixelsCount = S.OriginalPixelsCount;
+
+			for ( U32 i=0; i < S.OriginalPixelsCount; i++ ) {
+				U32				PixelIndex = m_pSamplePixels[S.PixelsStart+i];
+				const Pixel&	P = m_pCubeMapPixels[PixelIndex];
+				m_pFloodFillStates[PixelIndex] = P.IsFloodFillAcceptable( m_ImportanceThreshold ) ? U32(SampleIndex) : FLOOD_FILL_DISCARDED;
+				m_pFloodFillPositions[PixelIndex] = P.SmoothedDistance * P.View;
+				m_pFloodFillNormals[PixelIndex] = P.wsNormal;
+				m_pFloodFillAlbedos[PixelIndex] = P.Albedo;
+			}
 		}
 	}
 
@@ -558,36 +611,34 @@ GroupImportanceThreshold = 0.0;	// No rejection for now...
 	float	SampleRadiusAvg = 0.0f;
 	int		ValidSamplesCount = 0;
 	for ( int SampleIndex=0; SampleIndex < SHProbe::SAMPLES_COUNT; SampleIndex++ ) {
-		Sample&	S = m_pSamples[SampleIndex];
+		Sample&		S = m_pSamples[SampleIndex];
+		const U32*	pSamplePixels = m_pSamplePixels + S.PixelsStart;
 
 		// Build the lists of pixel groups for that sample
+		// (pixels are visited in decreasing index order, like the linked lists we used to build)
 		m_SamplePixelGroups.Clear();
-		Pixel*	pPixel = S.pPixels;
-		while ( pPixel != NULL ) {
-			if ( pPixel->pParentList == NULL && pPixel->IsFloodFillAcceptable( S ) ) {
-
-				// Propagate from the current pixel and form a coherent group
-				PixelsList&	AcceptedPixels = m_SamplePixelGroups.Append();
-				AcceptedPixels.PixelsCount = 0;
-				AcceptedPixels.pPixels = NULL;
-				AcceptedPixels.Importance = 0.0;
-
-				PixelsList	RejectedPixels;
-
-				m_ScanlinePixelIndex = 0;		// VEEERY important line where we reset the pixel index of the pool of flood filled pixels!
-				FloodFill( S, pPixel, pPixel, AcceptedPixels, RejectedPixels );
-				ASSERT( m_ScanlinePixelIndex > 0, "Can't have empty samples!" );
-
-				// Restore pixels rejected by that group since they may be useful for another group
-				while ( RejectedPixels.pPixels != NULL ) {
-					Pixel*	pTemp = RejectedPixels.pPixels;
-					ASSERT( pTemp >= m_pCubeMapPixels && pTemp < m_pCubeMapPixels+6*CUBE_MAP_FACE_SIZE, "Oh!" );
-					RejectedPixels.pPixels = RejectedPixels.pPixels->pNextInList;
-					pTemp->pParentList = NULL;
-					pTemp->pNextInList = NULL;
-				}
+		U32	GroupsPixelsCount = 0;
+		for ( U32 i=S.OriginalPixelsCount; i > 0; i-- ) {
+			U32	PixelIndex = pSamplePixels[i-1];
+			if ( m_pFloodFillStates[PixelIndex] != U32(SampleIndex) )
+				continue;	// Already part of a group or not acceptable
+
+			// Propagate from the current pixel and form a coherent group
+			PixelsList&	AcceptedPixels = m_SamplePixelGroups.Append();
+			AcceptedPixels.PixelsStart = GroupsPixelsCount;
+			AcceptedPixels.PixelsCount = 0;
+			AcceptedPixels.Importance = 0.0;
+
+			U32	RejectedPixelsCount = 0;
+			FloodFill( SampleIndex, PixelIndex, AcceptedPixels, RejectedPixelsCount );
+			ASSERT( AcceptedPixels.PixelsCount > 0, "Can't have empty samples!" );
+			GroupsPixelsCount += AcceptedPixels.PixelsCount;
+
+			// Restore pixels rejected by that group since they may be useful for another group
+			for ( U32 RejectedPixelIndex=0; RejectedPixelIndex < RejectedPixelsCount; RejectedPixelIndex++ ) {
+				ASSERT( m_pFloodFillStates[m_pFloodFillRejectedPixels[RejectedPixelIndex]] == FLOOD_FILL_REJECTED, "Oh!" );
+				m_pFloodFillStates[m_pFloodFillRejectedPixels[RejectedPixelIndex]] = SampleIndex;
 			}
-			pPixel = pPixel->pNext;
 		}
 
 		// Keep only the most interesting group
@@ -601,16 +652,13 @@ GroupImportanceThreshold = 0.0;	// No rejection for now...
 
 		if ( pBestGroup == NULL || pBestGroup->Importance < GroupImportanceThreshold ) {
 			// Discard this sample entirely as it's not important enough
-			S.pPixels = NULL;
 			S.PixelsCount = 0;
 			continue;
 		}
 
 		// Clear used flag for all pixels
-		pPixel = S.pPixels;
-		while ( pPixel != NULL ) {
-			pPixel->bUsedForSampling = false;
-			pPixel = pPixel->pNext;
+		for ( U32 i=0; i < S.OriginalPixelsCount; i++ ) {
+			m_pCubeMapPixels[pSamplePixels[i]].bUsedForSampling = false;
 		}
 
 		// ================================================================================
@@ -620,14 +668,14 @@ GroupImportanceThreshold = 0.0;	// No rejection for now...
 		S.AverageDirection = float3::Zero;
 		S.Albedo = float3::Zero;
 
-		pPixel = pBestGroup->pPixels;
-		while ( pPixel != NULL ) {
-			S.lsPosition = S.lsPosition + pPixel->lsPosition;
-			S.wsNormal = S.wsNormal + pPixel->wsNormal;
-			S.AverageDirection = S.AverageDirection + pPixel->View;
-			S.Albedo = S.Albedo + pPixel->Albedo;
-			pPixel->bUsedForSampling = true;	// Mark the pixel as used for sampling
-			pPixel = pPixel->pNextInList;
+		const U32*	pGroupPixels = m_pFloodFillPixels + pBestGroup->PixelsStart;
+		for ( U32 i=0; i < pBestGroup->PixelsCount; i++ ) {
+			Pixel&	P = m_pCubeMapPixels[pGroupPixels[i]];
+			S.lsPosition = S.lsPosition + P.lsPosition;
+			S.wsNormal = S.wsNormal + P.wsNormal;
+			S.AverageDirection = S.AverageDirection + P.View;
+			S.Albedo = S.Albedo + P.Albedo;
+			P.bUsedForSampling = true;	// Mark the pixel as used for sampling
 		}
 
 		SHProbe::Sample&	TargetSample = _Probe.m_pSamples[SampleIndex];
@@ -644,11 +692,9 @@ GroupImportanceThreshold = 0.0;	// No rejection for now...
 		// Build the radius
 		// This is an important data as a value of 0 would discard the sample at runtime
 		float	AverageSqDistance = 0.0f;
-		pPixel = pBestGroup->pPixels;
-		while ( pPixel != NULL ) {
-			float3	D = pPixel->lsPosition - S.lsPosition;
+		for ( U32 i=0; i < pBestGroup->PixelsCount; i++ ) {
+			float3	D = m_pCubeMapPixels[pGroupPixels[i]].lsPosition - S.lsPosition;
 			AverageSqDistance += D.LengthSq();
-			pPixel = pPixel->pNextInList;
 		}
 		AverageSqDistance *= Normalizer;
 		TargetSample.Radius = sqrtf( AverageSqDistance );
@@ -683,14 +729,12 @@ GroupImportanceThreshold = 0.0;	// No rejection for now...
 		}
 
 		// Accumulate SH
+		double	SHCoeffs[9];
+		pPixel->BuildSHCoeffs( SHCoeffs );
 		for ( int i=0; i < 9; i++ ) {
-			pSurface->SH[i] += pPixel->SHCoeffs[i];
+			pSurface->SH[i] += SHCoeffs[i];
 		}
 		pSurface->SolidAngle += pPixel->SolidAngle;
-
-		// Link
-		pPixel->pNext = pSurface->pPixels;
-		pSurface->pPixels = pPixel;
 		pSurface->PixelsCount++;
 	}
 
@@ -728,100 +772,106 @@ GroupImportanceThreshold = 0.0;	// No rejection for now...
 // The idea here is to process an entire scanline first (going left and right and collecting valid pixels along the way)
 //  then for each of these pixels we move up/down and fill the top/bottom scanlines from these new seeds...
 //
-void	SHProbeEncoder::FloodFill( Sample& _Sample, Pixel* _PreviousPixel, Pixel* _P, PixelsList& _AcceptedPixels, PixelsList& _RejectedPixels ) const {
-
-	static int	RecursionLevel = 0;	// For debugging purpose
-
-	if ( !CheckAndAcceptPixel( _Sample, *_PreviousPixel, *_P, _AcceptedPixels, _RejectedPixels ) )
-		return;
+// The seeds are stored on an explicit stack instead of recursing: they're pushed in reverse order so they're popped
+//	in the exact order the recursive version used to visit them, and since pixels are only accepted when popped we get the same groups.
+//
+void	SHProbeEncoder::FloodFill( U32 _SampleIndex, U32 _SeedPixelIndex, PixelsList& _AcceptedPixels, U32& _RejectedPixelsCount ) {
+	TRACE_SCOPE( "SHProbeEncoder::FloodFill" );
+	U32	SeedsCount = 0;
+	m_pFloodFillSeeds[SeedsCount].PreviousPixelIndex = _SeedPixelIndex;
+	m_pFloodFillSeeds[SeedsCount].PixelIndex = _SeedPixelIndex;
+	SeedsCount++;
+
+	while ( SeedsCount > 0 ) {
+		FloodFillSeed	Seed = m_pFloodFillSeeds[--SeedsCount];
+		if ( !CheckAndAcceptPixel( _SampleIndex, Seed.PreviousPixelIndex, Seed.PixelIndex, _AcceptedPixels, _RejectedPixelsCount ) )
+			continue;
 
-	//////////////////////////////////////////////////////////////////////////
-	// Check the entire scanline
-	int	ScanlineStartIndex = m_ScanlinePixelIndex;
-	m_ppScanlinePixelsPool[m_ScanlinePixelIndex++] = _P;	// This pixel is implicitly on the scanline
-
-	{	// Start going right
-		CubeMapPixelWalker	P( *this, *_P );
-		Pixel*	Previous = _P;
-		Pixel*	Current = &P.Right();
-		while ( CheckAndAcceptPixel( _Sample, *Previous, *Current, _AcceptedPixels, _RejectedPixels ) ) {
-			m_ppScanlinePixelsPool[m_ScanlinePixelIndex++] = Current;
-			Previous = Current;
-			Current = &P.Right();
+		//////////////////////////////////////////////////////////////////////////
+		// Check the entire scanline
+		// Accepted pixels are appended to the group so the scanline ends up being the last pixels of the group
+		U32	ScanlineStartIndex = _AcceptedPixels.PixelsStart + _AcceptedPixels.PixelsCount - 1;	// This pixel is implicitly on the scanline
+
+		{	// Start going right
+			CubeMapPixelWalker	P( *this, Seed.PixelIndex );
+			U32	Previous = Seed.PixelIndex;
+			P.Right();
+			while ( CheckAndAcceptPixel( _SampleIndex, Previous, P.GetIndex(), _AcceptedPixels, _RejectedPixelsCount ) ) {
+				Previous = P.GetIndex();
+				P.Right();
+			}
 		}
-	}
 
-	{	// Start going left
-		CubeMapPixelWalker	P( *this, *_P );
-		Pixel*	Previous = _P;
-		Pixel*	Current = &P.Left();
-		while ( CheckAndAcceptPixel( _Sample, *Previous, *Current, _AcceptedPixels, _RejectedPixels ) ) {
-			m_ppScanlinePixelsPool[m_ScanlinePixelIndex++] = Current;
-			Previous = Current;
-			Current = &P.Left();
+		{	// Start going left
+			CubeMapPixelWalker	P( *this, Seed.PixelIndex );
+			U32	Previous = Seed.PixelIndex;
+			P.Left();
+			while ( CheckAndAcceptPixel( _SampleIndex, Previous, P.GetIndex(), _AcceptedPixels, _RejectedPixelsCount ) ) {
+				Previous = P.GetIndex();
+				P.Left();
+			}
 		}
-	}
 
-	int	ScanlineEndIndex = m_ScanlinePixelIndex;
+		U32	ScanlineEndIndex = _AcceptedPixels.PixelsStart + _AcceptedPixels.PixelsCount;
+		ASSERT( SeedsCount + 2 * (ScanlineEndIndex - ScanlineStartIndex) <= 1+2*m_MaxSamplePixelsCount, "Flood fill stack overflow!" );
 
-	//////////////////////////////////////////////////////////////////////////
-	// Recurse into each pixel of the top scanline
-	RecursionLevel++;
+		//////////////////////////////////////////////////////////////////////////
+		// Push the pixels of the bottom scanline, then the pixels of the top scanline so they're visited first
+		for ( U32 ScanlinePixelIndex=ScanlineEndIndex; ScanlinePixelIndex > ScanlineStartIndex; ScanlinePixelIndex-- ) {
+			U32	PixelIndex = m_pFloodFillPixels[ScanlinePixelIndex-1];
 
-	for ( int ScanlinePixelIndex=ScanlineStartIndex; ScanlinePixelIndex < ScanlineEndIndex; ScanlinePixelIndex++ ) {
-		Pixel*	P = m_ppScanlinePixelsPool[ScanlinePixelIndex];
-
-		CubeMapPixelWalker	Walker( *this, *P );
-		Pixel*	Top = &Walker.Up();
-		FloodFill( _Sample, P, Top, _AcceptedPixels, _RejectedPixels );
-	}
+			CubeMapPixelWalker	Walker( *this, PixelIndex );
+			Walker.Down();
+			m_pFloodFillSeeds[SeedsCount].PreviousPixelIndex = PixelIndex;
+			m_pFloodFillSeeds[SeedsCount].PixelIndex = Walker.GetIndex();
+			SeedsCount++;
+		}
 
-	//////////////////////////////////////////////////////////////////////////
-	// Recurse into each pixel of the bottom scanline
-	for ( int ScanlinePixelIndex=ScanlineStartIndex; ScanlinePixelIndex < ScanlineEndIndex; ScanlinePixelIndex++ ) {
-		Pixel*	P = m_ppScanlinePixelsPool[ScanlinePixelIndex];
+		for ( U32 ScanlinePixelIndex=ScanlineEndIndex; ScanlinePixelIndex > ScanlineStartIndex; ScanlinePixelIndex-- ) {
+			U32	PixelIndex = m_pFloodFillPixels[ScanlinePixelIndex-1];
 
-		CubeMapPixelWalker	Walker( *this, *P );
-		Pixel*	Bottom = &Walker.Down();
-		FloodFill( _Sample, P, Bottom, _AcceptedPixels, _RejectedPixels );
+			CubeMapPixelWalker	Walker( *this, PixelIndex );
+			Walker.Up();
+			m_pFloodFillSeeds[SeedsCount].PreviousPixelIndex = PixelIndex;
+			m_pFloodFillSeeds[SeedsCount].PixelIndex = Walker.GetIndex();
+			SeedsCount++;
+		}
 	}
-
-	RecursionLevel--;
 }
 
-bool	SHProbeEncoder::CheckAndAcceptPixel( Sample& _Sample, Pixel& _PreviousPixel, Pixel& _P, PixelsList& _AcceptedPixels, PixelsList& _RejectedPixels ) const {
+bool	SHProbeEncoder::CheckAndAcceptPixel( U32 _SampleIndex, U32 _PreviousPixelIndex, U32 _PixelIndex, PixelsList& _AcceptedPixels, U32& _RejectedPixelsCount ) {
 	// Start by checking if we can use that pixel at all
-	if ( !_P.IsFloodFillAcceptable( _Sample ) ) {
-		return false;
+	if ( m_pFloodFillStates[_PixelIndex] != _SampleIndex ) {
+		return false;	// Already part of a list, part of another sample or not acceptable on its own
 	}
 
 	// Check some additional criterions for a match
 	bool	Accepted = false;
 
 	// First, let's check the angular discrepancy
-	float	Dot = _PreviousPixel.wsNormal | _P.wsNormal;
-	if ( Dot > ANGULAR_THRESHOLD ) {
+	float	Dot = m_pFloodFillNormals[_PreviousPixelIndex] | m_pFloodFillNormals[_PixelIndex];
+	if ( Dot > m_AngularThreshold ) {
 		// Next, let's check the distance discrepancy
-		float3	P0 = _PreviousPixel.SmoothedDistance * _PreviousPixel.View;
-		float3	P1 = _P.SmoothedDistance * _P.View;
-		float	DistanceDiff = (P1 - P0).LengthSq();
-		if ( DistanceDiff < DISTANCE_THRESHOLD*DISTANCE_THRESHOLD ) {
+		float	DistanceDiff = (m_pFloodFillPositions[_PixelIndex] - m_pFloodFillPositions[_PreviousPixelIndex]).LengthSq();
+		if ( DistanceDiff < m_DistanceThreshold*m_DistanceThreshold ) {
 			// Next, let's check color discrepancy (I'm using the simplest metric here...)
-			float	ColorDiff = (_PreviousPixel.Albedo - _P.Albedo).LengthSq();
-			if ( ColorDiff < ALBEDO_RGB_THRESHOLD*ALBEDO_RGB_THRESHOLD ) {
+			float	ColorDiff = (m_pFloodFillAlbedos[_PreviousPixelIndex] - m_pFloodFillAlbedos[_PixelIndex]).LengthSq();
+			if ( ColorDiff < m_AlbedoRGBThreshold*m_AlbedoRGBThreshold ) {
 				Accepted = true;	// Winner!
 			}
 		}
 	}
 
 	// Add the pixel to the proper list
-	PixelsList&	Target = Accepted ? _AcceptedPixels : _RejectedPixels;
-	_P.pNextInList = Target.pPixels;
-	ASSERT( _P.pNextInList == NULL || (_P.pNextInList >= m_pCubeMapPixels && _P.pNextInList < m_pCubeMapPixels+6*CUBE_MAP_FACE_SIZE), "Oh!" );
-	_P.pParentList = &Target;
-	Target.pPixels = &_P;
-	Target.PixelsCount++;
-	Target.Importance += _P.Importance * _P.SolidAngle;
+	if ( Accepted ) {
+		const Pixel&	P = m_pCubeMapPixels[_PixelIndex];
+		m_pFloodFillStates[_PixelIndex] = FLOOD_FILL_ACCEPTED;
+		m_pFloodFillPixels[_AcceptedPixels.PixelsStart + _AcceptedPixels.PixelsCount++] = _PixelIndex;
+		_AcceptedPixels.Importance += P.Importance * P.SolidAngle;
+	} else {
+		m_pFloodFillStates[_PixelIndex] = FLOOD_FILL_REJECTED;
+		m_pFloodFillRejectedPixels[_RejectedPixelsCount++] = _PixelIndex;
+	}
 
 	return Accepted;
 }
@@ -1015,16 +1065,18 @@ static const int	FaceTransforms[6][4][6] = {
 	},
 };
 
-void SHProbeEncoder::CubeMapPixelWalker::Set( Pixel& _Pixel ) {
-	CubeFaceIndex = _Pixel.CubeFaceIndex;
-	pUV[0] = _Pixel.CubeFaceX;
-	pUV[1] = _Pixel.CubeFaceY;
+void SHProbeEncoder::CubeMapPixelWalker::Set( U32 _PixelIndex ) {
+	CubeFaceIndex = _PixelIndex / CUBE_MAP_FACE_SIZE;
+	pUV[0] = _PixelIndex % CUBE_MAP_SIZE;
+	pUV[1] = (_PixelIndex / CUBE_MAP_SIZE) % CUBE_MAP_SIZE;
 	pRight[0] = 1;	pRight[1] = 0;
 	pDown[0] = 0;	pDown[1] = 1;
 }
+U32	SHProbeEncoder::CubeMapPixelWalker::GetIndex() const {
+	return CUBE_MAP_FACE_SIZE * CubeFaceIndex + CUBE_MAP_SIZE * pUV[1] + pUV[0];
+}
 SHProbeEncoder::Pixel&	SHProbeEncoder::CubeMapPixelWalker::Get() const {
-	int		FinalPixelIndex = CUBE_MAP_FACE_SIZE * CubeFaceIndex + CUBE_MAP_SIZE * pUV[1] + pUV[0];
-	Pixel&	Result = Owner.m_pCubeMapPixels[FinalPixelIndex];
+	Pixel&	Result = Owner.m_pCubeMapPixels[GetIndex()];
 	return Result;
 }
 SHProbeEncoder::Pixel& SHProbeEncoder::CubeMapPixelWalker::Left() {
@@ -1095,9 +1147,10 @@ void	SHProbeEncoder::CubeMapPixelWalker::GoToAdjacentPixel( int _dU, int _dV ) {
 
 //////////////////////////////////////////////////////////////////////////
 //
-void	SHProbeEncoder::ReadBackProbeCubeMap( Texture2D& _StagingCubeMap, U32 _SceneTotalFacesCount ) {
+void	SHProbeEncoder::ReadBackProbeCubeMap( Texture2D& _StagingCubeMap, U32 _SceneTotalFacesCount, const U32* _pFaceSizes ) {
 
 	m_ScenePixelsCount = 0;
+	m_bHasProjectedSH = false;
 
 	m_MeanDistance = 0.0;
 	m_MeanHarmonicDistance = 0.0;
@@ -1116,19 +1169,21 @@ void	SHProbeEncoder::ReadBackProbeCubeMap( Texture2D& _StagingCubeMap, U32 _Scen
 	for ( int CubeFaceIndex=0; CubeFaceIndex < 6; CubeFaceIndex++ ) {
 		Pixel*	pCubeMapPixels = &m_pCubeMapPixels[CubeFaceIndex*CUBE_MAP_FACE_SIZE];
 
+		U32	FaceSize = _pFaceSizes != NULL ? _pFaceSizes[CubeFaceIndex] : CUBE_MAP_SIZE;
+		ASSERT( FaceSize > 0 && FaceSize <= CUBE_MAP_SIZE && (CUBE_MAP_SIZE % FaceSize) == 0, "Invalid cube face resolution!" );
+
 		D3D11_MAPPED_SUBRESOURCE	Map0 = _StagingCubeMap.Map( 0, 6*0+CubeFaceIndex );
 		D3D11_MAPPED_SUBRESOURCE	Map1 = _StagingCubeMap.Map( 0, 6*1+CubeFaceIndex );
 		D3D11_MAPPED_SUBRESOURCE	Map2 = _StagingCubeMap.Map( 0, 6*2+CubeFaceIndex );
 //		D3D11_MAPPED_SUBRESOURCE	Map3 = _StagingCubeMap.Map( 0, 6*3+CubeFaceIndex );
 
-		float4*	pFaceData0 = (float4*) Map0.pData;
-		float4*	pFaceData1 = (float4*) Map1.pData;
-		float4*	pFaceData2 = (float4*) Map2.pData;
-//		float4*	pFaceData3 = (float4*) Map3.pData;
-
 		Pixel*	P = pCubeMapPixels;
 		for ( int Y=0; Y < CUBE_MAP_SIZE; Y++ )
-			for ( int X=0; X < CUBE_MAP_SIZE; X++, P++, pFaceData0++, pFaceData1++, pFaceData2++ ) {
+			for ( int X=0; X < CUBE_MAP_SIZE; X++, P++ ) {
+				const float4*	pFaceData0 = GetFaceTexel( Map0, FaceSize, X, Y );
+				const float4*	pFaceData1 = GetFaceTexel( Map1, FaceSize, X, Y );
+				const float4*	pFaceData2 = GetFaceTexel( Map2, FaceSize, X, Y );
+
 				// ==== Read back albedo & unique face ID ====
 				float	Red = pFaceData0->x;
 				float	Green = pFaceData0->y;
@@ -1139,12 +1194,12 @@ void	SHProbeEncoder::ReadBackProbeCubeMap( Texture2D& _StagingCubeMap, U32 _Scen
 // 				Green *= PI;
 // 				Blue *= PI;
 
-				P->SetAlbedo( float3( Red, Green, Blue ) );
-				P->FaceIndex = ((U32&) pFaceData0->w);
+				P->Albedo.Set( Red, Green, Blue );
+				P->FaceIndex = ((const U32&) pFaceData0->w);
 
 				// ==== Read back static lighting & emissive material IDs ====
 				P->StaticLitColor = *pFaceData2;
-				P->EmissiveMatID = ((U32&) pFaceData2->w);
+				P->EmissiveMatID = ((const U32&) pFaceData2->w);
 
 				// ==== Read back position & normal ====
 				float	Nx = pFaceData1->x;
@@ -1202,7 +1257,9 @@ NegativeImportancePixelsCount++;
 
 	m_MeanDistance /= (CUBE_MAP_SIZE * CUBE_MAP_SIZE * 6);
 	m_MeanHarmonicDistance = (CUBE_MAP_SIZE * CUBE_MAP_SIZE * 6) / m_MeanHarmonicDistance;
+}
 
+void	SHProbeEncoder::SmoothCubeMapPixels() {
 	// Perform bilateral-filtered smoothing of adjacent distances, static lit colors & infinity values for smoother SH encoding
 	for ( int CubeFaceIndex=0; CubeFaceIndex < 6; CubeFaceIndex++ ) {
 		Pixel*	pCubeMapPixels = &m_pCubeMapPixels[CubeFaceIndex*CUBE_MAP_FACE_SIZE];
@@ -1270,47 +1327,6 @@ const double	SHProbeEncoder::Pixel::f1 = sqrt(3.0) * SHProbeEncoder::Pixel::f0;
 const double	SHProbeEncoder::Pixel::f2 = sqrt(15.0) * SHProbeEncoder::Pixel::f0;
 const double	SHProbeEncoder::Pixel::f3 = sqrt(5.0) * 0.5 * SHProbeEncoder::Pixel::f0;
 
-float	SHProbeEncoder::Pixel::IMPORTANCE_THRESOLD = 0.0f;
-
-SHProbeEncoder::Pixel::RadixNode_t*	SHProbeEncoder::Pixel::ms_RadixNodes[2] = { NULL, NULL };
-void	SHProbeEncoder::Pixel::Sort( Pixel*& _pList, ISortKeyProvider& _KeyProvider, bool _ReverseSortOnExit ) {
-	// Convert linked-list into a sortable list
-	Pixel*			pSource = _pList;
-	RadixNode_t*	pTarget = ms_RadixNodes[0];
-	while ( pSource != NULL ) {
-		pTarget->Key = _KeyProvider.GetKey( *pSource );
-		pTarget->pPixel = pSource;
-		pTarget++;
-		pSource = pSource->pNext;
-	}
-
-	U32	ElementsCount = pTarget - ms_RadixNodes[0];
-	if ( ElementsCount < 2 ) {
-		return;	// Nothing to sort here...
-	}
-
-	// Sort
-	Sort( ElementsCount, ms_RadixNodes[0], ms_RadixNodes[1] );
-
-	// Rebuild sorted linked-list
-	if ( _ReverseSortOnExit ) {
-		// Reversed, largest to smallest sort
-		RadixNode_t*	pNode = ms_RadixNodes[1];
-		_pList = NULL;
-		for ( U32 i=0; i < ElementsCount; i++, pNode++ ) {
-			pNode->pPixel->pNext = _pList;
-			_pList = pNode->pPixel;
-		}
-	} else {
-		// Standard, smallest to largest sort
-		RadixNode_t*	pNode = ms_RadixNodes[1];
-		for ( U32 i=0; i < ElementsCount-1; i++, pNode++ ) {
-			pNode->pPixel->pNext = pNode[1].pPixel;
-		}
-		pNode->pPixel->pNext = NULL;
-		_pList = ms_RadixNodes[1]->pPixel;
-	}
-}
 
 //////////////////////////////////////////////////////////////////////////
 // 11-bits Radix sort from Michael Herf (http://stereopsis.com/radix.html)
@@ -1322,7 +1338,7 @@ void	SHProbeEncoder::Pixel::Sort( Pixel*& _pList, ISortKeyProvider& _KeyProvider
 #define _1(x)	(x >> 11 & 0x7FF)
 #define _2(x)	(x >> 22 )
 
-void	SHProbeEncoder::Pixel::Sort( U32 _ElementsCount, RadixNode_t* _pList, RadixNode_t* _pSorted ) {
+void	SHProbeEncoder::Sort( U32 _ElementsCount, RadixNode_t* _pList, RadixNode_t* _pSorted ) {
 	U32		i;
 
 	// 3 histograms on the stack:
@@ -9,6 +9,10 @@
 // These pixels are analyzed to isolate an average position, direction and color. Or they get discared altogether
 //	because the entire group is not considered significant enough to contribute to the lighting of the probe.
 //
+// The faces of the cube map may have been rendered at a lower resolution than CUBE_MAP_SIZE (cf. SHProbeNetwork's ADAPTIVE_PROBE_CUBE_MAPS):
+//	such a face occupies the top-left FaceSize x FaceSize corner of its slice and each of its texels is replicated over the
+//	(CUBE_MAP_SIZE/FaceSize) pixels it covers when read back, so the encoding always works on the same pixels & samples.
+//
 //
 #pragma once
 
@@ -24,12 +28,6 @@ public:		// CONSTANTS
 	static const U32		CUBE_MAP_SIZE = 128;
 	static const int		CUBE_MAP_FACE_SIZE = CUBE_MAP_SIZE * CUBE_MAP_SIZE;
 
-	// Various thresholds used to allow merging of adjacent pixels
-	static float			DISTANCE_THRESHOLD;
-	static float			ANGULAR_THRESHOLD;
-	static float			ALBEDO_HUE_THRESHOLD;
-	static float			ALBEDO_RGB_THRESHOLD;
-
 	static const double		SAMPLE_SH_NORMALIZER;				// 1 / MAX_PROBE_SAMPLES, an equal share for all samples
 
 private:
@@ -37,13 +35,18 @@ private:
 	static const float	Z_INFINITY;
 	static const float	Z_INFINITY_TEST;
 
+	// Flood fill states of the pixels (a pixel that can still join a group has the index of its sample as state)
+	static const U32	FLOOD_FILL_DISCARDED = ~0U;		// Can never be part of a group
+	static const U32	FLOOD_FILL_ACCEPTED = ~1U;		// Part of a group of the current sample
+	static const U32	FLOOD_FILL_REJECTED = ~2U;		// Rejected by the group being built
+
 
 private:	// NESTED TYPES
 
-	struct	PixelsList;
 	class	Sample;
 
 	// This represents all the information about the pixel of a cube map
+	// The fields used by the flood fill are mirrored in the compact m_pFloodFill* arrays (cf. ComputeFloodFill())
 	class	Pixel {
 		static const double		f0;
 		static const double		f1;
@@ -51,11 +54,6 @@ private:	// NESTED TYPES
 		static const double		f3;
 
 	public:
-		static float	IMPORTANCE_THRESOLD;	// To be set manually before encoding
-
-	public:
-		Pixel*		pNext;					// Pointer to the next pixel in the list if they're part of a particular sample
-
 		int			Index;					// Index of the pixel in the scene pixels (can help us locate the cube map face + position of the pixel when finding adjacent pixels)
 		int			CubeFaceIndex;
 		int			CubeFaceX;
@@ -64,7 +62,6 @@ private:	// NESTED TYPES
 		float3		lsPosition;				// Local position
 		float3		wsNormal;				// World normal
 		float3		Albedo;					// Material albedo
-		float3		AlbedoHSL;				// Material albedo in HSL format
 		float3		F0;						// Material Fresnel coefficient
 		float3		StaticLitColor;			// Color of the statically lit environment
 		float3		SmoothedStaticLitColor;	// Color of the statically lit environment
@@ -81,20 +78,14 @@ private:	// NESTED TYPES
 
 		double		SolidAngle;				// Solid angle covered by the pixel
 		float3		View;					// View vector pointing to that pixel
-		double		SHCoeffs[9];			// SH coefficients of the pixel
 
 		Sample*		pParentSample;			// The sample this pixel is part of
 		bool		bUsedForSampling;		// Tells if the pixel is used by the sample
 
-		PixelsList*	pParentList;			// The list this pixel is part of (only temporary, used when building)
-		Pixel*		pNextInList;			// Next pixel in the list
-
 		Pixel()
-			: pNext( NULL )
-			, lsPosition( float3::Zero )
+			: lsPosition( float3::Zero )
 			, wsNormal( float3::Zero )
 			, Albedo( float3::Zero )
-			, AlbedoHSL( float3::Zero )
 			, FaceIndex( ~0UL )
 			, EmissiveMatID( ~0UL )
 			, NeighborProbeID( ~0UL )
@@ -105,91 +96,37 @@ private:	// NESTED TYPES
 			, Infinity( false )
 			, SolidAngle( 0.0 )
 			, View( float3::Zero )
-			, pParentSample( NULL )
-			, pParentList( NULL )
-			, pNextInList( NULL ) {}
-
-		void		InitSH() {
-			// Build SH coeffs for that pixel
-			SHCoeffs[0] = f0;
-			SHCoeffs[1] = -f1 * View.x;
-			SHCoeffs[2] = f1 * View.y;
-			SHCoeffs[3] = -f1 * View.z;
-			SHCoeffs[4] = f2 * View.x * View.z;
-			SHCoeffs[5] = -f2 * View.x * View.y;
-			SHCoeffs[6] = f3 * (3.0 * View.y*View.y - 1.0);
-			SHCoeffs[7] = -f2 * View.z * View.y;
-			SHCoeffs[8] = f2 * 0.5 * (View.z*View.z - View.x*View.x);
-		}
-
-		// Sets the albedo's RGB & HSL values
-		void		SetAlbedo( const float3& _RGB )
-		{
-			Albedo = _RGB;
-
-			// Convert into HSL
-			float	Min = min( min( Albedo.x, Albedo.y ), Albedo.z );
-			float	Max = max( max( Albedo.x, Albedo.y ), Albedo.z );
-			float	Delta = Max - Min;
-
-			float	L = 0.5f * (Max + Min);
-			float	S = Delta;
-			float	H = 0;
-			if ( Delta > 0 )
-			{
-				S /= L < 0.5f ? 2.0f * L : 2.0f * (1.0f - L);
-				if ( Max == Albedo.x )
-					H = (Albedo.y - Albedo.z) / Delta;
-				else if ( Max == Albedo.y )
-					H = 2.0f + (Albedo.z - Albedo.x) / Delta;
-				else if ( Max == Albedo.z )
-					H = 4.0f + (Albedo.x - Albedo.y) / Delta;
-				else
-					ASSERT( false, "Rha!" );
-
-				H = fmod( H + 6, 6.0f );
-			}
-
-// DEBUG => Should stop on saturated colors like the red/blue side walls
-// if ( S > 0.5f )
-// 	S += 1e-6f;
-
-			AlbedoHSL.Set( H, S, L );
+			, pParentSample( NULL ) {}
+
+		// Builds the SH coeffs in the pixel's view direction (they're not stored since that would double the size of the pixels)
+		void		BuildSHCoeffs( double _SHCoeffs[9] ) const {
+			_SHCoeffs[0] = f0;
+			_SHCoeffs[1] = -f1 * View.x;
+			_SHCoeffs[2] = f1 * View.y;
+			_SHCoeffs[3] = -f1 * View.z;
+			_SHCoeffs[4] = f2 * View.x * View.z;
+			_SHCoeffs[5] = -f2 * View.x * View.y;
+			_SHCoeffs[6] = f3 * (3.0 * View.y*View.y - 1.0);
+			_SHCoeffs[7] = -f2 * View.z * View.y;
+			_SHCoeffs[8] = f2 * 0.5 * (View.z*View.z - View.x*View.x);
 		}
 
-		// Tells if the pixel is acceptable on its own.
+		// Tells if the pixel can be part of a flood filled group at all
 		// The test checks if the pixel:
-		//	_ doesn't already belong to a list
-		//	_ is part of the same sample
 		//	_ is a scene pixel (i.e. not at infinity)
+		//	_ is not emissive
 		//	_ has enough importance
-		bool		IsFloodFillAcceptable( Sample& _SourceSample )
+		bool		IsFloodFillAcceptable( float _ImportanceThreshold ) const
 		{
-			if ( pParentList != NULL )
-				return false;	// We don't accept pixels that are already part of a list
-			if ( pParentSample != &_SourceSample )
-				return false;	// We don't accept pixels that are part of another sample!
 			if ( Infinity )
 				return false;	// We only accept scene pixels!
 			if ( EmissiveMatID != ~0UL )
 				return false;	// Reject all emissive pixels no matter what!
-			if ( Importance < IMPORTANCE_THRESOLD )
+			if ( Importance < _ImportanceThreshold )
 				return false;	// Not important enough!
 
 			return true;
 		}
-
-		// Sorts a linked list of pixels using radix sort
-		struct RadixNode_t {
-			U32		Key;
-			Pixel*	pPixel;
-		};
-		class ISortKeyProvider {
-		public: virtual U32	GetKey( const Pixel& _Pixel ) const = 0;
-		};
-		static RadixNode_t*	ms_RadixNodes[2];
-		static void	Sort( Pixel*& _pList, ISortKeyProvider& _KeyProvider, bool _ReverseSortOnExit );	// Directly takes a linked list and builds a sortable list. If reverse is used, list is rebuilt from largest to lowest key.
-		static void	Sort( U32 _ElementsCount, RadixNode_t* _pList, RadixNode_t* _pSorted );				// Takes a sortable list and a temp buffer
 	};
 
 	// A sample is a collection of pixels averaged as a single position, direction and a set of SH coefficients representing its contribution
@@ -202,7 +139,7 @@ private:	// NESTED TYPES
 	class	Sample : public Pixel {
 	public:
 		U32				PixelsCount;			// Amount of pixels in the sample
-		Pixel*			pPixels;				// The list of pixels belonging to this sample
+		U32				PixelsStart;			// Index of the sample's first pixel in m_pSamplePixels (the sample's OriginalPixelsCount pixels are stored contiguously)
 
 		U32				OriginalPixelsCount;	// The amount of pixels belonging to the sample, discarded or not (theoretically, all samples should contain an equal amount of pixels since we uniformly subdivided the sphere)
 		Pixel*			pCenterPixel;			// The pixel at the center of this sample
@@ -212,7 +149,7 @@ private:	// NESTED TYPES
 
 		Sample()
 			: PixelsCount( 0 )
-			, pPixels( NULL )
+			, PixelsStart( 0 )
 			, OriginalPixelsCount( 0 )
 			, pCenterPixel( NULL )
 			, AverageDirection( float3::Zero ) {
@@ -224,7 +161,6 @@ private:	// NESTED TYPES
  	class	EmissiveSurface {
  	public:
 		U32				PixelsCount;	// Amount of pixels in the surface
-		Pixel*			pPixels;		// The list of pixels belonging to this surface
 
 		U32				EmissiveMatID;	// ID of the emissive material or ~0UL if not emissive
 		U32				ID;				// Warning: Only available once the computation is over and all surfaces have been resolved!
@@ -238,7 +174,6 @@ private:	// NESTED TYPES
 
 		EmissiveSurface()
 			: PixelsCount( 0 )
-			, pPixels( NULL )
 			, EmissiveMatID( ~0UL )
 			, ID( ~0UL )
 			, SolidAngle( 0.0 ) {
@@ -246,12 +181,25 @@ private:	// NESTED TYPES
 			}
  	};
 
+	// A group of flood filled pixels, stored contiguously in m_pFloodFillPixels
 	struct PixelsList {
+		U32		PixelsStart;
 		U32		PixelsCount;
-		Pixel*	pPixels;
 		double	Importance;
 
-		PixelsList() : PixelsCount( 0 ), pPixels( NULL ), Importance( 0.0 ) {}
+		PixelsList() : PixelsStart( 0 ), PixelsCount( 0 ), Importance( 0.0 ) {}
+	};
+
+	// A pixel to check by the flood fill, along with the adjacent pixel we came from
+	struct	FloodFillSeed {
+		U32		PreviousPixelIndex;
+		U32		PixelIndex;
+	};
+
+	// Radix sort nodes
+	struct	RadixNode_t {
+		U32		Key;
+		U32		PixelIndex;
 	};
 
 
@@ -289,10 +237,14 @@ private:
 	public:
 
 		CubeMapPixelWalker( const SHProbeEncoder& _Owner, Pixel& _Pixel ) : Owner( _Owner ) {
-			Set( _Pixel );
+			Set( _Pixel.Index );
+		}
+		CubeMapPixelWalker( const SHProbeEncoder& _Owner, U32 _PixelIndex ) : Owner( _Owner ) {
+			Set( _PixelIndex );
 		}
 
-		void	Set( Pixel& _Pixel );
+		void	Set( U32 _PixelIndex );
+		U32		GetIndex() const;
 		Pixel&	Get() const;
 
 		Pixel&	Left();
@@ -315,8 +267,20 @@ private:	// FIELDS
 	U32						m_ProbeID;							// This is extracted from the cube map file name... Not very robust but good enough!
 
 	Pixel*					m_pCubeMapPixels;					// Original cube map
+	U32*					m_pSamplePixels;					// Indices of the cube map pixels sorted by sample (cf. Sample::PixelsStart)
 	U32						m_ScenePixelsCount;					// Amount of pixels that participate to the scene geometry (i.e. not at infinity)
 
+	// Various thresholds used to allow merging of adjacent pixels (setup by ComputeFloodFill() for each probe)
+	float					m_ImportanceThreshold;				// Pixels less important than this are discarded
+	float					m_DistanceThreshold;
+	float					m_AngularThreshold;
+	float					m_AlbedoHueThreshold;
+	float					m_AlbedoRGBThreshold;
+
+	// Static lighting (XYZ) & occlusion (W) SH provided by SetProjectedSH()
+	bool					m_bHasProjectedSH;
+	float4					m_pProjectedSH[9];
+
 	// Pre-computed samples
 	Sample					m_pSamples[SHProbe::SAMPLES_COUNT];	// The array of samples best representing the probe's environment
 	U32						m_MinSamplePixelsCount;				// The minimum amount of pixels encountered on the samples
@@ -333,6 +297,17 @@ private:	// FIELDS
  
 	List< PixelsList >		m_SamplePixelGroups;
 
+	// Compact per-pixel data read by the flood fill (cf. ComputeFloodFill())
+	U32*					m_pFloodFillStates;					// Either the index of the pixel's sample if it's free or one of the FLOOD_FILL_ states
+	float3*					m_pFloodFillPositions;				// Smoothed local position
+	float3*					m_pFloodFillNormals;
+	float3*					m_pFloodFillAlbedos;
+
+	// Flood fill pools, sized for the largest sample
+	U32*					m_pFloodFillPixels;					// Accepted pixels of all the groups of the current sample
+	U32*					m_pFloodFillRejectedPixels;			// Pixels rejected by the group being built
+	FloodFillSeed*			m_pFloodFillSeeds;					// The explicit stack of pixels to check
+
  	// Emissive surfaces
 	List< EmissiveSurface >	m_EmissiveSurfaces;
 
@@ -357,13 +332,29 @@ public:		// METHODS
 	~SHProbeEncoder();
 
 	// Builds visible neighbor IDs
-	void	BuildProbeNeighborIDs( Texture2D& _StagingCubeMap, SHProbe& _Probe );
+	// _pFaceSizes, the resolution each face was rendered at (must divide CUBE_MAP_SIZE), NULL if they were all rendered at CUBE_MAP_SIZE
+	void	BuildProbeNeighborIDs( Texture2D& _StagingCubeMap, SHProbe& _Probe, const U32* _pFaceSizes=NULL );
 
-	// Builds the Vorono cell information associated to the probe
-	void	BuildProbeVoronoiCell( Texture2D& _StagingCubeMap, SHProbe& _Probe );
+	// Builds the Vorono cell information associated to the probe from the positions of its directly visible neighbors (cf. BuildProbeNeighborIDs())
+	void	BuildProbeVoronoiCell( SHProbe& _Probe );
 
 	// Encodes the MRT cube map into basic SH elements that can later be combined at runtime to form a dynamically updatable probe
-	void	EncodeProbeCubeMap( Texture2D& _StagingCubeMap, SHProbe& _Probe, U32 _SceneTotalFacesCount );
+	// This simply calls ReadBackProbeCubeMap() then EncodeProbe()
+	void	EncodeProbeCubeMap( Texture2D& _StagingCubeMap, SHProbe& _Probe, U32 _SceneTotalFacesCount, const U32* _pFaceSizes=NULL );
+
+	// Reads back the cube map and populates cube map pixels, probe pixels and scene pixels.
+	// After this, the probe is ready for encoding
+	// _pFaceSizes, the resolution each face was rendered at (must divide CUBE_MAP_SIZE), NULL if they were all rendered at CUBE_MAP_SIZE
+	// WARNING: Must be called by the thread owning the device since it maps the staging cube map
+	void	ReadBackProbeCubeMap( Texture2D& _StagingCubeMap, U32 _SceneTotalFacesCount, const U32* _pFaceSizes=NULL );
+
+	// Provides the static lighting (XYZ) & occlusion (W) SH projected by the GPU from the same cube map so EncodeProbe() doesn't have to project the pixels itself
+	// WARNING: Must be called after ReadBackProbeCubeMap() that discards them
+	void	SetProjectedSH( const float4 _pSH[9] );
+
+	// Encodes the pixels read back by ReadBackProbeCubeMap() (smoothing, static SH, flood fill & samples)
+	// Only the encoder and the probe are modified so different encoders can encode different probes concurrently
+	void	EncodeProbe( SHProbe& _Probe );
 
 	// Saves a debugging structure of all the pixels and surfaces
 	void	SavePixels( const char* _FileName ) const;
@@ -374,19 +365,23 @@ public:		// METHODS
 
 private:
 
-	// Reads back the cube map and populates cube map pixels, probe pixels and scene pixels.
-	// After this, the probe is ready for encoding
-	void	ReadBackProbeCubeMap( Texture2D& _StagingCubeMap, U32 _SceneTotalFacesCount );
+	// Returns the texel of a staging face read back for the pixel (X,Y), the face being FaceSize wide
+	static const float4*	GetFaceTexel( const D3D11_MAPPED_SUBRESOURCE& _Map, U32 _FaceSize, int _X, int _Y ) {
+		return (const float4*) ((const U8*) _Map.pData + (_Y * _FaceSize / CUBE_MAP_SIZE) * _Map.RowPitch) + _X * _FaceSize / CUBE_MAP_SIZE;
+	}
+
+	// Performs bilateral-filtered smoothing of the pixels read back by ReadBackProbeCubeMap()
+	void	SmoothCubeMapPixels();
 
 	// Build surfaces using flood fill and adjacency propagation
 	void	ComputeFloodFill( SHProbe& _Probe, float _SpatialDistanceWeight, float _NormalDistanceWeight, float _AlbedoDistanceWeight, float _MinimumImportanceDiscardThreshold );
 
 	// Intensive flood fill routine
-	mutable int		m_ScanlinePixelIndex;
-	mutable Pixel*	m_ppScanlinePixelsPool[6 * CUBE_MAP_SIZE * CUBE_MAP_SIZE];
+	void	FloodFill( U32 _SampleIndex, U32 _SeedPixelIndex, PixelsList& _AcceptedPixels, U32& _RejectedPixelsCount );
+	bool	CheckAndAcceptPixel( U32 _SampleIndex, U32 _PreviousPixelIndex, U32 _PixelIndex, PixelsList& _AcceptedPixels, U32& _RejectedPixelsCount );
 
-	void	FloodFill( Sample& _S, Pixel* _PreviousPixel, Pixel* _P, PixelsList& _AcceptedPixels, PixelsList& _RejectedPixels ) const;
-	bool	CheckAndAcceptPixel( Sample& _Sample, Pixel& _PreviousPixel, Pixel& _P, PixelsList& _AcceptedPixels, PixelsList& _RejectedPixels ) const;
+	// Sorts nodes by key, the sorted nodes end up in _pSorted (_pList is used as temp buffer)
+	static void	Sort( U32 _ElementsCount, RadixNode_t* _pList, RadixNode_t* _pSorted );
 
 	// Helpers
 	template< typename T > void	ToArray( const List<T>& _List, T* _Array, U32 _Max, U32& _ArraySize ) {
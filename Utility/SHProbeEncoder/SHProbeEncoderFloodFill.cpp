@@ -209,8 +209,8 @@ void	SHProbeEncoder::EncodeProbeCubeMap( Texture2D& _StagingCubeMap, U32 _ProbeI
 
 	// Sort from most important to least important neighbor
 	{
-		class	Comparer : public IComparer<NeighborProbe> {
-		public:	virtual int		Compare( const NeighborProbe& a, const NeighborProbe& b ) const {
+		class	Comparer {
+		public:	int		Compare( const NeighborProbe& a, const NeighborProbe& b ) const {
 				if ( a.SolidAngle < b.SolidAngle )
 					return +1;
 				if ( a.SolidAngle > b.SolidAngle )
@@ -0,0 +1,151 @@
+#include "../../GodComplex.h"
+#include "SHProbeIrradianceVolume.h"
+
+#define CHECK_MATERIAL( pMaterial, ErrorCode )		if ( (pMaterial)->HasErrors() ) m_ErrorCode = ErrorCode;
+
+namespace {
+	const int	THREADS_PER_AXIS = 4;		// Threads per axis of the groups of CS_Update, cf. GIIrradianceVolume.hlsl
+}
+
+SHProbeIrradianceVolume::SHProbeIrradianceVolume()
+	: m_pDevice( NULL )
+	, m_ErrorCode( 0 )
+	, m_FinestCellSize( 0.5f )
+	, m_pCSUpdate( NULL )
+	, m_pSB_Levels( NULL )
+	, m_pCB_IrradianceVolume( NULL )
+	, m_NextLevel( 0 ) {
+	m_ppTexSH[0] = m_ppTexSH[1] = m_ppTexSH[2] = NULL;
+	Invalidate();
+}
+
+SHProbeIrradianceVolume::~SHProbeIrradianceVolume() {
+	Exit();
+}
+
+void	SHProbeIrradianceVolume::Init( Device& _Device, const char* _pSHStorageFormatMacro, float _FinestCellSize ) {
+	ASSERT( (LEVEL_SIZE % THREADS_PER_AXIS) == 0, "The levels must be a multiple of the thread groups' size!" );
+
+	m_pDevice = &_Device;
+	m_FinestCellSize = _FinestCellSize;
+
+	m_pCB_IrradianceVolume = new CB<CBIrradianceVolume>( _Device, 10 );
+
+	for ( int ChannelIndex=0; ChannelIndex < 3; ChannelIndex++ )
+		m_ppTexSH[ChannelIndex] = new Texture3D( _Device, LEVEL_SIZE, LEVEL_SIZE, LEVELS_COUNT * LEVEL_SIZE, PixelFormatRGBA16F::DESCRIPTOR, 1, NULL, false, true );
+
+	// Levels are placed far away until they're resampled once so they're never used
+	m_pSB_Levels = new SB<LevelInfos>( _Device, LEVELS_COUNT, true );
+	float	CellSize = m_FinestCellSize;
+	for ( int LevelIndex=0; LevelIndex < LEVELS_COUNT; LevelIndex++, CellSize *= 2.0f ) {
+		m_pSB_Levels->m[LevelIndex].wsMin.Set( 1e6f, 1e6f, 1e6f );
+		m_pSB_Levels->m[LevelIndex].InvSize = 1.0f / (CellSize * LEVEL_SIZE);
+	}
+	m_pSB_Levels->Write();
+
+	Invalidate();
+
+	{
+ScopedForceMaterialsLoadFromBinary	bisou;
+
+		D3D_SHADER_MACRO	pMacros[] = { { "SH_STORAGE_FORMAT", _pSHStorageFormatMacro }, { NULL, NULL } };
+		CHECK_MATERIAL( m_pCSUpdate = CreateComputeShader( IDR_SHADER_GI_IRRADIANCE_VOLUME, "./Resources/Shaders/GIIrradianceVolume.hlsl", "CS_Update", pMacros ), 1 );
+	}
+}
+
+void	SHProbeIrradianceVolume::Exit() {
+	SAFE_DELETE( m_pCSUpdate );
+	SAFE_DELETE( m_pSB_Levels );
+	for ( int ChannelIndex=0; ChannelIndex < 3; ChannelIndex++ )
+		SAFE_DELETE( m_ppTexSH[ChannelIndex] );
+	SAFE_DELETE( m_pCB_IrradianceVolume );
+}
+
+void	SHProbeIrradianceVolume::Invalidate() {
+	for ( int LevelIndex=0; LevelIndex < LEVELS_COUNT; LevelIndex++ )
+		m_pLevelValid[LevelIndex] = false;
+	m_NextLevel = 0;
+}
+
+void	SHProbeIrradianceVolume::Update( const float3& _wsCameraPosition ) {
+	if ( m_pCSUpdate == NULL || HasErrors() )
+		return;
+
+	// Find the cell the camera is in for each level
+	int		ppCameraCells[LEVELS_COUNT][3];
+	float	CellSize = m_FinestCellSize;
+	for ( int LevelIndex=0; LevelIndex < LEVELS_COUNT; LevelIndex++, CellSize *= 2.0f ) {
+		ppCameraCells[LevelIndex][0] = int( floorf( _wsCameraPosition.x / CellSize ) );
+		ppCameraCells[LevelIndex][1] = int( floorf( _wsCameraPosition.y / CellSize ) );
+		ppCameraCells[LevelIndex][2] = int( floorf( _wsCameraPosition.z / CellSize ) );
+	}
+
+	int		LevelIndex = SelectLevel( ppCameraCells );
+	CellSize = m_FinestCellSize * float( 1 << LevelIndex );
+
+	// Center the level on the camera
+	int*	pCenter = m_ppLevelCenters[LevelIndex];
+	pCenter[0] = ppCameraCells[LevelIndex][0];
+	pCenter[1] = ppCameraCells[LevelIndex][1];
+	pCenter[2] = ppCameraCells[LevelIndex][2];
+	float3	wsLevelMin( float( pCenter[0] - LEVEL_SIZE/2 ) * CellSize, float( pCenter[1] - LEVEL_SIZE/2 ) * CellSize, float( pCenter[2] - LEVEL_SIZE/2 ) * CellSize );
+
+	// Resample the probes into the level's slices
+	m_pCB_IrradianceVolume->m.wsLevelMin = wsLevelMin;
+	m_pCB_IrradianceVolume->m.CellSize = CellSize;
+	m_pCB_IrradianceVolume->m.LevelIndex = LevelIndex;
+	m_pCB_IrradianceVolume->m.LevelSize = LEVEL_SIZE;
+	m_pCB_IrradianceVolume->UpdateData();
+
+	m_pSB_Levels->RemoveFromLastAssignedSlots();
+	for ( int ChannelIndex=0; ChannelIndex < 3; ChannelIndex++ )
+		m_ppTexSH[ChannelIndex]->RemoveFromLastAssignedSlots();
+
+	USING_COMPUTESHADER_START( *m_pCSUpdate )
+
+	for ( int ChannelIndex=0; ChannelIndex < 3; ChannelIndex++ )
+		m_ppTexSH[ChannelIndex]->SetCSUAV( ChannelIndex, m_ppTexSH[ChannelIndex]->GetUAV( 0, LevelIndex * LEVEL_SIZE, LEVEL_SIZE ) );
+
+	int	GroupsCount = LEVEL_SIZE / THREADS_PER_AXIS;
+	M.Dispatch( GroupsCount, GroupsCount, GroupsCount );
+
+	for ( int ChannelIndex=0; ChannelIndex < 3; ChannelIndex++ )
+		m_ppTexSH[ChannelIndex]->RemoveFromLastAssignedSlotUAV();
+
+	USING_COMPUTE_SHADER_END
+
+	// The level can now be sampled at its new place
+	m_pSB_Levels->m[LevelIndex].wsMin = wsLevelMin;
+	m_pSB_Levels->Write();
+
+	m_pLevelValid[LevelIndex] = true;
+	m_NextLevel = (LevelIndex + 1) % LEVELS_COUNT;
+}
+
+int		SHProbeIrradianceVolume::SelectLevel( const int _ppCameraCells[LEVELS_COUNT][3] ) const {
+	// Levels that were never resampled come first
+	for ( int LevelIndex=0; LevelIndex < LEVELS_COUNT; LevelIndex++ )
+		if ( !m_pLevelValid[LevelIndex] )
+			return LevelIndex;
+
+	// Then the finest level the camera drifted too far from
+	for ( int LevelIndex=0; LevelIndex < LEVELS_COUNT; LevelIndex++ ) {
+		const int*	pCenter = m_ppLevelCenters[LevelIndex];
+		const int*	pCamera = _ppCameraCells[LevelIndex];
+		int			Drift = MAX( MAX( abs( pCamera[0] - pCenter[0] ), abs( pCamera[1] - pCenter[1] ) ), abs( pCamera[2] - pCenter[2] ) );
+		if ( Drift >= RECENTER_DISTANCE )
+			return LevelIndex;
+	}
+
+	// Otherwise refresh the levels in turn so they follow the probes' updates
+	return m_NextLevel;
+}
+
+void	SHProbeIrradianceVolume::Bind() {
+	if ( m_pSB_Levels == NULL )
+		return;
+
+	for ( int ChannelIndex=0; ChannelIndex < 3; ChannelIndex++ )
+		m_ppTexSH[ChannelIndex]->Set( 40+ChannelIndex, true );
+	m_pSB_Levels->SetInput( 43 );
+}
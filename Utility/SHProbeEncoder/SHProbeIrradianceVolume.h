@@ -0,0 +1,93 @@
+//////////////////////////////////////////////////////////////////////////
+// SH Probe Irradiance Volume
+//
+// Resamples the final SH of the probe network into nested camera-centered 3D textures so dynamic objects, particles and
+//	volumetrics can fetch the L1 irradiance anywhere instead of looking up & blending the probes themselves (cf. Inc/IrradianceVolume.hlsl)
+// Each level is LEVEL_SIZE^3 cells twice as large as the previous level's, the levels are stacked along Z in 3 RGBA16F textures
+//	where RGBA are the 4 L1 coefficients of the red, green & blue channels.
+// The volume is refreshed incrementally: a single level is resampled each frame, the level that drifted the most from the camera
+//	first and the others in turn, so the probes' dynamic updates propagate to the whole volume in LEVELS_COUNT frames.
+//
+// Usage:
+//	Volume.Init( Device, SHProbeNetwork::GetSHStorageFormatMacro( Format ) );
+//	(...)
+//	Volume.Update( wsCameraPosition );	// Once the probes' final SH are computed and bound (cf. SHProbeNetwork::UpdateDynamicProbes())
+//	Volume.Bind();
+//
+#pragma once
+
+template<typename> class CB;
+template<typename> class SB;
+
+class	SHProbeIrradianceVolume {
+public:		// CONSTANTS
+
+	static const int		LEVELS_COUNT = 3;			// !!IMPORTANT ==> Must correspond to IRRADIANCE_VOLUME_LEVELS in Inc/IrradianceVolume.hlsl!!
+	static const int		LEVEL_SIZE = 32;			// Cells per axis of each level (!!IMPORTANT ==> Must correspond to IRRADIANCE_VOLUME_SIZE in Inc/IrradianceVolume.hlsl!!)
+	static const int		RECENTER_DISTANCE = 4;		// A level gets recentered once the camera moved that many of its cells away from its center
+
+private:	// NESTED TYPES
+
+#pragma pack( push, 4 )
+
+	// WARNING: must match the IrradianceVolumeLevel structure in Inc/IrradianceVolume.hlsl!
+	struct	LevelInfos {
+		float3		wsMin;				// World position of the minimum corner of the level
+		float		InvSize;			// 1 / (CellSize * LEVEL_SIZE)
+	};
+
+	// WARNING: must match the cbIrradianceVolume constant buffer in GIIrradianceVolume.hlsl!
+	struct	CBIrradianceVolume {
+		float3		wsLevelMin;
+		float		CellSize;
+		U32			LevelIndex;
+		U32			LevelSize;
+		U32			__PAD[2];
+	};
+
+#pragma pack( pop )
+
+private:	// FIELDS
+
+	Device*					m_pDevice;
+	U32						m_ErrorCode;
+
+	float					m_FinestCellSize;			// Size of the cells of the first level (in meters)
+
+	ComputeShader*			m_pCSUpdate;				// Resamples the probes' SH into a level
+
+	Texture3D*				m_ppTexSH[3];				// L1 SH of the red, green & blue channels
+	SB<LevelInfos>*			m_pSB_Levels;				// (SRV) Placement of each level
+	CB<CBIrradianceVolume>*	m_pCB_IrradianceVolume;
+
+	int						m_ppLevelCenters[LEVELS_COUNT][3];	// Cell the camera was in when each level was last resampled (in the level's cells)
+	bool					m_pLevelValid[LEVELS_COUNT];		// False until the level is resampled once
+	int						m_NextLevel;						// Next level to refresh in turn
+
+public:
+
+	SHProbeIrradianceVolume();
+	~SHProbeIrradianceVolume();
+
+	// _pSHStorageFormatMacro, the SH_STORAGE_FORMAT of the network's final SH buffer (cf. SHProbeNetwork::GetSHStorageFormatMacro())
+	// _FinestCellSize, the size of the cells of the first level (in meters)
+	void			Init( Device& _Device, const char* _pSHStorageFormatMacro, float _FinestCellSize=0.5f );
+	void			Exit();
+
+	bool			HasErrors() const				{ return m_ErrorCode != 0; }
+	float			GetFinestCellSize() const		{ return m_FinestCellSize; }
+
+	// Forces all the levels to be resampled over the next frames (e.g. when the probes are reloaded)
+	void			Invalidate();
+
+	// Resamples a single level around the camera, the probes' final SH, grid & tetrahedra must be bound (cf. SHProbeNetwork::BindSceneInputs())
+	void			Update( const float3& _wsCameraPosition );
+
+	// Binds the textures & the levels' placement for all the shaders (cf. Inc/IrradianceVolume.hlsl)
+	void			Bind();
+
+private:
+
+	// Returns the level to resample this frame
+	int				SelectLevel( const int _ppCameraCells[LEVELS_COUNT][3] ) const;
+};
@@ -2,6 +2,85 @@
 
 #define CHECK_MATERIAL( pMaterial, ErrorCode )		if ( (pMaterial)->HasErrors() ) m_ErrorCode = ErrorCode;
 
+#define PROJECT_PROBE_SH_ON_GPU		// Define this to project static lighting & occlusion into SH with a compute shader instead of letting the encoder project the pixels read back from the cube map
+#define GATHER_PROBE_UPDATES_ON_GPU	// Define this to upload the static probe update infos once and let a compute shader gather them each frame instead of rebuilding and uploading them for every updated probe
+#define ADAPTIVE_PROBE_CUBE_MAPS	// Define this to render the probe cube maps at a low resolution first and only render again the faces seeing close or discontinuous geometry, at the resolution they need
+//#define MULTIVIEW_CUBE_MAPS		// Define this to render the 6 faces of the probe cube maps with a single traversal of the scene, instanced for the faces seeing each mesh (cube map shader is compiled with MULTIVIEW=1, cf. Inc/MultiView.hlsl)
+
+namespace {
+	const float	NEVER_UPDATED_AGE = 1e4f;					// Age given to probes that were never updated (in seconds)
+	const float	PRIORITY_REFERENCE_DISTANCE = 10.0f;		// Distance to the viewer at which the priority of a probe is halved (in meters)
+	const float	PRIORITY_INVISIBLE_FACTOR = 0.1f;			// Priority factor for probes outside of the viewer's frustum
+	const float	PRIORITY_LIGHT_CHANGED_FACTOR = 16.0f;		// Priority factor for probes affected by a light that changed
+	const float	AVERAGE_UPDATES_COUNT_FACTOR = 1.0f / 32;
+	const char*	BAKE_UNIT_FILE_NAME_FORMAT = "BakeUnit%03dOf%03d.bakeunit";	// Name of the work unit files of a distributed bake in the probes directory
+	const char*	BAKE_MANIFEST_FILE_NAME = "ProbeBake.manifest";			// Name of the manifest of the last bake in the probes directory (cf. RebakeProbes())
+	const char*	PROBE_PLACEMENT_FILE_NAME = "ProbePlacement.keep";		// Name of the placement file listing the scene probes to keep in the probes directory (cf. OptimizeProbePlacement())
+	const char*	VERTEX_STREAM_FILE_NAME = "Scene.vertexStream.U16";		// Name of the probe influence vertex stream file in the probes directory
+	// Adaptive probe cube maps (cf. ADAPTIVE_PROBE_CUBE_MAPS and SHProbeNetwork::ChooseCubeMapFaceSizes())
+	const U32	ADAPTIVE_CUBE_MAP_MIN_SIZE = SHProbeEncoder::CUBE_MAP_SIZE / 4;	// Resolution of the first pass
+	const float	ADAPTIVE_CUBE_MAP_NEAR_DISTANCE = 1.0f;		// Faces seeing geometry closer than this are always rendered at full resolution (in meters)
+	const float	ADAPTIVE_CUBE_MAP_DEPTH_RATIO = 0.1f;		// Adjacent texels whose distances differ by more than 10% are a discontinuity...
+	const float	ADAPTIVE_CUBE_MAP_NORMAL_COS = 0.8f;		// ...as are adjacent texels whose normals are more than ~37 apart or that see the sky and the scene
+	const float	ADAPTIVE_CUBE_MAP_HALF_RATIO = 0.02f;		// Faces with more than 2% of discontinuous texel pairs are rendered again at half resolution...
+	const float	ADAPTIVE_CUBE_MAP_FULL_RATIO = 0.08f;		// ...and at full resolution above 8%
+	const char*	PACKED_PROBES_FILE_NAME = "ProbeNetwork.packed";		// Name of the packed probe network file in the probes directory	// Same as the default rolling average factor of the GPU profiler so the measured time and the updates count match
+
+	// Frustum planes extracted from a WORLD -> PROJ transform
+	class	Frustum {
+		float4	m_pPlanes[6];	// Normalized planes with normals pointing inside the frustum
+
+	public:
+		Frustum( const float4x4& _World2Proj ) {
+			const float*	m = _World2Proj.m;
+			float4	C0( m[0], m[4], m[8], m[12] );	// Columns of the matrix (we're using row vectors)
+			float4	C1( m[1], m[5], m[9], m[13] );
+			float4	C2( m[2], m[6], m[10], m[14] );
+			float4	C3( m[3], m[7], m[11], m[15] );
+
+			m_pPlanes[0] = C3 + C0;	// Left
+			m_pPlanes[1] = C3 - C0;	// Right
+			m_pPlanes[2] = C3 + C1;	// Bottom
+			m_pPlanes[3] = C3 - C1;	// Top
+			m_pPlanes[4] = C2;		// Near (Z in [0,1])
+			m_pPlanes[5] = C3 - C2;	// Far
+			for ( int PlaneIndex=0; PlaneIndex < 6; PlaneIndex++ ) {
+				float4&	P = m_pPlanes[PlaneIndex];
+				float	Length = float3( P.x, P.y, P.z ).Length();
+				P = P / MAX( 1e-6f, Length );
+			}
+		}
+
+		bool	IsVisible( const float3& _Center, float _Radius ) const {
+			for ( int PlaneIndex=0; PlaneIndex < 6; PlaneIndex++ ) {
+				const float4&	P = m_pPlanes[PlaneIndex];
+				if ( P.x * _Center.x + P.y * _Center.y + P.z * _Center.z + P.w < -_Radius )
+					return false;
+			}
+			return true;
+		}
+	};
+
+	// Tells if 2 adjacent texels of the (normal + distance) cube map see different surfaces (cf. SHProbeNetwork::ChooseCubeMapFaceSizes())
+	bool	IsCubeMapDiscontinuity( const float4& _Texel0, const float4& _Texel1 ) {
+		const float	Z_INFINITY_TEST = 0.99f * 1e6f;
+
+		bool	bInfinity0 = _Texel0.w > Z_INFINITY_TEST;
+		bool	bInfinity1 = _Texel1.w > Z_INFINITY_TEST;
+		if ( bInfinity0 || bInfinity1 )
+			return bInfinity0 != bInfinity1;	// Silhouette of the scene against the sky
+
+		if ( fabs( _Texel0.w - _Texel1.w ) > ADAPTIVE_CUBE_MAP_DEPTH_RATIO * MIN( _Texel0.w, _Texel1.w ) )
+			return true;
+
+		float3	Normal0( _Texel0.x, _Texel0.y, _Texel0.z );
+		float3	Normal1( _Texel1.x, _Texel1.y, _Texel1.z );
+		Normal0.Normalize();
+		Normal1.Normalize();
+		return Normal0.Dot( Normal1 ) < ADAPTIVE_CUBE_MAP_NORMAL_COS;
+	}
+}
+
 SHProbeNetwork::SHProbeNetwork() 
 	: m_pDevice( NULL )
 	, m_ErrorCode( 0 )
@@ -9,18 +88,20 @@ SHProbeNetwork::SHProbeNetwork()
 	, m_MaxProbesCount( 0 )
 	, m_pProbes( NULL )
 	, m_pPrimProbeIDs( NULL )
-	, m_ProbeUpdateIndex( 0 ) {
+	, m_pProbeUpdateStates( NULL )
+	, m_AverageProbeUpdatesCount( 0.0f ) {
 }
 
 SHProbeNetwork::~SHProbeNetwork() {
 	Exit();
 }
 
-void	SHProbeNetwork::Init( Device& _Device, Primitive& _ScreenQuad ) {
+void	SHProbeNetwork::Init( Device& _Device, Primitive& _ScreenQuad, SH_STORAGE_FORMAT _SHStorageFormat, bool _PackedSceneVertices, bool _TextureArrays ) {
 	m_ProbeEncoder.m_pOwner = this;
 
 	m_pDevice = &_Device;
 	m_pScreenQuad = &_ScreenQuad;
+	m_SHStorageFormat = _SHStorageFormat;
 
 	//////////////////////////////////////////////////////////////////////////
 	// Create the constant buffers
@@ -31,12 +112,25 @@ void	SHProbeNetwork::Init( Device& _Device, Primitive& _ScreenQuad ) {
 	// Create the probes structured buffers
 	m_pSB_RuntimeProbes = NULL;
 	m_pSB_ProbeNeighbors = NULL;
+	m_pSB_ProbeGridInfos = NULL;
+	m_pSB_ProbeGridCells = NULL;
+	m_pSB_ProbeGridCandidates = NULL;
+	m_pSB_ProbeGridPositions = NULL;
+	m_pSB_ProbeTetrahedra = NULL;
+	m_pSB_ProbeTetrahedraBarycentrics = NULL;
+	m_pSB_ProbeTetrahedronOfProbe = NULL;
 	m_pSB_RuntimeProbeNetworkInfos = NULL;
 
 	m_pSB_RuntimeProbeUpdateInfos = new SB<RuntimeProbeUpdateInfo>( *m_pDevice, MAX_PROBE_UPDATES_PER_FRAME, true );
 	m_pSB_RuntimeProbeSamples = new SB<RuntimeProbeUpdateSampleInfo>( *m_pDevice, MAX_PROBE_UPDATES_PER_FRAME*SHProbe::SAMPLES_COUNT, true );
 	m_pSB_RuntimeProbeEmissiveSurfaces = new SB<RuntimeProbeUpdateEmissiveSurfaceInfo>( *m_pDevice, MAX_PROBE_UPDATES_PER_FRAME*SHProbe::MAX_EMISSIVE_SURFACES, true );
 
+	m_pSB_ProbeUpdateRequests = new SB<ProbeUpdateRequest>( *m_pDevice, MAX_PROBE_UPDATES_PER_FRAME, true );
+	m_pSB_StaticProbeUpdateInfos = NULL;
+	m_pSB_StaticProbeSamples = NULL;
+	m_pSB_StaticEmissiveSurfaces = NULL;
+	m_pSB_EmissiveMaterialColors = NULL;
+
 	// Create the static SH coefficients for each sample
 	m_pSB_RuntimeProbeSamplesSH = new SB<SHCoeffs1>( *m_pDevice, SHProbe::SAMPLES_COUNT, true );
 	for ( int SampleIndex=0; SampleIndex < SHProbe::SAMPLES_COUNT; SampleIndex++ ) {
@@ -59,58 +153,115 @@ void	SHProbeNetwork::Init( Device& _Device, Primitive& _ScreenQuad ) {
 	{
 ScopedForceMaterialsLoadFromBinary		bisou;
 
-		CHECK_MATERIAL( m_pMatRenderCubeMap = CreateMaterial( IDR_SHADER_GI_RENDER_CUBEMAP, "./Resources/Shaders/GIRenderCubeMap.hlsl", VertexFormatP3N3G3B3T2::DESCRIPTOR, "VS", NULL, "PS" ), 0 );
+		const IVertexFormatDescriptor&	SceneVertexFormat = _PackedSceneVertices ? (const IVertexFormatDescriptor&) VertexFormatPackedP3N3G3B3T2::DESCRIPTOR : (const IVertexFormatDescriptor&) VertexFormatP3N3G3B3T2::DESCRIPTOR;
+#ifdef MULTIVIEW_CUBE_MAPS
+		D3D_SHADER_MACRO	pCubeMapMacros[] = { { "PACKED_VERTICES", _PackedSceneVertices ? "1" : "0" }, { "TEXTURE_ARRAYS", _TextureArrays ? "1" : "0" }, { "MULTIVIEW", "1" }, { NULL, NULL } };
+		CHECK_MATERIAL( m_pMatRenderCubeMap = CreateMaterial( IDR_SHADER_GI_RENDER_CUBEMAP, "./Resources/Shaders/GIRenderCubeMap.hlsl", SceneVertexFormat, "VS", "GS", "PS", pCubeMapMacros ), 0 );
+#else
+		D3D_SHADER_MACRO	pCubeMapMacros[] = { { "PACKED_VERTICES", _PackedSceneVertices ? "1" : "0" }, { "TEXTURE_ARRAYS", _TextureArrays ? "1" : "0" }, { NULL, NULL } };
+		CHECK_MATERIAL( m_pMatRenderCubeMap = CreateMaterial( IDR_SHADER_GI_RENDER_CUBEMAP, "./Resources/Shaders/GIRenderCubeMap.hlsl", SceneVertexFormat, "VS", NULL, "PS", pCubeMapMacros ), 0 );
+#endif
  		CHECK_MATERIAL( m_pMatRenderNeighborProbe = CreateMaterial( IDR_SHADER_GI_RENDER_NEIGHBOR_PROBE, "./Resources/Shaders/GIRenderNeighborProbe.hlsl", VertexFormatPt4::DESCRIPTOR, "VS", NULL, "PS" ), 1 );
 	}
 
+	D3D_SHADER_MACRO	pSHStorageMacros[] = { { "SH_STORAGE_FORMAT", GetSHStorageFormatMacro( m_SHStorageFormat ) }, { NULL, NULL } };
 	{
 // This one is REALLY heavy! So build it once and reload it from binary forever again
 ScopedForceMaterialsLoadFromBinary		bisou;
 
-		CHECK_MATERIAL( m_pCSUpdateProbeDynamicSH = CreateComputeShader( IDR_SHADER_GI_UPDATE_PROBE, "./Resources/Shaders/GIUpdateProbe.hlsl", "CS" ), 2 );
+		CHECK_MATERIAL( m_pCSUpdateProbeDynamicSH = CreateComputeShader( IDR_SHADER_GI_UPDATE_PROBE, "./Resources/Shaders/GIUpdateProbe.hlsl", "CS", pSHStorageMacros ), 2 );
+	}
+
+	{
+ScopedForceMaterialsLoadFromBinary	bisou;
+
+ 		CHECK_MATERIAL( m_pCSAccumulateProbeSH = CreateComputeShader( IDR_SHADER_GI_UPDATE_PROBE, "./Resources/Shaders/GIUpdateProbe.hlsl", "CS_AccumulateSH", pSHStorageMacros ), 3 );
+	}
+
+	{
+ScopedForceMaterialsLoadFromBinary	bisou;
+
+		CHECK_MATERIAL( m_pCSProjectProbeSH = CreateComputeShader( IDR_SHADER_GI_ENCODE_PROBE_SH, "./Resources/Shaders/GIEncodeProbeSH.hlsl", "CS" ), 4 );
+		CHECK_MATERIAL( m_pCSReduceProbeSH = CreateComputeShader( IDR_SHADER_GI_ENCODE_PROBE_SH, "./Resources/Shaders/GIEncodeProbeSH.hlsl", "CS_Reduce" ), 5 );
 	}
 
 	{
 ScopedForceMaterialsLoadFromBinary	bisou;
 
- 		CHECK_MATERIAL( m_pCSAccumulateProbeSH = CreateComputeShader( IDR_SHADER_GI_UPDATE_PROBE, "./Resources/Shaders/GIUpdateProbe.hlsl", "CS_AccumulateSH" ), 3 );
+		CHECK_MATERIAL( m_pCSGatherProbeUpdates = CreateComputeShader( IDR_SHADER_GI_GATHER_PROBE_UPDATES, "./Resources/Shaders/GIGatherProbeUpdates.hlsl", "CS" ), 6 );
 	}
+
+	m_IrradianceVolume.Init( _Device, GetSHStorageFormatMacro( m_SHStorageFormat ) );
+	if ( m_IrradianceVolume.HasErrors() )
+		m_ErrorCode = 7;
 }
 
 void	SHProbeNetwork::Exit() {
+	m_IrradianceVolume.Exit();
+
 	m_ProbesCount = 0;
 	SAFE_DELETE_ARRAY( m_pProbes );
+	SAFE_DELETE_ARRAY( m_pProbeUpdateStates );
 
-	delete m_pPrimProbeIDs;
-
-	delete m_ppSB_RuntimeSHStatic[0];
-	delete m_ppSB_RuntimeSHStatic[1];
-	delete m_pSB_RuntimeSHAmbient;
-	delete m_pSB_RuntimeSHDynamic;
-	delete m_pSB_RuntimeSHDynamicSun;
-	delete m_pSB_RuntimeSHFinal;
+	ReleaseLoadedProbes();
 
+	delete m_pCSGatherProbeUpdates;
+	delete m_pCSReduceProbeSH;
+	delete m_pCSProjectProbeSH;
 	delete m_pCSUpdateProbeDynamicSH;
 	delete m_pMatRenderNeighborProbe;
 	delete m_pMatRenderCubeMap;
 
 	delete m_pSB_RuntimeProbeSamplesSH;
 
+	delete m_pSB_ProbeUpdateRequests;
+
 	delete m_pSB_RuntimeProbeEmissiveSurfaces;
 	delete m_pSB_RuntimeProbeSamples;
 	delete m_pSB_RuntimeProbeUpdateInfos;
-	delete m_pSB_RuntimeProbeNetworkInfos;
-	delete m_pSB_RuntimeProbes;
-
-	delete m_pSB_ProbeNeighbors;
 
 	delete m_pCB_UpdateProbes;
 	delete m_pCB_Probe;
 }
 
+// Releases everything LoadProbes() builds so the probes can be loaded again (e.g. after a partial rebake)
+void	SHProbeNetwork::ReleaseLoadedProbes() {
+	SAFE_DELETE( m_pPrimProbeIDs );
+
+	SAFE_DELETE( m_ppSB_RuntimeSHStatic[0] );
+	SAFE_DELETE( m_ppSB_RuntimeSHStatic[1] );
+	SAFE_DELETE( m_pSB_RuntimeSHAmbient );
+	SAFE_DELETE( m_pSB_RuntimeSHDynamic );
+	SAFE_DELETE( m_pSB_RuntimeSHDynamicSun );
+	SAFE_DELETE( m_pSB_RuntimeSHFinal );
+
+	SAFE_DELETE( m_pSB_EmissiveMaterialColors );
+	SAFE_DELETE( m_pSB_StaticEmissiveSurfaces );
+	SAFE_DELETE( m_pSB_StaticProbeSamples );
+	SAFE_DELETE( m_pSB_StaticProbeUpdateInfos );
+	m_EmissiveMaterialIDs.Clear();
+
+	SAFE_DELETE( m_pSB_RuntimeProbeNetworkInfos );
+	SAFE_DELETE( m_pSB_RuntimeProbes );
+
+	SAFE_DELETE( m_pSB_ProbeNeighbors );
+
+	SAFE_DELETE( m_pSB_ProbeTetrahedronOfProbe );
+	SAFE_DELETE( m_pSB_ProbeTetrahedraBarycentrics );
+	SAFE_DELETE( m_pSB_ProbeTetrahedra );
+	m_ProbeTetrahedra.Exit();
+
+	SAFE_DELETE( m_pSB_ProbeGridPositions );
+	SAFE_DELETE( m_pSB_ProbeGridCandidates );
+	SAFE_DELETE( m_pSB_ProbeGridCells );
+	SAFE_DELETE( m_pSB_ProbeGridInfos );
+	m_ProbeGrid.Exit();
+}
+
 void	SHProbeNetwork::PreAllocateProbes( int _ProbesCount ) {
 	m_MaxProbesCount = _ProbesCount;
 	m_pProbes = new SHProbe[m_MaxProbesCount];
+	m_pProbeUpdateStates = new ProbeUpdateState[m_MaxProbesCount];
 }
 
 void	SHProbeNetwork::AddProbe( Scene::Probe& _Probe ) {
@@ -118,13 +269,14 @@ void	SHProbeNetwork::AddProbe( Scene::Probe& _Probe ) {
 	m_pProbes[m_ProbesCount].m_ProbeID = m_ProbesCount;
 	m_pProbes[m_ProbesCount].m_pSceneProbe = &_Probe;
 	m_pProbes[m_ProbesCount].m_wsPosition = float3( _Probe.m_Local2World.GetRow(3) );	// Cache probe position as we're going to use it a lot!
+	m_pProbeUpdateStates[m_ProbesCount].LastUpdateTime = -NEVER_UPDATED_AGE;			// Never updated probes go first
+	m_pProbeUpdateStates[m_ProbesCount].bLightChanged = false;
 	m_ProbesCount++;
 }
 
 void	SHProbeNetwork::UpdateDynamicProbes( DynamicUpdateParms& _Parms ) {
-//	ASSERT( m_ProbesCount <= MAX_PROBE_UPDATES_PER_FRAME, "Increase max probes update per frame! Or write the time-sliced updater you promised!" );
-
-	U32		ProbeUpdatesCount = MIN( _Parms.MaxProbeUpdatesPerFrame, U32(m_ProbesCount) );
+	U32		pProbeIndices[MAX_PROBE_UPDATES_PER_FRAME];
+	U32		ProbeUpdatesCount = ScheduleProbeUpdates( _Parms, pProbeIndices );
 
 	// Prepare constant buffer for update
 	m_pCB_UpdateProbes->m.SunBoost = _Parms.BounceFactorSun;
@@ -133,8 +285,7 @@ void	SHProbeNetwork::UpdateDynamicProbes( DynamicUpdateParms& _Parms ) {
 	m_pCB_UpdateProbes->m.StaticLightingBoost = _Parms.BounceFactorStatic;
 	m_pCB_UpdateProbes->m.EmissiveBoost = _Parms.BounceFactorEmissive;
 	m_pCB_UpdateProbes->m.NeighborProbesContributionBoost = _Parms.BounceFactorNeighbors;
-// 	for ( int i=0; i < 9; i++ )
-// 		m_pCB_UpdateProbes->m.AmbientSH[i] = float4( _Parms.AmbientSkySH[i], 0 );	// Update one by one because of float3 padding
+	// NOTE: The ambient sky SH aren't uploaded anymore, they're computed on the GPU and stay bound at t57 (cf. EffectGlobalIllum2::UpdateSkySH())
 
 	m_pCB_UpdateProbes->UpdateData();
 
@@ -150,20 +301,70 @@ void	SHProbeNetwork::UpdateDynamicProbes( DynamicUpdateParms& _Parms ) {
 	//
 	// Basically for every probe update, we perform 1(sky)+4(neighbor) expensive SH products and compute lighting for at most 128 samples in the scene
 	//
-//TODO: Handle a proper stack of probes to update
+	// The probes to update are chosen by ScheduleProbeUpdates()
+	//
+#ifdef GATHER_PROBE_UPDATES_ON_GPU
+	// The static update infos of all the probes were uploaded by LoadProbes(), we only send the probes to update
+	//	and the current emissive colors, GIGatherProbeUpdates.hlsl then fills the update buffers
+	int		TotalEmissiveSurfacesCount = 0;
+	for ( U32 ProbeUpdateIndex=0; ProbeUpdateIndex < ProbeUpdatesCount; ProbeUpdateIndex++ ) {
+		U32			ProbeIndex = pProbeIndices[ProbeUpdateIndex];
+
+		// Reset the probe's priority
+		m_pProbeUpdateStates[ProbeIndex].LastUpdateTime = _Parms.Time;
+		m_pProbeUpdateStates[ProbeIndex].bLightChanged = false;
+
+		ProbeUpdateRequest&	Request = m_pSB_ProbeUpdateRequests->m[ProbeUpdateIndex];
+		Request.ProbeIndex = ProbeIndex;
+		Request.EmissiveSurfacesStart = TotalEmissiveSurfacesCount;
+
+		TotalEmissiveSurfacesCount += m_pProbes[ProbeIndex].m_EmissiveSurfacesCount;
+	}
+
+	for ( int EmissiveMaterialIndex=0; EmissiveMaterialIndex < m_EmissiveMaterialIDs.GetCount(); EmissiveMaterialIndex++ ) {
+		ASSERT( _Parms.pQueryMaterial != NULL, "Invalid material query functor!" );
+		Scene::Material*	pEmissiveMaterial = (*_Parms.pQueryMaterial)( m_EmissiveMaterialIDs[EmissiveMaterialIndex] );
+		ASSERT( pEmissiveMaterial != NULL, "Invalid emissive material!" );
+		m_pSB_EmissiveMaterialColors->m[EmissiveMaterialIndex] = pEmissiveMaterial->m_EmissiveColor;
+	}
+
+	// =========================================================
+	// Gather the update infos
+	if ( ProbeUpdatesCount > 0 ) {
+		USING_COMPUTESHADER_START( *m_pCSGatherProbeUpdates )
+
+		m_pSB_ProbeUpdateRequests->Write( ProbeUpdatesCount );
+		m_pSB_ProbeUpdateRequests->SetInput( 17 );
 
+		m_pSB_StaticProbeUpdateInfos->SetInput( 18 );
+		m_pSB_StaticProbeSamples->SetInput( 19 );
+		m_pSB_StaticEmissiveSurfaces->SetInput( 20 );
+
+		m_pSB_EmissiveMaterialColors->Write( MAX( 1, m_EmissiveMaterialIDs.GetCount() ) );
+		m_pSB_EmissiveMaterialColors->SetInput( 21 );
+
+		m_pSB_RuntimeProbeUpdateInfos->SetOutput( 0 );
+		m_pSB_RuntimeProbeSamples->SetOutput( 1 );
+		m_pSB_RuntimeProbeEmissiveSurfaces->SetOutput( 2 );
+
+		M.Dispatch( ProbeUpdatesCount, 1, 1 );
+
+		USING_COMPUTE_SHADER_END
+	}
+
+#else
 	// Prepare the buffer of probe update infos and sampling point infos
 	RuntimeProbeUpdateSampleInfo*	pSampleUpdateInfos = m_pSB_RuntimeProbeSamples->m;
 	int		TotalEmissiveSurfacesCount = 0;
 	for ( U32 ProbeUpdateIndex=0; ProbeUpdateIndex < ProbeUpdatesCount; ProbeUpdateIndex++ ) {
-		// Simple at the moment, when we have the update stack we'll have to fetch the index from it...
-//		int			ProbeIndex = ProbeUpdateIndex;
-
-		// Still simple: we update N probes each frame in sequence, next frame we'll update the next N ones...
-		int			ProbeIndex = (m_ProbeUpdateIndex + ProbeUpdateIndex) % m_ProbesCount;
+		U32			ProbeIndex = pProbeIndices[ProbeUpdateIndex];
 
 		SHProbe&	Probe = m_pProbes[ProbeIndex];
 
+		// Reset the probe's priority
+		m_pProbeUpdateStates[ProbeIndex].LastUpdateTime = _Parms.Time;
+		m_pProbeUpdateStates[ProbeIndex].bLightChanged = false;
+
 		// Fill the probe update infos
 		RuntimeProbeUpdateInfo&	ProbeUpdateInfos = m_pSB_RuntimeProbeUpdateInfos->m[ProbeUpdateIndex];
 
@@ -208,20 +409,20 @@ void	SHProbeNetwork::UpdateDynamicProbes( DynamicUpdateParms& _Parms ) {
 		TotalEmissiveSurfacesCount += Probe.m_EmissiveSurfacesCount;
 	}
 
+	m_pSB_RuntimeProbeUpdateInfos->Write( ProbeUpdatesCount );
+	m_pSB_RuntimeProbeSamples->Write( ProbeUpdatesCount * SHProbe::SAMPLES_COUNT );
+	m_pSB_RuntimeProbeEmissiveSurfaces->Write( TotalEmissiveSurfacesCount );
+#endif
+
 	// =========================================================
 	// Do the update!
 	{
 		USING_COMPUTESHADER_START( *m_pCSUpdateProbeDynamicSH )
 
-		m_pSB_RuntimeSHFinal->SetInput( 8, true );	// Feed last frame's SH for neighbor bounce
+		m_pSB_RuntimeSHFinal->SetInput( 8 );	// Feed last frame's SH for neighbor bounce
 
-		m_pSB_RuntimeProbeUpdateInfos->Write( ProbeUpdatesCount );
 		m_pSB_RuntimeProbeUpdateInfos->SetInput( 10 );
-
-		m_pSB_RuntimeProbeSamples->Write( ProbeUpdatesCount * SHProbe::SAMPLES_COUNT );
 		m_pSB_RuntimeProbeSamples->SetInput( 11 );
-
-		m_pSB_RuntimeProbeEmissiveSurfaces->Write( TotalEmissiveSurfacesCount );
 		m_pSB_RuntimeProbeEmissiveSurfaces->SetInput( 12 );
 
 		m_pSB_RuntimeProbeSamplesSH->SetInput( 13 );
@@ -236,10 +437,6 @@ void	SHProbeNetwork::UpdateDynamicProbes( DynamicUpdateParms& _Parms ) {
 		USING_COMPUTE_SHADER_END
 	}
 
-	// Advance probe update index
-	if ( m_ProbesCount > 0 )
-		m_ProbeUpdateIndex = (m_ProbeUpdateIndex + ProbeUpdatesCount) % m_ProbesCount;
-
 #else
 	// Software update (no shadows!)
 	for ( int ProbeIndex=0; ProbeIndex < m_ProbesCount; ProbeIndex++ )
@@ -328,23 +525,218 @@ void	SHProbeNetwork::UpdateDynamicProbes( DynamicUpdateParms& _Parms ) {
 
 	// =========================================================
 	// Setup the input buffers for scene rendering
+	BindSceneInputs();
+
+	// =========================================================
+	// Resample the new SH into a level of the irradiance volume
+	m_IrradianceVolume.Update( _Parms.wsCameraPosition );
+	m_IrradianceVolume.Bind();
+}
+
+U32	SHProbeNetwork::ScheduleProbeUpdates( const DynamicUpdateParms& _Parms, U32 _pProbeIndices[MAX_PROBE_UPDATES_PER_FRAME] ) {
+	U32	MaxUpdatesCount = MIN( MIN( _Parms.MaxProbeUpdatesPerFrame, U32(MAX_PROBE_UPDATES_PER_FRAME) ), m_ProbesCount );
+
+	//////////////////////////////////////////////////////////////////////////
+	// Adapt the amount of updates to the GPU budget
+	U32	UpdatesCount = MaxUpdatesCount;
+	if ( _Parms.GPUBudget > 0.0f && _Parms.MeasuredGPUTime > 0.0f && m_AverageProbeUpdatesCount > 0.0f ) {
+		float	ProbeCost = _Parms.MeasuredGPUTime / m_AverageProbeUpdatesCount;
+		UpdatesCount = CLAMP( U32( _Parms.GPUBudget / ProbeCost ), MIN( 1U, MaxUpdatesCount ), MaxUpdatesCount );
+	}
+	m_AverageProbeUpdatesCount = LERP( m_AverageProbeUpdatesCount, float(UpdatesCount), AVERAGE_UPDATES_COUNT_FACTOR );
+
+	if ( UpdatesCount == 0 )
+		return 0;
+
+	//////////////////////////////////////////////////////////////////////////
+	// Flag the probes affected by the lights that changed
+	for ( U32 LightIndex=0; LightIndex < _Parms.ChangedLightsCount; LightIndex++ ) {
+		const float4&	Light = _Parms.pChangedLights[LightIndex];
+		float3			LightPosition( Light.x, Light.y, Light.z );
+		for ( U32 ProbeIndex=0; ProbeIndex < m_ProbesCount; ProbeIndex++ ) {
+			const SHProbe&	Probe = m_pProbes[ProbeIndex];
+			float			Distance = (Probe.m_wsPosition - LightPosition).Length();
+			if ( Distance < Light.w + Probe.m_MeanDistance )
+				m_pProbeUpdateStates[ProbeIndex].bLightChanged = true;	// The light reaches the geometry surrounding the probe
+		}
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+	// Keep the probes with the highest priorities, sorted by decreasing priority
+	Frustum			ViewFrustum( _Parms.World2Proj );
+	ScheduledProbe	pScheduled[MAX_PROBE_UPDATES_PER_FRAME];
+	U32				ScheduledCount = 0;
+	float			InvSqReferenceDistance = 1.0f / (PRIORITY_REFERENCE_DISTANCE * PRIORITY_REFERENCE_DISTANCE);
+	for ( U32 ProbeIndex=0; ProbeIndex < m_ProbesCount; ProbeIndex++ ) {
+		const SHProbe&			Probe = m_pProbes[ProbeIndex];
+		const ProbeUpdateState&	State = m_pProbeUpdateStates[ProbeIndex];
+
+		float	Priority = _Parms.Time - State.LastUpdateTime;
+		Priority /= 1.0f + (Probe.m_wsPosition - _Parms.wsCameraPosition).LengthSq() * InvSqReferenceDistance;
+		if ( !ViewFrustum.IsVisible( Probe.m_wsPosition, Probe.m_MeanDistance ) )
+			Priority *= PRIORITY_INVISIBLE_FACTOR;
+		if ( State.bLightChanged )
+			Priority *= PRIORITY_LIGHT_CHANGED_FACTOR;
+
+		if ( ScheduledCount == UpdatesCount && Priority <= pScheduled[ScheduledCount-1].Priority )
+			continue;	// Not important enough
+
+		// Insert
+		U32	InsertIndex = MIN( ScheduledCount, UpdatesCount-1 );
+		for ( ; InsertIndex > 0 && pScheduled[InsertIndex-1].Priority < Priority; InsertIndex-- )
+			pScheduled[InsertIndex] = pScheduled[InsertIndex-1];	// Shift less important probes (the last one is dropped if we're full)
+
+		pScheduled[InsertIndex].ProbeIndex = ProbeIndex;
+		pScheduled[InsertIndex].Priority = Priority;
+		ScheduledCount = MIN( ScheduledCount+1, UpdatesCount );
+	}
+
+	for ( U32 ScheduledIndex=0; ScheduledIndex < ScheduledCount; ScheduledIndex++ )
+		_pProbeIndices[ScheduledIndex] = pScheduled[ScheduledIndex].ProbeIndex;
+
+	return ScheduledCount;
+}
+
+void	SHProbeNetwork::BindSceneInputs() {
 	m_pSB_RuntimeProbes->SetInput( 7, true );
-	m_pSB_RuntimeSHFinal->SetInput( 8, true );
+	m_pSB_RuntimeSHFinal->SetInput( 8 );
 	m_pSB_ProbeNeighbors->SetInput( 9, true );
+
+	m_pSB_ProbeGridInfos->SetInput( 22 );
+	m_pSB_ProbeGridCells->SetInput( 23 );
+	m_pSB_ProbeGridCandidates->SetInput( 24 );
+	m_pSB_ProbeGridPositions->SetInput( 25 );
+
+	m_pSB_ProbeTetrahedra->SetInput( 37 );
+	m_pSB_ProbeTetrahedraBarycentrics->SetInput( 38 );
+	m_pSB_ProbeTetrahedronOfProbe->SetInput( 39 );
+
+	m_IrradianceVolume.Bind();
 }
 
 U32	SHProbeNetwork::GetNearestProbe( const float3& _wsPosition ) const {
-	float					ProbeDistance;
-	const SHProbe* const*	ppNearestProbe = m_ProbeOctree.FetchNearest( _wsPosition, ProbeDistance );
-	U32						probeID = ppNearestProbe != NULL ? (*ppNearestProbe)->m_ProbeID : 0xFFFFFFFFU;
-	return probeID;
+	return m_ProbeGrid.FetchNearest( _wsPosition );	// Probe IDs are their index
+}
+
+void	SHProbeNetwork::GetNearestProbes( U32 _Count, const float3* _pwsPositions, U32* _pProbeIDs ) const {
+	m_ProbeGrid.FetchNearest( _pwsPositions, _Count, _pProbeIDs );
+}
+
+U32	SHProbeNetwork::FindProbeTetrahedron( const float3& _wsPosition, U32 _TetrahedronHint, U32 _pProbeIDs[4], float4& _Weights ) const {
+	U32	TetrahedronIndex = m_ProbeTetrahedra.FindTetrahedron( _wsPosition, _TetrahedronHint, _Weights );
+	if ( TetrahedronIndex == Tetrahedralization::INVALID_INDEX ) {
+		// Too few probes for tetrahedra, use the nearest one
+		_pProbeIDs[0] = _pProbeIDs[1] = _pProbeIDs[2] = _pProbeIDs[3] = GetNearestProbe( _wsPosition );
+		_Weights.Set( 1, 0, 0, 0 );
+		return TetrahedronIndex;
+	}
+
+	const Tetrahedralization::Tetrahedron&	T = m_ProbeTetrahedra.GetTetrahedra()[TetrahedronIndex];
+	for ( int i=0; i < 4; i++ )
+		_pProbeIDs[i] = T.pVertices[i];	// Probe IDs are their index
+
+	return TetrahedronIndex;
+}
+
+const char*	SHProbeNetwork::GetSHStorageFormatMacro( SH_STORAGE_FORMAT _Format ) {
+	static const char*	ppValues[] = { "0", "1", "2" };
+	return ppValues[_Format];
 }
 
-void	SHProbeNetwork::PreComputeProbes( const char* _pPathToProbes, IRenderSceneDelegate& _RenderScene, Scene& _Scene, U32 _TotalFacesCount ) {
+int	SHProbeNetwork::GetSHStorageElementSize( SH_STORAGE_FORMAT _Format ) {
+	switch ( _Format ) {
+		case SH_STORAGE_HALF:	return sizeof(SHCoeffs3Half);
+		case SH_STORAGE_L1:		return sizeof(SHCoeffs3L1);
+		default:				return sizeof(SHCoeffs3);
+	}
+}
+
+// Must match DecodeProbeSH() in Inc/SHProbeStorage.hlsl
+void	SHProbeNetwork::EncodeRuntimeSH( SH_STORAGE_FORMAT _Format, const float3 _pSH[9], void* _pTarget ) {
+	switch ( _Format ) {
+		case SH_STORAGE_HALF: {
+			const float*	pCoeffs = &_pSH[0].x;
+			U32*			pPacked = ((SHCoeffs3Half*) _pTarget)->pPacked;
+			for ( int PairIndex=0; PairIndex < 14; PairIndex++ ) {
+				half	Low( pCoeffs[2*PairIndex+0] );
+				half	High( 2*PairIndex+1 < 27 ? pCoeffs[2*PairIndex+1] : 0.0f );
+				pPacked[PairIndex] = Low.raw | (U32( High.raw ) << 16);
+			}
+			break;
+		}
+
+		case SH_STORAGE_L1:
+			memcpy( ((SHCoeffs3L1*) _pTarget)->pSH, _pSH, 4*sizeof(float3) );
+			break;
+
+		default:
+			memcpy( ((SHCoeffs3*) _pTarget)->pSH, _pSH, 9*sizeof(float3) );
+			break;
+	}
+}
+
+namespace {
+	// Encodes a probe once the device thread has read back its cube map
+	class	EncodeProbeJob : public IJob {
+	public:
+		SHProbeEncoder*	pEncoder;
+		SHProbe*		pProbe;
+
+		virtual void	Run()	{ pEncoder->EncodeProbe( *pProbe ); }
+	};
+}
+
+void	SHProbeNetwork::PreComputeProbes( const char* _pPathToProbes, IRenderSceneDelegate& _RenderScene, Scene& _Scene, U32 _TotalFacesCount, U32 _UnitIndex, U32 _UnitsCount ) {
+
+	// Select the probes of our work unit
+	// All the probes are still needed to render the neighborhoods but only the unit's probes are rendered & encoded
+	U32		FirstProbeIndex, UnitProbesCount;
+	GetBakeWorkUnit( m_ProbesCount, _UnitIndex, _UnitsCount, FirstProbeIndex, UnitProbesCount );
+
+	List<U32>	ProbeIndices( MAX( 1U, UnitProbesCount ) );
+	for ( U32 ProbeIndex=FirstProbeIndex; ProbeIndex < FirstProbeIndex+UnitProbesCount; ProbeIndex++ )
+		ProbeIndices.Append( ProbeIndex );
+
+	List<BakeMesh>	Meshes;
+	GatherBakeMeshes( _Scene, Meshes );
+
+	if ( _UnitsCount > 1 ) {
+		// Save the unit's influences that will be merged with the other units' later
+		BakeProbes( _pPathToProbes, _RenderScene, _TotalFacesCount, ProbeIndices, Meshes, NULL );
+		SaveBakeWorkUnit( _pPathToProbes, _UnitIndex, _UnitsCount, _TotalFacesCount );
+		return;
+	}
+
+	// Save the final probe influences and what each probe saw for the next incremental bakes
+	List<SeenFace>*	pSeenFaces = new List<SeenFace>[MAX( 1U, m_ProbesCount )];
+
+	BakeProbes( _pPathToProbes, _RenderScene, _TotalFacesCount, ProbeIndices, Meshes, pSeenFaces );
+	BuildProbeInfluenceVertexStream( _Scene, _pPathToProbes );
+	SaveBakeManifest( _pPathToProbes, _Scene, Meshes, pSeenFaces );
+
+	delete[] pSeenFaces;
+}
+
+// Renders & encodes the provided probes, saves their files and collates their best influence on each face in m_ProbeInfluencePerFace
+void	SHProbeNetwork::BakeProbes( const char* _pPathToProbes, IRenderSceneDelegate& _RenderScene, U32 _TotalFacesCount, const List<U32>& _ProbeIndices, const List<BakeMesh>& _Meshes, List<SeenFace>* _pSeenFaces ) {
 
 	const float		Z_INFINITY = 1e6f;
 	const float		Z_INFINITY_TEST = 0.99f * Z_INFINITY;
 
+#ifdef _DEBUG
+	U32	MeshesFacesCount = 0;
+	for ( int MeshIndex=0; MeshIndex < _Meshes.GetCount(); MeshIndex++ )
+		MeshesFacesCount += _Meshes[MeshIndex].FacesCount;
+	ASSERT( MeshesFacesCount == _TotalFacesCount, "The meshes don't cover all the faces!" );
+#endif
+
+	// The packed network file will be rebuilt from the new probe files by LoadProbes()
+	{
+		char	pPackedFileName[1024];
+		sprintf_s( pPackedFileName, "%s%s", _pPathToProbes, PACKED_PROBES_FILE_NAME );
+		DeleteFileA( pPackedFileName );
+	}
+
 	if ( m_pRTCubeMap == NULL ) {
 		m_pRTCubeMap = new Texture2D( *m_pDevice, SHProbeEncoder::CUBE_MAP_SIZE, SHProbeEncoder::CUBE_MAP_SIZE, -6 * 3, PixelFormatRGBA32F::DESCRIPTOR, 1, NULL );				// Will contain albedo (cube 0) + (normal + distance) (cube 1) + (static lighting + emissive surface index) (cube 2)
 	}
@@ -415,6 +807,23 @@ void	SHProbeNetwork::PreComputeProbes( const char* _pPathToProbes, IRenderSceneD
 		float4x4	World2Proj;
 	};
 	CB<CBCubeMapCamera>*	pCBCubeMapCamera = new CB<CBCubeMapCamera>( *m_pDevice, 8, true );
+#ifdef MULTIVIEW_CUBE_MAPS
+	MultiView				CubeMapViews( *m_pDevice );
+#endif
+
+#ifdef PROJECT_PROBE_SH_ON_GPU
+	// Create the buffers for the GPU projection of the static lighting & occlusion SH
+	SB<SHCoeffs4>*	pSBProbeSHPartials = new SB<SHCoeffs4>( *m_pDevice, PROBE_SH_PARTIALS_COUNT, false );
+	SB<SHCoeffs4>*	pSBProbeSH = new SB<SHCoeffs4>( *m_pDevice, 1, false );
+
+	// Resolution of each face, cf. GIEncodeProbeSH.hlsl
+	struct	CBCubeMapFaces
+	{
+		U32			pFaceSizes[8];	// Only the first 6 are used
+	};
+	CB<CBCubeMapFaces>*	pCBCubeMapFaces = new CB<CBCubeMapFaces>( *m_pDevice, 11, false, Device::SSF_COMPUTE_SHADER );
+	memset( &pCBCubeMapFaces->m, 0, sizeof(CBCubeMapFaces) );
+#endif
 
 
 	//////////////////////////////////////////////////////////////////////////
@@ -428,55 +837,139 @@ void	SHProbeNetwork::PreComputeProbes( const char* _pPathToProbes, IRenderSceneD
 	}
 
 
+	//////////////////////////////////////////////////////////////////////////
+	// Create the encoders
+	// This thread renders and reads back the probes while the worker threads encode the previous ones, each probe in flight
+	//	needs its own encoder. Once all the encoders are busy, we wait for them and save their results in probe order.
+	JobQueue&		Jobs = m_pDevice->Jobs();
+	int				EncodersCount = MAX( 1, MIN( 1 + Jobs.GetWorkersCount(), _ProbeIndices.GetCount() ) );
+	SHProbeEncoder*	ppEncoders[1+JobQueue::MAX_WORKERS];
+	EncodeProbeJob	pEncodeJobs[1+JobQueue::MAX_WORKERS];
+	ppEncoders[0] = &m_ProbeEncoder;
+	for ( int EncoderIndex=1; EncoderIndex < EncodersCount; EncoderIndex++ ) {
+		ppEncoders[EncoderIndex] = new SHProbeEncoder();
+		ppEncoders[EncoderIndex]->m_pOwner = this;
+	}
+
+
 	//////////////////////////////////////////////////////////////////////////
 	// Render every probe as a cube map & process
 	//
 	char	pTemp[1024];
 
-	for ( U32 ProbeIndex=0; ProbeIndex < m_ProbesCount; ProbeIndex++ ) {
-		SHProbe&	Probe = m_pProbes[ProbeIndex];
+	for ( int BakedProbeIndex=0; BakedProbeIndex < _ProbeIndices.GetCount(); BakedProbeIndex++ ) {
+		U32				ProbeIndex = _ProbeIndices[BakedProbeIndex];
+		SHProbe&		Probe = m_pProbes[ProbeIndex];
+		int				EncoderIndex = BakedProbeIndex % EncodersCount;
+		SHProbeEncoder&	Encoder = *ppEncoders[EncoderIndex];
 
 		m_pCB_Probe->m.CurrentProbePosition = Probe.m_wsPosition;
 
-		// Clear cube maps
-		m_pDevice->ClearRenderTarget( *m_pRTCubeMap->GetRTV( 0, 6*0, 6 ), float4::Zero );
-		m_pDevice->ClearRenderTarget( *m_pRTCubeMap->GetRTV( 0, 6*1, 6 ), float4( 0, 0, 0, Z_INFINITY ) );	// We clear distance to infinity here
-
-		float4	Bisou = float4::Zero;
-		((U32&) Bisou.w) = 0xFFFFFFFFUL;
-		m_pDevice->ClearRenderTarget( *m_pRTCubeMap->GetRTV( 0, 6*2, 6 ), Bisou );	// Clear emissive surface ID to -1 (invalid) and static color to 0
-
 		// Setup probe WORLD -> LOCAL transform
 		float4x4	ProbeLocal2World = float4x4::Identity;
 					ProbeLocal2World.SetRow( 3, Probe.m_wsPosition, 1 );
 		float4x4	ProbeWorld2Local = ProbeLocal2World.Inverse();
 
-		// Render the 6 faces
-		for ( int CubeFaceIndex=0; CubeFaceIndex < 6; CubeFaceIndex++ ) {
-			// Update cube map face camera transform
-			float4x4	World2Proj = ProbeWorld2Local * SideWorld2Proj[CubeFaceIndex];
+		float4	Bisou = float4::Zero;
+		((U32&) Bisou.w) = 0xFFFFFFFFUL;
 
-			pCBCubeMapCamera->m.Camera2World = Side2Local[CubeFaceIndex] * ProbeLocal2World;
-			pCBCubeMapCamera->m.World2Proj = World2Proj;
-			pCBCubeMapCamera->UpdateData();
+		// Each face is rendered in the top-left corner of its slices at its own resolution
+		U32		pFaceSizes[6];
+		U32		RenderedFacesMask = 0x3F;
+#ifdef ADAPTIVE_PROBE_CUBE_MAPS
+		// A first pass renders all the faces at low resolution, then the faces seeing close or discontinuous geometry are rendered
+		//	again at the resolution they need (cf. ChooseCubeMapFaceSizes()). The encoder replicates the texels of low-resolution faces.
+		for ( int CubeFaceIndex=0; CubeFaceIndex < 6; CubeFaceIndex++ )
+			pFaceSizes[CubeFaceIndex] = ADAPTIVE_CUBE_MAP_MIN_SIZE;
+
+		for ( int PassIndex=0; PassIndex < 2 && RenderedFacesMask != 0; PassIndex++ ) {
+			if ( PassIndex == 1 ) {
+				pRTCubeMapStaging->CopyFrom( *m_pRTCubeMap );
+				RenderedFacesMask = ChooseCubeMapFaceSizes( *pRTCubeMapStaging, pFaceSizes );
+#ifdef MULTIVIEW_CUBE_MAPS
+				if ( RenderedFacesMask != 0 ) {
+					// All the faces share the same viewport
+					U32	MaxFaceSize = 0;
+					for ( int CubeFaceIndex=0; CubeFaceIndex < 6; CubeFaceIndex++ )
+						MaxFaceSize = MAX( MaxFaceSize, pFaceSizes[CubeFaceIndex] );
+					for ( int CubeFaceIndex=0; CubeFaceIndex < 6; CubeFaceIndex++ )
+						pFaceSizes[CubeFaceIndex] = MaxFaceSize;
+					RenderedFacesMask = 0x3F;
+				}
+#endif
+				if ( RenderedFacesMask == 0 )
+					break;	// The low-resolution faces are good enough
+			}
+#else
+		for ( int CubeFaceIndex=0; CubeFaceIndex < 6; CubeFaceIndex++ )
+			pFaceSizes[CubeFaceIndex] = SHProbeEncoder::CUBE_MAP_SIZE;
+
+		{
+#endif
+			// Clear cube maps
+			for ( int CubeFaceIndex=0; CubeFaceIndex < 6; CubeFaceIndex++ )
+				if ( RenderedFacesMask & (1 << CubeFaceIndex) ) {
+					m_pDevice->ClearRenderTarget( *m_pRTCubeMap->GetRTV( 0, 6*0+CubeFaceIndex, 1 ), float4::Zero );
+					m_pDevice->ClearRenderTarget( *m_pRTCubeMap->GetRTV( 0, 6*1+CubeFaceIndex, 1 ), float4( 0, 0, 0, Z_INFINITY ) );	// We clear distance to infinity here
+					m_pDevice->ClearRenderTarget( *m_pRTCubeMap->GetRTV( 0, 6*2+CubeFaceIndex, 1 ), Bisou );	// Clear emissive surface ID to -1 (invalid) and static color to 0
+				}
+
+#ifdef MULTIVIEW_CUBE_MAPS
+			// Render the 6 faces at once, each face is a slice of the arrays
+			{
+				CubeMapViews.SetCubeMap( Probe.m_wsPosition, 0.01f, 1000.0f );
+				CubeMapViews.Set();
 
-			ID3D11DepthStencilView*	pDSV = pRTCubeMapDepth->GetDSV( CubeFaceIndex, 1 );
+				ID3D11DepthStencilView*	pDSV = pRTCubeMapDepth->GetDSV( 0, 6 );
 
-			m_pDevice->ClearDepthStencil( *pDSV, 1.0f, 0, true, false );
+				m_pDevice->ClearDepthStencil( *pDSV, 1.0f, 0, true, false );
 
-			//////////////////////////////////////////////////////////////////////////
-			// 1] Render Albedo + Normal + Distance + Static lit + Emissive Mat ID
-			m_pDevice->SetStates( m_pDevice->m_pRS_CullFront, m_pDevice->m_pDS_ReadWriteLess, m_pDevice->m_pBS_Disabled );
-
-			ID3D11RenderTargetView*	ppViews[3] = {
-				m_pRTCubeMap->GetRTV( 0, 6*0+CubeFaceIndex, 1 ),
-				m_pRTCubeMap->GetRTV( 0, 6*1+CubeFaceIndex, 1 ),
-				m_pRTCubeMap->GetRTV( 0, 6*2+CubeFaceIndex, 1 )
-			};
-			m_pDevice->SetRenderTargets( SHProbeEncoder::CUBE_MAP_SIZE, SHProbeEncoder::CUBE_MAP_SIZE, 3, ppViews, pDSV );
-
-			// Render scene
-			_RenderScene( *m_pMatRenderCubeMap );
+				//////////////////////////////////////////////////////////////////////////
+				// 1] Render Albedo + Normal + Distance + Static lit + Emissive Mat ID
+				m_pDevice->SetStates( m_pDevice->m_pRS_CullFront, m_pDevice->m_pDS_ReadWriteLess, m_pDevice->m_pBS_Disabled );
+
+				ID3D11RenderTargetView*	ppViews[3] = {
+					m_pRTCubeMap->GetRTV( 0, 6*0, 6 ),
+					m_pRTCubeMap->GetRTV( 0, 6*1, 6 ),
+					m_pRTCubeMap->GetRTV( 0, 6*2, 6 )
+				};
+				m_pDevice->SetRenderTargets( pFaceSizes[0], pFaceSizes[0], 3, ppViews, pDSV );
+
+				// Render scene
+				_RenderScene( *m_pMatRenderCubeMap, CubeMapViews );
+			}
+#else
+			// Render the 6 faces
+			for ( int CubeFaceIndex=0; CubeFaceIndex < 6; CubeFaceIndex++ ) {
+				if ( (RenderedFacesMask & (1 << CubeFaceIndex)) == 0 )
+					continue;
+
+				// Update cube map face camera transform
+				float4x4	World2Proj = ProbeWorld2Local * SideWorld2Proj[CubeFaceIndex];
+
+				pCBCubeMapCamera->m.Camera2World = Side2Local[CubeFaceIndex] * ProbeLocal2World;
+				pCBCubeMapCamera->m.World2Proj = World2Proj;
+				pCBCubeMapCamera->UpdateData();
+
+				ID3D11DepthStencilView*	pDSV = pRTCubeMapDepth->GetDSV( CubeFaceIndex, 1 );
+
+				m_pDevice->ClearDepthStencil( *pDSV, 1.0f, 0, true, false );
+
+				//////////////////////////////////////////////////////////////////////////
+				// 1] Render Albedo + Normal + Distance + Static lit + Emissive Mat ID
+				m_pDevice->SetStates( m_pDevice->m_pRS_CullFront, m_pDevice->m_pDS_ReadWriteLess, m_pDevice->m_pBS_Disabled );
+
+				ID3D11RenderTargetView*	ppViews[3] = {
+					m_pRTCubeMap->GetRTV( 0, 6*0+CubeFaceIndex, 1 ),
+					m_pRTCubeMap->GetRTV( 0, 6*1+CubeFaceIndex, 1 ),
+					m_pRTCubeMap->GetRTV( 0, 6*2+CubeFaceIndex, 1 )
+				};
+				m_pDevice->SetRenderTargets( pFaceSizes[CubeFaceIndex], pFaceSizes[CubeFaceIndex], 3, ppViews, pDSV );
+
+				// Render scene
+				_RenderScene( *m_pMatRenderCubeMap );
+			}
+#endif
 		}
 
 		//////////////////////////////////////////////////////////////////////////
@@ -504,7 +997,7 @@ void	SHProbeNetwork::PreComputeProbes( const char* _pPathToProbes, IRenderSceneD
 
 			// Render
 			m_pDevice->SetStates( m_pDevice->m_pRS_CullNone, m_pDevice->m_pDS_ReadWriteLess, m_pDevice->m_pBS_Disabled );
-			m_pDevice->SetRenderTarget( SHProbeEncoder::CUBE_MAP_SIZE, SHProbeEncoder::CUBE_MAP_SIZE, *pRTCubeMapNeighbors->GetRTV( 0, CubeFaceIndex, 1 ), pRTCubeMapDepthCopy->GetDSV( CubeFaceIndex, 1 ) );
+			m_pDevice->SetRenderTarget( pFaceSizes[CubeFaceIndex], pFaceSizes[CubeFaceIndex], *pRTCubeMapNeighbors->GetRTV( 0, CubeFaceIndex, 1 ), pRTCubeMapDepthCopy->GetDSV( CubeFaceIndex, 1 ) );
 
 			USING_MATERIAL_START( *m_pMatRenderNeighborProbe )
 
@@ -525,66 +1018,57 @@ void	SHProbeNetwork::PreComputeProbes( const char* _pPathToProbes, IRenderSceneD
 			USING_MATERIAL_END
 		}
 
-		// Build neighbors list immediately since we need it for the Vorono splatting right after
+		// Build neighbors list immediately since we need it for the Vorono cell right after
 		pRTCubeMapNeighborsStaging->CopyFrom( *pRTCubeMapNeighbors );
 
-		m_ProbeEncoder.BuildProbeNeighborIDs( *pRTCubeMapNeighborsStaging, Probe );
+		Encoder.BuildProbeNeighborIDs( *pRTCubeMapNeighborsStaging, Probe, pFaceSizes );
 
 
 		//////////////////////////////////////////////////////////////////////////
 		// 3] Build the Vorono cells
 		// This is without a doubt the most important structure to spread the probes' influence correctly:
-		//	1) We render all connections STRICTLY VISIBLE neighbors by splatting large planes in the middle of the connection
-		//		=> This will build the planes for the Vorono cell
-		//	2) We read back the neighbor IDs and store their planes into the Vorono structure associated to the probe
-		//		=> The probe's influence will be constrained within the strict influence of this cell
+		//	1) The planes halfway to all the STRICTLY VISIBLE neighbors are intersected analytically on the CPU
+		//		=> The planes bounding the intersection are the planes of the Vorono cell
+		//	2) The probe's influence will be constrained within the strict influence of this cell
 		//	3) We'll use the Vorono cell's structure later when we'll spread the influence of the probe across the scene
 		//
-		pRTCubeMapDepthCopy->CopyFrom( *pRTCubeMapDepth );
+		Encoder.BuildProbeVoronoiCell( Probe );
 
-		((U32&) Bisou.x) = 0xFFFFFFFFUL;
-		m_pDevice->ClearRenderTarget( *pRTCubeMapNeighbors->GetRTV( 0, 0, 6 ), Bisou );	// Clear probe ID to -1 (invalid)
 
-		for ( int CubeFaceIndex=0; CubeFaceIndex < 6; CubeFaceIndex++ ) {
-			// Update cube map face camera transform
-			float4x4	World2Proj = ProbeWorld2Local * SideWorld2Proj[CubeFaceIndex];
+		//////////////////////////////////////////////////////////////////////////
+		// 3] Read back cube map and create the various dynamic samples & static SH coefficients
+#ifdef PROJECT_PROBE_SH_ON_GPU
+		// Project static lighting & occlusion into SH on the GPU, only the 9 final coefficients are read back
+		{
+			memcpy_s( pCBCubeMapFaces->m.pFaceSizes, sizeof(pCBCubeMapFaces->m.pFaceSizes), pFaceSizes, 6*sizeof(U32) );
+			pCBCubeMapFaces->UpdateData();
 
-			pCBCubeMapCamera->m.Camera2World = Side2Local[CubeFaceIndex] * ProbeLocal2World;
-			pCBCubeMapCamera->m.World2Proj = World2Proj;
-			pCBCubeMapCamera->UpdateData();
+			USING_COMPUTESHADER_START( *m_pCSProjectProbeSH )
 
-			m_pDevice->SetStates( m_pDevice->m_pRS_CullNone, m_pDevice->m_pDS_ReadWriteLess, m_pDevice->m_pBS_Disabled );
-			m_pDevice->SetRenderTarget( SHProbeEncoder::CUBE_MAP_SIZE, SHProbeEncoder::CUBE_MAP_SIZE, *pRTCubeMapNeighbors->GetRTV( 0, CubeFaceIndex, 1 ), pRTCubeMapDepthCopy->GetDSV( CubeFaceIndex, 1 ) );
+			m_pRTCubeMap->SetCS( 0, true, m_pRTCubeMap->GetSRV( 0, 0, 0, 0, true ) );	// Viewed as an array of 18 slices
+			pSBProbeSHPartials->SetOutput( 0 );
 
-			USING_MATERIAL_START( *m_pMatRenderNeighborProbe )
+			int	TilesCount = SHProbeEncoder::CUBE_MAP_SIZE / PROBE_SH_TILE_SIZE;
+			M.Dispatch( TilesCount, TilesCount, 6 );
 
-			for ( U32 NeighborProbeIndex=0; NeighborProbeIndex < U32(Probe.m_NeighborProbes.GetCount()); NeighborProbeIndex++ ) {
-				const SHProbe::NeighborProbeInfo&	NP = Probe.m_NeighborProbes[NeighborProbeIndex];
-				if ( NP.DirectlyVisible ) {
-					const float3&	NeighborProbePosition = m_pProbes[NP.ProbeID].m_wsPosition;
+			USING_COMPUTE_SHADER_END
+		}
+		{
+			USING_COMPUTESHADER_START( *m_pCSReduceProbeSH )
 
-					float3	CenterPosition = 0.5f * (Probe.m_wsPosition + NeighborProbePosition);
-					float	Distance2Neighbor = (NeighborProbePosition - Probe.m_wsPosition).Length();
+			pSBProbeSHPartials->SetInput( 1 );
+			pSBProbeSH->SetOutput( 0 );
 
-					m_pCB_Probe->m.NeighborProbeID = NP.ProbeID;
-					m_pCB_Probe->m.NeighborProbePosition = CenterPosition;
-					m_pCB_Probe->m.QuadHalfSize = min( 100.0f, 2.0f * Distance2Neighbor );
-					m_pCB_Probe->UpdateData();
+			M.Dispatch( 1, 1, 1 );
 
-					m_pScreenQuad->Render( M );
-				}
-			}
+			pSBProbeSHPartials->RemoveFromLastAssignedSlots();	// So we can bind it as output for next probe
+			m_pRTCubeMap->RemoveFromLastAssignedSlots();		// So we can render into it for next probe
 
-			USING_MATERIAL_END
+			USING_COMPUTE_SHADER_END
 		}
+		pSBProbeSH->Read();
+#endif
 
-		pRTCubeMapNeighborsStaging->CopyFrom( *pRTCubeMapNeighbors );
-
-		m_ProbeEncoder.BuildProbeVoronoiCell( *pRTCubeMapNeighborsStaging, Probe );
-
-
-		//////////////////////////////////////////////////////////////////////////
-		// 3] Read back cube map and create the various dynamic samples & static SH coefficients
 		pRTCubeMapStaging->CopyFrom( *m_pRTCubeMap );
 
 #if 0	// Save to disk for processing by the external ProbeSHEncoder tool (not needed anymore since we're doing everything in here now)
@@ -592,45 +1076,84 @@ void	SHProbeNetwork::PreComputeProbes( const char* _pPathToProbes, IRenderSceneD
 		pRTCubeMapStaging->Save( pTemp );
 #endif
 
-		m_ProbeEncoder.EncodeProbeCubeMap( *pRTCubeMapStaging, Probe, _TotalFacesCount );
+		Encoder.ReadBackProbeCubeMap( *pRTCubeMapStaging, _TotalFacesCount, pFaceSizes );
+#ifdef PROJECT_PROBE_SH_ON_GPU
+		Encoder.SetProjectedSH( pSBProbeSH->m[0].pSH );
+#endif
+
+		// Encode on a worker thread while we render the next probes
+		pEncodeJobs[EncoderIndex].pEncoder = &Encoder;
+		pEncodeJobs[EncoderIndex].pProbe = &Probe;
+		Jobs.Push( pEncodeJobs[EncoderIndex] );
 
-		// Save probe results
-		{
-			sprintf_s( pTemp, "%sProbe%02d.probeset", _pPathToProbes, ProbeIndex );
+		U32	EncodedProbesCount = EncoderIndex + 1;
+		if ( EncodedProbesCount < U32(EncodersCount) && BakedProbeIndex+1 < _ProbeIndices.GetCount() )
+			continue;	// Some encoders are still available
 
-			FILE*	pFile = NULL;
-			fopen_s( &pFile, pTemp, "wb" );
-			ASSERT( pFile != NULL, "Locked!" );
+		Jobs.Wait();
 
-			Probe.Save( pFile );
+		for ( U32 EncodedProbeIndex=0; EncodedProbeIndex < EncodedProbesCount; EncodedProbeIndex++ ) {
+			U32				DoneProbeIndex = _ProbeIndices[BakedProbeIndex+1 - EncodedProbesCount + EncodedProbeIndex];
+			SHProbe&		DoneProbe = m_pProbes[DoneProbeIndex];
+			SHProbeEncoder&	DoneEncoder = *ppEncoders[EncodedProbeIndex];
 
-			fclose( pFile );
-		}
+			// Save probe results
+			{
+				sprintf_s( pTemp, "%sProbe%02d.probeset", _pPathToProbes, DoneProbeIndex );
+
+				FILE*	pFile = NULL;
+				fopen_s( &pFile, pTemp, "wb" );
+				ASSERT( pFile != NULL, "Locked!" );
+
+				DoneProbe.Save( pFile );
+
+				fclose( pFile );
+			}
 
 #ifdef _DEBUG
-		// Save probe debug pixels (can be analyzed with the external tool found in Tools.sln => GIProbesDebugger)
-		sprintf_s( pTemp, "%sProbe%02d.probepixels", _pPathToProbes, ProbeIndex );
-		m_ProbeEncoder.SavePixels( pTemp );
+			// Save probe debug pixels (can be analyzed with the external tool found in Tools.sln => GIProbesDebugger)
+			sprintf_s( pTemp, "%sProbe%02d.probepixels", _pPathToProbes, DoneProbeIndex );
+			DoneEncoder.SavePixels( pTemp );
 #endif
 
-		//////////////////////////////////////////////////////////////////////////
-		// 4] Collate per-face probe influence for the secondary vertex stream
-		const double*	pNewInfluence = &m_ProbeEncoder.GetProbeInfluences()[0];
-		ProbeInfluence*	pCurrentInfluence = &m_ProbeInfluencePerFace[0];
-		for ( U32 FaceIndex=0; FaceIndex < _TotalFacesCount; FaceIndex++, pCurrentInfluence++, pNewInfluence++ ) {
-			if ( *pNewInfluence > pCurrentInfluence->Influence ) {
-				pCurrentInfluence->Influence = *pNewInfluence;
-				pCurrentInfluence->ProbeID = Probe.m_ProbeID;
+			//////////////////////////////////////////////////////////////////////////
+			// 4] Collate per-face probe influence for the secondary vertex stream
+			const double*	pNewInfluence = &DoneEncoder.GetProbeInfluences()[0];
+			ProbeInfluence*	pCurrentInfluence = &m_ProbeInfluencePerFace[0];
+			for ( U32 FaceIndex=0; FaceIndex < _TotalFacesCount; FaceIndex++, pCurrentInfluence++, pNewInfluence++ ) {
+				if ( *pNewInfluence > pCurrentInfluence->Influence ) {
+					pCurrentInfluence->Influence = *pNewInfluence;
+					pCurrentInfluence->ProbeID = DoneProbe.m_ProbeID;
+				}
+			}
+
+			// Record the faces the probe saw
+			if ( _pSeenFaces != NULL ) {
+				List<SeenFace>&	SeenFaces = _pSeenFaces[DoneProbeIndex];
+				SeenFaces.Clear();
+
+				pNewInfluence = &DoneEncoder.GetProbeInfluences()[0];
+				for ( int MeshIndex=0; MeshIndex < _Meshes.GetCount(); MeshIndex++ )
+					for ( U32 FaceIndex=0; FaceIndex < _Meshes[MeshIndex].FacesCount; FaceIndex++, pNewInfluence++ )
+						if ( *pNewInfluence > 0.0 ) {
+							SeenFace&	Face = SeenFaces.Append();
+							Face.MeshIndex = MeshIndex;
+							Face.FaceIndex = FaceIndex;
+							Face.Influence = *pNewInfluence;
+						}
 			}
 		}
 	}
 
-	delete pCBCubeMapCamera;
-
-	//////////////////////////////////////////////////////////////////////////
-	// Save the final probe influences
-	BuildProbeInfluenceVertexStream( _Scene, _pPathToProbes );
+	for ( int EncoderIndex=1; EncoderIndex < EncodersCount; EncoderIndex++ )
+		delete ppEncoders[EncoderIndex];
 
+	delete pCBCubeMapCamera;
+#ifdef PROJECT_PROBE_SH_ON_GPU
+	delete pCBCubeMapFaces;
+	delete pSBProbeSH;
+	delete pSBProbeSHPartials;
+#endif
 
 	//////////////////////////////////////////////////////////////////////////
 	// Release
@@ -649,7 +1172,52 @@ m_pRTCubeMap->SetPS( 64 );
 // 	delete m_pRTCubeMap;
 }
 
-void	SHProbeNetwork::MeshWithAdjacency::Build( SHProbeNetwork& _Owner, const Scene::Mesh& _Mesh, ProbeInfluence* _pProbeInfluencePerFace ) {
+// Chooses the resolution of each face of a probe cube map from the first low-resolution pass (cf. ADAPTIVE_PROBE_CUBE_MAPS)
+// A face needs more texels where the encoder's flood fill would merge different surfaces: adjacent texels at very different
+//	distances, with different orientations or at the silhouette of the scene against the sky. Faces seeing very close geometry
+//	are always rendered at full resolution since they hold most of the probe's importance (cf. SHProbeEncoder::Pixel::Importance).
+// _pFaceSizes must contain the resolution of the pass being analyzed and receives the resolution each face needs
+U32	SHProbeNetwork::ChooseCubeMapFaceSizes( Texture2D& _StagingCubeMap, U32 _pFaceSizes[6] ) {
+	U32	RenderedFacesMask = 0;
+	for ( int CubeFaceIndex=0; CubeFaceIndex < 6; CubeFaceIndex++ ) {
+		U32	FaceSize = _pFaceSizes[CubeFaceIndex];
+
+		D3D11_MAPPED_SUBRESOURCE	Map = _StagingCubeMap.Map( 0, 6*1+CubeFaceIndex );	// Normal + distance
+
+		float	MinDistance = 1e6f;
+		U32		DiscontinuitiesCount = 0;
+		for ( U32 Y=0; Y < FaceSize; Y++ ) {
+			const float4*	pRow = (const float4*) ((const U8*) Map.pData + Y * Map.RowPitch);
+			const float4*	pNextRow = Y+1 < FaceSize ? (const float4*) ((const U8*) pRow + Map.RowPitch) : NULL;
+			for ( U32 X=0; X < FaceSize; X++ ) {
+				MinDistance = MIN( MinDistance, pRow[X].w );
+				if ( X+1 < FaceSize && IsCubeMapDiscontinuity( pRow[X], pRow[X+1] ) )
+					DiscontinuitiesCount++;
+				if ( pNextRow != NULL && IsCubeMapDiscontinuity( pRow[X], pNextRow[X] ) )
+					DiscontinuitiesCount++;
+			}
+		}
+
+		_StagingCubeMap.UnMap( 0, 6*1+CubeFaceIndex );
+
+		float	DiscontinuitiesRatio = float(DiscontinuitiesCount) / (2 * FaceSize * (FaceSize-1));	// Amount of adjacent texel pairs
+
+		U32	NeededFaceSize = FaceSize;
+		if ( MinDistance < ADAPTIVE_CUBE_MAP_NEAR_DISTANCE || DiscontinuitiesRatio > ADAPTIVE_CUBE_MAP_FULL_RATIO )
+			NeededFaceSize = SHProbeEncoder::CUBE_MAP_SIZE;
+		else if ( DiscontinuitiesRatio > ADAPTIVE_CUBE_MAP_HALF_RATIO )
+			NeededFaceSize = MAX( FaceSize, SHProbeEncoder::CUBE_MAP_SIZE / 2 );
+
+		if ( NeededFaceSize != FaceSize ) {
+			_pFaceSizes[CubeFaceIndex] = NeededFaceSize;
+			RenderedFacesMask |= 1 << CubeFaceIndex;
+		}
+	}
+
+	return RenderedFacesMask;
+}
+
+void	SHProbeNetwork::MeshWithAdjacency::Build( SHProbeNetwork& _Owner, const Scene::Mesh& _Mesh, ProbeInfluence* _pProbeInfluencePerFace, List< Primitive::BuildJob >& _Jobs ) {
 
 	m_Local2World = _Mesh.m_Local2World;
 	m_World2Local = _Mesh.m_Local2World.Inverse();
@@ -660,29 +1228,19 @@ void	SHProbeNetwork::MeshWithAdjacency::Build( SHProbeNetwork& _Owner, const Sce
 	int	FaceOffset = 0;
 	for ( int PrimitiveIndex=0; PrimitiveIndex < _Mesh.m_PrimitivesCount; PrimitiveIndex++ ) {
 		const Scene::Mesh::Primitive&	SourcePrim = _Mesh.m_pPrimitives[PrimitiveIndex];
-		m_pPrimitives[PrimitiveIndex].Build( _Owner, m_Local2World, SourcePrim, _pProbeInfluencePerFace + FaceOffset );
-		FaceOffset += SourcePrim.m_FacesCount;
-	}
-}
-
-U32	SHProbeNetwork::MeshWithAdjacency::PropagateProbeInfluences( SHProbeNetwork& _Owner ) {
-	U32	spreadsCount = false;
-	for ( int PrimitiveIndex=0; PrimitiveIndex < m_PrimitivesCount; PrimitiveIndex++ ) {
-		Primitive&	P = m_pPrimitives[PrimitiveIndex];
-		spreadsCount += P.PropagateProbeInfluences( _Owner );
-	}
 
-	return spreadsCount;
-}
+		Primitive::BuildJob&	Job = _Jobs.Append();
+		Job.pOwner = &_Owner;
+		Job.Local2World = m_Local2World;
+		Job.pSourcePrimitive = &SourcePrim;
+		Job.pProbeInfluencePerFace = _pProbeInfluencePerFace + FaceOffset;
+		Job.pPrimitive = &m_pPrimitives[PrimitiveIndex];
+		Job.PassesCount = 0;
+		Job.SpreadsCount = 0;
+		Job.IsolatedVerticesCount = 0;
 
-U32	SHProbeNetwork::MeshWithAdjacency::AssignNearestProbe( SHProbeNetwork& _Owner ) {
-	U32	isolatedVerticesCount = 0;
-	for ( int PrimitiveIndex=0; PrimitiveIndex < m_PrimitivesCount; PrimitiveIndex++ ) {
-		Primitive&	P = m_pPrimitives[PrimitiveIndex];
-		isolatedVerticesCount += P.AssignNearestProbe( _Owner );
+		FaceOffset += SourcePrim.m_FacesCount;
 	}
-
-	return isolatedVerticesCount;
 }
 
 void	SHProbeNetwork::MeshWithAdjacency::RedistributeProbeIDs2Vertices( ProbeInfluence const**& _ppProbeInfluences ) const {
@@ -693,7 +1251,28 @@ void	SHProbeNetwork::MeshWithAdjacency::RedistributeProbeIDs2Vertices( ProbeInfl
 	}
 }
 
-SHProbeNetwork::MeshWithAdjacency::Primitive::VertexLink*	SHProbeNetwork::MeshWithAdjacency::Primitive::ms_ppCells[64*64*64];
+namespace {
+	// Hashes the integer coordinates of a welding cell into a bucket index (_BucketsCount must be a power of 2)
+	// Cells sharing a bucket are simply mixed in the same list, the distance test takes care of them
+	U32	HashWeldingCell( int _X, int _Y, int _Z, U32 _BucketsCount ) {
+		return ((_X * 73856093) ^ (_Y * 19349663) ^ (_Z * 83492791)) & (_BucketsCount-1);
+	}
+}
+
+void	SHProbeNetwork::MeshWithAdjacency::Primitive::BuildJob::Run() {
+	pPrimitive->Build( *pOwner, Local2World, *pSourcePrimitive, pProbeInfluencePerFace );
+
+	// Propagate best probe indices by adjacency
+	U32	spreadsCount = 1;
+	while ( spreadsCount > 0 ) {
+		PassesCount++;
+		spreadsCount = pPrimitive->PropagateProbeInfluences( *pOwner );
+		SpreadsCount += spreadsCount;
+	}
+
+	// Assign nearest probes to vertices without influence (isolated vertices)
+	IsolatedVerticesCount = pPrimitive->AssignNearestProbe( *pProbeGrid );
+}
 
 void	SHProbeNetwork::MeshWithAdjacency::Primitive::Build( SHProbeNetwork& _Owner, const float4x4& _Local2World, const Scene::Mesh::Primitive& _SourcePrimitive, ProbeInfluence* _pProbeInfluencePerFace ) {
 
@@ -704,6 +1283,7 @@ void	SHProbeNetwork::MeshWithAdjacency::Primitive::Build( SHProbeNetwork& _Owner
 	//////////////////////////////////////////////////////////////////////////
 	// Create vertices world space positions and build the linked-list of vertices located in a 64x64x64 grid subdividing the local BBox of the primitive
 	// (this will be used to quickly weld vertices together)
+	// The grid is sparse: its cells are hashed into buckets owned by the primitive so several primitives can be built concurrently
 	m_Vertices.Init( VerticesCount );
 	m_Vertices.SetCount( VerticesCount );
 
@@ -717,12 +1297,18 @@ void	SHProbeNetwork::MeshWithAdjacency::Primitive::Build( SHProbeNetwork& _Owner
 	m_VertexCells.SetCount( VerticesCount );
 
 	// Fill up the 64x64x64 cells with lists of vertices inside each cell
-	memset( ms_ppCells, 0, 64*64*64*sizeof(VertexLink*) );
+	U32	BucketsCount = 1;
+	while ( BucketsCount < 2*VerticesCount )
+		BucketsCount <<= 1;
+
+	List<VertexLink*>	Buckets( BucketsCount );
+	Buckets.SetCount( BucketsCount );
+	memset( &Buckets[0], 0, BucketsCount*sizeof(VertexLink*) );
 
 	VertexLink*	pFreeCell = &m_VertexCells[0];
 	Scene::Mesh::Primitive::VF_P3N3G3B3T2*	pSourceVertex = pSourceVertices;
 	Vertex*									pTargetVertex = &m_Vertices[0];;
-	for ( U32 VertexIndex=0; VertexIndex < VerticesCount; VertexIndex++, pSourceVertex++, pTargetVertex++, pFreeCell++ ) {
+	for ( U32 VertexIndex=0; VertexIndex < VerticesCount; VertexIndex++, pSourceVertex++, pFreeCell++ ) {
 		float3&	Position = pSourceVertex->P;
 		float3	CellPosition = (Position - BBoxMin) / BBoxCellSize;
 		U32		iCellPositionX = U32( floorf( CellPosition.x ) );
@@ -730,25 +1316,25 @@ void	SHProbeNetwork::MeshWithAdjacency::Primitive::Build( SHProbeNetwork& _Owner
 		U32		iCellPositionZ = U32( floorf( CellPosition.z ) );
 
 		// Link it into its nearest integer cell
-		pFreeCell->pNext = ms_ppCells[iCellPositionX+64*(iCellPositionY+64*iCellPositionZ)];
-		ms_ppCells[iCellPositionX+64*(iCellPositionY+64*iCellPositionZ)] = pFreeCell;
+		U32		BucketIndex = HashWeldingCell( iCellPositionX, iCellPositionY, iCellPositionZ, BucketsCount );
+		pFreeCell->pNext = Buckets[BucketIndex];
+		Buckets[BucketIndex] = pFreeCell;
 
 		pFreeCell->V = VertexIndex;
-
-		// Build world space position to interrogate probes's Vorono cells
-		pTargetVertex->wsPosition = float4( pSourceVertex->P, 1.0f ) * _Local2World;
 	}
 
+	// Build world space positions to interrogate probes's Vorono cells
+	_Local2World.TransformPoints( &pSourceVertices->P, &m_Vertices[0].wsPosition, VerticesCount, sizeof(Scene::Mesh::Primitive::VF_P3N3G3B3T2), sizeof(Vertex) );
+
 
 	//////////////////////////////////////////////////////////////////////////
 	// Build faces and assign seed per-vertex probe influences
-	const U32*		pSourceFace = _SourcePrimitive.m_pFaces;
 	ProbeInfluence* pFaceProbeInfluence = _pProbeInfluencePerFace;
 	for ( U32 FaceIndex=0; FaceIndex < FacesCount; FaceIndex++, pFaceProbeInfluence++ ) {
 		U32		V[3];
-		V[0] = *pSourceFace++;
-		V[1] = *pSourceFace++;
-		V[2] = *pSourceFace++;
+		V[0] = _SourcePrimitive.GetIndex( 3*FaceIndex+0 );
+		V[1] = _SourcePrimitive.GetIndex( 3*FaceIndex+1 );
+		V[2] = _SourcePrimitive.GetIndex( 3*FaceIndex+2 );
 
 		// Distribute probe influence to face vertices
 		if ( pFaceProbeInfluence->ProbeID != ~0UL ) {
@@ -799,6 +1385,7 @@ void	SHProbeNetwork::MeshWithAdjacency::Primitive::Build( SHProbeNetwork& _Owner
 		NewWeldedVertex.pSharingVertices = NULL;
 		NewWeldedVertex.Influence.Influence = 0.0;
 		NewWeldedVertex.Influence.ProbeID = ~0UL;	// No valid influence at the moment...
+		NewWeldedVertex.Dirty = true;				// All vertices are part of the first propagation
 
 		float3	CellPosition = (pSourceVertex->P - BBoxMin) / BBoxCellSize;
 		int		iCellPositionX = int( floorf( CellPosition.x ) );
@@ -819,9 +1406,9 @@ void	SHProbeNetwork::MeshWithAdjacency::Primitive::Build( SHProbeNetwork& _Owner
 					if ( iNeighborCellPositionX < 0 || iNeighborCellPositionX >= 64 )
 						continue;
 
-					U32			NeighborCellOffset = iNeighborCellPositionX+64*(iNeighborCellPositionY+64*iNeighborCellPositionZ);
+					U32			NeighborCellOffset = HashWeldingCell( iNeighborCellPositionX, iNeighborCellPositionY, iNeighborCellPositionZ, BucketsCount );
 					VertexLink*	pPreviousNeighborCell = NULL;
-					VertexLink*	pNeighborCell = ms_ppCells[NeighborCellOffset];
+					VertexLink*	pNeighborCell = Buckets[NeighborCellOffset];
 					while ( pNeighborCell != NULL ) {
 						float	SqDistance = (pSourceVertices[pNeighborCell->V].P - NewWeldedVertex.lsPosition).LengthSq();
 						if ( SqDistance > 0.0001f ) {
@@ -839,7 +1426,7 @@ void	SHProbeNetwork::MeshWithAdjacency::Primitive::Build( SHProbeNetwork& _Owner
 						if ( pPreviousNeighborCell != NULL )
 							pPreviousNeighborCell->pNext = pNeighborCell;
 						else 
-							ms_ppCells[NeighborCellOffset] = pNeighborCell;
+							Buckets[NeighborCellOffset] = pNeighborCell;
 
 						// Link-in this vertex as a new welded vertex
 						pWeldedCell->pNext = NewWeldedVertex.pSharingVertices;
@@ -874,12 +1461,11 @@ void	SHProbeNetwork::MeshWithAdjacency::Primitive::Build( SHProbeNetwork& _Owner
 
 	//////////////////////////////////////////////////////////////////////////
 	// Build welded vertices adjacency
-	pSourceFace = _SourcePrimitive.m_pFaces;
 	for ( U32 FaceIndex=0; FaceIndex < FacesCount; FaceIndex++ ) {
 		U32		V[3];
-		V[0] = *pSourceFace++;
-		V[1] = *pSourceFace++;
-		V[2] = *pSourceFace++;
+		V[0] = _SourcePrimitive.GetIndex( 3*FaceIndex+0 );
+		V[1] = _SourcePrimitive.GetIndex( 3*FaceIndex+1 );
+		V[2] = _SourcePrimitive.GetIndex( 3*FaceIndex+2 );
 
 		U32		WV[3] = {
 			m_Vertices[V[0]].WeldedVertexIndex,
@@ -898,11 +1484,17 @@ void	SHProbeNetwork::MeshWithAdjacency::Primitive::Build( SHProbeNetwork& _Owner
 	}
 }
 
+// Runs a single propagation pass over the frontier of vertices that changed, or whose adjacent vertices changed, since they were last propagated
+// Other vertices can't spread anything so the result is the same as a pass over all the vertices
 U32	SHProbeNetwork::MeshWithAdjacency::Primitive::PropagateProbeInfluences( SHProbeNetwork& _Owner ) {
 	U32				spreadsCount = 0;
 	WeldedVertex*	pVertex = &m_WeldedVertices[0];
 	int				VerticesCount = m_WeldedVertices.GetCount();
 	for ( int VertexIndex=0; VertexIndex < VerticesCount; VertexIndex++, pVertex++ ) {
+		if ( !pVertex->Dirty )
+			continue;
+
+		pVertex->Dirty = false;
 		spreadsCount += pVertex->PropagateProbeInfluencesBetweenVertices( _Owner ) ? 1 : 0;
 	}
 
@@ -910,7 +1502,8 @@ U32	SHProbeNetwork::MeshWithAdjacency::Primitive::PropagateProbeInfluences( SHPr
 }
 
 // Assigns the nearest probe to any isolated vertex without probe influence (worst case scenario)
-U32	SHProbeNetwork::MeshWithAdjacency::Primitive::AssignNearestProbe( SHProbeNetwork& _Owner ) {
+// The grid is queried concurrently by all the build jobs, a query doesn't depend on the amount of probes
+U32	SHProbeNetwork::MeshWithAdjacency::Primitive::AssignNearestProbe( const PointGrid& _ProbeGrid ) {
 	U32				isolatedVerticesCount = 0;
 	WeldedVertex*	pWeldedVertex = &m_WeldedVertices[0];
 	int				VerticesCount = m_WeldedVertices.GetCount();
@@ -918,16 +1511,7 @@ U32	SHProbeNetwork::MeshWithAdjacency::Primitive::AssignNearestProbe( SHProbeNet
 		if ( pWeldedVertex->Influence.ProbeID != ~0U )
 			continue;
 
-		float	NearestProbeSqDistance = FLT_MAX;
-		U32		NearestProbeIndex = ~0UL;
-		for ( U32 ProbeIndex=0; ProbeIndex < _Owner.m_ProbesCount; ProbeIndex++ ) {
-			float	SqDistance = (_Owner.m_pProbes[ProbeIndex].m_wsPosition - pWeldedVertex->wsPosition).LengthSq();
-			if ( SqDistance < NearestProbeSqDistance ) {
-				NearestProbeSqDistance = SqDistance;
-				NearestProbeIndex = ProbeIndex;
-			}
-		}
-		pWeldedVertex->Influence.ProbeID = NearestProbeIndex;
+		pWeldedVertex->Influence.ProbeID = _ProbeGrid.FetchNearest( pWeldedVertex->wsPosition );	// Probe IDs are their index
 		isolatedVerticesCount++;
 	}
 
@@ -983,11 +1567,13 @@ bool	SHProbeNetwork::MeshWithAdjacency::Primitive::WeldedVertex::PropagateProbeI
 			// Spread from this vertex to adjacent vertex
 			AdjacentVertex.Influence.Influence = ReducedInfluence0;
 			AdjacentVertex.Influence.ProbeID = Influence.ProbeID;
+			AdjacentVertex.MarkDirty();
 			spreading = true;
 		} else if ( ReducedInfluence1 > Influence.Influence ) {
 			// Spread from adjacent vertex to this vertex
 			Influence.Influence = ReducedInfluence1;
 			Influence.ProbeID = AdjacentVertex.Influence.ProbeID;
+			MarkDirty();
 			spreading = true;
 		}
 	}
@@ -995,18 +1581,29 @@ bool	SHProbeNetwork::MeshWithAdjacency::Primitive::WeldedVertex::PropagateProbeI
 	return spreading;
 }
 
-void	SHProbeNetwork::BuildProbeInfluenceVertexStream( Scene& _Scene, const char* _pPathToStreamFile ) {
+void	SHProbeNetwork::MeshWithAdjacency::Primitive::WeldedVertex::MarkDirty() {
+	Dirty = true;
+	for ( int AdjacentVertexIndex=0; AdjacentVertexIndex < AdjacentVertices.GetCount(); AdjacentVertexIndex++ )
+		AdjacentVertices[AdjacentVertexIndex]->Dirty = true;
+}
+
+void	SHProbeNetwork::BuildProbeInfluenceVertexStream( Scene& _Scene, const char* _pPathToStreamFile, const U32* const* _ppKeptMeshProbeIDs ) {
 
 	//////////////////////////////////////////////////////////////////////////
 	// Start by building adjacency structures between primitives' faces
-	List< MeshWithAdjacency >	Meshes;
+	List< MeshWithAdjacency >				Meshes;
+	List< MeshWithAdjacency::Primitive::BuildJob >	Jobs;
 	Meshes.Init( _Scene.m_MeshesCount );
+	Jobs.Init( _Scene.m_MeshesCount );
 
 	class MeshVisitor : public Scene::IVisitor {
 	public:
 		SHProbeNetwork&				m_Owner;
 		List< MeshWithAdjacency >*	m_Meshes;
+		List< MeshWithAdjacency::Primitive::BuildJob >*	m_Jobs;
 		ProbeInfluence*				m_ProbeInfluencePerFace;
+		const U32* const*			m_ppKeptMeshProbeIDs;
+		List< U32 >					m_MeshVerticesCounts;
 		U32							m_TotalFacesCount;
 		U32							m_TotalVerticesCount;
 
@@ -1016,47 +1613,58 @@ void	SHProbeNetwork::BuildProbeInfluenceVertexStream( Scene& _Scene, const char*
 				return;
 			
 			Scene::Mesh&		SourceMesh = (Scene::Mesh&) _Node;
-			MeshWithAdjacency&	TargetMesh = m_Meshes->Append();
-			TargetMesh.Build( m_Owner, SourceMesh, m_ProbeInfluencePerFace + m_TotalFacesCount );
+			if ( m_ppKeptMeshProbeIDs == NULL || m_ppKeptMeshProbeIDs[m_MeshVerticesCounts.GetCount()] == NULL ) {
+				MeshWithAdjacency&	TargetMesh = m_Meshes->Append();
+				TargetMesh.Build( m_Owner, SourceMesh, m_ProbeInfluencePerFace + m_TotalFacesCount, *m_Jobs );
+			}
 
 			// Accumulate vertices/faces count
+			U32		MeshVerticesCount = 0;
 			for ( int PrimitiveIndex=0; PrimitiveIndex < SourceMesh.m_PrimitivesCount; PrimitiveIndex++ ) {
 				Scene::Mesh::Primitive&	P = SourceMesh.m_pPrimitives[PrimitiveIndex];
 				m_TotalFacesCount += P.m_FacesCount;
-				m_TotalVerticesCount += P.m_VerticesCount;
+				MeshVerticesCount += P.m_VerticesCount;
 			}
+			m_TotalVerticesCount += MeshVerticesCount;
+			m_MeshVerticesCounts.Append( MeshVerticesCount );
 		}
 	} visitor( *this );
 	visitor.m_TotalFacesCount = 0;
 	visitor.m_TotalVerticesCount = 0;
+	visitor.m_ppKeptMeshProbeIDs = _ppKeptMeshProbeIDs;
 	visitor.m_Meshes = &Meshes;
+	visitor.m_Jobs = &Jobs;
 	visitor.m_ProbeInfluencePerFace = &m_ProbeInfluencePerFace[0];
 	_Scene.ForEach( visitor );
 
-	//////////////////////////////////////////////////////////////////////////
-	// Propagate best probe indices by adjacency
-	U32		passesCount = 0;
-	U32		spreadsCount = 1;
-	U32		averageSpreadsCount = 0;
-	while ( spreadsCount > 0 ) {
-		passesCount++;
+	// Isolated vertices get the nearest probe from a grid of the baked probes (the runtime grid isn't loaded yet)
+	float3*		pProbePositions = new float3[MAX( 1U, m_ProbesCount )];
+	for ( U32 ProbeIndex=0; ProbeIndex < m_ProbesCount; ProbeIndex++ )
+		pProbePositions[ProbeIndex] = m_pProbes[ProbeIndex].m_wsPosition;
+	PointGrid	ProbeGrid;
+	ProbeGrid.Init( pProbePositions, m_ProbesCount, _Scene.m_GlobalBBoxMin, _Scene.m_GlobalBBoxMax );
+	delete[] pProbePositions;
 
-		spreadsCount = 0;
-		for ( int MeshIndex=0; MeshIndex < Meshes.GetCount(); MeshIndex++ ) {
-			MeshWithAdjacency&	M = Meshes[MeshIndex];
-			spreadsCount += M.PropagateProbeInfluences( *this );
-		}
-		averageSpreadsCount += spreadsCount;
+	//////////////////////////////////////////////////////////////////////////
+	// Weld, propagate best probe indices by adjacency and assign nearest probes to isolated vertices, one job per primitive
+	// (the jobs list won't grow anymore so it's safe to push pointers to its elements)
+	JobQueue&	JobsQueue = m_pDevice->Jobs();
+	for ( int JobIndex=0; JobIndex < Jobs.GetCount(); JobIndex++ ) {
+		Jobs[JobIndex].pProbeGrid = &ProbeGrid;
+		JobsQueue.Push( Jobs[JobIndex] );
 	}
-	averageSpreadsCount /= (passesCount-1);
+	JobsQueue.Wait();
 
-	//////////////////////////////////////////////////////////////////////////
-	// Assign nearest probes to vertices without influence (isolated vertices)
-	U32	isolatedVerticesCount = 0;
-	for ( int MeshIndex=0; MeshIndex < Meshes.GetCount(); MeshIndex++ ) {
-		MeshWithAdjacency&	M = Meshes[MeshIndex];
-		isolatedVerticesCount += M.AssignNearestProbe( *this );
+	U32		passesCount = 0;
+	U32		averageSpreadsCount = 0;
+	U32		isolatedVerticesCount = 0;
+	for ( int JobIndex=0; JobIndex < Jobs.GetCount(); JobIndex++ ) {
+		const MeshWithAdjacency::Primitive::BuildJob&	Job = Jobs[JobIndex];
+		passesCount = MAX( passesCount, Job.PassesCount );
+		averageSpreadsCount += Job.SpreadsCount;
+		isolatedVerticesCount += Job.IsolatedVerticesCount;
 	}
+	averageSpreadsCount /= MAX( 1U, passesCount-1 );
 
 	//////////////////////////////////////////////////////////////////////////
 	// Redistribute to vertices, choosing the best probe influence each time
@@ -1065,8 +1673,14 @@ void	SHProbeNetwork::BuildProbeInfluenceVertexStream( Scene& _Scene, const char*
 
 	{
 		ProbeInfluence const**	ppInfluence = pProbeInfluencePerVertex;
-		for ( int MeshIndex=0; MeshIndex < Meshes.GetCount(); MeshIndex++ ) {
-			MeshWithAdjacency&	M = Meshes[MeshIndex];
+		int						BuiltMeshIndex = 0;
+		for ( int MeshIndex=0; MeshIndex < visitor.m_MeshVerticesCounts.GetCount(); MeshIndex++ ) {
+			if ( _ppKeptMeshProbeIDs != NULL && _ppKeptMeshProbeIDs[MeshIndex] != NULL ) {
+				ppInfluence += visitor.m_MeshVerticesCounts[MeshIndex];	// The mesh keeps its previous probe IDs
+				continue;
+			}
+
+			MeshWithAdjacency&	M = Meshes[BuiltMeshIndex++];
 			M.RedistributeProbeIDs2Vertices( ppInfluence );
 		}
 	}
@@ -1075,7 +1689,7 @@ void	SHProbeNetwork::BuildProbeInfluenceVertexStream( Scene& _Scene, const char*
 	// Save the vertex stream containing U32-packed probe IDs for each vertex
 	{
 		char	pTemp[1024];
-		sprintf_s( pTemp, "%sScene.vertexStream.U16", _pPathToStreamFile );
+		sprintf_s( pTemp, "%s%s", _pPathToStreamFile, VERTEX_STREAM_FILE_NAME );
 
 		FILE*	pFile = NULL;
 		fopen_s( &pFile, pTemp, "wb" );
@@ -1084,9 +1698,19 @@ void	SHProbeNetwork::BuildProbeInfluenceVertexStream( Scene& _Scene, const char*
 		fwrite( &visitor.m_TotalVerticesCount, sizeof(U32), 1, pFile );
 
 		ProbeInfluence const**	ppInfluence = pProbeInfluencePerVertex;
-		for ( U32 VertexIndex=0; VertexIndex < visitor.m_TotalVerticesCount; VertexIndex++, ppInfluence++ ) {
-			ASSERT( ppInfluence != NULL, "Yikes!" );
-			fwrite( &(*ppInfluence)->ProbeID, sizeof(U32), 1, pFile );
+		for ( int MeshIndex=0; MeshIndex < visitor.m_MeshVerticesCounts.GetCount(); MeshIndex++ ) {
+			U32			MeshVerticesCount = visitor.m_MeshVerticesCounts[MeshIndex];
+			const U32*	pKeptProbeIDs = _ppKeptMeshProbeIDs != NULL ? _ppKeptMeshProbeIDs[MeshIndex] : NULL;
+			if ( pKeptProbeIDs != NULL ) {
+				fwrite( pKeptProbeIDs, sizeof(U32), MeshVerticesCount, pFile );
+				ppInfluence += MeshVerticesCount;
+				continue;
+			}
+
+			for ( U32 VertexIndex=0; VertexIndex < MeshVerticesCount; VertexIndex++, ppInfluence++ ) {
+				ASSERT( ppInfluence != NULL, "Yikes!" );
+				fwrite( &(*ppInfluence)->ProbeID, sizeof(U32), 1, pFile );
+			}
 		}
 
 		fclose( pFile );
@@ -1095,30 +1719,540 @@ void	SHProbeNetwork::BuildProbeInfluenceVertexStream( Scene& _Scene, const char*
 	SAFE_DELETE_ARRAY( pProbeInfluencePerVertex );
 }
 
-static void	CopyProbeNetworkConnection( int _EntryIndex, SHProbeNetwork::RuntimeProbeNetworkInfos& _Value, void* _pUserData );
+//////////////////////////////////////////////////////////////////////////
+// Distributed bake
+//
+// Each work unit saves the .probeset files of its probes exactly like a complete bake, plus a unit file holding the size & checksum
+//	of these files and the best influence of the unit's probes on each face. The merge verifies every unit was baked from the same
+//	probes & faces with the same partition, that its probe files are the ones it saved, then keeps the best influence of all the
+//	units for each face (the units are merged in probe order so ties resolve like a complete bake) and builds the vertex stream.
+//
+namespace {
+	// FNV-1a hash
+	U32		HashBytes( const void* _pData, U32 _Size, U32 _Hash=2166136261U ) {
+		const U8*	pData = (const U8*) _pData;
+		for ( U32 i=0; i < _Size; i++ )
+			_Hash = (_Hash ^ pData[i]) * 16777619U;
+		return _Hash;
+	}
 
-void	SHProbeNetwork::LoadProbes( const char* _pPathToProbes, const float3& _SceneBBoxMin, const float3& _SceneBBoxMax ) {
+	// Returns false if the file can't be read
+	bool	ChecksumFile( const char* _pFileName, U32& _Size, U32& _Checksum ) {
+		_Size = 0;
+		_Checksum = 0;
+		MappedDiskFile	File( _pFileName );
+		if ( !File.IsValid() )
+			return false;
+
+		_Size = File.GetSize();
+		_Checksum = HashBytes( File.GetMappedMemory(), _Size );
+		return true;
+	}
+
+	bool	BakeMergeError( const char* _pError, const char* _pFileName ) {
+		char	pMessage[1024];
+		sprintf_s( pMessage, "Probe bake merge failed: %s \"%s\"!\n", _pError, _pFileName );
+		OutputDebugStringA( pMessage );
+		return false;
+	}
+}
+
+void	SHProbeNetwork::GetBakeWorkUnit( U32 _ProbesCount, U32 _UnitIndex, U32 _UnitsCount, U32& _FirstProbeIndex, U32& _UnitProbesCount ) {
+	ASSERT( _UnitsCount > 0 && _UnitIndex < _UnitsCount, "Invalid bake work unit!" );
+
+	// The units get the same amount of probes, give or take one
+	_FirstProbeIndex = U32( (U64(_ProbesCount) * _UnitIndex) / _UnitsCount );
+	_UnitProbesCount = U32( (U64(_ProbesCount) * (_UnitIndex+1)) / _UnitsCount ) - _FirstProbeIndex;
+}
+
+U32		SHProbeNetwork::ComputeBakeSignature( U32 _TotalFacesCount ) const {
+	U32	Signature = HashBytes( &m_ProbesCount, sizeof(U32) );
+		Signature = HashBytes( &_TotalFacesCount, sizeof(U32), Signature );
+	for ( U32 ProbeIndex=0; ProbeIndex < m_ProbesCount; ProbeIndex++ )
+		Signature = HashBytes( &m_pProbes[ProbeIndex].m_wsPosition, sizeof(float3), Signature );
+
+	return Signature;
+}
+
+void	SHProbeNetwork::SaveBakeWorkUnit( const char* _pPathToProbes, U32 _UnitIndex, U32 _UnitsCount, U32 _TotalFacesCount ) const {
+	BakeUnitFileHeader	Header;
+	Header.Magic = BAKE_UNIT_FILE_MAGIC;
+	Header.Version = BAKE_UNIT_FILE_VERSION;
+	Header.Signature = ComputeBakeSignature( _TotalFacesCount );
+	Header.UnitIndex = _UnitIndex;
+	Header.UnitsCount = _UnitsCount;
+	GetBakeWorkUnit( m_ProbesCount, _UnitIndex, _UnitsCount, Header.FirstProbeIndex, Header.ProbesCount );
+	Header.FacesCount = _TotalFacesCount;
+	Header.pStructureSizes[0] = sizeof(BakedProbeInfo);
+	Header.pStructureSizes[1] = sizeof(ProbeInfluence);
+
+	// Checksum the probe files we just saved
+	char	pTemp[1024];
+	BakedProbeInfo*	pProbeInfos = new BakedProbeInfo[MAX( 1U, Header.ProbesCount )];
+	for ( U32 i=0; i < Header.ProbesCount; i++ ) {
+		sprintf_s( pTemp, "%sProbe%02d.probeset", _pPathToProbes, Header.FirstProbeIndex + i );
+		bool	bProbeSaved = ChecksumFile( pTemp, pProbeInfos[i].FileSize, pProbeInfos[i].Checksum );
+		ASSERT( bProbeSaved, "Can't read back a saved probe!" );
+	}
+
+	// Write the unit file
+	char	pFileName[256];
+	sprintf_s( pFileName, BAKE_UNIT_FILE_NAME_FORMAT, _UnitIndex, _UnitsCount );
+	sprintf_s( pTemp, "%s%s", _pPathToProbes, pFileName );
 
 	FILE*	pFile = NULL;
+	fopen_s( &pFile, pTemp, "wb" );
+	ASSERT( pFile != NULL, "Can't create bake unit file!" );
+
+	fwrite( &Header, sizeof(BakeUnitFileHeader), 1, pFile );
+	fwrite( pProbeInfos, sizeof(BakedProbeInfo), Header.ProbesCount, pFile );
+	if ( _TotalFacesCount > 0 )
+		fwrite( &m_ProbeInfluencePerFace[0], sizeof(ProbeInfluence), _TotalFacesCount, pFile );
+
+	fclose( pFile );
+
+	delete[] pProbeInfos;
+}
+
+bool	SHProbeNetwork::MergeBakeWorkUnits( const char* _pPathToProbes, Scene& _Scene, U32 _TotalFacesCount, U32 _UnitsCount ) {
+	if ( _UnitsCount == 0 )
+		return BakeMergeError( "no bake units in", _pPathToProbes );
+
+	U32		Signature = ComputeBakeSignature( _TotalFacesCount );
+
+	m_ProbeInfluencePerFace.Init( _TotalFacesCount );
+	m_ProbeInfluencePerFace.SetCount( _TotalFacesCount );
+	for ( U32 FaceIndex=0; FaceIndex < _TotalFacesCount; FaceIndex++ ) {
+		m_ProbeInfluencePerFace[FaceIndex].ProbeID = ~0UL;
+		m_ProbeInfluencePerFace[FaceIndex].Influence = 0.0;
+	}
+
+	char	pFileName[256];
 	char	pTemp[1024];
+	for ( U32 UnitIndex=0; UnitIndex < _UnitsCount; UnitIndex++ ) {
+		sprintf_s( pFileName, BAKE_UNIT_FILE_NAME_FORMAT, UnitIndex, _UnitsCount );
+		sprintf_s( pTemp, "%s%s", _pPathToProbes, pFileName );
+
+		MappedDiskFile	File( pTemp );
+		if ( !File.IsValid() || File.GetSize() < sizeof(BakeUnitFileHeader) )
+			return BakeMergeError( "missing bake unit", pTemp );
+
+		U32		FirstProbeIndex, UnitProbesCount;
+		GetBakeWorkUnit( m_ProbesCount, UnitIndex, _UnitsCount, FirstProbeIndex, UnitProbesCount );
+		U32		ProbeInfosOffset = sizeof(BakeUnitFileHeader);
+		U32		InfluencesOffset = ProbeInfosOffset + UnitProbesCount * sizeof(BakedProbeInfo);
+
+		const BakeUnitFileHeader&	Header = *File.GetMappedMemory<BakeUnitFileHeader>( 0 );
+		if (	Header.Magic != BAKE_UNIT_FILE_MAGIC
+			||	Header.Version != BAKE_UNIT_FILE_VERSION
+			||	Header.pStructureSizes[0] != sizeof(BakedProbeInfo)
+			||	Header.pStructureSizes[1] != sizeof(ProbeInfluence)
+			||	File.GetSize() != InfluencesOffset + _TotalFacesCount * sizeof(ProbeInfluence) )
+			return BakeMergeError( "corrupt bake unit", pTemp );
+		if (	Header.Signature != Signature
+			||	Header.FacesCount != _TotalFacesCount
+			||	Header.UnitIndex != UnitIndex
+			||	Header.UnitsCount != _UnitsCount
+			||	Header.FirstProbeIndex != FirstProbeIndex
+			||	Header.ProbesCount != UnitProbesCount )
+			return BakeMergeError( "bake unit baked from another scene or partition", pTemp );
+
+		// Verify & load the unit's probes (we need their Voronoi cells to spread their influence)
+		const BakedProbeInfo*	pProbeInfos = File.GetMappedMemory<BakedProbeInfo>( ProbeInfosOffset );
+		for ( U32 i=0; i < UnitProbesCount; i++ ) {
+			U32		ProbeIndex = FirstProbeIndex + i;
+			sprintf_s( pTemp, "%sProbe%02d.probeset", _pPathToProbes, ProbeIndex );
+
+			U32		FileSize, Checksum;
+			if ( !ChecksumFile( pTemp, FileSize, Checksum ) || FileSize != pProbeInfos[i].FileSize || Checksum != pProbeInfos[i].Checksum )
+				return BakeMergeError( "missing or modified probe", pTemp );
+
+			FILE*	pFile = NULL;
+			fopen_s( &pFile, pTemp, "rb" );
+			if ( pFile == NULL )
+				return BakeMergeError( "can't read probe", pTemp );
+
+			m_pProbes[ProbeIndex].Load( pFile );
+
+			fclose( pFile );
+		}
+
+		// Keep the best influence of each face
+		const ProbeInfluence*	pUnitInfluence = File.GetMappedMemory<ProbeInfluence>( InfluencesOffset );
+		for ( U32 FaceIndex=0; FaceIndex < _TotalFacesCount; FaceIndex++, pUnitInfluence++ ) {
+			ProbeInfluence&	Influence = m_ProbeInfluencePerFace[FaceIndex];
+			if ( pUnitInfluence->Influence > Influence.Influence )
+				Influence = *pUnitInfluence;
+		}
+	}
+
+	// The packed network file will be rebuilt from the merged probe files by LoadProbes()
+	sprintf_s( pTemp, "%s%s", _pPathToProbes, PACKED_PROBES_FILE_NAME );
+	DeleteFileA( pTemp );
+
+	// The manifest of the last complete bake doesn't match the merged probes anymore
+	sprintf_s( pTemp, "%s%s", _pPathToProbes, BAKE_MANIFEST_FILE_NAME );
+	DeleteFileA( pTemp );
+
+	BuildProbeInfluenceVertexStream( _Scene, _pPathToProbes );
 
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Incremental bake
+//
+// The manifest saved by a complete bake is a BakeManifestHeader followed by a BakeMesh for each mesh of the scene (in the visitor's order),
+//	the amount of faces seen by each probe then the SeenFace of all the probes one after another.
+// The next bake matches the current meshes with the baked ones by signature: the probes that saw a baked mesh without a match
+//	or whose farthest pixel is farther than the bounding box of a current mesh without a match are rebaked, the others keep
+//	their files and the faces they saw. Meshes whose best face influences didn't change keep their previous probe IDs.
+//
+namespace {
+	float	DistanceToBBox( const float3& _Position, const float3& _BBoxMin, const float3& _BBoxMax ) {
+		float3	Delta(	MAX( 0.0f, MAX( _BBoxMin.x - _Position.x, _Position.x - _BBoxMax.x ) ),
+						MAX( 0.0f, MAX( _BBoxMin.y - _Position.y, _Position.y - _BBoxMax.y ) ),
+						MAX( 0.0f, MAX( _BBoxMin.z - _Position.z, _Position.z - _BBoxMax.z ) ) );
+		return Delta.Length();
+	}
+}
+
+void	SHProbeNetwork::GatherBakeMeshes( Scene& _Scene, List<BakeMesh>& _Meshes ) const {
+	_Meshes.Init( _Scene.m_MeshesCount );
+	for ( int MeshIndex=0; MeshIndex < _Scene.m_MeshesCount; MeshIndex++ ) {
+		const Scene::Mesh&	SourceMesh = *_Scene.m_ppMeshes[MeshIndex];
+		BakeMesh&			Mesh = _Meshes.Append();
+		Mesh.Signature = HashBytes( &SourceMesh.m_Local2World, sizeof(float4x4) );
+		Mesh.FacesCount = 0;
+		Mesh.VerticesCount = 0;
+		Mesh.GlobalBBoxMin = SourceMesh.m_GlobalBBoxMin;
+		Mesh.GlobalBBoxMax = SourceMesh.m_GlobalBBoxMax;
+
+		for ( int PrimitiveIndex=0; PrimitiveIndex < SourceMesh.m_PrimitivesCount; PrimitiveIndex++ ) {
+			const Scene::Mesh::Primitive&	P = SourceMesh.m_pPrimitives[PrimitiveIndex];
+			U32		IndexSize = P.m_IndexFormat == DXGI_FORMAT_R16_UINT ? sizeof(U16) : sizeof(U32);
+			Mesh.Signature = HashBytes( P.m_pVertices, P.m_VerticesCount * sizeof(Scene::Mesh::Primitive::VF_P3N3G3B3T2), Mesh.Signature );
+			Mesh.Signature = HashBytes( P.m_pFaces, 3 * P.m_FacesCount * IndexSize, Mesh.Signature );
+
+			// The probes also saw the materials
+			const Scene::Material&	M = *P.m_pMaterial;
+			U32		pTextureIDs[3] = { M.m_TexDiffuseAlbedo.m_ID, M.m_TexSpecularAlbedo.m_ID, M.m_TexNormal.m_ID };
+			Mesh.Signature = HashBytes( &M.m_ID, sizeof(U32), Mesh.Signature );
+			Mesh.Signature = HashBytes( &M.m_DiffuseAlbedo, sizeof(float3), Mesh.Signature );
+			Mesh.Signature = HashBytes( &M.m_SpecularAlbedo, sizeof(float3), Mesh.Signature );
+			Mesh.Signature = HashBytes( &M.m_SpecularExponent, sizeof(float3), Mesh.Signature );
+			Mesh.Signature = HashBytes( &M.m_EmissiveColor, sizeof(float3), Mesh.Signature );
+			Mesh.Signature = HashBytes( pTextureIDs, sizeof(pTextureIDs), Mesh.Signature );
+
+			Mesh.FacesCount += P.m_FacesCount;
+			Mesh.VerticesCount += P.m_VerticesCount;
+		}
+	}
+}
+
+U32		SHProbeNetwork::ComputeBakeManifestSignature( Scene& _Scene ) const {
+	// The probes' neighborhoods & the static lighting they baked depend on all the probes & lights
+	U32		Signature = HashBytes( &m_ProbesCount, sizeof(U32) );
+	for ( U32 ProbeIndex=0; ProbeIndex < m_ProbesCount; ProbeIndex++ )
+		Signature = HashBytes( &m_pProbes[ProbeIndex].m_wsPosition, sizeof(float3), Signature );
+
+	for ( int LightIndex=0; LightIndex < _Scene.m_LightsCount; LightIndex++ ) {
+		const Scene::Light&	Light = *_Scene.m_ppLights[LightIndex];
+		Signature = HashBytes( &Light.m_LightType, sizeof(Light.m_LightType), Signature );
+		Signature = HashBytes( &Light.m_Local2World, sizeof(float4x4), Signature );
+		Signature = HashBytes( &Light.m_Color, sizeof(float3), Signature );
+		Signature = HashBytes( &Light.m_Intensity, sizeof(float), Signature );
+		Signature = HashBytes( &Light.m_HotSpot, sizeof(float), Signature );
+		Signature = HashBytes( &Light.m_Falloff, sizeof(float), Signature );
+	}
+
+	return Signature;
+}
+
+// Keeps the best influence of the probes on each face, in probe order like the bake does
+void	SHProbeNetwork::CollateSeenFaces( U32 _ProbesCount, const List<BakeMesh>& _Meshes, const List<SeenFace>* _pSeenFaces, List<ProbeInfluence>& _ProbeInfluencePerFace ) {
+	List<U32>	MeshFirstFaces( MAX( 1, _Meshes.GetCount() ) );
+	U32			TotalFacesCount = 0;
+	for ( int MeshIndex=0; MeshIndex < _Meshes.GetCount(); MeshIndex++ ) {
+		MeshFirstFaces.Append( TotalFacesCount );
+		TotalFacesCount += _Meshes[MeshIndex].FacesCount;
+	}
+
+	_ProbeInfluencePerFace.Init( TotalFacesCount );
+	_ProbeInfluencePerFace.SetCount( TotalFacesCount );
+	for ( U32 FaceIndex=0; FaceIndex < TotalFacesCount; FaceIndex++ ) {
+		_ProbeInfluencePerFace[FaceIndex].ProbeID = ~0UL;
+		_ProbeInfluencePerFace[FaceIndex].Influence = 0.0;
+	}
+
+	for ( U32 ProbeIndex=0; ProbeIndex < _ProbesCount; ProbeIndex++ ) {
+		const List<SeenFace>&	SeenFaces = _pSeenFaces[ProbeIndex];
+		for ( int SeenFaceIndex=0; SeenFaceIndex < SeenFaces.GetCount(); SeenFaceIndex++ ) {
+			const SeenFace&	Face = SeenFaces[SeenFaceIndex];
+			ProbeInfluence&	Influence = _ProbeInfluencePerFace[MeshFirstFaces[Face.MeshIndex] + Face.FaceIndex];
+			if ( Face.Influence > Influence.Influence ) {
+				Influence.Influence = Face.Influence;
+				Influence.ProbeID = ProbeIndex;
+			}
+		}
+	}
+}
+
+void	SHProbeNetwork::SaveBakeManifest( const char* _pPathToProbes, Scene& _Scene, const List<BakeMesh>& _Meshes, const List<SeenFace>* _pSeenFaces ) const {
+	BakeManifestHeader	Header;
+	Header.Magic = BAKE_MANIFEST_MAGIC;
+	Header.Version = BAKE_MANIFEST_VERSION;
+	Header.Signature = ComputeBakeManifestSignature( _Scene );
+	Header.ProbesCount = m_ProbesCount;
+	Header.MeshesCount = _Meshes.GetCount();
+	Header.SeenFacesCount = 0;
+	for ( U32 ProbeIndex=0; ProbeIndex < m_ProbesCount; ProbeIndex++ )
+		Header.SeenFacesCount += _pSeenFaces[ProbeIndex].GetCount();
+	Header.pStructureSizes[0] = sizeof(BakeMesh);
+	Header.pStructureSizes[1] = sizeof(SeenFace);
+
+	char	pTemp[1024];
+	sprintf_s( pTemp, "%s%s", _pPathToProbes, BAKE_MANIFEST_FILE_NAME );
+
+	FILE*	pFile = NULL;
+	fopen_s( &pFile, pTemp, "wb" );
+	if ( pFile == NULL )
+		return;	// Not critical, the next bake will simply rebake everything...
+
+	fwrite( &Header, sizeof(BakeManifestHeader), 1, pFile );
+	if ( _Meshes.GetCount() > 0 )
+		fwrite( &_Meshes[0], sizeof(BakeMesh), _Meshes.GetCount(), pFile );
+	for ( U32 ProbeIndex=0; ProbeIndex < m_ProbesCount; ProbeIndex++ ) {
+		U32	SeenFacesCount = _pSeenFaces[ProbeIndex].GetCount();
+		fwrite( &SeenFacesCount, sizeof(U32), 1, pFile );
+	}
+	for ( U32 ProbeIndex=0; ProbeIndex < m_ProbesCount; ProbeIndex++ )
+		if ( _pSeenFaces[ProbeIndex].GetCount() > 0 )
+			fwrite( &_pSeenFaces[ProbeIndex][0], sizeof(SeenFace), _pSeenFaces[ProbeIndex].GetCount(), pFile );
+
+	fclose( pFile );
+}
+
+void	SHProbeNetwork::RebakeProbes( const char* _pPathToProbes, IRenderSceneDelegate& _RenderScene, Scene& _Scene, U32 _TotalFacesCount ) {
+	char	pTemp[1024];
+
+	List<BakeMesh>	Meshes;
+	GatherBakeMeshes( _Scene, Meshes );
+
+	//////////////////////////////////////////////////////////////////////////
+	// Read the manifest & the vertex stream of the last bake
+	// (they're copied so the files aren't mapped anymore when we overwrite them)
+	List<BakeMesh>	BakedMeshes;
+	List<SeenFace>*	pBakedSeenFaces = new List<SeenFace>[MAX( 1U, m_ProbesCount )];
+	List<U32>		BakedProbeIDs;
+	bool			bValidManifest = false;
+	{
+		sprintf_s( pTemp, "%s%s", _pPathToProbes, BAKE_MANIFEST_FILE_NAME );
+		MappedDiskFile	Manifest( pTemp );
+		sprintf_s( pTemp, "%s%s", _pPathToProbes, VERTEX_STREAM_FILE_NAME );
+		MappedDiskFile	Stream( pTemp );
+
+		const BakeManifestHeader*	pHeader = Manifest.IsValid() && Manifest.GetSize() >= sizeof(BakeManifestHeader) ? Manifest.GetMappedMemory<BakeManifestHeader>( 0 ) : NULL;
+		bValidManifest =	pHeader != NULL
+						&&	pHeader->Magic == BAKE_MANIFEST_MAGIC
+						&&	pHeader->Version == BAKE_MANIFEST_VERSION
+						&&	pHeader->pStructureSizes[0] == sizeof(BakeMesh)
+						&&	pHeader->pStructureSizes[1] == sizeof(SeenFace)
+						&&	pHeader->ProbesCount == m_ProbesCount
+						&&	pHeader->Signature == ComputeBakeManifestSignature( _Scene )
+						&&	Manifest.GetSize() == sizeof(BakeManifestHeader) + pHeader->MeshesCount * sizeof(BakeMesh) + m_ProbesCount * sizeof(U32) + pHeader->SeenFacesCount * sizeof(SeenFace);
+
+		if ( bValidManifest ) {
+			U32		Offset = sizeof(BakeManifestHeader);
+			BakedMeshes.Init( MAX( 1U, pHeader->MeshesCount ) );
+			BakedMeshes.AppendRange( Manifest.GetMappedMemory<BakeMesh>( Offset ), pHeader->MeshesCount );
+			Offset += pHeader->MeshesCount * sizeof(BakeMesh);
+
+			const U32*	pSeenFacesCounts = Manifest.GetMappedMemory<U32>( Offset );
+			Offset += m_ProbesCount * sizeof(U32);
+			for ( U32 ProbeIndex=0; ProbeIndex < m_ProbesCount; ProbeIndex++ ) {
+				bValidManifest &= Offset + pSeenFacesCounts[ProbeIndex] * sizeof(SeenFace) <= Manifest.GetSize();
+				if ( !bValidManifest )
+					break;
+
+				pBakedSeenFaces[ProbeIndex].Init( MAX( 1U, pSeenFacesCounts[ProbeIndex] ) );
+				pBakedSeenFaces[ProbeIndex].AppendRange( Manifest.GetMappedMemory<SeenFace>( Offset ), pSeenFacesCounts[ProbeIndex] );
+				Offset += pSeenFacesCounts[ProbeIndex] * sizeof(SeenFace);
+			}
+
+			// The vertex stream must be the one of the baked meshes
+			U32		BakedVerticesCount = 0;
+			for ( int MeshIndex=0; MeshIndex < BakedMeshes.GetCount(); MeshIndex++ )
+				BakedVerticesCount += BakedMeshes[MeshIndex].VerticesCount;
+
+			bValidManifest &=	Stream.IsValid()
+							&&	Stream.GetSize() == (1 + BakedVerticesCount) * sizeof(U32)
+							&&	*Stream.GetMappedMemory<U32>( 0 ) == BakedVerticesCount;
+			if ( bValidManifest ) {
+				BakedProbeIDs.Init( MAX( 1U, BakedVerticesCount ) );
+				BakedProbeIDs.AppendRange( Stream.GetMappedMemory<U32>( sizeof(U32) ), BakedVerticesCount );
+			}
+		}
+	}
+	if ( !bValidManifest ) {
+		delete[] pBakedSeenFaces;
+		PreComputeProbes( _pPathToProbes, _RenderScene, _Scene, _TotalFacesCount );	// Rebake everything
+		return;
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+	// Match the meshes with the baked ones, the ones without a match changed (or were added or removed)
+	List<U32>	BakedMeshOfMesh( MAX( 1, Meshes.GetCount() ) );
+	List<U32>	MeshOfBakedMesh( MAX( 1, BakedMeshes.GetCount() ) );
+	for ( int BakedMeshIndex=0; BakedMeshIndex < BakedMeshes.GetCount(); BakedMeshIndex++ )
+		MeshOfBakedMesh.Append( ~0U );
+	for ( int MeshIndex=0; MeshIndex < Meshes.GetCount(); MeshIndex++ ) {
+		U32		Signature = Meshes[MeshIndex].Signature;
+		U32		BakedMeshIndex = MeshIndex < BakedMeshes.GetCount() && MeshOfBakedMesh[MeshIndex] == ~0U && BakedMeshes[MeshIndex].Signature == Signature ? MeshIndex : ~0U;	// Most meshes stay in place
+		for ( int CandidateIndex=0; BakedMeshIndex == ~0U && CandidateIndex < BakedMeshes.GetCount(); CandidateIndex++ )
+			if ( MeshOfBakedMesh[CandidateIndex] == ~0U && BakedMeshes[CandidateIndex].Signature == Signature )
+				BakedMeshIndex = CandidateIndex;
+
+		BakedMeshOfMesh.Append( BakedMeshIndex );
+		if ( BakedMeshIndex != ~0U )
+			MeshOfBakedMesh[BakedMeshIndex] = MeshIndex;
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+	// Find the probes to rebake
+	bool*		pRebakeProbes = new bool[MAX( 1U, m_ProbesCount )];
+	List<U32>	ProbeIndices( MAX( 1U, m_ProbesCount ) );
 	for ( U32 ProbeIndex=0; ProbeIndex < m_ProbesCount; ProbeIndex++ ) {
 		SHProbe&	Probe = m_pProbes[ProbeIndex];
 
-		// Read numbered probe
+		// Load the baked probe, we need its farthest pixel distance & its Vorono cell
 		sprintf_s( pTemp, "%sProbe%02d.probeset", _pPathToProbes, ProbeIndex );
+		FILE*	pFile = NULL;
 		fopen_s( &pFile, pTemp, "rb" );
-		if ( pFile == NULL ) {
-			// Not ready yet (happens for first time computation!)
-			memset( Probe.m_pSamples, 0, SHProbe::SAMPLES_COUNT*sizeof(SHProbe::Sample) );
-			Probe.m_EmissiveSurfacesCount = 0;
+		bool	bRebake = pFile == NULL;
+		if ( pFile != NULL ) {
+			Probe.Load( pFile );
+			fclose( pFile );
+		}
+
+		// Did it see a mesh that changed?
+		const List<SeenFace>&	SeenFaces = pBakedSeenFaces[ProbeIndex];
+		for ( int SeenFaceIndex=0; !bRebake && SeenFaceIndex < SeenFaces.GetCount(); SeenFaceIndex++ )
+			bRebake = MeshOfBakedMesh[SeenFaces[SeenFaceIndex].MeshIndex] == ~0U;
+
+		// Could it see a mesh that changed?
+		for ( int MeshIndex=0; !bRebake && MeshIndex < Meshes.GetCount(); MeshIndex++ )
+			bRebake = BakedMeshOfMesh[MeshIndex] == ~0U && DistanceToBBox( Probe.m_wsPosition, Meshes[MeshIndex].GlobalBBoxMin, Meshes[MeshIndex].GlobalBBoxMax ) <= Probe.m_MaxDistance;
+
+		pRebakeProbes[ProbeIndex] = bRebake;
+		if ( bRebake )
+			ProbeIndices.Append( ProbeIndex );
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+	// Rebake them, the other probes keep the faces they saw
+	List<SeenFace>*	pSeenFaces = new List<SeenFace>[MAX( 1U, m_ProbesCount )];
+	for ( U32 ProbeIndex=0; ProbeIndex < m_ProbesCount; ProbeIndex++ ) {
+		if ( pRebakeProbes[ProbeIndex] )
 			continue;
+
+		const List<SeenFace>&	BakedSeenFaces = pBakedSeenFaces[ProbeIndex];
+		pSeenFaces[ProbeIndex].Init( MAX( 1, BakedSeenFaces.GetCount() ) );
+		for ( int SeenFaceIndex=0; SeenFaceIndex < BakedSeenFaces.GetCount(); SeenFaceIndex++ ) {
+			SeenFace&	Face = pSeenFaces[ProbeIndex].Append();
+			Face = BakedSeenFaces[SeenFaceIndex];
+			Face.MeshIndex = MeshOfBakedMesh[Face.MeshIndex];
 		}
-//		ASSERT( pFile != NULL, "Can't find probeset test file!" );
+	}
 
-		Probe.Load( pFile );
+	if ( ProbeIndices.GetCount() > 0 )
+		BakeProbes( _pPathToProbes, _RenderScene, _TotalFacesCount, ProbeIndices, Meshes, pSeenFaces );
 
-		fclose( pFile );
+	// The influences of the rebaked probes were collated by the bake, collate all the probes now
+	CollateSeenFaces( m_ProbesCount, Meshes, pSeenFaces, m_ProbeInfluencePerFace );
+	ASSERT( U32(m_ProbeInfluencePerFace.GetCount()) == _TotalFacesCount, "Faces count mismatch!" );
+
+	//////////////////////////////////////////////////////////////////////////
+	// Only rebuild the vertex stream of the meshes whose face influences changed
+	List<ProbeInfluence>	BakedProbeInfluencePerFace;
+	CollateSeenFaces( m_ProbesCount, BakedMeshes, pBakedSeenFaces, BakedProbeInfluencePerFace );
+
+	List<const U32*>	KeptMeshProbeIDs( MAX( 1, Meshes.GetCount() ) );
+	U32		FirstFace = 0;
+	for ( int MeshIndex=0; MeshIndex < Meshes.GetCount(); MeshIndex++ ) {
+		const U32*	pKeptProbeIDs = NULL;
+		U32			BakedMeshIndex = BakedMeshOfMesh[MeshIndex];
+		if ( BakedMeshIndex != ~0U ) {
+			U32		BakedFirstFace = 0;
+			U32		BakedFirstVertex = 0;
+			for ( U32 i=0; i < BakedMeshIndex; i++ ) {
+				BakedFirstFace += BakedMeshes[i].FacesCount;
+				BakedFirstVertex += BakedMeshes[i].VerticesCount;
+			}
+
+			bool	bChanged = false;
+			for ( U32 FaceIndex=0; !bChanged && FaceIndex < Meshes[MeshIndex].FacesCount; FaceIndex++ ) {
+				const ProbeInfluence&	Influence = m_ProbeInfluencePerFace[FirstFace + FaceIndex];
+				const ProbeInfluence&	BakedInfluence = BakedProbeInfluencePerFace[BakedFirstFace + FaceIndex];
+				bChanged =	Influence.ProbeID != BakedInfluence.ProbeID
+						||	Influence.Influence != BakedInfluence.Influence
+						||	(Influence.ProbeID != ~0UL && pRebakeProbes[Influence.ProbeID]);	// Its Vorono cell may have changed
+			}
+
+			if ( !bChanged && Meshes[MeshIndex].VerticesCount > 0 )
+				pKeptProbeIDs = &BakedProbeIDs[BakedFirstVertex];
+		}
+
+		KeptMeshProbeIDs.Append( pKeptProbeIDs );
+		FirstFace += Meshes[MeshIndex].FacesCount;
+	}
+
+	// The probes of each mesh are spread using all the probes' Vorono cells, that's why they were all loaded
+	BuildProbeInfluenceVertexStream( _Scene, _pPathToProbes, Meshes.GetCount() > 0 ? &KeptMeshProbeIDs[0] : NULL );
+	SaveBakeManifest( _pPathToProbes, _Scene, Meshes, pSeenFaces );
+
+	delete[] pSeenFaces;
+	delete[] pRebakeProbes;
+	delete[] pBakedSeenFaces;
+}
+
+static void	CopyProbeNetworkConnection( int _EntryIndex, SHProbeNetwork::RuntimeProbeNetworkInfos& _Value, void* _pUserData );
+
+void	SHProbeNetwork::LoadProbes( const char* _pPathToProbes, const float3& _SceneBBoxMin, const float3& _SceneBBoxMax ) {
+	ReleaseLoadedProbes();	// Loading again
+
+	FILE*	pFile = NULL;
+	char	pTemp[1024];
+
+	// Try the packed network file first
+	char	pPackedFileName[1024];
+	sprintf_s( pPackedFileName, "%s%s", _pPathToProbes, PACKED_PROBES_FILE_NAME );
+	if ( !LoadPackedProbes( pPackedFileName ) ) {
+		// Load individual probe files
+		bool	bAllProbesLoaded = true;
+		for ( U32 ProbeIndex=0; ProbeIndex < m_ProbesCount; ProbeIndex++ ) {
+			SHProbe&	Probe = m_pProbes[ProbeIndex];
+
+			// Read numbered probe
+			sprintf_s( pTemp, "%sProbe%02d.probeset", _pPathToProbes, ProbeIndex );
+			fopen_s( &pFile, pTemp, "rb" );
+			if ( pFile == NULL ) {
+				// Not ready yet (happens for first time computation!)
+				memset( Probe.m_pSamples, 0, SHProbe::SAMPLES_COUNT*sizeof(SHProbe::Sample) );
+				Probe.m_EmissiveSurfacesCount = 0;
+				bAllProbesLoaded = false;
+				continue;
+			}
+//			ASSERT( pFile != NULL, "Can't find probeset test file!" );
+
+			Probe.Load( pFile );
+
+			fclose( pFile );
+		}
+
+		// Pack them for next time
+		if ( bAllProbesLoaded )
+			SavePackedProbes( pPackedFileName, false );
 	}
 
 
@@ -1170,22 +2304,91 @@ void	SHProbeNetwork::LoadProbes( const char* _pPathToProbes, const float3& _Scen
 	m_pSB_ProbeNeighbors->Write();
 
 
+	//////////////////////////////////////////////////////////////////////////
+	// Upload the static probes update infos once and for all
+#ifdef GATHER_PROBE_UPDATES_ON_GPU
+	U32		TotalEmissiveSurfacesCount = 0;
+	for ( U32 ProbeIndex=0; ProbeIndex < m_ProbesCount; ProbeIndex++ )
+		TotalEmissiveSurfacesCount += m_pProbes[ProbeIndex].m_EmissiveSurfacesCount;
+
+	m_pSB_StaticProbeUpdateInfos = new SB<RuntimeProbeUpdateInfo>( *m_pDevice, m_ProbesCount, true );
+	m_pSB_StaticProbeSamples = new SB<RuntimeProbeUpdateSampleInfo>( *m_pDevice, m_ProbesCount*SHProbe::SAMPLES_COUNT, true );
+	m_pSB_StaticEmissiveSurfaces = new SB<StaticEmissiveSurfaceInfo>( *m_pDevice, MAX( 1U, TotalEmissiveSurfacesCount ), true );
+
+	m_EmissiveMaterialIDs.Clear();
+
+	RuntimeProbeUpdateSampleInfo*	pStaticSample = m_pSB_StaticProbeSamples->m;
+	StaticEmissiveSurfaceInfo*		pStaticEmissiveSurface = m_pSB_StaticEmissiveSurfaces->m;
+	TotalEmissiveSurfacesCount = 0;
+	for ( U32 ProbeIndex=0; ProbeIndex < m_ProbesCount; ProbeIndex++ ) {
+		SHProbe&	Probe = m_pProbes[ProbeIndex];
+
+		// Fill the probe update infos
+		RuntimeProbeUpdateInfo&	ProbeUpdateInfos = m_pSB_StaticProbeUpdateInfos->m[ProbeIndex];
+
+		ProbeUpdateInfos.Index = ProbeIndex;
+		ProbeUpdateInfos.EmissiveSurfacesStart = TotalEmissiveSurfacesCount;
+		ProbeUpdateInfos.EmissiveSurfacesCount = Probe.m_EmissiveSurfacesCount;
+
+		for ( int NeighborIndex=0; NeighborIndex < 4; NeighborIndex++ )
+			ProbeUpdateInfos.NeighborProbeIDs[NeighborIndex] = Probe.m_NeighborProbes[NeighborIndex].ProbeID;
+		for( int i=0; i < 9; i++ ) {
+			ProbeUpdateInfos.SHConvolution[i].x = Probe.m_NeighborProbes[0].SH[i];
+			ProbeUpdateInfos.SHConvolution[i].y = Probe.m_NeighborProbes[1].SH[i];
+			ProbeUpdateInfos.SHConvolution[i].z = Probe.m_NeighborProbes[2].SH[i];
+			ProbeUpdateInfos.SHConvolution[i].w = Probe.m_NeighborProbes[3].SH[i];
+		}
+
+		// Fill the samples update infos
+		SHProbe::Sample*	pSample = Probe.m_pSamples;
+		for ( U32 SampleIndex=0; SampleIndex < SHProbe::SAMPLES_COUNT; SampleIndex++, pSample++, pStaticSample++ ) {
+			pStaticSample->Position = pSample->Position;
+			pStaticSample->Normal = pSample->Normal;
+			pStaticSample->Albedo = pSample->SHFactor * pSample->Albedo;
+			pStaticSample->Radius = pSample->Radius;
+		}
+
+		// Fill the emissive surface update infos (colors are queried from the materials at runtime)
+		for ( U32 EmissiveSurfaceIndex=0; EmissiveSurfaceIndex < Probe.m_EmissiveSurfacesCount; EmissiveSurfaceIndex++, pStaticEmissiveSurface++ ) {
+			const SHProbe::EmissiveSurface&	EmissiveSurface = Probe.m_pEmissiveSurfaces[EmissiveSurfaceIndex];
+
+			U32	EmissiveMaterialIndex = m_EmissiveMaterialIDs.IndexOf( EmissiveSurface.MaterialID );
+			if ( EmissiveMaterialIndex == ~0UL ) {
+				EmissiveMaterialIndex = m_EmissiveMaterialIDs.GetCount();
+				m_EmissiveMaterialIDs.Append( EmissiveSurface.MaterialID );
+			}
+			pStaticEmissiveSurface->EmissiveMaterialIndex = EmissiveMaterialIndex;
+
+			memcpy_s( pStaticEmissiveSurface->SH, sizeof(pStaticEmissiveSurface->SH), EmissiveSurface.pSH, 9*sizeof(float) );
+		}
+
+		TotalEmissiveSurfacesCount += Probe.m_EmissiveSurfacesCount;
+	}
+	m_pSB_StaticProbeUpdateInfos->Write();
+	m_pSB_StaticProbeSamples->Write();
+	m_pSB_StaticEmissiveSurfaces->Write();
+
+	m_pSB_EmissiveMaterialColors = new SB<float3>( *m_pDevice, MAX( 1, m_EmissiveMaterialIDs.GetCount() ), true );
+#endif
+
+
 	//////////////////////////////////////////////////////////////////////////
 	// Copy static lighting & occlusion info
-	m_ppSB_RuntimeSHStatic[0] = new SB<SHCoeffs3>( *m_pDevice, m_ProbesCount, true );
-	m_ppSB_RuntimeSHStatic[1] = new SB<SHCoeffs3>( *m_pDevice, m_ProbesCount, true );
+	int		SHElementSize = GetSHStorageElementSize( m_SHStorageFormat );
+	m_ppSB_RuntimeSHStatic[0] = new StructuredBuffer( *m_pDevice, SHElementSize, m_ProbesCount, true );
+	m_ppSB_RuntimeSHStatic[1] = new StructuredBuffer( *m_pDevice, SHElementSize, m_ProbesCount, true );
 	m_pSB_RuntimeSHAmbient = new SB<SHCoeffs1>( *m_pDevice, m_ProbesCount, true );
-	m_pSB_RuntimeSHDynamic = new SB<SHCoeffs3>( *m_pDevice, m_ProbesCount, false );
-	m_pSB_RuntimeSHDynamicSun = new SB<SHCoeffs3>( *m_pDevice, m_ProbesCount, false );
-	m_pSB_RuntimeSHFinal = new SB<SHCoeffs3>( *m_pDevice, m_ProbesCount, false );
+	m_pSB_RuntimeSHDynamic = new StructuredBuffer( *m_pDevice, SHElementSize, m_ProbesCount, false );
+	m_pSB_RuntimeSHDynamicSun = new StructuredBuffer( *m_pDevice, SHElementSize, m_ProbesCount, false );
+	m_pSB_RuntimeSHFinal = new StructuredBuffer( *m_pDevice, SHElementSize, m_ProbesCount, false );
 
+	U8*		pRuntimeSHStatic = new U8[m_ProbesCount*SHElementSize];
 	for ( U32 ProbeIndex=0; ProbeIndex < m_ProbesCount; ProbeIndex++ ) {
 		SHProbe&	Probe = m_pProbes[ProbeIndex];
 
-		for ( int SHCoeffIndex=0; SHCoeffIndex < 9; SHCoeffIndex++ ) {
-			m_ppSB_RuntimeSHStatic[0]->m[ProbeIndex].pSH[SHCoeffIndex] = Probe.m_pSHStaticLighting[SHCoeffIndex];
-			m_ppSB_RuntimeSHStatic[1]->m[ProbeIndex].pSH[SHCoeffIndex] = Probe.m_pSHStaticLighting[SHCoeffIndex];
+		EncodeRuntimeSH( m_SHStorageFormat, Probe.m_pSHStaticLighting, pRuntimeSHStatic + ProbeIndex*SHElementSize );
 
+		for ( int SHCoeffIndex=0; SHCoeffIndex < 9; SHCoeffIndex++ ) {
 			m_pSB_RuntimeSHAmbient->m[ProbeIndex].pSH[SHCoeffIndex] = Probe.m_pSHOcclusion[SHCoeffIndex];
 
 // 			m_pSB_RuntimeSHDynamic->m[ProbeIndex].pSH[SHCoeffIndex] = float3::Zero;
@@ -1193,9 +2396,10 @@ void	SHProbeNetwork::LoadProbes( const char* _pPathToProbes, const float3& _Scen
 		}
 	}
 
-	m_ppSB_RuntimeSHStatic[0]->Write();
-	m_ppSB_RuntimeSHStatic[1]->Write();
+	m_ppSB_RuntimeSHStatic[0]->Write( pRuntimeSHStatic );
+	m_ppSB_RuntimeSHStatic[1]->Write( pRuntimeSHStatic );
 	m_pSB_RuntimeSHAmbient->Write();
+	delete[] pRuntimeSHStatic;
 // 	m_pSB_RuntimeSHDynamic->Write();
 // 	m_pSB_RuntimeSHDynamicSun->Write();
 
@@ -1205,7 +2409,7 @@ void	SHProbeNetwork::LoadProbes( const char* _pPathToProbes, const float3& _Scen
 	// Load the vertex stream of probe IDs
 	{
 		char	pTemp[1024];
-		sprintf_s( pTemp, "%sScene.vertexStream.U16", _pPathToProbes );
+		sprintf_s( pTemp, "%s%s", _pPathToProbes, VERTEX_STREAM_FILE_NAME );
 
 		FILE*	pFile = NULL;
 		fopen_s( &pFile, pTemp, "rb" );
@@ -1226,31 +2430,69 @@ void	SHProbeNetwork::LoadProbes( const char* _pPathToProbes, const float3& _Scen
 
 
 	//////////////////////////////////////////////////////////////////////////
-	// Build the probes' octree
-	float	MaxDimension = (_SceneBBoxMax - _SceneBBoxMin).Max();
+	// Build the probes' grid
+	m_pSB_ProbeGridPositions = new SB<float3>( *m_pDevice, MAX( 1U, m_ProbesCount ), true );
+	for ( U32 ProbeIndex=0; ProbeIndex < m_ProbesCount; ProbeIndex++ )
+		m_pSB_ProbeGridPositions->m[ProbeIndex] = m_pProbes[ProbeIndex].m_wsPosition;
+
+	m_ProbeGrid.Init( m_pSB_ProbeGridPositions->m, m_ProbesCount, _SceneBBoxMin, _SceneBBoxMax );
+
+	// Mirror it on the GPU
+	m_pSB_ProbeGridInfos = new SB<ProbeGridInfos>( *m_pDevice, 1, true );
+	m_pSB_ProbeGridInfos->m[0].Min = m_ProbeGrid.GetMin();
+	m_pSB_ProbeGridInfos->m[0].InvCellSize = m_ProbesCount > 0 ? 1.0f / m_ProbeGrid.GetCellSize() : 0.0f;
+	for ( int Axis=0; Axis < 3; Axis++ )
+		m_pSB_ProbeGridInfos->m[0].pSize[Axis] = m_ProbeGrid.GetSize( Axis );
+	m_pSB_ProbeGridInfos->m[0].ProbesCount = m_ProbesCount;
+
+	U32		GridCellsCount = MAX( 1U, m_ProbeGrid.GetCellsCount() );
+	U32		GridCandidatesCount = MAX( 1U, m_ProbeGrid.GetCandidatesCount() );
+	m_pSB_ProbeGridCells = new SB<PointGrid::Cell>( *m_pDevice, GridCellsCount, true );
+	m_pSB_ProbeGridCandidates = new SB<U32>( *m_pDevice, GridCandidatesCount, true );
+	if ( m_ProbesCount > 0 ) {
+		memcpy_s( m_pSB_ProbeGridCells->m, GridCellsCount*sizeof(PointGrid::Cell), m_ProbeGrid.GetCells(), m_ProbeGrid.GetCellsCount()*sizeof(PointGrid::Cell) );
+		memcpy_s( m_pSB_ProbeGridCandidates->m, GridCandidatesCount*sizeof(U32), m_ProbeGrid.GetCandidates(), m_ProbeGrid.GetCandidatesCount()*sizeof(U32) );
+	}
 
-	m_ProbeOctree.Init( _SceneBBoxMin, MaxDimension, 4.0f, m_ProbesCount );
-	int		MaxNodesCount = 0;
-	int		TotalNodesCount = 0;
-	U32		MaxNodesProbeIndex = ~0;
-	for ( U32 ProbeIndex=0; ProbeIndex < m_ProbesCount; ProbeIndex++ ) {
-		SHProbe&	Probe = m_pProbes[ProbeIndex];
+	m_pSB_ProbeGridInfos->Write();
+	m_pSB_ProbeGridCells->Write();
+	m_pSB_ProbeGridCandidates->Write();
+	m_pSB_ProbeGridPositions->Write();
 
-		int	NodesCount = m_ProbeOctree.Append( Probe.m_wsPosition, Probe.m_MaxDistance, &Probe );
-		TotalNodesCount += NodesCount;
-		if ( NodesCount > MaxNodesCount )
-		{	// New probe with more octree nodes
-			MaxNodesCount = NodesCount;
-			MaxNodesProbeIndex = ProbeIndex;
-		}
+
+	//////////////////////////////////////////////////////////////////////////
+	// Build the probes' tetrahedra (the probes' positions are enough so they're not stored in the probes' files)
+	m_ProbeTetrahedra.Init( m_pSB_ProbeGridPositions->m, m_ProbesCount );
+
+	// Mirror them on the GPU
+	U32		TetrahedraCount = m_ProbeTetrahedra.GetTetrahedraCount();
+	m_pSB_ProbeTetrahedra = new SB<Tetrahedralization::Tetrahedron>( *m_pDevice, MAX( 1U, TetrahedraCount ), true );
+	m_pSB_ProbeTetrahedraBarycentrics = new SB<Tetrahedralization::Barycentrics>( *m_pDevice, MAX( 1U, TetrahedraCount ), true );
+	if ( TetrahedraCount > 0 ) {
+		memcpy_s( m_pSB_ProbeTetrahedra->m, TetrahedraCount*sizeof(Tetrahedralization::Tetrahedron), m_ProbeTetrahedra.GetTetrahedra(), TetrahedraCount*sizeof(Tetrahedralization::Tetrahedron) );
+		memcpy_s( m_pSB_ProbeTetrahedraBarycentrics->m, TetrahedraCount*sizeof(Tetrahedralization::Barycentrics), m_ProbeTetrahedra.GetBarycentrics(), TetrahedraCount*sizeof(Tetrahedralization::Barycentrics) );
+	} else {
+		memset( m_pSB_ProbeTetrahedra->m, 0xFF, sizeof(Tetrahedralization::Tetrahedron) );	// Tells the shaders there are no tetrahedra
+		memset( m_pSB_ProbeTetrahedraBarycentrics->m, 0, sizeof(Tetrahedralization::Barycentrics) );
 	}
 
-	float	AverageNodesCount = float(TotalNodesCount) / m_ProbesCount;
+	m_pSB_ProbeTetrahedronOfProbe = new SB<U32>( *m_pDevice, MAX( 1U, m_ProbesCount ), true );
+	if ( TetrahedraCount > 0 )
+		memcpy_s( m_pSB_ProbeTetrahedronOfProbe->m, MAX( 1U, m_ProbesCount )*sizeof(U32), m_ProbeTetrahedra.GetPointTetrahedra(), m_ProbesCount*sizeof(U32) );
+	else
+		memset( m_pSB_ProbeTetrahedronOfProbe->m, 0xFF, MAX( 1U, m_ProbesCount )*sizeof(U32) );
+
+	m_pSB_ProbeTetrahedra->Write();
+	m_pSB_ProbeTetrahedraBarycentrics->Write();
+	m_pSB_ProbeTetrahedronOfProbe->Write();
+
+	// The volume still holds the previous probes
+	m_IrradianceVolume.Invalidate();
 
 
 	//////////////////////////////////////////////////////////////////////////
 	// Build the probes network debug mesh
-	Dictionary<RuntimeProbeNetworkInfos>	Connections;
+	FlatDictionary<U32, RuntimeProbeNetworkInfos>	Connections( 4*m_ProbesCount );
 	for ( U32 ProbeIndex=0; ProbeIndex < m_ProbesCount; ProbeIndex++ ) {
 		SHProbe&	Probe = m_pProbes[ProbeIndex];
 
@@ -1306,3 +2548,414 @@ static void	CopyProbeNetworkConnection( int _EntryIndex, SHProbeNetwork::Runtime
 	SHProbeNetwork::RuntimeProbeNetworkInfos*	_pTarget = (SHProbeNetwork::RuntimeProbeNetworkInfos*) _pUserData;
 	memcpy_s( &_pTarget[_EntryIndex], sizeof(SHProbeNetwork::RuntimeProbeNetworkInfos), &_Value, sizeof(SHProbeNetwork::RuntimeProbeNetworkInfos) );
 }
+
+
+//////////////////////////////////////////////////////////////////////////
+// Probe placement
+//
+// The placement file saved by OptimizeProbePlacement() is a ProbePlacementHeader followed by the indices of the scene probes to keep.
+// All the probes of the scene are the candidates (e.g. a dense grid of probe nodes), once they're baked the static lighting & occlusion
+//	SH of each probe are predicted from its directly visible neighbors still in the network, weighted by their inverse squared distance.
+// The probe with the smallest prediction error is removed as long as its error and the errors of the removed probes it helped
+//	predicting stay within the budget. A probe that can't be removed is kept for good since further removals only make things worse.
+//
+namespace {
+	const U32	PLACEMENT_MIN_PROBES_COUNT = 4;		// Always keep at least a tetrahedron of probes
+
+	// Relative L2 error of the predicted coefficients
+	float	RelativeSHError( const float* _pPredicted, const float* _pReference, U32 _CoefficientsCount ) {
+		float	SumSqDelta = 0.0f;
+		float	SumSqReference = 0.0f;
+		for ( U32 i=0; i < _CoefficientsCount; i++ ) {
+			float	Delta = _pPredicted[i] - _pReference[i];
+			SumSqDelta += Delta * Delta;
+			SumSqReference += _pReference[i] * _pReference[i];
+		}
+		return sqrtf( SumSqDelta / MAX( 1e-8f, SumSqReference ) );
+	}
+}
+
+U32		SHProbeNetwork::ComputePlacementSignature( Scene& _Scene ) {
+	U32		Signature = HashBytes( &_Scene.m_ProbesCount, sizeof(int) );
+	for ( int ProbeIndex=0; ProbeIndex < _Scene.m_ProbesCount; ProbeIndex++ ) {
+		float3	wsPosition = float3( _Scene.m_ppProbes[ProbeIndex]->m_Local2World.GetRow(3) );
+		Signature = HashBytes( &wsPosition, sizeof(float3), Signature );
+	}
+	return Signature;
+}
+
+void	SHProbeNetwork::AddSceneProbes( Scene& _Scene, const char* _pPathToProbes, bool _bAllCandidates ) {
+	List<U32>	KeptProbeIndices;
+	bool		bValidPlacement = false;
+	if ( !_bAllCandidates ) {
+		char	pTemp[1024];
+		sprintf_s( pTemp, "%s%s", _pPathToProbes, PROBE_PLACEMENT_FILE_NAME );
+		MappedDiskFile	Placement( pTemp );
+
+		const ProbePlacementHeader*	pHeader = Placement.IsValid() && Placement.GetSize() >= sizeof(ProbePlacementHeader) ? Placement.GetMappedMemory<ProbePlacementHeader>( 0 ) : NULL;
+		bValidPlacement =	pHeader != NULL
+						&&	pHeader->Magic == PROBE_PLACEMENT_MAGIC
+						&&	pHeader->Version == PROBE_PLACEMENT_VERSION
+						&&	pHeader->CandidatesCount == U32(_Scene.m_ProbesCount)
+						&&	pHeader->Signature == ComputePlacementSignature( _Scene )
+						&&	pHeader->KeptCount <= pHeader->CandidatesCount
+						&&	Placement.GetSize() == sizeof(ProbePlacementHeader) + pHeader->KeptCount * sizeof(U32);
+
+		if ( bValidPlacement ) {
+			const U32*	pIndices = Placement.GetMappedMemory<U32>( sizeof(ProbePlacementHeader) );
+			KeptProbeIndices.Init( MAX( 1U, pHeader->KeptCount ) );
+			for ( U32 i=0; i < pHeader->KeptCount; i++ ) {
+				bValidPlacement &= pIndices[i] < pHeader->CandidatesCount;
+				KeptProbeIndices.Append( pIndices[i] );
+			}
+		}
+	}
+
+	if ( !bValidPlacement ) {
+		PreAllocateProbes( _Scene.m_ProbesCount );
+		for ( int ProbeIndex=0; ProbeIndex < _Scene.m_ProbesCount; ProbeIndex++ )
+			AddProbe( *_Scene.m_ppProbes[ProbeIndex] );
+		return;
+	}
+
+	PreAllocateProbes( KeptProbeIndices.GetCount() );
+	for ( int i=0; i < KeptProbeIndices.GetCount(); i++ )
+		AddProbe( *_Scene.m_ppProbes[KeptProbeIndices[i]] );
+}
+
+// Returns the relative error of the static SH of the probe predicted from its directly visible neighbors that aren't removed
+//	(nor _ExcludedProbeIndex), MAX_FLOAT if there are none to predict it from
+float	SHProbeNetwork::ComputeProbePredictionError( U32 _ProbeIndex, const bool* _pbRemoved, U32 _ExcludedProbeIndex ) const {
+	const SHProbe&	Probe = m_pProbes[_ProbeIndex];
+
+	float	pOcclusion[9];
+	float3	pStaticLighting[9];
+	memset( pOcclusion, 0, 9*sizeof(float) );
+	memset( pStaticLighting, 0, 9*sizeof(float3) );
+
+	float	SumWeights = 0.0f;
+	for ( int NeighborIndex=0; NeighborIndex < Probe.m_NeighborProbes.GetCount(); NeighborIndex++ ) {
+		const SHProbe::NeighborProbeInfo&	Neighbor = Probe.m_NeighborProbes[NeighborIndex];
+		if ( !Neighbor.DirectlyVisible || Neighbor.ProbeID >= m_ProbesCount || _pbRemoved[Neighbor.ProbeID] || Neighbor.ProbeID == _ExcludedProbeIndex )
+			continue;
+
+		const SHProbe&	NeighborProbe = m_pProbes[Neighbor.ProbeID];
+		float	Weight = 1.0f / MAX( 1e-4f, (NeighborProbe.m_wsPosition - Probe.m_wsPosition).LengthSq() );
+		for ( int i=0; i < 9; i++ ) {
+			pOcclusion[i] += Weight * NeighborProbe.m_pSHOcclusion[i];
+			pStaticLighting[i] = pStaticLighting[i] + Weight * NeighborProbe.m_pSHStaticLighting[i];
+		}
+		SumWeights += Weight;
+	}
+	if ( SumWeights == 0.0f )
+		return MAX_FLOAT;
+
+	float	Normalizer = 1.0f / SumWeights;
+	for ( int i=0; i < 9; i++ ) {
+		pOcclusion[i] *= Normalizer;
+		pStaticLighting[i] = Normalizer * pStaticLighting[i];
+	}
+
+	return MAX( RelativeSHError( pOcclusion, Probe.m_pSHOcclusion, 9 ), RelativeSHError( &pStaticLighting[0].x, &Probe.m_pSHStaticLighting[0].x, 27 ) );
+}
+
+U32		SHProbeNetwork::OptimizeProbePlacement( const char* _pPathToProbes, Scene& _Scene, float _ErrorBudget ) {
+	ASSERT( m_ProbesCount == U32(_Scene.m_ProbesCount), "The network must hold all the probes of the scene to optimize their placement!" );
+
+	bool*	pbRemoved = new bool[MAX( 1U, m_ProbesCount )];
+	bool*	pbLocked = new bool[MAX( 1U, m_ProbesCount )];
+	float*	pErrors = new float[MAX( 1U, m_ProbesCount )];
+	memset( pbRemoved, 0, m_ProbesCount*sizeof(bool) );
+	memset( pbLocked, 0, m_ProbesCount*sizeof(bool) );
+	for ( U32 ProbeIndex=0; ProbeIndex < m_ProbesCount; ProbeIndex++ )
+		pErrors[ProbeIndex] = ComputeProbePredictionError( ProbeIndex, pbRemoved );
+
+	U32		KeptCount = m_ProbesCount;
+	while ( KeptCount > PLACEMENT_MIN_PROBES_COUNT ) {
+		// Find the best predicted probe
+		U32		BestProbeIndex = ~0U;
+		float	BestError = _ErrorBudget;
+		for ( U32 ProbeIndex=0; ProbeIndex < m_ProbesCount; ProbeIndex++ )
+			if ( !pbRemoved[ProbeIndex] && !pbLocked[ProbeIndex] && pErrors[ProbeIndex] <= BestError ) {
+				BestProbeIndex = ProbeIndex;
+				BestError = pErrors[ProbeIndex];
+			}
+		if ( BestProbeIndex == ~0U )
+			break;	// No probe can be removed anymore
+
+		// The removed probes it helps predicting must stay within the budget without it
+		bool	bCanRemove = true;
+		for ( U32 ProbeIndex=0; ProbeIndex < m_ProbesCount && bCanRemove; ProbeIndex++ ) {
+			if ( !pbRemoved[ProbeIndex] )
+				continue;
+
+			const List< SHProbe::NeighborProbeInfo >&	Neighbors = m_pProbes[ProbeIndex].m_NeighborProbes;
+			for ( int NeighborIndex=0; NeighborIndex < Neighbors.GetCount(); NeighborIndex++ )
+				if ( Neighbors[NeighborIndex].ProbeID == BestProbeIndex ) {
+					bCanRemove = ComputeProbePredictionError( ProbeIndex, pbRemoved, BestProbeIndex ) <= _ErrorBudget;
+					break;
+				}
+		}
+		if ( !bCanRemove ) {
+			pbLocked[BestProbeIndex] = true;
+			continue;
+		}
+
+		pbRemoved[BestProbeIndex] = true;
+		KeptCount--;
+
+		// Update the errors of the remaining probes that were predicted from it
+		for ( U32 ProbeIndex=0; ProbeIndex < m_ProbesCount; ProbeIndex++ ) {
+			if ( pbRemoved[ProbeIndex] )
+				continue;
+
+			const List< SHProbe::NeighborProbeInfo >&	Neighbors = m_pProbes[ProbeIndex].m_NeighborProbes;
+			for ( int NeighborIndex=0; NeighborIndex < Neighbors.GetCount(); NeighborIndex++ )
+				if ( Neighbors[NeighborIndex].ProbeID == BestProbeIndex ) {
+					pErrors[ProbeIndex] = ComputeProbePredictionError( ProbeIndex, pbRemoved );
+					break;
+				}
+		}
+	}
+
+	// Save the indices of the scene probes to keep
+	ProbePlacementHeader	Header;
+	Header.Magic = PROBE_PLACEMENT_MAGIC;
+	Header.Version = PROBE_PLACEMENT_VERSION;
+	Header.Signature = ComputePlacementSignature( _Scene );
+	Header.CandidatesCount = m_ProbesCount;
+	Header.KeptCount = KeptCount;
+	Header.ErrorBudget = _ErrorBudget;
+
+	char	pTemp[1024];
+	sprintf_s( pTemp, "%s%s", _pPathToProbes, PROBE_PLACEMENT_FILE_NAME );
+
+	FILE*	pFile = NULL;
+	fopen_s( &pFile, pTemp, "wb" );
+	ASSERT( pFile != NULL, "Can't write probe placement file!" );
+	if ( pFile != NULL ) {
+		fwrite( &Header, sizeof(ProbePlacementHeader), 1, pFile );
+		for ( U32 ProbeIndex=0; ProbeIndex < m_ProbesCount; ProbeIndex++ )
+			if ( !pbRemoved[ProbeIndex] ) {
+				U32	SceneProbeIndex = ProbeIndex;	// Same order as the scene since the network holds all of its probes
+				fwrite( &SceneProbeIndex, sizeof(U32), 1, pFile );
+			}
+		fclose( pFile );
+	}
+
+	sprintf_s( pTemp, "Probe placement: kept %d of %d probes within a %.1f%% error budget\n", KeptCount, m_ProbesCount, 100.0f * _ErrorBudget );
+	OutputDebugStringA( pTemp );
+
+	delete[] pErrors;
+	delete[] pbLocked;
+	delete[] pbRemoved;
+
+	return KeptCount;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// Packed probe network file
+//
+// The file is a PackedFileHeader followed by the sections listed in PACKED_SECTION, each section is the raw content
+//	of the runtime structures for all the probes so loading simply copies them in place
+//
+bool	SHProbeNetwork::LoadPackedProbes( const char* _pFileName ) {
+	MappedDiskFile	File( _pFileName );
+	if ( !File.IsValid() || File.GetSize() < sizeof(PackedFileHeader) )
+		return false;
+
+	const PackedFileHeader&	Header = *File.GetMappedMemory<PackedFileHeader>( 0 );
+	if (	Header.Magic != PACKED_FILE_MAGIC
+		||	Header.Version != PACKED_FILE_VERSION
+		||	Header.ProbesCount != m_ProbesCount
+		||	Header.pStructureSizes[0] != sizeof(SHProbe::Sample)
+		||	Header.pStructureSizes[1] != sizeof(SHProbe::EmissiveSurface)
+		||	Header.pStructureSizes[2] != sizeof(SHProbe::NeighborProbeInfo)
+		||	Header.pStructureSizes[3] != sizeof(SHProbe::VoronoiProbeInfo)
+		||	Header.pSectionOffsets[PACKED_SECTIONS_COUNT] != File.GetSize() )
+		return false;	// Stale or corrupt file
+
+	bool	bHalfSH = (Header.Flags & PACKED_FLAG_HALF_SH) != 0;
+
+	const PackedProbeInfo*				pInfos = File.GetMappedMemory<PackedProbeInfo>( Header.pSectionOffsets[PACKED_SECTION_INFOS] );
+	const SHProbe::Sample*				pSamples = File.GetMappedMemory<SHProbe::Sample>( Header.pSectionOffsets[PACKED_SECTION_SAMPLES] );
+	const SHProbe::EmissiveSurface*		pEmissiveSurfaces = File.GetMappedMemory<SHProbe::EmissiveSurface>( Header.pSectionOffsets[PACKED_SECTION_EMISSIVE_SURFACES] );
+	const SHProbe::NeighborProbeInfo*	pNeighbors = File.GetMappedMemory<SHProbe::NeighborProbeInfo>( Header.pSectionOffsets[PACKED_SECTION_NEIGHBORS] );
+	const SHProbe::VoronoiProbeInfo*	pVoronoi = File.GetMappedMemory<SHProbe::VoronoiProbeInfo>( Header.pSectionOffsets[PACKED_SECTION_VORONOI] );
+
+	for ( U32 ProbeIndex=0; ProbeIndex < m_ProbesCount; ProbeIndex++ ) {
+		SHProbe&				Probe = m_pProbes[ProbeIndex];
+		const PackedProbeInfo&	Info = pInfos[ProbeIndex];
+
+		Probe.m_MeanDistance = Info.MeanDistance;
+		Probe.m_MeanHarmonicDistance = Info.MeanHarmonicDistance;
+		Probe.m_MinDistance = Info.MinDistance;
+		Probe.m_MaxDistance = Info.MaxDistance;
+		Probe.m_lsBBoxMin = Info.lsBBoxMin;
+		Probe.m_lsBBoxMax = Info.lsBBoxMax;
+		Probe.m_NearestNeighborProbeDistance = Info.NearestNeighborProbeDistance;
+		Probe.m_FarthestNeighborProbeDistance = Info.FarthestNeighborProbeDistance;
+
+		// Static SH
+		if ( bHalfSH ) {
+			const half*	pSHStatic = File.GetMappedMemory<half>( Header.pSectionOffsets[PACKED_SECTION_SH_STATIC] ) + 27*ProbeIndex;
+			const half*	pSHOcclusion = File.GetMappedMemory<half>( Header.pSectionOffsets[PACKED_SECTION_SH_OCCLUSION] ) + 9*ProbeIndex;
+			for ( int i=0; i < 9; i++ ) {
+				Probe.m_pSHStaticLighting[i].Set( pSHStatic[3*i+0], pSHStatic[3*i+1], pSHStatic[3*i+2] );
+				Probe.m_pSHOcclusion[i] = pSHOcclusion[i];
+			}
+		} else {
+			memcpy_s( Probe.m_pSHStaticLighting, sizeof(Probe.m_pSHStaticLighting), File.GetMappedMemory<float3>( Header.pSectionOffsets[PACKED_SECTION_SH_STATIC] ) + 9*ProbeIndex, 9*sizeof(float3) );
+			memcpy_s( Probe.m_pSHOcclusion, sizeof(Probe.m_pSHOcclusion), File.GetMappedMemory<float>( Header.pSectionOffsets[PACKED_SECTION_SH_OCCLUSION] ) + 9*ProbeIndex, 9*sizeof(float) );
+		}
+
+		// Samples & emissive surfaces are already in their runtime state
+		memcpy_s( Probe.m_pSamples, sizeof(Probe.m_pSamples), pSamples + SHProbe::SAMPLES_COUNT*ProbeIndex, SHProbe::SAMPLES_COUNT*sizeof(SHProbe::Sample) );
+
+		Probe.m_EmissiveSurfacesCount = MIN( SHProbe::MAX_EMISSIVE_SURFACES, Info.EmissiveSurfacesCount );
+		memcpy_s( Probe.m_pEmissiveSurfaces, sizeof(Probe.m_pEmissiveSurfaces), pEmissiveSurfaces + Info.EmissiveSurfacesOffset, Probe.m_EmissiveSurfacesCount*sizeof(SHProbe::EmissiveSurface) );
+
+		// Neighbors
+		Probe.m_NeighborProbes.Init( Info.NeighborsCount );
+		Probe.m_NeighborProbes.AppendRange( pNeighbors + Info.NeighborsOffset, Info.NeighborsCount );
+
+		Probe.m_VoronoiProbes.Init( Info.VoronoiCount );
+		Probe.m_VoronoiProbes.AppendRange( pVoronoi + Info.VoronoiOffset, Info.VoronoiCount );
+	}
+
+	return true;
+}
+
+void	SHProbeNetwork::SavePackedProbes( const char* _pFileName, bool _bHalfSH ) const {
+	// Build the header & the per-probe infos
+	PackedFileHeader	Header;
+	Header.Magic = PACKED_FILE_MAGIC;
+	Header.Version = PACKED_FILE_VERSION;
+	Header.ProbesCount = m_ProbesCount;
+	Header.Flags = _bHalfSH ? PACKED_FLAG_HALF_SH : 0;
+	Header.pStructureSizes[0] = sizeof(SHProbe::Sample);
+	Header.pStructureSizes[1] = sizeof(SHProbe::EmissiveSurface);
+	Header.pStructureSizes[2] = sizeof(SHProbe::NeighborProbeInfo);
+	Header.pStructureSizes[3] = sizeof(SHProbe::VoronoiProbeInfo);
+
+	PackedProbeInfo*	pInfos = new PackedProbeInfo[m_ProbesCount];
+	U32		TotalEmissiveSurfacesCount = 0;
+	U32		TotalNeighborsCount = 0;
+	U32		TotalVoronoiCount = 0;
+	for ( U32 ProbeIndex=0; ProbeIndex < m_ProbesCount; ProbeIndex++ ) {
+		const SHProbe&		Probe = m_pProbes[ProbeIndex];
+		PackedProbeInfo&	Info = pInfos[ProbeIndex];
+
+		Info.MeanDistance = Probe.m_MeanDistance;
+		Info.MeanHarmonicDistance = Probe.m_MeanHarmonicDistance;
+		Info.MinDistance = Probe.m_MinDistance;
+		Info.MaxDistance = Probe.m_MaxDistance;
+		Info.lsBBoxMin = Probe.m_lsBBoxMin;
+		Info.lsBBoxMax = Probe.m_lsBBoxMax;
+		Info.NearestNeighborProbeDistance = Probe.m_NearestNeighborProbeDistance;
+		Info.FarthestNeighborProbeDistance = Probe.m_FarthestNeighborProbeDistance;
+
+		Info.EmissiveSurfacesOffset = TotalEmissiveSurfacesCount;
+		Info.EmissiveSurfacesCount = Probe.m_EmissiveSurfacesCount;
+		Info.NeighborsOffset = TotalNeighborsCount;
+		Info.NeighborsCount = Probe.m_NeighborProbes.GetCount();
+		Info.VoronoiOffset = TotalVoronoiCount;
+		Info.VoronoiCount = Probe.m_VoronoiProbes.GetCount();
+
+		TotalEmissiveSurfacesCount += Info.EmissiveSurfacesCount;
+		TotalNeighborsCount += Info.NeighborsCount;
+		TotalVoronoiCount += Info.VoronoiCount;
+	}
+
+	// Compute section offsets (sections are 16-bytes aligned)
+	U32		pSectionSizes[PACKED_SECTIONS_COUNT] = {
+		U32( m_ProbesCount * sizeof(PackedProbeInfo) ),
+		U32( m_ProbesCount * 27 * (_bHalfSH ? sizeof(half) : sizeof(float)) ),
+		U32( m_ProbesCount * 9 * (_bHalfSH ? sizeof(half) : sizeof(float)) ),
+		U32( m_ProbesCount * SHProbe::SAMPLES_COUNT * sizeof(SHProbe::Sample) ),
+		U32( TotalEmissiveSurfacesCount * sizeof(SHProbe::EmissiveSurface) ),
+		U32( TotalNeighborsCount * sizeof(SHProbe::NeighborProbeInfo) ),
+		U32( TotalVoronoiCount * sizeof(SHProbe::VoronoiProbeInfo) ),
+	};
+
+	U32		Offset = (sizeof(PackedFileHeader) + 15) & ~15U;
+	for ( int SectionIndex=0; SectionIndex < PACKED_SECTIONS_COUNT; SectionIndex++ ) {
+		Header.pSectionOffsets[SectionIndex] = Offset;
+		Offset += pSectionSizes[SectionIndex];
+		if ( SectionIndex < PACKED_SECTIONS_COUNT-1 )
+			Offset = (Offset + 15) & ~15U;
+	}
+	Header.pSectionOffsets[PACKED_SECTIONS_COUNT] = Offset;
+
+	// Write the file
+	FILE*	pFile = NULL;
+	fopen_s( &pFile, _pFileName, "wb" );
+	if ( pFile == NULL ) {
+		delete[] pInfos;
+		return;	// Not critical, we'll simply load the individual probe files again next time...
+	}
+
+	const U8	pPadding[16] = { 0 };
+
+	#define	WRITE_SECTION_START( Section )	fwrite( pPadding, 1, Header.pSectionOffsets[Section] - ftell( pFile ), pFile );
+
+	fwrite( &Header, sizeof(PackedFileHeader), 1, pFile );
+
+	WRITE_SECTION_START( PACKED_SECTION_INFOS );
+	fwrite( pInfos, sizeof(PackedProbeInfo), m_ProbesCount, pFile );
+	delete[] pInfos;
+
+	WRITE_SECTION_START( PACKED_SECTION_SH_STATIC );
+	for ( U32 ProbeIndex=0; ProbeIndex < m_ProbesCount; ProbeIndex++ ) {
+		const SHProbe&	Probe = m_pProbes[ProbeIndex];
+		if ( _bHalfSH ) {
+			half	pSH[27];
+			for ( int i=0; i < 9; i++ ) {
+				pSH[3*i+0] = Probe.m_pSHStaticLighting[i].x;
+				pSH[3*i+1] = Probe.m_pSHStaticLighting[i].y;
+				pSH[3*i+2] = Probe.m_pSHStaticLighting[i].z;
+			}
+			fwrite( pSH, sizeof(half), 27, pFile );
+		} else
+			fwrite( Probe.m_pSHStaticLighting, sizeof(float3), 9, pFile );
+	}
+
+	WRITE_SECTION_START( PACKED_SECTION_SH_OCCLUSION );
+	for ( U32 ProbeIndex=0; ProbeIndex < m_ProbesCount; ProbeIndex++ ) {
+		const SHProbe&	Probe = m_pProbes[ProbeIndex];
+		if ( _bHalfSH ) {
+			half	pSH[9];
+			for ( int i=0; i < 9; i++ )
+				pSH[i] = Probe.m_pSHOcclusion[i];
+			fwrite( pSH, sizeof(half), 9, pFile );
+		} else
+			fwrite( Probe.m_pSHOcclusion, sizeof(float), 9, pFile );
+	}
+
+	WRITE_SECTION_START( PACKED_SECTION_SAMPLES );
+	for ( U32 ProbeIndex=0; ProbeIndex < m_ProbesCount; ProbeIndex++ )
+		fwrite( m_pProbes[ProbeIndex].m_pSamples, sizeof(SHProbe::Sample), SHProbe::SAMPLES_COUNT, pFile );
+
+	WRITE_SECTION_START( PACKED_SECTION_EMISSIVE_SURFACES );
+	for ( U32 ProbeIndex=0; ProbeIndex < m_ProbesCount; ProbeIndex++ )
+		fwrite( m_pProbes[ProbeIndex].m_pEmissiveSurfaces, sizeof(SHProbe::EmissiveSurface), m_pProbes[ProbeIndex].m_EmissiveSurfacesCount, pFile );
+
+	WRITE_SECTION_START( PACKED_SECTION_NEIGHBORS );
+	for ( U32 ProbeIndex=0; ProbeIndex < m_ProbesCount; ProbeIndex++ ) {
+		const List< SHProbe::NeighborProbeInfo >&	Neighbors = m_pProbes[ProbeIndex].m_NeighborProbes;
+		if ( Neighbors.GetCount() > 0 )
+			fwrite( &Neighbors[0], sizeof(SHProbe::NeighborProbeInfo), Neighbors.GetCount(), pFile );
+	}
+
+	WRITE_SECTION_START( PACKED_SECTION_VORONOI );
+	for ( U32 ProbeIndex=0; ProbeIndex < m_ProbesCount; ProbeIndex++ ) {
+		const List< SHProbe::VoronoiProbeInfo >&	Voronoi = m_pProbes[ProbeIndex].m_VoronoiProbes;
+		if ( Voronoi.GetCount() > 0 )
+			fwrite( &Voronoi[0], sizeof(SHProbe::VoronoiProbeInfo), Voronoi.GetCount(), pFile );
+	}
+
+	#undef WRITE_SECTION_START
+
+	fclose( pFile );
+}
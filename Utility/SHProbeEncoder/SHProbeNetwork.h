@@ -7,6 +7,7 @@
 #pragma once
 
 #include "SHProbeEncoder.h"
+#include "SHProbeIrradianceVolume.h"
 
 class	SHProbeNetwork
 {
@@ -15,6 +16,17 @@ public:		// CONSTANTS
 	static const U32		MAX_PROBE_NEIGHBORS = 4;			// Only keep the 4 most significant neighbors
 	static const U32		MAX_PROBE_UPDATES_PER_FRAME = 32;	// Update a maximum of 32 probes per frame
 
+	static const int		PROBE_SH_TILE_SIZE = 32;			// Size of the cube face tiles projected by each thread group of GIEncodeProbeSH.hlsl
+	static const int		PROBE_SH_PARTIALS_COUNT = 6 * (SHProbeEncoder::CUBE_MAP_SIZE / PROBE_SH_TILE_SIZE) * (SHProbeEncoder::CUBE_MAP_SIZE / PROBE_SH_TILE_SIZE);	// One partial SH per tile
+
+	// Storage formats of the runtime SH buffers (static, dynamic, dynamic sun & final)
+	// Shaders accessing these buffers must be compiled with the SH_STORAGE_FORMAT macro (cf. GetSHStorageFormatMacro() and Inc/SHProbeStorage.hlsl)
+	enum SH_STORAGE_FORMAT {
+		SH_STORAGE_FLOAT = 0,		// 9 float3 coefficients (108 bytes per probe)
+		SH_STORAGE_HALF = 1,		// 9 half3 coefficients packed by pairs (56 bytes per probe)
+		SH_STORAGE_L1 = 2,			// Only the first 4 float3 coefficients, for large maps with distant probes (48 bytes per probe)
+	};
+
 
 public:		// NESTED TYPES
 
@@ -35,10 +47,22 @@ public:		// NESTED TYPES
 		float3			BounceFactorStatic;		// Bounce factor for static lights
 		float			BounceFactorEmissive;	// Bounce factor for emissive materials
 		float			BounceFactorNeighbors;	// Bounce factor for neighbor probes
+
+		// Scheduling
+		// Probes are updated by decreasing priority, that grows with the time since their last update and is boosted for
+		//	probes close to the viewer, visible by the viewer or affected by a light that changed.
+		float			Time;					// Current time (in seconds)
+		float3			wsCameraPosition;		// Position of the viewer
+		float4x4		World2Proj;				// Viewer's transform used to test the visibility of the probes
+		float			GPUBudget;				// GPU time we can spend on the update (in microseconds), the amount of updated probes then adapts to the measured cost (0 to always update MaxProbeUpdatesPerFrame probes)
+		float			MeasuredGPUTime;		// Average measured GPU time of the update (in microseconds, 0 if unknown)
+		U32				ChangedLightsCount;		// Amount of lights that changed since last frame
+		const float4*	pChangedLights;			// Influence spheres of the lights that changed since last frame (XYZ=Position W=Radius)
 	};
 
 	class IRenderSceneDelegate {
 	public: virtual void	operator()( Shader& _Material ) = 0;
+			virtual void	operator()( Shader& _Material, MultiView& _Views ) = 0;	// Renders all the views at once (cf. MultiView)
 	};
 
 private:	// RUNTIME STRUCTURES
@@ -66,7 +90,7 @@ private:	// RUNTIME STRUCTURES
 		float		EmissiveBoost;
 
 		float		NeighborProbesContributionBoost;
-//		float4		AmbientSH[9];		// Ambient sky (padded!)
+		// The ambient sky SH are read from t57 (cf. Inc/SkySH.hlsl)
  	};
 
 	// Runtime probes buffer containing the probe's position and all neighbor probes in the Vorono cell
@@ -92,6 +116,18 @@ private:	// RUNTIME STRUCTURES
 		float3		pSH[9];
 	};
 
+	struct SHCoeffs4 {		// Static lighting (XYZ) + occlusion (W) projected by GIEncodeProbeSH.hlsl
+		float4		pSH[9];
+	};
+
+	struct SHCoeffs3Half {	// SH_STORAGE_HALF runtime SH
+		U32			pPacked[14];		// 27 half coefficients (R0 G0 B0 R1 ...) packed by pairs, low word first
+	};
+
+	struct SHCoeffs3L1 {	// SH_STORAGE_L1 runtime SH
+		float3		pSH[4];
+	};
+
 	// Probes update buffers
 	struct RuntimeProbeUpdateInfo
 	{
@@ -118,6 +154,27 @@ private:	// RUNTIME STRUCTURES
 		float		SH[9];							// SH for the surface
 	};
 
+	// Static probes update buffers (uploaded once, gathered on the GPU by GIGatherProbeUpdates.hlsl)
+	struct	ProbeUpdateRequest
+	{
+		U32			ProbeIndex;						// The index of the probe we're updating
+		U32			EmissiveSurfacesStart;			// Index of the first emissive surface for the probe in the update buffer
+	};
+
+	struct	StaticEmissiveSurfaceInfo
+	{
+		U32			EmissiveMaterialIndex;			// Index of the emissive material in m_EmissiveMaterialIDs
+		float		SH[9];							// SH for the surface
+	};
+
+	struct ProbeGridInfos					// Header of the nearest probe grid (cf. Inc/ProbeGrid.hlsl)
+	{
+		float3		Min;							// Minimum corner of the grid
+		float		InvCellSize;
+		U32			pSize[3];						// Amount of cells along each axis
+		U32			ProbesCount;
+	};
+
 	struct RuntimeProbeNetworkInfos
 	{
 		U32			ProbeIDs[2];					// The IDs of the 2 connected probes
@@ -134,6 +191,131 @@ private:	// BUILD TIME STRUCTURES
 		double	Influence;
 	};
 
+	// The probe placement file lists the scene probes kept by the last OptimizeProbePlacement() (see OptimizeProbePlacement() for the layout)
+	static const U32		PROBE_PLACEMENT_MAGIC = 0x43414C50;	// "PLAC"
+	static const U32		PROBE_PLACEMENT_VERSION = 1;
+
+	struct ProbePlacementHeader {
+		U32		Magic;
+		U32		Version;
+		U32		Signature;					// Signature of the positions of all the scene's probes (cf. ComputePlacementSignature()), the placement is ignored once they change
+		U32		CandidatesCount;			// Amount of probes in the scene
+		U32		KeptCount;					// Amount of scene probe indices following the header
+		float	ErrorBudget;				// Budget the placement was optimized with
+	};
+
+
+private:	// PACKED FILE STRUCTURES
+
+	// The packed file stores the entire probe network as SoA sections that are mapped and copied without any parsing
+	//	(see SavePackedProbes() for the layout)
+	static const U32		PACKED_FILE_MAGIC = 0x54454E50;		// "PNET"
+	static const U32		PACKED_FILE_VERSION = 1;
+	static const U32		PACKED_FLAG_HALF_SH = 1;			// Static lighting & occlusion SH are stored as half floats
+
+	enum PACKED_SECTION {
+		PACKED_SECTION_INFOS,				// PackedProbeInfo per probe
+		PACKED_SECTION_SH_STATIC,			// 9 float3 (or 27 half) per probe
+		PACKED_SECTION_SH_OCCLUSION,		// 9 float (or 9 half) per probe
+		PACKED_SECTION_SAMPLES,				// SAMPLES_COUNT SHProbe::Sample per probe
+		PACKED_SECTION_EMISSIVE_SURFACES,	// SHProbe::EmissiveSurface for all probes
+		PACKED_SECTION_NEIGHBORS,			// SHProbe::NeighborProbeInfo for all probes
+		PACKED_SECTION_VORONOI,				// SHProbe::VoronoiProbeInfo for all probes
+		PACKED_SECTIONS_COUNT,
+	};
+
+	struct PackedFileHeader {
+		U32		Magic;
+		U32		Version;
+		U32		ProbesCount;
+		U32		Flags;
+		U32		pStructureSizes[4];			// Size of the sample, emissive surface, neighbor & Vorono structures so files written by another build are rejected
+		U32		pSectionOffsets[PACKED_SECTIONS_COUNT+1];	// Offsets of each section from the start of the file, the last one is the file size
+	};
+
+	struct PackedProbeInfo {
+		float	MeanDistance;
+		float	MeanHarmonicDistance;
+		float	MinDistance;
+		float	MaxDistance;
+		float3	lsBBoxMin;
+		float3	lsBBoxMax;
+		float	NearestNeighborProbeDistance;
+		float	FarthestNeighborProbeDistance;
+		U32		EmissiveSurfacesOffset;		// Offsets are in elements from the start of their section
+		U32		EmissiveSurfacesCount;
+		U32		NeighborsOffset;
+		U32		NeighborsCount;
+		U32		VoronoiOffset;
+		U32		VoronoiCount;
+	};
+
+	// A bake work unit file is a BakeUnitFileHeader followed by a BakedProbeInfo for each probe of the unit, then by the
+	//	ProbeInfluence of every face of the scene for the probes of the unit
+	static const U32		BAKE_UNIT_FILE_MAGIC = 0x4B414250;	// "PBAK"
+	static const U32		BAKE_UNIT_FILE_VERSION = 1;
+
+	struct BakeUnitFileHeader {
+		U32		Magic;
+		U32		Version;
+		U32		Signature;					// Signature of the probes & faces the unit was baked from (cf. ComputeBakeSignature()) so units baked from another scene are rejected
+		U32		UnitIndex;
+		U32		UnitsCount;
+		U32		FirstProbeIndex;
+		U32		ProbesCount;				// Probes of the unit
+		U32		FacesCount;
+		U32		pStructureSizes[2];			// Size of the baked probe info & probe influence structures
+	};
+
+	struct BakedProbeInfo {
+		U32		FileSize;					// Size & checksum of the probe's .probeset file, verified by the merge
+		U32		Checksum;
+	};
+
+	// The bake manifest records the meshes of the scene and the faces each probe saw so the next bake only rebakes the probes
+	//	affected by the meshes that changed (see SaveBakeManifest() for the layout)
+	static const U32		BAKE_MANIFEST_MAGIC = 0x4E414D50;	// "PMAN"
+	static const U32		BAKE_MANIFEST_VERSION = 1;
+
+	struct BakeManifestHeader {
+		U32		Magic;
+		U32		Version;
+		U32		Signature;					// Signature of the probes & static lights (cf. ComputeBakeManifestSignature()), any change requires a complete bake
+		U32		ProbesCount;
+		U32		MeshesCount;
+		U32		SeenFacesCount;				// Total for all the probes
+		U32		pStructureSizes[2];			// Size of the mesh & seen face structures
+	};
+
+	// A scene mesh as baked
+	struct BakeMesh {
+		U32		Signature;					// Hash of the mesh's transform, geometry & materials
+		U32		FacesCount;
+		U32		VerticesCount;
+		float3	GlobalBBoxMin;
+		float3	GlobalBBoxMax;
+	};
+
+	// A face seen by a probe, with the probe's influence on it
+	struct SeenFace {
+		U32		MeshIndex;
+		U32		FaceIndex;					// Index of the face within its mesh
+		double	Influence;
+	};
+
+
+private:	// SCHEDULING STRUCTURES
+
+	struct ProbeUpdateState {
+		float	LastUpdateTime;		// Time of the last update of the probe
+		bool	bLightChanged;		// True if a light affecting the probe changed since its last update
+	};
+
+	struct ScheduledProbe {
+		U32		ProbeIndex;
+		float	Priority;
+	};
+
 	class MeshWithAdjacency {
 	public:
 		class	Primitive {
@@ -152,7 +334,6 @@ private:	// BUILD TIME STRUCTURES
 				VertexLink*		pNext;
 				U32				V;						// Original vertex index
 			};
-			static VertexLink*		ms_ppCells[64*64*64];
 
 			// Welded vertex structure
 			struct WeldedVertex {
@@ -163,19 +344,42 @@ private:	// BUILD TIME STRUCTURES
 				U32					SharingVerticesCount;	// Amount of vertices welded together
 				VertexLink*			pSharingVertices;		// List of original vertices sharing this welded vertex
 				List<WeldedVertex*>	AdjacentVertices;		// List of welded vertices adjacent to this vertex
+				bool				Dirty;					// True if the vertex or one of its adjacent vertices changed since the vertex was last propagated
 
 				// Main code that propagates probe influences between adjacent vertices
  				bool	PropagateProbeInfluencesBetweenVertices( SHProbeNetwork& _Owner );
+
+				// Flags the vertex and its adjacent vertices for the next propagation
+				void	MarkDirty();
 			};
 
 		public:
+			// Job building the primitive then propagating its probe influences until they converge
+			// Primitives don't share any vertex so they can all be processed concurrently
+			class	BuildJob : public IJob {
+			public:
+				SHProbeNetwork*					pOwner;
+				float4x4						Local2World;
+				const Scene::Mesh::Primitive*	pSourcePrimitive;
+				ProbeInfluence*					pProbeInfluencePerFace;
+				Primitive*						pPrimitive;
+				const PointGrid*				pProbeGrid;		// Grid of the probes being baked, for the isolated vertices
+
+				// Statistics
+				U32								PassesCount;
+				U32								SpreadsCount;
+				U32								IsolatedVerticesCount;
+
+				virtual void	Run();
+			};
+
 			List< Vertex >			m_Vertices;
 			List< VertexLink >		m_VertexCells;
 			List< WeldedVertex >	m_WeldedVertices;		
 
 			void	Build( SHProbeNetwork& _Owner, const float4x4& _Local2World, const Scene::Mesh::Primitive& _SourcePrimitive, ProbeInfluence* _pProbeInfluencePerFace );
 			U32		PropagateProbeInfluences( SHProbeNetwork& _Owner );
-			U32		AssignNearestProbe( SHProbeNetwork& _Owner );
+			U32		AssignNearestProbe( const PointGrid& _ProbeGrid );
 			void	RedistributeProbeIDs2Vertices( ProbeInfluence const** _ppProbeInfluences ) const;
 		};
 
@@ -187,9 +391,8 @@ private:	// BUILD TIME STRUCTURES
 
 		~MeshWithAdjacency() { SAFE_DELETE_ARRAY( m_pPrimitives ); }
 
-		void	Build( SHProbeNetwork& _Owner, const Scene::Mesh& _Mesh, ProbeInfluence* _pProbeInfluencePerFace );
-		U32		PropagateProbeInfluences( SHProbeNetwork& _Owner );
-		U32		AssignNearestProbe( SHProbeNetwork& _Owner );
+		// Allocates the primitives and appends the jobs that will build them
+		void	Build( SHProbeNetwork& _Owner, const Scene::Mesh& _Mesh, ProbeInfluence* _pProbeInfluencePerFace, List< Primitive::BuildJob >& _Jobs );
 		void	RedistributeProbeIDs2Vertices( ProbeInfluence const**& _ppProbeInfluences ) const;
 	};
 
@@ -212,8 +415,12 @@ private:	// FIELDS
 	Shader*				m_pMatRenderNeighborProbe;	// Renders the neighbor probes as planes to form a 3D vorono cell
 	ComputeShader*			m_pCSUpdateProbeDynamicSH;	// Dynamically update probes (spread across several frames)
 	ComputeShader*			m_pCSAccumulateProbeSH;		// Dynamically update probes' SH by accumulating static + sky + dynamic SH (done each frame)
+	ComputeShader*			m_pCSProjectProbeSH;		// Projects tiles of the probe's cube map into partial static lighting & occlusion SH (pre-computation only)
+	ComputeShader*			m_pCSReduceProbeSH;			// Sums the partial SH into the probe's final SH (pre-computation only)
+	ComputeShader*			m_pCSGatherProbeUpdates;	// Gathers the static update infos of the probes to update from the buffers below
 
-	Octree<const SHProbe*>	m_ProbeOctree;				// Scene octree containing probes, queried by dynamic objects
+	PointGrid				m_ProbeGrid;				// Scene grid containing probe positions, queried by dynamic objects
+	Tetrahedralization		m_ProbeTetrahedra;			// Delaunay tetrahedra of the probe positions, queried by dynamic objects to blend 4 probes
 
 	// Constant buffers
  	CB<CBProbe>*			m_pCB_Probe;
@@ -222,11 +429,13 @@ private:	// FIELDS
 	// Runtime probes
 	SB<RuntimeProbe>*		m_pSB_RuntimeProbes;		// (SRV) Position + Radius + info for each probe
 
-	SB<SHCoeffs3>*			m_ppSB_RuntimeSHStatic[2];	// (SRV) 2 sets of static SH (2 sets of lights, A and B, render in these)
+	// Runtime SH buffers, their elements are in the m_SHStorageFormat format
+	SH_STORAGE_FORMAT		m_SHStorageFormat;
+	StructuredBuffer*		m_ppSB_RuntimeSHStatic[2];	// (SRV) 2 sets of static SH (2 sets of lights, A and B, render in these)
 	SB<SHCoeffs1>*			m_pSB_RuntimeSHAmbient;		// (SRV) 1 set of ambient sky SH 
-	SB<SHCoeffs3>*			m_pSB_RuntimeSHDynamic;		// (UAV) 1 sets of dynamic SH (updated in real time across several frames)
-	SB<SHCoeffs3>*			m_pSB_RuntimeSHDynamicSun;	// (UAV) 1 sets of dynamic SH for the Sun (updated in real time across several frames)
-	SB<SHCoeffs3>*			m_pSB_RuntimeSHFinal;		// (UAV) The sum of all the above, updated each frame...
+	StructuredBuffer*		m_pSB_RuntimeSHDynamic;		// (UAV) 1 sets of dynamic SH (updated in real time across several frames)
+	StructuredBuffer*		m_pSB_RuntimeSHDynamicSun;	// (UAV) 1 sets of dynamic SH for the Sun (updated in real time across several frames)
+	StructuredBuffer*		m_pSB_RuntimeSHFinal;		// (UAV) The sum of all the above, updated each frame...
 
 	// Vorono cell neighbors
 	SB<ProbeNeighbors>*		m_pSB_ProbeNeighbors;
@@ -237,15 +446,37 @@ private:	// FIELDS
 	SB<RuntimeProbeUpdateEmissiveSurfaceInfo>*	m_pSB_RuntimeProbeEmissiveSurfaces;	// (SRV) Info for each emissive surface we're updating (color, SH)
 	SB<SHCoeffs1>*								m_pSB_RuntimeProbeSamplesSH;		// (SRV) SH for each sample direction
 
+	// Static probes update infos, uploaded once by LoadProbes()
+	SB<ProbeUpdateRequest>*						m_pSB_ProbeUpdateRequests;			// (SRV) Index + emissive surfaces start of each probe we're updating (the only per-probe data sent each frame)
+	SB<RuntimeProbeUpdateInfo>*					m_pSB_StaticProbeUpdateInfos;		// (SRV) Update info for each probe (emissive surfaces start is the index in m_pSB_StaticEmissiveSurfaces)
+	SB<RuntimeProbeUpdateSampleInfo>*			m_pSB_StaticProbeSamples;			// (SRV) Info for each sample of each probe
+	SB<StaticEmissiveSurfaceInfo>*				m_pSB_StaticEmissiveSurfaces;		// (SRV) Info for each emissive surface of each probe (material index, SH)
+	SB<float3>*									m_pSB_EmissiveMaterialColors;		// (SRV) Color of each emissive material, updated each frame
+	List< U32 >									m_EmissiveMaterialIDs;				// IDs of the materials used by the emissive surfaces
+
+	// Nearest probe grid mirrored on the GPU (cf. Inc/ProbeGrid.hlsl)
+	SB<ProbeGridInfos>*		m_pSB_ProbeGridInfos;		// (SRV) Grid dimensions
+	SB<PointGrid::Cell>*	m_pSB_ProbeGridCells;		// (SRV) Candidates range for each cell
+	SB<U32>*				m_pSB_ProbeGridCandidates;	// (SRV) Candidate probe IDs for all the cells
+	SB<float3>*				m_pSB_ProbeGridPositions;	// (SRV) Position of each probe
+
+	// Probe tetrahedra mirrored on the GPU (cf. Inc/ProbeTetrahedra.hlsl)
+	SB<Tetrahedralization::Tetrahedron>*	m_pSB_ProbeTetrahedra;				// (SRV) Probe IDs & neighbors of each tetrahedron
+	SB<Tetrahedralization::Barycentrics>*	m_pSB_ProbeTetrahedraBarycentrics;	// (SRV) Barycentric matrix of each tetrahedron
+	SB<U32>*								m_pSB_ProbeTetrahedronOfProbe;		// (SRV) A tetrahedron using each probe, where the walks of the shaders start from
+
+	// Camera-centered volume of the probes' SH for dynamic objects & particles (cf. Inc/IrradianceVolume.hlsl)
+	SHProbeIrradianceVolume	m_IrradianceVolume;
+
 	// Additional vertex stream containing probe IDs for each vertex
 	Primitive*				m_pPrimProbeIDs;
 
 	// Probes network debug
 	SB<RuntimeProbeNetworkInfos>*	m_pSB_RuntimeProbeNetworkInfos;
 
-	// Queue of probe indices to update each frame
-	// TODO! I'm only storing the index of the sequence of probes I'll update each frame
-	int						m_ProbeUpdateIndex;
+	// Probes update scheduling
+	ProbeUpdateState*		m_pProbeUpdateStates;		// Update state of each probe
+	float					m_AverageProbeUpdatesCount;	// Rolling average of the amount of probes updated each frame, used to estimate the GPU cost of a single probe
 
 	// The encoder that will render cube maps and process them to generate runtime probe data
 	SHProbeEncoder			m_ProbeEncoder;
@@ -259,12 +490,23 @@ public:
 	SHProbeNetwork();
 	~SHProbeNetwork();
 
-	void			Init( Device& _Device, Primitive& _ScreenQuad );
+	// _PackedSceneVertices, true if the scene primitives rendered in the probes' cube maps use VertexFormatPackedP3N3G3B3T2
+	// _TextureArrays, true if the scene materials sample their textures from texture arrays (cf. Inc/MaterialTextureArrays.hlsl)
+	void			Init( Device& _Device, Primitive& _ScreenQuad, SH_STORAGE_FORMAT _SHStorageFormat=SH_STORAGE_FLOAT, bool _PackedSceneVertices=false, bool _TextureArrays=false );
 	void			Exit();
 
+	SH_STORAGE_FORMAT	GetSHStorageFormat() const	{ return m_SHStorageFormat; }
+
+	// Returns the value of the SH_STORAGE_FORMAT macro to compile the shaders reading the runtime SH with
+	static const char*	GetSHStorageFormatMacro( SH_STORAGE_FORMAT _Format );
+
 	void			PreAllocateProbes( int _ProbesCount );
 
 	void			AddProbe( Scene::Probe& _Probe );
+
+	// Adds the probes of the scene, only the ones kept by the last OptimizeProbePlacement() if its placement file is still valid
+	// _bAllCandidates, true to ignore the placement file and add all the probes of the scene (e.g. to optimize their placement again)
+	void			AddSceneProbes( Scene& _Scene, const char* _pPathToProbes, bool _bAllCandidates=false );
 	U32				GetProbesCount() const			{ return m_ProbesCount; }
 	const SHProbe&	GetProbe( U32 _Index ) const	{ return m_pProbes[_Index]; }
 
@@ -272,15 +514,69 @@ public:
 
 	// Runtime use
 	void			UpdateDynamicProbes( DynamicUpdateParms& _Parms );
+	void			BindSceneInputs();	// Binds the probes' buffers used for scene rendering (also done at the end of the dynamic update)
+	const SHProbeIrradianceVolume&	GetIrradianceVolume() const	{ return m_IrradianceVolume; }
 	U32				GetNearestProbe( const float3& _wsPosition ) const;
+	void			GetNearestProbes( U32 _Count, const float3* _pwsPositions, U32* _pProbeIDs ) const;	// Batched version for many dynamic objects
+
+	// Finds the 4 probes to blend with their weights (that sum to 1) at the provided position by walking the probe tetrahedra from _TetrahedronHint
+	// Returns the tetrahedron to provide as hint for the next query of the same object (start with ~0U), positions outside of the
+	//	tetrahedra use the nearest tetrahedron with clamped weights and if there are no tetrahedra at all, the nearest probe gets all the weight
+	U32				FindProbeTetrahedron( const float3& _wsPosition, U32 _TetrahedronHint, U32 _pProbeIDs[4], float4& _Weights ) const;
 
 	// Build/Load/Save
-	void			PreComputeProbes( const char* _pPathToProbes, IRenderSceneDelegate& _RenderScene, Scene& _Scene, U32 _TotalFacesCount );
+	// The bake can be split into _UnitsCount work units of contiguous probes baked independently (e.g. by processes on the nodes of a render farm
+	//	that load the same scene and write to the same shared probes directory), each unit then saves its probes and a unit file that
+	//	MergeBakeWorkUnits() verifies and merges into the probe influence vertex stream. A single unit bakes everything at once.
+	void			PreComputeProbes( const char* _pPathToProbes, IRenderSceneDelegate& _RenderScene, Scene& _Scene, U32 _TotalFacesCount, U32 _UnitIndex=0, U32 _UnitsCount=1 );
+	bool			MergeBakeWorkUnits( const char* _pPathToProbes, Scene& _Scene, U32 _TotalFacesCount, U32 _UnitsCount );	// Returns false if a unit is missing, stale or its probes don't match
+	static void		GetBakeWorkUnit( U32 _ProbesCount, U32 _UnitIndex, U32 _UnitsCount, U32& _FirstProbeIndex, U32& _UnitProbesCount );
+
+	// Only rebakes the probes that saw a mesh that changed since the last bake or that could see a mesh that changed, then only rebuilds
+	//	the probe influence vertex stream of the meshes whose face influences changed
+	// Falls back to PreComputeProbes() if the last bake left no manifest (e.g. a distributed bake) or if probes or static lights changed
+	void			RebakeProbes( const char* _pPathToProbes, IRenderSceneDelegate& _RenderScene, Scene& _Scene, U32 _TotalFacesCount );
+
+	// Can be called again after a rebake, the probe IDs vertex stream is rebuilt so it must be bound again to the scene primitives
 	void			LoadProbes( const char* _pPathToProbes, const float3& _SceneBBoxMin, const float3& _SceneBBoxMax );
 
+	// Offline probe placement optimization, the network must hold all the probes of the scene, baked & loaded
+	// Greedily removes the probes whose static SH are predicted by their directly visible neighbors within _ErrorBudget (relative error)
+	//	and saves the scene probes to keep in the placement file used by the next AddSceneProbes(). Returns the amount of probes kept.
+	U32				OptimizeProbePlacement( const char* _pPathToProbes, Scene& _Scene, float _ErrorBudget );
+
 private:
 
-	void			BuildProbeInfluenceVertexStream( Scene& _Scene, const char* _pPathToStreamFile );
+	void			BakeProbes( const char* _pPathToProbes, IRenderSceneDelegate& _RenderScene, U32 _TotalFacesCount, const List<U32>& _ProbeIndices, const List<BakeMesh>& _Meshes, List<SeenFace>* _pSeenFaces );
+	static U32		ChooseCubeMapFaceSizes( Texture2D& _StagingCubeMap, U32 _pFaceSizes[6] );	// Returns the mask of the faces of the low-resolution pass that must be rendered again (cf. ADAPTIVE_PROBE_CUBE_MAPS)
+	void			BuildProbeInfluenceVertexStream( Scene& _Scene, const char* _pPathToStreamFile, const U32* const* _ppKeptMeshProbeIDs=NULL );	// Meshes given previous probe IDs are not rebuilt
+	void			ReleaseLoadedProbes();
+
+	// Distributed bake
+	U32				ComputeBakeSignature( U32 _TotalFacesCount ) const;
+	void			SaveBakeWorkUnit( const char* _pPathToProbes, U32 _UnitIndex, U32 _UnitsCount, U32 _TotalFacesCount ) const;
+
+	// Incremental bake
+	void			GatherBakeMeshes( Scene& _Scene, List<BakeMesh>& _Meshes ) const;
+	U32				ComputeBakeManifestSignature( Scene& _Scene ) const;
+	void			SaveBakeManifest( const char* _pPathToProbes, Scene& _Scene, const List<BakeMesh>& _Meshes, const List<SeenFace>* _pSeenFaces ) const;
+	static void		CollateSeenFaces( U32 _ProbesCount, const List<BakeMesh>& _Meshes, const List<SeenFace>* _pSeenFaces, List<ProbeInfluence>& _ProbeInfluencePerFace );
+
+	// Probe placement
+	float			ComputeProbePredictionError( U32 _ProbeIndex, const bool* _pbRemoved, U32 _ExcludedProbeIndex=~0U ) const;
+	static U32		ComputePlacementSignature( Scene& _Scene );
+
+	// Packed probe network file
+	// Returns false if the file doesn't exist or doesn't match the current network (probes should then be loaded from their individual files)
+	bool			LoadPackedProbes( const char* _pFileName );
+	void			SavePackedProbes( const char* _pFileName, bool _bHalfSH ) const;
+
+	// Runtime SH storage
+	static int		GetSHStorageElementSize( SH_STORAGE_FORMAT _Format );
+	static void		EncodeRuntimeSH( SH_STORAGE_FORMAT _Format, const float3 _pSH[9], void* _pTarget );
+
+	// Fills the indices of the probes to update this frame, sorted by decreasing priority, and returns their amount
+	U32				ScheduleProbeUpdates( const DynamicUpdateParms& _Parms, U32 _pProbeIndices[MAX_PROBE_UPDATES_PER_FRAME] );
 
 friend class SHProbeEncoder;
 friend static void	CopyProbeNetworkConnection( int _EntryIndex, SHProbeNetwork::RuntimeProbeNetworkInfos& _Value, void* _pUserData );
@@ -0,0 +1,99 @@
+#include "../GodComplex.h"
+
+ShaderPermutations::ShaderPermutations( U16 _ShaderResourceID, const char* _pFileName, const IVertexFormatDescriptor& _Format, const char* _pEntryPointVS, const char* _pEntryPointGS, const char* _pEntryPointPS, const char** _ppKeywords, D3D_SHADER_MACRO* _pMacros )
+	: m_ShaderResourceID( _ShaderResourceID )
+	, m_pFileName( _pFileName )
+	, m_Format( _Format )
+	, m_pEntryPointVS( _pEntryPointVS )
+	, m_pEntryPointHS( NULL )
+	, m_pEntryPointDS( NULL )
+	, m_pEntryPointGS( _pEntryPointGS )
+	, m_pEntryPointPS( _pEntryPointPS )
+{
+	Init( _ppKeywords, _pMacros );
+}
+
+ShaderPermutations::ShaderPermutations( U16 _ShaderResourceID, const char* _pFileName, const IVertexFormatDescriptor& _Format, const char* _pEntryPointVS, const char* _pEntryPointHS, const char* _pEntryPointDS, const char* _pEntryPointGS, const char* _pEntryPointPS, const char** _ppKeywords, D3D_SHADER_MACRO* _pMacros )
+	: m_ShaderResourceID( _ShaderResourceID )
+	, m_pFileName( _pFileName )
+	, m_Format( _Format )
+	, m_pEntryPointVS( _pEntryPointVS )
+	, m_pEntryPointHS( _pEntryPointHS )
+	, m_pEntryPointDS( _pEntryPointDS )
+	, m_pEntryPointGS( _pEntryPointGS )
+	, m_pEntryPointPS( _pEntryPointPS )
+{
+	Init( _ppKeywords, _pMacros );
+}
+
+ShaderPermutations::~ShaderPermutations()
+{
+	for ( U32 VariantIndex=0; VariantIndex < GetVariantsCount(); VariantIndex++ )
+		delete m_ppVariants[VariantIndex];
+}
+
+void	ShaderPermutations::Init( const char** _ppKeywords, D3D_SHADER_MACRO* _pMacros )
+{
+	m_KeywordsCount = 0;
+	while ( _ppKeywords != NULL && _ppKeywords[m_KeywordsCount] != NULL )
+	{
+		ASSERT( m_KeywordsCount < MAX_KEYWORDS, "Too many keywords!" );
+		m_ppKeywords[m_KeywordsCount] = _ppKeywords[m_KeywordsCount];
+		m_KeywordsCount++;
+	}
+
+	m_MacrosCount = 0;
+	while ( _pMacros != NULL && _pMacros[m_MacrosCount].Name != NULL )
+	{
+		ASSERT( m_MacrosCount < MAX_MACROS, "Too many common macros!" );
+		m_pMacros[m_MacrosCount] = _pMacros[m_MacrosCount];
+		m_MacrosCount++;
+	}
+
+	memset( m_ppVariants, 0, sizeof(m_ppVariants) );
+}
+
+int		ShaderPermutations::GetCompiledVariantsCount() const
+{
+	int	Count = 0;
+	for ( U32 VariantIndex=0; VariantIndex < GetVariantsCount(); VariantIndex++ )
+		if ( m_ppVariants[VariantIndex] != NULL )
+			Count++;
+	return Count;
+}
+
+U32		ShaderPermutations::GetKeyword( const char* _pKeyword ) const
+{
+	for ( int KeywordIndex=0; KeywordIndex < m_KeywordsCount; KeywordIndex++ )
+		if ( !strcmp( m_ppKeywords[KeywordIndex], _pKeyword ) )
+			return 1U << KeywordIndex;
+
+	ASSERT( false, "Unknown keyword!" );
+	return 0;
+}
+
+Shader&	ShaderPermutations::Get( U32 _Keywords )
+{
+	ASSERT( _Keywords < GetVariantsCount(), "Invalid keywords mask!" );
+	if ( m_ppVariants[_Keywords] != NULL )
+		return *m_ppVariants[_Keywords];
+
+	// Common macros followed by the keywords of the variant (the shader copies the array)
+	D3D_SHADER_MACRO	pMacros[MAX_MACROS+MAX_KEYWORDS+1];
+	int					MacrosCount = 0;
+	for ( int MacroIndex=0; MacroIndex < m_MacrosCount; MacroIndex++ )
+		pMacros[MacrosCount++] = m_pMacros[MacroIndex];
+	for ( int KeywordIndex=0; KeywordIndex < m_KeywordsCount; KeywordIndex++ )
+		if ( _Keywords & (1U << KeywordIndex) )
+		{
+			pMacros[MacrosCount].Name = m_ppKeywords[KeywordIndex];
+			pMacros[MacrosCount].Definition = "1";
+			MacrosCount++;
+		}
+	pMacros[MacrosCount].Name = NULL;
+	pMacros[MacrosCount].Definition = NULL;
+
+	m_ppVariants[_Keywords] = CreateMaterial( m_ShaderResourceID, m_pFileName, m_Format, m_pEntryPointVS, m_pEntryPointHS, m_pEntryPointDS, m_pEntryPointGS, m_pEntryPointPS, MacrosCount > 0 ? pMacros : NULL );
+
+	return *m_ppVariants[_Keywords];
+}
@@ -0,0 +1,69 @@
+//////////////////////////////////////////////////////////////////////////
+// Shader Permutations
+// Declares the keywords of a shader file once and creates the variant for a given combination of keywords only the first time
+//	it's requested, so the startup only compiles the variants that are actually used.
+// A variant is identified by a bitmask: bit i set means the i-th keyword is defined to "1" (in addition to the common macros).
+//
+// Usage:
+//	const char*			ppKeywords[] = { "CAMERA_ABOVE_CLOUDS", NULL };
+//	ShaderPermutations	Display( IDR_SHADER_VOLUMETRIC_DISPLAY, "./Resources/Shaders/VolumetricDisplay.hlsl", VertexFormatPt4::DESCRIPTOR, "VS", NULL, "PS", ppKeywords );
+//	Shader&				M = Display.Get( bAboveClouds ? Display.GetKeyword( "CAMERA_ABOVE_CLOUDS" ) : 0 );
+//
+// Variants are created with CreateMaterial() so they are watched for modifications and ScopedForceMaterialsLoadFromBinary loads
+//	their .fxbin like any other material. In RELEASE, the blob of a variant is looked up in the aggregate under its variant name
+//	(i.e. "<EntryPoint><Macros signature>", cf. Shader::BuildVariantName()).
+//
+// NOTE: Keywords and common macros must be persistent strings, the shaders keep pointers to them for recompilation.
+//
+#pragma once
+
+class Shader;
+class IVertexFormatDescriptor;
+
+class ShaderPermutations
+{
+public:		// CONSTANTS
+
+	static const int	MAX_KEYWORDS = 8;			// 256 variants per shader file
+	static const int	MAX_MACROS = 16;			// Common macros defined for all the variants
+
+private:	// FIELDS
+
+	U16								m_ShaderResourceID;
+	const char*						m_pFileName;
+	const IVertexFormatDescriptor&	m_Format;
+	const char*						m_pEntryPointVS;
+	const char*						m_pEntryPointHS;
+	const char*						m_pEntryPointDS;
+	const char*						m_pEntryPointGS;
+	const char*						m_pEntryPointPS;
+
+	int								m_KeywordsCount;
+	const char*						m_ppKeywords[MAX_KEYWORDS];
+	int								m_MacrosCount;
+	D3D_SHADER_MACRO				m_pMacros[MAX_MACROS];
+
+	Shader*							m_ppVariants[1 << MAX_KEYWORDS];
+
+public:		// PROPERTIES
+
+	U32			GetVariantsCount() const	{ return 1U << m_KeywordsCount; }
+	int			GetCompiledVariantsCount() const;
+
+	// Returns the bit of a keyword
+	U32			GetKeyword( const char* _pKeyword ) const;
+
+public:		// METHODS
+
+	// _ppKeywords and _pMacros are NULL-terminated
+	ShaderPermutations( U16 _ShaderResourceID, const char* _pFileName, const IVertexFormatDescriptor& _Format, const char* _pEntryPointVS, const char* _pEntryPointGS, const char* _pEntryPointPS, const char** _ppKeywords, D3D_SHADER_MACRO* _pMacros=NULL );
+	ShaderPermutations( U16 _ShaderResourceID, const char* _pFileName, const IVertexFormatDescriptor& _Format, const char* _pEntryPointVS, const char* _pEntryPointHS, const char* _pEntryPointDS, const char* _pEntryPointGS, const char* _pEntryPointPS, const char** _ppKeywords, D3D_SHADER_MACRO* _pMacros=NULL );
+	~ShaderPermutations();	// Deletes the variants
+
+	// Returns the variant, compiling it if it's the first time it's requested
+	Shader&		Get( U32 _Keywords );
+
+private:
+
+	void		Init( const char** _ppKeywords, D3D_SHADER_MACRO* _pMacros );
+};
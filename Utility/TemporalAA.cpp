@@ -0,0 +1,133 @@
+#include "../GodComplex.h"
+
+static const float	DEFAULT_HISTORY_WEIGHT = 0.9f;	// Converges over ~10 frames
+
+// Radical inverse of the index in the given base, the first index is 1 since 0 would always give 0
+static float	Halton( U32 _Index, U32 _Base )
+{
+	float	Result = 0.0f;
+	float	Fraction = 1.0f / _Base;
+	for ( ; _Index > 0; _Index /= _Base, Fraction /= _Base )
+		Result += Fraction * (_Index % _Base);
+	return Result;
+}
+
+TemporalAA::TemporalAA( Device& _Device, Camera& _Camera, int _Width, int _Height, const IVertexFormatDescriptor& _ObjectVertexFormat )
+	: m_Device( _Device )
+	, m_Camera( _Camera )
+	, m_Width( _Width )
+	, m_Height( _Height )
+	, m_pRTHistory( NULL )
+	, m_JitterIndex( 0 )
+	, m_HistoryWeight( DEFAULT_HISTORY_WEIGHT )
+	, m_bHistoryValid( false )
+{
+	m_pCSCameraVelocity = CreateComputeShader( IDR_SHADER_TEMPORAL_AA, "./Resources/Shaders/TemporalAA.hlsl", "CS_CameraVelocity" );
+	m_pCSResolve = CreateComputeShader( IDR_SHADER_TEMPORAL_AA, "./Resources/Shaders/TemporalAA.hlsl", "CS_Resolve" );
+	m_pMatObjectVelocity = CreateMaterial( IDR_SHADER_TEMPORAL_AA, "./Resources/Shaders/TemporalAA.hlsl", _ObjectVertexFormat, "VS_ObjectVelocity", NULL, "PS_ObjectVelocity" );
+
+	m_pRTVelocity = new Texture2D( m_Device, m_Width, m_Height, 1, PixelFormatRG16F::DESCRIPTOR, 1, NULL, false, true );
+
+	m_pCB_TemporalAA = new CB<CBTemporalAA>( m_Device, 10 );
+	m_pCB_TemporalAA->m.TargetSizeX = m_Width;
+	m_pCB_TemporalAA->m.TargetSizeY = m_Height;
+	m_pCB_ObjectMotion = new CB<CBObjectMotion>( m_Device, 11 );
+}
+
+TemporalAA::~TemporalAA()
+{
+	if ( m_pRTHistory != NULL )
+		m_Device.RenderTargets().Release( *m_pRTHistory );
+
+	delete m_pCB_ObjectMotion;
+	delete m_pCB_TemporalAA;
+	delete m_pRTVelocity;
+	delete m_pMatObjectVelocity;
+	delete m_pCSResolve;
+	delete m_pCSCameraVelocity;
+}
+
+bool	TemporalAA::HasErrors() const
+{
+	return m_pCSCameraVelocity->HasErrors() || m_pCSResolve->HasErrors() || m_pMatObjectVelocity->HasErrors();
+}
+
+void	TemporalAA::JitterCamera()
+{
+	U32		SampleIndex = 1 + (m_JitterIndex++ % JITTER_SEQUENCE_LENGTH);
+	float2	PixelOffset( Halton( SampleIndex, 2 ) - 0.5f, Halton( SampleIndex, 3 ) - 0.5f );
+
+	// A pixel is 2/Width wide in NDC, and Y goes up in NDC while it goes down in pixels
+	m_Camera.SetJitter( float2( 2.0f * PixelOffset.x / m_Width, -2.0f * PixelOffset.y / m_Height ) );
+}
+
+void	TemporalAA::ComputeCameraVelocity( const Texture2D& _DepthStencil )
+{
+	ASSERT( _DepthStencil.GetWidth() == m_Width && _DepthStencil.GetHeight() == m_Height, "Depth stencil doesn't have the TAA's resolution!" );
+
+	UpdateCameraData();
+	if ( !m_pCSCameraVelocity->Use() )
+		return;
+
+	m_pRTVelocity->RemoveFromLastAssignedSlots();
+	_DepthStencil.SetCS( 11 );
+	m_pRTVelocity->SetCSUAV( 0 );
+
+	m_pCSCameraVelocity->Dispatch( (m_Width+7) >> 3, (m_Height+7) >> 3, 1 );
+
+	m_Device.RemoveShaderResources( 11, 1, Device::SSF_COMPUTE_SHADER );
+	m_pRTVelocity->RemoveFromLastAssignedSlotUAV();
+}
+
+void	TemporalAA::SetObjectMotion( const float4x4& _Local2World, const float4x4& _PreviousLocal2World )
+{
+	m_pCB_ObjectMotion->m.Local2World = _Local2World;
+	m_pCB_ObjectMotion->m.PreviousLocal2World = _PreviousLocal2World;
+	m_pCB_ObjectMotion->UpdateData();
+}
+
+void	TemporalAA::Resolve( Texture2D& _Source, const Texture2D& _DepthStencil )
+{
+	ASSERT( _Source.GetWidth() == m_Width && _Source.GetHeight() == m_Height, "Source doesn't have the TAA's resolution!" );
+
+	// The new history ping-pongs with the previous one in the pool
+	// It has the same usage as the HDR source so it can be copied from it while the kernel compiles
+	Texture2D&	RTHistory = m_Device.RenderTargets().Acquire( m_Width, m_Height, 1, RenderTargetFormats::Select( RenderTargetFormats::HDR_COLOR ), 1, true );
+	m_Device.RenderTargets().KeepAcrossFrames( RTHistory );
+
+	bool	bHistoryValid = m_bHistoryValid && m_pRTHistory != NULL;
+	if ( m_pCSResolve->Use() )
+	{
+		m_pCB_TemporalAA->m.HistoryWeight = m_HistoryWeight;
+		m_pCB_TemporalAA->m.HistoryValid = bHistoryValid;
+		m_pCB_TemporalAA->UpdateData();
+
+		_Source.SetCS( 10 );
+		_DepthStencil.SetCS( 11 );
+		m_pRTVelocity->SetCS( 12 );
+		(bHistoryValid ? *m_pRTHistory : _Source).SetCS( 13 );
+		RTHistory.SetCSUAV( 0 );
+
+		m_pCSResolve->Dispatch( (m_Width+7) >> 3, (m_Height+7) >> 3, 1 );
+
+		m_Device.RemoveShaderResources( 10, 4, Device::SSF_COMPUTE_SHADER );
+		RTHistory.RemoveFromLastAssignedSlotUAV();
+		m_bHistoryValid = true;
+	}
+	else
+		RTHistory.CopyFrom( _Source );	// Still present something while the kernel compiles
+
+	if ( m_pRTHistory != NULL )
+		m_Device.RenderTargets().Release( *m_pRTHistory );
+	m_pRTHistory = &RTHistory;
+}
+
+// The camera constants are copied in our own buffer so the velocity passes don't depend on the layout of the global camera buffer
+void	TemporalAA::UpdateCameraData()
+{
+	m_pCB_TemporalAA->m.World2Proj = m_Camera.GetCB().World2Proj;
+	m_pCB_TemporalAA->m.Proj2World = m_Camera.GetCB().Proj2World;
+	m_pCB_TemporalAA->m.PreviousWorld2Proj = m_Camera.GetCB().PreviousWorld2Proj;
+	m_pCB_TemporalAA->m.Jitter = m_Camera.GetCB().Jitter;
+	m_pCB_TemporalAA->UpdateData();
+}
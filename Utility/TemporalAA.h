@@ -0,0 +1,118 @@
+//////////////////////////////////////////////////////////////////////////
+// Temporal anti-aliasing
+// Amortizes supersampling over several frames: the camera's projection is offset by a different sub-pixel jitter each frame
+//	and the jittered frames are accumulated into a history that's reprojected with per-pixel motion vectors (cf. TemporalAA.hlsl):
+//	_ JitterCamera() offsets the camera's projection with the next point of a Halton(2,3) sequence
+//	_ ComputeCameraVelocity() fills the velocity buffer with the camera motion, reconstructed from the scene's depth
+//	_ The moving objects are then drawn over the velocity buffer with the object velocity material and their own motion
+//	_ Resolve() reprojects the history with the velocity of the closest pixel of each 3x3 block, clamps it to the color range of
+//		the current frame's neighborhood so disoccluded pixels don't ghost, and blends the current frame into it
+//
+// The history is a pooled render target kept across frames (cf. RenderTargetPool::KeepAcrossFrames()), the resolve acquires a
+//	new one and releases the previous one so the 2 targets ping-pong in the pool.
+//
+// Usage:
+//	TemporalAA	TAA( gs_Device, Camera, RESX, RESY, VertexFormatP3N3G3T2::DESCRIPTOR );
+//	(...)
+//	TAA.JitterCamera();
+//	Camera.Upload( 0 );
+//	(...)	// Render the scene
+//	TAA.ComputeCameraVelocity( gs_Device.DefaultDepthStencil() );
+//	USING_MATERIAL_START( TAA.GetObjectVelocityMaterial() )
+//		TAA.SetObjectMotion( Local2World, PreviousLocal2World );
+//		(...)	// Draw the moving object into TAA.GetVelocity() with the scene's depth stencil
+//	USING_MATERIAL_END
+//	TAA.Resolve( *pRTHDR, gs_Device.DefaultDepthStencil() );
+//	(...)	// Post-process TAA.GetHistory()
+//
+// NOTE: The velocity is stored in UV space as (previous UV - current UV), the jitter being removed from both.
+//
+#pragma once
+
+template<typename> class CB;
+
+class	TemporalAA
+{
+public:		// CONSTANTS
+
+	static const int	JITTER_SEQUENCE_LENGTH = 8;
+
+protected:	// NESTED TYPES
+
+	// WARNING: must match the cbTemporalAA constant buffer in TemporalAA.hlsl!
+	struct	CBTemporalAA
+	{
+		U32			TargetSizeX, TargetSizeY;
+		float		HistoryWeight;
+		U32			HistoryValid;
+
+		float4x4	World2Proj;				// Current frame, jittered
+		float4x4	Proj2World;
+		float4x4	PreviousWorld2Proj;		// Previous frame, jittered
+		float4		Jitter;					// XY=Current jitter, ZW=Previous jitter (in NDC)
+	};
+
+	// WARNING: must match the cbObjectMotion constant buffer in TemporalAA.hlsl!
+	struct	CBObjectMotion
+	{
+		float4x4	Local2World;
+		float4x4	PreviousLocal2World;
+	};
+
+protected:	// FIELDS
+
+	Device&				m_Device;
+	Camera&				m_Camera;
+
+	int					m_Width;
+	int					m_Height;
+
+	ComputeShader*		m_pCSCameraVelocity;
+	ComputeShader*		m_pCSResolve;
+	Shader*				m_pMatObjectVelocity;
+
+	Texture2D*			m_pRTVelocity;		// RG=Previous UV - Current UV
+	Texture2D*			m_pRTHistory;		// Pooled, NULL until the first resolve
+	CB<CBTemporalAA>*	m_pCB_TemporalAA;
+	CB<CBObjectMotion>*	m_pCB_ObjectMotion;
+
+	U32					m_JitterIndex;
+	float				m_HistoryWeight;
+	bool				m_bHistoryValid;
+
+public:		// PROPERTIES
+
+	bool				HasErrors() const;
+	Shader&				GetObjectVelocityMaterial()	{ return *m_pMatObjectVelocity; }
+	Texture2D&			GetVelocity()				{ return *m_pRTVelocity; }
+	Texture2D&			GetHistory()				{ ASSERT( m_pRTHistory != NULL, "Nothing was resolved yet!" ); return *m_pRTHistory; }
+
+	// Weight of the history in the blend (the higher the smoother, but the longer the reprojection errors take to fade)
+	float				GetHistoryWeight() const			{ return m_HistoryWeight; }
+	void				SetHistoryWeight( float _Weight )	{ m_HistoryWeight = _Weight; }
+
+public:		// METHODS
+
+	// _ObjectVertexFormat, vertex format of the moving objects drawn with the object velocity material
+	TemporalAA( Device& _Device, Camera& _Camera, int _Width, int _Height, const IVertexFormatDescriptor& _ObjectVertexFormat );
+	~TemporalAA();
+
+	// Offsets the camera's projection for the frame, call it before uploading the camera
+	void				JitterCamera();
+
+	// Forgets the history so the next frame isn't blended with it (e.g. after a camera cut)
+	void				InvalidateHistory()		{ m_bHistoryValid = false; }
+
+	// Fills the velocity buffer with the camera motion (call it once the scene's depth is complete)
+	void				ComputeCameraVelocity( const Texture2D& _DepthStencil );
+
+	// Sets the transforms of a moving object before drawing it with the object velocity material
+	void				SetObjectMotion( const float4x4& _Local2World, const float4x4& _PreviousLocal2World );
+
+	// Accumulates the source into a new history (cf. GetHistory())
+	void				Resolve( Texture2D& _Source, const Texture2D& _DepthStencil );
+
+protected:
+
+	void				UpdateCameraData();
+};
@@ -0,0 +1,517 @@
+#include "../GodComplex.h"
+
+namespace
+{
+	inline void		Sub( const double* a, const double* b, double* r )		{ r[0] = a[0] - b[0]; r[1] = a[1] - b[1]; r[2] = a[2] - b[2]; }
+	inline void		Cross( const double* a, const double* b, double* r )	{ r[0] = a[1]*b[2] - a[2]*b[1]; r[1] = a[2]*b[0] - a[0]*b[2]; r[2] = a[0]*b[1] - a[1]*b[0]; }
+	inline double	Dot( const double* a, const double* b )					{ return a[0]*b[0] + a[1]*b[1] + a[2]*b[2]; }
+
+	// Returns 6 times the signed volume of the tetrahedron, positive when (b-a, c-a, d-a) is a direct basis
+	double	Orient( const double* a, const double* b, const double* c, const double* d )
+	{
+		double	ab[3], ac[3], ad[3], N[3];
+		Sub( b, a, ab );
+		Sub( c, a, ac );
+		Sub( d, a, ad );
+		Cross( ac, ad, N );
+		return Dot( ab, N );
+	}
+
+	// Uniform value in [-1,1] from a simple LCG, so the jitter doesn't depend on the global random state
+	double	Jitter( U32& _Seed )
+	{
+		_Seed = 1664525U * _Seed + 1013904223U;
+		return (_Seed >> 8) * (2.0 / double(1 << 24)) - 1.0;
+	}
+
+	// Incremental Bowyer-Watson insertion
+	class	DelaunayBuilder
+	{
+	public:
+
+		struct	BuildTetrahedron
+		{
+			U32		pVertices[4];
+			U32		pNeighbors[4];		// Across the face opposite each vertex
+			double	pCenter[3];			// Circumsphere
+			double	RadiusSq;
+			U32		Mark;				// Index of the last insertion whose cavity contained the tetrahedron
+			bool	bAlive;
+		};
+
+		struct	BoundaryFace
+		{
+			U32		pVertices[4];		// Vertices of the new tetrahedron: the face's 3 vertices and the inserted point
+			U32		FaceIndex;			// Index of the inserted point in the new tetrahedron
+			U32		Neighbor;			// Tetrahedron on the other side of the face
+			U32		NeighborFace;		// Face of the neighbor that pointed to the cavity
+			U32		NewTetrahedron;
+		};
+
+		struct	CavityEdge
+		{
+			U32		pVertices[2];		// Sorted
+			U32		Tetrahedron;
+			U32		FaceIndex;
+		};
+
+	public:
+
+		const double*			m_pPoints;
+		double					m_OrientEpsilon;
+
+		List<BuildTetrahedron>	m_Tetrahedra;
+		List<U32>				m_FreeTetrahedra;
+		U32						m_LastTetrahedron;
+		U32						m_Mark;
+
+		// Scratch lists kept across insertions
+		List<U32>				m_Cavity;
+		List<BoundaryFace>		m_Faces;
+		List<CavityEdge>		m_Edges;
+
+	public:
+
+		DelaunayBuilder( const double* _pPoints, double _OrientEpsilon )
+			: m_pPoints( _pPoints )
+			, m_OrientEpsilon( _OrientEpsilon )
+			, m_LastTetrahedron( 0 )
+			, m_Mark( 0 )
+		{
+		}
+
+		const double*	Point( U32 _Index ) const	{ return m_pPoints + 3*_Index; }
+
+		U32		Allocate( const U32 _pVertices[4] )
+		{
+			U32	Index;
+			if ( m_FreeTetrahedra.GetCount() > 0 )
+			{
+				Index = m_FreeTetrahedra[m_FreeTetrahedra.GetCount()-1];
+				m_FreeTetrahedra.RemoveAt( m_FreeTetrahedra.GetCount()-1 );
+			}
+			else
+			{
+				Index = m_Tetrahedra.GetCount();
+				m_Tetrahedra.Append();
+			}
+
+			BuildTetrahedron&	T = m_Tetrahedra[Index];
+			for ( int i=0; i < 4; i++ )
+			{
+				T.pVertices[i] = _pVertices[i];
+				T.pNeighbors[i] = Tetrahedralization::INVALID_INDEX;
+			}
+			T.Mark = 0;
+			T.bAlive = true;
+			ComputeCircumsphere( T );
+
+			return Index;
+		}
+
+		void	ComputeCircumsphere( BuildTetrahedron& _T ) const
+		{
+			const double*	a = Point( _T.pVertices[0] );
+			double	ba[3], ca[3], da[3];
+			Sub( Point( _T.pVertices[1] ), a, ba );
+			Sub( Point( _T.pVertices[2] ), a, ca );
+			Sub( Point( _T.pVertices[3] ), a, da );
+
+			double	CD[3], DB[3], BC[3];
+			Cross( ca, da, CD );
+			Cross( da, ba, DB );
+			Cross( ba, ca, BC );
+			double	Det = Dot( ba, CD );
+			if ( fabs( Det ) < 1e-300 )
+			{	// Flat: make sure every insertion nearby removes it
+				_T.pCenter[0] = a[0]; _T.pCenter[1] = a[1]; _T.pCenter[2] = a[2];
+				_T.RadiusSq = 1e300;
+				return;
+			}
+
+			double	Lb = Dot( ba, ba ), Lc = Dot( ca, ca ), Ld = Dot( da, da );
+			double	InvDet = 0.5 / Det;
+			double	Offset[3];
+			for ( int i=0; i < 3; i++ )
+				Offset[i] = (Lb * CD[i] + Lc * DB[i] + Ld * BC[i]) * InvDet;
+
+			_T.pCenter[0] = a[0] + Offset[0];
+			_T.pCenter[1] = a[1] + Offset[1];
+			_T.pCenter[2] = a[2] + Offset[2];
+			_T.RadiusSq = Dot( Offset, Offset );
+		}
+
+		bool	InSphere( const BuildTetrahedron& _T, const double* _P ) const
+		{
+			double	D[3];
+			Sub( _P, _T.pCenter, D );
+			return Dot( D, D ) < _T.RadiusSq;
+		}
+
+		// Orientation of the tetrahedron whose vertex _VertexIndex is replaced by _P (i.e. > 0 if _P is on the inner side of the opposite face)
+		double	OrientReplaced( const BuildTetrahedron& _T, U32 _VertexIndex, const double* _P ) const
+		{
+			const double*	ppV[4] = { Point( _T.pVertices[0] ), Point( _T.pVertices[1] ), Point( _T.pVertices[2] ), Point( _T.pVertices[3] ) };
+			ppV[_VertexIndex] = _P;
+			return Orient( ppV[0], ppV[1], ppV[2], ppV[3] );
+		}
+
+		// Walks from the last created tetrahedron to the one containing the point
+		U32		Locate( const double* _P ) const
+		{
+			U32	Current = m_LastTetrahedron;
+			U32	MaxSteps = m_Tetrahedra.GetCount();
+			for ( U32 Step=0; Step < MaxSteps; Step++ )
+			{
+				const BuildTetrahedron&	T = m_Tetrahedra[Current];
+				U32	Next = Tetrahedralization::INVALID_INDEX;
+				for ( U32 i=0; i < 4; i++ )
+				{
+					U32	FaceIndex = (i + Step) & 3;	// Rotate the first tested face so the walk can't cycle forever
+					if ( OrientReplaced( T, FaceIndex, _P ) < 0.0 )
+					{
+						Next = T.pNeighbors[FaceIndex];
+						break;
+					}
+				}
+				if ( Next == Tetrahedralization::INVALID_INDEX )
+					return Current;
+
+				Current = Next;
+			}
+
+			// The walk failed, look for any tetrahedron that will be in the cavity
+			for ( U32 TetrahedronIndex=0; TetrahedronIndex < U32(m_Tetrahedra.GetCount()); TetrahedronIndex++ )
+				if ( m_Tetrahedra[TetrahedronIndex].bAlive && InSphere( m_Tetrahedra[TetrahedronIndex], _P ) )
+					return TetrahedronIndex;
+
+			return Tetrahedralization::INVALID_INDEX;
+		}
+
+		// Returns false if the point couldn't be inserted
+		bool	Insert( U32 _PointIndex )
+		{
+			const double*	P = Point( _PointIndex );
+			U32	Start = Locate( P );
+			if ( Start == Tetrahedralization::INVALID_INDEX )
+				return false;
+
+			//////////////////////////////////////////////////////////////////////////
+			// Flood the tetrahedra whose circumsphere contains the point
+			m_Mark++;
+			m_Cavity.Clear();
+			m_Cavity.Append( Start );
+			m_Tetrahedra[Start].Mark = m_Mark;
+			for ( U32 CavityIndex=0; CavityIndex < U32(m_Cavity.GetCount()); CavityIndex++ )
+			{
+				const BuildTetrahedron&	T = m_Tetrahedra[m_Cavity[CavityIndex]];
+				for ( int FaceIndex=0; FaceIndex < 4; FaceIndex++ )
+				{
+					U32	Neighbor = T.pNeighbors[FaceIndex];
+					if ( Neighbor == Tetrahedralization::INVALID_INDEX )
+						continue;
+
+					BuildTetrahedron&	N = m_Tetrahedra[Neighbor];
+					if ( N.Mark == m_Mark || !InSphere( N, P ) )
+						continue;
+
+					N.Mark = m_Mark;
+					m_Cavity.Append( Neighbor );
+				}
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			// Collect the faces of the cavity's boundary
+			// With rounding errors the cavity may not be star-shaped from the point, in which case we grow it across
+			//	the faces the point doesn't see (the result is then not exactly Delaunay but still a valid tetrahedralization)
+			bool	bExpanded = true;
+			while ( bExpanded )
+			{
+				bExpanded = false;
+				m_Faces.Clear();
+				for ( U32 CavityIndex=0; CavityIndex < U32(m_Cavity.GetCount()); CavityIndex++ )
+				{
+					U32		TetrahedronIndex = m_Cavity[CavityIndex];
+					for ( U32 FaceIndex=0; FaceIndex < 4; FaceIndex++ )
+					{
+						const BuildTetrahedron&	T = m_Tetrahedra[TetrahedronIndex];
+						U32	Neighbor = T.pNeighbors[FaceIndex];
+						if ( Neighbor != Tetrahedralization::INVALID_INDEX && m_Tetrahedra[Neighbor].Mark == m_Mark )
+							continue;	// Inside the cavity
+
+						if ( OrientReplaced( T, FaceIndex, P ) <= m_OrientEpsilon )
+						{
+							if ( Neighbor == Tetrahedralization::INVALID_INDEX )
+								return false;	// Outside of the enclosing tetrahedron
+
+							m_Tetrahedra[Neighbor].Mark = m_Mark;
+							m_Cavity.Append( Neighbor );
+							bExpanded = true;
+							continue;
+						}
+
+						BoundaryFace&	F = m_Faces.Append();
+						memcpy( F.pVertices, T.pVertices, 4*sizeof(U32) );
+						F.pVertices[FaceIndex] = _PointIndex;
+						F.FaceIndex = FaceIndex;
+						F.Neighbor = Neighbor;
+						F.NeighborFace = Tetrahedralization::INVALID_INDEX;
+						if ( Neighbor != Tetrahedralization::INVALID_INDEX )
+						{
+							const BuildTetrahedron&	N = m_Tetrahedra[Neighbor];
+							for ( U32 NeighborFace=0; NeighborFace < 4; NeighborFace++ )
+								if ( N.pNeighbors[NeighborFace] == TetrahedronIndex )
+									F.NeighborFace = NeighborFace;
+						}
+					}
+				}
+			}
+
+			//////////////////////////////////////////////////////////////////////////
+			// Replace the cavity by the tetrahedra joining its boundary faces to the point
+			for ( U32 CavityIndex=0; CavityIndex < U32(m_Cavity.GetCount()); CavityIndex++ )
+			{
+				m_Tetrahedra[m_Cavity[CavityIndex]].bAlive = false;
+				m_FreeTetrahedra.Append( m_Cavity[CavityIndex] );
+			}
+
+			m_Edges.Clear();
+			for ( U32 FaceIndex=0; FaceIndex < U32(m_Faces.GetCount()); FaceIndex++ )
+			{
+				BoundaryFace&	F = m_Faces[FaceIndex];
+				F.NewTetrahedron = Allocate( F.pVertices );
+
+				// Link with the tetrahedron outside of the cavity
+				m_Tetrahedra[F.NewTetrahedron].pNeighbors[F.FaceIndex] = F.Neighbor;
+				if ( F.Neighbor != Tetrahedralization::INVALID_INDEX )
+					m_Tetrahedra[F.Neighbor].pNeighbors[F.NeighborFace] = F.NewTetrahedron;
+
+				// The 3 other faces contain the point and an edge of the boundary face, shared with exactly one other new tetrahedron
+				for ( U32 OppositeVertex=0; OppositeVertex < 4; OppositeVertex++ )
+				{
+					if ( OppositeVertex == F.FaceIndex )
+						continue;
+
+					U32	pEdge[2];
+					U32	EdgeVerticesCount = 0;
+					for ( U32 i=0; i < 4; i++ )
+						if ( i != OppositeVertex && i != F.FaceIndex )
+							pEdge[EdgeVerticesCount++] = F.pVertices[i];
+					if ( pEdge[0] > pEdge[1] )
+					{
+						U32	Temp = pEdge[0];
+						pEdge[0] = pEdge[1];
+						pEdge[1] = Temp;
+					}
+
+					U32	EdgeIndex = 0;
+					for ( ; EdgeIndex < U32(m_Edges.GetCount()); EdgeIndex++ )
+						if ( m_Edges[EdgeIndex].pVertices[0] == pEdge[0] && m_Edges[EdgeIndex].pVertices[1] == pEdge[1] )
+							break;
+
+					if ( EdgeIndex < U32(m_Edges.GetCount()) )
+					{	// Found the other side
+						const CavityEdge&	E = m_Edges[EdgeIndex];
+						m_Tetrahedra[F.NewTetrahedron].pNeighbors[OppositeVertex] = E.Tetrahedron;
+						m_Tetrahedra[E.Tetrahedron].pNeighbors[E.FaceIndex] = F.NewTetrahedron;
+						m_Edges.RemoveSwap( EdgeIndex );
+					}
+					else
+					{
+						CavityEdge&	E = m_Edges.Append();
+						E.pVertices[0] = pEdge[0];
+						E.pVertices[1] = pEdge[1];
+						E.Tetrahedron = F.NewTetrahedron;
+						E.FaceIndex = OppositeVertex;
+					}
+				}
+			}
+			ASSERT( m_Edges.GetCount() == 0, "The boundary of the cavity isn't closed!" );
+
+			m_LastTetrahedron = m_Faces[0].NewTetrahedron;
+			return true;
+		}
+	};
+}
+
+Tetrahedralization::Tetrahedralization()
+	: m_PointsCount( 0 )
+{
+}
+
+Tetrahedralization::~Tetrahedralization()
+{
+	Exit();
+}
+
+void	Tetrahedralization::Init( const float3* _pPoints, U32 _PointsCount )
+{
+	Exit();
+	m_PointsCount = _PointsCount;
+	if ( _PointsCount < 4 )
+		return;
+
+	//////////////////////////////////////////////////////////////////////////
+	// Copy the points in double precision with a tiny jitter that breaks the co-planar & co-spherical configurations
+	float3	Min = _pPoints[0];
+	float3	Max = _pPoints[0];
+	for ( U32 PointIndex=1; PointIndex < _PointsCount; PointIndex++ )
+	{
+		Min = Min.Min( _pPoints[PointIndex] );
+		Max = Max.Max( _pPoints[PointIndex] );
+	}
+	double	Size = MAX( 1e-3, double( (Max - Min).Max() ) );
+	double	JitterAmplitude = 1e-4 * Size;
+
+	double*	pPoints = new double[3*(_PointsCount+4)];
+	U32		Seed = 1;
+	for ( U32 PointIndex=0; PointIndex < _PointsCount; PointIndex++ )
+	{
+		pPoints[3*PointIndex+0] = _pPoints[PointIndex].x + JitterAmplitude * Jitter( Seed );
+		pPoints[3*PointIndex+1] = _pPoints[PointIndex].y + JitterAmplitude * Jitter( Seed );
+		pPoints[3*PointIndex+2] = _pPoints[PointIndex].z + JitterAmplitude * Jitter( Seed );
+	}
+
+	// The 4 last points are the vertices of a regular tetrahedron much larger than the points' bounding sphere
+	double	pCenter[3] = { 0.5 * (Min.x + Max.x), 0.5 * (Min.y + Max.y), 0.5 * (Min.z + Max.z) };
+	double	SuperRadius = 3.0 * 100.0 * Size;	// The inner radius of a regular tetrahedron is a third of its outer radius
+	static const double	ppCorners[4][3] = { { 1, 1, 1 }, { 1, -1, -1 }, { -1, 1, -1 }, { -1, -1, 1 } };
+	for ( int CornerIndex=0; CornerIndex < 4; CornerIndex++ )
+		for ( int i=0; i < 3; i++ )
+			pPoints[3*(_PointsCount+CornerIndex)+i] = pCenter[i] + SuperRadius * ppCorners[CornerIndex][i] / sqrt( 3.0 );
+
+	//////////////////////////////////////////////////////////////////////////
+	// Insert the points one by one
+	DelaunayBuilder	Builder( pPoints, 1e-12 * Size*Size*Size );
+	Builder.m_Tetrahedra.Reserve( 8 * _PointsCount );
+
+	U32	pSuperVertices[4] = { _PointsCount, _PointsCount+1, _PointsCount+2, _PointsCount+3 };
+	if ( Orient( Builder.Point( pSuperVertices[0] ), Builder.Point( pSuperVertices[1] ), Builder.Point( pSuperVertices[2] ), Builder.Point( pSuperVertices[3] ) ) < 0.0 )
+	{
+		pSuperVertices[2] = _PointsCount+3;
+		pSuperVertices[3] = _PointsCount+2;
+	}
+	Builder.Allocate( pSuperVertices );
+
+	for ( U32 PointIndex=0; PointIndex < _PointsCount; PointIndex++ )
+	{
+		bool	bInserted = Builder.Insert( PointIndex );
+		ASSERT( bInserted, "Failed to insert a point in the tetrahedralization!" );
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+	// Keep the tetrahedra that don't touch the enclosing tetrahedron
+	U32		BuildCount = Builder.m_Tetrahedra.GetCount();
+	U32*	pRemap = new U32[BuildCount];
+	U32		KeptCount = 0;
+	for ( U32 TetrahedronIndex=0; TetrahedronIndex < BuildCount; TetrahedronIndex++ )
+	{
+		const DelaunayBuilder::BuildTetrahedron&	T = Builder.m_Tetrahedra[TetrahedronIndex];
+		bool	bKeep = T.bAlive;
+		for ( int i=0; i < 4; i++ )
+			bKeep &= T.pVertices[i] < _PointsCount;
+		pRemap[TetrahedronIndex] = bKeep ? KeptCount++ : INVALID_INDEX;
+	}
+
+	m_Tetrahedra.Init( KeptCount );
+	m_Barycentrics.Init( KeptCount );
+	m_PointTetrahedra.Init( _PointsCount );
+	for ( U32 PointIndex=0; PointIndex < _PointsCount; PointIndex++ )
+		m_PointTetrahedra.Append( INVALID_INDEX );
+	for ( U32 TetrahedronIndex=0; TetrahedronIndex < BuildCount; TetrahedronIndex++ )
+	{
+		if ( pRemap[TetrahedronIndex] == INVALID_INDEX )
+			continue;
+
+		const DelaunayBuilder::BuildTetrahedron&	T = Builder.m_Tetrahedra[TetrahedronIndex];
+		Tetrahedron&	Target = m_Tetrahedra.Append();
+		for ( int i=0; i < 4; i++ )
+		{
+			Target.pVertices[i] = T.pVertices[i];
+			Target.pNeighbors[i] = T.pNeighbors[i] != INVALID_INDEX ? pRemap[T.pNeighbors[i]] : INVALID_INDEX;
+			m_PointTetrahedra[T.pVertices[i]] = pRemap[TetrahedronIndex];
+		}
+
+		// Invert the matrix whose columns are the 3 first vertices relative to the last one
+		//	(using the jittered positions the tetrahedra were built with so none of them is flat)
+		const double*	d = Builder.Point( T.pVertices[3] );
+		double	a[3], b[3], c[3];
+		Sub( Builder.Point( T.pVertices[0] ), d, a );
+		Sub( Builder.Point( T.pVertices[1] ), d, b );
+		Sub( Builder.Point( T.pVertices[2] ), d, c );
+
+		double	ppRows[3][3];
+		Cross( b, c, ppRows[0] );
+		Cross( c, a, ppRows[1] );
+		Cross( a, b, ppRows[2] );
+		double	InvDet = 1.0 / Dot( a, ppRows[0] );
+
+		Barycentrics&	B = m_Barycentrics.Append();
+		for ( int RowIndex=0; RowIndex < 3; RowIndex++ )
+		{
+			double*	pRow = ppRows[RowIndex];
+			pRow[0] *= InvDet;
+			pRow[1] *= InvDet;
+			pRow[2] *= InvDet;
+			B.pRows[RowIndex] = float4( float(pRow[0]), float(pRow[1]), float(pRow[2]), float(-Dot( pRow, d )) );
+		}
+	}
+
+	delete[] pRemap;
+	delete[] pPoints;
+}
+
+void	Tetrahedralization::Exit()
+{
+	m_PointsCount = 0;
+	m_Tetrahedra.Clear();
+	m_Barycentrics.Clear();
+	m_PointTetrahedra.Clear();
+}
+
+U32		Tetrahedralization::FindTetrahedron( const float3& _Position, U32 _StartTetrahedron, float4& _Weights ) const
+{
+	U32	TetrahedraCount = m_Tetrahedra.GetCount();
+	if ( TetrahedraCount == 0 )
+	{
+		_Weights = float4( 0, 0, 0, 0 );
+		return INVALID_INDEX;
+	}
+
+	U32	Current = _StartTetrahedron < TetrahedraCount ? _StartTetrahedron : 0;
+	for ( U32 Step=0; Step < MAX_WALK_STEPS; Step++ )
+	{
+		ComputeWeights( Current, _Position, _Weights );
+
+		// Cross the face opposite the most negative weight
+		U32		FaceIndex = 0;
+		float	MinWeight = _Weights.x;
+		if ( _Weights.y < MinWeight ) { MinWeight = _Weights.y; FaceIndex = 1; }
+		if ( _Weights.z < MinWeight ) { MinWeight = _Weights.z; FaceIndex = 2; }
+		if ( _Weights.w < MinWeight ) { MinWeight = _Weights.w; FaceIndex = 3; }
+		if ( MinWeight >= -1e-5f )
+			return Current;	// Inside
+
+		U32	Next = m_Tetrahedra[Current].pNeighbors[FaceIndex];
+		if ( Next == INVALID_INDEX )
+			break;	// Outside of the hull
+
+		Current = Next;
+	}
+
+	// Outside (or the walk gave up): keep the blend of the nearest tetrahedron found
+	_Weights = _Weights.Max( float4( 0, 0, 0, 0 ) );
+	_Weights = _Weights / (_Weights.x + _Weights.y + _Weights.z + _Weights.w);	// The sum is at least 1 since the weights summed to 1 before clamping
+
+	return Current;
+}
+
+void	Tetrahedralization::ComputeWeights( U32 _TetrahedronIndex, const float3& _Position, float4& _Weights ) const
+{
+	const Barycentrics&	B = m_Barycentrics[_TetrahedronIndex];
+	float4	P( _Position, 1.0f );
+	_Weights.x = B.pRows[0] | P;
+	_Weights.y = B.pRows[1] | P;
+	_Weights.z = B.pRows[2] | P;
+	_Weights.w = 1.0f - _Weights.x - _Weights.y - _Weights.z;
+}
@@ -0,0 +1,80 @@
+//////////////////////////////////////////////////////////////////////////
+// Delaunay tetrahedralization of a static set of points, used to interpolate values stored at the points (e.g. light probes)
+//
+// The tetrahedra are built by incremental Bowyer-Watson insertion into a huge enclosing tetrahedron that is removed afterward.
+// Each tetrahedron stores its 4 vertices, the tetrahedron across the face opposite each vertex and the matrix giving the
+//	barycentric coordinates of any position, so a query walks from a known tetrahedron toward the position by crossing
+//	the face of the most negative barycentric coordinate: starting from the tetrahedron found last time a moving object
+//	is only ever a step or two away from its new tetrahedron.
+// Tetrahedra & barycentric matrices are stored in flat arrays that can be mirrored as-is in GPU buffers (cf. Inc/ProbeTetrahedra.hlsl).
+//
+// Usage:
+//	Tetrahedralization	Tetras;
+//	Tetras.Init( pPositions, PositionsCount );
+//	(...)
+//	float4	Weights;
+//	m_TetrahedronHint = Tetras.FindTetrahedron( ObjectPosition, m_TetrahedronHint, Weights );	// Keep the hint for the next query
+//	const Tetrahedralization::Tetrahedron&	T = Tetras.GetTetrahedra()[m_TetrahedronHint];
+//	Value = Weights.x * pValues[T.pVertices[0]] + Weights.y * pValues[T.pVertices[1]] + ...
+//
+// NOTE: The points are slightly jittered before insertion so the regular grids of points (that are degenerate for Delaunay)
+//	still yield valid tetrahedra. Less than 4 non-coplanar points yield no tetrahedron at all.
+//
+#pragma once
+
+#include "../NuajAPI/API/List.h"
+
+class	Tetrahedralization
+{
+public:		// CONSTANTS
+
+	static const U32	INVALID_INDEX = ~0U;
+	static const U32	MAX_WALK_STEPS = 256;	// The walk gives up after that many steps (!!IMPORTANT ==> Must correspond to MAX_WALK_STEPS in Inc/ProbeTetrahedra.hlsl!!)
+
+public:		// NESTED TYPES
+
+	struct	Tetrahedron
+	{
+		U32		pVertices[4];		// Indices of the 4 points
+		U32		pNeighbors[4];		// Index of the tetrahedron across the face opposite each vertex, INVALID_INDEX on the hull
+	};
+
+	// (w0, w1, w2) = (dot( pRows[0], P1 ), dot( pRows[1], P1 ), dot( pRows[2], P1 )) with P1 = float4( Position, 1 ), and w3 = 1 - w0 - w1 - w2
+	struct	Barycentrics
+	{
+		float4	pRows[3];
+	};
+
+protected:	// FIELDS
+
+	U32					m_PointsCount;
+	List<Tetrahedron>	m_Tetrahedra;
+	List<Barycentrics>	m_Barycentrics;
+	List<U32>			m_PointTetrahedra;		// A tetrahedron using each point, INVALID_INDEX if the point isn't used by any
+
+public:		// PROPERTIES
+
+	U32					GetPointsCount() const			{ return m_PointsCount; }
+	U32					GetTetrahedraCount() const		{ return m_Tetrahedra.GetCount(); }
+	const Tetrahedron*	GetTetrahedra() const			{ return m_Tetrahedra.GetCount() > 0 ? &m_Tetrahedra[0] : NULL; }
+	const Barycentrics*	GetBarycentrics() const			{ return m_Barycentrics.GetCount() > 0 ? &m_Barycentrics[0] : NULL; }
+	const U32*			GetPointTetrahedra() const		{ return m_PointTetrahedra.GetCount() > 0 ? &m_PointTetrahedra[0] : NULL; }	// Good starting points for FindTetrahedron() given the nearest point
+
+public:		// METHODS
+
+	Tetrahedralization();
+	~Tetrahedralization();
+
+	// Builds the tetrahedralization of the provided points
+	void				Init( const float3* _pPoints, U32 _PointsCount );
+	void				Exit();
+
+	// Returns the index of the tetrahedron containing the provided position by walking from _StartTetrahedron (any value works,
+	//	INVALID_INDEX included) and writes the barycentric weights of its 4 vertices, or returns INVALID_INDEX if there are no tetrahedra
+	// Outside of the tetrahedralization, returns the tetrahedron of the hull the walk came out of with its weights clamped to [0,1]
+	//	and normalized, so the values blend smoothly when objects leave the volume covered by the points
+	U32					FindTetrahedron( const float3& _Position, U32 _StartTetrahedron, float4& _Weights ) const;
+
+	// Writes the barycentric weights of the provided position within a tetrahedron (they're negative outside of it)
+	void				ComputeWeights( U32 _TetrahedronIndex, const float3& _Position, float4& _Weights ) const;
+};
@@ -0,0 +1,73 @@
+#include "../GodComplex.h"
+
+TextureArrayPacker::TextureArrayPacker( Device& _Device )
+	: m_Device( _Device )
+{
+}
+
+TextureArrayPacker::~TextureArrayPacker()
+{
+	for ( int SourceIndex=0; SourceIndex < m_Sources.GetCount(); SourceIndex++ )
+		delete m_Sources[SourceIndex];
+	for ( int ArrayIndex=0; ArrayIndex < m_Arrays.GetCount(); ArrayIndex++ )
+		delete m_Arrays[ArrayIndex];
+}
+
+int		TextureArrayPacker::Add( const char* _pFileName )
+{
+	ASSERT( m_Sources.GetCount() == m_Slots.GetCount(), "Textures can't be added once the arrays are built!" );
+
+	TextureFilePOM*	pPOM = new TextureFilePOM( _pFileName );
+	ASSERT( pPOM->m_Type == TextureFilePOM::TEX_2D && pPOM->m_ArraySizeOrDepth == 1, "Only single 2D textures can be packed!" );
+
+	// The arrays compute the pitches of their content themselves
+	int	BlockSize = pPOM->m_pPixelFormat->BlockSize();
+	ASSERT( pPOM->m_pMipsDescriptors == NULL || pPOM->m_pMipsDescriptors[0].RowPitch == ((pPOM->m_Width+BlockSize-1) / BlockSize) * pPOM->m_pPixelFormat->Size(), "Textures with padded rows can't be packed!" );
+
+	m_Sources.Append( pPOM );
+	m_Slots.Append( INVALID_SLOT );
+	return m_Slots.GetCount()-1;
+}
+
+void	TextureArrayPacker::Build()
+{
+	int	SourcesCount = m_Sources.GetCount();
+
+	List<int>			SliceSources( SourcesCount );	// Textures of the array being built
+	List<const void*>	Content;
+	for ( int FirstIndex=0; FirstIndex < SourcesCount; FirstIndex++ )
+	{
+		if ( m_Slots[FirstIndex] != INVALID_SLOT )
+			continue;	// Already packed with a previous texture of its class
+
+		// Gather the textures of the same class
+		const TextureFilePOM&	First = *m_Sources[FirstIndex];
+		U32	ArrayIndex = m_Arrays.GetCount();
+
+		SliceSources.Clear();
+		for ( int SourceIndex=FirstIndex; SourceIndex < SourcesCount && SliceSources.GetCount() < MAX_ARRAY_SIZE; SourceIndex++ )
+			if ( m_Slots[SourceIndex] == INVALID_SLOT && IsSameClass( First, *m_Sources[SourceIndex] ) )
+			{
+				m_Slots[SourceIndex] = (ArrayIndex << 16) | U32(SliceSources.GetCount());
+				SliceSources.Append( SourceIndex );
+			}
+
+		// The content is given slice after slice, each slice giving all its mips
+		Content.Clear();
+		for ( int SliceIndex=0; SliceIndex < SliceSources.GetCount(); SliceIndex++ )
+			Content.AppendRange( (const void* const*) m_Sources[SliceSources[SliceIndex]]->m_ppContent, First.m_MipsCount );
+
+		m_Arrays.Append( new Texture2D( m_Device, First.m_Width, First.m_Height, SliceSources.GetCount(), *First.m_pPixelFormat, First.m_MipsCount, &Content[0] ) );
+	}
+
+	// The content was copied by the arrays' creation
+	for ( int SourceIndex=0; SourceIndex < SourcesCount; SourceIndex++ )
+		delete m_Sources[SourceIndex];
+	m_Sources.Clear();
+}
+
+// The slices of an array must have the same format, size & mips count
+bool	TextureArrayPacker::IsSameClass( const TextureFilePOM& _A, const TextureFilePOM& _B ) const
+{
+	return _A.m_pPixelFormat == _B.m_pPixelFormat && _A.m_Width == _B.m_Width && _A.m_Height == _B.m_Height && _A.m_MipsCount == _B.m_MipsCount;
+}
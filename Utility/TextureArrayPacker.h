@@ -0,0 +1,61 @@
+//////////////////////////////////////////////////////////////////////////
+// Packs a set of POM textures into as few Texture2DArrays as possible
+// Textures sharing the same format, size and mips count become the slices of the same array, so a shader given all the
+//	arrays at once can sample any of the textures from its slot (array index & slice) without rebinding anything.
+//
+// Usage:
+//	TextureArrayPacker	Packer( Device );
+//	int	DiffuseIndex = Packer.Add( "Diffuse.pom" );		// The files are kept loaded until Build()
+//	(...)
+//	Packer.Build();
+//	U32	Slot = Packer.GetSlot( DiffuseIndex );			// Give it to the shader (cf. Inc/MaterialTextureArrays.hlsl)
+//	for ( int ArrayIndex=0; ArrayIndex < Packer.GetArraysCount(); ArrayIndex++ )
+//		Packer.GetArray( ArrayIndex ).SetPS( FirstSlot + ArrayIndex, false, Packer.GetArray( ArrayIndex ).GetSRV( 0, 0, 0, 0, true ) );
+//
+// NOTE: The arrays are immutable, streaming textures are not supported.
+// Arrays of a single slice must be bound with a view created with _AsArray or they're seen as simple Texture2D.
+//
+#pragma once
+
+#include "../NuajAPI/API/List.h"
+
+class	TextureArrayPacker
+{
+public:		// CONSTANTS
+
+	static const int	MAX_ARRAY_SIZE = 2048;		// D3D11_REQ_TEXTURE2D_ARRAY_AXIS_DIMENSION, larger groups are split into several arrays
+	static const U32	INVALID_SLOT = ~0U;
+
+protected:	// FIELDS
+
+	Device&					m_Device;
+	List<TextureFilePOM*>	m_Sources;				// Loaded textures waiting for Build()
+	List<U32>				m_Slots;				// Slot of each texture
+	List<Texture2D*>		m_Arrays;
+
+public:		// PROPERTIES
+
+	int					GetTexturesCount() const			{ return m_Slots.GetCount(); }
+	int					GetArraysCount() const				{ return m_Arrays.GetCount(); }
+	Texture2D&			GetArray( int _ArrayIndex ) const	{ return *m_Arrays[_ArrayIndex]; }
+
+	// Returns the slot of a texture (only valid after Build()), (ArrayIndex << 16) | SliceIndex
+	U32					GetSlot( int _TextureIndex ) const	{ return m_Slots[_TextureIndex]; }
+	static int			GetSlotArray( U32 _Slot )			{ return int( _Slot >> 16 ); }
+	static int			GetSlotSlice( U32 _Slot )			{ return int( _Slot & 0xFFFF ); }
+
+public:		// METHODS
+
+	TextureArrayPacker( Device& _Device );
+	~TextureArrayPacker();
+
+	// Loads a 2D texture and returns its index
+	int					Add( const char* _pFileName );
+
+	// Creates the arrays and releases the loaded files
+	void				Build();
+
+protected:
+
+	bool				IsSameClass( const TextureFilePOM& _A, const TextureFilePOM& _B ) const;
+};
@@ -5,23 +5,31 @@
 #include <stdio.h>
 
 TextureFilePOM::TextureFilePOM()
-	: m_Width( 0 )
+	: m_Type( TEX_2D )
+	, m_Width( 0 )
 	, m_Height( 0 )
 	, m_ArraySizeOrDepth( 0 )
 	, m_MipsCount( 0 )
 	, m_pPixelFormat( NULL )
 	, m_ppContent( NULL )
 	, m_pMipsDescriptors( NULL )
+	, m_hFile( NULL )
+	, m_hMapping( NULL )
+	, m_pMappedView( NULL )
 {
 }
 TextureFilePOM::TextureFilePOM( const char* _pFileName )
-	: m_Width( 0 )
+	: m_Type( TEX_2D )
+	, m_Width( 0 )
 	, m_Height( 0 )
 	, m_ArraySizeOrDepth( 0 )
 	, m_MipsCount( 0 )
 	, m_pPixelFormat( NULL )
 	, m_ppContent( NULL )
 	, m_pMipsDescriptors( NULL )
+	, m_hFile( NULL )
+	, m_hMapping( NULL )
+	, m_pMappedView( NULL )
 {
 	Load( _pFileName );
 }
@@ -31,7 +39,7 @@ TextureFilePOM::~TextureFilePOM()
 	ReleasContent();
 }
 
-void	TextureFilePOM::Load( const char* _pFileName )
+void	TextureFilePOM::Load( const char* _pFileName, int _FirstMipIndex, int _MipsCount )
 {
 	ReleasContent();
 
@@ -42,9 +50,11 @@ void	TextureFilePOM::Load( const char* _pFileName )
 		return;
 
 	// Read the type and format
-	U8		Format;
-	fread_s( &m_Type, sizeof(U8), sizeof(U8), 1, pFile );
+	U8		Type, Format;
+	fread_s( &Type, sizeof(U8), sizeof(U8), 1, pFile );
 	fread_s( &Format, sizeof(U8), sizeof(U8), 1, pFile );
+	bool	bVersion2 = (Type & POM_V2) != 0;
+	m_Type = TEXTURE_TYPE( Type & ~POM_V2 );
 	DXGI_FORMAT	PixelFormat = DXGI_FORMAT( Format );
 
 	switch ( PixelFormat )
@@ -70,10 +80,21 @@ void	TextureFilePOM::Load( const char* _pFileName )
 	fread_s( &m_ArraySizeOrDepth, sizeof(U32), sizeof(U32), 1, pFile );
 	fread_s( &m_MipsCount, sizeof(U32), sizeof(U32), 1, pFile );
 
-	int	ContentBuffersCount = m_Type == TEX_3D ? m_MipsCount : m_MipsCount*m_ArraySizeOrDepth;
+	int	ContentBuffersCount = GetContentBuffersCount();
 	m_ppContent = new void*[ContentBuffersCount];
+	memset( m_ppContent, 0, ContentBuffersCount*sizeof(void*) );
 	m_pMipsDescriptors = new MipDescriptor[m_MipsCount];
 
+	int	LastMipIndex = _MipsCount < 0 ? m_MipsCount : MIN( m_MipsCount, _FirstMipIndex + _MipsCount );
+
+	if ( bVersion2 )
+	{	// Read the mip descriptors then point into the mapped file
+		fread_s( m_pMipsDescriptors, m_MipsCount*sizeof(MipDescriptor), sizeof(MipDescriptor), m_MipsCount, pFile );
+		fclose( pFile );
+		LoadMapped( _pFileName, _FirstMipIndex, LastMipIndex );
+		return;
+	}
+
 	// Read each mip
 	int	Depth = m_ArraySizeOrDepth;
 	for ( int MipLevelIndex=0; MipLevelIndex < m_MipsCount; MipLevelIndex++ )
@@ -81,7 +102,12 @@ void	TextureFilePOM::Load( const char* _pFileName )
 		fread_s( &m_pMipsDescriptors[MipLevelIndex].RowPitch, sizeof(U32), sizeof(U32), 1, pFile );
 		fread_s( &m_pMipsDescriptors[MipLevelIndex].DepthPitch, sizeof(U32), sizeof(U32), 1, pFile );
 
-		if ( m_Type != TEX_3D )
+		if ( MipLevelIndex < _FirstMipIndex || MipLevelIndex >= LastMipIndex )
+		{	// Skip that mip
+			int	MipSize = m_pMipsDescriptors[MipLevelIndex].DepthPitch * (m_Type != TEX_3D ? m_ArraySizeOrDepth : Depth);
+			fseek( pFile, MipSize, SEEK_CUR );
+		}
+		else if ( m_Type != TEX_3D )
 		{
 			for ( int SliceIndex=0; SliceIndex < m_ArraySizeOrDepth; SliceIndex++ )
 			{
@@ -109,8 +135,9 @@ void	TextureFilePOM::Save( const char* _pFileName )
 	ASSERT( pFile != NULL, "Can't create file!" );
 
 	// Write the type and format
+	U8		Type = U8(m_Type) | POM_V2;
 	U8		Format = U32(m_pPixelFormat->DirectXFormat()) & 0xFF;
-	fwrite( &m_Type, sizeof(U8), 1, pFile );
+	fwrite( &Type, sizeof(U8), 1, pFile );
 	fwrite( &Format, sizeof(U8), 1, pFile );
 
 	// Write the dimensions
@@ -118,29 +145,124 @@ void	TextureFilePOM::Save( const char* _pFileName )
 	fwrite( &m_Height, sizeof(U32), 1, pFile );
 	fwrite( &m_ArraySizeOrDepth, sizeof(U32), 1, pFile );
 	fwrite( &m_MipsCount, sizeof(U32), 1, pFile );
+	fwrite( m_pMipsDescriptors, sizeof(MipDescriptor), m_MipsCount, pFile );
 
-	// Write each mip
-	int	Depth = m_ArraySizeOrDepth;
+	// Build the content table, the slices of a mip are stored contiguously so a streamed mip is read in one go
+	int				ContentBuffersCount = GetContentBuffersCount();
+	int				SlicesCount = m_Type == TEX_3D ? 1 : m_ArraySizeOrDepth;
+	ContentEntry*	pEntries = new ContentEntry[ContentBuffersCount];
+	U32				Offset = 2*sizeof(U8) + 4*sizeof(U32) + m_MipsCount*sizeof(MipDescriptor) + ContentBuffersCount*sizeof(ContentEntry);
 	for ( int MipLevelIndex=0; MipLevelIndex < m_MipsCount; MipLevelIndex++ )
-	{
-		fwrite( &m_pMipsDescriptors[MipLevelIndex].RowPitch, sizeof(U32), 1, pFile );
-		fwrite( &m_pMipsDescriptors[MipLevelIndex].DepthPitch, sizeof(U32), 1, pFile );
-
-		if ( m_Type != TEX_3D )
+		for ( int SliceIndex=0; SliceIndex < SlicesCount; SliceIndex++ )
 		{
-			for ( int SliceIndex=0; SliceIndex < m_ArraySizeOrDepth; SliceIndex++ )
-				fwrite( m_ppContent[MipLevelIndex+m_MipsCount*SliceIndex], m_pMipsDescriptors[MipLevelIndex].DepthPitch, 1, pFile );
+			ContentEntry&	Entry = pEntries[MipLevelIndex+m_MipsCount*SliceIndex];
+			Offset = (Offset + POM_ALIGNMENT-1) & ~(POM_ALIGNMENT-1);
+			Entry.Offset = Offset;
+			Entry.Size = GetContentSize( MipLevelIndex+m_MipsCount*SliceIndex );
+			Entry.Compression = COMPRESSION_NONE;
+			Offset += Entry.Size;
 		}
-		else
-			fwrite( m_ppContent[MipLevelIndex], Depth * m_pMipsDescriptors[MipLevelIndex].DepthPitch, 1, pFile );
+	fwrite( pEntries, sizeof(ContentEntry), ContentBuffersCount, pFile );
 
-		Depth = MAX( 1, Depth >> 1 );
-	}
+	// Write each mip's payloads
+	static const U8	pPadding[POM_ALIGNMENT] = { 0 };
+	for ( int MipLevelIndex=0; MipLevelIndex < m_MipsCount; MipLevelIndex++ )
+		for ( int SliceIndex=0; SliceIndex < SlicesCount; SliceIndex++ )
+		{
+			const ContentEntry&	Entry = pEntries[MipLevelIndex+m_MipsCount*SliceIndex];
+			fwrite( pPadding, 1, Entry.Offset - U32(ftell( pFile )), pFile );
+			fwrite( m_ppContent[MipLevelIndex+m_MipsCount*SliceIndex], Entry.Size, 1, pFile );
+		}
+	delete[] pEntries;
 
 	// We're done!
 	fclose( pFile );
 }
 
+void	TextureFilePOM::Prefetch() const
+{
+	if ( m_pMappedView == NULL )
+		return;	// Content is already in memory
+
+	volatile U8	Sum = 0;
+	int	ContentBuffersCount = GetContentBuffersCount();
+	for ( int ContentIndex=0; ContentIndex < ContentBuffersCount; ContentIndex++ )
+	{
+		const U8*	pContent = (const U8*) m_ppContent[ContentIndex];
+		if ( pContent == NULL )
+			continue;
+
+		int	Size = GetContentSize( ContentIndex );
+		for ( int Offset=0; Offset < Size; Offset+=POM_ALIGNMENT )
+			Sum += pContent[Offset];
+	}
+}
+
+void	TextureFilePOM::LoadMapped( const char* _pFileName, int _FirstMipIndex, int _LastMipIndex )
+{
+	// Read the content table that follows the header
+	int				ContentBuffersCount = GetContentBuffersCount();
+	ContentEntry*	pEntries = new ContentEntry[ContentBuffersCount];
+
+	m_hFile = CreateFileA( _pFileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL );
+	ASSERT( m_hFile != INVALID_HANDLE_VALUE, "Can't open POM file!" );
+	if ( m_hFile == INVALID_HANDLE_VALUE )
+	{
+		m_hFile = NULL;
+		delete[] pEntries;
+		return;
+	}
+	m_hMapping = CreateFileMappingA( m_hFile, NULL, PAGE_READONLY, 0, 0, NULL );
+	ASSERT( m_hMapping != NULL, "Can't map POM file!" );
+	if ( m_hMapping != NULL )
+		m_pMappedView = (U8*) MapViewOfFile( m_hMapping, FILE_MAP_READ, 0, 0, 0 );
+	ASSERT( m_pMappedView != NULL, "Can't map POM file!" );
+	if ( m_pMappedView == NULL )
+	{
+		Unmap();
+		delete[] pEntries;
+		return;
+	}
+
+	U32	TableOffset = 2*sizeof(U8) + 4*sizeof(U32) + m_MipsCount*sizeof(MipDescriptor);
+	memcpy_s( pEntries, ContentBuffersCount*sizeof(ContentEntry), m_pMappedView + TableOffset, ContentBuffersCount*sizeof(ContentEntry) );
+
+	// Point to the payloads of the requested mips, the pages are only touched once they're read
+	for ( int ContentIndex=0; ContentIndex < ContentBuffersCount; ContentIndex++ )
+	{
+		int	MipLevelIndex = ContentIndex % m_MipsCount;
+		if ( MipLevelIndex < _FirstMipIndex || MipLevelIndex >= _LastMipIndex )
+			continue;
+
+		const ContentEntry&	Entry = pEntries[ContentIndex];
+		ASSERT( Entry.Compression == COMPRESSION_NONE, "Unsupported POM compression!" );
+		ASSERT( int(Entry.Size) == GetContentSize( ContentIndex ), "Unexpected POM payload size!" );
+		m_ppContent[ContentIndex] = m_pMappedView + Entry.Offset;
+	}
+
+	delete[] pEntries;
+}
+
+int		TextureFilePOM::GetContentSize( int _ContentIndex ) const
+{
+	int	MipLevelIndex = _ContentIndex % m_MipsCount;
+	int	Depth = m_Type == TEX_3D ? MAX( 1, m_ArraySizeOrDepth >> MipLevelIndex ) : 1;
+	return Depth * m_pMipsDescriptors[MipLevelIndex].DepthPitch;
+}
+
+void	TextureFilePOM::Unmap()
+{
+	if ( m_pMappedView != NULL )
+		UnmapViewOfFile( m_pMappedView );
+	if ( m_hMapping != NULL )
+		CloseHandle( m_hMapping );
+	if ( m_hFile != NULL )
+		CloseHandle( m_hFile );
+	m_pMappedView = NULL;
+	m_hMapping = NULL;
+	m_hFile = NULL;
+}
+
 void	TextureFilePOM::AllocateContent( Texture2D& _Texture )
 {
 	ReleasContent();
@@ -178,7 +300,9 @@ void	TextureFilePOM::AllocateContent( Texture3D& _Texture )
 
 void	TextureFilePOM::ReleasContent()
 {
-	if ( m_Type != TEX_3D )
+	if ( m_pMappedView != NULL )
+		Unmap();	// Content points into the view
+	else if ( m_Type != TEX_3D )
 	{	// Release each slice in each mip
 		for ( int MipLevelIndex=0; MipLevelIndex < m_MipsCount; MipLevelIndex++ )
 			for ( int SliceIndex=0; SliceIndex < m_ArraySizeOrDepth; SliceIndex++ )
@@ -1,6 +1,11 @@
 //////////////////////////////////////////////////////////////////////////
 // Loads & saves the POM format
 //
+// Version 2 files start with a table giving the file offset and size of every mip/slice, the payloads being aligned on
+//	POM_ALIGNMENT bytes. They're loaded by memory-mapping the file so m_ppContent points straight into the mapped view:
+//	only the pages of the mips that are actually read get touched, and there's no copy of the whole file.
+// Version 1 files (no table) are still read the old way.
+//
 #pragma once
 
 #define POM_FORMAT_SUPPORT
@@ -21,12 +26,30 @@ public:		// NESTED TYPES
 		TEX_3D = 2,		// 3D
 	};
 
+	enum	COMPRESSION
+	{
+		COMPRESSION_NONE = 0,	// Only uncompressed payloads are supported for now (the field is reserved for per-mip codecs)
+	};
+
 	struct	MipDescriptor
 	{
 		int					RowPitch;
 		int					DepthPitch;
 	};
 
+	// Location of a mip/slice's payload in a version 2 file
+	struct	ContentEntry
+	{
+		U32					Offset;
+		U32					Size;				// Size in the file
+		U32					Compression;		// One of COMPRESSION
+	};
+
+public:		// CONSTANTS
+
+	static const U8			POM_V2 = 0x80;			// Flag OR'ed with the type byte of version 2 files
+	static const U32		POM_ALIGNMENT = 4096;	// Alignment of the payloads in version 2 files
+
 public:		// FIELDS
 
 	TEXTURE_TYPE			m_Type;
@@ -38,8 +61,15 @@ public:		// FIELDS
 	void**					m_ppContent;
 	MipDescriptor*			m_pMipsDescriptors;
 
+private:
+
+	void*					m_hFile;			// File & view of a mapped version 2 file (m_ppContent then points into the view)
+	void*					m_hMapping;
+	U8*						m_pMappedView;
+
 public:		// PROPERTIES
- 
+
+	bool		IsMapped() const	{ return m_pMappedView != NULL; }
 
 public:		// METHODS
 
@@ -47,8 +77,12 @@ public:		// METHODS
 	TextureFilePOM( const char* _pFileName );
 	~TextureFilePOM();
 
-	void	Load( const char* _pFileName );
-	void	Save( const char* _pFileName );
+	// Only the mips in [_FirstMipIndex,_FirstMipIndex+_MipsCount[ are read, the others are skipped and their content is NULL (cf. TextureStreamer)
+	void	Load( const char* _pFileName, int _FirstMipIndex=0, int _MipsCount=-1 );
+	void	Save( const char* _pFileName );		// Always saves a version 2 file
+
+	// Reads a byte of every page of the mapped content so it's faulted in on the calling thread (cf. TextureStreamer)
+	void	Prefetch() const;
 
 	// Used by Texture2D/Texture3D to store their mapped content
 	void	AllocateContent( Texture2D& _Texture );
@@ -56,4 +90,8 @@ public:		// METHODS
 
 private:
 	void	ReleasContent();
+	void	LoadMapped( const char* _pFileName, int _FirstMipIndex, int _LastMipIndex );
+	int		GetContentBuffersCount() const	{ return m_Type == TEX_3D ? m_MipsCount : m_MipsCount*m_ArraySizeOrDepth; }
+	int		GetContentSize( int _ContentIndex ) const;
+	void	Unmap();
 };
\ No newline at end of file
@@ -0,0 +1,181 @@
+#include "../GodComplex.h"
+
+static const float	MIN_LOG_LUMINANCE = -10.0f;			// Histogram range in log2 luminance
+static const float	MAX_LOG_LUMINANCE = 6.0f;
+static const float	DEFAULT_KEY_VALUE = 0.18f;			// Middle gray
+static const float	DEFAULT_ADAPTATION_SPEED_UP = 3.0f;	// Adapting to brighter scenes is faster than to darker scenes, as does the eye
+static const float	DEFAULT_ADAPTATION_SPEED_DOWN = 1.0f;
+static const float	DEFAULT_LOW_PERCENTILE = 0.5f;		// The darkest 50% & the brightest 2% of the pixels don't weigh in the average
+static const float	DEFAULT_HIGH_PERCENTILE = 0.98f;
+static const float	DEFAULT_WHITE_POINT = 11.2f;
+static const float	DEFAULT_PAPER_WHITE_NITS = 200.0f;
+static const float	DEFAULT_DISPLAY_MAX_NITS = 1000.0f;
+
+static const U32	LUT_BAKE_REQUIRED = ~0U;
+
+ToneMapper::ToneMapper( Device& _Device, int _Width, int _Height )
+	: m_Device( _Device )
+	, m_Width( _Width )
+	, m_Height( _Height )
+	, m_bResetAdaptation( true )
+	, m_LUTOutputEncoding( LUT_BAKE_REQUIRED )
+{
+	m_pCSHistogram = CreateComputeShader( IDR_SHADER_TONE_MAPPING, "./Resources/Shaders/ToneMapping.hlsl", "CS_Histogram" );
+	m_pCSExposure = CreateComputeShader( IDR_SHADER_TONE_MAPPING, "./Resources/Shaders/ToneMapping.hlsl", "CS_Exposure" );
+	m_pCSBakeLUT = CreateComputeShader( IDR_SHADER_TONE_MAPPING, "./Resources/Shaders/ToneMapping.hlsl", "CS_BakeLUT" );
+	m_pMatToneMap = CreateMaterial( IDR_SHADER_TONE_MAPPING, "./Resources/Shaders/ToneMapping.hlsl", VertexFormatPt4::DESCRIPTOR, "VS", NULL, "PS" );
+
+	m_pSB_Histogram = new StructuredBuffer( m_Device, sizeof(U32), HISTOGRAM_BINS_COUNT, true );
+	m_pSB_Exposure = new StructuredBuffer( m_Device, sizeof(Exposure), 1, true );
+	m_pTexLUT = new Texture3D( m_Device, LUT_SIZE, LUT_SIZE, LUT_SIZE, PixelFormatRGBA16F::DESCRIPTOR, 1, NULL, false, true );
+
+	U32	pZero[4] = { 0, 0, 0, 0 };
+	m_pSB_Histogram->Clear( pZero );	// CS_Exposure clears it after use
+
+	m_pCB_ToneMapping = new CB<CBToneMapping>( m_Device, 10 );
+	m_pCB_ToneMapping->m.TargetSizeX = m_Width;
+	m_pCB_ToneMapping->m.TargetSizeY = m_Height;
+	m_pCB_ToneMapping->m.MinLogLuminance = MIN_LOG_LUMINANCE;
+	m_pCB_ToneMapping->m.LogLuminanceRange = MAX_LOG_LUMINANCE - MIN_LOG_LUMINANCE;
+	m_pCB_ToneMapping->m.AdaptationSpeedUp = DEFAULT_ADAPTATION_SPEED_UP;
+	m_pCB_ToneMapping->m.AdaptationSpeedDown = DEFAULT_ADAPTATION_SPEED_DOWN;
+	m_pCB_ToneMapping->m.KeyValue = DEFAULT_KEY_VALUE;
+	m_pCB_ToneMapping->m.ExposureCompensation = 0.0f;
+	m_pCB_ToneMapping->m.LowPercentile = DEFAULT_LOW_PERCENTILE;
+	m_pCB_ToneMapping->m.HighPercentile = DEFAULT_HIGH_PERCENTILE;
+	m_pCB_ToneMapping->m.WhitePoint = DEFAULT_WHITE_POINT;
+	m_pCB_ToneMapping->m.PaperWhiteNits = DEFAULT_PAPER_WHITE_NITS;
+	m_pCB_ToneMapping->m.DisplayMaxNits = DEFAULT_DISPLAY_MAX_NITS;
+}
+
+ToneMapper::~ToneMapper()
+{
+	delete m_pCB_ToneMapping;
+	delete m_pTexLUT;
+	delete m_pSB_Exposure;
+	delete m_pSB_Histogram;
+	delete m_pMatToneMap;
+	delete m_pCSBakeLUT;
+	delete m_pCSExposure;
+	delete m_pCSHistogram;
+}
+
+bool	ToneMapper::HasErrors() const
+{
+	return m_pCSHistogram->HasErrors() || m_pCSExposure->HasErrors() || m_pCSBakeLUT->HasErrors() || m_pMatToneMap->HasErrors();
+}
+
+void	ToneMapper::SetExposureCompensation( float _EV )
+{
+	m_pCB_ToneMapping->m.ExposureCompensation = _EV;
+}
+
+void	ToneMapper::SetAdaptationSpeeds( float _SpeedUp, float _SpeedDown )
+{
+	m_pCB_ToneMapping->m.AdaptationSpeedUp = _SpeedUp;
+	m_pCB_ToneMapping->m.AdaptationSpeedDown = _SpeedDown;
+}
+
+void	ToneMapper::SetWhitePoint( float _WhitePoint )
+{
+	if ( _WhitePoint == m_pCB_ToneMapping->m.WhitePoint )
+		return;
+
+	m_pCB_ToneMapping->m.WhitePoint = _WhitePoint;
+	m_LUTOutputEncoding = LUT_BAKE_REQUIRED;
+}
+
+void	ToneMapper::SetDisplayNits( float _PaperWhiteNits, float _DisplayMaxNits )
+{
+	if ( _PaperWhiteNits == m_pCB_ToneMapping->m.PaperWhiteNits && _DisplayMaxNits == m_pCB_ToneMapping->m.DisplayMaxNits )
+		return;
+
+	m_pCB_ToneMapping->m.PaperWhiteNits = _PaperWhiteNits;
+	m_pCB_ToneMapping->m.DisplayMaxNits = _DisplayMaxNits;
+	m_LUTOutputEncoding = LUT_BAKE_REQUIRED;
+}
+
+void	ToneMapper::Render( float _DeltaTime, const Texture2D& _Source, const Texture2D& _Target, Primitive& _ScreenQuad )
+{
+	ASSERT( _Source.GetWidth() == m_Width && _Source.GetHeight() == m_Height, "Source doesn't have the tone mapper's resolution!" );
+
+	U32	OutputEncoding = GetOutputEncoding( _Target );
+	if ( OutputEncoding != m_LUTOutputEncoding )
+	{
+		m_pCB_ToneMapping->m.OutputEncoding = OutputEncoding;
+		if ( BakeLUT() )
+			m_LUTOutputEncoding = OutputEncoding;
+	}
+
+	m_pCB_ToneMapping->m.DeltaTime = _DeltaTime;
+	m_pCB_ToneMapping->m.ResetAdaptation = m_bResetAdaptation;
+	m_pCB_ToneMapping->UpdateData();
+	m_bResetAdaptation = false;
+
+	//////////////////////////////////////////////////////////////////////////
+	// 1] Build the luminance histogram
+	if ( m_pCSHistogram->Use() )
+	{
+		_Source.SetCS( 10 );
+		m_pSB_Histogram->SetOutput( 0 );
+
+		m_pCSHistogram->Dispatch( (m_Width+15) >> 4, (m_Height+15) >> 4, 1 );
+
+		m_Device.RemoveShaderResources( 10, 1, Device::SSF_COMPUTE_SHADER );
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+	// 2] Adapt the exposure to the histogram's average
+	if ( m_pCSExposure->Use() )
+	{
+		m_pSB_Histogram->SetOutput( 0 );
+		m_pSB_Exposure->SetOutput( 1 );
+
+		m_pCSExposure->Dispatch( 1, 1, 1 );
+	}
+	m_pSB_Histogram->RemoveFromLastAssignedSlotUAV();
+	m_pSB_Exposure->RemoveFromLastAssignedSlotUAV();
+
+	//////////////////////////////////////////////////////////////////////////
+	// 3] Tone map
+	USING_MATERIAL_START( *m_pMatToneMap )
+
+	m_Device.SetStates( m_Device.m_pRS_CullNone, m_Device.m_pDS_Disabled, m_Device.m_pBS_Disabled );
+	m_Device.SetRenderTarget( _Target );
+
+	_Source.SetPS( 10 );
+	m_pTexLUT->SetPS( 11 );
+	m_pSB_Exposure->SetInput( 12 );
+
+	_ScreenQuad.Render( M );
+
+	USING_MATERIAL_END
+
+	m_Device.RemoveShaderResources( 10, 3, Device::SSF_PIXEL_SHADER );
+}
+
+U32	ToneMapper::GetOutputEncoding( const Texture2D& _Target ) const
+{
+	if ( &_Target == &m_Device.DefaultRenderTarget() && m_Device.IsHDR10Output() )
+		return OUTPUT_HDR10;
+
+	return _Target.GetFormatDescriptor().DirectXFormat() == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB ? OUTPUT_LINEAR : OUTPUT_SRGB;
+}
+
+// The LUT only depends on the tone curve & the output encoding, not on the exposure
+bool	ToneMapper::BakeLUT()
+{
+	if ( !m_pCSBakeLUT->Use() )
+		return false;
+
+	m_pCB_ToneMapping->UpdateData();
+
+	m_pTexLUT->RemoveFromLastAssignedSlots();
+	m_pTexLUT->SetCSUAV( 0 );
+
+	m_pCSBakeLUT->Dispatch( LUT_SIZE >> 2, LUT_SIZE >> 2, LUT_SIZE >> 2 );
+
+	m_pTexLUT->RemoveFromLastAssignedSlotUAV();
+
+	return true;
+}
@@ -0,0 +1,117 @@
+//////////////////////////////////////////////////////////////////////////
+// HDR tone mapping with auto-exposure
+// Brings an HDR target to the screen in 3 compute passes and a full screen pass (cf. ToneMapping.hlsl):
+//	_ CS_Histogram builds a log2 luminance histogram of the HDR target in a single pass: each thread group bins its pixels
+//		into shared memory then merges its bins into the global histogram with atomic adds, so there's no downsampling chain
+//	_ CS_Exposure averages the histogram (ignoring the darkest & brightest pixels) and adapts the exposure toward it at
+//		a speed depending on the frame's delta time, the histogram is cleared for the next frame
+//	_ CS_BakeLUT bakes the filmic tone curve & the output encoding into a 3D LUT, only when the tone parameters change
+//	_ The full screen pass exposes the HDR color and looks the display color up in the LUT
+//
+// The LUT's output depends on the target: linear for sRGB targets, sRGB-encoded for the other targets, and PQ-encoded Rec.2020
+//	for the back buffer of an HDR10 device (cf. Device::IsHDR10Output()), where the filmic curve is replaced by a roll-off of
+//	the highlights toward the display's peak luminance.
+//
+// Usage:
+//	ToneMapper	Tone( gs_Device, RESX, RESY );
+//	(...)
+//	Tone.Render( _DeltaTime, *pRTHDR, gs_Device.DefaultRenderTarget(), ScreenQuad );
+//
+#pragma once
+
+template<typename> class CB;
+
+class	ToneMapper
+{
+public:		// CONSTANTS
+
+	static const int	HISTOGRAM_BINS_COUNT = 64;	// !!IMPORTANT ==> Must correspond to HISTOGRAM_BINS_COUNT in ToneMapping.hlsl!!
+	static const int	LUT_SIZE = 32;				// !!IMPORTANT ==> Must correspond to LUT_SIZE in ToneMapping.hlsl!!
+
+protected:	// NESTED TYPES
+
+	enum	OUTPUT_ENCODING
+	{
+		OUTPUT_LINEAR = 0,		// The target does the sRGB encoding
+		OUTPUT_SRGB = 1,
+		OUTPUT_HDR10 = 2,		// PQ-encoded Rec.2020
+	};
+
+	// WARNING: must match the cbToneMapping constant buffer in ToneMapping.hlsl!
+	struct	CBToneMapping
+	{
+		U32		TargetSizeX, TargetSizeY;
+		float	MinLogLuminance;
+		float	LogLuminanceRange;
+
+		float	DeltaTime;
+		float	AdaptationSpeedUp;
+		float	AdaptationSpeedDown;
+		float	KeyValue;
+
+		float	ExposureCompensation;
+		U32		ResetAdaptation;
+		float	LowPercentile;
+		float	HighPercentile;
+
+		float	WhitePoint;
+		U32		OutputEncoding;
+		float	PaperWhiteNits;
+		float	DisplayMaxNits;
+	};
+
+	// WARNING: must match the Exposure structure in ToneMapping.hlsl!
+	struct	Exposure
+	{
+		float	AdaptedLuminance;
+		float	TargetLuminance;
+		float	Exposure;
+		float	__PAD;
+	};
+
+protected:	// FIELDS
+
+	Device&				m_Device;
+
+	int					m_Width;
+	int					m_Height;
+
+	ComputeShader*		m_pCSHistogram;
+	ComputeShader*		m_pCSExposure;
+	ComputeShader*		m_pCSBakeLUT;
+	Shader*				m_pMatToneMap;
+
+	StructuredBuffer*	m_pSB_Histogram;	// One U32 per bin
+	StructuredBuffer*	m_pSB_Exposure;		// A single Exposure
+	Texture3D*			m_pTexLUT;
+	CB<CBToneMapping>*	m_pCB_ToneMapping;
+
+	bool				m_bResetAdaptation;
+	U32					m_LUTOutputEncoding;	// Encoding of the LUT's last bake, ~0U if it must be baked again
+
+public:		// PROPERTIES
+
+	bool				HasErrors() const;
+
+	// Tone parameters, changing them only bakes the LUT again when they affect the tone curve
+	void				SetExposureCompensation( float _EV );
+	void				SetAdaptationSpeeds( float _SpeedUp, float _SpeedDown );
+	void				SetWhitePoint( float _WhitePoint );
+	void				SetDisplayNits( float _PaperWhiteNits, float _DisplayMaxNits );
+
+public:		// METHODS
+
+	ToneMapper( Device& _Device, int _Width, int _Height );
+	~ToneMapper();
+
+	// Forgets the adapted exposure so the next frame is exposed right away (e.g. after a camera cut)
+	void				ResetAdaptation()		{ m_bResetAdaptation = true; }
+
+	// Exposes & tone maps the HDR source into _Target
+	void				Render( float _DeltaTime, const Texture2D& _Source, const Texture2D& _Target, Primitive& _ScreenQuad );
+
+protected:
+
+	U32					GetOutputEncoding( const Texture2D& _Target ) const;
+	bool				BakeLUT();	// Returns false if the kernel isn't ready yet
+};
@@ -0,0 +1,170 @@
+#include "../GodComplex.h"
+
+Tracer	gs_Trace;
+
+// Index of the calling thread's buffer, -1 until it records its first event and -2 if there were no buffer left for it
+static __declspec(thread) int	gs_TraceThreadIndex = -1;
+
+Tracer::Tracer()
+	: m_pThreads( NULL )
+	, m_ThreadsCount( 0 )
+	, m_bRecording( false )
+	, m_Frequency( 1 )
+	, m_StartTicks( 0 )
+	, m_bGPUClockSynchronized( false )
+	, m_GPUSyncTicks( 0 )
+	, m_GPUSyncCPUTicks( 0 )
+{
+}
+
+void	Tracer::Init()
+{
+	ASSERT( m_pThreads == NULL, "Tracer already initialized!" );
+
+	m_pThreads = new ThreadBuffer[MAX_THREADS+1];
+	for ( int ThreadIndex=0; ThreadIndex <= MAX_THREADS; ThreadIndex++ )
+	{
+		m_pThreads[ThreadIndex].ThreadID = 0;
+		m_pThreads[ThreadIndex].pName[0] = '\0';
+		m_pThreads[ThreadIndex].EventsCount = 0;
+	}
+	strcpy_s( m_pThreads[MAX_THREADS].pName, MAX_THREAD_NAME_LENGTH, "GPU" );
+}
+
+void	Tracer::Exit()
+{
+	m_bRecording = false;
+	delete[] m_pThreads;
+	m_pThreads = NULL;
+}
+
+void	Tracer::StartRecording()
+{
+	ASSERT( m_pThreads != NULL, "You forgot to call Init()!" );
+	if ( m_pThreads == NULL )
+		return;
+
+	for ( int ThreadIndex=0; ThreadIndex <= MAX_THREADS; ThreadIndex++ )
+		m_pThreads[ThreadIndex].EventsCount = 0;
+
+	LARGE_INTEGER	Frequency;
+	QueryPerformanceFrequency( &Frequency );
+	m_Frequency = Frequency.QuadPart;
+	m_StartTicks = Now();
+
+	m_bGPUClockSynchronized = false;	// The GPU clock may have drifted since the last recording
+	m_bRecording = true;
+}
+
+void	Tracer::SetThreadName( const char* _pName )
+{
+	ThreadBuffer*	pBuffer = GetThreadBuffer();
+	if ( pBuffer != NULL )
+		strcpy_s( pBuffer->pName, MAX_THREAD_NAME_LENGTH, _pName );
+}
+
+void	Tracer::Record( const char* _pName, LONGLONG _Start, LONGLONG _End )
+{
+	if ( !m_bRecording )
+		return;	// Stopped meanwhile
+
+	ThreadBuffer*	pBuffer = GetThreadBuffer();
+	if ( pBuffer != NULL )
+		Push( *pBuffer, _pName, _Start, _End );
+}
+
+void	Tracer::SetGPUClock( UINT64 _GPUTicks, LONGLONG _CPUTicks )
+{
+	m_GPUSyncTicks = _GPUTicks;
+	m_GPUSyncCPUTicks = _CPUTicks;
+	m_bGPUClockSynchronized = true;
+}
+
+void	Tracer::RecordGPU( const char* _pName, UINT64 _Begin, UINT64 _End, UINT64 _GPUFrequency )
+{
+	if ( !m_bRecording || !m_bGPUClockSynchronized || _GPUFrequency == 0 )
+		return;
+
+	// The GPU ticks are signed relative to the synchronization point since the frames read back late may predate it
+	double		GPU2CPU = double(m_Frequency) / double(_GPUFrequency);
+	LONGLONG	Start = m_GPUSyncCPUTicks + LONGLONG( GPU2CPU * double( LONGLONG(_Begin - m_GPUSyncTicks) ) );
+	LONGLONG	End = m_GPUSyncCPUTicks + LONGLONG( GPU2CPU * double( LONGLONG(_End - m_GPUSyncTicks) ) );
+	if ( Start < m_StartTicks )
+		return;	// Issued before the recording started
+
+	Push( m_pThreads[MAX_THREADS], _pName, Start, End );
+}
+
+bool	Tracer::Export( const char* _pFileName ) const
+{
+	ASSERT( !m_bRecording, "Stop recording before exporting!" );
+	if ( m_pThreads == NULL )
+		return false;
+
+	FILE*	pFile = NULL;
+	fopen_s( &pFile, _pFileName, "wt" );
+	if ( pFile == NULL )
+		return false;
+
+	double	ToMicroseconds = 1e6 / double(m_Frequency);
+
+	fprintf( pFile, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n" );
+	bool	bFirst = true;
+	int		ThreadsCount = MIN( int(m_ThreadsCount), MAX_THREADS );
+	for ( int ThreadIndex=0; ThreadIndex <= MAX_THREADS; ThreadIndex++ )
+	{
+		if ( ThreadIndex == ThreadsCount )
+			ThreadIndex = MAX_THREADS;	// Skip the unused buffers straight to the GPU's
+
+		const ThreadBuffer&	B = m_pThreads[ThreadIndex];
+		if ( B.pName[0] != '\0' )
+			fprintf( pFile, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", bFirst ? "" : ",\n", ThreadIndex, B.pName );
+		else
+			fprintf( pFile, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"Thread %u\"}}", bFirst ? "" : ",\n", ThreadIndex, B.ThreadID );
+		bFirst = false;
+
+		// Oldest first
+		LONG	EventsCount = B.EventsCount;
+		for ( LONG EventIndex=MAX( 0, EventsCount - EVENTS_PER_THREAD ); EventIndex < EventsCount; EventIndex++ )
+		{
+			const Event&	E = B.pEvents[EventIndex & (EVENTS_PER_THREAD-1)];
+			fprintf( pFile, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+				E.pName, ThreadIndex == MAX_THREADS ? "GPU" : "CPU", ThreadIndex, (E.Start - m_StartTicks) * ToMicroseconds, (E.End - E.Start) * ToMicroseconds );
+		}
+	}
+	fprintf( pFile, "\n]}\n" );
+
+	fclose( pFile );
+	return true;
+}
+
+Tracer::ThreadBuffer*	Tracer::GetThreadBuffer()
+{
+	if ( m_pThreads == NULL || gs_TraceThreadIndex == -2 )
+		return NULL;
+
+	if ( gs_TraceThreadIndex == -1 )
+	{	// First event of that thread
+		int	ThreadIndex = InterlockedIncrement( &m_ThreadsCount ) - 1;
+		if ( ThreadIndex >= MAX_THREADS )
+		{
+			gs_TraceThreadIndex = -2;
+			return NULL;
+		}
+
+		m_pThreads[ThreadIndex].ThreadID = GetCurrentThreadId();
+		gs_TraceThreadIndex = ThreadIndex;
+	}
+
+	return &m_pThreads[gs_TraceThreadIndex];
+}
+
+void	Tracer::Push( ThreadBuffer& _Buffer, const char* _pName, LONGLONG _Start, LONGLONG _End )
+{
+	LONG	EventIndex = _Buffer.EventsCount;
+	Event&	E = _Buffer.pEvents[EventIndex & (EVENTS_PER_THREAD-1)];
+	E.pName = _pName;
+	E.Start = _Start;
+	E.End = _End;
+	_Buffer.EventsCount = EventIndex + 1;
+}
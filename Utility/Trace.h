@@ -0,0 +1,128 @@
+//////////////////////////////////////////////////////////////////////////
+// Timeline tracer
+// Records named CPU scopes of every thread and the GPU profiler's scopes on a single clock, and exports them as a Chrome
+//	trace (open the file in chrome://tracing or https://ui.perfetto.dev) so you can see what each thread was doing when
+//	rather than only how long a scope takes on average (cf. TimeProfile & GPUProfiler)
+//	_ Each thread writes into its own ring buffer of events without any lock, only the last EVENTS_PER_THREAD events are kept
+//	_ The events are timed with QueryPerformanceCounter(), the GPU timestamps read back by the GPU profiler are converted
+//		to the same clock by measuring the GPU clock against the CPU's once when the recording starts
+//
+// Usage:
+//	void	SHProbeEncoder::ComputeFloodFill( (...) )
+//	{
+//		TRACE_SCOPE( "SHProbeEncoder::ComputeFloodFill" );
+//		(...)
+//	}
+//
+//	gs_Trace.StartRecording();
+//	(...)	// Run a few frames
+//	gs_Trace.StopRecording();
+//	gs_Trace.Export( "./Trace.json" );
+//
+// NOTE: The scope names must be persistent & must not contain quotes (i.e. use string literals!)
+// Start, stop & export the recording from the main thread, between frames. The scopes that straddle the start of a recording are lost.
+// Without TRACING the scopes compile to nothing, with it they cost a single test while nothing is recorded.
+//
+#pragma once
+
+#define TRACING		// Define this to compile the trace scopes in (cf. TRACE_SCOPE). Comment to strip them all
+
+class Tracer
+{
+public:		// CONSTANTS
+
+	static const int	MAX_THREADS = 16;				// Threads that can record events, the events of the others are ignored
+	static const int	EVENTS_PER_THREAD = 16384;		// Size of each thread's ring buffer (must be a power of 2)
+	static const int	MAX_THREAD_NAME_LENGTH = 32;
+
+protected:	// NESTED TYPES
+
+	struct	Event
+	{
+		const char*		pName;
+		LONGLONG		Start;		// QPC ticks
+		LONGLONG		End;
+	};
+
+	// Only the owner thread writes into its buffer
+	struct	ThreadBuffer
+	{
+		DWORD			ThreadID;
+		char			pName[MAX_THREAD_NAME_LENGTH];
+		LONG			EventsCount;	// Total amount of events recorded, the ring only keeps the last EVENTS_PER_THREAD ones
+		Event			pEvents[EVENTS_PER_THREAD];
+	};
+
+protected:	// FIELDS
+
+	ThreadBuffer*		m_pThreads;			// [MAX_THREADS] is the GPU's, filled by the GPU profiler on the main thread
+	volatile LONG		m_ThreadsCount;
+	volatile bool		m_bRecording;
+
+	LONGLONG			m_Frequency;		// QPC ticks per second
+	LONGLONG			m_StartTicks;
+
+	bool				m_bGPUClockSynchronized;
+	UINT64				m_GPUSyncTicks;		// A GPU timestamp...
+	LONGLONG			m_GPUSyncCPUTicks;	// ...and the QPC time it was measured at
+
+public:		// PROPERTIES
+
+	bool				IsRecording() const				{ return m_bRecording; }
+	bool				IsGPUClockSynchronized() const	{ return m_bGPUClockSynchronized; }
+
+	static LONGLONG		Now()							{ LARGE_INTEGER Ticks; QueryPerformanceCounter( &Ticks ); return Ticks.QuadPart; }
+
+public:		// METHODS
+
+	Tracer();
+
+	// Must be called by the main thread before any other thread starts (allocates the buffers)
+	void				Init();
+	void				Exit();
+
+	// Clears the previous events and starts recording new ones
+	void				StartRecording();
+	void				StopRecording()		{ m_bRecording = false; }
+
+	// Names the calling thread in the exported trace (e.g. "Worker 3"), threads without a name show their ID
+	void				SetThreadName( const char* _pName );
+
+	// Records a scope of the calling thread
+	void				Record( const char* _pName, LONGLONG _Start, LONGLONG _End );
+
+	// Tells which QPC time a GPU timestamp was taken at (cf. GPUProfiler), the GPU events are ignored until then
+	void				SetGPUClock( UINT64 _GPUTicks, LONGLONG _CPUTicks );
+
+	// Records a GPU scope given its timestamps & the frequency of the GPU clock (cf. D3D11_QUERY_DATA_TIMESTAMP_DISJOINT)
+	void				RecordGPU( const char* _pName, UINT64 _Begin, UINT64 _End, UINT64 _GPUFrequency );
+
+	// Writes the recorded events as a Chrome trace_event JSON file
+	// Returns false if the file couldn't be created
+	bool				Export( const char* _pFileName ) const;
+
+protected:
+
+	ThreadBuffer*		GetThreadBuffer();	// Returns NULL before Init() or if there are too many threads
+	static void			Push( ThreadBuffer& _Buffer, const char* _pName, LONGLONG _Start, LONGLONG _End );
+};
+
+extern Tracer	gs_Trace;
+
+// Scoped helper recording its lifetime
+class	TraceScope
+{
+	const char*		m_pName;
+	LONGLONG		m_Start;
+public:
+	TraceScope( const char* _pName ) : m_pName( _pName ), m_Start( gs_Trace.IsRecording() ? Tracer::Now() : 0 )	{}
+	~TraceScope()																									{ if ( m_Start != 0 ) gs_Trace.Record( m_pName, m_Start, Tracer::Now() ); }
+};
+
+#ifdef TRACING
+#define TRACE_CONCAT2( a, b )	a##b
+#define TRACE_CONCAT( a, b )	TRACE_CONCAT2( a, b )
+#define TRACE_SCOPE( _Name )	TraceScope	TRACE_CONCAT( __TraceScope, __LINE__ )( _Name );
+#else
+#define TRACE_SCOPE( _Name )
+#endif
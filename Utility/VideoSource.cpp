@@ -0,0 +1,635 @@
+#ifdef _DEBUG
+
+#include "../GodComplex.h"
+
+static const double	TIME_UNITS = 1e7;	// Media Foundation times are in 100ns units
+
+// Builds the row of the YUV->RGB matrix that applies _KU & _KV to the centered chroma, with the range expansion folded in
+static float4	BuildRow( bool _bFullRange, float _KU, float _KV )
+{
+	float	ScaleY = _bFullRange ? 1.0f : 255.0f / 219.0f;
+	float	ScaleC = _bFullRange ? 1.0f : 255.0f / 224.0f;
+	float	OffsetY = _bFullRange ? 0.0f : 16.0f / 255.0f;
+	float	OffsetC = 128.0f / 255.0f;
+	return float4( ScaleY, _KU * ScaleC, _KV * ScaleC, -ScaleY * OffsetY - (_KU + _KV) * ScaleC * OffsetC );
+}
+
+VideoSource::VideoSource( Device& _Device )
+	: m_Device( _Device )
+	, m_RefCount( 1 )
+	, m_pDeviceManager( NULL )
+	, m_ResetToken( 0 )
+	, m_pMediaSource( NULL )
+	, m_pReader( NULL )
+	, m_bLive( false )
+	, m_Width( 0 )
+	, m_Height( 0 )
+	, m_bMediaTypeChanged( 0 )
+	, m_pNextSample( NULL )
+	, m_NextSampleTime( 0 )
+	, m_bEndOfStream( false )
+	, m_pLatestSample( NULL )
+	, m_LatestSampleTime( 0 )
+	, m_bReadPending( 0 )
+	, m_DroppedFramesCount( 0 )
+	, m_bQuit( 0 )
+	, m_FrameTime( 0.0 )
+	, m_FramesCount( 0 )
+	, m_pTexture( NULL )
+	, m_ViewsCount( 0 )
+	, m_pUploadTexture( NULL )
+{
+	memset( &m_UploadView, 0, sizeof(CachedView) );
+	InitializeCriticalSection( &m_Lock );
+	m_hFlushedEvent = CreateEvent( NULL, FALSE, FALSE, NULL );
+
+	m_pCSConvert = CreateComputeShader( IDR_SHADER_NV12_TO_RGB, "./Resources/Shaders/NV12ToRGB.hlsl", "CS_Convert" );
+	m_pCB_Convert = new CB<CBConvert>( m_Device, 10 );
+}
+
+VideoSource::~VideoSource()
+{
+	Exit();
+
+	delete m_pCB_Convert;
+	delete m_pCSConvert;
+
+	CloseHandle( m_hFlushedEvent );
+	DeleteCriticalSection( &m_Lock );
+}
+
+bool	VideoSource::InitFile( const wchar_t* _pFileName )
+{
+	m_bLive = false;
+	return Init( NULL, _pFileName );
+}
+
+bool	VideoSource::InitCaptureDevice( int _DeviceIndex )
+{
+	Exit();
+	if ( FAILED( MFStartup( MF_VERSION ) ) )
+		return false;
+
+	IMFAttributes*	pAttributes = NULL;
+	IMFActivate**	ppDevices = NULL;
+	UINT32			DevicesCount = 0;
+	if (	SUCCEEDED( MFCreateAttributes( &pAttributes, 1 ) )
+		&&	SUCCEEDED( pAttributes->SetGUID( MF_DEVSOURCE_ATTRIBUTE_SOURCE_TYPE, MF_DEVSOURCE_ATTRIBUTE_SOURCE_TYPE_VIDCAP_GUID ) ) )
+		MFEnumDeviceSources( pAttributes, &ppDevices, &DevicesCount );
+	if ( pAttributes != NULL )
+		pAttributes->Release();
+
+	if ( _DeviceIndex >= 0 && U32(_DeviceIndex) < DevicesCount )
+		ppDevices[_DeviceIndex]->ActivateObject( IID_PPV_ARGS( &m_pMediaSource ) );
+
+	for ( U32 DeviceIndex=0; DeviceIndex < DevicesCount; DeviceIndex++ )
+		ppDevices[DeviceIndex]->Release();
+	CoTaskMemFree( ppDevices );
+
+	bool	bSucceeded = false;
+	if ( m_pMediaSource != NULL )
+	{
+		m_bLive = true;
+		bSucceeded = Init( m_pMediaSource, NULL );
+	}
+
+	MFShutdown();	// Init() holds its own reference to the platform
+	return bSucceeded;
+}
+
+bool	VideoSource::Init( IMFMediaSource* _pSource, const wchar_t* _pURL )
+{
+	if ( _pSource == NULL )
+		Exit();
+	if ( FAILED( MFStartup( MF_VERSION ) ) )
+		return false;
+
+	// The decoder works on our device from its own threads
+	ID3D10Multithread*	pMultithread = NULL;
+	if ( SUCCEEDED( m_Device.DXDevice().QueryInterface( __uuidof(ID3D10Multithread), (void**) &pMultithread ) ) )
+	{
+		pMultithread->SetMultithreadProtected( TRUE );
+		pMultithread->Release();
+	}
+
+	if (	FAILED( MFCreateDXGIDeviceManager( &m_ResetToken, &m_pDeviceManager ) )
+		||	FAILED( m_pDeviceManager->ResetDevice( &m_Device.DXDevice(), m_ResetToken ) ) )
+	{
+		ASSERT( false, "Failed to create the DXGI device manager! (Was the device created with D3D11_CREATE_DEVICE_VIDEO_SUPPORT?)" );
+		if ( m_pDeviceManager == NULL )
+			MFShutdown();	// Otherwise released by Exit()
+		Exit();
+		return false;
+	}
+
+	// Create a reader that decodes with DXVA into shader readable textures of our device
+	IMFAttributes*	pAttributes = NULL;
+	HRESULT	hr = MFCreateAttributes( &pAttributes, 5 );
+	if ( SUCCEEDED( hr ) )
+	{
+		pAttributes->SetUnknown( MF_SOURCE_READER_D3D_MANAGER, m_pDeviceManager );
+		pAttributes->SetUINT32( MF_READWRITE_ENABLE_HARDWARE_TRANSFORMS, TRUE );
+		pAttributes->SetUINT32( MF_SOURCE_READER_ENABLE_ADVANCED_VIDEO_PROCESSING, TRUE );	// Lets the GPU convert webcam formats (e.g. YUY2) to NV12
+		pAttributes->SetUINT32( MF_SOURCE_READER_D3D11_BIND_FLAGS, D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_DECODER );
+		if ( m_bLive )
+			pAttributes->SetUnknown( MF_SOURCE_READER_ASYNC_CALLBACK, this );
+
+		hr = _pSource != NULL ? MFCreateSourceReaderFromMediaSource( _pSource, pAttributes, &m_pReader ) : MFCreateSourceReaderFromURL( _pURL, pAttributes, &m_pReader );
+		pAttributes->Release();
+	}
+	if ( FAILED( hr ) )
+	{
+		m_pReader = NULL;
+		Exit();
+		return false;
+	}
+
+	// Only decode the first video stream, as NV12
+	IMFMediaType*	pType = NULL;
+	m_pReader->SetStreamSelection( DWORD(MF_SOURCE_READER_ALL_STREAMS), FALSE );
+	m_pReader->SetStreamSelection( DWORD(MF_SOURCE_READER_FIRST_VIDEO_STREAM), TRUE );
+	hr = MFCreateMediaType( &pType );
+	if ( SUCCEEDED( hr ) )
+	{
+		pType->SetGUID( MF_MT_MAJOR_TYPE, MFMediaType_Video );
+		pType->SetGUID( MF_MT_SUBTYPE, MFVideoFormat_NV12 );
+		hr = m_pReader->SetCurrentMediaType( DWORD(MF_SOURCE_READER_FIRST_VIDEO_STREAM), NULL, pType );
+		pType->Release();
+	}
+	if ( FAILED( hr ) || !UpdateMediaType() )
+	{
+		Exit();
+		return false;
+	}
+
+	m_bEndOfStream = false;
+	m_bQuit = 0;
+	m_FrameTime = 0.0;
+	m_FramesCount = 0;
+	m_DroppedFramesCount = 0;
+
+	if ( m_bLive )
+		RequestSample();
+	else
+		ReadNextSample();
+
+	return true;
+}
+
+// Reads the frame size and color space of the decoder's output and (re)creates the target texture
+bool	VideoSource::UpdateMediaType()
+{
+	IMFMediaType*	pType = NULL;
+	if ( FAILED( m_pReader->GetCurrentMediaType( DWORD(MF_SOURCE_READER_FIRST_VIDEO_STREAM), &pType ) ) )
+		return false;
+
+	UINT32	Width = 0, Height = 0;
+	MFGetAttributeSize( pType, MF_MT_FRAME_SIZE, &Width, &Height );
+	UINT32	Matrix = MFGetAttributeUINT32( pType, MF_MT_YUV_MATRIX, Height >= 720 ? MFVideoTransferMatrix_BT709 : MFVideoTransferMatrix_BT601 );
+	UINT32	Range = MFGetAttributeUINT32( pType, MF_MT_VIDEO_NOMINAL_RANGE, MFNominalRange_16_235 );
+	pType->Release();
+
+	if ( Width == 0 || Height == 0 )
+		return false;
+
+	bool	bFullRange = Range == MFNominalRange_0_255;
+	if ( Matrix == MFVideoTransferMatrix_BT601 )
+	{
+		m_pCB_Convert->m.RowR = BuildRow( bFullRange, 0.0f, 1.402f );
+		m_pCB_Convert->m.RowG = BuildRow( bFullRange, -0.344136f, -0.714136f );
+		m_pCB_Convert->m.RowB = BuildRow( bFullRange, 1.772f, 0.0f );
+	}
+	else
+	{
+		m_pCB_Convert->m.RowR = BuildRow( bFullRange, 0.0f, 1.5748f );
+		m_pCB_Convert->m.RowG = BuildRow( bFullRange, -0.187324f, -0.468124f );
+		m_pCB_Convert->m.RowB = BuildRow( bFullRange, 1.8556f, 0.0f );
+	}
+
+	if ( m_pTexture != NULL && m_Width == int(Width) && m_Height == int(Height) )
+		return true;
+
+	m_Width = Width;
+	m_Height = Height;
+	delete m_pTexture;
+	m_pTexture = new Texture2D( m_Device, m_Width, m_Height, 1, PixelFormatRGBA16F::DESCRIPTOR, 1, NULL, false, true );
+
+	// The upload texture has the previous size
+	ReleaseViews( m_UploadView );
+	if ( m_pUploadTexture != NULL )
+		m_pUploadTexture->Release();
+	m_pUploadTexture = NULL;
+
+	return true;
+}
+
+void	VideoSource::Exit()
+{
+	if ( m_pReader != NULL && m_bLive )
+	{
+		// Wait for the pending read to be cancelled so the callback doesn't run on a dead reader
+		InterlockedExchange( &m_bQuit, 1 );
+		if ( SUCCEEDED( m_pReader->Flush( DWORD(MF_SOURCE_READER_ALL_STREAMS) ) ) )
+			WaitForSingleObject( m_hFlushedEvent, 1000 );
+	}
+
+	if ( m_pNextSample != NULL )
+		m_pNextSample->Release();
+	m_pNextSample = NULL;
+	if ( m_pLatestSample != NULL )
+		m_pLatestSample->Release();
+	m_pLatestSample = NULL;
+
+	for ( int ViewIndex=0; ViewIndex < m_ViewsCount; ViewIndex++ )
+		ReleaseViews( m_pViews[ViewIndex] );
+	m_ViewsCount = 0;
+	ReleaseViews( m_UploadView );
+	if ( m_pUploadTexture != NULL )
+		m_pUploadTexture->Release();
+	m_pUploadTexture = NULL;
+
+	delete m_pTexture;
+	m_pTexture = NULL;
+
+	bool	bStarted = m_pDeviceManager != NULL;
+	if ( m_pReader != NULL )
+		m_pReader->Release();
+	m_pReader = NULL;
+	if ( m_pMediaSource != NULL )
+	{
+		m_pMediaSource->Shutdown();
+		m_pMediaSource->Release();
+	}
+	m_pMediaSource = NULL;
+	if ( m_pDeviceManager != NULL )
+		m_pDeviceManager->Release();
+	m_pDeviceManager = NULL;
+
+	m_bReadPending = 0;
+	m_Width = m_Height = 0;
+
+	if ( bStarted )
+		MFShutdown();
+}
+
+bool	VideoSource::Update( double _Time )
+{
+	if ( m_pReader == NULL )
+		return false;
+
+	if ( InterlockedExchange( &m_bMediaTypeChanged, 0 ) )
+		UpdateMediaType();
+
+	IMFSample*	pSample = NULL;
+	LONGLONG	SampleTime = 0;
+	if ( m_bLive )
+	{
+		EnterCriticalSection( &m_Lock );
+		pSample = m_pLatestSample;
+		SampleTime = m_LatestSampleTime;
+		m_pLatestSample = NULL;
+		LeaveCriticalSection( &m_Lock );
+	}
+	else
+	{
+		// Decode up to the last frame that should be visible at that time, the frames we go past are dropped
+		LONGLONG	Time = LONGLONG( _Time * TIME_UNITS );
+		while ( m_pNextSample != NULL && m_NextSampleTime <= Time )
+		{
+			if ( pSample != NULL )
+			{
+				pSample->Release();
+				m_DroppedFramesCount++;
+			}
+			pSample = m_pNextSample;
+			SampleTime = m_NextSampleTime;
+			m_pNextSample = NULL;
+			ReadNextSample();
+
+			if ( InterlockedExchange( &m_bMediaTypeChanged, 0 ) )
+				UpdateMediaType();
+		}
+	}
+
+	if ( pSample == NULL )
+		return false;	// Keep showing the current frame
+
+	bool	bConverted = Convert( *pSample );
+	pSample->Release();
+	if ( !bConverted )
+		return false;
+
+	m_FrameTime = SampleTime / TIME_UNITS;
+	m_FramesCount++;
+	return true;
+}
+
+void	VideoSource::Seek( double _Time )
+{
+	ASSERT( !m_bLive, "Can't seek a live source!" );
+	if ( m_pReader == NULL || m_bLive )
+		return;
+
+	if ( m_pNextSample != NULL )
+		m_pNextSample->Release();
+	m_pNextSample = NULL;
+
+	PROPVARIANT	Position;
+	PropVariantInit( &Position );
+	Position.vt = VT_I8;
+	Position.hVal.QuadPart = LONGLONG( MAX( 0.0, _Time ) * TIME_UNITS );
+	m_pReader->SetCurrentPosition( GUID_NULL, Position );	// Restarts from the key frame before the position, Update() skips up to the exact frame
+	PropVariantClear( &Position );
+
+	m_bEndOfStream = false;
+	m_FrameTime = _Time;
+	ReadNextSample();
+}
+
+bool	VideoSource::ReadNextSample()
+{
+	while ( !m_bEndOfStream )
+	{
+		DWORD		Flags = 0;
+		LONGLONG	Time = 0;
+		IMFSample*	pSample = NULL;
+		if ( FAILED( m_pReader->ReadSample( DWORD(MF_SOURCE_READER_FIRST_VIDEO_STREAM), 0, NULL, &Flags, &Time, &pSample ) ) )
+			Flags |= MF_SOURCE_READERF_ERROR;
+
+		if ( Flags & MF_SOURCE_READERF_CURRENTMEDIATYPECHANGED )
+			m_bMediaTypeChanged = 1;
+		if ( Flags & (MF_SOURCE_READERF_ENDOFSTREAM | MF_SOURCE_READERF_ERROR) )
+			m_bEndOfStream = true;
+
+		if ( pSample != NULL )
+		{
+			m_pNextSample = pSample;
+			m_NextSampleTime = Time;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void	VideoSource::RequestSample()
+{
+	if ( m_bQuit || InterlockedCompareExchange( &m_bReadPending, 1, 0 ) != 0 )
+		return;	// Already waiting for a sample
+
+	if ( FAILED( m_pReader->ReadSample( DWORD(MF_SOURCE_READER_FIRST_VIDEO_STREAM), 0, NULL, NULL, NULL, NULL ) ) )
+		m_bReadPending = 0;
+}
+
+bool	VideoSource::Convert( IMFSample& _Sample )
+{
+	IMFMediaBuffer*	pBuffer = NULL;
+	if ( FAILED( _Sample.GetBufferByIndex( 0, &pBuffer ) ) )
+		return false;
+
+	// Hardware decoded frames are slices of the decoder's texture array, we read them in place
+	CachedView*		pView = NULL;
+	IMFDXGIBuffer*	pDXGIBuffer = NULL;
+	if ( SUCCEEDED( pBuffer->QueryInterface( IID_PPV_ARGS( &pDXGIBuffer ) ) ) )
+	{
+		ID3D11Texture2D*	pTexture = NULL;
+		UINT				SubResource = 0;
+		if (	SUCCEEDED( pDXGIBuffer->GetResource( IID_PPV_ARGS( &pTexture ) ) )
+			&&	SUCCEEDED( pDXGIBuffer->GetSubresourceIndex( &SubResource ) ) )
+			pView = GetViews( *pTexture, SubResource );	// Decoder textures have a single mip so the sub-resource is the slice
+		if ( pTexture != NULL )
+			pTexture->Release();
+		pDXGIBuffer->Release();
+	}
+	else
+		pView = Upload( *pBuffer );
+	pBuffer->Release();
+
+	if ( pView == NULL || !m_pCSConvert->Use() )
+		return false;
+
+	m_pCB_Convert->m.Width = m_Width;
+	m_pCB_Convert->m.Height = m_Height;
+	m_pCB_Convert->UpdateData();
+
+	m_pTexture->RemoveFromLastAssignedSlots();
+	ID3D11ShaderResourceView*	ppViews[2] = { pView->pLuma, pView->pChroma };
+	m_Device.SetShaderResources( Device::SSF_COMPUTE_SHADER, 10, 2, ppViews );
+	m_pTexture->SetCSUAV( 0 );
+
+	m_pCSConvert->Dispatch( (m_Width+7) >> 3, (m_Height+7) >> 3, 1 );
+
+	m_Device.RemoveShaderResources( 10, 2, Device::SSF_COMPUTE_SHADER );
+	m_pTexture->RemoveFromLastAssignedSlotUAV();
+
+	return true;
+}
+
+VideoSource::CachedView*	VideoSource::GetViews( ID3D11Texture2D& _Texture, UINT _ArraySlice )
+{
+	for ( int ViewIndex=0; ViewIndex < m_ViewsCount; ViewIndex++ )
+		if ( m_pViews[ViewIndex].pTexture == &_Texture && m_pViews[ViewIndex].ArraySlice == _ArraySlice )
+			return &m_pViews[ViewIndex];
+
+	// New surface from the decoder's pool (the cache only fills up if the decoder reallocated its pool)
+	if ( m_ViewsCount == MAX_CACHED_VIEWS )
+	{
+		for ( int ViewIndex=0; ViewIndex < m_ViewsCount; ViewIndex++ )
+			ReleaseViews( m_pViews[ViewIndex] );
+		m_ViewsCount = 0;
+	}
+
+	CachedView&	View = m_pViews[m_ViewsCount];
+	CreateViews( View, _Texture, _ArraySlice );
+	if ( View.pLuma == NULL || View.pChroma == NULL )
+	{
+		ReleaseViews( View );
+		return NULL;
+	}
+
+	m_ViewsCount++;
+	return &View;
+}
+
+// Fallback for frames in system memory, NV12 buffers store the chroma plane right after the luma plane with the same pitch
+VideoSource::CachedView*	VideoSource::Upload( IMFMediaBuffer& _Buffer )
+{
+	if ( m_pUploadTexture == NULL )
+	{
+		D3D11_TEXTURE2D_DESC	Desc;
+		memset( &Desc, 0, sizeof(Desc) );
+		Desc.Width = m_Width;
+		Desc.Height = m_Height;
+		Desc.MipLevels = 1;
+		Desc.ArraySize = 1;
+		Desc.Format = DXGI_FORMAT_NV12;
+		Desc.SampleDesc.Count = 1;
+		Desc.Usage = D3D11_USAGE_DEFAULT;
+		Desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		if ( FAILED( m_Device.DXDevice().CreateTexture2D( &Desc, NULL, &m_pUploadTexture ) ) )
+		{
+			m_pUploadTexture = NULL;
+			return NULL;
+		}
+
+		CreateViews( m_UploadView, *m_pUploadTexture, 0 );
+	}
+
+	BYTE*	pData = NULL;
+	LONG	Pitch = m_Width;
+	IMF2DBuffer*	p2DBuffer = NULL;
+	bool	bLocked = false;
+	if ( SUCCEEDED( _Buffer.QueryInterface( IID_PPV_ARGS( &p2DBuffer ) ) ) )
+		bLocked = SUCCEEDED( p2DBuffer->Lock2D( &pData, &Pitch ) );
+	else
+		bLocked = SUCCEEDED( _Buffer.Lock( &pData, NULL, NULL ) );
+
+	if ( bLocked && Pitch > 0 )
+		m_Device.DXContext().UpdateSubresource( m_pUploadTexture, 0, NULL, pData, Pitch, 0 );
+
+	if ( p2DBuffer != NULL )
+	{
+		if ( bLocked )
+			p2DBuffer->Unlock2D();
+		p2DBuffer->Release();
+	}
+	else if ( bLocked )
+		_Buffer.Unlock();
+
+	return bLocked && m_UploadView.pLuma != NULL && m_UploadView.pChroma != NULL ? &m_UploadView : NULL;	// Bottom-up frames (negative pitch) are not supported
+}
+
+void	VideoSource::CreateViews( CachedView& _View, ID3D11Texture2D& _Texture, UINT _ArraySlice )
+{
+	_View.pTexture = &_Texture;
+	_View.pTexture->AddRef();	// So the decoder doesn't recycle the address while we cache it
+	_View.ArraySlice = _ArraySlice;
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC	Desc;
+	Desc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+	Desc.Texture2DArray.MostDetailedMip = 0;
+	Desc.Texture2DArray.MipLevels = 1;
+	Desc.Texture2DArray.FirstArraySlice = _ArraySlice;
+	Desc.Texture2DArray.ArraySize = 1;
+
+	Desc.Format = DXGI_FORMAT_R8_UNORM;
+	if ( FAILED( m_Device.DXDevice().CreateShaderResourceView( &_Texture, &Desc, &_View.pLuma ) ) )
+		_View.pLuma = NULL;
+	Desc.Format = DXGI_FORMAT_R8G8_UNORM;
+	if ( FAILED( m_Device.DXDevice().CreateShaderResourceView( &_Texture, &Desc, &_View.pChroma ) ) )
+		_View.pChroma = NULL;
+}
+
+void	VideoSource::ReleaseViews( CachedView& _View )
+{
+	if ( _View.pLuma != NULL )
+		_View.pLuma->Release();
+	if ( _View.pChroma != NULL )
+		_View.pChroma->Release();
+	if ( _View.pTexture != NULL )
+		_View.pTexture->Release();
+	memset( &_View, 0, sizeof(CachedView) );
+}
+
+void	VideoSource::EnumerateDevices( EnumerateDelegate _pDeviceEnumerator, void* _pUserData )
+{
+	if ( FAILED( MFStartup( MF_VERSION ) ) )
+		return;
+
+	IMFAttributes*	pAttributes = NULL;
+	IMFActivate**	ppDevices = NULL;
+	UINT32			DevicesCount = 0;
+	if (	SUCCEEDED( MFCreateAttributes( &pAttributes, 1 ) )
+		&&	SUCCEEDED( pAttributes->SetGUID( MF_DEVSOURCE_ATTRIBUTE_SOURCE_TYPE, MF_DEVSOURCE_ATTRIBUTE_SOURCE_TYPE_VIDCAP_GUID ) ) )
+		MFEnumDeviceSources( pAttributes, &ppDevices, &DevicesCount );
+	if ( pAttributes != NULL )
+		pAttributes->Release();
+
+	for ( U32 DeviceIndex=0; DeviceIndex < DevicesCount; DeviceIndex++ )
+	{
+		wchar_t*	pFriendlyName = NULL;
+		UINT32		Length = 0;
+		if ( SUCCEEDED( ppDevices[DeviceIndex]->GetAllocatedString( MF_DEVSOURCE_ATTRIBUTE_FRIENDLY_NAME, &pFriendlyName, &Length ) ) )
+		{
+			(*_pDeviceEnumerator)( DeviceIndex, pFriendlyName, _pUserData );
+			CoTaskMemFree( pFriendlyName );
+		}
+		ppDevices[DeviceIndex]->Release();
+	}
+	CoTaskMemFree( ppDevices );
+
+	MFShutdown();
+}
+
+//////////////////////////////////////////////////////////////////////////
+// IUnknown
+HRESULT	VideoSource::QueryInterface( REFIID riid, void** ppvObject )
+{
+	if ( ppvObject == NULL )
+		return E_POINTER;
+
+	if ( riid == __uuidof(IMFSourceReaderCallback) )
+		*ppvObject = static_cast<IMFSourceReaderCallback*>( this );
+	else if ( riid == IID_IUnknown )
+		*ppvObject = static_cast<IUnknown*>( this );
+	else
+	{
+		*ppvObject = NULL;
+		return E_NOINTERFACE;
+	}
+
+	AddRef();
+	return S_OK;
+}
+
+ULONG	VideoSource::AddRef()
+{
+	return InterlockedIncrement( &m_RefCount );
+}
+
+ULONG	VideoSource::Release()
+{
+	return InterlockedDecrement( &m_RefCount );
+}
+
+//////////////////////////////////////////////////////////////////////////
+// IMFSourceReaderCallback (called from a Media Foundation work queue thread)
+HRESULT	VideoSource::OnReadSample( HRESULT hrStatus, DWORD dwStreamIndex, DWORD dwStreamFlags, LONGLONG llTimestamp, IMFSample* pSample )
+{
+	if ( dwStreamFlags & MF_SOURCE_READERF_CURRENTMEDIATYPECHANGED )
+		InterlockedExchange( &m_bMediaTypeChanged, 1 );
+
+	if ( SUCCEEDED( hrStatus ) && pSample != NULL )
+	{
+		// Only keep the newest frame
+		pSample->AddRef();
+		EnterCriticalSection( &m_Lock );
+		if ( m_pLatestSample != NULL )
+		{
+			m_pLatestSample->Release();
+			InterlockedIncrement( &m_DroppedFramesCount );
+		}
+		m_pLatestSample = pSample;
+		m_LatestSampleTime = llTimestamp;
+		LeaveCriticalSection( &m_Lock );
+	}
+
+	InterlockedExchange( &m_bReadPending, 0 );
+	if ( SUCCEEDED( hrStatus ) && (dwStreamFlags & (MF_SOURCE_READERF_ENDOFSTREAM | MF_SOURCE_READERF_ERROR)) == 0 )
+		RequestSample();	// Keep the capture running
+
+	return S_OK;
+}
+
+HRESULT	VideoSource::OnFlush( DWORD dwStreamIndex )
+{
+	SetEvent( m_hFlushedEvent );
+	return S_OK;
+}
+
+HRESULT	VideoSource::OnEvent( DWORD dwStreamIndex, IMFMediaEvent* pEvent )
+{
+	return S_OK;
+}
+
+#endif
@@ -0,0 +1,164 @@
+#ifdef _DEBUG
+
+//////////////////////////////////////////////////////////////////////////
+// Video Source
+// Decodes a video file or a live capture device with Media Foundation straight into D3D11 textures of our own device:
+//	the source reader is given a DXGI device manager so the hardware decoder (DXVA) outputs NV12 textures we read
+//	in place (no D3D9 device, no shared surfaces, no CPU copy), then a compute shader converts the frame to linear RGB.
+// This replaces the DirectShow/VMR9 presenter of Utility/Video.h which had to go through a D3D9Ex device.
+//
+// Usage:
+//	VideoSource	Video( gs_Device );
+//	Video.InitFile( L"./Resources/Videos/Intro.mp4" );	// Or Video.InitCaptureDevice( 0 )
+//	...
+//	if ( Video.Update( Time ) )				// Once per frame on the device thread
+//		...									// A new frame is available
+//	Video.GetTexture().SetPS( 10 );
+//	...
+//	Video.Exit();
+//
+// Files are read synchronously and presented frame-accurately: Update() always shows the last frame whose presentation
+//	time is <= the given time, whatever the frame rates of the video and of the intro, and Seek() jumps to any time.
+// Live sources are read asynchronously and Update() shows the newest frame that arrived, it never blocks.
+//
+// NOTE: The device must be created with video support (cf. Device::Init()).
+// If a source delivers system memory buffers (e.g. software decoder or a webcam without hardware conversion), the frame
+//	is uploaded to an NV12 texture first and goes through the same conversion.
+//
+#pragma once
+
+#include <mfapi.h>
+#include <mfidl.h>
+#include <mfreadwrite.h>
+
+class	VideoSource : public IMFSourceReaderCallback
+{
+public:		// CONSTANTS
+
+	static const int	MAX_CACHED_VIEWS = 32;			// Decoders typically cycle through a pool of ~20 surfaces
+
+public:		// NESTED TYPES
+
+	typedef void	EnumerateDelegate( int _DeviceIndex, const wchar_t* _pFriendlyName, void* _pUserData );
+
+protected:
+
+	// WARNING: must match the cbConvert constant buffer in NV12ToRGB.hlsl!
+	struct	CBConvert
+	{
+		U32		Width, Height;
+		float2	__PAD;
+		float4	RowR;		// Coefficients applied to (Y,U,V,1) for each component
+		float4	RowG;
+		float4	RowB;
+	};
+
+	// Luma & chroma views on a decoder texture slice (the decoder outputs into slices of a texture array)
+	struct	CachedView
+	{
+		ID3D11Texture2D*			pTexture;
+		UINT						ArraySlice;
+		ID3D11ShaderResourceView*	pLuma;
+		ID3D11ShaderResourceView*	pChroma;
+	};
+
+protected:	// FIELDS
+
+	Device&					m_Device;
+	long					m_RefCount;
+
+	IMFDXGIDeviceManager*	m_pDeviceManager;
+	UINT					m_ResetToken;
+	IMFMediaSource*			m_pMediaSource;			// Capture devices only
+	IMFSourceReader*		m_pReader;
+	bool					m_bLive;
+
+	int						m_Width;
+	int						m_Height;
+	volatile LONG			m_bMediaTypeChanged;	// The decoder changed its output (e.g. frame size), handled by Update()
+
+	// File mode
+	IMFSample*				m_pNextSample;			// The first sample that is past the presented time
+	LONGLONG				m_NextSampleTime;		// In 100ns units
+	bool					m_bEndOfStream;
+
+	// Live mode (protected by m_Lock against the reader's callback)
+	CRITICAL_SECTION		m_Lock;
+	IMFSample*				m_pLatestSample;
+	LONGLONG				m_LatestSampleTime;
+	volatile LONG			m_bReadPending;
+	volatile LONG			m_DroppedFramesCount;
+	volatile LONG			m_bQuit;
+	HANDLE					m_hFlushedEvent;
+
+	double					m_FrameTime;			// Presentation time of the displayed frame, in seconds
+	U32						m_FramesCount;			// Amount of frames displayed so far
+
+	ComputeShader*			m_pCSConvert;
+	CB<CBConvert>*			m_pCB_Convert;
+	Texture2D*				m_pTexture;				// Linear RGB frame
+
+	CachedView				m_pViews[MAX_CACHED_VIEWS];
+	int						m_ViewsCount;
+
+	ID3D11Texture2D*		m_pUploadTexture;		// NV12 texture for system memory frames, created on first use
+	CachedView				m_UploadView;
+
+public:		// PROPERTIES
+
+	bool			IsInitialized() const		{ return m_pReader != NULL; }
+	bool			IsLive() const				{ return m_bLive; }
+	bool			IsEndOfStream() const		{ return m_bEndOfStream; }
+	int				GetWidth() const			{ return m_Width; }
+	int				GetHeight() const			{ return m_Height; }
+	Texture2D&		GetTexture() const			{ return *m_pTexture; }
+	double			GetFrameTime() const		{ return m_FrameTime; }
+	U32				GetFramesCount() const		{ return m_FramesCount; }
+	U32				GetDroppedFramesCount() const	{ return U32(m_DroppedFramesCount); }
+
+public:		// METHODS
+
+	VideoSource( Device& _Device );
+	~VideoSource();
+
+	// Opens a video file (or any URL Media Foundation supports), returns false on failure
+	bool			InitFile( const wchar_t* _pFileName );
+
+	// Opens a video capture device (cf. EnumerateDevices()), returns false on failure
+	bool			InitCaptureDevice( int _DeviceIndex );
+
+	void			Exit();
+
+	// Converts the frame to display at the given time (live sources ignore the time and take the newest frame)
+	// Returns true if a new frame was converted into the texture
+	bool			Update( double _Time );
+
+	// Files only, the next Update() presents the frame at the new time
+	void			Seek( double _Time );
+
+	static void		EnumerateDevices( EnumerateDelegate _pDeviceEnumerator, void* _pUserData );
+
+	// IUnknown Implementation
+	virtual HRESULT STDMETHODCALLTYPE	QueryInterface( REFIID riid, void** ppvObject );
+	virtual ULONG STDMETHODCALLTYPE		AddRef();
+	virtual ULONG STDMETHODCALLTYPE		Release();
+
+	// IMFSourceReaderCallback Implementation (live sources only)
+	virtual HRESULT STDMETHODCALLTYPE	OnReadSample( HRESULT hrStatus, DWORD dwStreamIndex, DWORD dwStreamFlags, LONGLONG llTimestamp, IMFSample* pSample );
+	virtual HRESULT STDMETHODCALLTYPE	OnFlush( DWORD dwStreamIndex );
+	virtual HRESULT STDMETHODCALLTYPE	OnEvent( DWORD dwStreamIndex, IMFMediaEvent* pEvent );
+
+protected:
+
+	bool			Init( IMFMediaSource* _pSource, const wchar_t* _pURL );
+	bool			UpdateMediaType();
+	bool			ReadNextSample();
+	void			RequestSample();
+	bool			Convert( IMFSample& _Sample );
+	CachedView*		GetViews( ID3D11Texture2D& _Texture, UINT _ArraySlice );
+	CachedView*		Upload( IMFMediaBuffer& _Buffer );
+	void			CreateViews( CachedView& _View, ID3D11Texture2D& _Texture, UINT _ArraySlice );
+	static void		ReleaseViews( CachedView& _View );
+};
+
+#endif
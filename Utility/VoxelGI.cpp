@@ -0,0 +1,202 @@
+#include "../GodComplex.h"
+
+static const int	THREADS_COUNT = 4;			// Threads per group in each dimension, cf. VoxelGI.hlsl
+static const float	SHADOW_BIAS = 0.001f;		// In shadow map depth units, the voxels are already pushed out of their surface
+
+const float	VoxelGI::DEFAULT_VOXEL_SIZE = 0.25f;	// Levels of 16, 32, 64 & 128 meters
+
+VoxelGI::VoxelGI( Device& _Device, const IVertexFormatDescriptor& _SceneVertexFormat, D3D_SHADER_MACRO* _pMacros, float _VoxelSize )
+	: m_Device( _Device )
+	, m_VoxelSize( _VoxelSize )
+	, m_FrameIndex( 0 )
+{
+	m_pMatVoxelize = CreateMaterial( IDR_SHADER_VOXEL_GI, "./Resources/Shaders/VoxelGI.hlsl", _SceneVertexFormat, "VS", "GS", "PS", _pMacros );
+	m_pCSInject = CreateComputeShader( IDR_SHADER_VOXEL_GI, "./Resources/Shaders/VoxelGI.hlsl", "CS_Inject" );
+	m_pCSBuildAnisotropic = CreateComputeShader( IDR_SHADER_VOXEL_GI, "./Resources/Shaders/VoxelGI.hlsl", "CS_BuildAnisotropic" );
+
+	// All the levels are stacked along Z
+	m_pTexAlbedo = new Texture3D( m_Device, CLIPMAP_SIZE, CLIPMAP_SIZE, LEVELS_COUNT * CLIPMAP_SIZE, PixelFormatR32_UINT::DESCRIPTOR, 1, NULL, false, true );
+	m_pTexAlbedo->m_pMemoryTag = "Voxel GI";
+	m_pTexNormal = new Texture3D( m_Device, CLIPMAP_SIZE, CLIPMAP_SIZE, LEVELS_COUNT * CLIPMAP_SIZE, PixelFormatR32_UINT::DESCRIPTOR, 1, NULL, false, true );
+	m_pTexNormal->m_pMemoryTag = "Voxel GI";
+	m_pTexRadiance = new Texture3D( m_Device, CLIPMAP_SIZE, CLIPMAP_SIZE, LEVELS_COUNT * CLIPMAP_SIZE, PixelFormatRGBA16F::DESCRIPTOR, 1, NULL, false, true );
+	m_pTexRadiance->m_pMemoryTag = "Voxel GI";
+	m_pTexAnisotropic = new Texture3D( m_Device, 6 * (CLIPMAP_SIZE/2), CLIPMAP_SIZE/2, LEVELS_COUNT * (CLIPMAP_SIZE/2), PixelFormatRGBA16F::DESCRIPTOR, ANISO_MIPS_COUNT, NULL, false, true );
+	m_pTexAnisotropic->m_pMemoryTag = "Voxel GI";
+
+	m_pCB_VoxelGI = new CB<CBVoxelGI>( m_Device, 7, true );
+	memset( &m_pCB_VoxelGI->m, 0, sizeof(CBVoxelGI) );
+	m_pCB_VoxelGI->m.LevelsCount = LEVELS_COUNT;
+	m_pCB_VoxelGI->m.MaxDistance = CLIPMAP_SIZE * m_VoxelSize * (1 << (LEVELS_COUNT-1));
+	for ( int LevelIndex=0; LevelIndex < LEVELS_COUNT; LevelIndex++ )
+	{
+		m_pLevelMins[LevelIndex] = float3::Zero;
+		m_pCB_VoxelGI->m.pLevels[LevelIndex].Set( 0.0f, 0.0f, 0.0f, m_VoxelSize * (1 << LevelIndex) );
+	}
+	m_pCB_Voxelize = new CB<CBVoxelize>( m_Device, 5, true );
+	memset( &m_pCB_Voxelize->m, 0, sizeof(CBVoxelize) );
+	m_pCB_Voxelize->m.ShadowBias = SHADOW_BIAS;
+
+	Invalidate();
+}
+
+VoxelGI::~VoxelGI()
+{
+	delete m_pCB_Voxelize;
+	delete m_pCB_VoxelGI;
+	delete m_pTexAnisotropic;
+	delete m_pTexRadiance;
+	delete m_pTexNormal;
+	delete m_pTexAlbedo;
+	delete m_pCSBuildAnisotropic;
+	delete m_pCSInject;
+	delete m_pMatVoxelize;
+}
+
+bool	VoxelGI::HasErrors() const
+{
+	return m_pMatVoxelize->HasErrors() || m_pCSInject->HasErrors() || m_pCSBuildAnisotropic->HasErrors();
+}
+
+void	VoxelGI::Invalidate()
+{
+	for ( int LevelIndex=0; LevelIndex < LEVELS_COUNT; LevelIndex++ )
+		m_pbLevelValid[LevelIndex] = false;
+}
+
+void	VoxelGI::Update( const float3& _CameraPosition, IVoxelizeScene& _VoxelizeScene, const float3& _SunDirection, const float3& _SunColor, const Texture2D& _SunShadowMap, const float4x4& _World2SunShadow )
+{
+	// Levels whose snapped position changed must be voxelized again
+	for ( int LevelIndex=0; LevelIndex < LEVELS_COUNT; LevelIndex++ )
+	{
+		float	SnapSize = 2.0f * m_VoxelSize * (1 << LevelIndex);	// Keeps the texels of the first anisotropic mip aligned
+		float	HalfExtent = 0.25f * CLIPMAP_SIZE * SnapSize;
+		float3	Min( SnapSize * floorf( (_CameraPosition.x - HalfExtent) / SnapSize ), SnapSize * floorf( (_CameraPosition.y - HalfExtent) / SnapSize ), SnapSize * floorf( (_CameraPosition.z - HalfExtent) / SnapSize ) );
+		if ( Min.x != m_pLevelMins[LevelIndex].x || Min.y != m_pLevelMins[LevelIndex].y || Min.z != m_pLevelMins[LevelIndex].z )
+		{
+			m_pLevelMins[LevelIndex] = Min;
+			m_pbLevelValid[LevelIndex] = false;
+		}
+	}
+
+	// The first invalid level, or level i every 2^(i+1) frames
+	m_FrameIndex++;
+	int	VoxelizedLevelIndex = 0;
+	while ( VoxelizedLevelIndex < LEVELS_COUNT && m_pbLevelValid[VoxelizedLevelIndex] )
+		VoxelizedLevelIndex++;
+	if ( VoxelizedLevelIndex == LEVELS_COUNT )
+	{
+		VoxelizedLevelIndex = 0;
+		while ( VoxelizedLevelIndex < LEVELS_COUNT-1 && (m_FrameIndex & (1 << VoxelizedLevelIndex)) == 0 )
+			VoxelizedLevelIndex++;
+	}
+
+	Voxelize( VoxelizedLevelIndex, _VoxelizeScene );
+
+	if ( Inject( _SunDirection, _SunColor, _SunShadowMap, _World2SunShadow ) )
+		BuildAnisotropic();
+}
+
+void	VoxelGI::Bind()
+{
+	m_pCB_VoxelGI->UpdateData();
+	m_pTexRadiance->Set( 58, true );
+	m_pTexAnisotropic->Set( 59, true );
+}
+
+void	VoxelGI::Voxelize( int _LevelIndex, IVoxelizeScene& _VoxelizeScene )
+{
+	float	VoxelSize = m_VoxelSize * (1 << _LevelIndex);
+	float	Extent = CLIPMAP_SIZE * VoxelSize;
+	float3	Min = m_pLevelMins[_LevelIndex];
+
+	m_pCB_Voxelize->m.LevelMin = Min;
+	m_pCB_Voxelize->m.VoxelSize = VoxelSize;
+	m_pCB_Voxelize->UpdateData();
+
+	// The level's slab of the albedo & normal volumes
+	m_pTexAlbedo->RemoveFromLastAssignedSlots();
+	m_pTexNormal->RemoveFromLastAssignedSlots();
+	ID3D11UnorderedAccessView*	ppUAVs[2] = {
+		m_pTexAlbedo->GetUAV( 0, _LevelIndex * CLIPMAP_SIZE, CLIPMAP_SIZE ),
+		m_pTexNormal->GetUAV( 0, _LevelIndex * CLIPMAP_SIZE, CLIPMAP_SIZE ),
+	};
+	const UINT	pZero[4] = { 0, 0, 0, 0 };
+	m_Device.DXContext().ClearUnorderedAccessViewUint( ppUAVs[0], pZero );
+	m_Device.DXContext().ClearUnorderedAccessViewUint( ppUAVs[1], pZero );
+
+	m_Device.SetStates( m_Device.m_pRS_CullNone, m_Device.m_pDS_Disabled, m_Device.m_pBS_Disabled );
+	m_Device.SetPixelShaderUAVs( CLIPMAP_SIZE, CLIPMAP_SIZE, 2, ppUAVs );
+
+	// Maps the level's box to [(-1,-1,0),(+1,+1,1)] for the culling
+	float4x4	Level2World;
+	Level2World.SetRow( 0, float3( 0.5f * Extent, 0.0f, 0.0f ) );
+	Level2World.SetRow( 1, float3( 0.0f, 0.5f * Extent, 0.0f ) );
+	Level2World.SetRow( 2, float3( 0.0f, 0.0f, Extent ) );
+	Level2World.SetRow( 3, Min + float3( 0.5f * Extent, 0.5f * Extent, 0.0f ), 1 );
+	float4x4	World2Level = Level2World.Inverse();
+
+	_VoxelizeScene( *m_pMatVoxelize, World2Level );
+
+	m_Device.RemoveUAVs();
+
+	// The level is used with the position it was voxelized at
+	m_pCB_VoxelGI->m.pLevels[_LevelIndex].Set( Min.x, Min.y, Min.z, VoxelSize );
+	m_pbLevelValid[_LevelIndex] = true;
+}
+
+bool	VoxelGI::Inject( const float3& _SunDirection, const float3& _SunColor, const Texture2D& _SunShadowMap, const float4x4& _World2SunShadow )
+{
+	if ( !m_pCSInject->Use() )
+		return false;
+
+	m_pCB_VoxelGI->UpdateData();	// CS_Inject reads the levels' positions
+	m_pCB_Voxelize->m.World2SunShadow = _World2SunShadow;
+	m_pCB_Voxelize->m.SunDirection = _SunDirection;
+	m_pCB_Voxelize->m.SunColor = _SunColor;
+	m_pCB_Voxelize->UpdateData();
+
+	m_pTexRadiance->RemoveFromLastAssignedSlots();
+	_SunShadowMap.SetCS( 11, true );
+	m_pTexAlbedo->SetCS( 12, true );
+	m_pTexNormal->SetCS( 13, true );
+	m_pTexRadiance->SetCSUAV( 2, m_pTexRadiance->GetUAV( 0, 0, LEVELS_COUNT * CLIPMAP_SIZE ) );
+
+	m_pCSInject->Dispatch( CLIPMAP_SIZE / THREADS_COUNT, CLIPMAP_SIZE / THREADS_COUNT, LEVELS_COUNT * CLIPMAP_SIZE / THREADS_COUNT );
+
+	m_Device.RemoveShaderResources( 11, 3, Device::SSF_COMPUTE_SHADER );
+	m_pTexRadiance->RemoveFromLastAssignedSlotUAV();
+
+	return true;
+}
+
+bool	VoxelGI::BuildAnisotropic()
+{
+	if ( !m_pCSBuildAnisotropic->Use() )
+		return false;
+
+	m_pTexAnisotropic->RemoveFromLastAssignedSlots();
+
+	int	TargetSize = CLIPMAP_SIZE / 2;
+	for ( int MipLevelIndex=0; MipLevelIndex < ANISO_MIPS_COUNT; MipLevelIndex++, TargetSize >>= 1 )
+	{
+		m_pCB_Voxelize->m.MipIndex = MipLevelIndex;
+		m_pCB_Voxelize->m.TargetSize = TargetSize;
+		m_pCB_Voxelize->UpdateData();
+
+		// The first mip is built from the isotropic radiance, the next ones from the previous mip
+		if ( MipLevelIndex == 0 )
+			m_pTexRadiance->SetCS( 14, true );
+		else
+			m_pTexAnisotropic->SetCS( 14, true, m_pTexAnisotropic->GetSRV( MipLevelIndex-1, 1 ) );
+		m_pTexAnisotropic->SetCSUAV( 3, m_pTexAnisotropic->GetUAV( MipLevelIndex, 0, LEVELS_COUNT * TargetSize ) );
+
+		m_pCSBuildAnisotropic->Dispatch( (6*TargetSize+THREADS_COUNT-1) / THREADS_COUNT, (TargetSize+THREADS_COUNT-1) / THREADS_COUNT, (LEVELS_COUNT*TargetSize+THREADS_COUNT-1) / THREADS_COUNT );
+
+		// Unbind before the written mip becomes the next source
+		m_Device.RemoveShaderResources( 14, 1, Device::SSF_COMPUTE_SHADER );
+		m_pTexAnisotropic->RemoveFromLastAssignedSlotUAV();
+	}
+
+	return true;
+}
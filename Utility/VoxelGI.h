@@ -0,0 +1,124 @@
+//////////////////////////////////////////////////////////////////////////
+// Voxel cone-traced global illumination (cf. VoxelGI.hlsl & Inc/VoxelConeTracing.hlsl)
+// Lights the scene with the radiance of a camera-centered clipmap of voxels instead of the probes, so the indirect lighting
+//	follows dynamic lights and geometry without any precomputation:
+//	_ The clipmap is made of LEVELS_COUNT nested levels of CLIPMAP_SIZE^3 voxels, each twice as large as the previous one,
+//		snapped to 2 voxels of their size around the camera
+//	_ One level per frame is voxelized: the finest every 2nd frame, the next every 4th frame, etc. A level whose snapped
+//		position changed is voxelized first. The provided delegate draws the scene with the voxelization material, that
+//		projects the triangles along their dominant axis and averages their albedo & normal into the voxels with atomics
+//	_ All the levels are then lit each frame by the sun through its shadow map (CS_Inject) and the 6 directional volumes are
+//		rebuilt from the result with their mips (CS_BuildAnisotropic)
+//
+// Usage:
+//	VoxelGI	GI( gs_Device, SceneVertexFormat, pMacros );	// pMacros tells how the scene's vertices are packed
+//	(...)
+//	GI.Update( CameraPosition, VoxelizeDelegate, SunDirection, SunColor, *pRTSunShadowMap, World2SunShadow );
+//	GI.Bind();										// Scene shaders can now call ConeTraceDiffuse() & ConeTraceSpecular()
+//
+// NOTE: Update() leaves no render target bound. The global slots b7, t58 & t59 are bound by Bind(), the slots
+//	b5, t10 to t14 & u0 to u3 are overwritten.
+//
+#pragma once
+
+template<typename> class CB;
+
+class	VoxelGI
+{
+public:		// CONSTANTS
+
+	static const int	CLIPMAP_SIZE = 64;			// !!IMPORTANT ==> Must correspond to VOXEL_CLIPMAP_SIZE in Inc/VoxelConeTracing.hlsl!!
+	static const int	LEVELS_COUNT = 4;			// !!IMPORTANT ==> Must correspond to VOXEL_LEVELS_MAX in Inc/VoxelConeTracing.hlsl!!
+	static const int	ANISO_MIPS_COUNT = 6;		// Down to a single texel per direction & level
+	static const float	DEFAULT_VOXEL_SIZE;			// Size of the finest level's voxels (in meters)
+
+public:		// NESTED TYPES
+
+	// Draws the scene geometry with the provided material, the meshes outside of the level can be culled with _World2Level
+	//	that maps the level's box to [(-1,-1,0),(+1,+1,1)] like a projection
+	class	IVoxelizeScene
+	{
+	public:	virtual void	operator()( Shader& _Material, const float4x4& _World2Level ) = 0;
+	};
+
+protected:
+
+	// WARNING: must match the cbVoxelGI constant buffer in Inc/VoxelConeTracing.hlsl!
+	struct	CBVoxelGI
+	{
+		float4		pLevels[LEVELS_COUNT];	// XYZ = minimum corner, W = voxel size
+		U32			LevelsCount;
+		float		MaxDistance;
+		float		__PAD[2];
+	};
+
+	// WARNING: must match the cbVoxelize constant buffer in VoxelGI.hlsl!
+	struct	CBVoxelize
+	{
+		float3		LevelMin;
+		float		VoxelSize;
+		U32			MipIndex;
+		U32			TargetSize;
+		U32			__PAD0;
+		float		ShadowBias;
+
+		float4x4	World2SunShadow;
+		float3		SunDirection;
+		float		__PAD1;
+		float3		SunColor;
+		float		__PAD2;
+	};
+
+protected:	// FIELDS
+
+	Device&				m_Device;
+
+	float				m_VoxelSize;
+
+	Shader*				m_pMatVoxelize;
+	ComputeShader*		m_pCSInject;
+	ComputeShader*		m_pCSBuildAnisotropic;
+
+	Texture3D*			m_pTexAlbedo;		// Packed RGBA8 averages, A = fragments count
+	Texture3D*			m_pTexNormal;
+	Texture3D*			m_pTexRadiance;		// A = opacity
+	Texture3D*			m_pTexAnisotropic;	// The 6 directions stacked in X at half the resolution, with mips
+	CB<CBVoxelGI>*		m_pCB_VoxelGI;
+	CB<CBVoxelize>*		m_pCB_Voxelize;
+
+	float3				m_pLevelMins[LEVELS_COUNT];	// Where each level was last voxelized
+	bool				m_pbLevelValid[LEVELS_COUNT];
+	U32					m_FrameIndex;
+
+public:		// PROPERTIES
+
+	bool				HasErrors() const;
+	Shader&				GetVoxelizeMaterial()	{ return *m_pMatVoxelize; }
+
+	const Texture3D&	GetRadiance() const		{ return *m_pTexRadiance; }
+	const Texture3D&	GetAnisotropic() const	{ return *m_pTexAnisotropic; }
+
+public:		// METHODS
+
+	// _SceneVertexFormat & _pMacros, vertex format of the scene primitives drawn by the voxelization delegate and the macros
+	//	telling the voxelization material how to decode them (e.g. PACKED_VERTICES)
+	// _VoxelSize, size of the finest level's voxels, the coarsest level then covers CLIPMAP_SIZE * _VoxelSize * 2^(LEVELS_COUNT-1)
+	VoxelGI( Device& _Device, const IVertexFormatDescriptor& _SceneVertexFormat, D3D_SHADER_MACRO* _pMacros=NULL, float _VoxelSize=DEFAULT_VOXEL_SIZE );
+	~VoxelGI();
+
+	// Moves the levels around the camera, voxelizes one of them, then lights the whole clipmap by the sun
+	// _World2SunShadow, maps the sun's shadow map to [(-1,-1,0),(+1,+1,1)] (e.g. the World2Light of the shadow map)
+	void				Update( const float3& _CameraPosition, IVoxelizeScene& _VoxelizeScene, const float3& _SunDirection, const float3& _SunColor, const Texture2D& _SunShadowMap, const float4x4& _World2SunShadow );
+
+	// Binds the clipmap for the scene shaders
+	void				Bind();
+
+	// Voxelizes all the levels again (e.g. after the scene changed)
+	void				Invalidate();
+
+protected:
+
+	void				Voxelize( int _LevelIndex, IVoxelizeScene& _VoxelizeScene );
+	bool				Inject( const float3& _SunDirection, const float3& _SunColor, const Texture2D& _SunShadowMap, const float4x4& _World2SunShadow );
+	bool				BuildAnisotropic();
+};
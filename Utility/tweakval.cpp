@@ -8,6 +8,12 @@
 
 namespace tweakval
 {
+	static const int	MAX_TWEAKABLE_VALUES = 4096;	// Must be a power of 2
+	static const int	MAX_TWEAKABLE_FILES = 256;		// Must be a power of 2
+	static const int	MAX_LISTENERS = 16;
+
+	// The tables are open-addressed and lock-free: a slot is claimed by swapping its key from 0, then its fields are written and
+	//	it's flagged as ready. Slots are never released so a reader can keep a pointer to them.
 	struct Tweakable
 	{
 		enum TweakableType
@@ -16,77 +22,100 @@ namespace tweakval
 			Type_FLOAT,
 		};
 
-		TweakableType type;
-		union
-		{
-			float	f;
-			int		i;
-		} val;
+		volatile LONG	Key;
+		volatile LONG	bReady;
+		const char*		pFilename;
+		size_t			Counter;
+		TweakableType	type;
+		volatile LONG	val;		// Bits of the int or float, written atomically by the reloader thread
+
+		bool	Matches( const char* _pFilename, size_t _Counter ) const	{ return Counter == _Counter && (pFilename == _pFilename || !strcmp( pFilename, _pFilename )); }
 	};
 
 	struct TweakableSourceFile
 	{
-//		char		pFilename[1024];
-		const char*	pFilename;
-		time_t		LastModificationTime;
+		volatile LONG	Key;
+		volatile LONG	bReady;
+		const char*		pFilename;
+		time_t			LastModificationTime;	// Only accessed by the reloader thread once ready
+
+		bool	Matches( const char* _pFilename, size_t ) const			{ return pFilename == _pFilename || !strcmp( pFilename, _pFilename ); }
+	};
+
+	struct Listener
+	{
+		TweakableValuesChanged	pCallback;
+		void*					pUserData;
 	};
 
-	static Dictionary<TweakableSourceFile>	g_TweakableFiles;
-	static Dictionary<Tweakable>			g_TweakableValues;
+	static Tweakable				g_pTweakableValues[MAX_TWEAKABLE_VALUES];
+	static TweakableSourceFile		g_pTweakableFiles[MAX_TWEAKABLE_FILES];
+	static volatile LONG			g_bReloaderStarted = 0;
+	static volatile LONG			g_ValuesVersion = 0;
+	static Listener					g_pListeners[MAX_LISTENERS];
+	static int						g_ListenersCount = 0;
 
 	U32			HashKey( const char* _pFileName, size_t _Counter )
 	{
-		static char	pStringKey[1024];
-		sprintf_s( pStringKey, 1024, "%s#%d", _pFileName, _Counter );
-
-		U32	Hash = DictionaryString<int>::Hash( pStringKey );
-		return Hash;
+		U32	Hash = DictionaryString<int>::Hash( _pFileName ) ^ (U32(_Counter + 1) * 0x9E3779B1U);
+		return Hash != 0 ? Hash : 1;	// 0 marks the free slots
 	}
 
-	Tweakable*	LookupTweakValue( const char* _pFileName, size_t _Counter )
+	// Returns the slot of the entry, or claims a free one when _pbClaimed is given (the caller must then fill it and flag it ready)
+	// Returns NULL if the entry wasn't found or the table is full
+	template<typename T> T*	FindSlot( T* _pTable, int _TableSize, const char* _pFileName, size_t _Counter, bool* _pbClaimed )
 	{
-		U32	Hash = HashKey( _pFileName, _Counter );
-		return g_TweakableValues.Get( Hash );
-	}
+		U32	Key = HashKey( _pFileName, _Counter );
+		for ( int Probe=0; Probe < _TableSize; Probe++ )
+		{
+			T&		Slot = _pTable[(Key + Probe) & (_TableSize-1)];
+			LONG	SlotKey = Slot.Key;
+			if ( SlotKey == 0 )
+			{
+				if ( _pbClaimed == NULL )
+					return NULL;	// Never registered
 
-	time_t		GetFileModTime( const char* _pFileName )
-	{	
-		struct _stat statInfo;
-		_stat( _pFileName, &statInfo );
+				SlotKey = InterlockedCompareExchange( &Slot.Key, LONG(Key), 0 );
+				if ( SlotKey == 0 )
+				{
+					*_pbClaimed = true;
+					return &Slot;
+				}
+			}
+			if ( SlotKey != LONG(Key) )
+				continue;
 
-		return statInfo.st_mtime;
+			while ( !Slot.bReady )
+				YieldProcessor();	// Another thread is registering it right now
+			if ( Slot.Matches( _pFileName, _Counter ) )
+				return &Slot;
+		}
+
+		return NULL;
 	}
 
-	Tweakable&	AddTweakableValue( const char* _pFilename, size_t _Counter )
+	time_t		GetFileModTime( const char* _pFileName )
 	{
-		// First, see if this file is in the files list
-		U32		Key = DictionaryString<int>::Hash( _pFilename );
-		TweakableSourceFile*	pFileEntry = g_TweakableFiles.Get( Key );
-		if ( pFileEntry == NULL )
-		{	// if it's not found, add to the list of tweakable files, assume it's unmodified since the program has been built 
-			TweakableSourceFile&	Value = g_TweakableFiles.Add( Key );
-// 			strcpy( Value.pFilename, _pFilename );
-			Value.pFilename = _pFilename;
-			Value.LastModificationTime = GetFileModTime( _pFilename );
-		}
+		struct _stat statInfo;
+		if ( _stat( _pFileName, &statInfo ) != 0 )
+			return 0;
 
-		// Add to the tweakables
-		Key = HashKey( _pFilename, _Counter );
-		return g_TweakableValues.Add( Key );
+		return statInfo.st_mtime;
 	}
 
 	void	ReloadTweakableFile( TweakableSourceFile& _SrcFile )
-	{	
+	{
 		size_t	counter = 0;
 		FILE*	fp = fopen( _SrcFile.pFilename, "rt" );
-	
+		if ( fp == NULL )
+			return;	// Probably still being written, we'll retry on the next change
+
 		char line[2048], strval[512];
-		while ( !feof( fp ) )
+		while ( fgets( line, 2048, fp ) != NULL )
 		{
-			fgets( line, 2048, fp );
 			char*	ch = line;
 
-			// chop off c++ comments. C style comments, and 
+			// chop off c++ comments. C style comments, and
 			// preprocessor directives like #if 0 are not currently
 			// handled so beware if you use those too much
 			char*	comment = strstr( line, "//" );
@@ -98,7 +127,7 @@ namespace tweakval
 			{
 				ch += 4; // skip the _TV( value
 				char*	chend = strstr( ch, ")" );
-				if ( !chend)
+				if ( !chend || chend-ch >= 512 )
 					break;	// Unmatched parenthesis
 
 				strncpy( strval, ch, chend-ch );
@@ -108,16 +137,17 @@ namespace tweakval
 				ch = chend;
 
 				// Apply the tweaked value (if found)
-				Tweakable*	tv = LookupTweakValue( _SrcFile.pFilename, counter );
+				Tweakable*	tv = FindSlot( g_pTweakableValues, MAX_TWEAKABLE_VALUES, _SrcFile.pFilename, counter, NULL );
 				if ( tv )
 				{
 					if ( tv->type == Tweakable::Type_INT )
 					{
-						tv->val.i = atoi( strval );
+						InterlockedExchange( &tv->val, LONG(atoi( strval )) );
 					}
 					else if ( tv->type == Tweakable::Type_FLOAT )
 					{
-						tv->val.f = float(atof( strval ));
+						float	Value = float(atof( strval ));
+						InterlockedExchange( &tv->val, *((LONG*) &Value) );
 					}
 				}
 
@@ -127,57 +157,128 @@ namespace tweakval
 		fclose( fp );
 	}
 
+	// Checks the files for changes at regular intervals and re-parses them, so the threads using _TV() never wait for the disk
+	DWORD WINAPI	ReloaderThread( LPVOID _pParam )
+	{
+		while ( true )
+		{
+			Sleep( MATERIAL_REFRESH_CHANGES_INTERVAL );
+
+			bool	bChanged = false;
+			for ( int FileIndex=0; FileIndex < MAX_TWEAKABLE_FILES; FileIndex++ )
+			{
+				TweakableSourceFile&	File = g_pTweakableFiles[FileIndex];
+				if ( !File.bReady )
+					continue;
+
+				time_t	LastModificationTime = GetFileModTime( File.pFilename );
+				if ( LastModificationTime <= File.LastModificationTime )
+					continue;	// No change !
+
+				File.LastModificationTime = LastModificationTime;
+				ReloadTweakableFile( File );
+				bChanged = true;
+			}
+
+			if ( bChanged )
+				InterlockedIncrement( &g_ValuesVersion );
+		}
+
+		return 0;
+	}
+
+	void	RegisterTweakableFile( const char* _pFilename )
+	{
+		bool	bClaimed = false;
+		TweakableSourceFile*	pFileEntry = FindSlot( g_pTweakableFiles, MAX_TWEAKABLE_FILES, _pFilename, 0, &bClaimed );
+		ASSERT( pFileEntry != NULL, "Too many files with tweakable values!" );
+		if ( bClaimed )
+		{	// if it's not found, add to the list of tweakable files, assume it's unmodified since the program has been built
+			pFileEntry->pFilename = _pFilename;
+			pFileEntry->LastModificationTime = GetFileModTime( _pFilename );
+			InterlockedExchange( &pFileEntry->bReady, 1 );
+		}
+
+		// Start watching with the first file
+		if ( InterlockedCompareExchange( &g_bReloaderStarted, 1, 0 ) == 0 )
+		{
+			DWORD	ThreadID;
+			HANDLE	hThread = CreateThread( NULL, 0, ReloaderThread, NULL, 0, &ThreadID );
+			ASSERT( hThread != NULL, "Failed to create the tweakable values reloader thread!" );
+			CloseHandle( hThread );	// Runs until the process exits
+		}
+	}
+
+	// Returns the tweakable of the call site, registering it with its original value the first time
+	Tweakable*	GetTweakable( const char* _pFilename, size_t _Counter, Tweakable::TweakableType _Type, LONG _OriginalValue )
+	{
+		bool		bClaimed = false;
+		Tweakable*	tv = FindSlot( g_pTweakableValues, MAX_TWEAKABLE_VALUES, _pFilename, _Counter, &bClaimed );
+		ASSERT( tv != NULL, "Too many tweakable values!" );
+		if ( bClaimed )
+		{
+			tv->pFilename = _pFilename;
+			tv->Counter = _Counter;
+			tv->type = _Type;
+			tv->val = _OriginalValue;
+			InterlockedExchange( &tv->bReady, 1 );
+
+			RegisterTweakableFile( _pFilename );
+		}
+
+		return tv;
+	}
+
 } // namespace tweakval
 
 using namespace tweakval;
 float _TweakValue( const char* file, size_t counter, float origVal )
 {
-	Tweakable*	tv = LookupTweakValue( file, counter );
+	Tweakable*	tv = GetTweakable( file, counter, Tweakable::Type_FLOAT, *((LONG*) &origVal) );
 	if ( !tv )
-	{
-		tv = &AddTweakableValue( file, counter );
-		tv->type = Tweakable::Type_FLOAT;
-		tv->val.f = origVal;
-	}
+		return origVal;
 
-	return tv->val.f;
+	LONG	Value = tv->val;
+	return *((float*) &Value);
 }
 
 int _TweakValue( const char *file, size_t counter, int origVal )
 {
-	Tweakable*	tv = LookupTweakValue( file, counter );
+	Tweakable*	tv = GetTweakable( file, counter, Tweakable::Type_INT, LONG(origVal) );
 	if ( !tv )
-	{
-		tv = &AddTweakableValue( file, counter );
-		tv->type = Tweakable::Type_INT;
-		tv->val.i = origVal;
-	}
+		return origVal;
 
-	return tv->val.i;
+	return int(tv->val);
 }
 
-void	FilesVisitor( int _EntryIndex, TweakableSourceFile& _File, void* _pUserData )
+void	ReloadChangedTweakableValues()
 {
-	time_t	LastModificationTime = GetFileModTime( _File.pFilename );
-	if ( LastModificationTime <= _File.LastModificationTime )
+	static LONG	LastVersion = 0;
+	LONG		Version = g_ValuesVersion;
+	if ( Version == LastVersion )
 		return;	// No change !
 
-	_File.LastModificationTime = LastModificationTime;
-	ReloadTweakableFile( _File );
+	LastVersion = Version;
+
+	// Notify the listeners
+	for ( int ListenerIndex=0; ListenerIndex < g_ListenersCount; ListenerIndex++ )
+		(*g_pListeners[ListenerIndex].pCallback)( g_pListeners[ListenerIndex].pUserData );
 }
 
-void	ReloadChangedTweakableValues()
+void	AddTweakableValuesListener( TweakableValuesChanged _pCallback, void* _pUserData )
+{
+	ASSERT( g_ListenersCount < MAX_LISTENERS, "Too many tweakable values listeners!" );
+	if ( g_ListenersCount == MAX_LISTENERS )
+		return;
+
+	g_pListeners[g_ListenersCount].pCallback = _pCallback;
+	g_pListeners[g_ListenersCount].pUserData = _pUserData;
+	g_ListenersCount++;
+}
+
+U32		GetTweakableValuesVersion()
 {
-	static int	LastTime = -1;
-	int			CurrentTime = timeGetTime();
-	if ( LastTime >= 0 && (CurrentTime - LastTime) < MATERIAL_REFRESH_CHANGES_INTERVAL )
-		return;	// Too soon to check !
-
-	// Update last check time
-	LastTime = CurrentTime;
-		
-	// Go through the list of Tweakable Files and see if any have changed since their last modification time
-	g_TweakableFiles.ForEach( FilesVisitor, NULL );
+	return U32(g_ValuesVersion);
 }
 
 #endif
@@ -31,6 +31,15 @@
 //     // initial monster health
 //     Monster *m = new Monster( _TV( 10 ) );
 //
+//   THREADING:
+//   _TV() can be used from any thread (e.g. jobs), values are
+//   looked up in a lock-free table and read atomically.
+//   The source files are checked and re-parsed by a background
+//   thread, the main loop's ReloadChangedTweakableValues() then
+//   notifies the listeners (on the main thread) that values changed:
+//
+//     AddTweakableValuesListener( OnTweaked, this );	// Rebuild what depends on _TV()s
+//
 //   WARNING: 
 //   This is currently in a very rough state, it doesn't
 //   handle errors, c-style comments, and adding and removing or
@@ -38,7 +47,7 @@
 //   Also, putting _TV's in header files is not a good idea.
 //=========================================================
 
-#define MATERIAL_REFRESH_CHANGES_INTERVAL	500		// Time in ms between checks for changes
+#define MATERIAL_REFRESH_CHANGES_INTERVAL	500		// Time in ms between checks for changes (by the reloader thread)
 
 
 // Do only in debug builds
@@ -46,13 +55,19 @@
 
 #  define _TV(Val) _TweakValue( __FILE__, __COUNTER__, Val )
 
+typedef void	(*TweakableValuesChanged)( void* _pUserData );
+
 float	_TweakValue( const char *file, size_t counter, float origVal );
 int		_TweakValue( const char *file, size_t counter, int origVal );
-void	ReloadChangedTweakableValues();
+void	ReloadChangedTweakableValues();		// Called by the main loop, notifies the listeners if the reloader thread changed values
+void	AddTweakableValuesListener( TweakableValuesChanged _pCallback, void* _pUserData );	// Main thread only
+U32		GetTweakableValuesVersion();		// Incremented each time the reloader thread changes values
 
 #else
 
 #  define _TV(Val) Val
 #  define ReloadChangedTweakableValues()
+#  define AddTweakableValuesListener( _pCallback, _pUserData )
+#  define GetTweakableValuesVersion()	0U
 
 #endif